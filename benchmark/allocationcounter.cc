@@ -0,0 +1,231 @@
+#include "allocationcounter.hh"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <atomic>
+#include <limits>
+#include <cstdlib>
+#include <new>
+
+#include "logger.hh"
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+/* ********************************************************************************************* *
+ * Counting hooks
+ * ********************************************************************************************* */
+// Counters are constant-initialized, hence valid before any static constructor allocates.
+static std::atomic<quint64> allocationCount(0);
+static std::atomic<quint64> allocationBytes(0);
+
+static inline void
+countAllocation(size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocationBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+// Interpose the malloc family, glibc exports the actual implementation under these names.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) noexcept {
+  countAllocation(size);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) noexcept {
+  countAllocation(n*size);
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept {
+  countAllocation(size);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) noexcept {
+  __libc_free(ptr);
+}
+}
+#else
+// Replace the global operator new, allocations by malloc (e.g., Qt containers) are not counted.
+static inline void *
+countedNew(size_t size) {
+  countAllocation(size);
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new(size_t size) { return countedNew(size); }
+void *operator new[](size_t size) { return countedNew(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  countAllocation(size); return std::malloc(size ? size : 1);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  countAllocation(size); return std::malloc(size ? size : 1);
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+#endif
+
+
+/* ********************************************************************************************* *
+ * Implementation of AllocationCounter
+ * ********************************************************************************************* */
+AllocationCounter::AllocationCounter()
+  : _allocations(0), _bytes(0)
+{
+  restart();
+}
+
+void
+AllocationCounter::restart() {
+  _allocations = allocationCount.load(std::memory_order_relaxed);
+  _bytes = allocationBytes.load(std::memory_order_relaxed);
+}
+
+quint64
+AllocationCounter::allocations() const {
+  return allocationCount.load(std::memory_order_relaxed) - _allocations;
+}
+
+quint64
+AllocationCounter::bytes() const {
+  return allocationBytes.load(std::memory_order_relaxed) - _bytes;
+}
+
+quint64
+AllocationCounter::peakRSS() {
+#if defined(Q_OS_WIN)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (! GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return 0;
+  return counters.PeakWorkingSetSize;
+#else
+  struct rusage usage;
+  if (0 != getrusage(RUSAGE_SELF, &usage))
+    return 0;
+#if defined(Q_OS_MACOS)
+  // Reported in bytes on macOS
+  return quint64(usage.ru_maxrss);
+#else
+  // Reported in KiB elsewhere
+  return quint64(usage.ru_maxrss)*1024;
+#endif
+#endif
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of AllocationBudget
+ * ********************************************************************************************* */
+AllocationBudget::AllocationBudget()
+  : _limits()
+{
+  // pass...
+}
+
+bool
+AllocationBudget::load(const QString &filename, QString &errorMessage) {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errorMessage = QString("Cannot open budget '%1': %2").arg(filename, file.errorString());
+    return false;
+  }
+
+  QJsonParseError error;
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+  if (! doc.isObject()) {
+    errorMessage = QString("Cannot parse budget '%1': %2").arg(filename, error.errorString());
+    return false;
+  }
+
+  _limits.clear();
+  QJsonObject scenarios = doc.object();
+  foreach (const QString &key, scenarios.keys()) {
+    if (! scenarios.value(key).isObject()) {
+      errorMessage = QString("Cannot parse budget '%1': Limits of '%2' are not an object.")
+          .arg(filename, key);
+      return false;
+    }
+    QJsonObject obj = scenarios.value(key).toObject();
+    Limits limits;
+    limits.allocations = qint64(obj.value("allocations").toDouble(-1));
+    limits.bytes = qint64(obj.value("bytes").toDouble(-1));
+    limits.peakRSS = qint64(obj.value("peak_rss").toDouble(-1));
+    _limits.insert(key, limits);
+  }
+
+  return true;
+}
+
+bool
+AllocationBudget::isEmpty() const {
+  return _limits.isEmpty();
+}
+
+AllocationBudget::Limits
+AllocationBudget::limits(const QString &scenario) const {
+  // Specificity of the key used for each limit: exact matches win, then the longest prefix.
+  Limits limits;
+  int allocations = -1, bytes = -1, peakRSS = -1;
+  for (QHash<QString, Limits>::const_iterator it=_limits.begin(); it!=_limits.end(); it++) {
+    int specificity = -1;
+    if (it.key() == scenario)
+      specificity = std::numeric_limits<int>::max();
+    else if (it.key().endsWith('*') && scenario.startsWith(it.key().left(it.key().size()-1)))
+      specificity = it.key().size();
+    if (specificity < 0)
+      continue;
+
+    if ((0 <= it->allocations) && (specificity > allocations)) {
+      limits.allocations = it->allocations; allocations = specificity;
+    }
+    if ((0 <= it->bytes) && (specificity > bytes)) {
+      limits.bytes = it->bytes; bytes = specificity;
+    }
+    if ((0 <= it->peakRSS) && (specificity > peakRSS)) {
+      limits.peakRSS = it->peakRSS; peakRSS = specificity;
+    }
+  }
+  return limits;
+}
+
+bool
+AllocationBudget::check(const QString &scenario, quint64 allocations, quint64 bytes,
+                        quint64 peakRSS) const
+{
+  Limits lim = limits(scenario);
+  bool ok = true;
+  if ((0 <= lim.allocations) && (allocations > quint64(lim.allocations))) {
+    logError() << "Budget of '" << scenario << "' exceeded: " << allocations
+               << " allocations, limit " << lim.allocations << ".";
+    ok = false;
+  }
+  if ((0 <= lim.bytes) && (bytes > quint64(lim.bytes))) {
+    logError() << "Budget of '" << scenario << "' exceeded: " << bytes
+               << " bytes allocated, limit " << lim.bytes << ".";
+    ok = false;
+  }
+  if ((0 <= lim.peakRSS) && (peakRSS > quint64(lim.peakRSS))) {
+    logError() << "Budget of '" << scenario << "' exceeded: peak RSS " << peakRSS
+               << " bytes, limit " << lim.peakRSS << ".";
+    ok = false;
+  }
+  return ok;
+}
@@ -0,0 +1,83 @@
+/* Allocation counting for the benchmarks.
+ * Linking allocationcounter.cc into a program counts all heap allocations of the process. With
+ * glibc, the malloc family is interposed, hence allocations of Qt containers and strings are
+ * counted too. On other platforms, only the global operator new is replaced. */
+#ifndef ALLOCATIONCOUNTER_HH
+#define ALLOCATIONCOUNTER_HH
+
+#include <QtGlobal>
+#include <QString>
+#include <QHash>
+
+
+/** Counts the heap allocations and the bytes allocated since the construction or the last
+ * restart of the counter. Allocations of all threads are counted. */
+class AllocationCounter
+{
+public:
+  /** Starts counting. */
+  AllocationCounter();
+
+  /** Restarts counting. */
+  void restart();
+  /** Returns the number of allocations since the start. */
+  quint64 allocations() const;
+  /** Returns the number of bytes allocated since the start. Memory freed in between is not
+   * subtracted. */
+  quint64 bytes() const;
+
+  /** Returns the peak resident set size of the process in bytes or 0 if unknown. */
+  static quint64 peakRSS();
+
+protected:
+  /** The total number of allocations at the start. */
+  quint64 _allocations;
+  /** The total number of bytes allocated at the start. */
+  quint64 _bytes;
+};
+
+
+/** Per-scenario limits of the allocations and the peak RSS, read from a JSON file like
+ * @code
+ * {
+ *   "d878uv/encode": {"allocations": 20000, "bytes": 8000000},
+ *   "readYAML:*": {"allocations": 50000},
+ *   "*": {"peak_rss": 500000000}
+ * }
+ * @endcode
+ * A key ending with '*' applies to all scenarios starting with the key. The most specific key
+ * is used for each limit, missing limits are not checked. */
+class AllocationBudget
+{
+public:
+  /** Limits of a scenario, negative limits are not checked. */
+  struct Limits {
+    /** Maximum number of allocations. */
+    qint64 allocations = -1;
+    /** Maximum number of bytes allocated. */
+    qint64 bytes = -1;
+    /** Maximum peak resident set size in bytes. */
+    qint64 peakRSS = -1;
+  };
+
+public:
+  /** Constructs an empty budget, accepting everything. */
+  AllocationBudget();
+
+  /** Reads the budget from the given JSON file. */
+  bool load(const QString &filename, QString &errorMessage);
+  /** Returns @c true if no limits are set. */
+  bool isEmpty() const;
+
+  /** Returns the limits for the given scenario. */
+  Limits limits(const QString &scenario) const;
+  /** Checks the given numbers against the limits of the scenario. Every exceeded limit gets
+   * logged as an error. Returns @c false if any limit is exceeded. */
+  bool check(const QString &scenario, quint64 allocations, quint64 bytes, quint64 peakRSS) const;
+
+protected:
+  /** The limits by scenario key. */
+  QHash<QString, Limits> _limits;
+};
+
+#endif // ALLOCATIONCOUNTER_HH
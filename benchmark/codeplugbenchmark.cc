@@ -0,0 +1,288 @@
+/* Codeplug benchmark.
+ * Measures the time spent in the individual stages of encoding and decoding a codeplug for every
+ * supported radio model. The configuration is generated synthetically, hence the results only
+ * depend on the size of the config and not on some particular codeplug file.
+ *
+ * The results are written as CSV (default) or as JSON lines to stdout. Each record contains the
+ * radio, the stage, the config size and the minimum, median and maximum time in microseconds
+ * over all repetitions. Additionally, it contains the median number of heap allocations and bytes
+ * allocated per run of the stage and the peak RSS of the process after the stage. If a budget
+ * file is given (see AllocationBudget), the scenarios "radio/stage" exceeding their budget are
+ * reported and the benchmark fails. */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+
+#include "logger.hh"
+#include "config.hh"
+#include "codeplug.hh"
+#include "syntheticconfig.hh"
+#include "allocationcounter.hh"
+
+#include "d868uv_codeplug.hh"
+#include "d878uv_codeplug.hh"
+#include "d878uv2_codeplug.hh"
+#include "d578uv_codeplug.hh"
+#include "dmr6x2uv_codeplug.hh"
+#include "gd77_codeplug.hh"
+#include "rd5r_codeplug.hh"
+#include "opengd77_codeplug.hh"
+#include "openrtx_codeplug.hh"
+#include "md390_codeplug.hh"
+#include "uv390_codeplug.hh"
+#include "md2017_codeplug.hh"
+#include "dm1701_codeplug.hh"
+#include "dr1801uv_codeplug.hh"
+#include "gd73_codeplug.hh"
+
+
+/** Pairs a radio key with a factory for its codeplug. */
+struct BenchmarkRadio {
+  /** The radio key, as used by dmrconf. */
+  QString key;
+  /** Creates a new, empty codeplug for the radio. */
+  std::function<Codeplug *()> create;
+};
+
+/** Timing statistics of a single stage. */
+struct BenchmarkResult {
+  /** Stage name. */
+  QString stage;
+  /** Individual timings in ns. */
+  QVector<qint64> timings;
+  /** If a stage failed, holds the error message. */
+  QString error;
+  /** Number of allocations of each run. */
+  QVector<quint64> allocations = {};
+  /** Number of bytes allocated by each run. */
+  QVector<quint64> bytes = {};
+  /** Peak RSS of the process after the last run. */
+  quint64 peakRSS = 0;
+
+  /** Records a single run. */
+  void record(qint64 ns, const AllocationCounter &counter) {
+    timings.append(ns);
+    allocations.append(counter.allocations());
+    bytes.append(counter.bytes());
+    peakRSS = AllocationCounter::peakRSS();
+  }
+};
+
+
+static QList<BenchmarkRadio>
+benchmarkRadios() {
+  return {
+    { "d868uv",   []() -> Codeplug * { return new D868UVCodeplug(); } },
+    { "d878uv",   []() -> Codeplug * { return new D878UVCodeplug(); } },
+    { "d878uv2",  []() -> Codeplug * { return new D878UV2Codeplug(); } },
+    { "d578uv",   []() -> Codeplug * { return new D578UVCodeplug(); } },
+    { "dmr6x2uv", []() -> Codeplug * { return new DMR6X2UVCodeplug(); } },
+    { "gd77",     []() -> Codeplug * { return new GD77Codeplug(); } },
+    { "rd5r",     []() -> Codeplug * { return new RD5RCodeplug(); } },
+    { "opengd77", []() -> Codeplug * { return new OpenGD77Codeplug(); } },
+    { "openrtx",  []() -> Codeplug * { return new OpenRTXCodeplug(); } },
+    { "md390",    []() -> Codeplug * { return new MD390Codeplug(); } },
+    { "uv390",    []() -> Codeplug * { return new UV390Codeplug(); } },
+    { "md2017",   []() -> Codeplug * { return new MD2017Codeplug(); } },
+    { "dm1701",   []() -> Codeplug * { return new DM1701Codeplug(); } },
+    { "dr1801uv", []() -> Codeplug * { return new DR1801UVCodeplug(); } },
+    { "gd73",     []() -> Codeplug * { return new GD73Codeplug(); } }
+  };
+}
+
+
+/** Runs all stages @c runs times for the given radio and config. */
+static QList<BenchmarkResult>
+benchmarkRadio(const BenchmarkRadio &radio, Config *config, unsigned int runs) {
+  BenchmarkResult preprocess{"preprocess", {}, {}}, index{"index", {}, {}},
+      encode{"encode", {}, {}}, decode{"decode", {}, {}}, postprocess{"postprocess", {}, {}};
+
+  Codeplug::Flags flags; flags.updateCodePlug = false;
+  QElapsedTimer timer;
+  AllocationCounter counter;
+
+  for (unsigned int r=0; r<runs; r++) {
+    Codeplug *codeplug = radio.create();
+    ErrorStack err;
+
+    // Preprocess creates a radio-specific copy of the config
+    counter.restart(); timer.start();
+    Config *prepared = codeplug->preprocess(config, err);
+    preprocess.record(timer.nsecsElapsed(), counter);
+    if (nullptr == prepared) {
+      preprocess.error = err.format(" ");
+      delete codeplug;
+      break;
+    }
+
+    // Index of the prepared config
+    Codeplug::Context ctx(prepared);
+    counter.restart(); timer.start();
+    bool ok = codeplug->index(prepared, ctx, err);
+    index.record(timer.nsecsElapsed(), counter);
+    if (! ok)
+      index.error = err.format(" ");
+
+    // Full encoding, this includes indexing and the allocation of the codeplug memory
+    counter.restart(); timer.start();
+    ok = codeplug->encode(prepared, flags, err);
+    encode.record(timer.nsecsElapsed(), counter);
+    delete prepared;
+    if (! ok) {
+      encode.error = err.format(" ");
+      delete codeplug;
+      break;
+    }
+
+    // Decode the freshly encoded codeplug
+    Config decoded;
+    counter.restart(); timer.start();
+    ok = codeplug->decode(&decoded, err);
+    decode.record(timer.nsecsElapsed(), counter);
+    if (! ok) {
+      decode.error = err.format(" ");
+      delete codeplug;
+      break;
+    }
+
+    counter.restart(); timer.start();
+    ok = codeplug->postprocess(&decoded, err);
+    postprocess.record(timer.nsecsElapsed(), counter);
+    if (! ok)
+      postprocess.error = err.format(" ");
+
+    delete codeplug;
+  }
+
+  return {preprocess, index, encode, decode, postprocess};
+}
+
+
+/** Writes the result and checks it against the budget. Returns @c false if the budget is
+ * exceeded. */
+static bool
+writeResult(QTextStream &out, bool json, const QString &radio, const SyntheticConfigSize &size,
+            BenchmarkResult result, const AllocationBudget &budget)
+{
+  std::sort(result.timings.begin(), result.timings.end());
+  qint64 min = 0, median = 0, max = 0;
+  if (result.timings.size()) {
+    min = result.timings.first()/1000;
+    median = result.timings.at(result.timings.size()/2)/1000;
+    max = result.timings.last()/1000;
+  }
+  // The first run may fill some static tables, the median is unaffected.
+  std::sort(result.allocations.begin(), result.allocations.end());
+  std::sort(result.bytes.begin(), result.bytes.end());
+  quint64 allocations = 0, bytes = 0;
+  if (result.allocations.size()) {
+    allocations = result.allocations.at(result.allocations.size()/2);
+    bytes = result.bytes.at(result.bytes.size()/2);
+  }
+
+  if (json) {
+    QJsonObject obj;
+    obj.insert("radio", radio);
+    obj.insert("stage", result.stage);
+    obj.insert("channels", int(size.channels));
+    obj.insert("contacts", int(size.contacts));
+    obj.insert("zones", int(size.zones));
+    obj.insert("groupLists", int(size.groupLists));
+    obj.insert("scanLists", int(size.scanLists));
+    obj.insert("roamingZones", int(size.roamingZones));
+    obj.insert("runs", result.timings.size());
+    obj.insert("min_us", min);
+    obj.insert("median_us", median);
+    obj.insert("max_us", max);
+    obj.insert("allocations", double(allocations));
+    obj.insert("alloc_bytes", double(bytes));
+    obj.insert("peak_rss_kb", double(result.peakRSS/1024));
+    if (! result.error.isEmpty())
+      obj.insert("error", result.error.simplified());
+    out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << "\n";
+  } else {
+    QString error = result.error;
+    error.replace('\n', ' ').replace('"', "\"\"");
+    out << radio << "," << result.stage << "," << size.channels << "," << size.contacts << ","
+        << size.zones << "," << size.groupLists << "," << size.scanLists << ","
+        << size.roamingZones << "," << result.timings.size() << "," << min << "," << median
+        << "," << max << "," << allocations << "," << bytes << "," << (result.peakRSS/1024)
+        << ",\"" << error << "\"\n";
+  }
+  out.flush();
+
+  return budget.check(radio + "/" + result.stage, allocations, bytes, result.peakRSS);
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Install log handler to stderr.
+  QTextStream err(stderr);
+  StreamLogHandler *handler = new StreamLogHandler(err, LogMessage::ERROR, true);
+  Logger::get().addHandler(handler);
+
+  QCoreApplication app(argc, argv);
+  app.setApplicationName("codeplugbenchmark");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+        "Measures the time of the individual codeplug encoding and decoding stages for each "
+        "radio model using a synthetic configuration.");
+  parser.addHelpOption();
+  parser.addOption({"channels", "Number of channels (default 1000).", "N", "1000"});
+  parser.addOption({"contacts", "Number of contacts (default 1000).", "N", "1000"});
+  parser.addOption({"zones", "Number of zones (default 50).", "N", "50"});
+  parser.addOption({"group-lists", "Number of RX group lists (default 50).", "N", "50"});
+  parser.addOption({"scan-lists", "Number of scan lists (default 10).", "N", "10"});
+  parser.addOption({"roaming-zones", "Number of roaming zones (default 10).", "N", "10"});
+  parser.addOption({"runs", "Number of repetitions per radio (default 5).", "N", "5"});
+  parser.addOption({"radio", "Benchmark only the specified radio, may be given several times.",
+                    "RADIO"});
+  parser.addOption({"json", "Writes the results as JSON lines instead of CSV."});
+  parser.addOption({"budget", "Fails if a stage exceeds the allocations or peak RSS given in the "
+                    "JSON budget file for \"radio/stage\".", "FILE"});
+  parser.process(app);
+
+  AllocationBudget budget;
+  QString errorMessage;
+  if (parser.isSet("budget") && (! budget.load(parser.value("budget"), errorMessage))) {
+    logError() << errorMessage;
+    return 1;
+  }
+
+  SyntheticConfigSize size;
+  size.channels     = parser.value("channels").toUInt();
+  size.contacts     = parser.value("contacts").toUInt();
+  size.zones        = parser.value("zones").toUInt();
+  size.groupLists   = parser.value("group-lists").toUInt();
+  size.scanLists    = parser.value("scan-lists").toUInt();
+  size.roamingZones = parser.value("roaming-zones").toUInt();
+  unsigned int runs = std::max(1U, parser.value("runs").toUInt());
+  QStringList selected = parser.values("radio");
+  bool json = parser.isSet("json");
+
+  Config *config = createSyntheticConfig(size);
+
+  QTextStream out(stdout);
+  if (! json)
+    out << "radio,stage,channels,contacts,zones,group_lists,scan_lists,roaming_zones,runs,"
+           "min_us,median_us,max_us,allocations,alloc_bytes,peak_rss_kb,error\n";
+
+  bool withinBudget = true;
+  foreach (const BenchmarkRadio &radio, benchmarkRadios()) {
+    if (selected.size() && (! selected.contains(radio.key, Qt::CaseInsensitive)))
+      continue;
+    foreach (const BenchmarkResult &result, benchmarkRadio(radio, config, runs))
+      withinBudget &= writeResult(out, json, radio.key, size, result, budget);
+  }
+
+  delete config;
+  return withinBudget ? 0 : 1;
+}
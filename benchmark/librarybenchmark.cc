@@ -0,0 +1,375 @@
+/* Library benchmark.
+ * Measures the time spent in the hot primitives of libdmrconf, i.e., address lookups, CRCs,
+ * string and BCD encodings, frequency parsing and formatting, bitmaps, the Levenshtein distance,
+ * adding objects to large lists, YAML conversions, encoding a call-sign DB and reading and
+ * writing the YAML codeplugs used by the unit tests.
+ *
+ * Each benchmark performs a fixed number of operations per run. The results are written as CSV
+ * (default) or as JSON lines to stdout. Each record contains the benchmark name, the number of
+ * operations per run, the minimum, median and maximum time per operation in nanoseconds over
+ * all runs, the median number of heap allocations and bytes allocated per operation and the peak
+ * RSS of the process after the benchmark. If a budget file is given (see AllocationBudget), the
+ * benchmarks exceeding their budget per operation are reported and the benchmark fails. */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QDir>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "logger.hh"
+#include "config.hh"
+#include "channel.hh"
+#include "addressmap.hh"
+#include "crc32.hh"
+#include "utils.hh"
+#include "frequency.hh"
+#include "interval.hh"
+#include "anytone_codeplug.hh"
+#include "userdatabase.hh"
+#include "d868uv_callsigndb.hh"
+#include "allocationcounter.hh"
+
+#ifndef BENCHMARK_DATA_DIRECTORY
+#define BENCHMARK_DATA_DIRECTORY "test/data"
+#endif
+
+
+/** A single benchmark. */
+struct PrimitiveBenchmark {
+  /** The benchmark name. */
+  QString name;
+  /** Number of operations performed by a single run. */
+  unsigned int operations;
+  /** Performs a single run. */
+  std::function<void()> run;
+  /** Optional preparation of a single run, that is not timed. */
+  std::function<void()> setup = nullptr;
+};
+
+/** Prevents the compiler from optimizing away the benchmarked results. */
+static volatile uint64_t sink = 0;
+
+
+/** Simple deterministic pseudo-random numbers, the benchmarks must not depend on the seed of
+ * the system RNG. */
+static inline uint32_t
+nextRandom(uint32_t &state) {
+  state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+  return state;
+}
+
+
+static QList<PrimitiveBenchmark>
+primitiveBenchmarks(const QString &dataDir) {
+  QList<PrimitiveBenchmark> benchmarks;
+
+  // Address map over 4096 regions with gaps, like the elements of a large codeplug
+  static AddressMap map;
+  static QVector<uint32_t> addresses;
+  map.clear(); addresses.clear();
+  for (uint32_t i=0; i<4096; i++)
+    map.add(0x00800000 + i*0x200, 0x100, i);
+  uint32_t state = 0x12345678;
+  for (int i=0; i<65536; i++)
+    addresses.append(0x00800000 + (nextRandom(state) % (4096*0x200)));
+  benchmarks.append({"addressmap.find", uint32_t(addresses.size()), []() {
+    for (uint32_t addr: addresses)
+      sink += map.find(addr);
+  }});
+
+  // CRC over 1MB
+  static QByteArray block(0x100000, Qt::Uninitialized);
+  for (int i=0; i<block.size(); i++)
+    block[i] = char(nextRandom(state));
+  benchmarks.append({"crc32.update", 1, []() {
+    CRC32 crc; crc.update(block); sink += crc.get();
+  }});
+
+  // String encodings of typical names
+  static uint8_t ascii[16]; static uint16_t unicode[16];
+  benchmarks.append({"encode_ascii", 10000, []() {
+    QString name("Channel 1234");
+    for (int i=0; i<10000; i++) {
+      encode_ascii(ascii, name, sizeof(ascii), 0x00); sink += ascii[i % 12];
+    }
+  }});
+  benchmarks.append({"encode_unicode", 10000, []() {
+    QString name("Channel 1234");
+    for (int i=0; i<10000; i++) {
+      encode_unicode(unicode, name, 16, 0x0000); sink += unicode[i % 12];
+    }
+  }});
+
+  // BCD helpers
+  benchmarks.append({"encode_dmr_id_bcd", 10000, []() {
+    uint8_t bcd[4];
+    for (uint32_t i=0; i<10000; i++) {
+      encode_dmr_id_bcd(bcd, 2621370+i); sink += bcd[3];
+    }
+  }});
+  benchmarks.append({"decode_dmr_id_bcd", 10000, []() {
+    uint8_t bcd[4] = {0x02, 0x62, 0x13, 0x70};
+    for (uint32_t i=0; i<10000; i++) {
+      bcd[3] = i & 0x99; sink += decode_dmr_id_bcd(bcd);
+    }
+  }});
+  benchmarks.append({"encode_frequency", 10000, []() {
+    for (uint32_t i=0; i<10000; i++)
+      sink += encode_frequency(430.0125 + i*0.0125);
+  }});
+  benchmarks.append({"decode_frequency", 10000, []() {
+    for (uint32_t i=0; i<10000; i++)
+      sink += uint64_t(decode_frequency(0x43001250 + (i & 0x9)));
+  }});
+
+  // Frequency parsing and formatting
+  static const QStringList frequencies = {"144.800 MHz", "439.5625MHz", "145.6", "12.5kHz", "1.2 GHz"};
+  benchmarks.append({"frequency.parse", 10000, []() {
+    Frequency f;
+    for (int i=0; i<10000; i++) {
+      f.parse(frequencies.at(i % frequencies.size())); sink += f.inHz();
+    }
+  }});
+  benchmarks.append({"frequency.format", 10000, []() {
+    for (uint32_t i=0; i<10000; i++)
+      sink += Frequency::fromHz(430000000ULL + i*12500ULL).format().size();
+  }});
+
+  // Bitmaps, e.g., the channel bitmap of AnyTone codeplugs
+  static QByteArray bitmap(AnytoneCodeplug::ChannelBitmapElement::size(), 0x00);
+  unsigned int bits = 8*AnytoneCodeplug::ChannelBitmapElement::size();
+  benchmarks.append({"bitmap.setEncoded", bits, [bits]() {
+    AnytoneCodeplug::ChannelBitmapElement el((uint8_t *)bitmap.data());
+    el.clear();
+    for (unsigned int i=0; i<bits; i+=2)
+      el.setEncoded(i, true);
+    for (unsigned int i=1; i<bits; i+=2)
+      el.setEncoded(i, true);
+    sink += el.count();
+  }});
+  benchmarks.append({"bitmap.nextEncoded", bits, [bits]() {
+    AnytoneCodeplug::ChannelBitmapElement el((uint8_t *)bitmap.data());
+    el.clear(); el.setRange(0, bits/3, true);
+    for (int i=el.nextEncoded(0); i>=0; i=el.nextEncoded(i+1))
+      sink += i;
+  }});
+
+  // Levenshtein distance of similar names
+  benchmarks.append({"levDist", 1000, []() {
+    for (int i=0; i<1000; i++)
+      sink += levDist(QString("DB0ABC Repeater %1").arg(i % 10), "DB0ABD repeater 7");
+  }});
+
+  // Adding objects to a large list, the objects are created in the setup
+  static Config *config = nullptr;
+  static QVector<Channel *> channels;
+  benchmarks.append({"configobjectlist.add", 10000, []() {
+    foreach (Channel *ch, channels)
+      config->channelList()->add(ch);
+    sink += config->channelList()->count();
+  }, []() {
+    delete config;
+    config = new Config();
+    channels.clear();
+    for (int i=0; i<10000; i++) {
+      DMRChannel *ch = new DMRChannel();
+      ch->setName(QString("Channel %1").arg(i+1));
+      channels.append(ch);
+    }
+  }});
+
+  // YAML conversion specialisations
+  benchmarks.append({"yaml.convert<Frequency>", 10000, []() {
+    Frequency f;
+    for (uint32_t i=0; i<10000; i++) {
+      YAML::Node node = YAML::convert<Frequency>::encode(Frequency::fromHz(430000000ULL + i*12500ULL));
+      YAML::convert<Frequency>::decode(node, f);
+      sink += f.inHz();
+    }
+  }});
+  benchmarks.append({"yaml.convert<Interval>", 10000, []() {
+    Interval iv;
+    for (uint32_t i=0; i<10000; i++) {
+      YAML::Node node = YAML::convert<Interval>::encode(Interval::fromMilliseconds(100+i));
+      YAML::convert<Interval>::decode(node, iv);
+      sink += iv.milliseconds();
+    }
+  }});
+
+  // Encoding a call-sign DB of 10000 users, the user DB is written once into a temporary file
+  static QTemporaryDir tempDir;
+  static UserDatabase *users = nullptr;
+  if ((nullptr == users) && tempDir.isValid()) {
+    QFile file(tempDir.filePath("users.json"));
+    if (file.open(QIODevice::WriteOnly)) {
+      file.write("{\"users\": [");
+      for (int i=0; i<10000; i++)
+        file.write(QString("%1{\"id\": %2, \"callsign\": \"DL%3\", \"fname\": \"Name\", "
+                           "\"city\": \"City\", \"country\": \"Germany\"}")
+                   .arg(i ? "," : "").arg(2620000+i).arg(i).toUtf8());
+      file.write("]}");
+      file.close();
+      users = new UserDatabase(file.fileName());
+    }
+  }
+  if (users) {
+    benchmarks.append({"callsigndb.encode", uint32_t(users->count()), []() {
+      D868UVCallsignDB db;
+      db.encode(users);
+      sink += db.memSize();
+    }});
+  }
+
+  // Reading and writing the YAML codeplugs of the unit tests
+  QDir dir(dataDir);
+  foreach (QString filename, dir.entryList(QStringList() << "*.yaml", QDir::Files, QDir::Name)) {
+    QString path = dir.filePath(filename);
+    benchmarks.append({"readYAML:" + filename, 1, [path]() {
+      Config config;
+      ErrorStack err;
+      if (! config.readYAML(path, err))
+        logError() << "Cannot read '" << path << "': " << err.format();
+      sink += config.channelList()->count();
+    }});
+    // The config is read once by the setup of the first run
+    static Config written;
+    static QString writtenPath;
+    benchmarks.append({"writeYAML:" + filename, 1, []() {
+      QString yaml;
+      QTextStream stream(&yaml);
+      written.toYAML(stream);
+      stream.flush();
+      sink += yaml.size();
+    }, [path]() {
+      if (writtenPath == path)
+        return;
+      ErrorStack err;
+      written.clear();
+      if (! written.readYAML(path, err))
+        logError() << "Cannot read '" << path << "': " << err.format();
+      writtenPath = path;
+    }});
+  }
+
+  return benchmarks;
+}
+
+
+/** Writes the result and checks it against the budget. Returns @c false if the budget is
+ * exceeded. */
+static bool
+writeResult(QTextStream &out, bool json, const PrimitiveBenchmark &benchmark,
+            QVector<qint64> timings, QVector<quint64> allocations, QVector<quint64> bytes,
+            const AllocationBudget &budget)
+{
+  std::sort(timings.begin(), timings.end());
+  double min = 0, median = 0, max = 0;
+  if (timings.size()) {
+    min = double(timings.first())/benchmark.operations;
+    median = double(timings.at(timings.size()/2))/benchmark.operations;
+    max = double(timings.last())/benchmark.operations;
+  }
+  // The first run may fill some static tables, the median is unaffected.
+  std::sort(allocations.begin(), allocations.end());
+  std::sort(bytes.begin(), bytes.end());
+  double allocationsPerOp = 0, bytesPerOp = 0;
+  if (allocations.size()) {
+    allocationsPerOp = double(allocations.at(allocations.size()/2))/benchmark.operations;
+    bytesPerOp = double(bytes.at(bytes.size()/2))/benchmark.operations;
+  }
+  quint64 peakRSS = AllocationCounter::peakRSS();
+
+  if (json) {
+    QJsonObject obj;
+    obj.insert("benchmark", benchmark.name);
+    obj.insert("operations", int(benchmark.operations));
+    obj.insert("runs", timings.size());
+    obj.insert("min_ns", min);
+    obj.insert("median_ns", median);
+    obj.insert("max_ns", max);
+    obj.insert("allocations", allocationsPerOp);
+    obj.insert("alloc_bytes", bytesPerOp);
+    obj.insert("peak_rss_kb", double(peakRSS/1024));
+    out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << "\n";
+  } else {
+    out << benchmark.name << "," << benchmark.operations << "," << timings.size() << ","
+        << min << "," << median << "," << max << "," << allocationsPerOp << "," << bytesPerOp
+        << "," << (peakRSS/1024) << "\n";
+  }
+  out.flush();
+
+  // Budgets are given per operation, rounded up such that a budget of 0 only accepts none.
+  return budget.check(benchmark.name, quint64(std::ceil(allocationsPerOp)),
+                      quint64(std::ceil(bytesPerOp)), peakRSS);
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Install log handler to stderr.
+  QTextStream err(stderr);
+  StreamLogHandler *handler = new StreamLogHandler(err, LogMessage::ERROR, true);
+  Logger::get().addHandler(handler);
+
+  QCoreApplication app(argc, argv);
+  app.setApplicationName("librarybenchmark");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+        "Measures the time per operation of the hot primitives of libdmrconf.");
+  parser.addHelpOption();
+  parser.addOption({"runs", "Number of repetitions per benchmark (default 10).", "N", "10"});
+  parser.addOption({"benchmark", "Runs only the benchmarks starting with the given name, may be "
+                    "given several times.", "NAME"});
+  parser.addOption({"data", "Directory of the YAML codeplugs to read (default: the test data of "
+                    "the source tree).", "DIR", BENCHMARK_DATA_DIRECTORY});
+  parser.addOption({"json", "Writes the results as JSON lines instead of CSV."});
+  parser.addOption({"budget", "Fails if a benchmark exceeds the allocations per operation or the "
+                    "peak RSS given in the JSON budget file.", "FILE"});
+  parser.process(app);
+
+  AllocationBudget budget;
+  QString errorMessage;
+  if (parser.isSet("budget") && (! budget.load(parser.value("budget"), errorMessage))) {
+    logError() << errorMessage;
+    return 1;
+  }
+
+  unsigned int runs = std::max(1U, parser.value("runs").toUInt());
+  QStringList selected = parser.values("benchmark");
+  bool json = parser.isSet("json");
+
+  QTextStream out(stdout);
+  if (! json)
+    out << "benchmark,operations,runs,min_ns,median_ns,max_ns,allocations,alloc_bytes,peak_rss_kb\n";
+
+  QElapsedTimer timer;
+  AllocationCounter counter;
+  bool withinBudget = true;
+  foreach (const PrimitiveBenchmark &benchmark, primitiveBenchmarks(parser.value("data"))) {
+    if (selected.size() && (! std::any_of(selected.begin(), selected.end(), [&benchmark](const QString &name) {
+                              return benchmark.name.startsWith(name, Qt::CaseInsensitive); })))
+      continue;
+    QVector<qint64> timings;
+    QVector<quint64> allocations, bytes;
+    for (unsigned int r=0; r<runs; r++) {
+      if (benchmark.setup)
+        benchmark.setup();
+      counter.restart(); timer.start();
+      benchmark.run();
+      timings.append(timer.nsecsElapsed());
+      allocations.append(counter.allocations());
+      bytes.append(counter.bytes());
+    }
+    withinBudget &= writeResult(out, json, benchmark, timings, allocations, bytes, budget);
+  }
+
+  return withinBudget ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#include "archive.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QFileInfo>
+
+#include "logger.hh"
+#include "dfufile.hh"
+#include "imagearchive.hh"
+
+
+int archive(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app)
+
+  if (2 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  ImageArchive archive(parser.value("archive"));
+  QString action = parser.positionalArguments().at(1);
+  ErrorStack err;
+
+  if ("add" == action) {
+    if (3 > parser.positionalArguments().size())
+      parser.showHelp(-1);
+    QString filename = parser.positionalArguments().at(2);
+    QString name = (4 <= parser.positionalArguments().size()) ?
+          parser.positionalArguments().at(3) : QFileInfo(filename).completeBaseName();
+    DFUFile file;
+    if (! file.read(filename, err)) {
+      logError() << "Cannot read binary file '" << filename << "': " << err.format();
+      return -1;
+    }
+    unsigned newChunks = 0;
+    if (! archive.store(name, file, err, &newChunks)) {
+      logError() << "Cannot archive '" << filename << "': " << err.format();
+      return -1;
+    }
+    logInfo() << "Archived '" << filename << "' as '" << name << "', " << newChunks
+              << " new chunks.";
+    return 0;
+  }
+
+  if ("list" == action) {
+    QTextStream out(stdout);
+    foreach (const QString &name, archive.names()) {
+      ImageArchive::Entry entry;
+      if (! archive.entry(name, entry, err)) {
+        logError() << "Cannot read archived '" << name << "': " << err.format();
+        return -1;
+      }
+      out << entry.name << "\t" << entry.created.toString(Qt::ISODate) << "\t"
+          << entry.memSize << "b\t" << entry.chunks << " chunks\n";
+    }
+    return 0;
+  }
+
+  if ("extract" == action) {
+    if (4 > parser.positionalArguments().size())
+      parser.showHelp(-1);
+    QString name = parser.positionalArguments().at(2);
+    QString filename = parser.positionalArguments().at(3);
+    if (! archive.extract(name, filename, err)) {
+      logError() << "Cannot extract '" << name << "' into '" << filename << "': " << err.format();
+      return -1;
+    }
+    return 0;
+  }
+
+  if ("remove" == action) {
+    if (3 > parser.positionalArguments().size())
+      parser.showHelp(-1);
+    for (int i=2; i<parser.positionalArguments().size(); i++) {
+      if (! archive.remove(parser.positionalArguments().at(i), err)) {
+        logError() << err.format();
+        return -1;
+      }
+    }
+    unsigned removed = 0;
+    if (! archive.collectGarbage(err, &removed)) {
+      logError() << err.format();
+      return -1;
+    }
+    logInfo() << "Removed " << removed << " unreferenced chunks.";
+    return 0;
+  }
+
+  logError() << "Unknown archive action '" << action
+             << "': Expected 'add', 'list', 'extract' or 'remove'.";
+  return -1;
+}
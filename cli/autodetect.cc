@@ -3,6 +3,34 @@
 #include "logger.hh"
 #include "radioinfo.hh"
 #include "usbdevice.hh"
+#include "detectioncache.hh"
+#include "virtualdevice.hh"
+#include <QThread>
+#include <algorithm>
+#include <csignal>
+
+/** Maximum number of devices probed concurrently. */
+#define MAX_PROBES 8
+
+/** Cancels the transfers of all detected radios, once the user interrupts the program. */
+static CancellationToken _interrupt;
+
+static void
+onInterrupt(int sig) {
+  _interrupt.cancel();
+  // A second interrupt terminates immediately
+  std::signal(sig, SIG_DFL);
+}
+
+/** Makes the transfers of the given radio cancelable by SIGINT. Hence, an interrupted transfer
+ * leaves the programming mode of the device cleanly. */
+static Radio *
+interruptible(Radio *radio) {
+  static const bool installed = (SIG_ERR != std::signal(SIGINT, onInterrupt));
+  if (installed && (nullptr != radio))
+    radio->setCancellationToken(_interrupt);
+  return radio;
+}
 
 QVariant
 parseDeviceHandle(const QString &device) {
@@ -33,9 +61,20 @@ printDevices(QTextStream &out, const QList<USBDeviceDescriptor> &devices) {
   }
 }
 
-Radio *
-autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &err) {
-  Q_UNUSED(app)
+/** Returns the descriptor of a virtual device. */
+static USBDeviceDescriptor
+virtualDevice(const QString &handle, const ErrorStack &err) {
+  USBDeviceDescriptor device = VirtualDevice::Descriptor(handle);
+  if (! device.isValid())
+    errMsg(err) << "Invalid virtual device '" << handle << "'.";
+  return device;
+}
+
+USBDeviceDescriptor
+selectDevice(QCommandLineParser &parser, const ErrorStack &err) {
+  // Virtual devices are not detected
+  if (parser.isSet("device") && VirtualDevice::isHandle(parser.value("device")))
+    return virtualDevice(parser.value("device"), err);
 
   logDebug() << "Autodetect radios.";
 
@@ -45,7 +84,7 @@ autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &
 
   if (interfaces.isEmpty()) {
     errMsg(err) << "No matching USB devices are found. Check connection?";
-    return nullptr;
+    return USBDeviceDescriptor();
   }
 
   logInfo() << "Found " << interfaces.count() << " device(s):";
@@ -67,7 +106,7 @@ autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &
       ErrorStack::MessageStream msg(err, __FILE__, __LINE__);
       msg << "Device handle '" << parser.value("device") << "' not found in:\n";
       printDevices(msg, interfaces);
-      return nullptr;
+      return USBDeviceDescriptor();
     }
   } else if (1 != interfaces.size()) {
     // If no device is specified, there should only be one interface
@@ -75,18 +114,37 @@ autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &
     msg << "Cannot auto-detect radio, more than one matching USB devices found:"
         << " Use --device option to specify to which device to talk to. Devices found:\n";
     printDevices(msg, interfaces);
-    return nullptr;
+    return USBDeviceDescriptor();
   } else if (! interfaces.first().isSave()) {
     ErrorStack::MessageStream msg(err, __FILE__, __LINE__);
     msg << "It is not save to assume that the device:\n";
     printDevices(msg, interfaces);
     msg << "is a DMR radio. Please specify the device explicitly to verify correctness.";
-    return nullptr;
+    return USBDeviceDescriptor();
   } else {
     // The first device is save to use
     device = interfaces.first();
   }
 
+  return device;
+}
+
+Radio *
+autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &err) {
+  Q_UNUSED(app)
+
+  USBDeviceDescriptor device = selectDevice(parser, err);
+  if (! device.isValid())
+    return nullptr;
+
+  Radio *radio = detectRadio(parser, device, err);
+  if (nullptr != radio)
+    cacheDetection(parser, device, radio);
+  return radio;
+}
+
+Radio *
+detectRadio(QCommandLineParser &parser, const USBDeviceDescriptor &device, const ErrorStack &err) {
   logDebug() << "Using device " << device.deviceHandle() << ".";
 
   // Handle identifiability of radio
@@ -101,7 +159,7 @@ autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &
       logError() << "Cannot detect radio.";
       return nullptr;
     }
-    return rad;
+    return interruptible(rad);
   } else if (! device.isSave()) {
     // Collect all radio keys for the device
     QStringList radios;
@@ -121,5 +179,168 @@ autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &
     errMsg(err) << "Cannot auto-detect radio.";
     return nullptr;
   }
-  return rad;
+  return interruptible(rad);
+}
+
+QList<USBDeviceDescriptor>
+selectDevices(QCommandLineParser &parser, const ErrorStack &err) {
+  logDebug() << "Autodetect all radios.";
+
+  QList<USBDeviceDescriptor> interfaces = USBDeviceDescriptor::detect();
+  if (interfaces.isEmpty())
+    interfaces = USBDeviceDescriptor::detect(false);
+
+  // Select devices, either all given by --device options or all found
+  QList<USBDeviceDescriptor> devices;
+  if (parser.isSet("device")) {
+    foreach (QString handle, parser.values("device")) {
+      if (VirtualDevice::isHandle(handle)) {
+        USBDeviceDescriptor device = virtualDevice(handle, err);
+        if (! device.isValid())
+          return QList<USBDeviceDescriptor>();
+        devices.append(device);
+        continue;
+      }
+      QVariant devHandle = parseDeviceHandle(handle);
+      USBDeviceDescriptor device;
+      foreach (USBDeviceDescriptor dev, interfaces) {
+        if (dev.device() == devHandle) {
+          device = dev;
+          break;
+        }
+      }
+      if (! device.isValid()) {
+        ErrorStack::MessageStream msg(err, __FILE__, __LINE__);
+        msg << "Device handle '" << handle << "' not found in:\n";
+        printDevices(msg, interfaces);
+        return QList<USBDeviceDescriptor>();
+      }
+      devices.append(device);
+    }
+  } else {
+    foreach (USBDeviceDescriptor dev, interfaces) {
+      if (USBDeviceInfo::Class::None != dev.interfaceClass())
+        devices.append(dev);
+    }
+  }
+
+  if (devices.isEmpty()) {
+    errMsg(err) << "No matching USB devices are found. Check connection?";
+    return QList<USBDeviceDescriptor>();
+  }
+
+  logInfo() << "Found " << devices.count() << " device(s):";
+  foreach (USBDeviceDescriptor d, devices) {
+    logInfo() << "  " << d.description() << " at " << d.deviceHandle() << ".";
+  }
+
+  return devices;
+}
+
+
+/** Probes a single device within a worker thread. Once detected, the radio and its interface
+ * are moved to the given target thread. */
+class ProbeThread: public QThread
+{
+public:
+  ProbeThread(QCommandLineParser &parser, const USBDeviceDescriptor &device, QThread *target)
+    : QThread(), _parser(parser), _device(device), _target(target), _radio(nullptr), _err()
+  {
+    // pass...
+  }
+
+  Radio *radio() const { return _radio; }
+  const ErrorStack &errorStack() const { return _err; }
+
+protected:
+  void run() {
+    _radio = detectRadio(_parser, _device, _err);
+    if (nullptr != _radio)
+      _radio->moveAllToThread(_target);
+  }
+
+protected:
+  QCommandLineParser &_parser;
+  USBDeviceDescriptor _device;
+  QThread *_target;
+  Radio *_radio;
+  ErrorStack _err;
+};
+
+QList<Radio *>
+detectRadios(QCommandLineParser &parser, const QList<USBDeviceDescriptor> &devices, const ErrorStack &err) {
+  QList<Radio *> radios;
+  if (1 == devices.size()) {
+    // No need for a worker thread
+    Radio *radio = detectRadio(parser, devices.first(), err);
+    if (nullptr == radio) {
+      errMsg(err) << "Cannot detect radio at device " << devices.first().deviceHandle() << ".";
+      DetectionCache().remove(devices.first());
+    } else
+      cacheDetection(parser, devices.first(), radio);
+    radios.append(radio);
+    return radios;
+  }
+
+  // Probe devices concurrently, bounded by the pool size
+  int poolSize = std::max(1, std::min(QThread::idealThreadCount(), MAX_PROBES));
+  for (int i=0; i<devices.size(); i+=poolSize) {
+    QList<ProbeThread *> probes;
+    for (int j=i; j<std::min(devices.size(), i+poolSize); j++) {
+      probes.append(new ProbeThread(parser, devices.at(j), QThread::currentThread()));
+      probes.last()->start();
+    }
+    for (int j=0; j<probes.size(); j++) {
+      ProbeThread *probe = probes.at(j);
+      probe->wait();
+      const USBDeviceDescriptor &device = devices.at(i+j);
+      if (nullptr == probe->radio()) {
+        err.take(probe->errorStack());
+        errMsg(err) << "Cannot detect radio at device " << device.deviceHandle() << ".";
+        DetectionCache().remove(device);
+      } else {
+        cacheDetection(parser, device, probe->radio());
+      }
+      radios.append(probe->radio());
+      delete probe;
+    }
+  }
+
+  return radios;
+}
+
+QList<Radio *>
+autoDetectAll(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &err) {
+  Q_UNUSED(app)
+
+  QList<USBDeviceDescriptor> devices = selectDevices(parser, err);
+  if (devices.isEmpty())
+    return QList<Radio *>();
+
+  // Detect radio for every device, either all or none
+  QList<Radio *> radios = detectRadios(parser, devices, err);
+  if (radios.contains(nullptr)) {
+    qDeleteAll(radios);
+    return QList<Radio *>();
+  }
+
+  return radios;
+}
+
+void
+cacheDetection(QCommandLineParser &parser, const USBDeviceDescriptor &device, Radio *radio) {
+  // Forced radios are not identified, hence do not cache them.
+  if (parser.isSet("radio") || (nullptr == radio))
+    return;
+  foreach (RadioInfo info, RadioInfo::allRadios(device)) {
+    if (info.name() == radio->name()) {
+      DetectionCache().store(device, info);
+      return;
+    }
+  }
+}
+
+bool
+multipleDevices(QCommandLineParser &parser) {
+  return parser.isSet("all-devices") || (1 < parser.values("device").size());
 }
@@ -8,6 +8,22 @@
 
 QVariant parseDeviceHandle(const QString &device);
 void printDevices(QTextStream &out, const QList<USBDeviceDescriptor> &devices);
+/** Selects the device to use, either given by the --device option or the only one found. */
+USBDeviceDescriptor selectDevice(QCommandLineParser &parser, const ErrorStack &err=ErrorStack());
 Radio *autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &err=ErrorStack());
+Radio *detectRadio(QCommandLineParser &parser, const USBDeviceDescriptor &device, const ErrorStack &err=ErrorStack());
+/** Selects all devices given by --device options or all devices found. */
+QList<USBDeviceDescriptor> selectDevices(QCommandLineParser &parser, const ErrorStack &err=ErrorStack());
+/** Detects the radios at the given devices concurrently. The list contains a @c nullptr for every
+ * device, where no radio was detected. */
+QList<Radio *> detectRadios(QCommandLineParser &parser, const QList<USBDeviceDescriptor> &devices,
+                            const ErrorStack &err=ErrorStack());
+/** Stores the identification of the radio at the given device in the detection cache. */
+void cacheDetection(QCommandLineParser &parser, const USBDeviceDescriptor &device, Radio *radio);
+/** Detects the radios at all devices given by --device options or all devices found. */
+QList<Radio *> autoDetectAll(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &err=ErrorStack());
+/** Returns @c true if more than one device is selected, either by --all-devices or several
+ * --device options. */
+bool multipleDevices(QCommandLineParser &parser);
 
 #endif // AUTODETECT_HH
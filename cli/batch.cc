@@ -0,0 +1,197 @@
+#include "batch.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "logger.hh"
+#include "radioinfo.hh"
+#include "userdatabase.hh"
+#include "encodecodeplug.hh"
+#include "decodecodeplug.hh"
+#include "encodecallsigndb.hh"
+
+
+/** A single job of a batch, i.e., one line of the job file. */
+struct BatchJob
+{
+  int line = 0;                      ///< Line number within the job file.
+  QString operation;                 ///< The operation, i.e., encode, decode or encode-db.
+  QString radio;                     ///< The radio key.
+  QString input;                     ///< The input file.
+  QString output;                    ///< The output file.
+  UserDatabase *userdb = nullptr;    ///< The shared user DB for encode-db jobs.
+  CallsignDB::Selection selection;   ///< The selection of the shared user DB.
+  bool success = false;              ///< The result.
+  QString error;                     ///< The error message, if the job failed.
+  qint64 duration = 0;               ///< Time spent on the job in ms.
+};
+
+
+/** Runs a single job of the batch within the thread pool. The shared user databases are only
+ * read. */
+class BatchRunner: public QRunnable
+{
+public:
+  BatchRunner(BatchJob &job, const QCommandLineParser &parser)
+    : QRunnable(), _job(job), _parser(parser)
+  {
+    setAutoDelete(false);
+  }
+
+  void run() {
+    QElapsedTimer timer; timer.start();
+    ErrorStack err;
+    RadioInfo::Radio radio = RadioInfo::byKey(_job.radio).id();
+    if ("encode" == _job.operation)
+      _job.success = encodeCodeplugFile(_job.input, radio, _job.output, _parser, err);
+    else if ("decode" == _job.operation)
+      _job.success = decodeCodeplugFile(_job.input, radio, _job.output, _parser, err);
+    else if ("encode-db" == _job.operation)
+      _job.success = encodeCallsignDBFile(*_job.userdb, radio, _job.output, _job.selection, err);
+    if (! _job.success)
+      _job.error = err.format();
+    _job.duration = timer.elapsed();
+  }
+
+protected:
+  BatchJob &_job;
+  const QCommandLineParser &_parser;
+};
+
+
+/** Parses the job file. Malformed jobs are marked as failed and are not executed. */
+static bool
+readJobs(QTextStream &stream, QVector<BatchJob> &jobs) {
+  QString buffer;
+  for (int line=1; stream.readLineInto(&buffer); line++) {
+    buffer = buffer.simplified();
+    if (buffer.isEmpty() || buffer.startsWith('#'))
+      continue;
+
+    BatchJob job;
+    job.line = line;
+    QStringList fields = buffer.split(' ');
+    if (4 != fields.size()) {
+      job.error = QString("Malformed job '%1': Expected OPERATION RADIO INPUT OUTPUT.").arg(buffer);
+      jobs.append(job);
+      continue;
+    }
+    job.operation = fields.at(0).toLower();
+    job.radio = fields.at(1).toLower();
+    job.input = fields.at(2);
+    job.output = fields.at(3);
+
+    if (("encode" != job.operation) && ("decode" != job.operation) && ("encode-db" != job.operation))
+      job.error = QString("Unknown operation '%1'.").arg(job.operation);
+    else if (! RadioInfo::hasRadioKey(job.radio))
+      job.error = QString("Unknown radio '%1'.").arg(job.radio);
+
+    jobs.append(job);
+  }
+
+  return true;
+}
+
+
+int
+batch(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app);
+
+  // Read jobs from file or stdin
+  QVector<BatchJob> jobs;
+  QFile file;
+  QString filename = (2 <= parser.positionalArguments().size()) ? parser.positionalArguments().at(1) : "-";
+  if ("-" == filename) {
+    if (! file.open(stdin, QIODevice::ReadOnly)) {
+      logError() << "Cannot read jobs from stdin: " << file.errorString();
+      return -1;
+    }
+  } else {
+    file.setFileName(filename);
+    if (! file.open(QIODevice::ReadOnly)) {
+      logError() << "Cannot open job file '" << filename << "': " << file.errorString();
+      return -1;
+    }
+  }
+  QTextStream stream(&file);
+  readJobs(stream, jobs);
+  file.close();
+
+  // Load and sort every user DB used by encode-db jobs once. This happens here, as the default DB
+  // may need to be downloaded.
+  QHash<QString, UserDatabase *> databases;
+  QHash<QString, CallsignDB::Selection> selections;
+  for (int i=0; i<jobs.size(); i++) {
+    BatchJob &job = jobs[i];
+    if ((! job.error.isEmpty()) || ("encode-db" != job.operation))
+      continue;
+    QString dbfile = ("-" == job.input) ? parser.value("database") : job.input;
+    if (! databases.contains(dbfile)) {
+      ErrorStack err;
+      UserDatabase *userdb = sharedUserDB(dbfile, err);
+      CallsignDB::Selection selection;
+      if ((nullptr != userdb) && selectUsers(*userdb, parser, selection, err)) {
+        selections.insert(dbfile, selection);
+      } else {
+        logError() << err.format();
+        userdb = nullptr;
+      }
+      databases.insert(dbfile, userdb);
+    }
+    if (nullptr == databases.value(dbfile)) {
+      job.error = QString("Cannot load user DB '%1'.").arg(dbfile);
+      continue;
+    }
+    job.userdb = databases.value(dbfile);
+    job.selection = selections.value(dbfile);
+  }
+
+  // Run jobs concurrently
+  QThreadPool pool;
+  if (parser.isSet("jobs"))
+    pool.setMaxThreadCount(parser.value("jobs").toInt());
+  else if (parser.isSet("low-memory"))
+    pool.setMaxThreadCount(1);
+  else
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+  logDebug() << "Run " << jobs.size() << " jobs using up to " << pool.maxThreadCount() << " threads.";
+
+  QVector<BatchRunner *> runners;
+  for (int i=0; i<jobs.size(); i++) {
+    if (! jobs[i].error.isEmpty())
+      continue;
+    runners.append(new BatchRunner(jobs[i], parser));
+    pool.start(runners.back());
+  }
+  pool.waitForDone();
+  qDeleteAll(runners);
+
+  // Report results in the order of the job file, one JSON object per line
+  bool success = true;
+  QTextStream out(stdout);
+  foreach (const BatchJob &job, jobs) {
+    QJsonObject result;
+    result.insert("line", job.line);
+    result.insert("operation", job.operation);
+    result.insert("radio", job.radio);
+    result.insert("input", job.input);
+    result.insert("output", job.output);
+    result.insert("success", job.success);
+    if (! job.success)
+      result.insert("error", job.error);
+    result.insert("duration", job.duration);
+    out << QJsonDocument(result).toJson(QJsonDocument::Compact) << "\n";
+    success &= job.success;
+  }
+  out.flush();
+
+  return (success ? 0 : -1);
+}
@@ -0,0 +1,9 @@
+#ifndef BATCH_HH
+#define BATCH_HH
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int batch(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // BATCH_HH
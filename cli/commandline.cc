@@ -0,0 +1,493 @@
+#include "commandline.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include "logger.hh"
+#include "detect.hh"
+#include "verify.hh"
+#include "readcodeplug.hh"
+#include "writecodeplug.hh"
+#include "writecallsigndb.hh"
+#include "encodecodeplug.hh"
+#include "encodecallsigndb.hh"
+#include "decodecodeplug.hh"
+#include "importtalkgroups.hh"
+#include "infofile.hh"
+#include "difffile.hh"
+#include "resume.hh"
+#include "batch.hh"
+#include "serve.hh"
+#include "selftest.hh"
+#include "mergeconfig.hh"
+#include "routeconfig.hh"
+#include "archive.hh"
+#include "stats.hh"
+#include "timingpolicy.hh"
+#include "tracer.hh"
+#include "sessionrecorder.hh"
+#include "usbserial.hh"
+#include "devicemonitor.hh"
+#include "codeplug.hh"
+
+
+void
+setupCommandLine(QCommandLineParser &parser) {
+  parser.setApplicationDescription(
+        QCoreApplication::translate(
+          "main", "Up- and download codeplugs for cheap Chinese DMR radios."));
+
+  parser.addHelpOption();
+  parser.addVersionOption();
+  parser.addOption({
+                     {"V","verbose"},
+                     QCoreApplication::translate("main", "Verbose output.")
+                   });
+  parser.addOption({
+                     {"c", "csv"},
+                     QCoreApplication::translate("main", "Up- and download codeplugs in CSV format.")
+                   });
+  parser.addOption({
+                     {"y", "yaml"},
+                     QCoreApplication::translate("main", "Up- and download codeplugs in extensible YAML format.")
+                   });
+  parser.addOption({
+                     {"b", "bin"},
+                     QCoreApplication::translate("main", "Up- and download codeplugs in binary format.")
+                   });
+  parser.addOption({
+                     "snapshot",
+                     QCoreApplication::translate("main", "Read and write codeplugs as binary config "
+                     "snapshots. These are not editable but fast to read and write.")
+                   });
+  parser.addOption({
+                     {"m", "manufacturer"},
+                     QCoreApplication::translate("main", "Given file is manufacturer codeplug file. "
+                     " Can be used with 'decode'.")
+                   });
+  parser.addOption({
+                     {"D","device"},
+                     QCoreApplication::translate("main", "Specifies the device to use to talk to "
+                     "the radio. If not specified, the dmrconf will try to detect the radio "
+                     "automatically. Please note, that for some radios the device must be specified. "
+                     "Use 'virtual:RADIO[,latency=MS][,bandwidth=BPS][,errors=RATE]' to emulate a "
+                     "radio in memory."),
+                     QCoreApplication::translate("main", "DEVICE")
+                   });
+  parser.addOption(QCommandLineOption(
+                     "all-devices",
+                     QCoreApplication::translate("main", "Writes the codeplug or call-sign DB to all "
+                     "connected radios concurrently. Alternatively, several devices can be "
+                     "selected by passing the --device option several times.")));
+  parser.addOption({
+                     {"R", "radio"},
+                     QCoreApplication::translate("main", "Specifies the radio. This option can also "
+                     "be used to override the auto-detection of radios. Be careful using this "
+                     "option when writing to the device. A incompatible code-plug might be written."),
+                     QCoreApplication::translate("main", "RADIO")
+                   });
+  parser.addOption(QCommandLineOption(
+                     "all-radios",
+                     QCoreApplication::translate("main", "Verifies the codeplug against all "
+                     "supported radios concurrently or runs the self-test for all radios. "
+                     "Alternatively, several radios can be passed as a comma separated list to "
+                     "the --radio option.")));
+  parser.addOption({
+                     {"i", "id"},
+                     QCoreApplication::translate("main", "Specifies the DMR id."),
+                     QCoreApplication::translate("main", "ID")
+                   });
+  parser.addOption({
+                     {"n", "limit"},
+                     QCoreApplication::translate("main", "Limits several amonuts, depending on the "
+                     "context. When encoding/writing the callsign db, this option specifies the "
+                     "maximum number of callsigns to encode."),
+                     QCoreApplication::translate("main", "N")
+                   });
+  parser.addOption({
+                     "country",
+                     QCoreApplication::translate("main", "When encoding/writing the callsign db, "
+                     "selects all users of the given countries. A state can be given as "
+                     "COUNTRY/STATE. Several countries may be separated by commas."),
+                     QCoreApplication::translate("main", "COUNTRY")
+                   });
+  parser.addOption({
+                     "id-prefix",
+                     QCoreApplication::translate("main", "When encoding/writing the callsign db, "
+                     "selects all users whose DMR ID starts with one of the given comma separated "
+                     "prefixes. When importing talk groups, selects the talk groups with these "
+                     "prefixes."),
+                     QCoreApplication::translate("main", "PREFIX")
+                   });
+  parser.addOption({
+                     "group-list",
+                     QCoreApplication::translate("main", "When importing talk groups, adds all "
+                     "imported talk groups to the RX group list of the given name."),
+                     QCoreApplication::translate("main", "NAME")
+                   });
+  parser.addOption({
+                     {"B","database"},
+                     QCoreApplication::translate("main", "Specifies the user DB json file when "
+                     "writing the callsign db or the talk group DB json file when importing talk "
+                     "groups."),
+                     "FILENAME"
+                   });
+  parser.addOption(QCommandLineOption(
+                     "with-callsigns",
+                     QCoreApplication::translate("main", "When writing a codeplug, also writes the "
+                                                         "call-sign DB within the same programming "
+                                                         "session.")));
+  parser.addOption(QCommandLineOption(
+                     "init-codeplug",
+                     QCoreApplication::translate(
+                       "main", "Initializes the code-plug in the radio. If not present (default) "
+                               "the code-plug gets updated, maintining all settings made earlier.")));
+  parser.addOption(QCommandLineOption(
+                     "cache-id",
+                     QCoreApplication::translate(
+                       "main", "Enables the local image cache for the radio using the given "
+                               "identifier (e.g., serial number). If the radio was written before "
+                               "and is unchanged, the codeplug is not read from the device prior "
+                               "to writing."),
+                     QCoreApplication::translate("main", "ID")));
+  parser.addOption(QCommandLineOption(
+                     "auto-enable-gps",
+                     QCoreApplication::translate("main", "Automatically enables GPS if there is a "
+                                                         "GPS/APRS system used by any channel.")));
+  parser.addOption(QCommandLineOption(
+                     "auto-enable-roaming",
+                     QCoreApplication::translate("main", "Automatically enables roaming if there is a "
+                                                         "roaming zone used by any channel.")));
+  parser.addOption(QCommandLineOption(
+                     "encode-cache",
+                     QCoreApplication::translate("main", "Reuses the binary codeplug, if the same "
+                                                         "config was encoded for the same radio "
+                                                         "before. Encoded codeplugs are kept in the "
+                                                         "local cache.")));
+  parser.addOption(QCommandLineOption(
+                     "encode-threads",
+                     QCoreApplication::translate("main", "Encodes independent sections of the "
+                                                         "codeplug concurrently, using up to N "
+                                                         "threads. By default, the codeplug is "
+                                                         "encoded sequentially."),
+                     QCoreApplication::translate("main", "N")));
+  parser.addOption(QCommandLineOption(
+                     "decode-threads",
+                     QCoreApplication::translate("main", "Creates channels and contacts concurrently "
+                                                         "when decoding a codeplug, using up to N "
+                                                         "threads. By default, the codeplug is "
+                                                         "decoded sequentially."),
+                     QCoreApplication::translate("main", "N")));
+  parser.addOption(QCommandLineOption(
+                     "only",
+                     QCoreApplication::translate("main", "Reads only the given comma separated "
+                                                         "sections of the codeplug, e.g., "
+                                                         "'zones,contacts'. Sections required by "
+                                                         "the given ones are read too."),
+                     QCoreApplication::translate("main", "SECTIONS")));
+  parser.addOption(QCommandLineOption(
+                     "jobs",
+                     QCoreApplication::translate("main", "Runs up to N jobs of a batch or files of "
+                                                         "a multi-file info, decode or merge "
+                                                         "concurrently. By default, as many jobs as "
+                                                         "there are "
+                                                         "CPU cores are run concurrently."),
+                     QCoreApplication::translate("main", "N")));
+  parser.addOption(QCommandLineOption(
+                     "low-memory",
+                     QCoreApplication::translate("main", "Keeps the memory usage low on small hosts. "
+                                                         "Runs a single job at a time, encodes "
+                                                         "sequentially, bypasses the encode cache "
+                                                         "and reports the peak memory usage at the "
+                                                         "end. Explicit --jobs or --encode-threads "
+                                                         "options take precedence.")));
+  parser.addOption(QCommandLineOption(
+                     "merge-items",
+                     QCoreApplication::translate("main", "Selects how the 'merge' command handles "
+                                                         "items (radio IDs, contacts, channels, "
+                                                         "etc.) present in the base already. Either "
+                                                         "'ignore' (default), 'override' or "
+                                                         "'duplicate'."),
+                     QCoreApplication::translate("main", "STRATEGY")));
+  parser.addOption(QCommandLineOption(
+                     "merge-sets",
+                     QCoreApplication::translate("main", "Selects how the 'merge' command handles "
+                                                         "sets (group lists, zones and scan lists) "
+                                                         "present in the base already. Either "
+                                                         "'ignore' (default), 'override', "
+                                                         "'duplicate' or 'merge'."),
+                     QCoreApplication::translate("main", "STRATEGY")));
+  parser.addOption(QCommandLineOption(
+                     {"o", "output"},
+                     QCoreApplication::translate("main", "Writes the result of the 'merge' or "
+                                                         "'route' command into FILE instead of "
+                                                         "stdout."),
+                     QCoreApplication::translate("main", "FILE")));
+  parser.addOption(QCommandLineOption(
+                     "nearest",
+                     QCoreApplication::translate("main", "Selects the N nearest repeaters to each "
+                                                         "waypoint in the 'route' command. "
+                                                         "Defaults to 8."),
+                     QCoreApplication::translate("main", "N")));
+  parser.addOption(QCommandLineOption(
+                     "mode",
+                     QCoreApplication::translate("main", "Selects the repeaters the 'route' command "
+                                                         "creates channels for. Either 'dmr' "
+                                                         "(default), 'fm' or 'both'."),
+                     QCoreApplication::translate("main", "MODE")));
+  parser.addOption(QCommandLineOption(
+                     "stats",
+                     QCoreApplication::translate("main", "Prints some statistics about the transfer "
+                                                         "(e.g., bytes transferred, round trips, "
+                                                         "retries and latencies) and the memory used "
+                                                         "by the config, the codeplug and the "
+                                                         "databases after reading or writing the "
+                                                         "device.")));
+  parser.addOption(QCommandLineOption(
+                     "history",
+                     QCoreApplication::translate("main", "Selects the file, every transfer with a "
+                                                         "device is recorded in and that is "
+                                                         "summarized by the 'stats history' "
+                                                         "command. By default, the history is kept "
+                                                         "in the application data directory."),
+                     QCoreApplication::translate("main", "FILE")));
+  parser.addOption(QCommandLineOption(
+                     "progress",
+                     QCoreApplication::translate("main", "Selects how the progress of a transfer "
+                                                         "is reported. Either 'bar' (default) or "
+                                                         "'json', writing one JSON object per line "
+                                                         "with the current phase, bytes, address "
+                                                         "and the time spent in every phase."),
+                     QCoreApplication::translate("main", "FORMAT")));
+  parser.addOption(QCommandLineOption(
+                     "trace",
+                     QCoreApplication::translate("main", "Records the time spent in encoding, "
+                                                         "decoding, YAML processing and the "
+                                                         "communication with the device and writes "
+                                                         "it in the Chrome trace format into FILE."),
+                     QCoreApplication::translate("main", "FILE")));
+  parser.addOption(QCommandLineOption(
+                     "record",
+                     QCoreApplication::translate("main", "Records all requests and responses "
+                                                         "exchanged with the device together with "
+                                                         "their timing into FILE. Serial sessions "
+                                                         "can be replayed using a virtual device."),
+                     QCoreApplication::translate("main", "FILE")));
+  parser.addOption(QCommandLineOption(
+                     "low-latency",
+                     QCoreApplication::translate("main", "Opens serial ports in low-latency mode. "
+                                                         "On Linux, this reduces the latency timer "
+                                                         "of USB-serial bridges, where supported.")));
+  parser.addOption(QCommandLineOption(
+                     "timeout",
+                     QCoreApplication::translate("main", "Sets a fixed response timeout in "
+                                                         "milliseconds for the communication with "
+                                                         "the device. By default, the timeout is "
+                                                         "derived from the observed response times."),
+                     QCoreApplication::translate("main", "MS")));
+  parser.addOption(QCommandLineOption(
+                     "verify-write",
+                     QCoreApplication::translate("main", "Reads back the written memory after "
+                                                         "writing a codeplug or call-sign DB and "
+                                                         "compares it to the written data.")));
+  parser.addOption(QCommandLineOption(
+                     "verify-samples",
+                     QCoreApplication::translate("main", "Only reads back N evenly distributed "
+                                                         "blocks when verifying a write. Implies "
+                                                         "--verify-write."),
+                     QCoreApplication::translate("main", "N")));
+  parser.addOption(QCommandLineOption(
+                     "skip-unchanged",
+                     QCoreApplication::translate("main", "Compares each flash sector with its current "
+                                                         "content and skips unchanged sectors when "
+                                                         "writing a codeplug or call-sign DB.")));
+  parser.addOption(QCommandLineOption(
+                     "range",
+                     QCoreApplication::translate("main", "Restricts the hex-dump of the 'info' "
+                                                         "command to the memory range of SIZE "
+                                                         "bytes at ADDR. Both may be given in "
+                                                         "hex with a '0x' prefix. If SIZE is "
+                                                         "omitted, the dump extends to the end of "
+                                                         "the memory."),
+                     QCoreApplication::translate("main", "ADDR[:SIZE]")));
+  parser.addOption(QCommandLineOption(
+                     "summary",
+                     QCoreApplication::translate("main", "Lets the 'info' command print a summary "
+                                                         "instead of a hex-dump, listing all "
+                                                         "elements, their CRCs and the regions "
+                                                         "filled with a single byte.")));
+  parser.addOption(QCommandLineOption(
+                     "identify",
+                     QCoreApplication::translate("main", "Lets the 'info' command identify the "
+                                                         "radio and content of the file by its "
+                                                         "signature instead of dumping it.")));
+  parser.addOption(QCommandLineOption(
+                     "archive",
+                     QCoreApplication::translate("main", "Selects the directory of the image archive "
+                                                         "used by the 'archive' command. By default, "
+                                                         "the archive is kept in the application "
+                                                         "data directory."),
+                     QCoreApplication::translate("main", "DIR")));
+  parser.addOption(QCommandLineOption(
+                     "ignore-limits",
+                     QCoreApplication::translate("main", "Disables some limit checks.")));
+  parser.addOption(QCommandLineOption(
+                     "list-radios",
+                     QCoreApplication::translate("main", "Lists all supported radios including the "
+                                                 "keys to be used with the --radio option.")));
+  parser.addPositionalArgument(
+        "command", QCoreApplication::translate(
+          "main", "Specifies the command to perform. Either detect, verify, plan, read, write, "
+          "write-db, resume, encode, encode-db, decode, import-tg, batch, serve, info, diff, patch, archive, stats, merge, route or selftest. Consult the man-page of dmrconf for a "
+          "detailed description of these commands."),
+        QCoreApplication::translate("main", "[command]"));
+
+  parser.addPositionalArgument(
+        "file", QCoreApplication::translate(
+          "main", "The code-plug file. Either binary (extension .dfu), text/csv (extension .conf "
+          "or .csv), YAML format (extension .yaml) or config snapshot (extension .snap). The "
+          "format can be forced using the --csv, --yaml, --snapshot or --binary options."),
+        QCoreApplication::translate("main", "[filename]"));
+}
+
+
+int
+runCommand(QCommandLineParser &parser, QCoreApplication &app) {
+  if (parser.isSet("timeout")) {
+    bool ok; int ms = parser.value("timeout").toInt(&ok);
+    if ((! ok) || (0 >= ms)) {
+      logError() << "Invalid timeout '" << parser.value("timeout")
+                 << "': Expected a positive number of milliseconds.";
+      return -1;
+    }
+    TimingPolicy::setFixedTimeout(ms);
+  }
+
+  if (parser.isSet("progress") && ("bar" != parser.value("progress"))
+      && ("json" != parser.value("progress"))) {
+    logError() << "Invalid progress format '" << parser.value("progress")
+               << "': Expected 'bar' or 'json'.";
+    return -1;
+  }
+
+  if (parser.isSet("verify-samples")) {
+    bool ok; int n = parser.value("verify-samples").toInt(&ok);
+    if ((! ok) || (0 >= n)) {
+      logError() << "Invalid number of samples '" << parser.value("verify-samples")
+                 << "': Expected a positive number of blocks.";
+      return -1;
+    }
+  }
+
+  if (parser.isSet("encode-threads")) {
+    bool ok; int n = parser.value("encode-threads").toInt(&ok);
+    if ((! ok) || (0 >= n)) {
+      logError() << "Invalid number of threads '" << parser.value("encode-threads")
+                 << "': Expected a positive number.";
+      return -1;
+    }
+  }
+  if (parser.isSet("decode-threads")) {
+    bool ok; int n = parser.value("decode-threads").toInt(&ok);
+    if ((! ok) || (0 >= n)) {
+      logError() << "Invalid number of threads '" << parser.value("decode-threads")
+                 << "': Expected a positive number.";
+      return -1;
+    }
+  }
+  if (parser.isSet("only")) {
+    ErrorStack err; Codeplug::Sections sections;
+    if (! Codeplug::Sections::parse(parser.value("only"), sections, err)) {
+      logError() << "Invalid codeplug sections '" << parser.value("only") << "': "
+                 << err.format();
+      return -1;
+    }
+  }
+  if (parser.isSet("jobs")) {
+    bool ok; int n = parser.value("jobs").toInt(&ok);
+    if ((! ok) || (0 >= n)) {
+      logError() << "Invalid number of jobs '" << parser.value("jobs")
+                 << "': Expected a positive number.";
+      return -1;
+    }
+  }
+
+  if (parser.isSet("trace")) {
+    ErrorStack err;
+    if (! Tracer::start(parser.value("trace"), err)) {
+      logError() << "Cannot start trace: " << err.format();
+      return -1;
+    }
+  }
+
+  if (parser.isSet("record"))
+    SessionRecorder::setFilename(parser.value("record"));
+
+  if (parser.isSet("low-latency"))
+    USBSerial::setLowLatency(true);
+
+  int res = -1;
+  QString command = parser.positionalArguments().at(0);
+
+  // Commands accessing devices share a single table of the connected devices, kept up-to-date
+  // while the command runs.
+  static const QStringList deviceCommands = {
+    "detect", "verify", "read", "write", "write-db", "resume", "batch", "serve" };
+  bool monitored = deviceCommands.contains(command) && (nullptr != DeviceMonitor::acquire());
+
+  if ("detect" == command)
+    res = detect(parser, app);
+  else if ("verify" == command)
+    res = verify(parser, app);
+  else if ("plan" == command)
+    res = plan(parser, app);
+  else if ("read" == command)
+    res = readCodeplug(parser, app);
+  else if ("write" == command)
+    res = writeCodeplug(parser, app);
+  else if ("write-db" == command)
+    res = writeCallsignDB(parser, app);
+  else if ("resume" == command)
+    res = resumeUpload(parser, app);
+  else if ("encode" == command)
+    res = encodeCodeplug(parser, app);
+  else if ("encode-db" == command)
+    res = encodeCallsignDB(parser, app);
+  else if ("decode" == command)
+    res = decodeCodeplug(parser, app);
+  else if ("import-tg" == command)
+    res = importTalkGroups(parser, app);
+  else if ("batch" == command)
+    res = batch(parser, app);
+  else if ("serve" == command)
+    res = serve(parser, app);
+  else if ("info" == command)
+    res = infoFile(parser, app);
+  else if ("diff" == command)
+    res = diffFiles(parser, app);
+  else if ("patch" == command)
+    res = patchFile(parser, app);
+  else if ("selftest" == command)
+    res = selfTest(parser, app);
+  else if ("merge" == command)
+    res = mergeConfig(parser, app);
+  else if ("route" == command)
+    res = routeConfig(parser, app);
+  else if ("archive" == command)
+    res = archive(parser, app);
+  else if ("stats" == command)
+    res = stats(parser, app);
+  else
+    parser.showHelp(-1);
+
+  if (monitored)
+    DeviceMonitor::release();
+
+  if (parser.isSet("trace")) {
+    ErrorStack err;
+    if (! Tracer::stop(err))
+      logError() << "Cannot write trace: " << err.format();
+  }
+
+  return res;
+}
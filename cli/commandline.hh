@@ -0,0 +1,12 @@
+#ifndef COMMANDLINE_HH
+#define COMMANDLINE_HH
+
+class QCoreApplication;
+class QCommandLineParser;
+
+/** Adds all options and positional arguments of dmrconf to the given parser. */
+void setupCommandLine(QCommandLineParser &parser);
+/** Checks the options and runs the command given as the first positional argument. */
+int runCommand(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // COMMANDLINE_HH
@@ -4,10 +4,14 @@
 #include <QCommandLineParser>
 #include <QFile>
 #include <QFileInfo>
+#include <QJsonObject>
 
 #include "logger.hh"
 #include "config.hh"
+#include "configsnapshot.hh"
 #include "radioinfo.hh"
+#include "filesignature.hh"
+#include "multifile.hh"
 #include "dummyfilereader.hh"
 #include "md390_codeplug.hh"
 #include "md390_filereader.hh"
@@ -35,9 +39,9 @@
 #include "dr1801uv_filereader.hh"
 
 template <class Cpl, class Rdr>
-bool decode(Config &config, const QString &filename, QCommandLineParser &parser, const ErrorStack &err=ErrorStack()) {
+bool decode(Config &config, const QString &filename, bool manufacturer, const QCommandLineParser &parser, const ErrorStack &err=ErrorStack()) {
   Cpl codeplug;
-  if (parser.isSet("manufacturer")) {
+  if (manufacturer) {
     if (! Rdr::read(filename, &codeplug, err)) {
       errMsg(err) << "Cannot decode manufacturer codeplug file '" << filename << "'.";
       return false;
@@ -46,12 +50,14 @@ bool decode(Config &config, const QString &filename, QCommandLineParser &parser,
     errMsg(err) << "Cannot decode binary codeplug file '" << filename << "'.";
     return false;
   }
+  if (parser.isSet("decode-threads"))
+    codeplug.setDecodeThreads(parser.value("decode-threads").toUInt());
   if (! codeplug.decode(&config, err)) {
     errMsg(err) << "Cannot decode binary codeplug file '" << filename << "'.";
     return false;
   }
   if (! codeplug.postprocess(&config, err)) {
-    logError() << "Cannot post-process binary codeplug file '" << filename << "'.";
+    errMsg(err) << "Cannot post-process binary codeplug file '" << filename << "'.";
     return false;
   }
 
@@ -59,6 +65,119 @@ bool decode(Config &config, const QString &filename, QCommandLineParser &parser,
 }
 
 
+/** Decodes the given codeplug file of the given radio into the config. */
+static bool
+decodeInto(Config &config, RadioInfo::Radio radio, const QString &filename, bool manufacturer,
+           const QCommandLineParser &parser, const ErrorStack &err)
+{
+  switch (radio) {
+  case RadioInfo::MD390: return decode<MD390Codeplug, MD390FileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::UV390: return decode<UV390Codeplug, UV390FileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::MD2017: return decode<MD2017Codeplug, MD2017FileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::DM1701: return decode<DM1701Codeplug, DM1701FileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::RD5R: return decode<RD5RCodeplug, RD5RFileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::GD73: return decode<GD73Codeplug, GD73FileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::GD77: return decode<GD77Codeplug, GD77FileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::OpenGD77: return decode<OpenGD77Codeplug, DummyFileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::OpenRTX: return decode<OpenRTXCodeplug, DummyFileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::D868UVE: return decode<D868UVCodeplug, DummyFileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::D878UV: return decode<D878UVCodeplug, DummyFileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::D878UVII: return decode<D878UV2Codeplug, DummyFileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::D578UV: return decode<D578UVCodeplug, DummyFileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::DMR6X2UV: return decode<DMR6X2UVCodeplug, DummyFileReader>(config, filename, manufacturer, parser, err);
+  case RadioInfo::DR1801UV: return decode<DR1801UVCodeplug, DR1801UVFileReader>(config, filename, manufacturer, parser, err);
+  default: break;
+  }
+
+  errMsg(err) << "Decoding not implemented for " << RadioInfo::byID(radio).name() << ".";
+  return false;
+}
+
+
+/** Identifies the radio of the given codeplug file by its signature, if no radio is given. The
+ * identification must be unique. */
+static bool
+identifyCodeplug(const QString &filename, RadioInfo::Radio &radio, bool &manufacturer,
+                 const ErrorStack &err)
+{
+  QList<FileSignature::Match> matches;
+  if (! FileSignature::identify(filename, matches, err)) {
+    errMsg(err) << "Cannot determine radio of '" << filename << "', use the --radio option.";
+    return false;
+  }
+
+  QStringList candidates;
+  foreach (const FileSignature::Match &match, matches) {
+    if (FileSignature::Content::Codeplug != match.content)
+      continue;
+    radio = match.radio;
+    manufacturer = (FileSignature::Format::Manufacturer == match.format);
+    candidates.append(RadioInfo::byID(match.radio).key());
+  }
+
+  if (candidates.isEmpty()) {
+    errMsg(err) << "File '" << filename << "' is not a codeplug.";
+    return false;
+  }
+  if (1 < candidates.size()) {
+    errMsg(err) << "Cannot determine radio of '" << filename << "', candidates are "
+                << candidates.join(", ") << ". Use the --radio option.";
+    return false;
+  }
+
+  logDebug() << "Identified '" << filename << "' as " << RadioInfo::byID(radio).name() << " codeplug.";
+  return true;
+}
+
+
+/** Writes the decoded config into the given file. */
+static bool
+writeDecoded(Config &config, const QString &filename, const QCommandLineParser &parser,
+             const ErrorStack &err)
+{
+  QFileInfo info(filename);
+  if (("conf" == info.suffix()) || ("csv" == info.suffix()) || parser.isSet("csv")) {
+    errMsg(err) << "Export of the old table based format was disabled with 0.9.0. "
+                   "Import still works.";
+    return false;
+  } else if (("yaml" == info.suffix()) || parser.isSet("yaml")) {
+    QFile outfile(info.filePath());
+    if (! outfile.open(QIODevice::WriteOnly)) {
+      errMsg(err) << "Cannot write YAML codeplug file '" << outfile.fileName()
+                  << "': " << outfile.errorString();
+      return false;
+    }
+    QTextStream stream(&outfile);
+    if (! config.toYAML(stream, err)) {
+      errMsg(err) << "Cannot serialize codeplug to YAML.";
+      return false;
+    }
+    outfile.close();
+  } else if (("snap" == info.suffix()) || parser.isSet("snapshot")) {
+    if (! ConfigSnapshot::write(&config, info.filePath(), err)) {
+      errMsg(err) << "Cannot write config snapshot.";
+      return false;
+    }
+  } else {
+    errMsg(err) << "Cannot determine codeplug output file format. Consider using --csv, --yaml or --snapshot.";
+    return false;
+  }
+
+  return true;
+}
+
+
+bool
+decodeCodeplugFile(const QString &input, RadioInfo::Radio radio, const QString &output,
+                   const QCommandLineParser &parser, const ErrorStack &err)
+{
+  Config config;
+  if (! decodeInto(config, radio, input, parser.isSet("manufacturer"), parser, err))
+    return false;
+  return writeDecoded(config, output, parser, err);
+}
+
+
 int
 decodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
   Q_UNUSED(app);
@@ -69,12 +188,9 @@ decodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
   QString filename = parser.positionalArguments().at(1);
   ErrorStack err;
 
-  if (! parser.isSet("radio")) {
-    logError() << "No radio type is specified! Use the --radio option.";
-    return -1;
-  }
-
-  if (! RadioInfo::hasRadioKey(parser.value("radio").toLower())) {
+  // Without a radio, the radio of every file gets identified by its signature
+  bool identify = ! parser.isSet("radio");
+  if ((! identify) && (! RadioInfo::hasRadioKey(parser.value("radio").toLower()))) {
     QStringList radios;
     foreach (RadioInfo info, RadioInfo::allRadios())
       radios.append(info.key());
@@ -83,111 +199,51 @@ decodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
     return -1;
   }
 
-  RadioInfo::Radio radio = RadioInfo::byKey(parser.value("radio").toLower()).id();
+  RadioInfo::Radio radio = identify ? RadioInfo::OpenGD77 : RadioInfo::byKey(parser.value("radio").toLower()).id();
+  bool manufacturer = parser.isSet("manufacturer");
+
+  // If more than two files or any patterns are given, all of them are inputs. They are decoded
+  // concurrently into YAML or snapshot files next to the inputs.
+  QStringList files = expandFilePatterns(parser.positionalArguments().mid(1));
+  if (files.isEmpty()) {
+    logError() << "No input files given.";
+    return -1;
+  }
+  if ((3 < parser.positionalArguments().size())
+      || (files != parser.positionalArguments().mid(1))) {
+    QString suffix = parser.isSet("snapshot") ? "snap" : "yaml";
+    auto processor = [identify, radio, manufacturer, suffix, &parser](const QString &input, QJsonObject &result, const ErrorStack &err) {
+      QFileInfo info(input);
+      QString output = info.dir().filePath(info.completeBaseName() + "." + suffix);
+      result.insert("output", output);
+      RadioInfo::Radio fileRadio = radio; bool fileManufacturer = manufacturer;
+      if (identify) {
+        if (! identifyCodeplug(input, fileRadio, fileManufacturer, err))
+          return false;
+        result.insert("radio", RadioInfo::byID(fileRadio).key());
+      }
+      Config config;
+      return decodeInto(config, fileRadio, input, fileManufacturer, parser, err)
+          && writeDecoded(config, output, parser, err);
+    };
+    return processFiles(files, parser, processor) ? 0 : -1;
+  }
+
+  if (identify && (! identifyCodeplug(filename, radio, manufacturer, err))) {
+    logError() << err.format();
+    return -1;
+  }
+
   Config config;
 
-  switch (radio) {
-  case RadioInfo::MD390:
-    if (! decode<MD390Codeplug, MD390FileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::UV390:
-    if (! decode<UV390Codeplug, UV390FileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::MD2017:
-    if (! decode<MD2017Codeplug, MD2017FileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::DM1701:
-    if (! decode<DM1701Codeplug, DM1701FileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::RD5R:
-    if (! decode<RD5RCodeplug, RD5RFileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::GD73:
-    if (! decode<GD73Codeplug, GD73FileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::GD77:
-    if (! decode<GD77Codeplug, GD77FileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::OpenGD77:
-    if (! decode<OpenGD77Codeplug, DummyFileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::OpenRTX:
-    if (! decode<OpenRTXCodeplug, DummyFileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::D868UVE:
-    if (! decode<D868UVCodeplug, DummyFileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::D878UV:
-    if (! decode<D878UVCodeplug, DummyFileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::D878UVII:
-    if (! decode<D878UV2Codeplug, DummyFileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::D578UV:
-    if (! decode<D578UVCodeplug, DummyFileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::DMR6X2UV:
-    if (! decode<DMR6X2UVCodeplug, DummyFileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  case RadioInfo::DR1801UV:
-    if (! decode<DR1801UVCodeplug, DR1801UVFileReader>(config, filename, parser, err)) {
-      logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
-      return -1;
-    } break;
-  default:
-    logError() << "Decoding not implemented for " << RadioInfo::byID(radio).name() << ".";
+  if (! decodeInto(config, radio, filename, manufacturer, parser, err)) {
+    logError() << "Cannot decode codeplug '" << filename << "': " << err.format();
     return -1;
   }
 
   if (3 <= parser.positionalArguments().size()) {
-    QFileInfo info(parser.positionalArguments().at(2));
-    if (("conf" == info.suffix()) || ("csv" == info.suffix()) || parser.isSet("csv")) {
-      logError() << "Export of the old table based format was disabled with 0.9.0. "
-                    "Import still works.";
-      return -1;
-    } else if (("yaml" == info.suffix()) || parser.isSet("yaml")) {
-      QFile outfile(info.filePath());
-      if (! outfile.open(QIODevice::WriteOnly)) {
-        logError() << "Cannot write CSV codeplug file '" << outfile.fileName()
-                   << "':\n" << outfile.errorString();
-        return -1;
-      }
-      QTextStream stream(&outfile);
-      if (! config.toYAML(stream, err)) {
-        logError() << "Cannot serialize codeplug to YAML:\n"
-                   << err.format(" ");
-      }
-      outfile.close();
-    } else {
-      logError() << "Cannot determine codeplug output file format. Consider using --csv or --yaml.";
+    if (! writeDecoded(config, parser.positionalArguments().at(2), parser, err)) {
+      logError() << "Cannot write decoded codeplug:\n" << err.format(" ");
       return -1;
     }
   } else {
@@ -202,12 +258,17 @@ decodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
                    << err.format(" ");
         return -1;
       }
+    } else if (parser.isSet("snapshot")) {
+      QFile out;
+      if ((! out.open(stdout, QIODevice::WriteOnly)) || (! ConfigSnapshot::write(&config, out, err))) {
+        logError() << "Cannot write config snapshot:\n" << err.format(" ");
+        return -1;
+      }
     } else {
-      logError() << "Cannot determine codeplug output file format. Consider using --csv or --yaml.";
+      logError() << "Cannot determine codeplug output file format. Consider using --csv, --yaml or --snapshot.";
       return -1;
     }
   }
 
   return 0;
 }
-
@@ -1,9 +1,17 @@
 #ifndef DECODECODEPLUG_HH
 #define DECODECODEPLUG_HH
 
+#include "radioinfo.hh"
+#include "errorstack.hh"
+
 class QCoreApplication;
 class QCommandLineParser;
 
 int decodeCodeplug(QCommandLineParser &parser, QCoreApplication &app);
 
+/** Decodes the binary or manufacturer codeplug file @c input of the given radio and writes it
+ * into the YAML or snapshot file @c output. The options are taken from the given parser. */
+bool decodeCodeplugFile(const QString &input, RadioInfo::Radio radio, const QString &output,
+                        const QCommandLineParser &parser, const ErrorStack &err=ErrorStack());
+
 #endif // DECODECODEPLUG_HH
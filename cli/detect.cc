@@ -6,20 +6,80 @@
 #include "radio.hh"
 #include "radiointerface.hh"
 #include "autodetect.hh"
+#include "detectioncache.hh"
+
+/** Returns the cached identification of the given device, unless the radio is forced. */
+static RadioInfo
+cachedDetection(QCommandLineParser &parser, const USBDeviceDescriptor &device) {
+  if (parser.isSet("radio"))
+    return RadioInfo();
+  return DetectionCache().lookup(device);
+}
 
 int detect(QCommandLineParser &parser, QCoreApplication &app) {
-  // Try to detect a radio
+  Q_UNUSED(app)
+
   ErrorStack err;
-  Radio *radio = autoDetect(parser, app, err);
+  if (multipleDevices(parser)) {
+    QList<USBDeviceDescriptor> devices = selectDevices(parser, err);
+    if (devices.isEmpty()) {
+      logError() << "Cannot detect radios: \n" << err.format("  ");
+      return -1;
+    }
+
+    // Report cached identifications, probe the remaining devices concurrently
+    QList<USBDeviceDescriptor> probe;
+    foreach (USBDeviceDescriptor device, devices) {
+      RadioInfo info = cachedDetection(parser, device);
+      if (info.isValid())
+        logInfo() << "Found: '" << info.name() << "' at " << device.deviceHandle() << " (cached).";
+      else
+        probe.append(device);
+    }
+
+    int failed = 0;
+    if (! probe.isEmpty()) {
+      QList<Radio *> radios = detectRadios(parser, probe, err);
+      for (int i=0; i<radios.size(); i++) {
+        if (nullptr == radios.at(i)) {
+          failed++;
+          continue;
+        }
+        logInfo() << "Found: '" << radios.at(i)->name() << "' at "
+                  << probe.at(i).deviceHandle() << ".";
+        delete radios.at(i);
+      }
+    }
+    if (failed) {
+      logError() << "Cannot detect " << failed << " radio(s): \n" << err.format("  ");
+      return -1;
+    }
+    return 0;
+  }
+
+  USBDeviceDescriptor device = selectDevice(parser, err);
+  if (! device.isValid()) {
+    logError() << "Cannot detect radio: \n" << err.format("  ");
+    return -1;
+  }
+
+  RadioInfo info = cachedDetection(parser, device);
+  if (info.isValid()) {
+    logInfo() << "Found: '" << info.name() << "' (cached).";
+    return 0;
+  }
+
+  // Try to detect a radio
+  Radio *radio = detectRadio(parser, device, err);
   if (nullptr == radio) {
     logError() << "Cannot detect radio: \n" << err.format("  ");
+    DetectionCache().remove(device);
     return -1;
   }
+  cacheDetection(parser, device, radio);
 
   logInfo() << "Found: '" << radio->name() << "'.";
   delete  radio;
 
   return 0;
 }
-
-
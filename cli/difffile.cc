@@ -0,0 +1,93 @@
+#include "difffile.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include "logger.hh"
+#include "dfufile.hh"
+#include "dfupatch.hh"
+
+
+int diffFiles(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app)
+
+  if (3 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  QString fromFile = parser.positionalArguments().at(1);
+  QString toFile = parser.positionalArguments().at(2);
+  ErrorStack err;
+
+  DFUFile from, to;
+  if (! from.read(fromFile, err)) {
+    logError() << "Cannot read binary file '" << fromFile << "': " << err.format();
+    return -1;
+  }
+  if (! to.read(toFile, err)) {
+    logError() << "Cannot read binary file '" << toFile << "': " << err.format();
+    return -1;
+  }
+
+  DFUPatch patch;
+  if (! patch.diff(from, to, 8, err)) {
+    logError() << "Cannot compare '" << fromFile << "' and '" << toFile << "': " << err.format();
+    return -1;
+  }
+
+  // Without a patch file, print modified ranges only
+  if (3 == parser.positionalArguments().size()) {
+    QTextStream out(stdout);
+    patch.dump(out);
+    return 0;
+  }
+
+  QString patchFile = parser.positionalArguments().at(3);
+  if (! patch.write(patchFile, err)) {
+    logError() << "Cannot write patch file '" << patchFile << "': " << err.format();
+    return -1;
+  }
+  logDebug() << "Wrote " << patch.numHunks() << " hunks (" << patch.size() << "b) to '"
+             << patchFile << "'.";
+
+  return 0;
+}
+
+
+int patchFile(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app)
+
+  if (3 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  QString filename = parser.positionalArguments().at(1);
+  QString patchFile = parser.positionalArguments().at(2);
+  QString output = (4 <= parser.positionalArguments().size()) ?
+        parser.positionalArguments().at(3) : filename;
+  ErrorStack err;
+
+  DFUFile file;
+  if (! file.read(filename, err)) {
+    logError() << "Cannot read binary file '" << filename << "': " << err.format();
+    return -1;
+  }
+
+  DFUPatch patch;
+  if (! patch.read(patchFile, err)) {
+    logError() << "Cannot read patch file '" << patchFile << "': " << err.format();
+    return -1;
+  }
+
+  if (! patch.apply(file, err)) {
+    logError() << "Cannot apply patch '" << patchFile << "' to '" << filename << "': "
+               << err.format();
+    return -1;
+  }
+
+  if (! file.write(output, err)) {
+    logError() << "Cannot write binary file '" << output << "': " << err.format();
+    return -1;
+  }
+
+  return 0;
+}
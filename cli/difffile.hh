@@ -0,0 +1,11 @@
+#ifndef DIFFFILE_HH
+#define DIFFFILE_HH
+
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int diffFiles(QCommandLineParser &parser, QCoreApplication &app);
+int patchFile(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // DIFFFILE_HH
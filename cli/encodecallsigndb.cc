@@ -1,4 +1,4 @@
-#include "encodecodeplug.hh"
+#include "encodecallsigndb.hh"
 
 #include <QCoreApplication>
 #include <QCommandLineParser>
@@ -17,17 +17,12 @@
 #include "crc32.hh"
 
 
-int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
-  Q_UNUSED(app);
-
-  if (2 > parser.positionalArguments().size())
-    parser.showHelp(-1);
-
-  UserDatabase userdb;
-  if (parser.isSet("database")) {
-    if (! userdb.load(parser.value("database"))) {
-      logError() << "Cannot load user-db from '" << parser.value("database") << "'.";
-      return -1;
+bool
+loadUserDB(UserDatabase &userdb, const QString &filename, const ErrorStack &err) {
+  if (! filename.isEmpty()) {
+    if (! userdb.load(filename)) {
+      errMsg(err) << "Cannot load user-db from '" << filename << "'.";
+      return false;
     }
   } else if (0 == userdb.count()) {
     logInfo() << "Downloading call-sign DB...";
@@ -38,8 +33,60 @@ int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     loop.exec();
     // Check if call-sign DB has been loaded
     if (0 == userdb.count()) {
-      logError() << "Could not download/load call-sign DB.";
-      return -1;
+      errMsg(err) << "Could not download/load call-sign DB.";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+UserDatabase *
+sharedUserDB(const QString &filename, const ErrorStack &err) {
+  // Owned by the application, such that they get deleted before the application
+  static QHash<QString, UserDatabase *> databases;
+  if (databases.contains(filename))
+    return databases.value(filename);
+
+  UserDatabase *userdb = new UserDatabase(30, QCoreApplication::instance());
+  if (! loadUserDB(*userdb, filename, err)) {
+    delete userdb;
+    return nullptr;
+  }
+  databases.insert(filename, userdb);
+  return userdb;
+}
+
+
+bool
+selectUsers(UserDatabase &userdb, const QCommandLineParser &parser,
+            CallsignDB::Selection &selection, const ErrorStack &err)
+{
+  if (parser.isSet("limit")) {
+    bool ok=true;
+    selection.setCountLimit(parser.value("limit").toUInt(&ok));
+    if (! ok) {
+      errMsg(err) << "Please specify a valid limit for the number of callsign db entries using the -n/--limit option.";
+      return false;
+    }
+  }
+
+  if (parser.isSet("country")) {
+    foreach (QString region, parser.value("country").split(",", Qt::SkipEmptyParts)) {
+      QStringList parts = region.split("/");
+      selection.addCountry(parts.first().simplified(), parts.mid(1).join("/").simplified());
+    }
+  }
+
+  if (parser.isSet("id-prefix")) {
+    foreach (QString prefix_text, parser.value("id-prefix").split(",")) {
+      bool ok=true; unsigned prefix = prefix_text.toUInt(&ok);
+      if (! ok) {
+        errMsg(err) << "Please specify a valid list of DMR ID prefixes for --id-prefix option.";
+        return false;
+      }
+      selection.addPrefix(prefix);
     }
   }
 
@@ -53,15 +100,15 @@ int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     }
 
     if (prefixes.isEmpty()) {
-      logError() << "Please specify a valid DMR ID or a list of DMR prefixes for --id option.";
-      return -1;
+      errMsg(err) << "Please specify a valid DMR ID or a list of DMR prefixes for --id option.";
+      return false;
     }
     prefixes_text.clear();
     foreach (unsigned prefix, prefixes) {
       prefixes_text.append(QString::number(prefix));
     }
     logDebug() << "Sort call-sign DB w.r.t. DMR ID(s) {" << prefixes_text.join(", ") << "}.";
-    userdb.sortUsers(prefixes);
+    userdb.sortUsers(prefixes, selection.hasCountLimit() ? int(selection.countLimit()) : -1);
   } else {
     logWarn() << "No ID is specified, a more or less random set of call-signs will be used "
               << "if the radio cannot hold the entire call-sign DB of " << userdb.count()
@@ -69,14 +116,86 @@ int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
               << "select those entries 'closest' to you. I.e., DMR IDs with the same prefix.";
   }
 
+  return true;
+}
+
+
+/** Encodes the user DB using the given device specific call-sign DB and writes it into the given
+ * file. */
+template <class DB>
+bool encodeDB(UserDatabase &userdb, const QString &filename, const CallsignDB::Selection &selection,
+              const ErrorStack &err)
+{
+  DB db;
+  if (! db.encode(&userdb, selection, err)) {
+    errMsg(err) << "Cannot encode call-sign DB.";
+    return false;
+  }
+  if (! db.write(filename, err)) {
+    errMsg(err) << "Cannot write output call-sign DB file '" << filename << "'.";
+    return false;
+  }
+  return true;
+}
+
+/** Encodes the user DB using the given device specific call-sign DB, that is written into a
+ * file directly. */
+template <class DB>
+bool encodeDBToFile(UserDatabase &userdb, const QString &filename,
+                    const CallsignDB::Selection &selection, const ErrorStack &err)
+{
+  DB db;
+  if (! db.encodeToFile(&userdb, filename, selection, err)) {
+    errMsg(err) << "Cannot write output call-sign DB file '" << filename << "'.";
+    return false;
+  }
+  return true;
+}
+
+
+bool
+encodeCallsignDBFile(UserDatabase &userdb, RadioInfo::Radio radio, const QString &output,
+                     const CallsignDB::Selection &selection, const ErrorStack &err)
+{
+  switch (radio) {
+  case RadioInfo::UV390:
+    return encodeDBToFile<UV390CallsignDB>(userdb, output, selection, err);
+  case RadioInfo::MD2017:
+    return encodeDBToFile<MD2017CallsignDB>(userdb, output, selection, err);
+  case RadioInfo::DM1701:
+    return encodeDBToFile<DM1701CallsignDB>(userdb, output, selection, err);
+  case RadioInfo::OpenGD77:
+    return encodeDB<OpenGD77CallsignDB>(userdb, output, selection, err);
+  case RadioInfo::GD77:
+    return encodeDB<GD77CallsignDB>(userdb, output, selection, err);
+  case RadioInfo::D868UVE:
+  case RadioInfo::D878UV:
+    return encodeDB<D868UVCallsignDB>(userdb, output, selection, err);
+  case RadioInfo::D878UVII:
+  case RadioInfo::D578UV:
+    return encodeDB<D878UV2CallsignDB>(userdb, output, selection, err);
+  default:
+    break;
+  }
+
+  errMsg(err) << "Cannot encode calls-sign DB: Not implemented for '"
+              << RadioInfo::byID(radio).name() << "'.";
+  return false;
+}
+
+
+int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app);
+
+  if (2 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  ErrorStack err;
+  UserDatabase *userdb = sharedUserDB(parser.value("database"), err);
   CallsignDB::Selection selection;
-  if (parser.isSet("limit")) {
-    bool ok=true;
-    selection.setCountLimit(parser.value("limit").toUInt(&ok));
-    if (! ok) {
-      logError() << "Please specify a valid limit for the number of callsign db entries using the -n/--limit option.";
-      return -1;
-    }
+  if ((nullptr == userdb) || (! selectUsers(*userdb, parser, selection, err))) {
+    logError() << err.format();
+    return -1;
   }
 
   if (! parser.isSet("radio")) {
@@ -95,87 +214,8 @@ int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
   }
 
   RadioInfo::Radio radio = RadioInfo::byKey(parser.value("radio").toLower()).id();
-  ErrorStack err;
-
-  if (RadioInfo::UV390 == radio) {
-    UV390CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::MD2017 == radio) {
-    MD2017CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::DM1701 == radio) {
-    DM1701CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::OpenGD77 == radio) {
-    OpenGD77CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::GD77 == radio) {
-    GD77CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if ((RadioInfo::D868UVE == radio) || (RadioInfo::D878UV == radio)){
-    D868UVCallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if ((RadioInfo::D878UVII == radio) || (RadioInfo::D578UV == radio)){
-    D878UV2CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else {
-    logError() << "Cannot encode calls-sign DB: Not implemented for '" << parser.value("radio") << "'.";
+  if (! encodeCallsignDBFile(*userdb, radio, parser.positionalArguments().at(1), selection, err)) {
+    logError() << err.format();
     return -1;
   }
 
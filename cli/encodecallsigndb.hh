@@ -1,9 +1,28 @@
 #ifndef ENCODECALLSIGNDB_HH
 #define ENCODECALLSIGNDB_HH
 
+#include "radioinfo.hh"
+#include "callsigndb.hh"
+#include "errorstack.hh"
+
 class QCoreApplication;
 class QCommandLineParser;
+class UserDatabase;
 
 int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app);
 
+/** Loads the user DB from the given JSON file. If the file name is empty, the cached user DB is
+ * used or downloaded. */
+bool loadUserDB(UserDatabase &userdb, const QString &filename, const ErrorStack &err=ErrorStack());
+/** Returns the user DB loaded from the given JSON file (see @c loadUserDB). Every DB is loaded
+ * only once per process and is shared by all commands. Returns @c nullptr on error. */
+UserDatabase *sharedUserDB(const QString &filename, const ErrorStack &err=ErrorStack());
+/** Applies the --limit and --id options. That is, sets the count limit of the selection and sorts
+ * the user DB w.r.t. the given IDs. */
+bool selectUsers(UserDatabase &userdb, const QCommandLineParser &parser,
+                 CallsignDB::Selection &selection, const ErrorStack &err=ErrorStack());
+/** Encodes the user DB for the given radio into the call-sign DB file @c output. */
+bool encodeCallsignDBFile(UserDatabase &userdb, RadioInfo::Radio radio, const QString &output,
+                          const CallsignDB::Selection &selection, const ErrorStack &err=ErrorStack());
+
 #endif // ENCODECALLSIGNDB_HH
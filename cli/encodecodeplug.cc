@@ -7,6 +7,7 @@
 
 #include "logger.hh"
 #include "config.hh"
+#include "configsnapshot.hh"
 #include "radioinfo.hh"
 #include "rd5r_codeplug.hh"
 #include "gd73_codeplug.hh"
@@ -23,37 +24,134 @@
 #include "dmr6x2uv_codeplug.hh"
 #include "dr1801uv_codeplug.hh"
 #include "crc32.hh"
+#include "encodecache.hh"
 
 
 template <class T>
-bool encode(Config &config, Codeplug::Flags flags, QCommandLineParser &parser) {
-  ErrorStack err;
+bool encode(Config &config, RadioInfo::Radio radio, Codeplug::Flags flags, bool cached,
+            const QString &output, const ErrorStack &err)
+{
   T codeplug;
 
-  Config *intermediate = codeplug.preprocess(&config, err);
+  // Reuse a previously encoded image of the same config
+  EncodeCache cache;
+  QString key;
+  if (cached) {
+    QByteArray hash = EncodeCache::configHash(&config, err);
+    if (hash.isEmpty())
+      return false;
+    key = EncodeCache::key(hash, RadioInfo::byID(radio), T::staticMetaObject.className(), flags);
+    DFUFile image;
+    if (cache.load(key, image)) {
+      logDebug() << "Reuse cached encoding of the codeplug.";
+      if (! image.write(output, err)) {
+        errMsg(err) << "Cannot write output codeplug file '" << output << "'.";
+        return false;
+      }
+      return true;
+    }
+  }
+
+  // Encoding does not modify the config, only copy it if it gets rewritten.
+  Config *intermediate = &config;
+  if (codeplug.requiresPreprocessing(&config))
+    intermediate = codeplug.preprocess(&config, err);
   if (nullptr == intermediate) {
-    logError() << "Cannot pre-process codeplug: " << err.format();
+    errMsg(err) << "Cannot pre-process codeplug.";
     return false;
   }
 
   if (! codeplug.encode(intermediate, flags, err)) {
-    logError() << "Cannot encode codeplug: " << err.format();
-    delete intermediate;
+    errMsg(err) << "Cannot encode codeplug.";
+    if (intermediate != &config)
+      delete intermediate;
     return false;
   }
-  delete intermediate;
+  if (intermediate != &config)
+    delete intermediate;
 
   codeplug.image(0).sort();
-  if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-    logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-               << "': " << err.format();
+  if (! codeplug.write(output, err)) {
+    errMsg(err) << "Cannot write output codeplug file '" << output << "'.";
     return false;
   }
 
+  if (cached && (! cache.store(key, codeplug)))
+    logWarn() << "Cannot cache encoded codeplug.";
+
   return true;
 }
 
 
+bool
+encodeCodeplugFile(const QString &input, RadioInfo::Radio radio, const QString &output,
+                   const QCommandLineParser &parser, const ErrorStack &err)
+{
+  QFileInfo fileinfo(input);
+
+  Codeplug::Flags flags;
+  flags.updateCodePlug = false;
+  if (parser.isSet("auto-enable-gps"))
+    flags.autoEnableGPS = true;
+  if (parser.isSet("auto-enable-roaming"))
+    flags.autoEnableRoaming = true;
+  if (parser.isSet("encode-threads"))
+    flags.encodeThreads = parser.value("encode-threads").toUInt();
+  // Cached codeplugs are held in memory in addition to the encoded one
+  bool cached = parser.isSet("encode-cache") && (! parser.isSet("low-memory"));
+
+  Config config;
+  if (parser.isSet("csv") || ("conf" == fileinfo.suffix()) || ("csv" == fileinfo.suffix())) {
+    QString errorMessage;
+    QFile infile(fileinfo.canonicalFilePath());
+    if (! infile.open(QIODevice::ReadOnly)) {
+      errMsg(err) << "Cannot encode CSV codeplug file '" << fileinfo.fileName() << "': "
+                  << infile.errorString();
+      return false;
+    }
+    QTextStream stream(&infile);
+    if (! config.readCSV(stream, errorMessage)) {
+      errMsg(err) << "Cannot parse CSV codeplug '" << infile.fileName() << "': " << errorMessage;
+      return false;
+    }
+  } else if (parser.isSet("yaml") || ("yaml" == fileinfo.suffix())) {
+    if (! config.readYAML(fileinfo.canonicalFilePath(), err)) {
+      errMsg(err) << "Cannot parse YAML codeplug '" << fileinfo.fileName() << "'.";
+      return false;
+    }
+  } else if (parser.isSet("snapshot") || ("snap" == fileinfo.suffix())) {
+    if (! ConfigSnapshot::read(&config, fileinfo.canonicalFilePath(), err)) {
+      errMsg(err) << "Cannot read config snapshot '" << fileinfo.fileName() << "'.";
+      return false;
+    }
+  } else {
+    errMsg(err) << "Cannot determine input file type, consider using --csv, --yaml or --snapshot.";
+    return false;
+  }
+
+  switch (radio) {
+  case RadioInfo::MD390: return encode<MD390Codeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::UV390: return encode<UV390Codeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::MD2017: return encode<MD2017Codeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::RD5R: return encode<RD5RCodeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::GD73: return encode<GD73Codeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::GD77: return encode<GD77Codeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::OpenGD77: return encode<OpenGD77Codeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::OpenRTX: return encode<OpenRTXCodeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::D868UVE: return encode<D868UVCodeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::D878UV: return encode<D878UVCodeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::D878UVII: return encode<D878UV2Codeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::D578UV: return encode<D578UVCodeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::DMR6X2UV: return encode<DMR6X2UVCodeplug>(config, radio, flags, cached, output, err);
+  case RadioInfo::DR1801UV: return encode<DR1801UVCodeplug>(config, radio, flags, cached, output, err);
+  default: break;
+  }
+
+  errMsg(err) << "Cannot encode codeplug: Unknown radio '" << RadioInfo::byID(radio).name() << "'.";
+  return false;
+}
+
+
 int encodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
   Q_UNUSED(app);
 
@@ -79,97 +177,9 @@ int encodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
 
   RadioInfo::Radio radio = RadioInfo::byKey(parser.value("radio").toLower()).id();
 
-  Codeplug::Flags flags;
-  flags.updateCodePlug = false;
-  if (parser.isSet("auto-enable-gps"))
-    flags.autoEnableGPS = true;
-  if (parser.isSet("auto-enable-roaming"))
-    flags.autoEnableRoaming = true;
-
-  Config config;
   ErrorStack err;
-  if (parser.isSet("csv") || ("conf" == fileinfo.suffix()) || ("csv" == fileinfo.suffix())) {
-    QString errorMessage;
-    QFile infile(fileinfo.canonicalFilePath());
-    if (! infile.open(QIODevice::ReadOnly)) {
-      logError() << "Cannot encode CSV codeplug file '" << fileinfo.fileName() << "': " << infile.errorString();
-      return -1;
-    }
-    QTextStream stream(&infile);
-    if (! config.readCSV(stream, errorMessage)) {
-      logError() << "Cannot parse CSV codeplug '" << infile.fileName() << "': " << errorMessage;
-      return -1;
-    }
-  } else if (parser.isSet("yaml") || ("yaml" == fileinfo.suffix())) {
-    if (! config.readYAML(fileinfo.canonicalFilePath(), err)) {
-      logError() << "Cannot parse YAML codeplug '" << fileinfo.fileName()
-                 << "':\n" << err.format(" ");
-      return -1;
-    }
-  } else {
-    logError() << "Cannot determine input file type, consider using --csv or --yaml.";
-    return -1;
-  }
-
-  switch (radio) {
-  case RadioInfo::MD390:
-    if (! encode<MD390Codeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::UV390:
-    if (! encode<UV390Codeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::MD2017:
-    if (! encode<MD2017Codeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::RD5R:
-    if (! encode<RD5RCodeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::GD73:
-    if (! encode<GD73Codeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::GD77:
-    if (! encode<GD77Codeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::OpenGD77:
-    if (! encode<OpenGD77Codeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::OpenRTX:
-    if (! encode<OpenRTXCodeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::D868UVE:
-    if (! encode<D868UVCodeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::D878UV:
-    if (! encode<D878UVCodeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::D878UVII:
-    if (! encode<D878UV2Codeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::D578UV:
-    if (! encode<D578UVCodeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::DMR6X2UV:
-    if (! encode<DMR6X2UVCodeplug>(config, flags, parser))
-      return -1;
-    break;
-  case RadioInfo::DR1801UV:
-    if (! encode<DR1801UVCodeplug>(config, flags, parser))
-      return -1;
-    break;
-  default:
-    logError() << "Cannot encode codeplug: Unknown radio '" << parser.value("radio") << "'.";
+  if (! encodeCodeplugFile(fileinfo.filePath(), radio, parser.positionalArguments().at(2), parser, err)) {
+    logError() << "Cannot encode codeplug '" << fileinfo.fileName() << "':\n" << err.format(" ");
     return -1;
   }
 
@@ -1,9 +1,17 @@
 #ifndef ENCODECODEPLUG_HH
 #define ENCODECODEPLUG_HH
 
+#include "radioinfo.hh"
+#include "errorstack.hh"
+
 class QCoreApplication;
 class QCommandLineParser;
 
 int encodeCodeplug(QCommandLineParser &parser, QCoreApplication &app);
 
+/** Reads the codeplug file @c input and encodes it for the given radio into the binary codeplug
+ * file @c output. The options are taken from the given parser. */
+bool encodeCodeplugFile(const QString &input, RadioInfo::Radio radio, const QString &output,
+                        const QCommandLineParser &parser, const ErrorStack &err=ErrorStack());
+
 #endif // ENCODECODEPLUG_HH
@@ -0,0 +1,108 @@
+#include "importtalkgroups.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include "logger.hh"
+#include "config.hh"
+#include "talkgroupdatabase.hh"
+
+
+static bool
+loadTalkGroupDB(TalkGroupDatabase &db, const QString &filename, const ErrorStack &err) {
+  if (! filename.isEmpty()) {
+    if (! db.load(filename)) {
+      errMsg(err) << "Cannot load talk group DB from '" << filename << "'.";
+      return false;
+    }
+  } else if (0 == db.count()) {
+    logInfo() << "Downloading talk group DB...";
+    // Wait for download to finish
+    QEventLoop loop;
+    QObject::connect(&db, SIGNAL(loaded()), &loop, SLOT(quit()));
+    QObject::connect(&db, SIGNAL(error(QString)), &loop, SLOT(quit()));
+    loop.exec();
+    if (0 == db.count()) {
+      errMsg(err) << "Could not download/load talk group DB.";
+      return false;
+    }
+  }
+  return true;
+}
+
+
+int importTalkGroups(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app)
+
+  if (2 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  QFileInfo input(parser.positionalArguments().at(1));
+  if ((! parser.isSet("yaml")) && ("yaml" != input.suffix())) {
+    logError() << "Talk groups can only be imported into YAML codeplugs.";
+    return -1;
+  }
+
+  // Collect ID prefixes, an empty list accepts all talk groups
+  QStringList prefixes;
+  if (parser.isSet("id-prefix")) {
+    foreach (QString prefix, parser.value("id-prefix").split(",")) {
+      bool ok=true; prefix.toUInt(&ok);
+      if (! ok) {
+        logError() << "Please specify a valid list of talk group prefixes for --id-prefix option.";
+        return -1;
+      }
+      prefixes.append(prefix);
+    }
+  }
+
+  ErrorStack err;
+  Config config;
+  if (! config.readYAML(input.canonicalFilePath(), err)) {
+    logError() << "Cannot parse YAML codeplug '" << input.fileName() << "':\n" << err.format(" ");
+    return -1;
+  }
+
+  TalkGroupDatabase db(30, QCoreApplication::instance());
+  if (! loadTalkGroupDB(db, parser.value("database"), err)) {
+    logError() << err.format();
+    return -1;
+  }
+
+  int created = config.importTalkGroups(&db, [&prefixes](unsigned number, const QString &name) {
+    Q_UNUSED(name);
+    if (prefixes.isEmpty())
+      return true;
+    QString id = QString::number(number);
+    foreach (const QString &prefix, prefixes) {
+      if (id.startsWith(prefix))
+        return true;
+    }
+    return false;
+  }, parser.value("group-list"));
+  logInfo() << "Created " << created << " talk group contacts.";
+
+  QFile outfile;
+  if (3 <= parser.positionalArguments().size()) {
+    outfile.setFileName(parser.positionalArguments().at(2));
+    if (! outfile.open(QIODevice::WriteOnly)) {
+      logError() << "Cannot write YAML codeplug file '" << outfile.fileName()
+                 << "': " << outfile.errorString();
+      return -1;
+    }
+  } else if (! outfile.open(stdout, QIODevice::WriteOnly)) {
+    logError() << "Cannot write YAML codeplug to stdout.";
+    return -1;
+  }
+  QTextStream stream(&outfile);
+  if (! config.toYAML(stream, err)) {
+    logError() << "Cannot serialize codeplug into YAML:\n" << err.format(" ");
+    return -1;
+  }
+
+  return 0;
+}
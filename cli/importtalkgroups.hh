@@ -0,0 +1,9 @@
+#ifndef IMPORTTALKGROUPS_HH
+#define IMPORTTALKGROUPS_HH
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int importTalkGroups(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // IMPORTTALKGROUPS_HH
@@ -3,9 +3,69 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QTextStream>
+#include <QJsonObject>
+#include <QJsonArray>
 
 #include "logger.hh"
 #include "dfufile.hh"
+#include "filesignature.hh"
+#include "multifile.hh"
+
+
+/** Collects the structure of the given DFU file, i.e., its images and elements together with
+ * their CRCs, into the result. */
+static bool
+inspectFile(const QString &filename, QJsonObject &result, const ErrorStack &err) {
+  DFUFile file;
+  if (! file.read(filename, err)) {
+    errMsg(err) << "Cannot read codeplug file '" << filename << "'.";
+    return false;
+  }
+
+  result.insert("size", qint64(file.size()));
+  QJsonArray images;
+  for (int i=0; i<file.numImages(); i++) {
+    const DFUFile::Image &image = file.image(i);
+    QJsonArray elements;
+    for (int j=0; j<image.numElements(); j++) {
+      const DFUFile::Element &element = image.element(j);
+      QJsonObject obj;
+      obj.insert("address", qint64(element.address()));
+      obj.insert("size", qint64(element.memSize()));
+      obj.insert("crc32", qint64(element.crc()));
+      uint8_t fill = 0x00;
+      if (element.isUniform(&fill))
+        obj.insert("fill", fill);
+      elements.append(obj);
+    }
+    QJsonObject obj;
+    obj.insert("name", image.name());
+    obj.insert("elements", elements);
+    images.append(obj);
+  }
+  result.insert("images", images);
+  return true;
+}
+
+/** Identifies the radio and content of the given file by its signature only, see
+ * @c FileSignature. */
+static bool
+identifyFile(const QString &filename, QJsonObject &result, const ErrorStack &err) {
+  QList<FileSignature::Match> matches;
+  if (! FileSignature::identify(filename, matches, err))
+    return false;
+
+  QJsonArray radios;
+  foreach (const FileSignature::Match &match, matches) {
+    QJsonObject obj;
+    obj.insert("radio", RadioInfo::byID(match.radio).key());
+    obj.insert("content", FileSignature::contentName(match.content));
+    obj.insert("format", FileSignature::formatName(match.format));
+    radios.append(obj);
+  }
+  result.insert("matches", radios);
+  return true;
+}
 
 
 int infoFile(QCommandLineParser &parser, QCoreApplication &app) {
@@ -14,9 +74,33 @@ int infoFile(QCommandLineParser &parser, QCoreApplication &app) {
   if (2 > parser.positionalArguments().size())
     parser.showHelp(-1);
 
+  // Several files are inspected concurrently, reporting one JSON object per file
+  QStringList files = expandFilePatterns(parser.positionalArguments().mid(1));
+  if (files.isEmpty()) {
+    logError() << "No input files given.";
+    return -1;
+  }
+  if ((1 < files.size()) || (files.first() != parser.positionalArguments().at(1)))
+    return processFiles(files, parser, parser.isSet("identify") ? identifyFile : inspectFile) ? 0 : -1;
+
   QString filename = parser.positionalArguments().at(1);
-  DFUFile file;
   ErrorStack err;
+
+  if (parser.isSet("identify")) {
+    QList<FileSignature::Match> matches;
+    if (! FileSignature::identify(filename, matches, err)) {
+      logError() << "Cannot identify file '" << filename << "': " << err.format();
+      return -1;
+    }
+    QTextStream out(stdout);
+    foreach (const FileSignature::Match &match, matches) {
+      out << RadioInfo::byID(match.radio).key() << " " << FileSignature::contentName(match.content)
+          << " (" << FileSignature::formatName(match.format) << ")\n";
+    }
+    return 0;
+  }
+
+  DFUFile file;
   if (! file.read(filename, err)) {
     logError() << "Cannot read codeplug file '" << filename
                << "': " << err.format();
@@ -24,6 +108,22 @@ int infoFile(QCommandLineParser &parser, QCoreApplication &app) {
   }
 
   QTextStream out(stdout);
-  file.dump(out);
+  if (parser.isSet("summary")) {
+    file.summarize(out);
+  } else if (parser.isSet("range")) {
+    QStringList range = parser.value("range").split(":");
+    bool okAddr = true, okSize = true;
+    uint32_t address = range.at(0).toUInt(&okAddr, 0), size = 0xffffffff-address;
+    if (range.size() > 1)
+      size = range.at(1).toUInt(&okSize, 0);
+    if ((! okAddr) || (! okSize) || (range.size() > 2)) {
+      logError() << "Invalid memory range '" << parser.value("range")
+                 << "', expected ADDR[:SIZE].";
+      return -1;
+    }
+    file.dump(out, address, size);
+  } else {
+    file.dump(out);
+  }
   return 0;
 }
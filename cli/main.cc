@@ -1,21 +1,15 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
+#include <QTextStream>
+#include <QEventLoop>
 #include <iostream>
 
 #include "logger.hh"
 #include "config.h"
-#include "detect.hh"
-#include "verify.hh"
 #include "radioinfo.hh"
-#include "readcodeplug.hh"
-#include "writecodeplug.hh"
-#include "writecallsigndb.hh"
-#include "encodecodeplug.hh"
-#include "encodecallsigndb.hh"
-#include "decodecodeplug.hh"
-#include "infofile.hh"
+#include "memoryusage.hh"
+#include "commandline.hh"
 
-#include "uv390_codeplug.hh"
 
 int main(int argc, char *argv[])
 {
@@ -32,98 +26,7 @@ int main(int argc, char *argv[])
   app.setApplicationVersion(VERSION_STRING);
 
   QCommandLineParser parser;
-  parser.setApplicationDescription(
-        QCoreApplication::translate(
-          "main", "Up- and download codeplugs for cheap Chinese DMR radios."));
-
-  parser.addHelpOption();
-  parser.addVersionOption();
-  parser.addOption({
-                     {"V","verbose"},
-                     QCoreApplication::translate("main", "Verbose output.")
-                   });
-  parser.addOption({
-                     {"c", "csv"},
-                     QCoreApplication::translate("main", "Up- and download codeplugs in CSV format.")
-                   });
-  parser.addOption({
-                     {"y", "yaml"},
-                     QCoreApplication::translate("main", "Up- and download codeplugs in extensible YAML format.")
-                   });
-  parser.addOption({
-                     {"b", "bin"},
-                     QCoreApplication::translate("main", "Up- and download codeplugs in binary format.")
-                   });
-  parser.addOption({
-                     {"m", "manufacturer"},
-                     QCoreApplication::translate("main", "Given file is manufacturer codeplug file. "
-                     " Can be used with 'decode'.")
-                   });
-  parser.addOption({
-                     {"D","device"},
-                     QCoreApplication::translate("main", "Specifies the device to use to talk to "
-                     "the radio. If not specified, the dmrconf will try to detect the radio "
-                     "automatically. Please note, that for some radios the device must be specified."),
-                     QCoreApplication::translate("main", "DEVICE")
-                   });
-  parser.addOption({
-                     {"R", "radio"},
-                     QCoreApplication::translate("main", "Specifies the radio. This option can also "
-                     "be used to override the auto-detection of radios. Be careful using this "
-                     "option when writing to the device. A incompatible code-plug might be written."),
-                     QCoreApplication::translate("main", "RADIO")
-                   });
-  parser.addOption({
-                     {"i", "id"},
-                     QCoreApplication::translate("main", "Specifies the DMR id."),
-                     QCoreApplication::translate("main", "ID")
-                   });
-  parser.addOption({
-                     {"n", "limit"},
-                     QCoreApplication::translate("main", "Limits several amonuts, depending on the "
-                     "context. When encoding/writing the callsign db, this option specifies the "
-                     "maximum number of callsigns to encode."),
-                     QCoreApplication::translate("main", "N")
-                   });
-  parser.addOption({
-                     {"B","database"},
-                     QCoreApplication::translate("main", "Specifies the user DB json file when "
-                     "writing the callsign db."),
-                     "FILENAME"
-                   });
-  parser.addOption(QCommandLineOption(
-                     "init-codeplug",
-                     QCoreApplication::translate(
-                       "main", "Initializes the code-plug in the radio. If not present (default) "
-                               "the code-plug gets updated, maintining all settings made earlier.")));
-  parser.addOption(QCommandLineOption(
-                     "auto-enable-gps",
-                     QCoreApplication::translate("main", "Automatically enables GPS if there is a "
-                                                         "GPS/APRS system used by any channel.")));
-  parser.addOption(QCommandLineOption(
-                     "auto-enable-roaming",
-                     QCoreApplication::translate("main", "Automatically enables roaming if there is a "
-                                                         "roaming zone used by any channel.")));
-  parser.addOption(QCommandLineOption(
-                     "ignore-limits",
-                     QCoreApplication::translate("main", "Disables some limit checks.")));
-  parser.addOption(QCommandLineOption(
-                     "list-radios",
-                     QCoreApplication::translate("main", "Lists all supported radios including the "
-                                                 "keys to be used with the --radio option.")));
-  parser.addPositionalArgument(
-        "command", QCoreApplication::translate(
-          "main", "Specifies the command to perform. Either detect, verify, read, write, "
-          "write-db, encode, encode-db, decode or info. Consult the man-page of dmrconf for a "
-          "detailed description of these commands."),
-        QCoreApplication::translate("main", "[command]"));
-
-  parser.addPositionalArgument(
-        "file", QCoreApplication::translate(
-          "main", "The code-plug file. Either binary (extension .dfu), text/csv (extension .conf "
-          "or .csv) or YAML format (extension .yaml). The format can be forced using the --csv, "
-          "--yaml or --binary options."),
-        QCoreApplication::translate("main", "[filename]"));
+  setupCommandLine(parser);
 
   parser.process(app);
 
@@ -165,33 +68,17 @@ int main(int argc, char *argv[])
   if (parser.isSet("verbose"))
     handler->setMinLevel(LogMessage::DEBUG);
 
-  int res = -1;
-  QString command = parser.positionalArguments().at(0);
-
-  if ("detect" == command)
-    res = detect(parser, app);
-  else if ("verify" == command)
-    res = verify(parser, app);
-  else if ("read" == command)
-    res = readCodeplug(parser, app);
-  else if ("write" == command)
-    res = writeCodeplug(parser, app);
-  else if ("write-db" == command)
-    res = writeCallsignDB(parser, app);
-  else if ("encode" == command)
-    res = encodeCodeplug(parser, app);
-  else if ("encode-db" == command)
-    res = encodeCallsignDB(parser, app);
-  else if ("decode" == command)
-    res = decodeCodeplug(parser, app);
-  else if ("info" == command)
-    res = infoFile(parser, app);
-  else
-    parser.showHelp(-1);
+  int res = runCommand(parser, app);
 
   // Allow some pending events to be processed (e.g., deleteLater())
   QEventLoop loop;
   while(loop.processEvents()) {}
 
+  if (parser.isSet("low-memory")) {
+    quint64 peak = MemoryUsage::peakResident();
+    out << "Peak memory usage: " << (peak ? MemoryUsage::formatBytes(peak) : QString("unknown")) << "\n";
+    out.flush();
+  }
+
   return res;
 }
@@ -0,0 +1,171 @@
+#include "mergeconfig.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
+
+#include "logger.hh"
+#include "config.hh"
+#include "configmergevisitor.hh"
+#include "multifile.hh"
+
+
+/** Reads a single fragment within the thread pool. The config is created within the pool thread,
+ * as the objects read are its children, and moved to the given thread once it is complete. */
+class FragmentReader: public QRunnable
+{
+public:
+  FragmentReader(const QString &filename, QThread *target, Config *&config, QString &error)
+    : QRunnable(), _filename(filename), _target(target), _config(config), _error(error)
+  {
+    // pass...
+  }
+
+  void run() {
+    ErrorStack err;
+    Config *config = new Config();
+    if (! config->readYAML(_filename, err)) {
+      _error = err.format();
+      delete config;
+      return;
+    }
+    config->moveToThread(_target);
+    _config = config;
+  }
+
+protected:
+  QString _filename;
+  QThread *_target;
+  Config *&_config;
+  QString &_error;
+};
+
+
+/** Parses the item strategy given by the @c --merge-items option. */
+static bool
+itemStrategy(const QCommandLineParser &parser, ConfigMergeVisitor::ItemStrategy &strategy) {
+  strategy = ConfigMergeVisitor::ItemStrategy::Ignore;
+  if (! parser.isSet("merge-items"))
+    return true;
+  QString value = parser.value("merge-items").toLower();
+  if ("ignore" == value)
+    strategy = ConfigMergeVisitor::ItemStrategy::Ignore;
+  else if ("override" == value)
+    strategy = ConfigMergeVisitor::ItemStrategy::Override;
+  else if ("duplicate" == value)
+    strategy = ConfigMergeVisitor::ItemStrategy::Duplicate;
+  else
+    return false;
+  return true;
+}
+
+/** Parses the set strategy given by the @c --merge-sets option. */
+static bool
+setStrategy(const QCommandLineParser &parser, ConfigMergeVisitor::SetStrategy &strategy) {
+  strategy = ConfigMergeVisitor::SetStrategy::Ignore;
+  if (! parser.isSet("merge-sets"))
+    return true;
+  QString value = parser.value("merge-sets").toLower();
+  if ("ignore" == value)
+    strategy = ConfigMergeVisitor::SetStrategy::Ignore;
+  else if ("override" == value)
+    strategy = ConfigMergeVisitor::SetStrategy::Override;
+  else if ("duplicate" == value)
+    strategy = ConfigMergeVisitor::SetStrategy::Duplicate;
+  else if ("merge" == value)
+    strategy = ConfigMergeVisitor::SetStrategy::Merge;
+  else
+    return false;
+  return true;
+}
+
+
+int
+mergeConfig(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app)
+
+  ConfigMergeVisitor::ItemStrategy items;
+  if (! itemStrategy(parser, items)) {
+    logError() << "Invalid item strategy '" << parser.value("merge-items")
+               << "': Expected 'ignore', 'override' or 'duplicate'.";
+    return -1;
+  }
+  ConfigMergeVisitor::SetStrategy sets;
+  if (! setStrategy(parser, sets)) {
+    logError() << "Invalid set strategy '" << parser.value("merge-sets")
+               << "': Expected 'ignore', 'override', 'duplicate' or 'merge'.";
+    return -1;
+  }
+
+  QStringList files = expandFilePatterns(parser.positionalArguments().mid(1));
+  if (2 > files.size())
+    parser.showHelp(-1);
+
+  QElapsedTimer timer; timer.start();
+
+  // Read base and fragments concurrently, the order of the list is kept.
+  QVector<Config *> configs(files.size(), nullptr);
+  QVector<QString> errors(files.size());
+  QThreadPool pool;
+  if (parser.isSet("jobs"))
+    pool.setMaxThreadCount(parser.value("jobs").toInt());
+  else if (parser.isSet("low-memory"))
+    pool.setMaxThreadCount(1);
+  for (int i=0; i<files.size(); i++)
+    pool.start(new FragmentReader(files.at(i), QThread::currentThread(), configs[i], errors[i]));
+  pool.waitForDone();
+
+  int res = 0;
+  for (int i=0; i<files.size(); i++) {
+    if (nullptr == configs[i]) {
+      logError() << "Cannot read '" << files.at(i) << "': " << errors[i];
+      res = -1;
+    }
+  }
+  logDebug() << "Read " << files.size() << " files in " << timer.elapsed() << "ms.";
+
+  Config *base = configs.first();
+  QList<Config *> fragments = configs.toList().mid(1);
+  ErrorStack err;
+  if ((0 == res) && (! ConfigMerge::mergeAllInto(base, fragments, items, sets, err))) {
+    logError() << "Cannot merge codeplugs: " << err.format();
+    res = -1;
+  }
+
+  if (0 == res) {
+    QFile file;
+    if (parser.isSet("output")) {
+      file.setFileName(parser.value("output"));
+      if (! file.open(QIODevice::WriteOnly)) {
+        logError() << "Cannot open file '" << parser.value("output") << "': "
+                   << file.errorString();
+        res = -1;
+      }
+    } else if (! file.open(stdout, QIODevice::WriteOnly)) {
+      logError() << "Cannot write to stdout: " << file.errorString();
+      res = -1;
+    }
+
+    if (0 == res) {
+      QTextStream stream(&file);
+      if (! base->toYAML(stream, err)) {
+        logError() << "Cannot serialize merged codeplug: " << err.format();
+        res = -1;
+      }
+      stream.flush();
+      file.close();
+    }
+  }
+
+  if (0 == res)
+    logInfo() << "Merged " << fragments.size() << " fragments into '" << files.first() << "' in "
+              << timer.elapsed() << "ms.";
+
+  qDeleteAll(configs);
+  return res;
+}
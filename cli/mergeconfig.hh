@@ -0,0 +1,11 @@
+#ifndef MERGECONFIG_HH
+#define MERGECONFIG_HH
+
+class QCommandLineParser;
+class QCoreApplication;
+
+/** Merges several YAML codeplug fragments into a base codeplug. The fragments are read
+ * concurrently but merged in the order given. */
+int mergeConfig(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // MERGECONFIG_HH
@@ -0,0 +1,63 @@
+#include "multidevice.hh"
+
+#include <QEventLoop>
+#include <QVector>
+
+#include "logger.hh"
+#include "radio.hh"
+#include "progressbar.hh"
+
+
+unsigned
+runOnRadios(const QList<Radio *> &radios, std::function<bool(Radio *, const ErrorStack &)> start,
+            bool stats)
+{
+  QEventLoop loop;
+  QVector<int> progress(radios.size(), 0);
+  QVector<ErrorStack> errors(radios.size());
+  QVector<bool> started(radios.size(), false);
+  int running = 0;
+
+  showProgress();
+  for (int i=0; i<radios.size(); i++) {
+    // Progress gets reported from the radio threads, hence the average over all radios is
+    // updated within the event loop.
+    QObject::connect(radios[i], &Radio::uploadProgress, &loop, [&progress, i](int percent) {
+      progress[i] = percent;
+      int sum = 0;
+      foreach (int p, progress)
+        sum += p;
+      updateProgress(sum/progress.size());
+    });
+    QObject::connect(radios[i], &QThread::finished, &loop, [&running, &loop]() {
+      if (0 == (--running))
+        loop.quit();
+    });
+  }
+
+  // Start all radios
+  for (int i=0; i<radios.size(); i++) {
+    logDebug() << "Start task on " << radios[i]->name() << " (#" << i+1 << ").";
+    if ((started[i] = start(radios[i], errors[i])))
+      running++;
+  }
+
+  if (running)
+    loop.exec();
+
+  // Report result per radio
+  unsigned failed = 0;
+  for (int i=0; i<radios.size(); i++) {
+    if ((! started[i]) || (Radio::StatusError == radios[i]->status())) {
+      logError() << radios[i]->name() << " (#" << i+1 << ") failed: " << errors[i].format();
+      failed++;
+    } else {
+      logInfo() << radios[i]->name() << " (#" << i+1 << ") completed.";
+    }
+    if (stats)
+      logInfo() << "Transfer statistics of " << radios[i]->name() << " (#" << i+1 << "):\n"
+                << radios[i]->transferStatistics().format();
+  }
+
+  return failed;
+}
@@ -0,0 +1,18 @@
+#ifndef MULTIDEVICE_HH
+#define MULTIDEVICE_HH
+
+#include <QList>
+#include <functional>
+#include "errorstack.hh"
+
+class Radio;
+
+/** Starts a task on all given radios concurrently using @c start and waits for all of them to
+ * finish. The progress is shown aggregated over all radios, the result is reported per radio.
+ * If @c stats is @c true, the transfer statistics are reported for every radio too.
+ * @returns The number of radios that failed. */
+unsigned runOnRadios(const QList<Radio *> &radios,
+                     std::function<bool(Radio *radio, const ErrorStack &err)> start,
+                     bool stats=false);
+
+#endif // MULTIDEVICE_HH
@@ -0,0 +1,109 @@
+#include "multifile.hh"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "logger.hh"
+
+
+/** Shared output of all file jobs. Lines are written one at a time. */
+struct FileOutput
+{
+  QFile stream;           ///< The output stream, i.e., stdout.
+  QMutex lock;            ///< Serializes the lines written.
+  QAtomicInt failed;      ///< Number of failed jobs.
+};
+
+
+/** Processes a single file within the thread pool. */
+class FileRunner: public QRunnable
+{
+public:
+  FileRunner(const QString &filename, const FileProcessor &processor, FileOutput &output)
+    : QRunnable(), _filename(filename), _processor(processor), _output(output)
+  {
+    // pass...
+  }
+
+  void run() {
+    QElapsedTimer timer; timer.start();
+    ErrorStack err;
+    QJsonObject result;
+    result.insert("input", _filename);
+    bool success = _processor(_filename, result, err);
+    result.insert("success", success);
+    if (! success) {
+      result.insert("error", err.format());
+      _output.failed.ref();
+    }
+    result.insert("duration", timer.elapsed());
+
+    QByteArray line = QJsonDocument(result).toJson(QJsonDocument::Compact) + "\n";
+    QMutexLocker locker(&_output.lock);
+    _output.stream.write(line);
+    _output.stream.flush();
+  }
+
+protected:
+  QString _filename;
+  const FileProcessor &_processor;
+  FileOutput &_output;
+};
+
+
+QStringList
+expandFilePatterns(const QStringList &patterns) {
+  QStringList files;
+  foreach (QString pattern, patterns) {
+    QFileInfo info(pattern);
+    if (! info.fileName().contains(QRegExp("[*?\\[]"))) {
+      files.append(pattern);
+      continue;
+    }
+    QDir dir = info.dir();
+    QStringList matches = dir.entryList(QStringList() << info.fileName(), QDir::Files, QDir::Name);
+    if (matches.isEmpty())
+      logWarn() << "No files match '" << pattern << "'.";
+    foreach (QString match, matches)
+      files.append(dir.filePath(match));
+  }
+  return files;
+}
+
+
+bool
+processFiles(const QStringList &files, const QCommandLineParser &parser,
+             const FileProcessor &processor)
+{
+  FileOutput output;
+  if (! output.stream.open(stdout, QIODevice::WriteOnly)) {
+    logError() << "Cannot write results to stdout: " << output.stream.errorString();
+    return false;
+  }
+
+  QThreadPool pool;
+  if (parser.isSet("jobs"))
+    pool.setMaxThreadCount(parser.value("jobs").toInt());
+  else if (parser.isSet("low-memory"))
+    pool.setMaxThreadCount(1);
+  else
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+  logDebug() << "Process " << files.size() << " files using up to "
+             << pool.maxThreadCount() << " threads.";
+
+  foreach (QString filename, files)
+    pool.start(new FileRunner(filename, processor, output));
+  pool.waitForDone();
+
+  return 0 == output.failed.loadAcquire();
+}
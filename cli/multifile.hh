@@ -0,0 +1,26 @@
+#ifndef MULTIFILE_HH
+#define MULTIFILE_HH
+
+#include <functional>
+#include <QStringList>
+#include "errorstack.hh"
+
+class QCommandLineParser;
+class QJsonObject;
+
+/** Expands all glob patterns (containing '*', '?' or '[') within the given file names. Files
+ * without pattern are passed unchanged. The matches of a pattern are sorted by name. */
+QStringList expandFilePatterns(const QStringList &patterns);
+
+/** Processes a single input file. The result is stored in the given JSON object. */
+typedef std::function<bool(const QString &, QJsonObject &, const ErrorStack &)> FileProcessor;
+
+/** Processes all given files concurrently and writes the result of every file as a single-line
+ * JSON object to stdout, as soon as the file is done. The number of concurrent jobs is taken from
+ * the @c --jobs option. Results are not kept, hence the memory needed is bounded by the number of
+ * concurrent jobs.
+ * @returns @c true, if all files were processed successfully. */
+bool processFiles(const QStringList &files, const QCommandLineParser &parser,
+                  const FileProcessor &processor);
+
+#endif // MULTIFILE_HH
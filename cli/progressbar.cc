@@ -1,5 +1,13 @@
 #include "progressbar.hh"
 
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "radio.hh"
+#include "logger.hh"
+
+
 void showProgress(unsigned percent) {
   std::cerr << "[";
   for (unsigned i=0; i<50; i++) {
@@ -15,3 +23,119 @@ void updateProgress(unsigned percent) {
   std::cerr << "\033[1A\033[K";
   showProgress(percent);
 }
+
+
+/* ********************************************************************************************* *
+ * Implementation of TransferProgress
+ * ********************************************************************************************* */
+TransferProgress::TransferProgress(const QCommandLineParser &parser)
+  : _json("json" == parser.value("progress")), _radio(nullptr), _phase("connect"), _total(0),
+    _offset(0), _percent(-1), _timer(), _durations(), _history(parser.value("history")),
+    _recorder()
+{
+  _timer.start();
+  _recorder.start(parser.positionalArguments().value(0));
+  if (_json)
+    write(QJsonObject{{"event", "phase"}, {"phase", _phase}});
+}
+
+void
+TransferProgress::attach(Radio *radio) {
+  _radio = radio;
+  _offset = bytesTransferred();
+  _recorder.attach(radio);
+
+  if (! _json) {
+    showProgress();
+    QObject::connect(radio, &Radio::downloadProgress, updateProgress);
+    QObject::connect(radio, &Radio::uploadProgress, updateProgress);
+    return;
+  }
+
+  QObject::connect(radio, &Radio::downloadProgress, [this](int percent) { progress(percent); });
+  QObject::connect(radio, &Radio::uploadProgress, [this](int percent) { progress(percent); });
+  QObject::connect(radio, &Radio::phaseChanged, [this](Radio::Phase phase, quint64 bytes) {
+    switch (phase) {
+    case Radio::PhaseRead: enterPhase("read", bytes); break;
+    case Radio::PhaseEncode: enterPhase("encode", bytes); break;
+    case Radio::PhaseWrite: enterPhase("write", bytes); break;
+    case Radio::PhaseVerify: enterPhase("verify", bytes); break;
+    }
+  });
+}
+
+void
+TransferProgress::finish(bool success) {
+  // Only transfers with a detected radio are recorded
+  PerformanceHistory::Record record = _recorder.finish(success);
+  if (_radio) {
+    ErrorStack err;
+    if (! PerformanceHistory(_history).append(record, err))
+      logWarn() << "Cannot record transfer: " << err.format();
+  }
+
+  if (! _json)
+    return;
+
+  _durations.append(QPair<QString, qint64>(_phase, _timer.elapsed()));
+  QJsonObject phases;
+  qint64 duration = 0;
+  for (const QPair<QString, qint64> &d: _durations) {
+    // A phase may be entered several times (e.g., writing a codeplug in several segments)
+    phases[d.first] = phases[d.first].toDouble() + double(d.second)/1000;
+    duration += d.second;
+  }
+
+  QJsonObject obj{{"event", "finished"}, {"success", success}, {"phases", phases},
+                  {"duration", double(duration)/1000}};
+  if (_radio) {
+    TransferStatistics stats = _radio->transferStatistics();
+    obj["bytesRead"] = double(stats.bytesRead());
+    obj["bytesWritten"] = double(stats.bytesWritten());
+    if (! stats.linkMode().isEmpty())
+      obj["linkMode"] = stats.linkMode();
+  }
+  write(obj);
+}
+
+void
+TransferProgress::enterPhase(const QString &name, quint64 total) {
+  _durations.append(QPair<QString, qint64>(_phase, _timer.restart()));
+  _phase = name;
+  _total = total;
+  _offset = bytesTransferred();
+  _percent = -1;
+
+  QJsonObject obj{{"event", "phase"}, {"phase", _phase}};
+  if (_total)
+    obj["total"] = double(_total);
+  write(obj);
+}
+
+void
+TransferProgress::progress(int percent) {
+  // The radio throttles the progress signals, but a percentage may get signaled again
+  if (percent == _percent)
+    return;
+  _percent = percent;
+
+  QJsonObject obj{{"event", "progress"}, {"phase", _phase}, {"percent", percent},
+                  {"bytes", double(bytesTransferred()-_offset)}};
+  if (_total)
+    obj["total"] = double(_total);
+  if (_radio)
+    obj["address"] = double(_radio->transferStatistics().address());
+  write(obj);
+}
+
+quint64
+TransferProgress::bytesTransferred() const {
+  if (nullptr == _radio)
+    return 0;
+  return _radio->bytesTransferred();
+}
+
+void
+TransferProgress::write(const QJsonObject &obj) {
+  std::cerr << QJsonDocument(obj).toJson(QJsonDocument::Compact).constData() << std::endl;
+}
@@ -2,8 +2,70 @@
 #define PROGRESSBAR_HH
 
 #include <iostream>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+#include <QPair>
+#include "performancehistory.hh"
+
+class Radio;
+class QCommandLineParser;
+class QJsonObject;
 
 void showProgress(unsigned percent=0);
 void updateProgress(unsigned percent);
 
+/** Reports the progress of a transfer from or to a single radio on stderr.
+ *
+ * By default, the usual progress bar is shown. If @c --progress=json is given, one compact JSON
+ * object per line is written instead. These objects report the current phase of the transfer,
+ * the bytes transferred within this phase, the current address as well as the wall time spent
+ * in every phase. The reporter gets created before the radio gets detected, hence the initial
+ * @c connect phase covers the detection of the radio and entering the program mode. */
+class TransferProgress
+{
+public:
+  /** Constructs a new reporter using the format selected by the @c --progress option. */
+  explicit TransferProgress(const QCommandLineParser &parser);
+
+  /** Connects to the progress signals of the given radio. The radio must be used in blocking
+   * mode, as the transfer statistics are read from within the signal handlers. */
+  void attach(Radio *radio);
+  /** Finishes the current phase and reports the result together with the time spent in every
+   * phase. Also records the transfer in the performance history. */
+  void finish(bool success);
+
+protected:
+  /** Starts a new phase. */
+  void enterPhase(const QString &name, quint64 total);
+  /** Handles the progress signals. */
+  void progress(int percent);
+  /** Returns the number of bytes transferred by the radio in total. */
+  quint64 bytesTransferred() const;
+  /** Writes a single JSON line. */
+  static void write(const QJsonObject &obj);
+
+protected:
+  /** If @c true, JSON lines get written instead of a progress bar. */
+  bool _json;
+  /** The radio, the transfer is reported for. */
+  Radio *_radio;
+  /** Name of the current phase. */
+  QString _phase;
+  /** Bytes expected within the current phase, 0 if unknown. */
+  quint64 _total;
+  /** Bytes transferred before the current phase started. */
+  quint64 _offset;
+  /** The last reported percentage. */
+  int _percent;
+  /** Measures the current phase. */
+  QElapsedTimer _timer;
+  /** Duration of all finished phases in milliseconds. */
+  QVector<QPair<QString, qint64>> _durations;
+  /** The performance history file, empty for the default location. */
+  QString _history;
+  /** Records the transfer for the performance history. */
+  PerformanceHistory::Recorder _recorder;
+};
+
 #endif // PROGRESSBAR_HH
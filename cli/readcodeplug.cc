@@ -10,6 +10,7 @@
 #include "radio.hh"
 #include "printprogress.hh"
 #include "config.hh"
+#include "configsnapshot.hh"
 #include "codeplug.hh"
 #include "progressbar.hh"
 #include "autodetect.hh"
@@ -23,27 +24,33 @@ int readCodeplug(QCommandLineParser &parser, QCoreApplication &app)
     parser.showHelp(-1);
 
   ErrorStack err;
+  TransferProgress progress(parser);
   Radio *radio = autoDetect(parser, app, err);
   if (nullptr == radio) {
+    progress.finish(false);
     logError() << "Cannot detect radio: " << err.format();
     return -1;
   }
 
   QString filename = parser.positionalArguments().at(1);
 
-  showProgress();
-  QObject::connect(radio, &Radio::downloadProgress, updateProgress);
+  progress.attach(radio);
+
+  // Sections were validated already
+  Codeplug::Sections sections;
+  if (parser.isSet("only"))
+    Codeplug::Sections::parse(parser.value("only"), sections);
 
   Config config;
-  if (! radio->startDownload(true, err)) {
+  if ((! radio->startDownload(sections, true, err)) || (Radio::StatusError == radio->status())) {
+    progress.finish(false);
     logError() << "Codeplug download error: " << err.format();
     return -1;
   }
+  progress.finish(true);
 
-  if (Radio::StatusError == radio->status()) {
-    logError() << "Codeplug download error: " << err.format();
-    return -1;
-  }
+  if (parser.isSet("stats"))
+    logInfo() << "Transfer statistics:\n" << radio->transferStatistics().format();
 
   logDebug() << "Save codeplug at '" << filename << "'.";
   // If output is CSV -> decode code-plug
@@ -53,6 +60,8 @@ int readCodeplug(QCommandLineParser &parser, QCoreApplication &app)
     return -1;
   } else if (parser.isSet("yaml") || filename.endsWith(".yaml")) {
     // decode codeplug
+    if (parser.isSet("decode-threads"))
+      radio->codeplug().setDecodeThreads(parser.value("decode-threads").toUInt());
     if (! radio->codeplug().decode(&config, err)) {
       logError() << "Cannot decode codeplug: " << err.format();
       return -1;
@@ -77,6 +86,23 @@ int readCodeplug(QCommandLineParser &parser, QCoreApplication &app)
     }
     stream.flush();
     file.close();
+  } else if (parser.isSet("snapshot") || filename.endsWith(".snap")) {
+    // decode codeplug
+    if (parser.isSet("decode-threads"))
+      radio->codeplug().setDecodeThreads(parser.value("decode-threads").toUInt());
+    if (! radio->codeplug().decode(&config, err)) {
+      logError() << "Cannot decode codeplug: " << err.format();
+      return -1;
+    }
+    // post-process decoded codeplug
+    if (! radio->codeplug().postprocess(&config, err)) {
+      logError() << "Cannot post-process codeplug: " << err.format();
+      return -1;
+    }
+    if (! ConfigSnapshot::write(&config, filename, err)) {
+      logError() << "Cannot write config snapshot: " << err.format();
+      return -1;
+    }
   } else if (parser.isSet("bin") || filename.endsWith(".bin") || filename.endsWith(".dfu")) {
     // otherwise write binary code-plug
     if (! radio->codeplug().write(filename, err)) {
@@ -85,9 +111,16 @@ int readCodeplug(QCommandLineParser &parser, QCoreApplication &app)
     }
   } else {
     logError() << "Cannot determine file output type from '" << filename << "'. "
-               << "Consider using --csv, --yaml or --bin.";
+               << "Consider using --csv, --yaml, --snapshot or --bin.";
     return -1;
   }
 
+  if (parser.isSet("stats")) {
+    MemoryUsage usage("Total");
+    usage.add(radio->codeplug().memoryUsage("Codeplug"));
+    usage.add(config.memoryUsage());
+    logInfo() << "Memory usage:\n" << usage.format();
+  }
+
   return 0;
 }
@@ -0,0 +1,49 @@
+#include "resume.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include "logger.hh"
+#include "radio.hh"
+#include "progressbar.hh"
+#include "autodetect.hh"
+
+
+int resumeUpload(QCommandLineParser &parser, QCoreApplication &app) {
+  ErrorStack err;
+  TransferProgress progress(parser);
+  Radio *radio = autoDetect(parser, app, err);
+  if (nullptr == radio) {
+    progress.finish(false);
+    logError() << "Cannot detect radio:" << err.format();
+    return -1;
+  }
+
+  // The cache ID is also used to identify the checkpoint of the radio
+  if (parser.isSet("cache-id"))
+    radio->setImageCache(parser.value("cache-id"));
+
+  if (! radio->hasCheckpoint()) {
+    progress.finish(false);
+    logError() << "There is no failed upload to " << radio->name() << " to resume.";
+    return -1;
+  }
+
+  progress.attach(radio);
+
+  logDebug() << "Resume upload to " << radio->name() << ".";
+  if ((! radio->startResume(true, err)) || (Radio::StatusError == radio->status())) {
+    progress.finish(false);
+    logError() << "Cannot resume upload: " << err.format();
+    if (radio->hasCheckpoint())
+      logInfo() << "Run 'dmrconf resume' again to continue the upload.";
+    return -1;
+  }
+  progress.finish(true);
+
+  if (parser.isSet("stats"))
+    logInfo() << "Transfer statistics:\n" << radio->transferStatistics().format();
+
+  logDebug() << "Upload completed.";
+  return 0;
+}
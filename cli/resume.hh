@@ -0,0 +1,9 @@
+#ifndef RESUME_HH
+#define RESUME_HH
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int resumeUpload(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // RESUME_HH
@@ -0,0 +1,115 @@
+#include "routeconfig.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+
+#include "logger.hh"
+#include "config.hh"
+#include "configbuilder.hh"
+#include "repeaterselection.hh"
+
+/** Default number of repeaters per waypoint. */
+#define DEFAULT_NEAREST 8
+
+
+/** Parses the mode given by the @c --mode option. */
+static bool
+selectionMode(const QCommandLineParser &parser, RepeaterSelection::Mode &mode) {
+  mode = RepeaterSelection::Mode::DMR;
+  if (! parser.isSet("mode"))
+    return true;
+  QString value = parser.value("mode").toLower();
+  if ("dmr" == value)
+    mode = RepeaterSelection::Mode::DMR;
+  else if ("fm" == value)
+    mode = RepeaterSelection::Mode::FM;
+  else if ("both" == value)
+    mode = RepeaterSelection::Mode::Both;
+  else
+    return false;
+  return true;
+}
+
+
+int
+routeConfig(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app)
+
+  QStringList args = parser.positionalArguments();
+  if ((3 > args.size()) || (4 < args.size()))
+    parser.showHelp(-1);
+
+  RepeaterSelection::Mode mode;
+  if (! selectionMode(parser, mode)) {
+    logError() << "Invalid mode '" << parser.value("mode") << "': Expected 'dmr', 'fm' or 'both'.";
+    return -1;
+  }
+
+  int nearest = DEFAULT_NEAREST;
+  if (parser.isSet("nearest")) {
+    bool ok;
+    nearest = parser.value("nearest").toInt(&ok);
+    if ((! ok) || (0 >= nearest)) {
+      logError() << "Invalid number of repeaters '" << parser.value("nearest") << "'.";
+      return -1;
+    }
+  }
+
+  QElapsedTimer timer; timer.start();
+
+  ErrorStack err;
+  RepeaterSelection selection;
+  if (! selection.readRepeaterBook(args.at(1), err)) {
+    logError() << err.format();
+    return -1;
+  }
+  QList<RepeaterSelection::Waypoint> waypoints;
+  if (! RepeaterSelection::readWaypoints(args.at(2), waypoints, err)) {
+    logError() << err.format();
+    return -1;
+  }
+
+  Config config;
+  if ((4 == args.size()) && (! config.readYAML(args.at(3), err))) {
+    logError() << "Cannot read base codeplug '" << args.at(3) << "': " << err.format();
+    return -1;
+  }
+
+  int channels = 0;
+  {
+    ConfigBuilder builder(&config);
+    channels = selection.build(builder, waypoints, nearest, mode);
+    if (nullptr == builder.finish(nullptr, err)) {
+      logError() << "Cannot assemble codeplug: " << err.format();
+      return -1;
+    }
+  }
+
+  QFile file;
+  if (parser.isSet("output")) {
+    file.setFileName(parser.value("output"));
+    if (! file.open(QIODevice::WriteOnly)) {
+      logError() << "Cannot open file '" << parser.value("output") << "': " << file.errorString();
+      return -1;
+    }
+  } else if (! file.open(stdout, QIODevice::WriteOnly)) {
+    logError() << "Cannot write to stdout: " << file.errorString();
+    return -1;
+  }
+
+  QTextStream stream(&file);
+  if (! config.toYAML(stream, err)) {
+    logError() << "Cannot serialize codeplug: " << err.format();
+    return -1;
+  }
+  stream.flush();
+  file.close();
+
+  logInfo() << "Selected " << channels << " channels from " << selection.count()
+            << " repeaters for " << waypoints.size() << " waypoints in " << timer.elapsed() << "ms.";
+
+  return 0;
+}
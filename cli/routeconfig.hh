@@ -0,0 +1,11 @@
+#ifndef ROUTECONFIG_HH
+#define ROUTECONFIG_HH
+
+class QCommandLineParser;
+class QCoreApplication;
+
+/** Assembles channels and zones from the repeaters nearest to a list of waypoints. The result
+ * is appended to an optional base codeplug and written as YAML. */
+int routeConfig(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // ROUTECONFIG_HH
@@ -0,0 +1,293 @@
+#include "selftest.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+
+#include "logger.hh"
+#include "config.hh"
+#include "configsnapshot.hh"
+#include "syntheticconfig.hh"
+#include "multifile.hh"
+#include "radioinfo.hh"
+#include "codeplug.hh"
+#include "rd5r_codeplug.hh"
+#include "gd73_codeplug.hh"
+#include "gd77_codeplug.hh"
+#include "opengd77_codeplug.hh"
+#include "openrtx_codeplug.hh"
+#include "md390_codeplug.hh"
+#include "uv390_codeplug.hh"
+#include "md2017_codeplug.hh"
+#include "dm1701_codeplug.hh"
+#include "d868uv_codeplug.hh"
+#include "d878uv_codeplug.hh"
+#include "d878uv2_codeplug.hh"
+#include "d578uv_codeplug.hh"
+#include "dmr6x2uv_codeplug.hh"
+#include "dr1801uv_codeplug.hh"
+
+
+/** Radios the corpus gets encoded for with --all-radios. */
+static const QList<RadioInfo::Radio> selfTestRadios = {
+  RadioInfo::OpenGD77, RadioInfo::OpenRTX, RadioInfo::RD5R, RadioInfo::GD73, RadioInfo::GD77,
+  RadioInfo::MD390, RadioInfo::UV390, RadioInfo::MD2017, RadioInfo::D868UVE, RadioInfo::DMR6X2UV,
+  RadioInfo::D878UV, RadioInfo::D878UVII, RadioInfo::D578UV, RadioInfo::DM1701, RadioInfo::DR1801UV
+};
+
+/** Creates an empty codeplug for the given radio. Returns @c nullptr, if the radio is not
+ * supported. */
+static Codeplug *
+createCodeplug(RadioInfo::Radio id) {
+  switch (id) {
+  case RadioInfo::OpenGD77: return new OpenGD77Codeplug();
+  case RadioInfo::OpenRTX: return new OpenRTXCodeplug();
+  case RadioInfo::RD5R: return new RD5RCodeplug();
+  case RadioInfo::GD73: return new GD73Codeplug();
+  case RadioInfo::GD77: return new GD77Codeplug();
+  case RadioInfo::MD390: return new MD390Codeplug();
+  case RadioInfo::UV390: return new UV390Codeplug();
+  case RadioInfo::MD2017: return new MD2017Codeplug();
+  case RadioInfo::D868UVE: return new D868UVCodeplug();
+  case RadioInfo::DMR6X2UV: return new DMR6X2UVCodeplug();
+  case RadioInfo::D878UV: return new D878UVCodeplug();
+  case RadioInfo::D878UVII: return new D878UV2Codeplug();
+  case RadioInfo::D578UV: return new D578UVCodeplug();
+  case RadioInfo::DM1701: return new DM1701Codeplug();
+  case RadioInfo::DR1801UV: return new DR1801UVCodeplug();
+  default: break;
+  }
+  return nullptr;
+}
+
+
+/** A config of the corpus. */
+struct SelfTestConfig
+{
+  QString name;           ///< The file name or the name of the generated config.
+  Config *config;         ///< The config, frozen as it is shared by all jobs.
+};
+
+/** Shared output of all jobs. Lines are written one at a time. */
+struct SelfTestOutput
+{
+  QFile stream;           ///< The output stream, i.e., stdout.
+  QMutex lock;            ///< Serializes the lines written.
+  QAtomicInt failed;      ///< Number of failed jobs.
+};
+
+
+/** Returns the total number of objects of the given config. */
+static int
+countObjects(const Config *config) {
+  return config->radioIDs()->count() + config->contacts()->count()
+      + config->rxGroupLists()->count() + config->channelList()->count()
+      + config->zones()->count() + config->scanlists()->count()
+      + config->posSystems()->count() + config->roamingChannels()->count()
+      + config->roamingZones()->count();
+}
+
+/** Compares the decoded config with the encoded one. Objects dropped by the codeplug, e.g.,
+ * due to the limits of the radio, are counted as lost. Channels and contacts kept, but decoded
+ * with a different frequency or number, are counted as mismatched. */
+static void
+compareConfigs(const Config *encoded, const Config *decoded, QJsonObject &result) {
+  int lost = std::max(0, countObjects(encoded) - countObjects(decoded));
+
+  int mismatched = 0;
+  int channels = std::min(encoded->channelList()->count(), decoded->channelList()->count());
+  for (int i=0; i<channels; i++) {
+    Channel *a = encoded->channelList()->channel(i), *b = decoded->channelList()->channel(i);
+    if ((a->rxFrequency() != b->rxFrequency()) || (a->txFrequency() != b->txFrequency()))
+      mismatched++;
+  }
+  // Contacts may get reordered, only those kept by the codeplug are searched for.
+  int contacts = std::min(encoded->contacts()->digitalCount(), decoded->contacts()->digitalCount());
+  for (int i=0; i<contacts; i++) {
+    if (nullptr == decoded->contacts()->findDigitalContact(encoded->contacts()->digitalContact(i)->number()))
+      mismatched++;
+  }
+
+  result.insert("lost", lost);
+  result.insert("mismatched", mismatched);
+}
+
+
+/** Encodes and decodes a single config for a single radio within the thread pool. */
+class SelfTestRunner: public QRunnable
+{
+public:
+  SelfTestRunner(const SelfTestConfig &config, const RadioInfo &radio, SelfTestOutput &output)
+    : QRunnable(), _config(config), _radio(radio), _output(output)
+  {
+    // pass...
+  }
+
+  void run() {
+    QJsonObject result;
+    result.insert("config", _config.name);
+    result.insert("radio", _radio.key());
+    ErrorStack err;
+    bool success = roundTrip(result, err);
+    if (success && (0 != result.value("mismatched").toInt())) {
+      errMsg(err) << "Decoded codeplug does not match the encoded config.";
+      success = false;
+    }
+    result.insert("success", success);
+    if (! success) {
+      result.insert("error", err.format(" "));
+      _output.failed.ref();
+    }
+
+    QByteArray line = QJsonDocument(result).toJson(QJsonDocument::Compact) + "\n";
+    QMutexLocker locker(&_output.lock);
+    _output.stream.write(line);
+    _output.stream.flush();
+  }
+
+protected:
+  bool roundTrip(QJsonObject &result, const ErrorStack &err) {
+    Codeplug *codeplug = createCodeplug(_radio.id());
+    if (nullptr == codeplug) {
+      errMsg(err) << "Cannot create codeplug for " << _radio.name() << ".";
+      return false;
+    }
+
+    Codeplug::Flags flags; flags.updateCodePlug = false;
+    QElapsedTimer timer; timer.start();
+    Config *encoded = codeplug->preprocess(_config.config, err);
+    if ((nullptr == encoded) || (! codeplug->encode(encoded, flags, err))) {
+      errMsg(err) << "Cannot encode '" << _config.name << "' for " << _radio.name() << ".";
+      if (encoded)
+        delete encoded;
+      delete codeplug;
+      return false;
+    }
+    qint64 encodeTime = timer.nsecsElapsed();
+
+    timer.start();
+    Config decoded;
+    if ((! codeplug->decode(&decoded, err)) || (! codeplug->postprocess(&decoded, err))) {
+      errMsg(err) << "Cannot decode '" << _config.name << "' for " << _radio.name() << ".";
+      delete encoded;
+      delete codeplug;
+      return false;
+    }
+    qint64 decodeTime = timer.nsecsElapsed();
+
+    int objects = countObjects(encoded);
+    double seconds = std::max(double(encodeTime + decodeTime)/1e9, 1e-9);
+    result.insert("objects", objects);
+    result.insert("bytes", qint64(codeplug->memSize()));
+    result.insert("encode_ms", double(encodeTime)/1e6);
+    result.insert("decode_ms", double(decodeTime)/1e6);
+    result.insert("objects_per_s", objects/seconds);
+    result.insert("mb_per_s", double(codeplug->memSize())/seconds/1e6);
+    compareConfigs(encoded, &decoded, result);
+
+    delete encoded;
+    delete codeplug;
+    return true;
+  }
+
+protected:
+  SelfTestConfig _config;
+  RadioInfo _radio;
+  SelfTestOutput &_output;
+};
+
+
+/** Reads a config of the corpus. */
+static Config *
+readConfig(const QString &filename, const QCommandLineParser &parser, const ErrorStack &err) {
+  Config *config = new Config();
+  if (parser.isSet("snapshot") || filename.endsWith(".snap")) {
+    if (ConfigSnapshot::read(config, filename, err))
+      return config;
+  } else if (parser.isSet("yaml") || filename.endsWith(".yaml") || filename.endsWith(".yml")) {
+    if (config->readYAML(filename, err))
+      return config;
+  } else {
+    errMsg(err) << "Cannot determine file type, consider using --yaml or --snapshot.";
+  }
+  delete config;
+  return nullptr;
+}
+
+
+int
+selfTest(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app);
+
+  // Collect radios
+  QList<RadioInfo> radios;
+  if (parser.isSet("all-radios")) {
+    foreach (RadioInfo::Radio id, selfTestRadios)
+      radios.append(RadioInfo::byID(id));
+  } else if (parser.isSet("radio")) {
+    foreach (QString key, parser.value("radio").toLower().split(",", Qt::SkipEmptyParts)) {
+      key = key.trimmed();
+      if ((! RadioInfo::hasRadioKey(key)) || (! selfTestRadios.contains(RadioInfo::byKey(key).id()))) {
+        logError() << "Cannot test unknown radio '" << key << "'.";
+        return -1;
+      }
+      radios.append(RadioInfo::byKey(key));
+    }
+  } else {
+    logError() << "Specify the radios to test using the --radio or --all-radios options.";
+    return -1;
+  }
+
+  // Assemble the corpus from the given files and some generated configs
+  QList<SelfTestConfig> corpus;
+  foreach (QString filename, expandFilePatterns(parser.positionalArguments().mid(1))) {
+    ErrorStack err;
+    Config *config = readConfig(filename, parser, err);
+    if (nullptr == config) {
+      logError() << "Cannot read '" << filename << "': " << err.format();
+      foreach (const SelfTestConfig &entry, corpus)
+        delete entry.config;
+      return -1;
+    }
+    corpus.append({QFileInfo(filename).fileName(), config});
+  }
+  corpus.append({"generated:small", createSyntheticConfig({64, 64, 4, 4, 2, 2})});
+  corpus.append({"generated:large", createSyntheticConfig({1000, 1000, 50, 50, 10, 10})});
+
+  // The configs are only read by the jobs
+  foreach (const SelfTestConfig &entry, corpus)
+    entry.config->freeze();
+
+  SelfTestOutput output;
+  output.stream.open(stdout, QIODevice::WriteOnly);
+
+  QElapsedTimer timer; timer.start();
+  QThreadPool pool;
+  if (parser.isSet("jobs"))
+    pool.setMaxThreadCount(parser.value("jobs").toInt());
+  foreach (const SelfTestConfig &entry, corpus) {
+    foreach (const RadioInfo &radio, radios)
+      pool.start(new SelfTestRunner(entry, radio, output));
+  }
+  pool.waitForDone();
+
+  int jobs = corpus.size()*radios.size(), failed = output.failed.loadAcquire();
+  logInfo() << "Tested " << corpus.size() << " configs with " << radios.size() << " radios in "
+            << timer.elapsed() << "ms: " << (jobs-failed) << " passed, " << failed << " failed.";
+
+  foreach (const SelfTestConfig &entry, corpus) {
+    entry.config->thaw();
+    delete entry.config;
+  }
+
+  return (failed ? -1 : 0);
+}
@@ -0,0 +1,12 @@
+#ifndef SELFTEST_HH
+#define SELFTEST_HH
+
+class QCommandLineParser;
+class QCoreApplication;
+
+/** Encodes and decodes a corpus of configs for the selected radios concurrently and reports the
+ * round-trip time, the throughput and any loss of fidelity. The corpus consists of the given
+ * YAML or snapshot files and some generated configs. */
+int selfTest(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // SELFTEST_HH
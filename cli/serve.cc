@@ -0,0 +1,216 @@
+#include "serve.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QEventLoop>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QHash>
+#include <QSet>
+
+#include "logger.hh"
+#include "timingpolicy.hh"
+#include "commandline.hh"
+
+/** Default name of the local socket. */
+#define SERVICE_SOCKET_NAME "dmrconf"
+
+/** JSON-RPC error codes. */
+#define RPC_PARSE_ERROR       -32700
+#define RPC_INVALID_REQUEST   -32600
+#define RPC_METHOD_NOT_FOUND  -32601
+#define RPC_INVALID_PARAMS    -32602
+
+
+/** Minimum number of positional arguments (including the command itself) of the commands
+ * available through the service. The commands show the help and exit otherwise. */
+static const QHash<QString, int> serviceCommands = {
+  {"detect", 1}, {"verify", 2}, {"read", 2}, {"write", 2}, {"write-db", 1}, {"resume", 1},
+  {"encode", 3}, {"encode-db", 2}, {"decode", 2}, {"batch", 2}, {"info", 2}, {"diff", 3},
+  {"patch", 3}
+};
+
+/** Commands, that exit if no radio is specified. */
+static const QSet<QString> radioCommands = {
+  "encode", "encode-db"
+};
+
+
+/** Collects the log messages emitted while processing a single request. */
+class CaptureLogHandler: public LogHandler
+{
+public:
+  explicit CaptureLogHandler(LogMessage::Level minLevel)
+    : LogHandler(), _minLevel(minLevel), _messages()
+  {
+    // pass...
+  }
+
+  LogMessage::Level minLevel() const {
+    return _minLevel;
+  }
+
+  void handle(const LogMessage &message) {
+    static const char *levels[] = {"debug", "info", "warning", "error", "fatal"};
+    if (message.level() < _minLevel)
+      return;
+    QJsonObject obj;
+    obj.insert("level", levels[message.level()]);
+    obj.insert("message", message.message());
+    _messages.append(obj);
+  }
+
+  const QJsonArray &messages() const {
+    return _messages;
+  }
+
+protected:
+  LogMessage::Level _minLevel;
+  QJsonArray _messages;
+};
+
+
+/** Assembles a JSON-RPC error response. */
+static QJsonObject
+errorResponse(const QJsonValue &id, int code, const QString &message) {
+  QJsonObject error;
+  error.insert("code", code);
+  error.insert("message", message);
+  QJsonObject response;
+  response.insert("jsonrpc", "2.0");
+  response.insert("id", id);
+  response.insert("error", error);
+  return response;
+}
+
+
+/** Runs the command requested and assembles the response. The parameters are the command line
+ * arguments of the command, as passed to dmrconf. */
+static QJsonObject
+handleRequest(const QByteArray &line, QCoreApplication &app, bool &shutdown) {
+  QJsonParseError parseError;
+  QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+  if (QJsonParseError::NoError != parseError.error)
+    return errorResponse(QJsonValue::Null, RPC_PARSE_ERROR, parseError.errorString());
+  if ((! doc.isObject()) || (! doc.object().value("method").isString()))
+    return errorResponse(QJsonValue::Null, RPC_INVALID_REQUEST, "Expected a request object.");
+
+  QJsonObject request = doc.object();
+  QJsonValue id = request.value("id");
+  QString method = request.value("method").toString();
+
+  if ("shutdown" == method) {
+    shutdown = true;
+    QJsonObject response;
+    response.insert("jsonrpc", "2.0");
+    response.insert("id", id);
+    response.insert("result", QJsonObject());
+    return response;
+  }
+
+  if (! serviceCommands.contains(method))
+    return errorResponse(id, RPC_METHOD_NOT_FOUND, QString("Unknown method '%1'.").arg(method));
+
+  QStringList args = {QCoreApplication::applicationFilePath(), method};
+  foreach (QJsonValue param, request.value("params").toArray()) {
+    if (! param.isString())
+      return errorResponse(id, RPC_INVALID_PARAMS, "Expected command line arguments as strings.");
+    args.append(param.toString());
+  }
+
+  // Each request gets a fresh parser, such that options do not leak into later requests
+  QCommandLineParser parser;
+  setupCommandLine(parser);
+  if (! parser.parse(args))
+    return errorResponse(id, RPC_INVALID_PARAMS, parser.errorText());
+  if (parser.isSet("help") || parser.isSet("version") || parser.isSet("list-radios"))
+    return errorResponse(id, RPC_INVALID_PARAMS, "Options --help, --version and --list-radios "
+                                                 "are not available.");
+  if (serviceCommands.value(method) > parser.positionalArguments().size())
+    return errorResponse(id, RPC_INVALID_PARAMS, QString("Missing arguments for '%1'.").arg(method));
+  if (radioCommands.contains(method) && (! parser.isSet("radio")))
+    return errorResponse(id, RPC_INVALID_PARAMS, "No radio specified, use the --radio option.");
+
+  logDebug() << "Serve request '" << method << "' (" << args.mid(2).join(" ") << ").";
+  CaptureLogHandler *capture = new CaptureLogHandler(
+        parser.isSet("verbose") ? LogMessage::DEBUG : LogMessage::INFO);
+  Logger::get().addHandler(capture);
+  TimingPolicy::setFixedTimeout(0);
+  int status = runCommand(parser, app);
+  Logger::get().remHandler(capture);
+
+  QJsonObject result;
+  result.insert("status", status);
+  result.insert("messages", capture->messages());
+  delete capture;
+
+  QJsonObject response;
+  response.insert("jsonrpc", "2.0");
+  response.insert("id", id);
+  response.insert("result", result);
+  return response;
+}
+
+
+int
+serve(QCommandLineParser &parser, QCoreApplication &app) {
+  QString name = SERVICE_SOCKET_NAME;
+  if (2 <= parser.positionalArguments().size())
+    name = parser.positionalArguments().at(1);
+
+  QLocalServer server;
+  server.setSocketOptions(QLocalServer::UserAccessOption);
+  QLocalServer::removeServer(name);
+  if (! server.listen(name)) {
+    logError() << "Cannot listen on '" << name << "': " << server.errorString();
+    return -1;
+  }
+  logInfo() << "Serving requests on '" << server.fullServerName() << "'.";
+
+  // Commands may run nested event loops. Hence requests are queued and processed one at a time
+  // by the outermost invocation only.
+  QList<QPair<QPointer<QLocalSocket>, QByteArray>> queue;
+  bool busy = false, shutdown = false;
+  QEventLoop loop;
+
+  auto process = [&]() {
+    if (busy)
+      return;
+    busy = true;
+    while ((! queue.isEmpty()) && (! shutdown)) {
+      auto request = queue.takeFirst();
+      QJsonObject response = handleRequest(request.second, app, shutdown);
+      if (request.first) {
+        request.first->write(QJsonDocument(response).toJson(QJsonDocument::Compact) + "\n");
+        request.first->flush();
+      }
+    }
+    busy = false;
+    if (shutdown)
+      loop.quit();
+  };
+
+  QObject::connect(&server, &QLocalServer::newConnection, [&]() {
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+      QObject::connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+      QObject::connect(socket, &QLocalSocket::readyRead, [&, socket]() {
+        while (socket->canReadLine()) {
+          QByteArray line = socket->readLine().trimmed();
+          if (! line.isEmpty())
+            queue.append({QPointer<QLocalSocket>(socket), line});
+        }
+        process();
+      });
+    }
+  });
+
+  loop.exec();
+  server.close();
+  logInfo() << "Service stopped.";
+
+  return 0;
+}
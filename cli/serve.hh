@@ -0,0 +1,9 @@
+#ifndef SERVE_HH
+#define SERVE_HH
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int serve(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // SERVE_HH
@@ -0,0 +1,56 @@
+#include "stats.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include "logger.hh"
+#include "radioinfo.hh"
+#include "performancehistory.hh"
+
+
+int stats(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app)
+
+  if (2 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  PerformanceHistory history(parser.value("history"));
+  QString action = parser.positionalArguments().at(1);
+  ErrorStack err;
+
+  if ("history" == action) {
+    QVector<PerformanceHistory::Record> records;
+    if (! history.read(records, err)) {
+      logError() << "Cannot read performance history: " << err.format();
+      return -1;
+    }
+
+    // Records store the name of the radio
+    if (parser.isSet("radio")) {
+      RadioInfo radio = RadioInfo::byKey(parser.value("radio").toLower());
+      if (! radio.isValid()) {
+        logError() << "Unknown radio '" << parser.value("radio") << "'.";
+        return -1;
+      }
+      QVector<PerformanceHistory::Record> selected;
+      foreach (const PerformanceHistory::Record &record, records) {
+        if (radio.name() == record.radio)
+          selected.append(record);
+      }
+      records.swap(selected);
+    }
+
+    if (records.isEmpty()) {
+      logInfo() << "No transfers recorded in '" << history.filename() << "'.";
+      return 0;
+    }
+
+    QTextStream out(stdout);
+    out << PerformanceHistory::summarize(records);
+    return 0;
+  }
+
+  logError() << "Unknown stats action '" << action << "'.";
+  return -1;
+}
@@ -0,0 +1,10 @@
+#ifndef STATS_HH
+#define STATS_HH
+
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int stats(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // STATS_HH
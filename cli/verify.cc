@@ -4,10 +4,13 @@
 #include <QString>
 #include <QFile>
 #include <QTextStream>
+#include <QThreadPool>
+#include <QRunnable>
 #include <iostream>
 
 #include "logger.hh"
 #include "config.hh"
+#include "configsnapshot.hh"
 #include "csvreader.hh"
 #include "dfufile.hh"
 #include "radiolimits.hh"
@@ -22,169 +25,267 @@
 #include "d578uv.hh"
 
 
-int verify(QCommandLineParser &parser, QCoreApplication &app)
+/** Verifies the config against the limits of the given radio. The config is only copied, if the
+ * codeplug of the radio rewrites it during pre-processing. */
+static bool
+verifyWith(Radio &radio, Config &config, RadioLimitContext &ctx) {
+  if (! radio.codeplug().requiresPreprocessing(&config)) {
+    radio.limits().verifyConfig(&config, ctx);
+    return true;
+  }
+
+  ErrorStack err;
+  Config *intermediate = radio.codeplug().preprocess(&config, err);
+  if (nullptr == intermediate) {
+    logError() << "Cannot pre-process codeplug: " << err.format();
+    return false;
+  }
+  radio.limits().verifyConfig(intermediate, ctx);
+  delete intermediate;
+  return true;
+}
+
+
+/** Creates the radio to verify against. Returns @c nullptr, if verification against the given
+ * radio is not supported. */
+static Radio *
+createRadio(RadioInfo::Radio id) {
+  switch (id) {
+  case RadioInfo::RD5R: return new RD5R();
+  case RadioInfo::UV390: return new UV390();
+  case RadioInfo::MD2017: return new MD2017();
+  case RadioInfo::GD77: return new GD77();
+  case RadioInfo::OpenGD77: return new OpenGD77();
+  case RadioInfo::D868UV: return new D868UV();
+  case RadioInfo::D878UV: return new D878UV();
+  case RadioInfo::D878UVII: return new D878UV2();
+  case RadioInfo::D578UV: return new D578UV();
+  default: break;
+  }
+  return nullptr;
+}
+
+/** Radios a codeplug gets verified against with --all-radios. */
+static const QList<RadioInfo::Radio> verifiableRadios = {
+  RadioInfo::RD5R, RadioInfo::UV390, RadioInfo::MD2017, RadioInfo::GD77, RadioInfo::OpenGD77,
+  RadioInfo::D868UV, RadioInfo::D878UV, RadioInfo::D878UVII, RadioInfo::D578UV
+};
+
+
+/** Verifies the shared config against a single radio within a thread pool. The radio is created
+ * and destroyed within the worker thread. */
+class VerifyRunner: public QRunnable
 {
-  Q_UNUSED(app);
+public:
+  VerifyRunner(const RadioInfo &info, Config &config)
+    : QRunnable(), _info(info), _config(config), _context(), _result(false)
+  {
+    setAutoDelete(false);
+    // Report identical issues only once
+    _context.enableAggregation();
+  }
 
-  if (2 > parser.positionalArguments().size())
-    parser.showHelp(-1);
+  void run() {
+    Radio *radio = createRadio(_info.id());
+    if (nullptr == radio)
+      return;
+    _result = verifyWith(*radio, _config, _context);
+    delete radio;
+  }
+
+  const RadioInfo &info() const {
+    return _info;
+  }
+
+  const RadioLimitContext &context() const {
+    return _context;
+  }
+
+  bool result() const {
+    return _result;
+  }
+
+protected:
+  RadioInfo _info;
+  Config &_config;
+  RadioLimitContext _context;
+  bool _result;
+};
+
+
+/** Logs the issues found. Returns @c false if there is any critical issue. */
+static bool
+report(const RadioLimitContext &ctx, const QString &prefix=QString()) {
+  bool valid = true;
+  for (int i=0; i<ctx.count(); i++) {
+    QString message = prefix + ctx.message(i).format();
+    switch (ctx.message(i).severity()) {
+    case RadioLimitIssue::Silent:
+      logDebug() << message;
+      break;
+    case RadioLimitIssue::Hint:
+      logInfo() << message;
+      break;
+    case RadioLimitIssue::Warning:
+      logWarn() << message;
+      break;
+    case RadioLimitIssue::Critical:
+      logError() << message;
+      valid = false;
+      break;
+    }
+  }
+  return valid;
+}
 
+
+/** Reads the config given as the first file argument. */
+static bool
+readConfig(QCommandLineParser &parser, Config &config) {
   QString filename = parser.positionalArguments().at(1);
   QFile file(filename);
   if (! file.open(QIODevice::ReadOnly)) {
     logError() << "Cannot open file" << filename;
-    return -1;
+    return false;
   }
 
-  Config config;
-
   // Determine type by ending or flag
   if (parser.isSet("csv") || (filename.endsWith(".conf") || filename.endsWith(".csv"))) {
     QTextStream stream(&file);
     QString errorMessage;
     if (! CSVReader::read(&config, stream, errorMessage)) {
       logError() << "Cannot read config file '" << filename << "': " << errorMessage;
-      return -1;
+      return false;
     }
-    logInfo() << "Verify '" << filename << "': No syntax issues found.";
+    logInfo() << "Read '" << filename << "': No syntax issues found.";
   } else if (parser.isSet("bin") || (filename.endsWith(".bin") || filename.endsWith(".dfu"))) {
-    logError() << "Verification of binary code-plugs makes no sense.";
-    return -1;
+    logError() << "Verification or planning of binary code-plugs makes no sense.";
+    return false;
+  } else if (parser.isSet("snapshot") || filename.endsWith(".snap")) {
+    ErrorStack err;
+    if (! ConfigSnapshot::read(&config, file, err)) {
+      logError() << "Cannot read config snapshot '" << filename
+                 << "': " << err.format();
+      return false;
+    }
   } else if (parser.isSet("yaml") || (filename.endsWith(".yaml") || filename.endsWith(".yml"))) {
     ErrorStack err;
     if (! config.readYAML(filename,err)) {
       logError() << "Cannot read codeplug file '" << filename
                  << "': " << err.format();
-      return -1;
+      return false;
     }
   } else {
     logError() << "Cannot determine filetype from filename '" << filename
                << "': Consider using --csv.";
-    return -1;
+    return false;
   }
 
-  if (! parser.isSet("radio")) {
+  return true;
+}
+
+
+int verify(QCommandLineParser &parser, QCoreApplication &app)
+{
+  Q_UNUSED(app);
+
+  if (2 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  Config config;
+  if (! readConfig(parser, config))
+    return -1;
+
+  if ((! parser.isSet("radio")) && (! parser.isSet("all-radios"))) {
     logInfo() << "To verify the codeplug against a specific radio, conser using the --radio=RADIO option.";
     return 0;
   }
 
-
-  RadioLimitContext ctx;
-  RadioInfo::Radio radio = RadioInfo::byKey(parser.value("radio").toLower()).id();
-  switch (radio) {
-  case RadioInfo::RD5R: {
-    RD5R radio; ErrorStack err;
-    Config *intermediate = radio.codeplug().preprocess(&config, err);
-    if (nullptr == intermediate) {
-      logError() << "Cannot pre-process codeplug: " << err.format();
-      return -1;
-    }
-    radio.limits().verifyConfig(intermediate, ctx);
-    delete intermediate;
-    } break;
-  case RadioInfo::UV390: {
-      UV390 radio; ErrorStack err;
-      Config *intermediate = radio.codeplug().preprocess(&config, err);
-      if (nullptr == intermediate) {
-        logError() << "Cannot pre-process codeplug: " << err.format();
-        return -1;
-      }
-      radio.limits().verifyConfig(intermediate, ctx);
-      delete intermediate;
-    } break;
-  case RadioInfo::MD2017: {
-      MD2017 radio; ErrorStack err;
-      Config *intermediate = radio.codeplug().preprocess(&config, err);
-      if (nullptr == intermediate) {
-        logError() << "Cannot pre-process codeplug: " << err.format();
-        return -1;
-      }
-      radio.limits().verifyConfig(intermediate, ctx);
-      delete intermediate;
-    } break;
-  case RadioInfo::GD77: {
-      GD77 radio; ErrorStack err;
-      Config *intermediate = radio.codeplug().preprocess(&config, err);
-      if (nullptr == intermediate) {
-        logError() << "Cannot pre-process codeplug: " << err.format();
-        return -1;
-      }
-      radio.limits().verifyConfig(intermediate, ctx);
-      delete intermediate;
-    } break;
-  case RadioInfo::OpenGD77: {
-      OpenGD77 radio; ErrorStack err;
-      Config *intermediate = radio.codeplug().preprocess(&config, err);
-      if (nullptr == intermediate) {
-        logError() << "Cannot pre-process codeplug: " << err.format();
-        return -1;
-      }
-      radio.limits().verifyConfig(intermediate, ctx);
-      delete intermediate;
-    } break;
-  case RadioInfo::D868UV: {
-      D868UV radio; ErrorStack err;
-      Config *intermediate = radio.codeplug().preprocess(&config, err);
-      if (nullptr == intermediate) {
-        logError() << "Cannot pre-process codeplug: " << err.format();
-        return -1;
-      }
-      radio.limits().verifyConfig(intermediate, ctx);
-      delete intermediate;
-    } break;
-  case RadioInfo::D878UV: {
-      D878UV radio; ErrorStack err;
-      Config *intermediate = radio.codeplug().preprocess(&config, err);
-      if (nullptr == intermediate) {
-        logError() << "Cannot pre-process codeplug: " << err.format();
-        return -1;
-      }
-      radio.limits().verifyConfig(intermediate, ctx);
-      delete intermediate;
-    } break;
-  case RadioInfo::D878UVII: {
-      D878UV2 radio; ErrorStack err;
-      Config *intermediate = radio.codeplug().preprocess(&config, err);
-      if (nullptr == intermediate) {
-        logError() << "Cannot pre-process codeplug: " << err.format();
-        return -1;
-      }
-      radio.limits().verifyConfig(intermediate, ctx);
-      delete intermediate;
-    } break;
-  case RadioInfo::D578UV: {
-      D578UV radio; ErrorStack err;
-      Config *intermediate = radio.codeplug().preprocess(&config, err);
-      if (nullptr == intermediate) {
-        logError() << "Cannot pre-process codeplug: " << err.format();
+  // Collect radios to verify against
+  QList<RadioInfo> radios;
+  if (parser.isSet("all-radios")) {
+    foreach (RadioInfo::Radio id, verifiableRadios)
+      radios.append(RadioInfo::byID(id));
+  } else {
+    foreach (QString key, parser.value("radio").toLower().split(",", Qt::SkipEmptyParts)) {
+      key = key.trimmed();
+      if ((! RadioInfo::hasRadioKey(key)) || (! verifiableRadios.contains(RadioInfo::byKey(key).id()))) {
+        logError() << "Cannot verify code-plug against unknown radio '" << key << "'.";
         return -1;
       }
-      radio.limits().verifyConfig(intermediate, ctx);
-      delete intermediate;
-    } break;
-  default:
-    logError() << "Cannot verify code-plug against unknown radio '" << radio << "'.";
-    return -1;
+      radios.append(RadioInfo::byKey(key));
+    }
   }
 
+  if (1 == radios.size()) {
+    VerifyRunner runner(radios.first(), config);
+    runner.run();
+    if (! runner.result())
+      return -1;
+    return (report(runner.context()) ? 0 : -1);
+  }
+
+  // Verify against all radios concurrently, the config is only read.
+  QVector<VerifyRunner *> runners;
+  foreach (const RadioInfo &info, radios)
+    runners.append(new VerifyRunner(info, config));
+  QThreadPool pool;
+  foreach (VerifyRunner *runner, runners)
+    pool.start(runner);
+  pool.waitForDone();
+
+  // Report in the order the radios were given
   bool valid = true;
-  for (int i=0; i<ctx.count(); i++) {
-    switch (ctx.message(i).severity()) {
-    case RadioLimitIssue::Silent:
-      logDebug() << ctx.message(i).format();
-      break;
-    case RadioLimitIssue::Hint:
-      logInfo() << ctx.message(i).format();
-      break;
-    case RadioLimitIssue::Warning:
-      logWarn() << ctx.message(i).format();
-      break;
-    case RadioLimitIssue::Critical:
-      logError() << ctx.message(i).format();
+  foreach (VerifyRunner *runner, runners) {
+    QString prefix = QString("%1: ").arg(runner->info().name());
+    if (! runner->result()) {
+      logError() << prefix << "Verification failed.";
       valid = false;
-      break;
+    } else {
+      bool ok = report(runner->context(), prefix);
+      if (ok)
+        logInfo() << prefix << "No critical issues found.";
+      valid &= ok;
     }
+    delete runner;
   }
 
   return (valid ? 0 : -1);
 }
+
+
+int plan(QCommandLineParser &parser, QCoreApplication &app)
+{
+  Q_UNUSED(app);
+
+  if ((2 > parser.positionalArguments().size()) || (! parser.isSet("radio")))
+    parser.showHelp(-1);
+
+  Config config;
+  if (! readConfig(parser, config))
+    return -1;
+
+  // Only the limits of the radios are needed, no codeplug gets encoded
+  bool fits = true;
+  QStringList keys = parser.value("radio").toLower().split(",", Qt::SkipEmptyParts);
+  QTextStream out(stdout);
+  foreach (QString key, keys) {
+    key = key.trimmed();
+    if ((! RadioInfo::hasRadioKey(key)) || (! verifiableRadios.contains(RadioInfo::byKey(key).id()))) {
+      logError() << "Cannot plan code-plug for unknown radio '" << key << "'.";
+      return -1;
+    }
+    Radio *radio = createRadio(RadioInfo::byKey(key).id());
+    RadioLimitUsage usage = radio->limits().estimateUsage(&config);
+    if (1 < keys.size())
+      out << radio->name() << ":\n";
+    out << usage.format() << "\n";
+    if (! usage.fits()) {
+      logWarn() << "Code-plug does not fit into " << radio->name() << ".";
+      fits = false;
+    }
+    delete radio;
+  }
+
+  return (fits ? 0 : -1);
+}
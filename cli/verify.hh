@@ -5,5 +5,6 @@ class QCommandLineParser;
 class QCoreApplication;
 
 int verify(QCommandLineParser &parser, QCoreApplication &app);
+int plan(QCommandLineParser &parser, QCoreApplication &app);
 
 #endif // VERIFY_HH
@@ -9,80 +9,73 @@
 #include "progressbar.hh"
 #include "callsigndb.hh"
 #include "autodetect.hh"
+#include "multidevice.hh"
+#include "encodecallsigndb.hh"
 
 
 int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
-  UserDatabase userdb;
+  ErrorStack err;
+  UserDatabase *userdb = sharedUserDB(parser.value("database"), err);
+  CallsignDB::Selection selection;
+  if ((nullptr == userdb) || (! selectUsers(*userdb, parser, selection, err))) {
+    logError() << err.format();
+    return -1;
+  }
 
-  if (parser.isSet("database")) {
-    if (! userdb.load(parser.value("database"))) {
-      logError() << "Cannot load user-db from '" << parser.value("database") << "'.";
+  if (multipleDevices(parser)) {
+    QList<Radio *> radios = autoDetectAll(parser, app, err);
+    if (radios.isEmpty()) {
+      logError() << "Could not detect radios: " << err.format();
       return -1;
     }
-  } else if (0 == userdb.count()) {
-    logInfo() << "Downloading call-sign DB...";
-    // Wait for download to finish
-    QEventLoop loop;
-    QObject::connect(&userdb, SIGNAL(loaded()), &loop, SLOT(quit()));
-    QObject::connect(&userdb, SIGNAL(error(QString)), &loop, SLOT(quit()));
-    loop.exec();
-    // Check if call-sign DB has been loaded
-    if (0 == userdb.count()) {
-      logError() << "Could not download/load call-sign DB.";
-      return -1;
-    }
-  }
 
-  if (parser.isSet("id")) {
-    QStringList prefixes_text = parser.value("id").split(",");
-    QSet<unsigned> prefixes;
-    foreach (QString prefix_text, prefixes_text) {
-      bool ok=true; uint32_t prefix = prefix_text.toUInt(&ok);
-      if (ok)
-        prefixes.insert(prefix);
-    }
+    foreach (Radio *radio, radios)
+      radio->setReadbackVerification(parser.isSet("verify-write") || parser.isSet("verify-samples"),
+                                     parser.value("verify-samples").toUInt());
+      radio->setSkipUnchanged(parser.isSet("skip-unchanged"));
 
-    if (prefixes.isEmpty()) {
-      logError() << "Please specify a valid DMR ID or a list of DMR prefixes for --id option.";
-      return -1;
-    }
-    prefixes_text.clear();
-    foreach (unsigned prefix, prefixes) {
-      prefixes_text.append(QString::number(prefix));
-    }
-    logDebug() << "Sort call-sign DB w.r.t. DMR ID(s) {" << prefixes_text.join(", ") << "}.";
-    userdb.sortUsers(prefixes);
-  } else {
-    logWarn() << "No ID is specified, a more or less random set of call-signs will be used "
-              << "if the radio cannot hold the entire call-sign DB of " << userdb.count()
-              << " entries. Specify your DMR ID with --id=YOUR_DMR_ID. dmrconf will then "
-              << "select those entries 'closest' to you. I.e., DMR IDs with the same prefix.";
-  }
+    unsigned failed = runOnRadios(radios, [userdb, &selection](Radio *radio, const ErrorStack &err) {
+      return radio->startUploadCallsignDB(userdb, false, selection, err);
+    }, parser.isSet("stats"));
+    qDeleteAll(radios);
 
-  CallsignDB::Selection selection;
-  if (parser.isSet("limit")) {
-    bool ok=true;
-    selection.setCountLimit(parser.value("limit").toUInt(&ok));
-    if (! ok) {
-      logError() << "Please specify a valid limit for the number of callsign db entries using the -n/--limit option.";
+    if (failed) {
+      logError() << "Could not upload call-sign DB to " << failed << " of " << radios.size() << " radios.";
       return -1;
     }
+    return 0;
   }
 
-  ErrorStack err;
+  TransferProgress progress(parser);
   Radio *radio = autoDetect(parser, app, err);
   if (nullptr == radio) {
+    progress.finish(false);
     logError() << "Could not detect radio: " << err.format();
     return -1;
   }
 
-  showProgress();
-  QObject::connect(radio, &Radio::uploadProgress, updateProgress);
+  progress.attach(radio);
+  radio->setReadbackVerification(parser.isSet("verify-write") || parser.isSet("verify-samples"),
+                                 parser.value("verify-samples").toUInt());
+  radio->setSkipUnchanged(parser.isSet("skip-unchanged"));
 
-  if (! radio->startUploadCallsignDB(&userdb, true, selection, err)) {
+  if (! radio->startUploadCallsignDB(userdb, true, selection, err)) {
+    progress.finish(false);
     logError() << "Could not upload call-sign DB to radio: " << err.format();
+    if (radio->hasCheckpoint())
+      logInfo() << "Run 'dmrconf resume' to continue the upload.";
     return -1;
   }
+  progress.finish(Radio::StatusError != radio->status());
+
+  if (parser.isSet("stats")) {
+    logInfo() << "Transfer statistics:\n" << radio->transferStatistics().format();
+    MemoryUsage usage("Total");
+    usage.add(userdb->memoryUsage());
+    if (radio->callsignDB())
+      usage.add(radio->callsignDB()->memoryUsage("Callsign DB"));
+    logInfo() << "Memory usage:\n" << usage.format();
+  }
 
   return 0;
 }
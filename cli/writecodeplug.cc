@@ -3,51 +3,95 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
 
 #include "logger.hh"
 #include "radio.hh"
 #include "config.hh"
+#include "configsnapshot.hh"
 #include "progressbar.hh"
 #include "autodetect.hh"
 #include "radiolimits.hh"
+#include "multidevice.hh"
+#include "userdatabase.hh"
+#include "encodecallsigndb.hh"
 
 
-int writeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
-  if (2 > parser.positionalArguments().size())
-    parser.showHelp(-1);
+/** Reads the codeplug within a thread pool, while the radio gets detected and identified. The
+ * config is created within the pool thread and moved to the given thread once it is complete. */
+class CodeplugReader: public QRunnable
+{
+public:
+  /** Possible file formats. */
+  enum class Format { None, CSV, YAML, Snapshot };
 
-  QString filename = parser.positionalArguments().at(1);
-  QFileInfo fileinfo(filename);
+public:
+  CodeplugReader(const QString &filename, Format format, QThread *target, Config *&config, QString &error)
+    : QRunnable(), _filename(filename), _format(format), _target(target), _config(config), _error(error)
+  {
+    // pass...
+  }
 
-  QString errorMessage;
-  Config config;
-  if (parser.isSet("csv") || ("csv" == fileinfo.suffix()) || ("conf"==fileinfo.suffix())) {
-    if (! config.readCSV(filename, errorMessage)) {
-      logError() << "Cannot read CSV file '" << filename << "': " << errorMessage;
-      return -1;
-    }
-  } else if (parser.isSet("yaml") || ("yaml" == fileinfo.suffix())) {
+  void run() {
     ErrorStack err;
-    if (! config.readYAML(fileinfo.canonicalFilePath(), err)) {
-      logError() << "Cannot parse YAML codeplug '" << fileinfo.fileName() << "': " << err.format();
-      return -1;
+    QFileInfo fileinfo(_filename);
+    Config *config = new Config();
+    if (Format::CSV == _format) {
+      QString errorMessage;
+      if (! config->readCSV(_filename, errorMessage)) {
+        _error = QString("Cannot read CSV file '%1': %2").arg(_filename, errorMessage);
+        delete config;
+        return;
+      }
+    } else if (Format::YAML == _format) {
+      if (! config->readYAML(fileinfo.canonicalFilePath(), err)) {
+        _error = QString("Cannot parse YAML codeplug '%1': %2").arg(fileinfo.fileName(), err.format());
+        delete config;
+        return;
+      }
+    } else if ((Format::Snapshot == _format) && (! ConfigSnapshot::read(config, fileinfo.canonicalFilePath(), err))) {
+      _error = QString("Cannot read config snapshot '%1': %2").arg(fileinfo.fileName(), err.format());
+      delete config;
+      return;
     }
+    config->moveToThread(_target);
+    _config = config;
   }
-  logDebug() << "Read codeplug from '" << filename << "'.";
 
-  ErrorStack err;
-  Radio *radio = autoDetect(parser, app, err);
-  if (nullptr == radio) {
-    logError() << "Cannot detect radio:" << err.format();
-    return -1;
+protected:
+  QString _filename;
+  Format _format;
+  QThread *_target;
+  Config *&_config;
+  QString &_error;
+};
+
+
+/** Waits for the codeplug reader and returns the read codeplug or @c nullptr on error. */
+static Config *
+waitForCodeplug(QThreadPool &pool, Config *&config, const QString &error) {
+  pool.waitForDone();
+  if (nullptr == config) {
+    logError() << error;
+    return nullptr;
   }
+  logDebug() << "Read codeplug.";
+  return config;
+}
+
 
+/** Pre-processes and verifies the codeplug for the given radio. */
+static Config *
+prepareCodeplug(Radio *radio, Config &config, QCommandLineParser &parser) {
+  ErrorStack err;
   RadioLimitContext ctx(parser.isSet("ignore-limits"));
 
   Config *intermediate = radio->codeplug().preprocess(&config, err);
   if (nullptr == intermediate) {
     logError() << "Cannot pre-process codeplug: " << err.format();
-    return -1;
+    return nullptr;
   }
 
   bool verified = true;
@@ -70,11 +114,35 @@ int writeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
   if (! verified) {
     logError() << "Cannot upload codeplug to device: Codeplug cannot be verified with radio.";
     delete intermediate;
-    return -1;
+    return nullptr;
+  }
+
+  return intermediate;
+}
+
+int writeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
+  if (2 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  QString filename = parser.positionalArguments().at(1);
+  QFileInfo fileinfo(filename);
+
+  CodeplugReader::Format format = CodeplugReader::Format::None;
+  if (parser.isSet("csv") || ("csv" == fileinfo.suffix()) || ("conf"==fileinfo.suffix())) {
+    format = CodeplugReader::Format::CSV;
+  } else if (parser.isSet("yaml") || ("yaml" == fileinfo.suffix())) {
+    format = CodeplugReader::Format::YAML;
+  } else if (parser.isSet("snapshot") || ("snap" == fileinfo.suffix())) {
+    format = CodeplugReader::Format::Snapshot;
   }
 
-  showProgress();
-  QObject::connect(radio, &Radio::uploadProgress, updateProgress);
+  // Read the codeplug in the background, while the radio gets detected and identified. The
+  // readers are joined, once the radio is needed to pre-process the codeplug.
+  Config *config = nullptr;
+  QString readError;
+  QThreadPool pool;
+  pool.setMaxThreadCount(1);
+  pool.start(new CodeplugReader(filename, format, QThread::currentThread(), config, readError));
 
   Codeplug::Flags flags;
   if (parser.isSet("init-codeplug"))
@@ -83,17 +151,127 @@ int writeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
     flags.autoEnableGPS = true;
   if (parser.isSet("auto-enable-roaming"))
     flags.autoEnableRoaming = true;
+  if (parser.isSet("encode-threads"))
+    flags.encodeThreads = parser.value("encode-threads").toUInt();
 
-  logDebug() << "Start upload to " << radio->name() << ".";
-  if (! radio->startUpload(intermediate, true, flags, err)) {
-    logError() << "Codeplug upload error: " << err.format();
+  // Load the user DB, if the call-sign DB is written within the same session
+  UserDatabase *userdb = nullptr;
+  CallsignDB::Selection selection;
+  if (parser.isSet("with-callsigns")) {
+    ErrorStack err;
+    userdb = sharedUserDB(parser.value("database"), err);
+    if ((nullptr == userdb) || (! selectUsers(*userdb, parser, selection, err))) {
+      logError() << err.format();
+      pool.waitForDone();
+      delete config;
+      return -1;
+    }
+  }
+
+  if (multipleDevices(parser)) {
+    ErrorStack err;
+    QList<Radio *> radios = autoDetectAll(parser, app, err);
+    if (radios.isEmpty()) {
+      logError() << "Cannot detect radios:" << err.format();
+      pool.waitForDone();
+      delete config;
+      return -1;
+    }
+    if (nullptr == waitForCodeplug(pool, config, readError)) {
+      qDeleteAll(radios);
+      return -1;
+    }
+    if (parser.isSet("cache-id"))
+      logWarn() << "Image cache is ignored when writing to several devices.";
+
+    // Pre-process codeplug for every radio, the radio takes ownership of the intermediate config
+    QList<Config *> intermediates;
+    foreach (Radio *radio, radios) {
+      radio->setReadbackVerification(parser.isSet("verify-write") || parser.isSet("verify-samples"),
+                                     parser.value("verify-samples").toUInt());
+      radio->setSkipUnchanged(parser.isSet("skip-unchanged"));
+      Config *intermediate = prepareCodeplug(radio, *config, parser);
+      if (nullptr == intermediate) {
+        qDeleteAll(intermediates);
+        qDeleteAll(radios);
+        delete config;
+        return -1;
+      }
+      intermediates.append(intermediate);
+    }
+
+    logDebug() << "Start upload to " << radios.size() << " radios.";
+    unsigned failed = runOnRadios(radios, [&radios, &intermediates, &flags, userdb, &selection](Radio *radio, const ErrorStack &err) {
+      Config *intermediate = intermediates.at(radios.indexOf(radio));
+      if (userdb)
+        return radio->startUploadAll(intermediate, userdb, false, flags, selection, err);
+      return radio->startUpload(intermediate, false, flags, err);
+    }, parser.isSet("stats"));
+    qDeleteAll(radios);
+    delete config;
+
+    if (failed) {
+      logError() << "Codeplug upload failed for " << failed << " of " << radios.size() << " radios.";
+      return -1;
+    }
+
+    logDebug() << "Upload completed.";
+    return 0;
+  }
+
+  ErrorStack err;
+  TransferProgress progress(parser);
+  Radio *radio = autoDetect(parser, app, err);
+  if (nullptr == radio) {
+    progress.finish(false);
+    logError() << "Cannot detect radio:" << err.format();
+    pool.waitForDone();
+    delete config;
+    return -1;
+  }
+  if (nullptr == waitForCodeplug(pool, config, readError)) {
+    progress.finish(false);
     return -1;
   }
 
-  if (Radio::StatusError == radio->status()) {
+  Config *intermediate = prepareCodeplug(radio, *config, parser);
+  if (nullptr == intermediate) {
+    progress.finish(false);
+    delete config;
+    return -1;
+  }
+
+  progress.attach(radio);
+
+  if (parser.isSet("cache-id"))
+    radio->setImageCache(parser.value("cache-id"));
+  radio->setReadbackVerification(parser.isSet("verify-write") || parser.isSet("verify-samples"),
+                                 parser.value("verify-samples").toUInt());
+  radio->setSkipUnchanged(parser.isSet("skip-unchanged"));
+
+  logDebug() << "Start upload to " << radio->name() << ".";
+  bool ok = (nullptr != userdb) ? radio->startUploadAll(intermediate, userdb, true, flags, selection, err)
+                                : radio->startUpload(intermediate, true, flags, err);
+  if ((! ok) || (Radio::StatusError == radio->status())) {
+    progress.finish(false);
     logError() << "Codeplug upload error: " << err.format();
+    if (radio->hasCheckpoint())
+      logInfo() << "Run 'dmrconf resume' to continue the upload.";
+    delete config;
     return -1;
   }
+  progress.finish(true);
+
+  if (parser.isSet("stats")) {
+    logInfo() << "Transfer statistics:\n" << radio->transferStatistics().format();
+    MemoryUsage usage("Total");
+    usage.add(config->memoryUsage());
+    usage.add(radio->codeplug().memoryUsage("Codeplug"));
+    if (userdb)
+      usage.add(userdb->memoryUsage());
+    logInfo() << "Memory usage:\n" << usage.format();
+  }
+  delete config;
 
   logDebug() << "Upload completed.";
   return 0;
@@ -1,21 +1,48 @@
 #include "addressmap.hh"
 #include <algorithm>
 
-AddressMap::AddressMap()
-  : _items()
+/** Page size of the page table as a power of two. */
+#define PAGE_BITS 12
+/** Maximum number of pages of the page table. Maps spanning more get searched instead. */
+#define MAX_PAGES (1<<20)
+
+AddressMap::AddressMap(Strategy strategy)
+  : _items(), _strategy(strategy), _lastHit(-1), _pagesValid(false), _pageBase(0), _pages()
 {
   // pass...
 }
 
 AddressMap::AddressMap(const AddressMap &other)
-  : _items(other._items)
+  : _items(other._items), _strategy(other._strategy), _lastHit(-1), _pagesValid(false),
+    _pageBase(0), _pages()
 {
   // pass...
 }
 
+AddressMap::AddressMap(AddressMap &&other) noexcept
+  : _items(std::move(other._items)), _strategy(other._strategy), _lastHit(other._lastHit),
+    _pagesValid(other._pagesValid), _pageBase(other._pageBase), _pages(std::move(other._pages))
+{
+  other.invalidate();
+}
+
 AddressMap &
 AddressMap::operator =(const AddressMap &other) {
   _items = other._items;
+  _strategy = other._strategy;
+  invalidate();
+  return *this;
+}
+
+AddressMap &
+AddressMap::operator =(AddressMap &&other) noexcept {
+  _items = std::move(other._items);
+  _strategy = other._strategy;
+  _lastHit = other._lastHit;
+  _pagesValid = other._pagesValid;
+  _pageBase = other._pageBase;
+  _pages = std::move(other._pages);
+  other.invalidate();
   return *this;
 }
 
@@ -23,6 +50,12 @@ AddressMap::operator =(const AddressMap &other) {
 void
 AddressMap::clear() {
   _items.clear();
+  invalidate();
+}
+
+void
+AddressMap::reserve(size_t n) {
+  _items.reserve(n);
 }
 
 bool
@@ -36,9 +69,28 @@ AddressMap::add(uint32_t addr, uint32_t len, int idx) {
     _items.push_back(item);
   else
     _items.insert(at, item);
+  invalidate();
   return true;
 }
 
+void
+AddressMap::add(const std::vector<Range> &ranges, uint32_t firstIndex) {
+  if (ranges.empty())
+    return;
+
+  size_t present = _items.size();
+  _items.reserve(present + ranges.size());
+  for (size_t i=0; i<ranges.size(); i++)
+    _items.emplace_back(ranges[i].address, ranges[i].length, uint32_t(firstIndex+i));
+
+  // Sort the new items (usually sorted already) and merge them with the present ones
+  std::vector<AddrMapItem>::iterator middle = _items.begin() + present;
+  if (! std::is_sorted(middle, _items.end()))
+    std::stable_sort(middle, _items.end());
+  std::inplace_merge(_items.begin(), middle, _items.end());
+  invalidate();
+}
+
 bool
 AddressMap::rem(uint32_t idx) {
   std::vector<AddrMapItem>::iterator at = _items.begin();
@@ -49,6 +101,7 @@ AddressMap::rem(uint32_t idx) {
   if (_items.end() == at)
     return false;
   _items.erase(at);
+  invalidate();
   return true;
 }
 
@@ -59,13 +112,111 @@ AddressMap::contains(uint32_t addr) const {
 
 int
 AddressMap::find(uint32_t addr) const {
-  std::vector<AddrMapItem>::const_iterator at = std::lower_bound(_items.begin(), _items.end(), addr);
-  if (_items.end() == at)
-    return _items.back().contains(addr) ? _items.back().index : -1;
-  if (at->contains(addr))
-    return at->index;
-  if (_items.begin() == at)
+  if (_items.empty())
+    return -1;
+
+  int pos = -1;
+  switch (_strategy) {
+  case Strategy::BinarySearch:
+    pos = search(addr, 0, _items.size());
+    break;
+
+  case Strategy::LastHit:
+    if ((0 <= _lastHit) && (_items[_lastHit].contains(addr)))
+      return _items[_lastHit].index;
+    if ((0 <= _lastHit) && (size_t(_lastHit+1) < _items.size()) && _items[_lastHit+1].contains(addr))
+      pos = _lastHit+1;
+    else
+      pos = search(addr, 0, _items.size());
+    _lastHit = pos;
+    break;
+
+  case Strategy::PageTable:
+    if (! _pagesValid)
+      buildPageTable();
+    if (_pages.empty()) {
+      // Map too sparse for a page table
+      pos = search(addr, 0, _items.size());
+      break;
+    }
+    if (addr < _pageBase)
+      return -1;
+    uint32_t page = (addr - _pageBase) >> PAGE_BITS;
+    if ((page+1) >= _pages.size())
+      return -1;
+    // The item containing the address either starts within the page or is the one right before.
+    pos = search(addr, _pages[page] ? (_pages[page]-1) : 0, _pages[page+1]);
+    break;
+  }
+
+  return (0 <= pos) ? int(_items[pos].index) : -1;
+}
+
+bool
+AddressMap::prepareConcurrentLookup() const {
+  if (Strategy::LastHit == _strategy)
+    return false;
+  if ((Strategy::PageTable == _strategy) && (! _pagesValid) && (! _items.empty()))
+    buildPageTable();
+  return true;
+}
+
+AddressMap::Strategy
+AddressMap::strategy() const {
+  return _strategy;
+}
+
+void
+AddressMap::setStrategy(Strategy strategy) {
+  _strategy = strategy;
+  invalidate();
+}
+
+int
+AddressMap::search(uint32_t addr, size_t first, size_t last) const {
+  last = std::min(last, _items.size());
+  if (first >= last)
+    return -1;
+  std::vector<AddrMapItem>::const_iterator begin = _items.begin()+first, end = _items.begin()+last;
+  std::vector<AddrMapItem>::const_iterator at = std::lower_bound(begin, end, addr);
+  if ((end != at) && at->contains(addr))
+    return at - _items.begin();
+  if (begin == at)
     return -1;
   --at;
-  return at->contains(addr) ? at->index : -1;
+  return at->contains(addr) ? int(at - _items.begin()) : -1;
+}
+
+bool
+AddressMap::buildPageTable() const {
+  _pages.clear();
+  _pagesValid = true;
+  _pageBase = _items.front().address & ~((1u<<PAGE_BITS)-1);
+  uint64_t end = 0;
+  for (const AddrMapItem &item: _items)
+    end = std::max(end, uint64_t(item.address)+item.length);
+
+  uint64_t numPages = ((end - _pageBase) >> PAGE_BITS) + 1;
+  if (numPages > MAX_PAGES)
+    return false;
+
+  // For every page start address (and the end of the last page), store the position of the first
+  // item starting at or after that address.
+  _pages.resize(numPages+1);
+  size_t pos = 0;
+  for (uint64_t p=0; p<=numPages; p++) {
+    uint64_t addr = uint64_t(_pageBase) + (p << PAGE_BITS);
+    while ((pos < _items.size()) && (_items[pos].address < addr))
+      pos++;
+    _pages[p] = pos;
+  }
+
+  return true;
+}
+
+void
+AddressMap::invalidate() {
+  _lastHit = -1;
+  _pagesValid = false;
+  _pages.clear();
 }
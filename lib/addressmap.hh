@@ -2,6 +2,7 @@
 #define ADDRESSMAP_HH
 
 #include <cinttypes>
+#include <cstddef>
 #include <vector>
 
 /** This class represents a memory map.
@@ -9,22 +10,52 @@
  * efficiently. This should speedup the generation of codeplugs consisting of many small memory
  * sections.
  *
+ * The lookup strategy can be selected. By default, a dense page table is built on the first lookup
+ * after a modification of the map. It maps every 4kb page to the range of items starting within it,
+ * reducing the search to the few items of a single page. For sparse maps spanning a huge address
+ * range, the map falls back to a plain binary search.
+ *
  * @ingroup util */
 class AddressMap
 {
+public:
+  /** Possible lookup strategies. */
+  enum class Strategy {
+    BinarySearch,  ///< Plain binary search over all items.
+    LastHit,       ///< Checks the last hit and its successor before falling back to a binary search.
+    PageTable      ///< Uses a dense page table to narrow the search (default).
+  };
+
+  /** A memory region to add, see @c add. */
+  struct Range {
+    uint32_t address;   ///< The start address of the region.
+    uint32_t length;    ///< The size/length of the region.
+  };
+
 public:
   /** Empty constructor. */
-  AddressMap();
+  AddressMap(Strategy strategy=Strategy::PageTable);
   /** Copy constructor. */
   AddressMap(const AddressMap &other);
+  /** Move constructor. */
+  AddressMap(AddressMap &&other) noexcept;
 
   /** Copy assignment. */
   AddressMap &operator=(const AddressMap &other);
+  /** Move assignment. */
+  AddressMap &operator=(AddressMap &&other) noexcept;
 
   /** Clears the address map. */
   void clear();
+  /** Reserves space for the given number of items. */
+  void reserve(size_t n);
   /** Adds an item to the address map. */
   bool add(uint32_t addr, uint32_t len, int idx=-1);
+  /** Adds many items at once, the i-th range gets associated with the index @c firstIndex+i.
+   * The new items are sorted once and merged with the present ones in a single pass. Hence,
+   * adding @c k items to a map of @c n items takes O(n + k log k) instead of O(n k) for adding
+   * them one-by-one in arbitrary order. */
+  void add(const std::vector<Range> &ranges, uint32_t firstIndex);
   /** Removes an item from the address map associated with the given index. */
   bool rem(uint32_t idx);
   /** Returns @c true if the given address is contained in any of the memory regions. */
@@ -32,6 +63,25 @@ public:
   /** Finds the index of the memory region containing the given address. If no such region is found,
    * -1 is returned. */
   int find(uint32_t addr) const;
+  /** Builds all lookup caches in advance. Once done, concurrent calls to @c find are safe as long
+   * as the map is not modified. Returns @c false for the @c LastHit strategy, which updates its
+   * cache on every lookup. */
+  bool prepareConcurrentLookup() const;
+
+  /** Returns the lookup strategy. */
+  Strategy strategy() const;
+  /** Sets the lookup strategy. */
+  void setStrategy(Strategy strategy);
+
+protected:
+  /** Binary search for the position of the item containing the given address within the
+   * item positions @c [first, last). Returns -1 if not found. */
+  int search(uint32_t addr, size_t first, size_t last) const;
+  /** (Re-) Builds the page table. Returns @c false and leaves the table empty if the map spans
+   * too many pages. */
+  bool buildPageTable() const;
+  /** Invalidates all lookup caches. */
+  void invalidate();
 
 protected:
   /** Memory map item.
@@ -63,6 +113,18 @@ protected:
 protected:
   /** Holds the vector of memory items, the order of these items is maintained. */
   std::vector<AddrMapItem> _items;
+  /** The selected lookup strategy. */
+  Strategy _strategy;
+  /** Position of the item found by the last lookup, -1 if none. Only used by @c LastHit. */
+  mutable int _lastHit;
+  /** If @c true, the page table is up to date. An empty table then means the map is too sparse. */
+  mutable bool _pagesValid;
+  /** The address of the first page. */
+  mutable uint32_t _pageBase;
+  /** For every page, the position of the first item starting within or after it. The table has
+   * one extra entry, such that the item containing an address within page @c i is found within
+   * @c [_pages[i]-1, _pages[i+1]). */
+  mutable std::vector<uint32_t> _pages;
 };
 
 #endif // ADDRESSMAP_HH
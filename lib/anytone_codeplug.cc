@@ -1,12 +1,19 @@
 #include "anytone_codeplug.hh"
+#include "dfupatch.hh"
 #include "utils.hh"
 #include "logger.hh"
 #include "anytone_extension.hh"
 #include "config.hh"
 #include "melody.hh"
 #include "intermediaterepresentation.hh"
+#include "tracer.hh"
 #include <QTimeZone>
 #include <QRegularExpression>
+#include <QtAlgorithms>
+#include <QtEndian>
+#include <QMutex>
+#include <QMutexLocker>
+#include "stringpool.hh"
 
 #define CUSTOM_CTCSS_TONE 0x33
 
@@ -61,6 +68,69 @@ QVector<char> _anytone_bin_dtmf_tab = {
 };
 
 
+/** Loads the 64-bit word of a bitmap starting at the given byte. The bits are inverted by XOR-ing
+ * with @c invert, bytes beyond the end of the bitmap are zero. Hence, a set bit in the result
+ * always marks an encoded element. */
+static inline quint64
+bitmapWord(const uint8_t *data, size_t size, size_t byte, quint64 invert) {
+  if ((byte+8) <= size) {
+    quint64 word; memcpy(&word, data+byte, 8);
+    return qFromLittleEndian(word) ^ invert;
+  }
+  quint64 word = 0;
+  for (size_t i=0; (byte+i)<size; i++)
+    word |= quint64(data[byte+i] ^ uint8_t(invert)) << (8*i);
+  return word;
+}
+
+/** Counts the encoded elements of a bitmap, word by word. */
+static unsigned int
+bitmapCount(const uint8_t *data, size_t size, quint64 invert) {
+  unsigned int count = 0;
+  for (size_t byte=0; byte<size; byte+=8)
+    count += qPopulationCount(bitmapWord(data, size, byte, invert));
+  return count;
+}
+
+/** Finds the next encoded element of a bitmap at or after the given index. */
+static int
+bitmapNext(const uint8_t *data, size_t size, quint64 invert, unsigned int idx) {
+  size_t byte = idx/8;
+  if (byte >= size)
+    return -1;
+  quint64 word = bitmapWord(data, size, byte, invert) & (~quint64(0) << (idx%8));
+  while (0 == word) {
+    byte += 8;
+    if (byte >= size)
+      return -1;
+    word = bitmapWord(data, size, byte, invert);
+  }
+  return byte*8 + qCountTrailingZeroBits(word);
+}
+
+/** Sets or clears @c n bits of a bitmap, starting at bit @c first. Whole bytes are written at
+ * once. */
+static void
+bitmapSetRange(uint8_t *data, size_t size, unsigned int first, unsigned int n, bool set) {
+  unsigned int end = std::min(size_t(first)+n, size*8);
+  // Leading bits up to the next byte boundary
+  for (; (first < end) && (first % 8); first++) {
+    if (set) data[first/8] |= (1 << (first%8));
+    else data[first/8] &= ~(1 << (first%8));
+  }
+  // Whole bytes
+  if (first < end && (end-first) >= 8) {
+    memset(data+first/8, set ? 0xff : 0x00, (end-first)/8);
+    first += ((end-first)/8)*8;
+  }
+  // Trailing bits
+  for (; first < end; first++) {
+    if (set) data[first/8] |= (1 << (first%8));
+    else data[first/8] &= ~(1 << (first%8));
+  }
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of AnytoneCodeplug::BitmapElement
  * ********************************************************************************************* */
@@ -92,11 +162,22 @@ AnytoneCodeplug::BitmapElement::setEncoded(unsigned int idx, bool enable) {
 
 void
 AnytoneCodeplug::BitmapElement::enableFirst(unsigned int n) {
-  unsigned int byte = n/8, bit=n%8;
-  memset(_data, 0xff, byte);
-  for (unsigned int i=0; i<bit; i++) {
-    _data[byte] |= (1<<i);
-  }
+  setRange(0, n, true);
+}
+
+void
+AnytoneCodeplug::BitmapElement::setRange(unsigned int first, unsigned int n, bool enable) {
+  bitmapSetRange(_data, _size, first, n, enable);
+}
+
+unsigned int
+AnytoneCodeplug::BitmapElement::count() const {
+  return bitmapCount(_data, _size, 0);
+}
+
+int
+AnytoneCodeplug::BitmapElement::nextEncoded(unsigned int idx) const {
+  return bitmapNext(_data, _size, 0, idx);
 }
 
 
@@ -131,11 +212,22 @@ AnytoneCodeplug::InvertedBitmapElement::setEncoded(unsigned int idx, bool enable
 
 void
 AnytoneCodeplug::InvertedBitmapElement::enableFirst(unsigned int n) {
-  unsigned int byte = n/8, bit=n%8;
-  memset(_data, 0x00, byte);
-  for (unsigned int i=0; i<bit; i++) {
-    _data[byte] &= ~(1<<i);
-  }
+  setRange(0, n, true);
+}
+
+void
+AnytoneCodeplug::InvertedBitmapElement::setRange(unsigned int first, unsigned int n, bool enable) {
+  bitmapSetRange(_data, _size, first, n, !enable);
+}
+
+unsigned int
+AnytoneCodeplug::InvertedBitmapElement::count() const {
+  return bitmapCount(_data, _size, ~quint64(0));
+}
+
+int
+AnytoneCodeplug::InvertedBitmapElement::nextEncoded(unsigned int idx) const {
+  return bitmapNext(_data, _size, ~quint64(0), idx);
 }
 
 
@@ -169,7 +261,32 @@ AnytoneCodeplug::InvertedBytemapElement::setEncoded(unsigned int idx, bool enabl
 
 void
 AnytoneCodeplug::InvertedBytemapElement::enableFirst(unsigned int n) {
-  memset(_data, 0x00, n);
+  setRange(0, n, true);
+}
+
+void
+AnytoneCodeplug::InvertedBytemapElement::setRange(unsigned int first, unsigned int n, bool enable) {
+  if (first >= _size)
+    return;
+  memset(_data+first, enable ? 0x00 : 0xff, std::min(size_t(n), _size-first));
+}
+
+unsigned int
+AnytoneCodeplug::InvertedBytemapElement::count() const {
+  unsigned int count = 0;
+  for (size_t i=0; i<_size; i++)
+    count += (0 == _data[i]) ? 1 : 0;
+  return count;
+}
+
+int
+AnytoneCodeplug::InvertedBytemapElement::nextEncoded(unsigned int idx) const {
+  if (idx >= _size)
+    return -1;
+  const uint8_t *ptr = (const uint8_t *)memchr(_data+idx, 0x00, _size-idx);
+  if (nullptr == ptr)
+    return -1;
+  return ptr - _data;
 }
 
 
@@ -206,20 +323,20 @@ AnytoneCodeplug::ChannelElement::clear() {
 
 unsigned
 AnytoneCodeplug::ChannelElement::rxFrequency() const {
-  return ((unsigned)getBCD8_be(0x0000))*10;
+  return ((unsigned)getField<Fields::RXFrequency>())*10;
 }
 void
 AnytoneCodeplug::ChannelElement::setRXFrequency(unsigned hz) {
-  setBCD8_be(0x0000, hz/10);
+  setField<Fields::RXFrequency>(hz/10);
 }
 
 unsigned
 AnytoneCodeplug::ChannelElement::txOffset() const {
-  return ((unsigned)getBCD8_be(0x0004))*10;
+  return ((unsigned)getField<Fields::TXOffset>())*10;
 }
 void
 AnytoneCodeplug::ChannelElement::setTXOffset(unsigned hz) {
-  setBCD8_be(0x0004, hz/10);
+  setField<Fields::TXOffset>(hz/10);
 }
 
 unsigned
@@ -245,16 +362,16 @@ AnytoneCodeplug::ChannelElement::setTXFrequency(unsigned hz) {
 
 AnytoneCodeplug::ChannelElement::Mode
 AnytoneCodeplug::ChannelElement::mode() const {
-  return (Mode) getUInt2(0x0008, 0);
+  return (Mode) getField<Fields::Mode>();
 }
 void
 AnytoneCodeplug::ChannelElement::setMode(Mode mode) {
-  setUInt2(0x0008, 0, (unsigned)mode);
+  setField<Fields::Mode>((unsigned)mode);
 }
 
 Channel::Power
 AnytoneCodeplug::ChannelElement::power() const {
-  switch ((Power)getUInt2(0x0008, 2)) {
+  switch ((Power)getField<Fields::Power>()) {
   case POWER_LOW: return Channel::Power::Low;
   case POWER_MIDDLE: return Channel::Power::Mid;
   case POWER_HIGH: return Channel::Power::High;
@@ -267,50 +384,50 @@ AnytoneCodeplug::ChannelElement::setPower(Channel::Power power) {
   switch (power) {
   case Channel::Power::Min:
   case Channel::Power::Low:
-    setUInt2(0x0008, 2, (unsigned)POWER_LOW);
+    setField<Fields::Power>((unsigned)POWER_LOW);
     break;
   case Channel::Power::Mid:
-    setUInt2(0x0008, 2, (unsigned)POWER_MIDDLE);
+    setField<Fields::Power>((unsigned)POWER_MIDDLE);
     break;
   case Channel::Power::High:
-    setUInt2(0x0008, 2, (unsigned)POWER_HIGH);
+    setField<Fields::Power>((unsigned)POWER_HIGH);
     break;
   case Channel::Power::Max:
-    setUInt2(0x0008, 2, (unsigned)POWER_TURBO);
+    setField<Fields::Power>((unsigned)POWER_TURBO);
     break;
   }
 }
 
 FMChannel::Bandwidth
 AnytoneCodeplug::ChannelElement::bandwidth() const {
-  if (getBit(0x0008, 4))
+  if (getField<Fields::Bandwidth>())
     return FMChannel::Bandwidth::Wide;
   return FMChannel::Bandwidth::Narrow;
 }
 void
 AnytoneCodeplug::ChannelElement::setBandwidth(FMChannel::Bandwidth bw) {
   switch (bw) {
-  case FMChannel::Bandwidth::Narrow: setBit(0x0008, 4, false); break;
-  case FMChannel::Bandwidth::Wide: setBit(0x0008, 4, true); break;
+  case FMChannel::Bandwidth::Narrow: setField<Fields::Bandwidth>(0); break;
+  case FMChannel::Bandwidth::Wide: setField<Fields::Bandwidth>(1); break;
   }
 }
 
 AnytoneCodeplug::ChannelElement::RepeaterMode
 AnytoneCodeplug::ChannelElement::repeaterMode() const {
-  return (RepeaterMode)getUInt2(0x0008, 6);
+  return (RepeaterMode)getField<Fields::RepeaterMode>();
 }
 void
 AnytoneCodeplug::ChannelElement::setRepeaterMode(RepeaterMode mode) {
-  setUInt2(0x0008, 6, (unsigned)mode);
+  setField<Fields::RepeaterMode>((unsigned)mode);
 }
 
 AnytoneCodeplug::ChannelElement::SignalingMode
 AnytoneCodeplug::ChannelElement::rxSignalingMode() const {
-  return (SignalingMode)getUInt2(0x0009, 0);
+  return (SignalingMode)getField<Fields::RXSignalingMode>();
 }
 void
 AnytoneCodeplug::ChannelElement::setRXSignalingMode(SignalingMode mode) {
-  setUInt2(0x0009, 0, (unsigned)mode);
+  setField<Fields::RXSignalingMode>((unsigned)mode);
 }
 
 Signaling::Code
@@ -338,11 +455,11 @@ AnytoneCodeplug::ChannelElement::setRXTone(Signaling::Code code) {
 
 AnytoneCodeplug::ChannelElement::SignalingMode
 AnytoneCodeplug::ChannelElement::txSignalingMode() const {
-  return (SignalingMode)getUInt2(0x0009, 2);
+  return (SignalingMode)getField<Fields::TXSignalingMode>();
 }
 void
 AnytoneCodeplug::ChannelElement::setTXSignalingMode(SignalingMode mode) {
-  setUInt2(0x0009, 2, (unsigned)mode);
+  setField<Fields::TXSignalingMode>((unsigned)mode);
 }
 
 Signaling::Code
@@ -370,73 +487,73 @@ AnytoneCodeplug::ChannelElement::setTXTone(Signaling::Code code) {
 
 bool
 AnytoneCodeplug::ChannelElement::ctcssPhaseReversal() const {
-  return getBit(0x0009, 4);
+  return getField<Fields::CTCSSPhaseReversal>();
 }
 void
 AnytoneCodeplug::ChannelElement::enableCTCSSPhaseReversal(bool enable) {
-  setBit(0x0009, 4, enable);
+  setField<Fields::CTCSSPhaseReversal>(enable);
 }
 bool
 AnytoneCodeplug::ChannelElement::rxOnly() const {
-  return getBit(0x0009, 5);
+  return getField<Fields::RXOnly>();
 }
 void
 AnytoneCodeplug::ChannelElement::enableRXOnly(bool enable) {
-  setBit(0x0009, 5, enable);
+  setField<Fields::RXOnly>(enable);
 }
 bool
 AnytoneCodeplug::ChannelElement::callConfirm() const {
-  return getBit(0x0009, 6);
+  return getField<Fields::CallConfirm>();
 }
 void
 AnytoneCodeplug::ChannelElement::enableCallConfirm(bool enable) {
-  setBit(0x0009, 6, enable);
+  setField<Fields::CallConfirm>(enable);
 }
 bool
 AnytoneCodeplug::ChannelElement::talkaround() const {
-  return getBit(0x0009, 7);
+  return getField<Fields::Talkaround>();
 }
 void
 AnytoneCodeplug::ChannelElement::enableTalkaround(bool enable) {
-  setBit(0x0009, 7, enable);
+  setField<Fields::Talkaround>(enable);
 }
 
 bool
 AnytoneCodeplug::ChannelElement::txCTCSSIsCustom() const {
-  return CUSTOM_CTCSS_TONE == getUInt8(0x000a);
+  return CUSTOM_CTCSS_TONE == getField<Fields::TXCTCSS>();
 }
 Signaling::Code
 AnytoneCodeplug::ChannelElement::txCTCSS() const {
-  return ctcss_num2code(getUInt8(0x000a));
+  return ctcss_num2code(getField<Fields::TXCTCSS>());
 }
 void
 AnytoneCodeplug::ChannelElement::setTXCTCSS(Signaling::Code tone) {
-  setUInt8(0x000a, ctcss_code2num(tone));
+  setField<Fields::TXCTCSS>(ctcss_code2num(tone));
 }
 void
 AnytoneCodeplug::ChannelElement::enableTXCustomCTCSS() {
-  setUInt8(0x000a, CUSTOM_CTCSS_TONE);
+  setField<Fields::TXCTCSS>(CUSTOM_CTCSS_TONE);
 }
 bool
 AnytoneCodeplug::ChannelElement::rxCTCSSIsCustom() const {
-  return CUSTOM_CTCSS_TONE == getUInt8(0x000b);
+  return CUSTOM_CTCSS_TONE == getField<Fields::RXCTCSS>();
 }
 Signaling::Code
 AnytoneCodeplug::ChannelElement::rxCTCSS() const {
-  return ctcss_num2code(getUInt8(0x000b));
+  return ctcss_num2code(getField<Fields::RXCTCSS>());
 }
 void
 AnytoneCodeplug::ChannelElement::setRXCTCSS(Signaling::Code tone) {
-  setUInt8(0x000b, ctcss_code2num(tone));
+  setField<Fields::RXCTCSS>(ctcss_code2num(tone));
 }
 void
 AnytoneCodeplug::ChannelElement::enableRXCustomCTCSS() {
-  setUInt8(0x000b, CUSTOM_CTCSS_TONE);
+  setField<Fields::RXCTCSS>(CUSTOM_CTCSS_TONE);
 }
 
 Signaling::Code
 AnytoneCodeplug::ChannelElement::txDCS() const {
-  uint16_t code = getUInt16_le(0x000c);
+  uint16_t code = getField<Fields::TXDCS>();
   if (512 > code)
     return Signaling::fromDCSNumber(dec_to_oct(code), false);
   return Signaling::fromDCSNumber(dec_to_oct(code-512), true);
@@ -444,16 +561,16 @@ AnytoneCodeplug::ChannelElement::txDCS() const {
 void
 AnytoneCodeplug::ChannelElement::setTXDCS(Signaling::Code code) {
   if (Signaling::isDCSNormal(code))
-    setUInt16_le(0x000c, oct_to_dec(Signaling::toDCSNumber(code)));
+    setField<Fields::TXDCS>(oct_to_dec(Signaling::toDCSNumber(code)));
   else if (Signaling::isDCSInverted(code))
-    setUInt16_le(0x000c, oct_to_dec(Signaling::toDCSNumber(code))+512);
+    setField<Fields::TXDCS>(oct_to_dec(Signaling::toDCSNumber(code))+512);
   else
-    setUInt16_le(0x000c, 0);
+    setField<Fields::TXDCS>(0);
 }
 
 Signaling::Code
 AnytoneCodeplug::ChannelElement::rxDCS() const {
-  uint16_t code = getUInt16_le(0x000e);
+  uint16_t code = getField<Fields::RXDCS>();
   if (512 > code)
     return Signaling::fromDCSNumber(dec_to_oct(code), false);
   return Signaling::fromDCSNumber(dec_to_oct(code-512), true);
@@ -461,74 +578,74 @@ AnytoneCodeplug::ChannelElement::rxDCS() const {
 void
 AnytoneCodeplug::ChannelElement::setRXDCS(Signaling::Code code) {
   if (Signaling::isDCSNormal(code))
-    setUInt16_le(0x000e, oct_to_dec(Signaling::toDCSNumber(code)));
+    setField<Fields::RXDCS>(oct_to_dec(Signaling::toDCSNumber(code)));
   else if (Signaling::isDCSInverted(code))
-    setUInt16_le(0x000e, oct_to_dec(Signaling::toDCSNumber(code))+512);
+    setField<Fields::RXDCS>(oct_to_dec(Signaling::toDCSNumber(code))+512);
   else
-    setUInt16_le(0x000e, 0);
+    setField<Fields::RXDCS>(0);
 }
 
 double
 AnytoneCodeplug::ChannelElement::customCTCSSFrequency() const {
-  return ((double) getUInt16_le(0x0010))/10;
+  return ((double) getField<Fields::CustomCTCSS>())/10;
 }
 void
 AnytoneCodeplug::ChannelElement::setCustomCTCSSFrequency(double hz) {
-  setUInt16_le(0x0010, hz*10);
+  setField<Fields::CustomCTCSS>(hz*10);
 }
 
 unsigned
 AnytoneCodeplug::ChannelElement::twoToneDecodeIndex() const {
-  return getUInt16_le(0x0012);
+  return getField<Fields::TwoToneDecodeIndex>();
 }
 void
 AnytoneCodeplug::ChannelElement::setTwoToneDecodeIndex(unsigned idx) {
-  setUInt16_le(0x0012, idx);
+  setField<Fields::TwoToneDecodeIndex>(idx);
 }
 
 unsigned
 AnytoneCodeplug::ChannelElement::contactIndex() const {
-  return getUInt32_le(0x0014);
+  return getField<Fields::ContactIndex>();
 }
 void
 AnytoneCodeplug::ChannelElement::setContactIndex(unsigned idx) {
-  return setUInt32_le(0x0014, idx);
+  setField<Fields::ContactIndex>(idx);
 }
 
 unsigned
 AnytoneCodeplug::ChannelElement::radioIDIndex() const {
-  return getUInt8(0x0018);
+  return getField<Fields::RadioIDIndex>();
 }
 void
 AnytoneCodeplug::ChannelElement::setRadioIDIndex(unsigned idx) {
-  return setUInt8(0x0018, idx);
+  setField<Fields::RadioIDIndex>(idx);
 }
 
 AnytoneFMChannelExtension::SquelchMode
 AnytoneCodeplug::ChannelElement::squelchMode() const {
-  return (AnytoneFMChannelExtension::SquelchMode)getUInt3(0x0019, 4);
+  return (AnytoneFMChannelExtension::SquelchMode)getField<Fields::SquelchMode>();
 }
 void
 AnytoneCodeplug::ChannelElement::setSquelchMode(AnytoneFMChannelExtension::SquelchMode mode) {
-  setUInt3(0x0019, 4, (unsigned)mode);
+  setField<Fields::SquelchMode>((unsigned)mode);
 }
 
 AnytoneCodeplug::ChannelElement::Admit
 AnytoneCodeplug::ChannelElement::admit() const {
-  return (Admit)getUInt2(0x001a, 0);
+  return (Admit)getField<Fields::Admit>();
 }
 void
 AnytoneCodeplug::ChannelElement::setAdmit(Admit admit) {
-  setUInt2(0x001a, 0, (unsigned)admit);
+  setField<Fields::Admit>((unsigned)admit);
 }
 
 AnytoneCodeplug::ChannelElement::OptSignaling
 AnytoneCodeplug::ChannelElement::optionalSignaling() const {
-  return (OptSignaling)getUInt2(0x001a, 4);
+  return (OptSignaling)getField<Fields::OptionalSignaling>();
 }
 void
 AnytoneCodeplug::ChannelElement::setOptionalSignaling(OptSignaling sig) {
-  setUInt2(0x001a, 4, (unsigned)sig);
+  setField<Fields::OptionalSignaling>((unsigned)sig);
 }
 
 bool
@@ -537,11 +654,11 @@ AnytoneCodeplug::ChannelElement::hasScanListIndex() const {
 }
 unsigned
 AnytoneCodeplug::ChannelElement::scanListIndex() const {
-  return getUInt8(0x001b);
+  return getField<Fields::ScanListIndex>();
 }
 void
 AnytoneCodeplug::ChannelElement::setScanListIndex(unsigned idx) {
-  setUInt8(0x001b, idx);
+  setField<Fields::ScanListIndex>(idx);
 }
 void
 AnytoneCodeplug::ChannelElement::clearScanListIndex() {
@@ -554,11 +671,11 @@ AnytoneCodeplug::ChannelElement::hasGroupListIndex() const {
 }
 unsigned
 AnytoneCodeplug::ChannelElement::groupListIndex() const {
-  return getUInt8(0x001c);
+  return getField<Fields::GroupListIndex>();
 }
 void
 AnytoneCodeplug::ChannelElement::setGroupListIndex(unsigned idx) {
-  setUInt8(0x001c, idx);
+  setField<Fields::GroupListIndex>(idx);
 }
 void
 AnytoneCodeplug::ChannelElement::clearGroupListIndex() {
@@ -567,27 +684,27 @@ AnytoneCodeplug::ChannelElement::clearGroupListIndex() {
 
 unsigned
 AnytoneCodeplug::ChannelElement::twoToneIDIndex() const {
-  return getUInt8(0x001d);
+  return getField<Fields::TwoToneIDIndex>();
 }
 void
 AnytoneCodeplug::ChannelElement::setTwoToneIDIndex(unsigned idx) {
-  setUInt8(0x001d, idx);
+  setField<Fields::TwoToneIDIndex>(idx);
 }
 unsigned
 AnytoneCodeplug::ChannelElement::fiveToneIDIndex() const {
-  return getUInt8(0x001e);
+  return getField<Fields::FiveToneIDIndex>();
 }
 void
 AnytoneCodeplug::ChannelElement::setFiveToneIDIndex(unsigned idx) {
-  setUInt8(0x001e, idx);
+  setField<Fields::FiveToneIDIndex>(idx);
 }
 unsigned
 AnytoneCodeplug::ChannelElement::dtmfIDIndex() const {
-  return getUInt8(0x001f);
+  return getField<Fields::DTMFIDIndex>();
 }
 void
 AnytoneCodeplug::ChannelElement::setDTMFIDIndex(unsigned idx) {
-  setUInt8(0x001f, idx);
+  setField<Fields::DTMFIDIndex>(idx);
 }
 
 unsigned
@@ -4461,15 +4578,15 @@ AnytoneCodeplug::ContactMapElement::isGroup() const {
 }
 unsigned
 AnytoneCodeplug::ContactMapElement::id() const {
-  uint32_t tmp = getUInt32_le(0x0000);
-  tmp = tmp>>1;
-  return decode_dmr_id_bcd_le((uint8_t *)&tmp);
+  return decode_bcd8(getUInt32_le(0x0000) >> 1);
 }
 void
 AnytoneCodeplug::ContactMapElement::setID(unsigned id, bool group) {
-  uint32_t tmp; encode_dmr_id_bcd_le((uint8_t *)&tmp, id);
-  tmp = ( (tmp << 1) | (group ? 1 : 0) );
-  setUInt32_le(0x0000, tmp);
+  setBCDID(encode_bcd8(id), group);
+}
+void
+AnytoneCodeplug::ContactMapElement::setBCDID(uint32_t bcd, bool group) {
+  setUInt32_le(0x0000, (bcd << 1) | (group ? 1 : 0));
 }
 
 unsigned
@@ -4486,7 +4603,7 @@ AnytoneCodeplug::ContactMapElement::setIndex(unsigned idx) {
  * Implementation of AnytoneCodeplug
  * ********************************************************************************************* */
 AnytoneCodeplug::AnytoneCodeplug(const QString &label, QObject *parent)
-  : Codeplug(parent), _label(label)
+  : Codeplug(parent), _label(label), _encodeProgress(nullptr)
 {
   // pass...
 }
@@ -4506,8 +4623,31 @@ AnytoneCodeplug::clear() {
   this->allocateBitmaps();
 }
 
+void
+AnytoneCodeplug::allocateSkeleton() {
+  static QMutex lock;
+  static QHash<QString, DFUFile::Image> skeletons;
+
+  QString key = QString("%1:%2").arg(metaObject()->className()).arg(_label);
+  QMutexLocker locker(&lock);
+  if (skeletons.contains(key)) {
+    while (this->numImages())
+      remImage(0);
+    // Element data is shared with the skeleton until it gets modified
+    addImage(skeletons[key]);
+    return;
+  }
+
+  // Clear codeplug
+  this->clear();
+  // Then allocate elements
+  this->allocateUpdated();
+  skeletons.insert(key, image(0));
+}
+
 bool
 AnytoneCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) const {
+  TRACE_SPAN("AnytoneCodeplug::index", "codeplug");
   Q_UNUSED(err)
 
   // All indices as 0-based. That is, the first channel gets index 0 etc.
@@ -4579,8 +4719,14 @@ AnytoneCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) cons
 }
 
 
+bool
+AnytoneCodeplug::requiresPreprocessing(const Config *config) const {
+  return Codeplug::requiresPreprocessing(config) || ZoneSplitVisitor::isRequired(config);
+}
+
 Config *
 AnytoneCodeplug::preprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("AnytoneCodeplug::preprocess", "codeplug");
   Config *intermediate = Codeplug::preprocess(config, err);
   if (nullptr == intermediate) {
     errMsg(err) << "Cannot pre-process codeplug for anytone device.";
@@ -4600,6 +4746,7 @@ AnytoneCodeplug::preprocess(Config *config, const ErrorStack &err) const {
 
 bool
 AnytoneCodeplug::postprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("AnytoneCodeplug::postprocess", "codeplug");
   if (! Codeplug::postprocess(config, err)) {
     errMsg(err) << "Cannot post-process codeplug for anytone device.";
     return false;
@@ -4615,45 +4762,113 @@ AnytoneCodeplug::postprocess(Config *config, const ErrorStack &err) const {
 }
 
 
-bool
-AnytoneCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
-  Context ctx(config);
+void
+AnytoneCodeplug::addTables(Context &ctx) const {
   // Register table for auto-repeater offsets
   ctx.addTable(&AnytoneAutoRepeaterOffset::staticMetaObject);
   // Register table for FM APRS frequencies
   ctx.addTable(&AnytoneAPRSFrequency::staticMetaObject);
+}
+
+bool
+AnytoneCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
+  TRACE_SPAN("AnytoneCodeplug::encode", "codeplug");
+  Context ctx(config);
+  addTables(ctx);
 
   if (! index(config, ctx, err)) {
     errMsg(err) << "Cannot encode anytone codeplug.";
     return false;
   }
 
+  return encodeIndexed(ctx, flags, err);
+}
+
+bool
+AnytoneCodeplug::encodeIndexed(Context &ctx, const Flags &flags, const ErrorStack &err) {
+  TRACE_SPAN("AnytoneCodeplug::encodeIndexed", "codeplug");
   // If codeplug is generated from scratch -> clear and reallocate
-  if (! flags.updateCodePlug) {
-    // Clear codeplug
-    this->clear();
-    // Then allocate elements
-    this->allocateUpdated();
-  }
+  if (! flags.updateCodePlug)
+    this->allocateSkeleton();
 
   // First set bitmaps
   this->setBitmaps(ctx);
   // Allocate all memory elements representing the common config
   this->allocateForEncoding();
 
+  // The layout is fixed now. When reporting the progress, the encoded sections get read while
+  // the remaining ones are being encoded. Hence the element data must not move from now on.
+  if (_encodeProgress) {
+    unsigned merged = image(0).compact();
+    logDebug() << "Merged " << merged << " adjacent elements.";
+    prepareConcurrentAccess();
+    _encodeProgress->setAllocated();
+  }
+
   // Then encode everything.
   return this->encodeElements(flags, ctx, err);
 }
 
+void
+AnytoneCodeplug::setEncodeProgress(EncodeProgress *progress) {
+  _encodeProgress = progress;
+}
+
+void
+AnytoneCodeplug::reportEncoded(uint32_t address, uint32_t size) {
+  if (_encodeProgress)
+    _encodeProgress->setEncoded(address, size);
+}
+
+bool
+AnytoneCodeplug::encodeIncremental(Config *config, Context &ctx, DFUPatch &changes,
+                                   const Flags &flags, const ErrorStack &err)
+{
+  TRACE_SPAN("AnytoneCodeplug::encodeIncremental", "codeplug");
+  // Keep a (shallow) copy of the current codeplug to determine the changes
+  DFUFile previous;
+  for (int i=0; i<numImages(); i++)
+    previous.addImage(image(i));
+
+  Context current(config);
+  addTables(current);
+  if (! index(config, current, err)) {
+    errMsg(err) << "Cannot encode anytone codeplug.";
+    return false;
+  }
+
+  bool success = false;
+  if (current.hasSameIndices(ctx)) {
+    // Neither bitmaps nor allocation change, only re-encode modified elements. As channels depend
+    // on some global settings, a modification of the settings re-encodes everything.
+    current.setIncremental(! config->settings()->isDirty());
+    success = encodeElements(flags, current, err);
+    current.setIncremental(false);
+  } else {
+    logDebug() << "Objects were added, removed or reordered: Encode entire codeplug.";
+    success = encodeIndexed(current, flags, err);
+  }
+
+  if (! success) {
+    errMsg(err) << "Cannot encode anytone codeplug.";
+    return false;
+  }
+
+  current.clearDirty();
+  config->settings()->clearDirty();
+  ctx = current;
+
+  return changes.diff(previous, *this, 0, err);
+}
+
 bool
 AnytoneCodeplug::decode(Config *config, const ErrorStack &err) {
+  TRACE_SPAN("AnytoneCodeplug::decode", "codeplug");
+  // Names decoded repeatedly share their storage
+  StringPool::Scope strings;
   // Maps code-plug indices to objects
   Context ctx(config);
-
-  // Register table for auto-repeater offsets
-  ctx.addTable(&AnytoneAutoRepeaterOffset::staticMetaObject);
-  // Register table for FM APRS frequencies
-  ctx.addTable(&AnytoneAPRSFrequency::staticMetaObject);
+  addTables(ctx);
 
   return this->decodeElements(ctx, err);
 }
@@ -2,6 +2,8 @@
 #define ANYTONECODEPLUG_HH
 
 #include "codeplug.hh"
+#include "encodeprogress.hh"
+#include "memorylayout.hh"
 #include <QGeoCoordinate>
 #include "channel.hh"
 #include "contact.hh"
@@ -38,6 +40,14 @@ public:
     virtual void setEncoded(unsigned int idx, bool enable);
     /** Enables the first n elements. */
     virtual void enableFirst(unsigned int n);
+
+    /** Enables/disables @c n elements, starting at index @c first. */
+    void setRange(unsigned int first, unsigned int n, bool enable);
+    /** Returns the number of enabled elements. */
+    unsigned int count() const;
+    /** Returns the index of the first enabled element at or after @c idx. Returns -1 if there
+     * is none. */
+    int nextEncoded(unsigned int idx) const;
   };
 
   /** Represents the base class for inverted bitmaps in all AnyTone codeplugs. */
@@ -57,6 +67,14 @@ public:
     virtual void setEncoded(unsigned int idx, bool enable);
     /** Enables the first n elements. */
     virtual void enableFirst(unsigned int n);
+
+    /** Enables/disables @c n elements, starting at index @c first. */
+    void setRange(unsigned int first, unsigned int n, bool enable);
+    /** Returns the number of enabled elements. */
+    unsigned int count() const;
+    /** Returns the index of the first enabled element at or after @c idx. Returns -1 if there
+     * is none. */
+    int nextEncoded(unsigned int idx) const;
   };
 
   /** Represents the base class for inverted bytemaps in all AnyTone codeplugs.
@@ -81,6 +99,14 @@ public:
     virtual void setEncoded(unsigned int idx, bool enable);
     /** Enables the first n elements. */
     virtual void enableFirst(unsigned int n);
+
+    /** Enables/disables @c n elements, starting at index @c first. */
+    void setRange(unsigned int first, unsigned int n, bool enable);
+    /** Returns the number of enabled elements. */
+    unsigned int count() const;
+    /** Returns the index of the first enabled element at or after @c idx. Returns -1 if there
+     * is none. */
+    int nextEncoded(unsigned int idx) const;
   };
 
   /** Represents the base class for channel encodings in all AnyTone codeplugs.
@@ -383,6 +409,40 @@ public:
     struct Offset {
       /// @todo Implement
     };
+
+    /** Internal used fields within the channel element. */
+    struct Fields {
+      /// @cond DO_NOT_DOCUMENT
+      typedef Field<0x0000, 0, 32, FieldEncoding::BCD_be> RXFrequency;
+      typedef Field<0x0004, 0, 32, FieldEncoding::BCD_be> TXOffset;
+      typedef Field<0x0008, 0, 2> Mode;
+      typedef Field<0x0008, 2, 2> Power;
+      typedef Field<0x0008, 4, 1> Bandwidth;
+      typedef Field<0x0008, 6, 2> RepeaterMode;
+      typedef Field<0x0009, 0, 2> RXSignalingMode;
+      typedef Field<0x0009, 2, 2> TXSignalingMode;
+      typedef Field<0x0009, 4, 1> CTCSSPhaseReversal;
+      typedef Field<0x0009, 5, 1> RXOnly;
+      typedef Field<0x0009, 6, 1> CallConfirm;
+      typedef Field<0x0009, 7, 1> Talkaround;
+      typedef Field<0x000a, 0, 8, FieldEncoding::UInt_le> TXCTCSS;
+      typedef Field<0x000b, 0, 8, FieldEncoding::UInt_le> RXCTCSS;
+      typedef Field<0x000c, 0, 16, FieldEncoding::UInt_le> TXDCS;
+      typedef Field<0x000e, 0, 16, FieldEncoding::UInt_le> RXDCS;
+      typedef Field<0x0010, 0, 16, FieldEncoding::UInt_le> CustomCTCSS;
+      typedef Field<0x0012, 0, 16, FieldEncoding::UInt_le> TwoToneDecodeIndex;
+      typedef Field<0x0014, 0, 32, FieldEncoding::UInt_le> ContactIndex;
+      typedef Field<0x0018, 0, 8, FieldEncoding::UInt_le> RadioIDIndex;
+      typedef Field<0x0019, 4, 3> SquelchMode;
+      typedef Field<0x001a, 0, 2> Admit;
+      typedef Field<0x001a, 4, 2> OptionalSignaling;
+      typedef Field<0x001b, 0, 8, FieldEncoding::UInt_le> ScanListIndex;
+      typedef Field<0x001c, 0, 8, FieldEncoding::UInt_le> GroupListIndex;
+      typedef Field<0x001d, 0, 8, FieldEncoding::UInt_le> TwoToneIDIndex;
+      typedef Field<0x001e, 0, 8, FieldEncoding::UInt_le> FiveToneIDIndex;
+      typedef Field<0x001f, 0, 8, FieldEncoding::UInt_le> DTMFIDIndex;
+      /// @endcond
+    };
   };
 
   /** Represents the channel bitmaps in all AnyTone codeplugs. */
@@ -2932,12 +2992,38 @@ public:
     virtual unsigned id() const;
     /** Encodes ID and group call flag. */
     virtual void setID(unsigned id, bool group=false);
+    /** Stores an already BCD encoded ID and group call flag. */
+    virtual void setBCDID(uint32_t bcd, bool group=false);
     /** Returns the index. */
     virtual unsigned index() const;
     /** Sets the index. */
     virtual void setIndex(unsigned idx);
   };
 
+  /** Non-polymorphic view of an entry of the contact indices, see @c ContactMapElement. Used by
+   * the loops encoding many entries at once. */
+  class ContactMapView: public ElementView<0x0008>
+  {
+  public:
+    /** Constructor. */
+    explicit inline ContactMapView(uint8_t *ptr) : ElementView<0x0008>(ptr) { }
+
+    /** Encodes ID and group call flag. */
+    inline void setID(unsigned id, bool group=false) const { setBCDID(encode_bcd8(id), group); }
+    /** Stores an already BCD encoded ID and group call flag. */
+    inline void setBCDID(uint32_t bcd, bool group=false) const {
+      setField<ID>((bcd << 1) | (group ? 1 : 0));
+    }
+    /** Sets the index. */
+    inline void setIndex(unsigned idx) const { setField<Index>(idx); }
+
+  protected:
+    /// @cond DO_NOT_DOCUMENT
+    typedef Element::Field<0x0000, 0, 32, Element::FieldEncoding::UInt_le> ID;
+    typedef Element::Field<0x0004, 0, 32, Element::FieldEncoding::UInt_le> Index;
+    /// @endcond
+  };
+
 protected:
   /** Hidden constructor. */
   AnytoneCodeplug(const QString &label, QObject *parent=nullptr);
@@ -2950,14 +3036,80 @@ public:
   virtual void clear();
 
   Config *preprocess(Config *config, const ErrorStack &err) const;
+  bool requiresPreprocessing(const Config *config) const;
   bool encode(Config *config, const Flags &flags, const ErrorStack &err);
+  bool encodeIncremental(Config *config, Context &ctx, DFUPatch &changes, const Flags &flags,
+                         const ErrorStack &err);
 
   bool decode(Config *config, const ErrorStack &err);
   bool postprocess(Config *config, const ErrorStack &err) const;
 
+  /** Adds the AnyTone specific tables to the context. */
+  void addTables(Context &ctx) const;
+
 protected:
   virtual bool index(Config *config, Context &ctx, const ErrorStack &err=ErrorStack()) const;
+  /** Encodes the config of the already indexed context. */
+  virtual bool encodeIndexed(Context &ctx, const Flags &flags, const ErrorStack &err=ErrorStack());
+
+  /** Reports the progress of the following encodings to the given tracker, e.g., to upload the
+   * encoded sections while the remaining ones are being encoded. Once allocated, the image gets
+   * compacted and prepared for concurrent access. Pass @c nullptr to stop reporting. */
+  void setEncodeProgress(EncodeProgress *progress);
+  /** Marks the given range as encoded, if the progress gets reported. The range must not be
+   * modified by the remaining encoding. */
+  void reportEncoded(uint32_t address, uint32_t size);
+
+  /** Allocates the elements of the given table, that are marked as encoded in the given bitmap.
+   * The elements are allocated in groups of @c n consecutive elements within a bank. The bitmap
+   * is swept once and adjacent groups, that are not allocated yet, are coalesced into a single
+   * run. Hence, densely populated tables are allocated by a few large elements. The given
+   * function gets called with the address and size of every newly allocated run.
+   * @returns The number of encoded elements. */
+  template <class Bitmap, class Init>
+  unsigned int allocateTable(const MemoryTable &table, const Bitmap &bitmap, unsigned int n, Init init) {
+    // Groups may only be coalesced, if there are no gaps between the elements.
+    bool contiguous = (table.stride == table.elementSize);
+    uint32_t runStart = 0, runEnd = 0;
+    auto flush = [this, &init, &runStart, &runEnd]() {
+      if (runEnd > runStart) {
+        image(0).addElement(runStart, runEnd-runStart);
+        init(runStart, runEnd-runStart);
+      }
+      runStart = runEnd = 0;
+    };
 
+    unsigned int encoded = 0;
+    for (int i=bitmap.nextEncoded(0); (i>=0) && (unsigned(i)<table.count); i=bitmap.nextEncoded(i+1)) {
+      encoded++;
+      uint32_t addr = table.groupAddress(i, n);
+      // Group is part of the current run already
+      if ((runStart <= addr) && (addr < runEnd))
+        continue;
+      if (isAllocated(addr, 0)) {
+        flush();
+        continue;
+      }
+      if ((! contiguous) || (addr != runEnd)) {
+        flush();
+        runStart = addr;
+      }
+      runEnd = addr + table.groupSize(n);
+    }
+    flush();
+    return encoded;
+  }
+  /** Allocates the elements of the given table, that are marked as encoded in the given bitmap,
+   * in groups of @c n consecutive elements. */
+  template <class Bitmap>
+  unsigned int allocateTable(const MemoryTable &table, const Bitmap &bitmap, unsigned int n=1) {
+    return allocateTable(table, bitmap, n, [](uint32_t, uint32_t) { });
+  }
+
+  /** Clears the codeplug and allocates all elements that must be written back to the device (see
+   * @c allocateUpdated). The resulting image only depends on the radio model, hence it is kept as
+   * a skeleton per model and copied on subsequent calls. */
+  void allocateSkeleton();
   /** Allocates the bitmaps. This is also performed during a clear. */
   virtual bool allocateBitmaps() = 0;
   /** Sets all bitmaps for the given config. */
@@ -2980,9 +3132,12 @@ protected:
 protected:
   /** Holds the image label. */
   QString _label;
+  /** The progress of the encoding, if reported. */
+  EncodeProgress *_encodeProgress;
 
   // Allow access to protected allocation methods.
   friend class AnytoneRadio;
+  friend class AnytoneEncodeTask;
 };
 
 #endif // ANYTONECODEPLUG_HH
@@ -1,8 +1,8 @@
 #include "anytone_filereader.hh"
-#include <QFile>
-#include <QFileInfo>
 #include <QtEndian>
 
+#include "mappedfile.hh"
+
 #include "d868uv_filereader.hh"
 #include "d878uv_filereader.hh"
 
@@ -83,41 +83,29 @@ AnytoneFileReader::read() {
 bool
 AnytoneFileReader::read(const QString &filename, Config *config, QString &message)
 {
-  QFileInfo info(filename);
-  if (! info.exists()) {
-    message = QObject::tr("Cannot open file '%1': File does not exist.").arg(filename);
-    return false;
-  }
-
-  QFile file(filename);
-  if (! file.open(QFile::ReadOnly)) {
-    message = QObject::tr("Cannot open file '%1': %2.").arg(filename).arg(file.errorString());
+  // Map file, the readers decode directly from the mapped memory
+  MappedFile file;
+  ErrorStack err;
+  if (! file.open(filename, err)) {
+    message = err.format();
     return false;
   }
 
   file_header head;
-  if (sizeof(file_header) != file.read((char *)&head, sizeof(file_header))) {
+  if (! file.copy(0, &head, sizeof(file_header), err)) {
     message = QObject::tr("Cannot read header from file '%1': %2.")
-        .arg(filename).arg(file.errorString());
-    file.close();
+        .arg(filename).arg(err.format());
     return false;
   }
 
   size_t size = qFromLittleEndian(head.payload_size)+14;
-  if (size != (size_t)info.size()) {
+  if (size != file.size()) {
     message = QObject::tr("Malformed header in file '%1': Mismatching content size. Expected %2, got %3.")
-        .arg(filename).arg(info.size()-14).arg(size-14);
-    file.close();
+        .arg(filename).arg(file.size()-14).arg(size-14);
     return false;
   }
 
-  uint8_t *data = file.map(0, size);
-  if (nullptr == data) {
-    message = QObject::tr("Cannot mmap file '%1': %2.")
-        .arg(filename).arg(file.errorString());
-    file.close();
-    return false;
-  }
+  const uint8_t *data = file.data();
 
   QString cps_version = QString::fromLocal8Bit(head.version, strnlen(head.version,5));
   QString model = QString::fromLocal8Bit(head.modelname, strnlen(head.modelname,7));
@@ -135,30 +123,24 @@ AnytoneFileReader::read(const QString &filename, Config *config, QString &messag
   } else {
     message = QObject::tr("Cannot read codeplug file '%1': Unknown model '%2'.")
         .arg(filename).arg(model);
-    file.unmap(data);
-    file.close();
     return false;
   }
 
   if (nullptr == reader) {
     message = QObject::tr("Cannot read codeplug file '%1': Model '%2' not implemented yet.")
         .arg(filename).arg(model);
-    file.unmap(data);
-    file.close();
     return false;
   }
 
   // Clear config
   config->reset();
 
-  if (! reader->read()) {
+  bool ok = reader->read();
+  delete reader;
+  if (! ok) {
     message = QObject::tr("Cannot read codeplug file '%1': %2").arg(filename).arg(message);
-    file.unmap(data);
-    file.close();
     return false;
   }
 
-  file.unmap(data);
-  file.close();
   return true;
 }
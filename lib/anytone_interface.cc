@@ -1,10 +1,16 @@
 #include "anytone_interface.hh"
 #include "logger.hh"
 #include <QtEndian>
+#include <QElapsedTimer>
 
 #define USB_VID 0x28e9
 #define USB_PID 0x018a
 
+/** Default number of read requests kept in flight. */
+#define READ_PIPELINE_DEPTH 16
+/** Default number of write requests sent before collecting ACKs. */
+#define WRITE_WINDOW 16
+
 /* ********************************************************************************************* *
  * Implementation of AnytoneInterface::ReadRequest
  * ********************************************************************************************* */
@@ -86,7 +92,8 @@ AnytoneInterface::RadioVariant::isValid() const {
  * Implementation of AnytoneInterface
  * ********************************************************************************************* */
 AnytoneInterface::AnytoneInterface(const USBDeviceDescriptor &descriptor, const ErrorStack &err, QObject *parent)
-  : USBSerial(descriptor, QSerialPort::Baud115200, err, parent), _state(STATE_INITIALIZED), _info()
+  : USBSerial(descriptor, QSerialPort::Baud115200, err, parent), _state(STATE_INITIALIZED), _info(),
+    _readPipelineDepth(READ_PIPELINE_DEPTH), _writeWindow(WRITE_WINDOW)
 {
   if (isOpen()) {
     _state = STATE_OPEN;
@@ -181,6 +188,7 @@ AnytoneInterface::write_start(uint32_t bank, uint32_t addr, const ErrorStack &er
 bool
 AnytoneInterface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err)
 {
+  _transferStatistics.setAddress(addr);
   if (0 != bank) {
     errMsg(err) << "Anytone: Cannot write to bank " << bank << ". There is only one (idx=0).";
     return false;
@@ -191,9 +199,12 @@ AnytoneInterface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes,
     return false;
   }
 
-  //logDebug() << "Anytone: Write " << nbytes << "b to addr 0x" << QString::number(addr, 16) << "...";
+  logDebug() << "Anytone: Write " << nbytes << "b to addr 0x" << QString::number(addr, 16) << "...";
 
   for (int i=0; i<nbytes; i+=16) {
+    if (! checkCanceled(err))
+      return false;
+    TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Write, 16);
     uint8_t ack;
     WriteRequest req(addr+i, (const char *)(data+i));
     if (! send_receive((const char *)&req, sizeof(WriteRequest),(char *)&ack, 1, err)) {
@@ -210,6 +221,91 @@ AnytoneInterface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes,
   return true;
 }
 
+bool
+AnytoneInterface::write_windowed(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err)
+{
+  _transferStatistics.setAddress(addr);
+  if (_writeWindow < 2)
+    return write(bank, addr, data, nbytes, err);
+
+  if (0 != bank) {
+    errMsg(err) << "Anytone: Cannot write to bank " << bank << ". There is only one (idx=0).";
+    return false;
+  }
+
+  if (STATE_PROGRAM != _state) {
+    errMsg(err) << "Anytone: Cannot write data to device: Not in programming mode.";
+    return false;
+  }
+
+  QByteArray requests, acks;
+  for (int i=0; i<nbytes;) {
+    // Stop between windows, no acknowledgements are pending then
+    if (! checkCanceled(err))
+      return false;
+    // Assemble a window of write requests
+    int n = std::min(int(_writeWindow), (nbytes-i+15)/16);
+    TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Write, 16*n);
+    requests.resize(0);
+    for (int j=0; j<n; j++) {
+      WriteRequest req(addr+i+16*j, (const char *)(data+i+16*j));
+      requests.append((const char *)&req, sizeof(WriteRequest));
+    }
+
+    // Send all requests at once
+    if (requests.size() != QSerialPort::write(requests.constData(), requests.size())) {
+      errMsg(err) << "Cannot send command to device.";
+      close();
+      _state = STATE_ERROR;
+      return false;
+    }
+
+    // Collect ACKs
+    acks.resize(n);
+    char *p = acks.data();
+    int len = acks.size();
+    QElapsedTimer wait;
+    while (len > 0) {
+      wait.start();
+      if (! waitForReadyRead(_timing.timeout()))
+        break;
+      _timing.addRoundTrip(wait.nsecsElapsed()/1000);
+      int r = QSerialPort::read(p, len);
+      if (r < 0)
+        break;
+      p += r; len -= r;
+    }
+    int nrecv = acks.size()-len;
+
+    // Check ACKs in order
+    for (int j=0; j<n; j++) {
+      if ((j >= nrecv) || (0x06 != acks.at(j))) {
+        logWarn() << "Anytone: Windowed write failed at 0x" << QString::number(addr+i, 16)
+                  << ": " << ((j >= nrecv) ? QString("Timeout") : QString("NAK %1").arg(int(acks.at(j))))
+                  << ". Fall back to lock-step write.";
+        _writeWindow = 1;
+        _transferStatistics.addRetry();
+        discard_pending();
+        // Writes are idempotent, hence re-write everything not acknowledged yet
+        return write(bank, addr+i, data+i, nbytes-i, err);
+      }
+      i += 16;
+    }
+  }
+
+  return true;
+}
+
+unsigned
+AnytoneInterface::writeWindow() const {
+  return _writeWindow;
+}
+
+void
+AnytoneInterface::setWriteWindow(unsigned window) {
+  _writeWindow = std::max(1U, window);
+}
+
 bool
 AnytoneInterface::write_finish(const ErrorStack &err) {
   Q_UNUSED(err)
@@ -228,6 +324,7 @@ AnytoneInterface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err
 
 bool
 AnytoneInterface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  _transferStatistics.setAddress(addr);
   if (0 != bank) {
     errMsg(err) << "Anytone: Cannot read from bank " << bank << ". There is only one (idx=0).";
     return false;
@@ -238,9 +335,12 @@ AnytoneInterface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes,
     return false;
   }
 
-  //logDebug() << "Anytone: Read " << nbytes << "b from addr 0x" << QString::number(addr, 16) << "...";
+  logDebug() << "Anytone: Read " << nbytes << "b from addr 0x" << QString::number(addr, 16) << "...";
 
   for (int i=0; i<nbytes; i+=16) {
+    if (! checkCanceled(err))
+      return false;
+    TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Read, 16);
     ReadRequest req(addr + i);
     ReadResponse resp;
     if (! send_receive((const char *)&req, sizeof(ReadRequest),
@@ -259,6 +359,94 @@ AnytoneInterface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes,
   return true;
 }
 
+bool
+AnytoneInterface::read_pipelined(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  _transferStatistics.setAddress(addr);
+  if (_readPipelineDepth < 2)
+    return read(bank, addr, data, nbytes, err);
+
+  if (0 != bank) {
+    errMsg(err) << "Anytone: Cannot read from bank " << bank << ". There is only one (idx=0).";
+    return false;
+  }
+
+  if (STATE_PROGRAM != _state) {
+    errMsg(err) << "Anytone: Cannot read data from device: Not in programming mode.";
+    return false;
+  }
+
+  QByteArray requests, responses;
+  for (int i=0; i<nbytes;) {
+    // Stop between windows, no responses are pending then
+    if (! checkCanceled(err))
+      return false;
+    // Assemble a window of read requests
+    int n = std::min(int(_readPipelineDepth), (nbytes-i+15)/16);
+    TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Read, 16*n);
+    requests.resize(0);
+    for (int j=0; j<n; j++) {
+      ReadRequest req(addr + i + 16*j);
+      requests.append((const char *)&req, sizeof(ReadRequest));
+    }
+
+    // Send all requests at once
+    if (requests.size() != QSerialPort::write(requests.constData(), requests.size())) {
+      errMsg(err) << "Cannot send command to device.";
+      close();
+      _state = STATE_ERROR;
+      return false;
+    }
+
+    // Collect responses
+    responses.resize(n*sizeof(ReadResponse));
+    char *p = responses.data();
+    int len = responses.size();
+    QElapsedTimer wait;
+    while (len > 0) {
+      wait.start();
+      if (! waitForReadyRead(_timing.timeout()))
+        break;
+      _timing.addRoundTrip(wait.nsecsElapsed()/1000);
+      int r = QSerialPort::read(p, len);
+      if (r < 0)
+        break;
+      p += r; len -= r;
+    }
+    // Number of complete responses received
+    int nrecv = (responses.size()-len)/sizeof(ReadResponse);
+
+    // Check responses in order
+    for (int j=0; j<n; j++) {
+      QString msg;
+      const ReadResponse *resp = (const ReadResponse *)(responses.constData() + j*sizeof(ReadResponse));
+      if ((j >= nrecv) || (! resp->check(addr+i, msg))) {
+        if (j >= nrecv)
+          msg = tr("Timeout");
+        logWarn() << "Anytone: Pipelined read failed at 0x" << QString::number(addr+i, 16)
+                  << ": " << msg << ". Fall back to lock-step read.";
+        _readPipelineDepth = 1;
+        _transferStatistics.addRetry();
+        discard_pending();
+        return read(bank, addr+i, data+i, nbytes-i, err);
+      }
+      memcpy(data+i, resp->data, 16);
+      i += 16;
+    }
+  }
+
+  return true;
+}
+
+unsigned
+AnytoneInterface::readPipelineDepth() const {
+  return _readPipelineDepth;
+}
+
+void
+AnytoneInterface::setReadPipelineDepth(unsigned depth) {
+  _readPipelineDepth = std::max(1U, depth);
+}
+
 bool
 AnytoneInterface::read_finish(const ErrorStack &err) {
   Q_UNUSED(err)
@@ -289,6 +477,7 @@ AnytoneInterface::enter_program_mode(const ErrorStack &err) {
     return false;
   }
 
+  TransferStatistics::Timer timer(_transferStatistics);
   char ack[3];
   // send "enter program mode" command
   if (! send_receive("PROGRAM", 7, ack, 3, err)) {
@@ -370,10 +559,11 @@ AnytoneInterface::send_receive(const char *cmd, int clen, char *resp, int rlen,
   }
 
   // Read from device until complete response has been read
+  QElapsedTimer timer; timer.start();
   char *p = resp;
   int len = rlen;
   while (len > 0) {
-    if (! waitForReadyRead(1000)) {
+    if (! waitForReadyRead(_timing.timeout())) {
       errMsg(err) << "No response from device: Timeout.";
       close();
       _state = STATE_ERROR;
@@ -391,6 +581,13 @@ AnytoneInterface::send_receive(const char *cmd, int clen, char *resp, int rlen,
     len-=r;
   }
 
+  _timing.addRoundTrip(timer.nsecsElapsed()/1000);
   // done
   return true;
 }
+
+void
+AnytoneInterface::discard_pending() {
+  // Wait for any response still in transit and drop it
+  discardInput(100);
+}
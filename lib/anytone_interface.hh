@@ -51,12 +51,33 @@ public:
 
   bool read_start(uint32_t bank, uint32_t addr, const ErrorStack &err=ErrorStack());
   bool read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  /** Reads a chunk of data like @c read, but keeps up to @c readPipelineDepth() read requests in
+   * flight. The responses are matched against the requested addresses. On any mismatch or
+   * timeout, the remaining data is read in lock-step using @c read and pipelining gets disabled
+   * for this interface. */
+  bool read_pipelined(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
   bool read_finish(const ErrorStack &err=ErrorStack());
 
+  /** Returns the number of read requests kept in flight by @c read_pipelined. */
+  unsigned readPipelineDepth() const;
+  /** Sets the number of read requests kept in flight by @c read_pipelined. A depth of 1 is
+   * equivalent to a lock-step read. */
+  void setReadPipelineDepth(unsigned depth);
+
   bool write_start(uint32_t bank, uint32_t addr, const ErrorStack &err=ErrorStack());
   bool write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  /** Writes a chunk of data like @c write, but sends up to @c writeWindow() write requests before
+   * collecting the ACKs. On a NAK or timeout, the remaining data is written in lock-step using
+   * @c write and the window gets shrunk to 1 for this interface. */
+  bool write_windowed(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
   bool write_finish(const ErrorStack &err=ErrorStack());
 
+  /** Returns the number of write requests sent by @c write_windowed before collecting ACKs. */
+  unsigned writeWindow() const;
+  /** Sets the number of write requests sent by @c write_windowed before collecting ACKs. A window
+   * of 1 is equivalent to a lock-step write. */
+  void setWriteWindow(unsigned window);
+
   bool reboot(const ErrorStack &err=ErrorStack());
 
 public:
@@ -74,6 +95,9 @@ protected:
   bool leave_program_mode(const ErrorStack &err=ErrorStack());
   /** Internal used method to send messages to and receive responses from radio. */
   bool send_receive(const char *cmd, int clen, char *resp, int rlen, const ErrorStack &err=ErrorStack());
+  /** Discards any pending responses from the radio. Used to re-synchronize the interface after a
+   * failed pipelined transfer. */
+  void discard_pending();
 
 protected:
   /** Binary representation of a read request to the radio. */
@@ -137,6 +161,10 @@ protected:
   State _state;
   /** Holds the radio info. */
   RadioVariant _info;
+  /** Number of read requests kept in flight by @c read_pipelined. */
+  unsigned _readPipelineDepth;
+  /** Number of write requests sent by @c write_windowed before collecting ACKs. */
+  unsigned _writeWindow;
 };
 
 #endif // ANYTONEINTERFACE_HH
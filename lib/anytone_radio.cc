@@ -4,13 +4,90 @@
 #include "config.hh"
 #include "logger.hh"
 #include "configcopyvisitor.hh"
+#include "dfupatch.hh"
+#include "encodesession.hh"
+#include "utils.hh"
+#include <QThreadPool>
+#include <QRunnable>
+#include <QBitArray>
 
 #define RBSIZE 16
 #define WBSIZE 16
+/** Size of the chunks written at once during the callsign DB upload. Only affects the progress
+ * reporting granularity. */
+#define WCHUNKSIZE 1024
+
+
+/** Indexes the config of the encode session on a worker thread, while the current codeplug gets
+ * read from the device. Indexing only reads the config and fills the context of the session. */
+class AnytoneIndexTask: public QRunnable
+{
+public:
+  AnytoneIndexTask(EncodeSession *session)
+    : QRunnable(), _session(session), _result(false), _err()
+  {
+    setAutoDelete(false);
+  }
+
+  void run() {
+    _result = _session->index(_err);
+  }
+
+  bool result() const {
+    return _result;
+  }
+
+  const ErrorStack &errors() const {
+    return _err;
+  }
+
+protected:
+  EncodeSession *_session;
+  bool _result;
+  ErrorStack _err;
+};
+
+
+/** Encodes the indexed config on a worker thread, while the encoded sections get uploaded. The
+ * progress of the encoding is reported to the given tracker, which gets completed in any case. */
+class AnytoneEncodeTask: public QRunnable
+{
+public:
+  AnytoneEncodeTask(AnytoneCodeplug *codeplug, EncodeSession *session, const Codeplug::Flags &flags,
+                    EncodeProgress &progress)
+    : QRunnable(), _codeplug(codeplug), _session(session), _flags(flags), _progress(progress),
+      _result(false), _err()
+  {
+    setAutoDelete(false);
+  }
+
+  void run() {
+    _codeplug->setEncodeProgress(&_progress);
+    _result = _codeplug->encodeIndexed(_session->context(), _flags, _err);
+    _codeplug->setEncodeProgress(nullptr);
+    _progress.finish(_result);
+  }
+
+  bool result() const {
+    return _result;
+  }
+
+  const ErrorStack &errors() const {
+    return _err;
+  }
+
+protected:
+  AnytoneCodeplug *_codeplug;
+  EncodeSession *_session;
+  Codeplug::Flags _flags;
+  EncodeProgress &_progress;
+  bool _result;
+  ErrorStack _err;
+};
 
 
 AnytoneRadio::AnytoneRadio(const QString &name, AnytoneInterface *device, QObject *parent)
-  : Radio(parent), _name(name), _dev(device), _codeplugFlags(), _config(nullptr),
+  : Radio(parent), _name(name), _dev(device), _codeplugFlags(), _session(nullptr), _config(nullptr),
     _codeplug(nullptr), _callsigns(nullptr)
 {
   // Check if device is open
@@ -29,6 +106,26 @@ AnytoneRadio::~AnytoneRadio() {
     _dev->deleteLater();
     _dev = nullptr;
   }
+  if (_session)
+    delete _session;
+}
+
+TransferStatistics
+AnytoneRadio::transferStatistics() const {
+  if (nullptr == _dev)
+    return TransferStatistics();
+  return _dev->transferStatistics();
+}
+
+void
+AnytoneRadio::moveInterfaceToThread(QThread *thread) {
+  if (_dev)
+    _dev->moveToThread(thread);
+}
+
+RadioInterface *
+AnytoneRadio::radioInterface() const {
+  return _dev;
 }
 
 const QString &
@@ -46,6 +143,21 @@ AnytoneRadio::codeplug() {
   return *_codeplug;
 }
 
+const CallsignDB *
+AnytoneRadio::callsignDB() const {
+  return _callsigns;
+}
+
+CallsignDB *
+AnytoneRadio::callsignDB() {
+  return _callsigns;
+}
+
+bool
+AnytoneRadio::hasSelectiveDownload() const {
+  return true;
+}
+
 bool
 AnytoneRadio::startDownload(bool blocking, const ErrorStack &err) {
   if (StatusIdle != _task)
@@ -69,19 +181,30 @@ AnytoneRadio::startDownload(bool blocking, const ErrorStack &err) {
 
 bool
 AnytoneRadio::startUpload(Config *config, bool blocking, const Codeplug::Flags &flags, const ErrorStack &err) {
-  if (StatusIdle != _task)
+  // Cannot upload null-pointer
+  if ((StatusIdle != _task) || (nullptr == config))
     return false;
 
-  if (_config)
-    delete _config;
+  // The config is already preprocessed
+  return startUploadSession(new EncodeSession(config, *_codeplug, true), blocking, flags, err);
+}
+
+bool
+AnytoneRadio::startUploadSession(EncodeSession *session, bool blocking, const Codeplug::Flags &flags,
+                                 const ErrorStack &err)
+{
+  if (StatusIdle != _task) {
+    delete session;
+    return false;
+  }
 
-  // Cannot upload null-pointer
-  if (nullptr == (_config = config))
+  if (! setSession(session, err))
     return false;
 
   _task = StatusUpload;
   _codeplugFlags = flags;
   _errorStack = err;
+  _checkpoint.reset();
 
   if (blocking) {
     run();
@@ -92,8 +215,9 @@ AnytoneRadio::startUpload(Config *config, bool blocking, const Codeplug::Flags &
   if (_dev && _dev->isOpen())
     _dev->moveToThread(this);
 
-  // also, move config to thread
-  _config->moveToThread(this);
+  // also, move config to thread, unless it is frozen and thus may be shared between threads
+  if (! _config->isFrozen())
+    _config->moveToThread(this);
 
   start();
 
@@ -101,14 +225,84 @@ AnytoneRadio::startUpload(Config *config, bool blocking, const Codeplug::Flags &
 }
 
 bool
-AnytoneRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignDB::Selection &selection, const ErrorStack &err) {
-  Q_UNUSED(db);
-  Q_UNUSED(blocking);
+AnytoneRadio::setSession(EncodeSession *session, const ErrorStack &err) {
+  // Deleting the previous session also deletes its config
+  if (_session)
+    delete _session;
+  _session = session;
+  if (nullptr == (_config = _session->uploadConfig(err))) {
+    errMsg(err) << "Cannot upload codeplug to " << name() << ".";
+    return false;
+  }
+  return true;
+}
 
-  _callsigns->encode(db, selection);
+bool
+AnytoneRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignDB::Selection &selection, const ErrorStack &err) {
+  // Encode the DB in the background, the upload starts once the layout is known
+  if (! _callsigns->startEncoding(db, selection, err))
+    return false;
 
   _task = StatusUploadCallsigns;
   _errorStack = err;
+  _checkpoint.reset();
+
+  if (blocking) {
+    run();
+    return (StatusIdle == _task);
+  }
+
+  // If non-blocking -> move device to this thread
+  if (_dev && _dev->isOpen())
+    _dev->moveToThread(this);
+  start();
+
+  return true;
+}
+
+bool
+AnytoneRadio::startUploadAll(Config *config, UserDatabase *db, bool blocking, const Codeplug::Flags &flags,
+                             const CallsignDB::Selection &selection, const ErrorStack &err)
+{
+  // Cannot upload null-pointer
+  if ((StatusIdle != _task) || (nullptr == config))
+    return false;
+
+  // The config is already preprocessed
+  if (! setSession(new EncodeSession(config, *_codeplug, true), err))
+    return false;
+
+  // Encode the DB in the background, while the codeplug gets uploaded
+  if (! _callsigns->startEncoding(db, selection, err))
+    return false;
+
+  _task = StatusUploadAll;
+  _codeplugFlags = flags;
+  _errorStack = err;
+  _checkpoint.reset();
+
+  if (blocking) {
+    run();
+    return (StatusIdle == _task);
+  }
+
+  // If non-blocking -> move device to this thread
+  if (_dev && _dev->isOpen())
+    _dev->moveToThread(this);
+
+  // also, move config to thread, unless it is frozen and thus may be shared between threads
+  if (! _config->isFrozen())
+    _config->moveToThread(this);
+
+  start();
+
+  return true;
+}
+
+bool
+AnytoneRadio::startResume(bool blocking, const ErrorStack &err) {
+  if (! restoreCheckpoint(err))
+    return false;
 
   if (blocking) {
     run();
@@ -156,6 +350,7 @@ AnytoneRadio::run() {
     emit uploadStarted();
 
     if (! upload()) {
+      storeCheckpoint();
       _dev->reboot();
       _dev->close();
       _task = StatusError;
@@ -163,6 +358,7 @@ AnytoneRadio::run() {
       return;
     }
 
+    clearCheckpoint();
     _dev->reboot();
     _dev->close();
     _task = StatusIdle;
@@ -177,6 +373,7 @@ AnytoneRadio::run() {
     emit uploadStarted();
 
     if (! uploadCallsigns()) {
+      storeCheckpoint();
       _dev->reboot();
       _dev->close();
       _task = StatusError;
@@ -184,6 +381,39 @@ AnytoneRadio::run() {
       return;
     }
 
+    clearCheckpoint();
+    _dev->reboot();
+    _dev->close();
+    _task = StatusIdle;
+    emit uploadComplete(this);
+  } else if (StatusUploadAll == _task) {
+    if ((nullptr==_dev) || (! _dev->isOpen())) {
+      _task = StatusError;
+      emit uploadError(this);
+      return;
+    }
+
+    emit uploadStarted();
+
+    // Stay in programming mode between codeplug and callsign DB. Once the codeplug is written,
+    // a checkpoint refers to the callsign DB.
+    bool ok = upload();
+    if (ok) {
+      clearCheckpoint();
+      _task = StatusUploadCallsigns;
+      ok = uploadCallsigns();
+    }
+
+    if (! ok) {
+      storeCheckpoint();
+      _dev->reboot();
+      _dev->close();
+      _task = StatusError;
+      emit uploadError(this);
+      return;
+    }
+
+    clearCheckpoint();
     _dev->reboot();
     _dev->close();
     _task = StatusIdle;
@@ -198,7 +428,16 @@ AnytoneRadio::download() {
     return false;
   }
 
+  // Select the sections to download, they apply to this download only
+  _codeplug->setSections(_downloadSections);
+  _downloadSections = Codeplug::Sections();
+  if (! _codeplug->sections().isAll())
+    logInfo() << "Download sections " << _codeplug->sections().format() << " only.";
+
   logDebug() << "Download of " << _codeplug->image(0).numElements() << " bitmaps.";
+  enterPhase(PhaseRead);
+  // All elements get downloaded entirely, no need to initialize them
+  _codeplug->prepareOverwrite();
 
   // Download bitmaps
   for (int n=0; n<_codeplug->image(0).numElements(); n++) {
@@ -208,12 +447,13 @@ AnytoneRadio::download() {
       errMsg(_errorStack) << "Cannot download codeplug.";
       return false;
     }
-    emit downloadProgress(float(n*100)/_codeplug->image(0).numElements());
+    reportDownloadProgress(float(n*100)/_codeplug->image(0).numElements());
   }
 
   // Allocate remaining memory sections
   unsigned nstart = _codeplug->image(0).numElements();
   _codeplug->allocateForDecoding();
+  _codeplug->prepareOverwrite();
 
   // Check every segment in the remaining codeplug
   for (int n=nstart; n<_codeplug->image(0).numElements(); n++) {
@@ -226,15 +466,18 @@ AnytoneRadio::download() {
     }
   }
 
-  // Download remaining memory sections
+  // Download remaining memory sections, these are usually large contiguous elements. The
+  // codeplug may start decoding the received elements meanwhile.
+  _codeplug->startProgressiveDecoding();
   for (int n=nstart; n<_codeplug->image(0).numElements(); n++) {
     unsigned addr = _codeplug->image(0).element(n).address();
     unsigned size = _codeplug->image(0).element(n).data().size();
-    if (! _dev->read(0, addr, _codeplug->data(addr), size, _errorStack)) {
+    if (! _dev->read_pipelined(0, addr, _codeplug->data(addr), size, _errorStack)) {
       errMsg(_errorStack) << "Cannot download codeplug.";
       return false;
     }
-    emit downloadProgress(float(n*100)/_codeplug->image(0).numElements());
+    _codeplug->elementReady(0, addr, size);
+    reportDownloadProgress(float(n*100)/_codeplug->image(0).numElements());
   }
 
   return true;
@@ -247,51 +490,207 @@ AnytoneRadio::upload() {
     return false;
   }
 
-  // Download bitmaps first
-  size_t nbitmaps = _codeplug->numImages();
-  for (int n=0; n<_codeplug->image(0).numElements(); n++) {
-    unsigned addr = _codeplug->image(0).element(n).address();
-    unsigned size = _codeplug->image(0).element(n).data().size();
-    if (! _dev->read(0, addr, _codeplug->data(addr), size, _errorStack)) {
-      errMsg(_errorStack) << "Cannot read codeplug for update.";
+  // If resumed, the image being written was restored from the checkpoint. Otherwise, read the
+  // device memory and encode the codeplug in the background. The pool waits for the encoding on
+  // every return.
+  DFUFile::Image current;
+  EncodeProgress encoding;
+  AnytoneEncodeTask encodeTask(_codeplug, _session, _codeplugFlags, encoding);
+  QThreadPool pool;
+  auto encodeFailed = [&]() {
+    pool.waitForDone();
+    _errorStack.take(encodeTask.errors());
+    errMsg(_errorStack) << "Cannot encode codeplug.";
+    // The image is incomplete, hence the upload must not be resumed
+    _checkpoint.reset();
+    return false;
+  };
+
+  if (_checkpoint.isResume()) {
+    logInfo() << "Resume upload to " << name() << " from checkpoint.";
+    _codeplug->image(0).compact();
+  } else {
+    if (! prepareUpload(current))
       return false;
+    // Once allocated, the image is compacted and its layout is fixed
+    encoding.start();
+    pool.start(&encodeTask);
+    if (! encoding.waitAllocated())
+      return encodeFailed();
+  }
+  const DFUFile::Image &image = _codeplug->image(0);
+
+  // The modified bytes are only known once encoded, hence the progress counts all bytes
+  logDebug() << "Upload modified blocks of " << image.memSize() << "b codeplug.";
+  enterPhase(PhaseWrite, image.memSize());
+  size_t totalBytes = std::max(1U, image.memSize()), bytesDone = 0;
+  QVector<QBitArray> streamed(image.numElements());
+  for (int n=0; n<image.numElements(); n++)
+    streamed[n].resize((image.element(n).memSize()+WBSIZE-1)/WBSIZE);
+
+  _checkpoint.begin();
+  _readback.reset();
+  _readback.setBlockSize(WCHUNKSIZE);
+
+  // While encoding, upload the modified blocks of all sections encoded so far. The checkpoint is
+  // not confirmed, as these blocks are not written in order.
+  for (unsigned int generation=0; ! encoding.isDone(); generation=encoding.waitProgress(generation)) {
+    for (int n=0; n<image.numElements(); n++) {
+      unsigned addr = image.element(n).address();
+      unsigned size = image.element(n).memSize();
+      for (unsigned offset=0; offset<size;) {
+        unsigned start = offset;
+        while ((offset < size) && ((offset-start) < WCHUNKSIZE) && (! streamed[n].testBit(offset/WBSIZE))
+               && encoding.isEncoded(addr+offset, std::min(unsigned(WBSIZE), size-offset))) {
+          streamed[n].setBit(offset/WBSIZE);
+          offset += std::min(unsigned(WBSIZE), size-offset);
+        }
+        if (start == offset) {
+          offset += std::min(unsigned(WBSIZE), size-offset);
+          continue;
+        }
+        if (! writeModified(current, n, start, offset))
+          return false;
+        bytesDone += offset-start;
+        reportUploadProgress(50+float(bytesDone*50)/totalBytes);
+      }
     }
-    emit uploadProgress(float(n*25)/_codeplug->image(0).numElements());
   }
 
-  // Allocate all memory sections that must be read first
-  // and written back to the device more or less untouched
-  _codeplug->allocateUpdated();
-
-  // Download new memory sections for update
-  for (int n=nbitmaps; n<_codeplug->image(0).numElements(); n++) {
-    unsigned addr = _codeplug->image(0).element(n).address();
-    unsigned size = _codeplug->image(0).element(n).data().size();
-    if (! _dev->read(0, addr, _codeplug->data(addr), size, _errorStack)) {
-      errMsg(_errorStack) << "Cannot read codeplug for update.";
-      return false;
+  if (! encoding.waitDone())
+    return encodeFailed();
+
+  // Upload all remaining modified blocks in order, e.g., settings and bitmaps. Consecutive
+  // modified blocks are written at once.
+  for (int n=0; n<image.numElements(); n++) {
+    unsigned size = image.element(n).memSize();
+    for (unsigned offset=0; offset<size;) {
+      unsigned bsize = std::min(unsigned(WBSIZE), size-offset);
+      if ((! _checkpoint.pending(0, n, offset, bsize)) || streamed[n].testBit(offset/WBSIZE)) {
+        offset += bsize;
+        continue;
+      }
+      unsigned start = offset;
+      while ((offset < size) && ((offset-start) < WCHUNKSIZE) && (! streamed[n].testBit(offset/WBSIZE)))
+        offset += std::min(unsigned(WBSIZE), size-offset);
+      if (! writeModified(current, n, start, offset))
+        return false;
+      _checkpoint.confirm(0, n, offset);
+      bytesDone += offset-start;
+      reportUploadProgress(50+float(bytesDone*50)/totalBytes);
     }
-    emit uploadProgress(25+float(n*25)/_codeplug->image(0).numElements());
   }
 
-  // Update binary codeplug from config
-  if (! _codeplug->encode(_config, _codeplugFlags, _errorStack)) {
-    errMsg(_errorStack) << "Cannot encode codeplug.";
+  if (! verifyUpload()) {
+    errMsg(_errorStack) << "Cannot verify codeplug.";
     return false;
   }
 
-  // Sort all elements before uploading
-  _codeplug->image(0).sort();
+  // Remember what has been written to the device
+  if (! _imageCacheId.isEmpty())
+    _imageCache.store(name(), _imageCacheId, *_codeplug);
 
-  // Upload all elements back to the device
-  for (int n=0; n<_codeplug->image(0).numElements(); n++) {
-    unsigned addr = _codeplug->image(0).element(n).address();
-    unsigned size = _codeplug->image(0).element(n).data().size();
-    if (! _dev->write(0, addr, _codeplug->data(addr), size, _errorStack)) {
+  return true;
+}
+
+bool
+AnytoneRadio::writeModified(const DFUFile::Image &current, int n, unsigned begin, unsigned end) {
+  const DFUFile::Image &image = _codeplug->image(0);
+  unsigned addr = image.element(n).address();
+  for (unsigned offset=begin; offset<end;) {
+    unsigned bsize = std::min(unsigned(WBSIZE), end-offset);
+    if (! image.differs(current, addr+offset, bsize)) {
+      offset += bsize;
+      continue;
+    }
+    unsigned start = offset;
+    while ((offset < end) && image.differs(current, addr+offset, bsize)) {
+      offset += bsize;
+      bsize = std::min(unsigned(WBSIZE), end-offset);
+    }
+    if (! _dev->write_windowed(0, addr+start, _codeplug->data(addr+start), offset-start, _errorStack)) {
       errMsg(_errorStack) << "Cannot write codeplug.";
       return false;
     }
-    emit uploadProgress(50+float(n*50)/_codeplug->image(0).numElements());
+    _readback.add(0, addr+start, _codeplug->data(addr+start), offset-start);
+  }
+  return true;
+}
+
+bool
+AnytoneRadio::prepareUpload(DFUFile::Image &current) {
+  // Index the config in parallel to reading the device memory, unless the session indexed it
+  // before. The pool waits for the task on every return.
+  AnytoneIndexTask indexTask(_session);
+  QThreadPool pool;
+  pool.start(&indexTask);
+
+  // Try to obtain the current device memory from the image cache first
+  enterPhase(PhaseRead);
+  DFUFile cached;
+  bool restored = _codeplugFlags.updateCodePlug && (! _imageCacheId.isEmpty())
+      && _imageCache.load(name(), _imageCacheId, cached) && (1 == cached.numImages())
+      && _codeplug->image(0).copyData(cached.image(0));
+
+  // Download bitmaps first
+  size_t nbitmaps = _codeplug->image(0).numElements();
+  if (! restored) {
+    for (int n=0; n<_codeplug->image(0).numElements(); n++) {
+      unsigned addr = _codeplug->image(0).element(n).address();
+      unsigned size = _codeplug->image(0).element(n).data().size();
+      if (! _dev->read(0, addr, _codeplug->data(addr), size, _errorStack)) {
+        errMsg(_errorStack) << "Cannot read codeplug for update.";
+        return false;
+      }
+      reportUploadProgress(float(n*25)/_codeplug->image(0).numElements());
+    }
+  }
+
+  // Allocate all memory sections that must be read first
+  // and written back to the device more or less untouched
+  _codeplug->allocateUpdated();
+
+  if (restored) {
+    // Check if the cached image covers all elements and matches the device memory
+    restored = _codeplug->image(0).copyData(cached.image(0))
+        && ImageCache::verify(_dev, cached.image(0), RBSIZE);
+    if (restored) {
+      logInfo() << "Use cached image of " << name() << " '" << _imageCacheId << "', skip read.";
+    } else {
+      logInfo() << "Cached image of " << name() << " '" << _imageCacheId
+                << "' is outdated, read codeplug from device.";
+      // Bitmaps were taken from the outdated cache, hence read them too
+      nbitmaps = 0;
+    }
+  }
+
+  // Download new memory sections for update
+  if (! restored) {
+    for (int n=nbitmaps; n<_codeplug->image(0).numElements(); n++) {
+      unsigned addr = _codeplug->image(0).element(n).address();
+      unsigned size = _codeplug->image(0).element(n).data().size();
+      if (! _dev->read_pipelined(0, addr, _codeplug->data(addr), size, _errorStack)) {
+        errMsg(_errorStack) << "Cannot read codeplug for update.";
+        return false;
+      }
+      reportUploadProgress(25+float(n*25)/_codeplug->image(0).numElements());
+    }
+  }
+
+  // Keep a copy of the current device memory, to upload modified blocks only. The copy is cheap
+  // as the element data is implicitly shared until modified by the encoder.
+  if (restored)
+    current = cached.image(0);
+  else if (_codeplugFlags.updateCodePlug)
+    current = _codeplug->image(0);
+
+  // The binary codeplug gets updated from the indexed config
+  enterPhase(PhaseEncode);
+  pool.waitForDone();
+  if (! indexTask.result()) {
+    _errorStack.take(indexTask.errors());
+    errMsg(_errorStack) << "Cannot encode codeplug.";
+    return false;
   }
 
   return true;
@@ -300,26 +699,130 @@ AnytoneRadio::upload() {
 
 bool
 AnytoneRadio::uploadCallsigns() {
-  // Sort all elements before uploading
-  _callsigns->image(0).sort();
+  // The callsign DB gets encoded in the background and is already compacted, see
+  // CallsignDB::startEncoding.
+
+  // If the callsign DB written last time is known and still on the device, upload changes only
+  QString cacheId = _imageCacheId + "-callsigns";
+  DFUFile cached;
+  if ((! _imageCacheId.isEmpty()) && (! _checkpoint.isResume())
+      && _imageCache.load(name(), cacheId, cached) && (1 == cached.numImages())
+      && ImageCache::verify(_dev, cached.image(0), RBSIZE)) {
+    // The changes are only known, once the entire DB is encoded
+    if (! _callsigns->finishEncoding(_errorStack))
+      return false;
+    logInfo() << "Use cached callsign DB of " << name() << " '" << _imageCacheId
+              << "', upload changes only.";
+    if (! uploadCallsignChanges(cached))
+      return false;
+    _imageCache.store(name(), cacheId, *_callsigns);
+    return true;
+  }
 
+  enterPhase(PhaseWrite, _callsigns->memSize());
   size_t totalBlocks = _callsigns->memSize()/WBSIZE;
   size_t blkWritten  = 0;
   // Upload all elements back to the device
+  _checkpoint.begin();
+  _readback.reset();
+  _readback.setBlockSize(WCHUNKSIZE);
   for (int n=0; n<_callsigns->image(0).numElements(); n++) {
     unsigned addr = _callsigns->image(0).element(n).address();
     unsigned size = _callsigns->image(0).element(n).data().size();
-    unsigned nblks = size/WBSIZE;
-    for (unsigned i=0; i<nblks; i++) {
-      if (! _dev->write(0, addr+i*WBSIZE, _callsigns->data(addr)+i*WBSIZE, WBSIZE, _errorStack)) {
+    for (unsigned offset=0; offset<size; offset+=WCHUNKSIZE) {
+      unsigned len = std::min(unsigned(WCHUNKSIZE), size-offset);
+      blkWritten += len/WBSIZE;
+      // Skip chunks written before, when resuming
+      if (! _checkpoint.pending(0, n, offset, len))
+        continue;
+      // Wait for the chunk being encoded
+      if (! _callsigns->waitEncoded(addr+offset, len)) {
+        _callsigns->finishEncoding(_errorStack);
+        // The DB is incomplete, hence the upload must not be resumed
+        _checkpoint.reset();
+        return false;
+      }
+      if (! _dev->write_windowed(0, addr+offset, _callsigns->data(addr)+offset, len, _errorStack)) {
+        errMsg(_errorStack) << "Cannot write callsign db.";
+        return false;
+      }
+      _checkpoint.confirm(0, n, offset+len);
+      _readback.add(0, addr+offset, _callsigns->data(addr)+offset, len);
+      reportUploadProgress(float(blkWritten*100)/totalBlocks);
+    }
+  }
+
+  if (! _callsigns->finishEncoding(_errorStack))
+    return false;
+
+  if (! verifyUpload()) {
+    errMsg(_errorStack) << "Cannot verify callsign db.";
+    return false;
+  }
+
+  // Remember what has been written to the device
+  if (! _imageCacheId.isEmpty())
+    _imageCache.store(name(), cacheId, *_callsigns);
+
+  return true;
+}
+
+bool
+AnytoneRadio::uploadCallsignChanges(const DFUFile &previous) {
+  DFUPatch changes;
+  if (! changes.diff(previous, *_callsigns, WCHUNKSIZE, _errorStack)) {
+    errMsg(_errorStack) << "Cannot determine changes of callsign db.";
+    return false;
+  }
+
+  logDebug() << "Upload " << changes.size() << "b in " << changes.numHunks()
+             << " modified ranges of callsign db.";
+  enterPhase(PhaseWrite, changes.size());
+  size_t total = std::max(1U, changes.size()), written = 0;
+  _checkpoint.begin();
+  _readback.reset();
+  _readback.setBlockSize(WCHUNKSIZE);
+  for (int i=0; i<changes.numHunks(); i++) {
+    // Align modified range with the write block size, but keep it within the element.
+    const DFUPatch::Hunk &hunk = changes.hunk(i);
+    const DFUFile::Element &el = _callsigns->image(0).element(
+          _callsigns->image(0).findElement(hunk.address));
+    unsigned addr = std::max(el.address(), align_addr(hunk.address, WBSIZE));
+    unsigned end  = std::min(el.address()+el.memSize(),
+                             align_size(hunk.address+hunk.data.size(), WBSIZE));
+    for (unsigned offset=addr; offset<end; offset+=WCHUNKSIZE) {
+      unsigned len = std::min(unsigned(WCHUNKSIZE), end-offset);
+      if (! _dev->write_windowed(0, offset, _callsigns->data(offset), len, _errorStack)) {
         errMsg(_errorStack) << "Cannot write callsign db.";
-        _task = StatusError;
         return false;
       }
-      blkWritten++;
-      emit uploadProgress(float(blkWritten*100)/totalBlocks);
+      _readback.add(0, offset, _callsigns->data(offset), len);
     }
+    written += hunk.data.size();
+    reportUploadProgress(float(written*100)/total);
+  }
+
+  if (! verifyUpload()) {
+    errMsg(_errorStack) << "Cannot verify callsign db.";
+    return false;
   }
 
   return true;
 }
+
+bool
+AnytoneRadio::verifyUpload() {
+  if (! _readback.isEnabled())
+    return true;
+
+  logDebug() << "Read back " << _readback.numBlocks() << " written blocks from " << name() << ".";
+  enterPhase(PhaseVerify);
+  bool ok = _readback.verify(
+        [this](uint32_t bank, uint32_t addr, uint8_t *data, int n, const ErrorStack &err) {
+          return _dev->read_pipelined(bank, addr, data, n, err);
+        }, _errorStack);
+  // Everything was written, hence resuming the upload is pointless.
+  if (! ok)
+    _checkpoint.reset();
+  return ok;
+}
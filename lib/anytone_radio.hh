@@ -45,6 +45,10 @@ public:
   const QString &name() const;
   const Codeplug &codeplug() const;
   Codeplug &codeplug();
+  const CallsignDB *callsignDB() const;
+  CallsignDB *callsignDB();
+  TransferStatistics transferStatistics() const;
+  bool hasSelectiveDownload() const;
 
 public slots:
   /** Starts the download of the codeplug and derives the generic configuration from it. */
@@ -53,22 +57,52 @@ public slots:
    * codeplug to the radio. */
   bool startUpload(Config *config, bool blocking=false,
                    const Codeplug::Flags &flags = Codeplug::Flags(), const ErrorStack &err=ErrorStack());
+  /** Uploads the config of the given encode session. Takes the ownership of the session, its
+   * context gets indexed on the worker thread, unless the session indexed it before. */
+  bool startUploadSession(EncodeSession *session, bool blocking=false,
+                          const Codeplug::Flags &flags=Codeplug::Flags(), const ErrorStack &err=ErrorStack());
   /** Encodes the given user-database and uploades it to the device. */
   bool startUploadCallsignDB(UserDatabase *db, bool blocking=false,
                              const CallsignDB::Selection &selection=CallsignDB::Selection(), const ErrorStack &err=ErrorStack());
+  /** Uploads the codeplug and the callsign DB within a single programming session. */
+  bool startUploadAll(Config *config, UserDatabase *db, bool blocking=false,
+                      const Codeplug::Flags &flags = Codeplug::Flags(),
+                      const CallsignDB::Selection &selection=CallsignDB::Selection(),
+                      const ErrorStack &err=ErrorStack());
+  /** Resumes a failed upload from the stored checkpoint. */
+  bool startResume(bool blocking=false, const ErrorStack &err=ErrorStack());
 
 protected:
+  void moveInterfaceToThread(QThread *thread);
+  RadioInterface *radioInterface() const;
   /** Thread main routine, performs all blocking IO operations for codeplug up- and download. */
   void run();
 
 private:
   /** Downloads the codeplug from the radio. This method block until the download is complete. */
   virtual bool download();
-  /** Uploads the encoded codeplug to the radio. This method block until the upload is complete. */
+  /** Uploads the encoded codeplug to the radio. This method block until the upload is complete.
+   * The codeplug gets encoded in the background, encoded sections get uploaded while the
+   * remaining ones are being encoded. All other memory, e.g., settings and bitmaps, gets
+   * uploaded last. */
   virtual bool upload();
+  /** Reads the current codeplug from the radio and indexes the configuration of the encode
+   * session. The current device memory is returned in @c current, to upload modified blocks
+   * only. */
+  bool prepareUpload(DFUFile::Image &current);
+  /** Replaces the encode session and takes the config to upload from it. */
+  bool setSession(EncodeSession *session, const ErrorStack &err);
+  /** Writes the blocks within [begin, end) of the n-th element of the codeplug, that differ from
+   * the @c current device memory. */
+  bool writeModified(const DFUFile::Image &current, int n, unsigned begin, unsigned end);
   /** Uploads the encoded callsign database to the radio.
    * This method block until the upload is complete. */
   virtual bool uploadCallsigns();
+  /** Uploads only those blocks of the callsign database, that differ from the given image
+   * previously written to the radio. */
+  bool uploadCallsignChanges(const DFUFile &previous);
+  /** Reads back the written blocks, if the readback verification is enabled. */
+  bool verifyUpload();
 
 protected:
   /** The device identifier. */
@@ -78,7 +112,9 @@ protected:
   /** If @c true, the codeplug on the radio gets updated upon upload. If @c false, it gets
    * overridden. */
   Codeplug::Flags _codeplugFlags;
-  /** Owns the generic configuration. */
+  /** Owns the encode session of the current upload, including the config. */
+  EncodeSession *_session;
+  /** The generic configuration to upload, owned by the session. */
   Config *_config;
   /** A weak reference to the user-database. */
   UserDatabase *_userDB;
@@ -167,23 +167,5 @@ AuctusA6Interface::receive(uint16_t &command,
 bool
 AuctusA6Interface::read(uint8_t *data, qint64 n, unsigned int timeout_ms, const ErrorStack &err)
 {
-  while (n > 0) {
-    if (0 == bytesAvailable()) {
-      if (! waitForReadyRead(timeout_ms)) {
-        errMsg(err) << "QSerialPort: " << errorString();
-        return false;
-      }
-    }
-
-    qint64 k = QSerialPort::read((char *)data, std::min(n, bytesAvailable()));
-    if (0 > k) {
-      errMsg(err) << "QSerialPort: " << errorString();
-      return false;
-    }
-
-    n -= k;
-    data += k;
-  }
-
-  return true;
+  return USBSerial::receive((char *)data, n, timeout_ms, err);
 }
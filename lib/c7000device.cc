@@ -1,4 +1,6 @@
 #include "c7000device.hh"
+#include "usbcontext.hh"
+#include "devicemonitor.hh"
 #include "logger.hh"
 #include <QtEndian>
 #include <QThread>
@@ -127,19 +129,15 @@ C7000Device::C7000Device(const USBDeviceDescriptor &descr, const ErrorStack &err
     return;
   }
 
-  int error = libusb_init(&_ctx);
-  if (error < 0) {
-    errMsg(err) << "Libusb init failed (" << error << "): "
-                << libusb_strerror((enum libusb_error) error) << ".";
+  if (nullptr == (_ctx = USBContext::acquire(err)))
     return;
-  }
 
-  int num=0;
+  int error, num=0;
   libusb_device **lst;
   libusb_device *dev=nullptr;
   if (0 > (num = libusb_get_device_list(_ctx, &lst))) {
     errMsg(err) << "Cannot obtain list of USB devices.";
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
     return;
   }
@@ -168,7 +166,7 @@ C7000Device::C7000Device(const USBDeviceDescriptor &descr, const ErrorStack &err
 
   if (nullptr == dev) {
     errMsg(err) << "No matching device found: " << descr.description() << ".";
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
     return;
   }
@@ -177,7 +175,7 @@ C7000Device::C7000Device(const USBDeviceDescriptor &descr, const ErrorStack &err
     errMsg(err) << "Cannot open device " << descr.description()
                 << ": " << libusb_strerror((enum libusb_error) error) << ".";
     libusb_unref_device(dev);
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
     return;
   }
@@ -193,7 +191,7 @@ C7000Device::C7000Device(const USBDeviceDescriptor &descr, const ErrorStack &err
                 << ": " << libusb_strerror((enum libusb_error) error) << ".";
     libusb_close(_dev);
     _dev = nullptr;
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
     return;
   }
@@ -217,39 +215,16 @@ C7000Device::detect(bool saveOnly)
   Q_UNUSED(saveOnly)
   QList<USBDeviceDescriptor> res;
 
-  int error, num;
-  libusb_context *ctx;
-  if (0 > (error = libusb_init(&ctx))) {
-    logError() << "Libusb init failed (" << error << "): "
-               << libusb_strerror((enum libusb_error) error) << ".";
-    return res;
-  }
-
-  libusb_device **lst;
-  if (0 == (num = libusb_get_device_list(ctx, &lst))) {
-    logDebug() << "No USB devices found at all.";
-    // unref devices and free list
-    libusb_free_device_list(lst, 1);
-    return res;
-  }
-
   logDebug() << "Search for C7000 devices matching VID:PID "
              << QString::number(C7000_VID, 16) << ":" << QString::number(C7000_PID, 16) << ".";
-  for (int i=0; (i<num)&&(nullptr!=lst[i]); i++) {
-    libusb_device_descriptor descr;
-    libusb_get_device_descriptor(lst[i], &descr);
-    if ((C7000_VID == descr.idVendor) && (C7000_PID == descr.idProduct)) {
-      logDebug() << "Found device on bus=" << libusb_get_bus_number(lst[i])
-                 << ", device=" << libusb_get_device_address(lst[i])
-                 << " with " << QString::number(C7000_VID, 16) << ":" << QString::number(C7000_PID, 16) << ".";
-      res.append(C7000Device::Descriptor(
-                   USBDeviceInfo(USBDeviceInfo::Class::C7K, C7000_VID, C7000_PID),
-                   libusb_get_bus_number(lst[i]),
-                   libusb_get_device_address(lst[i])));
-    }
+  foreach (const DeviceMonitor::USBDevice &device, DeviceMonitor::usbDevices(C7000_VID, C7000_PID)) {
+    logDebug() << "Found device on bus=" << int(device.bus) << ", device=" << int(device.address)
+               << " with " << QString::number(C7000_VID, 16) << ":" << QString::number(C7000_PID, 16) << ".";
+    res.append(C7000Device::Descriptor(
+                 USBDeviceInfo(USBDeviceInfo::Class::C7K, C7000_VID, C7000_PID),
+                 device.bus, device.address));
   }
 
-  libusb_free_device_list(lst, 1);
   return res;
 }
 
@@ -266,20 +241,28 @@ C7000Device::close() {
     libusb_close(_dev);
   }
   if (nullptr != _ctx)
-    libusb_exit(_ctx);
+    USBContext::release();
   _ctx = nullptr;
   _dev = nullptr;
 }
 
 bool
 C7000Device::sendRecv(const Packet &request, Packet &response, const ErrorStack &err) {
+  if (! send(request, err))
+    return false;
+  QObject().thread()->usleep(1000);
+  return receive(response, 1000, err);
+}
+
+bool
+C7000Device::send(const Packet &request, const ErrorStack &err) {
   if (! request.isValid()) {
     errMsg(err) << "Cannot send invalid request.";
     return false;
   }
 
   uint8_t buffer[64];
-  int bytes_send, bytes_received;
+  int bytes_send;
 
   memcpy(buffer, request.encoded().constData(), request.encoded().size());
   int ret = libusb_bulk_transfer(_dev, 0x02, buffer, request.encoded().size(), &bytes_send, 1000);
@@ -287,11 +270,18 @@ C7000Device::sendRecv(const Packet &request, Packet &response, const ErrorStack
     errMsg(err) << "Cannot send command to device: " << libusb_error_name(ret) << ".";
     return false;
   }
-  QObject().thread()->usleep(1000);
+
+  return true;
+}
+
+bool
+C7000Device::receive(Packet &response, int timeout, const ErrorStack &err) {
+  uint8_t buffer[64];
+  int bytes_received;
 
   unsigned int retry_count = 0;
 retry_receive:
-  ret = libusb_bulk_transfer(_dev, 0x81, buffer, 64, &bytes_received, 1000);
+  int ret = libusb_bulk_transfer(_dev, 0x81, buffer, 64, &bytes_received, timeout);
   if (ret) {
     errMsg(err) << "Cannot receive response from device: " << libusb_error_name(ret) << ".";
     return false;
@@ -313,3 +303,12 @@ retry_receive:
 
   return true;
 }
+
+void
+C7000Device::discardInput(int settle_ms) {
+  uint8_t buffer[64];
+  int bytes_received;
+  while (0 == libusb_bulk_transfer(_dev, 0x81, buffer, 64, &bytes_received, settle_ms)) {
+    // pass...
+  }
+}
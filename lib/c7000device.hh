@@ -73,6 +73,12 @@ public:
 protected:
   /** Sends the given request to the device and receives the response. */
   bool sendRecv(const Packet &request, Packet &response, const ErrorStack &err=ErrorStack());
+  /** Sends the given request without waiting for the response. */
+  bool send(const Packet &request, const ErrorStack &err=ErrorStack());
+  /** Receives the next response within @c timeout ms. */
+  bool receive(Packet &response, int timeout=1000, const ErrorStack &err=ErrorStack());
+  /** Drops all pending responses, that arrive within @c settle_ms. */
+  void discardInput(int settle_ms=50);
 
 protected:
   /** USB context. */
@@ -1,17 +1,27 @@
 #include "callsigndb.hh"
+#include "userdatabase.hh"
+#include "logger.hh"
+#include "taskscheduler.hh"
+#include <QThreadPool>
+#include <QRunnable>
+#include <algorithm>
+
+/** Minimum number of entries per chunk to encode concurrently. */
+#define MIN_PARALLEL_CHUNK 4096
 
 
 /* ********************************************************************************************* *
  * Implementation of CallsignDB::Selection
  * ********************************************************************************************* */
 CallsignDB::Selection::Selection(int64_t count)
-  : _count(count)
+  : _count(count), _size(-1), _countries(), _prefixes()
 {
   // pass...
 }
 
 CallsignDB::Selection::Selection(const Selection &other)
-  : _count(other._count)
+  : _count(other._count), _size(other._size), _countries(other._countries),
+    _prefixes(other._prefixes)
 {
   // pass...
 }
@@ -38,16 +48,238 @@ CallsignDB::Selection::clearCountLimit() {
   _count = -1;
 }
 
+bool
+CallsignDB::Selection::hasSizeLimit() const {
+  return (0 <= _size);
+}
+
+qint64
+CallsignDB::Selection::sizeLimit() const {
+  if (0 > _size)
+    return std::numeric_limits<qint64>::max();
+  return _size;
+}
+
+void
+CallsignDB::Selection::setSizeLimit(qint64 bytes) {
+  _size = bytes;
+}
+
+void
+CallsignDB::Selection::clearSizeLimit() {
+  _size = -1;
+}
+
+bool
+CallsignDB::Selection::hasFilter() const {
+  return (! _countries.isEmpty()) || (! _prefixes.isEmpty());
+}
+
+void
+CallsignDB::Selection::addCountry(const QString &country, const QString &state) {
+  _countries.append(QPair<QString, QString>(country, state));
+}
+
+void
+CallsignDB::Selection::addPrefix(unsigned prefix) {
+  _prefixes.append(prefix);
+}
+
+QVector<int>
+CallsignDB::Selection::select(UserDatabase *db, qint64 capacity, qint64 bytes, const EntrySize &size) const {
+  capacity = std::max(qint64(0), std::min(capacity, db->count()));
+  QVector<int> indices;
+
+  if (! hasFilter()) {
+    // Take the first users of the DB
+    qint64 n = hasCountLimit() ? std::min(capacity, qint64(countLimit())) : capacity;
+    indices.resize(n);
+    for (qint64 i=0; i<n; i++)
+      indices[i] = i;
+  } else {
+    // Users matching any filter come first, the bitmap removes duplicates
+    QVector<bool> selected(db->count(), false);
+    auto add = [&indices, &selected, capacity](int idx) {
+      if (selected[idx] || (indices.size() >= capacity))
+        return;
+      selected[idx] = true;
+      indices.append(idx);
+    };
+    typedef QPair<QString, QString> Region;
+    foreach (const Region &region, _countries) {
+      foreach (int idx, db->usersInCountry(region.first, region.second))
+        add(idx);
+    }
+    foreach (unsigned prefix, _prefixes) {
+      foreach (int idx, db->usersWithPrefix(prefix))
+        add(idx);
+    }
+    logDebug() << "Selected " << indices.size() << " users by country or prefix.";
+
+    // Fill the remaining space with the first users of the DB
+    qint64 fill = hasCountLimit() ? qint64(countLimit()) : capacity;
+    for (qint64 i=0; (i<db->count()) && (0 < fill) && (indices.size() < capacity); i++) {
+      if (selected[i])
+        continue;
+      add(i); fill--;
+    }
+  }
+
+  // Take as many of the selected users as fit into the memory, in the order of selection
+  if (size && ((0 <= bytes) || hasSizeLimit())) {
+    qint64 memory = (0 <= bytes) ? std::min(bytes, sizeLimit()) : sizeLimit();
+    qint64 n = fittingUsers(entryOffsets(db, indices, size), memory);
+    if (n < indices.size())
+      logDebug() << "Only " << n << " of " << indices.size() << " users fit into " << memory << "b.";
+    indices.resize(n);
+  }
+
+  std::sort(indices.begin(), indices.end(), [db](int a, int b) {
+    return db->user(a).id < db->user(b).id;
+  });
+  return indices;
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of CallsignDB
  * ********************************************************************************************* */
 CallsignDB::CallsignDB(QObject *parent)
-  : DFUFile(parent)
+  : DFUFile(parent), _progress(), _progressive(false), _encodeErrors(), _cancel()
 {
   // pass...
 }
 
 CallsignDB::~CallsignDB() {
-  // pass...
+  // The background encoder must not outlive the DB
+  finishEncoding();
+}
+
+QVector<int>
+CallsignDB::sortedSelection(UserDatabase *db, const Selection &selection, qint64 capacity,
+                            qint64 bytes, const Selection::EntrySize &size)
+{
+  return selection.select(db, capacity, bytes, size);
+}
+
+QVector<qint64>
+CallsignDB::entryOffsets(UserDatabase *db, const QVector<int> &users, const Selection::EntrySize &size) {
+  QVector<qint64> offsets(users.size()+1);
+  offsets[0] = 0;
+  for (int i=0; i<users.size(); i++)
+    offsets[i+1] = offsets[i] + size(db->user(users[i]));
+  return offsets;
+}
+
+qint64
+CallsignDB::fittingUsers(const QVector<qint64> &offsets, qint64 bytes) {
+  // Offsets are ascending, find the last one not exceeding the memory
+  return std::upper_bound(offsets.begin(), offsets.end(), bytes) - offsets.begin() - 1;
+}
+
+void
+CallsignDB::parallelFor(qint64 n, const std::function<void (qint64, qint64)> &body) {
+  TaskScheduler::parallelFor(n, MIN_PARALLEL_CHUNK, body);
+}
+
+/** Runs the background encoding of a @c CallsignDB. */
+class CallsignDBEncodeRunner: public QRunnable
+{
+public:
+  CallsignDBEncodeRunner(CallsignDB *callsigns, UserDatabase *db, const CallsignDB::Selection &selection)
+    : QRunnable(), _callsigns(callsigns), _db(db), _selection(selection)
+  {
+    // pass...
+  }
+
+  void run() {
+    _callsigns->runEncoding(_db, _selection);
+  }
+
+protected:
+  CallsignDB *_callsigns;
+  UserDatabase *_db;
+  CallsignDB::Selection _selection;
+};
+
+bool
+CallsignDB::startEncoding(UserDatabase *db, const Selection &selection, const ErrorStack &err) {
+  // Complete any previous encoding first
+  finishEncoding();
+
+  _progressive = true;
+  _encodeErrors = ErrorStack();
+  _progress.start();
+  QThreadPool::globalInstance()->start(new CallsignDBEncodeRunner(this, db, selection));
+
+  if (! _progress.waitAllocated())
+    return finishEncoding(err);
+  return true;
+}
+
+bool
+CallsignDB::waitEncoded(uint32_t address, uint32_t size) {
+  return _progress.waitEncoded(address, size);
+}
+
+bool
+CallsignDB::finishEncoding(const ErrorStack &err) {
+  if (_progress.waitDone())
+    return true;
+  err.take(_encodeErrors);
+  errMsg(err) << "Cannot encode call-sign DB.";
+  return false;
+}
+
+const CancellationToken &
+CallsignDB::cancellationToken() const {
+  return _cancel;
+}
+
+void
+CallsignDB::setCancellationToken(const CancellationToken &token) {
+  _cancel = token;
+}
+
+void
+CallsignDB::setAllocated() {
+  if (! _progressive)
+    return;
+  // Sort and merge adjacent elements before uploading, this moves the element data
+  image(0).compact();
+  _progress.setAllocated();
+}
+
+void
+CallsignDB::setEncoded(uint32_t address, uint32_t size) {
+  if (_progressive)
+    _progress.setEncoded(address, size);
+}
+
+void
+CallsignDB::runEncoding(UserDatabase *db, const Selection &selection) {
+  ErrorStack err;
+  bool ok = _cancel.check(err) && encode(db, selection, err);
+
+  // Encoders not reporting the allocation, get compacted once complete
+  if ((! _progress.isAllocated()) && numImages())
+    image(0).compact();
+  _progressive = false;
+  _encodeErrors = err;
+  _progress.finish(ok);
+}
+
+bool
+CallsignDB::encodeToFile(UserDatabase *db, const QString &filename, const Selection &selection,
+                         const ErrorStack &err)
+{
+  if (! encode(db, selection, err)) {
+    errMsg(err) << "Cannot encode call-sign DB.";
+    return false;
+  }
+  if (! write(filename, err)) {
+    errMsg(err) << "Cannot write call-sign DB file '" << filename << "'.";
+    return false;
+  }
+  return true;
 }
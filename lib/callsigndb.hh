@@ -2,13 +2,21 @@
 #define CALLSIGNDB_HH
 
 #include "dfufile.hh"
-
-// Forward decl.
-class UserDatabase;
+#include "userdatabase.hh"
+#include "encodeprogress.hh"
+#include "cancellation.hh"
+#include <QVector>
+#include <QPair>
+#include <functional>
 
 /** Abstract base class of all callsign database implementations.
  * This class defines the interface for all device-specific binary encodings of call sign
  * databases. The interface is particularly simple: reimplement the @c encode method.
+ *
+ * The DB may also be encoded in the background using @c startEncoding, while it gets uploaded to
+ * the device. The upload then waits for each range using @c waitEncoded. Encoders supporting
+ * this, report the completed allocation using @c setAllocated and every finished range using
+ * @c setEncoded. All other encoders simply complete the entire DB before the upload starts.
  * @ingroup conf */
 class CallsignDB : public DFUFile
 {
@@ -16,9 +24,20 @@ class CallsignDB : public DFUFile
 
 public:
   /** Controls the selection of callsigns from the @c UserDatabase to be encoded into the
-   * callsign db. */
+   * callsign db.
+   *
+   * All users matching any of the filters (countries, states or ID prefixes) get selected first.
+   * The remaining space gets filled with the first users of the database, e.g., those closest
+   * to the own ID (see @c UserDatabase::sortUsers). If a count limit is set, it limits the
+   * number of these additional users. Without any filter, it limits the total number of users.
+   *
+   * If a size limit is set, the selection fills the given memory: As many of the users above get
+   * selected as fit into that many bytes, in the order of selection. */
   class Selection {
   public:
+    /** Computes the size of the encoded entry for a user. */
+    typedef std::function<unsigned(const UserDatabase::User &user)> EntrySize;
+
     /** Constructor. */
     Selection(int64_t count=-1);
     /** Copy constructor. */
@@ -33,10 +52,44 @@ public:
     /** Clears the count limit. */
     void clearCountLimit();
 
+    /** Returns @c true if the selection limits the size of the encoded entries. */
+    bool hasSizeLimit() const;
+    /** Returns the limit of the size of all encoded entries in bytes. */
+    qint64 sizeLimit() const;
+    /** Sets the size limit in bytes. */
+    void setSizeLimit(qint64 bytes);
+    /** Clears the size limit. */
+    void clearSizeLimit();
+
+    /** Returns @c true if any filter is set. */
+    bool hasFilter() const;
+    /** Selects all users of the given country or, if a @c state is given, only those of that
+     * state. */
+    void addCountry(const QString &country, const QString &state=QString());
+    /** Selects all users whose ID starts with the given decimal prefix. */
+    void addPrefix(unsigned prefix);
+
+    /** Returns the indices of the selected users of the given DB, at most @c capacity, in
+     * ascending order of their IDs. The users are not copied, use @c UserDatabase::user to
+     * access them.
+     *
+     * For devices with variable sized entries, @c size computes the size of each entry and
+     * @c bytes specifies the memory available for them. Then, only as many users get selected as
+     * fit into that memory or into the size limit, whichever is smaller. */
+    QVector<int> select(UserDatabase *db, qint64 capacity, qint64 bytes=-1,
+                        const EntrySize &size=EntrySize()) const;
+
   protected:
     /** Specifies the maximum amount of callsigns to add. If negative, the device limit should be
      * used. */
     int64_t _count;
+    /** Specifies the maximum size of all encoded entries in bytes. If negative, the device memory
+     * should be used. */
+    qint64 _size;
+    /** The selected countries and states, the state may be empty. */
+    QList<QPair<QString, QString>> _countries;
+    /** The selected ID prefixes. */
+    QList<unsigned> _prefixes;
   };
 
 protected:
@@ -50,6 +103,67 @@ public:
   /** Encodes the given user db into the device specific callsign db. */
   virtual bool encode(UserDatabase *db, const Selection &selection=Selection(),
                       const ErrorStack &err=ErrorStack()) = 0;
+  /** Encodes the given user db and writes the callsign db to the specified DFU file.
+   * The default implementation encodes the entire DB in memory first. Devices may reimplement
+   * this method to stream the encoded DB into the file using a @c DFUStreamWriter. */
+  virtual bool encodeToFile(UserDatabase *db, const QString &filename,
+                            const Selection &selection=Selection(),
+                            const ErrorStack &err=ErrorStack());
+
+  /** Starts encoding the given user db in the background. Returns as soon as the memory layout
+   * of the DB is fixed, i.e., all elements are allocated and compacted. Then the encoded ranges
+   * may be uploaded, once @c waitEncoded returns for them. Returns @c false if the encoding
+   * failed before. */
+  bool startEncoding(UserDatabase *db, const Selection &selection=Selection(),
+                     const ErrorStack &err=ErrorStack());
+  /** Blocks until the given range is encoded. Returns @c false if the encoding failed. */
+  bool waitEncoded(uint32_t address, uint32_t size);
+  /** Blocks until the background encoding is complete. Returns @c false if it failed. */
+  bool finishEncoding(const ErrorStack &err=ErrorStack());
+
+  /** Returns the token, the encoding is canceled with. */
+  const CancellationToken &cancellationToken() const;
+  /** Sets the token, the encoding is canceled with. Encoders check the token between blocks of
+   * entries, a canceled encoding fails. */
+  void setCancellationToken(const CancellationToken &token);
+
+protected:
+  /** Gets called by the encoder, once all elements are allocated. When encoding in the
+   * background, the image gets compacted and the upload may start. Hence the encoder must
+   * obtain the pointers to the element data after this call. */
+  void setAllocated();
+  /** Gets called by the encoder, once the given range is complete. */
+  void setEncoded(uint32_t address, uint32_t size);
+  /** Encodes the DB in the background, see @c startEncoding. */
+  void runEncoding(UserDatabase *db, const Selection &selection);
+
+  /** Returns the indices of the users of the given user DB selected by @c selection, at most
+   * @c capacity, ordered by ascending ID. See @c Selection::select. */
+  static QVector<int> sortedSelection(UserDatabase *db, const Selection &selection, qint64 capacity,
+                                     qint64 bytes=-1, const Selection::EntrySize &size=Selection::EntrySize());
+  /** Computes the prefix sums of the entry sizes of the given users, in the given order. That is,
+   * the i-th element is the size of the first i entries. Hence the last element is the total size. */
+  static QVector<qint64> entryOffsets(UserDatabase *db, const QVector<int> &users,
+                                      const Selection::EntrySize &size);
+  /** Returns the number of users fitting into @c bytes, given the prefix sums of their entry
+   * sizes (see @c entryOffsets). */
+  static qint64 fittingUsers(const QVector<qint64> &offsets, qint64 bytes);
+  /** Calls @c body for contiguous chunks [first, last) of the range [0, n) concurrently.
+   * Small ranges are processed sequentially. The @c body must only write disjoint memory for
+   * disjoint chunks. */
+  static void parallelFor(qint64 n, const std::function<void(qint64 first, qint64 last)> &body);
+
+protected:
+  /** The progress of the background encoding. */
+  EncodeProgress _progress;
+  /** If @c true, the DB gets encoded in the background. */
+  bool _progressive;
+  /** The errors of the background encoding. */
+  ErrorStack _encodeErrors;
+  /** The token, the encoding is canceled with. */
+  CancellationToken _cancel;
+
+  friend class CallsignDBEncodeRunner;
 };
 
 #endif // CALLSIGNDB_HH
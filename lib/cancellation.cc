@@ -0,0 +1,30 @@
+#include "cancellation.hh"
+
+CancellationToken::CancellationToken()
+  : _canceled(new QAtomicInt(0))
+{
+  // pass...
+}
+
+void
+CancellationToken::cancel() const {
+  _canceled->storeRelease(1);
+}
+
+bool
+CancellationToken::isCanceled() const {
+  return 0 != _canceled->loadAcquire();
+}
+
+bool
+CancellationToken::check(const ErrorStack &err) const {
+  if (! isCanceled())
+    return true;
+  errMsg(err) << "Operation canceled.";
+  return false;
+}
+
+bool
+CancellationToken::operator==(const CancellationToken &other) const {
+  return _canceled == other._canceled;
+}
@@ -0,0 +1,42 @@
+#ifndef CANCELLATION_HH
+#define CANCELLATION_HH
+
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include "errorstack.hh"
+
+/** A flag to cancel long-running operations cooperatively.
+ *
+ * Copies of a token share their state. Hence, the thread starting an operation keeps a copy and
+ * passes another one to the operation (e.g., using @c Radio::setCancellationToken). The operation
+ * polls the token at convenient checkpoints (e.g., every block transferred or element encoded)
+ * using @c check and returns cleanly with an error, once the token got canceled. Canceling is
+ * thread-safe and async-signal-safe, e.g., it may be called from a SIGINT handler.
+ *
+ * A token stays canceled. Restarting a canceled operation needs a new token.
+ *
+ * @ingroup util */
+class CancellationToken
+{
+public:
+  /** Creates a new token, not canceled yet. */
+  CancellationToken();
+
+  /** Cancels the operations, this token was passed to. */
+  void cancel() const;
+  /** Returns @c true if the token got canceled. */
+  bool isCanceled() const;
+  /** Checkpoint of an operation. If the token got canceled, an error message is put on the given
+   * error stack.
+   * @returns @c false if the operation must stop. */
+  bool check(const ErrorStack &err=ErrorStack()) const;
+
+  /** Returns @c true if both tokens share their state. */
+  bool operator==(const CancellationToken &other) const;
+
+protected:
+  /** The shared flag. */
+  QSharedPointer<QAtomicInt> _canceled;
+};
+
+#endif // CANCELLATION_HH
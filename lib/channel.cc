@@ -19,6 +19,7 @@
 #include <QCompleter>
 #include <QAbstractProxyModel>
 #include <QMetaEnum>
+#include "enumtable.hh"
 #include <QRegularExpression>
 
 #include "opengd77_extension.hh"
@@ -260,8 +261,7 @@ Channel::populate(YAML::Node &node, const Context &context, const ErrorStack &er
     YAML::Node def = YAML::Node(YAML::NodeType::Scalar); def.SetTag("!default");
     node["power"] = def;
   } else {
-    QMetaEnum metaEnum = QMetaEnum::fromType<Power>();
-    node["power"] = metaEnum.valueToKey((unsigned)power());
+    node["power"] = EnumTable::get<Power>().valueToKey((unsigned)power());
   }
 
   if (defaultTimeout()) {
@@ -311,8 +311,7 @@ Channel::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStac
   if ((!ch["power"]) || ("!default" == ch["power"].Tag())) {
     setDefaultPower();
   } else if (ch["power"] && ch["power"].IsScalar()) {
-    QMetaEnum meta = QMetaEnum::fromType<Channel::Power>();
-    setPower((Channel::Power)meta.keyToValue(ch["power"].as<std::string>().c_str()));
+    setPower((Channel::Power)EnumTable::get<Channel::Power>().keyToValue(ch["power"].Scalar()));
   }
 
   if ((!ch["timeout"]) || ("!default" == ch["timeout"].Tag())) {
@@ -955,6 +954,8 @@ SelectedChannel *SelectedChannel::_instance = nullptr;
 SelectedChannel::SelectedChannel()
   : Channel()
 {
+  // Shared by all codeplugs, thus references are not tracked
+  disableTracking();
   setName("[Selected]");
 }
 
@@ -4,8 +4,11 @@
 #include "signaling.hh"
 #include "channel.hh"
 #include "config.hh"
+#include "objectarena.hh"
 
 #include <QStringList>
+#include <QTextStream>
+#include <QLocale>
 
 
 /* ********************************************************************************************* *
@@ -59,24 +62,87 @@ QHash<QString, ChirpFormat::CrossMode> const ChirpFormat::_crossModes = {
 };
 
 
+/* ********************************************************************************************* *
+ * Implementation of ChirpReader::Filter
+ * ********************************************************************************************* */
+bool
+ChirpReader::Filter::accepts(const Frequency &rx) const {
+  if (bands.isEmpty())
+    return true;
+  foreach (auto band, bands) {
+    if ((band.first <= rx) && (rx <= band.second))
+      return true;
+  }
+  return false;
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of ChirpReader
  * ********************************************************************************************* */
+/** Looks up the given code in one of the code tables without creating a temporary string. */
+template <class T>
+static bool
+lookupCode(const QHash<QString, T> &table, QStringView code, T &value) {
+  code = code.trimmed();
+  for (auto it=table.cbegin(); it!=table.cend(); it++) {
+    if (QStringView(it.key()) == code) {
+      value = it.value();
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Returns the field at the given index or an empty field, if the column is not present. */
+static inline QStringView
+field(const QVector<QStringView> &line, int idx) {
+  if (0 > idx)
+    return QStringView();
+  return line.at(idx);
+}
+
+/** Parses a decimal number from the given field. */
+static inline double
+toDouble(QStringView text, bool *ok) {
+  return QLocale::c().toDouble(text.trimmed(), ok);
+}
+
+/** Parses an unsigned integer from the given field. */
+static inline unsigned
+toUInt(QStringView text, bool *ok) {
+  return QLocale::c().toUInt(text.trimmed(), ok);
+}
+
+
 bool
 ChirpReader::read(QTextStream &stream, Config *config, const ErrorStack &err) {
+  return read(stream, config, Filter(), err);
+}
+
+bool
+ChirpReader::read(QTextStream &stream, Config *config, const Filter &filter, const ErrorStack &err) {
+  // The line buffer gets reused, the fields refer to it.
+  QString buffer;
+  QVector<QStringView> fields;
+
   // First read header
-  QStringList header;
-  if (! readLine(stream, header, err)) {
+  if (! stream.readLineInto(&buffer)) {
     errMsg(err) << "Cannot read CSV header.";
     return false;
   }
 
   // Some trivial sanity checks for the header
-  if (0 == header.size()) {
+  if (buffer.isEmpty()) {
     errMsg(err) << "Invalid CSV file header: Got empty header.";
     return false;
   }
 
+  QStringList header;
+  splitLine(buffer, fields);
+  foreach (QStringView name, fields)
+    header.append(name.toString());
+
   if ("Location" != header.at(0)) {
     errMsg(err) << "Invalid CSV file header: 'Location' is not first column!";
     return false;
@@ -96,63 +162,85 @@ ChirpReader::read(QTextStream &stream, Config *config, const ErrorStack &err) {
     }
   }
 
-  int line=2;
-  while (! stream.atEnd()) {
-    QStringList entry;
-    if (! readLine(stream, entry, err)) {
-      errMsg(err) << "In CSV file line " << line << ": Cannot read line.";
-      return false;
-    }
-    if (! processLine(header, entry, config, err)) {
+  // Resolve columns once, the first column is the location
+  Columns columns;
+  columns.count = header.size();
+  columns.name = header.indexOf("Name", 1);
+  columns.frequency = header.indexOf("Frequency", 1);
+  columns.duplex = header.indexOf("Duplex", 1);
+  columns.offset = header.indexOf("Offset", 1);
+  columns.mode = header.indexOf("Mode", 1);
+  columns.tone = header.indexOf("Tone", 1);
+  columns.rToneFreq = header.indexOf("rToneFreq", 1);
+  columns.cToneFreq = header.indexOf("cToneFreq", 1);
+  columns.dtcsCode = header.indexOf("DtcsCode", 1);
+  columns.rxDtcsCode = header.indexOf("RxDtcsCode", 1);
+  columns.dtcsPolarity = header.indexOf("DtcsPolarity", 1);
+  columns.crossMode = header.indexOf("CrossMode", 1);
+
+  // Channels are collected first and added at once
+  ObjectArena::Scope arena;
+  QVector<ConfigObject *> channels;
+  for (int line=2; stream.readLineInto(&buffer); line++) {
+    if (buffer.isEmpty())
+      continue;
+    splitLine(buffer, fields);
+    if (! processLine(columns, fields, filter, channels, err)) {
       errMsg(err) << "In CSV file line " << line << ": Cannot read line.";
+      qDeleteAll(channels);
       return false;
     }
-    line++;
   }
 
+  Config::BulkUpdate update(config);
+  config->channelList()->addMany(channels);
+
   return true;
 }
 
 
-bool
-ChirpReader::readLine(QTextStream &stream, QStringList &list, const ErrorStack &err) {
-  Q_UNUSED(err)
-
-  list.clear();
-  if (stream.atEnd())
-    return true;
-
-  QString token;
-  QChar ch; stream >> ch;
-  bool string = false;
-  while ((! stream.atEnd()) && (QChar('\n') != ch)) {
-    if ((!string) && (QChar(',') == ch)) {
-      list.append(token); token.clear();
-    } else if ((! string) && (QChar('"') == ch)) {
-      string = true;
-    } else if (string && (QChar('"') == ch)) {
-      string = false;
+void
+ChirpReader::splitLine(const QString &line, QVector<QStringView> &fields) {
+  fields.clear();
+
+  const QChar *ptr = line.constData(), *end = ptr + line.size();
+  while (true) {
+    const QChar *start = ptr, *stop = ptr;
+    if ((ptr < end) && (QChar('"') == *ptr)) {
+      // Quoted field, may contain separators
+      start = ++ptr;
+      while ((ptr < end) && (QChar('"') != *ptr))
+        ptr++;
+      stop = ptr;
+      // Skip everything up to the next separator
+      while ((ptr < end) && (QChar(',') != *ptr))
+        ptr++;
     } else {
-      token.append(ch);
+      while ((ptr < end) && (QChar(',') != *ptr))
+        ptr++;
+      stop = ptr;
     }
-    stream >> ch;
+    fields.append(QStringView(start, stop-start));
+    if (ptr >= end)
+      break;
+    // skip separator
+    ptr++;
   }
-
-  list.append(token);
-
-  return true;
 }
 
 
 bool
-ChirpReader::processLine(const QStringList &header, const QStringList &line, Config *config, const ErrorStack &err) {
-  if (header.size() != line.size()) {
-    errMsg(err) << "Malformed line. Expected " << header.size() << " entries, got " << line.size() << ".";
+ChirpReader::processLine(const Columns &columns, const QVector<QStringView> &line,
+                         const Filter &filter, QVector<ConfigObject *> &channels,
+                         const ErrorStack &err)
+{
+  if (columns.count != line.size()) {
+    errMsg(err) << "Malformed line. Expected " << columns.count << " entries, got " << line.size() << ".";
     return false;
   }
 
   bool ok;
-  QString name;
+  QStringView text;
   Frequency rxFrequency, txFrequency;
   Duplex duplex = Duplex::None;
   Mode mode = Mode::FM;
@@ -162,199 +250,212 @@ ChirpReader::processLine(const QStringList &header, const QStringList &line, Con
   int txDTCSCode = 000, rxDTCSCode = 000;
   Polarity txPol = Polarity::Normal, rxPol = Polarity::Normal;
 
-  for (int i=1; i<header.size(); i++) {
-    if ("Name" == header.at(i)) {
-      name = line.at(i).simplified();
-    } else if ("Frequency" == header.at(i)) {
-      rxFrequency = Frequency::fromMHz(line.at(i).toDouble(&ok));
-      if (! ok) {
-        errMsg(err) << "Cannot parse frequency '" << line.at(i) << "': Malformed frequency.";
-        return false;
-      }
-    } else if (("Offset" == header.at(i)) && (! line.at(i).isEmpty())) {
-      txFrequency = Frequency::fromMHz(line.at(i).toDouble(&ok));
-      if (! ok) {
-        errMsg(err) << "Cannot parse offset frequency '" << line.at(i) << "': Malformed frequency.";
-        return false;
-      }
-    } else if ("Duplex" == header.at(i)) {
-      if (! processDuplex(line.at(i), duplex, err))
-        return false;
-    } else if ("Mode" == header.at(i)) {
-      if (! processMode(line.at(i), mode, err))
-        return false;
-    } else if ("Tone" == header.at(i)) {
-      if (! processToneMode(line.at(i), toneMode, err))
-        return false;
-    } else if (("rToneFreq" == header.at(i)) && (! line.at(i).isEmpty())) {
-      txTone = line.at(i).toDouble(&ok);
-      if (! ok) {
-        errMsg(err) << "Cannot parse TX CTCSS tone frequency '" << line.at(i) << "'.";
-        return false;
-      }
-    } else if (("cToneFreq" == header.at(i)) && (! line.at(i).isEmpty())) {
-      rxTone = line.at(i).toDouble(&ok);
-      if (! ok) {
-        errMsg(err) << "Cannot parse RX CTCSS tone frequency '" << line.at(i) << "'.";
-        return false;
-      }
-    } else if (("DtcsCode" == header.at(i)) && (! line.at(i).isEmpty())) {
-      txDTCSCode = line.at(i).toUInt(&ok);
-      if (! ok) {
-        errMsg(err) << "Cannot decode TX DCS code '" << line.at(i) <<"': invalid format.";
-        return false;
-      }
-    } else if (("RxDtcsCode" == header.at(i)) && (! line.at(i).isEmpty())) {
-      rxDTCSCode = line.at(i).toUInt(&ok);
-      if (! ok) {
-        errMsg(err) << "Cannot decode RX DCS code '" << line.at(i) <<"': invalid format.";
-        return false;
-      }
-    } else if ("DtcsPolarity" == header.at(i)) {
-      if (! processPolarity(line.at(i), txPol, rxPol, err))
-        return false;
-    } else if ("CrossMode" == header.at(i)) {
-      if (! processCrossMode(line.at(i), crossMode, err))
-        return false;
-    }
+  // First, parse the columns the filter is applied to
+  if (! processMode(line.at(columns.mode), mode, err))
+    return false;
+  if ((Mode::FM != mode) && (Mode::NFM != mode)) {
+    if (filter.skipUnsupported)
+      return true;
+    errMsg(err) << "Unhandled channel format.";
+    return false;
+  }
+  if (((Mode::FM == mode) && (! filter.fm)) || ((Mode::NFM == mode) && (! filter.nfm)))
+    return true;
+
+  text = line.at(columns.frequency);
+  rxFrequency = Frequency::fromMHz(toDouble(text, &ok));
+  if (! ok) {
+    errMsg(err) << "Cannot parse frequency '" << text.toString() << "': Malformed frequency.";
+    return false;
   }
+  if (! filter.accepts(rxFrequency))
+    return true;
 
-  // Some more sanity checks:
+  // Then the remaining columns
+  QString name = line.at(columns.name).toString().simplified();
   if (name.isEmpty()) {
     errMsg(err) << "Invalid empty name.";
     return false;
   }
 
-  if ((Mode::FM == mode) || (Mode::NFM == mode)) {
-    FMChannel *fm = new FMChannel();
+  if (! (text = line.at(columns.offset)).isEmpty()) {
+    txFrequency = Frequency::fromMHz(toDouble(text, &ok));
+    if (! ok) {
+      errMsg(err) << "Cannot parse offset frequency '" << text.toString() << "': Malformed frequency.";
+      return false;
+    }
+  }
 
-    fm->setName(name);
-    fm->setRXFrequency(rxFrequency);
+  if (! processDuplex(line.at(columns.duplex), duplex, err))
+    return false;
 
-    switch (duplex) {
-    case Duplex::None:
-      fm->setTXFrequency(fm->rxFrequency());
-      break;
-    case Duplex::Off:
-      fm->setTXFrequency(fm->rxFrequency());
-      fm->setRXOnly(true);
+  if ((0 <= columns.tone) && (! processToneMode(line.at(columns.tone), toneMode, err)))
+    return false;
+
+  if (! (text = field(line, columns.rToneFreq)).isEmpty()) {
+    txTone = toDouble(text, &ok);
+    if (! ok) {
+      errMsg(err) << "Cannot parse TX CTCSS tone frequency '" << text.toString() << "'.";
+      return false;
+    }
+  }
+
+  if (! (text = field(line, columns.cToneFreq)).isEmpty()) {
+    rxTone = toDouble(text, &ok);
+    if (! ok) {
+      errMsg(err) << "Cannot parse RX CTCSS tone frequency '" << text.toString() << "'.";
+      return false;
+    }
+  }
+
+  if (! (text = field(line, columns.dtcsCode)).isEmpty()) {
+    txDTCSCode = toUInt(text, &ok);
+    if (! ok) {
+      errMsg(err) << "Cannot decode TX DCS code '" << text.toString() <<"': invalid format.";
+      return false;
+    }
+  }
+
+  if (! (text = field(line, columns.rxDtcsCode)).isEmpty()) {
+    rxDTCSCode = toUInt(text, &ok);
+    if (! ok) {
+      errMsg(err) << "Cannot decode RX DCS code '" << text.toString() <<"': invalid format.";
+      return false;
+    }
+  }
+
+  if ((0 <= columns.dtcsPolarity) &&
+      (! processPolarity(line.at(columns.dtcsPolarity), txPol, rxPol, err)))
+    return false;
+
+  if ((0 <= columns.crossMode) && (! processCrossMode(line.at(columns.crossMode), crossMode, err)))
+    return false;
+
+  FMChannel *fm = new FMChannel();
+
+  fm->setName(name);
+  fm->setRXFrequency(rxFrequency);
+  fm->setBandwidth((Mode::NFM == mode) ? FMChannel::Bandwidth::Narrow : FMChannel::Bandwidth::Wide);
+
+  switch (duplex) {
+  case Duplex::None:
+    fm->setTXFrequency(fm->rxFrequency());
+    break;
+  case Duplex::Off:
+    fm->setTXFrequency(fm->rxFrequency());
+    fm->setRXOnly(true);
+    break;
+  case Duplex::Split:
+    fm->setTXFrequency(txFrequency);
+    break;
+  case Duplex::Negative:
+    fm->setTXFrequency(Frequency::fromHz(rxFrequency.inHz()-txFrequency.inHz()));
+    break;
+  case Duplex::Positive:
+    fm->setTXFrequency(Frequency::fromHz(rxFrequency.inHz()+txFrequency.inHz()));
+    break;
+  }
+
+  switch (toneMode) {
+  case ToneMode::None: break;
+  case ToneMode::Tone:
+    fm->setTXTone(Signaling::fromCTCSSFrequency(txTone));
+    fm->setRXTone(Signaling::SIGNALING_NONE);
+    break;
+  case ToneMode::TSQL:
+    fm->setTXTone(Signaling::fromCTCSSFrequency(rxTone));
+    fm->setRXTone(Signaling::fromCTCSSFrequency(rxTone));
+    break;
+  case ToneMode::TSQL_R:
+    errMsg(err) << "Reversed CTCSS not supported.";
+    delete fm;
+    return false;
+  case ToneMode::DTCS:
+    fm->setTXTone(Signaling::fromDCSNumber(txDTCSCode, Polarity::Reversed == txPol));
+    fm->setRXTone(Signaling::fromDCSNumber(txDTCSCode, Polarity::Reversed == rxPol));
+    break;
+  case ToneMode::DTCS_R:
+    errMsg(err) << "Reversed DCS not supported.";
+    delete fm;
+    return false;
+  case ToneMode::Cross:
+    switch (crossMode) {
+    case CrossMode::NoneTone:
+      fm->setTXTone(Signaling::SIGNALING_NONE);
+      fm->setRXTone(Signaling::fromCTCSSFrequency(rxTone));
       break;
-    case Duplex::Split:
-      fm->setTXFrequency(txFrequency);
+    case CrossMode::NoneDTCS:
+      fm->setTXTone(Signaling::SIGNALING_NONE);
+      fm->setRXTone(Signaling::fromDCSNumber(rxDTCSCode, Polarity::Reversed == rxPol));
       break;
-    case Duplex::Negative:
-      fm->setTXFrequency(Frequency::fromHz(rxFrequency.inHz()-txFrequency.inHz()));
+    case CrossMode::ToneNone:
+      fm->setTXTone(Signaling::fromCTCSSFrequency(txTone));
+      fm->setRXTone(Signaling::SIGNALING_NONE);
       break;
-    case Duplex::Positive:
-      fm->setTXFrequency(Frequency::fromHz(rxFrequency.inHz()+txFrequency.inHz()));
+    case CrossMode::ToneTone:
+      fm->setTXTone(Signaling::fromCTCSSFrequency(txTone));
+      fm->setRXTone(Signaling::fromCTCSSFrequency(rxTone));
       break;
-    }
-
-    switch (toneMode) {
-    case ToneMode::None: break;
-    case ToneMode::Tone:
+    case CrossMode::ToneDTCS:
       fm->setTXTone(Signaling::fromCTCSSFrequency(txTone));
+      fm->setRXTone(Signaling::fromDCSNumber(rxDTCSCode, Polarity::Reversed == rxPol));
+      break;
+    case CrossMode::DTCSNone:
+      fm->setTXTone(Signaling::fromDCSNumber(txDTCSCode, Polarity::Reversed == txPol));
       fm->setRXTone(Signaling::SIGNALING_NONE);
       break;
-    case ToneMode::TSQL:
-      fm->setTXTone(Signaling::fromCTCSSFrequency(rxTone));
+    case CrossMode::DTCSTone:
+      fm->setTXTone(Signaling::fromDCSNumber(txDTCSCode, Polarity::Reversed == txPol));
       fm->setRXTone(Signaling::fromCTCSSFrequency(rxTone));
       break;
-    case ToneMode::TSQL_R:
-      errMsg(err) << "Reversed CTCSS not supported.";
-      return false;
-    case ToneMode::DTCS:
+    case CrossMode::DTCSDTCS:
       fm->setTXTone(Signaling::fromDCSNumber(txDTCSCode, Polarity::Reversed == txPol));
-      fm->setRXTone(Signaling::fromDCSNumber(txDTCSCode, Polarity::Reversed == rxPol));
+      fm->setRXTone(Signaling::fromDCSNumber(rxDTCSCode, Polarity::Reversed == rxPol));
       break;
-    case ToneMode::DTCS_R:
-      errMsg(err) << "Reversed DCS not supported.";
-      return false;
-    case ToneMode::Cross:
-      switch (crossMode) {
-      case CrossMode::NoneTone:
-        fm->setTXTone(Signaling::SIGNALING_NONE);
-        fm->setRXTone(Signaling::fromCTCSSFrequency(rxTone));
-        break;
-      case CrossMode::NoneDTCS:
-        fm->setTXTone(Signaling::SIGNALING_NONE);
-        fm->setRXTone(Signaling::fromDCSNumber(rxDTCSCode, Polarity::Reversed == rxPol));
-        break;
-      case CrossMode::ToneNone:
-        fm->setTXTone(Signaling::fromCTCSSFrequency(txTone));
-        fm->setRXTone(Signaling::SIGNALING_NONE);
-        break;
-      case CrossMode::ToneTone:
-        fm->setTXTone(Signaling::fromCTCSSFrequency(txTone));
-        fm->setRXTone(Signaling::fromCTCSSFrequency(rxTone));
-        break;
-      case CrossMode::ToneDTCS:
-        fm->setTXTone(Signaling::fromCTCSSFrequency(txTone));
-        fm->setRXTone(Signaling::fromDCSNumber(rxDTCSCode, Polarity::Reversed == rxPol));
-        break;
-      case CrossMode::DTCSNone:
-        fm->setTXTone(Signaling::fromDCSNumber(txDTCSCode, Polarity::Reversed == txPol));
-        fm->setRXTone(Signaling::SIGNALING_NONE);
-        break;
-      case CrossMode::DTCSTone:
-        fm->setTXTone(Signaling::fromDCSNumber(txDTCSCode, Polarity::Reversed == txPol));
-        fm->setRXTone(Signaling::fromCTCSSFrequency(rxTone));
-        break;
-      case CrossMode::DTCSDTCS:
-        fm->setTXTone(Signaling::fromDCSNumber(txDTCSCode, Polarity::Reversed == txPol));
-        fm->setRXTone(Signaling::fromDCSNumber(rxDTCSCode, Polarity::Reversed == rxPol));
-        break;
-      }
     }
-
-    config->channelList()->add(fm);
-    return true;
   }
 
-  errMsg(err) << "Unhandled channel format.";
-
-  return false;
+  channels.append(fm);
+  return true;
 }
 
 
 bool
-ChirpReader::processDuplex(const QString &code, Duplex &duplex, const ErrorStack &err) {
-  if (! _duplexCodes.contains(code.simplified())) {
-    errMsg(err) << "Cannot decode duplex '" << code << "': Unknown setting.";
+ChirpReader::processDuplex(QStringView code, Duplex &duplex, const ErrorStack &err) {
+  if (! lookupCode(_duplexCodes, code, duplex)) {
+    errMsg(err) << "Cannot decode duplex '" << code.toString() << "': Unknown setting.";
     return false;
   }
-  duplex = _duplexCodes[code.simplified()];
   return true;
 }
 
 bool
-ChirpReader::processMode(const QString &code, Mode &mode, const ErrorStack &err) {
-  if (! _modeCodes.contains(code.simplified())) {
-    errMsg(err) << "Cannot decode mode '" << code << "': Unknown setting.";
+ChirpReader::processMode(QStringView code, Mode &mode, const ErrorStack &err) {
+  if (! lookupCode(_modeCodes, code, mode)) {
+    errMsg(err) << "Cannot decode mode '" << code.toString() << "': Unknown setting.";
     return false;
   }
-  mode = _modeCodes[code.simplified()];
   return true;
 }
 
 bool
-ChirpReader::processToneMode(const QString &code, ToneMode &mode, const ErrorStack &err) {
-  if (! _toneModeCodes.contains(code.simplified())) {
-    errMsg(err) << "Cannot decode tone mode '" << code << "': Unknown setting.";
+ChirpReader::processToneMode(QStringView code, ToneMode &mode, const ErrorStack &err) {
+  if (! lookupCode(_toneModeCodes, code, mode)) {
+    errMsg(err) << "Cannot decode tone mode '" << code.toString() << "': Unknown setting.";
     return false;
   }
-  mode = _toneModeCodes[code.simplified()];
   return true;
 }
 
 bool
-ChirpReader::processPolarity(const QString &code, Polarity &txPol, Polarity &rxPol, const ErrorStack &err) {
-  if (2 != code.simplified().size()) {
-    errMsg(err) << "Cannot parse polarity code '" << code << "': invalid format.";
+ChirpReader::processPolarity(QStringView code, Polarity &txPol, Polarity &rxPol, const ErrorStack &err) {
+  code = code.trimmed();
+  if (2 != code.size()) {
+    errMsg(err) << "Cannot parse polarity code '" << code.toString() << "': invalid format.";
     return false;
   }
 
-  QChar tx = code.simplified().at(0), rx = code.simplified().at(1);
+  QChar tx = code.at(0), rx = code.at(1);
   if ('N' == tx) {
     txPol = Polarity::Normal;
   } else if ('R' == tx) {
@@ -377,12 +478,11 @@ ChirpReader::processPolarity(const QString &code, Polarity &txPol, Polarity &rxP
 }
 
 bool
-ChirpReader::processCrossMode(const QString &code, CrossMode &crossMode, const ErrorStack &err) {
-  if (! _crossModes.contains(code.simplified())) {
-    errMsg(err) << "Cannot decode cross-mode '" << code << "': unknown mode.";
+ChirpReader::processCrossMode(QStringView code, CrossMode &crossMode, const ErrorStack &err) {
+  if (! lookupCode(_crossModes, code, crossMode)) {
+    errMsg(err) << "Cannot decode cross-mode '" << code.toString() << "': unknown mode.";
     return false;
   }
-  crossMode = _crossModes[code.simplified()];
   return true;
 }
 
@@ -9,11 +9,15 @@
 #define CHIRPFORMAT_HH
 
 #include "errorstack.hh"
+#include "frequency.hh"
 #include <QSet>
+#include <QVector>
+#include <QPair>
+#include <QStringView>
 
 class QTextStream;
 class Config;
-class QStringList;
+class ConfigObject;
 class FMChannel;
 
 
@@ -92,32 +96,72 @@ protected:
  * @ingroup chirp */
 class ChirpReader: public ChirpFormat
 {
+public:
+  /** Selects the rows of a CHIRP CSV file to import. The filter is applied before any channel
+   * gets created. */
+  struct Filter {
+    /** Frequency bands (lower and upper receive frequency, inclusive) to import. If empty, channels
+     * of all frequencies are imported. */
+    QVector<QPair<Frequency, Frequency>> bands;
+    /** If @c true, FM (25kHz) channels are imported. */
+    bool fm = true;
+    /** If @c true, NFM (12.5kHz) channels are imported. */
+    bool nfm = true;
+    /** If @c true, rows of modes not supported by qdmr (e.g., AM, DV) are skipped. Otherwise,
+     * the import fails. */
+    bool skipUnsupported = false;
+
+    /** Returns @c true, if the given receive frequency is within one of the bands. */
+    bool accepts(const Frequency &rx) const;
+  };
 
 public:
   /** Reads a CHIRP CSV file from the given stream and updates the given configuration.
    * Please note, that the CHRIP generic CSV does not contain a functional DMR codeplug. */
   static bool read(QTextStream &stream, Config *config, const ErrorStack &err=ErrorStack());
+  /** Reads those channels of a CHIRP CSV file from the given stream that pass the given filter.
+   * All channels are added at once to the channel list of the given configuration. */
+  static bool read(QTextStream &stream, Config *config, const Filter &filter,
+                   const ErrorStack &err=ErrorStack());
 
 protected:
-  /** Internal used method to read a line from the given stream.
-   * This method also implements the proper quotation parsing of strings. */
-  static bool readLine(QTextStream &stream, QStringList &list, const ErrorStack &err=ErrorStack());
+  /** Column indices of the known fields, -1 if a column is not present. */
+  struct Columns {
+    int count = 0;          ///< Total number of columns.
+    int name = -1;          ///< Index of the "Name" column.
+    int frequency = -1;     ///< Index of the "Frequency" column.
+    int duplex = -1;        ///< Index of the "Duplex" column.
+    int offset = -1;        ///< Index of the "Offset" column.
+    int mode = -1;          ///< Index of the "Mode" column.
+    int tone = -1;          ///< Index of the "Tone" column.
+    int rToneFreq = -1;     ///< Index of the "rToneFreq" column.
+    int cToneFreq = -1;     ///< Index of the "cToneFreq" column.
+    int dtcsCode = -1;      ///< Index of the "DtcsCode" column.
+    int rxDtcsCode = -1;    ///< Index of the "RxDtcsCode" column.
+    int dtcsPolarity = -1;  ///< Index of the "DtcsPolarity" column.
+    int crossMode = -1;     ///< Index of the "CrossMode" column.
+  };
+
+  /** Internal used method to split a line into its fields. The fields refer to the given line,
+   * hence nothing gets copied. This method also implements the quotation parsing of strings. */
+  static void splitLine(const QString &line, QVector<QStringView> &fields);
 
-  /** Line parser, the header must be read before and passed to this method. The parsed channel is
-   * added to the configuration. */
-  static bool processLine(const QStringList &header, const QStringList &line,
-                          Config *config, const ErrorStack &err=ErrorStack());
+  /** Line parser, the column indices must be obtained from the header before and passed to this
+   * method. If the row passes the filter, the parsed channel is appended to @c channels. */
+  static bool processLine(const Columns &columns, const QVector<QStringView> &line,
+                          const Filter &filter, QVector<ConfigObject *> &channels,
+                          const ErrorStack &err=ErrorStack());
 
   /** Helper function to parse a duplex column. */
-  static bool processDuplex(const QString &code, Duplex &duplex, const ErrorStack &err=ErrorStack());
+  static bool processDuplex(QStringView code, Duplex &duplex, const ErrorStack &err=ErrorStack());
   /** Helper function to parse a mode column. */
-  static bool processMode(const QString &code, Mode &mode, const ErrorStack &err=ErrorStack());
+  static bool processMode(QStringView code, Mode &mode, const ErrorStack &err=ErrorStack());
   /** Helper function to parse a tone mode column. */
-  static bool processToneMode(const QString &code, ToneMode &mode, const ErrorStack &err=ErrorStack());
+  static bool processToneMode(QStringView code, ToneMode &mode, const ErrorStack &err=ErrorStack());
   /** Helper function to parse a polarity column. */
-  static bool processPolarity(const QString &code, Polarity &txPol, Polarity &rxPol, const ErrorStack &err=ErrorStack());
+  static bool processPolarity(QStringView code, Polarity &txPol, Polarity &rxPol, const ErrorStack &err=ErrorStack());
   /** Helper function to parse a cross mode column. */
-  static bool processCrossMode(const QString &code, CrossMode &crossMode, const ErrorStack &err = ErrorStack());
+  static bool processCrossMode(QStringView code, CrossMode &crossMode, const ErrorStack &err = ErrorStack());
 };
 
 
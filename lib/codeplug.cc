@@ -1,21 +1,110 @@
 #include "codeplug.hh"
 #include "config.hh"
 #include <QtEndian>
+#include <QThread>
 #include "logger.hh"
 #include "roamingchannel.hh"
 #include "configcopyvisitor.hh"
+#include "dfupatch.hh"
+#include "utils.hh"
+#include "objectarena.hh"
+#include "stringpool.hh"
+#include "taskscheduler.hh"
+#include <atomic>
+#include "tracer.hh"
+
+/** Indices below this limit are resolved through a flat vector, larger ones through a hash. */
+#define MAX_FLAT_INDEX 0x10000
 
 
 /* ********************************************************************************************* *
  * Implementation of CodePlug::Flags
  * ********************************************************************************************* */
 Codeplug::Flags::Flags()
-  : updateCodePlug(true), autoEnableGPS(false), autoEnableRoaming(false)
+  : updateCodePlug(true), autoEnableGPS(false), autoEnableRoaming(false), encodeThreads(1)
 {
   // pass...
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of CodePlug::Sections
+ * ********************************************************************************************* */
+/** Names of the sections in the order of their flags. */
+static const char *sectionNames[] = {
+  "radioids", "contacts", "grouplists", "channels", "zones", "scanlists", "positioning",
+  "roaming", "settings", nullptr
+};
+
+Codeplug::Sections::Sections(unsigned int sections)
+  : _sections(sections & All)
+{
+  // pass...
+}
+
+bool
+Codeplug::Sections::isAll() const {
+  return All == _sections;
+}
+
+bool
+Codeplug::Sections::has(Section section) const {
+  return _sections & section;
+}
+
+Codeplug::Sections
+Codeplug::Sections::resolved() const {
+  unsigned int sections = _sections | RadioIDs;
+  // The settings refer to almost everything
+  if (sections & Settings)
+    sections = All;
+  // Zones, scan lists and positioning systems refer to channels
+  if (sections & (Zones | ScanLists | Positioning))
+    sections |= Channels;
+  // Digital channels and group lists refer to contacts
+  if (sections & (Channels | GroupLists))
+    sections |= Contacts;
+  return Sections(sections);
+}
+
+QString
+Codeplug::Sections::format() const {
+  QStringList names;
+  for (unsigned int i=0; nullptr != sectionNames[i]; i++) {
+    if (_sections & (1u << i))
+      names.append(sectionNames[i]);
+  }
+  return names.join(",");
+}
+
+bool
+Codeplug::Sections::parse(const QString &list, Sections &sections, const ErrorStack &err) {
+  unsigned int selected = 0;
+  foreach (QString name, list.split(",", Qt::SkipEmptyParts)) {
+    name = name.simplified().toLower();
+    if ("all" == name) {
+      selected = All;
+      continue;
+    }
+    unsigned int i=0;
+    while ((nullptr != sectionNames[i]) && (name != sectionNames[i]))
+      i++;
+    if (nullptr == sectionNames[i]) {
+      errMsg(err) << "Unknown codeplug section '" << name << "', expected one of "
+                  << Sections(All).format() << ".";
+      return false;
+    }
+    selected |= (1u << i);
+  }
+  if (0 == selected) {
+    errMsg(err) << "No codeplug section selected.";
+    return false;
+  }
+  sections = Sections(selected);
+  return true;
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of CodePlug::Element
  * ********************************************************************************************* */
@@ -65,6 +154,11 @@ Codeplug::Element::fill(uint8_t value, unsigned offset, int size) {
   return true;
 }
 
+void
+Codeplug::Element::fieldOverflow(unsigned int offset) const {
+  logFatal() << "Cannot access field at " << QString::number(offset, 16) << ": Overflow.";
+}
+
 bool
 Codeplug::Element::getBit(const Offset::BitOffset &offset) const {
   return getBit(offset.byte, offset.bit);
@@ -504,10 +598,7 @@ Codeplug::Element::getBCD8_be(unsigned offset) const {
     return 0;
   }
 
-  uint32_t val = getUInt32_be(offset);
-  return (val & 0xf) + ((val>>4) & 0xf)*10 + ((val>>8) & 0xf)*100 + ((val>>12) & 0xf)*1000 +
-      ((val>>16) & 0xf)*10000 + ((val>>20) & 0xf)*100000 + ((val>>24) & 0xf)*1000000 +
-      ((val>>28) & 0xf)*10000000;
+  return decode_bcd8(getUInt32_be(offset));
 }
 void
 Codeplug::Element::setBCD8_be(unsigned offset, uint32_t val) {
@@ -516,15 +607,7 @@ Codeplug::Element::setBCD8_be(unsigned offset, uint32_t val) {
     return;
   }
 
-  uint32_t a  = (val / 10000000) % 10;
-  uint32_t b  = (val /  1000000) % 10;
-  uint32_t c  = (val /   100000) % 10;
-  uint32_t d  = (val /    10000) % 10;
-  uint32_t e  = (val /     1000) % 10;
-  uint32_t f  = (val /      100) % 10;
-  uint32_t g  = (val /       10) % 10;
-  uint32_t h  = (val /        1) % 10;
-  setUInt32_be(offset, (a << 28) + (b << 24) + (c << 20) + (d << 16) + (e << 12) + (f << 8) + (g << 4) + h);
+  setUInt32_be(offset, encode_bcd8(val));
 }
 uint32_t
 Codeplug::Element::getBCD8_le(unsigned offset) const {
@@ -533,10 +616,7 @@ Codeplug::Element::getBCD8_le(unsigned offset) const {
     return 0;
   }
 
-  uint32_t val = getUInt32_le(offset);
-  return (val & 0xf) + ((val>>4) & 0xf)*10 + ((val>>8) & 0xf)*100 + ((val>>12) & 0xf)*1000 +
-      ((val>>16) & 0xf)*10000 + ((val>>20) & 0xf)*100000 + ((val>>24) & 0xf)*1000000 +
-      ((val>>28) & 0xf)*10000000;
+  return decode_bcd8(getUInt32_le(offset));
 }
 void
 Codeplug::Element::setBCD8_le(unsigned offset, uint32_t val) {
@@ -545,55 +625,25 @@ Codeplug::Element::setBCD8_le(unsigned offset, uint32_t val) {
     return;
   }
 
-  uint32_t a  = (val / 10000000) % 10;
-  uint32_t b  = (val /  1000000) % 10;
-  uint32_t c  = (val /   100000) % 10;
-  uint32_t d  = (val /    10000) % 10;
-  uint32_t e  = (val /     1000) % 10;
-  uint32_t f  = (val /      100) % 10;
-  uint32_t g  = (val /       10) % 10;
-  uint32_t h  = (val /        1) % 10;
-  setUInt32_le(offset, (a << 28) + (b << 24) + (c << 20) + (d << 16) + (e << 12) + (f << 8) + (g << 4) + h);
+  setUInt32_le(offset, encode_bcd8(val));
 }
 
 QString
 Codeplug::Element::readASCII(unsigned offset, unsigned maxlen, uint8_t eos) const {
-  QString txt;
-  uint8_t *ptr = (uint8_t *)(_data+offset);
-  for (unsigned i=0; (i<maxlen)&&(ptr[i])&&(eos!=ptr[i]); i++) {
-    txt.append(QChar::fromLatin1(ptr[i]));
-  }
-  return txt;
+  return decode_ascii(_data+offset, maxlen, eos);
 }
 void
 Codeplug::Element::writeASCII(unsigned offset, const QString &txt, unsigned maxlen, uint8_t eos) {
-  uint8_t *ptr = (uint8_t *)(_data+offset);
-  for (unsigned i=0; i<maxlen; i++) {
-    if (i < unsigned(txt.length()))
-      ptr[i] = txt.at(i).toLatin1();
-    else
-      ptr[i] = eos;
-  }
+  encode_ascii(_data+offset, txt, maxlen, eos);
 }
 
 QString
 Codeplug::Element::readUnicode(unsigned offset, unsigned maxlen, uint16_t eos) const {
-  QString txt;
-  uint16_t *ptr = (uint16_t *)(_data+offset);
-  for (unsigned i=0; (i<maxlen)&&(eos!=ptr[i]); i++) {
-    txt.append(QChar(ptr[i]));
-  }
-  return txt;
+  return decode_unicode((const uint16_t *)(_data+offset), maxlen, eos);
 }
 void
 Codeplug::Element::writeUnicode(unsigned offset, const QString &txt, unsigned maxlen, uint16_t eos) {
-  uint16_t *ptr = (uint16_t *)(_data+offset);
-  for (unsigned i=0; i<maxlen; i++) {
-    if (i < unsigned(txt.length()))
-      ptr[i] = txt.at(i).unicode();
-    else
-      ptr[i] = eos;
-  }
+  encode_unicode((uint16_t *)(_data+offset), txt, maxlen, eos);
 }
 
 
@@ -601,7 +651,7 @@ Codeplug::Element::writeUnicode(unsigned offset, const QString &txt, unsigned ma
  * Implementation of CodePlug::Context
  * ********************************************************************************************* */
 Codeplug::Context::Context(Config *config)
-  : _config(config), _tables()
+  : _config(config), _tables(), _tableTypes(), _resolved(), _shared(false), _incremental(false)
 {
   // Add tables for common elements
   addTable(&DMRRadioID::staticMetaObject);
@@ -625,62 +675,157 @@ Codeplug::Context::config() const {
 
 bool
 Codeplug::Context::hasTable(const QMetaObject *obj) const {
-  // Find a matching table
-  if (_tables.contains(obj->className()))
+  return 0 <= tableIndex(obj);
+}
+
+int
+Codeplug::Context::tableIndex(const QMetaObject *obj) const {
+  QHash<const QMetaObject *, int>::const_iterator cached = _resolved.constFind(obj);
+  if (_resolved.constEnd() != cached)
+    return cached.value();
+
+  // Find a matching table for the type or any of its super classes
+  int idx = -1;
+  for (const QMetaObject *type = obj; (nullptr != type) && (0 > idx); type = type->superClass())
+    idx = _tableTypes.value(type, -1);
+  // Do not touch the cache while other threads may read it
+  if (! _shared)
+    _resolved.insert(obj, idx);
+  return idx;
+}
+
+bool
+Codeplug::Context::hasSameIndices(const Context &other) const {
+  if ((_tables.size() != other._tables.size()) || (_tableTypes != other._tableTypes))
+    return false;
+  for (int i=0; i<_tables.size(); i++) {
+    if (_tables.at(i).indices != other._tables.at(i).indices)
+      return false;
+  }
+  return true;
+}
+
+bool
+Codeplug::Context::isIncremental() const {
+  return _incremental;
+}
+
+void
+Codeplug::Context::setIncremental(bool incremental) {
+  _incremental = incremental;
+}
+
+bool
+Codeplug::Context::isDirty(const QMetaObject *type) const {
+  if (! _incremental)
+    return true;
+  int idx = tableIndex(type);
+  if (0 > idx)
     return true;
-  else if (obj->superClass())
-    return hasTable(obj->superClass());
+  const Table &table = _tables.at(idx);
+  QHash<ConfigItem *, unsigned>::const_iterator item = table.indices.constBegin();
+  for (; item != table.indices.constEnd(); item++) {
+    if (item.key()->isDirty())
+      return true;
+  }
   return false;
 }
 
+void
+Codeplug::Context::clearDirty() {
+  foreach (const Table &table, _tables) {
+    QHash<ConfigItem *, unsigned>::const_iterator item = table.indices.constBegin();
+    for (; item != table.indices.constEnd(); item++)
+      item.key()->clearDirty();
+  }
+}
+
+bool
+Codeplug::Context::isShared() const {
+  return _shared;
+}
+
+void
+Codeplug::Context::setShared(bool shared) {
+  _shared = shared;
+}
+
 Codeplug::Context::Table &
 Codeplug::Context::getTable(const QMetaObject *obj) {
-  if (_tables.contains(obj->className()))
-    return _tables[obj->className()];
-  return getTable(obj->superClass());
+  return _tables[tableIndex(obj)];
 }
 
 bool
 Codeplug::Context::addTable(const QMetaObject *obj) {
   if (hasTable(obj))
     return false;
-  _tables.insert(obj->className(), Table());
+  _tableTypes.insert(obj, _tables.size());
+  _tables.append(Table());
+  // A new table may change the resolution of derived types
+  _resolved.clear();
   return true;
 }
 
 ConfigItem *
 Codeplug::Context::obj(const QMetaObject *elementType, unsigned idx) {
-  if (! hasTable(elementType))
+  int table = tableIndex(elementType);
+  if (0 > table)
     return nullptr;
-  return getTable(elementType).objects.value(idx, nullptr);
+  return _tables[table].object(idx);
 }
 
 int
 Codeplug::Context::index(ConfigItem *obj) {
   if (nullptr == obj)
     return -1;
-  if (! hasTable(obj->metaObject()))
+  int table = tableIndex(obj->metaObject());
+  if (0 > table)
     return -1;
-  return getTable(obj->metaObject()).indices.value(obj, -1);
+  return _tables[table].indices.value(obj, -1);
 }
 
 bool
 Codeplug::Context::add(ConfigItem *obj, unsigned idx) {
-  if (!hasTable(obj->metaObject()))
+  int table = tableIndex(obj->metaObject());
+  if (0 > table)
     return false;
-  if (! getTable(obj->metaObject()).indices.contains(obj))
-    getTable(obj->metaObject()).indices.insert(obj, idx);
-  if (! getTable(obj->metaObject()).objects.contains(idx))
-    getTable(obj->metaObject()).objects.insert(idx, obj);
+  Table &tab = _tables[table];
+  if (! tab.indices.contains(obj))
+    tab.indices.insert(obj, idx);
+  tab.addObject(idx, obj);
   return true;
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of CodePlug::Context::Table
+ * ********************************************************************************************* */
+ConfigItem *
+Codeplug::Context::Table::object(unsigned idx) const {
+  if (idx < unsigned(objects.size()))
+    return objects.at(idx);
+  return sparseObjects.value(idx, nullptr);
+}
+
+void
+Codeplug::Context::Table::addObject(unsigned idx, ConfigItem *obj) {
+  if (idx >= MAX_FLAT_INDEX) {
+    if (! sparseObjects.contains(idx))
+      sparseObjects.insert(idx, obj);
+    return;
+  }
+  if (idx >= unsigned(objects.size()))
+    objects.resize(idx+1);
+  if (nullptr == objects.at(idx))
+    objects[idx] = obj;
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of CodePlug
  * ********************************************************************************************* */
 Codeplug::Codeplug(QObject *parent)
-  : DFUFile(parent)
+  : DFUFile(parent), _decodeThreads(1), _sections(), _cancel()
 {
 	// pass...
 }
@@ -689,13 +834,234 @@ Codeplug::~Codeplug() {
 	// pass...
 }
 
+unsigned int
+Codeplug::decodeThreads() const {
+  return _decodeThreads;
+}
+
+void
+Codeplug::setDecodeThreads(unsigned int threads) {
+  _decodeThreads = std::max(1u, threads);
+}
+
+const CancellationToken &
+Codeplug::cancellationToken() const {
+  return _cancel;
+}
+
+void
+Codeplug::setCancellationToken(const CancellationToken &token) {
+  _cancel = token;
+}
+
+const Codeplug::Sections &
+Codeplug::sections() const {
+  return _sections;
+}
+
+void
+Codeplug::setSections(const Sections &sections) {
+  _sections = sections.resolved();
+}
+
 Config *
 Codeplug::preprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("Codeplug::preprocess", "codeplug");
   return ConfigCopy::copy(config, err)->as<Config>();
 }
 
+void
+Codeplug::addTables(Context &ctx) const {
+  Q_UNUSED(ctx);
+}
+
+bool
+Codeplug::requiresPreprocessing(const Config *config) const {
+  Q_UNUSED(config);
+  return false;
+}
+
 bool
 Codeplug::postprocess(Config *config, const ErrorStack &err) const {
   Q_UNUSED(config); Q_UNUSED(err);
   return true;
 }
+
+bool
+Codeplug::encodeIncremental(Config *config, Context &ctx, DFUPatch &changes, const Flags &flags,
+                            const ErrorStack &err)
+{
+  Q_UNUSED(ctx);
+
+  // Keep a (shallow) copy of the current codeplug to determine the changes
+  DFUFile previous;
+  for (int i=0; i<numImages(); i++)
+    previous.addImage(image(i));
+
+  if (! encode(config, flags, err))
+    return false;
+
+  return changes.diff(previous, *this, 0, err);
+}
+
+std::vector<AddressMap::Range>
+Codeplug::generatedMemory() const {
+  return std::vector<AddressMap::Range>();
+}
+
+bool
+Codeplug::isGenerated(const std::vector<AddressMap::Range> &generated, uint32_t address, uint32_t size) {
+  for (const AddressMap::Range &range: generated) {
+    if ((address >= range.address) && ((address+size) <= (range.address+range.length)))
+      return true;
+  }
+  return false;
+}
+
+void
+Codeplug::startProgressiveDecoding() {
+  // pass...
+}
+
+void
+Codeplug::elementReady(unsigned int image, uint32_t address, uint32_t size) {
+  Q_UNUSED(image); Q_UNUSED(address); Q_UNUSED(size)
+}
+
+bool
+Codeplug::hasLazyDecoding() const {
+  return false;
+}
+
+QList<unsigned int>
+Codeplug::channelIndices() {
+  return QList<unsigned int>();
+}
+
+Channel *
+Codeplug::decodeChannel(unsigned int idx, Context &ctx, const ErrorStack &err) {
+  Q_UNUSED(idx); Q_UNUSED(ctx);
+  errMsg(err) << "Lazy decoding is not implemented for this codeplug.";
+  return nullptr;
+}
+
+QStringList
+Codeplug::zoneNames(const ErrorStack &err) {
+  errMsg(err) << "Lazy decoding is not implemented for this codeplug.";
+  return QStringList();
+}
+
+QList<DMRRadioID *>
+Codeplug::decodeRadioIDs(Context &ctx, const ErrorStack &err) {
+  Q_UNUSED(ctx);
+  errMsg(err) << "Lazy decoding is not implemented for this codeplug.";
+  return QList<DMRRadioID *>();
+}
+
+bool
+Codeplug::decodeChannelTable(ChannelTable &table, const ErrorStack &err) {
+  Q_UNUSED(table);
+  errMsg(err) << "Lazy decoding is not implemented for this codeplug.";
+  return false;
+}
+
+bool
+Codeplug::decodeContactTable(ContactTable &table, const ErrorStack &err) {
+  Q_UNUSED(table);
+  errMsg(err) << "Lazy decoding is not implemented for this codeplug.";
+  return false;
+}
+
+bool
+Codeplug::runTasks(const QVector<Task> &tasks, Context &ctx, unsigned int threads, const ErrorStack &err) {
+  TRACE_SPAN("Codeplug::runTasks", "codeplug");
+  if ((2 > threads) || (2 > tasks.size())) {
+    foreach (const Task &task, tasks) {
+      if ((! _cancel.check(err)) || (! task(err)))
+        return false;
+    }
+    return true;
+  }
+
+  if (! prepareConcurrentAccess()) {
+    logDebug() << "Codeplug does not support concurrent access, run tasks sequentially.";
+    return runTasks(tasks, ctx, 1, err);
+  }
+
+  bool wasShared = ctx.isShared();
+  ctx.setShared(true);
+
+  // Each lane runs the next task not started yet, hence at most @c threads tasks run at once.
+  QVector<ErrorStack> errors(tasks.size());
+  QVector<char> results(tasks.size(), 0);
+  ErrorStack *taskErrors = errors.data();
+  char *taskResults = results.data();
+  std::atomic<int> next(0);
+  StringPool *strings = StringPool::current();
+  CancellationToken cancel = _cancel;
+  TaskGroup group;
+  for (unsigned int i=0; i<std::min(unsigned(tasks.size()), threads); i++) {
+    group.run([&tasks, &next, taskErrors, taskResults, strings, cancel](const ErrorStack &err) {
+      Q_UNUSED(err);
+      // Objects created by the tasks are pooled per thread, strings with those of the caller
+      ObjectArena::Scope arena;
+      StringPool::Scope pool(strings);
+      for (int t=next.fetch_add(1); t<tasks.size(); t=next.fetch_add(1)) {
+        // Skipped tasks keep their result false
+        if (cancel.isCanceled())
+          break;
+        TRACE_SPAN("Codeplug::task", "codeplug");
+        taskResults[t] = tasks[t](taskErrors[t]);
+      }
+      return true;
+    });
+  }
+  group.wait();
+  ctx.setShared(wasShared);
+
+  // Merge errors in task order
+  bool success = true;
+  for (int t=0; t<tasks.size(); t++) {
+    err.take(errors[t]);
+    success &= bool(results[t]);
+  }
+  if (! success)
+    _cancel.check(err);
+
+  return success;
+}
+
+void
+Codeplug::createObjects(unsigned int count, const ObjectFactory &factory,
+                        QVector<ConfigItem *> &objects, Context &ctx)
+{
+  TRACE_SPAN("Codeplug::createObjects", "codeplug");
+  objects.fill(nullptr, count);
+  if (0 == count)
+    return;
+
+  // Split index range into contiguous chunks, one per thread
+  QThread *target = QThread::currentThread();
+  ConfigItem **result = objects.data();
+  unsigned int chunks = std::min(count, _decodeThreads);
+  unsigned int chunkSize = (count + chunks - 1)/chunks;
+  StringPool *pool = StringPool::current();
+  QVector<Task> tasks;
+  for (unsigned int first=0; first<count; first+=chunkSize) {
+    unsigned int last = std::min(count, first+chunkSize);
+    tasks.append([first, last, target, result, pool, &factory](const ErrorStack &err) {
+      Q_UNUSED(err);
+      ObjectArena::Scope arena;
+      StringPool::Scope strings(pool);
+      for (unsigned int i=first; i<last; i++) {
+        ConfigItem *obj = factory(i);
+        if ((nullptr != obj) && (obj->thread() != target))
+          obj->moveToThread(target);
+        result[i] = obj;
+      }
+      return true;
+    });
+  }
+
+  runTasks(tasks, ctx, _decodeThreads);
+}
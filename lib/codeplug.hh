@@ -3,13 +3,23 @@
 
 #include <QObject>
 #include <QHash>
+#include <QStringList>
+#include <functional>
+#include <cstring>
 #include "dfufile.hh"
+#include "utils.hh"
+#include "cancellation.hh"
 
 //#include "userdatabase.hh"
 //#include "config.hh"
 
 class Config;
 class ConfigItem;
+struct ChannelTable;
+struct ContactTable;
+class DFUPatch;
+class Channel;
+class DMRRadioID;
 
 
 /** This class defines the interface all device-specific code-plugs must implement.
@@ -35,11 +45,56 @@ public:
     /** If @c true enables automatic roaming when there is a roaming zone defined that is used by any
      * channel. This may cause automatic transmissions, hence the default is @c false. */
     bool autoEnableRoaming;
+    /** Maximum number of threads used to encode independent sections of the codeplug
+     * concurrently. If @c 1, all sections are encoded sequentially. Default @c 1. */
+    unsigned int encodeThreads;
 
     /** Default constructor, enables code-plug update and disables automatic GPS/APRS and roaming. */
     Flags();
   };
 
+  /** Selects the sections of a codeplug, that get downloaded and decoded.
+   *
+   * Codeplugs supporting the selection only download the memory needed to decode the selected
+   * sections and only decode those into the config. Sections depend on each other, e.g., zones
+   * refer to channels. Hence, @c resolved adds all sections required to decode the selected
+   * ones. The radio IDs are always decoded. */
+  class Sections {
+  public:
+    /** The possible sections. */
+    enum Section {
+      RadioIDs    = 0x001,  ///< The radio IDs.
+      Contacts    = 0x002,  ///< Digital and analog contacts.
+      GroupLists  = 0x004,  ///< RX group lists.
+      Channels    = 0x008,  ///< Channels.
+      Zones       = 0x010,  ///< Zones.
+      ScanLists   = 0x020,  ///< Scan lists.
+      Positioning = 0x040,  ///< GPS and APRS systems.
+      Roaming     = 0x080,  ///< Roaming channels and zones.
+      Settings    = 0x100,  ///< General settings, boot settings and messages.
+      All         = 0x1ff   ///< Everything.
+    };
+
+    /** Selects the given sections, all by default. */
+    explicit Sections(unsigned int sections=All);
+
+    /** Returns @c true if all sections are selected. */
+    bool isAll() const;
+    /** Returns @c true if the given section is selected. */
+    bool has(Section section) const;
+    /** Returns the selected sections together with all sections they depend on. */
+    Sections resolved() const;
+    /** Returns a comma separated list of the selected sections. */
+    QString format() const;
+
+    /** Parses a comma separated list of section names (e.g., "zones,contacts"). */
+    static bool parse(const QString &list, Sections &sections, const ErrorStack &err=ErrorStack());
+
+  protected:
+    /** The selected sections. */
+    unsigned int _sections;
+  };
+
   /** Represents the abstract base class of all codeplug elements.
    *
    * That is a memory region within the codeplug that encodes a specific element. E.g., channels,
@@ -81,6 +136,45 @@ public:
       };
     };
 
+    /** Possible encodings of a field. */
+    enum class FieldEncoding {
+      Bits,        ///< Unsigned integer of up to 8 bits within a single byte.
+      UInt_le,     ///< Little-endian unsigned integer of 8, 16, 24 or 32 bits.
+      UInt_be,     ///< Big-endian unsigned integer of 8, 16, 24 or 32 bits.
+      BCD_le,      ///< Little-endian BCD value of 2, 4, 6 or 8 digits.
+      BCD_be       ///< Big-endian BCD value of 2, 4, 6 or 8 digits.
+    };
+
+    /** Compile-time descriptor of a field within an element.
+     *
+     * Describes the position (byte offset and bit), width (in bits) and encoding of a field.
+     * Accessing a field through @c getField and @c setField resolves all offset computations at compile
+     * time and inlines the access. Only a single bounds-check remains.
+     *
+     * @code
+     * typedef Field<0x0000, 0, 32, FieldEncoding::BCD_be> RXFrequency;
+     * unsigned int freq = getField<RXFrequency>()*10;
+     * @endcode */
+    template <unsigned int Byte, unsigned int Bit, unsigned int Width,
+              FieldEncoding Encoding=FieldEncoding::Bits>
+    struct Field {
+      static_assert((FieldEncoding::Bits != Encoding) || ((Bit+Width) <= 8),
+                    "Bit fields must not cross byte boundaries.");
+      static_assert((FieldEncoding::Bits == Encoding) ||
+                    ((0 == Bit) && (0 == (Width%8)) && (8 <= Width) && (32 >= Width)),
+                    "Multi-byte fields must be byte-aligned and 8, 16, 24 or 32 bits wide.");
+      /** The byte offset of the field. */
+      static constexpr unsigned int byte() { return Byte; }
+      /** The bit within the byte, the field starts at. */
+      static constexpr unsigned int bit() { return Bit; }
+      /** The width of the field in bits. */
+      static constexpr unsigned int width() { return Width; }
+      /** The number of bytes touched by the field. */
+      static constexpr unsigned int bytes() { return (Bit+Width+7)/8; }
+      /** The encoding of the field. */
+      static constexpr FieldEncoding encoding() { return Encoding; }
+    };
+
   protected:
     /** Hidden constructor.
      * @param ptr Specifies the pointer to the element within the codeplug.
@@ -221,6 +315,92 @@ public:
      * The stored string gets padded with @c eos to @c maxlen. */
     void writeUnicode(unsigned offset, const QString &txt, unsigned maxlen, uint16_t eos=0x0000);
 
+    /** Reads the field described by the descriptor @c F. */
+    template <class F>
+    inline uint32_t getField() const {
+      if ((F::byte()+F::bytes()) > _size) {
+        fieldOverflow(F::byte());
+        return 0;
+      }
+      return readField<F>(_data);
+    }
+
+    /** Stores the given value in the field described by the descriptor @c F. */
+    template <class F>
+    inline void setField(uint32_t value) {
+      if ((F::byte()+F::bytes()) > _size) {
+        fieldOverflow(F::byte());
+        return;
+      }
+      writeField<F>(_data, value);
+    }
+
+    /** Reads the field described by the descriptor @c F from the element at @c data without any
+     * bounds-check. */
+    template <class F>
+    static inline uint32_t readField(const uint8_t *data) {
+      const uint8_t *ptr = data + F::byte();
+      if (FieldEncoding::Bits == F::encoding())
+        return (ptr[0] >> F::bit()) & fieldMask<F>();
+      uint32_t value = 0;
+      for (unsigned int i=0; i<F::bytes(); i++) {
+        if ((FieldEncoding::UInt_le == F::encoding()) || (FieldEncoding::BCD_le == F::encoding()))
+          value |= uint32_t(ptr[i]) << (8*i);
+        else
+          value = (value << 8) | ptr[i];
+      }
+      if ((FieldEncoding::UInt_le == F::encoding()) || (FieldEncoding::UInt_be == F::encoding()))
+        return value;
+      return decode_bcd8(value);
+    }
+
+    /** Stores the given value in the field described by the descriptor @c F into the element at
+     * @c data without any bounds-check. */
+    template <class F>
+    static inline void writeField(uint8_t *data, uint32_t value) {
+      uint8_t *ptr = data + F::byte();
+      if (FieldEncoding::Bits == F::encoding()) {
+        ptr[0] = (ptr[0] & ~(fieldMask<F>() << F::bit())) | ((value & fieldMask<F>()) << F::bit());
+        return;
+      }
+      if ((FieldEncoding::BCD_le == F::encoding()) || (FieldEncoding::BCD_be == F::encoding()))
+        value = encode_bcd8(value);
+      for (unsigned int i=0; i<F::bytes(); i++) {
+        if ((FieldEncoding::UInt_le == F::encoding()) || (FieldEncoding::BCD_le == F::encoding()))
+          ptr[i] = (value >> (8*i)) & 0xff;
+        else
+          ptr[F::bytes()-1-i] = (value >> (8*i)) & 0xff;
+      }
+    }
+
+    /** Reads several fields at once into the given variables. The fields are specified as
+     * template arguments, the destinations (e.g., members of a struct) as function arguments
+     * in the same order. */
+    template <class ...Fields, class ...Values>
+    inline void getFields(Values &...values) const {
+      static_assert(sizeof...(Fields) == sizeof...(Values), "Number of fields and values must match.");
+      int unused[] = { 0, ((values = Values(getField<Fields>())), 0)... };
+      Q_UNUSED(unused);
+    }
+
+    /** Stores several fields at once. The fields are specified as template arguments, the values
+     * as function arguments in the same order. */
+    template <class ...Fields, class ...Values>
+    inline void setFields(Values ...values) {
+      static_assert(sizeof...(Fields) == sizeof...(Values), "Number of fields and values must match.");
+      int unused[] = { 0, (setField<Fields>(uint32_t(values)), 0)... };
+      Q_UNUSED(unused);
+    }
+
+  protected:
+    /** Returns the bit mask for a bit field. */
+    template <class F>
+    static constexpr uint32_t fieldMask() {
+      return (F::width() >= 32) ? 0xffffffff : ((uint32_t(1) << (F::width()%32)) - 1);
+    }
+    /** Reports an out-of-bounds field access. */
+    void fieldOverflow(unsigned int offset) const;
+
   protected:
     /** Holds the pointer to the element. */
     uint8_t *_data;
@@ -228,6 +408,51 @@ public:
     size_t _size;
   };
 
+  /** Lightweight view of an element of fixed size.
+   *
+   * Unlike @c Element, the view is neither polymorphic nor does it hold the size. It is just a
+   * trivially copyable pointer, the size is given at compile time. Hence field accesses get
+   * checked at compile time and per-record loops over many views (e.g., index entries) can be
+   * inlined and vectorized by the compiler. Use @c Element for everything else.
+   *
+   * @code
+   * typedef Element::Field<0x0000, 0, 32, Element::FieldEncoding::UInt_le> ID;
+   * ElementView<8> entry(ptr); entry.setField<ID>(2621370);
+   * @endcode */
+  template <unsigned int Size>
+  class ElementView
+  {
+  public:
+    /** Constructs a view of the element at the given address. */
+    explicit inline ElementView(uint8_t *ptr) : _data(ptr) { }
+
+    /** Returns the size of the element. */
+    static constexpr unsigned int size() { return Size; }
+    /** Returns the pointer to the element. */
+    inline uint8_t *data() const { return _data; }
+    /** Returns @c true if the pointer is not null. */
+    inline bool isValid() const { return nullptr != _data; }
+    /** Sets the entire element to the given value. */
+    inline void fill(uint8_t value) const { memset(_data, value, Size); }
+
+    /** Reads the field described by the descriptor @c F. */
+    template <class F>
+    inline uint32_t getField() const {
+      static_assert((F::byte()+F::bytes()) <= Size, "Field exceeds element.");
+      return Element::readField<F>(_data);
+    }
+    /** Stores the given value in the field described by the descriptor @c F. */
+    template <class F>
+    inline void setField(uint32_t value) const {
+      static_assert((F::byte()+F::bytes()) <= Size, "Field exceeds element.");
+      Element::writeField<F>(_data, value);
+    }
+
+  protected:
+    /** Holds the pointer to the element. */
+    uint8_t *_data;
+  };
+
   /** Base class for all codeplug contexts.
    * Each device specific codeplug may extend this class to allow for device specific elements to
    * be indexed in a separate index. By default tables for @c DigitalContact, @c RXGroupList,
@@ -257,6 +482,27 @@ public:
     /** Returns @c true if a table is defined for the given type. */
     bool hasTable(const QMetaObject *obj) const;
 
+    /** Returns @c true if both contexts associate the same objects with the same indices. */
+    bool hasSameIndices(const Context &other) const;
+
+    /** Returns @c true if the context is used for an incremental encoding. */
+    bool isIncremental() const;
+    /** Enables incremental encoding. Then, @c isDirty reflects the state of the indexed objects
+     * instead of always returning @c true. */
+    void setIncremental(bool incremental);
+    /** Returns @c true if any object of the given type was modified since it was last encoded
+     * (see @c ConfigItem::isDirty). Unless the context is used for incremental encoding, this
+     * method always returns @c true. */
+    bool isDirty(const QMetaObject *type) const;
+    /** Marks all indexed objects as clean. */
+    void clearDirty();
+
+        /** Returns @c true if the context is currently shared between several threads. */
+    bool isShared() const;
+    /** Marks the context as shared between several threads. While shared, the context must not
+     * be modified and lookups do not update the type cache. */
+    void setShared(bool shared);
+
     /** Returns the object associated by the given index and type. */
     template <class T>
     T* get(unsigned idx) {
@@ -269,6 +515,12 @@ public:
       return nullptr != this->obj(&(T::staticMetaObject), idx)->template as<T>();
     }
 
+    /** Returns @c true if any object of the specified type was modified, see @c isDirty. */
+    template <class T>
+    bool isDirty() const {
+      return isDirty(&T::staticMetaObject);
+    }
+
     /** Returns the number of elements for the specified type. */
     template <class T>
     unsigned int count() {
@@ -279,13 +531,24 @@ public:
     /** Internal used table type to associate objects and indices. */
     class Table {
     public:
-      /** The index->object map. */
-      QHash<unsigned, ConfigItem *> objects;
+      /** Returns the object associated with the given index or @c nullptr. */
+      ConfigItem *object(unsigned idx) const;
+      /** Associates the index with the given object, unless the index is already taken. */
+      void addObject(unsigned idx, ConfigItem *obj);
+
+    public:
+      /** The index->object map for small indices. */
+      QVector<ConfigItem *> objects;
+      /** The index->object map for indices exceeding the flat vector. */
+      QHash<unsigned, ConfigItem *> sparseObjects;
       /** The object->index map. */
       QHash<ConfigItem *, unsigned> indices;
     };
 
   protected:
+    /** Returns the index of the table for the given type or any of its super classes, or -1 if
+     * there is none. The result gets cached per type. */
+    int tableIndex(const QMetaObject *obj) const;
     /** Returns a reference to the table for the given type. */
     Table &getTable(const QMetaObject *obj);
 
@@ -293,22 +556,90 @@ public:
     /** A weak reference to the config object. */
     Config *_config;
     /** Table of tables. */
-    QHash<QString, Table> _tables;
+    QVector<Table> _tables;
+    /** Maps the types of the tables to the table index. */
+    QHash<const QMetaObject *, int> _tableTypes;
+    /** Caches the resolved table index for every type looked up, including derived types. */
+    mutable QHash<const QMetaObject *, int> _resolved;
+    /** If @c true, the context is shared between threads. */
+    bool _shared;
+    /** If @c true, the context is used for an incremental encoding. */
+    bool _incremental;
   };
 
+  /** An independent encoding or decoding step, e.g., encoding all channels. */
+  typedef std::function<bool(const ErrorStack &err)> Task;
+  /** Creates a new object from the element with the given index or returns @c nullptr if there
+   * is none. */
+  typedef std::function<ConfigItem *(unsigned int idx)> ObjectFactory;
+
 protected:
   /** Hidden default constructor. */
   explicit Codeplug(QObject *parent=nullptr);
 
+  /** Runs the given tasks using up to @c threads threads and waits for all of them.
+   *
+   * The tasks must write to disjoint memory sections and must neither allocate nor free any
+   * memory of the codeplug. The context is shared between the tasks and therefore must not be
+   * modified. Each task gets its own error stack, which are merged into @c err in task order.
+   * Hence, the result does not depend on the scheduling. If @c threads is less than 2, the tasks
+   * are run sequentially and the first failing task stops processing. Once the cancellation
+   * token got canceled, the remaining tasks are skipped.
+   * @returns @c false if any task failed or got skipped. */
+  bool runTasks(const QVector<Task> &tasks, Context &ctx, unsigned int threads,
+                const ErrorStack &err=ErrorStack());
+
+  /** Creates the objects for all element indices @c [0, count) using the given @c factory.
+   *
+   * The index range is split evenly across up to @c decodeThreads threads. The factory must only
+   * read the codeplug and the context and must return new objects without parent. These objects
+   * are moved to the calling thread and stored in @c objects in index order, such that they can
+   * be added to the config deterministically afterwards. As each object gets created in a
+   * different thread, the factory must only be used for objects, that do not hold lists of
+   * references (e.g., channels or contacts). */
+  void createObjects(unsigned int count, const ObjectFactory &factory,
+                     QVector<ConfigItem *> &objects, Context &ctx);
+
+protected:
+  /** Maximum number of threads used to decode elements concurrently. */
+  unsigned int _decodeThreads;
+  /** The sections being downloaded and decoded. */
+  Sections _sections;
+  /** The token, encoding and decoding are canceled with. */
+  CancellationToken _cancel;
+
 public:
   /** Destructor. */
   virtual ~Codeplug();
 
+  /** Returns the maximum number of threads used to create the objects of the same type
+   * concurrently when decoding the codeplug. */
+  unsigned int decodeThreads() const;
+  /** Sets the maximum number of threads used to create the objects concurrently when decoding
+   * the codeplug. If @c 1, all objects are created sequentially (default). */
+  void setDecodeThreads(unsigned int threads);
+
+  /** Returns the token, encoding and decoding are canceled with. */
+  const CancellationToken &cancellationToken() const;
+  /** Sets the token, encoding and decoding are canceled with. The token is checked before every
+   * task (see @c runTasks), hence a canceled encoding or decoding fails with an error message. */
+  void setCancellationToken(const CancellationToken &token);
+
   /** Indexes all elements of the codeplug.
    * This method must be implemented by any device or vendor specific codeplug to map config
    * objects to indices used within the binary codeplug to address each element (e.g., channels,
    * contacts etc.). */
   virtual bool index(Config *config, Context &ctx, const ErrorStack &err=ErrorStack()) const = 0;
+  /** Adds the device specific tables to the given context, before the config gets indexed into
+   * it (see @c index). The default implementation adds nothing. */
+  virtual void addTables(Context &ctx) const;
+
+  /** Returns the sections being downloaded and decoded. */
+  const Sections &sections() const;
+  /** Selects the sections being downloaded and decoded. Codeplugs not supporting the selection
+   * always download and decode the complete codeplug. The selection gets resolved, such that
+   * the sections required by the selected ones are included. */
+  virtual void setSections(const Sections &sections);
 
   /** Decodes a binary codeplug to the given abstract configuration @c config.
    * This must be implemented by the device-specific codeplug. */
@@ -320,9 +651,74 @@ public:
   /** Retruns a prepared configuration for this particular radio. All unsupported featrues are
    *  removed from the copy. The default implementation only copies the config. */
   virtual Config *preprocess(Config *config, const ErrorStack &err=ErrorStack()) const;
+  /** Returns @c true if @c preprocess would rewrite the given config. If not, the config can be
+   * verified or encoded as is, without creating a copy first. The default implementation returns
+   * @c false, as the default @c preprocess only copies the config. */
+  virtual bool requiresPreprocessing(const Config *config) const;
   /** Encodes a given abstract configuration (@c config) to the device specific binary code-plug.
    * This must be implemented by the device-specific codeplug. */
   virtual bool encode(Config *config, const Flags &flags=Flags(), const ErrorStack &err=ErrorStack()) = 0;
+
+  /** Re-encodes the given config, updating only those parts of the codeplug that were modified
+   * since the last call.
+   *
+   * Unlike @c encode, the config gets encoded as is, without preprocessing. The @c ctx holds the
+   * indices of the previous call and gets updated. Hence, the first call with an empty context
+   * encodes everything. The same config and flags must be passed on every call. All address
+   * ranges that changed are stored in @c changes, which can then be uploaded or applied to
+   * another copy of the codeplug.
+   *
+   * The default implementation encodes the entire codeplug every time.
+   * @returns @c false on error. */
+  virtual bool encodeIncremental(Config *config, Context &ctx, DFUPatch &changes,
+                                 const Flags &flags=Flags(), const ErrorStack &err=ErrorStack());
+
+  /** Returns the memory ranges of the first image, the encoder rewrites entirely, independent of
+   * their previous content (e.g., contact or zone tables). When updating a codeplug, the radio
+   * must not read these ranges from the device before encoding, but must always write them.
+   * All other memory may hold settings unknown to the encoder and gets preserved from the device.
+   * The default implementation returns an empty list, i.e., everything gets preserved. */
+  virtual std::vector<AddressMap::Range> generatedMemory() const;
+  /** Returns @c true if the memory section at @c address of the given @c size lies entirely within
+   * one of the given @c generated ranges (see @c generatedMemory). */
+  static bool isGenerated(const std::vector<AddressMap::Range> &generated, uint32_t address, uint32_t size);
+
+  /** Starts the progressive decoding of a codeplug being downloaded. Gets called by the radio,
+   * once all memory for decoding got allocated and before the first call to @c elementReady.
+   * Discards all objects created during a previous download. The default implementation does
+   * nothing. */
+  virtual void startProgressiveDecoding();
+  /** Notifies the codeplug, that the given memory range of the given image was downloaded
+   * completely. Codeplugs supporting progressive decoding start creating the objects encoded
+   * within this range in the background (see @c CodeplugPrefetch), while the download
+   * continues. These objects are then used by @c decode. The default implementation does
+   * nothing. */
+  virtual void elementReady(unsigned int image, uint32_t address, uint32_t size);
+
+  /** Returns @c true if the codeplug can decode single elements on demand, without decoding the
+   * entire codeplug. See @c CodeplugView. The default implementation returns @c false. */
+  virtual bool hasLazyDecoding() const;
+  /** Returns the indices of all channels encoded in the codeplug. Only implemented by
+   * codeplugs with lazy decoding. */
+  virtual QList<unsigned int> channelIndices();
+  /** Decodes the channel with the given index without linking it to any other object. The
+   * caller takes ownership of the returned channel. Only implemented by codeplugs with lazy
+   * decoding.
+   * @returns @c nullptr if there is no such channel. */
+  virtual Channel *decodeChannel(unsigned int idx, Context &ctx, const ErrorStack &err=ErrorStack());
+  /** Returns the names of all zones encoded in the codeplug. Only implemented by codeplugs with
+   * lazy decoding. */
+  virtual QStringList zoneNames(const ErrorStack &err=ErrorStack());
+  /** Decodes all radio IDs encoded in the codeplug. The caller takes ownership of the returned
+   * objects. Only implemented by codeplugs with lazy decoding. */
+  virtual QList<DMRRadioID *> decodeRadioIDs(Context &ctx, const ErrorStack &err=ErrorStack());
+
+  /** Decodes all channels into the given plain table without creating any objects (see
+   * @c ChannelTable). Only implemented by codeplugs with lazy decoding. */
+  virtual bool decodeChannelTable(ChannelTable &table, const ErrorStack &err=ErrorStack());
+  /** Decodes all DMR contacts into the given plain table without creating any objects (see
+   * @c ContactTable). Only implemented by codeplugs with lazy decoding. */
+  virtual bool decodeContactTable(ContactTable &table, const ErrorStack &err=ErrorStack());
 };
 
 #endif // CODEPLUG_HH
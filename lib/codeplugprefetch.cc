@@ -0,0 +1,101 @@
+#include "codeplugprefetch.hh"
+#include <QThread>
+#include <QRunnable>
+#include <algorithm>
+#include "configobject.hh"
+#include "objectarena.hh"
+#include "stringpool.hh"
+#include "tracer.hh"
+
+
+/** Creates the objects for a list of indices within the worker thread. */
+class CodeplugPrefetchRunner: public QRunnable
+{
+public:
+  CodeplugPrefetchRunner(const QVector<unsigned int> &indices, ConfigItem **result,
+                         const CodeplugPrefetch::Factory &factory)
+    : QRunnable(), _indices(indices), _result(result), _factory(factory)
+  {
+    // pass...
+  }
+
+  void run() {
+    TRACE_SPAN("CodeplugPrefetch::task", "codeplug");
+    ObjectArena::Scope arena;
+    StringPool::Scope strings;
+    Codeplug::Context ctx(nullptr);
+    foreach (unsigned int i, _indices) {
+      ConfigItem *obj = _factory(i, ctx);
+      // Release thread affinity, the object gets pulled into the thread taking it.
+      if (obj)
+        obj->moveToThread(nullptr);
+      _result[i] = obj;
+    }
+  }
+
+protected:
+  QVector<unsigned int> _indices;
+  ConfigItem **_result;
+  CodeplugPrefetch::Factory _factory;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of CodeplugPrefetch
+ * ********************************************************************************************* */
+CodeplugPrefetch::CodeplugPrefetch()
+  : _pool(), _scheduled(), _objects()
+{
+  // Objects get created in download order
+  _pool.setMaxThreadCount(1);
+}
+
+CodeplugPrefetch::~CodeplugPrefetch() {
+  reset();
+}
+
+void
+CodeplugPrefetch::reset(unsigned int count) {
+  wait();
+  qDeleteAll(_objects);
+  _objects.fill(nullptr, count);
+  _scheduled = QBitArray(count);
+}
+
+void
+CodeplugPrefetch::schedule(unsigned int first, unsigned int last, const Factory &factory) {
+  last = std::min(last, unsigned(_objects.size()));
+  QVector<unsigned int> indices;
+  for (unsigned int i=first; i<last; i++) {
+    if (_scheduled.testBit(i))
+      continue;
+    _scheduled.setBit(i);
+    indices.append(i);
+  }
+  if (indices.isEmpty())
+    return;
+
+  // Every index is written by exactly one task, hence the slots are not protected
+  _pool.start(new CodeplugPrefetchRunner(indices, _objects.data(), factory));
+}
+
+void
+CodeplugPrefetch::wait() {
+  _pool.waitForDone();
+}
+
+bool
+CodeplugPrefetch::has(unsigned int idx) const {
+  return (idx < unsigned(_scheduled.size())) && _scheduled.testBit(idx);
+}
+
+ConfigItem *
+CodeplugPrefetch::take(unsigned int idx) {
+  if (! has(idx))
+    return nullptr;
+  ConfigItem *obj = _objects[idx];
+  _objects[idx] = nullptr;
+  if (obj)
+    obj->moveToThread(QThread::currentThread());
+  return obj;
+}
@@ -0,0 +1,66 @@
+#ifndef CODEPLUGPREFETCH_HH
+#define CODEPLUGPREFETCH_HH
+
+#include <QVector>
+#include <QBitArray>
+#include <QThreadPool>
+#include <functional>
+#include "codeplug.hh"
+
+class ConfigItem;
+
+/** Creates objects from the already downloaded parts of a codeplug in the background.
+ *
+ * While a radio downloads the codeplug, it notifies the codeplug about every completely read
+ * memory range (see @c Codeplug::elementReady). Codeplugs supporting progressive decoding then
+ * schedule the creation of the objects encoded within these ranges using this class. Once the
+ * codeplug gets decoded, the objects created so far are taken instead of creating them again.
+ * Linking the objects is left to the decoding. Hence, the download and the creation of the
+ * objects overlap.
+ *
+ * The objects are created in a single worker thread, which must only read those parts of the
+ * codeplug that were downloaded already. The created objects have no thread affinity until
+ * taken.
+ *
+ * @ingroup util */
+class CodeplugPrefetch
+{
+public:
+  /** Creates a new object from the element with the given index or returns @c nullptr if there
+   * is none. The context gets shared among all objects created within the same range. */
+  typedef std::function<ConfigItem *(unsigned int idx, Codeplug::Context &ctx)> Factory;
+
+public:
+  /** Empty constructor. */
+  CodeplugPrefetch();
+  /** Destructor, waits for the worker and deletes all objects not taken. */
+  ~CodeplugPrefetch();
+
+  /** Waits for the worker, deletes all objects not taken and prepares for the given number of
+   * element indices. */
+  void reset(unsigned int count=0);
+
+  /** Schedules the creation of the objects with indices @c [first, last) using the given
+   * factory. Indices scheduled earlier are skipped. */
+  void schedule(unsigned int first, unsigned int last, const Factory &factory);
+  /** Waits until all scheduled objects got created. */
+  void wait();
+
+  /** Returns @c true if the object with the given index was scheduled. Must only be called after
+   * @c wait. */
+  bool has(unsigned int idx) const;
+  /** Takes the object with the given index and moves it into the current thread. The caller
+   * takes the ownership. Returns @c nullptr if there is no element with this index. Must only be
+   * called after @c wait. Different indices may be taken concurrently. */
+  ConfigItem *take(unsigned int idx);
+
+protected:
+  /** The worker thread. */
+  QThreadPool _pool;
+  /** Marks the scheduled indices. */
+  QBitArray _scheduled;
+  /** The created objects, indexed by element index. */
+  QVector<ConfigItem *> _objects;
+};
+
+#endif // CODEPLUGPREFETCH_HH
@@ -0,0 +1,87 @@
+#include "codeplugtable.hh"
+
+
+/* ********************************************************************************************* *
+ * Implementation of ChannelTable
+ * ********************************************************************************************* */
+int
+ChannelTable::size() const {
+  return index.size();
+}
+
+void
+ChannelTable::clear() {
+  index.clear(); name.clear(); rxFrequency.clear(); txFrequency.clear(); power.clear();
+  digital.clear(); rxOnly.clear(); contact.clear(); groupList.clear(); scanList.clear();
+}
+
+void
+ChannelTable::reserve(int n) {
+  index.reserve(n); name.reserve(n); rxFrequency.reserve(n); txFrequency.reserve(n);
+  power.reserve(n); digital.reserve(n); rxOnly.reserve(n); contact.reserve(n);
+  groupList.reserve(n); scanList.reserve(n);
+}
+
+int
+ChannelTable::addRow() {
+  index.append(0); name.append(QString()); rxFrequency.append(Frequency());
+  txFrequency.append(Frequency()); power.append(Channel::Power::Low); digital.append(false);
+  rxOnly.append(false); contact.append(-1); groupList.append(-1); scanList.append(-1);
+  return index.size()-1;
+}
+
+Channel *
+ChannelTable::createChannel(int row) const {
+  if ((0 > row) || (size() <= row))
+    return nullptr;
+
+  Channel *ch;
+  if (digital.at(row)) {
+    ch = new DMRChannel();
+  } else {
+    FMChannel *fm = new FMChannel();
+    fm->setSquelchDefault();
+    ch = fm;
+  }
+
+  ch->setName(name.at(row));
+  ch->setRXFrequency(rxFrequency.at(row));
+  ch->setTXFrequency(txFrequency.at(row));
+  ch->setPower(power.at(row));
+  ch->setRXOnly(rxOnly.at(row));
+  ch->setVOXDefault();
+  ch->setDefaultTimeout();
+  return ch;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ContactTable
+ * ********************************************************************************************* */
+int
+ContactTable::size() const {
+  return index.size();
+}
+
+void
+ContactTable::clear() {
+  index.clear(); name.clear(); number.clear(); type.clear();
+}
+
+void
+ContactTable::reserve(int n) {
+  index.reserve(n); name.reserve(n); number.reserve(n); type.reserve(n);
+}
+
+int
+ContactTable::addRow() {
+  index.append(0); name.append(QString()); number.append(0); type.append(DMRContact::PrivateCall);
+  return index.size()-1;
+}
+
+DMRContact *
+ContactTable::createContact(int row) const {
+  if ((0 > row) || (size() <= row))
+    return nullptr;
+  return new DMRContact(type.at(row), name.at(row), number.at(row));
+}
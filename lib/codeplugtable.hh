@@ -0,0 +1,69 @@
+#ifndef CODEPLUGTABLE_HH
+#define CODEPLUGTABLE_HH
+
+#include <QVector>
+#include <QString>
+#include "frequency.hh"
+#include "channel.hh"
+#include "contact.hh"
+
+/** Plain table of all channels encoded in a codeplug, stored as a struct of arrays.
+ *
+ * The table gets filled by @c Codeplug::decodeChannelTable without creating any @c Channel
+ * objects. References to other objects are kept as the codeplug indices of these objects, -1
+ * marks a missing reference. Hence the table is cheap to decode and suited for tools inspecting
+ * many codeplugs. If needed, channel objects can be created for single rows.
+ *
+ * @ingroup util */
+struct ChannelTable
+{
+  QVector<unsigned int> index;        ///< Codeplug index of the channel.
+  QVector<QString> name;              ///< Name of the channel.
+  QVector<Frequency> rxFrequency;     ///< RX frequency of the channel.
+  QVector<Frequency> txFrequency;     ///< TX frequency of the channel.
+  QVector<Channel::Power> power;      ///< Power setting of the channel.
+  QVector<bool> digital;              ///< @c true for DMR channels, @c false for FM channels.
+  QVector<bool> rxOnly;               ///< @c true if the channel is RX only.
+  QVector<int> contact;               ///< Codeplug index of the TX contact or -1.
+  QVector<int> groupList;             ///< Codeplug index of the RX group list or -1.
+  QVector<int> scanList;              ///< Codeplug index of the scan list or -1.
+
+  /** Returns the number of channels. */
+  int size() const;
+  /** Removes all channels. */
+  void clear();
+  /** Reserves space for @c n channels. */
+  void reserve(int n);
+  /** Appends a row with default values and returns its row index. */
+  int addRow();
+
+  /** Creates an unlinked channel object for the given row. The caller takes ownership. */
+  Channel *createChannel(int row) const;
+};
+
+
+/** Plain table of all DMR contacts encoded in a codeplug, stored as a struct of arrays.
+ * See @c ChannelTable.
+ *
+ * @ingroup util */
+struct ContactTable
+{
+  QVector<unsigned int> index;        ///< Codeplug index of the contact.
+  QVector<QString> name;              ///< Name of the contact.
+  QVector<unsigned int> number;       ///< DMR number of the contact.
+  QVector<DMRContact::Type> type;     ///< Call type of the contact.
+
+  /** Returns the number of contacts. */
+  int size() const;
+  /** Removes all contacts. */
+  void clear();
+  /** Reserves space for @c n contacts. */
+  void reserve(int n);
+  /** Appends a row with default values and returns its row index. */
+  int addRow();
+
+  /** Creates a contact object for the given row. The caller takes ownership. */
+  DMRContact *createContact(int row) const;
+};
+
+#endif // CODEPLUGTABLE_HH
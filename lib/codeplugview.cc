@@ -0,0 +1,122 @@
+#include "codeplugview.hh"
+#include "config.hh"
+#include "logger.hh"
+
+
+CodeplugView::CodeplugView(Codeplug *codeplug, QObject *parent)
+  : QObject(parent), _codeplug(codeplug), _config(new Config(this)), _context(_config),
+    _decoded(false), _channelIndices(), _hasChannelIndices(false), _channels(), _zones(),
+    _hasZones(false), _radioIDs(), _hasRadioIDs(false)
+{
+  // pass...
+}
+
+bool
+CodeplugView::isLazy() const {
+  return _codeplug->hasLazyDecoding();
+}
+
+bool
+CodeplugView::decodeAll(const ErrorStack &err) {
+  if (_decoded)
+    return true;
+
+  logDebug() << "Codeplug does not support lazy decoding, decode entire codeplug.";
+  if (! _codeplug->decode(_config, err)) {
+    errMsg(err) << "Cannot decode codeplug.";
+    return false;
+  }
+
+  _decoded = true;
+  return true;
+}
+
+QList<unsigned int>
+CodeplugView::channelIndices(const ErrorStack &err) {
+  if (_hasChannelIndices)
+    return _channelIndices;
+
+  if (isLazy()) {
+    _channelIndices = _codeplug->channelIndices();
+  } else {
+    if (! decodeAll(err))
+      return QList<unsigned int>();
+    for (int i=0; i<_config->channelList()->count(); i++)
+      _channelIndices.append(i);
+  }
+
+  _hasChannelIndices = true;
+  return _channelIndices;
+}
+
+Channel *
+CodeplugView::channelAt(unsigned int idx, const ErrorStack &err) {
+  if (_channels.contains(idx))
+    return _channels[idx];
+
+  Channel *ch = nullptr;
+  if (isLazy()) {
+    if (nullptr == (ch = _codeplug->decodeChannel(idx, _context, err)))
+      return nullptr;
+    ch->setParent(this);
+  } else {
+    if (! decodeAll(err))
+      return nullptr;
+    if (idx >= unsigned(_config->channelList()->count())) {
+      errMsg(err) << "There is no channel with index " << idx << ".";
+      return nullptr;
+    }
+    ch = _config->channelList()->channel(idx);
+  }
+
+  _channels[idx] = ch;
+  return ch;
+}
+
+QStringList
+CodeplugView::zones(const ErrorStack &err) {
+  if (_hasZones)
+    return _zones;
+
+  if (isLazy()) {
+    ErrorStack lazyErr;
+    _zones = _codeplug->zoneNames(lazyErr);
+    if (! lazyErr.isEmpty()) {
+      err.take(lazyErr);
+      return QStringList();
+    }
+  } else {
+    if (! decodeAll(err))
+      return QStringList();
+    for (int i=0; i<_config->zones()->count(); i++)
+      _zones.append(_config->zones()->zone(i)->name());
+  }
+
+  _hasZones = true;
+  return _zones;
+}
+
+QList<DMRRadioID *>
+CodeplugView::radioIDs(const ErrorStack &err) {
+  if (_hasRadioIDs)
+    return _radioIDs;
+
+  if (isLazy()) {
+    ErrorStack lazyErr;
+    _radioIDs = _codeplug->decodeRadioIDs(_context, lazyErr);
+    foreach (DMRRadioID *id, _radioIDs)
+      id->setParent(this);
+    if (! lazyErr.isEmpty()) {
+      err.take(lazyErr);
+      return _radioIDs;
+    }
+  } else {
+    if (! decodeAll(err))
+      return QList<DMRRadioID *>();
+    for (int i=0; i<_config->radioIDs()->count(); i++)
+      _radioIDs.append(_config->radioIDs()->getId(i));
+  }
+
+  _hasRadioIDs = true;
+  return _radioIDs;
+}
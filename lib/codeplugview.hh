@@ -0,0 +1,78 @@
+#ifndef CODEPLUGVIEW_HH
+#define CODEPLUGVIEW_HH
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+#include "codeplug.hh"
+#include "errorstack.hh"
+
+class Config;
+class Channel;
+class DMRRadioID;
+
+/** Read-only view onto a binary codeplug, that decodes elements on first access.
+ *
+ * Inspecting a few elements of a codeplug (e.g., the zone names, a specific channel or the radio
+ * IDs) does not require to decode the entire codeplug into a @c Config. If the codeplug supports
+ * lazy decoding (see @c Codeplug::hasLazyDecoding), the view decodes single elements on demand
+ * and caches them. There is no index or link pass. Hence, the decoded objects are not linked to
+ * each other, e.g., channels do not refer to any contact or scan list.
+ *
+ * For all other codeplugs, the view decodes the entire codeplug once on first access. Then, the
+ * indices are the positions of the elements within the decoded config.
+ *
+ * All decoded objects are owned by the view. The codeplug must not be modified while the view
+ * is in use.
+ *
+ * @ingroup util */
+class CodeplugView: public QObject
+{
+  Q_OBJECT
+
+public:
+  /** Constructs a view onto the given codeplug. */
+  explicit CodeplugView(Codeplug *codeplug, QObject *parent=nullptr);
+
+  /** Returns @c true if the elements are decoded on demand. */
+  bool isLazy() const;
+
+  /** Returns the indices of all channels. */
+  QList<unsigned int> channelIndices(const ErrorStack &err=ErrorStack());
+  /** Returns the channel with the given index or @c nullptr if there is none. */
+  Channel *channelAt(unsigned int idx, const ErrorStack &err=ErrorStack());
+  /** Returns the names of all zones. */
+  QStringList zones(const ErrorStack &err=ErrorStack());
+  /** Returns all radio IDs. */
+  QList<DMRRadioID *> radioIDs(const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Decodes the entire codeplug once, if it does not support lazy decoding. */
+  bool decodeAll(const ErrorStack &err);
+
+protected:
+  /** The viewed codeplug. */
+  Codeplug *_codeplug;
+  /** The config holding all objects decoded at once. */
+  Config *_config;
+  /** The context passed to the codeplug for lazy decoding. */
+  Codeplug::Context _context;
+  /** If @c true, the entire codeplug has been decoded into @c _config. */
+  bool _decoded;
+  /** Cache of the channel indices. */
+  QList<unsigned int> _channelIndices;
+  /** If @c true, the channel indices are cached. */
+  bool _hasChannelIndices;
+  /** Cache of the decoded channels. */
+  QHash<unsigned int, Channel *> _channels;
+  /** Cache of the zone names. */
+  QStringList _zones;
+  /** If @c true, the zone names are cached. */
+  bool _hasZones;
+  /** Cache of the radio IDs. */
+  QList<DMRRadioID *> _radioIDs;
+  /** If @c true, the radio IDs are cached. */
+  bool _hasRadioIDs;
+};
+
+#endif // CODEPLUGVIEW_HH
@@ -5,65 +5,259 @@
 #include "channel.hh"
 #include "csvreader.hh"
 #include "userdatabase.hh"
+#include "talkgroupdatabase.hh"
 #include "logger.hh"
+#include "objectarena.hh"
+#include "tracer.hh"
 
 #include <QTextStream>
 #include <QDateTime>
 #include <QFile>
 #include <QMetaProperty>
+#include <QSet>
+#include <QTextCodec>
+#include <QSignalBlocker>
 #include <cmath>
+#include <ostream>
+#include <streambuf>
+
+// Returns the number of objects held by the top-level lists of the given config.
+inline int objectCount(const Config *config) {
+  return config->radioIDs()->count() + config->contacts()->count()
+      + config->rxGroupLists()->count() + config->channelList()->count()
+      + config->zones()->count() + config->scanlists()->count()
+      + config->posSystems()->count() + config->roamingChannels()->count()
+      + config->roamingZones()->count();
+}
+
+// Returns the number of elements in all top-level sequences of the given YAML document.
+inline int objectCount(const YAML::Node &node) {
+  int count = 0;
+  if (! node.IsMap())
+    return count;
+  for (YAML::const_iterator it=node.begin(); it!=node.end(); it++) {
+    if (it->second.IsSequence())
+      count += it->second.size();
+  }
+  return count;
+}
+
+/* ********************************************************************************************* *
+ * Implementation of TextStreamBuffer
+ * ********************************************************************************************* */
+/** Stream buffer forwarding the UTF-8 encoded output of the YAML emitter to a QTextStream.
+ * The decoder keeps multi-byte sequences split across flushes. */
+class TextStreamBuffer: public std::streambuf
+{
+public:
+  explicit TextStreamBuffer(QTextStream &stream)
+    : std::streambuf(), _stream(stream),
+      _decoder(QTextCodec::codecForName("UTF-8")->makeDecoder())
+  {
+    setp(_buffer, _buffer+sizeof(_buffer));
+  }
+
+  ~TextStreamBuffer() {
+    sync();
+    delete _decoder;
+  }
+
+protected:
+  int_type overflow(int_type c) {
+    sync();
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+      return traits_type::not_eof(c);
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+  }
+
+  int sync() {
+    if (pptr() != pbase())
+      _stream << _decoder->toUnicode(pbase(), pptr()-pbase());
+    setp(_buffer, _buffer+sizeof(_buffer));
+    return 0;
+  }
+
+protected:
+  QTextStream &_stream;
+  QTextDecoder *_decoder;
+  char _buffer[4096];
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of Config::BulkUpdate
+ * ********************************************************************************************* */
+Config::BulkUpdate::BulkUpdate(Config *config)
+  : _config(config)
+{
+  _config->beginUpdate();
+}
+
+Config::BulkUpdate::~BulkUpdate() {
+  _config->endUpdate();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of Config::DeferredYAML
+ * ********************************************************************************************* */
+/** Keeps the document of a lazily read YAML codeplug along with its context. Linking a reference
+ * to an ID not known yet, parses the deferred parts of the document into the context first. */
+class Config::DeferredYAML: public ConfigItem::Context
+{
+public:
+  /** Constructor. */
+  DeferredYAML(Config *config, const YAML::Node &document)
+    : ConfigItem::Context(), _config(config), _document(document), _parsed(false)
+  {
+    // pass...
+  }
+
+  using ConfigItem::Context::contains;
+
+  bool contains(const QString &id) const {
+    resolve(id);
+    return ConfigItem::Context::contains(id);
+  }
+
+  ConfigObject *getObj(const QString &id) const {
+    resolve(id);
+    return ConfigItem::Context::getObj(id);
+  }
+
+  /** Returns the YAML document. */
+  const YAML::Node &document() const {
+    return _document;
+  }
+
+  /** Returns @c true, if the deferred parts were parsed already. */
+  bool isParsed() const {
+    return _parsed;
+  }
+
+  /** Parses the deferred parts of the document, if not done yet. */
+  bool parse(const ErrorStack &err=ErrorStack()) const {
+    if (_parsed)
+      return true;
+    // Parse at most once, a failing parse would fail again
+    _parsed = true;
+    return _config->parseDeferred(_document, const_cast<DeferredYAML &>(*this), err);
+  }
+
+protected:
+  /** Parses the deferred parts, if the given ID is unknown. */
+  void resolve(const QString &id) const {
+    if (_parsed || ConfigItem::Context::contains(id))
+      return;
+    // Linking continues without an error stack, hence log the reason at least
+    ErrorStack err;
+    if (! parse(err))
+      logError() << "Cannot parse deferred codeplug elements: " << err.format();
+  }
+
+protected:
+  /** The configuration, the document is read into. */
+  Config *_config;
+  /** The YAML document. */
+  YAML::Node _document;
+  /** If @c true, the deferred parts were parsed. */
+  mutable bool _parsed;
+};
 
 
 /* ********************************************************************************************* *
  * Implementation of Config
  * ********************************************************************************************* */
 Config::Config(QObject *parent)
-  : ConfigItem(parent), _modified(false), _settings(new RadioSettings(this)),
+  : ConfigItem(parent), _modified(false), _hasSavedHash(false), _savedHash(0), _updateLevel(0), _updatePending(false), _frozen(false), _blocked(), _settings(new RadioSettings(this)),
     _radioIDs(new RadioIDList(this)), _contacts(new ContactList(this)),
     _rxGroupLists(new RXGroupLists(this)), _channels(new ChannelList(this)),
     _zones(new ZoneList(this)), _scanlists(new ScanLists(this)),
     _gpsSystems(new PositioningSystems(this)),
     _roamingChannels(new RoamingChannelList(this)), _roamingZones(new RoamingZoneList(this)),
     _tytExtension(nullptr), _commercialExtension(new CommercialExtension(this)),
-    _smsExtension(new SMSExtension(this))
+    _smsExtension(new SMSExtension(this)), _deferred(nullptr)
 {
   connect(_settings, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModified()));
   connect(_radioIDs, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
+  connect(_radioIDs, SIGNAL(elementsAdded(int,int)), this, SLOT(onConfigModified()));
+  connect(_radioIDs, SIGNAL(elementsReset()), this, SLOT(onConfigModified()));
   connect(_radioIDs, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
   connect(_radioIDs, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
+  connect(_radioIDs, SIGNAL(elementsModified(int,int)), this, SLOT(onConfigModified()));
   connect(_contacts, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
+  connect(_contacts, SIGNAL(elementsAdded(int,int)), this, SLOT(onConfigModified()));
+  connect(_contacts, SIGNAL(elementsReset()), this, SLOT(onConfigModified()));
   connect(_contacts, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
   connect(_contacts, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
+  connect(_contacts, SIGNAL(elementsModified(int,int)), this, SLOT(onConfigModified()));
   connect(_rxGroupLists, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
+  connect(_rxGroupLists, SIGNAL(elementsAdded(int,int)), this, SLOT(onConfigModified()));
+  connect(_rxGroupLists, SIGNAL(elementsReset()), this, SLOT(onConfigModified()));
   connect(_rxGroupLists, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
   connect(_rxGroupLists, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
+  connect(_rxGroupLists, SIGNAL(elementsModified(int,int)), this, SLOT(onConfigModified()));
   connect(_channels, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
+  connect(_channels, SIGNAL(elementsAdded(int,int)), this, SLOT(onConfigModified()));
+  connect(_channels, SIGNAL(elementsReset()), this, SLOT(onConfigModified()));
   connect(_channels, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
   connect(_channels, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
+  connect(_channels, SIGNAL(elementsModified(int,int)), this, SLOT(onConfigModified()));
   connect(_zones, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
+  connect(_zones, SIGNAL(elementsAdded(int,int)), this, SLOT(onConfigModified()));
+  connect(_zones, SIGNAL(elementsReset()), this, SLOT(onConfigModified()));
   connect(_zones, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
   connect(_zones, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
+  connect(_zones, SIGNAL(elementsModified(int,int)), this, SLOT(onConfigModified()));
   connect(_scanlists, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
+  connect(_scanlists, SIGNAL(elementsAdded(int,int)), this, SLOT(onConfigModified()));
+  connect(_scanlists, SIGNAL(elementsReset()), this, SLOT(onConfigModified()));
   connect(_scanlists, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
   connect(_scanlists, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
+  connect(_scanlists, SIGNAL(elementsModified(int,int)), this, SLOT(onConfigModified()));
   connect(_gpsSystems, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
+  connect(_gpsSystems, SIGNAL(elementsAdded(int,int)), this, SLOT(onConfigModified()));
+  connect(_gpsSystems, SIGNAL(elementsReset()), this, SLOT(onConfigModified()));
   connect(_gpsSystems, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
   connect(_gpsSystems, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
+  connect(_gpsSystems, SIGNAL(elementsModified(int,int)), this, SLOT(onConfigModified()));
   connect(_roamingChannels, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
+  connect(_roamingChannels, SIGNAL(elementsAdded(int,int)), this, SLOT(onConfigModified()));
+  connect(_roamingChannels, SIGNAL(elementsReset()), this, SLOT(onConfigModified()));
   connect(_roamingChannels, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
   connect(_roamingChannels, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
+  connect(_roamingChannels, SIGNAL(elementsModified(int,int)), this, SLOT(onConfigModified()));
   connect(_roamingZones, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
+  connect(_roamingZones, SIGNAL(elementsAdded(int,int)), this, SLOT(onConfigModified()));
+  connect(_roamingZones, SIGNAL(elementsReset()), this, SLOT(onConfigModified()));
   connect(_roamingZones, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
   connect(_roamingZones, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
+  connect(_roamingZones, SIGNAL(elementsModified(int,int)), this, SLOT(onConfigModified()));
 
   connect(_commercialExtension, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModified()));
   connect(_smsExtension, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModified()));
 }
 
+Config::~Config() {
+  discardDeferred();
+}
+
 bool
 Config::copy(const ConfigItem &other) {
   const Config *conf = other.as<Config>();
-  if ((nullptr==conf) || (! ConfigItem::copy(other)))
+  if (nullptr==conf)
+    return false;
+  if (_frozen) {
+    logError() << "Cannot copy into frozen config.";
+    return false;
+  }
+  // Everything gets replaced, no need to materialize
+  discardDeferred();
+
+  BulkUpdate update(this);
+  if (! ConfigItem::copy(other))
     return false;
 
   _settings->copy(*conf->settings());
@@ -92,33 +286,519 @@ Config::clone() const {
 
 bool
 Config::isModified() const {
-  return _modified;
+  if (! _modified)
+    return false;
+  // Changes may have been reverted
+  return (! _hasSavedHash) || (hash() != _savedHash);
 }
 void
 Config::setModified(bool modified) {
   _modified = modified;
+  _hasSavedHash = ! modified;
+  if (_hasSavedHash)
+    _savedHash = hash();
+}
+
+/** Matches the objects of the given lists by type and name and appends the differences. */
+static void
+diffList(const AbstractConfigObjectList *a, const AbstractConfigObjectList *b,
+         QList<Config::Change> &changes)
+{
+  if (a->hash() == b->hash())
+    return;
+
+  // Objects with the same name are matched in order
+  QHash<QString, QList<ConfigObject *>> objects;
+  for (int i=0; i<a->count(); i++) {
+    ConfigObject *obj = a->get(i);
+    objects[QString("%1:%2").arg(obj->metaObject()->className(), obj->name())].append(obj);
+  }
+
+  QSet<ConfigObject *> matched;
+  for (int i=0; i<b->count(); i++) {
+    ConfigObject *obj = b->get(i);
+    QList<ConfigObject *> &candidates =
+        objects[QString("%1:%2").arg(obj->metaObject()->className(), obj->name())];
+    if (candidates.isEmpty()) {
+      changes.append({Config::Change::Kind::Added, nullptr, obj});
+      continue;
+    }
+    ConfigObject *match = candidates.takeFirst();
+    matched.insert(match);
+    if (match->hash() != obj->hash())
+      changes.append({Config::Change::Kind::Modified, match, obj});
+  }
+
+  for (int i=0; i<a->count(); i++) {
+    if (! matched.contains(a->get(i)))
+      changes.append({Config::Change::Kind::Removed, a->get(i), nullptr});
+  }
+}
+
+QList<Config::Change>
+Config::diff(const Config *other) const {
+  QList<Change> changes;
+  if (hash() == other->hash())
+    return changes;
+
+  // Both configs share the property table
+  foreach (const PropertyInfo &info, propertyTable(metaObject())) {
+    PropertyKind kind = propertyKind(info);
+    if (PropertyKind::ObjectList == kind) {
+      AbstractConfigObjectList *a = info.prop.read(this).value<AbstractConfigObjectList *>(),
+          *b = info.prop.read(other).value<AbstractConfigObjectList *>();
+      if (a && b)
+        diffList(a, b, changes);
+    } else if (PropertyKind::Item == kind) {
+      ConfigItem *a = info.prop.read(this).value<ConfigItem *>(),
+          *b = info.prop.read(other).value<ConfigItem *>();
+      if (a && (nullptr == b))
+        changes.append({Change::Kind::Removed, a, nullptr});
+      else if ((nullptr == a) && b)
+        changes.append({Change::Kind::Added, nullptr, b});
+      else if (a && b && (a->hash() != b->hash()))
+        changes.append({Change::Kind::Modified, a, b});
+    }
+  }
+
+  return changes;
+}
+
+/** Collects the pairs of items, whose references need to be updated by @c applyReferences. */
+typedef QList<QPair<ConfigItem *, const ConfigItem *>> ReferencePairs;
+
+static bool applyItem(ConfigItem *a, const ConfigItem *b, QHash<ConfigObject *, ConfigObject *> &map,
+                      ReferencePairs &pairs, const ErrorStack &err);
+
+/** Maps all objects owned by @c b to the corresponding objects owned by @c a. Both items must
+ * be equal (e.g., a clone and its original). */
+static void
+mapItem(ConfigItem *a, const ConfigItem *b, QHash<ConfigObject *, ConfigObject *> &map,
+        ReferencePairs &pairs)
+{
+  pairs.append({a, b});
+  foreach (const ConfigItem::PropertyInfo &info, ConfigItem::propertyTable(a->metaObject())) {
+    ConfigItem::PropertyKind kind = a->propertyKind(info);
+    if (ConfigItem::PropertyKind::ObjectList == kind) {
+      AbstractConfigObjectList *la = info.prop.read(a).value<AbstractConfigObjectList *>(),
+          *lb = info.prop.read(b).value<AbstractConfigObjectList *>();
+      if ((nullptr == la) || (nullptr == lb) || (la->count() != lb->count()))
+        continue;
+      for (int i=0; i<lb->count(); i++) {
+        map.insert(lb->get(i), la->get(i));
+        mapItem(la->get(i), lb->get(i), map, pairs);
+      }
+    } else if (ConfigItem::PropertyKind::Item == kind) {
+      ConfigItem *ia = info.prop.read(a).value<ConfigItem *>(),
+          *ib = info.prop.read(b).value<ConfigItem *>();
+      if (ia && ib)
+        mapItem(ia, ib, map, pairs);
+    }
+  }
+}
+
+/** Updates the list @c a to match list @c b. */
+static bool
+applyList(AbstractConfigObjectList *a, const AbstractConfigObjectList *b, QHash<ConfigObject *, ConfigObject *> &map,
+          ReferencePairs &pairs, const ErrorStack &err)
+{
+  // Objects with the same name are matched in order, like in diffList()
+  QHash<QString, QList<ConfigObject *>> objects;
+  for (int i=0; i<a->count(); i++) {
+    ConfigObject *obj = a->get(i);
+    objects[QString("%1:%2").arg(obj->metaObject()->className(), obj->name())].append(obj);
+  }
+
+  QVector<ConfigObject *> order; order.reserve(b->count());
+  QSet<ConfigObject *> matched;
+  for (int i=0; i<b->count(); i++) {
+    ConfigObject *obj = b->get(i);
+    QList<ConfigObject *> &candidates =
+        objects[QString("%1:%2").arg(obj->metaObject()->className(), obj->name())];
+    if (candidates.isEmpty()) {
+      // Added, references get fixed once all objects are known
+      ConfigItem *item = obj->clone();
+      ConfigObject *clone = item ? item->as<ConfigObject>() : nullptr;
+      if (nullptr == clone) {
+        errMsg(err) << "Cannot clone " << obj->metaObject()->className() << " '" << obj->name() << "'.";
+        return false;
+      }
+      map.insert(obj, clone);
+      mapItem(clone, obj, map, pairs);
+      order.append(clone);
+      continue;
+    }
+    ConfigObject *match = candidates.takeFirst();
+    matched.insert(match);
+    map.insert(obj, match);
+    if (! applyItem(match, obj, map, pairs, err))
+      return false;
+    order.append(match);
+  }
+
+  // Removed objects first, this also clears all references to them
+  for (int i=a->count()-1; i>=0; i--) {
+    if (! matched.contains(a->get(i)))
+      a->del(a->get(i));
+  }
+  // Then add new objects at their position
+  for (int i=0; i<order.size(); i++) {
+    if (matched.contains(order[i]))
+      continue;
+    if (0 > a->add(order[i], i, false)) {
+      errMsg(err) << "Cannot add " << order[i]->metaObject()->className() << " '"
+                  << order[i]->name() << "'.";
+      order[i]->deleteLater();
+      return false;
+    }
+  }
+  // Finally, restore the order of other
+  for (int i=0; i<order.size(); i++) {
+    if (a->get(i) != order[i])
+      return a->reorder(order);
+  }
+  return true;
+}
+
+/** Updates item @c a to match item @c b. References are only collected and get updated by
+ * @c applyReferences. */
+static bool
+applyItem(ConfigItem *a, const ConfigItem *b, QHash<ConfigObject *, ConfigObject *> &map,
+          ReferencePairs &pairs, const ErrorStack &err)
+{
+  // Equal items just need to be mapped, their references are equal already
+  if (a->hash() == b->hash()) {
+    ReferencePairs ignored;
+    mapItem(a, b, map, ignored);
+    return true;
+  }
+
+  pairs.append({a, b});
+  foreach (const ConfigItem::PropertyInfo &info, ConfigItem::propertyTable(a->metaObject())) {
+    const QMetaProperty &prop = info.prop;
+    ConfigItem::PropertyKind kind = a->propertyKind(info);
+    if ((ConfigItem::PropertyKind::Enum == kind) || (ConfigItem::PropertyKind::Bool == kind) ||
+        (ConfigItem::PropertyKind::Int == kind) || (ConfigItem::PropertyKind::UInt == kind) ||
+        (ConfigItem::PropertyKind::Double == kind) || (ConfigItem::PropertyKind::String == kind) ||
+        (ConfigItem::PropertyKind::Frequency == kind) || (ConfigItem::PropertyKind::Interval == kind)) {
+      if ((! prop.isWritable()) || (prop.read(a) == prop.read(b)))
+        continue;
+      if (! prop.write(a, prop.read(b))) {
+        errMsg(err) << "Cannot set property '" << prop.name() << "' of "
+                    << a->metaObject()->className() << ".";
+        return false;
+      }
+    } else if (ConfigItem::PropertyKind::ObjectList == kind) {
+      AbstractConfigObjectList *la = prop.read(a).value<AbstractConfigObjectList *>(),
+          *lb = prop.read(b).value<AbstractConfigObjectList *>();
+      if (la && lb && (! applyList(la, lb, map, pairs, err)))
+        return false;
+    } else if (ConfigItem::PropertyKind::Item == kind) {
+      ConfigItem *ia = prop.read(a).value<ConfigItem *>(),
+          *ib = prop.read(b).value<ConfigItem *>();
+      if (ia && ib) {
+        if (! applyItem(ia, ib, map, pairs, err))
+          return false;
+      } else if ((ia || ib) && prop.isWritable()) {
+        ConfigItem *clone = ib ? ib->clone() : nullptr;
+        if (ib && (nullptr == clone)) {
+          errMsg(err) << "Cannot clone '" << prop.name() << "' of " << b->metaObject()->className() << ".";
+          return false;
+        }
+        if (! prop.write(a, QVariant::fromValue<ConfigItem *>(clone))) {
+          errMsg(err) << "Cannot replace '" << prop.name() << "' of " << a->metaObject()->className() << ".";
+          if (clone)
+            clone->deleteLater();
+          return false;
+        }
+        if (clone)
+          mapItem(clone, ib, map, pairs);
+      }
+    }
+  }
+
+  return true;
+}
+
+/** Translates an object referenced within @c other into the corresponding object of this
+ * config. Objects not owned by @c other (e.g., tags) are kept. */
+static bool
+translateReference(ConfigObject *obj, const Config *other, const QHash<ConfigObject *, ConfigObject *> &map,
+                   ConfigObject *&result, const ErrorStack &err)
+{
+  result = obj;
+  if (nullptr == obj)
+    return true;
+  if (map.contains(obj)) {
+    result = map.value(obj);
+    return true;
+  }
+  if (other != obj->config())
+    return true;
+  errMsg(err) << "Cannot resolve reference to " << obj->metaObject()->className()
+              << " '" << obj->name() << "'.";
+  return false;
+}
+
+/** Points all references of the collected items to the objects of this config. */
+static bool
+applyReferences(const ReferencePairs &pairs, const Config *other,
+                const QHash<ConfigObject *, ConfigObject *> &map, const ErrorStack &err)
+{
+  for (const auto &pair: pairs) {
+    ConfigItem *a = pair.first; const ConfigItem *b = pair.second;
+    foreach (const ConfigItem::PropertyInfo &info, ConfigItem::propertyTable(a->metaObject())) {
+      ConfigItem::PropertyKind kind = a->propertyKind(info);
+      if (ConfigItem::PropertyKind::Reference == kind) {
+        ConfigObjectReference *ra = info.prop.read(a).value<ConfigObjectReference *>(),
+            *rb = info.prop.read(b).value<ConfigObjectReference *>();
+        if ((nullptr == ra) || (nullptr == rb))
+          continue;
+        ConfigObject *target = nullptr;
+        if (! translateReference(rb->as<ConfigObject>(), other, map, target, err))
+          return false;
+        if ((ra->as<ConfigObject>() != target) && (! ra->set(target))) {
+          errMsg(err) << "Cannot set reference '" << info.prop.name() << "' of "
+                      << a->metaObject()->className() << ".";
+          return false;
+        }
+      } else if (ConfigItem::PropertyKind::RefList == kind) {
+        AbstractConfigObjectList *la = info.prop.read(a).value<AbstractConfigObjectList *>(),
+            *lb = info.prop.read(b).value<AbstractConfigObjectList *>();
+        if ((nullptr == la) || (nullptr == lb))
+          continue;
+        QVector<ConfigObject *> targets; targets.reserve(lb->count());
+        bool equal = (la->count() == lb->count());
+        for (int i=0; i<lb->count(); i++) {
+          ConfigObject *target = nullptr;
+          if (! translateReference(lb->get(i), other, map, target, err))
+            return false;
+          equal &= (la->get(i) == target);
+          targets.append(target);
+        }
+        if (equal)
+          continue;
+        la->clear();
+        la->addMany(targets, false);
+      }
+    }
+  }
+  return true;
+}
+
+bool
+Config::apply(const Config *other, const ErrorStack &err) {
+  if (_frozen) {
+    errMsg(err) << "Cannot apply changes to frozen config.";
+    return false;
+  }
+  if ((! materialize(err)) || (! other->isMaterialized())) {
+    errMsg(err) << "Cannot apply changes to partially read config.";
+    return false;
+  }
+
+  // Collect the modification signals, but keep the signals of the lists. Hence, views just
+  // update the changed rows instead of resetting.
+  _updateLevel++;
+  QHash<ConfigObject *, ConfigObject *> map;
+  ReferencePairs pairs;
+  bool ok = applyItem(this, other, map, pairs, err) && applyReferences(pairs, other, map, err);
+  if ((0 == --_updateLevel) && _updatePending) {
+    _updatePending = false;
+    emit modified(this);
+  }
+
+  if (! ok)
+    errMsg(err) << "Cannot apply changes to config.";
+  return ok;
+}
+
+void
+Config::beginUpdate() {
+  if (0 == _updateLevel++) {
+    _radioIDs->beginUpdate();
+    _contacts->beginUpdate();
+    _rxGroupLists->beginUpdate();
+    _channels->beginUpdate();
+    _zones->beginUpdate();
+    _scanlists->beginUpdate();
+    _gpsSystems->beginUpdate();
+    _roamingChannels->beginUpdate();
+    _roamingZones->beginUpdate();
+  }
+}
+
+void
+Config::endUpdate() {
+  if (1 != _updateLevel) {
+    if (_updateLevel)
+      _updateLevel--;
+    return;
+  }
+
+  // End list updates first, the resulting resets are collected as pending modification.
+  _radioIDs->endUpdate();
+  _contacts->endUpdate();
+  _rxGroupLists->endUpdate();
+  _channels->endUpdate();
+  _zones->endUpdate();
+  _scanlists->endUpdate();
+  _gpsSystems->endUpdate();
+  _roamingChannels->endUpdate();
+  _roamingZones->endUpdate();
+
+  _updateLevel = 0;
+  if (_updatePending) {
+    _updatePending = false;
+    emit modified(this);
+  }
+}
+
+void
+Config::freeze() {
+  if (_frozen)
+    return;
+
+  // Frozen configs must not change, not even by materializing deferred parts
+  materializeOnAccess();
+
+  // Memoize all hashes and build all indices
+  hash();
+  foreach (AbstractConfigObjectList *list, findChildren<AbstractConfigObjectList *>())
+    list->freeze();
+
+  // Block all signals, that are not blocked yet
+  QList<QObject *> objects = findChildren<QObject *>();
+  objects.prepend(this);
+  foreach (QObject *obj, objects) {
+    if (obj->signalsBlocked())
+      continue;
+    obj->blockSignals(true);
+    _blocked.append(obj);
+  }
+
+  _frozen = true;
+}
+
+void
+Config::thaw() {
+  if (! _frozen)
+    return;
+
+  foreach (QObject *obj, _blocked)
+    obj->blockSignals(false);
+  _blocked.clear();
+  foreach (AbstractConfigObjectList *list, findChildren<AbstractConfigObjectList *>())
+    list->thaw();
+
+  _frozen = false;
+}
+
+bool
+Config::isFrozen() const {
+  return _frozen;
+}
+
+MemoryUsage
+Config::memoryUsage() const {
+  MemoryUsage usage("Config", sizeof(Config));
+  foreach (const PropertyInfo &info, propertyTable(metaObject())) {
+    PropertyKind kind = propertyKind(info);
+    if ((PropertyKind::ObjectList == kind) || (PropertyKind::RefList == kind)) {
+      AbstractConfigObjectList *lst = info.prop.read(this).value<AbstractConfigObjectList *>();
+      if (lst)
+        usage.add(MemoryUsage(info.prop.name(), lst->memorySize(), lst->count()));
+    } else if (PropertyKind::Item == kind) {
+      ConfigItem *item = info.prop.read(this).value<ConfigItem *>();
+      if (item)
+        usage.add(MemoryUsage(info.prop.name(), item->memorySize()));
+    }
+  }
+  return usage;
 }
 
 bool
 Config::toYAML(QTextStream &stream, const ErrorStack &err) {
+  TRACE_SPAN("Config::toYAML", "yaml");
+  if (! materialize(err))
+    return false;
   ConfigItem::Context context;
+  context.reserve(objectCount(this));
   // Label all codeplug elements
   if (! this->label(context, err))
     return false;
-  // Serialize into YAML
-  YAML::Node doc = serialize(context, err);
-  if (doc.IsNull())
+
+  // Emit YAML directly into the stream. Only single elements get serialized into nodes, such
+  // that the complete document never exists in memory. The result is identical to emitting the
+  // node created by serialize().
+  TextStreamBuffer buffer(stream);
+  std::ostream out(&buffer);
+  YAML::Emitter emitter(out);
+  emitter << YAML::BeginDoc << YAML::BeginMap;
+  emitter << YAML::Key << "version" << YAML::Value << VERSION_STRING;
+
+  YAML::Node settings = _settings->serialize(context, err);
+  if (settings.IsNull())
+    return false;
+  emitter << YAML::Key << "settings" << YAML::Value << settings;
+
+  if ((! serializeList(emitter, "radioIDs", _radioIDs, context, err)) ||
+      (! serializeList(emitter, "contacts", _contacts, context, err)) ||
+      (! serializeList(emitter, "groupLists", _rxGroupLists, context, err)) ||
+      (! serializeList(emitter, "channels", _channels, context, err)) ||
+      (! serializeList(emitter, "zones", _zones, context, err)))
+    return false;
+
+  if (_scanlists->count() && (! serializeList(emitter, "scanLists", _scanlists, context, err)))
+    return false;
+  if (_gpsSystems->count() && (! serializeList(emitter, "positioning", _gpsSystems, context, err)))
+    return false;
+  if (_roamingChannels->count() &&
+      (! serializeList(emitter, "roamingChannels", _roamingChannels, context, err)))
     return false;
-  // Print YAML
-  YAML::Emitter emitter;
-  emitter << YAML::BeginDoc << doc << YAML::EndDoc;
-  stream << QString(emitter.c_str());
+  if (_roamingZones->count() &&
+      (! serializeList(emitter, "roamingZones", _roamingZones, context, err)))
+    return false;
+
+  // Remaining properties (extensions) are small, serialize them as usual.
+  YAML::Node extensions(YAML::NodeType::Map);
+  if (! ConfigItem::populate(extensions, context, err))
+    return false;
+  for (YAML::const_iterator it=extensions.begin(); it!=extensions.end(); it++)
+    emitter << YAML::Key << it->first << YAML::Value << it->second;
+
+  emitter << YAML::EndMap << YAML::EndDoc;
+  out.flush();
+
+  if (! emitter.good()) {
+    errMsg(err) << "Cannot emit YAML: " << QString::fromStdString(emitter.GetLastError()) << ".";
+    return false;
+  }
+
+  return true;
+}
+
+bool
+Config::serializeList(YAML::Emitter &emitter, const char *key, AbstractConfigObjectList *list,
+                      const Context &context, const ErrorStack &err)
+{
+  emitter << YAML::Key << key << YAML::Value << YAML::BeginSeq;
+  for (int i=0; i<list->count(); i++) {
+    YAML::Node node = list->get(i)->serialize(context, err);
+    if (node.IsNull())
+      return false;
+    emitter << node;
+  }
+  emitter << YAML::EndSeq;
   return true;
 }
 
 bool
 Config::populate(YAML::Node &node, const Context &context, const ErrorStack &err)
 {
+  if (! materialize(err))
+    return false;
+
   node["version"] = VERSION_STRING;
 
   if ((node["settings"]= _settings->serialize(context, err)).IsNull())
@@ -207,11 +887,13 @@ Config::posSystems() const {
 
 RoamingChannelList *
 Config::roamingChannels() const {
+  materializeOnAccess();
   return _roamingChannels;
 }
 
 RoamingZoneList *
 Config::roamingZones() const {
+  materializeOnAccess();
   return _roamingZones;
 }
 
@@ -248,8 +930,63 @@ Config::requiresGPS() const {
   return chHasGPS;
 }
 
+int
+Config::importTalkGroups(const TalkGroupDatabase *db, const TalkGroupFilter &filter,
+                         const QString &groupList)
+{
+  BulkUpdate update(this);
+
+  // Existing group calls are found by the number index of the contact list
+  QVector<ConfigObject *> created, imported;
+  QSet<unsigned> seen;
+  for (qint64 i=0; i<db->count(); i++) {
+    TalkGroupDatabase::TalkGroup tg = db->talkgroup(i);
+    if ((filter && (! filter(tg.id, tg.name))) || seen.contains(tg.id))
+      continue;
+    seen.insert(tg.id);
+    DMRContact *contact = _contacts->findDigitalContact(tg.id);
+    if (contact && (DMRContact::GroupCall != contact->type())) {
+      // Rare case, the first contact with that number is no group call
+      contact = nullptr;
+      for (int j=0; (nullptr == contact) && (j<_contacts->digitalCount()); j++) {
+        DMRContact *other = _contacts->digitalContact(j);
+        if ((tg.id == other->number()) && (DMRContact::GroupCall == other->type()))
+          contact = other;
+      }
+    }
+    if (nullptr == contact) {
+      contact = new DMRContact(DMRContact::GroupCall, tg.name, tg.id);
+      created.append(contact);
+    }
+    imported.append(contact);
+  }
+  _contacts->addMany(created, false);
+  logDebug() << "Imported " << imported.size() << " talk groups, created "
+             << created.size() << " contacts.";
+
+  if (groupList.isEmpty())
+    return created.size();
+
+  RXGroupList *list = nullptr;
+  if (ConfigObject *obj = _rxGroupLists->findItemByName(groupList))
+    list = obj->as<RXGroupList>();
+  if (nullptr == list) {
+    list = new RXGroupList(groupList);
+    _rxGroupLists->add(list);
+  }
+  list->contacts()->addMany(imported, true);
+
+  return created.size();
+}
+
 void
 Config::clear() {
+  if (_frozen) {
+    logError() << "Cannot clear frozen config.";
+    return;
+  }
+  BulkUpdate update(this);
+  discardDeferred();
   ConfigItem::clear();
 
   // Reset lists
@@ -264,7 +1001,10 @@ Config::clear() {
   _roamingChannels->clear();
   _roamingZones->clear();
 
-  emit modified(this);
+  if (_updateLevel)
+    _updatePending = true;
+  else
+    emit modified(this);
 }
 
 const Config *
@@ -275,20 +1015,25 @@ Config::config() const {
 
 CommercialExtension *
 Config::commercialExtension() const {
+  materializeOnAccess();
   return _commercialExtension;
 }
 
 SMSExtension *
 Config::smsExtension() const {
+  materializeOnAccess();
   return _smsExtension;
 }
 
 TyTConfigExtension *
 Config::tytExtension() const {
+  materializeOnAccess();
   return _tytExtension;
 }
 void
 Config::setTyTExtension(TyTConfigExtension *ext) {
+  // A deferred extension must not replace the given one later
+  materializeOnAccess();
   if (_tytExtension == ext)
     return;
   if (_tytExtension)
@@ -303,7 +1048,10 @@ Config::setTyTExtension(TyTConfigExtension *ext) {
 void
 Config::onConfigModified() {
   _modified = true;
-  emit modified(this);
+  if (_updateLevel)
+    _updatePending = true;
+  else
+    emit modified(this);
 }
 
 bool
@@ -318,15 +1066,17 @@ Config::readCSV(const QString &filename, QString &errorMessage) {
 bool
 Config::readCSV(QTextStream &stream, QString &errorMessage)
 {
-  if (CSVReader::read(this, stream, errorMessage))
-    _modified = false;
-  else
+  BulkUpdate update(this);
+  if (! CSVReader::read(this, stream, errorMessage))
     return false;
+  _modified = false;
+  _hasSavedHash = false;
   return true;
 }
 
 bool
-Config::readYAML(const QString &filename, const ErrorStack &err) {
+Config::readYAML(const QString &filename, const ErrorStack &err, bool lazy) {
+  TRACE_SPAN("Config::readYAML", "yaml");
   YAML::Node node;
   try {
     QFile file(filename);
@@ -348,20 +1098,96 @@ Config::readYAML(const QString &filename, const ErrorStack &err) {
     return false;
   }
 
+  BulkUpdate update(this);
+  ObjectArena::Scope arena;
   clear();
-  ConfigItem::Context context;
 
-  if (! parse(node, context, err))
-    return false;
+  if (! lazy) {
+    ConfigItem::Context context;
+    context.reserve(objectCount(node));
+    if (! parse(node, context, err))
+      return false;
+    if (! link(node, context, err))
+      return false;
+    return true;
+  }
 
-  if (! link(node, context, err))
+  DeferredYAML *deferred = new DeferredYAML(this, node);
+  deferred->reserve(objectCount(node));
+  if ((! parseCore(node, *deferred, err)) || (! linkCore(node, *deferred, err))) {
+    delete deferred;
     return false;
+  }
 
+  // If some reference required the deferred parts already, there is no point in deferring.
+  if (deferred->isParsed()) {
+    bool ok = linkDeferred(node, *deferred, err);
+    delete deferred;
+    return ok;
+  }
+
+  _deferred = deferred;
   return true;
 }
 
+bool
+Config::isMaterialized() const {
+  return nullptr == _deferred;
+}
+
+bool
+Config::materialize(const ErrorStack &err) {
+  if (nullptr == _deferred)
+    return true;
+
+  TRACE_SPAN("Config::materialize", "yaml");
+  // Detach first, the accessors must not materialize again
+  DeferredYAML *deferred = _deferred;
+  _deferred = nullptr;
+
+  // Materializing is not a modification, the views get updated by the list resets.
+  bool modified = _modified, pending = _updatePending;
+  QSignalBlocker blocker(this);
+  bool ok;
+  {
+    BulkUpdate update(this);
+    ObjectArena::Scope arena;
+    ok = deferred->parse(err) && linkDeferred(deferred->document(), *deferred, err);
+  }
+  _modified = modified; _updatePending = pending;
+  delete deferred;
+
+  if (! ok)
+    errMsg(err) << "Cannot materialize deferred codeplug elements.";
+  return ok;
+}
+
+void
+Config::materializeOnAccess() const {
+  if (nullptr == _deferred)
+    return;
+  ErrorStack err;
+  if (! const_cast<Config *>(this)->materialize(err))
+    logError() << err.format();
+}
+
+void
+Config::discardDeferred() {
+  if (nullptr == _deferred)
+    return;
+  delete _deferred;
+  _deferred = nullptr;
+}
+
 bool
 Config::parse(const YAML::Node &node, Context &ctx, const ErrorStack &err)
+{
+  TRACE_SPAN("Config::parse", "yaml");
+  return parseCore(node, ctx, err) && parseDeferred(node, ctx, err);
+}
+
+bool
+Config::parseCore(const YAML::Node &node, Context &ctx, const ErrorStack &err)
 {
   if (! node.IsMap()) {
     errMsg(err) << node.Mark().line << ":" << node.Mark().column
@@ -394,6 +1220,13 @@ Config::parse(const YAML::Node &node, Context &ctx, const ErrorStack &err)
     return false;
   if (node["positioning"] && (! _gpsSystems->parse(node["positioning"], ctx, err)))
     return false;
+
+  return true;
+}
+
+bool
+Config::parseDeferred(const YAML::Node &node, Context &ctx, const ErrorStack &err)
+{
   if (node["roamingChannels"] && (! _roamingChannels->parse(node["roamingChannels"], ctx, err)))
     return false;
   if (node["roamingZones"] && (! _roamingZones->parse(node["roamingZones"], ctx, err)))
@@ -411,6 +1244,12 @@ Config::parse(const YAML::Node &node, Context &ctx, const ErrorStack &err)
 
 bool
 Config::link(const YAML::Node &node, const Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("Config::link", "yaml");
+  return linkCore(node, ctx, err) && linkDeferred(node, ctx, err);
+}
+
+bool
+Config::linkCore(const YAML::Node &node, const Context &ctx, const ErrorStack &err) {
   // radio IDs must be linked before settings, as they may refer to the default DMR ID
 
   if (node["radioIDs"] && (! _radioIDs->link(node["radioIDs"], ctx, err)))
@@ -432,6 +1271,12 @@ Config::link(const YAML::Node &node, const Context &ctx, const ErrorStack &err)
     return false;
   if (node["positioning"] && (! _gpsSystems->link(node["positioning"], ctx, err)))
     return false;
+
+  return true;
+}
+
+bool
+Config::linkDeferred(const YAML::Node &node, const Context &ctx, const ErrorStack &err) {
   if (node["roamingZones"] && (! _roamingZones->link(node["roamingZones"], ctx, err)))
     return false;
   /** @todo Implemented for backward compatibility with version 0.10.0, remove for 1.0.0.*/
@@ -39,6 +39,7 @@
 #define CONFIG_HH
 
 #include <QTextStream>
+#include <functional>
 
 #include "configobject.hh"
 #include "contact.hh"
@@ -51,6 +52,7 @@
 #include "roamingzone.hh"
 #include "radioid.hh"
 #include "radiosettings.hh"
+#include "memoryusage.hh"
 
 #include "commercial_extension.hh"
 #include "smsextension.hh"
@@ -58,6 +60,7 @@
 
 // Forward declaration
 class UserDatabase;
+class TalkGroupDatabase;
 
 
 /** The config class, representing the codeplug configuration.
@@ -98,18 +101,97 @@ class Config : public ConfigItem
   /** Represents the config extension for TyT devices. */
   Q_PROPERTY(TyTConfigExtension* tytExtension READ tytExtension WRITE setTyTExtension)
 
+public:
+  /** Scope guard for bulk modifications of the configuration.
+   *
+   * While at least one instance exists, the lists of the configuration do not emit signals for
+   * every single added, removed or modified element. Instead, each changed list emits a single
+   * @c AbstractConfigObjectList::elementsReset signal and the configuration emits a single
+   * @c modified signal, once the last guard gets destroyed. Use this when decoding, reading or
+   * merging entire codeplugs. */
+  class BulkUpdate
+  {
+  public:
+    /** Starts a bulk update of the given configuration. */
+    explicit BulkUpdate(Config *config);
+    /** Ends the bulk update. */
+    ~BulkUpdate();
+
+  private:
+    /** The configuration being updated. */
+    Config *_config;
+  };
+
+  /** Describes a single difference between two configurations, see @c diff. */
+  struct Change {
+    /** Possible kinds of changes. */
+    enum class Kind {
+      Added,    ///< The object is only present in the other configuration.
+      Removed,  ///< The object is only present in this configuration.
+      Modified  ///< The object is present in both configurations but differs.
+    };
+
+    Kind kind;          ///< The kind of the change.
+    ConfigItem *item;   ///< The item of this configuration, @c nullptr if added.
+    ConfigItem *other;  ///< The item of the other configuration, @c nullptr if removed.
+  };
+
 public:
   /** Constructs an empty configuration. */
   Q_INVOKABLE explicit Config(QObject *parent = nullptr);
+  /** Destructor. */
+  virtual ~Config();
 
   bool copy(const ConfigItem &other);
   ConfigItem *clone() const;
 
-  /** Returns @c true if the config was modified, @see modified. */
+  /** Returns @c true if the config was modified, @see modified. If the config was modified
+   * but equals the config present when the modified flag was cleared (e.g., the saved one), the
+   * config is not considered modified. */
   bool isModified() const;
-  /** Sets the modified flag. */
+  /** Sets the modified flag. Clearing the flag remembers the hash of the current config. */
   void setModified(bool modified);
 
+  /** Compares this configuration with the given one and returns the objects added, removed or
+   * modified in @c other. Objects are matched by type and name within their lists, settings and
+   * extensions by their property. Lists and items with equal hashes (see @c ConfigItem::hash)
+   * are skipped. Hence, the effort is proportional to the changed lists. */
+  QList<Change> diff(const Config *other) const;
+  /** Makes this configuration equal to the given one by applying only the differences. Objects
+   * are matched like in @c diff. Matched objects are updated in place, hence references to them
+   * and the selection of views remain valid. Unmatched objects get removed, objects only present
+   * in @c other get cloned and the lists get reordered as in @c other. Instead of a modification
+   * signal for every change, a single @c modified signal is emitted, while the lists still emit
+   * their fine-grained signals. The given configuration is not modified. */
+  bool apply(const Config *other, const ErrorStack &err=ErrorStack());
+
+  /** Starts a bulk update, see @c BulkUpdate. Calls may be nested. */
+  void beginUpdate();
+  /** Ends a bulk update, see @c BulkUpdate. */
+  void endUpdate();
+
+  /** Freezes the configuration, such that it can be shared by several threads.
+   *
+   * Freezing memoizes the hashes and builds all lazily built indices of the configuration, its
+   * lists and items. Then, the signals of the configuration and all owned objects are blocked
+   * and the lists refuse to add, remove or move elements. While frozen, all const methods of the
+   * configuration, its lists and items are thread-safe. Hence, several threads may encode or
+   * verify the same configuration concurrently, without cloning it or moving it into their
+   * thread.
+   *
+   * The properties of the items must not be changed and no items must be deleted while the
+   * configuration is frozen. */
+  void freeze();
+  /** Unfreezes the configuration, see @c freeze. Must be called from the thread owning the
+   * configuration, once all other threads are done with it. */
+  void thaw();
+  /** Returns @c true, if the configuration is frozen. */
+  bool isFrozen() const;
+
+  /** Returns an estimate of the heap memory held by the configuration, itemized by the lists,
+   * the settings and the extensions. */
+  MemoryUsage memoryUsage() const;
+
   /** Returns the radio wide settings. */
   RadioSettings *settings() const;
   /** Returns the list of radio IDs. */
@@ -136,6 +218,17 @@ public:
   /** Returns @c true if one of the channels has a GPS or APRS system assigned. */
   bool requiresGPS() const;
 
+  /** Filter for @c importTalkGroups. Returns @c true, if the talk group with the given number
+   * and name should be imported. */
+  typedef std::function<bool(unsigned number, const QString &name)> TalkGroupFilter;
+  /** Creates group call contacts for all talk groups of the given database accepted by the
+   * @c filter, within a single bulk update. Talk groups already present as group calls are not
+   * duplicated. If @c groupList is not empty, all imported talk groups (new and existing ones)
+   * are added to the RX group list of that name, which gets created if needed.
+   * @returns The number of contacts created. */
+  int importTalkGroups(const TalkGroupDatabase *db, const TalkGroupFilter &filter=TalkGroupFilter(),
+                       const QString &groupList=QString());
+
   /** Clears the complete configuration. */
   void clear();
 
@@ -159,18 +252,50 @@ public:
   /** Imports a configuration from the given text stream in text format. */
   bool readCSV(QTextStream &stream, QString &errorMessage);
 
-  /** Imports a configuration from the given YAML file. */
-  bool readYAML(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Imports a configuration from the given YAML file.
+   *
+   * If @c lazy is @c true, only the settings, radio IDs, contacts, group lists, channels, zones,
+   * scan lists and positioning systems are parsed and linked. The roaming channels and zones as
+   * well as the extensions are kept as YAML and get materialized on the first access through
+   * their accessors (or by @c materialize). References to them (e.g., the roaming zone of a
+   * channel) are resolved on demand, that is, all deferred elements get parsed as soon as such
+   * a reference is linked. */
+  bool readYAML(const QString &filename, const ErrorStack &err=ErrorStack(), bool lazy=false);
 
   bool parse(const YAML::Node &node, Context &ctx, const ErrorStack &err=ErrorStack());
   bool link(const YAML::Node &node, const Context &ctx, const ErrorStack &err=ErrorStack());
 
+  /** Returns @c false, if parts of a lazily read YAML codeplug are not materialized yet. */
+  bool isMaterialized() const;
+  /** Parses and links all deferred parts of a lazily read YAML codeplug. Does not mark the
+   * configuration as modified. */
+  bool materialize(const ErrorStack &err=ErrorStack());
+
 public:
   /** Serializes the configuration into the given stream as text. */
   bool toYAML(QTextStream &stream, const ErrorStack &err=ErrorStack());
 
 protected:
+  /** Holds the deferred parts of a lazily read YAML codeplug, see @c readYAML. */
+  class DeferredYAML;
+
+  /** Parses the lists, that are never deferred. */
+  bool parseCore(const YAML::Node &node, Context &ctx, const ErrorStack &err=ErrorStack());
+  /** Links the lists, that are never deferred. */
+  bool linkCore(const YAML::Node &node, const Context &ctx, const ErrorStack &err=ErrorStack());
+  /** Parses the roaming channels, zones and the extensions. */
+  bool parseDeferred(const YAML::Node &node, Context &ctx, const ErrorStack &err=ErrorStack());
+  /** Links the roaming zones and the extensions. */
+  bool linkDeferred(const YAML::Node &node, const Context &ctx, const ErrorStack &err=ErrorStack());
+  /** Materializes the deferred parts on first access, errors are logged. */
+  void materializeOnAccess() const;
+  /** Drops the deferred parts without materializing them. */
+  void discardDeferred();
+
   bool populate(YAML::Node &node, const Context &context, const ErrorStack &err=ErrorStack());
+  /** Serializes the given list directly into the emitter as the value of the given key. */
+  bool serializeList(YAML::Emitter &emitter, const char *key, AbstractConfigObjectList *list,
+                     const Context &context, const ErrorStack &err=ErrorStack());
 
 protected slots:
   /** Iternal callback. */
@@ -179,6 +304,19 @@ protected slots:
 protected:
   /** If @c true, the configuration was modified. */
   bool _modified;
+  /** If @c true, @c _savedHash holds the hash of the config when the modified flag was
+   * cleared. */
+  bool _hasSavedHash;
+  /** Hash of the config when the modified flag was cleared, see @c isModified. */
+  quint64 _savedHash;
+  /** Nesting level of bulk updates. */
+  unsigned int _updateLevel;
+  /** If @c true, the configuration was modified during the current bulk update. */
+  bool _updatePending;
+  /** If @c true, the configuration is frozen, see @c freeze. */
+  bool _frozen;
+  /** The objects, whose signals got blocked by @c freeze. */
+  QList<QObject *> _blocked;
   /** Radio wide settings. */
   RadioSettings *_settings;
   /** The list of radio IDs. */
@@ -205,6 +343,8 @@ protected:
   CommercialExtension *_commercialExtension;
   /** Owns the SMS settings extension. */
   SMSExtension *_smsExtension;
+  /** Owns the not yet materialized parts of a lazily read YAML codeplug or @c nullptr. */
+  DeferredYAML *_deferred;
 };
 
 #endif // CONFIG_HH
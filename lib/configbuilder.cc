@@ -0,0 +1,167 @@
+#include "configbuilder.hh"
+#include "config.hh"
+#include "configreference.hh"
+#include "logger.hh"
+#include "tracer.hh"
+
+
+ConfigBuilder::ConfigBuilder()
+  : _arena(), _config(new Config()), _ownsConfig(true), _links()
+{
+  // pass...
+}
+
+ConfigBuilder::ConfigBuilder(Config *config)
+  : _arena(), _config(config), _ownsConfig(false), _links()
+{
+  // pass...
+}
+
+ConfigBuilder::~ConfigBuilder() {
+  for (int i=0; i<NUM_LISTS; i++)
+    qDeleteAll(_staged[i]);
+  if (_ownsConfig)
+    delete _config;
+}
+
+Config *
+ConfigBuilder::config() const {
+  return _config;
+}
+
+void
+ConfigBuilder::reserve(List list, int count) {
+  _staged[int(list)].reserve(count);
+}
+
+int
+ConfigBuilder::add(ConfigObject *obj) {
+  List list;
+  if (obj->is<RadioID>())
+    list = List::RadioIDs;
+  else if (obj->is<Contact>())
+    list = List::Contacts;
+  else if (obj->is<RXGroupList>())
+    list = List::GroupLists;
+  else if (obj->is<Channel>())
+    list = List::Channels;
+  else if (obj->is<Zone>())
+    list = List::Zones;
+  else if (obj->is<ScanList>())
+    list = List::ScanLists;
+  else if (obj->is<PositioningSystem>())
+    list = List::PositioningSystems;
+  else if (obj->is<RoamingChannel>())
+    list = List::RoamingChannels;
+  else if (obj->is<RoamingZone>())
+    list = List::RoamingZones;
+  else {
+    logError() << "Cannot stage object of type " << obj->metaObject()->className()
+               << ": No list for this type.";
+    return -1;
+  }
+
+  int idx = count(list);
+  _staged[int(list)].append(obj);
+  return idx;
+}
+
+int
+ConfigBuilder::count(List list) const {
+  return configList(list)->count() + _staged[int(list)].size();
+}
+
+void
+ConfigBuilder::link(ConfigObjectReference *ref, List list, int idx) {
+  _links.append({ref, nullptr, list, idx});
+}
+
+void
+ConfigBuilder::link(ConfigObjectRefList *refs, List list, int idx) {
+  _links.append({nullptr, refs, list, idx});
+}
+
+void
+ConfigBuilder::link(ConfigObjectRefList *refs, List list, const QVector<int> &indices) {
+  _links.reserve(_links.size() + indices.size());
+  foreach (int idx, indices)
+    _links.append({nullptr, refs, list, idx});
+}
+
+Config *
+ConfigBuilder::finish(ConfigItem::Context *context, const ErrorStack &err) {
+  TRACE_SPAN("ConfigBuilder::finish", "config");
+
+  // Resolve references first, the staged objects are not connected to any list yet. Hence,
+  // their modifications are not propagated.
+  foreach (const Link &link, _links) {
+    ConfigObject *obj = resolve(link.list, link.index);
+    if (nullptr == obj) {
+      errMsg(err) << "Cannot resolve reference to index " << link.index << " of list "
+                  << int(link.list) << ": Out of bounds.";
+      return nullptr;
+    }
+    if (link.ref && (! link.ref->set(obj))) {
+      errMsg(err) << "Cannot set reference to '" << obj->name() << "' of type "
+                  << obj->metaObject()->className() << ".";
+      return nullptr;
+    }
+    if (link.refs && (0 > link.refs->add(obj)) && (! link.refs->has(obj))) {
+      errMsg(err) << "Cannot add '" << obj->name() << "' of type "
+                  << obj->metaObject()->className() << " to reference list.";
+      return nullptr;
+    }
+  }
+  _links.clear();
+
+  {
+    Config::BulkUpdate update(_config);
+    for (int i=0; i<NUM_LISTS; i++) {
+      if (_staged[i].isEmpty())
+        continue;
+      AbstractConfigObjectList *list = configList(List(i));
+      list->reserve(list->count() + _staged[i].size());
+      // Staged objects are unique, adding them unchecked saves a look-up per object.
+      list->addMany(_staged[i], false);
+      _staged[i].clear();
+    }
+  }
+
+  if (context && (! _config->label(*context, err))) {
+    errMsg(err) << "Cannot label configuration.";
+    return nullptr;
+  }
+
+  Config *config = _config;
+  _ownsConfig = false;
+  return config;
+}
+
+AbstractConfigObjectList *
+ConfigBuilder::configList(List list) const {
+  switch (list) {
+  case List::RadioIDs: return _config->radioIDs();
+  case List::Contacts: return _config->contacts();
+  case List::GroupLists: return _config->rxGroupLists();
+  case List::Channels: return _config->channelList();
+  case List::Zones: return _config->zones();
+  case List::ScanLists: return _config->scanlists();
+  case List::PositioningSystems: return _config->posSystems();
+  case List::RoamingChannels: return _config->roamingChannels();
+  case List::RoamingZones: return _config->roamingZones();
+  }
+  return nullptr;
+}
+
+ConfigObject *
+ConfigBuilder::resolve(List list, int idx) const {
+  AbstractConfigObjectList *present = configList(list);
+  if (0 > idx)
+    return nullptr;
+  if (idx < present->count())
+    return present->get(idx);
+  idx -= present->count();
+  if (idx < _staged[int(list)].size())
+    return _staged[int(list)].at(idx);
+  return nullptr;
+}
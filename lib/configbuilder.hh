@@ -0,0 +1,118 @@
+#ifndef CONFIGBUILDER_HH
+#define CONFIGBUILDER_HH
+
+#include <QVector>
+#include "configobject.hh"
+#include "objectarena.hh"
+#include "errorstack.hh"
+
+class Config;
+class ConfigObjectReference;
+class ConfigObjectRefList;
+
+/** Assembles a configuration from many objects at once.
+ *
+ * Objects are created and set up by the caller and staged using @c add. References between them
+ * are given by the index of the target within its list (see @c link), hence they may also refer
+ * to objects staged later. The objects enter the configuration only in @c finish. There, all
+ * references are resolved, every list is appended at once within a single bulk update (see
+ * @c Config::BulkUpdate) and, optionally, all objects get labeled. Hence, building a large
+ * configuration does not emit any signals per object and takes linear time.
+ *
+ * While the builder exists, config items created in its thread are allocated from an
+ * @c ObjectArena scope. Hence the builder must be created and destroyed like any other scope
+ * guard, i.e., on the stack.
+ *
+ * @code
+ * ConfigBuilder builder;
+ * int tg = builder.add(new DMRContact(DMRContact::GroupCall, "TG 91", 91));
+ * DMRChannel *ch = new DMRChannel(); ch->setName("DMR 1");
+ * builder.link(ch->contact(), ConfigBuilder::List::Contacts, tg);
+ * int idx = builder.add(ch);
+ * Zone *zone = new Zone("Zone 1");
+ * builder.link(zone->A(), ConfigBuilder::List::Channels, idx);
+ * builder.add(zone);
+ * Config *config = builder.finish();
+ * @endcode
+ *
+ * @ingroup conf */
+class ConfigBuilder
+{
+public:
+  /** The lists of a configuration, objects can be staged for. */
+  enum class List {
+    RadioIDs = 0, Contacts, GroupLists, Channels, Zones, ScanLists, PositioningSystems,
+    RoamingChannels, RoamingZones
+  };
+
+public:
+  /** Constructs a builder for a new, empty configuration. */
+  ConfigBuilder();
+  /** Constructs a builder appending to the given configuration. The configuration is not owned
+   * by the builder and must not be modified otherwise, until the builder is finished. */
+  explicit ConfigBuilder(Config *config);
+  /** Destructor. Deletes all objects not handed over yet and the configuration, if it was
+   * created by the builder and @c finish was not called. */
+  ~ConfigBuilder();
+
+  /** Returns the configuration being built. */
+  Config *config() const;
+
+  /** Reserves space for the given number of objects in the specified list. */
+  void reserve(List list, int count);
+
+  /** Stages the given object for the list matching its type. The builder takes ownership.
+   * @returns The index the object will have within its list or -1 if there is no list for the
+   *          type of the object. */
+  int add(ConfigObject *obj);
+  /** Returns the number of objects the specified list will hold, i.e., the objects present
+   * already and the staged ones. */
+  int count(List list) const;
+
+  /** Sets the given reference to the object at index @c idx of the specified list, once the
+   * configuration gets finished. */
+  void link(ConfigObjectReference *ref, List list, int idx);
+  /** Appends the object at index @c idx of the specified list to the given reference list, once
+   * the configuration gets finished. */
+  void link(ConfigObjectRefList *refs, List list, int idx);
+  /** Appends the objects at the given indices of the specified list to the given reference
+   * list, once the configuration gets finished. */
+  void link(ConfigObjectRefList *refs, List list, const QVector<int> &indices);
+
+  /** Resolves all references, adds all staged objects to the configuration and labels them into
+   * the given context, if not @c nullptr. On success, the configuration is handed over to the
+   * caller. On error, the configuration and all staged objects remain with the builder.
+   * @returns The configuration or @c nullptr on error. */
+  Config *finish(ConfigItem::Context *context=nullptr, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Returns the specified list of the configuration. */
+  AbstractConfigObjectList *configList(List list) const;
+  /** Returns the object at the given index of the specified list or @c nullptr. */
+  ConfigObject *resolve(List list, int idx) const;
+
+protected:
+  /** A reference to resolve in @c finish. */
+  struct Link {
+    ConfigObjectReference *ref;   ///< The reference to set or @c nullptr.
+    ConfigObjectRefList *refs;    ///< The reference list to append to or @c nullptr.
+    List list;                    ///< The list of the target.
+    int index;                    ///< The index of the target within the list.
+  };
+
+  /** Number of lists. */
+  static const int NUM_LISTS = int(List::RoamingZones)+1;
+
+  /** Pools the objects created while building. */
+  ObjectArena::Scope _arena;
+  /** The configuration being built. */
+  Config *_config;
+  /** If @c true, the configuration is owned by the builder. */
+  bool _ownsConfig;
+  /** The staged objects per list. */
+  QVector<ConfigObject *> _staged[NUM_LISTS];
+  /** The references to resolve. */
+  QVector<Link> _links;
+};
+
+#endif // CONFIGBUILDER_HH
@@ -5,6 +5,19 @@
 #include "radioid.hh"
 #include "roamingzone.hh"
 #include "logger.hh"
+#include "objectarena.hh"
+#include "config.hh"
+#include "tracer.hh"
+
+// Returns the index of the given property on the clone. The clone usually shares the type of the
+// original item, the property index can then be used directly.
+inline int cloneIndex(const QObject *clone, const QMetaProperty &prop) {
+  const QMetaObject *meta = clone->metaObject();
+  int idx = prop.propertyIndex();
+  if ((idx < meta->propertyCount()) && (0 == strcmp(meta->property(idx).name(), prop.name())))
+    return idx;
+  return meta->indexOfProperty(prop.name());
+}
 
 /* ********************************************************************************************* *
  * Implementation of ConfigCloneVisitor
@@ -18,10 +31,11 @@ ConfigCloneVisitor::ConfigCloneVisitor(QHash<ConfigObject *, ConfigObject *> &ma
 
 bool
 ConfigCloneVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop, const ErrorStack &err) {
-  if (prop.isEnumType() || (QString("bool") == prop.typeName())
-      || (QString("int") == prop.typeName()) || (QString("uint") == prop.typeName())
-      || (QString("double") == prop.typeName()) || (QString("QString") == prop.typeName())
-      || (QString("Frequency") == prop.typeName()) || (QString("Interval") == prop.typeName())) {
+  ConfigItem::PropertyKind kind = item->propertyKind(prop);
+  if ((ConfigItem::PropertyKind::Enum == kind) || (ConfigItem::PropertyKind::Bool == kind)
+      || (ConfigItem::PropertyKind::Int == kind) || (ConfigItem::PropertyKind::UInt == kind)
+      || (ConfigItem::PropertyKind::Double == kind) || (ConfigItem::PropertyKind::String == kind)
+      || (ConfigItem::PropertyKind::Frequency == kind) || (ConfigItem::PropertyKind::Interval == kind)) {
     if ((! prop.isReadable()) && (!prop.isWritable())) {
       logDebug() << "Skip property " << prop.name()
                  << " of item " << item->metaObject()->className() << ": Not readable or writable.";
@@ -39,7 +53,7 @@ ConfigCloneVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop,
       return false;
     }
     // Find the property
-    int pidx = clone->metaObject()->indexOfProperty(prop.name());
+    int pidx = cloneIndex(clone, prop);
     if (0 > pidx) {
       errMsg(err) << "Cannot set property " << prop.name() << " on element on stack.";
       return false;
@@ -50,7 +64,7 @@ ConfigCloneVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop,
       return false;
     }
     return true;
-  } else if (propIsInstance<ConfigObjectReference>(prop)) {
+  } else if (ConfigItem::PropertyKind::Reference == kind) {
     // Get clone
     ConfigItem *clone = qobject_cast<ConfigItem*>(_stack.back());
     if (nullptr == clone) {
@@ -62,8 +76,10 @@ ConfigCloneVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop,
     ConfigObjectReference *ref = prop.read(item).value<ConfigObjectReference *>();
     ConfigObjectReference *cloneRef = prop.read(clone).value<ConfigObjectReference*>();
     cloneRef->set(ref->as<ConfigObject>());
+    if (! ref->isNull())
+      _references.append(cloneRef);
     return true;
-  } else if (propIsInstance<ConfigItem>(prop)) {
+  } else if (ConfigItem::PropertyKind::Item == kind) {
     if (nullptr == prop.read(item).value<ConfigItem *>())
       return true;
     // If writeable, simply traverse config item
@@ -75,7 +91,7 @@ ConfigCloneVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop,
       ConfigItem *newItem = dynamic_cast<ConfigItem *>(_stack.back()); _stack.pop_back();
       // Also, get item from stack, who owns the clones item
       ConfigItem *clone = dynamic_cast<ConfigItem *>(_stack.back());
-      int pidx = clone->metaObject()->indexOfProperty(prop.name());
+      int pidx = cloneIndex(clone, prop);
       // Find the property
       if (0 > pidx) {
         errMsg(err) << "Cannot set property " << prop.name() << " on element on stack.";
@@ -98,7 +114,7 @@ ConfigCloneVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop,
       return false;
     }
 
-    int pidx = clone->metaObject()->indexOfProperty(prop.name());
+    int pidx = cloneIndex(clone, prop);
     if (0 > pidx) {
       errMsg(err) << "Cannot read property " << prop.name() << " on element on stack.";
       return false;
@@ -117,7 +133,8 @@ ConfigCloneVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop,
     }
     _stack.pop_back();
     return true;
-  } else if (ConfigObjectList *lst = prop.read(item).value<ConfigObjectList *>()) {
+  } else if (ConfigObjectList *lst = (ConfigItem::PropertyKind::ObjectList == kind)
+             ? prop.read(item).value<ConfigObjectList *>() : nullptr) {
     // Lists are always owned by the item. So dig up the list and put it on the stack
     ConfigItem *clone = dynamic_cast<ConfigItem *>(_stack.back());
     if (nullptr == clone) {
@@ -126,7 +143,7 @@ ConfigCloneVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop,
       return false;
     }
 
-    int pidx = clone->metaObject()->indexOfProperty(prop.name());
+    int pidx = cloneIndex(clone, prop);
     if (0 > pidx) {
       errMsg(err) << "Cannot read property " << prop.name() << " on element on stack.";
       return false;
@@ -145,7 +162,8 @@ ConfigCloneVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop,
     }
     _stack.pop_back();
     return true;
-  } else if (ConfigObjectRefList *refs = prop.read(item).value<ConfigObjectRefList *>()) {
+  } else if (ConfigObjectRefList *refs = (ConfigItem::PropertyKind::RefList == kind)
+             ? prop.read(item).value<ConfigObjectRefList *>() : nullptr) {
     // Lists are always owned by the item. So dig up the parent and get the list
     ConfigItem *clone = dynamic_cast<ConfigItem *>(_stack.back());
     if (nullptr == clone) {
@@ -154,7 +172,7 @@ ConfigCloneVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop,
       return false;
     }
 
-    int pidx = clone->metaObject()->indexOfProperty(prop.name());
+    int pidx = cloneIndex(clone, prop);
     if (0 > pidx) {
       errMsg(err) << "Cannot read property " << prop.name() << " on element on stack.";
       return false;
@@ -215,9 +233,13 @@ ConfigCloneVisitor::processList(AbstractConfigObjectList *list, const ErrorStack
       return false;
     }
     // Just copy references, they will be replaced later
-    for (int i=0; i<refs->count(); i++) {
-      clone->add(refs->get(i));
-    }
+    if (0 == refs->count())
+      return true;
+    QVector<ConfigObject *> objs; objs.reserve(refs->count());
+    for (int i=0; i<refs->count(); i++)
+      objs.append(refs->get(i));
+    clone->addMany(objs);
+    _refLists.append(clone);
     return true;
   }
 
@@ -234,10 +256,12 @@ ConfigCloneVisitor::processList(AbstractConfigObjectList *list, const ErrorStack
     if (! Visitor::processList(olist, err))
       return false;
 
-    // Take generated items from stack
-    for (int i=0; i<olist->count(); i++) {
-      clone->add(dynamic_cast<ConfigObject *>(_stack.back()),0); _stack.pop_back();
-    }
+    // Take generated items from stack, these are in order
+    QVector<ConfigObject *> objs; objs.reserve(olist->count());
+    for (int i=_stack.size()-olist->count(); i<_stack.size(); i++)
+      objs.append(dynamic_cast<ConfigObject *>(_stack.at(i)));
+    _stack.erase(_stack.end()-olist->count(), _stack.end());
+    clone->addMany(objs);
 
     return true;
   }
@@ -263,6 +287,56 @@ ConfigCloneVisitor::takeResult(const ErrorStack &err) {
   return item;
 }
 
+bool
+ConfigCloneVisitor::fixReferences(bool keepUnknown, const ErrorStack &err) {
+  // Populate with default singleton instances.
+  _map[SelectedChannel::get()] = SelectedChannel::get();
+  _map[DefaultRadioID::get()]  = DefaultRadioID::get();
+  _map[DefaultRoamingZone::get()] = DefaultRoamingZone::get();
+
+  foreach (ConfigObjectReference *ref, _references) {
+    ConfigObject *obj = ref->as<ConfigObject>();
+    if (nullptr == obj)
+      continue;
+    ConfigObject *mapped = _map.value(obj, nullptr);
+    if (mapped) {
+      ref->set(mapped);
+    } else if (! keepUnknown) {
+      errMsg(err) << "Cannot fix refrence to object '" << obj->name()
+                  << "' of type " << obj->metaObject()->className()
+                  << ": Not mapped/cloned yet.";
+      return false;
+    }
+  }
+  _references.clear();
+
+  foreach (ConfigObjectRefList *rlist, _refLists) {
+    QVector<ConfigObject *> objs; objs.reserve(rlist->count());
+    bool changed = false;
+    for (int i=0; i<rlist->count(); i++) {
+      ConfigObject *obj = rlist->get(i);
+      ConfigObject *mapped = _map.value(obj, nullptr);
+      if ((nullptr == mapped) && (! keepUnknown)) {
+        errMsg(err) << "Cannot fix refrence to object '" << obj->name()
+                    << "' of type " << obj->metaObject()->className()
+                    << ": Not mapped/cloned yet.";
+        return false;
+      }
+      if (mapped && (mapped != obj))
+        changed = true;
+      objs.append(mapped ? mapped : obj);
+    }
+    if (! changed)
+      continue;
+    // Replace content at once, duplicate references get dropped
+    rlist->clear();
+    rlist->addMany(objs);
+  }
+  _refLists.clear();
+
+  return true;
+}
+
 
 
 /* ********************************************************************************************* *
@@ -335,15 +409,24 @@ FixReferencesVisistor::processList(AbstractConfigObjectList *list, const ErrorSt
  * ********************************************************************************************* */
 ConfigItem *
 ConfigCopy::copy(ConfigItem *original, const ErrorStack &err) {
+  TRACE_SPAN("ConfigCopy::copy", "visitor");
+  ObjectArena::Scope arena;
   QHash<ConfigObject*, ConfigObject*> map;
+  // Pre-size mapping table for complete configs
+  if (Config *config = original->as<Config>()) {
+    map.reserve(config->radioIDs()->count() + config->contacts()->count()
+                + config->rxGroupLists()->count() + config->channelList()->count()
+                + config->zones()->count() + config->scanlists()->count()
+                + config->posSystems()->count() + config->roamingChannels()->count()
+                + config->roamingZones()->count() + 3);
+  }
   ConfigCloneVisitor cloner(map);
   if (! cloner.processItem(original, err)) {
     errMsg(err) << "Cannot clone item of type " << original->metaObject()->className() << ".";
     return nullptr;
   }
   ConfigItem *clone = cloner.takeResult();
-  FixReferencesVisistor fixer(map, true);
-  if (! fixer.processItem(clone, err)) {
+  if (! cloner.fixReferences(true, err)) {
     errMsg(err) << "Cannot fix references in item of type "
                 << clone->metaObject()->className() << ".";
     delete clone;
@@ -4,9 +4,14 @@
 #include "visitor.hh"
 
 class ConfigObject;
+class ConfigObjectReference;
+class ConfigObjectRefList;
 
 /** This visitor traverses the the given configuration and clones it. All references are still
  *  pointing to the originals.
+ *
+ * While cloning, all references and reference lists of the clones are collected. Hence, they can
+ * be fixed afterwards using @c fixReferences without traversing the clone again.
  * @ingroup conf */
 class ConfigCloneVisitor : public Visitor
 {
@@ -22,11 +27,20 @@ public:
   /** Extracts the cloned item. */
   ConfigItem *takeResult(const ErrorStack &err=ErrorStack());
 
+  /** Replaces all references of the clones collected so far using the mapping table.
+   * @param keepUnknown If @c false, an unmapped reference is an error.
+   * @param err Passes the error stack. */
+  bool fixReferences(bool keepUnknown=false, const ErrorStack &err=ErrorStack());
+
 protected:
   /** Stack of the current object. */
   QList<QObject *> _stack;
   /** Reference to the translation table origial -> cloned object. */
   QHash<ConfigObject *, ConfigObject*> &_map;
+  /** All references of the clones, still pointing to the originals. */
+  QVector<ConfigObjectReference *> _references;
+  /** All reference lists of the clones, still pointing to the originals. */
+  QVector<ConfigObjectRefList *> _refLists;
 };
 
 
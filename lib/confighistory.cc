@@ -0,0 +1,283 @@
+#include "confighistory.hh"
+#include "configobject.hh"
+#include "configreference.hh"
+#include "frequency.hh"
+#include "interval.hh"
+#include "logger.hh"
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigHistory
+ * ********************************************************************************************* */
+ConfigHistory::ConfigHistory(unsigned int limit, QObject *parent)
+  : QObject(parent), _limit(limit), _depth(0), _label(), _snapshots(), _tracked(), _undo(), _redo()
+{
+  // pass...
+}
+
+void
+ConfigHistory::begin(const QString &label) {
+  if (0 == _depth++)
+    _label = label;
+}
+
+void
+ConfigHistory::track(ConfigItem *item) {
+  if ((0 == _depth) || (nullptr == item) || _tracked.contains(item))
+    return;
+
+  const QVector<ConfigItem::PropertyInfo> &table = ConfigItem::propertyTable(item->metaObject());
+  Snapshot snapshot{item, QVector<Value>(table.size())};
+  for (int i=0; i<table.size(); i++)
+    capture(item, i, snapshot.values[i]);
+  _tracked.insert(item, _snapshots.size());
+  _snapshots.append(snapshot);
+
+  // Track owned items like extensions as well
+  for (int i=0; i<table.size(); i++) {
+    if ((! table[i].prop.isReadable()) || (ConfigItem::PropertyKind::Item != item->propertyKind(table[i])))
+      continue;
+    track(table[i].prop.read(item).value<ConfigItem *>());
+  }
+}
+
+bool
+ConfigHistory::commit() {
+  if (0 == _depth) {
+    logWarn() << "Cannot commit history step: No step open.";
+    return false;
+  }
+  if (0 != --_depth)
+    return false;
+
+  Step step{_label, QVector<Change>()};
+  foreach (const Snapshot &snapshot, _snapshots) {
+    ConfigItem *item = snapshot.item.data();
+    if (nullptr == item)
+      continue;
+    for (int i=0; i<snapshot.values.size(); i++) {
+      Value after;
+      if (! capture(item, i, after))
+        continue;
+      if (! equal(item, i, snapshot.values[i], after))
+        step.changes.append(Change{item, i, snapshot.values[i], after});
+    }
+  }
+  _snapshots.clear();
+  _tracked.clear();
+
+  if (step.changes.isEmpty())
+    return false;
+
+  logDebug() << "Record " << step.changes.size() << " changes as '" << step.label << "'.";
+  _undo.append(step);
+  _redo.clear();
+  while ((unsigned int)_undo.size() > _limit)
+    _undo.removeFirst();
+  emit changed();
+  return true;
+}
+
+bool
+ConfigHistory::isRecording() const {
+  return 0 != _depth;
+}
+
+bool
+ConfigHistory::canUndo() const {
+  return ! _undo.isEmpty();
+}
+
+bool
+ConfigHistory::canRedo() const {
+  return ! _redo.isEmpty();
+}
+
+QString
+ConfigHistory::undoLabel() const {
+  if (_undo.isEmpty())
+    return QString();
+  return _undo.last().label;
+}
+
+QString
+ConfigHistory::redoLabel() const {
+  if (_redo.isEmpty())
+    return QString();
+  return _redo.last().label;
+}
+
+bool
+ConfigHistory::undo(const ErrorStack &err) {
+  if (isRecording()) {
+    errMsg(err) << "Cannot undo while recording.";
+    return false;
+  }
+  if (_undo.isEmpty()) {
+    errMsg(err) << "Nothing to undo.";
+    return false;
+  }
+
+  Step step = _undo.takeLast();
+  bool ok = apply(step, true, err);
+  _redo.append(step);
+  emit changed();
+  return ok;
+}
+
+bool
+ConfigHistory::redo(const ErrorStack &err) {
+  if (isRecording()) {
+    errMsg(err) << "Cannot redo while recording.";
+    return false;
+  }
+  if (_redo.isEmpty()) {
+    errMsg(err) << "Nothing to redo.";
+    return false;
+  }
+
+  Step step = _redo.takeLast();
+  bool ok = apply(step, false, err);
+  _undo.append(step);
+  emit changed();
+  return ok;
+}
+
+void
+ConfigHistory::clear() {
+  _depth = 0;
+  _snapshots.clear();
+  _tracked.clear();
+  _undo.clear();
+  _redo.clear();
+  emit changed();
+}
+
+bool
+ConfigHistory::capture(ConfigItem *item, int property, Value &value) {
+  const ConfigItem::PropertyInfo &info = ConfigItem::propertyTable(item->metaObject()).at(property);
+  if (! info.prop.isReadable())
+    return false;
+
+  switch (item->propertyKind(info)) {
+  case ConfigItem::PropertyKind::Enum:
+  case ConfigItem::PropertyKind::Bool:
+  case ConfigItem::PropertyKind::Int:
+  case ConfigItem::PropertyKind::UInt:
+  case ConfigItem::PropertyKind::Double:
+  case ConfigItem::PropertyKind::String:
+  case ConfigItem::PropertyKind::Frequency:
+  case ConfigItem::PropertyKind::Interval:
+    if (! info.prop.isWritable())
+      return false;
+    value.value = info.prop.read(item);
+    return true;
+  case ConfigItem::PropertyKind::Reference:
+    if (ConfigObjectReference *ref = info.prop.read(item).value<ConfigObjectReference *>()) {
+      value.objects.clear();
+      if (! ref->isNull())
+        value.objects.append(ref->as<ConfigObject>());
+      return true;
+    }
+    return false;
+  case ConfigItem::PropertyKind::RefList:
+    if (ConfigObjectRefList *list = info.prop.read(item).value<ConfigObjectRefList *>()) {
+      value.objects.clear();
+      value.objects.reserve(list->count());
+      for (int i=0; i<list->count(); i++)
+        value.objects.append(list->get(i));
+      return true;
+    }
+    return false;
+  default:
+    break;
+  }
+
+  return false;
+}
+
+bool
+ConfigHistory::restore(ConfigItem *item, int property, const Value &value, const ErrorStack &err) {
+  const ConfigItem::PropertyInfo &info = ConfigItem::propertyTable(item->metaObject()).at(property);
+  ConfigItem::PropertyKind kind = item->propertyKind(info);
+
+  if (ConfigItem::PropertyKind::Reference == kind) {
+    ConfigObjectReference *ref = info.prop.read(item).value<ConfigObjectReference *>();
+    ConfigObject *obj = value.objects.isEmpty() ? nullptr : value.objects.first().data();
+    if ((nullptr == ref) || (! ref->set(obj))) {
+      errMsg(err) << "Cannot restore reference '" << info.prop.name() << "' of "
+                  << item->metaObject()->className() << ".";
+      return false;
+    }
+    return true;
+  }
+
+  if (ConfigItem::PropertyKind::RefList == kind) {
+    ConfigObjectRefList *list = info.prop.read(item).value<ConfigObjectRefList *>();
+    if (nullptr == list) {
+      errMsg(err) << "Cannot restore list '" << info.prop.name() << "' of "
+                  << item->metaObject()->className() << ".";
+      return false;
+    }
+    QVector<ConfigObject *> objs; objs.reserve(value.objects.size());
+    foreach (const QPointer<ConfigObject> &obj, value.objects) {
+      if (obj)
+        objs.append(obj.data());
+    }
+    list->beginUpdate();
+    list->clear();
+    list->addMany(objs, false);
+    list->endUpdate();
+    return true;
+  }
+
+  if (! info.prop.write(item, value.value)) {
+    errMsg(err) << "Cannot restore property '" << info.prop.name() << "' of "
+                << item->metaObject()->className() << ".";
+    return false;
+  }
+  return true;
+}
+
+bool
+ConfigHistory::equal(ConfigItem *item, int property, const Value &a, const Value &b) {
+  const ConfigItem::PropertyInfo &info = ConfigItem::propertyTable(item->metaObject()).at(property);
+  switch (item->propertyKind(info)) {
+  case ConfigItem::PropertyKind::Enum:
+  case ConfigItem::PropertyKind::Bool:
+  case ConfigItem::PropertyKind::Int:
+  case ConfigItem::PropertyKind::UInt:
+    return a.value.toInt() == b.value.toInt();
+  case ConfigItem::PropertyKind::Double:
+    return a.value.toDouble() == b.value.toDouble();
+  case ConfigItem::PropertyKind::String:
+    return a.value.toString() == b.value.toString();
+  case ConfigItem::PropertyKind::Frequency: {
+    Frequency fa = a.value.value<Frequency>(), fb = b.value.value<Frequency>();
+    return (! (fa < fb)) && (! (fb < fa));
+  }
+  case ConfigItem::PropertyKind::Interval: {
+    Interval ia = a.value.value<Interval>(), ib = b.value.value<Interval>();
+    return (! (ia < ib)) && (! (ib < ia));
+  }
+  default:
+    break;
+  }
+  return a.objects == b.objects;
+}
+
+bool
+ConfigHistory::apply(const Step &step, bool backward, const ErrorStack &err) {
+  bool ok = true;
+  for (int i=0; i<step.changes.size(); i++) {
+    const Change &change = step.changes[backward ? (step.changes.size()-1-i) : i];
+    ConfigItem *item = change.item.data();
+    if (nullptr == item)
+      continue;
+    if (! restore(item, change.property, backward ? change.before : change.after, err))
+      ok = false;
+  }
+  if (! ok)
+    errMsg(err) << "Cannot " << (backward ? "undo" : "redo") << " '" << step.label << "'.";
+  return ok;
+}
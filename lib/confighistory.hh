@@ -0,0 +1,137 @@
+#ifndef CONFIGHISTORY_HH
+#define CONFIGHISTORY_HH
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include <QHash>
+#include <QVariant>
+#include "errorstack.hh"
+
+class ConfigItem;
+class ConfigObject;
+
+/** Records property-level changes of config items for undo and redo.
+ *
+ * Edits are recorded as steps. A step gets opened by @c begin and every item edited within the
+ * step gets announced by @c track before it is changed. Once the step gets committed, the tracked
+ * items are compared against the values captured by @c track and only the changed properties are
+ * kept together with their old and new values. Hence, the memory held by the history is
+ * proportional to the edits, not to the size of the config. Undoing or redoing a step only writes
+ * the recorded properties.
+ *
+ * Steps may be nested, e.g., to group a bulk edit. Only the outermost @c commit records a step.
+ *
+ * Basic properties, references and reference lists are recorded, including those of owned items
+ * like extensions. Adding or removing objects is not recorded. References to objects deleted
+ * meanwhile are restored as null references, changes to deleted items are skipped.
+ *
+ * @ingroup conf */
+class ConfigHistory: public QObject
+{
+  Q_OBJECT
+
+public:
+  /** Constructs an empty history keeping at most @c limit steps. */
+  explicit ConfigHistory(unsigned int limit=100, QObject *parent=nullptr);
+
+  /** Opens a (nested) step with the given label. The label of the outermost step is kept. */
+  void begin(const QString &label);
+  /** Captures the current state of the given item and its owned items. Must be called before
+   * the item gets changed within an open step. Items tracked before are ignored. */
+  void track(ConfigItem *item);
+  /** Closes the current step. If the outermost step is closed, the changes get recorded.
+   * @returns @c true if a step with at least one change got recorded. */
+  bool commit();
+  /** Returns @c true if a step is open. */
+  bool isRecording() const;
+
+  /** Returns @c true if there is a step to undo. */
+  bool canUndo() const;
+  /** Returns @c true if there is a step to redo. */
+  bool canRedo() const;
+  /** Returns the label of the next step to undo. */
+  QString undoLabel() const;
+  /** Returns the label of the next step to redo. */
+  QString redoLabel() const;
+
+  /** Reverts the last recorded step. */
+  bool undo(const ErrorStack &err=ErrorStack());
+  /** Re-applies the last reverted step. */
+  bool redo(const ErrorStack &err=ErrorStack());
+
+public slots:
+  /** Drops all recorded steps, e.g., once another codeplug got loaded. */
+  void clear();
+
+signals:
+  /** Gets emitted whenever a step got recorded, undone or redone and once the history got
+   * cleared. */
+  void changed();
+
+protected:
+  /** The value of a single property. Basic properties are held as variants, references and
+   * reference lists as weak pointers to the referenced objects. */
+  struct Value {
+    /** The value of a basic property. */
+    QVariant value;
+    /** The referenced objects. */
+    QVector<QPointer<ConfigObject>> objects;
+  };
+
+  /** A recorded change of a single property. */
+  struct Change {
+    /** The changed item. */
+    QPointer<ConfigItem> item;
+    /** The index of the property within the property table of the item. */
+    int property;
+    /** The value before the change. */
+    Value before;
+    /** The value after the change. */
+    Value after;
+  };
+
+  /** A recorded step. */
+  struct Step {
+    /** The label of the step. */
+    QString label;
+    /** The changes of the step, in order of the tracked items. */
+    QVector<Change> changes;
+  };
+
+  /** The state of a tracked item. */
+  struct Snapshot {
+    /** The tracked item. */
+    QPointer<ConfigItem> item;
+    /** The values indexed like the property table of the item. */
+    QVector<Value> values;
+  };
+
+protected:
+  /** Captures the value of the given property. Returns @c false if the property is not recorded. */
+  static bool capture(ConfigItem *item, int property, Value &value);
+  /** Restores the value of the given property. */
+  static bool restore(ConfigItem *item, int property, const Value &value, const ErrorStack &err);
+  /** Compares two values of the given property. */
+  static bool equal(ConfigItem *item, int property, const Value &a, const Value &b);
+  /** Applies the given step forward or backward. */
+  bool apply(const Step &step, bool backward, const ErrorStack &err);
+
+protected:
+  /** The maximum number of steps. */
+  unsigned int _limit;
+  /** The nesting depth of the open step. */
+  unsigned int _depth;
+  /** The label of the open step. */
+  QString _label;
+  /** The items tracked within the open step. */
+  QVector<Snapshot> _snapshots;
+  /** Maps the tracked items to their snapshots. */
+  QHash<ConfigItem *, int> _tracked;
+  /** The steps to undo, the most recent last. */
+  QVector<Step> _undo;
+  /** The steps to redo, the most recently undone last. */
+  QVector<Step> _redo;
+};
+
+#endif // CONFIGHISTORY_HH
@@ -1,7 +1,7 @@
 #include "configlabelingvisitor.hh"
 
 ConfigLabelingVisitor::ConfigLabelingVisitor(ConfigItem::Context &context)
-  : Visitor(), _context(context)
+  : Visitor({ConfigObject::staticMetaObject}), _context(context)
 {
   // pass..
 }
@@ -18,13 +18,8 @@ ConfigLabelingVisitor::processItem(ConfigItem *item, const ErrorStack &err)
     if (prefix.isEmpty())
       return Visitor::processItem(item, err);
 
-    // Find unused ID
-    unsigned n=1;
-    QString id=QString("%1%2").arg(prefix).arg(n);
-    while (_context.contains(id))
-      id=QString("%1%2").arg(prefix).arg(++n);
-
-    // Add to context
+    // Find unused ID and add to context
+    QString id = _context.newId(prefix);
     if (! _context.add(id, obj)) {
       if (_context.contains(obj))
         errMsg(err) << "Object already in context with id '" << _context.getId(obj) << "'.";
@@ -5,6 +5,7 @@
 #include "config.hh"
 #include "channel.hh"
 #include "logger.hh"
+#include "tracer.hh"
 
 
 /* ********************************************************************************************* *
@@ -48,11 +49,11 @@ ConfigMergeVisitor::processItem(ConfigItem *item, const ErrorStack &err) {
 
 bool
 ConfigMergeVisitor::processRadioID(RadioID *item, const ErrorStack &err) {
-  if (0 == _destination->radioIDs()->findItemsByName(item->name()).count())
+  ConfigObject *found = _destination->radioIDs()->findItemByName(item->name());
+  if (nullptr == found)
     return addObject(_destination->radioIDs(), nullptr, item, err);
 
-  RadioID *present = _destination->radioIDs()->findItemsByName(item->name())
-      .first()->as<RadioID>();
+  RadioID *present = found->as<RadioID>();
 
   if (ItemStrategy::Ignore == _itemStrategy)
     return ignoreObject(_destination->radioIDs(), present, item, err);
@@ -69,11 +70,11 @@ ConfigMergeVisitor::processRadioID(RadioID *item, const ErrorStack &err) {
 
 bool
 ConfigMergeVisitor::processChannel(Channel *item, const ErrorStack &err) {
-  if (0 == _destination->channelList()->findItemsByName(item->name()).count())
+  ConfigObject *found = _destination->channelList()->findItemByName(item->name());
+  if (nullptr == found)
     return addObject(_destination->channelList(), nullptr, item, err);
 
-  Channel *present = _destination->channelList()->findItemsByName(item->name())
-      .first()->as<Channel>();
+  Channel *present = found->as<Channel>();
 
   if (ItemStrategy::Ignore == _itemStrategy)
     return ignoreObject(_destination->channelList(), present, item, err);
@@ -90,11 +91,11 @@ ConfigMergeVisitor::processChannel(Channel *item, const ErrorStack &err) {
 
 bool
 ConfigMergeVisitor::processContact(Contact *item, const ErrorStack &err) {
-  if (0 == _destination->contacts()->findItemsByName(item->name()).count())
+  ConfigObject *found = _destination->contacts()->findItemByName(item->name());
+  if (nullptr == found)
     return addObject(_destination->contacts(), nullptr, item, err);
 
-  Contact *present = _destination->contacts()->findItemsByName(item->name())
-      .first()->as<Contact>();
+  Contact *present = found->as<Contact>();
 
   if (ItemStrategy::Ignore == _itemStrategy)
     return ignoreObject(_destination->contacts(), present, item, err);
@@ -111,11 +112,11 @@ ConfigMergeVisitor::processContact(Contact *item, const ErrorStack &err) {
 
 bool
 ConfigMergeVisitor::processPositioningSystem(PositioningSystem *item, const ErrorStack &err) {
-  if (0 == _destination->posSystems()->findItemsByName(item->name()).count())
+  ConfigObject *found = _destination->posSystems()->findItemByName(item->name());
+  if (nullptr == found)
     return addObject(_destination->posSystems(), nullptr, item, err);
 
-  PositioningSystem *present = _destination->posSystems()->findItemsByName(item->name())
-      .first()->as<PositioningSystem>();
+  PositioningSystem *present = found->as<PositioningSystem>();
 
   if (ItemStrategy::Ignore == _itemStrategy)
     return ignoreObject(_destination->posSystems(), present, item, err);
@@ -132,11 +133,11 @@ ConfigMergeVisitor::processPositioningSystem(PositioningSystem *item, const Erro
 
 bool
 ConfigMergeVisitor::processRoamingChannel(RoamingChannel *item, const ErrorStack &err) {
-  if (0 == _destination->roamingChannels()->findItemsByName(item->name()).count())
+  ConfigObject *found = _destination->roamingChannels()->findItemByName(item->name());
+  if (nullptr == found)
     return addObject(_destination->roamingChannels(), nullptr, item, err);
 
-  RoamingChannel *present = _destination->roamingChannels()->findItemsByName(item->name())
-      .first()->as<RoamingChannel>();
+  RoamingChannel *present = found->as<RoamingChannel>();
 
   if (ItemStrategy::Ignore == _itemStrategy)
     return ignoreObject(_destination->roamingChannels(), present, item, err);
@@ -153,11 +154,11 @@ ConfigMergeVisitor::processRoamingChannel(RoamingChannel *item, const ErrorStack
 
 bool
 ConfigMergeVisitor::processGroupList(RXGroupList *item, const ErrorStack &err) {
-  if (0 == _destination->rxGroupLists()->findItemsByName(item->name()).count())
+  ConfigObject *found = _destination->rxGroupLists()->findItemByName(item->name());
+  if (nullptr == found)
     return addObject(_destination->rxGroupLists(), nullptr, item, err);
 
-  RXGroupList *present = _destination->rxGroupLists()->findItemsByName(item->name())
-      .first()->as<RXGroupList>();
+  RXGroupList *present = found->as<RXGroupList>();
 
   if (SetStrategy::Ignore == _setStrategy)
     return ignoreObject(_destination->rxGroupLists(), present, item, err);
@@ -177,11 +178,11 @@ ConfigMergeVisitor::processGroupList(RXGroupList *item, const ErrorStack &err) {
 
 bool
 ConfigMergeVisitor::processZone(Zone *item, const ErrorStack &err) {
-  if (0 == _destination->zones()->findItemsByName(item->name()).count())
+  ConfigObject *found = _destination->zones()->findItemByName(item->name());
+  if (nullptr == found)
     return addObject(_destination->zones(), nullptr, item, err);
 
-  Zone *present = _destination->zones()->findItemsByName(item->name())
-      .first()->as<Zone>();
+  Zone *present = found->as<Zone>();
 
   if (SetStrategy::Ignore == _setStrategy)
     return ignoreObject(_destination->zones(), present, item, err);
@@ -202,11 +203,11 @@ ConfigMergeVisitor::processZone(Zone *item, const ErrorStack &err) {
 
 bool
 ConfigMergeVisitor::processScanList(ScanList *item, const ErrorStack &err) {
-  if (0 == _destination->scanlists()->findItemsByName(item->name()).count())
+  ConfigObject *found = _destination->scanlists()->findItemByName(item->name());
+  if (nullptr == found)
     return addObject(_destination->scanlists(), nullptr, item, err);
 
-  ScanList *present = _destination->scanlists()->findItemsByName(item->name())
-      .first()->as<ScanList>();
+  ScanList *present = found->as<ScanList>();
 
   if (SetStrategy::Ignore == _setStrategy)
     return ignoreObject(_destination->scanlists(), present, item, err);
@@ -226,11 +227,11 @@ ConfigMergeVisitor::processScanList(ScanList *item, const ErrorStack &err) {
 
 bool
 ConfigMergeVisitor::processRoamingZone(RoamingZone *item, const ErrorStack &err) {
-  if (0 == _destination->roamingZones()->findItemsByName(item->name()).count())
+  ConfigObject *found = _destination->roamingZones()->findItemByName(item->name());
+  if (nullptr == found)
     return addObject(_destination->roamingZones(), nullptr, item, err);
 
-  RoamingZone *present = _destination->roamingZones()->findItemsByName(item->name())
-      .first()->as<RoamingZone>();
+  RoamingZone *present = found->as<RoamingZone>();
 
   if (SetStrategy::Ignore == _setStrategy)
     return ignoreObject(_destination->roamingZones(), present, item, err);
@@ -338,11 +339,40 @@ ConfigMerge::mergeInto(Config *destination, Config *source,
                        ConfigMergeVisitor::SetStrategy setStrategy,
                        const ErrorStack &err)
 {
+  return mergeAllInto(destination, QList<Config *>({source}), itemStrategy, setStrategy, err);
+}
+
+
+bool
+ConfigMerge::mergeAllInto(Config *destination, const QList<Config *> &sources,
+                          ConfigMergeVisitor::ItemStrategy itemStrategy,
+                          ConfigMergeVisitor::SetStrategy setStrategy,
+                          const ErrorStack &err)
+{
+  TRACE_SPAN("ConfigMerge::mergeAllInto", "visitor");
+
+  // A single translation table is shared by all merges.
   QHash<ConfigObject *, ConfigObject *> referenceTable;
   ConfigMergeVisitor mergeVisitor(destination, referenceTable, itemStrategy, setStrategy);
-  if (! mergeVisitor.process(source, err)) {
-    errMsg(err) << "Cannot merge configurations.";
-    return false;
+  for (int i=0; i<sources.size(); i++) {
+    if (! mergeVisitor.process(sources.at(i), err)) {
+      errMsg(err) << "Cannot merge configuration " << (i+1) << " of " << sources.size() << ".";
+      return false;
+    }
+  }
+
+  // As references are fixed only once, an object added by one source may have been replaced by a
+  // later one. Follow these chains to the final replacement.
+  for (QHash<ConfigObject *, ConfigObject *>::iterator it=referenceTable.begin();
+       it!=referenceTable.end(); it++) {
+    ConfigObject *target = it.value();
+    for (int steps=0; (steps<sources.size()) && referenceTable.contains(target); steps++) {
+      ConfigObject *next = referenceTable.value(target);
+      if (next == target)
+        break;
+      target = next;
+    }
+    it.value() = target;
   }
 
   FixReferencesVisistor linkVisitor(referenceTable, true);
@@ -354,13 +384,13 @@ ConfigMerge::mergeInto(Config *destination, Config *source,
   return true;
 }
 
-
 Config *
 ConfigMerge::merge(Config *destination, Config *source,
                    ConfigMergeVisitor::ItemStrategy itemStrategy,
                    ConfigMergeVisitor::SetStrategy setStrategy,
                    const ErrorStack &err)
 {
+  TRACE_SPAN("ConfigMerge::merge", "visitor");
   Config *copy = ConfigCopy::copy(destination, err)->as<Config>();
   if (nullptr == copy) {
     errMsg(err) << "Cannot merge configurations.";
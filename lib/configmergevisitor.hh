@@ -111,6 +111,16 @@ public:
                         ConfigMergeVisitor::SetStrategy setStrategy=ConfigMergeVisitor::SetStrategy::Ignore,
                         const ErrorStack &err = ErrorStack());
 
+  /** Merges all given @c sources in order into the given @c destination using the specified
+   * strategies to handle conflicts. In contrast to calling @c mergeInto for every source, the
+   * references of the @c destination get fixed only once, after all sources are merged. Hence,
+   * the sources must not be modified or deleted before this function returns. Here the
+   * @c destination codeplug gets modified, even on errors. */
+  static bool mergeAllInto(Config *destination, const QList<Config *> &sources,
+                           ConfigMergeVisitor::ItemStrategy itemStrategy=ConfigMergeVisitor::ItemStrategy::Ignore,
+                           ConfigMergeVisitor::SetStrategy setStrategy=ConfigMergeVisitor::SetStrategy::Ignore,
+                           const ErrorStack &err = ErrorStack());
+
   /** Merges the given @c source into a copy of the given @c destination, using the specified
    * strategies to handle conflicts. Here the @c destination codeplug does not get modified at
    * all. */
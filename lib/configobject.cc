@@ -4,20 +4,37 @@
 #include "frequency.hh"
 #include "interval.hh"
 #include "commercial_extension.hh"
+#include "objectarena.hh"
+#include "enumtable.hh"
+#include "memoryusage.hh"
 
 #include <QMetaProperty>
 #include <QMetaEnum>
-
-// Helper function to extract key names for a QMetaEnum
-inline QStringList enumKeys(const QMetaEnum &e) {
-  QStringList lst;
-  for (int i=0; i<e.keyCount(); i++)
-    lst.push_back(e.key(i));
-  return lst;
+#include <QMutex>
+#include <QReadWriteLock>
+#include <algorithm>
+#include <cstring>
+
+// Estimated size of the private data of a QObject, not covered by sizeof.
+#define QOBJECT_PRIVATE_SIZE 112
+
+// Combines two 64-bit hashes, 64-bit variant of boost::hash_combine
+inline quint64 hashCombine(quint64 seed, quint64 value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// FNV-1a hash of a string
+inline quint64 hashString(const QString &str) {
+  quint64 hash = 0xcbf29ce484222325ULL;
+  const ushort *c = str.utf16();
+  for (int i=0; i<str.size(); i++) {
+    hash ^= c[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
 }
 
-inline bool isInstanceOf(QObject *obj, const QStringList &typeNames) {
-  const QMetaObject *type = obj->metaObject();
+inline bool isInstanceOf(const QMetaObject *type, const QStringList &typeNames) {
   while (type) {
     if (typeNames.contains(type->className()))
       return true;
@@ -26,17 +43,26 @@ inline bool isInstanceOf(QObject *obj, const QStringList &typeNames) {
   return false;
 }
 
+inline bool isInstanceOf(QObject *obj, const QStringList &typeNames) {
+  return isInstanceOf(obj->metaObject(), typeNames);
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of ConfigObject::Context
  * ********************************************************************************************* */
-QHash<QString, QHash<QString, ConfigObject *>> ConfigObject::Context::_tagObjects =
-    QHash<QString, QHash<QString, ConfigObject *>>();
-QHash<QString, QHash<ConfigObject *, QString>> ConfigObject::Context::_tagNames =
-    QHash<QString, QHash<ConfigObject *, QString>>();
+QHash<QString, int> ConfigObject::Context::_tagIndices = QHash<QString, int>();
+QHash<QPair<const QMetaObject *, int>, int> ConfigObject::Context::_propertyTagIndices =
+    QHash<QPair<const QMetaObject *, int>, int>();
+QVector<QHash<QString, ConfigObject *>> ConfigObject::Context::_tagObjects =
+    QVector<QHash<QString, ConfigObject *>>();
+QVector<QHash<ConfigObject *, QString>> ConfigObject::Context::_tagNames =
+    QVector<QHash<ConfigObject *, QString>>();
+// Guards the tag tables, tags get registered by constructors, which may run in several threads.
+static QReadWriteLock _tagLock;
 
 ConfigItem::Context::Context()
-  : _version(), _objects(), _ids()
+  : _version(), _objects(), _ids(), _nextIds()
 {
   // pass...
 }
@@ -83,56 +109,279 @@ ConfigItem::Context::add(const QString &id, ConfigObject *obj) {
   return true;
 }
 
+QString
+ConfigItem::Context::newId(const QString &prefix) {
+  unsigned &n = _nextIds[prefix];
+  if (0 == n)
+    n = 1;
+  QString id = QString("%1%2").arg(prefix).arg(n);
+  while (contains(id))
+    id = QString("%1%2").arg(prefix).arg(++n);
+  n++;
+  return id;
+}
+
+void
+ConfigItem::Context::reserve(int size) {
+  _objects.reserve(size);
+  _ids.reserve(size);
+}
+
+int
+ConfigItem::Context::tagIndex(const QString &className, const QString &property) {
+  return _tagIndices.value(className+"::"+property, -1);
+}
+
+int
+ConfigItem::Context::tagIndex(const QMetaProperty &prop) {
+  QPair<const QMetaObject *, int> key(prop.enclosingMetaObject(), prop.propertyIndex());
+  {
+    QReadLocker locker(&_tagLock);
+    auto cached = _propertyTagIndices.constFind(key);
+    if (_propertyTagIndices.constEnd() != cached)
+      return cached.value();
+  }
+  QWriteLocker locker(&_tagLock);
+  int idx = tagIndex(prop.enclosingMetaObject()->className(), prop.name());
+  _propertyTagIndices.insert(key, idx);
+  return idx;
+}
+
 bool
 ConfigItem::Context::hasTag(const QString &className, const QString &property, const QString &tag) {
-  QString qname = className+"::"+property;
-  return _tagObjects.contains(qname) && _tagObjects[qname].contains(tag);
+  QReadLocker locker(&_tagLock);
+  int idx = tagIndex(className, property);
+  return (0 <= idx) && _tagObjects[idx].contains(tag);
 }
 
 bool
 ConfigItem::Context::hasTag(const QString &className, const QString &property, ConfigObject *obj) {
-  QString qname = className+"::"+property;
-  return _tagNames.contains(qname) && _tagNames[qname].contains(obj);
+  QReadLocker locker(&_tagLock);
+  int idx = tagIndex(className, property);
+  return (0 <= idx) && _tagNames[idx].contains(obj);
 }
 
 ConfigObject *
 ConfigItem::Context::getTag(const QString &className, const QString &property, const QString &tag) {
   //logDebug() << "Request " << tag << " for " << property << " in " << className << ".";
-  QString qname = className+"::"+property;
-  if (! _tagObjects.contains(qname))
+  QReadLocker locker(&_tagLock);
+  int idx = tagIndex(className, property);
+  if (0 > idx)
     return nullptr;
-  return _tagObjects[qname].value(tag, nullptr);
+  return _tagObjects[idx].value(tag, nullptr);
 }
 
 QString
 ConfigItem::Context::getTag(const QString &className, const QString &property, ConfigObject *obj) {
   //logDebug() << "Request tag for " << property << " in " << className << ".";
-  QString qname = className+"::"+property;
-  if (! _tagNames.contains(qname))
-    return nullptr;
-  return _tagNames[qname].value(obj);
+  QReadLocker locker(&_tagLock);
+  int idx = tagIndex(className, property);
+  if (0 > idx)
+    return QString();
+  return _tagNames[idx].value(obj);
 }
 
 void
 ConfigItem::Context::setTag(const QString &className, const QString &property, const QString &tag, ConfigObject *obj) {
   //logDebug() << "Register tag " << tag << " for " << property << " in " << className << ".";
-  QString qname = className+"::"+property;
-  if (! _tagObjects.contains(qname))
-    _tagObjects[qname] = QHash<QString, ConfigObject*>();
-  _tagObjects[qname].insert(tag, obj);
-  if (! _tagNames.contains(qname))
-    _tagNames[qname] = QHash<ConfigObject*, QString>();
-  _tagNames[qname].insert(obj, tag);
+  QWriteLocker locker(&_tagLock);
+  int idx = tagIndex(className, property);
+  if (0 > idx) {
+    idx = _tagObjects.size();
+    _tagIndices.insert(className+"::"+property, idx);
+    _tagObjects.append(QHash<QString, ConfigObject*>());
+    _tagNames.append(QHash<ConfigObject*, QString>());
+    // Cached misses may be outdated now
+    _propertyTagIndices.clear();
+  }
+  _tagObjects[idx].insert(tag, obj);
+  _tagNames[idx].insert(obj, tag);
+}
+
+bool
+ConfigItem::Context::hasTag(const QMetaProperty &prop, ConfigObject *obj) {
+  int idx = tagIndex(prop);
+  QReadLocker locker(&_tagLock);
+  return (0 <= idx) && _tagNames[idx].contains(obj);
+}
+
+ConfigObject *
+ConfigItem::Context::getTag(const QMetaProperty &prop, const QString &tag) {
+  int idx = tagIndex(prop);
+  QReadLocker locker(&_tagLock);
+  if (0 > idx)
+    return nullptr;
+  return _tagObjects[idx].value(tag, nullptr);
+}
+
+QString
+ConfigItem::Context::getTag(const QMetaProperty &prop, ConfigObject *obj) {
+  int idx = tagIndex(prop);
+  QReadLocker locker(&_tagLock);
+  if (0 > idx)
+    return QString();
+  return _tagNames[idx].value(obj);
 }
 
 
 /* ********************************************************************************************* *
  * Implementation of ConfigItem
  * ********************************************************************************************* */
+QAtomicInt ConfigItem::_renames(0);
+
 ConfigItem::ConfigItem(QObject *parent)
-  : QObject(parent)
+  : QObject(parent), _dirty(true), _revision(0), _hash(0), _hashValid(false), _hashRenames(0)
 {
-  // pass...
+  connect(this, SIGNAL(modified(ConfigItem*)), this, SLOT(markDirty()));
+}
+
+const QVector<ConfigItem::PropertyInfo> &
+ConfigItem::propertyTable(const QMetaObject *meta) {
+  static QMutex lock;
+  static QHash<const QMetaObject *, QVector<PropertyInfo> *> tables;
+
+  QMutexLocker locker(&lock);
+  if (tables.contains(meta))
+    return *tables[meta];
+
+  // Invalid properties are kept as PropertyKind::Other, such that the table can be indexed by
+  // the property index.
+  QVector<PropertyInfo> *table = new QVector<PropertyInfo>();
+  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    if (! prop.isValid())
+      logWarn() << "Invalid property " << prop.name() << ". This should not happen.";
+    PropertyKind kind = prop.isValid() ? classifyProperty(prop) : PropertyKind::Other;
+    table->append(PropertyInfo{prop, kind, (PropertyKind::Enum == kind) ? &EnumTable::get(prop.enumerator()) : nullptr});
+  }
+
+  tables.insert(meta, table);
+  return *table;
+}
+
+ConfigItem::PropertyKind
+ConfigItem::classifyProperty(const QMetaProperty &prop) {
+  if (prop.isEnumType())
+    return PropertyKind::Enum;
+  if (QVariant::Bool == prop.type())
+    return PropertyKind::Bool;
+  if (QVariant::Int == prop.type())
+    return PropertyKind::Int;
+  if (QVariant::UInt == prop.type())
+    return PropertyKind::UInt;
+  if (QVariant::Double == prop.type())
+    return PropertyKind::Double;
+  if (QVariant::String == prop.type())
+    return PropertyKind::String;
+  if (qMetaTypeId<Frequency>() == prop.userType())
+    return PropertyKind::Frequency;
+  if (qMetaTypeId<Interval>() == prop.userType())
+    return PropertyKind::Interval;
+  if (propIsInstance<ConfigObjectReference>(prop))
+    return PropertyKind::Reference;
+  if (propIsInstance<ConfigObjectRefList>(prop))
+    return PropertyKind::RefList;
+  if (propIsInstance<ConfigObjectList>(prop))
+    return PropertyKind::ObjectList;
+  if (propIsInstance<ConfigItem>(prop))
+    return PropertyKind::Item;
+  if (QMetaType::UnknownType == prop.userType())
+    return PropertyKind::Unresolved;
+  return PropertyKind::Other;
+}
+
+bool
+ConfigItem::mayContain(const QMetaObject *meta, const QString &typeName) {
+  static QMutex lock;
+  static QHash<QPair<const QMetaObject *, QString>, bool> table;
+
+  QPair<const QMetaObject *, QString> key(meta, typeName);
+  {
+    QMutexLocker locker(&lock);
+    auto entry = table.constFind(key);
+    if (table.constEnd() != entry)
+      return entry.value();
+  }
+
+  // Compute outside of the lock, the property tables are locked separately
+  QSet<const QMetaObject *> visiting;
+  bool result = computeMayContain(meta, typeName, visiting);
+
+  QMutexLocker locker(&lock);
+  table.insert(key, result);
+  return result;
+}
+
+bool
+ConfigItem::mayContainAny(const QMetaObject *meta, const QStringList &typeNames) {
+  foreach (const QString &typeName, typeNames) {
+    if (mayContain(meta, typeName))
+      return true;
+  }
+  return false;
+}
+
+bool
+ConfigItem::computeMayContain(const QMetaObject *meta, const QString &typeName,
+                              QSet<const QMetaObject *> &visiting) {
+  // Cyclic declarations are resolved by the other properties
+  if (visiting.contains(meta))
+    return false;
+  visiting.insert(meta);
+
+  foreach (const PropertyInfo &info, propertyTable(meta)) {
+    if ((PropertyKind::ObjectList == info.kind) || (PropertyKind::Unresolved == info.kind))
+      return true;
+    if (PropertyKind::Item != info.kind)
+      continue;
+    const QMetaObject *declared = QMetaType(info.prop.userType()).metaObject();
+    if (nullptr == declared)
+      return true;
+    if (isInstanceOf(declared, QStringList(typeName)))
+      return true;
+    if (computeMayContain(declared, typeName, visiting))
+      return true;
+  }
+
+  return false;
+}
+
+ConfigItem::PropertyKind
+ConfigItem::propertyKind(const QMetaProperty &prop) const {
+  const QVector<PropertyInfo> &table = propertyTable(metaObject());
+  int idx = prop.propertyIndex() - QObject::staticMetaObject.propertyCount();
+  if ((0 <= idx) && (idx < table.size()) && (table[idx].prop.name() == prop.name()))
+    return propertyKind(table[idx]);
+  // Property of another class
+  return propertyKind(PropertyInfo{prop, classifyProperty(prop)});
+}
+
+ConfigItem::PropertyKind
+ConfigItem::propertyKind(const PropertyInfo &info) const {
+  if (PropertyKind::Unresolved != info.kind)
+    return info.kind;
+
+  // Type not known statically, check value
+  QVariant value = info.prop.read(this);
+  if (value.value<ConfigObjectReference *>())
+    return PropertyKind::Reference;
+  if (value.value<ConfigObjectRefList *>())
+    return PropertyKind::RefList;
+  if (value.value<ConfigObjectList *>())
+    return PropertyKind::ObjectList;
+  if (value.value<ConfigItem *>())
+    return PropertyKind::Item;
+  return PropertyKind::Other;
+}
+
+void *
+ConfigItem::operator new(std::size_t size) {
+  return ObjectArena::allocate(size);
+}
+
+void
+ConfigItem::operator delete(void *ptr) {
+  ObjectArena::release(ptr);
 }
 
 bool
@@ -147,53 +396,47 @@ ConfigItem::copy(const ConfigItem &other) {
   // clear this instance
   this->clear();
 
-  // Iterate over all properties
-  const QMetaObject *meta = metaObject();
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-    // This property
-    QMetaProperty prop = meta->property(p);
-    // the same property over at other
-    QMetaProperty oprop = other.metaObject()->property(p);
-
-    // Should never happen
-    if (! prop.isValid()) {
-      logWarn() << "Invalid property " << prop.name() << ". This should not happen.";
-      continue;
-    }
+  // Iterate over all properties, both items are of the same type and share the property table
+  foreach (const PropertyInfo &info, propertyTable(metaObject())) {
+    // This property, the same property over at other
+    const QMetaProperty &prop = info.prop, &oprop = info.prop;
+    PropertyKind kind = propertyKind(info);
 
     // true if the property is a basic type
-    bool isBasicType = ( prop.isEnumType() || (QVariant::Bool==prop.type()) ||
-                         (QVariant::Int==prop.type()) || (QVariant::UInt==prop.type()) ||
-                         (QVariant::Double==prop.type()) || (QVariant::String==prop.type()) ||
-                         (QString("Frequency")==prop.typeName()) ||
-                         (QString("Interval")==prop.typeName()) );
+    bool isBasicType = ( (PropertyKind::Enum == kind) || (PropertyKind::Bool == kind) ||
+                         (PropertyKind::Int == kind) || (PropertyKind::UInt == kind) ||
+                         (PropertyKind::Double == kind) || (PropertyKind::String == kind) ||
+                         (PropertyKind::Frequency == kind) || (PropertyKind::Interval == kind) );
 
     // If a basic type -> simply copy value
-    if (isBasicType && prop.isWritable() && (prop.type()==oprop.type())) {
+    if (isBasicType && prop.isWritable()) {
       if (! prop.write(this, oprop.read(&other))) {
         logError() << "Cannot set property '" << prop.name() << "' of "
                    << this->metaObject()->className() << ".";
         return false;
       }
-    } else if (ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>()) {
-      if (! ref->copy(oprop.read(&other).value<ConfigObjectReference*>())) {
+    } else if (PropertyKind::Reference == kind) {
+      ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>();
+      if (ref && (! ref->copy(oprop.read(&other).value<ConfigObjectReference*>()))) {
         logError() << "Cannot copy object reference '" << prop.name() << "' of "
                    << this->metaObject()->className() << ".";
         return false;
       }
-    } else if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>()) {
-      if (! lst->copy(*oprop.read(&other).value<ConfigObjectList*>())) {
+    } else if (PropertyKind::ObjectList == kind) {
+      ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>();
+      if (lst && (! lst->copy(*oprop.read(&other).value<ConfigObjectList*>()))) {
         logError() << "Cannot copy object list '" << prop.name() << "' of "
                    << this->metaObject()->className() << ".";
         return false;
       }
-    } else if (ConfigObjectRefList *lst = prop.read(this).value<ConfigObjectRefList *>()) {
-      if (! lst->copy(*oprop.read(&other).value<ConfigObjectRefList*>())) {
+    } else if (PropertyKind::RefList == kind) {
+      ConfigObjectRefList *lst = prop.read(this).value<ConfigObjectRefList *>();
+      if (lst && (! lst->copy(*oprop.read(&other).value<ConfigObjectRefList*>()))) {
         logError() << "Cannot copy reference list '" << prop.name() << "' of "
                    << this->metaObject()->className() << ".";
         return false;
       }
-    } else if (propIsInstance<ConfigItem>(prop)) {
+    } else if (PropertyKind::Item == kind) {
       // If the item is owned by this item
       if (prop.isWritable()) {
         // If the owned item is writeable -> clone if set in other
@@ -240,20 +483,14 @@ ConfigItem::compare(const ConfigItem &other) const {
   if (strcmp(other.metaObject()->className(), metaObject()->className()))
     return strcmp(metaObject()->className(), other.metaObject()->className());
 
-  // Compare by properties
-  const QMetaObject *meta = metaObject();
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-    // This property
-    QMetaProperty prop = meta->property(p);
-    // the same property over at other
-    QMetaProperty oprop = other.metaObject()->property(p);
-
-    // Should never happen
-    if (! prop.isValid())
-      continue;
+  // Compare by properties, both items are of the same type and share the property table
+  foreach (const PropertyInfo &info, propertyTable(metaObject())) {
+    // This property, the same property over at other
+    const QMetaProperty &prop = info.prop, &oprop = info.prop;
+    PropertyKind kind = propertyKind(info);
 
     // Handle comparison of basic types
-    if ((prop.isEnumType()) || (QVariant::Bool == prop.type()) || (QVariant::Int == prop.type()) || (QVariant::UInt == prop.type())) {
+    if ((PropertyKind::Enum == kind) || (PropertyKind::Bool == kind) || (PropertyKind::Int == kind) || (PropertyKind::UInt == kind)) {
       int a=prop.read(this).toInt(), b=oprop.read(&other).toInt();
       if (a<b)
         return -1;
@@ -262,7 +499,7 @@ ConfigItem::compare(const ConfigItem &other) const {
       continue;
     }
 
-    if (QVariant::Double == prop.type()) {
+    if (PropertyKind::Double == kind) {
       double a=prop.read(this).toDouble(), b=oprop.read(&other).toDouble();
       if (a<b)
         return -1;
@@ -271,14 +508,14 @@ ConfigItem::compare(const ConfigItem &other) const {
       continue;
     }
 
-    if (QVariant::String == prop.type()) {
+    if (PropertyKind::String == kind) {
       int cmp = QString::compare(prop.read(this).toString(), oprop.read(&other).toString());
       if (cmp)
         return cmp;
       continue;
     }
 
-    if (QString("Frequency") == prop.typeName()) {
+    if (PropertyKind::Frequency == kind) {
       Frequency a = prop.read(this).value<Frequency>(), b = oprop.read(&other).value<Frequency>();
       if (a<b)
         return -1;
@@ -287,7 +524,7 @@ ConfigItem::compare(const ConfigItem &other) const {
       continue;
     }
 
-    if (QString("Interval") == prop.typeName()) {
+    if (PropertyKind::Interval == kind) {
       Interval a = prop.read(this).value<Interval>(), b = oprop.read(&other).value<Interval>();
       if (a<b)
         return -1;
@@ -296,21 +533,27 @@ ConfigItem::compare(const ConfigItem &other) const {
       continue;
     }
 
-    if (ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>()) {
+    if (PropertyKind::Reference == kind) {
+      ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>();
+      if (nullptr == ref)
+        continue;
       int cmp = ref->compare(*oprop.read(&other).value<ConfigObjectReference*>());
       if (cmp)
         return cmp;
       continue;
     }
 
-    if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>()) {
+    if (PropertyKind::ObjectList == kind) {
+      ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>();
+      if (nullptr == lst)
+        continue;
       int cmp = lst->compare(*oprop.read(&other).value<ConfigObjectList*>());
       if (cmp)
         return cmp;
       continue;
     }
 
-    if (propIsInstance<ConfigObjectRefList>(prop)) {
+    if (PropertyKind::RefList == kind) {
       ConfigObjectRefList *lst = prop.read(this).value<ConfigObjectRefList *>();
       int cmp = lst->compare(*oprop.read(&other).value<ConfigObjectRefList*>());
       if (cmp)
@@ -318,7 +561,7 @@ ConfigItem::compare(const ConfigItem &other) const {
       continue;
     }
 
-    if (propIsInstance<ConfigItem>(prop)) {
+    if (PropertyKind::Item == kind) {
       // If the owned item is writeable -> clone if set in other
       if (prop.read(this).isNull() && !oprop.read(&other).isNull())
         return -1;
@@ -340,19 +583,15 @@ ConfigItem::compare(const ConfigItem &other) const {
 bool
 ConfigItem::label(ConfigObject::Context &context, const ErrorStack &err) {
   // Label properties owning config objects, that is of type ConfigObject or ConfigObjectList
-  const QMetaObject *meta = metaObject();
-
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
-    if (! prop.isValid())
-      continue;
-    if (prop.read(this).value<ConfigObjectList *>()) {
-      ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>();
-      if (! lst->label(context, err))
+  foreach (const PropertyInfo &info, propertyTable(metaObject())) {
+    PropertyKind kind = propertyKind(info);
+    if (PropertyKind::ObjectList == kind) {
+      ConfigObjectList *lst = info.prop.read(this).value<ConfigObjectList *>();
+      if (lst && (! lst->label(context, err)))
         return false;
-    } else if (prop.read(this).value<ConfigItem *>()) {
-      ConfigItem *obj = prop.read(this).value<ConfigItem *>();
-      if (! obj->label(context, err))
+    } else if (PropertyKind::Item == kind) {
+      ConfigItem *obj = info.prop.read(this).value<ConfigItem *>();
+      if (obj && (! obj->label(context, err)))
         return false;
     }
   }
@@ -374,17 +613,16 @@ ConfigItem::clear() {
   emit beginClear();
 
   // Delete or clear all object owned by properties, that is ConfigObjectList and ConfigObject
-  const QMetaObject *meta = metaObject();
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
-    if (! prop.isValid())
-      continue;
-    if (propIsInstance<ConfigItem>(prop) && prop.isWritable()) {
+  foreach (const PropertyInfo &info, propertyTable(metaObject())) {
+    const QMetaProperty &prop = info.prop;
+    PropertyKind kind = propertyKind(info);
+    if ((PropertyKind::Item == kind) && prop.isWritable()) {
       if (ConfigItem *item = prop.read(this).value<ConfigItem*>())
         item->deleteLater();
       prop.write(this, QVariant::fromValue<ConfigItem*>(nullptr));
-    } else if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>()) {
-      lst->clear();
+    } else if (PropertyKind::ObjectList == kind) {
+      if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>())
+        lst->clear();
     }
   }
 
@@ -394,50 +632,48 @@ ConfigItem::clear() {
 bool
 ConfigItem::populate(YAML::Node &node, const Context &context, const ErrorStack &err){
   // Serialize all properties
-  const QMetaObject *meta = metaObject();
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
-    if (! prop.isValid())
-      continue;
+  foreach (const PropertyInfo &info, propertyTable(metaObject())) {
+    const QMetaProperty &prop = info.prop;
     if (! prop.isScriptable()) {
       /*logDebug() << "Do not serialize property '"
                  << prop.name() << "': Marked as not scriptable.";*/
       continue;
     }
-    if (prop.isEnumType()) {
-      QMetaEnum e = prop.enumerator();
+    PropertyKind kind = propertyKind(info);
+    if (PropertyKind::Enum == kind) {
       QVariant value = prop.read(this);
-      const char *key = e.valueToKey(value.toInt());
+      const char *key = info.enums->valueToKey(value.toInt());
       if (nullptr == key) {
         errMsg(err) << "Cannot map value " << value.toUInt()
-                    << " to enum " << e.name()
+                    << " to enum " << info.enums->name()
                     << ". Ignore attribute '" << prop.name()
                     << "' but this points to an incompatibility in some codeplug. "
                     << "Consider reporting it to https://github.com/hmatuschek/qdmr/issues.";
         continue;
       }
       node[prop.name()] = key;
-    } else if (QString("bool") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).toBool();
-    } else if (QString("int") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).toInt();
-    } else if (QString("uint") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).toUInt();
-    } else if (QString("double") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).toDouble();
-    } else if (QString("QString") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).toString().toStdString();
-    } else if (QString("Frequency") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).value<Frequency>();
-    } else if (QString("Interval") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).value<Interval>();
-    } else if (ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>()) {
-      ConfigObject *obj = ref->as<ConfigObject>();
+    } else if (PropertyKind::Bool == kind) {
+      node[prop.name()] = prop.read(this).toBool();
+    } else if (PropertyKind::Int == kind) {
+      node[prop.name()] = prop.read(this).toInt();
+    } else if (PropertyKind::UInt == kind) {
+      node[prop.name()] = prop.read(this).toUInt();
+    } else if (PropertyKind::Double == kind) {
+      node[prop.name()] = prop.read(this).toDouble();
+    } else if (PropertyKind::String == kind) {
+      node[prop.name()] = prop.read(this).toString().toStdString();
+    } else if (PropertyKind::Frequency == kind) {
+      node[prop.name()] = prop.read(this).value<Frequency>();
+    } else if (PropertyKind::Interval == kind) {
+      node[prop.name()] = prop.read(this).value<Interval>();
+    } else if (PropertyKind::Reference == kind) {
+      ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>();
+      ConfigObject *obj = ref ? ref->as<ConfigObject>() : nullptr;
       if (nullptr == obj)
         continue;
-      if (context.hasTag(prop.enclosingMetaObject()->className(), prop.name(), obj)) {
+      if (context.hasTag(prop, obj)) {
         YAML::Node tag(YAML::NodeType::Scalar);
-        tag.SetTag(context.getTag(prop.enclosingMetaObject()->className(), prop.name(), obj).toStdString());
+        tag.SetTag(context.getTag(prop, obj).toStdString());
         node[prop.name()] = tag;
         continue;
       } else if (! context.contains(obj)) {
@@ -446,15 +682,18 @@ ConfigItem::populate(YAML::Node &node, const Context &context, const ErrorStack
         return false;
       }
       node[prop.name()] = context.getId(obj).toStdString();
-    } else if (ConfigObjectRefList *refs = prop.read(this).value<ConfigObjectRefList *>()) {
+    } else if (PropertyKind::RefList == kind) {
+      ConfigObjectRefList *refs = prop.read(this).value<ConfigObjectRefList *>();
+      if (nullptr == refs)
+        continue;
       //logDebug() << "Serialize obj ref list w/ " << refs->count() << " elements." ;
       YAML::Node list = YAML::Node(YAML::NodeType::Sequence);
       list.SetStyle(YAML::EmitterStyle::Flow);
       for (int i=0; i<refs->count(); i++) {
         ConfigObject *obj = refs->get(i);
-        if (context.hasTag(prop.enclosingMetaObject()->className(), prop.name(), obj)) {
+        if (context.hasTag(prop, obj)) {
           YAML::Node tag(YAML::NodeType::Scalar);
-          tag.SetTag(context.getTag(prop.enclosingMetaObject()->className(), prop.name(), obj).toStdString());
+          tag.SetTag(context.getTag(prop, obj).toStdString());
           //tag = tag.Tag().substr(1);
           list.push_back(tag);
           continue;
@@ -466,14 +705,15 @@ ConfigItem::populate(YAML::Node &node, const Context &context, const ErrorStack
         list.push_back(context.getId(obj).toStdString());
       }
       node[prop.name()] = list;
-    } else if (propIsInstance<ConfigItem>(prop)) {
+    } else if (PropertyKind::Item == kind) {
       ConfigItem *obj = prop.read(this).value<ConfigItem *>();
       // Serialize config objects in-place.
       if (obj)
         node[prop.name()] = obj->serialize(context);
-    } else if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>()) {
+    } else if (PropertyKind::ObjectList == kind) {
       // Serialize config object lists in-place.
-      node[prop.name()] = lst->serialize(context);
+      if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>())
+        node[prop.name()] = lst->serialize(context);
     } else {
       logDebug() << "Unhandled property " << prop.name()
                  << " of unknown type " << prop.typeName() << ".";
@@ -525,11 +765,8 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
   }
 
   const QMetaObject *meta = this->metaObject();
-  for (int p=QObject::staticMetaObject.propertyOffset(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
-
-    if (! prop.isValid())
-      continue;
+  foreach (const PropertyInfo &info, propertyTable(meta)) {
+    QMetaProperty prop = info.prop;
     // If marked as non-scriptable, skip that property.
     // It is handled separately or not at all.
     if (! prop.isScriptable())
@@ -538,125 +775,102 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
     /// @todo With Qt 5.15, we can use the REQUIRED flag to check for mandatory properties.
     /// However, Ubuntu 20.04 (Focal) comes with Qt 5.12.
 
-    if (prop.isEnumType()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+    PropertyKind kind = propertyKind(info);
+    // References & reference lists are linked later
+    if ((PropertyKind::Reference == kind) || (PropertyKind::RefList == kind))
+      continue;
+
+    // Look-up property once, a look-up within a map node is a linear search.
+    YAML::Node value = node[prop.name()];
+    // If property is not set -> skip
+    if (! value)
+      continue;
+
+    if (PropertyKind::Enum == kind) {
       // parse & check enum key
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected enum key.";
         return false;
       }
-      QMetaEnum e = prop.enumerator();
-      std::string key = node[prop.name()].as<std::string>();
-      bool ok=true; int value = e.keyToValue(key.c_str(), &ok);
+      const std::string &key = value.Scalar();
+      bool ok=true; int enumValue = info.enums->keyToValue(key, &ok);
       if (! ok) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Unknown key '" << key.c_str() << "' for enum '" << prop.name()
-                    << "'. Expected one of " << enumKeys(e).join(", ") << ".";
+                    << "'. Expected one of " << info.enums->keys().join(", ") << ".";
         return false;
       }
       // finally set property
-      prop.write(this, value);
-    } else if (QString("bool") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, enumValue);
+    } else if (PropertyKind::Bool == kind) {
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected boolean value.";
         return false;
       }
-      prop.write(this, node[prop.name()].as<bool>());
-    } else if (QString("int") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, value.as<bool>());
+    } else if (PropertyKind::Int == kind) {
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected integer value.";
         return false;
       }
-      prop.write(this, node[prop.name()].as<int>());
-    } else if (QString("uint") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, value.as<int>());
+    } else if (PropertyKind::UInt == kind) {
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected unsigned integer value.";
         return false;
       }
-      prop.write(this, node[prop.name()].as<unsigned>());
-    } else if (QString("double") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, value.as<unsigned>());
+    } else if (PropertyKind::Double == kind) {
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected floating point value.";
         return false;
       }
-      prop.write(this, node[prop.name()].as<double>());
-    } else if (QString("QString") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, value.as<double>());
+    } else if (PropertyKind::String == kind) {
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected string.";
         return false;
       }
-      prop.write(this, QString::fromStdString(node[prop.name()].as<std::string>()));
-    } else if (QString("Frequency") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, QString::fromStdString(value.Scalar()));
+    } else if (PropertyKind::Frequency == kind) {
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected frequency.";
         return false;
       }
-      Frequency f = node[prop.name()].as<Frequency>();
-      prop.write(this, QVariant::fromValue(f));
-    } else if (QString("Interval") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, QVariant::fromValue(value.as<Frequency>()));
+    } else if (PropertyKind::Interval == kind) {
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected interval.";
         return false;
       }
-      prop.write(this, QVariant::fromValue(node[prop.name()].as<Interval>()));
-    } else if (prop.read(this).value<ConfigObjectReference *>()) {
-      // references are linked later
-      continue;
-    } else if (prop.read(this).value<ConfigObjectRefList *>()) {
-      // reference lists are linked later
-      continue;
-    } else if (propIsInstance<ConfigItem>(prop)) {
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, QVariant::fromValue(value.as<Interval>()));
+    } else if (PropertyKind::Item == kind) {
       // check type
-      if (! node[prop.name()].IsMap()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsMap()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse '" << prop.name() << "' of '" << meta->className()
                     << "': Expected instance of '"
                     << QMetaType::metaObjectForType(prop.userType())->className() << "'.";
@@ -667,8 +881,8 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
 
       // If not set and writable -> allocate and set
       if ((nullptr == obj) && prop.isWritable()) {
-        if (nullptr == (obj = this->allocateChild(prop, node[prop.name()], ctx))) {
-          errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+        if (nullptr == (obj = this->allocateChild(prop, value, ctx))) {
+          errMsg(err) << value.Mark().line << ":" << value.Mark().column
                       << ": Cannot allocate " << prop.name() << " of " << meta->className() << ".";
           return false;
         }
@@ -683,20 +897,17 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
       }
 
       // parse instance
-      YAML::Node propNode = node[prop.name()];
-      if (obj && (! obj->parse(propNode, ctx))) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (obj && (! obj->parse(value, ctx))) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className() << ".";
         if (nullptr == obj->parent())
           obj->deleteLater();
         return false;
       }
-    } else if (prop.read(this).value<ConfigObjectList *>()) {
-      if (! node[prop.name()])
-        continue;
+    } else if ((PropertyKind::ObjectList == kind) && prop.read(this).value<ConfigObjectList *>()) {
       // check type
-      if (! node[prop.name()].IsSequence()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsSequence()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected instance of '"
                     << QMetaType::metaObjectForType(prop.userType())->className() << "'.";
@@ -706,8 +917,8 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
       ConfigObjectList *lst = prop.read(this).value<ConfigObjectList*>();
       // If not set and writable -> allocate and set
       if ((nullptr == lst) && prop.isWritable()) {
-        if (nullptr == (lst = this->allocateChild(prop, node[prop.name()], ctx)->as<ConfigObjectList>())) {
-          errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+        if (nullptr == (lst = this->allocateChild(prop, value, ctx)->as<ConfigObjectList>())) {
+          errMsg(err) << value.Mark().line << ":" << value.Mark().column
                       << ": Cannot allocate list " << prop.name() << " of " << meta->className() << ".";
           return false;
         }
@@ -723,7 +934,7 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
 
       // Allocate elements
       ConfigObject *obj = nullptr;
-      for (YAML::const_iterator it=node[prop.name()].begin(); it!=node[prop.name()].end(); it++) {
+      for (YAML::const_iterator it=value.begin(); it!=value.end(); it++) {
         // allocate element
         if (nullptr == (obj = lst->allocateChild(*it, ctx, err)->as<ConfigObject>())) {
           errMsg(err) << it->Mark().line << ":" << it->Mark().column
@@ -760,34 +971,41 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
 
   const QMetaObject *meta = this->metaObject();
 
-  for (int p=QObject::staticMetaObject.propertyOffset(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
-    if (! prop.isValid())
-      continue;
-
+  foreach (const PropertyInfo &info, propertyTable(meta)) {
+    const QMetaProperty &prop = info.prop;
     if (! prop.isScriptable()) {
       //logDebug() << "Do not link property '" << prop.name() << "': Marked as not scriptable.";
       continue;
     }
-    if ((prop.isEnumType()) || (QString("bool") == prop.typeName()) || (QString("int") == prop.typeName()) ||
-        (QString("uint") == prop.typeName()) || (QString("double") == prop.typeName()) || (QString("QString") == prop.typeName()) ) {
+
+    // Only references and owned items need to be linked
+    PropertyKind kind = propertyKind(info);
+    if ((PropertyKind::Reference != kind) && (PropertyKind::RefList != kind) &&
+        (PropertyKind::Item != kind) && (PropertyKind::ObjectList != kind)) {
       continue;
-    } else if (ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>()) {
-      // If not set -> skip
-      if (! node[prop.name()])
+    }
+
+    // If not set -> skip
+    YAML::Node value = node[prop.name()];
+    if (! value)
+      continue;
+
+    if (PropertyKind::Reference == kind) {
+      ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>();
+      if (nullptr == ref)
         continue;
       // check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className()
                     << ": Expected id.";
         return false;
       }
       // handle tags
-      QString tag = QString::fromStdString(node[prop.name()].Tag());
-      if ((!node[prop.name()].Scalar().size()) && (!tag.isEmpty())) {
-        if (! ref->set(ctx.getTag(prop.enclosingMetaObject()->className(), prop.name(), tag))) {
-          errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      QString tag = QString::fromStdString(value.Tag());
+      if ((!value.Scalar().size()) && (!tag.isEmpty())) {
+        if (! ref->set(ctx.getTag(prop, tag))) {
+          errMsg(err) << value.Mark().line << ":" << value.Mark().column
                       << ": Cannot link " << prop.name() << " of " << meta->className()
                       << ": Unknown tag " << tag << ".";
           return false;
@@ -795,14 +1013,14 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
         continue;
       }
       // set reference
-      QString id = QString::fromStdString(node[prop.name()].as<std::string>());
+      QString id = QString::fromStdString(value.Scalar());
       if (! ctx.contains(id)) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link reference to '" << id << "', element not defined.";
         return false;
       }
       if (! ref->set(ctx.getObj(id))) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className()
                     << ": Cannot set reference.";
         return false;
@@ -810,18 +1028,18 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
       /*logDebug() << "Linked reference " << prop.name() << "='" << id
                  << "' to " << ctx.getObj(id)->metaObject()->className()
                  << " '" << ctx.getObj(id)->name() << "'.";*/
-    } else if (ConfigObjectRefList *lst = prop.read(this).value<ConfigObjectRefList *>()) {
-      // If not set -> skip
-      if (! node[prop.name()])
+    } else if (PropertyKind::RefList == kind) {
+      ConfigObjectRefList *lst = prop.read(this).value<ConfigObjectRefList *>();
+      if (nullptr == lst)
         continue;
       // check type
-      if (! node[prop.name()].IsSequence()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsSequence()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className()
                     << ": Expected sequence.";
         return false;
       }
-      for (YAML::const_iterator it=node[prop.name()].begin(); it!=node[prop.name()].end(); it++) {
+      for (YAML::const_iterator it=value.begin(); it!=value.end(); it++) {
         if (! it->IsScalar()) {
           errMsg(err) << it->Mark().line << ":" << it->Mark().column
                       << ": Cannot link " << prop.name() << " of " << meta->className()
@@ -831,7 +1049,7 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
         // check for tags
         QString tag = QString::fromStdString(it->Tag());
         if ((!it->Scalar().size()) && (!tag.isEmpty())) {
-          if (0 > lst->add(ctx.getTag(prop.enclosingMetaObject()->className(), prop.name(), tag))) {
+          if (0 > lst->add(ctx.getTag(prop, tag))) {
             errMsg(err) << it->Mark().line << ":" << it->Mark().column
                         << ": Cannot link " << prop.name() << " of " << meta->className()
                         << ": Cannot add reference for tag '" << tag << "'.";
@@ -839,7 +1057,7 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
           }
           continue;
         }
-        QString id = QString::fromStdString(it->as<std::string>());
+        QString id = QString::fromStdString(it->Scalar());
         if (! ctx.contains(id)) {
           errMsg(err) << it->Mark().line << ":" << it->Mark().column
                       << ": Cannot link " << prop.name() << " of " << meta->className()
@@ -854,39 +1072,39 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
         }
       }
 
-    } else if (ConfigItem *obj = prop.read(this).value<ConfigItem *>()) {
-      // If not set -> skip
-      if (! node[prop.name()])
+    } else if (PropertyKind::Item == kind) {
+      ConfigItem *obj = prop.read(this).value<ConfigItem *>();
+      if (nullptr == obj)
         continue;
 
       // check type
-      if (! node[prop.name()].IsMap()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsMap()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className()
                     << ": Expected object.";
         return false;
       }
 
-      if (! obj->link(node[prop.name()], ctx, err)) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! obj->link(value, ctx, err)) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className() << ".";
         return false;
       }
-    } else if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>()) {
-      // If not set -> skip
-      if (! node[prop.name()])
+    } else if (PropertyKind::ObjectList == kind) {
+      ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>();
+      if (nullptr == lst)
         continue;
 
       // check type
-      if (! node[prop.name()].IsSequence()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsSequence()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className()
                     << ": Expected sequence.";
         return false;
       }
 
-      if (! lst->link(node[prop.name()], ctx, err)) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! lst->link(value, ctx, err)) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className() << ".";
         return false;
       }
@@ -896,6 +1114,122 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
   return true;
 }
 
+bool
+ConfigItem::isDirty() const {
+  return _dirty;
+}
+
+void
+ConfigItem::clearDirty() {
+  _dirty = false;
+}
+
+unsigned int
+ConfigItem::revision() const {
+  return _revision;
+}
+
+void
+ConfigItem::markDirty() {
+  _dirty = true;
+  _revision++;
+  invalidateHash();
+}
+
+quint64
+ConfigItem::hash() const {
+  unsigned int renames = renameCount();
+  if (_hashValid && (_hashRenames == renames))
+    return _hash;
+
+  // Hash by properties, like compare
+  quint64 hash = hashString(metaObject()->className());
+  foreach (const PropertyInfo &info, propertyTable(metaObject())) {
+    const QMetaProperty &prop = info.prop;
+    PropertyKind kind = propertyKind(info);
+
+    if ((PropertyKind::Enum == kind) || (PropertyKind::Bool == kind) || (PropertyKind::Int == kind) || (PropertyKind::UInt == kind)) {
+      hash = hashCombine(hash, quint64(prop.read(this).toInt()));
+    } else if (PropertyKind::Double == kind) {
+      // Equal values must give equal hashes, hence -0 == +0
+      double value = prop.read(this).toDouble() + 0.0;
+      quint64 bits; memcpy(&bits, &value, sizeof(bits));
+      hash = hashCombine(hash, bits);
+    } else if (PropertyKind::String == kind) {
+      hash = hashCombine(hash, hashString(prop.read(this).toString()));
+    } else if (PropertyKind::Frequency == kind) {
+      hash = hashCombine(hash, prop.read(this).value<Frequency>().inHz());
+    } else if (PropertyKind::Interval == kind) {
+      hash = hashCombine(hash, prop.read(this).value<Interval>().milliseconds());
+    } else if (PropertyKind::Reference == kind) {
+      ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>();
+      ConfigObject *obj = ref ? ref->as<ConfigObject>() : nullptr;
+      if (nullptr == obj)
+        hash = hashCombine(hash, 0);
+      else
+        hash = hashCombine(hashCombine(hash, hashString(obj->metaObject()->className())),
+                           hashString(obj->name()));
+    } else if ((PropertyKind::ObjectList == kind) || (PropertyKind::RefList == kind)) {
+      AbstractConfigObjectList *lst = prop.read(this).value<AbstractConfigObjectList *>();
+      hash = hashCombine(hash, lst ? lst->hash() : 0);
+    } else if (PropertyKind::Item == kind) {
+      ConfigItem *item = prop.read(this).value<ConfigItem *>();
+      hash = hashCombine(hash, item ? item->hash() : 0);
+    }
+  }
+
+  _hash = hash;
+  _hashValid = true;
+  _hashRenames = renames;
+  return _hash;
+}
+
+quint64
+ConfigItem::memorySize() const {
+  // The size of the derived class is unknown, hence the object is estimated by the base class
+  // and the private data of the QObject.
+  quint64 bytes = sizeof(ConfigObject) + QOBJECT_PRIVATE_SIZE;
+  foreach (const PropertyInfo &info, propertyTable(metaObject())) {
+    const QMetaProperty &prop = info.prop;
+    PropertyKind kind = propertyKind(info);
+
+    if (PropertyKind::String == kind) {
+      bytes += MemoryUsage::of(prop.read(this).toString());
+    } else if (PropertyKind::Reference == kind) {
+      ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>();
+      if (ref && (this == ref->parent()))
+        bytes += sizeof(ConfigObjectReference) + QOBJECT_PRIVATE_SIZE;
+    } else if ((PropertyKind::ObjectList == kind) || (PropertyKind::RefList == kind)) {
+      AbstractConfigObjectList *lst = prop.read(this).value<AbstractConfigObjectList *>();
+      if (lst && (this == lst->parent()))
+        bytes += lst->memorySize();
+    } else if (PropertyKind::Item == kind) {
+      // Only owned items (e.g., extensions) are counted, avoids counting shared items twice.
+      ConfigItem *item = prop.read(this).value<ConfigItem *>();
+      if (item && (this == item->parent()))
+        bytes += item->memorySize();
+    }
+  }
+  return bytes;
+}
+
+void
+ConfigItem::invalidateHash() {
+  // If the hash is invalid, the hashes of all owners are invalid too
+  if (! _hashValid)
+    return;
+  _hashValid = false;
+  if (ConfigItem *item = qobject_cast<ConfigItem *>(parent()))
+    item->invalidateHash();
+  else if (AbstractConfigObjectList *lst = qobject_cast<AbstractConfigObjectList *>(parent()))
+    lst->invalidateHash();
+}
+
+unsigned int
+ConfigItem::renameCount() {
+  return _renames.loadAcquire();
+}
+
 const Config *
 ConfigItem::config() const {
   if (nullptr == parent())
@@ -913,19 +1247,21 @@ ConfigItem::findItemsOfTypes(const QStringList &typeNames, QSet<ConfigItem *> &i
   const QMetaObject *meta = metaObject();
 
   // Visit all properties
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
-    if (! prop.isValid())
-      continue;
-    if (! prop.isReadable())
+  foreach (const PropertyInfo &info, propertyTable(meta)) {
+    if (! info.prop.isReadable())
       continue;
 
-    if (ConfigItem *obj = prop.read(this).value<ConfigItem *>()) {
-      if (isInstanceOf(obj, typeNames))
-        items.insert(obj);
-      obj->findItemsOfTypes(typeNames, items);
-    } else if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>()) {
-      lst->findItemsOfTypes(typeNames, items);
+    PropertyKind kind = propertyKind(info);
+    if (PropertyKind::Item == kind) {
+      if (ConfigItem *obj = info.prop.read(this).value<ConfigItem *>()) {
+        if (isInstanceOf(obj, typeNames))
+          items.insert(obj);
+        if (mayContainAny(obj->metaObject(), typeNames))
+          obj->findItemsOfTypes(typeNames, items);
+      }
+    } else if (PropertyKind::ObjectList == kind) {
+      if (ConfigObjectList *lst = info.prop.read(this).value<ConfigObjectList *>())
+        lst->findItemsOfTypes(typeNames, items);
     }
   }
 }
@@ -999,17 +1335,27 @@ ConfigItem::longDescription(const QMetaProperty &prop) const {
  * Implementation of ConfigObject
  * ********************************************************************************************* */
 ConfigObject::ConfigObject(QObject *parent)
-  : ConfigItem(parent), _name()
+  : ConfigItem(parent), _name(), _references(), _lists(), _tracked(true)
 {
   // pass...
 }
 
 ConfigObject::ConfigObject(const QString &name, QObject *parent)
-  : ConfigItem(parent), _name(name)
+  : ConfigItem(parent), _name(name), _references(), _lists(), _tracked(true)
 {
   // pass...
 }
 
+ConfigObject::~ConfigObject() {
+  // Detach first, the referrers must not unregister while being notified
+  QVector<ConfigObjectReference *> references; references.swap(_references);
+  foreach (ConfigObjectReference *ref, references)
+    ref->onReferenceDeleted(this);
+  QVector<AbstractConfigObjectList *> lists; lists.swap(_lists);
+  foreach (AbstractConfigObjectList *list, lists)
+    list->onElementDeleted(this);
+}
+
 const QString &
 ConfigObject::name() const {
   return _name;
@@ -1020,9 +1366,68 @@ ConfigObject::setName(const QString &name) {
   if (name.simplified().isEmpty() || (_name == name.simplified()))
     return;
   _name = name;
+  _renames.fetchAndAddOrdered(1);
   emit modified(this);
 }
 
+const QVector<ConfigObjectReference *> &
+ConfigObject::references() const {
+  return _references;
+}
+
+const QVector<AbstractConfigObjectList *> &
+ConfigObject::lists() const {
+  return _lists;
+}
+
+int
+ConfigObject::useCount() const {
+  int count = _references.size();
+  foreach (AbstractConfigObjectList *list, _lists) {
+    if (list != parent())
+      count++;
+  }
+  return count;
+}
+
+void
+ConfigObject::disableTracking() {
+  _tracked = false;
+  _references.clear();
+  _lists.clear();
+}
+
+void
+ConfigObject::attach(ConfigObjectReference *ref) {
+  if (_tracked)
+    _references.append(ref);
+}
+
+void
+ConfigObject::detach(ConfigObjectReference *ref) {
+  // The order does not matter, swap with the last one
+  int idx = _references.lastIndexOf(ref);
+  if (0 > idx)
+    return;
+  _references[idx] = _references.last();
+  _references.removeLast();
+}
+
+void
+ConfigObject::attach(AbstractConfigObjectList *list) {
+  if (_tracked)
+    _lists.append(list);
+}
+
+void
+ConfigObject::detach(AbstractConfigObjectList *list) {
+  int idx = _lists.lastIndexOf(list);
+  if (0 > idx)
+    return;
+  _lists[idx] = _lists.last();
+  _lists.removeLast();
+}
+
 QString
 ConfigObject::idPrefix() const {
   return findIdPrefix(this->metaObject());
@@ -1030,13 +1435,7 @@ ConfigObject::idPrefix() const {
 
 bool
 ConfigObject::label(ConfigObject::Context &context, const ErrorStack &err) {
-  unsigned n=1;
-  QString prefix = this->idPrefix();
-  QString id=QString("%1%2").arg(prefix).arg(n);
-  while (context.contains(id)) {
-    id=QString("%1%2").arg(prefix).arg(++n);
-  }
-
+  QString id = context.newId(this->idPrefix());
   if (! context.add(id, this)) {
     if (context.contains(this))
       errMsg(err) << "Object already in context with id '" << context.getId(this) << "'.";
@@ -1077,14 +1476,29 @@ ConfigObject::populate(YAML::Node &node, const Context &context, const ErrorStac
 
 QString
 ConfigObject::findIdPrefix(const QMetaObject *meta) {
-  for (int i=meta->classInfoOffset(); i<meta->classInfoCount(); i++) {
-    if (0 == strcmp("IdPrefix", meta->classInfo(i).name())) {
-      return meta->classInfo(i).value();
+  // Class infos are static, hence the prefix is resolved once per type.
+  static QReadWriteLock lock;
+  static QHash<const QMetaObject *, QString> prefixes;
+  {
+    QReadLocker locker(&lock);
+    auto cached = prefixes.constFind(meta);
+    if (prefixes.constEnd() != cached)
+      return cached.value();
+  }
+
+  QString prefix; bool found = false;
+  for (const QMetaObject *type=meta; type && (! found); type=type->superClass()) {
+    for (int i=type->classInfoOffset(); (i<type->classInfoCount()) && (! found); i++) {
+      if (0 == strcmp("IdPrefix", type->classInfo(i).name())) {
+        prefix = type->classInfo(i).value();
+        found = true;
+      }
     }
   }
-  if (meta->superClass())
-    return findIdPrefix(meta->superClass());
-  return "";
+
+  QWriteLocker locker(&lock);
+  prefixes.insert(meta, prefix);
+  return prefix;
 }
 
 
@@ -1102,13 +1516,23 @@ ConfigExtension::ConfigExtension(QObject *parent)
  * Implementation of AbstractConfigObjectList
  * ********************************************************************************************* */
 AbstractConfigObjectList::AbstractConfigObjectList(const QMetaObject &elementType, QObject *parent)
-  : QObject(parent), _elementTypes(), _items()
+  : QObject(parent), _elementTypes(), _items(), _index(), _indexValid(true), _bulkAdd(false),
+    _bulkModify(false), _nameIndex(), _indexedNames(), _nameIndexValid(false), _updateLevel(0),
+    _updatePending(false), _hash(0), _hashValid(false), _hashRenames(0), _frozen(false)
 {
   _elementTypes.append(elementType);
 }
 
+AbstractConfigObjectList::~AbstractConfigObjectList() {
+  foreach (ConfigObject *obj, _items)
+    untrack(obj);
+}
+
 AbstractConfigObjectList::AbstractConfigObjectList(const std::initializer_list<QMetaObject> &elementTypes, QObject *parent)
-  : QObject(parent), _elementTypes(elementTypes), _items()
+  : QObject(parent), _elementTypes(elementTypes), _items(), _index(), _indexValid(true),
+    _bulkAdd(false), _bulkModify(false), _nameIndex(), _indexedNames(), _nameIndexValid(false),
+    _updateLevel(0), _updatePending(false), _hash(0), _hashValid(false), _hashRenames(0),
+    _frozen(false)
 {
   // pass...
 }
@@ -1117,8 +1541,7 @@ bool
 AbstractConfigObjectList::copy(const AbstractConfigObjectList &other) {
   this->clear();
   _elementTypes = other._elementTypes;
-  foreach (ConfigObject *item, other._items)
-    add(item);
+  addMany(other._items);
   return true;
 }
 
@@ -1129,14 +1552,130 @@ AbstractConfigObjectList::count() const {
 
 int
 AbstractConfigObjectList::indexOf(ConfigObject *obj) const {
-  return _items.indexOf(obj);
+  if (! _indexValid) {
+    // Rebuild index, keep first occurrence for non-unique lists
+    _index.clear();
+    _index.reserve(_items.size());
+    for (int i=_items.size()-1; i>=0; i--)
+      _index.insert(_items[i], i);
+    _indexValid = true;
+  }
+  return _index.value(obj, -1);
+}
+
+void
+AbstractConfigObjectList::invalidateIndex() {
+  _indexValid = false;
+  _typeIndices.clear();
+  invalidateHash();
+}
+
+void
+AbstractConfigObjectList::appendToIndex(ConfigObject *obj, int idx) {
+  if (_indexValid && (! _index.contains(obj)))
+    _index.insert(obj, idx);
+  for (auto it=_typeIndices.begin(); it!=_typeIndices.end(); it++) {
+    if (! obj->inherits(it.key()->className()))
+      continue;
+    if (! it->positions.contains(obj))
+      it->positions.insert(obj, it->items.size());
+    it->items.append(obj);
+  }
+  invalidateHash();
+}
+
+void
+AbstractConfigObjectList::removeLastFromIndex(ConfigObject *obj, int idx) {
+  if (_indexValid && (idx == _index.value(obj, -1)))
+    _index.remove(obj);
+  // Compare pointers only, the object may already be destroyed
+  for (auto it=_typeIndices.begin(); it!=_typeIndices.end(); it++) {
+    if (it->items.isEmpty() || (obj != it->items.last()))
+      continue;
+    it->items.removeLast();
+    if (it->items.size() == it->positions.value(obj, -1))
+      it->positions.remove(obj);
+  }
+  invalidateHash();
+}
+
+const AbstractConfigObjectList::TypeIndex &
+AbstractConfigObjectList::typeIndex(const QMetaObject &type) const {
+  // Frozen lists may be accessed concurrently, indices of new types are built under a lock.
+  QMutexLocker locker(_frozen ? &_typeIndexLock : nullptr);
+  auto it = _typeIndices.find(&type);
+  if (it != _typeIndices.end())
+    return *it;
+
+  TypeIndex &index = _typeIndices[&type];
+  foreach (ConfigObject *obj, _items) {
+    if (! obj->inherits(type.className()))
+      continue;
+    if (! index.positions.contains(obj))
+      index.positions.insert(obj, index.items.size());
+    index.items.append(obj);
+  }
+  return index;
+}
+
+int
+AbstractConfigObjectList::countOfType(const QMetaObject &type) const {
+  return typeIndex(type).items.size();
+}
+
+ConfigObject *
+AbstractConfigObjectList::getOfType(const QMetaObject &type, int idx) const {
+  return typeIndex(type).items.value(idx, nullptr);
+}
+
+int
+AbstractConfigObjectList::indexOfType(const QMetaObject &type, ConfigObject *obj) const {
+  return typeIndex(type).positions.value(obj, -1);
+}
+
+void
+AbstractConfigObjectList::updateIndex(ConfigObject *obj) {
+  Q_UNUSED(obj);
+  // pass...
+}
+
+void
+AbstractConfigObjectList::invalidateNameIndex() {
+  _nameIndexValid = false;
+  _nameIndex.clear();
+  _indexedNames.clear();
+}
+
+void
+AbstractConfigObjectList::removeFromNameIndex(ConfigObject *obj) {
+  // Keep the entry, if the object is still in the list (non-unique lists)
+  if ((! _nameIndexValid) || (! _indexedNames.contains(obj)) || (0 <= indexOf(obj)))
+    return;
+  _nameIndex.remove(_indexedNames.take(obj), obj);
+}
+
+void
+AbstractConfigObjectList::track(ConfigObject *obj) {
+  obj->attach(this);
+}
+
+void
+AbstractConfigObjectList::untrack(ConfigObject *obj) {
+  obj->detach(this);
 }
 
 void
 AbstractConfigObjectList::clear() {
+  if (! checkMutable())
+    return;
+  invalidateNameIndex();
   for (int i=(count()-1); i>=0; i--) {
+    removeLastFromIndex(_items.back(), i);
+    untrack(_items.back());
+    disconnect(_items.back(), nullptr, this, nullptr);
     _items.pop_back();
-    emit elementRemoved(i);
+    if (! deferSignal())
+      emit elementRemoved(i);
   }
 }
 
@@ -1151,23 +1690,49 @@ AbstractConfigObjectList::config() const {
 
 void
 AbstractConfigObjectList::findItemsOfTypes(const QStringList &typeNames, QSet<ConfigItem *> &items) const {
+  // Elements are usually of few classes, skip those that cannot hold any of the types
+  const QMetaObject *last = nullptr;
+  bool descend = false;
   foreach (ConfigObject *obj, _items) {
     if (isInstanceOf(obj, typeNames))
       items.insert(obj);
-    obj->findItemsOfTypes(typeNames, items);
+    if (last != obj->metaObject()) {
+      last = obj->metaObject();
+      descend = ConfigItem::mayContainAny(last, typeNames);
+    }
+    if (descend)
+      obj->findItemsOfTypes(typeNames, items);
   }
 }
 
 QList<ConfigObject *>
 AbstractConfigObjectList::findItemsByName(const QString name) const {
-  QList<ConfigObject *> items;
-  foreach (ConfigObject *obj, _items) {
-    if (obj->name() == name)
-      items.append(obj);
+  if (! _nameIndexValid) {
+    foreach (ConfigObject *obj, _items) {
+      if (_indexedNames.contains(obj))
+        continue;
+      _indexedNames.insert(obj, obj->name());
+      _nameIndex.insert(obj->name(), obj);
+    }
+    _nameIndexValid = true;
   }
+
+  // Return matches in list order
+  QList<ConfigObject *> items = _nameIndex.values(name);
+  std::sort(items.begin(), items.end(), [this](ConfigObject *a, ConfigObject *b) {
+    return indexOf(a) < indexOf(b);
+  });
   return items;
 }
 
+ConfigObject *
+AbstractConfigObjectList::findItemByName(const QString &name) const {
+  QList<ConfigObject *> items = findItemsByName(name);
+  if (items.isEmpty())
+    return nullptr;
+  return items.first();
+}
+
 bool
 AbstractConfigObjectList::has(ConfigObject *obj) const {
   return 0 <= indexOf(obj);
@@ -1181,7 +1746,7 @@ AbstractConfigObjectList::get(int idx) const {
 int
 AbstractConfigObjectList::add(ConfigObject *obj, int row, bool unique) {
   // Ignore nullptr
-  if (nullptr == obj)
+  if ((nullptr == obj) || (! checkMutable()))
     return -1;
   // If already in list -> ignore
   if (unique && (0 <= indexOf(obj)))
@@ -1202,17 +1767,50 @@ AbstractConfigObjectList::add(ConfigObject *obj, int row, bool unique) {
     return -1;
   }
   _items.insert(row, obj);
+  if (row == (_items.size()-1))
+    appendToIndex(obj, row);
+  else
+    invalidateIndex();
+  if (_nameIndexValid && (! _indexedNames.contains(obj))) {
+    _indexedNames.insert(obj, obj->name());
+    _nameIndex.insert(obj->name(), obj);
+  }
   // Otherwise connect to object
-  connect(obj, SIGNAL(destroyed(QObject*)), this, SLOT(onElementDeleted(QObject*)));
+  track(obj);
   connect(obj, SIGNAL(modified(ConfigItem*)), this, SLOT(onElementModified(ConfigItem*)));
-  emit elementAdded(row);
+  if ((! _bulkAdd) && (! deferSignal()))
+    emit elementAdded(row);
   return row;
 }
 
+void
+AbstractConfigObjectList::reserve(int size) {
+  _items.reserve(size);
+  _index.reserve(size);
+}
+
+int
+AbstractConfigObjectList::addMany(const QVector<ConfigObject *> &objs, bool unique) {
+  if (! checkMutable())
+    return 0;
+  int first = count();
+  // Elements are added through add(), such that checks of derived lists apply.
+  _bulkAdd = true;
+  _index.reserve(first + objs.size());
+  foreach (ConfigObject *obj, objs)
+    add(obj, -1, unique);
+  _bulkAdd = false;
+
+  int added = count() - first;
+  if (added && (! deferSignal()))
+    emit elementsAdded(first, added);
+  return added;
+}
+
 int
 AbstractConfigObjectList::replace(ConfigObject *obj, int row, bool unique) {
   // Ignore nullptr
-  if (nullptr == obj)
+  if ((nullptr == obj) || (! checkMutable()))
     return -1;
   // Check index
   if (row >= count())
@@ -1240,14 +1838,19 @@ AbstractConfigObjectList::replace(ConfigObject *obj, int row, bool unique) {
   // Remove present element
   ConfigObject *oldobj = _items.at(row);
   _items.remove(row, 1);
-  emit elementRemoved(row);
+  invalidateIndex();
+  removeFromNameIndex(oldobj);
+  if (! deferSignal())
+    emit elementRemoved(row);
+  untrack(oldobj);
   disconnect(oldobj, nullptr, this, nullptr);
 
   _items.insert(row, obj);
   // connect to object
-  connect(obj, SIGNAL(destroyed(QObject*)), this, SLOT(onElementDeleted(QObject*)));
+  track(obj);
   connect(obj, SIGNAL(modified(ConfigItem*)), this, SLOT(onElementModified(ConfigItem*)));
-  emit elementAdded(row);
+  if (! deferSignal())
+    emit elementAdded(row);
 
   return row;
 }
@@ -1255,14 +1858,21 @@ AbstractConfigObjectList::replace(ConfigObject *obj, int row, bool unique) {
 bool
 AbstractConfigObjectList::take(ConfigObject *obj) {
   // Ignore nullptr
-  if (nullptr == obj)
+  if ((nullptr == obj) || (! checkMutable()))
     return false;
   int idx = indexOf(obj);
   if (0 > idx)
     return false;
+  if (idx == (_items.size()-1))
+    removeLastFromIndex(obj, idx);
+  else
+    invalidateIndex();
   _items.remove(idx, 1);
-  emit elementRemoved(idx);
+  removeFromNameIndex(obj);
+  if (! deferSignal())
+    emit elementRemoved(idx);
   // Otherwise disconnect from
+  untrack(obj);
   disconnect(obj, nullptr, this, nullptr);
   return true;
 }
@@ -1274,35 +1884,39 @@ AbstractConfigObjectList::del(ConfigObject *obj) {
 
 bool
 AbstractConfigObjectList::moveUp(int row) {
-  if ((row <= 0) || (row>=count()))
+  if ((row <= 0) || (row>=count()) || (! checkMutable()))
     return false;
   std::swap(_items[row-1], _items[row]);
+  invalidateIndex();
   return true;
 }
 
 bool
 AbstractConfigObjectList::moveUp(int first, int last) {
-  if ((first <= 0) || (last>=count()))
+  if ((first <= 0) || (last>=count()) || (! checkMutable()))
     return false;
   for (int row=first; row<=last; row++)
     std::swap(_items[row-1], _items[row]);
+  invalidateIndex();
   return true;
 }
 
 bool
 AbstractConfigObjectList::moveDown(int row) {
-  if ((row >= (count()-1)) || (0 > row))
+  if ((row >= (count()-1)) || (0 > row) || (! checkMutable()))
     return false;
   std::swap(_items[row+1], _items[row]);
+  invalidateIndex();
   return true;
 }
 
 bool
 AbstractConfigObjectList::moveDown(int first, int last) {
-  if ((last >= (count()-1)) || (0 > first))
+  if ((last >= (count()-1)) || (0 > first) || (! checkMutable()))
     return false;
   for (int row=last; row>=first; row--)
     std::swap(_items[row+1], _items[row]);
+  invalidateIndex();
   return true;
 }
 
@@ -1310,7 +1924,7 @@ bool
 AbstractConfigObjectList::move(int source, int count, int destination) {
   if ((0 == count) || (source == destination))
     return true;
-  if ((source+count)>_items.size())
+  if (((source+count)>_items.size()) || (! checkMutable()))
     return false;
   if (source > destination) {
     // move up
@@ -1321,9 +1935,77 @@ AbstractConfigObjectList::move(int source, int count, int destination) {
     for (int i=0; i<count; i++)
       _items.insert(destination-1, _items.takeAt(source));
   }
+  invalidateIndex();
   return true;
 }
 
+bool
+AbstractConfigObjectList::reorder(const QVector<ConfigObject *> &order) {
+  if ((order.size() != _items.size()) || (! checkMutable()))
+    return false;
+  // Check permutation, lists may contain elements several times
+  QHash<ConfigObject *, int> counts; counts.reserve(_items.size());
+  foreach (ConfigObject *obj, _items)
+    counts[obj]++;
+  foreach (ConfigObject *obj, order) {
+    if (0 >= counts.value(obj, 0))
+      return false;
+    counts[obj]--;
+  }
+  if (_items == order)
+    return true;
+  _items = order;
+  invalidateIndex();
+  if (! deferSignal())
+    emit elementsReset();
+  return true;
+}
+
+quint64
+AbstractConfigObjectList::hash() const {
+  unsigned int renames = ConfigItem::renameCount();
+  if (_hashValid && (_hashRenames == renames))
+    return _hash;
+
+  quint64 hash = hashCombine(0, _items.size());
+  foreach (ConfigObject *obj, _items)
+    hash = hashCombine(hash, obj->hash());
+
+  _hash = hash;
+  _hashValid = true;
+  _hashRenames = renames;
+  return _hash;
+}
+
+quint64
+AbstractConfigObjectList::memorySize() const {
+  quint64 bytes = sizeof(AbstractConfigObjectList) + QOBJECT_PRIVATE_SIZE
+      + MemoryUsage::of(_items) + MemoryUsage::of(_index) + MemoryUsage::of(_nameIndex)
+      + MemoryUsage::of(_indexedNames);
+  {
+    // Type indices may get built concurrently while frozen
+    QMutexLocker locker(&_typeIndexLock);
+    bytes += MemoryUsage::of(_typeIndices);
+    foreach (const TypeIndex &index, _typeIndices)
+      bytes += MemoryUsage::of(index.items) + MemoryUsage::of(index.positions);
+  }
+  foreach (ConfigObject *obj, _items) {
+    if (this == obj->parent())
+      bytes += obj->memorySize();
+  }
+  return bytes;
+}
+
+void
+AbstractConfigObjectList::invalidateHash() {
+  // If the hash is invalid, the hashes of all owners are invalid too
+  if (! _hashValid)
+    return;
+  _hashValid = false;
+  if (ConfigItem *item = qobject_cast<ConfigItem *>(parent()))
+    item->invalidateHash();
+}
+
 const QList<QMetaObject> &
 AbstractConfigObjectList::elementTypes() const {
   return _elementTypes;
@@ -1338,21 +2020,100 @@ AbstractConfigObjectList::classNames() const {
   return cls;
 }
 
+void
+AbstractConfigObjectList::beginUpdate() {
+  _updateLevel++;
+}
+
+void
+AbstractConfigObjectList::endUpdate() {
+  if (0 == _updateLevel)
+    return;
+  if ((0 == --_updateLevel) && _updatePending) {
+    _updatePending = false;
+    emit elementsReset();
+  }
+}
+
+bool
+AbstractConfigObjectList::isUpdating() const {
+  return 0 != _updateLevel;
+}
+
+void
+AbstractConfigObjectList::freeze() {
+  // Build all lazily built indices
+  indexOf(nullptr);
+  findItemsByName(QString());
+  foreach (const QMetaObject &type, _elementTypes)
+    typeIndex(type);
+  hash();
+  _frozen = true;
+}
+
+void
+AbstractConfigObjectList::thaw() {
+  _frozen = false;
+}
+
+bool
+AbstractConfigObjectList::isFrozen() const {
+  return _frozen;
+}
+
+bool
+AbstractConfigObjectList::checkMutable() const {
+  if (! _frozen)
+    return true;
+  logError() << "Cannot modify frozen list of " << classNames().join(", ") << ".";
+  return false;
+}
+
+bool
+AbstractConfigObjectList::deferSignal() {
+  if (0 == _updateLevel)
+    return false;
+  _updatePending = true;
+  return true;
+}
+
 void
 AbstractConfigObjectList::onElementModified(ConfigItem *obj) {
+  invalidateHash();
+  // Update name index, if element got renamed
+  ConfigObject *cobj = obj->as<ConfigObject>();
+  if (_nameIndexValid && cobj && _indexedNames.contains(cobj)
+      && (_indexedNames[cobj] != cobj->name())) {
+    _nameIndex.remove(_indexedNames[cobj], cobj);
+    _indexedNames[cobj] = cobj->name();
+    _nameIndex.insert(cobj->name(), cobj);
+  }
+  if (cobj)
+    updateIndex(cobj);
+  // Reported once by applyToAll()
+  if (_bulkModify)
+    return;
+
   int idx = indexOf(obj->as<ConfigObject>());
-  if (0 >= idx)
+  if ((0 >= idx) && (! deferSignal()))
     emit elementModified(idx);
 }
 
 void
 AbstractConfigObjectList::onElementDeleted(QObject *obj) {
-  // Use reinterpret cast here as the obj may already be destroyed and this all RTTI freed.
-  // We just use the pointer address to remove the element here.
+  // Called by the destructor of the element, which already dropped this list. Use reinterpret
+  // cast here as the derived parts of obj are already destroyed and thus all RTTI freed. We just
+  // use the pointer address to remove the element here.
   int idx = indexOf(reinterpret_cast<ConfigObject *>(obj));
   if (0 <= idx) {
+    if (idx == (_items.size()-1))
+      removeLastFromIndex(reinterpret_cast<ConfigObject *>(obj), idx);
+    else
+      invalidateIndex();
     _items.remove(idx);
-    emit elementRemoved(idx);
+    removeFromNameIndex(reinterpret_cast<ConfigObject *>(obj));
+    if (! deferSignal())
+      emit elementRemoved(idx);
   }
 }
 
@@ -1477,8 +2238,47 @@ ConfigObjectList::del(ConfigObject *obj) {
   return true;
 }
 
+int
+ConfigObjectList::applyToAll(const QVector<int> &rows, const char *property, const QVariant &value,
+                             const ErrorStack &err)
+{
+  if (! checkMutable()) {
+    errMsg(err) << "Cannot modify frozen list.";
+    return -1;
+  }
+
+  int first = -1, last = -1, count = 0;
+  bool success = true;
+  _bulkModify = true;
+  foreach (int row, rows) {
+    ConfigObject *obj = get(row);
+    if (nullptr == obj)
+      continue;
+    int idx = obj->metaObject()->indexOfProperty(property);
+    if (0 > idx)
+      continue;
+    QMetaProperty prop = obj->metaObject()->property(idx);
+    if ((! prop.isWritable()) || (! prop.write(obj, value))) {
+      errMsg(err) << "Cannot set property '" << property << "' of "
+                  << obj->metaObject()->className() << " '" << obj->name() << "'.";
+      success = false;
+      break;
+    }
+    first = ((0 > first) || (row < first)) ? row : first;
+    last = std::max(last, row);
+    count++;
+  }
+  _bulkModify = false;
+
+  if (count && (! deferSignal()))
+    emit elementsModified(first, last-first+1);
+  return success ? count : -1;
+}
+
 void
 ConfigObjectList::clear() {
+  if (! checkMutable())
+    return;
   QVector<ConfigObject *> items = _items;
   AbstractConfigObjectList::clear();
   for (int i=0; i<items.count(); i++)
@@ -1489,8 +2289,10 @@ bool
 ConfigObjectList::copy(const AbstractConfigObjectList &other) {
   clear();
   _elementTypes = other.elementTypes();
+  QVector<ConfigObject *> clones; clones.reserve(other.count());
   for (int i=0; i<other.count(); i++)
-    add(other.get(i)->clone()->as<ConfigObject>());
+    clones.append(other.get(i)->clone()->as<ConfigObject>());
+  addMany(clones);
   return true;
 }
 
@@ -1554,3 +2356,30 @@ ConfigObjectRefList::compare(const ConfigObjectRefList &other) const {
   return 0;
 }
 
+quint64
+ConfigObjectRefList::hash() const {
+  unsigned int renames = ConfigItem::renameCount();
+  if (_hashValid && (_hashRenames == renames))
+    return _hash;
+
+  quint64 hash = hashCombine(0, _items.size());
+  foreach (ConfigObject *obj, _items)
+    hash = hashCombine(hashCombine(hash, hashString(obj->metaObject()->className())),
+                       hashString(obj->name()));
+
+  _hash = hash;
+  _hashValid = true;
+  _hashRenames = renames;
+  return _hash;
+}
+
+int
+ConfigObjectRefList::moveAll(ConfigObjectRefList *dest) {
+  if ((nullptr == dest) || (this == dest) || _items.isEmpty())
+    return 0;
+  QVector<ConfigObject *> items = _items;
+  beginUpdate();
+  clear();
+  endUpdate();
+  return dest->addMany(items);
+}
@@ -6,6 +6,8 @@
 #include <QHash>
 #include <QVector>
 #include <QMetaProperty>
+#include <QAtomicInt>
+#include <QMutex>
 
 #include <yaml-cpp/yaml.h>
 
@@ -15,6 +17,9 @@
 class Config;
 class ConfigObject;
 class ConfigExtension;
+class EnumTable;
+class ConfigObjectReference;
+class AbstractConfigObjectList;
 
 /** Helper function to test property type. */
 template <class T>
@@ -69,6 +74,12 @@ public:
 
     /** Associates the given object with the given ID. */
     virtual bool add(const QString &id, ConfigObject *);
+    /** Returns the next unused ID with the given prefix, e.g., "ch3". A counter is kept per
+     * prefix, hence labeling N objects with the same prefix takes linear time. IDs added
+     * explicitly (e.g., while parsing) are skipped. */
+    QString newId(const QString &prefix);
+    /** Reserves space for the given number of objects. */
+    void reserve(int size);
 
     /** Returns @c true if the property of the class has the specified tag associated. */
     static bool hasTag(const QString &className, const QString &property, const QString &tag);
@@ -81,6 +92,21 @@ public:
     /** Associates the given object with the tag for the property of the given class. */
     static void setTag(const QString &className, const QString &property, const QString &tag, ConfigObject *obj);
 
+    /** Returns @c true if the given property has the specified object as a tag associated.
+     * Unlike the variant taking the class and property names, the look-up is cached per
+     * property. */
+    static bool hasTag(const QMetaProperty &prop, ConfigObject *obj);
+    /** Returns the object associated with the tag for the given property. */
+    static ConfigObject *getTag(const QMetaProperty &prop, const QString &tag);
+    /** Returns the tag associated with the object for the given property. */
+    static QString getTag(const QMetaProperty &prop, ConfigObject *obj);
+
+  protected:
+    /** Returns the index of the tag tables for the given class and property name or -1. */
+    static int tagIndex(const QString &className, const QString &property);
+    /** Returns the index of the tag tables for the given property or -1. */
+    static int tagIndex(const QMetaProperty &prop);
+
   protected:
     /** The version string. */
     QString _version;
@@ -88,10 +114,17 @@ public:
     QHash<QString, ConfigObject *> _objects;
     /** OBJ->ID look-up table. */
     QHash<ConfigObject*, QString> _ids;
+    /** Next candidate number for each ID prefix, see @c newId. */
+    QHash<QString, unsigned> _nextIds;
+    /** Maps qualified property names to the index of the tag tables. */
+    static QHash<QString, int> _tagIndices;
+    /** Caches the tag table index for properties, identified by the enclosing meta object and
+     * property index. */
+    static QHash<QPair<const QMetaObject *, int>, int> _propertyTagIndices;
     /** Maps tags to singleton objects. */
-    static QHash<QString, QHash<QString, ConfigObject *>> _tagObjects;
+    static QVector<QHash<QString, ConfigObject *>> _tagObjects;
     /** Maps singleton objects to tags. */
-    static QHash<QString, QHash<ConfigObject *, QString>> _tagNames;
+    static QVector<QHash<ConfigObject *, QString>> _tagNames;
   };
 
 protected:
@@ -100,6 +133,11 @@ protected:
   explicit ConfigItem(QObject *parent = nullptr);
 
 public:
+  /** Allocates config items from the @c ObjectArena, if a scope is active. */
+  static void *operator new(std::size_t size);
+  /** Releases config items allocated by @c operator new. */
+  static void operator delete(void *ptr);
+
   /** Copies the given item into this one.
    * @returns @c true if copying was successful and false otherwise. The two items must be of the
    *          same type (obviously). */
@@ -137,6 +175,31 @@ public:
   /** Clears the config object. */
   virtual void clear();
 
+  /** Returns @c true if the item (or any of its owned items, e.g., extensions) was modified
+   * since the last call to @c clearDirty. New items are dirty. */
+  bool isDirty() const;
+  /** Marks the item as clean, e.g., once it has been encoded. */
+  void clearDirty();
+  /** Returns a counter, that gets incremented whenever the item is marked dirty. In contrast to
+   * the dirty flag, the revision is never reset. Hence, it can be used by several independent
+   * caches. */
+  unsigned int revision() const;
+
+  /** Returns a 64-bit structural hash of the item, its properties and all owned items. Items
+   * comparing equal (see @c compare) have equal hashes. References are hashed by the type and
+   * name of the referenced object. The hash is memoized until the item or any owned item gets
+   * modified. It is only meaningful within the running process. */
+  quint64 hash() const;
+  /** Invalidates the memoized hash of this item and of all items and lists owning it. */
+  void invalidateHash();
+  /** Returns a counter, that gets incremented whenever any config object gets renamed. As
+   * references are hashed by name, memoized hashes are only valid for the same count. */
+  static unsigned int renameCount();
+
+  /** Returns an estimate of the heap memory in bytes held by the item, its properties and all
+   * owned items and lists. Referenced objects are not included. */
+  quint64 memorySize() const;
+
   /** Returns the config, the item belongs to or @c nullptr if not part of a config. */
   virtual const Config *config() const;
   /** Searches the config tree to find all instances of the given type names. */
@@ -177,11 +240,75 @@ public:
   /** Returns the long description of property if set by a class info. */
   QString longDescription(const QMetaProperty &prop) const;
 
+public:
+  /** Possible kinds of properties, handled by the generic methods like @c copy or @c parse. */
+  enum class PropertyKind {
+    Enum, Bool, Int, UInt, Double, String, Frequency, Interval,
+    Reference, RefList, ObjectList, Item,
+    Unresolved,   ///< Pointer to a type unknown to the meta type system, see @c propertyKind.
+    Other
+  };
+
+  /** Describes a property of a config item class. */
+  struct PropertyInfo {
+    /** The property, also used to access its value. */
+    QMetaProperty prop;
+    /** The kind of the property. */
+    PropertyKind kind;
+    /** The key/value tables of enum properties, @c nullptr otherwise. */
+    const EnumTable *enums;
+  };
+
+  /** Returns the descriptors of all properties of the given class (except for those of QObject),
+   * in the order of their index. The table gets computed once per class and is shared by all
+   * instances. */
+  static const QVector<PropertyInfo> &propertyTable(const QMetaObject *meta);
+  /** Returns the kind of the given property. Unresolved pointer properties are classified by
+   * their current value. */
+  PropertyKind propertyKind(const PropertyInfo &info) const;
+  /** Returns the kind of the given property of this item. */
+  PropertyKind propertyKind(const QMetaProperty &prop) const;
+
+  /** Returns @c true if an instance of the given class may hold an instance of the given type
+   * within its items, recursively. Items are expected to be instances of the declared type of
+   * their property, object lists and unresolved properties may hold anything. The result gets
+   * computed once per class and type, such that traversals can skip subtrees cheaply. */
+  static bool mayContain(const QMetaObject *meta, const QString &typeName);
+  /** Returns @c true if an instance of the given class may hold an instance of any of the given
+   * types, see @c mayContain. */
+  static bool mayContainAny(const QMetaObject *meta, const QStringList &typeNames);
+
+private:
+  /** Determines the kind of the given property from its type. */
+  static PropertyKind classifyProperty(const QMetaProperty &prop);
+  /** Computes @c mayContain, skipping the classes already being visited. */
+  static bool computeMayContain(const QMetaObject *meta, const QString &typeName,
+                                QSet<const QMetaObject *> &visiting);
+
 protected:
   /** Recursively serializes the configuration to YAML nodes.
    * The complete configuration must be labeled first. */
   virtual bool populate(YAML::Node &node, const Context &context, const ErrorStack &err=ErrorStack());
 
+protected slots:
+  /** Marks the item as dirty. Derived classes may connect changes, that are not signaled
+   * through @c modified (e.g., of owned reference lists), to this slot. */
+  void markDirty();
+
+protected:
+  /** If @c true, the item was modified since the last call to @c clearDirty. */
+  bool _dirty;
+  /** Counts the modifications of the item. */
+  unsigned int _revision;
+  /** The memoized hash, see @c hash. */
+  mutable quint64 _hash;
+  /** If @c true, the memoized hash is valid for the rename count @c _hashRenames. */
+  mutable bool _hashValid;
+  /** The rename count, the memoized hash was computed at. */
+  mutable unsigned int _hashRenames;
+  /** Counts the renames of all config objects, see @c renameCount. */
+  static QAtomicInt _renames;
+
 signals:
   /** Gets emitted once the config object is modified.
    * The instance passed is the modified item, this event is passed up the config tree. */
@@ -216,11 +343,23 @@ protected:
   ConfigObject(const QString &name, QObject *parent = nullptr);
 
 public:
+  /** Destructor, clears all references to this object and removes it from all lists. */
+  virtual ~ConfigObject();
+
   /** Returns the name of the object. */
   virtual const QString &name() const;
   /** Sets the name of the object. */
   virtual void setName(const QString &name);
 
+  /** Returns all references to this object. */
+  const QVector<ConfigObjectReference *> &references() const;
+  /** Returns all lists containing this object. Lists containing the object several times are
+   * included as often. */
+  const QVector<AbstractConfigObjectList *> &lists() const;
+  /** Returns the number of references and reference lists using this object. The list owning
+   * the object is not counted. */
+  int useCount() const;
+
 public:
   /** Returns the ID prefix for this object. */
   QString idPrefix() const;
@@ -230,12 +369,35 @@ public:
 protected:
   virtual bool populate(YAML::Node &node, const Context &context, const ErrorStack &err=ErrorStack());
 
-  /** Helper to find the @c IdPrefix class info in the class hierarchy. */
+  /** Helper to find the @c IdPrefix class info in the class hierarchy. The result is cached
+   * per meta object. */
   static QString findIdPrefix(const QMetaObject* meta);
 
+  /** Disables tracking of references and lists. Only used by singletons, that are never
+   * deleted and may be referenced from several threads. */
+  void disableTracking();
+  /** Registers a reference to this object. */
+  void attach(ConfigObjectReference *ref);
+  /** Unregisters a reference to this object. */
+  void detach(ConfigObjectReference *ref);
+  /** Registers a list containing this object. */
+  void attach(AbstractConfigObjectList *list);
+  /** Unregisters a list containing this object. */
+  void detach(AbstractConfigObjectList *list);
+
 protected:
   /** Holds the name of the object. */
   QString _name;
+  /** The references to this object. When the object gets deleted, these are cleared directly,
+   * hence references do not need to connect to the @c destroyed signal. */
+  QVector<ConfigObjectReference *> _references;
+  /** The lists containing this object, the object gets removed from when deleted. */
+  QVector<AbstractConfigObjectList *> _lists;
+  /** If @c false, neither references nor lists are tracked. */
+  bool _tracked;
+
+  friend class ConfigObjectReference;
+  friend class AbstractConfigObjectList;
 };
 
 
@@ -265,6 +427,9 @@ protected:
   AbstractConfigObjectList(const std::initializer_list<QMetaObject> &elementTypes, QObject *parent=nullptr);
 
 public:
+  /** Destructor, unregisters the list from its elements. */
+  virtual ~AbstractConfigObjectList();
+
   /** Copies all elements from @c other to this list. */
   virtual bool copy(const AbstractConfigObjectList &other);
 
@@ -287,13 +452,31 @@ public:
   virtual void findItemsOfTypes(const QStringList &typeNames, QSet<ConfigItem*> &items) const;
   /** Searches the list for objects with the given name. */
   virtual QList<ConfigObject *> findItemsByName(const QString name) const;
+  /** Returns the first object with the given name or @c nullptr if there is none. */
+  ConfigObject *findItemByName(const QString &name) const;
 
   /** Returns @c true, if the list contains the given object. */
   virtual bool has(ConfigObject *obj) const;
   /** Returns the list element at the given index or @c nullptr if out of bounds. */
   virtual ConfigObject *get(int idx) const;
+  /** Returns the number of elements of the given type (including derived types). The typed
+   * index is built on the first query for a type and maintained when elements get appended or
+   * the last one gets removed. */
+  int countOfType(const QMetaObject &type) const;
+  /** Returns the element at index @c idx among all elements of the given type or @c nullptr if
+   * out of bounds. */
+  ConfigObject *getOfType(const QMetaObject &type, int idx) const;
+  /** Returns the index of the given object among all elements of the given type or -1 if the
+   * object is not an element of that type. */
+  int indexOfType(const QMetaObject &type, ConfigObject *obj) const;
   /** Adds an element to the list. */
   virtual int add(ConfigObject *obj, int row=-1, bool unique=true);
+  /** Reserves space for the given total number of elements. */
+  void reserve(int size);
+  /** Appends all given elements to the list. Instead of an @c elementAdded signal for every
+   * element, a single @c elementsAdded signal is emitted.
+   * @returns The number of elements added. */
+  int addMany(const QVector<ConfigObject *> &objs, bool unique=true);
   /** Replaces an element in the list. */
   virtual int replace(ConfigObject *obj, int row, bool unique=true);
   /** Removes an element from the list. */
@@ -313,19 +496,62 @@ public:
    * The destination index is given before the movement. That is, if elements 0 & 1 are moved to
    * indices 1 & 2, call @c move(0,2, 2) */
   virtual bool move(int source, int count, int destination);
+  /** Reorders the list according to the given order, which must be a permutation of the
+   * elements of the list. Instead of a signal for every moved element, a single
+   * @c elementsReset signal is emitted.
+   * @returns @c false if @c order is not a permutation of the list. */
+  bool reorder(const QVector<ConfigObject *> &order);
+
+  /** Returns a 64-bit structural hash of the list, combining the hashes of all elements in
+   * order. The hash is memoized until the list or any owned element gets modified, see
+   * @c ConfigItem::hash. */
+  virtual quint64 hash() const;
+  /** Invalidates the memoized hash of this list and of all items owning it. */
+  void invalidateHash();
+
+  /** Returns an estimate of the heap memory in bytes held by the list, its indices and all
+   * owned elements. Elements only referenced by the list are not included. */
+  quint64 memorySize() const;
 
   /** Returns the element type for this list. */
   const QList<QMetaObject> &elementTypes() const;
   /** Returns a list of all class names. */
   QStringList classNames() const;
 
+  /** Starts a bulk update of the list. Until the matching @c endUpdate call, no
+   * @c elementAdded, @c elementsAdded, @c elementModified or @c elementRemoved signals are
+   * emitted. Calls may be nested. */
+  void beginUpdate();
+  /** Ends a bulk update of the list. If the list was changed during the update, a single
+   * @c elementsReset signal is emitted once the outermost update ends. */
+  void endUpdate();
+  /** Returns @c true, if the list is within a bulk update. */
+  bool isUpdating() const;
+
+  /** Freezes the list, see @c Config::freeze. All lazily built indices get built first, such
+   * that the const methods do not modify the list anymore. Derived lists maintaining further
+   * indices build them here too. A frozen list cannot be modified. */
+  virtual void freeze();
+  /** Unfreezes the list. */
+  void thaw();
+  /** Returns @c true, if the list is frozen. */
+  bool isFrozen() const;
+
 signals:
   /** Gets emitted if an element was added to the list. */
   void elementAdded(int idx);
+  /** Gets emitted if several elements were appended at once, see @c addMany. */
+  void elementsAdded(int first, int count);
   /** Gets emitted if one of the lists elements gets modified. */
   void elementModified(int idx);
+  /** Gets emitted if several elements were modified at once, see
+   * @c ConfigObjectList::applyToAll. The range may include unmodified elements. */
+  void elementsModified(int first, int count);
   /** Gets emitted if one of the lists elements gets deleted. */
   void elementRemoved(int idx);
+  /** Gets emitted at the end of a bulk update, if the list was changed. Listeners must assume
+   * that the entire list has changed, see @c beginUpdate. */
+  void elementsReset();
 
 private slots:
   /** Internal used callback to handle modified elements. */
@@ -333,11 +559,81 @@ private slots:
   /** Internal used callback to handle deleted elements. */
   void onElementDeleted(QObject *obj);
 
+protected:
+  /** Must be called whenever elements get inserted, removed or moved at positions other than
+   * the end of the list. Derived lists maintaining further indices invalidate them here too. */
+  virtual void invalidateIndex();
+  /** Updates the index after appending an element. */
+  virtual void appendToIndex(ConfigObject *obj, int idx);
+  /** Updates the index after removing the last element. */
+  virtual void removeLastFromIndex(ConfigObject *obj, int idx);
+  /** Gets called whenever an element of the list was modified. Derived lists maintaining
+   * indices by properties other than the name (e.g., numbers) update them here. The default
+   * implementation does nothing. */
+  virtual void updateIndex(ConfigObject *obj);
+  /** Invalidates the name index, it gets rebuilt on the next search by name. */
+  void invalidateNameIndex();
+  /** Updates the name index after removing an element. */
+  void removeFromNameIndex(ConfigObject *obj);
+  /** Returns @c true, if element signals must not be emitted as the list is within a bulk
+   * update. The change is then reported by @c elementsReset at the end of the update. */
+  bool deferSignal();
+  /** Returns @c false and logs an error, if the list is frozen and thus must not be modified. */
+  bool checkMutable() const;
+  /** Starts tracking the given element, see @c ConfigObject::lists. */
+  void track(ConfigObject *obj);
+  /** Stops tracking the given element. */
+  void untrack(ConfigObject *obj);
+
+  /** Index of the elements of a single type, see @c countOfType. */
+  struct TypeIndex {
+    /** The elements of the type in list order. */
+    QVector<ConfigObject *> items;
+    /** Maps elements to their (first) position within @c items. */
+    QHash<ConfigObject *, int> positions;
+  };
+  /** Returns the index of the given type, builds it if needed. */
+  const TypeIndex &typeIndex(const QMetaObject &type) const;
+
 protected:
   /** Holds the static QMetaObject of the element type. */
   QList<QMetaObject> _elementTypes;
   /** Holds the list items. */
   QVector<ConfigObject *> _items;
+  /** Maps elements to their (first) position in the list, rebuilt lazily by @c indexOf. */
+  mutable QHash<ConfigObject *, int> _index;
+  /** If @c false, the index must be rebuilt. */
+  mutable bool _indexValid;
+  /** If @c true, @c add does not emit @c elementAdded, see @c addMany. */
+  bool _bulkAdd;
+  /** If @c true, modified elements do not emit @c elementModified, see
+   * @c ConfigObjectList::applyToAll. */
+  bool _bulkModify;
+  /** Maps names to elements, built lazily by @c findItemsByName. */
+  mutable QMultiHash<QString, ConfigObject *> _nameIndex;
+  /** The names, the elements are indexed with. Used to detect renamed elements. */
+  mutable QHash<ConfigObject *, QString> _indexedNames;
+  /** If @c false, the name index must be rebuilt. */
+  mutable bool _nameIndexValid;
+  /** Nesting level of bulk updates, see @c beginUpdate. */
+  unsigned int _updateLevel;
+  /** If @c true, the list was changed during the current bulk update. */
+  bool _updatePending;
+  /** The memoized hash, see @c hash. */
+  mutable quint64 _hash;
+  /** If @c true, the memoized hash is valid for the rename count @c _hashRenames. */
+  mutable bool _hashValid;
+  /** The rename count, the memoized hash was computed at. */
+  mutable unsigned int _hashRenames;
+  /** Indices of the elements by type, built lazily by @c typeIndex. */
+  mutable QHash<const QMetaObject *, TypeIndex> _typeIndices;
+  /** If @c true, the list is frozen. */
+  bool _frozen;
+  /** Serializes building type indices, while the list is frozen and thus accessed
+   * concurrently. */
+  mutable QMutex _typeIndexLock;
+
+  friend class ConfigObject;
 };
 
 
@@ -362,6 +658,14 @@ public:
   void clear();
   bool copy(const AbstractConfigObjectList &other);
 
+  /** Sets the given property of all elements at the given rows to the given value. Elements
+   * without that property (e.g., the time slot of FM channels) are skipped. Instead of an
+   * @c elementModified signal for every element, a single @c elementsModified signal is emitted
+   * for the range of the given rows.
+   * @returns The number of modified elements or -1 on error. */
+  int applyToAll(const QVector<int> &rows, const char *property, const QVariant &value,
+                 const ErrorStack &err=ErrorStack());
+
   /** Compares the object lists.
    *
    * This method returns 0 if the two lists are equivalent and -1, 1 otherwise. The established
@@ -407,6 +711,15 @@ public:
    *
    * @returns 0 if the two lists are equivalent, -1 or 1 otherwise.*/
   virtual int compare(const ConfigObjectRefList &other) const;
+
+  /** Combines the types and names of the referenced objects in order. */
+  quint64 hash() const;
+
+  /** Moves all references to the end of the @c dest list, leaving this list empty. Instead of
+   * a signal for every element, the destination emits a single @c elementsAdded and this list a
+   * single @c elementsReset signal.
+   * @returns The number of references added to the destination. */
+  int moveAll(ConfigObjectRefList *dest);
 };
 
 
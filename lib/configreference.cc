@@ -9,15 +9,51 @@
 #include "roamingzone.hh"
 #include "zone.hh"
 #include "encryptionextension.hh"
+#include <QMutex>
+#include <QMutexLocker>
 
 
 /* ********************************************************************************************* *
  * Implementation of ConfigObjectReference
  * ********************************************************************************************* */
+/** Returns the shared list of allowed type names. All references with the same allowed types
+ * share the same (implicitly shared) list, hence no list gets allocated per reference. */
+static QStringList
+internElementTypes(const QStringList &types) {
+  static QMutex lock;
+  static QHash<QString, QStringList> lists;
+
+  QMutexLocker locker(&lock);
+  QString key = types.join(",");
+  auto item = lists.find(key);
+  if (lists.end() == item)
+    item = lists.insert(key, types);
+  return item.value();
+}
+
+/** Returns the shared list of allowed type names for a single type. */
+static QStringList
+internElementTypes(const QMetaObject &type) {
+  static QMutex lock;
+  static QHash<const QMetaObject *, QStringList> lists;
+
+  QMutexLocker locker(&lock);
+  auto item = lists.find(&type);
+  if (lists.end() == item)
+    item = lists.insert(&type, internElementTypes(QStringList(type.className())));
+  return item.value();
+}
+
+
 ConfigObjectReference::ConfigObjectReference(const QMetaObject &elementType, QObject *parent)
-  : QObject(parent), _elementTypes(), _object(nullptr)
+  : QObject(parent), _elementTypes(internElementTypes(elementType)), _object(nullptr)
 {
-  _elementTypes.append(elementType.className());
+  // pass...
+}
+
+ConfigObjectReference::~ConfigObjectReference() {
+  if (_object)
+    _object->detach(this);
 }
 
 bool
@@ -28,7 +64,7 @@ ConfigObjectReference::isNull() const {
 void
 ConfigObjectReference::clear() {
   if (_object) {
-    disconnect(_object, SIGNAL(destroyed(QObject*)), this, SLOT(onReferenceDeleted(QObject*)));
+    _object->detach(this);
     emit modified();
   }
   _object = nullptr;
@@ -37,20 +73,18 @@ ConfigObjectReference::clear() {
 bool
 ConfigObjectReference::set(ConfigObject *object) {
   if (_object)
-    disconnect(_object, SIGNAL(destroyed(QObject*)), this, SLOT(onReferenceDeleted(QObject*)));
+    _object->detach(this);
 
   if (nullptr == object) {
     _object = nullptr;
     return true;
   }
 
-  // Check type
+  // Check type, walks the class hierarchy without converting the type names
   bool typeCheck = false;
-  foreach (const QString &cname, _elementTypes) {
-    if (object->inherits(cname.toLatin1().constData())) {
-      typeCheck = true;
-      break;
-    }
+  for (const QMetaObject *meta = object->metaObject(); (nullptr != meta) && (! typeCheck);
+       meta = meta->superClass()) {
+    typeCheck = _elementTypes.contains(QLatin1String(meta->className()));
   }
   if (! typeCheck) {
     logError() << "Cannot reference element of type " << object->metaObject()->className()
@@ -60,8 +94,7 @@ ConfigObjectReference::set(ConfigObject *object) {
 
   _object = object;
   if (_object)
-    connect(_object, &QObject::destroyed,
-            this, &ConfigObjectReference::onReferenceDeleted, Qt::DirectConnection);
+    _object->attach(this);
 
   emit modified();
   return true;
@@ -88,8 +121,11 @@ ConfigObjectReference::compare(const ConfigObjectReference &other) const {
 
 bool
 ConfigObjectReference::allow(const QMetaObject *elementType) {
-  if (! _elementTypes.contains(elementType->className()))
-    _elementTypes.append(elementType->className());
+  if (_elementTypes.contains(elementType->className()))
+    return true;
+  QStringList types = _elementTypes;
+  types.append(elementType->className());
+  _elementTypes = internElementTypes(types);
   return true;
 }
 
@@ -100,6 +136,7 @@ ConfigObjectReference::elementTypeNames() const {
 
 void
 ConfigObjectReference::onReferenceDeleted(QObject *obj) {
+  // Called by the destructor of the referenced object, which already dropped this reference.
   // Check if destroyed obj is referenced one.
   if (_object != reinterpret_cast<ConfigObject*>(obj))
     return;
@@ -22,6 +22,9 @@ protected:
   ConfigObjectReference(const QMetaObject &elementType=ConfigObject::staticMetaObject, QObject *parent = nullptr);
 
 public:
+  /** Destructor, unregisters the reference from the referenced object. */
+  virtual ~ConfigObjectReference();
+
   /** Returns @c true if the reference is null.
    * That is, if there is no object referenced. */
   bool isNull() const;
@@ -69,10 +72,13 @@ protected slots:
   void onReferenceDeleted(QObject *obj);
 
 protected:
-  /** Holds the static QMetaObject of the possible element types. */
+  /** Holds the class names of the possible element types. The list is shared among all
+   * references allowing the same types. */
   QStringList _elementTypes;
   /** The reference to the object. */
   ConfigObject *_object;
+
+  friend class ConfigObject;
 };
 
 
@@ -0,0 +1,570 @@
+#include "configsnapshot.hh"
+#include "config.hh"
+#include "channel.hh"
+#include "contact.hh"
+#include "radioid.hh"
+#include "gpssystem.hh"
+#include "encryptionextension.hh"
+#include "logger.hh"
+#include "objectarena.hh"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QMetaProperty>
+#include <cstring>
+
+#define SNAPSHOT_MAGIC      "QDMRSNAP"
+#define SNAPSHOT_MAGIC_SIZE 8
+
+/** Type codes of the stored values. These are part of the file format and must not change. */
+enum class SnapshotType : quint8 {
+  Enum = 1, Bool, Int, UInt, Double, String, Frequency, Interval, Reference, RefList, Item,
+  ObjectList
+};
+
+/** Reference index of a null reference. */
+static const qint32 NullReference = -1;
+/** Reference index of a tagged singleton, the tag name follows. */
+static const qint32 TagReference = -2;
+
+/** Maps the given property kind to the stored type code. Returns @c false, if the kind cannot be
+ * stored. */
+static bool
+snapshotType(ConfigItem::PropertyKind kind, SnapshotType &type) {
+  switch (kind) {
+  case ConfigItem::PropertyKind::Enum: type = SnapshotType::Enum; return true;
+  case ConfigItem::PropertyKind::Bool: type = SnapshotType::Bool; return true;
+  case ConfigItem::PropertyKind::Int: type = SnapshotType::Int; return true;
+  case ConfigItem::PropertyKind::UInt: type = SnapshotType::UInt; return true;
+  case ConfigItem::PropertyKind::Double: type = SnapshotType::Double; return true;
+  case ConfigItem::PropertyKind::String: type = SnapshotType::String; return true;
+  case ConfigItem::PropertyKind::Frequency: type = SnapshotType::Frequency; return true;
+  case ConfigItem::PropertyKind::Interval: type = SnapshotType::Interval; return true;
+  case ConfigItem::PropertyKind::Reference: type = SnapshotType::Reference; return true;
+  case ConfigItem::PropertyKind::RefList: type = SnapshotType::RefList; return true;
+  case ConfigItem::PropertyKind::Item: type = SnapshotType::Item; return true;
+  case ConfigItem::PropertyKind::ObjectList: type = SnapshotType::ObjectList; return true;
+  default: break;
+  }
+  return false;
+}
+
+/** Returns the meta object for the given class name. First, the given candidates are searched
+ * (e.g., the element types of a list), then all classes, that may appear as elements of
+ * polymorphic lists. */
+static const QMetaObject *
+snapshotClass(const QByteArray &className, const QList<QMetaObject> &candidates) {
+  static const QList<const QMetaObject *> polymorphic = {
+    &FMChannel::staticMetaObject, &DMRChannel::staticMetaObject,
+    &DTMFContact::staticMetaObject, &DMRContact::staticMetaObject,
+    &DMRRadioID::staticMetaObject, &DTMFRadioID::staticMetaObject,
+    &GPSSystem::staticMetaObject, &APRSSystem::staticMetaObject,
+    &BasicEncryptionKey::staticMetaObject, &EnhancedEncryptionKey::staticMetaObject,
+    &AESEncryptionKey::staticMetaObject
+  };
+
+  foreach (const QMetaObject &meta, candidates) {
+    if (className == meta.className())
+      return &meta;
+  }
+  foreach (const QMetaObject *meta, polymorphic) {
+    if (className == meta->className())
+      return meta;
+  }
+  return nullptr;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of SnapshotWriter
+ * ********************************************************************************************* */
+/** Serializes a configuration into a data stream. */
+class SnapshotWriter
+{
+public:
+  explicit SnapshotWriter(QDataStream &stream)
+    : _stream(stream), _indices()
+  {
+    // pass...
+  }
+
+  bool write(Config *config, const ErrorStack &err) {
+    // Number all objects first, references may point forward.
+    enumerate(config);
+    return writeItem(config, err);
+  }
+
+protected:
+  void enumerate(ConfigItem *item) {
+    if (ConfigObject *obj = item->as<ConfigObject>())
+      _indices.insert(obj, _indices.size());
+    foreach (const ConfigItem::PropertyInfo &info, ConfigItem::propertyTable(item->metaObject())) {
+      ConfigItem::PropertyKind kind = item->propertyKind(info);
+      if (ConfigItem::PropertyKind::Item == kind) {
+        if (ConfigItem *child = info.prop.read(item).value<ConfigItem *>())
+          enumerate(child);
+      } else if (ConfigItem::PropertyKind::ObjectList == kind) {
+        if (ConfigObjectList *lst = info.prop.read(item).value<ConfigObjectList *>()) {
+          for (int i=0; i<lst->count(); i++)
+            enumerate(lst->get(i));
+        }
+      }
+    }
+  }
+
+  bool writeItem(ConfigItem *item, const ErrorStack &err) {
+    ConfigObject *obj = item->as<ConfigObject>();
+    _stream << QByteArray(item->metaObject()->className())
+            << (obj ? _indices.value(obj, NullReference) : NullReference);
+
+    foreach (const ConfigItem::PropertyInfo &info, ConfigItem::propertyTable(item->metaObject())) {
+      const QMetaProperty &prop = info.prop;
+      ConfigItem::PropertyKind kind = item->propertyKind(info);
+      SnapshotType type;
+      if (! snapshotType(kind, type))
+        continue;
+
+      if (SnapshotType::Reference == type) {
+        ConfigObjectReference *ref = prop.read(item).value<ConfigObjectReference *>();
+        if (nullptr == ref)
+          continue;
+        writeHeader(prop, type);
+        if (! writeReference(prop, ref->as<ConfigObject>(), err))
+          return false;
+      } else if (SnapshotType::RefList == type) {
+        ConfigObjectRefList *refs = prop.read(item).value<ConfigObjectRefList *>();
+        if (nullptr == refs)
+          continue;
+        writeHeader(prop, type);
+        _stream << quint32(refs->count());
+        for (int i=0; i<refs->count(); i++) {
+          if (! writeReference(prop, refs->get(i), err))
+            return false;
+        }
+      } else if (SnapshotType::Item == type) {
+        ConfigItem *child = prop.read(item).value<ConfigItem *>();
+        writeHeader(prop, type);
+        _stream << (nullptr != child);
+        if (child && (! writeItem(child, err)))
+          return false;
+      } else if (SnapshotType::ObjectList == type) {
+        ConfigObjectList *lst = prop.read(item).value<ConfigObjectList *>();
+        if (nullptr == lst)
+          continue;
+        writeHeader(prop, type);
+        _stream << quint32(lst->count());
+        for (int i=0; i<lst->count(); i++) {
+          if (! writeItem(lst->get(i), err))
+            return false;
+        }
+      } else if (prop.isWritable()) {
+        // Like ConfigItem::copy, only writable properties of basic types are stored.
+        writeHeader(prop, type);
+        QVariant value = prop.read(item);
+        switch (type) {
+        case SnapshotType::Enum:
+        case SnapshotType::Int: _stream << qint32(value.toInt()); break;
+        case SnapshotType::Bool: _stream << value.toBool(); break;
+        case SnapshotType::UInt: _stream << quint32(value.toUInt()); break;
+        case SnapshotType::Double: _stream << value.toDouble(); break;
+        case SnapshotType::String: _stream << value.toString(); break;
+        case SnapshotType::Frequency: _stream << quint64(value.value<Frequency>().inHz()); break;
+        case SnapshotType::Interval: _stream << quint64(value.value<Interval>().milliseconds()); break;
+        default: break;
+        }
+      }
+    }
+
+    // The empty name terminates the property list.
+    _stream << QByteArray();
+    return true;
+  }
+
+  void writeHeader(const QMetaProperty &prop, SnapshotType type) {
+    _stream << QByteArray(prop.name()) << quint8(type);
+  }
+
+  bool writeReference(const QMetaProperty &prop, ConfigObject *obj, const ErrorStack &err) {
+    const char *className = prop.enclosingMetaObject()->className();
+    if (nullptr == obj) {
+      _stream << NullReference;
+    } else if (ConfigItem::Context::hasTag(prop, obj)) {
+      _stream << TagReference << ConfigItem::Context::getTag(prop, obj);
+    } else if (_indices.contains(obj)) {
+      _stream << _indices.value(obj);
+    } else {
+      errMsg(err) << "Cannot store reference '" << prop.name() << "' of " << className
+                  << ": Referenced " << obj->metaObject()->className()
+                  << " is not part of the configuration.";
+      return false;
+    }
+    return true;
+  }
+
+protected:
+  QDataStream &_stream;
+  QHash<ConfigObject *, qint32> _indices;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of SnapshotReader
+ * ********************************************************************************************* */
+/** Reads a configuration from a data stream. References are collected and resolved at the end. */
+class SnapshotReader
+{
+protected:
+  /** A reference or reference list to resolve. */
+  struct Link {
+    ConfigItem *item;
+    QMetaProperty prop;
+    QVector<qint32> indices;
+    QStringList tags;
+  };
+
+public:
+  explicit SnapshotReader(QDataStream &stream)
+    : _stream(stream), _objects(), _links()
+  {
+    // pass...
+  }
+
+  bool read(Config *config, const ErrorStack &err) {
+    QByteArray className; qint32 index;
+    _stream >> className >> index;
+    if (className != config->metaObject()->className()) {
+      errMsg(err) << "Snapshot does not contain a configuration.";
+      return false;
+    }
+    if (! readProperties(config, err))
+      return false;
+    return resolve(err);
+  }
+
+protected:
+  bool readProperties(ConfigItem *item, const ErrorStack &err) {
+    const QMetaObject *meta = item->metaObject();
+    while (true) {
+      QByteArray name; quint8 code;
+      _stream >> name;
+      if (QDataStream::Ok != _stream.status()) {
+        errMsg(err) << "Unexpected end of snapshot while reading " << meta->className() << ".";
+        return false;
+      }
+      if (name.isEmpty())
+        return true;
+      _stream >> code;
+      SnapshotType type = SnapshotType(code);
+
+      // Skip unknown properties and properties of different type
+      int idx = meta->indexOfProperty(name.constData());
+      SnapshotType expected;
+      if ((0 > idx) || (! snapshotType(item->propertyKind(meta->property(idx)), expected))
+          || (expected != type)) {
+        logDebug() << "Skip property '" << name << "' of " << meta->className() << " in snapshot.";
+        if (! skipValue(type, err))
+          return false;
+        continue;
+      }
+
+      if (! readValue(item, meta->property(idx), type, err))
+        return false;
+    }
+  }
+
+  bool readValue(ConfigItem *item, const QMetaProperty &prop, SnapshotType type, const ErrorStack &err) {
+    switch (type) {
+    case SnapshotType::Enum:
+    case SnapshotType::Int: { qint32 v; _stream >> v; prop.write(item, v); } break;
+    case SnapshotType::Bool: { bool v; _stream >> v; prop.write(item, v); } break;
+    case SnapshotType::UInt: { quint32 v; _stream >> v; prop.write(item, v); } break;
+    case SnapshotType::Double: { double v; _stream >> v; prop.write(item, v); } break;
+    case SnapshotType::String: { QString v; _stream >> v; prop.write(item, v); } break;
+    case SnapshotType::Frequency: {
+      quint64 v; _stream >> v; prop.write(item, QVariant::fromValue(Frequency::fromHz(v)));
+    } break;
+    case SnapshotType::Interval: {
+      quint64 v; _stream >> v; prop.write(item, QVariant::fromValue(Interval::fromMilliseconds(v)));
+    } break;
+    case SnapshotType::Reference: {
+      Link link{item, prop, {}, {}};
+      readReference(link);
+      _links.append(link);
+    } break;
+    case SnapshotType::RefList: {
+      Link link{item, prop, {}, {}};
+      quint32 n; _stream >> n;
+      for (quint32 i=0; (i<n) && (QDataStream::Ok == _stream.status()); i++)
+        readReference(link);
+      _links.append(link);
+    } break;
+    case SnapshotType::Item:
+      return readChild(item, prop, err);
+    case SnapshotType::ObjectList:
+      return readList(item, prop, err);
+    }
+    return QDataStream::Ok == _stream.status();
+  }
+
+  void readReference(Link &link) {
+    qint32 index; QString tag;
+    _stream >> index;
+    if (TagReference == index)
+      _stream >> tag;
+    link.indices.append(index);
+    link.tags.append(tag);
+  }
+
+  bool readChild(ConfigItem *item, const QMetaProperty &prop, const ErrorStack &err) {
+    bool present; _stream >> present;
+    ConfigItem *child = prop.read(item).value<ConfigItem *>();
+    if (! present) {
+      if (child && prop.isWritable())
+        prop.write(item, QVariant::fromValue<ConfigItem *>(nullptr));
+      return true;
+    }
+
+    QByteArray className; qint32 index;
+    _stream >> className >> index;
+    if ((nullptr == child) || (className != child->metaObject()->className())) {
+      if (! prop.isWritable())
+        return skipProperties(err);
+      QList<QMetaObject> candidates;
+      if (const QMetaObject *propType = QMetaType(prop.userType()).metaObject())
+        candidates.append(*propType);
+      const QMetaObject *childType = snapshotClass(className, candidates);
+      if ((nullptr == childType) ||
+          (nullptr == (child = qobject_cast<ConfigItem *>(childType->newInstance(Q_ARG(QObject *, item)))))) {
+        errMsg(err) << "Cannot instantiate " << className << " for '" << prop.name()
+                    << "' of " << item->metaObject()->className() << ".";
+        return false;
+      }
+      if (! prop.write(item, QVariant::fromValue(child))) {
+        errMsg(err) << "Cannot set property '" << prop.name() << "' of "
+                    << item->metaObject()->className() << ".";
+        child->deleteLater();
+        return false;
+      }
+    }
+
+    if (ConfigObject *obj = child->as<ConfigObject>())
+      _objects.insert(index, obj);
+    return readProperties(child, err);
+  }
+
+  bool readList(ConfigItem *item, const QMetaProperty &prop, const ErrorStack &err) {
+    ConfigObjectList *lst = prop.read(item).value<ConfigObjectList *>();
+    quint32 n; _stream >> n;
+    for (quint32 i=0; i<n; i++) {
+      if (nullptr == lst) {
+        if (! skipItem(err))
+          return false;
+        continue;
+      }
+      QByteArray className; qint32 index;
+      _stream >> className >> index;
+      const QMetaObject *type = snapshotClass(className, lst->elementTypes());
+      ConfigObject *obj = nullptr;
+      if ((nullptr == type) || (nullptr == (obj = qobject_cast<ConfigObject *>(type->newInstance())))) {
+        errMsg(err) << "Cannot instantiate " << className << " as element of '" << prop.name()
+                    << "' of " << item->metaObject()->className() << ".";
+        return false;
+      }
+      if (! readProperties(obj, err)) {
+        delete obj;
+        return false;
+      }
+      if (0 > lst->add(obj)) {
+        errMsg(err) << "Cannot add " << className << " '" << obj->name() << "' to '"
+                    << prop.name() << "' of " << item->metaObject()->className() << ".";
+        delete obj;
+        return false;
+      }
+      _objects.insert(index, obj);
+    }
+    return QDataStream::Ok == _stream.status();
+  }
+
+  bool skipValue(SnapshotType type, const ErrorStack &err) {
+    switch (type) {
+    case SnapshotType::Enum:
+    case SnapshotType::Int:
+    case SnapshotType::UInt: _stream.skipRawData(sizeof(quint32)); break;
+    case SnapshotType::Bool: _stream.skipRawData(sizeof(quint8)); break;
+    case SnapshotType::Double:
+    case SnapshotType::Frequency:
+    case SnapshotType::Interval: _stream.skipRawData(sizeof(quint64)); break;
+    case SnapshotType::String: { QString v; _stream >> v; } break;
+    case SnapshotType::Reference: { Link link; readReference(link); } break;
+    case SnapshotType::RefList: {
+      Link link; quint32 n; _stream >> n;
+      for (quint32 i=0; (i<n) && (QDataStream::Ok == _stream.status()); i++)
+        readReference(link);
+    } break;
+    case SnapshotType::Item: {
+      bool present; _stream >> present;
+      if (present)
+        return skipItem(err);
+    } break;
+    case SnapshotType::ObjectList: {
+      quint32 n; _stream >> n;
+      for (quint32 i=0; (i<n) && (QDataStream::Ok == _stream.status()); i++) {
+        if (! skipItem(err))
+          return false;
+      }
+    } break;
+    default:
+      errMsg(err) << "Unknown value type " << int(type) << " in snapshot.";
+      return false;
+    }
+    return QDataStream::Ok == _stream.status();
+  }
+
+  bool skipItem(const ErrorStack &err) {
+    QByteArray className; qint32 index;
+    _stream >> className >> index;
+    return skipProperties(err);
+  }
+
+  bool skipProperties(const ErrorStack &err) {
+    while (QDataStream::Ok == _stream.status()) {
+      QByteArray name; quint8 code;
+      _stream >> name;
+      if (name.isEmpty())
+        break;
+      _stream >> code;
+      if (! skipValue(SnapshotType(code), err))
+        return false;
+    }
+    return QDataStream::Ok == _stream.status();
+  }
+
+  bool resolve(const ErrorStack &err) {
+    foreach (const Link &link, _links) {
+      const char *className = link.prop.enclosingMetaObject()->className();
+      ConfigObjectRefList *lst = nullptr;
+      ConfigObjectReference *ref = nullptr;
+      if (! (lst = link.prop.read(link.item).value<ConfigObjectRefList *>()))
+        ref = link.prop.read(link.item).value<ConfigObjectReference *>();
+      if ((nullptr == lst) && (nullptr == ref))
+        continue;
+
+      for (int i=0; i<link.indices.size(); i++) {
+        ConfigObject *obj = nullptr;
+        if (TagReference == link.indices[i]) {
+          obj = ConfigItem::Context::getTag(link.prop, link.tags[i]);
+        } else if (NullReference != link.indices[i]) {
+          obj = _objects.value(link.indices[i], nullptr);
+        }
+        if ((nullptr == obj) && (lst || (NullReference != link.indices[i]))) {
+          errMsg(err) << "Cannot link '" << link.prop.name() << "' of " << className
+                      << ": Reference not defined in snapshot.";
+          return false;
+        }
+        if ((lst && (0 > lst->add(obj))) || (ref && (! ref->set(obj)))) {
+          errMsg(err) << "Cannot link '" << link.prop.name() << "' of " << className << ".";
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+protected:
+  QDataStream &_stream;
+  QHash<qint32, ConfigObject *> _objects;
+  QList<Link> _links;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigSnapshot
+ * ********************************************************************************************* */
+bool
+ConfigSnapshot::write(Config *config, QIODevice &device, const ErrorStack &err) {
+  QDataStream stream(&device);
+  stream.setVersion(QDataStream::Qt_5_12);
+  stream.writeRawData(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+  stream << Version;
+
+  SnapshotWriter writer(stream);
+  if (! writer.write(config, err))
+    return false;
+
+  if (QDataStream::Ok != stream.status()) {
+    errMsg(err) << "Cannot write snapshot: " << device.errorString() << ".";
+    return false;
+  }
+  return true;
+}
+
+bool
+ConfigSnapshot::write(Config *config, const QString &filename, const ErrorStack &err) {
+  QSaveFile file(filename);
+  if (! file.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot open snapshot '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+  if (! write(config, file, err)) {
+    file.cancelWriting();
+    errMsg(err) << "Cannot write snapshot '" << filename << "'.";
+    return false;
+  }
+  if (! file.commit()) {
+    errMsg(err) << "Cannot write snapshot '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+  return true;
+}
+
+bool
+ConfigSnapshot::read(Config *config, QIODevice &device, const ErrorStack &err) {
+  QDataStream stream(&device);
+  stream.setVersion(QDataStream::Qt_5_12);
+
+  char magic[SNAPSHOT_MAGIC_SIZE];
+  quint32 version = 0;
+  if ((SNAPSHOT_MAGIC_SIZE != stream.readRawData(magic, SNAPSHOT_MAGIC_SIZE)) ||
+      (0 != memcmp(magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE))) {
+    errMsg(err) << "Not a config snapshot.";
+    return false;
+  }
+  stream >> version;
+  if ((QDataStream::Ok != stream.status()) || (Version < version)) {
+    errMsg(err) << "Unsupported snapshot version " << version << ", expected " << Version << ".";
+    return false;
+  }
+
+  Config::BulkUpdate update(config);
+  ObjectArena::Scope arena;
+  config->clear();
+  SnapshotReader reader(stream);
+  if (! reader.read(config, err)) {
+    config->clear();
+    return false;
+  }
+  return true;
+}
+
+bool
+ConfigSnapshot::read(Config *config, const QString &filename, const ErrorStack &err) {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open snapshot '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+  if (! read(config, file, err)) {
+    errMsg(err) << "Cannot read snapshot '" << filename << "'.";
+    return false;
+  }
+  return true;
+}
+
+bool
+ConfigSnapshot::isSnapshot(const QString &filename) {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly))
+    return false;
+  return SNAPSHOT_MAGIC == file.read(SNAPSHOT_MAGIC_SIZE);
+}
@@ -0,0 +1,45 @@
+#ifndef CONFIGSNAPSHOT_HH
+#define CONFIGSNAPSHOT_HH
+
+#include <QString>
+#include "errorstack.hh"
+
+class Config;
+class QIODevice;
+
+/** Implements a compact binary snapshot format of the complete configuration.
+ *
+ * In contrast to the YAML codeplug, the snapshot is not meant to be edited by hand. It serves as
+ * a fast intermediate format, e.g., for caches, autosave or passing a codeplug between several
+ * invocations of @c dmrconf. The snapshot is generated from the property tables of the config
+ * items (see @c ConfigItem::propertyTable) and stores the same state that gets copied by
+ * @c ConfigItem::copy. That is, all writable properties of basic types, owned items and lists
+ * as well as references. References are stored as indices of the referenced objects.
+ *
+ * Properties are stored by name together with their type. Hence, properties unknown to the
+ * reading version are skipped and missing properties keep their default values.
+ *
+ * @ingroup conf */
+class ConfigSnapshot
+{
+public:
+  /** Current version of the snapshot format. */
+  static const quint32 Version = 1;
+
+public:
+  /** Serializes the given configuration into the given device. */
+  static bool write(Config *config, QIODevice &device, const ErrorStack &err=ErrorStack());
+  /** Serializes the given configuration into the given file. The file only gets replaced, if
+   * the snapshot was written completely. */
+  static bool write(Config *config, const QString &filename, const ErrorStack &err=ErrorStack());
+
+  /** Reads the configuration from the given device. The configuration gets cleared first. */
+  static bool read(Config *config, QIODevice &device, const ErrorStack &err=ErrorStack());
+  /** Reads the configuration from the given file. The configuration gets cleared first. */
+  static bool read(Config *config, const QString &filename, const ErrorStack &err=ErrorStack());
+
+  /** Returns @c true, if the given file is a config snapshot. */
+  static bool isSnapshot(const QString &filename);
+};
+
+#endif // CONFIGSNAPSHOT_HH
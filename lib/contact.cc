@@ -256,7 +256,8 @@ DMRContact::setAnytoneExtension(AnytoneContactExtension *ext) {
  * Implementation of ContactList
  * ********************************************************************************************* */
 ContactList::ContactList(QObject *parent)
-  : ConfigObjectList(Contact::staticMetaObject, parent)
+  : ConfigObjectList(Contact::staticMetaObject, parent), _dmrIndex(), _dtmfIndex(),
+    _numberIndexValid(false)
 {
   // pass...
 }
@@ -270,20 +271,12 @@ ContactList::add(ConfigObject *obj, int row, bool unique) {
 
 int
 ContactList::digitalCount() const {
-  int c=0;
-  for (int i=0; i<_items.size(); i++)
-    if (_items.at(i)->is<DMRContact>())
-      c++;
-  return c;
+  return countOfType(DMRContact::staticMetaObject);
 }
 
 int
 ContactList::dtmfCount() const {
-  int c=0;
-  for (int i=0; i<_items.size(); i++)
-    if (_items.at(i)->is<DTMFContact>())
-      c++;
-  return c;
+  return countOfType(DTMFContact::staticMetaObject);
 }
 
 
@@ -296,41 +289,108 @@ ContactList::contact(int idx) const {
 
 DMRContact *
 ContactList::digitalContact(int idx) const {
-  for (int i=0; i<_items.size(); i++) {
-    if (_items.at(i)->is<DMRContact>()) {
-      if (0 == idx)
-        return _items.at(i)->as<DMRContact>();
-      else
-        idx--;
-    }
-  }
+  if (ConfigObject *obj = getOfType(DMRContact::staticMetaObject, idx))
+    return obj->as<DMRContact>();
   return nullptr;
 }
 
 DMRContact *
 ContactList::findDigitalContact(unsigned number) const {
-  for (int i=0; i<_items.size(); i++) {
-    if (! _items.at(i)->is<DMRContact>())
-      continue;
-    if (_items.at(i)->as<DMRContact>()->number() == number)
-      return _items.at(i)->as<DMRContact>();
-  }
-  return nullptr;
+  buildNumberIndex();
+  return _dmrIndex.value(number, nullptr);
 }
 
 DTMFContact *
 ContactList::dtmfContact(int idx) const {
-  for (int i=0; i<_items.size(); i++) {
-    if (_items.at(i)->is<DTMFContact>()) {
-      if (0 == idx)
-        return _items.at(i)->as<DTMFContact>();
-      else
-        idx--;
-    }
-  }
+  if (ConfigObject *obj = getOfType(DTMFContact::staticMetaObject, idx))
+    return obj->as<DTMFContact>();
   return nullptr;
 }
 
+DTMFContact *
+ContactList::findDTMFContact(const QString &number) const {
+  buildNumberIndex();
+  return _dtmfIndex.value(number, nullptr);
+}
+
+void
+ContactList::invalidateIndex() {
+  ConfigObjectList::invalidateIndex();
+  _numberIndexValid = false;
+}
+
+void
+ContactList::appendToIndex(ConfigObject *obj, int idx) {
+  ConfigObjectList::appendToIndex(obj, idx);
+  if (! _numberIndexValid)
+    return;
+  // The appended contact is only found, if it is the first one with that number
+  if (DMRContact *dmr = obj->as<DMRContact>()) {
+    if (! _dmrIndex.contains(dmr->number()))
+      _dmrIndex.insert(dmr->number(), dmr);
+  } else if (DTMFContact *dtmf = obj->as<DTMFContact>()) {
+    if (! _dtmfIndex.contains(dtmf->number()))
+      _dtmfIndex.insert(dtmf->number(), dtmf);
+  }
+}
+
+void
+ContactList::removeLastFromIndex(ConfigObject *obj, int idx) {
+  ConfigObjectList::removeLastFromIndex(obj, idx);
+  if (! _numberIndexValid)
+    return;
+  // If the last contact is found by its number, there is no other contact with that number
+  if (DMRContact *dmr = obj->as<DMRContact>()) {
+    if (dmr == _dmrIndex.value(dmr->number(), nullptr))
+      _dmrIndex.remove(dmr->number());
+  } else if (DTMFContact *dtmf = obj->as<DTMFContact>()) {
+    if (dtmf == _dtmfIndex.value(dtmf->number(), nullptr))
+      _dtmfIndex.remove(dtmf->number());
+  } else {
+    // Contact is being destroyed, its type and number are gone
+    _numberIndexValid = false;
+  }
+}
+
+void
+ContactList::updateIndex(ConfigObject *obj) {
+  ConfigObjectList::updateIndex(obj);
+  if (! _numberIndexValid)
+    return;
+  // If the contact is not found by its number, the number may have changed
+  if (DMRContact *dmr = obj->as<DMRContact>()) {
+    if (dmr != _dmrIndex.value(dmr->number(), nullptr))
+      _numberIndexValid = false;
+  } else if (DTMFContact *dtmf = obj->as<DTMFContact>()) {
+    if (dtmf != _dtmfIndex.value(dtmf->number(), nullptr))
+      _numberIndexValid = false;
+  }
+}
+
+void
+ContactList::freeze() {
+  // Build the number and type indices before freezing
+  buildNumberIndex();
+  digitalCount(); dtmfCount();
+  ConfigObjectList::freeze();
+}
+
+void
+ContactList::buildNumberIndex() const {
+  if (_numberIndexValid)
+    return;
+  _dmrIndex.clear();
+  _dtmfIndex.clear();
+  // Iterate in reverse order, such that the first contact with a number wins
+  for (int i=_items.size()-1; i>=0; i--) {
+    if (DMRContact *dmr = _items.at(i)->as<DMRContact>())
+      _dmrIndex.insert(dmr->number(), dmr);
+    else if (DTMFContact *dtmf = _items.at(i)->as<DTMFContact>())
+      _dtmfIndex.insert(dtmf->number(), dtmf);
+  }
+  _numberIndexValid = true;
+}
+
 ConfigItem *
 ContactList::allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err) {
   Q_UNUSED(ctx)
@@ -242,9 +242,31 @@ public:
   DMRContact *findDigitalContact(unsigned number) const;
   /** Returns the DTMF contact at index @c idx among DTMF contacts. */
   DTMFContact *dtmfContact(int idx) const;
+  /** Searches for a DTMF contact with the given number. */
+  DTMFContact *findDTMFContact(const QString &number) const;
+
+  void freeze();
 
 public:
   ConfigItem *allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err=ErrorStack());
+
+protected:
+  void invalidateIndex();
+  void appendToIndex(ConfigObject *obj, int idx);
+  void removeLastFromIndex(ConfigObject *obj, int idx);
+  void updateIndex(ConfigObject *obj);
+  /** Builds the number indices, if invalid. */
+  void buildNumberIndex() const;
+
+protected:
+  /** Maps DMR numbers to the first contact with that number, built lazily by
+   * @c findDigitalContact. */
+  mutable QHash<unsigned, DMRContact *> _dmrIndex;
+  /** Maps DTMF numbers to the first contact with that number, built lazily by
+   * @c findDTMFContact. */
+  mutable QHash<QString, DTMFContact *> _dtmfIndex;
+  /** If @c false, the number indices must be rebuilt. */
+  mutable bool _numberIndexValid;
 };
 
 #endif // CONTACT_HH
@@ -1,4 +1,29 @@
 #include "crc32.hh"
+#include <QtEndian>
+#include "taskscheduler.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC32_HAS_PCLMUL 1
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#define CRC32_HAS_ARMV8 1
+#if defined(__clang__)
+#define CRC32_ARMV8_TARGET "crc"
+#else
+#define CRC32_ARMV8_TARGET "+crc"
+#endif
+#endif
+
+/** Minimum number of bytes processed per thread by @c CRC32::updateParallel. */
+#define MIN_PARALLEL_CHUNK (1024*1024)
+
+/** Minimum number of bytes to process with the carry-less multiplication folding. */
+#define PCLMUL_MIN_SIZE 64
 
 static const uint32_t _crc_table[256] = {
   /* CRC polynomial 0xedb88320 */
@@ -48,12 +73,196 @@ static const uint32_t _crc_table[256] = {
 };
 
 
+
+/** Byte-at-a-time update, used for heads and tails of the faster variants. */
+static inline uint32_t
+crc32_bytewise(uint32_t crc, const uint8_t *buf, size_t n) {
+  for (size_t i=0; i<n; i++)
+    crc = ( _crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8) );
+  return crc;
+}
+
+/** Lookup tables for the slicing-by-8 implementation, derived from the byte-wise table. */
+struct SlicingTables {
+  uint32_t t[8][256];
+
+  SlicingTables() {
+    for (int i=0; i<256; i++)
+      t[0][i] = _crc_table[i];
+    for (int k=1; k<8; k++)
+      for (int i=0; i<256; i++)
+        t[k][i] = (t[k-1][i] >> 8) ^ _crc_table[t[k-1][i] & 0xFF];
+  }
+};
+
+static const SlicingTables _slicing_tables;
+
+/** Portable slicing-by-8 implementation, processes 8 bytes per iteration. */
+static uint32_t
+crc32_slicing8(uint32_t crc, const uint8_t *buf, size_t n) {
+  const uint32_t (&t)[8][256] = _slicing_tables.t;
+  while (n >= 8) {
+    uint32_t one = qFromLittleEndian<quint32>(buf) ^ crc;
+    uint32_t two = qFromLittleEndian<quint32>(buf+4);
+    crc = t[7][ one      & 0xFF] ^ t[6][(one >>  8) & 0xFF] ^
+          t[5][(one >> 16) & 0xFF] ^ t[4][ one >> 24        ] ^
+          t[3][ two      & 0xFF] ^ t[2][(two >>  8) & 0xFF] ^
+          t[1][(two >> 16) & 0xFF] ^ t[0][ two >> 24        ];
+    buf += 8; n -= 8;
+  }
+  return crc32_bytewise(crc, buf, n);
+}
+
+#ifdef CRC32_HAS_PCLMUL
+/** Folds the data using carry-less multiplication, see Gopal et al., "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction", Intel 2009. Requires at least 64 bytes. */
+__attribute__((target("sse4.1,pclmul")))
+static uint32_t
+crc32_pclmul(uint32_t crc, const uint8_t *buf, size_t n) {
+  // Bit-reflected folding constants and Barrett reduction constants for polynomial 0x04c11db7.
+  alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+  alignas(16) static const uint64_t k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+  alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124, 0x0000000000 };
+  alignas(16) static const uint64_t poly[] = { 0x01db710641, 0x01f7011641 };
+
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+  x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+  x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+  x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+  x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(int(crc)));
+  x0 = _mm_load_si128((const __m128i *)k1k2);
+  buf += 64; n -= 64;
+
+  // Fold 64 bytes per iteration in four parallel lanes.
+  while (n >= 64) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(buf + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(buf + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(buf + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(buf + 0x30)));
+    buf += 64; n -= 64;
+  }
+
+  // Fold the four lanes into a single 128bit value.
+  x0 = _mm_load_si128((const __m128i *)k3k4);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  // Fold remaining 16 byte blocks.
+  while (n >= 16) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)buf)), x5);
+    buf += 16; n -= 16;
+  }
+
+  // Fold 128 to 64 bits.
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits.
+  x0 = _mm_load_si128((const __m128i *)poly);
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  crc = uint32_t(_mm_extract_epi32(x1, 1));
+
+  return crc32_slicing8(crc, buf, n);
+}
+
+static uint32_t
+crc32_accelerated(uint32_t crc, const uint8_t *buf, size_t n) {
+  if (n < PCLMUL_MIN_SIZE)
+    return crc32_slicing8(crc, buf, n);
+  return crc32_pclmul(crc, buf, n);
+}
+
+static bool
+crc32_has_acceleration() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+#endif
+
+#ifdef CRC32_HAS_ARMV8
+/** Uses the ARMv8 CRC32 instructions, which implement exactly this (IEEE) polynomial. */
+__attribute__((target(CRC32_ARMV8_TARGET)))
+static uint32_t
+crc32_accelerated(uint32_t crc, const uint8_t *buf, size_t n) {
+  while (n && (uintptr_t(buf) & 7)) {
+    crc = __crc32b(crc, *buf++); n--;
+  }
+  while (n >= 8) {
+    crc = __crc32d(crc, qFromLittleEndian<quint64>(buf));
+    buf += 8; n -= 8;
+  }
+  while (n--)
+    crc = __crc32b(crc, *buf++);
+  return crc;
+}
+
+static bool
+crc32_has_acceleration() {
+#if defined(__APPLE__)
+  return true;
+#elif defined(__linux__) && defined(HWCAP_CRC32)
+  return 0 != (getauxval(AT_HWCAP) & HWCAP_CRC32);
+#else
+  return false;
+#endif
+}
+#endif
+
+/** Selects the fastest implementation available on this CPU once. */
+typedef uint32_t (*crc32_impl_t)(uint32_t crc, const uint8_t *buf, size_t n);
+static crc32_impl_t
+crc32_select() {
+#if defined(CRC32_HAS_PCLMUL) || defined(CRC32_HAS_ARMV8)
+  if (crc32_has_acceleration())
+    return crc32_accelerated;
+#endif
+  return crc32_slicing8;
+}
+
+static const crc32_impl_t _crc_impl = crc32_select();
+
+
 CRC32::CRC32()
   : _crc(0xFFFFFFFF)
 {
 	// pass...
 }
 
+CRC32::CRC32(uint32_t init)
+  : _crc(init)
+{
+  // pass...
+}
+
 void
 CRC32::update(uint8_t c) {
   _crc = ( _crc_table[(_crc ^ c) & 0xFF] ^ (_crc >> 8) );
@@ -61,8 +270,17 @@ CRC32::update(uint8_t c) {
 
 void
 CRC32::update(const uint8_t *buf, size_t n) {
-	for (size_t i=0; i<n; i++)
-    _crc = ( _crc_table[(_crc ^ buf[i]) & 0xFF] ^ (_crc >> 8) );
+  _crc = _crc_impl(_crc, buf, n);
+}
+
+void
+CRC32::updateBytewise(const uint8_t *buf, size_t n) {
+  _crc = crc32_bytewise(_crc, buf, n);
+}
+
+void
+CRC32::updateSlicing(const uint8_t *buf, size_t n) {
+  _crc = crc32_slicing8(_crc, buf, n);
 }
 
 void
@@ -70,3 +288,65 @@ CRC32::update(const QByteArray &buf) {
 	update((const uint8_t *)buf.constData(), buf.size());
 }
 
+/** Multiplies a and b modulo the (reflected) CRC polynomial. */
+static uint32_t
+crc32_multmodp(uint32_t a, uint32_t b) {
+  uint32_t m = uint32_t(1) << 31, p = 0;
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if (0 == (a & (m - 1)))
+        break;
+    }
+    m >>= 1;
+    b = (b & 1) ? ((b >> 1) ^ 0xedb88320) : (b >> 1);
+  }
+  return p;
+}
+
+uint32_t
+CRC32::shift(uint32_t crc, uint64_t n) {
+  // Computes x^(8n) modulo the polynomial by squaring, starting with x^8 for a single byte. In the
+  // reflected representation, x^k is bit 31-k.
+  uint32_t power = uint32_t(1) << 23, p = uint32_t(1) << 31;
+  while (n) {
+    if (n & 1)
+      p = crc32_multmodp(power, p);
+    power = crc32_multmodp(power, power);
+    n >>= 1;
+  }
+  return crc32_multmodp(p, crc);
+}
+
+uint32_t
+CRC32::combine(uint32_t crc1, uint32_t crc2, uint64_t n2) {
+  // crc2 contains the initial value shifted over the second block. Replacing it by crc1 only
+  // requires to shift their difference, the CRC register is linear.
+  return shift(crc1 ^ 0xFFFFFFFF, n2) ^ crc2;
+}
+
+void
+CRC32::append(uint32_t crc, uint64_t n) {
+  _crc = combine(_crc, crc, n);
+}
+
+
+void
+CRC32::updateParallel(const uint8_t *buf, size_t n) {
+  if (n < 2*MIN_PARALLEL_CHUNK) {
+    update(buf, n);
+    return;
+  }
+
+  // Partial CRCs of the chunks are combined in order, see CRC32::combine.
+  struct Partial { uint32_t crc; uint64_t n; };
+  Partial total = TaskScheduler::parallelReduce(
+        qint64(n), MIN_PARALLEL_CHUNK, Partial{0xFFFFFFFF, 0},
+        [buf](qint64 first, qint64 last) {
+          return Partial{_crc_impl(0xFFFFFFFF, buf+first, size_t(last-first)), uint64_t(last-first)};
+        },
+        [](const Partial &a, const Partial &b) {
+          return Partial{combine(a.crc, b.crc, b.n), a.n+b.n};
+        });
+  append(total.crc, total.n);
+}
@@ -11,14 +11,36 @@ class CRC32
 public:
   /** Default constructor. */
 	CRC32();
+  /** Constructs a CRC with the given initial register value. */
+  explicit CRC32(uint32_t init);
   /** Update CRC with given byte. */
 	void update(uint8_t c);
   /** Update CRC with given data. */
 	void update(const uint8_t *c, size_t n);
   /** Update CRC with given data. */
 	void update(const QByteArray &data);
+  /** Update CRC with given data using the reference byte-at-a-time implementation. */
+  void updateBytewise(const uint8_t *c, size_t n);
+  /** Update CRC with given data using the portable slicing-by-8 implementation. */
+  void updateSlicing(const uint8_t *c, size_t n);
+  /** Update CRC with given data. Large buffers are split into chunks, processed concurrently and
+   * combined afterwards (see @c combine). Small buffers are processed by @c update directly. */
+  void updateParallel(const uint8_t *c, size_t n);
+  /** Update CRC with data of length @c n, the CRC @c crc was computed over separately (starting
+   * with the default initial value). The data itself is not needed. */
+  void append(uint32_t crc, uint64_t n);
   /** Returns the current CRC. */
-  inline uint32_t get() { return _crc; }
+  inline uint32_t get() const { return _crc; }
+
+  /** Returns the CRC register @c crc after feeding @c n zero bytes, in O(log n).
+   * As the CRC is linear, this allows one to correct a CRC computed over placeholder bytes
+   * that get patched later. */
+  static uint32_t shift(uint32_t crc, uint64_t n);
+  /** Returns the CRC of the concatenation of two blocks, given their CRCs @c crc1 and @c crc2
+   * (both starting with the default initial value) and the length @c n2 of the second block.
+   * Runs in O(log n2), hence CRCs of large regions can be assembled from cached CRCs of their
+   * parts. */
+  static uint32_t combine(uint32_t crc1, uint32_t crc2, uint64_t n2);
 
 protected:
   /** Current CRC. */
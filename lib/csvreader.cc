@@ -3,31 +3,33 @@
 #include "utils.hh"
 #include "logger.hh"
 
-#include <QRegExp>
 #include <QDebug>
 
-QVector< QPair<QRegExp, CSVLexer::Token::TokenType> > CSVLexer::_pattern = {
-  { QRegExp("^n([0-9]{3})"),                     CSVLexer::Token::T_DCS_N },
-  { QRegExp("^i([0-9]{3})"),                     CSVLexer::Token::T_DCS_I },
-  { QRegExp("^([a-zA-Z0-9]{1,6}-[0-9]{1,2})"),   CSVLexer::Token::T_APRSCALL },
-  { QRegExp("^([a-zA-Z_][a-zA-Z0-9_]*)"),        CSVLexer::Token::T_KEYWORD },
-  { QRegExp("^\"([^\"\r\n]*)\""),                CSVLexer::Token::T_STRING },
-  { QRegExp("^([+-]?[0-9]+(\\.[0-9]*)?)"),       CSVLexer::Token::T_NUMBER },
-  { QRegExp("^(:)"),                             CSVLexer::Token::T_COLON },
-  { QRegExp("^(-)"),                             CSVLexer::Token::T_NOT_SET },
-  { QRegExp("^(\\+)"),                           CSVLexer::Token::T_ENABLED },
-  { QRegExp("^(,)"),                             CSVLexer::Token::T_COMMA },
-  { QRegExp("^([ \t]+)"),                        CSVLexer::Token::T_WHITESPACE },
-  { QRegExp("^(\r?\n)"),                         CSVLexer::Token::T_NEWLINE},
-  { QRegExp("^(#[^\n\r]*)"),                     CSVLexer::Token::T_COMMENT},
-};
+/* ********************************************************************************************* *
+ * Character classes of the lexer
+ * ********************************************************************************************* */
+static inline bool isDigit(QChar c) {
+  return (c >= '0') && (c <= '9');
+}
+
+static inline bool isAlpha(QChar c) {
+  return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'));
+}
+
+static inline bool isAlphaNum(QChar c) {
+  return isAlpha(c) || isDigit(c);
+}
+
+static inline bool isIdentChar(QChar c) {
+  return isAlphaNum(c) || ('_' == c);
+}
 
 
 /* ********************************************************************************************* *
  * Implementation of CSVLexer
  * ********************************************************************************************* */
 CSVLexer::CSVLexer(QTextStream &stream, QObject *parent)
-  : QObject(parent), _errorMessage(), _stream(stream), _stack(), _currentLine()
+  : QObject(parent), _errorMessage(), _stream(stream), _stack(), _currentLine(), _linePos(0)
 {
   _stream.seek(0);
   _stack.reserve(10);
@@ -50,30 +52,144 @@ CSVLexer::next() {
 
 CSVLexer::Token
 CSVLexer::lex() {
-  if (_currentLine.isEmpty() && _stream.atEnd()) {
+  if ((_linePos >= _currentLine.size()) && _stream.atEnd()) {
     return {Token::T_END_OF_STREAM, "", _stack.back().line, _stack.back().column };
-  } else if (_currentLine.isEmpty()) {
+  } else if (_linePos >= _currentLine.size()) {
     Token token = {Token::T_NEWLINE, "", _stack.back().line, _stack.back().column };
     _stack.back().offset = _stream.pos();
     _currentLine = _stream.readLine();
+    _linePos = 0;
     _stack.back().line++;
     _stack.back().column = 1;
     return token;
   }
-  foreach (auto pattern, _pattern) {
-    if (0 == pattern.first.indexIn(_currentLine)) {
-      Token token = {pattern.second, pattern.first.cap(1), _stack.back().line, _stack.back().column};
-      _stack.back().offset += pattern.first.matchedLength();
-      _stack.back().column += token.value.size();
-      _currentLine = _currentLine.mid(pattern.first.matchedLength());
-      return token;
-    }
+
+  Token::TokenType type; int start=0, length=0, matched=0;
+  if (scan(QStringView(_currentLine).mid(_linePos), type, start, length, matched)) {
+    Token token = {type, _currentLine.mid(_linePos+start, length), _stack.back().line, _stack.back().column};
+    _stack.back().offset += matched;
+    _stack.back().column += length;
+    _linePos += matched;
+    return token;
   }
+
   _errorMessage = tr("Lexer error %1,%2: Unexpected char '%3'.").arg(_stack.back().line)
-      .arg(_stack.back().column).arg(_currentLine.at(0));
+      .arg(_stack.back().column).arg(_currentLine.at(_linePos));
   return {Token::T_ERROR, _errorMessage, _stack.back().line, _stack.back().column};
 }
 
+bool
+CSVLexer::scan(QStringView text, Token::TokenType &type, int &start, int &length, int &matched) {
+  int n = text.size();
+  QChar c = text.at(0);
+  start = 0;
+
+  // DCS codes: n or i followed by exactly 3 digits
+  if ((('n' == c) || ('i' == c)) && (n >= 4) && isDigit(text.at(1)) && isDigit(text.at(2))
+      && isDigit(text.at(3))) {
+    type = ('n' == c) ? Token::T_DCS_N : Token::T_DCS_I;
+    start = 1; length = 3; matched = 4;
+    return true;
+  }
+
+  // APRS call: 1-6 alphanumeric chars, a dash and 1-2 digits
+  if (isAlphaNum(c)) {
+    int i = 1;
+    while ((i < n) && (i < 7) && isAlphaNum(text.at(i)))
+      i++;
+    if ((i < 7) && ((i+1) < n) && ('-' == text.at(i)) && isDigit(text.at(i+1))) {
+      i += 2;
+      if ((i < n) && isDigit(text.at(i)))
+        i++;
+      type = Token::T_APRSCALL;
+      length = matched = i;
+      return true;
+    }
+  }
+
+  // Keyword or identifier
+  if (isAlpha(c) || ('_' == c)) {
+    int i = 1;
+    while ((i < n) && isIdentChar(text.at(i)))
+      i++;
+    type = Token::T_KEYWORD;
+    length = matched = i;
+    return true;
+  }
+
+  // Quoted string without line breaks, unterminated strings are errors
+  if ('"' == c) {
+    int i = 1;
+    while ((i < n) && ('"' != text.at(i)) && ('\r' != text.at(i)) && ('\n' != text.at(i)))
+      i++;
+    if ((i < n) && ('"' == text.at(i))) {
+      type = Token::T_STRING;
+      start = 1; length = i-1; matched = i+1;
+      return true;
+    }
+    return false;
+  }
+
+  // Number with optional sign and fractional part
+  {
+    int i = (('+' == c) || ('-' == c)) ? 1 : 0;
+    if ((i < n) && isDigit(text.at(i))) {
+      while ((i < n) && isDigit(text.at(i)))
+        i++;
+      if ((i < n) && ('.' == text.at(i))) {
+        i++;
+        while ((i < n) && isDigit(text.at(i)))
+          i++;
+      }
+      type = Token::T_NUMBER;
+      length = matched = i;
+      return true;
+    }
+  }
+
+  // Single character tokens
+  switch (c.unicode()) {
+  case ':': type = Token::T_COLON; length = matched = 1; return true;
+  case '-': type = Token::T_NOT_SET; length = matched = 1; return true;
+  case '+': type = Token::T_ENABLED; length = matched = 1; return true;
+  case ',': type = Token::T_COMMA; length = matched = 1; return true;
+  default: break;
+  }
+
+  // Whitespace
+  if ((' ' == c) || ('\t' == c)) {
+    int i = 1;
+    while ((i < n) && ((' ' == text.at(i)) || ('\t' == text.at(i))))
+      i++;
+    type = Token::T_WHITESPACE;
+    length = matched = i;
+    return true;
+  }
+
+  // Line breaks, usually removed when reading lines
+  if ('\n' == c) {
+    type = Token::T_NEWLINE;
+    length = matched = 1;
+    return true;
+  } else if (('\r' == c) && (n > 1) && ('\n' == text.at(1))) {
+    type = Token::T_NEWLINE;
+    length = matched = 2;
+    return true;
+  }
+
+  // Comment till the end of the line
+  if ('#' == c) {
+    int i = 1;
+    while ((i < n) && ('\n' != text.at(i)) && ('\r' != text.at(i)))
+      i++;
+    type = Token::T_COMMENT;
+    length = matched = i;
+    return true;
+  }
+
+  return false;
+}
+
 void
 CSVLexer::push() {
   _stack.push_back(_stack.back());
@@ -86,6 +202,7 @@ CSVLexer::pop() {
   _stack.pop_back();
   _stream.seek(_stack.back().offset);
   _currentLine = QString();
+  _linePos = 0;
 }
 
 /* ********************************************************************************************* *
@@ -2262,8 +2379,8 @@ CSVReader::handleRoamingZone(qint64 idx, const QString &name, const QList<qint64
             .arg(line).arg(column).arg(name).arg(i);
         return false;
       }
-      RoamingChannel *rch = RoamingChannel::fromDMRChannel(_channels[i]->as<DMRChannel>());
-      _config->roamingChannels()->add(rch);
+      // Channels used in several roaming zones share the same roaming channel
+      RoamingChannel *rch = _config->roamingChannels()->findOrCreate(_channels[i]->as<DMRChannel>());
       _roamingZones[idx]->addChannel(rch);
     }
     // done
@@ -5,6 +5,7 @@
 #include <QTextStream>
 #include <QMap>
 #include <QVector>
+#include <QStringView>
 
 #include "channel.hh"
 #include "contact.hh"
@@ -86,6 +87,12 @@ protected:
    * and comment. */
   Token lex();
 
+public:
+  /** Scans a single token at the beginning of the given text in one pass. On success, the token
+   * type, the position and length of its value within the text and the number of matched
+   * characters are returned. Returns @c false if no token matches. */
+  static bool scan(QStringView text, Token::TokenType &type, int &start, int &length, int &matched);
+
 protected:
   /// The error message.
   QString _errorMessage;
@@ -93,10 +100,10 @@ protected:
   QTextStream &_stream;
   /// The stack of saved lexer states
   QVector<State> _stack;
-  /// The current line count
+  /// The current line
   QString _currentLine;
-  /// The list of patterns to match
-  static QVector< QPair<QRegExp, Token::TokenType> > _pattern;
+  /// The position of the next token within the current line
+  int _linePos;
 };
 
 
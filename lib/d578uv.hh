@@ -31,7 +31,7 @@ public:
 
 private:
   /** Holds the limits for the radio. */
-  RadioLimits *_limits;
+  const RadioLimits *_limits;
 };
 
 #endif // __D878UV_HH__
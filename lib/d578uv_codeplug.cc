@@ -8,6 +8,7 @@
 #include "config.h"
 #include "logger.hh"
 #include "roamingchannel.hh"
+#include "tracer.hh"
 
 #include <QTimeZone>
 #include <QtEndian>
@@ -1893,6 +1894,7 @@ bool D578UVCodeplug::allocateBitmaps() {
 
 void
 D578UVCodeplug::allocateUpdated() {
+  TRACE_SPAN("D578UVCodeplug::allocateUpdated", "codeplug");
   D878UVCodeplug::allocateUpdated();
 
   this->allocateAirBand();
@@ -1910,33 +1912,20 @@ D578UVCodeplug::encodeChannels(const Flags &flags, Context &ctx, const ErrorStac
   // Encode channels
   for (int i=0; i<ctx.config()->channelList()->count(); i++) {
     // enable channel
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
+    ChannelElement ch(data(Table::channels().address(i)));
     ch.fromChannelObj(ctx.config()->channelList()->channel(i), ctx);
   }
   return true;
 }
 
-bool
-D578UVCodeplug::createChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-
+Channel *
+D578UVCodeplug::createChannel(unsigned int i, Context &ctx) {
+  // Check if channel is enabled:
   ChannelBitmapElement channel_bitmap(data(Offset::channelBitmap()));
-
-  // Create channels
-  for (uint16_t i=0; i<Limit::numChannels(); i++) {
-    // Check if channel is enabled:
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    if (! channel_bitmap.isEncoded(i))
-      continue;
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
-    if (Channel *obj = ch.toChannelObj(ctx)) {
-      ctx.config()->channelList()->add(obj); ctx.add(obj, i);
-    }
-  }
-  return true;
+  if ((i >= Limit::numChannels()) || (! channel_bitmap.isEncoded(i)))
+    return nullptr;
+  ChannelElement ch(data(Table::channels().address(i)));
+  return ch.toChannelObj(ctx);
 }
 
 bool
@@ -1948,11 +1937,9 @@ D578UVCodeplug::linkChannels(Context &ctx, const ErrorStack &err) {
   // Link channel objects
   for (uint16_t i=0; i<Limit::numChannels(); i++) {
     // Check if channel is enabled:
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
     if (! channel_bitmap.isEncoded(i))
       continue;
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
+    ChannelElement ch(data(Table::channels().address(i)));
     if (ctx.has<Channel>(i))
       ch.linkChannelObj(ctx.get<Channel>(i), ctx);
   }
@@ -1963,19 +1950,11 @@ D578UVCodeplug::linkChannels(Context &ctx, const ErrorStack &err) {
 void
 D578UVCodeplug::allocateContacts() {
   /* Allocate contacts */
-  ContactBitmapElement contact_bitmap(data(Offset::contactBitmap()));
-  unsigned contactCount=0;
-  for (uint16_t i=0; i<Limit::numContacts(); i++) {
-    if (! contact_bitmap.isEncoded(i))
-      continue;
-    contactCount++;
-    uint32_t bank_addr = Offset::contactBanks() + (i/Limit::contactsPerBank())*Offset::betweenContactBanks();
-    uint32_t addr = bank_addr + (i%Limit::contactsPerBank())*Offset::betweenContactBlocks();
-    if (!isAllocated(addr, 0)) {
-      image(0).addElement(addr, Offset::betweenContactBlocks());
-      memset(data(addr), 0x00, Offset::betweenContactBlocks());
-    }
-  }
+  unsigned contactCount = allocateTable(
+        Table::contacts(), ContactBitmapElement(data(Offset::contactBitmap())),
+        Limit::contactsPerBlock(), [this](uint32_t addr, uint32_t size) {
+    memset(data(addr), 0x00, size);
+  });
   if (contactCount) {
     image(0).addElement(Offset::contactIndex(), align_size(4*contactCount, 16));
     memset(data(Offset::contactIndex()), 0xff, align_size(4*contactCount, 16));
@@ -1991,9 +1970,7 @@ D578UVCodeplug::encodeContacts(const Flags &flags, Context &ctx, const ErrorStac
   QVector<DMRContact*> contacts;
   // Encode contacts and also collect id<->index map
   for (int i=0; i<ctx.config()->contacts()->digitalCount(); i++) {
-    uint32_t bank_addr = Offset::contactBanks() + (i/Limit::contactsPerBank())*Offset::betweenContactBanks();
-    uint32_t addr = bank_addr + (i%Limit::contactsPerBank())*ContactElement::size();
-    ContactElement con(data(addr));
+    ContactElement con(data(Table::contacts().address(i)));
     DMRContact *contact = ctx.config()->contacts()->digitalContact(i);
     if(! con.fromContactObj(contact, ctx))
       return false;
@@ -2006,13 +1983,25 @@ D578UVCodeplug::encodeContacts(const Flags &flags, Context &ctx, const ErrorStac
     return a->number() < b->number();
   });
   for (int i=0; i<contacts.size(); i++) {
-    ContactMapElement el(data(Offset::contactIdTable() + i*ContactMapElement::size()));
+    ContactMapView el(data(Offset::contactIdTable() + i*ContactMapView::size()));
     el.setID(contacts[i]->number(), (DMRContact::GroupCall==contacts[i]->type()));
     el.setIndex(ctx.index(contacts[i]));
   }
   return true;
 }
 
+D868UVCodeplug::SectionLayout
+D578UVCodeplug::sectionLayout(Sections::Section section) const {
+  SectionLayout layout = D878UVCodeplug::sectionLayout(section);
+  if (Sections::Channels == section) {
+    layout.name = "D578UV";
+  } else if (Sections::Contacts == section) {
+    layout.name = "D578UV";
+    layout.ranges.last().first = Offset::contactIdTable();
+  }
+  return layout;
+}
+
 void
 D578UVCodeplug::allocateGeneralSettings() {
   // override allocation of general settings for D878UV code-plug. General settings are larger!
@@ -1058,12 +1058,14 @@ protected:
   void allocateHotKeySettings();
 
   bool encodeChannels(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
-  bool createChannels(Context &ctx, const ErrorStack &err=ErrorStack());
+  Channel *createChannel(unsigned int i, Context &ctx);
   bool linkChannels(Context &ctx, const ErrorStack &err=ErrorStack());
 
   void allocateContacts();
   bool encodeContacts(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
 
+  SectionLayout sectionLayout(Sections::Section section) const;
+
   void allocateGeneralSettings();
   bool encodeGeneralSettings(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
   bool decodeGeneralSettings(Context &ctx, const ErrorStack &err=ErrorStack());
@@ -48,7 +48,7 @@ public:
 
 protected:
   /** Holds the limits for this radio.*/
-  RadioLimits *_limits;
+  const RadioLimits *_limits;
 };
 
 #endif // __D868UV_HH__
@@ -3,6 +3,9 @@
 #include "utils.hh"
 #include <QtEndian>
 
+/** Number of entries encoded at once, before the block gets marked as complete. */
+#define ENCODE_BLOCK_ENTRIES 0x8000
+
 
 /* ********************************************************************************************* *
  * Implementation of D868UVCallsignDB::EntryElement
@@ -54,13 +57,14 @@ D868UVCallsignDB::EntryElement::setContent(
     const QString &name, const QString &city, const QString &call, const QString &state,
     const QString &country, const QString &comment)
 {
+  // Pack strings back-to-back, each terminated by 0x00
   unsigned addr = 0x0006;
-  writeASCII(addr, name, 16, 0x00); addr += std::min(16, name.size()); setUInt8(addr, 0); addr++;
-  writeASCII(addr, city, 15, 0x00); addr += std::min(15, city.size()); setUInt8(addr, 0); addr++;
-  writeASCII(addr, call, 8, 0x00); addr += std::min(8, call.size()); setUInt8(addr, 0); addr++;
-  writeASCII(addr, state, 16, 0x00); addr += std::min(16, state.size()); setUInt8(addr, 0); addr++;
-  writeASCII(addr, country, 16, 0x00); addr += std::min(16, country.size()); setUInt8(addr, 0); addr++;
-  writeASCII(addr, comment, 16, 0x00); addr += std::min(16, comment.size()); setUInt8(addr, 0); addr++;
+  addr += pack_ascii(_data+addr, name, 16); setUInt8(addr++, 0);
+  addr += pack_ascii(_data+addr, city, 15); setUInt8(addr++, 0);
+  addr += pack_ascii(_data+addr, call, 8); setUInt8(addr++, 0);
+  addr += pack_ascii(_data+addr, state, 16); setUInt8(addr++, 0);
+  addr += pack_ascii(_data+addr, country, 16); setUInt8(addr++, 0);
+  addr += pack_ascii(_data+addr, comment, 16); setUInt8(addr++, 0);
 }
 
 unsigned
@@ -146,98 +150,134 @@ D868UVCallsignDB::D868UVCallsignDB(QObject *parent)
 }
 
 bool D868UVCallsignDB::encode(UserDatabase *db, const Selection &selection, const ErrorStack &err) {
-  Q_UNUSED(err)
 
-  // Determine size of call-sign DB in memory
+  // The index banks of the max. number of entries must not run into the limits and entries.
+  static_assert(indexTable(Offset::index(), Limit::entries()).isValid()
+                && (indexTable(Offset::index(), Limit::entries()).end() <= Offset::limits())
+                && (Offset::limits() < Offset::callsigns()),
+                "Index banks overlap the DB limits or entries.");
+
+  // Determine size of call-sign DB in memory, the selection may limit it further
   qint64 n = std::min(db->count(), qint64(Limit::entries()));
-  // If DB size is limited by settings
-  if (selection.hasCountLimit())
-    n = std::min(n, (qint64)selection.countLimit());
-
-  // Select n users and sort them in ascending order of their IDs
-  QVector<UserDatabase::User> users;
-  users.reserve(n);
-  for (unsigned i=0; i<n; i++)
-    users.append(db->user(i));
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
-
-  // Compute total size of callsign db entries
-  size_t dbSize = 0;
+
+  encodeUsers(db, selection, n, Limit::banks(),
+              Offset::limits(), Offset::index(), Offset::callsigns());
+  // A canceled encoding stops between blocks
+  return _cancel.check(err);
+}
+
+qint64
+D868UVCallsignDB::fittingUsers(UserDatabase *db, const QVector<int> &users, unsigned int banks) {
+  // Entries may span banks, hence only the total size matters
+  return CallsignDB::fittingUsers(entryOffsets(db, users, EntryElement::size),
+                                  qint64(banks)*EntryBankElement::size());
+}
+
+void
+D868UVCallsignDB::encodeUsers(UserDatabase *db, const Selection &selection, qint64 capacity,
+                              unsigned int banks, unsigned int limitsAddr, unsigned int indexAddr,
+                              unsigned int callsignsAddr)
+{
+  // Select users in ascending order of their IDs, as many as fit into the entry banks
+  QVector<int> users = sortedSelection(db, selection, capacity,
+                                       qint64(banks)*EntryBankElement::size(), EntryElement::size);
+  qint64 n = users.size();
+
+  // Compute the (virtual) offset of every entry, i.e., the offset without the gaps between the
+  // banks. Hence the total size of the callsign db entries is the last offset.
+  QVector<qint64> offsets = entryOffsets(db, users, EntryElement::size);
+  size_t dbSize = offsets[n];
   size_t indexSize = n*IndexEntryElement::size();
-  for (qint64 i=0; i<n; i++)
-    dbSize += EntryElement::size(users[i]);
 
   // Allocate DB limits
-  image(0).addElement(Offset::limits(), LimitsElement::size());
-  // Store DB limits
-  LimitsElement limits(data(Offset::limits()));
-  limits.clear();
-  limits.setCount(n);
-  limits.setTotalSize(dbSize);
+  image(0).addElement(limitsAddr, LimitsElement::size());
 
   // Allocate index banks
+  QVector<uint32_t> indexBankAddrs;
+  std::vector<AddressMap::Range> banks;
   for (int i=0; 0<indexSize; i++, indexSize-=std::min(indexSize, size_t(IndexBankElement::size()))) {
-    size_t addr = Offset::index() + i*Offset::betweenIndexBanks();
+    size_t addr = indexAddr + i*Offset::betweenIndexBanks();
     size_t size = align_size(std::min(indexSize, size_t(IndexBankElement::size())), 16);
-    image(0).addElement(addr, size);
-    memset(data(addr), 0xff, size);
+    banks.push_back({uint32_t(addr), uint32_t(size)});
+    indexBankAddrs.append(addr);
   }
+  image(0).addElements(banks, 0xff);
 
   // Allocate entry banks
+  QVector<uint32_t> entryBankAddrs;
+  banks.clear();
   for (int i=0; 0<dbSize; i++, dbSize-=std::min(dbSize, size_t(EntryBankElement::size()))) {
-    size_t addr = Offset::callsigns() + i*Offset::betweenCallsignBanks();
+    size_t addr = callsignsAddr + i*Offset::betweenCallsignBanks();
     size_t size = align_size(std::min(dbSize, size_t(EntryBankElement::size())), 16);
-    image(0).addElement(addr, size);
-    memset(data(addr), 0x00, size);
+    banks.push_back({uint32_t(addr), uint32_t(size)});
+    entryBankAddrs.append(addr);
   }
+  image(0).addElements(banks, 0x00);
+
+  // The layout is fixed now, the element data may move when compacted. Hence, resolve the
+  // pointers into the banks afterwards.
+  setAllocated();
+  QVector<uint8_t *> indexBanks, entryBanks;
+  foreach (uint32_t addr, indexBankAddrs)
+    indexBanks.append(data(addr));
+  foreach (uint32_t addr, entryBankAddrs)
+    entryBanks.append(data(addr));
+
+  // Store DB limits, the selection is known, hence the limits can be uploaded first
+  LimitsElement limits(data(limitsAddr));
+  limits.clear();
+  limits.setCount(n);
+  limits.setTotalSize(offsets[n]);
+  setEncoded(limitsAddr, LimitsElement::size());
 
-  // Fill index, the offset of the entry is not the real memory offset,
-  // but a virtual one without the gaps.
-  uint32_t entry_offset = 0;
-  uint32_t index_offset = 0;
-  uint32_t index_bank   = 0;
-  for (qint64 i=0; i<n; i++, index_offset+=IndexEntryElement::size()) {
-    if (IndexBankElement::size() <= index_offset) {
-      index_offset = 0; index_bank += 1;
+  // Fill index and entries in blocks, each block gets encoded concurrently and marked as
+  // complete afterwards. This allows to upload finished blocks while encoding the next.
+  const unsigned int entriesPerIndexBank = IndexBankElement::size()/IndexEntryView::size();
+  auto setEncodedBanks = [this](uint32_t addr, uint32_t between, qint64 bankSize, qint64 from, qint64 to) {
+    while (from < to) {
+      qint64 bank = from/bankSize, offset = from%bankSize, len = std::min(to-from, bankSize-offset);
+      setEncoded(addr + bank*between + offset, len);
+      from += len;
     }
-    IndexEntryElement index(data(Offset::index()+index_bank*Offset::betweenIndexBanks()+index_offset));
-    index.setID(users[i].id, false);
-    index.setIndex(entry_offset);
-    entry_offset += EntryElement::size(users[i]);
-  }
+  };
+  for (qint64 block=0; (block<n) && (! _cancel.isCanceled()); block+=ENCODE_BLOCK_ENTRIES) {
+    qint64 end = std::min(n, block+qint64(ENCODE_BLOCK_ENTRIES));
+    parallelFor(end-block, [&](qint64 blockFirst, qint64 blockLast) {
+      qint64 first = block+blockFirst, last = block+blockLast;
+      // Encode all IDs of the chunk at once
+      QVector<uint32_t> ids(last-first), bcdIDs(last-first);
+      for (qint64 i=first; i<last; i++)
+        ids[i-first] = db->user(users[i]).id;
+      encode_bcd8(bcdIDs.data(), ids.constData(), last-first);
+
+      for (qint64 i=first; i<last; i++) {
+        const UserDatabase::User &user = db->user(users[i]);
+
+        // Index entry, the offset of the entry is not the real memory offset
+        IndexEntryView index(indexBanks[i/entriesPerIndexBank]
+            + (i%entriesPerIndexBank)*IndexEntryView::size());
+        index.setBCDID(bcdIDs[i-first], false);
+        index.setIndex(offsets[i]);
 
-  // Then store DB entries
-  uint32_t entry_bank = 0;
-  entry_offset = 0;
-  for (qint64 i=0; i<n; i++) {
-    // Get size of current entry
-    uint32_t entry_size = EntryElement::size(users[i]);
-    // Check if entry fits into bank
-    if (EntryBankElement::size() < (entry_offset+entry_size)) {
-      // If not, split
-      uint8_t buffer[100]; EntryElement(buffer).fromUser(users[i]);
-      uint32_t n1 = (EntryBankElement::size()-entry_offset);
-      uint32_t n2 = entry_size-n1;
-      if (0 != n1) {
-        // Copy first half
-        uint8_t *ptr = data(Offset::callsigns()+entry_bank*Offset::betweenCallsignBanks()+entry_offset);
-        memcpy(ptr, buffer, n1);
+        // Entry, check if entry fits into bank
+        uint32_t bank = offsets[i]/EntryBankElement::size();
+        uint32_t offset = offsets[i]%EntryBankElement::size();
+        uint32_t size = offsets[i+1]-offsets[i];
+        if (EntryBankElement::size() < (offset+size)) {
+          // If not, split
+          uint8_t buffer[100]; EntryElement(buffer).fromUser(user);
+          uint32_t n1 = (EntryBankElement::size()-offset);
+          memcpy(entryBanks[bank]+offset, buffer, n1);
+          memcpy(entryBanks[bank+1], buffer+n1, size-n1);
+        } else {
+          // when it fits, just add
+          EntryElement(entryBanks[bank]+offset).fromUser(user);
+        }
       }
-      // advance bank counter
-      entry_bank++; entry_offset = 0;
-      // copy second half
-      uint8_t *ptr = data(Offset::callsigns()+entry_bank*Offset::betweenCallsignBanks()+entry_offset);
-      memcpy(ptr, buffer+n1, n2);
-      // Update offset
-      entry_offset += n2;
-    } else {
-      // when it fits, just add
-      EntryElement(data(Offset::callsigns()+entry_bank*Offset::betweenCallsignBanks()+entry_offset))
-          .fromUser(users[i]);
-      entry_offset += entry_size;
-    }
+    });
+    setEncodedBanks(indexAddr, Offset::betweenIndexBanks(), entriesPerIndexBank*IndexEntryView::size(),
+                    block*IndexEntryView::size(), end*IndexEntryView::size());
+    setEncodedBanks(callsignsAddr, Offset::betweenCallsignBanks(), EntryBankElement::size(),
+                    offsets[block], offsets[end]);
   }
-
-  return true;
 }
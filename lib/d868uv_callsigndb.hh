@@ -100,6 +100,8 @@ public:
   /** Same index entry used by the codeplug to map normal digital contacts to an contact index. Here
    * it maps to the byte offset within the database entries. */
   typedef D868UVCodeplug::ContactMapElement IndexEntryElement;
+  /** Non-polymorphic view of an index entry, used to encode the index. */
+  typedef D868UVCodeplug::ContactMapView IndexEntryView;
 
   /** Represents a bank of index entries. */
   class IndexBankElement: public Codeplug::Element
@@ -164,11 +166,17 @@ public:
   bool encode(UserDatabase *db, const Selection &selection=Selection(),
               const ErrorStack &err=ErrorStack());
 
+  /** Returns the number of the given users, that fit into the given number of entry banks. The
+   * users are taken in the given order. */
+  static qint64 fittingUsers(UserDatabase *db, const QVector<int> &users, unsigned int banks);
+
 public:
   /** Some limits for the call-sign DB. */
   struct Limit {
     /// Specifies the max number of entries in the DB.
     static constexpr unsigned int entries() { return 200000; }
+    /// Specifies the max number of entry banks, enough for the max number of entries of max size.
+    static constexpr unsigned int banks() { return 200; }
   };
 
 protected:
@@ -182,6 +190,21 @@ protected:
     static constexpr unsigned int limits()               { return 0x044C0000; }
     /// @endcond
   };
+
+  /** Returns the layout of the index banks at the given address, holding the given number of
+   * entries. Used to check the layout of the DB at compile time. */
+  static constexpr MemoryTable indexTable(unsigned int address, unsigned int entries) {
+    return {address, Offset::betweenIndexBanks(), IndexBankElement::size()/IndexEntryView::size(),
+            IndexEntryView::size(), IndexEntryView::size(), entries};
+  }
+
+  /** Encodes the users of the given user DB chosen by the @c selection, at most @c capacity users
+   * fitting into the given number of entry @c banks. The limits, index banks and callsign banks
+   * are placed at the given addresses. The entries and index slots are filled concurrently, as the
+   * offset of every entry is known in advance. Stops between blocks of entries, once the
+   * cancellation token got canceled. */
+  void encodeUsers(UserDatabase *db, const Selection &selection, qint64 capacity, unsigned int banks,
+                   unsigned int limitsAddr, unsigned int indexAddr, unsigned int callsignsAddr);
 };
 
 #endif // D868UVCALLSIGNDB_HH
@@ -7,7 +7,10 @@
 #include "userdatabase.hh"
 #include "config.h"
 #include "logger.hh"
+#include "anytone_extension.hh"
 #include "utils.hh"
+#include "tracer.hh"
+#include "codeplugtable.hh"
 #include <cmath>
 
 #include <QTimeZone>
@@ -1253,19 +1256,39 @@ D868UVCodeplug::GeneralSettingsElement::linkSettings(RadioSettings *settings, Co
  * Implementation of D868UVCodeplug
  * ******************************************************************************************** */
 D868UVCodeplug::D868UVCodeplug(const QString &label, QObject *parent)
-  : AnytoneCodeplug(label, parent)
+  : AnytoneCodeplug(label, parent), _encodeSource(nullptr)
 {
-  // pass...
+  // Check the layout of the banked tables at compile time
+  static_assert(Table::channels().isValid() && Table::contacts().isValid()
+                && Table::scanLists().isValid() && Table::messages().isValid(),
+                "Elements of a table overlap.");
+  static_assert(Table::zoneChannels().isValid() && Table::zoneNames().isValid()
+                && (! Table::zoneChannels().overlaps(Table::zoneNames())),
+                "Zone tables overlap.");
+  static_assert((! Table::channels().overlaps(Table::contacts()))
+                && (! Table::channels().overlaps(Table::scanLists()))
+                && (! Table::channels().overlaps(Table::messages()))
+                && (! Table::contacts().overlaps(Table::scanLists()))
+                && (! Table::contacts().overlaps(Table::messages()))
+                && (! Table::scanLists().overlaps(Table::messages())),
+                "Tables overlap.");
+  static_assert(! Table::channels().overlaps(Offset::vfoA(), 2*ChannelElement::size()),
+                "Channels overlap VFO settings.");
+  static_assert(Table::contacts().groupSize(Limit::contactsPerBlock()) == Offset::betweenContactBlocks(),
+                "Contact blocks do not match contact size.");
+  static_assert(Table::messages().groupSize(Limit::numMessagePerBank()) == Size::messageBank(),
+                "Message banks do not match message size.");
 }
 
 D868UVCodeplug::D868UVCodeplug(QObject *parent)
-  : AnytoneCodeplug("AnyTone AT-D868UV Codeplug", parent)
+  : AnytoneCodeplug("AnyTone AT-D868UV Codeplug", parent), _encodeSource(nullptr)
 {
   // pass...
 }
 
 void
 D868UVCodeplug::allocateUpdated() {
+  TRACE_SPAN("D868UVCodeplug::allocateUpdated", "codeplug");
   this->allocateVFOSettings();
 
   // General config
@@ -1297,6 +1320,7 @@ D868UVCodeplug::allocateUpdated() {
 
 void
 D868UVCodeplug::allocateForEncoding() {
+  TRACE_SPAN("D868UVCodeplug::allocateForEncoding", "codeplug");
   this->allocateChannels();
   this->allocateZones();
   this->allocateContacts();
@@ -1309,25 +1333,154 @@ D868UVCodeplug::allocateForEncoding() {
 
 void
 D868UVCodeplug::allocateForDecoding() {
+  TRACE_SPAN("D868UVCodeplug::allocateForDecoding", "codeplug");
+  // Only those sections selected get allocated, see Codeplug::setSections()
   this->allocateRadioIDs();
-  this->allocateChannels();
-  this->allocateZones();
-  this->allocateContacts();
-  this->allocateAnalogContacts();
-  this->allocateRXGroupLists();
-  this->allocateScanLists();
+  if (_sections.has(Sections::Channels)) {
+    this->allocateChannels();
+    this->allocateRepeaterOffsetFrequencies();
+  }
+  if (_sections.has(Sections::Zones))
+    this->allocateZones();
+  if (_sections.has(Sections::Contacts)) {
+    this->allocateContacts();
+    this->allocateAnalogContacts();
+  }
+  if (_sections.has(Sections::GroupLists))
+    this->allocateRXGroupLists();
+  if (_sections.has(Sections::ScanLists))
+    this->allocateScanLists();
 
   // General config
-  this->allocateGeneralSettings();
-  this->allocateZoneChannelList();
-  this->allocateBootSettings();
-  this->allocateRepeaterOffsetFrequencies();
-  this->allocateSMSMessages();
+  if (_sections.has(Sections::Settings)) {
+    this->allocateGeneralSettings();
+    this->allocateZoneChannelList();
+    this->allocateBootSettings();
+    this->allocateSMSMessages();
+  }
 
   // GPS settings
-  this->allocateGPSSystems();
+  if (_sections.has(Sections::Positioning))
+    this->allocateGPSSystems();
+}
+
+bool
+D868UVCodeplug::hasLazyDecoding() const {
+  return true;
 }
 
+QList<unsigned int>
+D868UVCodeplug::channelIndices() {
+  QList<unsigned int> indices;
+  ChannelBitmapElement channel_bitmap(data(Offset::channelBitmap()));
+  for (int i=channel_bitmap.nextEncoded(0); (i>=0) && (i<int(Limit::numChannels())); i=channel_bitmap.nextEncoded(i+1))
+    indices.append(i);
+  return indices;
+}
+
+Channel *
+D868UVCodeplug::decodeChannel(unsigned int idx, Context &ctx, const ErrorStack &err) {
+  Channel *ch = createChannel(idx, ctx);
+  if (nullptr == ch)
+    errMsg(err) << "There is no channel with index " << idx << ".";
+  return ch;
+}
+
+void
+D868UVCodeplug::startProgressiveDecoding() {
+  _channelPrefetch.reset(Limit::numChannels());
+}
+
+void
+D868UVCodeplug::elementReady(unsigned int img, uint32_t address, uint32_t size) {
+  if (0 != img)
+    return;
+
+  // Create all channels located completely within the range. The channel bitmap was read first.
+  uint32_t end = address + size;
+  constexpr MemoryTable channels = Table::channels();
+  for (unsigned int bank=0; bank<channels.banks(); bank++) {
+    unsigned int first = bank*channels.perBank, count = channels.bankCount(bank);
+    uint32_t bankStart = channels.bankAddress(bank), bankEnd = bankStart + channels.bankSize(bank);
+    if ((bankEnd <= address) || (bankStart >= end))
+      continue;
+    unsigned int i0 = (address <= bankStart) ?
+          0 : (address-bankStart + ChannelElement::size()-1)/ChannelElement::size();
+    unsigned int i1 = (end >= bankEnd) ? count : (end-bankStart)/ChannelElement::size();
+    if (i0 < i1) {
+      _channelPrefetch.schedule(first+i0, first+i1, [this](unsigned int i, Context &ctx) -> ConfigItem * {
+        return this->createChannel(i, ctx);
+      });
+    }
+  }
+}
+
+QStringList
+D868UVCodeplug::zoneNames(const ErrorStack &err) {
+  Q_UNUSED(err)
+  QStringList names;
+  ZoneBitmapElement zone_bitmap(data(Offset::zoneBitmap()));
+  for (int i=zone_bitmap.nextEncoded(0); (i>=0) && (i<int(Limit::numZones())); i=zone_bitmap.nextEncoded(i+1)) {
+    names.append(decode_ascii(data(Offset::zoneNames()+i*Offset::betweenZoneNames()),
+                              Limit::zoneNameLength(), 0));
+  }
+  return names;
+}
+
+QList<DMRRadioID *>
+D868UVCodeplug::decodeRadioIDs(Context &ctx, const ErrorStack &err) {
+  Q_UNUSED(ctx); Q_UNUSED(err)
+  QList<DMRRadioID *> ids;
+  RadioIDBitmapElement radio_id_bitmap(data(Offset::radioIDBitmap()));
+  for (int i=radio_id_bitmap.nextEncoded(0); (i>=0) && (i<int(Limit::numRadioIDs())); i=radio_id_bitmap.nextEncoded(i+1)) {
+    RadioIDElement id(data(Offset::radioIDs() + i*RadioIDElement::size()));
+    if (DMRRadioID *rid = id.toRadioID())
+      ids.append(rid);
+  }
+  return ids;
+}
+
+bool
+D868UVCodeplug::decodeChannelTable(ChannelTable &table, const ErrorStack &err) {
+  Q_UNUSED(err)
+  table.clear();
+  ChannelBitmapElement channel_bitmap(data(Offset::channelBitmap()));
+  table.reserve(channel_bitmap.count());
+  for (int i=channel_bitmap.nextEncoded(0); (i>=0) && (i<int(Limit::numChannels())); i=channel_bitmap.nextEncoded(i+1)) {
+    ChannelElement ch(data(Table::channels().address(i)));
+    int row = table.addRow();
+    table.index[row] = i;
+    table.name[row] = ch.name();
+    table.rxFrequency[row] = Frequency::fromHz(ch.rxFrequency());
+    table.txFrequency[row] = Frequency::fromHz(ch.txFrequency());
+    table.power[row] = ch.power();
+    table.rxOnly[row] = ch.rxOnly();
+    table.scanList[row] = ch.hasScanListIndex() ? int(ch.scanListIndex()) : -1;
+    if ((ChannelElement::Mode::Digital == ch.mode()) || (ChannelElement::Mode::MixedDigital == ch.mode())) {
+      table.digital[row] = true;
+      table.contact[row] = ch.contactIndex();
+      table.groupList[row] = ch.hasGroupListIndex() ? int(ch.groupListIndex()) : -1;
+    }
+  }
+  return true;
+}
+
+bool
+D868UVCodeplug::decodeContactTable(ContactTable &table, const ErrorStack &err) {
+  Q_UNUSED(err)
+  table.clear();
+  ContactBitmapElement contact_bitmap(data(Offset::contactBitmap()));
+  table.reserve(contact_bitmap.count());
+  for (int i=contact_bitmap.nextEncoded(0); (i>=0) && (i<int(Limit::numContacts())); i=contact_bitmap.nextEncoded(i+1)) {
+    ContactElement con(data(Table::contacts().address(i)));
+    int row = table.addRow();
+    table.index[row] = i;
+    table.name[row] = con.name();
+    table.number[row] = con.number();
+    table.type[row] = con.type();
+  }
+  return true;
+}
 
 bool
 D868UVCodeplug::allocateBitmaps() {
@@ -1406,103 +1559,226 @@ D868UVCodeplug::setBitmaps(Context& ctx)
 }
 
 
+bool
+D868UVCodeplug::encodeFrom(const D868UVCodeplug &source, Config *config, const Flags &flags,
+                           const ErrorStack &err)
+{
+  TRACE_SPAN("D868UVCodeplug::encodeFrom", "codeplug");
+  _encodeSource = &source;
+  bool success = this->encode(config, flags, err);
+  _encodeSource = nullptr;
+  return success;
+}
+
+D868UVCodeplug::SectionLayout
+D868UVCodeplug::sectionLayout(Sections::Section section) const {
+  SectionLayout layout;
+  switch (section) {
+  case Sections::Contacts:
+    layout.name = "D868UV";
+    layout.ranges.append({Offset::contactIndex(), align_size(4*Limit::numContacts(), 16)});
+    for (unsigned int b=0; b<Table::contacts().banks(); b++)
+      layout.ranges.append({Table::contacts().bankAddress(b), Table::contacts().bankSize(b)});
+    layout.ranges.append({Offset::dtmfIndex(), Limit::numDTMFContacts()});
+    layout.ranges.append({Offset::dtmfContacts(), Limit::numDTMFContacts()*DTMFContactElement::size()});
+    // The contact ID table must remain the last range, some codeplugs move it.
+    layout.ranges.append({Offset::contactIdTable(), align_size(ContactMapElement::size()*(1+Limit::numContacts()), 16)});
+    break;
+  case Sections::GroupLists:
+    layout.name = "D868UV";
+    layout.ranges.append({Offset::groupLists(), Limit::numGroupLists()*Offset::betweenGroupLists()});
+    break;
+  case Sections::Channels:
+    layout.name = "D868UV";
+    // Excludes the VFO settings following the last channel
+    for (unsigned int b=0; b<Table::channels().banks(); b++)
+      layout.ranges.append({Table::channels().bankAddress(b), Table::channels().bankSize(b)});
+    break;
+  case Sections::Zones:
+    layout.name = "D868UV";
+    layout.ranges.append({Offset::zoneChannels(), Limit::numZones()*Offset::betweenZoneChannels()});
+    layout.ranges.append({Offset::zoneNames(), Limit::numZones()*Offset::betweenZoneNames()});
+    break;
+  case Sections::ScanLists:
+    layout.name = "D868UV";
+    for (unsigned int b=0; b<Table::scanLists().banks(); b++)
+      layout.ranges.append({Table::scanLists().bankAddress(b),
+                            Table::scanLists().perBank*Offset::betweenScanLists()});
+    break;
+  default:
+    // Settings, radio IDs and positioning differ between the radios, always encode them.
+    break;
+  }
+  return layout;
+}
+
+bool
+D868UVCodeplug::copySection(const D868UVCodeplug &source, const SectionLayout &layout) {
+  const DFUFile::Image &from = source.image(0);
+  for (int i=0; i<image(0).numElements(); i++) {
+    uint32_t elStart = image(0).element(i).address(),
+        elEnd = elStart + image(0).element(i).memSize();
+    foreach (auto range, layout.ranges) {
+      uint32_t addr = std::max(elStart, range.first),
+          end = std::min(elEnd, range.first+range.second);
+      // Copy overlap, possibly spanning several elements of the source
+      while (addr < end) {
+        int j = from.findElement(addr);
+        if (0 > j)
+          return false;
+        uint32_t n = std::min(end, from.element(j).address()+from.element(j).memSize()) - addr;
+        memcpy(data(addr), source.data(addr), n);
+        addr += n;
+      }
+    }
+  }
+  return true;
+}
+
+void
+D868UVCodeplug::reportSection(Sections::Section section) {
+  if (nullptr == _encodeProgress)
+    return;
+  foreach (auto range, sectionLayout(section).ranges)
+    reportEncoded(range.first, range.second);
+}
+
 bool
 D868UVCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err)
 {
+  TRACE_SPAN("D868UVCodeplug::encodeElements", "codeplug");
+  // When encoding from another codeplug of the family, copy all sections encoded identically.
+  unsigned int reused = 0;
+  if (nullptr != _encodeSource) {
+    for (Sections::Section section: {Sections::Contacts, Sections::GroupLists, Sections::Channels,
+         Sections::Zones, Sections::ScanLists}) {
+      SectionLayout layout = sectionLayout(section);
+      if (layout.name.isEmpty() || (layout.name != _encodeSource->sectionLayout(section).name))
+        continue;
+      if (copySection(*_encodeSource, layout)) {
+        reused |= section;
+        reportSection(section);
+      }
+    }
+    logDebug() << "Reuse sections " << Sections(reused).format() << " of "
+               << _encodeSource->metaObject()->className() << ".";
+  }
+
   if (! this->encodeRadioID(flags, ctx, err))
     return false;
 
   if (! this->encodeGeneralSettings(flags, ctx, err))
     return false;
 
-  if (! this->encodeSMSMessages(flags, ctx, err))
-    return false;
-
   if (! this->encodeRepeaterOffsetFrequencies(flags, ctx, err))
     return false;
 
   if (! this->encodeBootSettings(flags, ctx, err))
     return false;
 
-  if (! this->encodeChannels(flags, ctx, err))
-    return false;
-
-  if (! this->encodeContacts(flags, ctx, err))
-    return false;
-
-  if (! this->encodeAnalogContacts(flags, ctx, err))
-    return false;
-
-  if (! this->encodeRXGroupLists(flags, ctx, err))
-    return false;
-
-  if (! this->encodeZones(flags, ctx, err))
-    return false;
-
-  if (! this->encodeScanLists(flags, ctx, err))
-    return false;
-
-  if (! this->encodeGPSSystems(flags, ctx, err))
-    return false;
-
-  return true;
+  // Reports a section as encoded, once its task succeeded. Then it may be uploaded while the
+  // remaining sections are being encoded (see AnytoneCodeplug::setEncodeProgress).
+  auto reporting = [this](Sections::Section section, const Task &task) -> Task {
+    return [this, section, task](const ErrorStack &err) {
+      if (! task(err))
+        return false;
+      this->reportSection(section);
+      return true;
+    };
+  };
+
+  // The remaining sections are independent of each other and occupy disjoint memory, hence they
+  // may be encoded concurrently. When encoding incrementally, unmodified sections are skipped.
+  QVector<Task> sections;
+  if (ctx.isDirty<SMSTemplate>())
+    sections.append([this, &flags, &ctx](const ErrorStack &err) { return this->encodeSMSMessages(flags, ctx, err); });
+  if (ctx.isDirty<Channel>() && (0 == (reused & Sections::Channels)))
+    sections.append(reporting(Sections::Channels, [this, &flags, &ctx](const ErrorStack &err) {
+      return this->encodeChannels(flags, ctx, err); }));
+  // Digital and analog contacts form a single section
+  if ((ctx.isDirty<DMRContact>() || ctx.isDirty<DTMFContact>()) && (0 == (reused & Sections::Contacts)))
+    sections.append(reporting(Sections::Contacts, [this, &flags, &ctx](const ErrorStack &err) {
+      return ((! ctx.isDirty<DMRContact>()) || this->encodeContacts(flags, ctx, err))
+          && ((! ctx.isDirty<DTMFContact>()) || this->encodeAnalogContacts(flags, ctx, err)); }));
+  if (ctx.isDirty<RXGroupList>() && (0 == (reused & Sections::GroupLists)))
+    sections.append(reporting(Sections::GroupLists, [this, &flags, &ctx](const ErrorStack &err) {
+      return this->encodeRXGroupLists(flags, ctx, err); }));
+  if (ctx.isDirty<Zone>() && (0 == (reused & Sections::Zones)))
+    sections.append(reporting(Sections::Zones, [this, &flags, &ctx](const ErrorStack &err) {
+      return this->encodeZones(flags, ctx, err); }));
+  if (ctx.isDirty<ScanList>() && (0 == (reused & Sections::ScanLists)))
+    sections.append(reporting(Sections::ScanLists, [this, &flags, &ctx](const ErrorStack &err) {
+      return this->encodeScanLists(flags, ctx, err); }));
+  // Positioning depends on the channels using it
+  if (ctx.isDirty<GPSSystem>() || ctx.isDirty<APRSSystem>() || ctx.isDirty<AnytoneAPRSFrequency>()
+      || ctx.isDirty<Channel>())
+    sections.append([this, &flags, &ctx](const ErrorStack &err) { return this->encodeGPSSystems(flags, ctx, err); });
+
+  return runTasks(sections, ctx, flags.encodeThreads, err);
 }
 
 bool
 D868UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err)
 {
+  TRACE_SPAN("D868UVCodeplug::decodeElements", "codeplug");
+  // Only the selected sections get decoded, these include all sections they depend on.
+  bool settings = _sections.has(Sections::Settings), channels = _sections.has(Sections::Channels),
+      contacts = _sections.has(Sections::Contacts), groupLists = _sections.has(Sections::GroupLists),
+      zones = _sections.has(Sections::Zones), scanLists = _sections.has(Sections::ScanLists),
+      positioning = _sections.has(Sections::Positioning);
+
   if (! this->setRadioID(ctx, err))
     return false;
 
-  if (! this->decodeGeneralSettings(ctx, err))
+  if (settings && (! this->decodeGeneralSettings(ctx, err)))
     return false;
 
-  if (! this->createSMSMessages(ctx, err))
+  if (settings && (! this->createSMSMessages(ctx, err)))
     return false;
 
-  if (! this->decodeRepeaterOffsetFrequencies(ctx, err))
+  if (channels && (! this->decodeRepeaterOffsetFrequencies(ctx, err)))
     return false;
 
-  if (! this->decodeBootSettings(ctx, err))
+  if (settings && (! this->decodeBootSettings(ctx, err)))
     return false;
 
-  if (! this->createChannels(ctx, err))
+  if (channels && (! this->createChannels(ctx, err)))
     return false;
 
-  if (! this->createContacts(ctx, err))
+  if (contacts && (! this->createContacts(ctx, err)))
     return false;
 
-  if (! this->createAnalogContacts(ctx, err))
+  if (contacts && (! this->createAnalogContacts(ctx, err)))
     return false;
 
-  if (! this->createRXGroupLists(ctx, err))
+  if (groupLists && (! this->createRXGroupLists(ctx, err)))
     return false;
 
-  if (! this->linkRXGroupLists(ctx, err))
+  if (groupLists && (! this->linkRXGroupLists(ctx, err)))
     return false;
 
-  if (! this->createZones(ctx, err))
+  if (zones && (! this->createZones(ctx, err)))
     return false;
 
-  if (! this->linkZones(ctx, err))
+  if (zones && (! this->linkZones(ctx, err)))
     return false;
 
-  if (! this->createScanLists(ctx, err))
+  if (scanLists && (! this->createScanLists(ctx, err)))
     return false;
 
-  if (! this->linkScanLists(ctx, err))
+  if (scanLists && (! this->linkScanLists(ctx, err)))
     return false;
 
-  if (! this->createGPSSystems(ctx, err))
+  if (positioning && (! this->createGPSSystems(ctx, err)))
     return false;
 
-  if (! this->linkChannels(ctx, err))
+  if (channels && (! this->linkChannels(ctx, err)))
     return false;
 
-  if (! this->linkGPSSystems(ctx, err))
+  if (positioning && (! this->linkGPSSystems(ctx, err)))
     return false;
 
-  if (! this->linkGeneralSettings(ctx, err)) {
+  if (settings && (! this->linkGeneralSettings(ctx, err))) {
     return false;
   }
 
@@ -1513,20 +1789,7 @@ D868UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err)
 void
 D868UVCodeplug::allocateChannels() {
   /* Allocate channels */
-  ChannelBitmapElement channel_bitmap(data(Offset::channelBitmap()));
-  for (uint16_t i=0; i<Limit::numChannels(); i++) {
-    // if disabled -> skip
-    if (! channel_bitmap.isEncoded(i))
-      continue;
-    // compute address for channel
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    uint32_t addr = Offset::channelBanks() +
-        + bank * Offset::betweenChannelBanks()
-        + idx * ChannelElement::size();
-    if (!isAllocated(addr, 0)) {
-      image(0).addElement(addr, ChannelElement::size());
-    }
-  }
+  allocateTable(Table::channels(), ChannelBitmapElement(data(Offset::channelBitmap())));
 }
 
 bool
@@ -1535,10 +1798,7 @@ D868UVCodeplug::encodeChannels(const Flags &flags, Context &ctx, const ErrorStac
 
   // Encode channels
   for (int i=0; i<ctx.config()->channelList()->count(); i++) {
-    // enable channel
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    ChannelElement ch(data(Offset::channelBanks() + bank * Offset::betweenChannelBanks()
-                           + idx * ChannelElement::size()));
+    ChannelElement ch(data(Table::channels().address(i)));
     if (! ch.fromChannelObj(ctx.config()->channelList()->channel(i), ctx))
       return false;
   }
@@ -1548,23 +1808,37 @@ D868UVCodeplug::encodeChannels(const Flags &flags, Context &ctx, const ErrorStac
 bool
 D868UVCodeplug::createChannels(Context &ctx, const ErrorStack &err) {
   Q_UNUSED(err)
-  ChannelBitmapElement channel_bitmap(data(Offset::channelBitmap()));
 
-  // Create channels
-  for (uint16_t i=0; i<Limit::numChannels(); i++) {
-    // Check if channel is enabled:
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    if (! channel_bitmap.isEncoded(i))
+  // Create channels, possibly concurrently. Take those created during the download.
+  _channelPrefetch.wait();
+  QVector<ConfigItem *> channels;
+  createObjects(Limit::numChannels(), [this, &ctx](unsigned int i) -> ConfigItem * {
+    if (_channelPrefetch.has(i))
+      return _channelPrefetch.take(i);
+    return this->createChannel(i, ctx);
+  }, channels, ctx);
+  _channelPrefetch.reset();
+
+  // Add channels in order
+  for (int i=0; i<channels.size(); i++) {
+    if (nullptr == channels[i])
       continue;
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
-    if (Channel *obj = ch.toChannelObj(ctx)) {
-      ctx.config()->channelList()->add(obj); ctx.add(obj, i);
-    }
+    Channel *obj = channels[i]->as<Channel>();
+    ctx.config()->channelList()->add(obj); ctx.add(obj, i);
   }
   return true;
 }
 
+Channel *
+D868UVCodeplug::createChannel(unsigned int i, Context &ctx) {
+  // Check if channel is enabled:
+  ChannelBitmapElement channel_bitmap(data(Offset::channelBitmap()));
+  if ((i >= Limit::numChannels()) || (! channel_bitmap.isEncoded(i)))
+    return nullptr;
+  ChannelElement ch(data(Table::channels().address(i)));
+  return ch.toChannelObj(ctx);
+}
+
 bool
 D868UVCodeplug::linkChannels(Context &ctx, const ErrorStack &err) {
   Q_UNUSED(err)
@@ -1574,9 +1848,7 @@ D868UVCodeplug::linkChannels(Context &ctx, const ErrorStack &err) {
     // Check if channel is enabled:
     if (! channel_bitmap.isEncoded(i))
       continue;
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
+    ChannelElement ch(data(Table::channels().address(i)));
     if (ctx.has<Channel>(i))
       ch.linkChannelObj(ctx.get<Channel>(i), ctx);
   }
@@ -1596,20 +1868,11 @@ D868UVCodeplug::allocateVFOSettings() {
 void
 D868UVCodeplug::allocateContacts() {
   /* Allocate contacts */
-  ContactBitmapElement contact_bitmap(data(Offset::contactBitmap()));
-  unsigned contactCount=0;
-  for (uint16_t i=0; i<Limit::numContacts(); i++) {
-    // enabled if false (ass hole)
-    if (! contact_bitmap.isEncoded(i))
-      continue;
-    contactCount++;
-    uint32_t bank_addr = Offset::contactBanks() + (i/Limit::contactsPerBank())*Offset::betweenContactBanks();
-    uint32_t addr = bank_addr + ((i%Limit::contactsPerBank())/Limit::contactsPerBlock())*Offset::betweenContactBlocks();
-    if (!isAllocated(addr, 0)) {
-      image(0).addElement(addr, Offset::betweenContactBlocks());
-      memset(data(addr), 0x00, Offset::betweenContactBlocks());
-    }
-  }
+  unsigned contactCount = allocateTable(
+        Table::contacts(), ContactBitmapElement(data(Offset::contactBitmap())),
+        Limit::contactsPerBlock(), [this](uint32_t addr, uint32_t size) {
+    memset(data(addr), 0x00, size);
+  });
 
   if (contactCount) {
     image(0).addElement(Offset::contactIndex(), align_size(4*contactCount, 16));
@@ -1626,9 +1889,7 @@ D868UVCodeplug::encodeContacts(const Flags &flags, Context &ctx, const ErrorStac
   QVector<DMRContact*> contacts;
   // Encode contacts and also collect id<->index map
   for (int i=0; i<ctx.config()->contacts()->digitalCount(); i++) {
-    uint32_t bank_addr = Offset::contactBanks() + (i/Limit::contactsPerBank())*Offset::betweenContactBanks();
-    uint32_t addr = bank_addr + (i%Limit::contactsPerBank())*ContactElement::size();
-    ContactElement con(data(addr));
+    ContactElement con(data(Table::contacts().address(i)));
     DMRContact *contact = ctx.config()->contacts()->digitalContact(i);
     if(! con.fromContactObj(contact, ctx))
       return false;
@@ -1641,7 +1902,7 @@ D868UVCodeplug::encodeContacts(const Flags &flags, Context &ctx, const ErrorStac
     return a->number() < b->number();
   });
   for (int i=0; i<contacts.size(); i++) {
-    ContactMapElement el(data(Offset::contactIdTable() + i*ContactMapElement::size()));
+    ContactMapView el(data(Offset::contactIdTable() + i*ContactMapView::size()));
     el.setID(contacts[i]->number(), (DMRContact::GroupCall==contacts[i]->type()));
     el.setIndex(ctx.index(contacts[i]));
   }
@@ -1652,18 +1913,23 @@ bool
 D868UVCodeplug::createContacts(Context &ctx, const ErrorStack &err) {
   Q_UNUSED(err)
 
-  // Create digital contacts
+  // Create digital contacts, possibly concurrently
   ContactBitmapElement contact_bitmap(data(Offset::contactBitmap()));
-  for (uint16_t i=0; i<Limit::numContacts(); i++) {
+  QVector<ConfigItem *> contacts;
+  createObjects(Limit::numContacts(), [this, &contact_bitmap, &ctx](unsigned int i) -> ConfigItem * {
     // Check if contact is enabled:
     if (! contact_bitmap.isEncoded(i))
+      return nullptr;
+    ContactElement con(data(Table::contacts().address(i)));
+    return con.toContactObj(ctx);
+  }, contacts, ctx);
+
+  // Add contacts in order
+  for (int i=0; i<contacts.size(); i++) {
+    if (nullptr == contacts[i])
       continue;
-    uint32_t bank_addr = Offset::contactBanks() + (i/Limit::contactsPerBank())*Offset::betweenContactBanks();
-    uint32_t addr = bank_addr + (i%Limit::contactsPerBank())*ContactElement::size();
-    ContactElement con(data(addr));
-    if (DMRContact *obj = con.toContactObj(ctx)) {
-      ctx.config()->contacts()->add(obj); ctx.add(obj, i);
-    }
+    DMRContact *obj = contacts[i]->as<DMRContact>();
+    ctx.config()->contacts()->add(obj); ctx.add(obj, i);
   }
   return true;
 }
@@ -1673,10 +1939,7 @@ void
 D868UVCodeplug::allocateAnalogContacts() {
   /* Allocate analog contacts */
   DTMFContactBytemapElement analog_contact_bytemap(data(Offset::dtmfContactBytemap()));
-  for (uint8_t i=0; i<Limit::numDTMFContacts(); i++) {
-    // if disabled -> skip
-    if (! analog_contact_bytemap.isEncoded(i))
-      continue;
+  for (int i=analog_contact_bytemap.nextEncoded(0); (i>=0) && (i<int(Limit::numDTMFContacts())); i=analog_contact_bytemap.nextEncoded(i+1)) {
     uint32_t bank_addr = Offset::dtmfContacts() + (i/2)*(2*DTMFContactElement::size());
     if (! isAllocated(bank_addr, 0)) {
       image(0).addElement(bank_addr, 2*DTMFContactElement::size());
@@ -1723,10 +1986,7 @@ void
 D868UVCodeplug::allocateRadioIDs() {
   /* Allocate radio IDs */
   RadioIDBitmapElement radioid_bitmap(data(Offset::radioIDBitmap()));
-  for (uint8_t i=0; i<Limit::numRadioIDs(); i++) {
-    // if disabled -> skip
-    if (! radioid_bitmap.isEncoded(i))
-      continue;
+  for (int i=radioid_bitmap.nextEncoded(0); (i>=0) && (i<int(Limit::numRadioIDs())); i=radioid_bitmap.nextEncoded(i+1)) {
     // Allocate radio IDs individually
     uint32_t addr = Offset::radioIDs() + i*RadioIDElement::size();
     if (! isAllocated(addr, 0)) {
@@ -1771,10 +2031,7 @@ D868UVCodeplug::allocateRXGroupLists() {
    * Allocate group lists
    */
   GroupListBitmapElement grouplist_bitmap(data(Offset::groupListBitmap()));
-  for (uint16_t i=0; i<Limit::numGroupLists(); i++) {
-    // if disabled -> skip
-    if (! grouplist_bitmap.isEncoded(i))
-      continue;
+  for (int i=grouplist_bitmap.nextEncoded(0); (i>=0) && (i<int(Limit::numGroupLists())); i=grouplist_bitmap.nextEncoded(i+1)) {
     // Allocate RX group lists indivitually
     uint32_t addr = Offset::groupLists() + i*Offset::betweenGroupLists();
     if (! isAllocated(addr, 0)) {
@@ -1841,15 +2098,10 @@ D868UVCodeplug::linkRXGroupLists(Context &ctx, const ErrorStack &err) {
 
 void
 D868UVCodeplug::allocateZones() {
+  // Allocate channel lists and names of the zones
   ZoneBitmapElement zone_bitmap(data(Offset::zoneBitmap()));
-  for (uint16_t i=0; i<Limit::numZones(); i++) {
-    // if invalid -> skip
-    if (! zone_bitmap.isEncoded(i))
-      continue;
-    // Allocate zone itself
-    image(0).addElement(Offset::zoneChannels()+i*Offset::betweenZoneChannels(), Size::zoneChannels());
-    image(0).addElement(Offset::zoneNames()+i*Offset::betweenZoneNames(), Size::zoneName());
-  }
+  allocateTable(Table::zoneChannels(), zone_bitmap);
+  allocateTable(Table::zoneNames(), zone_bitmap);
 }
 
 bool
@@ -1952,20 +2204,11 @@ D868UVCodeplug::linkZone(int i, Zone *zone, bool isB, Context &ctx, const ErrorS
 
 void
 D868UVCodeplug::allocateScanLists() {
-  ScanListBitmapElement scanlist_bitmap(data(Offset::scanListBitmap()));
-  for (uint8_t i=0; i<Limit::numScanLists(); i++) {
-    // if disabled -> skip
-    if (! scanlist_bitmap.isEncoded(i))
-      continue;
-    // Allocate scan lists indivitually
-    uint8_t bank = (i/Limit::numScanListsPerBank()), bank_idx = (i%Limit::numScanListsPerBank());
-    uint32_t addr = Offset::scanListBanks() + bank*Offset::betweenScanListBanks()
-        + bank_idx*Offset::betweenScanLists();
-    if (!isAllocated(addr, 0)) {
-      image(0).addElement(addr, ScanListElement::size());
-      ScanListElement(data(addr)).clear();
-    }
-  }
+  // Allocate scan lists indivitually
+  allocateTable(Table::scanLists(), ScanListBitmapElement(data(Offset::scanListBitmap())), 1,
+                [this](uint32_t addr, uint32_t size) {
+    Q_UNUSED(size); ScanListElement(data(addr)).clear();
+  });
 }
 
 bool
@@ -1975,9 +2218,7 @@ D868UVCodeplug::encodeScanLists(const Flags &flags, Context &ctx, const ErrorSta
   // Encode scan lists
   unsigned int num_scan_lists = std::min(Limit::numScanLists(), ctx.count<ScanList>());
   for (unsigned int i=0; i<num_scan_lists; i++) {
-    uint8_t bank = i/Limit::numScanListsPerBank(), idx = i%Limit::numScanListsPerBank();
-    ScanListElement scan(data(Offset::scanListBanks() + bank*Offset::betweenScanListBanks()
-                              + idx*Offset::betweenScanLists()));
+    ScanListElement scan(data(Table::scanLists().address(i)));
     scan.fromScanListObj(ctx.config()->scanlists()->scanlist(i), ctx);
   }
   return true;
@@ -1992,10 +2233,7 @@ D868UVCodeplug::createScanLists(Context &ctx, const ErrorStack &err) {
   for (unsigned int i=0; i<Limit::numScanLists(); i++) {
     if (! scanlist_bitmap.isEncoded(i))
       continue;
-    uint8_t bank = i/Limit::numScanListsPerBank(), bank_idx = i%Limit::numScanListsPerBank();
-    uint32_t addr = Offset::scanListBanks() + bank*Offset::betweenScanListBanks()
-        + bank_idx*Offset::betweenScanLists();
-    ScanListElement scanl(data(addr));
+    ScanListElement scanl(data(Table::scanLists().address(i)));
     // Create scanlist
     ScanList *obj = scanl.toScanListObj();
     ctx.config()->scanlists()->add(obj); ctx.add(obj, i);
@@ -2011,10 +2249,7 @@ D868UVCodeplug::linkScanLists(Context &ctx, const ErrorStack &err) {
   for (unsigned i=0; i<Limit::numScanLists(); i++) {
     if (! scanlist_bitmap.isEncoded(i))
       continue;
-    uint8_t bank = i/Limit::numScanListsPerBank(), bank_idx = i%Limit::numScanListsPerBank();
-    uint32_t addr = Offset::scanListBanks() + bank*Offset::betweenScanListBanks()
-        + bank_idx*Offset::betweenScanLists();
-    ScanListElement scanl(data(addr));
+    ScanListElement scanl(data(Table::scanLists().address(i)));
     // Create scanlist
     ScanList *obj = ctx.get<ScanList>(i);
     // Link scanlists immediately, all channels are defined already
@@ -2104,13 +2339,11 @@ D868UVCodeplug::createGPSSystems(Context &ctx, const ErrorStack &err) {
   ChannelBitmapElement channel_bitmap(data(Offset::channelBitmap()));
   for (uint16_t i=0; i<Limit::numChannels(); i++) {
     // Check if channel is enabled:
-    uint16_t  bank = i/128, idx = i%128;
     if (! channel_bitmap.isEncoded(i))
       continue;
     if (ctx.get<Channel>(i)->is<FMChannel>())
       continue;
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
+    ChannelElement ch(data(Table::channels().address(i)));
     if (ch.txDigitalAPRS())
       systems.insert(ch.digitalAPRSSystemIndex());
   }
@@ -2139,17 +2372,10 @@ D868UVCodeplug::linkGPSSystems(Context &ctx, const ErrorStack &err) {
 void
 D868UVCodeplug::allocateSMSMessages() {
   // Prefab. SMS messages
-  MessageBytemapElement messages_bytemap(data(Offset::messageBytemap()));
-  unsigned message_count = 0;
-  for (uint8_t i=0; i<Limit::numMessages(); i++) {
-    if (! messages_bytemap.isEncoded(i))
-      continue;
-    message_count++;
-    uint32_t addr = Offset::messageBanks() + (i/Limit::numMessagePerBank())*Offset::betweenMessageBanks();
-    if (!isAllocated(addr, 0)) {
-      image(0).addElement(addr, Size::messageBank());
-    }
-  }
+  // Messages are allocated in entire banks
+  unsigned message_count = allocateTable(
+        Table::messages(), MessageBytemapElement(data(Offset::messageBytemap())),
+        Limit::numMessagePerBank());
   if (message_count) {
     image(0).addElement(Offset::messageIndex(), Size::messageIndex()*message_count);
   }
@@ -2159,9 +2385,7 @@ bool
 D868UVCodeplug::encodeSMSMessages(const Flags &flags, Context &ctx, const ErrorStack &err) {
   Q_UNUSED(flags); Q_UNUSED(err)
   for (unsigned int i=0; i<ctx.count<SMSTemplate>(); i++) {
-    unsigned int bank = i/Limit::numMessagePerBank(), msg_idx = i % Limit::numMessagePerBank();
-    unsigned int addr = Offset::messageBanks() + bank*Offset::betweenMessageBanks() + msg_idx*MessageElement::size();
-    MessageElement message(data(addr));
+    MessageElement message(data(Table::messages().address(i)));
     message.setMessage(ctx.get<SMSTemplate>(i)->message());
     MessageListElement listElement(data(Offset::messageIndex() + i*Size::messageIndex()));
     listElement.setIndex(i);
@@ -2180,9 +2404,7 @@ D868UVCodeplug::createSMSMessages(Context &ctx, const ErrorStack &err) {
   for (unsigned int i=0; i<Limit::numMessages(); i++) {
     if (! messages_bytemap.isEncoded(i))
       continue;
-    unsigned int bank = i/Limit::numMessagePerBank(), msg_idx = i % Limit::numMessagePerBank();
-    unsigned int addr = Offset::messageBanks() + bank*Offset::betweenMessageBanks() + msg_idx*MessageElement::size();
-    MessageElement message(data(addr));
+    MessageElement message(data(Table::messages().address(i)));
     SMSTemplate *temp = new SMSTemplate();
     temp->setName(QString("SMS %1").arg(i+1));
     temp->setMessage(message.message());
@@ -2277,9 +2499,7 @@ void
 D868UVCodeplug::allocate5ToneIDs() {
   // Allocate 5-tone functions
   FiveToneIDBitmapElement bitmap(data(Offset::fiveToneIdBitmap()));
-  for (uint8_t i=0; i<FiveToneIDListElement::Limit::numEntries(); i++) {
-    if (! bitmap.isEncoded(i))
-      continue;
+  for (int i=bitmap.nextEncoded(0); (i>=0) && (i<int(FiveToneIDListElement::Limit::numEntries())); i=bitmap.nextEncoded(i+1)) {
     image(0).addElement(Offset::fiveToneIdList() + i*FiveToneIDElement::size(), FiveToneIDElement::size());
   }
 }
@@ -2298,9 +2518,7 @@ void
 D868UVCodeplug::allocate2ToneIDs() {
   // Allocate 2-tone encoding
   TwoToneIDBitmapElement enc_bitmap(data(Offset::twoToneIdBitmap()));
-  for (uint8_t i=0; i<Limit::numTwoToneIDs(); i++) {
-    if (! enc_bitmap.isEncoded(i))
-      continue;
+  for (int i=enc_bitmap.nextEncoded(0); (i>=0) && (i<int(Limit::numTwoToneIDs())); i=enc_bitmap.nextEncoded(i+1)) {
     image(0).addElement(Offset::twoToneIdList() + i*TwoToneIDElement::size(), TwoToneIDElement::size());
   }
 }
@@ -2310,9 +2528,7 @@ void
 D868UVCodeplug::allocate2ToneFunctions() {
   // Allocate 2-tone decoding
   TwoToneFunctionBitmapElement dec_bitmap(data(Offset::twoToneFunctionBitmap()));
-  for (uint8_t i=0; i<Limit::numTwoToneFunctions(); i++) {
-    if (! dec_bitmap.isEncoded(i))
-      continue;
+  for (int i=dec_bitmap.nextEncoded(0); (i>=0) && (i<int(Limit::numTwoToneFunctions())); i=dec_bitmap.nextEncoded(i+1)) {
     image(0).addElement(Offset::twoToneFunctionList() + i*TwoToneFunctionElement::size(),
                         TwoToneFunctionElement::size());
   }
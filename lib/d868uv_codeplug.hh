@@ -4,6 +4,7 @@
 #include <QDateTime>
 
 #include "anytone_codeplug.hh"
+#include "codeplugprefetch.hh"
 #include "signaling.hh"
 
 class Channel;
@@ -644,6 +645,46 @@ public:
   /** Empty constructor. */
   explicit D868UVCodeplug(QObject *parent = nullptr);
 
+  bool hasLazyDecoding() const;
+  QList<unsigned int> channelIndices();
+  Channel *decodeChannel(unsigned int idx, Context &ctx, const ErrorStack &err=ErrorStack());
+  QStringList zoneNames(const ErrorStack &err=ErrorStack());
+  QList<DMRRadioID *> decodeRadioIDs(Context &ctx, const ErrorStack &err=ErrorStack());
+  bool decodeChannelTable(ChannelTable &table, const ErrorStack &err=ErrorStack());
+  bool decodeContactTable(ContactTable &table, const ErrorStack &err=ErrorStack());
+
+  void startProgressiveDecoding();
+  void elementReady(unsigned int image, uint32_t address, uint32_t size);
+
+  /** Encodes the given config, reusing all sections already encoded by another codeplug of the
+   * same family. E.g., when the same config gets encoded for a D878UV and a D878UVII.
+   *
+   * Sections encoded identically by both codeplugs (see @c sectionLayout) are copied from the
+   * @c source, only the remaining sections get encoded. The @c source must have been encoded
+   * from the same config with the same flags. */
+  bool encodeFrom(const D868UVCodeplug &source, Config *config, const Flags &flags=Flags(),
+                  const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Describes how a section of the codeplug is encoded. */
+  struct SectionLayout {
+    /** Identifies the encoding of the section. Codeplugs encode sections with the same name
+     * identically at the same addresses. An empty name marks sections, that are never shared. */
+    QString name;
+    /** The address ranges (address, size) holding the encoded section. */
+    QVector<QPair<uint32_t, uint32_t>> ranges;
+  };
+
+  /** Returns the layout of the given section. The default implementation describes the
+   * contacts, group lists, channels, zones and scan lists of the D868UV codeplug. */
+  virtual SectionLayout sectionLayout(Sections::Section section) const;
+  /** Copies all allocated memory within the given section from the @c source. Returns @c false
+   * if the source does not hold all the memory. */
+  bool copySection(const D868UVCodeplug &source, const SectionLayout &layout);
+  /** Reports the memory of the given section as encoded (see @c sectionLayout and
+   * @c AnytoneCodeplug::reportEncoded). */
+  void reportSection(Sections::Section section);
+
 protected:
   bool allocateBitmaps();
   virtual void setBitmaps(Context &ctx);
@@ -660,6 +701,9 @@ protected:
   virtual bool encodeChannels(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
   /** Create channels from codeplug. */
   virtual bool createChannels(Context &ctx, const ErrorStack &err=ErrorStack());
+  /** Creates the channel with the given index from the codeplug, without linking it.
+   * @returns @c nullptr if the channel is not encoded. */
+  virtual Channel *createChannel(unsigned int i, Context &ctx);
   /** Link channels. */
   virtual bool linkChannels(Context &ctx, const ErrorStack &err=ErrorStack());
 
@@ -793,6 +837,12 @@ protected:
   /** Allocates DTMF settings. */
   virtual void allocateDTMFSettings();
 
+protected:
+  /** Channels created while the codeplug gets downloaded. */
+  CodeplugPrefetch _channelPrefetch;
+  /** The codeplug to copy shared sections from, set during @c encodeFrom. */
+  const D868UVCodeplug *_encodeSource;
+
 public:
   /** Some limits for the codeplug. */
   struct Limit {
@@ -908,6 +958,37 @@ protected:
     static constexpr unsigned int messageIndex()         { return 0x0010; }
     /// @endcond
   };
+
+  /** The banked tables of the codeplug, given by the offsets and limits above. The addresses of
+   * their elements are computed by the compiler, where possible. */
+  struct Table {
+    /// @cond DO_NOT_DOCUMENT
+    static constexpr MemoryTable channels() {
+      return {Offset::channelBanks(), Offset::betweenChannelBanks(), Limit::channelsPerBank(),
+              ChannelElement::size(), ChannelElement::size(), Limit::numChannels()};
+    }
+    static constexpr MemoryTable contacts() {
+      return {Offset::contactBanks(), Offset::betweenContactBanks(), Limit::contactsPerBank(),
+              ContactElement::size(), ContactElement::size(), Limit::numContacts()};
+    }
+    static constexpr MemoryTable scanLists() {
+      return {Offset::scanListBanks(), Offset::betweenScanListBanks(), Limit::numScanListsPerBank(),
+              Offset::betweenScanLists(), ScanListElement::size(), Limit::numScanLists()};
+    }
+    static constexpr MemoryTable messages() {
+      return {Offset::messageBanks(), Offset::betweenMessageBanks(), Limit::numMessagePerBank(),
+              MessageElement::size(), MessageElement::size(), Limit::numMessages()};
+    }
+    static constexpr MemoryTable zoneChannels() {
+      return {Offset::zoneChannels(), Limit::numZones()*Offset::betweenZoneChannels(), Limit::numZones(),
+              Offset::betweenZoneChannels(), Size::zoneChannels(), Limit::numZones()};
+    }
+    static constexpr MemoryTable zoneNames() {
+      return {Offset::zoneNames(), Limit::numZones()*Offset::betweenZoneNames(), Limit::numZones(),
+              Offset::betweenZoneNames(), Size::zoneName(), Limit::numZones()};
+    }
+    /// @endcond
+  };
 };
 
 #endif // D868UVCODEPLUG_HH
@@ -47,7 +47,7 @@ public:
   static RadioInfo defaultRadioInfo();
 
 private:
-  RadioLimits *_limits;
+  const RadioLimits *_limits;
 };
 
 #endif // __D878UV_HH__
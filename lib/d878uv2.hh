@@ -48,7 +48,7 @@ public:
 
 private:
   /** The limits for the radio. */
-  RadioLimits *_limits;
+  const RadioLimits *_limits;
 };
 
 #endif // __D878UV2_HH__
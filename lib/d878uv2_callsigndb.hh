@@ -40,6 +40,8 @@ public:
   struct Limit : public D868UVCallsignDB::Limit {
     /// Specifies the max number of entries in the call-sign DB. */
     static constexpr unsigned int entries() { return 500000; }
+    /// Specifies the max number of entry banks, enough for the max number of entries of max size.
+    static constexpr unsigned int banks() { return 500; }
   };
 
 protected:
@@ -32,20 +32,11 @@ D878UV2Codeplug::D878UV2Codeplug(QObject *parent)
 void
 D878UV2Codeplug::allocateContacts() {
   /* Allocate contacts */
-  ContactBitmapElement contact_bitmap(data(Offset::contactBitmap()));
-  unsigned contactCount=0;
-  for (uint16_t i=0; i<Limit::numContacts(); i++) {
-    // enabled if false (ass hole)
-    if (! contact_bitmap.isEncoded(i))
-      continue;
-    contactCount++;
-    uint32_t bank_addr = Offset::contactBanks() + (contactCount/Limit::contactsPerBank())*Offset::betweenContactBanks();
-    uint32_t addr = bank_addr + ((i%Limit::contactsPerBank())/Limit::contactsPerBlock())*Offset::betweenContactBlocks();
-    if (! isAllocated(addr, 0)) {
-      image(0).addElement(addr, Offset::betweenContactBlocks());
-      memset(data(addr), 0x00, Offset::betweenContactBlocks());
-    }
-  }
+  unsigned contactCount = allocateTable(
+        Table::contacts(), ContactBitmapElement(data(Offset::contactBitmap())),
+        Limit::contactsPerBlock(), [this](uint32_t addr, uint32_t size) {
+    memset(data(addr), 0x00, size);
+  });
   if (contactCount) {
     image(0).addElement(Offset::contactIndex(), align_size(4*contactCount, 16));
     memset(data(Offset::contactIndex()), 0xff, align_size(4*contactCount, 16));
@@ -61,9 +52,7 @@ D878UV2Codeplug::encodeContacts(const Flags &flags, Context &ctx, const ErrorSta
   QVector<DMRContact*> contacts;
   // Encode contacts and also collect id<->index map
   for (int i=0; i<ctx.config()->contacts()->digitalCount(); i++) {
-    uint32_t bank_addr = Offset::contactBanks() + (i/Limit::contactsPerBank())*Offset::betweenContactBanks();
-    uint32_t addr = bank_addr + (i%Limit::contactsPerBank())*ContactElement::size();
-    ContactElement con(data(addr));
+    ContactElement con(data(Table::contacts().address(i)));
     DMRContact *contact = ctx.config()->contacts()->digitalContact(i);
     if(! con.fromContactObj(contact, ctx))
       return false;
@@ -76,11 +65,19 @@ D878UV2Codeplug::encodeContacts(const Flags &flags, Context &ctx, const ErrorSta
     return a->number() < b->number();
   });
   for (int i=0; i<contacts.size(); i++) {
-    ContactMapElement el(data(Offset::contactIdTable() + i*ContactMapElement::size()));
+    ContactMapView el(data(Offset::contactIdTable() + i*ContactMapView::size()));
     el.setID(contacts[i]->number(), (DMRContact::GroupCall==contacts[i]->type()));
     el.setIndex(ctx.index(contacts[i]));
   }
   return true;
 }
 
-
+D868UVCodeplug::SectionLayout
+D878UV2Codeplug::sectionLayout(Sections::Section section) const {
+  SectionLayout layout = D878UVCodeplug::sectionLayout(section);
+  if (Sections::Contacts == section) {
+    layout.name = "D878UV2";
+    layout.ranges.last().first = Offset::contactIdTable();
+  }
+  return layout;
+}
@@ -209,6 +209,8 @@ protected:
   void allocateContacts();
   bool encodeContacts(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
 
+  SectionLayout sectionLayout(Sections::Section section) const;
+
 protected:
   /** Internal used offsets within the codeplug. */
   struct Offset: public D878UVCodeplug::Offset {
@@ -8,6 +8,7 @@
 #include "config.h"
 #include "logger.hh"
 #include "channel.hh"
+#include "tracer.hh"
 
 #include <QTimeZone>
 #include <QtEndian>
@@ -3387,6 +3388,7 @@ D878UVCodeplug::allocateBitmaps() {
 
 void
 D878UVCodeplug::allocateUpdated() {
+  TRACE_SPAN("D878UVCodeplug::allocateUpdated", "codeplug");
   // First allocate everything common between D868UV and D878UV codeplugs.
   D868UVCodeplug::allocateUpdated();
 
@@ -3403,6 +3405,7 @@ D878UVCodeplug::allocateUpdated() {
 
 void
 D878UVCodeplug::allocateForEncoding() {
+  TRACE_SPAN("D878UVCodeplug::allocateForEncoding", "codeplug");
   // First allocate everything common between D868UV and D878UV codeplugs.
   D868UVCodeplug::allocateForEncoding();
   this->allocateRoaming();
@@ -3410,11 +3413,14 @@ D878UVCodeplug::allocateForEncoding() {
 
 void
 D878UVCodeplug::allocateForDecoding() {
+  TRACE_SPAN("D878UVCodeplug::allocateForDecoding", "codeplug");
   // First allocate everything common between D868UV and D878UV codeplugs.
   D868UVCodeplug::allocateForDecoding();
-  this->allocateRoaming();
+  if (_sections.has(Sections::Roaming))
+    this->allocateRoaming();
   // allocate FM APRS frequency names
-  image(0).addElement(Offset::fmAPRSFrequencyNames(), FMAPRSFrequencyNamesElement::size());
+  if (_sections.has(Sections::Positioning))
+    image(0).addElement(Offset::fmAPRSFrequencyNames(), FMAPRSFrequencyNamesElement::size());
 }
 
 void
@@ -3437,24 +3443,47 @@ D878UVCodeplug::setBitmaps(Context& ctx)
 bool
 D878UVCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err)
 {
+  TRACE_SPAN("D878UVCodeplug::encodeElements", "codeplug");
   // Encode everything common between d868uv and d878uv radios.
   if (! D868UVCodeplug::encodeElements(flags, ctx, err))
     return false;
 
-  if (! this->encodeRoaming(flags, ctx, err))
+  if ((ctx.isDirty<RoamingChannel>() || ctx.isDirty<RoamingZone>())
+      && (! this->encodeRoaming(flags, ctx, err)))
     return false;
 
   return true;
 }
 
 
+D868UVCodeplug::SectionLayout
+D878UVCodeplug::sectionLayout(Sections::Section section) const {
+  SectionLayout layout = D868UVCodeplug::sectionLayout(section);
+  if (Sections::Channels == section) {
+    // Channels are extended by a second element, 0x2000 bytes behind the first
+    layout.name = "D878UV";
+    int n = layout.ranges.size();
+    for (int i=0; i<n; i++)
+      layout.ranges.append({layout.ranges[i].first+0x2000, layout.ranges[i].second});
+  } else if (Sections::Zones == section) {
+    layout.name = "D878UV";
+    layout.ranges.append({Offset::hiddenZoneBitmap(), HiddenZoneBitmapElement::size()});
+  }
+  return layout;
+}
+
+
 bool
 D878UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err)
 {
+  TRACE_SPAN("D878UVCodeplug::decodeElements", "codeplug");
   // Decode everything commong between d868uv and d878uv codeplugs.
   if (! D868UVCodeplug::decodeElements(ctx, err))
     return false;
 
+  if (! _sections.has(Sections::Roaming))
+    return true;
+
   if (! this->createRoaming(ctx, err))
     return false;
 
@@ -3473,9 +3502,7 @@ D878UVCodeplug::allocateChannels() {
     if (! channel_bitmap.isEncoded(i))
       continue;
     // compute address for channel
-    uint16_t bank = i/Limit::channelsPerBank(), idx=i%Limit::channelsPerBank();
-    uint32_t addr = Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-        + idx * ChannelElement::size();
+    uint32_t addr = Table::channels().address(i);
     if (!isAllocated(addr, 0)) {
       image(0).addElement(addr, ChannelElement::size());
     }
@@ -3492,32 +3519,20 @@ D878UVCodeplug::encodeChannels(const Flags &flags, Context &ctx, const ErrorStac
   // Encode channels
   for (int i=0; i<ctx.config()->channelList()->count(); i++) {
     // enable channel
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
+    ChannelElement ch(data(Table::channels().address(i)));
     ch.fromChannelObj(ctx.config()->channelList()->channel(i), ctx);
   }
   return true;
 }
 
-bool
-D878UVCodeplug::createChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-
-  // Create channels
+Channel *
+D878UVCodeplug::createChannel(unsigned int i, Context &ctx) {
+  // Check if channel is enabled:
   ChannelBitmapElement channel_bitmap(data(Offset::channelBitmap()));
-  for (uint16_t i=0; i<Limit::numChannels(); i++) {
-    // Check if channel is enabled:
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    if (! channel_bitmap.isEncoded(i))
-      continue;
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
-    if (Channel *obj = ch.toChannelObj(ctx)) {
-      ctx.config()->channelList()->add(obj); ctx.add(obj, i);
-    }
-  }
-  return true;
+  if ((i >= Limit::numChannels()) || (! channel_bitmap.isEncoded(i)))
+    return nullptr;
+  ChannelElement ch(data(Table::channels().address(i)));
+  return ch.toChannelObj(ctx);
 }
 
 bool
@@ -3528,11 +3543,9 @@ D878UVCodeplug::linkChannels(Context &ctx, const ErrorStack &err) {
   // Link channel objects
   for (uint16_t i=0; i<Limit::numChannels(); i++) {
     // Check if channel is enabled:
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
     if (! channel_bitmap.isEncoded(i))
       continue;
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
+    ChannelElement ch(data(Table::channels().address(i)));
     if (ctx.has<Channel>(i))
       ch.linkChannelObj(ctx.get<Channel>(i), ctx);
   }
@@ -3721,35 +3734,15 @@ D878UVCodeplug::linkGPSSystems(Context &ctx, const ErrorStack &err) {
 
 void
 D878UVCodeplug::allocateRoaming() {
-  /* Allocate roaming channels */
-  RoamingChannelBitmapElement roaming_channel_bitmap(data(Offset::roamingChannelBitmap()));
-  for (uint8_t i=0; i<Limit::roamingChannels(); i++) {
-    // Get byte and bit for roaming channel
-    // if disabled -> skip
-    if (! roaming_channel_bitmap.isEncoded(i))
-      continue;
-    // Allocate roaming channel
-    uint32_t addr = Offset::roamingChannels() + i*RoamingChannelElement::size();
-    if (!isAllocated(addr, 0)) {
-      //logDebug() << "Allocate roaming channel at " << QString::number(addr, 16) << "h.";
-      image(0).addElement(addr, RoamingChannelElement::size());
-    }
-  }
-
-  /* Allocate roaming zones. */
-  RoamingZoneBitmapElement roaming_zone_bitmap(data(Offset::roamingZoneBitmap()));
-  for (uint8_t i=0; i<Limit::roamingZones(); i++) {
-    // Get byte and bit for radio ID
-    // if disabled -> skip
-    if (! roaming_zone_bitmap.isEncoded(i))
-      continue;
-    // Allocate roaming zone
-    uint32_t addr = Offset::roamingZones() + i*RoamingZoneElement::size();
-    if (!isAllocated(addr, 0)) {
-      logDebug() << "Allocate roaming zone at " << QString::number(addr, 16);
-      image(0).addElement(addr, RoamingZoneElement::size());
-    }
-  }
+  static_assert((! Table::roamingChannels().overlaps(Offset::roamingChannelBitmap(),
+                                                     RoamingChannelBitmapElement::size()))
+                && (! Table::roamingChannels().overlaps(Table::roamingZones())),
+                "Roaming tables overlap.");
+
+  allocateTable(Table::roamingChannels(),
+                RoamingChannelBitmapElement(data(Offset::roamingChannelBitmap())));
+  allocateTable(Table::roamingZones(),
+                RoamingZoneBitmapElement(data(Offset::roamingZoneBitmap())));
 }
 
 bool
@@ -1895,9 +1895,11 @@ protected:
   bool decodeElements(Context &ctx, const ErrorStack &err=ErrorStack());
   bool encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
 
+  SectionLayout sectionLayout(Sections::Section section) const;
+
   void allocateChannels();
   bool encodeChannels(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
-  bool createChannels(Context &ctx, const ErrorStack &err=ErrorStack());
+  Channel *createChannel(unsigned int i, Context &ctx);
   bool linkChannels(Context &ctx, const ErrorStack &err=ErrorStack());
 
   virtual void allocateZones();
@@ -1949,6 +1951,22 @@ protected:
     static constexpr unsigned int aesKeys()                     { return 0x024C4000; }
     /// @endcond
   };
+
+  /** The banked tables of the codeplug, extends the ones of the D868UV by the roaming tables. */
+  struct Table: public D868UVCodeplug::Table {
+    /// @cond DO_NOT_DOCUMENT
+    static constexpr MemoryTable roamingChannels() {
+      return {Offset::roamingChannels(), Limit::roamingChannels()*RoamingChannelElement::size(),
+              Limit::roamingChannels(), RoamingChannelElement::size(), RoamingChannelElement::size(),
+              Limit::roamingChannels()};
+    }
+    static constexpr MemoryTable roamingZones() {
+      return {Offset::roamingZones(), Limit::roamingZones()*RoamingZoneElement::size(),
+              Limit::roamingZones(), RoamingZoneElement::size(), RoamingZoneElement::size(),
+              Limit::roamingZones()};
+    }
+    /// @endcond
+  };
 };
 
 #endif // D878UVCODEPLUG_HH
@@ -0,0 +1,87 @@
+#include "detectioncache.hh"
+#include "logger.hh"
+
+#include <QDir>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QRegularExpression>
+
+
+/* ********************************************************************************************* *
+ * Implementation of DetectionCache
+ * ********************************************************************************************* */
+DetectionCache::DetectionCache(const QString &filename, unsigned ttl)
+  : _filename(filename), _ttl(ttl)
+{
+  if (_filename.isEmpty())
+    _filename = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+        .filePath("detection.ini");
+}
+
+const QString &
+DetectionCache::filename() const {
+  return _filename;
+}
+
+RadioInfo
+DetectionCache::lookup(const USBDeviceDescriptor &device) const {
+  QSettings settings(_filename, QSettings::IniFormat);
+  settings.beginGroup(key(device));
+  if (! settings.contains("radio"))
+    return RadioInfo();
+
+  QDateTime timestamp = QDateTime::fromSecsSinceEpoch(settings.value("timestamp").toLongLong());
+  if (timestamp.secsTo(QDateTime::currentDateTime()) > qint64(_ttl)) {
+    logDebug() << "Cached identification of " << device.deviceHandle() << " expired.";
+    return RadioInfo();
+  }
+
+  RadioInfo radio = RadioInfo::byKey(settings.value("radio").toString());
+  if (radio.isValid() && (radio.interface() != device)) {
+    logDebug() << "Cached identification of " << device.deviceHandle()
+               << " does not match the interface.";
+    return RadioInfo();
+  }
+  return radio;
+}
+
+void
+DetectionCache::store(const USBDeviceDescriptor &device, const RadioInfo &radio) const {
+  if (! radio.isValid())
+    return;
+  QDir().mkpath(QFileInfo(_filename).absolutePath());
+  QSettings settings(_filename, QSettings::IniFormat);
+  settings.beginGroup(key(device));
+  settings.setValue("radio", radio.key());
+  settings.setValue("timestamp", QDateTime::currentDateTime().toSecsSinceEpoch());
+  settings.endGroup();
+  settings.sync();
+  if (QSettings::NoError != settings.status())
+    logDebug() << "Cannot store identification of " << device.deviceHandle()
+               << " in '" << _filename << "'.";
+}
+
+void
+DetectionCache::remove(const USBDeviceDescriptor &device) const {
+  QSettings settings(_filename, QSettings::IniFormat);
+  settings.remove(key(device));
+}
+
+QString
+DetectionCache::key(const USBDeviceDescriptor &device) {
+  QString handle;
+  if (USBDeviceInfo::Class::Serial == device.interfaceClass()) {
+    handle = device.device().toString();
+  } else {
+    USBDeviceHandle addr = device.device().value<USBDeviceHandle>();
+    handle = QString("%1-%2-%3").arg(addr.bus).arg(addr.device).arg(addr.locationId, 0, 16);
+  }
+  QString key = QString("%1-%2-%3-%4").arg(int(device.interfaceClass()))
+      .arg(device.vendorId(), 4, 16, QChar('0')).arg(device.productId(), 4, 16, QChar('0'))
+      .arg(handle);
+  // Group names must not contain slashes (e.g., /dev/ttyACM0)
+  key.replace(QRegularExpression("[^A-Za-z0-9_.\\-]"), "_");
+  return key;
+}
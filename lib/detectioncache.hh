@@ -0,0 +1,47 @@
+#ifndef DETECTIONCACHE_HH
+#define DETECTIONCACHE_HH
+
+#include <QString>
+#include "usbdevice.hh"
+#include "radioinfo.hh"
+
+/** Implements a short-lived persistent cache of successful radio identifications.
+ *
+ * Identifying a radio requires a handshake with the device. When several invocations run in
+ * quick succession (e.g., on a bench with many radios connected), the identification of a device
+ * can be taken from this cache instead. Entries are keyed by the interface class, VID:PID and the
+ * bus/device number and location ID (or the serial port name) of the device and expire after a
+ * short time, as these handles get reused once a device is disconnected.
+ *
+ * @ingroup detect */
+class DetectionCache
+{
+public:
+  /** Constructs a new detection cache stored in the given file, whose entries expire after
+   * @c ttl seconds. If no file is given, a file in the default cache location of the application
+   * is used. */
+  explicit DetectionCache(const QString &filename=QString(), unsigned ttl=60);
+
+  /** Returns the cache file. */
+  const QString &filename() const;
+
+  /** Returns the cached identification of the given device or an invalid radio info if there is
+   * no such entry or it has expired. */
+  RadioInfo lookup(const USBDeviceDescriptor &device) const;
+  /** Stores the identification of the given device. */
+  void store(const USBDeviceDescriptor &device, const RadioInfo &radio) const;
+  /** Removes the identification of the given device. */
+  void remove(const USBDeviceDescriptor &device) const;
+
+public:
+  /** Returns the unique key of the given device. */
+  static QString key(const USBDeviceDescriptor &device);
+
+protected:
+  /** The cache file. */
+  QString _filename;
+  /** Time-to-live of the entries in seconds. */
+  unsigned _ttl;
+};
+
+#endif // DETECTIONCACHE_HH
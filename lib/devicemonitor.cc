@@ -0,0 +1,246 @@
+#include "devicemonitor.hh"
+#include "usbcontext.hh"
+#include "logger.hh"
+#include <QSerialPortInfo>
+#include <algorithm>
+
+/** Interval in ms, the tables without hotplug events are polled at. */
+#define POLL_INTERVAL_MSEC 1000
+
+
+QMutex DeviceMonitor::_instanceLock;
+DeviceMonitor *DeviceMonitor::_instance = nullptr;
+unsigned int DeviceMonitor::_references = 0;
+
+DeviceMonitor::DeviceMonitor(libusb_context *ctx, QObject *parent)
+  : QObject(parent), _ctx(ctx), _hotplugHandle(0), _hotplug(false), _lock(), _usb(), _usbAge(),
+    _serial(), _serialAge(), _poll()
+{
+  if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+    // Existing devices are reported by the callback during the registration
+    int error = libusb_hotplug_register_callback(
+          _ctx, libusb_hotplug_event(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+          LIBUSB_HOTPLUG_ENUMERATE, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+          LIBUSB_HOTPLUG_MATCH_ANY, &DeviceMonitor::hotplugCallback, this, &_hotplugHandle);
+    if (LIBUSB_SUCCESS == error) {
+      _hotplug = true;
+    } else {
+      logDebug() << "Cannot register libusb hotplug callback (" << error << "): "
+                 << libusb_strerror((enum libusb_error) error) << ", poll USB devices instead.";
+    }
+  }
+
+  if (! _hotplug) {
+    _usb = enumerateUSB(_ctx);
+    _usbAge.start();
+  }
+  _serial = enumerateSerial();
+  _serialAge.start();
+
+  _poll.setInterval(POLL_INTERVAL_MSEC);
+  connect(&_poll, SIGNAL(timeout()), this, SLOT(onPoll()));
+  _poll.start();
+}
+
+DeviceMonitor::~DeviceMonitor() {
+  _poll.stop();
+  if (_hotplug)
+    libusb_hotplug_deregister_callback(_ctx, _hotplugHandle);
+}
+
+DeviceMonitor *
+DeviceMonitor::acquire(const ErrorStack &err) {
+  QMutexLocker locker(&_instanceLock);
+
+  if (nullptr == _instance) {
+    libusb_context *ctx = USBContext::acquire(err);
+    if (nullptr == ctx) {
+      errMsg(err) << "Cannot start device monitor.";
+      return nullptr;
+    }
+    logDebug() << "Start device monitor.";
+    _instance = new DeviceMonitor(ctx);
+  }
+
+  _references++;
+  return _instance;
+}
+
+void
+DeviceMonitor::release() {
+  QMutexLocker locker(&_instanceLock);
+
+  if ((nullptr == _instance) || (0 == _references))
+    return;
+  if (0 != (--_references))
+    return;
+
+  logDebug() << "Stop device monitor.";
+  delete _instance;
+  _instance = nullptr;
+  USBContext::release();
+}
+
+DeviceMonitor *
+DeviceMonitor::instance() {
+  QMutexLocker locker(&_instanceLock);
+  return _instance;
+}
+
+bool
+DeviceMonitor::hasHotplug() const {
+  return _hotplug;
+}
+
+
+QList<DeviceMonitor::USBDevice>
+DeviceMonitor::usbDevices(uint16_t vid, uint16_t pid) {
+  QList<USBDevice> devices;
+  {
+    QMutexLocker locker(&_instanceLock);
+    if (_instance) {
+      devices = _instance->usbTable();
+    } else if (libusb_context *ctx = USBContext::acquire()) {
+      devices = enumerateUSB(ctx);
+      USBContext::release();
+    }
+  }
+
+  QList<USBDevice> matching;
+  foreach (const USBDevice &device, devices) {
+    if ((vid == device.vid) && (pid == device.pid))
+      matching.append(device);
+  }
+  return matching;
+}
+
+QList<DeviceMonitor::SerialPort>
+DeviceMonitor::serialPorts() {
+  QMutexLocker locker(&_instanceLock);
+  if (_instance)
+    return _instance->serialTable();
+  return enumerateSerial();
+}
+
+
+QList<DeviceMonitor::USBDevice>
+DeviceMonitor::usbTable() {
+  QMutexLocker locker(&_lock);
+  if ((! _hotplug) && _usbAge.hasExpired(POLL_INTERVAL_MSEC)) {
+    _usb = enumerateUSB(_ctx);
+    _usbAge.start();
+  }
+  return _usb;
+}
+
+QList<DeviceMonitor::SerialPort>
+DeviceMonitor::serialTable() {
+  QMutexLocker locker(&_lock);
+  if (_serialAge.hasExpired(POLL_INTERVAL_MSEC)) {
+    _serial = enumerateSerial();
+    _serialAge.start();
+  }
+  return _serial;
+}
+
+void
+DeviceMonitor::onPoll() {
+  bool changed = false;
+
+  QList<SerialPort> serial = enumerateSerial();
+  QList<USBDevice> usb;
+  if (! _hotplug)
+    usb = enumerateUSB(_ctx);
+
+  {
+    QMutexLocker locker(&_lock);
+    auto sameSerial = [](const SerialPort &a, const SerialPort &b) {
+      return (a.location == b.location) && (a.vid == b.vid) && (a.pid == b.pid);
+    };
+    changed |= ! std::equal(serial.begin(), serial.end(), _serial.begin(), _serial.end(), sameSerial);
+    _serial = serial;
+    _serialAge.start();
+
+    if (! _hotplug) {
+      auto sameUSB = [](const USBDevice &a, const USBDevice &b) {
+        return (a.vid == b.vid) && (a.pid == b.pid) && (a.bus == b.bus) && (a.address == b.address);
+      };
+      changed |= ! std::equal(usb.begin(), usb.end(), _usb.begin(), _usb.end(), sameUSB);
+      _usb = usb;
+      _usbAge.start();
+    }
+  }
+
+  if (changed)
+    emit devicesChanged();
+}
+
+
+QList<DeviceMonitor::USBDevice>
+DeviceMonitor::enumerateUSB(libusb_context *ctx) {
+  QList<USBDevice> devices;
+
+  libusb_device **lst;
+  ssize_t num = libusb_get_device_list(ctx, &lst);
+  if (0 > num) {
+    logError() << "Cannot enumerate USB devices (" << num << "): "
+               << libusb_strerror((enum libusb_error) num) << ".";
+    return devices;
+  }
+
+  for (ssize_t i=0; (i<num)&&(nullptr!=lst[i]); i++) {
+    libusb_device_descriptor descr;
+    if (LIBUSB_SUCCESS != libusb_get_device_descriptor(lst[i], &descr))
+      continue;
+    devices.append({descr.idVendor, descr.idProduct, libusb_get_bus_number(lst[i]),
+                    libusb_get_device_address(lst[i])});
+  }
+
+  libusb_free_device_list(lst, 1);
+  return devices;
+}
+
+QList<DeviceMonitor::SerialPort>
+DeviceMonitor::enumerateSerial() {
+  QList<SerialPort> ports;
+  foreach (const QSerialPortInfo &port, QSerialPortInfo::availablePorts()) {
+    ports.append({port.portName(), port.systemLocation(),
+                  uint16_t(port.hasVendorIdentifier() ? port.vendorIdentifier() : 0),
+                  uint16_t(port.hasProductIdentifier() ? port.productIdentifier() : 0)});
+  }
+  return ports;
+}
+
+int LIBUSB_CALL
+DeviceMonitor::hotplugCallback(libusb_context *ctx, libusb_device *device,
+                               libusb_hotplug_event event, void *userData)
+{
+  Q_UNUSED(ctx);
+  DeviceMonitor *self = reinterpret_cast<DeviceMonitor *>(userData);
+
+  libusb_device_descriptor descr;
+  if (LIBUSB_SUCCESS != libusb_get_device_descriptor(device, &descr))
+    return 0;
+  USBDevice dev = {descr.idVendor, descr.idProduct, libusb_get_bus_number(device),
+                   libusb_get_device_address(device)};
+
+  {
+    QMutexLocker locker(&self->_lock);
+    for (int i=0; i<self->_usb.size(); i++) {
+      if ((self->_usb[i].bus == dev.bus) && (self->_usb[i].address == dev.address)) {
+        self->_usb.removeAt(i);
+        break;
+      }
+    }
+    if (LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED == event)
+      self->_usb.append(dev);
+  }
+
+  logDebug() << "USB device " << QString::number(dev.vid, 16) << ":" << QString::number(dev.pid, 16)
+             << " on bus=" << int(dev.bus) << ", device=" << int(dev.address)
+             << ((LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED == event) ? " connected." : " disconnected.");
+  emit self->devicesChanged();
+
+  // Keep the callback registered
+  return 0;
+}
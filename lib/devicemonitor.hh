@@ -0,0 +1,119 @@
+#ifndef DEVICEMONITOR_HH
+#define DEVICEMONITOR_HH
+
+#include <QObject>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QList>
+#include <libusb.h>
+#include "errorstack.hh"
+
+/** Keeps a live table of the connected USB devices and serial ports.
+ *
+ * Without a monitor, every detection enumerates the entire USB bus or all serial ports. While the
+ * shared monitor is running (see @c acquire), the static methods @c usbDevices and @c serialPorts
+ * return a snapshot of the tables instead. The USB table is kept up-to-date by libusb hotplug
+ * events, handled within the shared libusb event thread (see @c USBContext). Serial ports and,
+ * where libusb does not support hotplug events, USB devices are polled periodically, if the thread
+ * creating the monitor runs an event loop. Otherwise, they are enumerated again on access, once
+ * the table is older than the poll interval. Hence, several detections in quick succession
+ * enumerate the devices only once.
+ *
+ * @ingroup detect */
+class DeviceMonitor: public QObject
+{
+  Q_OBJECT
+
+public:
+  /** A raw USB device. */
+  struct USBDevice {
+    uint16_t vid;      ///< The vendor ID.
+    uint16_t pid;      ///< The product ID.
+    uint8_t bus;       ///< The bus number.
+    uint8_t address;   ///< The device address on the bus.
+  };
+
+  /** A serial port. */
+  struct SerialPort {
+    QString name;      ///< The port name.
+    QString location;  ///< The system location of the port, e.g., /dev/ttyACM0.
+    uint16_t vid;      ///< The USB vendor ID or 0 if unknown.
+    uint16_t pid;      ///< The USB product ID or 0 if unknown.
+  };
+
+public:
+  /** Starts the shared monitor on first use. Every successful call must be paired with a call to
+   * @c release. Returns @c nullptr on error. */
+  static DeviceMonitor *acquire(const ErrorStack &err=ErrorStack());
+  /** Releases a reference to the shared monitor. The last reference stops it. */
+  static void release();
+  /** Returns the shared monitor or @c nullptr if it is not running. */
+  static DeviceMonitor *instance();
+
+  /** Returns all USB devices with the given VID:PID. */
+  static QList<USBDevice> usbDevices(uint16_t vid, uint16_t pid);
+  /** Returns all serial ports. */
+  static QList<SerialPort> serialPorts();
+
+  /** Returns @c true if the USB table is kept up-to-date by hotplug events. */
+  bool hasHotplug() const;
+
+signals:
+  /** Gets emitted, whenever a device got connected or disconnected. May be emitted from the
+   * libusb event thread. */
+  void devicesChanged();
+
+protected:
+  /** Hidden constructor, use @c acquire. */
+  explicit DeviceMonitor(libusb_context *ctx, QObject *parent=nullptr);
+  /** Destructor. */
+  virtual ~DeviceMonitor();
+
+  /** Returns a snapshot of the USB table, refreshes it first if it is polled and outdated. */
+  QList<USBDevice> usbTable();
+  /** Returns a snapshot of the serial ports, refreshes them first if outdated. */
+  QList<SerialPort> serialTable();
+
+  /** Enumerates all USB devices of the given context. */
+  static QList<USBDevice> enumerateUSB(libusb_context *ctx);
+  /** Enumerates all serial ports. */
+  static QList<SerialPort> enumerateSerial();
+
+  /** Handles the libusb hotplug events. */
+  static int LIBUSB_CALL hotplugCallback(libusb_context *ctx, libusb_device *device,
+                                         libusb_hotplug_event event, void *userData);
+
+protected slots:
+  /** Polls the tables, that are not updated by events. */
+  void onPoll();
+
+protected:
+  /** The shared libusb context. */
+  libusb_context *_ctx;
+  /** The hotplug callback handle, valid if @c _hotplug is set. */
+  libusb_hotplug_callback_handle _hotplugHandle;
+  /** If @c true, the USB table is updated by hotplug events. */
+  bool _hotplug;
+  /** Protects the tables. */
+  mutable QMutex _lock;
+  /** The connected USB devices. */
+  QList<USBDevice> _usb;
+  /** Age of the USB table, if polled. */
+  QElapsedTimer _usbAge;
+  /** The serial ports. */
+  QList<SerialPort> _serial;
+  /** Age of the serial table. */
+  QElapsedTimer _serialAge;
+  /** Polls the tables. */
+  QTimer _poll;
+
+  /** Protects the shared instance. */
+  static QMutex _instanceLock;
+  /** The shared instance. */
+  static DeviceMonitor *_instance;
+  /** Number of references to the shared instance. */
+  static unsigned int _references;
+};
+
+#endif // DEVICEMONITOR_HH
@@ -1,9 +1,17 @@
 #include "dfu_libusb.hh"
-#include <unistd.h>
+#include "usbcontext.hh"
+#include "devicemonitor.hh"
+#include <QThread>
+#include <algorithm>
 #include "logger.hh"
 #include "utils.hh"
+#include "sessionrecorder.hh"
 
 
+// Limits of the poll interval in ms, while the device is busy.
+#define MIN_POLL_TIMEOUT        10
+#define MAX_POLL_TIMEOUT        5000
+
 // USB request types.
 #define REQUEST_TYPE_TO_HOST    0xA1
 #define REQUEST_TYPE_TO_DEVICE  0x21
@@ -47,27 +55,25 @@ DFUDevice::Descriptor::Descriptor(const USBDeviceInfo &info, uint8_t bus, uint8_
  * Implementation of DFUDevice
  * ********************************************************************************************* */
 DFUDevice::DFUDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObject *parent)
-  : QObject(parent), _ctx(nullptr), _dev(nullptr)
+  : QObject(parent), _ctx(nullptr), _dev(nullptr), _maxTransferSize(0), _recorder(nullptr)
 {
+  memset(&_status, 0, sizeof(_status));
+
   if (USBDeviceInfo::Class::DFU != descr.interfaceClass()) {
     errMsg(err) << "Cannot connect to DFU device using a non DFU descriptor: "
                 << descr.description() << ".";
     return;
   }
 
-  int error = libusb_init(&_ctx);
-  if (error < 0) {
-    errMsg(err) << "Libusb init failed (" << error << "): "
-                << libusb_strerror((enum libusb_error) error) << ".";
+  if (nullptr == (_ctx = USBContext::acquire(err)))
     return;
-  }
 
-  int num=0;
+  int error, num=0;
   libusb_device **lst;
   libusb_device *dev=nullptr;
   if (0 > (num = libusb_get_device_list(_ctx, &lst))) {
     errMsg(err) << "Cannot obtain list of USB devices.";
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
     return;
   }
@@ -96,7 +102,7 @@ DFUDevice::DFUDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QO
 
   if (nullptr == dev) {
     errMsg(err) << "No matching device found: " << descr.description() << ".";
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
     return;
   }
@@ -105,7 +111,7 @@ DFUDevice::DFUDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QO
     errMsg(err) << "Cannot open device " << descr.description()
                 << ": " << libusb_strerror((enum libusb_error) error) << ".";
     libusb_unref_device(dev);
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
     return;
   }
@@ -121,16 +127,20 @@ DFUDevice::DFUDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QO
                 << ": " << libusb_strerror((enum libusb_error) error) << ".";
     libusb_close(_dev);
     _dev = nullptr;
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
     return;
   }
 
-  logDebug() << "Connected to DFU device " << descr.description() << ".";
+  _maxTransferSize = read_transfer_size();
+  logDebug() << "Connected to DFU device " << descr.description()
+             << ", max. transfer size " << _maxTransferSize << "b.";
+  _recorder = SessionRecorder::create(descr);
 }
 
 DFUDevice::~DFUDevice() {
   close();
+  delete _recorder;
 }
 
 QList<USBDeviceDescriptor>
@@ -138,39 +148,15 @@ DFUDevice::detect(uint16_t vid, uint16_t pid)
 {
   QList<USBDeviceDescriptor> res;
 
-  int error, num;
-  libusb_context *ctx;
-  if (0 > (error = libusb_init(&ctx))) {
-    logError() << "Libusb init failed (" << error << "): "
-               << libusb_strerror((enum libusb_error) error) << ".";
-    return res;
-  }
-
-  libusb_device **lst;
-  if (0 == (num = libusb_get_device_list(ctx, &lst))) {
-    logDebug() << "No USB devices found at all.";
-    // unref devices and free list
-    libusb_free_device_list(lst, 1);
-    return res;
-  }
-
   logDebug() << "Search for DFU devices matching VID:PID "
              << QString::number(vid, 16) << ":" << QString::number(pid, 16) << ".";
-  for (int i=0; (i<num)&&(nullptr!=lst[i]); i++) {
-    libusb_device_descriptor descr;
-    libusb_get_device_descriptor(lst[i], &descr);
-    if ((vid == descr.idVendor) && (pid == descr.idProduct)) {
-      logDebug() << "Found device on bus=" << libusb_get_bus_number(lst[i])
-                 << ", device=" << libusb_get_device_address(lst[i])
-                 << " with " << QString::number(vid, 16) << ":" << QString::number(pid, 16) << ".";
-      res.append(DFUDevice::Descriptor(
-                   USBDeviceInfo(USBDeviceInfo::Class::DFU, vid, pid),
-                   libusb_get_bus_number(lst[i]),
-                   libusb_get_device_address(lst[i])));
-    }
+  foreach (const DeviceMonitor::USBDevice &device, DeviceMonitor::usbDevices(vid, pid)) {
+    logDebug() << "Found device on bus=" << int(device.bus) << ", device=" << int(device.address)
+               << " with " << QString::number(vid, 16) << ":" << QString::number(pid, 16) << ".";
+    res.append(DFUDevice::Descriptor(
+                 USBDeviceInfo(USBDeviceInfo::Class::DFU, vid, pid), device.bus, device.address));
   }
 
-  libusb_free_device_list(lst, 1);
   return res;
 }
 
@@ -186,7 +172,7 @@ DFUDevice::close() {
     libusb_close(_dev);
   }
   if (nullptr != _ctx)
-    libusb_exit(_ctx);
+    USBContext::release();
   _ctx = nullptr;
   _dev = nullptr;
 }
@@ -194,6 +180,12 @@ DFUDevice::close() {
 
 int
 DFUDevice::download(unsigned block, uint8_t *data, unsigned len, const ErrorStack &err) {
+  if (_recorder) {
+    // Record the block number followed by the data
+    QByteArray request(2, 0); request[0] = block & 0xff; request[1] = (block >> 8) & 0xff;
+    request.append((const char *)data, len);
+    _recorder->record(SessionRecorder::Direction::Request, request.constData(), request.size());
+  }
   int error = libusb_control_transfer(
         _dev, REQUEST_TYPE_TO_DEVICE, REQUEST_DNLOAD, block, 0, data, len, 0);
 
@@ -207,6 +199,10 @@ DFUDevice::download(unsigned block, uint8_t *data, unsigned len, const ErrorStac
 
 int
 DFUDevice::upload(unsigned block, uint8_t *data, unsigned len, const ErrorStack &err) {
+  if (_recorder) {
+    const char request[2] = {char(block & 0xff), char((block >> 8) & 0xff)};
+    _recorder->record(SessionRecorder::Direction::Request, request, 2);
+  }
   int error = libusb_control_transfer(
         _dev, REQUEST_TYPE_TO_HOST, REQUEST_UPLOAD, block, 0, data, len, 0);
 
@@ -214,10 +210,53 @@ DFUDevice::upload(unsigned block, uint8_t *data, unsigned len, const ErrorStack
     errMsg(err) << "Cannot read block: " << libusb_strerror((enum libusb_error) error) << ".";
     return error;
   }
+  if (_recorder)
+    _recorder->record(SessionRecorder::Direction::Response, (const char *)data, error);
 
   return get_status();
 }
 
+uint16_t
+DFUDevice::maxTransferSize() const {
+  return _maxTransferSize;
+}
+
+uint16_t
+DFUDevice::read_transfer_size() {
+  libusb_config_descriptor *config = nullptr;
+  if ((nullptr == _dev) ||
+      (0 > libusb_get_active_config_descriptor(libusb_get_device(_dev), &config)))
+    return 0;
+
+  // Searches the extra descriptors for the DFU functional descriptor (type 0x21)
+  auto find = [](const unsigned char *extra, int length) -> uint16_t {
+    for (int i=0; (i+1)<length; i+=extra[i]) {
+      if (0 == extra[i])
+        break;
+      if ((0x21 == extra[i+1]) && (7 <= extra[i]) && ((i+7) <= length))
+        return uint16_t(extra[i+5]) | (uint16_t(extra[i+6]) << 8);
+    }
+    return 0;
+  };
+
+  uint16_t size = 0;
+  for (int i=0; (0==size) && (i<config->bNumInterfaces); i++) {
+    const libusb_interface &iface = config->interface[i];
+    for (int j=0; (0==size) && (j<iface.num_altsetting); j++) {
+      const libusb_interface_descriptor &alt = iface.altsetting[j];
+      // Application specific class 0xfe, DFU subclass 0x01
+      if ((0xfe != alt.bInterfaceClass) || (0x01 != alt.bInterfaceSubClass))
+        continue;
+      size = find(alt.extra, alt.extra_length);
+    }
+  }
+  if (0 == size)
+    size = find(config->extra, config->extra_length);
+
+  libusb_free_config_descriptor(config);
+  return size;
+}
+
 int
 DFUDevice::detach(int timeout, const ErrorStack &err)
 {
@@ -233,6 +272,7 @@ DFUDevice::detach(int timeout, const ErrorStack &err)
 int
 DFUDevice::get_status(const ErrorStack &err)
 {
+  memset(&_status, 0, sizeof(_status));
   int error = libusb_control_transfer(
         _dev, REQUEST_TYPE_TO_HOST, REQUEST_GETSTATUS, 0, 0, (unsigned char*)&_status, 6, 0);
   if (0 > error) {
@@ -306,7 +346,10 @@ DFUDevice::wait_idle(const ErrorStack &err)
       case appDETACH:
       case dfuDNBUSY:
       case dfuMANIFEST_WAIT_RESET:
-        usleep(100000);
+        // Poll the status at the interval requested by the device
+        QThread::msleep(std::max(poll_timeout(), unsigned(MIN_POLL_TIMEOUT)));
+        if (0 > (error = get_status(err)))
+          return 1;
         continue;
 
       default:
@@ -320,13 +363,25 @@ DFUDevice::wait_idle(const ErrorStack &err)
 }
 
 
+unsigned
+DFUDevice::poll_timeout() const {
+  return std::min(unsigned(_status.poll_timeout), unsigned(MAX_POLL_TIMEOUT));
+}
+
+void
+DFUDevice::wait_poll() const {
+  if (unsigned timeout = poll_timeout())
+    QThread::msleep(timeout);
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of DFUSEDevice
  * ********************************************************************************************* */
 DFUSEDevice::DFUSEDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, uint16_t blocksize, QObject *parent)
-  : DFUDevice(descr, err, parent), _blocksize(blocksize)
+  : DFUDevice(descr, err, parent), _blocksize(32)
 {
-  // pass...
+  setBlocksize(blocksize ? blocksize : _maxTransferSize);
 }
 
 void
@@ -340,6 +395,14 @@ DFUSEDevice::blocksize() const {
   return _blocksize;
 }
 
+void
+DFUSEDevice::setBlocksize(uint16_t blocksize) {
+  if (_maxTransferSize && (blocksize > _maxTransferSize))
+    blocksize = _maxTransferSize;
+  if (blocksize)
+    _blocksize = blocksize;
+}
+
 bool
 DFUSEDevice::setAddress(uint32_t address, const ErrorStack &err) {
   uint8_t cmd[5] ={
@@ -6,6 +6,8 @@
 #include "errorstack.hh"
 #include "radiointerface.hh"
 
+class SessionRecorder;
+
 /** This class implements DFU protocol to access radios.
  *
  * Many manufactures use the standardized DFU protocol to program codeplugs and update the
@@ -51,6 +53,10 @@ public:
   /** Uploads some data from the device. */
   int upload(unsigned block, uint8_t *data, unsigned len, const ErrorStack &err=ErrorStack());
 
+  /** Returns the maximum number of bytes per transfer as specified by the DFU functional
+   * descriptor of the device (@c wTransferSize). Returns 0 if unknown. */
+  uint16_t maxTransferSize() const;
+
 public:
   /** Finds all DFU interfaces with the specified VID/PID combination. */
   static QList<USBDeviceDescriptor> detect(uint16_t vid, uint16_t pid);
@@ -66,8 +72,18 @@ protected:
   int get_state(int &pstate, const ErrorStack &err=ErrorStack());
   /** Internal used function to abort the current operation. */
   int abort(const ErrorStack &err=ErrorStack());
-  /** Internal used function to busy-wait for a response from the device. */
+  /** Internal used function to wait until the device is idle. While the device is busy, the
+   * status is polled at the interval the device reports (@c bwPollTimeout). */
   int wait_idle(const ErrorStack &err=ErrorStack());
+  /** Returns the poll timeout in ms reported by the last status (@c bwPollTimeout), limited to
+   * a safe maximum. */
+  unsigned poll_timeout() const;
+  /** Waits for the poll timeout reported by the last status. Returns immediately if the device
+   * did not request a delay. */
+  void wait_poll() const;
+  /** Internal used function to read the maximum transfer size from the DFU functional
+   * descriptor. */
+  uint16_t read_transfer_size();
 
 protected:
   /** USB context. */
@@ -76,6 +92,10 @@ protected:
 	libusb_device_handle *_dev;
   /** Device status. */
 	status_t _status;
+  /** Maximum transfer size in bytes as specified by the DFU functional descriptor, 0 if unknown. */
+  uint16_t _maxTransferSize;
+  /** Records the session, if enabled. */
+  SessionRecorder *_recorder;
 };
 
 
@@ -88,7 +108,8 @@ class DFUSEDevice: public DFUDevice
 {
 public:
   /** Constructor, also connects to the specified VID/PID device found first. The @c blocksize
-   * specifies the blocksize for every read and write operation. */
+   * specifies the blocksize for every read and write operation. If the @c blocksize is 0, the
+   * maximum transfer size of the device is used (see @c DFUDevice::maxTransferSize). */
   DFUSEDevice(const USBDeviceDescriptor &descr, const ErrorStack &err=ErrorStack(), uint16_t blocksize=32, QObject *parent=nullptr);
 
   /** Closes the connection. */
@@ -96,6 +117,9 @@ public:
 
   /** Returns the blocksize in bytes. */
   uint16_t blocksize() const;
+  /** Sets the blocksize in bytes. The blocksize is limited by the maximum transfer size of the
+   * device, if known. */
+  void setBlocksize(uint16_t blocksize);
 
   /** Sets the read/write reference address. By default this is @c 0x08000000 (flash program
    * memory address on ST devices). */
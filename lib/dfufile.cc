@@ -1,10 +1,21 @@
 #include "dfufile.hh"
 #include <QFile>
 #include <QtEndian>
+#include <cstddef>
+#include <algorithm>
 
 #include "crc32.hh"
 #include "logger.hh"
 
+/** Size of the chunks, uniform elements are written in. */
+#define UNIFORM_CHUNK_SIZE 0x10000
+/** Size of the hex-dump buffer, that gets flushed into the stream once filled. */
+#define DUMP_BUFFER_SIZE 0x10000
+/** Maximum size of a single hex-dump line. */
+#define DUMP_LINE_SIZE 80
+/** Minimum size of a run of identical bytes, reported as a fill region by the summary. */
+#define SUMMARY_MIN_FILL 0x100
+
 
 typedef struct __attribute((packed)) {
   uint8_t signature[5];      ///< File signature = "DfuSe"
@@ -24,6 +35,73 @@ typedef struct __attribute((packed)) {
   uint32_t crc;              ///< CRC over compltete file excluding the CRC in little endian.
 } file_suffix_t;
 
+
+static const char hexDigits[] = "0123456789abcdef";
+
+/** Formats a single hex-dump line of @c n (at most 16) bytes at the given address into @c out.
+ * The line has the same layout as the one of @c hexdump -C. Returns the end of the line. */
+static char *
+formatDumpLine(char *out, const char *line, uint32_t address, uint32_t n) {
+  // Address, right aligned without leading zeros
+  char *addr = out+8;
+  do {
+    *(--addr) = hexDigits[address & 0xf];
+    address >>= 4;
+  } while (address && (addr > out));
+  while (addr > out)
+    *(--addr) = ' ';
+  out += 8;
+  *out++ = ' '; *out++ = ' ';
+  // Bytes in two groups of 8, missing bytes of a partial line are padded
+  for (uint32_t j=0; j<16; j++) {
+    if (8 == j)
+      *out++ = ' ';
+    if (j < n) {
+      *out++ = hexDigits[uint8_t(line[j]) >> 4];
+      *out++ = hexDigits[uint8_t(line[j]) & 0xf];
+    } else {
+      *out++ = ' '; *out++ = ' ';
+    }
+    *out++ = ' ';
+  }
+  *out++ = ' '; *out++ = '|';
+  for (uint32_t j=0; j<n; j++)
+    *out++ = ((line[j] >= 32) && (line[j] < 127)) ? line[j] : '.';
+  *out++ = '|'; *out++ = '\n';
+  return out;
+}
+
+/** Writes a hex-dump of @c size bytes at @c address into the given stream. Repeated lines are
+ * collapsed into a single "*" line. The lines are formatted into a preallocated buffer, that
+ * gets flushed into the stream once filled. If @c repeat is @c true, @c data holds a single line
+ * of 16 bytes, that is repeated over the entire size. */
+static void
+hexdump(QTextStream &stream, const char *data, uint32_t address, uint32_t size, bool repeat=false) {
+  QByteArray buffer(DUMP_BUFFER_SIZE+DUMP_LINE_SIZE, Qt::Uninitialized);
+  char *start = buffer.data(), *out = start;
+  const char *last = nullptr;
+  bool skipping = false;
+  for (uint32_t offset=0; offset<size; offset+=16) {
+    uint32_t n = std::min(16u, size-offset);
+    const char *line = repeat ? data : (data+offset);
+    if ((16 == n) && (nullptr != last) && (0 == memcmp(last, line, 16))) {
+      if (! skipping) {
+        memcpy(out, "       *\n", 9); out += 9;
+        skipping = true;
+      }
+      continue;
+    }
+    last = line; skipping = false;
+    out = formatDumpLine(out, line, address+offset, n);
+    if ((out-start) >= DUMP_BUFFER_SIZE) {
+      stream << QLatin1String(start, out-start);
+      out = start;
+    }
+  }
+  if (out > start)
+    stream << QLatin1String(start, out-start);
+}
+
 typedef struct __attribute((packed)) {
   uint8_t signature[6];      ///< Target signature, fixed "Target"
   uint8_t alternate_setting; ///< Alternate setting for image.
@@ -39,6 +117,46 @@ typedef struct __attribute((packed)) {
 } element_prefix_t;
 
 
+/* ********************************************************************************************* *
+ * Implementation of DFUFile::Mapping
+ * ********************************************************************************************* */
+class DFUFile::Mapping
+{
+public:
+  /** Maps the given, opened file. Takes the ownership of the file. */
+  Mapping(QFile *file)
+    : _file(file), _base(file->map(0, file->size()))
+  {
+    // pass...
+  }
+
+  ~Mapping() {
+    if (_base)
+      _file->unmap(_base);
+    delete _file;
+  }
+
+  /** Returns @c true if the file got mapped. */
+  bool isValid() const {
+    return nullptr != _base;
+  }
+
+  /** Returns a pointer to the mapped memory at the given offset or @c nullptr if the range
+   * @c [offset, offset+size) is not within the mapped file. */
+  const char *data(qint64 offset, qint64 size) const {
+    if ((nullptr == _base) || (0 > offset) || (0 > size) || ((offset+size) > _file->size()))
+      return nullptr;
+    return (const char *)(_base + offset);
+  }
+
+protected:
+  /** The mapped file. */
+  QFile *_file;
+  /** The base address of the mapping. */
+  uchar *_base;
+};
+
+
 /* ********************************************************************************************* *
  * Implementation of DFUFile
  * ********************************************************************************************* */
@@ -66,6 +184,31 @@ DFUFile::memSize() const {
   return size;
 }
 
+MemoryUsage
+DFUFile::memoryUsage(const QString &name) const {
+  MemoryUsage usage(name, sizeof(*this));
+  for (int i=0; i<_images.size(); i++) {
+    const Image &img = _images[i];
+    quint64 allocated = 0, uniform = 0, mapped = 0;
+    for (int j=0; j<img.numElements(); j++) {
+      const Element &el = img.element(j);
+      allocated += el.allocatedSize();
+      if (el.isUniform())
+        uniform += el.memSize();
+      else if (el.isMapped())
+        mapped += el.memSize();
+    }
+    MemoryUsage &child = usage.add(
+          MemoryUsage(img.isNamed() ? img.name() : QString("Image %1").arg(i), allocated,
+                      img.numElements()));
+    child.setNote(QString("%1 used, %2 uniform, %3 mapped")
+                  .arg(MemoryUsage::formatBytes(img.memSize()))
+                  .arg(MemoryUsage::formatBytes(uniform))
+                  .arg(MemoryUsage::formatBytes(mapped)));
+  }
+  return usage;
+}
+
 int
 DFUFile::numImages() const {
   return _images.size();
@@ -104,25 +247,56 @@ DFUFile::isAligned(unsigned blocksize) const {
   return true;
 }
 
+unsigned
+DFUFile::compact(uint32_t maxGap, uint8_t fill) {
+  unsigned merged = 0;
+  for (int i=0; i<_images.size(); i++)
+    merged += _images[i].compact(maxGap, fill);
+  return merged;
+}
+
+bool
+DFUFile::prepareConcurrentAccess() {
+  bool ok = true;
+  for (int i=0; i<_images.size(); i++)
+    ok &= _images[i].prepareConcurrentAccess();
+  return ok;
+}
+
+void
+DFUFile::prepareOverwrite() {
+  for (int i=0; i<_images.size(); i++)
+    _images[i].prepareOverwrite();
+}
+
 bool
 DFUFile::read(const QString &filename, const ErrorStack &err) {
-  QFile file(filename);
+  QFile *file = new QFile(filename);
 
-  if (! file.open(QIODevice::ReadOnly)) {
-    errMsg(err) << "Cannot read DFU file '" << filename << "': " << file.errorString() << ".";
+  if (! file->open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot read DFU file '" << filename << "': " << file->errorString() << ".";
+    delete file;
     return false;
   }
 
-  if (! read(file, err)) {
-    file.close();
-    return false;
+  // The mapping takes ownership of the file and keeps it open as long as any element refers to it.
+  QSharedPointer<Mapping> mapping(new Mapping(file));
+  if (! mapping->isValid()) {
+    logDebug() << "Cannot map DFU file '" << filename << "': " << file->errorString()
+               << ". Read it instead.";
+    return read(*file, QSharedPointer<Mapping>(), err);
   }
 
-  return true;
+  return read(*file, mapping, err);
 }
 
 bool
-DFUFile::read(QFile &file, const ErrorStack &err)
+DFUFile::read(QFile &file, const ErrorStack &err) {
+  return read(file, QSharedPointer<Mapping>(), err);
+}
+
+bool
+DFUFile::read(QFile &file, const QSharedPointer<Mapping> &mapping, const ErrorStack &err)
 {
   CRC32 crc;
 
@@ -149,7 +323,7 @@ DFUFile::read(QFile &file, const ErrorStack &err)
 
   for (uint8_t i=0; i<n_images; i++) {
     Image img; QString errorMessage;
-    if (! img.read(file, crc, errorMessage)) {
+    if (! img.read(file, crc, errorMessage, mapping)) {
       errMsg(err) << errorMessage;
       return false;
     }
@@ -188,8 +362,71 @@ DFUFile::read(QFile &file, const ErrorStack &err)
   return true;
 }
 
+bool
+DFUFile::readHeaders(const QString &filename, QVector<ImageHeader> &images, const ErrorStack &err) {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot read DFU file '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+
+  file_prefix_t prefix;
+  if ((sizeof(file_prefix_t) != file.read((char *)&prefix, sizeof(file_prefix_t)))
+      || memcmp(prefix.signature, "DfuSe", 5)) {
+    errMsg(err) << "Cannot read DFU file '" << filename << "': Invalid signature. Not a DFU file?";
+    return false;
+  }
+
+  images.clear();
+  images.reserve(prefix.n_targets);
+  for (uint8_t i=0; i<prefix.n_targets; i++) {
+    image_prefix_t imagePrefix;
+    if ((sizeof(image_prefix_t) != file.read((char *)&imagePrefix, sizeof(image_prefix_t)))
+        || memcmp(imagePrefix.signature, "Target", 6)) {
+      errMsg(err) << "Cannot read DFU file '" << filename << "': Invalid header of image " << i << ".";
+      return false;
+    }
+
+    ImageHeader header;
+    if (0x01 == qFromLittleEndian(imagePrefix.is_named)) {
+      char tmp[256]; tmp[255]=0;
+      memcpy(tmp, imagePrefix.name, 255);
+      header.name = tmp;
+    }
+
+    uint32_t n_elements = qFromLittleEndian(imagePrefix.n_elements);
+    // Each element has a header, do not trust the count beyond the file size
+    if ((qint64(sizeof(element_prefix_t))*n_elements) <= (file.size()-file.pos()))
+      header.elements.reserve(n_elements);
+    for (uint32_t j=0; j<n_elements; j++) {
+      element_prefix_t elementPrefix;
+      if (sizeof(element_prefix_t) != file.read((char *)&elementPrefix, sizeof(element_prefix_t))) {
+        errMsg(err) << "Cannot read DFU file '" << filename << "': Cannot read header of element "
+                    << j << " of image " << i << ".";
+        return false;
+      }
+      ElementHeader element{qFromLittleEndian(elementPrefix.address), qFromLittleEndian(elementPrefix.size)};
+      // Skip the element data
+      if (((file.pos()+element.size) > file.size()) || (! file.seek(file.pos()+element.size))) {
+        errMsg(err) << "Cannot read DFU file '" << filename << "': Element " << j << " of image "
+                    << i << " exceeds the file.";
+        return false;
+      }
+      header.elements.append(element);
+    }
+    images.append(header);
+  }
+
+  return true;
+}
+
 bool
 DFUFile::write(const QString &filename, const ErrorStack &err) {
+  // Detach all elements from a possible mapping, as the mapped file might be the one overwritten.
+  for (int i=0; i<_images.size(); i++)
+    for (int j=0; j<_images[i].numElements(); j++)
+      _images[i].element(j).data();
+
   QFile file(filename);
   if (! file.open(QIODevice::WriteOnly)) {
     errMsg(err) << "Cannot create DFU file '" << filename << "': " << file.errorString() << ".";
@@ -277,24 +514,53 @@ DFUFile::dump(QTextStream &stream) const {
   }
 }
 
+void
+DFUFile::dump(QTextStream &stream, uint32_t address, uint32_t size) const {
+  stream << "DFU file with " << _images.size() << " images:\n";
+  foreach (const Image &i, _images) {
+    i.dump(stream, address, size);
+  }
+}
+
+void
+DFUFile::summarize(QTextStream &stream) const {
+  stream << "DFU file with " << _images.size() << " images, size=0x"
+         << QString::number(size(), 16) << ":\n";
+  foreach (const Image &i, _images) {
+    i.summarize(stream);
+  }
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of DFUFile::Element
  * ********************************************************************************************* */
 DFUFile::Element::Element()
-  : _address(0), _data()
+  : _address(0), _data(), _uniform(false), _fill(0x00), _uniformSize(0), _overwrite(false),
+    _mapping(), _crc(0), _crcValid(false)
 {
   // pass...
 }
 
-DFUFile::Element::Element(uint32_t addr, uint32_t size)
-  : _address(addr), _data(size, 0x00)
+DFUFile::Element::Element(uint32_t addr, uint32_t size, uint8_t fill)
+  : _address(addr), _data(), _uniform(true), _fill(fill), _uniformSize(size), _overwrite(false),
+    _mapping(), _crc(0), _crcValid(false)
 {
   // pass...
 }
 
 DFUFile::Element::Element(const Element &other)
-  : _address(other._address), _data(other._data)
+  : _address(other._address), _data(other._data), _uniform(other._uniform), _fill(other._fill),
+    _uniformSize(other._uniformSize), _overwrite(other._overwrite), _mapping(other._mapping),
+    _crc(other._crc), _crcValid(other._crcValid)
+{
+  // pass...
+}
+
+DFUFile::Element::Element(Element &&other) noexcept
+  : _address(other._address), _data(std::move(other._data)), _uniform(other._uniform),
+    _fill(other._fill), _uniformSize(other._uniformSize), _overwrite(other._overwrite),
+    _mapping(std::move(other._mapping)), _crc(other._crc), _crcValid(other._crcValid)
 {
   // pass...
 }
@@ -303,16 +569,39 @@ DFUFile::Element &
 DFUFile::Element::operator=(const Element &other) {
   _address = other._address;
   _data = other._data;
+  _uniform = other._uniform;
+  _fill = other._fill;
+  _uniformSize = other._uniformSize;
+  _overwrite = other._overwrite;
+  _mapping = other._mapping;
+  _crc = other._crc;
+  _crcValid = other._crcValid;
+  return *this;
+}
+
+DFUFile::Element &
+DFUFile::Element::operator=(Element &&other) noexcept {
+  _address = other._address;
+  _data = std::move(other._data);
+  _uniform = other._uniform;
+  _fill = other._fill;
+  _uniformSize = other._uniformSize;
+  _overwrite = other._overwrite;
+  _mapping = std::move(other._mapping);
+  _crc = other._crc;
+  _crcValid = other._crcValid;
   return *this;
 }
 
 uint32_t
 DFUFile::Element::size() const {
-  return sizeof(element_prefix_t) + _data.size();
+  return sizeof(element_prefix_t) + memSize();
 }
 
 uint32_t
 DFUFile::Element::memSize() const {
+  if (_uniform)
+    return _uniformSize;
   return _data.size();
 }
 
@@ -328,21 +617,81 @@ DFUFile::Element::setAddress(uint32_t addr) {
 
 bool
 DFUFile::Element::isAligned(unsigned blocksize) const {
-  return (0 == (_address % blocksize)) && (0 == (_data.size() % blocksize));
+  return (0 == (_address % blocksize)) && (0 == (memSize() % blocksize));
 }
 
 const QByteArray &
 DFUFile::Element::data() const {
+  materialize();
   return _data;
 }
 
 QByteArray &
 DFUFile::Element::data() {
+  materialize();
+  _crcValid = false;
+  if (! _mapping.isNull()) {
+    // Copy on write: detach from the mapped memory before handing out a mutable reference.
+    _data = QByteArray(_data.constData(), _data.size());
+    _mapping.clear();
+  }
   return _data;
 }
 
 bool
-DFUFile::Element::read(QFile &file, CRC32 &crc, QString &errorMessage)
+DFUFile::Element::isMapped() const {
+  return ! _mapping.isNull();
+}
+
+uint32_t
+DFUFile::Element::allocatedSize() const {
+  if (_uniform || isMapped())
+    return 0;
+  return _data.capacity();
+}
+
+bool
+DFUFile::Element::isUniform(uint8_t *fill) const {
+  if (_overwrite)
+    return false;
+  if (_uniform && (nullptr != fill))
+    *fill = _fill;
+  return _uniform;
+}
+
+void
+DFUFile::Element::prepareOverwrite() {
+  if (_uniform) {
+    _overwrite = true;
+    _crcValid = false;
+  }
+}
+
+DFUFile::Element
+DFUFile::Element::section(uint32_t address, uint32_t size) const {
+  uint8_t fill;
+  if (isUniform(&fill))
+    return Element(address, size, fill);
+  Element el;
+  el._address = address;
+  el._data = data().mid(address-_address, size);
+  return el;
+}
+
+void
+DFUFile::Element::materialize() const {
+  if (! _uniform)
+    return;
+  if (_overwrite)
+    _data = QByteArray(_uniformSize, Qt::Uninitialized);
+  else
+    _data = QByteArray(_uniformSize, char(_fill));
+  _uniform = false;
+}
+
+bool
+DFUFile::Element::read(QFile &file, CRC32 &crc, QString &errorMessage,
+                       const QSharedPointer<Mapping> &mapping)
 {
   // Read Element prefix:
   element_prefix_t prefix;
@@ -357,14 +706,27 @@ DFUFile::Element::read(QFile &file, CRC32 &crc, QString &errorMessage)
   uint32_t size = qFromLittleEndian(prefix.size);
 
   _data.clear();
-  _data = file.read(size);
+  _uniform = _overwrite = _crcValid = false;
+  _mapping.clear();
+  if (! mapping.isNull()) {
+    const char *ptr = mapping->data(file.pos(), size);
+    if ((nullptr == ptr) || (! file.seek(file.pos()+size))) {
+      errorMessage = tr("Cannot read DFU file '%1': Element data exceeds file.").arg(file.fileName());
+      return false;
+    }
+    _data = QByteArray::fromRawData(ptr, size);
+    _mapping = mapping;
+  } else {
+    _data = file.read(size);
+  }
 
   if (size != uint32_t(_data.size())) {
     errorMessage = tr("Cannot read DFU file '%1': Cannot read element data: %2").arg(file.fileName()).arg(file.errorString());
     return false;
   }
 
-  crc.update(_data);
+  // Compute the element CRC once and fold it into the file CRC, keeping it for later writes.
+  crc.append(this->crc(), size);
 
   return true;
 }
@@ -373,7 +735,7 @@ bool
 DFUFile::Element::write(QFile &file, CRC32 &crc, QString &errorMessage) const {
   element_prefix_t prefix;
   prefix.address = qToLittleEndian(_address);
-  prefix.size = qToLittleEndian(uint32_t(_data.size()));
+  prefix.size = qToLittleEndian(memSize());
 
   crc.update((uint8_t *) &prefix, sizeof(element_prefix_t));
 
@@ -383,7 +745,22 @@ DFUFile::Element::write(QFile &file, CRC32 &crc, QString &errorMessage) const {
     return false;
   }
 
-  crc.update(_data);
+  // The element CRC is cached, hence unchanged elements are not traversed again.
+  crc.append(this->crc(), memSize());
+
+  if (_uniform) {
+    // Write uniform elements chunk-wise, without allocating their data
+    QByteArray chunk(std::min(_uniformSize, uint32_t(UNIFORM_CHUNK_SIZE)), char(_fill));
+    for (uint32_t offset=0; offset<_uniformSize; offset+=chunk.size()) {
+      int n = std::min(uint32_t(chunk.size()), _uniformSize-offset);
+      if (n != file.write(chunk.constData(), n)) {
+        errorMessage = tr("Cannot write element data to file '%1': %2")
+            .arg(file.fileName()).arg(file.errorString());
+        return false;
+      }
+    }
+    return true;
+  }
 
   if (_data.size() != file.write(_data)) {
     errorMessage = tr("Cannot write element data to file '%1': %2")
@@ -396,42 +773,79 @@ DFUFile::Element::write(QFile &file, CRC32 &crc, QString &errorMessage) const {
 
 void
 DFUFile::Element::dump(QTextStream &stream) const {
-  stream.setIntegerBase(16);
-  stream << "  Element @ 0x" << _address << ", size=0x" << _data.size() << "\n";
-  int nrow = _data.size()/16;
-  uint8_t last_line[16]; memset(last_line, 0, 16);
-  bool skipping = false;
-  for (int i=0; i<nrow; i++) {
-    if ((i>0) && (0==memcmp(last_line, _data.constData()+i*16, 16)) && skipping)
-      continue;
-    if ((i>0) && (0==memcmp(last_line, _data.constData()+i*16, 16))) {
-      skipping = true;
-      stream.setFieldAlignment(QTextStream::AlignRight);
-      stream << qSetFieldWidth(8) << "*" << qSetFieldWidth(1) << "\n";
-      continue;
-    }
-    memcpy(last_line, _data.constData()+i*16, 16);
-    skipping = false;
-    stream << qSetFieldWidth(8) << (_address+i*16)
-           << qSetFieldWidth(1) << "  ";
-    for (int j=(i*16); j<(i*16+8); j++) {
-      stream << QString("%1").arg(uint8_t(_data.at(j)), 2, 16, QChar('0'))
-             << qSetFieldWidth(1) << " ";
-    }
-    stream << " ";
-    for (int j=(i*16+8); j<(i*16+16); j++) {
-      stream << QString("%1").arg(uint8_t(_data.at(j)), 2, 16, QChar('0'))
-             << qSetFieldWidth(1) << " ";
-    }
-    stream << " |";
-    for (int j=(i*16); j<(i*16+16); j++) {
-      char c = _data.at(j);
-      if ((c>=32) && (c<127))
-        stream << c;
-      else
-        stream << ".";
+  dump(stream, _address, memSize());
+}
+
+void
+DFUFile::Element::dump(QTextStream &stream, uint32_t address, uint32_t size) const {
+  // Clip range to the element, lines stay aligned to the element address
+  uint64_t end = std::min(uint64_t(address)+size, uint64_t(_address)+memSize());
+  uint32_t start = std::max(address, _address);
+  if (start >= end)
+    return;
+  start = _address + ((start-_address) & ~0xfu);
+
+  stream << "  Element @ 0x" << QString::number(_address, 16)
+         << ", size=0x" << QString::number(memSize(), 16) << "\n";
+
+  uint8_t fill = 0x00;
+  if (isUniform(&fill)) {
+    // Do not allocate uniform elements just to dump them
+    char line[16]; memset(line, fill, 16);
+    hexdump(stream, line, start, end-start, true);
+  } else {
+    hexdump(stream, data().constData()+(start-_address), start, end-start);
+  }
+}
+
+uint32_t
+DFUFile::Element::crc() const {
+  if (_crcValid)
+    return _crc;
+
+  CRC32 checksum;
+  uint8_t fill = 0x00;
+  if (isUniform(&fill)) {
+    QByteArray chunk(std::min(_uniformSize, uint32_t(UNIFORM_CHUNK_SIZE)), char(fill));
+    for (uint32_t offset=0; offset<_uniformSize; offset+=chunk.size())
+      checksum.update((const uint8_t *)chunk.constData(), std::min(uint32_t(chunk.size()), _uniformSize-offset));
+  } else {
+    const QByteArray &buffer = data();
+    checksum.updateParallel((const uint8_t *)buffer.constData(), buffer.size());
+  }
+
+  _crc = checksum.get();
+  _crcValid = true;
+  return _crc;
+}
+
+void
+DFUFile::Element::summarize(QTextStream &stream) const {
+  stream << "  Element @ 0x" << QString::number(_address, 16)
+         << ", size=0x" << QString::number(memSize(), 16)
+         << ", crc32=0x" << QString::number(crc(), 16);
+
+  uint8_t fill = 0x00;
+  if (isUniform(&fill)) {
+    stream << ", uniform 0x" << QString("%1").arg(fill, 2, 16, QChar('0')) << "\n";
+    return;
+  }
+  stream << "\n";
+
+  const QByteArray &bytes = data();
+  // List runs of identical bytes
+  const char *ptr = bytes.constData();
+  uint32_t n = bytes.size();
+  for (uint32_t i=0; i<n;) {
+    uint32_t j = i+1;
+    while ((j<n) && (ptr[j] == ptr[i]))
+      j++;
+    if ((j-i) >= SUMMARY_MIN_FILL) {
+      stream << "    fill 0x" << QString("%1").arg(uint8_t(ptr[i]), 2, 16, QChar('0'))
+             << " @ 0x" << QString::number(_address+i, 16)
+             << ", size=0x" << QString::number(j-i, 16) << "\n";
     }
-    stream << "|\n";
+    i = j;
   }
 }
 
@@ -458,6 +872,13 @@ DFUFile::Image::Image(const Image &other)
   // pass...
 }
 
+DFUFile::Image::Image(Image &&other) noexcept
+  : _alternate_settings(other._alternate_settings), _name(std::move(other._name)),
+    _elements(std::move(other._elements)), _addressmap(std::move(other._addressmap))
+{
+  // pass...
+}
+
 DFUFile::Image::~Image() {
   // pass...
 }
@@ -471,6 +892,15 @@ DFUFile::Image::operator=(const Image &other) {
   return *this;
 }
 
+DFUFile::Image &
+DFUFile::Image::operator=(Image &&other) noexcept {
+  _alternate_settings = other._alternate_settings;
+  _name = std::move(other._name);
+  _elements = std::move(other._elements);
+  _addressmap = std::move(other._addressmap);
+  return *this;
+}
+
 uint32_t
 DFUFile::Image::size() const {
   uint32_t size = sizeof(image_prefix_t);
@@ -528,20 +958,40 @@ DFUFile::Image::element(int i) {
 }
 
 void
-DFUFile::Image::addElement(uint32_t addr, uint32_t size, int index) {
+DFUFile::Image::addElement(uint32_t addr, uint32_t size, int index, uint8_t fill) {
   if ((0 > index) || (_elements.size() <= index)) {
-    _elements.append(Element(addr, size));
+    _elements.append(Element(addr, size, fill));
     _addressmap.add(addr, size);
   } else {
-    _elements.insert(index, Element(addr, size));
+    _elements.insert(index, Element(addr, size, fill));
     _addressmap.add(addr, size, index);
   }
 }
 
 void
 DFUFile::Image::addElement(const Element &element) {
+  _addressmap.add(element.address(), element.memSize());
   _elements.append(element);
-  _addressmap.add(element.address(), element.size());
+}
+
+void
+DFUFile::Image::addElement(Element &&element) {
+  _addressmap.add(element.address(), element.memSize());
+  _elements.append(std::move(element));
+}
+
+void
+DFUFile::Image::addElements(const std::vector<AddressMap::Range> &ranges, uint8_t fill) {
+  _addressmap.add(ranges, _elements.size());
+  _elements.reserve(_elements.size() + int(ranges.size()));
+  for (const AddressMap::Range &range: ranges)
+    _elements.append(Element(range.address, range.length, fill));
+}
+
+void
+DFUFile::Image::reserve(int n) {
+  _elements.reserve(n);
+  _addressmap.reserve(n);
 }
 
 void
@@ -559,7 +1009,8 @@ DFUFile::Image::isAligned(unsigned blocksize) const {
 }
 
 bool
-DFUFile::Image::read(QFile &file, CRC32 &crc, QString &errorMessage)
+DFUFile::Image::read(QFile &file, CRC32 &crc, QString &errorMessage,
+                     const QSharedPointer<Mapping> &mapping)
 {
   image_prefix_t prefix;
   if (sizeof(image_prefix_t) != file.read((char *)&prefix, sizeof(image_prefix_t))) {
@@ -583,11 +1034,14 @@ DFUFile::Image::read(QFile &file, CRC32 &crc, QString &errorMessage)
 
   uint32_t size = qFromLittleEndian(prefix.size);
   uint32_t n_elements = qFromLittleEndian(prefix.n_elements);
+  // Each element has a header, do not trust the count beyond the file size
+  if ((qint64(sizeof(element_prefix_t))*n_elements) <= (file.size()-file.pos()))
+    reserve(numElements() + n_elements);
   for (uint32_t i=0; i<n_elements; i++) {
     Element element;
-    if (! element.read(file, crc, errorMessage))
+    if (! element.read(file, crc, errorMessage, mapping))
       return false;
-    this->addElement(element);
+    this->addElement(std::move(element));
   }
 
   // verify size:
@@ -633,11 +1087,68 @@ DFUFile::Image::sort() {
                    [](const Element &first, const Element &second) {
                      return first.address()<second.address();
                    });
+  rebuildAddressMap();
+}
+
+unsigned
+DFUFile::Image::compact(uint32_t maxGap, uint8_t fill) {
+  sort();
+
+  QVector<Element> elements;
+  elements.reserve(_elements.size());
+  for (int i=0; i<_elements.size();) {
+    // Find run of mergeable elements [i,j)
+    uint64_t start = _elements[i].address(), end = start + _elements[i].memSize();
+    int j = i+1;
+    while ((j < _elements.size()) && (_elements[j].address() >= end)
+           && ((_elements[j].address() - end) <= maxGap)) {
+      end = uint64_t(_elements[j].address()) + _elements[j].memSize();
+      j++;
+    }
 
-  // Rebuild address map
+    if (1 == (j-i)) {
+      elements.append(std::move(_elements[i]));
+    } else {
+      // Copy run into a single contiguous buffer
+      Element merged(uint32_t(start), uint32_t(end-start));
+      char *ptr = merged.data().data();
+      uint64_t addr = start;
+      for (int k=i; k<j; k++) {
+        const Element &el = _elements[k];
+        memset(ptr + (addr-start), fill, el.address()-addr);
+        memcpy(ptr + (el.address()-start), el.data().constData(), el.memSize());
+        addr = uint64_t(el.address()) + el.memSize();
+      }
+      elements.append(std::move(merged));
+    }
+    i = j;
+  }
+
+  // The unmerged elements were moved, hence take the new vector in any case
+  unsigned removed = _elements.size() - elements.size();
+  _elements = std::move(elements);
+  if (0 != removed)
+    rebuildAddressMap();
+  return removed;
+}
+
+void
+DFUFile::Image::rebuildAddressMap() {
+  std::vector<AddressMap::Range> ranges;
+  ranges.reserve(_elements.size());
+  foreach (const Element &el, _elements)
+    ranges.push_back({el.address(), el.memSize()});
   _addressmap.clear();
+  _addressmap.add(ranges, 0);
+}
+
+bool
+DFUFile::Image::prepareConcurrentAccess() {
+  // Detach the element vector and all element data now, such that obtaining a mutable reference
+  // later on does not copy anything.
   for (int i=0; i<_elements.size(); i++)
-    _addressmap.add(_elements[i].address(), _elements.size());
+    _elements[i].data().detach();
+  return _addressmap.prepareConcurrentLookup();
 }
 
 void
@@ -653,11 +1164,43 @@ DFUFile::Image::dump(QTextStream &stream) const {
   }
 }
 
+void
+DFUFile::Image::dump(QTextStream &stream, uint32_t address, uint32_t size) const {
+  stream << " Image";
+  if (_name.isEmpty())
+    stream << ", target not named";
+  else
+    stream << ", target '" << _name << "'";
+  stream << ", #elements=" << _elements.size() << ":\n";
+  foreach (const Element &e, _elements) {
+    e.dump(stream, address, size);
+  }
+}
+
+void
+DFUFile::Image::summarize(QTextStream &stream) const {
+  stream << " Image";
+  if (_name.isEmpty())
+    stream << ", target not named";
+  else
+    stream << ", target '" << _name << "'";
+  stream << ", #elements=" << _elements.size()
+         << ", memory size=0x" << QString::number(memSize(), 16) << ":\n";
+  foreach (const Element &e, _elements) {
+    e.summarize(stream);
+  }
+}
+
 bool
 DFUFile::Image::isAllocated(uint32_t offset) const {
   return 0 <= _addressmap.find(offset);
 }
 
+int
+DFUFile::Image::findElement(uint32_t offset) const {
+  return _addressmap.find(offset);
+}
+
 unsigned char *
 DFUFile::Image::data(uint32_t offset) {
   int idx = _addressmap.find(offset);
@@ -679,3 +1222,308 @@ DFUFile::Image::data(uint32_t offset) const {
   return (unsigned char *)(element(idx).data().data()+
                            (offset-element(idx).address()));
 }
+
+bool
+DFUFile::Image::copyData(const Image &source) {
+  for (int i=0; i<_elements.size(); i++) {
+    Element &el = _elements[i];
+    int j = source._addressmap.find(el.address());
+    if (0 > j)
+      return false;
+    const Element &src = source.element(j);
+    if ((el.address()+el.memSize()) > (src.address()+src.memSize()))
+      return false;
+    if ((el.address() == src.address()) && (el.memSize() == src.memSize()))
+      el = src;
+    else
+      memcpy(el.data().data(), src.data().constData()+(el.address()-src.address()), el.memSize());
+  }
+  return true;
+}
+
+DFUFile::Image
+DFUFile::Image::excluding(const std::vector<AddressMap::Range> &ranges) const {
+  std::vector<AddressMap::Range> sorted(ranges);
+  std::sort(sorted.begin(), sorted.end(), [](const AddressMap::Range &a, const AddressMap::Range &b) {
+    return a.address < b.address;
+  });
+
+  Image result(_name, _alternate_settings);
+  result.reserve(_elements.size());
+  for (int i=0; i<_elements.size(); i++) {
+    const Element &el = _elements[i];
+    uint32_t addr = el.address(), end = el.address()+el.memSize();
+    for (const AddressMap::Range &range: sorted) {
+      if (addr >= end)
+        break;
+      uint32_t rend = range.address+range.length;
+      if ((rend <= addr) || (range.address >= end))
+        continue;
+      if (range.address > addr)
+        result.addElement(el.section(addr, range.address-addr));
+      addr = std::max(addr, rend);
+    }
+    if ((addr == el.address()) && (end > addr))
+      result.addElement(el);
+    else if (addr < end)
+      result.addElement(el.section(addr, end-addr));
+  }
+  return result;
+}
+
+bool
+DFUFile::Image::isUniform(uint32_t offset, uint32_t size, uint8_t *fill) const {
+  int i = _addressmap.find(offset);
+  if (0 > i)
+    return false;
+  const Element &el = element(i);
+  if ((offset+size) > (el.address()+el.memSize()))
+    return false;
+  return el.isUniform(fill);
+}
+
+void
+DFUFile::Image::prepareOverwrite() {
+  for (int i=0; i<_elements.size(); i++)
+    _elements[i].prepareOverwrite();
+}
+
+bool
+DFUFile::Image::differs(const Image &other, uint32_t offset, uint32_t size) const {
+  int i = _addressmap.find(offset), j = other._addressmap.find(offset);
+  if ((0 > i) || (0 > j))
+    return true;
+  const Element &a = element(i), &b = other.element(j);
+  if (((offset+size) > (a.address()+a.memSize())) || ((offset+size) > (b.address()+b.memSize())))
+    return true;
+  uint8_t fillA, fillB;
+  if (a.isUniform(&fillA) && b.isUniform(&fillB))
+    return fillA != fillB;
+  return 0 != memcmp(a.data().constData()+(offset-a.address()),
+                     b.data().constData()+(offset-b.address()), size);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of DFUStreamWriter
+ * ********************************************************************************************* */
+DFUStreamWriter::DFUStreamWriter()
+  : _file(), _crc(0xffffffff), _patches(), _numImages(0), _fileSizeOffset(-1), _numImagesOffset(-1),
+    _imageSizeOffset(-1), _numElementsOffset(-1), _imageStart(0), _numElements(0),
+    _elementSizeOffset(-1), _elementAddress(0), _elementSize(0), _lastEnd(0)
+{
+  // pass...
+}
+
+DFUStreamWriter::~DFUStreamWriter() {
+  if (_file.isOpen())
+    _file.close();
+}
+
+bool
+DFUStreamWriter::open(const QString &filename, const ErrorStack &err) {
+  _file.setFileName(filename);
+  if (! _file.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot create DFU file '" << filename << "': " << _file.errorString() << ".";
+    return false;
+  }
+
+  _crc = 0xffffffff; _patches.clear(); _numImages = 0;
+
+  file_prefix_t prefix;
+  memcpy(prefix.signature, "DfuSe", 5);
+  prefix.version = 0x01;
+  prefix.image_size = 0;
+  prefix.n_targets = 0;
+  _fileSizeOffset = offsetof(file_prefix_t, image_size);
+  _numImagesOffset = offsetof(file_prefix_t, n_targets);
+  return append(&prefix, sizeof(file_prefix_t), err);
+}
+
+bool
+DFUStreamWriter::beginImage(const QString &name, uint8_t altSettings, const ErrorStack &err) {
+  if (0 <= _imageSizeOffset) {
+    errMsg(err) << "Cannot begin image: Previous image not finished.";
+    return false;
+  }
+  if (0xff == _numImages) {
+    errMsg(err) << "Cannot begin image: Too many images.";
+    return false;
+  }
+
+  image_prefix_t prefix;
+  memcpy(prefix.signature, "Target", 6);
+  prefix.alternate_setting = altSettings;
+  prefix.is_named = qToLittleEndian(uint32_t(name.isEmpty() ? 0 : 1));
+  memset(prefix.name, 0, 255);
+  if (! name.isEmpty())
+    memcpy(prefix.name, name.toLocal8Bit().constData(), std::min(255, name.size()));
+  prefix.size = 0;
+  prefix.n_elements = 0;
+
+  _imageStart = _file.pos();
+  _imageSizeOffset = _imageStart + offsetof(image_prefix_t, size);
+  _numElementsOffset = _imageStart + offsetof(image_prefix_t, n_elements);
+  _numElements = 0; _lastEnd = 0;
+  return append(&prefix, sizeof(image_prefix_t), err);
+}
+
+bool
+DFUStreamWriter::beginElement(uint32_t address, const ErrorStack &err) {
+  if ((0 > _imageSizeOffset) || (0 <= _elementSizeOffset)) {
+    errMsg(err) << "Cannot begin element: No image started or previous element not finished.";
+    return false;
+  }
+  if ((0 < _numElements) && (address < _lastEnd)) {
+    errMsg(err) << "Cannot begin element at 0x" << QString::number(address, 16)
+                << ": Elements must be written in ascending address order.";
+    return false;
+  }
+
+  element_prefix_t prefix;
+  prefix.address = qToLittleEndian(address);
+  prefix.size = 0;
+  _elementSizeOffset = _file.pos() + offsetof(element_prefix_t, size);
+  _elementAddress = address; _elementSize = 0;
+  return append(&prefix, sizeof(element_prefix_t), err);
+}
+
+bool
+DFUStreamWriter::write(const char *data, uint32_t size, const ErrorStack &err) {
+  if (0 > _elementSizeOffset) {
+    errMsg(err) << "Cannot write data: No element started.";
+    return false;
+  }
+  if (! append(data, size, err))
+    return false;
+  _elementSize += size;
+  return true;
+}
+
+bool
+DFUStreamWriter::write(const QByteArray &data, const ErrorStack &err) {
+  return write(data.constData(), data.size(), err);
+}
+
+bool
+DFUStreamWriter::fill(uint8_t value, uint32_t n, const ErrorStack &err) {
+  char buffer[1024]; memset(buffer, value, sizeof(buffer));
+  while (n) {
+    uint32_t len = std::min(n, uint32_t(sizeof(buffer)));
+    if (! write(buffer, len, err))
+      return false;
+    n -= len;
+  }
+  return true;
+}
+
+bool
+DFUStreamWriter::endElement(const ErrorStack &err) {
+  if (0 > _elementSizeOffset) {
+    errMsg(err) << "Cannot end element: No element started.";
+    return false;
+  }
+  if (! patch(_elementSizeOffset, _elementSize, 4, err))
+    return false;
+  _elementSizeOffset = -1;
+  _lastEnd = uint64_t(_elementAddress) + _elementSize;
+  _numElements++;
+  return true;
+}
+
+bool
+DFUStreamWriter::endImage(const ErrorStack &err) {
+  if ((0 > _imageSizeOffset) || (0 <= _elementSizeOffset)) {
+    errMsg(err) << "Cannot end image: No image started or element not finished.";
+    return false;
+  }
+  uint32_t size = _file.pos() - _imageStart - sizeof(image_prefix_t);
+  if ((! patch(_imageSizeOffset, size, 4, err)) || (! patch(_numElementsOffset, _numElements, 4, err)))
+    return false;
+  _imageSizeOffset = _numElementsOffset = -1;
+  _numImages++;
+  return true;
+}
+
+bool
+DFUStreamWriter::close(const ErrorStack &err) {
+  if (0 <= _imageSizeOffset) {
+    errMsg(err) << "Cannot close DFU file: Image not finished.";
+    return false;
+  }
+
+  uint32_t fileSize = _file.pos();
+  if ((! patch(_fileSizeOffset, fileSize, 4, err)) || (! patch(_numImagesOffset, _numImages, 1, err)))
+    return false;
+
+  file_suffix_t suffix;
+  suffix.device_id = qToLittleEndian((uint16_t)0xffff);
+  suffix.product_id = qToLittleEndian((uint16_t)0xffff);
+  suffix.vendor_id = qToLittleEndian((uint16_t)0xffff);
+  suffix.DFUlo = 0x1a;
+  suffix.DFUhi = 0x01;
+  memcpy(suffix.signature, "UFD", 3);
+  suffix.size = 16;
+  if (! append(&suffix, sizeof(file_suffix_t)-4, err))
+    return false;
+
+  // Correct CRC for the patched fields, the CRC is linear in the data
+  uint64_t total = _file.pos();
+  uint32_t crc = _crc;
+  foreach (const Patch &p, _patches) {
+    uint8_t bytes[4]; qToLittleEndian(p.value, bytes);
+    CRC32 delta(0); delta.update(bytes, p.size);
+    crc ^= CRC32::shift(delta.get(), total - p.offset - p.size);
+  }
+
+  uint32_t crcField = qToLittleEndian(crc);
+  if (4 != _file.write((const char *)&crcField, 4)) {
+    errMsg(err) << "Cannot write DFU suffix to '" << _file.fileName() << "': "
+                << _file.errorString() << ".";
+    return false;
+  }
+  _file.close();
+  return true;
+}
+
+bool
+DFUStreamWriter::addElement(const DFUFile::Element &element, const ErrorStack &err) {
+  return beginElement(element.address(), err) && write(element.data(), err) && endElement(err);
+}
+
+bool
+DFUStreamWriter::addImage(const DFUFile::Image &image, const ErrorStack &err) {
+  if (! beginImage(image.name(), image.alternateSettings(), err))
+    return false;
+  for (int i=0; i<image.numElements(); i++) {
+    if (! addElement(image.element(i), err))
+      return false;
+  }
+  return endImage(err);
+}
+
+bool
+DFUStreamWriter::append(const void *data, uint32_t size, const ErrorStack &err) {
+  if (qint64(size) != _file.write((const char *)data, size)) {
+    errMsg(err) << "Cannot write to DFU file '" << _file.fileName() << "': "
+                << _file.errorString() << ".";
+    return false;
+  }
+  CRC32 crc(_crc);
+  crc.update((const uint8_t *)data, size);
+  _crc = crc.get();
+  return true;
+}
+
+bool
+DFUStreamWriter::patch(qint64 offset, uint32_t value, uint8_t size, const ErrorStack &err) {
+  uint8_t bytes[4]; qToLittleEndian(value, bytes);
+  qint64 pos = _file.pos();
+  if ((! _file.seek(offset)) || (size != _file.write((const char *)bytes, size)) || (! _file.seek(pos))) {
+    errMsg(err) << "Cannot update header of DFU file '" << _file.fileName() << "': "
+                << _file.errorString() << ".";
+    return false;
+  }
+  _patches.append(Patch{offset, value, size});
+  return true;
+}
@@ -5,10 +5,12 @@
 #include <QVector>
 #include <QByteArray>
 #include <QString>
+#include <QSharedPointer>
 #include <QTextStream>
 
 #include "addressmap.hh"
 #include "errorstack.hh"
+#include "memoryusage.hh"
 
 class CRC32;
 
@@ -74,17 +76,31 @@ class DFUFile: public QObject
 	Q_OBJECT
 
 public:
-  /** Represents a single element within a @c Image. */
+  /** A read-only memory mapping of a DFU file, shared by all elements viewing into it. */
+  class Mapping;
+
+  /** Represents a single element within a @c Image.
+   *
+   * If read from a memory mapped file, the element data is a view into that mapping. The data gets
+   * copied on the first non-const access.
+   *
+   * A newly allocated element is uniformly filled with a single byte. Its data is not allocated
+   * until it is accessed first. Until then, @c isUniform can be used to skip the element. */
 	class Element {
 	public:
     /** Empty constructor. */
 		Element();
-    /** Constructs an element for the given address and of the given size. */
-		Element(uint32_t addr, uint32_t size);
+    /** Constructs an element for the given address and of the given size, uniformly filled with
+     * @c fill. */
+		Element(uint32_t addr, uint32_t size, uint8_t fill=0x00);
     /** Copy constructor. */
 		Element(const Element &other);
+    /** Move constructor. */
+    Element(Element &&other) noexcept;
     /** Copying assignment. */
 		Element &operator= (const Element &other);
+    /** Move assignment. */
+    Element &operator= (Element &&other) noexcept;
 
     /** Returns the address of the element. */
 		uint32_t address() const;
@@ -98,22 +114,67 @@ public:
     bool isAligned(unsigned blocksize) const;
     /** Returns a reference to the data. */
 		const QByteArray &data() const;
-    /** Returns a reference to the data. */
+    /** Returns a reference to the data. If the element is a view into a memory mapped file, the
+     * data gets copied first. As the data may get modified through the reference, the cached CRC
+     * of the element is discarded. Hence, do not keep the reference across calls to @c crc. */
 		QByteArray &data();
+    /** Returns @c true if the element data is a view into a memory mapped file. */
+    bool isMapped() const;
+    /** Returns the number of bytes allocated for the element data. Elements not accessed yet or
+     * mapped from a file, do not allocate any memory. */
+    uint32_t allocatedSize() const;
+    /** Returns @c true if the element data was not accessed yet and is therefore uniformly filled.
+     * If @c fill is given, the fill byte is stored there. */
+    bool isUniform(uint8_t *fill=nullptr) const;
+    /** Marks an untouched element to be overwritten entirely (e.g., by a download). Its data then
+     * gets allocated without initialization and it is no longer considered uniform. */
+    void prepareOverwrite();
+    /** Returns a new element holding a copy of the given memory section of this element. The
+     * section must lie within the element. Sections of uniform elements remain uniform. */
+    Element section(uint32_t address, uint32_t size) const;
 
-    /** Reads an element from the given file and updates the CRC. */
-		bool read(QFile &file, CRC32 &crc, QString &errorMessage);
+    /** Reads an element from the given file and updates the CRC. If a @c mapping of the file is
+     * given, the element data is not copied but refers to the mapped memory. */
+		bool read(QFile &file, CRC32 &crc, QString &errorMessage,
+              const QSharedPointer<Mapping> &mapping=QSharedPointer<Mapping>());
     /** Writes an element to the given file and updates the CRC. */
 		bool write(QFile &file, CRC32 &crc, QString &errorMessage) const;
 
     /** Dumps a textual representation of the element. */
 		void dump(QTextStream &stream) const;
+    /** Dumps a textual representation of the part of the element within the given memory range.
+     * Nothing is dumped, if the element does not overlap with the range. */
+    void dump(QTextStream &stream, uint32_t address, uint32_t size) const;
+    /** Returns the CRC32 of the element data. Uniform elements are not allocated. The CRC is
+     * cached until the data is accessed for modification. */
+    uint32_t crc() const;
+    /** Prints a single line summary of the element, including its CRC and the regions filled with
+     * a single byte. Uniform elements are not allocated. */
+    void summarize(QTextStream &stream) const;
+
+	protected:
+    /** Allocates the data of a uniform element. */
+    void materialize() const;
 
 	protected:
     /** The address of the element. */
 		uint32_t _address;
-    /** The data of the element. */
-		QByteArray _data;
+    /** The data of the element. Allocated on first access for uniform elements. */
+		mutable QByteArray _data;
+    /** If @c true, the data is not allocated yet and all bytes are @c _fill. */
+    mutable bool _uniform;
+    /** The fill byte of a uniform element. */
+    uint8_t _fill;
+    /** The size of a uniform element. */
+    uint32_t _uniformSize;
+    /** If @c true, the data of an untouched element gets allocated without initialization. */
+    bool _overwrite;
+    /** The mapping, the data refers to. Keeps the mapping alive as long as the element views into it. */
+    QSharedPointer<Mapping> _mapping;
+    /** The cached CRC32 of the data, valid if @c _crcValid is set. */
+    mutable uint32_t _crc;
+    /** If @c true, @c _crc holds the CRC32 of the current data. */
+    mutable bool _crcValid;
 	};
 
   /** Represents a single image within a @c DFUFile. */
@@ -127,10 +188,14 @@ public:
     Image(const QString &name, uint8_t altSettings=0);
     /** Copy constructor. */
 		Image(const Image &other);
+    /** Move constructor. */
+    Image(Image &&other) noexcept;
     /** Destructor. */
     virtual ~Image();
     /** Copying assignment. */
 		Image &operator=(const Image &other);
+    /** Move assignment. */
+    Image &operator=(Image &&other) noexcept;
 
     /** Returns the alternate settings byte. */
 		uint8_t alternateSettings() const;
@@ -154,33 +219,87 @@ public:
     /** Returns a reference to the i-th element of the image. */
     Element &element(int i);
     /** Adds an element to the image with the given address and size at the specified index.
-     * If the index is negative, the element gets appended. */
-    void addElement(uint32_t addr, uint32_t size, int index=-1);
+     * If the index is negative, the element gets appended. The element is uniformly filled with
+     * @c fill, see @c Element::isUniform. */
+    void addElement(uint32_t addr, uint32_t size, int index=-1, uint8_t fill=0x00);
     /** Adds an element to the image. */
     void addElement(const Element &element);
+    /** Adds an element to the image, taking over its data. */
+    void addElement(Element &&element);
+    /** Appends an element for every given memory range at once. The elements are uniformly
+     * filled with @c fill. Unlike adding them one-by-one, the address map gets updated in a
+     * single pass, hence encoders allocating many elements should prefer this method. */
+    void addElements(const std::vector<AddressMap::Range> &ranges, uint8_t fill=0x00);
+    /** Reserves space for the given number of elements. */
+    void reserve(int n);
     /** Removes the i-th element from this image. */
 		void remElement(int i);
     /** Checks if all element addresses and sizes is aligned with the given block size. */
     bool isAligned(unsigned blocksize) const;
 
     /** Reads an image from the given file and updates the CRC. */
-		bool read(QFile &file, CRC32 &crc, QString &errorMessage);
+		bool read(QFile &file, CRC32 &crc, QString &errorMessage,
+              const QSharedPointer<Mapping> &mapping=QSharedPointer<Mapping>());
     /** Writes this image to the given file and updates the CRC. */
 		bool write(QFile &file, CRC32 &crc, QString &errorMessage) const;
 
     /** Prints a textual representation of the image into the given stream. */
 		void dump(QTextStream &stream) const;
+    /** Prints a textual representation of all elements within the given memory range. */
+    void dump(QTextStream &stream, uint32_t address, uint32_t size) const;
+    /** Prints a summary of the image and its elements, see @c Element::summarize. */
+    void summarize(QTextStream &stream) const;
 
     /** Returns @c true if the specified address is allocated. */
     virtual bool isAllocated(uint32_t offset) const;
+    /** Returns the index of the element containing the specified address or -1 if there is none. */
+    int findElement(uint32_t offset) const;
 
     /** Returns a pointer to the encoded raw data at the specified offset. */
     virtual unsigned char *data(uint32_t offset);
     /** Returns a const pointer to the encoded raw data at the specified offset. */
     virtual const unsigned char *data(uint32_t offset) const;
 
+    /** Returns @c true if the memory section at @c offset of the given @c size lies within a single
+     * uniform element (see @c Element::isUniform). If @c fill is given, the fill byte is stored
+     * there. */
+    bool isUniform(uint32_t offset, uint32_t size, uint8_t *fill=nullptr) const;
+    /** Marks all untouched elements to be overwritten entirely, see
+     * @c Element::prepareOverwrite. */
+    void prepareOverwrite();
+
+    /** Returns @c true if the memory section at @c offset of the given @c size differs from the
+     * same section of the @c other image. If the section is not entirely allocated within a single
+     * element of both images, it is considered as different. */
+    bool differs(const Image &other, uint32_t offset, uint32_t size) const;
+
+    /** Copies the data of all elements of this image from the @c source image.
+     * @returns @c false if any element is not entirely contained within a single element of the
+     *          source image. */
+    bool copyData(const Image &source);
+    /** Returns a copy of this image, omitting the given memory ranges. Elements overlapping with
+     * any range get split. Hence, @c differs considers every section within these ranges as
+     * different. The element data is shared with this image until modified. */
+    Image excluding(const std::vector<AddressMap::Range> &ranges) const;
+
     /** Sorts all elements with respect to their addresses. */
     void sort();
+    /** Sorts all elements and merges neighbouring elements into a single contiguous element.
+     * Elements are merged if the gap between them is at most @c maxGap bytes. The gap is then
+     * filled with @c fill. Overlapping elements are not merged. The address map gets rebuilt.
+     * @returns The number of elements removed by merging. */
+    unsigned compact(uint32_t maxGap=0, uint8_t fill=0x00);
+
+    /** Prepares the image for concurrent access to its data from several threads. That is, all
+     * element data gets detached and the lookup caches are built in advance. Afterwards, several
+     * threads may obtain and modify data (at disjoint addresses), as long as no elements are added
+     * or removed.
+     * @returns @c false if the address map does not support concurrent lookups. */
+    bool prepareConcurrentAccess();
+
+  protected:
+    /** Rebuilds the address map from the elements. */
+    void rebuildAddressMap();
 
 	protected:
     /** Alternate settings byte. */
@@ -201,6 +320,10 @@ public:
 	uint32_t size() const;
   /** Returns the total memory size stored in the DFU file. */
   uint32_t memSize() const;
+  /** Returns a report of the memory allocated for the images of the DFU file. For each image,
+   * the note states the memory size used and how much of it is still uniform or mapped from a
+   * file. */
+  MemoryUsage memoryUsage(const QString &name) const;
 
   /** Returns the number of images within the DFU file. */
 	int numImages() const;
@@ -217,14 +340,44 @@ public:
 
   /** Checks if all image addresses and sizes is aligned with the given block size. */
   bool isAligned(unsigned blocksize) const;
+  /** Compacts all images, see @c Image::compact.
+   * @returns The number of elements removed by merging. */
+  unsigned compact(uint32_t maxGap=0, uint8_t fill=0x00);
+  /** Prepares all images for concurrent access, see @c Image::prepareConcurrentAccess.
+   * @returns @c false if any image does not support concurrent access. */
+  bool prepareConcurrentAccess();
+  /** Marks all untouched elements of all images to be overwritten entirely, see
+   * @c Element::prepareOverwrite. Called before downloading into the allocated elements. */
+  void prepareOverwrite();
 
   /** Reads the specified DFU file.
+   *
+   * The file gets memory mapped if possible. The element data then refers to the mapping and is
+   * only copied once modified.
    * @return @c false on error. */
   bool read(const QString &filename, const ErrorStack &err=ErrorStack());
   /** Reads the specified DFU file.
    * @returns @c false on error. */
   bool read(QFile &file, const ErrorStack &err=ErrorStack());
 
+  /** Header of an element, see @c readHeaders. */
+  struct ElementHeader {
+    uint32_t address;  ///< The target address of the element.
+    uint32_t size;     ///< The size of the element data.
+  };
+  /** Header of an image, see @c readHeaders. */
+  struct ImageHeader {
+    QString name;                       ///< The name of the image.
+    QVector<ElementHeader> elements;    ///< The headers of the elements.
+  };
+  /** Reads only the headers of the images and elements of the specified DFU file.
+   *
+   * The element data is skipped, neither read nor verified. Hence, the costs are proportional to
+   * the number of headers, not to the size of the file. This is used to identify files quickly.
+   * @returns @c false on error, e.g., if the file is not a DFU file. */
+  static bool readHeaders(const QString &filename, QVector<ImageHeader> &images,
+                          const ErrorStack &err=ErrorStack());
+
   /** Writes to the specified file.
    * @returns @c false on error. */
   bool write(const QString &filename, const ErrorStack &err=ErrorStack());
@@ -234,6 +387,10 @@ public:
 
   /** Dumps a text representation of the DFU file structure to the specified text stream. */
 	void dump(QTextStream &stream) const;
+  /** Dumps a text representation of the given memory range of all images. */
+  void dump(QTextStream &stream, uint32_t address, uint32_t size) const;
+  /** Prints a summary of the DFU file, listing all elements, their CRCs and fill regions. */
+  void summarize(QTextStream &stream) const;
 
   /** Returns @c true if the specified address (and image) is allocated. */
   virtual bool isAllocated(uint32_t offset, uint32_t img=0) const;
@@ -243,9 +400,102 @@ public:
   /** Returns a const pointer to the encoded raw data at the specified offset. */
   virtual const unsigned char *data(uint32_t offset, uint32_t img=0) const;
 
+protected:
+  /** Reads the DFU file, element data is taken from the @c mapping if given. */
+  bool read(QFile &file, const QSharedPointer<Mapping> &mapping, const ErrorStack &err);
+
 protected:
   /// The list of images.
 	QVector<Image> _images;
 };
 
+
+/** Writes a DFU file incrementally, without holding the entire content in memory.
+ *
+ * Images and elements are appended one after another, the elements of an image in ascending
+ * address order. Headers are written up front with placeholder sizes, that get patched once the
+ * element, image or file is finished. The CRC is updated on the fly and corrected for the patched
+ * fields when closing the file (see @c CRC32::shift).
+ *
+ * @code
+ * DFUStreamWriter writer;
+ * writer.open(filename, err);
+ * writer.beginImage("Callsign DB", 0, err);
+ * writer.beginElement(0x00200000, err);
+ * writer.write(chunk, err); // repeatedly
+ * writer.endElement(err);
+ * writer.endImage(err);
+ * writer.close(err);
+ * @endcode
+ *
+ * @ingroup util */
+class DFUStreamWriter
+{
+public:
+  /** Constructor. */
+  DFUStreamWriter();
+  /** Destructor, closes the file without finishing it. */
+  virtual ~DFUStreamWriter();
+
+  /** Creates the specified file and writes the file prefix. */
+  bool open(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Starts a new image. */
+  bool beginImage(const QString &name, uint8_t altSettings=0, const ErrorStack &err=ErrorStack());
+  /** Starts a new element of the current image at the given address. */
+  bool beginElement(uint32_t address, const ErrorStack &err=ErrorStack());
+  /** Appends data to the current element. */
+  bool write(const char *data, uint32_t size, const ErrorStack &err=ErrorStack());
+  /** Appends data to the current element. */
+  bool write(const QByteArray &data, const ErrorStack &err=ErrorStack());
+  /** Appends @c n bytes of the given value to the current element. */
+  bool fill(uint8_t value, uint32_t n, const ErrorStack &err=ErrorStack());
+  /** Finishes the current element. */
+  bool endElement(const ErrorStack &err=ErrorStack());
+  /** Finishes the current image. */
+  bool endImage(const ErrorStack &err=ErrorStack());
+  /** Writes the file suffix and closes the file. */
+  bool close(const ErrorStack &err=ErrorStack());
+
+  /** Appends the given element to the current image. */
+  bool addElement(const DFUFile::Element &element, const ErrorStack &err=ErrorStack());
+  /** Appends the given image. */
+  bool addImage(const DFUFile::Image &image, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** A patched placeholder field. */
+  struct Patch {
+    qint64 offset;    ///< Offset of the field within the file.
+    uint32_t value;   ///< The value written.
+    uint8_t size;     ///< Size of the field in bytes (1 or 4).
+  };
+
+  /** Writes the given data to the file and updates the CRC. */
+  bool append(const void *data, uint32_t size, const ErrorStack &err);
+  /** Patches the little endian field of @c size bytes at the given offset, which was written as
+   * zeros before. */
+  bool patch(qint64 offset, uint32_t value, uint8_t size, const ErrorStack &err);
+
+protected:
+  /** The file being written. */
+  QFile _file;
+  /** The CRC register over all bytes written, with placeholders being zero. */
+  uint32_t _crc;
+  /** The patched placeholders, to correct the CRC. */
+  QVector<Patch> _patches;
+  /** The number of images written. */
+  uint8_t _numImages;
+  /** Offsets of the file size and image count fields. */
+  qint64 _fileSizeOffset, _numImagesOffset;
+  /** Offsets of the image size and element count fields of the current image, -1 if none. */
+  qint64 _imageSizeOffset, _numElementsOffset;
+  /** Start offset and number of elements of the current image. */
+  qint64 _imageStart; uint32_t _numElements;
+  /** Offset of the size field of the current element, -1 if none. */
+  qint64 _elementSizeOffset;
+  /** Address and size of the current element. */
+  uint32_t _elementAddress, _elementSize;
+  /** End address of the last element of the current image, to verify the address order. */
+  uint64_t _lastEnd;
+};
+
 #endif // DFUFILE_HH
@@ -0,0 +1,295 @@
+#include "dfupatch.hh"
+#include <QFile>
+#include <QtEndian>
+#include <algorithm>
+#include <vector>
+
+#include "crc32.hh"
+#include "logger.hh"
+
+/** Current version of the patch file format. */
+#define PATCH_VERSION 1
+
+typedef struct __attribute((packed)) {
+  uint8_t signature[8];      ///< File signature = "DMRPatch"
+  uint8_t version;           ///< File version = 0x01
+  uint32_t n_hunks;          ///< Number of hunks in little endian.
+} patch_prefix_t;
+
+typedef struct __attribute((packed)) {
+  uint8_t image;             ///< Image index.
+  uint32_t address;          ///< Start address in little endian.
+  uint32_t size;             ///< Size of the hunk data in little endian.
+} hunk_prefix_t;
+
+
+DFUPatch::DFUPatch()
+  : _hunks()
+{
+  // pass...
+}
+
+bool
+DFUPatch::isEmpty() const {
+  return _hunks.isEmpty();
+}
+
+int
+DFUPatch::numHunks() const {
+  return _hunks.size();
+}
+
+const DFUPatch::Hunk &
+DFUPatch::hunk(int i) const {
+  return _hunks.at(i);
+}
+
+uint32_t
+DFUPatch::size() const {
+  uint32_t size = 0;
+  foreach (const Hunk &h, _hunks)
+    size += h.data.size();
+  return size;
+}
+
+void
+DFUPatch::clear() {
+  _hunks.clear();
+}
+
+bool
+DFUPatch::touches(uint8_t image, uint32_t address, uint32_t size) const {
+  foreach (const Hunk &h, _hunks) {
+    if ((h.image == image) && (h.address < (address+size)) && (address < (h.address+h.data.size())))
+      return true;
+  }
+  return false;
+}
+
+void
+DFUPatch::addHunk(uint8_t image, uint32_t address, const char *data, uint32_t size) {
+  if (0 == size)
+    return;
+  if ((! _hunks.isEmpty()) && (_hunks.last().image == image)
+      && ((_hunks.last().address + _hunks.last().data.size()) == address)) {
+    _hunks.last().data.append(data, size);
+    return;
+  }
+  _hunks.append(Hunk{image, address, QByteArray(data, size)});
+}
+
+bool
+DFUPatch::diff(const DFUFile &from, const DFUFile &to, uint32_t mergeGap, const ErrorStack &err) {
+  _hunks.clear();
+
+  if (from.numImages() != to.numImages()) {
+    errMsg(err) << "Cannot compare DFU files with " << from.numImages() << " and "
+                << to.numImages() << " images.";
+    return false;
+  }
+
+  for (int i=0; i<to.numImages(); i++) {
+    const DFUFile::Image &a = from.image(i), &b = to.image(i);
+
+    // Sorted start addresses of the old elements, to find the end of unallocated ranges
+    std::vector<uint32_t> starts;
+    for (int j=0; j<a.numElements(); j++)
+      starts.push_back(a.element(j).address());
+    std::sort(starts.begin(), starts.end());
+
+    // Sort new elements to obtain sorted hunks
+    std::vector<int> order;
+    for (int j=0; j<b.numElements(); j++)
+      order.push_back(j);
+    std::stable_sort(order.begin(), order.end(), [&b](int x, int y) {
+      return b.element(x).address() < b.element(y).address();
+    });
+
+    foreach (int j, order) {
+      const DFUFile::Element &el = b.element(j);
+      uint32_t end = el.address() + el.memSize();
+      uint8_t newFill = 0x00;
+      bool newUniform = el.isUniform(&newFill);
+      const char *newData = el.data().constData();
+      for (uint32_t pos=el.address(); pos<end;) {
+        int k = a.findElement(pos);
+        if (0 > k) {
+          // Range is not allocated in the old file, up to the next old element
+          std::vector<uint32_t>::const_iterator next = std::upper_bound(starts.begin(), starts.end(), pos);
+          uint32_t rend = ((starts.end() == next) || (*next > end)) ? end : *next;
+          addHunk(i, pos, newData+(pos-el.address()), rend-pos);
+          pos = rend;
+          continue;
+        }
+
+        // Compare the overlap with the old element
+        const DFUFile::Element &old = a.element(k);
+        uint32_t oend = std::min(end, old.address()+old.memSize());
+        // Untouched elements of the same fill need no comparison
+        uint8_t oldFill = 0x00;
+        if (newUniform && old.isUniform(&oldFill) && (newFill == oldFill)) {
+          pos = oend;
+          continue;
+        }
+        const char *oldData = old.data().constData();
+        // Shared (unmodified) data needs no comparison
+        if ((newData+(pos-el.address())) == (oldData+(pos-old.address()))) {
+          pos = oend;
+          continue;
+        }
+        uint32_t o = pos;
+        while (o < oend) {
+          if (newData[o-el.address()] == oldData[o-old.address()]) {
+            o++;
+            continue;
+          }
+          // Extend the run of modified bytes, include short unmodified gaps
+          uint32_t start = o, last = o;
+          for (o++; (o < oend) && ((o-last) <= mergeGap); o++) {
+            if (newData[o-el.address()] != oldData[o-old.address()])
+              last = o;
+          }
+          addHunk(i, start, newData+(start-el.address()), last+1-start);
+          o = last+1;
+        }
+        pos = oend;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool
+DFUPatch::apply(DFUFile &file, const ErrorStack &err) const {
+  foreach (const Hunk &h, _hunks) {
+    if (h.image >= file.numImages()) {
+      errMsg(err) << "Cannot apply patch: Image " << int(h.image) << " does not exist.";
+      return false;
+    }
+    DFUFile::Image &image = file.image(h.image);
+    uint32_t end = h.address + h.data.size();
+
+    int idx = image.findElement(h.address);
+    if (0 <= idx) {
+      const DFUFile::Element &el = image.element(idx);
+      if (end > (el.address()+el.memSize())) {
+        errMsg(err) << "Cannot apply patch: Range 0x" << QString::number(h.address, 16)
+                    << "-0x" << QString::number(end, 16) << " is only partially allocated.";
+        return false;
+      }
+      memcpy(image.data(h.address), h.data.constData(), h.data.size());
+      continue;
+    }
+
+    // Not allocated at all, hence add as a new element
+    for (int i=0; i<image.numElements(); i++) {
+      if ((image.element(i).address() > h.address) && (image.element(i).address() < end)) {
+        errMsg(err) << "Cannot apply patch: Range 0x" << QString::number(h.address, 16)
+                    << "-0x" << QString::number(end, 16) << " is only partially allocated.";
+        return false;
+      }
+    }
+    image.addElement(h.address, h.data.size());
+    memcpy(image.data(h.address), h.data.constData(), h.data.size());
+  }
+
+  return true;
+}
+
+bool
+DFUPatch::read(const QString &filename, const ErrorStack &err) {
+  _hunks.clear();
+
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot read patch file '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+  QByteArray buffer = file.readAll();
+  file.close();
+
+  if (uint32_t(buffer.size()) < (sizeof(patch_prefix_t)+4)) {
+    errMsg(err) << "Cannot read patch file '" << filename << "': File too short.";
+    return false;
+  }
+
+  CRC32 crc;
+  crc.update((const uint8_t *)buffer.constData(), buffer.size()-4);
+  if (crc.get() != qFromLittleEndian<quint32>(buffer.constData()+buffer.size()-4)) {
+    errMsg(err) << "Cannot read patch file '" << filename << "': Invalid checksum.";
+    return false;
+  }
+
+  const patch_prefix_t *prefix = (const patch_prefix_t *)buffer.constData();
+  if (memcmp(prefix->signature, "DMRPatch", 8) || (PATCH_VERSION != prefix->version)) {
+    errMsg(err) << "Cannot read patch file '" << filename << "': Invalid signature or version.";
+    return false;
+  }
+
+  uint32_t n = qFromLittleEndian(prefix->n_hunks);
+  uint32_t offset = sizeof(patch_prefix_t), end = buffer.size()-4;
+  for (uint32_t i=0; i<n; i++) {
+    if ((offset+sizeof(hunk_prefix_t)) > end) {
+      errMsg(err) << "Cannot read patch file '" << filename << "': Truncated hunk " << i << ".";
+      return false;
+    }
+    const hunk_prefix_t *hp = (const hunk_prefix_t *)(buffer.constData()+offset);
+    uint32_t address = qFromLittleEndian(hp->address), size = qFromLittleEndian(hp->size);
+    offset += sizeof(hunk_prefix_t);
+    if ((end-offset) < size) {
+      errMsg(err) << "Cannot read patch file '" << filename << "': Truncated hunk " << i << ".";
+      return false;
+    }
+    _hunks.append(Hunk{hp->image, address, buffer.mid(offset, size)});
+    offset += size;
+  }
+
+  return true;
+}
+
+bool
+DFUPatch::write(const QString &filename, const ErrorStack &err) const {
+  QByteArray buffer;
+
+  patch_prefix_t prefix;
+  memcpy(prefix.signature, "DMRPatch", 8);
+  prefix.version = PATCH_VERSION;
+  prefix.n_hunks = qToLittleEndian(uint32_t(_hunks.size()));
+  buffer.append((const char *)&prefix, sizeof(patch_prefix_t));
+
+  foreach (const Hunk &h, _hunks) {
+    hunk_prefix_t hp;
+    hp.image = h.image;
+    hp.address = qToLittleEndian(h.address);
+    hp.size = qToLittleEndian(uint32_t(h.data.size()));
+    buffer.append((const char *)&hp, sizeof(hunk_prefix_t));
+    buffer.append(h.data);
+  }
+
+  CRC32 crc; crc.update(buffer);
+  uint32_t checksum = qToLittleEndian(crc.get());
+  buffer.append((const char *)&checksum, 4);
+
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot create patch file '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+  if (buffer.size() != file.write(buffer)) {
+    errMsg(err) << "Cannot write patch file '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+  file.close();
+  return true;
+}
+
+void
+DFUPatch::dump(QTextStream &stream) const {
+  foreach (const Hunk &h, _hunks) {
+    stream << "  Image " << int(h.image) << " 0x" << QString::number(h.address, 16).rightJustified(8, '0')
+           << "-0x" << QString::number(h.address+h.data.size(), 16).rightJustified(8, '0')
+           << " (" << h.data.size() << "b)\n";
+  }
+  stream << _hunks.size() << " modified ranges, " << size() << "b total.\n";
+}
@@ -0,0 +1,77 @@
+#ifndef DFUPATCH_HH
+#define DFUPATCH_HH
+
+#include <QVector>
+#include <QByteArray>
+#include <QTextStream>
+#include "dfufile.hh"
+#include "errorstack.hh"
+
+/** Implements a binary patch between two DFU files.
+ *
+ * A patch is a list of hunks, each holding the image index, address and new content of a modified
+ * memory range. It is created by comparing two DFU files (see @c diff) and can be applied to the
+ * older one to obtain the newer one (see @c apply). Memory only present in the older file is left
+ * untouched, as DFU images have no notion of removed memory.
+ *
+ * The patch file format is little endian and consists of a header (signature "DMRPatch", version
+ * byte and number of hunks), the hunks (image byte, address, size and data) and a trailing CRC32
+ * over everything before it.
+ *
+ * @ingroup util */
+class DFUPatch
+{
+public:
+  /** A single modified memory range. */
+  struct Hunk {
+    uint8_t image;      ///< Index of the image.
+    uint32_t address;   ///< Start address of the range.
+    QByteArray data;    ///< New content of the range.
+  };
+
+public:
+  /** Constructs an empty patch. */
+  DFUPatch();
+
+  /** Returns @c true if the patch contains no hunks. */
+  bool isEmpty() const;
+  /** Returns the number of hunks. */
+  int numHunks() const;
+  /** Returns the i-th hunk. */
+  const Hunk &hunk(int i) const;
+  /** Returns the total number of patched bytes. */
+  uint32_t size() const;
+  /** Removes all hunks. */
+  void clear();
+
+  /** Returns @c true if the given memory range of the specified image is touched by the patch. */
+  bool touches(uint8_t image, uint32_t address, uint32_t size) const;
+
+  /** Computes the patch turning @c from into @c to. Modified ranges separated by fewer than
+   * @c mergeGap unmodified bytes are merged into a single hunk.
+   * @returns @c false if the files have a different number of images. */
+  bool diff(const DFUFile &from, const DFUFile &to, uint32_t mergeGap=8,
+            const ErrorStack &err=ErrorStack());
+  /** Applies this patch to the given file. Ranges not allocated in the file are added as new
+   * elements.
+   * @returns @c false if a hunk refers to a missing image or partially allocated memory. */
+  bool apply(DFUFile &file, const ErrorStack &err=ErrorStack()) const;
+
+  /** Reads a patch from the given file. */
+  bool read(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Writes the patch to the given file. */
+  bool write(const QString &filename, const ErrorStack &err=ErrorStack()) const;
+
+  /** Prints the modified address ranges to the given stream. */
+  void dump(QTextStream &stream) const;
+
+protected:
+  /** Appends a hunk, merges it with the previous one if directly adjacent. */
+  void addHunk(uint8_t image, uint32_t address, const char *data, uint32_t size);
+
+protected:
+  /** The hunks, sorted by image and address. */
+  QVector<Hunk> _hunks;
+};
+
+#endif // DFUPATCH_HH
@@ -5,8 +5,6 @@
 #include "logger.hh"
 #include "utils.hh"
 
-RadioLimits *DM1701::_limits = nullptr;
-
 
 DM1701::DM1701(TyTInterface *device, QObject *parent)
   : TyTRadio(device, parent), _name("Baofeng DM-1701"), _codeplug()
@@ -21,9 +19,7 @@ DM1701::name() const {
 
 const RadioLimits &
 DM1701::limits() const {
-  if (nullptr == _limits)
-    _limits = new DM1701Limits();
-  return *_limits;
+  return *RadioLimits::shared("dm1701", []() -> RadioLimits * { return new DM1701Limits(); });
 }
 
 RadioInfo
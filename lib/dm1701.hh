@@ -61,10 +61,6 @@ protected:
   DM1701Codeplug _codeplug;
   /** The callsign DB object. */
   DM1701CallsignDB _callsigndb;
-
-private:
-  /** Holds the singleton instance of the radio limits. */
-  static RadioLimits *_limits;
 };
 
 #endif // DM1701_HH
@@ -260,6 +260,8 @@ public:
   /** Destructor. */
   virtual ~DM1701Codeplug();
 
+  std::vector<AddressMap::Range> generatedMemory() const;
+
 public:
   void clearTimestamp();
   bool encodeTimestamp();
@@ -1,6 +1,5 @@
 #include "dm1701_filereader.hh"
-#include <QFile>
-#include <QFileInfo>
+#include "mappedfile.hh"
 
 #define SEGMENT0_FILE_ADDR   0x00002225
 #define SEGMENT0_TARGET_ADDR 0x00002000
@@ -12,65 +11,21 @@
 bool
 DM1701FileReader::read(const QString &filename, DM1701Codeplug *codeplug, const ErrorStack &err)
 {
-  // Check file properties
-  QFileInfo info(filename);
-  if (! info.exists()) {
-    errMsg(err) << "Cannot open file '" << filename << "': File does not exisist.";
+  // Map file, the segments get copied directly into the codeplug
+  MappedFile file;
+  if (! file.open(filename, err))
     return false;
-  }
-  if (852533 != info.size()) {
+  if (852533 != file.size()) {
     errMsg(err) << "Cannot read codeplug file '" << filename << "': File size is not 852533 bytes.";
     return false;
   }
 
-  // Open file
-  QFile file(filename);
-  if (! file.open(QFile::ReadOnly)) {
-    errMsg(err) << "Cannot open file '" << filename << "': " << file.errorString() << ".";
-    return false;
-  }
-
-  // Read file content
-
-  if (! file.seek(SEGMENT0_FILE_ADDR)) {
-    errMsg(err) << "Cannot read codeplug file '" << filename
-                << "': Cannot seek within file: " << file.errorString() << ".";
-    file.close();
-    return false;
-  }
-  char *ptr = (char *)codeplug->data(SEGMENT0_TARGET_ADDR);
-  size_t n = SEGMENT0_SIZE;
-  while (0 < n) {
-    int nread = file.read(ptr, n);
-    if (0 > nread) {
-      errMsg(err) << "Cannot read codeplug file '" << filename
-                  << "': " << file.errorString() << ".";
-      file.close();
-      return false;
-    }
-    n -= nread;
-    ptr += nread;
-  }
-
-  if (! file.seek(SEGMENT1_FILE_ADDR)) {
-    errMsg(err) << "Cannot read codeplug file '" << filename
-                << "': Cannot seek within file: " << file.errorString() << ".";
-    file.close();
+  // Copy file content
+  if ((! file.copy(SEGMENT0_FILE_ADDR, codeplug->data(SEGMENT0_TARGET_ADDR), SEGMENT0_SIZE, err)) ||
+      (! file.copy(SEGMENT1_FILE_ADDR, codeplug->data(SEGMENT1_TARGET_ADDR), SEGMENT1_SIZE, err))) {
+    errMsg(err) << "Cannot read codeplug file '" << filename << "'.";
     return false;
   }
-  ptr = (char *)codeplug->data(SEGMENT1_TARGET_ADDR);
-  n = SEGMENT1_SIZE;
-  while (0 < n) {
-    int nread = file.read(ptr, n);
-    if (0 > nread) {
-      errMsg(err) << "Cannot read codeplug file '" << filename
-                  << "': " << file.errorString() << ".";
-      file.close();
-      return false;
-    }
-    n -= nread;
-    ptr += nread;
-  }
 
   return true;
 }
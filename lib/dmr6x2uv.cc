@@ -18,91 +18,81 @@ DMR6X2UV::DMR6X2UV(AnytoneInterface *device, QObject *parent)
   if (_dev)
     _dev->getInfo(info);
 
-  switch (info.bands) {
-  case 0x00:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(400.), Frequency::fromMHz(480.)} },
-                                 { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(400.), Frequency::fromMHz(480.)} }, info.version, this);
-    break;
-  case 0x01:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(400.), Frequency::fromMHz(480.)} },
-                                 { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(420.), Frequency::fromMHz(450.)} }, info.version, this);
-    break;
-  case 0x02:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(430.), Frequency::fromMHz(440.)} },
-                                 { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(430.), Frequency::fromMHz(440.)} }, info.version, this);
-    break;
-  case 0x03:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(430.), Frequency::fromMHz(440.)} },
-                                 { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(430.), Frequency::fromMHz(440.)} }, info.version, this);
-    break;
-  case 0x04:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(440.), Frequency::fromMHz(480.)} },
-                                 { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(440.), Frequency::fromMHz(480.)} }, info.version, this);
-    break;
-  case 0x05:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(440.), Frequency::fromMHz(480.)} },
-                                 { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(440.), Frequency::fromMHz(480.)} }, info.version, this);
-    break;
-  case 0x06:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(446.), Frequency::fromMHz(447.)} },
-                                 { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(446.), Frequency::fromMHz(447.)} }, info.version, this);
-    break;
-  case 0x07:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(446.), Frequency::fromMHz(447.)} },
-                                 { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(446.), Frequency::fromMHz(447.)} }, info.version, this);
-    break;
-  case 0x08:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(400.), Frequency::fromMHz(470.)} },
-                                 { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(400.), Frequency::fromMHz(470.)} }, info.version, this);
-    break;
-  case 0x09:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(430.), Frequency::fromMHz(432.)} },
-                                 { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(430.), Frequency::fromMHz(432.)} }, info.version, this);
-    break;
-  case 0x0a:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(400.), Frequency::fromMHz(480.)} },
-                                 { {Frequency::fromMHz(144.), Frequency::fromMHz(148.)},
-                                   {Frequency::fromMHz(430.), Frequency::fromMHz(450.)} }, info.version, this);
-    break;
-  case 0x0b:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(400.), Frequency::fromMHz(480.)} },
-                                 { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
-                                   {Frequency::fromMHz(430.), Frequency::fromMHz(440.)} }, info.version, this);
-    break;
-  case 0x0c:
-    _limits = new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(403.), Frequency::fromMHz(470.)} },
-                                 { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
-                                   {Frequency::fromMHz(403.), Frequency::fromMHz(470.)} }, info.version, this);
-    break;
-  default:
-    logInfo() << "Unknown band-code" << QString::number(int(info.bands), 16)
-              << ": Do not check frequency range.";
-    _limits = new DMR6X2UVLimits({}, {}, info.version, this);
-    break;
-  }
+  // The limits are shared between all radios of the same variant
+  QString key = QString("dmr6x2uv:%1:%2").arg(int(uint8_t(info.bands)), 2, 16, QChar('0')).arg(info.version);
+  _limits = RadioLimits::shared(key, [info]() -> RadioLimits * {
+    switch (info.bands) {
+    case 0x00:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(400.), Frequency::fromMHz(480.)} },
+                                { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(400.), Frequency::fromMHz(480.)} }, info.version);
+    case 0x01:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(400.), Frequency::fromMHz(480.)} },
+                                { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(420.), Frequency::fromMHz(450.)} }, info.version);
+    case 0x02:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(430.), Frequency::fromMHz(440.)} },
+                                { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(430.), Frequency::fromMHz(440.)} }, info.version);
+    case 0x03:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(430.), Frequency::fromMHz(440.)} },
+                                { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(430.), Frequency::fromMHz(440.)} }, info.version);
+    case 0x04:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(440.), Frequency::fromMHz(480.)} },
+                                { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(440.), Frequency::fromMHz(480.)} }, info.version);
+    case 0x05:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(440.), Frequency::fromMHz(480.)} },
+                                { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(440.), Frequency::fromMHz(480.)} }, info.version);
+    case 0x06:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(446.), Frequency::fromMHz(447.)} },
+                                { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(446.), Frequency::fromMHz(447.)} }, info.version);
+    case 0x07:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(446.), Frequency::fromMHz(447.)} },
+                                { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(446.), Frequency::fromMHz(447.)} }, info.version);
+    case 0x08:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(400.), Frequency::fromMHz(470.)} },
+                                { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(400.), Frequency::fromMHz(470.)} }, info.version);
+    case 0x09:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(430.), Frequency::fromMHz(432.)} },
+                                { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(430.), Frequency::fromMHz(432.)} }, info.version);
+    case 0x0a:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(400.), Frequency::fromMHz(480.)} },
+                                { {Frequency::fromMHz(144.), Frequency::fromMHz(148.)},
+                                  {Frequency::fromMHz(430.), Frequency::fromMHz(450.)} }, info.version);
+    case 0x0b:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(400.), Frequency::fromMHz(480.)} },
+                                { {Frequency::fromMHz(144.), Frequency::fromMHz(146.)},
+                                  {Frequency::fromMHz(430.), Frequency::fromMHz(440.)} }, info.version);
+    case 0x0c:
+      return new DMR6X2UVLimits({ {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(403.), Frequency::fromMHz(470.)} },
+                                { {Frequency::fromMHz(136.), Frequency::fromMHz(174.)},
+                                  {Frequency::fromMHz(403.), Frequency::fromMHz(470.)} }, info.version);
+    default:
+      logInfo() << "Unknown band-code" << QString::number(int(info.bands), 16)
+                << ": Do not check frequency range.";
+      return new DMR6X2UVLimits({}, {}, info.version);
+    }
+  });
 }
 
 const RadioLimits &
@@ -33,7 +33,7 @@ public:
   static RadioInfo defaultRadioInfo();
 
 private:
-  RadioLimits *_limits;
+  const RadioLimits *_limits;
 };
 
 
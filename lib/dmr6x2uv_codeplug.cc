@@ -4,6 +4,7 @@
 #include "dmr6x2uv_codeplug.hh"
 #include "utils.hh"
 #include "logger.hh"
+#include "tracer.hh"
 
 
 /* ******************************************************************************************** *
@@ -2001,6 +2002,7 @@ DMR6X2UVCodeplug::setBitmaps(Context& ctx)
 
 void
 DMR6X2UVCodeplug::allocateUpdated() {
+  TRACE_SPAN("DMR6X2UVCodeplug::allocateUpdated", "codeplug");
   // First allocate everything common between D868UV and DMR-6X2UV codeplugs.
   D868UVCodeplug::allocateUpdated();
 
@@ -2010,6 +2012,7 @@ DMR6X2UVCodeplug::allocateUpdated() {
 
 void
 DMR6X2UVCodeplug::allocateForEncoding() {
+  TRACE_SPAN("DMR6X2UVCodeplug::allocateForEncoding", "codeplug");
   // First allocate everything common between D868UV and D878UV codeplugs.
   D868UVCodeplug::allocateForEncoding();
 
@@ -2018,23 +2021,28 @@ DMR6X2UVCodeplug::allocateForEncoding() {
 
 void
 DMR6X2UVCodeplug::allocateForDecoding() {
+  TRACE_SPAN("DMR6X2UVCodeplug::allocateForDecoding", "codeplug");
   // First allocate everything common between D868UV and D878UV codeplugs.
   D868UVCodeplug::allocateForDecoding();
 
-  this->allocateRoaming();
+  if (_sections.has(Sections::Roaming))
+    this->allocateRoaming();
 
   // allocate FM APRS frequency names
-  image(0).addElement(Offset::fmAPRSFrequencyNames(), D878UVCodeplug::FMAPRSFrequencyNamesElement::size());
+  if (_sections.has(Sections::Positioning))
+    image(0).addElement(Offset::fmAPRSFrequencyNames(), D878UVCodeplug::FMAPRSFrequencyNamesElement::size());
 }
 
 bool
 DMR6X2UVCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err)
 {
+  TRACE_SPAN("DMR6X2UVCodeplug::encodeElements", "codeplug");
   // Encode everything common between d868uv and d878uv radios.
   if (! D868UVCodeplug::encodeElements(flags, ctx, err))
     return false;
 
-  if (! this->encodeRoaming(flags, ctx, err))
+  if ((ctx.isDirty<RoamingChannel>() || ctx.isDirty<RoamingZone>())
+      && (! this->encodeRoaming(flags, ctx, err)))
     return false;
 
   return true;
@@ -2044,10 +2052,14 @@ DMR6X2UVCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorSt
 bool
 DMR6X2UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err)
 {
+  TRACE_SPAN("DMR6X2UVCodeplug::decodeElements", "codeplug");
   // Decode everything commong between d868uv and d878uv codeplugs.
   if (! D868UVCodeplug::decodeElements(ctx, err))
     return false;
 
+  if (! _sections.has(Sections::Roaming))
+    return true;
+
   if (! this->createRoaming(ctx, err))
     return false;
 
@@ -2106,32 +2118,21 @@ DMR6X2UVCodeplug::encodeChannels(const Flags &flags, Context &ctx, const ErrorSt
   // Encode channels
   for (int i=0; i<ctx.config()->channelList()->count(); i++) {
     // enable channel
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    ChannelElement ch(data(Offset::channelBanks() + bank * Offset::betweenChannelBanks()
-                           + idx * ChannelElement::size()));
+    ChannelElement ch(data(Table::channels().address(i)));
     if (! ch.fromChannelObj(ctx.config()->channelList()->channel(i), ctx))
       return false;
   }
   return true;
 }
 
-bool
-DMR6X2UVCodeplug::createChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-  // Create channels
+Channel *
+DMR6X2UVCodeplug::createChannel(unsigned int i, Context &ctx) {
+  // Check if channel is enabled:
   ChannelBitmapElement channel_bitmap(data(Offset::channelBitmap()));
-  for (uint16_t i=0; i<Limit::numChannels(); i++) {
-    // Check if channel is enabled:
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    if (! channel_bitmap.isEncoded(i))
-      continue;
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
-    if (Channel *obj = ch.toChannelObj(ctx)) {
-      ctx.config()->channelList()->add(obj); ctx.add(obj, i);
-    }
-  }
-  return true;
+  if ((i >= Limit::numChannels()) || (! channel_bitmap.isEncoded(i)))
+    return nullptr;
+  ChannelElement ch(data(Table::channels().address(i)));
+  return ch.toChannelObj(ctx);
 }
 
 bool
@@ -2144,9 +2145,7 @@ DMR6X2UVCodeplug::linkChannels(Context &ctx, const ErrorStack &err) {
     // Check if channel is enabled:
     if (! channel_bitmap.isEncoded(i))
       continue;
-    uint16_t bank = i/Limit::channelsPerBank(), idx = i%Limit::channelsPerBank();
-    ChannelElement ch(data(Offset::channelBanks() + bank*Offset::betweenChannelBanks()
-                           + idx*ChannelElement::size()));
+    ChannelElement ch(data(Table::channels().address(i)));
     if (ctx.has<Channel>(i))
       ch.linkChannelObj(ctx.get<Channel>(i), ctx);
   }
@@ -1120,7 +1120,7 @@ protected:
   bool linkGeneralSettings(Context &ctx, const ErrorStack &err=ErrorStack());
 
   virtual bool encodeChannels(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
-  virtual bool createChannels(Context &ctx, const ErrorStack &err=ErrorStack());
+  virtual Channel *createChannel(unsigned int i, Context &ctx);
   virtual bool linkChannels(Context &ctx, const ErrorStack &err=ErrorStack());
 
   void allocateGPSSystems();
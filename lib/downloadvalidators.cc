@@ -0,0 +1,111 @@
+#include "downloadvalidators.hh"
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QFile>
+#include <QDateTime>
+#include "logger.hh"
+
+
+DownloadValidators::DownloadValidators(const QString &filename)
+  : _filename(filename)
+{
+  // pass...
+}
+
+QString
+DownloadValidators::filename() const {
+  return _filename + ".validators";
+}
+
+QByteArray
+DownloadValidators::etag() const {
+  QByteArray etag, lastModified;
+  read(etag, lastModified);
+  return etag;
+}
+
+QByteArray
+DownloadValidators::lastModified() const {
+  QByteArray etag, lastModified;
+  read(etag, lastModified);
+  return lastModified;
+}
+
+bool
+DownloadValidators::prepare(QNetworkRequest &request) const {
+  QByteArray etag, lastModified;
+  if ((! QFile::exists(_filename)) || (! read(etag, lastModified)))
+    return false;
+  if (! etag.isEmpty())
+    request.setRawHeader("If-None-Match", etag);
+  if (! lastModified.isEmpty())
+    request.setRawHeader("If-Modified-Since", lastModified);
+  return (! etag.isEmpty()) || (! lastModified.isEmpty());
+}
+
+bool
+DownloadValidators::notModified(const QNetworkReply *reply) {
+  return 304 == reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+}
+
+bool
+DownloadValidators::store(const QNetworkReply *reply) const {
+  return store(reply->rawHeader("ETag"), reply->rawHeader("Last-Modified"));
+}
+
+bool
+DownloadValidators::store(const QByteArray &etag, const QByteArray &lastModified) const {
+  if (etag.isEmpty() && lastModified.isEmpty()) {
+    if (QFile::exists(filename()))
+      return QFile::remove(filename());
+    return true;
+  }
+
+  QJsonObject obj;
+  if (! etag.isEmpty())
+    obj.insert("etag", QString::fromLatin1(etag));
+  if (! lastModified.isEmpty())
+    obj.insert("lastModified", QString::fromLatin1(lastModified));
+
+  QSaveFile file(filename());
+  if (! file.open(QIODevice::WriteOnly)) {
+    logWarn() << "Cannot store download validators at " << filename() << ": " << file.errorString();
+    return false;
+  }
+  file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+  return file.commit();
+}
+
+bool
+DownloadValidators::touch(const QStringList &dependents) const {
+  QDateTime now = QDateTime::currentDateTime();
+  // The downloaded file first, dependents must not appear older than the download
+  QStringList files = QStringList(_filename) + dependents;
+  bool ok = true;
+  foreach (const QString &name, files) {
+    QFile file(name);
+    if (! file.exists())
+      continue;
+    if ((! file.open(QIODevice::Append)) || (! file.setFileTime(now, QFileDevice::FileModificationTime))) {
+      logWarn() << "Cannot update modification time of " << name << ": " << file.errorString();
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+bool
+DownloadValidators::read(QByteArray &etag, QByteArray &lastModified) const {
+  QFile file(filename());
+  if (! file.open(QIODevice::ReadOnly))
+    return false;
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+  if (! doc.isObject())
+    return false;
+  etag = doc.object().value("etag").toString().toLatin1();
+  lastModified = doc.object().value("lastModified").toString().toLatin1();
+  return true;
+}
@@ -0,0 +1,71 @@
+#ifndef DOWNLOADVALIDATORS_HH
+#define DOWNLOADVALIDATORS_HH
+
+#include <QString>
+#include <QByteArray>
+#include <QStringList>
+
+class QNetworkRequest;
+class QNetworkReply;
+
+/** The HTTP cache validators (i.e., the @c ETag and @c Last-Modified headers) of a downloaded file.
+ *
+ * The validators are stored next to the downloaded file (e.g., @c user.json.validators). When the
+ * file gets refreshed, they are sent with the request as @c If-None-Match and @c If-Modified-Since.
+ * If the file did not change on the server, it answers with an empty "304 Not Modified" and the
+ * local copy is just marked as fresh (see @c touch).
+ *
+ * @code
+ * DownloadValidators validators(path+"/user.json");
+ * QNetworkRequest request(url);
+ * if (haveValidCopy)
+ *   validators.prepare(request);
+ * ...
+ * if (DownloadValidators::notModified(reply))
+ *   validators.touch({cacheFile});
+ * else if (saveFile.commit())
+ *   validators.store(reply);
+ * @endcode
+ *
+ * @ingroup util */
+class DownloadValidators
+{
+public:
+  /** Constructs the validators of the given downloaded file. */
+  explicit DownloadValidators(const QString &filename);
+
+  /** Returns the file, the validators are stored in. */
+  QString filename() const;
+  /** Returns the stored entity tag or an empty array. */
+  QByteArray etag() const;
+  /** Returns the stored last-modified date (as sent by the server) or an empty array. */
+  QByteArray lastModified() const;
+
+  /** Adds the conditional headers to the given request, if the downloaded file and its validators
+   * exist. The request must not set @c Accept-Encoding, Qt then negotiates a compressed transfer
+   * and decompresses the reply transparently.
+   * @returns @c true if the request became conditional. */
+  bool prepare(QNetworkRequest &request) const;
+  /** Returns @c true if the server reported the requested file as unchanged. */
+  static bool notModified(const QNetworkReply *reply);
+
+  /** Stores the validators of the given (successful) reply. If the server sent none, any stored
+   * validators get removed. */
+  bool store(const QNetworkReply *reply) const;
+  /** Stores the given validators. If both are empty, any stored validators get removed. */
+  bool store(const QByteArray &etag, const QByteArray &lastModified) const;
+  /** Marks the downloaded file as fresh by updating its modification time. The given dependent
+   * files (e.g., binary caches derived from the download) get the same modification time, such
+   * that they are not considered outdated. */
+  bool touch(const QStringList &dependents=QStringList()) const;
+
+protected:
+  /** Reads the stored validators. */
+  bool read(QByteArray &etag, QByteArray &lastModified) const;
+
+protected:
+  /** The downloaded file. */
+  QString _filename;
+};
+
+#endif // DOWNLOADVALIDATORS_HH
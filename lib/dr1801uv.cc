@@ -3,8 +3,6 @@
 #include "logger.hh"
 
 
-RadioLimits * DR1801UV::_limits = nullptr;
-
 DR1801UV::DR1801UV(DR1801UVInterface *device, QObject *parent)
   : Radio(parent), _device(device), _name("Baofeng DR-1801UV")
 {
@@ -15,6 +13,17 @@ DR1801UV::DR1801UV(DR1801UVInterface *device, QObject *parent)
   }
 }
 
+void
+DR1801UV::moveInterfaceToThread(QThread *thread) {
+  if (_device)
+    _device->moveToThread(thread);
+}
+
+RadioInterface *
+DR1801UV::radioInterface() const {
+  return _device;
+}
+
 RadioInfo
 DR1801UV::defaultRadioInfo() {
   return RadioInfo(RadioInfo::DR1801UV, "dr1801uv",
@@ -40,9 +49,7 @@ DR1801UV::codeplug() {
 
 const RadioLimits &
 DR1801UV::limits() const {
-  if (nullptr == _limits)
-    _limits = new DR1801UVLimits();
-  return *_limits;
+  return *RadioLimits::shared("dr1801uv", []() -> RadioLimits * { return new DR1801UVLimits(); });
 }
 
 bool
@@ -154,8 +161,9 @@ DR1801UV::run() {
 
 bool
 DR1801UV::download() {
+  enterPhase(PhaseRead);
   if (! _device->readCodeplug(_codeplug, [this](unsigned int n, unsigned int total){
-                              emit downloadProgress(float(n*100)/total); }, _errorStack)) {
+                              reportDownloadProgress(float(n*100)/total); }, _errorStack)) {
     errMsg(_errorStack) << "Cannot read codeplug from device.";
     return false;
   }
@@ -166,20 +174,23 @@ DR1801UV::download() {
 bool
 DR1801UV::upload() {
   // First, read codeplug from the device
+  enterPhase(PhaseRead);
   if (! _device->readCodeplug(_codeplug, [this](unsigned int n, unsigned int total) {
-                              emit uploadProgress(float(n*50)/total); }, _errorStack))
+                              reportUploadProgress(float(n*50)/total); }, _errorStack))
   {
     errMsg(_errorStack) << "Cannot read codeplug.";
     return false;
   }
 
   // Encode config into codeplug
+  enterPhase(PhaseEncode);
   _codeplug.encode(_config, _codeplugFlags);
   _codeplug.data(0x304)[0] = 0;
 
   // Write codeplug back to the device
+  enterPhase(PhaseWrite);
   if (! _device->writeCodeplug(_codeplug, [this](unsigned int n, unsigned int total) {
-                               emit uploadProgress(50+float(n*50)/total); }, _errorStack)) {
+                               reportUploadProgress(50+float(n*50)/total); }, _errorStack)) {
     errMsg(_errorStack) << "Cannot write codeplug to the device.";
   }
 
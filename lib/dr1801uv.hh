@@ -40,6 +40,8 @@ public:
   bool startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignDB::Selection &selection, const ErrorStack &err);
 
 protected:
+  void moveInterfaceToThread(QThread *thread);
+  RadioInterface *radioInterface() const;
   /** Thread main routine, performs all blocking IO operations for codeplug up- and download. */
   void run();
 
@@ -58,10 +60,6 @@ protected:
   Config *_config;
   /** Some codeplug flags. */
   Codeplug::Flags _codeplugFlags;
-
-private:
-  /** Holds the singleton instance of the radio limits. */
-  static RadioLimits *_limits;
 };
 
 #endif // DR1801UV_HH
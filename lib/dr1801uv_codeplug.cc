@@ -4,8 +4,10 @@
 #include "zone.hh"
 #include "config.hh"
 #include "intermediaterepresentation.hh"
+#include "tracer.hh"
 
 #include <QRegularExpression>
+#include "stringpool.hh"
 
 
 /* ******************************************************************************************** *
@@ -3226,6 +3228,7 @@ DR1801UVCodeplug::DR1801UVCodeplug(QObject *parent)
 
 Config *
 DR1801UVCodeplug::preprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("DR1801UVCodeplug::preprocess", "codeplug");
   Config *copy = Codeplug::preprocess(config, err);
   if (nullptr == copy) {
     errMsg(err) << "Cannot pre-process DR1801A6 codeplug.";
@@ -3245,6 +3248,7 @@ DR1801UVCodeplug::preprocess(Config *config, const ErrorStack &err) const {
 
 bool
 DR1801UVCodeplug::postprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("DR1801UVCodeplug::postprocess", "codeplug");
   if (! Codeplug::postprocess(config, err)) {
     errMsg(err) << "Cannot post-process DR1801A6 codeplug.";
     return false;
@@ -3262,6 +3266,7 @@ DR1801UVCodeplug::postprocess(Config *config, const ErrorStack &err) const {
 
 bool
 DR1801UVCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) const {
+  TRACE_SPAN("DR1801UVCodeplug::index", "codeplug");
   Q_UNUSED(err)
 
   // All indices as 0-based. That is, the first channel gets index 0 etc.
@@ -3305,6 +3310,7 @@ DR1801UVCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) con
 
 bool
 DR1801UVCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
+  TRACE_SPAN("DR1801UVCodeplug::encode", "codeplug");
   Q_UNUSED(flags);
 
   Context ctx(config);
@@ -3324,6 +3330,9 @@ DR1801UVCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &e
 
 bool
 DR1801UVCodeplug::decode(Config *config, const ErrorStack &err) {
+  TRACE_SPAN("DR1801UVCodeplug::decode", "codeplug");
+  // Names decoded repeatedly share their storage
+  StringPool::Scope strings;
   Context ctx(config);
 
   if (! decodeElements(ctx, err)) {
@@ -3341,6 +3350,7 @@ DR1801UVCodeplug::decode(Config *config, const ErrorStack &err) {
 
 bool
 DR1801UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("DR1801UVCodeplug::decodeElements", "codeplug");
   if (! ChannelBankElement(data(Offset::channelBank())).decode(ctx, err)) {
     errMsg(err) << "Cannot decode channel elements.";
     return false;
@@ -3392,6 +3402,7 @@ DR1801UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err) {
 
 bool
 DR1801UVCodeplug::linkElements(Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("DR1801UVCodeplug::linkElements", "codeplug");
   if (! ChannelBankElement(data(Offset::channelBank())).link(ctx, err)) {
     errMsg(err) << "Cannot link channels.";
     return false;
@@ -3422,6 +3433,7 @@ DR1801UVCodeplug::linkElements(Context &ctx, const ErrorStack &err) {
 
 bool
 DR1801UVCodeplug::encodeElements(Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("DR1801UVCodeplug::encodeElements", "codeplug");
   if (! SettingsElement(data(Offset::settings())).fromConfig(ctx.config(), err)) {
     errMsg(err) << "Cannot encode settings element.";
     return false;
@@ -1,5 +1,6 @@
 #include "dr1801uv_interface.hh"
 #include <QtEndian>
+#include <cstring>
 #include "logger.hh"
 #include "dr1801uv.hh"
 
@@ -10,6 +11,22 @@
 #define WRITE_CODEPLUG_OFFSET 0x00000304
 #define WRITE_CODEPLUG_SIZE   0x0001da8c
 
+/** Number of bytes read or written at once during a codeplug transfer. */
+#define TRANSFER_CHUNK_SIZE   0x4000
+/** Timeout for each chunk in ms, on top of the time needed to transfer it at the current speed. */
+#define TRANSFER_TIMEOUT      2000
+/** Time in ms, the device needs to switch to a new baud rate. */
+#define BAUDRATE_SETTLE_TIME  1000
+/** Time in ms without any data after which the line is considered quiet, once a transfer is done. */
+#define QUIET_LINE_TIME       50
+
+/** Returns the time in ms, needed to transfer the given number of bytes at the given baud rate. */
+static inline int
+transferTime(unsigned int bytes, uint32_t baudrate) {
+  // 10 bit per byte (start, 8 data, stop)
+  return TRANSFER_TIMEOUT + int((quint64(bytes)*10*1000)/baudrate);
+}
+
 /* ********************************************************************************************* *
  * Implementation of DR1801UVInterface::PrepareReadRequest
  * ********************************************************************************************* */
@@ -50,9 +67,18 @@ DR1801UVInterface::PrepareWriteRequest::PrepareWriteRequest(uint32_t s, uint32_t
 
 void
 DR1801UVInterface::PrepareWriteRequest::updateCRC(const uint8_t *data, size_t length) {
-  uint16_t *ptr = (uint16_t*)data;
-  for (unsigned int i=0; i<length/2;i++) {
-    checksum ^= ptr[i];
+  // XOR 64-bit words and fold them afterwards, each holds four independent 16-bit lanes.
+  uint64_t sum = 0, word;
+  size_t i = 0;
+  for (; (i+8)<=length; i+=8) {
+    memcpy(&word, data+i, 8);
+    sum ^= word;
+  }
+  sum ^= sum >> 32; sum ^= sum >> 16;
+  checksum ^= uint16_t(sum);
+  for (uint16_t half; (i+2)<=length; i+=2) {
+    memcpy(&half, data+i, 2);
+    checksum ^= half;
   }
 }
 
@@ -77,9 +103,18 @@ DR1801UVInterface::CodeplugWriteResponse::isSuccessful() const {
 /* ********************************************************************************************* *
  * Implementation of DR1801UVInterface
  * ********************************************************************************************* */
+const uint32_t DR1801UVInterface::ReadSpeeds[] = {
+  460800, 230400, DR1801UVInterface::ReadSpeed
+};
+
+const uint32_t DR1801UVInterface::WriteSpeeds[] = {
+  QSerialPort::Baud115200, QSerialPort::Baud57600, QSerialPort::Baud19200,
+  DR1801UVInterface::WriteSpeed
+};
+
 DR1801UVInterface::DR1801UVInterface(const USBDeviceDescriptor &descriptor,
                                      const ErrorStack &err, QObject *parent)
-  : AuctusA6Interface(descriptor, err, parent), _identifier()
+  : AuctusA6Interface(descriptor, err, parent), _identifier(), _readSpeed(0), _writeSpeed(0)
 {
   if (! enterProgrammingMode(err)) {
     errMsg(err) << "Cannot connect to DR-1801UV.";
@@ -132,7 +167,7 @@ DR1801UVInterface::readCodeplug(
   }
 
   PrepareReadResponse resp;
-  if (! prepareReading(ReadSpeed, resp, err)) {
+  if (! negotiateReading(resp, err)) {
     errMsg(err) << "Cannot start reading the codeplug from " << _identifier << ".";
     _state = ERROR;
     return false;
@@ -156,10 +191,18 @@ DR1801UVInterface::readCodeplug(
     progress(0, total);
   logDebug() << "Start reading " << bytesToTransfer << "b of codeplug memory.";
 
+  // The device streams the codeplug, collect it in large chunks. It gets overwritten entirely,
+  // hence there is no need to initialize it.
+  codeplug.prepareOverwrite();
   unsigned int offset = 0;
   while (bytesToTransfer) {
-    unsigned n = std::min(256U, bytesToTransfer);
-    if (! AuctusA6Interface::read(codeplug.image(0).data(offset), n, 2000, err)) {
+    if (! checkCanceled(err)) {
+      _state = ERROR;
+      return false;
+    }
+    unsigned n = std::min(unsigned(TRANSFER_CHUNK_SIZE), bytesToTransfer);
+    if (! AuctusA6Interface::read(codeplug.image(0).data(offset), n,
+                                  transferTime(n, ReadSpeeds[_readSpeed]), err)) {
       errMsg(err) << "Cannot read from device '" << portName() << "'.";
       _state = ERROR;
       return false;
@@ -175,7 +218,8 @@ DR1801UVInterface::readCodeplug(
     errMsg(err) << "Cannot set baud-rate of serial port '" << portName() << "'.";
     return false;
   }
-  QThread::msleep(250);
+  // Wait until the line is quiet instead of a fixed delay
+  discardInput(QUIET_LINE_TIME);
 
   _state = IDLE;
 
@@ -212,7 +256,7 @@ DR1801UVInterface::writeCodeplug(
     crc ^= *((const uint16_t*)codeplug.image(0).data(offset +2*i));
   }
 
-  if (! prepareWriting(bytesToTransfer, DR1801UVInterface::WriteSpeed, crc, err) ) {
+  if (! negotiateWriting(bytesToTransfer, crc, err) ) {
     errMsg(err) << "Cannot initialize codeplug write.";
     return false;
   }
@@ -222,14 +266,18 @@ DR1801UVInterface::writeCodeplug(
 
   logDebug() << "Write codeplug...";
   while (bytesToTransfer) {
-    uint32_t n = std::min(200U, bytesToTransfer);
+    if (! checkCanceled(err)) {
+      _state = ERROR;
+      return false;
+    }
+    uint32_t n = std::min(unsigned(TRANSFER_CHUNK_SIZE), bytesToTransfer);
     if (! QSerialPort::write((char*)codeplug.data(offset), n)) {
       errMsg(err) << "Cannot write codeplug to device.";
       return false;
     }
     // Wait for bytes written
     while (bytesToWrite()) {
-      if (! waitForBytesWritten(2000)) {
+      if (! waitForBytesWritten(transferTime(bytesToWrite(), WriteSpeeds[_writeSpeed]))) {
         errMsg(err) << errorString();
         errMsg(err) << "Cannot write codeplug to the device.";
         _state = ERROR;
@@ -386,6 +434,36 @@ DR1801UVInterface::checkProgrammingPassword(const ErrorStack &err) {
   return true;
 }
 
+bool
+DR1801UVInterface::negotiateReading(PrepareReadResponse &response, const ErrorStack &err) {
+  const unsigned numSpeeds = sizeof(ReadSpeeds)/sizeof(uint32_t);
+  for (; _readSpeed<numSpeeds; _readSpeed++) {
+    // The last speed is always supported, pass errors
+    if ((numSpeeds-1) == _readSpeed)
+      return prepareReading(ReadSpeeds[_readSpeed], response, err);
+    if (prepareReading(ReadSpeeds[_readSpeed], response))
+      return true;
+    logDebug() << "Device rejected read speed " << ReadSpeeds[_readSpeed] << ", try slower one.";
+    discardInput(QUIET_LINE_TIME);
+  }
+  return false;
+}
+
+bool
+DR1801UVInterface::negotiateWriting(uint32_t size, uint16_t crc, const ErrorStack &err) {
+  const unsigned numSpeeds = sizeof(WriteSpeeds)/sizeof(uint32_t);
+  for (; _writeSpeed<numSpeeds; _writeSpeed++) {
+    // The last speed is always supported, pass errors
+    if ((numSpeeds-1) == _writeSpeed)
+      return prepareWriting(size, WriteSpeeds[_writeSpeed], crc, err);
+    if (prepareWriting(size, WriteSpeeds[_writeSpeed], crc))
+      return true;
+    logDebug() << "Device rejected write speed " << WriteSpeeds[_writeSpeed] << ", try slower one.";
+    discardInput(QUIET_LINE_TIME);
+  }
+  return false;
+}
+
 bool
 DR1801UVInterface::prepareReading(uint32_t baudrate, PrepareReadResponse &response, const ErrorStack &err) {
   PrepareReadRequest request(baudrate);
@@ -406,7 +484,7 @@ DR1801UVInterface::prepareReading(uint32_t baudrate, PrepareReadResponse &respon
     errMsg(err) << "Cannot set baud-rate of serial port '" << portName() << "'.";
     return false;
   }
-  QThread::msleep(1000);
+  QThread::msleep(BAUDRATE_SETTLE_TIME);
 
   return true;
 }
@@ -432,7 +510,7 @@ DR1801UVInterface::prepareWriting(uint32_t size, uint32_t baudrate, uint16_t crc
     errMsg(err) << "Cannot set baud-rate of serial port '" << portName() << "'.";
     return false;
   }
-  QThread::msleep(1000);
+  QThread::msleep(BAUDRATE_SETTLE_TIME);
 
   _state = WRITE_THROUGH;
   return true;
@@ -460,7 +538,8 @@ DR1801UVInterface::receiveWriteACK(const ErrorStack &err) {
     errMsg(err) << "Cannot set baud-rate of serial port '" << portName() << "'.";
     return false;
   }
-  QThread::msleep(1000);
+  // Wait until the line is quiet instead of a fixed delay
+  discardInput(QUIET_LINE_TIME);
   _state = IDLE;
 
   return true;
@@ -55,6 +55,13 @@ protected:
     WriteSpeed = QSerialPort::Baud9600
   };
 
+  /** Baud rates tried for reading the codeplug, in order of preference. The last one is
+   * @c ReadSpeed, which is always supported. */
+  static const uint32_t ReadSpeeds[];
+  /** Baud rates tried for writing the codeplug, in order of preference. The last one is
+   * @c WriteSpeed, which is always supported. */
+  static const uint32_t WriteSpeeds[];
+
   /** Implemented commands. */
   enum Command {
     REQUEST_INFO           = 0x0000, ///< Returns some information about the device.
@@ -128,6 +135,13 @@ protected:
   /** Checks the if a programming password is set. */
   bool checkProgrammingPassword(const ErrorStack &err=ErrorStack());
 
+  /** Prepares reading the codeplug at the fastest baud rate accepted by the device. Slower rates
+   * are tried, if the device rejects a rate. The accepted rate is kept for later transfers. */
+  bool negotiateReading(PrepareReadResponse &response, const ErrorStack &err=ErrorStack());
+  /** Prepares writing the codeplug at the fastest baud rate accepted by the device. Slower rates
+   * are tried, if the device rejects a rate. The accepted rate is kept for later transfers. */
+  bool negotiateWriting(uint32_t size, uint16_t crc, const ErrorStack &err=ErrorStack());
+
   /** Prepares reading the codeplug. */
   bool prepareReading(uint32_t baudrate, PrepareReadResponse &response, const ErrorStack &err=ErrorStack());
   /** Starts the read operation. Once the operation is complete, the device will close the
@@ -142,6 +156,10 @@ protected:
 protected:
   /** Holds the device identifier, once read. */
   QString _identifier;
+  /** Index of the fastest read speed accepted so far, see @c ReadSpeeds. */
+  unsigned _readSpeed;
+  /** Index of the fastest write speed accepted so far, see @c WriteSpeeds. */
+  unsigned _writeSpeed;
 };
 
 #endif // DR1801UVINTERFACE_HH
@@ -0,0 +1,116 @@
+#include "encodecache.hh"
+#include "config.hh"
+#include "radioinfo.hh"
+#include "logger.hh"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QTextStream>
+#include <QBuffer>
+#include <QMutexLocker>
+
+QMutex EncodeCache::_mutex;
+QHash<QString, QVector<DFUFile::Image>> EncodeCache::_images;
+
+
+/* ********************************************************************************************* *
+ * Implementation of EncodeCache
+ * ********************************************************************************************* */
+EncodeCache::EncodeCache(const QString &directory)
+  : _directory(directory)
+{
+  if (_directory.isEmpty())
+    _directory = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+        .filePath("encoded");
+}
+
+const QString &
+EncodeCache::directory() const {
+  return _directory;
+}
+
+QString
+EncodeCache::filename(const QString &key) const {
+  return QDir(_directory).filePath(QString("%1.dfu").arg(key));
+}
+
+QByteArray
+EncodeCache::configHash(Config *config, const ErrorStack &err) {
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  QTextStream stream(&buffer);
+  stream.setCodec("UTF-8");
+  if (! config->toYAML(stream, err)) {
+    errMsg(err) << "Cannot hash config.";
+    return QByteArray();
+  }
+  stream.flush();
+  return QCryptographicHash::hash(buffer.data(), QCryptographicHash::Sha256);
+}
+
+QString
+EncodeCache::key(const QByteArray &configHash, const RadioInfo &radio, const QString &variant,
+                 const Codeplug::Flags &flags)
+{
+  // The number of encoder threads does not change the result
+  QCryptographicHash hash(QCryptographicHash::Sha256);
+  hash.addData(configHash);
+  hash.addData(variant.toUtf8());
+  hash.addData(QByteArray(1, char((flags.updateCodePlug ? 1 : 0) | (flags.autoEnableGPS ? 2 : 0)
+                                  | (flags.autoEnableRoaming ? 4 : 0))));
+  return QString("%1-%2").arg(radio.key(), QString::fromLatin1(hash.result().toHex()));
+}
+
+bool
+EncodeCache::load(const QString &key, DFUFile &image, const ErrorStack &err) const {
+  QMutexLocker locker(&_mutex);
+  if (_images.contains(key)) {
+    while (image.numImages())
+      image.remImage(0);
+    foreach (const DFUFile::Image &img, _images[key])
+      image.addImage(img);
+    logDebug() << "Use encoded image '" << key << "' from memory.";
+    return true;
+  }
+
+  QString path = filename(key);
+  if (! QFileInfo::exists(path))
+    return false;
+  if (! image.read(path, err)) {
+    errMsg(err) << "Cannot read cached encoded image '" << path << "'.";
+    return false;
+  }
+
+  QVector<DFUFile::Image> images;
+  for (int i=0; i<image.numImages(); i++)
+    images.append(image.image(i));
+  _images.insert(key, images);
+  logDebug() << "Loaded encoded image from '" << path << "'.";
+  return true;
+}
+
+bool
+EncodeCache::store(const QString &key, DFUFile &image, const ErrorStack &err) const {
+  QMutexLocker locker(&_mutex);
+  QVector<DFUFile::Image> images;
+  for (int i=0; i<image.numImages(); i++)
+    images.append(image.image(i));
+  _images.insert(key, images);
+
+  if (! QDir().mkpath(_directory)) {
+    errMsg(err) << "Cannot create encode cache directory '" << _directory << "'.";
+    return false;
+  }
+  // Same key, same image
+  QString path = filename(key);
+  if (QFileInfo::exists(path))
+    return true;
+  if (! image.write(path, err)) {
+    errMsg(err) << "Cannot write cached encoded image '" << path << "'.";
+    return false;
+  }
+  logDebug() << "Stored encoded image in cache '" << path << "'.";
+  return true;
+}
@@ -0,0 +1,66 @@
+#ifndef ENCODECACHE_HH
+#define ENCODECACHE_HH
+
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+#include "dfufile.hh"
+#include "codeplug.hh"
+#include "errorstack.hh"
+
+class Config;
+class RadioInfo;
+
+/** Implements a cache of encoded codeplugs.
+ *
+ * Encoding the same config for the same radio twice yields the same binary image. This cache
+ * keeps the encoded images, keyed by a structural hash of the config (see @c configHash)
+ * combined with the radio model, the codeplug variant and the encoding flags. That is, re-encoding
+ * an unchanged config (e.g., for many identical radios) only costs the hash.
+ *
+ * Images are kept in memory, shared by all instances within the process, and stored as DFU files
+ * in the cache directory. Only images that do not depend on the current memory of the device may
+ * be cached, i.e., encoded without updating a downloaded codeplug.
+ *
+ * @ingroup util */
+class EncodeCache
+{
+public:
+  /** Constructs a new encode cache located in the given directory. If no directory is given, the
+   * default cache location of the application is used. */
+  explicit EncodeCache(const QString &directory=QString());
+
+  /** Returns the directory of the cache. */
+  const QString &directory() const;
+  /** Returns the path of the cache file for the given key. */
+  QString filename(const QString &key) const;
+
+  /** Computes the structural hash of the given config. The hash is computed over the serialized
+   * config, hence it does not depend on the formatting of the source file but only on the content
+   * and the version of qdmr.
+   * @returns An empty array on error. */
+  static QByteArray configHash(Config *config, const ErrorStack &err=ErrorStack());
+  /** Assembles the cache key from the config hash, the radio model, the codeplug variant (e.g.,
+   * class name) and the encoding flags. */
+  static QString key(const QByteArray &configHash, const RadioInfo &radio, const QString &variant,
+                     const Codeplug::Flags &flags);
+
+  /** Loads the cached image for the given key. The memory is searched first, then the cache
+   * directory.
+   * @returns @c false if there is no such image or it cannot be read. */
+  bool load(const QString &key, DFUFile &image, const ErrorStack &err=ErrorStack()) const;
+  /** Stores the given image for the given key, in memory and in the cache directory. */
+  bool store(const QString &key, DFUFile &image, const ErrorStack &err=ErrorStack()) const;
+
+protected:
+  /** The cache directory. */
+  QString _directory;
+
+  /** Guards the in-memory cache. */
+  static QMutex _mutex;
+  /** The in-memory cache, maps keys to images. */
+  static QHash<QString, QVector<DFUFile::Image>> _images;
+};
+
+#endif // ENCODECACHE_HH
@@ -0,0 +1,125 @@
+#include "encodeprogress.hh"
+#include <iterator>
+#include <algorithm>
+
+EncodeProgress::EncodeProgress()
+  : _lock(), _progress(), _allocated(true), _done(true), _success(true), _generation(0), _encoded()
+{
+  // pass...
+}
+
+void
+EncodeProgress::start() {
+  QMutexLocker locker(&_lock);
+  _allocated = _done = false;
+  _success = true;
+  _generation = 0;
+  _encoded.clear();
+}
+
+void
+EncodeProgress::setAllocated() {
+  QMutexLocker locker(&_lock);
+  _allocated = true;
+  _progress.wakeAll();
+}
+
+void
+EncodeProgress::setEncoded(uint32_t address, uint32_t size) {
+  QMutexLocker locker(&_lock);
+  if (0 == size)
+    return;
+
+  // Merge with the preceding and all overlapping or adjacent following ranges
+  uint32_t end = address + size;
+  QMap<uint32_t, uint32_t>::iterator range = _encoded.upperBound(address);
+  if ((range != _encoded.begin()) && (std::prev(range).value() >= address)) {
+    range = std::prev(range);
+    address = range.key();
+    end = std::max(end, range.value());
+    range = _encoded.erase(range);
+  }
+  while ((range != _encoded.end()) && (range.key() <= end)) {
+    end = std::max(end, range.value());
+    range = _encoded.erase(range);
+  }
+  _encoded.insert(address, end);
+  _generation++;
+  _progress.wakeAll();
+}
+
+void
+EncodeProgress::finish(bool success) {
+  QMutexLocker locker(&_lock);
+  _allocated = _done = true;
+  _success = success;
+  _progress.wakeAll();
+}
+
+bool
+EncodeProgress::isAllocated() const {
+  QMutexLocker locker(&_lock);
+  return _allocated;
+}
+
+bool
+EncodeProgress::isDone() const {
+  QMutexLocker locker(&_lock);
+  return _done;
+}
+
+bool
+EncodeProgress::isEncoded(uint32_t address, uint32_t size) const {
+  QMutexLocker locker(&_lock);
+  return covered(address, size);
+}
+
+bool
+EncodeProgress::covered(uint32_t address, uint32_t size) const {
+  // Find the encoded range starting at or before the address
+  QMap<uint32_t, uint32_t>::const_iterator range = _encoded.upperBound(address);
+  if (range == _encoded.constBegin())
+    return false;
+  return std::prev(range).value() >= (address+size);
+}
+
+bool
+EncodeProgress::waitAllocated() {
+  QMutexLocker locker(&_lock);
+  while (! _allocated)
+    _progress.wait(&_lock);
+  return _success;
+}
+
+bool
+EncodeProgress::waitEncoded(uint32_t address, uint32_t size) {
+  QMutexLocker locker(&_lock);
+  while (! _done) {
+    if (covered(address, size))
+      return true;
+    _progress.wait(&_lock);
+  }
+  return _success;
+}
+
+unsigned int
+EncodeProgress::waitProgress(unsigned int generation) {
+  QMutexLocker locker(&_lock);
+  while ((! _done) && (generation == _generation))
+    _progress.wait(&_lock);
+  return _generation;
+}
+
+bool
+EncodeProgress::waitDone() {
+  QMutexLocker locker(&_lock);
+  while (! _done)
+    _progress.wait(&_lock);
+  return _success;
+}
+
+unsigned int
+EncodeProgress::generation() const {
+  QMutexLocker locker(&_lock);
+  return _generation;
+}
@@ -0,0 +1,73 @@
+#ifndef ENCODEPROGRESS_HH
+#define ENCODEPROGRESS_HH
+
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+
+/** Tracks the progress of an encoding running in the background.
+ *
+ * The encoder marks the memory layout as fixed using @c setAllocated, every finished memory range
+ * using @c setEncoded and finally completes the encoding using @c finish. Meanwhile, another
+ * thread may upload the encoded ranges, waiting for them using @c waitEncoded or @c waitProgress.
+ * A range is considered encoded only, if it is not modified anymore until the encoding completes.
+ *
+ * All methods are thread-safe.
+ *
+ * @ingroup util */
+class EncodeProgress
+{
+public:
+  /** Constructs a completed progress, i.e., there is nothing to wait for. */
+  EncodeProgress();
+
+  /** Resets the progress at the start of a new encoding. */
+  void start();
+  /** Marks the memory layout as fixed. */
+  void setAllocated();
+  /** Marks the given range as encoded. */
+  void setEncoded(uint32_t address, uint32_t size);
+  /** Completes the encoding. */
+  void finish(bool success);
+
+  /** Returns @c true if the memory layout is fixed. */
+  bool isAllocated() const;
+  /** Returns @c true if the encoding is complete. */
+  bool isDone() const;
+  /** Returns @c true if the given range has been marked as encoded. */
+  bool isEncoded(uint32_t address, uint32_t size) const;
+
+  /** Blocks until the memory layout is fixed. Returns @c false if the encoding failed. */
+  bool waitAllocated();
+  /** Blocks until the given range is encoded. Returns @c false if the encoding failed. */
+  bool waitEncoded(uint32_t address, uint32_t size);
+  /** Blocks until any range got encoded after the given generation (see @c generation) or the
+   * encoding completed. Returns the current generation. */
+  unsigned int waitProgress(unsigned int generation);
+  /** Blocks until the encoding is complete. Returns @c false if it failed. */
+  bool waitDone();
+  /** Returns the current generation, which gets incremented with every encoded range. */
+  unsigned int generation() const;
+
+protected:
+  /** Returns @c true if the given range is encoded, the lock must be held. */
+  bool covered(uint32_t address, uint32_t size) const;
+
+protected:
+  /** Protects the state. */
+  mutable QMutex _lock;
+  /** Signals the progress. */
+  QWaitCondition _progress;
+  /** If @c true, the memory layout is fixed. */
+  bool _allocated;
+  /** If @c true, the encoding is complete. */
+  bool _done;
+  /** If @c false, the encoding failed. */
+  bool _success;
+  /** Gets incremented with every encoded range. */
+  unsigned int _generation;
+  /** The encoded ranges, maps the start address to the end address. */
+  QMap<uint32_t, uint32_t> _encoded;
+};
+
+#endif // ENCODEPROGRESS_HH
@@ -0,0 +1,123 @@
+#include "encodesession.hh"
+#include "config.hh"
+#include "logger.hh"
+
+EncodeSession::EncodeSession(Config *source, const Codeplug &codeplug, bool preprocessed)
+  : _source(source), _codeplug(codeplug), _preprocessed(preprocessed), _intermediate(nullptr),
+    _copy(nullptr), _verification(nullptr), _context(nullptr), _indexed(false), _indexResult(false)
+{
+  // pass...
+}
+
+EncodeSession::~EncodeSession() {
+  if (_context)
+    delete _context;
+  if (_verification)
+    delete _verification;
+  if (_copy)
+    delete _copy;
+  if (_intermediate)
+    delete _intermediate;
+  if (_preprocessed && _source)
+    delete _source;
+}
+
+Config *
+EncodeSession::source() const {
+  return _source;
+}
+
+Config *
+EncodeSession::config(const ErrorStack &err) {
+  if (_preprocessed || (! _codeplug.requiresPreprocessing(_source)))
+    return _source;
+  if (nullptr == _intermediate)
+    _intermediate = _codeplug.preprocess(_source, err);
+  return _intermediate;
+}
+
+bool
+EncodeSession::isRewritten() const {
+  return (! _preprocessed) && _codeplug.requiresPreprocessing(_source);
+}
+
+const RadioLimitContext &
+EncodeSession::verify(const RadioLimits &limits, RadioLimitCache *cache, bool ignoreFrequencyLimits) {
+  if (_verification)
+    return *_verification;
+
+  // Only unchanged objects of the source get cached, a rewritten config is new for every session.
+  _verification = new RadioLimitContext(isRewritten() ? nullptr : cache, ignoreFrequencyLimits);
+  Config *config = this->config();
+  if (nullptr == config) {
+    _verification->newMessage(RadioLimitIssue::Critical) << "Cannot preprocess config.";
+    return *_verification;
+  }
+  limits.verifyConfig(config, *_verification);
+  return *_verification;
+}
+
+bool
+EncodeSession::isVerified() const {
+  return nullptr != _verification;
+}
+
+Config *
+EncodeSession::uploadConfig(const ErrorStack &err) {
+  if (_preprocessed)
+    return _source;
+  if (isRewritten())
+    return config(err);
+  // Upload a copy, the source may be modified during the upload
+  if (nullptr == _copy)
+    _copy = _codeplug.preprocess(_source, err);
+  return _copy;
+}
+
+Config *
+EncodeSession::takeConfig(const ErrorStack &err) {
+  Config *config = uploadConfig(err);
+  if (nullptr == config)
+    return nullptr;
+
+  if (_context)
+    delete _context;
+  _context = nullptr;
+  _indexed = false;
+
+  if (_preprocessed)
+    _source = nullptr;
+  else if (config == _intermediate)
+    _intermediate = nullptr;
+  else
+    _copy = nullptr;
+  return config;
+}
+
+Codeplug::Context &
+EncodeSession::context() {
+  if (nullptr == _context) {
+    _context = new Codeplug::Context(uploadConfig());
+    _codeplug.addTables(*_context);
+  }
+  return *_context;
+}
+
+bool
+EncodeSession::index(const ErrorStack &err) {
+  if (_indexed)
+    return _indexResult;
+  Config *config = uploadConfig(err);
+  if (nullptr == config) {
+    errMsg(err) << "Cannot index config.";
+    return false;
+  }
+  _indexResult = _codeplug.index(config, context(), err);
+  _indexed = true;
+  return _indexResult;
+}
+
+bool
+EncodeSession::isIndexed() const {
+  return _indexed;
+}
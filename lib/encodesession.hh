@@ -0,0 +1,85 @@
+#ifndef ENCODESESSION_HH
+#define ENCODESESSION_HH
+
+#include "codeplug.hh"
+#include "radiolimits.hh"
+#include "errorstack.hh"
+
+class Config;
+
+/** Holds everything derived from a config for a single upload to a radio.
+ *
+ * That is, the preprocessed config (see @c Codeplug::preprocess), the result of its verification
+ * against the limits of the radio and the index of the config being encoded (see
+ * @c Codeplug::index). Each of these gets computed once, when first requested, and is then
+ * reused by all later steps of the upload. E.g., the config gets preprocessed once for both the
+ * verification and the encoding.
+ *
+ * The session does not take ownership of the source config. The config being uploaded, however,
+ * is always owned by the session, as it gets encoded in the background while the source may be
+ * modified. Hence, if the source does not require preprocessing, it gets verified as is and only
+ * copied when the config to upload is requested.
+ *
+ * @ingroup conf */
+class EncodeSession
+{
+public:
+  /** Constructs a new session encoding the given config into the given codeplug. If
+   * @c preprocessed is @c true, the session takes ownership of the config, which then gets
+   * verified and uploaded as is. */
+  EncodeSession(Config *source, const Codeplug &codeplug, bool preprocessed=false);
+  /** Destructor. */
+  ~EncodeSession();
+
+  /** Returns the source config. */
+  Config *source() const;
+  /** Returns the config to verify, i.e., the preprocessed config or the source itself if it does
+   * not require preprocessing. Returns @c nullptr if the preprocessing failed. */
+  Config *config(const ErrorStack &err=ErrorStack());
+  /** Returns @c true if the source gets rewritten by the preprocessing. */
+  bool isRewritten() const;
+
+  /** Verifies the config against the given limits, unless verified before. The cache is only
+   * used, if the source gets verified as is. Returns the verification result. */
+  const RadioLimitContext &verify(const RadioLimits &limits, RadioLimitCache *cache=nullptr,
+                                  bool ignoreFrequencyLimits=false);
+  /** Returns @c true if the config has been verified. */
+  bool isVerified() const;
+
+  /** Returns the config to upload, owned by the session. Returns @c nullptr on error. */
+  Config *uploadConfig(const ErrorStack &err=ErrorStack());
+  /** Returns the config to upload and passes its ownership to the caller. Any index of the
+   * config gets discarded. Returns @c nullptr on error. */
+  Config *takeConfig(const ErrorStack &err=ErrorStack());
+
+  /** Returns the index context of the config to upload. The tables of the codeplug are added,
+   * but the config gets indexed by @c index only. Must not be called before @c uploadConfig
+   * succeeded. */
+  Codeplug::Context &context();
+  /** Indexes the config to upload, unless indexed before. Returns @c false on error. */
+  bool index(const ErrorStack &err=ErrorStack());
+  /** Returns @c true if the config to upload has been indexed. */
+  bool isIndexed() const;
+
+protected:
+  /** The source config. */
+  Config *_source;
+  /** The codeplug to encode. */
+  const Codeplug &_codeplug;
+  /** If @c true, the source has been preprocessed and is owned by the session. */
+  bool _preprocessed;
+  /** The preprocessed config, if rewritten. */
+  Config *_intermediate;
+  /** The copy of the source to upload, if not rewritten. */
+  Config *_copy;
+  /** The result of the verification or @c nullptr if not verified yet. */
+  RadioLimitContext *_verification;
+  /** The index context of the config to upload or @c nullptr if not created yet. */
+  Codeplug::Context *_context;
+  /** If @c true, the config to upload has been indexed. */
+  bool _indexed;
+  /** The result of indexing the config. */
+  bool _indexResult;
+};
+
+#endif // ENCODESESSION_HH
@@ -0,0 +1,97 @@
+#include "enumtable.hh"
+#include <QMutex>
+#include <QPair>
+#include <algorithm>
+#include <cstring>
+
+
+EnumTable::EnumTable(const QMetaEnum &e)
+  : _enum(e), _keys(), _values(), _sorted(), _byValue()
+{
+  for (int i=0; i<e.keyCount(); i++) {
+    _keys.append(e.key(i));
+    _values.append(e.value(i));
+    _sorted.append(i);
+    if (! _byValue.contains(e.value(i)))
+      _byValue.insert(e.value(i), i);
+  }
+  std::sort(_sorted.begin(), _sorted.end(), [this](int a, int b) {
+    return 0 > strcmp(_keys[a], _keys[b]);
+  });
+}
+
+const EnumTable &
+EnumTable::get(const QMetaEnum &e) {
+  static QMutex lock;
+  static QHash<QPair<const QMetaObject *, const char *>, EnumTable *> tables;
+
+  // The name points into the static meta data of the enclosing class, hence it identifies the
+  // enum together with that class.
+  QPair<const QMetaObject *, const char *> id(e.enclosingMetaObject(), e.name());
+  QMutexLocker locker(&lock);
+  if (! tables.contains(id))
+    tables.insert(id, new EnumTable(e));
+  return *tables[id];
+}
+
+const char *
+EnumTable::name() const {
+  return _enum.name();
+}
+
+int
+EnumTable::keyCount() const {
+  return _keys.size();
+}
+
+const char *
+EnumTable::key(int i) const {
+  return _keys.at(i);
+}
+
+int
+EnumTable::value(int i) const {
+  return _values.at(i);
+}
+
+QStringList
+EnumTable::keys() const {
+  QStringList lst;
+  foreach (const char *key, _keys)
+    lst.push_back(key);
+  return lst;
+}
+
+const char *
+EnumTable::valueToKey(int value) const {
+  QHash<int, int>::const_iterator idx = _byValue.find(value);
+  if (_byValue.end() == idx)
+    return nullptr;
+  return _keys.at(*idx);
+}
+
+int
+EnumTable::keyToValue(const char *key, bool *ok) const {
+  QVector<int>::const_iterator idx = std::lower_bound(
+        _sorted.begin(), _sorted.end(), key, [this](int i, const char *key) {
+    return 0 > strcmp(_keys[i], key);
+  });
+  if ((_sorted.end() != idx) && (0 == strcmp(_keys[*idx], key))) {
+    if (ok)
+      *ok = true;
+    return _values[*idx];
+  }
+
+  // Scoped keys like "Class::Key" are rare, let the meta enum resolve them.
+  if (nullptr != strchr(key, ':'))
+    return _enum.keyToValue(key, ok);
+
+  if (ok)
+    *ok = false;
+  return -1;
+}
+
+int
+EnumTable::keyToValue(const std::string &key, bool *ok) const {
+  return keyToValue(key.c_str(), ok);
+}
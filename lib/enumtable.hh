@@ -0,0 +1,66 @@
+#ifndef ENUMTABLE_HH
+#define ENUMTABLE_HH
+
+#include <QMetaEnum>
+#include <QVector>
+#include <QHash>
+#include <QStringList>
+#include <string>
+
+/** Precomputed look-up tables for the keys and values of an enum.
+ *
+ * @c QMetaEnum::keyToValue performs a linear scan over all keys of the enum, comparing each
+ * key with the given one. This table sorts the keys once, such that a key gets resolved by a
+ * binary search, and maps values to keys using a hash table. The tables are built once per enum
+ * and shared, see @c get. They are used to serialize and parse enum properties as well as by the
+ * GUI delegates.
+ *
+ * @ingroup conf */
+class EnumTable
+{
+public:
+  /** Builds the tables for the given enum. Use @c get to obtain the shared instance. */
+  explicit EnumTable(const QMetaEnum &e);
+
+  /** Returns the shared table of the given enum. The table gets built on first use, this method
+   * is thread-safe. */
+  static const EnumTable &get(const QMetaEnum &e);
+  /** Returns the shared table of the given enum type. */
+  template <class T>
+  static const EnumTable &get() {
+    return get(QMetaEnum::fromType<T>());
+  }
+
+  /** Returns the name of the enum. */
+  const char *name() const;
+  /** Returns the number of keys. */
+  int keyCount() const;
+  /** Returns the i-th key in order of declaration. */
+  const char *key(int i) const;
+  /** Returns the i-th value in order of declaration. */
+  int value(int i) const;
+  /** Returns all keys in order of declaration. */
+  QStringList keys() const;
+
+  /** Returns the first declared key of the given value or @c nullptr if the value is unknown. */
+  const char *valueToKey(int value) const;
+  /** Returns the value of the given key. If @c ok is set, it is set to @c false if the key is
+   * unknown. */
+  int keyToValue(const char *key, bool *ok=nullptr) const;
+  /** Returns the value of the given key, e.g., directly from a YAML scalar. */
+  int keyToValue(const std::string &key, bool *ok=nullptr) const;
+
+protected:
+  /** The meta enum, used to resolve scoped keys. */
+  QMetaEnum _enum;
+  /** Keys in order of declaration. */
+  QVector<const char *> _keys;
+  /** Values in order of declaration. */
+  QVector<int> _values;
+  /** Indices of the keys in lexicographic order. */
+  QVector<int> _sorted;
+  /** Maps a value to the index of its first declared key. */
+  QHash<int, int> _byValue;
+};
+
+#endif // ENUMTABLE_HH
@@ -125,56 +125,70 @@ ErrorStack::Stack::unref() {
  * Implementation of ErrorStack
  * ********************************************************************************************* */
 ErrorStack::ErrorStack() noexcept
-  : _stack(new ErrorStack::Stack())
+  : _stack(nullptr)
 {
   // pass...
 }
 
 ErrorStack::ErrorStack(const ErrorStack &other)
-  : _stack(other._stack->ref())
+  : _stack(other.stack()->ref())
 {
   // pass...
 }
 
 ErrorStack::~ErrorStack() {
-  _stack->unref();
+  if (_stack)
+    _stack->unref();
   _stack = nullptr;
 }
 
 ErrorStack &
 ErrorStack::operator =(const ErrorStack &other) {
-  _stack->unref();
-  _stack = other._stack->ref();
+  Stack *stack = other.stack()->ref();
+  if (_stack)
+    _stack->unref();
+  _stack = stack;
   return *this;
 }
 
+ErrorStack::Stack *
+ErrorStack::stack() const {
+  if (nullptr == _stack)
+    _stack = new ErrorStack::Stack();
+  return _stack;
+}
+
 bool
 ErrorStack::isEmpty() const {
-  return _stack->isEmpty();
+  return (nullptr == _stack) || _stack->isEmpty();
 }
 
 unsigned
 ErrorStack::count() const {
-  return _stack->count();
+  return _stack ? _stack->count() : 0;
 }
 
 const ErrorStack::Message &
 ErrorStack::message(unsigned i) const {
-  return _stack->message(i);
+  return stack()->message(i);
 }
 
 void
 ErrorStack::push(const Message &msg) const {
-  _stack->push(msg);
+  stack()->push(msg);
 }
 
 void
 ErrorStack::take(const ErrorStack &other) const {
-  _stack->push(*other._stack);
+  if (other.isEmpty())
+    return;
+  stack()->push(*other._stack);
   other._stack->clear();
 }
 
 QString
 ErrorStack::format(const QString &indent) const {
+  if (nullptr == _stack)
+    return QString();
   return _stack->format(indent);
 }
@@ -36,6 +36,11 @@
  *   // []
  * }
  * @endcode
+ *
+ * The actual message stack is allocated lazily, once the first message is pushed or the error
+ * stack gets copied. Hence, passing a default constructed error stack along a call chain that
+ * succeeds is cheap.
+ *
  * @ingroup log */
 class ErrorStack
 {
@@ -128,7 +133,7 @@ public:
   };
 
 public:
-  /** Default constructor. */
+  /** Default constructor. Does not allocate the message stack. */
   ErrorStack() noexcept;
   /** Copy constructor. */
   ErrorStack(const ErrorStack &other);
@@ -153,8 +158,12 @@ public:
   QString format(const QString &indent="  ") const;
 
 protected:
-  /** A reference to the actual message stack. */
-  Stack *_stack;
+  /** Returns the message stack, allocates it on demand. */
+  Stack *stack() const;
+
+protected:
+  /** A reference to the actual message stack or @c nullptr, if not allocated yet. */
+  mutable Stack *_stack;
 };
 
 
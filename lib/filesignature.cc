@@ -0,0 +1,115 @@
+#include "filesignature.hh"
+#include "dfufile.hh"
+
+#include <QFileInfo>
+
+
+/* ********************************************************************************************* *
+ * Implementation of FileSignature
+ * ********************************************************************************************* */
+bool
+FileSignature::identify(const QString &filename, QList<Match> &matches, const ErrorStack &err) {
+  QFileInfo info(filename);
+  if (! info.isFile()) {
+    errMsg(err) << "Cannot identify '" << filename << "': Not a file.";
+    return false;
+  }
+
+  // Every DFU file written by this library names its images, only the headers are read
+  QVector<DFUFile::ImageHeader> images;
+  ErrorStack dfuErr;
+  if (DFUFile::readHeaders(filename, images, dfuErr)) {
+    int count = matches.size();
+    foreach (const DFUFile::ImageHeader &image, images) {
+      foreach (const Signature &sig, imageNames().value(image.name)) {
+        // Several images may identify the same radio (e.g., OpenGD77 EEPROM and FLASH)
+        bool known = false;
+        for (int i=count; (i<matches.size()) && (! known); i++)
+          known = (matches[i].radio == sig.radio) && (matches[i].content == sig.content);
+        if (! known)
+          matches.append(Match{sig.radio, sig.content, Format::DFU});
+      }
+    }
+    if (count == matches.size()) {
+      errMsg(err) << "Cannot identify DFU file '" << filename << "': Unknown image names.";
+      return false;
+    }
+    return true;
+  }
+
+  // Manufacturer files have no header, but a fixed size
+  if (! fileSizes().contains(info.size())) {
+    errMsg(err) << "Cannot identify '" << filename << "': Neither a known DFU file nor a "
+                << "manufacturer codeplug file of known size.";
+    return false;
+  }
+  foreach (RadioInfo::Radio radio, fileSizes().value(info.size()))
+    matches.append(Match{radio, Content::Codeplug, Format::Manufacturer});
+  return true;
+}
+
+QString
+FileSignature::contentName(Content content) {
+  switch (content) {
+  case Content::Codeplug: return "codeplug";
+  case Content::CallsignDB: return "call-sign DB";
+  }
+  return QString();
+}
+
+QString
+FileSignature::formatName(Format format) {
+  switch (format) {
+  case Format::DFU: return "dfu";
+  case Format::Manufacturer: return "manufacturer";
+  }
+  return QString();
+}
+
+const QHash<QString, QList<FileSignature::Signature>> &
+FileSignature::imageNames() {
+  static const QHash<QString, QList<Signature>> names = {
+    // Codeplugs
+    {"OpenGD77 Codeplug EEPROM", {{RadioInfo::OpenGD77, Content::Codeplug}}},
+    {"OpenGD77 Codeplug FLASH", {{RadioInfo::OpenGD77, Content::Codeplug}}},
+    {"OpenRTX codeplug v0.1", {{RadioInfo::OpenRTX, Content::Codeplug}}},
+    {"TYT MD-390 Codeplug", {{RadioInfo::MD390, Content::Codeplug}}},
+    {"TYT MD-UV390 Codeplug", {{RadioInfo::UV390, Content::Codeplug}}},
+    {"TYT MD-2017 Codeplug", {{RadioInfo::MD2017, Content::Codeplug}}},
+    {"Baofeng DM-1701 Codeplug", {{RadioInfo::DM1701, Content::Codeplug}}},
+    {"Radioddity RD5R Codeplug", {{RadioInfo::RD5R, Content::Codeplug}}},
+    {"Radioddity GD77 Codeplug", {{RadioInfo::GD77, Content::Codeplug}}},
+    {"Radioddity GD-73A/E codeplug", {{RadioInfo::GD73, Content::Codeplug}}},
+    {"BTECH DR-1801UV Codeplug", {{RadioInfo::DR1801UV, Content::Codeplug}}},
+    {"AnyTone AT-D868UV Codeplug", {{RadioInfo::D868UVE, Content::Codeplug}}},
+    {"Anytone AT-D878UV Codeplug", {{RadioInfo::D878UV, Content::Codeplug}}},
+    {"AnyTone AT-D868UVII Codeplug", {{RadioInfo::D878UVII, Content::Codeplug}}},
+    {"AnyTone AT-D578UV Codeplug", {{RadioInfo::D578UV, Content::Codeplug}}},
+    {"BTECH DMR-6X2UV", {{RadioInfo::DMR6X2UV, Content::Codeplug}}},
+    // Call-sign DBs
+    {"OpenGD77 call-sign database", {{RadioInfo::OpenGD77, Content::CallsignDB}}},
+    {"GD77 call-sign database", {{RadioInfo::GD77, Content::CallsignDB}}},
+    {"TYT Callsign database.", {{RadioInfo::MD390, Content::CallsignDB}}},
+    {"TYT MD-UV390 Callsign database.", {{RadioInfo::UV390, Content::CallsignDB}}},
+    {"TYT MD-2017 Callsign database.", {{RadioInfo::MD2017, Content::CallsignDB}}},
+    {"BTECH DM-1701 Callsign database.", {{RadioInfo::DM1701, Content::CallsignDB}}},
+    {"AnyTone AT-D878UV Callsign database.", {
+       {RadioInfo::D868UVE, Content::CallsignDB}, {RadioInfo::D878UV, Content::CallsignDB},
+       {RadioInfo::D878UVII, Content::CallsignDB}, {RadioInfo::D578UV, Content::CallsignDB},
+       {RadioInfo::DMR6X2UV, Content::CallsignDB}}}
+  };
+  return names;
+}
+
+const QHash<qint64, QList<RadioInfo::Radio>> &
+FileSignature::fileSizes() {
+  // Must match the sizes checked by the manufacturer file readers
+  static const QHash<qint64, QList<RadioInfo::Radio>> sizes = {
+    {262709, {RadioInfo::MD390}},
+    {852533, {RadioInfo::UV390, RadioInfo::MD2017, RadioInfo::DM1701}},
+    {131072, {RadioInfo::RD5R, RadioInfo::GD77}},
+    {0x22014, {RadioInfo::GD73}},
+    {0x1dd90, {RadioInfo::DR1801UV}}
+  };
+  return sizes;
+}
@@ -0,0 +1,69 @@
+#ifndef FILESIGNATURE_HH
+#define FILESIGNATURE_HH
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include "radioinfo.hh"
+#include "errorstack.hh"
+
+/** Identifies binary codeplug and call-sign DB files without decoding them.
+ *
+ * Every codeplug and call-sign DB written by this library is a DFU file, which names its images
+ * after the radio and content (e.g., "TYT MD-390 Codeplug"). These names are registered here
+ * together with the radio and the kind of content. Identifying a DFU file only reads its image and
+ * element headers (see @c DFUFile::readHeaders) and looks up the image names. The element data is
+ * never read. Hence, the costs are independent of the file size.
+ *
+ * Manufacturer codeplug files have no header. They are identified by their size only, which is
+ * fixed for every supported radio. As several radios share the same file format, a manufacturer
+ * file may match several radios. All matches are reported.
+ *
+ * @ingroup util */
+class FileSignature
+{
+public:
+  /** The possible contents of an identified file. */
+  enum class Content {
+    Codeplug,   ///< A codeplug.
+    CallsignDB  ///< A call-sign DB.
+  };
+
+  /** The possible formats of an identified file. */
+  enum class Format {
+    DFU,          ///< A binary DFU file as written by this library.
+    Manufacturer  ///< A codeplug file as written by the manufacturer CPS.
+  };
+
+  /** A single match of a file. */
+  struct Match {
+    RadioInfo::Radio radio;   ///< The matching radio.
+    Content content;          ///< The content of the file.
+    Format format;            ///< The format of the file.
+  };
+
+public:
+  /** Identifies the given file. All matching radios are appended to @c matches.
+   * @returns @c false if the file cannot be read or matches no registered signature. */
+  static bool identify(const QString &filename, QList<Match> &matches,
+                       const ErrorStack &err=ErrorStack());
+
+  /** Returns a human readable name of the given content. */
+  static QString contentName(Content content);
+  /** Returns a human readable name of the given format. */
+  static QString formatName(Format format);
+
+protected:
+  /** A registered signature, the matched radio and content. */
+  struct Signature {
+    RadioInfo::Radio radio;   ///< The radio.
+    Content content;          ///< The content.
+  };
+
+  /** Returns the registry of DFU image names. */
+  static const QHash<QString, QList<Signature>> &imageNames();
+  /** Returns the registry of manufacturer file sizes. */
+  static const QHash<qint64, QList<RadioInfo::Radio>> &fileSizes();
+};
+
+#endif // FILESIGNATURE_HH
@@ -1,6 +1,27 @@
 #include "frequency.hh"
 #include "logger.hh"
-#include <QRegularExpression>
+
+/** Returns the character code of the given character. */
+static inline unsigned charCode(QChar c) { return c.unicode(); }
+/** Returns the character code of the given character. */
+static inline unsigned charCode(char c) { return static_cast<unsigned char>(c); }
+
+template <class Char>
+static inline bool isDigit(Char c) {
+  return (charCode(c) >= '0') && (charCode(c) <= '9');
+}
+
+template <class Char>
+static inline unsigned digit(Char c) {
+  return charCode(c) - '0';
+}
+
+template <class Char>
+static inline const Char *skipSpaces(const Char *ptr, const Char *end) {
+  while ((ptr != end) && ((' ' == charCode(*ptr)) || (('\t' <= charCode(*ptr)) && ('\r' >= charCode(*ptr)))))
+    ptr++;
+  return ptr;
+}
 
 Frequency::Frequency(unsigned long long Hz)
   : _frequency(Hz)
@@ -26,80 +47,147 @@ Frequency::operator =(const Frequency &other) {
   return *this;
 }
 
-QString
-Frequency::format(Format f) const {
+size_t
+Frequency::format(char *buffer, Format f) const {
+  // Number of fractional digits of the unit and the significant digits shown.
+  unsigned int decimals = 0, precision = 20;
+  const char *unit = " Hz";
   switch (f) {
   case Format::Automatic:
     if (10000ULL > _frequency)
-      return format(Format::Hz);
+      return format(buffer, Format::Hz);
     else if (10000000ULL > _frequency)
-      return format(Format::kHz);
+      return format(buffer, Format::kHz);
     else if (10000000000ULL > _frequency)
-      return format(Format::MHz);
-    return format(Format::GHz);
-  case Format::Hz:
-    return QString("%1 Hz").arg(inHz());
-  case Format::kHz:
-    return QString("%1 kHz").arg(inkHz(), 0, 'g', 6);
-  case Format::MHz:
-    return QString("%1 MHz").arg(inMHz(), 0, 'g', 9);
-  case Format::GHz:
-    return QString("%1 GHz").arg(inGHz(), 0, 'g', 12);
+      return format(buffer, Format::MHz);
+    return format(buffer, Format::GHz);
+  case Format::Hz: break;
+  case Format::kHz: decimals = 3; precision = 6; unit = " kHz"; break;
+  case Format::MHz: decimals = 6; precision = 9; unit = " MHz"; break;
+  case Format::GHz: decimals = 9; precision = 12; unit = " GHz"; break;
   }
-  return "";
+
+  unsigned long long scale = 1;
+  for (unsigned int i=0; i<decimals; i++)
+    scale *= 10;
+
+  // Round to the number of significant digits, like QString::number(value, 'g', precision).
+  unsigned int digits = 1;
+  for (unsigned long long v=_frequency/scale; v>=10; v/=10)
+    digits++;
+  unsigned long long hz = _frequency;
+  if (digits < precision) {
+    unsigned long long step = 1;
+    for (unsigned int i=precision-digits; i<decimals; i++)
+      step *= 10;
+    hz = ((hz + step/2)/step)*step;
+  } else {
+    hz = ((hz + scale/2)/scale)*scale;
+  }
+
+  // Integer part, written backwards into a temporary buffer
+  char tmp[24]; unsigned int n = 0;
+  unsigned long long integer = hz/scale, fraction = hz%scale;
+  do {
+    tmp[n++] = char('0' + integer%10); integer /= 10;
+  } while (integer);
+  char *ptr = buffer;
+  while (n)
+    *ptr++ = tmp[--n];
+
+  // Fractional part with trimmed zeros
+  if (fraction) {
+    while (0 == (fraction % 10)) {
+      fraction /= 10; decimals--;
+    }
+    *ptr++ = '.';
+    for (unsigned int i=decimals; i>0; i--, fraction/=10)
+      ptr[i-1] = char('0' + fraction%10);
+    ptr += decimals;
+  }
+
+  while (*unit)
+    *ptr++ = *unit++;
+  return ptr - buffer;
+}
+
+QString
+Frequency::format(Format f) const {
+  char buffer[FORMAT_BUFFER_SIZE];
+  return QString::fromLatin1(buffer, format(buffer, f));
 }
 
+std::string
+Frequency::toStdString(Format f) const {
+  char buffer[FORMAT_BUFFER_SIZE];
+  return std::string(buffer, format(buffer, f));
+}
+
+template <class Char>
 bool
-Frequency::parse(const QString &value) {
-  QRegularExpression re(R"(\s*([0-9]+)(?:\.([0-9]*)|)\s*([kMG]?Hz|)\s*)");
-  QRegularExpressionMatch match = re.match(value);
-  if (! match.isValid())
+Frequency::parse(const Char *ptr, const Char *end) {
+  // Parses "<digits>[.<digits>] [Hz|kHz|MHz|GHz]", surrounded by optional white spaces.
+  // Frequencies get parsed for every channel of a codeplug, hence no regular expression here.
+  ptr = skipSpaces(ptr, end);
+
+  if ((ptr == end) || (! isDigit(*ptr)))
     return false;
+  unsigned long long leading = 0;
+  for (; (ptr != end) && isDigit(*ptr); ptr++)
+    leading = 10*leading + digit(*ptr);
 
-  bool hasUnit = match.capturedLength(3);
-  QString unit = match.captured(3);
-  QString decimals = match.captured(2);
-  QString leading = match.captured(1);
-  _frequency = leading.toUInt();
-
-  if ("Hz" == unit)
-    return true;
-
-  if ("kHz" == unit) {
-    _frequency *= 1000ULL;
-    unsigned long long factor = 100ULL;
-    for (int i=0; i<std::min(3, decimals.size()); i++) {
-      _frequency += decimals[i].digitValue()*factor;
-      factor /= 10;
-    }
-    // Rounding to proper Hz
-    if ((decimals.size()>3) && (decimals[3].digitValue()>=5))
-      _frequency+=1;
-  } else if (("MHz"==unit) || (!hasUnit)) {
-    _frequency *= 1000000ULL;
-    unsigned long long factor = 100000ULL;
-    for (int i=0; i<std::min(6, decimals.size()); i++) {
-      _frequency += decimals[i].digitValue()*factor;
-      factor /= 10;
-    }
-    // Rounding to proper Hz
-    if ((decimals.size()>6) && (decimals[6].digitValue()>=5))
-      _frequency+=1;
-  } else if ("GHz"==unit) {
-    _frequency *= 1000000000ULL;
-    unsigned long long factor = 100000000;
-    for (int i=0; i<std::min(9, decimals.size()); i++) {
-      _frequency += decimals[i].digitValue()*factor;
-      factor /= 10;
+  const Char *decimals = ptr, *decimalsEnd = ptr;
+  if ((ptr != end) && ('.' == charCode(*ptr))) {
+    decimals = ++ptr;
+    for (; (ptr != end) && isDigit(*ptr); ptr++);
+    decimalsEnd = ptr;
+  }
+  ptr = skipSpaces(ptr, end);
+
+  // Scale of the unit as number of decimal digits, MHz if no unit is given
+  int scale = 6;
+  if (ptr != end) {
+    switch (charCode(*ptr)) {
+    case 'H': scale = 0; break;
+    case 'k': scale = 3; ptr++; break;
+    case 'M': scale = 6; ptr++; break;
+    case 'G': scale = 9; ptr++; break;
+    default: return false;
     }
-    // Rounding to proper Hz
-    if ((decimals.size()>9) && (decimals[9].digitValue()>=5))
-      _frequency+=1;
+    if (((end-ptr) < 2) || ('H' != charCode(ptr[0])) || ('z' != charCode(ptr[1])))
+      return false;
+    if (skipSpaces(ptr+2, end) != end)
+      return false;
+  }
+
+  _frequency = leading;
+  for (int i=0; i<scale; i++) {
+    _frequency *= 10ULL;
+    if ((decimals+i) < decimalsEnd)
+      _frequency += digit(decimals[i]);
   }
+  // Rounding to proper Hz
+  if (((decimals+scale) < decimalsEnd) && (digit(decimals[scale])>=5))
+    _frequency+=1;
 
   return true;
 }
 
+bool
+Frequency::parse(const QString &value) {
+  return parse(QStringView(value));
+}
+
+bool
+Frequency::parse(QStringView value) {
+  return parse(value.data(), value.data()+value.size());
+}
+
+bool
+Frequency::parse(const std::string &value) {
+  return parse(value.data(), value.data()+value.size());
+}
+
 Frequency
 Frequency::fromString(const QString &freq) {
   Frequency f;
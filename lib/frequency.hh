@@ -3,6 +3,8 @@
 
 #include <yaml-cpp/yaml.h>
 #include <QString>
+#include <QStringView>
+#include <string>
 #include <QMetaType>
 
 /** Helper type to encode frequencies without any rounding error.
@@ -49,8 +51,14 @@ public:
 
   /** Format the frequency. */
   QString format(Format f=Format::Automatic) const;
+  /** Format the frequency, e.g., directly into a YAML scalar. */
+  std::string toStdString(Format f=Format::Automatic) const;
   /** Parses a frequency. */
   bool parse(const QString &value);
+  /** Parses a frequency. */
+  bool parse(QStringView value);
+  /** Parses a frequency, e.g., directly from a YAML scalar. */
+  bool parse(const std::string &value);
   /** Pareses a frequency. */
   static Frequency fromString(const QString &freq);
 
@@ -64,6 +72,16 @@ public:
   static inline Frequency fromMHz(double MHz) { return Frequency(MHz*1e6); }      ///< Unit conversion.
   static inline Frequency fromGHz(double GHz) { return Frequency(GHz*1e6); }      ///< Unit conversion.
 
+protected:
+  /** Size of a buffer that holds any formatted frequency. */
+  static const size_t FORMAT_BUFFER_SIZE = 32;
+  /** Formats the frequency into the given buffer of at least @c FORMAT_BUFFER_SIZE characters
+   * using integer arithmetic only. Returns the number of characters written. */
+  size_t format(char *buffer, Format f) const;
+  /** Parses a frequency from the given range of characters without any allocation. */
+  template <class Char>
+  bool parse(const Char *ptr, const Char *end);
+
 protected:
   /** The actual frequency in Hz. */
   unsigned long long _frequency;
@@ -80,14 +98,14 @@ namespace YAML
   {
     /** Serializes the frequency. */
     static Node encode(const Frequency& rhs) {
-      return Node(rhs.format().toStdString());
+      return Node(rhs.toStdString());
     }
 
     /** Parses the frequency. */
     static bool decode(const Node& node, Frequency& rhs) {
       if (! node.IsScalar())
         return false;
-      return rhs.parse(QString::fromStdString(node.as<std::string>()));
+      return rhs.parse(node.Scalar());
     }
   };
 }
@@ -3,11 +3,12 @@
 
 #include "logger.hh"
 #include "config.hh"
+#include <algorithm>
 
 
 #define BSIZE           0x35
-
-RadioLimits * GD73::_limits = nullptr;
+/** Maximum number of blocks passed to the interface at once. */
+#define RUN_BLOCKS      64
 
 
 GD73::GD73(GD73Interface *device, QObject *parent)
@@ -25,9 +26,7 @@ GD73::name() const {
 
 const RadioLimits &
 GD73::limits() const {
-  if (nullptr == _limits)
-    _limits = new GD73Limits();
-  return *_limits;
+  return *RadioLimits::shared("gd73", []() -> RadioLimits * { return new GD73Limits(); });
 }
 
 const Codeplug &
@@ -46,6 +45,17 @@ GD73::defaultRadioInfo() {
         RadioInfo::GD73, "gd73", "GD-73", "Radioddity", GD73Interface::interfaceInfo());
 }
 
+void
+GD73::moveInterfaceToThread(QThread *thread) {
+  if (_dev)
+    _dev->moveToThread(thread);
+}
+
+RadioInterface *
+GD73::radioInterface() const {
+  return _dev;
+}
+
 bool
 GD73::startDownload(bool blocking, const ErrorStack &err) {
   if (StatusIdle != _task)
@@ -160,26 +170,17 @@ bool
 GD73::download() {
   emit downloadStarted();
 
-  unsigned btot = 0;
-  for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    btot += codeplug().image(0).element(n).data().size()/BSIZE;
-  }
+  enterPhase(PhaseRead, codeplug().memSize());
+  // All elements get downloaded entirely, no need to initialize them
+  codeplug().prepareOverwrite();
 
   if (! _dev->read_start(0,0,_errorStack))
     return false;
 
-  unsigned bcount = 0;
-  for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    int b0 = codeplug().image(0).element(n).address()/BSIZE;
-    int nb = codeplug().image(0).element(n).data().size()/BSIZE;
-    for (int i=0; i<nb; i++, bcount++) {
-      // read
-      if (! _dev->read(0, (b0+i)*BSIZE, codeplug().data((b0+i)*BSIZE), BSIZE, _errorStack)) {
-        errMsg(_errorStack) << "Cannot download codeplug.";
-        return false;
-      }
-      emit downloadProgress(float(bcount*100)/btot);
-    }
+  if (! transferCodeplug(false, [this](unsigned bcount, unsigned btot) {
+                           reportDownloadProgress(float(bcount*100)/btot); })) {
+    errMsg(_errorStack) << "Cannot download codeplug.";
+    return false;
   }
 
   _dev->read_finish(_errorStack);
@@ -190,58 +191,37 @@ bool
 GD73::upload() {
   emit uploadStarted();
 
-  unsigned btot = 0;
-  for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    btot += codeplug().image(0).element(n).data().size()/BSIZE;
-  }
-
-  unsigned bcount = 0;
   if (_codeplugFlags.updateCodePlug) {
+    enterPhase(PhaseRead, codeplug().memSize());
     if (! _dev->read_start(0,0,_errorStack))
       return false;
 
     // If codeplug gets updated, download codeplug from device first:
-    for (int n=0; n<codeplug().image(0).numElements(); n++) {
-      int b0 = codeplug().image(0).element(n).address()/BSIZE;
-      int nb = codeplug().image(0).element(n).data().size()/BSIZE;
-      for (int i=0; i<nb; i++, bcount++) {
-        uint32_t addr = (b0+i)*BSIZE;
-        // read
-        if (! _dev->read(0, addr, codeplug().data(addr), BSIZE, _errorStack)) {
-          errMsg(_errorStack) << "Cannot upload codeplug.";
-          return false;
-        }
-        emit uploadProgress(float(bcount*50)/btot);
-      }
+    if (! transferCodeplug(false, [this](unsigned bcount, unsigned btot) {
+                             reportUploadProgress(float(bcount*50)/btot); })) {
+      errMsg(_errorStack) << "Cannot upload codeplug.";
+      return false;
     }
 
     _dev->read_finish(_errorStack);
   }
 
   // Encode config into codeplug
+  enterPhase(PhaseEncode);
   if (! codeplug().encode(_config, _codeplugFlags, _errorStack)) {
     errMsg(_errorStack) << "Codeplug upload failed.";
     return false;
   }
 
+  enterPhase(PhaseWrite, codeplug().memSize());
   if (! _dev->write_start(0, 0, _errorStack))
     return false;
 
   // then, upload modified codeplug
-  bcount = 0;
-  for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    int b0 = codeplug().image(0).element(n).address()/BSIZE;
-    int nb = codeplug().image(0).element(n).data().size()/BSIZE;
-    for (int i=0; i<nb; i++, bcount++) {
-      // Select bank by addr
-      uint32_t addr = (b0+i)*BSIZE;
-      // write block
-      if (! _dev->write(0, addr, codeplug().data(addr), BSIZE, _errorStack)) {
-        errMsg(_errorStack) << "Cannot upload codeplug.";
-        return false;
-      }
-      emit uploadProgress(50+float(bcount*50)/btot);
-    }
+  if (! transferCodeplug(true, [this](unsigned bcount, unsigned btot) {
+                           reportUploadProgress(50+float(bcount*50)/btot); })) {
+    errMsg(_errorStack) << "Cannot upload codeplug.";
+    return false;
   }
 
   _dev->write_finish(_errorStack);
@@ -254,3 +234,45 @@ GD73::uploadCallsigns() {
   return false;
 }
 
+bool
+GD73::transferCodeplug(bool write, const std::function<void(unsigned, unsigned)> &progress) {
+  const DFUFile::Image &image = codeplug().image(0);
+  unsigned btot = 0;
+  for (int n=0; n<image.numElements(); n++)
+    btot += image.element(n).data().size()/BSIZE;
+
+  unsigned bcount = 0;
+  QByteArray run;
+  for (int n=0; n<image.numElements();) {
+    // Merge adjacent elements
+    uint32_t addr = image.element(n).address();
+    uint32_t end = addr + (image.element(n).data().size()/BSIZE)*BSIZE;
+    int m = n+1;
+    while ((m < image.numElements()) && (image.element(m).address() == end)) {
+      end += (image.element(m).data().size()/BSIZE)*BSIZE;
+      m++;
+    }
+
+    for (uint32_t a=addr; a<end;) {
+      uint32_t size = std::min(end-a, uint32_t(RUN_BLOCKS*BSIZE));
+      // Runs may span several elements, hence copy block-wise
+      run.resize(size);
+      if (write) {
+        for (uint32_t o=0; o<size; o+=BSIZE)
+          memcpy(run.data()+o, codeplug().data(a+o), BSIZE);
+        if (! _dev->write(0, a, (uint8_t *)run.data(), size, _errorStack))
+          return false;
+      } else {
+        if (! _dev->read(0, a, (uint8_t *)run.data(), size, _errorStack))
+          return false;
+        for (uint32_t o=0; o<size; o+=BSIZE)
+          memcpy(codeplug().data(a+o), run.constData()+o, BSIZE);
+      }
+      a += size; bcount += size/BSIZE;
+      progress(bcount, btot);
+    }
+    n = m;
+  }
+
+  return true;
+}
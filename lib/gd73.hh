@@ -12,6 +12,7 @@
 #include "radio.hh"
 #include "gd73_interface.hh"
 #include "gd73_codeplug.hh"
+#include <functional>
 
 
 
@@ -49,6 +50,8 @@ public slots:
                              const CallsignDB::Selection &selection=CallsignDB::Selection(), const ErrorStack &err=ErrorStack());
 
 protected:
+  void moveInterfaceToThread(QThread *thread);
+  RadioInterface *radioInterface() const;
   /** Thread main routine, performs all blocking IO operations for codeplug up- and download. */
   void run();
 
@@ -57,6 +60,11 @@ private:
   virtual bool upload();
   virtual bool uploadCallsigns();
 
+  /** Reads or writes the complete codeplug. Adjacent elements are merged and transferred in runs
+   * of several blocks. After every run, @c progress gets called with the number of blocks
+   * transferred so far and the total number of blocks. */
+  bool transferCodeplug(bool write, const std::function<void(unsigned, unsigned)> &progress);
+
 protected:
   /** The device identifier. */
   QString _name;
@@ -70,10 +78,6 @@ protected:
 
   /** The codeplug. */
   GD73Codeplug _codeplug;
-
-private:
-  /** Holds the signleton instance of the radio limits for this radio. */
-  static RadioLimits *_limits;
 };
 
 #endif // GD77_HH
@@ -2,6 +2,8 @@
 #include "config.hh"
 #include "intermediaterepresentation.hh"
 #include "logger.hh"
+#include "tracer.hh"
+#include "stringpool.hh"
 
 
 QVector<Signaling::Code> _ctcss_codes = {
@@ -2227,8 +2229,14 @@ GD73Codeplug::GD73Codeplug(QObject *parent)
   image(0).addElement(0x000000, 0x22014);
 }
 
+bool
+GD73Codeplug::requiresPreprocessing(const Config *config) const {
+  return Codeplug::requiresPreprocessing(config) || ZoneSplitVisitor::isRequired(config);
+}
+
 Config *
 GD73Codeplug::preprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("GD73Codeplug::preprocess", "codeplug");
   Config *copy = Codeplug::preprocess(config, err);
   if (nullptr == copy) {
     errMsg(err) << "Cannot pre-process codeplug for GD73A/E.";
@@ -2246,6 +2254,7 @@ GD73Codeplug::preprocess(Config *config, const ErrorStack &err) const {
 
 bool
 GD73Codeplug::postprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("GD73Codeplug::postprocess", "codeplug");
   if (! Codeplug::postprocess(config, err)) {
     errMsg(err) << "Cannot post-process codeplug for GD73A/E.";
     return false;
@@ -2263,6 +2272,7 @@ GD73Codeplug::postprocess(Config *config, const ErrorStack &err) const {
 
 bool
 GD73Codeplug::index(Config *config, Context &ctx, const ErrorStack &err) const {
+  TRACE_SPAN("GD73Codeplug::index", "codeplug");
   // There must be a default DMR radio ID.
   if (nullptr == ctx.config()->settings()->defaultId()) {
     errMsg(err) << "No default DMR radio ID specified.";
@@ -2319,6 +2329,7 @@ GD73Codeplug::index(Config *config, Context &ctx, const ErrorStack &err) const {
 
 bool
 GD73Codeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
+  TRACE_SPAN("GD73Codeplug::encode", "codeplug");
   Q_UNUSED(flags);
 
   Context ctx(config);
@@ -2379,6 +2390,9 @@ GD73Codeplug::encode(Config *config, const Flags &flags, const ErrorStack &err)
 
 bool
 GD73Codeplug::decode(Config *config, const ErrorStack &err) {
+  TRACE_SPAN("GD73Codeplug::decode", "codeplug");
+  // Names decoded repeatedly share their storage
+  StringPool::Scope strings;
   Context ctx(config);
   ctx.addTable(&BasicEncryptionKey::staticMetaObject);
 
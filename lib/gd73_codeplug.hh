@@ -1640,6 +1640,7 @@ public:
   explicit GD73Codeplug(QObject *parent = nullptr);
 
   Config *preprocess(Config *config, const ErrorStack &err=ErrorStack()) const;
+  bool requiresPreprocessing(const Config *config) const;
   bool postprocess(Config *config, const ErrorStack &err=ErrorStack()) const;
 
   bool index(Config *config, Context &ctx, const ErrorStack &err=ErrorStack()) const;
@@ -1,11 +1,14 @@
 #include "gd73_interface.hh"
 #include "logger.hh"
 #include <QtEndian>
+#include <algorithm>
 
 #define BLOCK_SIZE 0x35
+/** Number of write requests queued back-to-back before the responses are collected. */
+#define WINDOW_SIZE 8
 
 GD73Interface::GD73Interface(const USBDeviceDescriptor &descriptor, const ErrorStack &err, QObject *parent)
-  : C7000Device(descriptor, err, parent), RadioInterface()
+  : C7000Device(descriptor, err, parent), RadioInterface(), _lastSequence(0xffff), _window(WINDOW_SIZE)
 {
   Packet request, response;
   if (nullptr == _dev) {
@@ -47,19 +50,32 @@ bool
 GD73Interface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
   Q_UNUSED(bank);
 
-  if ((addr%BLOCK_SIZE) || (nbytes!=BLOCK_SIZE)) {
+  if ((addr%BLOCK_SIZE) || (0 == nbytes) || (nbytes%BLOCK_SIZE)) {
     errMsg(err) << "Address and size must align with block size of 35h";
     return false;
   }
 
-  C7000Device::Packet request, response;
-  QByteArray payload; payload.resize(2);
-  *((uint16_t *)payload.data()) = qToLittleEndian((uint16_t)(addr/BLOCK_SIZE));
-  payload.append((char *)data, nbytes);
-  request = C7000Device::Packet(0x01, 0x00, 0x0f, payload);
-  if (! sendRecv(request, response, err)) {
-    errMsg(err) << "Cannot send write command.";
-    return false;
+  _transferStatistics.setAddress(addr);
+  for (int i=0; i<nbytes;) {
+    if (! checkCanceled(err))
+      return false;
+    int n = std::min(nbytes-i, int(_window*BLOCK_SIZE));
+    TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Write, n);
+    if (1 == _window) {
+      if (! writeBlocks(addr+i, data+i, n, err)) {
+        errMsg(err) << "Cannot send write command.";
+        return false;
+      }
+    } else if (! writeBlocks(addr+i, data+i, n)) {
+      // Blocks are addressed explicitly, hence the batch can simply be repeated.
+      logWarn() << "Pipelined write at " << QString::number(addr+i, 16)
+                << "h failed, fall back to lock-step transfers.";
+      _transferStatistics.addRetry();
+      discardInput();
+      _window = 1;
+      continue;
+    }
+    i += n;
   }
 
   return true;
@@ -83,13 +99,34 @@ bool
 GD73Interface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
   Q_UNUSED(bank);
 
-  if ((addr%BLOCK_SIZE) || (nbytes!=BLOCK_SIZE)) {
+  if ((addr%BLOCK_SIZE) || (0 == nbytes) || (nbytes%BLOCK_SIZE)) {
     errMsg(err) << "Address and size must align with block size of 35h";
     return false;
   }
 
   //logDebug() << "Read " << nbytes << "bytes from address " << Qt::hex << addr << "h.";
 
+  _transferStatistics.setAddress(addr);
+  for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
+    if (! checkCanceled(err))
+      return false;
+    TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Read, BLOCK_SIZE);
+    if (! readBlock(addr+i, data+i, err))
+      return false;
+  }
+
+  return true;
+}
+
+bool
+GD73Interface::read_finish(const ErrorStack &err) {
+  Q_UNUSED(err);
+  _lastSequence = 0xffff;
+  return true;
+}
+
+bool
+GD73Interface::readBlock(uint32_t addr, uint8_t *data, const ErrorStack &err) {
   uint16_t seqNum = addr/BLOCK_SIZE;
   if (uint16_t(_lastSequence+1) != seqNum) {
     errMsg(err) << "Out-of-sequence read: Expected seqnr. " << uint16_t(_lastSequence+1)
@@ -112,15 +149,27 @@ GD73Interface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, con
   }
 
   _lastSequence = qFromLittleEndian(*(uint16_t *)response.payload().data());
-  memcpy(data, response.payload().data()+2, nbytes);
+  memcpy(data, response.payload().data()+2, BLOCK_SIZE);
 
   return true;
 }
 
 bool
-GD73Interface::read_finish(const ErrorStack &err) {
-  Q_UNUSED(err);
-  _lastSequence = 0xffff;
+GD73Interface::writeBlocks(uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err) {
+  // Queue all requests back-to-back, then collect the responses in order.
+  for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
+    QByteArray payload; payload.resize(2);
+    *((uint16_t *)payload.data()) = qToLittleEndian((uint16_t)((addr+i)/BLOCK_SIZE));
+    payload.append((const char *)data+i, BLOCK_SIZE);
+    if (! send(C7000Device::Packet(0x01, 0x00, 0x0f, payload), err))
+      return false;
+  }
+  C7000Device::Packet response;
+  for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
+    if (! receive(response, 1000, err)) {
+      errMsg(err) << "Cannot write block at " << QString::number(addr+i, 16) << "h.";
+      return false;
+    }
+  }
   return true;
 }
-
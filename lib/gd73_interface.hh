@@ -5,6 +5,11 @@
 #include "radiointerface.hh"
 
 /** Implements the communication interface to the GD-73.
+ *
+ * Reads and writes accept any number of consecutive blocks. The codeplug is read as a stream,
+ * where every request acknowledges the previous block, hence reads are inherently lock-step.
+ * Writes address the blocks explicitly and get pipelined.
+ *
  * @ingroup gd73 */
 class GD73Interface: public C7000Device, public RadioInterface
 {
@@ -30,11 +35,21 @@ public:
 
   void close();
 
+protected:
+  /** Reads the next block of the codeplug stream. */
+  bool readBlock(uint32_t addr, uint8_t *data, const ErrorStack &err=ErrorStack());
+  /** Writes several consecutive blocks. All requests are queued back-to-back before the
+   * responses are collected. */
+  bool writeBlocks(uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+
 protected:
   /** Name of the radio. */
   QString _identifier;
   /** Last received/send sequence number. */
   uint16_t _lastSequence;
+  /** Number of write requests queued before collecting responses. Falls back to 1 (lock-step) if
+   * the device fails to keep up with pipelined requests. */
+  unsigned _window;
 };
 
 #endif // GD73INTERFACE_HH
@@ -3,11 +3,12 @@
 
 #include "logger.hh"
 #include "config.hh"
+#include <algorithm>
 
 
 #define BSIZE           32
-
-RadioLimits * GD77::_limits = nullptr;
+/** Maximum size of a run of blocks written at once. */
+#define RUN_SIZE        0x1000
 
 
 GD77::GD77(RadioddityInterface *device, QObject *parent)
@@ -23,9 +24,7 @@ GD77::name() const {
 
 const RadioLimits &
 GD77::limits() const {
-  if (nullptr == _limits)
-    _limits = new GD77Limits();
-  return *_limits;
+  return *RadioLimits::shared("gd77", []() -> RadioLimits * { return new GD77Limits(); });
 }
 
 const Codeplug &
@@ -90,21 +89,25 @@ GD77::uploadCallsigns()
   logDebug() << "Call-sign DB upload started...";
 
   size_t totb = _callsigns.memSize();
+  enterPhase(PhaseWrite, totb);
   unsigned bcount = 0;
   for (int n=0; n<_callsigns.image(0).numElements(); n++) {
     unsigned addr = _callsigns.image(0).element(n).address();
-    unsigned size = _callsigns.image(0).element(n).data().size();
-    unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-    for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
+    unsigned end = addr + _callsigns.image(0).element(n).data().size()/BSIZE*BSIZE;
+    // Write runs of blocks within the same memory bank
+    while (addr < end) {
+      unsigned limit = std::min(end, addr+RUN_SIZE);
+      if (0x10000 > addr)
+        limit = std::min(limit, 0x10000u);
+      unsigned len = limit-addr;
       RadioddityInterface::MemoryBank bank = (
-            (0x10000 > (b0+b)*BSIZE) ? RadioddityInterface::MEMBANK_CALLSIGN_LOWER : RadioddityInterface::MEMBANK_CALLSIGN_UPPER );
-      if (! _dev->write(bank, ((b0+b)*BSIZE)&0xffff,
-                        _callsigns.data((b0+b)*BSIZE, 0), BSIZE, _errorStack))
-      {
-        errMsg(_errorStack) << "Cannot write block " << (b0+b) << ".";
+            (0x10000 > addr) ? RadioddityInterface::MEMBANK_CALLSIGN_LOWER : RadioddityInterface::MEMBANK_CALLSIGN_UPPER );
+      if (! _dev->write(bank, addr&0xffff, _callsigns.data(addr, 0), len, _errorStack)) {
+        errMsg(_errorStack) << "Cannot write blocks " << addr/BSIZE << "-" << (limit/BSIZE-1) << ".";
         return false;
       }
-      emit uploadProgress(float(bcount*100)/totb);
+      addr += len; bcount += len;
+      reportUploadProgress(float(bcount*100)/totb);
     }
   }
 
@@ -52,10 +52,6 @@ protected:
   GD77Codeplug _codeplug;
   /** The actual binary callsign DB representation. */
   GD77CallsignDB _callsigns;
-
-private:
-  /** Holds the signleton instance of the radio limits for this radio. */
-  static RadioLimits *_limits;
 };
 
 #endif // GD77_HH
@@ -88,21 +88,15 @@ GD77CallsignDB::encode(UserDatabase *calldb, const Selection &selection, const E
 
   // Limit entries to USERDB_NUM_ENTRIES
   qint64 n = std::min(calldb->count(), qint64(USERDB_MAX_ENTRIES));
-  if (selection.hasCountLimit())
-    n = std::min(n, (qint64)selection.countLimit());
+
+  // Select entries and sort them in ascending order of their IDs
+  QVector<int> users = sortedSelection(calldb, selection, n);
+  n = users.size();
+  logDebug() << "Selected " << n << " entries out off " << calldb->count() << ".";
   // If there are no entries -> done.
   if (0 == n)
     return true;
 
-  // Select first n entries and sort them in ascending order of their IDs
-  logDebug() << "Select first " << n << " entries out off " << calldb->count() << ".";
-  QVector<UserDatabase::User> users;
-  for (unsigned i=0; i<n; i++)
-    users.append(calldb->user(i));
-  logDebug() << "Sort selected w.r.t their ID in ascending order.";
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
-
   // Allocate segment for user db if requested
   size_t size = align_size(sizeof(userdb_t)+n*sizeof(userdb_entry_t), BLOCK_SIZE);
   logDebug() << "Allocate 0x" << QString::number(size,16) << " bytes for call-sign DB.";
@@ -112,9 +106,11 @@ GD77CallsignDB::encode(UserDatabase *calldb, const Selection &selection, const E
   userdb_t *userdb = (userdb_t *)this->data(OFFSET_USERDB);
   userdb->clear(); userdb->setSize(n);
   userdb_entry_t *db = (userdb_entry_t *)this->data(OFFSET_USERDB+sizeof(userdb_t), 0);
-  for (unsigned i=0; i<n; i++) {
-    db[i].fromEntry(users[i]);
-  }
+  // Entries have a fixed size and can be encoded concurrently
+  parallelFor(n, [calldb, &users, db](qint64 first, qint64 last) {
+    for (qint64 i=first; i<last; i++)
+      db[i].fromEntry(calldb->user(users[i]));
+  });
 
   return true;
 }
@@ -259,6 +259,14 @@ GD77Codeplug::GD77Codeplug(QObject *parent)
   image(0).addElement(0x08000, 0x16b00);
 }
 
+std::vector<AddressMap::Range>
+GD77Codeplug::generatedMemory() const {
+  // Contacts and DTMF contacts are cleared before encoding.
+  return {
+    {ADDR_CONTACTS, NUM_CONTACTS*CONTACT_SIZE}, {ADDR_DTMF_CONTACTS, NUM_DTMF_CONTACTS*DTMF_CONTACT_SIZE}
+  };
+}
+
 void
 GD77Codeplug::clearGeneralSettings() {
   GeneralSettingsElement(data(ADDR_SETTINGS)).clear();
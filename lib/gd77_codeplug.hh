@@ -252,6 +252,8 @@ public:
   /** Constructs an empty codeplug for the GD-77. */
 	explicit GD77Codeplug(QObject *parent=nullptr);
 
+  std::vector<AddressMap::Range> generatedMemory() const;
+
 public:
   void clearGeneralSettings();
   bool encodeGeneralSettings(Config *config, const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
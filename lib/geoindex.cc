@@ -0,0 +1,119 @@
+#include "geoindex.hh"
+#include "memoryusage.hh"
+#include <QtMath>
+#include <cmath>
+#include <algorithm>
+
+/** Mean earth radius in meters, as used by QGeoCoordinate. */
+#define EARTH_RADIUS 6371007.2
+
+
+/* ********************************************************************************************* *
+ * Implementation of GeoIndex::Position
+ * ********************************************************************************************* */
+GeoIndex::Position::Position()
+  : x(0), y(0), z(0)
+{
+  // pass...
+}
+
+GeoIndex::Position::Position(const QGeoCoordinate &coor)
+{
+  double lat = qDegreesToRadians(coor.latitude()), lon = qDegreesToRadians(coor.longitude());
+  x = std::cos(lat)*std::cos(lon);
+  y = std::cos(lat)*std::sin(lon);
+  z = std::sin(lat);
+}
+
+double
+GeoIndex::Position::chord2(const Position &other) const {
+  double dx = x-other.x, dy = y-other.y, dz = z-other.z;
+  return dx*dx + dy*dy + dz*dz;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of GeoIndex
+ * ********************************************************************************************* */
+GeoIndex::GeoIndex()
+  : _positions()
+{
+  // pass...
+}
+
+int
+GeoIndex::size() const {
+  return _positions.size();
+}
+
+void
+GeoIndex::reserve(int size) {
+  _positions.reserve(size);
+}
+
+void
+GeoIndex::clear() {
+  _positions.clear();
+}
+
+void
+GeoIndex::append(const QGeoCoordinate &location) {
+  _positions.append(Position(location));
+}
+
+void
+GeoIndex::insert(int row, const QGeoCoordinate &location) {
+  _positions.insert(row, Position(location));
+}
+
+void
+GeoIndex::replace(int row, const QGeoCoordinate &location) {
+  _positions[row] = Position(location);
+}
+
+void
+GeoIndex::remove(int row) {
+  _positions.remove(row);
+}
+
+QVector<double>
+GeoIndex::distances(const QGeoCoordinate &location) const {
+  Position pos(location);
+  QVector<double> dist(_positions.size());
+  for (int i=0; i<_positions.size(); i++)
+    dist[i] = chordToDistance(pos.chord2(_positions[i]));
+  return dist;
+}
+
+QVector<int>
+GeoIndex::nearest(const QGeoCoordinate &location, int k, const Filter &filter) const {
+  Position pos(location);
+  QVector<QPair<double, int>> keys; keys.reserve(_positions.size());
+  for (int i=0; i<_positions.size(); i++) {
+    if (filter && (! filter(i)))
+      continue;
+    keys.append(QPair<double,int>(pos.chord2(_positions[i]), i));
+  }
+
+  k = std::max(0, std::min(k, keys.size()));
+  std::partial_sort(keys.begin(), keys.begin()+k, keys.end());
+  QVector<int> rows(k);
+  for (int i=0; i<k; i++)
+    rows[i] = keys[i].second;
+  return rows;
+}
+
+double
+GeoIndex::distance(const QGeoCoordinate &a, const QGeoCoordinate &b) {
+  return chordToDistance(Position(a).chord2(Position(b)));
+}
+
+quint64
+GeoIndex::memorySize() const {
+  return MemoryUsage::of(_positions);
+}
+
+double
+GeoIndex::chordToDistance(double chord2) {
+  return 2*EARTH_RADIUS*std::asin(std::min(1.0, std::sqrt(chord2)/2));
+}
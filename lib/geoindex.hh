@@ -0,0 +1,71 @@
+#ifndef GEOINDEX_HH
+#define GEOINDEX_HH
+
+#include <QVector>
+#include <QGeoCoordinate>
+#include <functional>
+
+/** Index of geographic locations for distance queries.
+ *
+ * Every location is kept as a unit vector. The chord length between two of these vectors is
+ * monotonic in the great-circle distance, hence locations can be ordered by their distance
+ * without any trigonometric function per location. The locations are identified by their row,
+ * which usually matches the row of some list or model.
+ *
+ * @ingroup util */
+class GeoIndex
+{
+public:
+  /** Filter for @c nearest. Returns @c true, if the location at the given row is considered. */
+  typedef std::function<bool(int row)> Filter;
+
+public:
+  /** Constructs an empty index. */
+  GeoIndex();
+
+  /** Returns the number of locations. */
+  int size() const;
+  /** Reserves space for the given number of locations. */
+  void reserve(int size);
+  /** Removes all locations. */
+  void clear();
+  /** Appends a location. */
+  void append(const QGeoCoordinate &location);
+  /** Inserts a location at the given row. */
+  void insert(int row, const QGeoCoordinate &location);
+  /** Replaces the location at the given row. */
+  void replace(int row, const QGeoCoordinate &location);
+  /** Removes the location at the given row. */
+  void remove(int row);
+
+  /** Returns the distances (in meters) of all locations to the given one, indexed by row. */
+  QVector<double> distances(const QGeoCoordinate &location) const;
+  /** Returns the rows of the (at most) @c k locations closest to the given one in ascending
+   * order of their distance. If given, only locations accepted by @c filter are considered. */
+  QVector<int> nearest(const QGeoCoordinate &location, int k, const Filter &filter=nullptr) const;
+
+  /** Returns the great-circle distance in meters between the given locations. */
+  static double distance(const QGeoCoordinate &a, const QGeoCoordinate &b);
+
+  /** Returns an estimate of the heap memory held by the index. */
+  quint64 memorySize() const;
+
+protected:
+  /** A location as unit vector. */
+  struct Position {
+    double x, y, z;
+    Position();
+    explicit Position(const QGeoCoordinate &coor);
+    /** Returns the squared chord length to the other position. */
+    double chord2(const Position &other) const;
+  };
+
+  /** Converts the squared chord length into the great-circle distance in meters. */
+  static double chordToDistance(double chord2);
+
+protected:
+  /** The positions, indexed by row. */
+  QVector<Position> _positions;
+};
+
+#endif // GEOINDEX_HH
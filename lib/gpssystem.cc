@@ -453,83 +453,35 @@ PositioningSystems::add(ConfigObject *obj, int row, bool unique) {
 
 int
 PositioningSystems::gpsCount() const {
-  int c=0;
-  for (int i=0; i<_items.size(); i++)
-    if (_items.at(i)->is<GPSSystem>())
-      c++;
-  return c;
+  return countOfType(GPSSystem::staticMetaObject);
 }
 
 int
 PositioningSystems::indexOfGPSSys(const GPSSystem *gps) const {
-  if (! _items.contains((GPSSystem *)gps))
-    return -1;
-
-  int idx=0;
-  for (int i=0; i<count(); i++) {
-    if (gps == _items.at(i))
-      return idx;
-    if (_items.at(i)->is<GPSSystem>())
-      idx++;
-  }
-
-  return -1;
+  return indexOfType(GPSSystem::staticMetaObject, const_cast<GPSSystem *>(gps));
 }
 
 GPSSystem *
 PositioningSystems::gpsSystem(int idx) const {
-  if ((0>idx) || (idx >= _items.size()))
-    return nullptr;
-  for (int i=0; i<_items.size(); i++) {
-    if (_items.at(i)->is<GPSSystem>()) {
-      if (0==idx)
-        return _items.at(i)->as<GPSSystem>();
-      else
-        idx--;
-    }
-  }
+  if (ConfigObject *obj = getOfType(GPSSystem::staticMetaObject, idx))
+    return obj->as<GPSSystem>();
   return nullptr;
 }
 
-
 int
 PositioningSystems::aprsCount() const {
-  int c=0;
-  for (int i=0; i<count(); i++) {
-    if (_items.at(i)->is<APRSSystem>())
-      c++;
-  }
-  return c;
+  return countOfType(APRSSystem::staticMetaObject);
 }
 
 int
 PositioningSystems::indexOfAPRSSys(APRSSystem *aprs) const {
-  if (! _items.contains(aprs))
-    return -1;
-
-  int idx=0;
-  for (int i=0; i<count(); i++) {
-    if (aprs == _items.at(i))
-      return idx;
-    if (_items.at(i)->is<APRSSystem>())
-      idx++;
-  }
-
-  return -1;
+  return indexOfType(APRSSystem::staticMetaObject, aprs);
 }
 
 APRSSystem *
 PositioningSystems::aprsSystem(int idx) const {
-  if ((0>idx) || (idx >= _items.size()))
-    return nullptr;
-  for (int i=0; i<_items.size(); i++) {
-    if (_items.at(i)->is<APRSSystem>()) {
-      if (0==idx)
-        return _items.at(i)->as<APRSSystem>();
-      else
-        idx--;
-    }
-  }
+  if (ConfigObject *obj = getOfType(APRSSystem::staticMetaObject, idx))
+    return obj->as<APRSSystem>();
   return nullptr;
 }
 
@@ -1,8 +1,11 @@
 #include "hid_libusb.hh"
 #include "logger.hh"
+#include "devicemonitor.hh"
+#include "sessionrecorder.hh"
+#include <QElapsedTimer>
 
 #define HID_INTERFACE   0                   // interface index
-#define TIMEOUT_MSEC    500                 // receive timeout
+#define TIMEOUT_MSEC    500                 // default receive timeout
 #define MAX_RETRY       20                  // Number of retries
 
 /* ********************************************************************************************* *
@@ -19,27 +22,27 @@ HIDevice::Descriptor::Descriptor(const USBDeviceInfo &info, uint8_t bus, uint8_t
  * Implementation of HIDevice
  * ********************************************************************************************* */
 HIDevice::HIDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObject *parent)
-  : QObject(parent), _ctx(nullptr), _dev(nullptr), _transfer(nullptr)
+  : QObject(parent), _ctx(nullptr), _dev(nullptr), _transfer(nullptr), _pipelineDepth(POOL_SIZE),
+    _timing(TIMEOUT_MSEC), _recorder(nullptr)
 {
+  for (unsigned i=0; i<POOL_SIZE; i++)
+    _pool[i].transfer = nullptr;
+
   if (USBDeviceInfo::Class::HID != descr.interfaceClass()) {
     errMsg(err) << "Cannot connect to HID device using a non HID descriptor: "
                 << descr.description() << ".";
     return;
   }
 
-  int error = libusb_init(&_ctx);
-  if (error < 0) {
-    errMsg(err) << "Libusb init failed (" << error << "): "
-                << libusb_strerror((enum libusb_error) error) << ".";
+  if (nullptr == (_ctx = USBContext::acquire(err)))
     return;
-  }
 
-  int num=0;
+  int error, num=0;
   libusb_device **lst;
   libusb_device *dev=nullptr;
   if (0 > (num = libusb_get_device_list(_ctx, &lst))) {
     errMsg(err) << "Cannot obtain list of USB devices.";
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
     return;
   }
@@ -68,7 +71,7 @@ HIDevice::HIDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObj
 
   if (nullptr == dev) {
     errMsg(err) << "No matching device found: " << descr.description() << ".";
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
     return;
   }
@@ -77,8 +80,9 @@ HIDevice::HIDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObj
     errMsg(err) << "Cannot open device " << descr.description()
                 << ": " << libusb_strerror((enum libusb_error) error) << ".";
     libusb_unref_device(dev);
-    libusb_exit(_ctx);
+    USBContext::release();
     _ctx = nullptr;
+    return;
   }
 
   if (libusb_kernel_driver_active(_dev, 0)) {
@@ -95,54 +99,34 @@ HIDevice::HIDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObj
     errMsg(err) << "Failed to claim HID interface (" << error
                 << "): " << libusb_strerror((enum libusb_error) error) << ".";
     libusb_close(_dev);
-    libusb_exit(_ctx);
+    USBContext::release();
     _dev = nullptr;
     _ctx = nullptr;
+    return;
   }
+
+  _recorder = SessionRecorder::create(descr);
 }
 
 HIDevice::~HIDevice() {
   close();
+  delete _recorder;
 }
 
 QList<USBDeviceDescriptor>
 HIDevice::detect(uint16_t vid, uint16_t pid) {
   QList<USBDeviceDescriptor> res;
 
-  int error, num;
-  libusb_context *ctx;
-  if (0 > (error = libusb_init(&ctx))) {
-    logError() << "Libusb init failed (" << error << "): "
-               << libusb_strerror((enum libusb_error) error) << ".";
-    return res;
-  }
-
-  libusb_device **lst;
-  if (0 == (num = libusb_get_device_list(ctx, &lst))) {
-    logDebug() << "No USB devices found at all.";
-    // unref devices and free list
-    libusb_free_device_list(lst, 1);
-    return res;
-  }
-
   logDebug() << "Search for HID interfaces matching VID:PID "
              << QString::number(vid, 16) << ":" << QString::number(pid, 16) << ".";
-  for (int i=0; (i<num)&&(nullptr!=lst[i]); i++) {
-    libusb_device_descriptor descr;
-    libusb_get_device_descriptor(lst[i], &descr);
-    if ((vid == descr.idVendor) && (pid == descr.idProduct)) {
-      logDebug() << "Found device on bus=" << libusb_get_bus_number(lst[i])
-                 << ", device=" << libusb_get_device_address(lst[i])
-                 << " matching " << QString::number(vid, 16) << ":"
-                 << QString::number(pid, 16) << ".";
-      res.append(HIDevice::Descriptor(
-                   USBDeviceInfo(USBDeviceInfo::Class::HID, vid, pid),
-                   libusb_get_bus_number(lst[i]),
-                   libusb_get_device_address(lst[i])));
-    }
+  foreach (const DeviceMonitor::USBDevice &device, DeviceMonitor::usbDevices(vid, pid)) {
+    logDebug() << "Found device on bus=" << int(device.bus) << ", device=" << int(device.address)
+               << " matching " << QString::number(vid, 16) << ":"
+               << QString::number(pid, 16) << ".";
+    res.append(HIDevice::Descriptor(
+                 USBDeviceInfo(USBDeviceInfo::Class::HID, vid, pid), device.bus, device.address));
   }
 
-  libusb_free_device_list(lst, 1);
   return res;
 }
 
@@ -163,13 +147,20 @@ HIDevice::close() {
     _transfer = nullptr;
   }
 
+  for (unsigned i=0; i<POOL_SIZE; i++) {
+    if (nullptr != _pool[i].transfer) {
+      libusb_free_transfer(_pool[i].transfer);
+      _pool[i].transfer = nullptr;
+    }
+  }
+
   if (nullptr != _dev) {
     libusb_release_interface(_dev, HID_INTERFACE);
     libusb_close(_dev);
     _dev = nullptr;
   }
 
-  libusb_exit(_ctx);
+  USBContext::release();
   _ctx = nullptr;
 }
 
@@ -189,15 +180,120 @@ HIDevice::hid_send_recv(const unsigned char *data, unsigned nbytes,
     memcpy(buf+4, data, nbytes);
   nbytes += 4;
 
+  if (_recorder)
+    _recorder->record(SessionRecorder::Direction::Request, (const char *)buf, sizeof(buf));
   reply_len = write_read(buf, sizeof(buf), reply, sizeof(reply));
   if (reply_len < 0) {
     err.take(_cbError);
     return false;
   }
+  if (_recorder)
+    _recorder->record(SessionRecorder::Direction::Response, (const char *)reply, reply_len);
 
-  if (reply_len != sizeof(reply)) {
-    errMsg(err) << "Short read: " << reply_len
-                << " bytes instead of " << (int)sizeof(reply) << "!";
+  return check_reply(reply, reply_len, rdata, rlength, err);
+}
+
+bool
+HIDevice::hid_send_recv_batch(const unsigned char *data, unsigned nbytes, unsigned n,
+                              unsigned char *rdata, unsigned rlength, const ErrorStack &err)
+{
+  unsigned char buf[42];
+
+  if ((_pipelineDepth < 2) || (n < 2)) {
+    for (unsigned i=0; i<n; i++) {
+      if (! hid_send_recv(data+i*nbytes, nbytes, rdata+i*rlength, rlength, err))
+        return false;
+    }
+    return true;
+  }
+
+  unsigned sent = 0, done = 0;
+  while (done < n) {
+    // Keep pipeline filled
+    while ((sent < n) && ((sent-done) < _pipelineDepth)) {
+      TransferSlot &slot = _pool[sent % POOL_SIZE];
+      if (nullptr == slot.transfer)
+        slot.transfer = libusb_alloc_transfer(0);
+      libusb_fill_interrupt_transfer(
+            slot.transfer, _dev, LIBUSB_RECIPIENT_INTERFACE | LIBUSB_ENDPOINT_IN,
+            slot.buffer, sizeof(slot.buffer), pool_callback, &slot, _timing.timeout());
+      slot.done.reset();
+      slot.error = ErrorStack();
+      int result = libusb_submit_transfer(slot.transfer);
+      if (result < 0) {
+        cancel_pool(done, sent);
+        errMsg(err) << "Error " << result << " submitting interrupt transfer: "
+                    << libusb_strerror((enum libusb_error) result) << ".";
+        return false;
+      }
+
+      memset(buf, 0, sizeof(buf));
+      buf[0] = 1;
+      buf[1] = 0;
+      buf[2] = nbytes;
+      buf[3] = nbytes >> 8;
+      if (nbytes > 0)
+        memcpy(buf+4, data+sent*nbytes, nbytes);
+      sent++;
+      if (_recorder)
+        _recorder->record(SessionRecorder::Direction::Request, (const char *)buf, sizeof(buf));
+
+      result = libusb_control_transfer(
+            _dev, LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE|LIBUSB_ENDPOINT_OUT,
+            0x09/*HID Set_Report*/, (2/*HID output*/ << 8) | 0,
+            HID_INTERFACE, buf, sizeof(buf), _timing.maxTimeout());
+      if (result < 0) {
+        cancel_pool(done, sent);
+        errMsg(err) << "Error " << result << " transmitting data via control transfer: "
+                    << libusb_strerror((enum libusb_error) result) << ".";
+        return false;
+      }
+    }
+
+    // Wait for the oldest outstanding request, completed by the event thread
+    TransferSlot &slot = _pool[done % POOL_SIZE];
+    int result = slot.done.wait();
+
+    if (LIBUSB_ERROR_TIMEOUT == result) {
+      // Device does not keep up with pipelined requests -> continue in lock-step
+      logWarn() << "HID (libusb): Timeout in pipelined transfer. Fall back to lock-step transfer.";
+      cancel_pool(done+1, sent);
+      _pipelineDepth = 1;
+      return hid_send_recv_batch(data+done*nbytes, nbytes, n-done, rdata+done*rlength, rlength, err);
+    } else if (0 > result) {
+      cancel_pool(done+1, sent);
+      err.take(slot.error);
+      return false;
+    }
+
+    if (_recorder)
+      _recorder->record(SessionRecorder::Direction::Response, (const char *)slot.buffer, result);
+    if (! check_reply(slot.buffer, result, rdata+done*rlength, rlength, err)) {
+      cancel_pool(done+1, sent);
+      return false;
+    }
+    done++;
+  }
+
+  return true;
+}
+
+unsigned
+HIDevice::pipelineDepth() const {
+  return _pipelineDepth;
+}
+
+void
+HIDevice::setPipelineDepth(unsigned depth) {
+  _pipelineDepth = std::max(1U, std::min(unsigned(POOL_SIZE), depth));
+}
+
+bool
+HIDevice::check_reply(const unsigned char *reply, int length, unsigned char *rdata, unsigned rlength,
+                      const ErrorStack &err)
+{
+  if (42 != length) {
+    errMsg(err) << "Short read: " << length << " bytes instead of 42!";
     return false;
   }
   if (reply[0] != 3 || reply[1] != 0 || reply[3] != 0) {
@@ -214,6 +310,17 @@ HIDevice::hid_send_recv(const unsigned char *data, unsigned nbytes,
   return true;
 }
 
+void
+HIDevice::cancel_pool(unsigned first, unsigned last) {
+  for (unsigned i=first; i<last; i++) {
+    if (! _pool[i % POOL_SIZE].done.isComplete())
+      libusb_cancel_transfer(_pool[i % POOL_SIZE].transfer);
+  }
+  // Wait for the cancelled transfers to complete
+  for (unsigned i=first; i<last; i++)
+    _pool[i % POOL_SIZE].done.wait();
+}
+
 
 int
 HIDevice::write_read(const unsigned char *data, unsigned length,
@@ -230,15 +337,19 @@ HIDevice::write_read(const unsigned char *data, unsigned length,
         reply, rlength, read_callback, this, TIMEOUT_MSEC);
 
   size_t nretry = 0;
+  QElapsedTimer timer;
 again:
-  _nbytes_received = 0;
+  _received.reset();
+  // Back off exponentially on repeated timeouts.
+  _transfer->timeout = _timing.timeout(nretry);
+  timer.start();
   libusb_submit_transfer(_transfer);
 
   int result = libusb_control_transfer(
         _dev,
         LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE|LIBUSB_ENDPOINT_OUT,
         0x09/*HID Set_Report*/, (2/*HID output*/ << 8) | 0,
-        HID_INTERFACE, (unsigned char*)data, length, TIMEOUT_MSEC);
+        HID_INTERFACE, (unsigned char*)data, length, _timing.maxTimeout());
 
   if (result < 0) {
     err.take(_cbError);
@@ -248,33 +359,21 @@ again:
     return -1;
   }
 
-  while (_nbytes_received == 0) {
-    result = libusb_handle_events(_ctx);
-    if (result < 0) {
-      /* Break out of this loop only on fatal error.*/
-      if (result != LIBUSB_ERROR_BUSY &&
-          result != LIBUSB_ERROR_TIMEOUT &&
-          result != LIBUSB_ERROR_OVERFLOW &&
-          result != LIBUSB_ERROR_INTERRUPTED)
-      {
-        err.take(_cbError);
-        errMsg(err) << "Error " <<result << " receiving data via interrupt transfer: "
-                    << libusb_strerror((enum libusb_error) result) << ".";
-        return result;
-      }
-    }
-  }
+  // Wait for the response, completed by the event thread
+  int nbytes_received = _received.wait();
 
-  if ((_nbytes_received == LIBUSB_ERROR_TIMEOUT) && (nretry < MAX_RETRY)) {
+  if ((nbytes_received == LIBUSB_ERROR_TIMEOUT) && (nretry < MAX_RETRY)) {
     if (0 == nretry)
       logDebug() << "HID (libusb): timeout. Retry...";
     nretry++;
     goto again;
   } else if (nretry >= MAX_RETRY) {
     logError() << "HID (libusb): Retry limit of " << MAX_RETRY << " exceeded.";
+  } else if ((0 < nbytes_received) && (0 == nretry)) {
+    _timing.addRoundTrip(timer.nsecsElapsed()/1000);
   }
 
-  return _nbytes_received;
+  return nbytes_received;
 }
 
 
@@ -286,27 +385,60 @@ HIDevice::read_callback(struct libusb_transfer *t)
   switch (t->status) {
   case LIBUSB_TRANSFER_COMPLETED:
     memcpy(self->_receive_buf, t->buffer, t->actual_length);
-    self->_nbytes_received = t->actual_length;
+    self->_received.complete(t->actual_length);
     break;
 
   case LIBUSB_TRANSFER_CANCELLED:
-    self->_nbytes_received = LIBUSB_ERROR_INTERRUPTED;
     errMsg(self->_cbError) << libusb_error_name(LIBUSB_ERROR_INTERRUPTED);
+    self->_received.complete(LIBUSB_ERROR_INTERRUPTED);
     break;
 
   case LIBUSB_TRANSFER_NO_DEVICE:
-    self->_nbytes_received = LIBUSB_ERROR_NO_DEVICE;
     errMsg(self->_cbError) << libusb_error_name(LIBUSB_ERROR_NO_DEVICE);
+    self->_received.complete(LIBUSB_ERROR_NO_DEVICE);
     break;
 
   case LIBUSB_TRANSFER_TIMED_OUT:
-    self->_nbytes_received = LIBUSB_ERROR_TIMEOUT;
     errMsg(self->_cbError) << libusb_error_name(LIBUSB_ERROR_TIMEOUT);
+    self->_received.complete(LIBUSB_ERROR_TIMEOUT);
     break;
 
   default:
-    self->_nbytes_received = LIBUSB_ERROR_IO;
     errMsg(self->_cbError) << libusb_error_name(LIBUSB_ERROR_IO);
+    self->_received.complete(LIBUSB_ERROR_IO);
+    break;
+  }
+}
+
+void
+HIDevice::pool_callback(struct libusb_transfer *t)
+{
+  TransferSlot *slot = (TransferSlot *)t->user_data;
+
+  switch (t->status) {
+  case LIBUSB_TRANSFER_COMPLETED:
+    // A zero-length report is not expected, mark it as an IO error to not block the pipeline
+    slot->done.complete((t->actual_length > 0) ? t->actual_length : LIBUSB_ERROR_IO);
+    break;
+
+  case LIBUSB_TRANSFER_CANCELLED:
+    errMsg(slot->error) << libusb_error_name(LIBUSB_ERROR_INTERRUPTED);
+    slot->done.complete(LIBUSB_ERROR_INTERRUPTED);
+    break;
+
+  case LIBUSB_TRANSFER_NO_DEVICE:
+    errMsg(slot->error) << libusb_error_name(LIBUSB_ERROR_NO_DEVICE);
+    slot->done.complete(LIBUSB_ERROR_NO_DEVICE);
+    break;
+
+  case LIBUSB_TRANSFER_TIMED_OUT:
+    errMsg(slot->error) << libusb_error_name(LIBUSB_ERROR_TIMEOUT);
+    slot->done.complete(LIBUSB_ERROR_TIMEOUT);
+    break;
+
+  default:
+    errMsg(slot->error) << libusb_error_name(LIBUSB_ERROR_IO);
+    slot->done.complete(LIBUSB_ERROR_IO);
     break;
   }
 }
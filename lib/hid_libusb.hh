@@ -5,6 +5,10 @@
 #include <libusb.h>
 #include "errorstack.hh"
 #include "radiointerface.hh"
+#include "timingpolicy.hh"
+#include "usbcontext.hh"
+
+class SessionRecorder;
 
 /** Implements the HID radio interface using libusb.
  * @ingroup rif */
@@ -38,6 +42,24 @@ public:
    * @param err Passes an error stack to put error messages on. */
   bool hid_send_recv(const unsigned char *data, unsigned nbytes,
                      unsigned char *rdata, unsigned rlength, const ErrorStack &err=ErrorStack());
+  /** Sends a batch of @c n commands of size @c nbytes each to the device and stores the responses
+   * of size @c rlength each in @c rdata. Up to @c pipelineDepth() requests are kept outstanding
+   * using a pool of pre-allocated transfers. On a timeout, the remaining commands are sent in
+   * lock-step using @c hid_send_recv and pipelining gets disabled for this device.
+   * @param data Pointer to the @c n commands to send.
+   * @param nbytes The size of each command.
+   * @param n The number of commands.
+   * @param rdata Pointer to the receive buffer, must hold @c n responses.
+   * @param rlength Size of each response.
+   * @param err Passes an error stack to put error messages on. */
+  bool hid_send_recv_batch(const unsigned char *data, unsigned nbytes, unsigned n,
+                           unsigned char *rdata, unsigned rlength, const ErrorStack &err=ErrorStack());
+
+  /** Returns the number of requests kept outstanding by @c hid_send_recv_batch. */
+  unsigned pipelineDepth() const;
+  /** Sets the number of requests kept outstanding by @c hid_send_recv_batch. The depth is limited
+   * to the size of the transfer pool. A depth of 1 is equivalent to a lock-step transfer. */
+  void setPipelineDepth(unsigned depth);
 
   /** Close connection to device. */
 	void close();
@@ -52,9 +74,32 @@ protected:
                  unsigned char *reply, unsigned rlength, const ErrorStack &err=ErrorStack());
   /** Callback for response data. */
   static void read_callback(struct libusb_transfer *t);
+  /** Callback for response data of pooled transfers. */
+  static void pool_callback(struct libusb_transfer *t);
+  /** Checks the reply to a command and copies the response into @c rdata. */
+  static bool check_reply(const unsigned char *reply, int length, unsigned char *rdata, unsigned rlength,
+                          const ErrorStack &err=ErrorStack());
+  /** Cancels all outstanding pooled transfers in the range [@c first, @c last). */
+  void cancel_pool(unsigned first, unsigned last);
+
+protected:
+  /** Number of pre-allocated transfers. */
+  static const unsigned POOL_SIZE = 8;
+
+  /** A pre-allocated transfer of the pool. */
+  struct TransferSlot {
+    /** The transfer descriptor. */
+    struct libusb_transfer *transfer;
+    /** Receive buffer. */
+    unsigned char buffer[42];
+    /** Completes with the number of bytes received or a negative libusb error. */
+    USBContext::Completion done;
+    /** Internal used error stack for the static callback function. */
+    ErrorStack error;
+  };
 
 protected:
-  /** libusb context. */
+  /** The shared libusb context. */
   libusb_context *_ctx;
   /** libusb device. */
   libusb_device_handle *_dev;
@@ -62,10 +107,20 @@ protected:
 	struct libusb_transfer *_transfer;
 	/** Receive buffer. */
 	unsigned char _receive_buf[42];
-	/** Receive result. */
-	volatile int _nbytes_received;
+	/** Completes with the number of bytes received or a negative libusb error. */
+	USBContext::Completion _received;
   /** Internal used error stack for the static callback function. */
   ErrorStack _cbError;
+  /** The pool of transfers used for pipelined requests. The slots are used as a ring in the order
+   * of submission. The callbacks are called from the shared event thread and signal the
+   * completion of each slot. */
+  TransferSlot _pool[POOL_SIZE];
+  /** Number of requests kept outstanding. */
+  unsigned _pipelineDepth;
+  /** Derives the receive timeout from the observed round-trip times. */
+  TimingPolicy _timing;
+  /** Records the session, if enabled. */
+  SessionRecorder *_recorder;
 };
 
 #endif // HID_MACOS_HH
@@ -6,6 +6,10 @@
 #include <string.h>
 #include <unistd.h>
 #include <logger.hh>
+#include "sessionrecorder.hh"
+#include <QElapsedTimer>
+
+#define TIMEOUT_MSEC 100            // default receive timeout
 
 
 /* ********************************************************************************************* *
@@ -21,7 +25,7 @@ HIDevice::Descriptor::Descriptor(const USBDeviceInfo &info, uint32_t locationId,
  * Implementation of HIDevice
  * ********************************************************************************************* */
 HIDevice::HIDevice(const USBDeviceDescriptor &desc, const ErrorStack &err, QObject *parent)
-  : QObject(parent), _dev(nullptr)
+  : QObject(parent), _dev(nullptr), _timing(TIMEOUT_MSEC), _recorder(nullptr)
 {
   // Create the USB HID Manager.
   _HIDManager = IOHIDManagerCreate(kCFAllocatorDefault,
@@ -59,8 +63,10 @@ HIDevice::HIDevice(const USBDeviceDescriptor &desc, const ErrorStack &err, QObje
   // Run loop until device found.
   for (int k=0; k<4; k++) {
     CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0, 0);
-    if (_dev)
+    if (_dev) {
+      _recorder = SessionRecorder::create(desc);
       return;
+    }
     usleep(10000);
   }
 
@@ -78,6 +84,7 @@ HIDevice::~HIDevice() {
     IOHIDManagerUnscheduleFromRunLoop(_HIDManager, CFRunLoopGetMain(), kCFRunLoopDefaultMode);
     IOHIDManagerClose(_HIDManager, kIOHIDOptionsTypeNone);
   }
+  delete _recorder;
 }
 
 QList<USBDeviceDescriptor>
@@ -183,8 +190,12 @@ HIDevice::hid_send_recv(const unsigned char *data, unsigned nbytes,
   memset(_receive_buf, 0, sizeof(_receive_buf));
 
   uint retrycount = 0;
+  QElapsedTimer timer;
 again:
+  timer.start();
   // Write to HID device.
+  if (_recorder)
+    _recorder->record(SessionRecorder::Direction::Request, (const char *)buf, sizeof(buf));
   result = IOHIDDeviceSetReport(_dev, kIOHIDReportTypeOutput, 0, buf, sizeof(buf));
   if (result != kIOReturnSuccess) {
     errMsg(err) << "HID output error: " << result << "!";
@@ -196,7 +207,8 @@ again:
   for (k = 0; _nbytes_received <= 0; k++) {
     usleep(100);
     CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0, 0);
-    if (k >= 1000) {
+    // Back off exponentially on repeated timeouts.
+    if (timer.elapsed() >= _timing.timeout(retrycount)) {
       retrycount++;
       if (retrycount<100)
         goto again;
@@ -204,7 +216,11 @@ again:
       return false;
     }
   }
+  if (0 == retrycount)
+    _timing.addRoundTrip(timer.nsecsElapsed()/1000);
   usleep(100);
+  if (_recorder)
+    _recorder->record(SessionRecorder::Direction::Response, (const char *)_receive_buf, _nbytes_received);
 
   if (_nbytes_received != sizeof(_receive_buf)) {
     errMsg(err) << "Short read: " << _nbytes_received << " bytes instead of "
@@ -229,6 +245,27 @@ again:
   return true;
 }
 
+bool
+HIDevice::hid_send_recv_batch(const unsigned char *data, unsigned nbytes, unsigned n,
+                              unsigned char *rdata, unsigned rlength, const ErrorStack &err)
+{
+  for (unsigned i=0; i<n; i++) {
+    if (! hid_send_recv(data+i*nbytes, nbytes, rdata+i*rlength, rlength, err))
+      return false;
+  }
+  return true;
+}
+
+unsigned
+HIDevice::pipelineDepth() const {
+  return 1;
+}
+
+void
+HIDevice::setPipelineDepth(unsigned depth) {
+  Q_UNUSED(depth);
+}
+
 //
 // Callback: data is received from the HID device
 //
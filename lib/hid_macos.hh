@@ -5,6 +5,9 @@
 #include <IOKit/hid/IOHIDManager.h>
 #include "errorstack.hh"
 #include "radiointerface.hh"
+#include "timingpolicy.hh"
+
+class SessionRecorder;
 
 /** Implements the HID radio interface MacOS X API.
  * @ingroup rif */
@@ -39,6 +42,21 @@ public:
 	bool hid_send_recv(const unsigned char *data, unsigned nbytes,
                      unsigned char *rdata, unsigned rlength,
                      const ErrorStack &err=ErrorStack());
+  /** Sends a batch of @c n commands of size @c nbytes each to the device and stores the responses
+   * of size @c rlength each in @c rdata. This implementation sends the commands in lock-step.
+   * @param data Pointer to the @c n commands to send.
+   * @param nbytes The size of each command.
+   * @param n The number of commands.
+   * @param rdata Pointer to the receive buffer, must hold @c n responses.
+   * @param rlength Size of each response.
+   * @param err The stack to put error messages on. */
+  bool hid_send_recv_batch(const unsigned char *data, unsigned nbytes, unsigned n,
+                           unsigned char *rdata, unsigned rlength, const ErrorStack &err=ErrorStack());
+
+  /** Returns the number of requests kept outstanding by @c hid_send_recv_batch. Always 1. */
+  unsigned pipelineDepth() const;
+  /** Sets the number of requests kept outstanding. Ignored by this implementation. */
+  void setPipelineDepth(unsigned depth);
 
   /** Close connection to device. */
 	void close();
@@ -67,6 +85,10 @@ protected:
 	unsigned char _receive_buf[42];
 	/** Receive result. */
 	volatile int _nbytes_received = 0;
+  /** Derives the receive timeout from the observed round-trip times. */
+  TimingPolicy _timing;
+  /** Records the session, if enabled. */
+  SessionRecorder *_recorder;
 };
 
 #endif // HID_MACOS_HH
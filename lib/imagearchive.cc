@@ -0,0 +1,343 @@
+#include "imagearchive.hh"
+#include "logger.hh"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QStandardPaths>
+#include <QRegularExpression>
+#include <QCryptographicHash>
+#include <algorithm>
+
+/** Version of the manifest format, increment on every incompatible change. */
+#define MANIFEST_VERSION 1
+
+
+/* ********************************************************************************************* *
+ * Implementation of ImageArchive
+ * ********************************************************************************************* */
+ImageArchive::ImageArchive(const QString &directory)
+  : _directory(directory)
+{
+  if (_directory.isEmpty())
+    _directory = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+        .filePath("archive");
+}
+
+const QString &
+ImageArchive::directory() const {
+  return _directory;
+}
+
+QString
+ImageArchive::manifestFilename(const QString &name) const {
+  return QDir(_directory).filePath("manifests/" + name + ".json");
+}
+
+QString
+ImageArchive::chunkFilename(const QByteArray &hash) const {
+  return QDir(_directory).filePath("chunks/" + QString::fromLatin1(hash.left(2)) + "/"
+                                   + QString::fromLatin1(hash));
+}
+
+bool
+ImageArchive::contains(const QString &name) const {
+  return QFileInfo::exists(manifestFilename(name));
+}
+
+QStringList
+ImageArchive::names() const {
+  QStringList names;
+  QDir manifests(QDir(_directory).filePath("manifests"));
+  foreach (const QFileInfo &info, manifests.entryInfoList({"*.json"}, QDir::Files, QDir::Name))
+    names.append(info.completeBaseName());
+  return names;
+}
+
+bool
+ImageArchive::entry(const QString &name, Entry &entry, const ErrorStack &err) const {
+  QJsonObject manifest;
+  if (! readManifest(name, manifest, err))
+    return false;
+
+  entry.name = name;
+  entry.created = QDateTime::fromString(manifest.value("created").toString(), Qt::ISODate);
+  entry.memSize = 0; entry.chunks = 0;
+  foreach (const QJsonValue &image, manifest.value("images").toArray()) {
+    foreach (const QJsonValue &element, image.toObject().value("elements").toArray()) {
+      entry.memSize += quint64(element.toObject().value("size").toDouble());
+      entry.chunks += element.toObject().value("chunks").toArray().size();
+    }
+  }
+  return true;
+}
+
+bool
+ImageArchive::store(const QString &name, const DFUFile &file, const ErrorStack &err, unsigned *newChunks) {
+  static const QRegularExpression validName("^[A-Za-z0-9_\\-][A-Za-z0-9_.\\-]*$");
+  if (! validName.match(name).hasMatch()) {
+    errMsg(err) << "Invalid archive name '" << name
+                << "': Use letters, digits, '_', '-' and '.' only.";
+    return false;
+  }
+  if (contains(name)) {
+    errMsg(err) << "Cannot archive '" << name << "': Name exists already.";
+    return false;
+  }
+  if (! QDir().mkpath(QDir(_directory).filePath("manifests"))) {
+    errMsg(err) << "Cannot create archive directory '" << _directory << "'.";
+    return false;
+  }
+
+  // Store chunks first, the file is only archived once its manifest exists
+  unsigned written = 0;
+  QJsonArray images;
+  for (int i=0; i<file.numImages(); i++) {
+    const DFUFile::Image &image = file.image(i);
+    QJsonArray elements;
+    for (int j=0; j<image.numElements(); j++) {
+      const DFUFile::Element &element = image.element(j);
+      const QByteArray &data = element.data();
+      QJsonArray chunks;
+      for (uint32_t o=0; o<uint32_t(data.size()); o+=CHUNK_SIZE) {
+        bool isNew = false;
+        uint32_t size = std::min(uint32_t(CHUNK_SIZE), uint32_t(data.size())-o);
+        QByteArray hash = writeChunk(data.constData()+o, size, isNew, err);
+        if (hash.isEmpty()) {
+          errMsg(err) << "Cannot archive '" << name << "'.";
+          return false;
+        }
+        chunks.append(QString::fromLatin1(hash));
+        if (isNew)
+          written++;
+      }
+      elements.append(QJsonObject{{"address", double(element.address())},
+                                  {"size", double(data.size())}, {"chunks", chunks}});
+    }
+    images.append(QJsonObject{{"name", image.name()}, {"alternate", image.alternateSettings()},
+                              {"elements", elements}});
+  }
+
+  QJsonObject manifest{
+    {"version", MANIFEST_VERSION},
+    {"created", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+    {"images", images}};
+  QSaveFile out(manifestFilename(name));
+  if (! out.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot write manifest '" << out.fileName() << "': " << out.errorString();
+    return false;
+  }
+  out.write(QJsonDocument(manifest).toJson(QJsonDocument::Compact));
+  if (! out.commit()) {
+    errMsg(err) << "Cannot write manifest '" << out.fileName() << "': " << out.errorString();
+    return false;
+  }
+
+  logDebug() << "Archived '" << name << "' with " << written << " new chunks.";
+  if (newChunks)
+    *newChunks = written;
+  return true;
+}
+
+bool
+ImageArchive::load(const QString &name, DFUFile &file, const ErrorStack &err) const {
+  QJsonObject manifest;
+  if (! readManifest(name, manifest, err))
+    return false;
+
+  foreach (const QJsonValue &imageValue, manifest.value("images").toArray()) {
+    QJsonObject imageObj = imageValue.toObject();
+    file.addImage(imageObj.value("name").toString(), imageObj.value("alternate").toInt());
+    DFUFile::Image &image = file.image(file.numImages()-1);
+    QJsonArray elements = imageObj.value("elements").toArray();
+    image.reserve(elements.size());
+    foreach (const QJsonValue &elementValue, elements) {
+      QJsonObject elementObj = elementValue.toObject();
+      uint32_t size = elementObj.value("size").toDouble();
+      QByteArray data, chunk;
+      data.reserve(size);
+      foreach (const QJsonValue &hash, elementObj.value("chunks").toArray()) {
+        if (! readChunk(hash.toString().toLatin1(), chunk, err)) {
+          errMsg(err) << "Cannot load archived '" << name << "'.";
+          return false;
+        }
+        data.append(chunk);
+      }
+      if (uint32_t(data.size()) != size) {
+        errMsg(err) << "Cannot load archived '" << name << "': Element size mismatch.";
+        return false;
+      }
+      DFUFile::Element element;
+      element.setAddress(elementObj.value("address").toDouble());
+      element.data() = data;
+      image.addElement(std::move(element));
+    }
+  }
+
+  return true;
+}
+
+bool
+ImageArchive::extract(const QString &name, const QString &filename, const ErrorStack &err) const {
+  QJsonObject manifest;
+  if (! readManifest(name, manifest, err))
+    return false;
+
+  // The stream writer requires the elements in ascending order, otherwise load the file first
+  foreach (const QJsonValue &image, manifest.value("images").toArray()) {
+    double last = -1;
+    foreach (const QJsonValue &element, image.toObject().value("elements").toArray()) {
+      if (element.toObject().value("address").toDouble() < last) {
+        DFUFile file;
+        return load(name, file, err) && file.write(filename, err);
+      }
+      last = element.toObject().value("address").toDouble() + element.toObject().value("size").toDouble();
+    }
+  }
+
+  DFUStreamWriter writer;
+  if (! writer.open(filename, err))
+    return false;
+  QByteArray chunk;
+  foreach (const QJsonValue &imageValue, manifest.value("images").toArray()) {
+    QJsonObject imageObj = imageValue.toObject();
+    if (! writer.beginImage(imageObj.value("name").toString(), imageObj.value("alternate").toInt(), err))
+      return false;
+    foreach (const QJsonValue &elementValue, imageObj.value("elements").toArray()) {
+      QJsonObject elementObj = elementValue.toObject();
+      if (! writer.beginElement(elementObj.value("address").toDouble(), err))
+        return false;
+      foreach (const QJsonValue &hash, elementObj.value("chunks").toArray()) {
+        if ((! readChunk(hash.toString().toLatin1(), chunk, err)) || (! writer.write(chunk, err))) {
+          errMsg(err) << "Cannot extract archived '" << name << "'.";
+          return false;
+        }
+      }
+      if (! writer.endElement(err))
+        return false;
+    }
+    if (! writer.endImage(err))
+      return false;
+  }
+  return writer.close(err);
+}
+
+bool
+ImageArchive::remove(const QString &name, const ErrorStack &err) {
+  if (! contains(name)) {
+    errMsg(err) << "Cannot remove archived '" << name << "': No such file.";
+    return false;
+  }
+  if (! QFile::remove(manifestFilename(name))) {
+    errMsg(err) << "Cannot remove manifest '" << manifestFilename(name) << "'.";
+    return false;
+  }
+  return true;
+}
+
+bool
+ImageArchive::collectGarbage(const ErrorStack &err, unsigned *removed) {
+  QSet<QString> referenced;
+  foreach (const QString &name, names()) {
+    QJsonObject manifest;
+    // Never delete chunks of a file, that cannot be read
+    if (! readManifest(name, manifest, err)) {
+      errMsg(err) << "Cannot collect garbage.";
+      return false;
+    }
+    foreach (const QJsonValue &image, manifest.value("images").toArray())
+      foreach (const QJsonValue &element, image.toObject().value("elements").toArray())
+        foreach (const QJsonValue &hash, element.toObject().value("chunks").toArray())
+          referenced.insert(hash.toString());
+  }
+
+  unsigned count = 0;
+  QDirIterator chunks(QDir(_directory).filePath("chunks"), QDir::Files, QDirIterator::Subdirectories);
+  while (chunks.hasNext()) {
+    QString path = chunks.next();
+    if (referenced.contains(chunks.fileName()))
+      continue;
+    if (! QFile::remove(path)) {
+      errMsg(err) << "Cannot remove chunk '" << path << "'.";
+      return false;
+    }
+    count++;
+  }
+
+  logDebug() << "Removed " << count << " unreferenced chunks from archive.";
+  if (removed)
+    *removed = count;
+  return true;
+}
+
+bool
+ImageArchive::readManifest(const QString &name, QJsonObject &manifest, const ErrorStack &err) const {
+  QFile file(manifestFilename(name));
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open manifest '" << file.fileName() << "': " << file.errorString();
+    return false;
+  }
+  QJsonParseError error;
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+  if ((QJsonParseError::NoError != error.error) || (! doc.isObject())) {
+    errMsg(err) << "Cannot parse manifest '" << file.fileName() << "': " << error.errorString();
+    return false;
+  }
+  manifest = doc.object();
+  if (MANIFEST_VERSION != manifest.value("version").toInt()) {
+    errMsg(err) << "Cannot read manifest '" << file.fileName() << "': Unknown version "
+                << manifest.value("version").toInt() << ".";
+    return false;
+  }
+  return true;
+}
+
+QByteArray
+ImageArchive::writeChunk(const char *data, uint32_t size, bool &written, const ErrorStack &err) {
+  QByteArray content = QByteArray::fromRawData(data, size);
+  QByteArray hash = QCryptographicHash::hash(content, QCryptographicHash::Sha256).toHex();
+  written = false;
+
+  QString path = chunkFilename(hash);
+  if (QFileInfo::exists(path))
+    return hash;
+
+  if (! QDir().mkpath(QFileInfo(path).absolutePath())) {
+    errMsg(err) << "Cannot create chunk directory '" << QFileInfo(path).absolutePath() << "'.";
+    return QByteArray();
+  }
+  QSaveFile file(path);
+  if (! file.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot write chunk '" << path << "': " << file.errorString();
+    return QByteArray();
+  }
+  file.write(qCompress(content));
+  if (! file.commit()) {
+    errMsg(err) << "Cannot write chunk '" << path << "': " << file.errorString();
+    return QByteArray();
+  }
+
+  written = true;
+  return hash;
+}
+
+bool
+ImageArchive::readChunk(const QByteArray &hash, QByteArray &data, const ErrorStack &err) const {
+  QFile file(chunkFilename(hash));
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open chunk '" << file.fileName() << "': " << file.errorString();
+    return false;
+  }
+  data = qUncompress(file.readAll());
+  if (hash != QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex()) {
+    errMsg(err) << "Chunk '" << file.fileName() << "' is corrupted.";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,96 @@
+#ifndef IMAGEARCHIVE_HH
+#define IMAGEARCHIVE_HH
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include "dfufile.hh"
+#include "errorstack.hh"
+
+class QJsonObject;
+
+/** Implements a persistent, deduplicating archive of binary codeplugs and call-sign DBs.
+ *
+ * Every archived @c DFUFile is described by a small manifest, listing its images and elements.
+ * The element data is split into chunks of @c CHUNK_SIZE bytes, starting at the element address.
+ * Each chunk is stored compressed and named after the SHA-256 hash of its content. Hence, chunks
+ * shared by several archived files (e.g., the unchanged parts of successive call-sign DBs or
+ * erased memory) are stored only once.
+ *
+ * The directory layout is
+ * @code
+ * ARCHIVE/manifests/NAME.json
+ * ARCHIVE/chunks/ab/abcdef0123...
+ * @endcode
+ *
+ * Archived files are retrieved either as a @c DFUFile (see @c load) or written as a DFU file
+ * (see @c extract), that can be read by @c DFUFile::read. Removing a file only removes its
+ * manifest, the chunks no longer referenced are deleted by @c collectGarbage.
+ *
+ * @ingroup util */
+class ImageArchive
+{
+public:
+  /** Size of the chunks, the element data is split into. */
+  static const uint32_t CHUNK_SIZE = 0x10000;
+
+  /** Summary of an archived file. */
+  struct Entry {
+    QString name;       ///< The name of the archived file.
+    QDateTime created;  ///< When the file was archived.
+    quint64 memSize;    ///< The memory size of all images.
+    unsigned chunks;    ///< The number of chunks referenced (including duplicates).
+  };
+
+public:
+  /** Constructs an archive located in the given directory. If no directory is given, the default
+   * data location of the application is used. */
+  explicit ImageArchive(const QString &directory=QString());
+
+  /** Returns the directory of the archive. */
+  const QString &directory() const;
+
+  /** Returns @c true if there is an archived file with the given name. */
+  bool contains(const QString &name) const;
+  /** Returns the names of all archived files in alphabetical order. */
+  QStringList names() const;
+  /** Returns a summary of the archived file with the given name.
+   * @returns @c false if there is no such file or the manifest cannot be read. */
+  bool entry(const QString &name, Entry &entry, const ErrorStack &err=ErrorStack()) const;
+
+  /** Archives the given file under the given name. Only chunks not archived yet are written.
+   * Names consist of letters, digits, '_', '-' and '.' only, archived files are never replaced.
+   * @param newChunks If given, the number of newly written chunks is stored there. */
+  bool store(const QString &name, const DFUFile &file, const ErrorStack &err=ErrorStack(),
+             unsigned *newChunks=nullptr);
+  /** Loads the archived file with the given name. */
+  bool load(const QString &name, DFUFile &file, const ErrorStack &err=ErrorStack()) const;
+  /** Writes the archived file with the given name as a DFU file. Unlike @c load, at most one
+   * chunk is held in memory at a time. */
+  bool extract(const QString &name, const QString &filename, const ErrorStack &err=ErrorStack()) const;
+  /** Removes the archived file with the given name. Its chunks are kept until the next
+   * @c collectGarbage. */
+  bool remove(const QString &name, const ErrorStack &err=ErrorStack());
+  /** Deletes all chunks not referenced by any archived file.
+   * @param removed If given, the number of deleted chunks is stored there. */
+  bool collectGarbage(const ErrorStack &err=ErrorStack(), unsigned *removed=nullptr);
+
+protected:
+  /** Returns the path of the manifest of the given name. */
+  QString manifestFilename(const QString &name) const;
+  /** Returns the path of the chunk with the given hash. */
+  QString chunkFilename(const QByteArray &hash) const;
+  /** Reads the manifest of the given name. */
+  bool readManifest(const QString &name, QJsonObject &manifest, const ErrorStack &err) const;
+  /** Stores the given chunk, if not present yet.
+   * @returns The hex-encoded hash of the chunk or an empty array on error. */
+  QByteArray writeChunk(const char *data, uint32_t size, bool &written, const ErrorStack &err);
+  /** Reads and verifies the chunk with the given hash. */
+  bool readChunk(const QByteArray &hash, QByteArray &data, const ErrorStack &err) const;
+
+protected:
+  /** The archive directory. */
+  QString _directory;
+};
+
+#endif // IMAGEARCHIVE_HH
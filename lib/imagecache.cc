@@ -0,0 +1,96 @@
+#include "imagecache.hh"
+#include "radiointerface.hh"
+#include "logger.hh"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QRegularExpression>
+
+
+/* ********************************************************************************************* *
+ * Implementation of ImageCache
+ * ********************************************************************************************* */
+ImageCache::ImageCache(const QString &directory)
+  : _directory(directory)
+{
+  if (_directory.isEmpty())
+    _directory = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+        .filePath("images");
+}
+
+const QString &
+ImageCache::directory() const {
+  return _directory;
+}
+
+QString
+ImageCache::filename(const QString &radio, const QString &id) const {
+  QString name = QString("%1-%2.dfu").arg(radio, id);
+  name.replace(QRegularExpression("[^A-Za-z0-9_.\\-]"), "_");
+  return QDir(_directory).filePath(name);
+}
+
+bool
+ImageCache::contains(const QString &radio, const QString &id) const {
+  return QFileInfo::exists(filename(radio, id));
+}
+
+bool
+ImageCache::load(const QString &radio, const QString &id, DFUFile &image, const ErrorStack &err) const {
+  QString path = filename(radio, id);
+  if (! QFileInfo::exists(path))
+    return false;
+  if (! image.read(path, err)) {
+    errMsg(err) << "Cannot read cached image '" << path << "'.";
+    return false;
+  }
+  logDebug() << "Loaded cached image from '" << path << "'.";
+  return true;
+}
+
+bool
+ImageCache::store(const QString &radio, const QString &id, DFUFile &image, const ErrorStack &err) const {
+  if (! QDir().mkpath(_directory)) {
+    errMsg(err) << "Cannot create image cache directory '" << _directory << "'.";
+    return false;
+  }
+  QString path = filename(radio, id);
+  if (! image.write(path, err)) {
+    errMsg(err) << "Cannot write cached image '" << path << "'.";
+    return false;
+  }
+  logDebug() << "Stored image in cache '" << path << "'.";
+  return true;
+}
+
+bool
+ImageCache::remove(const QString &radio, const QString &id) const {
+  return QFile::remove(filename(radio, id));
+}
+
+bool
+ImageCache::verify(RadioInterface *device, const DFUFile::Image &image, unsigned blockSize,
+                   unsigned samples, const ErrorStack &err)
+{
+  if ((nullptr == device) || (0 == image.numElements()))
+    return false;
+
+  QByteArray buffer(blockSize, 0);
+  unsigned step = std::max(1U, image.numElements()/std::max(1U, samples));
+  for (int i=0; i<image.numElements(); i+=step) {
+    const DFUFile::Element &el = image.element(i);
+    unsigned size = std::min(blockSize, el.memSize());
+    if (! device->read(0, el.address(), (uint8_t *)buffer.data(), size, err)) {
+      errMsg(err) << "Cannot verify cached image: Cannot read block at 0x"
+                  << QString::number(el.address(), 16) << ".";
+      return false;
+    }
+    if (0 != memcmp(buffer.constData(), el.data().constData(), size)) {
+      logDebug() << "Cached image differs from device at 0x" << QString::number(el.address(), 16) << ".";
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,55 @@
+#ifndef IMAGECACHE_HH
+#define IMAGECACHE_HH
+
+#include <QString>
+#include "dfufile.hh"
+#include "errorstack.hh"
+
+class RadioInterface;
+
+/** Implements a persistent local cache of the last known binary image of a radio.
+ *
+ * Whenever a codeplug gets written to a radio, the resulting binary image can be stored in this
+ * cache as a DFU file. The image is keyed by the radio name and a user-supplied identifier (e.g.,
+ * a serial number or asset tag). On the next upload to the same radio, the cached image can be
+ * used instead of reading the current codeplug from the device first. To detect whether the
+ * codeplug was changed on the device side, a sample of blocks gets read from the device and
+ * compared to the cached image (see @c verify).
+ *
+ * @ingroup util */
+class ImageCache
+{
+public:
+  /** Constructs a new image cache located in the given directory. If no directory is given, the
+   * default cache location of the application is used. */
+  explicit ImageCache(const QString &directory=QString());
+
+  /** Returns the directory of the cache. */
+  const QString &directory() const;
+  /** Returns the path of the cache file for the given radio name and identifier. */
+  QString filename(const QString &radio, const QString &id) const;
+
+  /** Returns @c true if there is a cached image for the given radio name and identifier. */
+  bool contains(const QString &radio, const QString &id) const;
+  /** Loads the cached image for the given radio name and identifier.
+   * @returns @c false if there is no such image or it cannot be read. */
+  bool load(const QString &radio, const QString &id, DFUFile &image, const ErrorStack &err=ErrorStack()) const;
+  /** Stores the given image for the radio name and identifier. */
+  bool store(const QString &radio, const QString &id, DFUFile &image, const ErrorStack &err=ErrorStack()) const;
+  /** Removes the cached image for the given radio name and identifier. */
+  bool remove(const QString &radio, const QString &id) const;
+
+public:
+  /** Verifies the given image against the device by reading a sample of blocks.
+   * The first block of up to @c samples elements (spread evenly over the image) is read from the
+   * device and compared to the image.
+   * @returns @c true if all sampled blocks match. */
+  static bool verify(RadioInterface *device, const DFUFile::Image &image, unsigned blockSize,
+                     unsigned samples=8, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** The cache directory. */
+  QString _directory;
+};
+
+#endif // IMAGECACHE_HH
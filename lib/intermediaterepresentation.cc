@@ -1,43 +1,65 @@
 #include "intermediaterepresentation.hh"
 #include "configobject.hh"
 #include "zone.hh"
+#include "config.hh"
 
 
 /* ********************************************************************************************* *
  * Implementation of ZoneSplitVisitor
  * ********************************************************************************************* */
 ZoneSplitVisitor::ZoneSplitVisitor()
-  : Visitor()
+  : Visitor({ZoneList::staticMetaObject})
 {
   // pass...
 }
 
 bool
-ZoneSplitVisitor::processItem(ConfigItem *item, const ErrorStack &err) {
-  // Skip non-zones
-  if (! item->is<Zone>())
-    return Visitor::processItem(item, err);
-  Zone *zone = item->as<Zone>();
-
-  // skip zones with empty B list
-  if (0 == zone->B()->count())
-    return Visitor::processItem(item, err);
-
-  // create new zone with B list as A list, clear B list of "old" zone
-  Zone *newZone = new Zone();
-  while (zone->B()->count()) {
-    newZone->A()->add(zone->B()->get(0));
-    zone->B()->take(zone->B()->get(0));
+ZoneSplitVisitor::isRequired(const Config *config) {
+  for (int i=0; i<config->zones()->count(); i++) {
+    if (config->zones()->zone(i)->B()->count())
+      return true;
+  }
+  return false;
+}
+
+bool
+ZoneSplitVisitor::processList(AbstractConfigObjectList *list, const ErrorStack &err) {
+  if (nullptr == qobject_cast<ZoneList *>(list))
+    return Visitor::processList(list, err);
+
+  // Collect the new order of zones, every split zone is followed by its B zone
+  QVector<ConfigObject *> order; order.reserve(2*list->count());
+  QVector<ConfigObject *> newZones;
+  for (int i=0; i<list->count(); i++) {
+    Zone *zone = list->get(i)->as<Zone>();
+    if (! Visitor::processItem(zone, err))
+      return false;
+    order.append(zone);
+
+    // skip zones with empty B list
+    if (0 == zone->B()->count())
+      continue;
+
+    // create new zone with B list as A list, clears B list of "old" zone
+    Zone *newZone = new Zone();
+    zone->B()->moveAll(newZone->A());
+
+    // set names
+    newZone->setName(QString("%1 B").arg(zone->name()));
+    zone->setName(QString("%1 A").arg(zone->name()));
+
+    order.append(newZone);
+    newZones.append(newZone);
   }
 
-  // set names
-  newZone->setName(QString("%1 B").arg(zone->name()));
-  zone->setName(QString("%1 A").arg(zone->name()));
+  if (newZones.isEmpty())
+    return true;
 
-  // add zone to list of zones
-  ConfigObjectList *lst = qobject_cast<ConfigObjectList*>(item->parent());
-  int idx = lst->indexOf(zone);
-  lst->add(newZone, idx+1);
+  // append new zones to list of zones and move them in place
+  list->beginUpdate();
+  list->addMany(newZones);
+  list->reorder(order);
+  list->endUpdate();
 
   return true;
 }
@@ -47,7 +69,7 @@ ZoneSplitVisitor::processItem(ConfigItem *item, const ErrorStack &err) {
  * Implementation of ZoneMergeVisitor
  * ********************************************************************************************* */
 ZoneMergeVisitor::ZoneMergeVisitor()
-  : Visitor(), _lastZone(nullptr), _mergedZones()
+  : Visitor({ZoneList::staticMetaObject})
 {
   // pass...
 }
@@ -60,49 +82,37 @@ ZoneMergeVisitor::processList(AbstractConfigObjectList *list, const ErrorStack &
   if (2 > list->count())
     return Visitor::processList(list, err);
 
-  _mergedZones.clear();
-  _lastZone = nullptr;
-
-  if (! processItem(list->get(0), err))
-    return false;
-  _lastZone = list->get(0)->as<Zone>();
-
-  for (int i=1; i<list->count(); i++) {
-    if (! processItem(list->get(i), err))
+  // Collect the new order of zones, merged zones are moved to the end
+  QVector<ConfigObject *> order; order.reserve(list->count());
+  QVector<ConfigObject *> mergedZones;
+  Zone *lastZone = nullptr;
+  for (int i=0; i<list->count(); i++) {
+    Zone *currentZone = list->get(i)->as<Zone>();
+    if (! Visitor::processItem(currentZone, err))
       return false;
-    _lastZone = list->get(i)->as<Zone>();
-  }
 
-  foreach(Zone *zone, _mergedZones) {
-    list->del(zone);
+    if (lastZone && lastZone->name().endsWith(" A") && (0 == lastZone->B()->count())
+        && currentZone->name().endsWith(" B") && (0 == currentZone->B()->count())) {
+      currentZone->A()->moveAll(lastZone->B());
+      lastZone->setName(lastZone->name().chopped(2));
+      mergedZones.append(currentZone);
+    } else {
+      order.append(currentZone);
+    }
+    lastZone = currentZone;
   }
-  _mergedZones.clear();
 
-  return true;
-}
+  if (mergedZones.isEmpty())
+    return true;
 
-bool
-ZoneMergeVisitor::processItem(ConfigItem *item, const ErrorStack &err) {
-  if (! item->is<Zone>())
-    return Visitor::processItem(item, err);
-  Zone *currentZone = item->as<Zone>();
+  // delete merged zones from the end of the list
+  list->beginUpdate();
+  list->reorder(order + mergedZones);
+  for (int i=mergedZones.size()-1; i>=0; i--)
+    list->del(mergedZones[i]);
+  list->endUpdate();
 
-  if ((! _lastZone) || (!_lastZone->name().endsWith(" A")) || (0 != _lastZone->B()->count()))
-    return Visitor::processItem(item, err);
-
-  if ((!currentZone->name().endsWith(" B")) || (0 != currentZone->B()->count()))
-    return Visitor::processItem(item, err);
-
-  while (currentZone->A()->count()) {
-    ConfigObject *ch = currentZone->A()->get(0);
-    _lastZone->B()->add(ch);
-    currentZone->A()->del(ch);
-  }
-
-  _lastZone->setName(_lastZone->name().chopped(2));
-  _mergedZones.append(currentZone);
-
-  return Visitor::processItem(item);
+  return true;
 }
 
 
@@ -110,14 +120,14 @@ ZoneMergeVisitor::processItem(ConfigItem *item, const ErrorStack &err) {
  * Implementation of ObjectFilterVisitor
  * ********************************************************************************************* */
 ObjectFilterVisitor::ObjectFilterVisitor(const std::initializer_list<QMetaObject> &types)
-  : Visitor(), _filter(types)
+  : Visitor(types), _filter(types)
 {
   // pass...
 }
 
 bool
 ObjectFilterVisitor::processProperty(ConfigItem *item, const QMetaProperty &prop, const ErrorStack &err) {
-  if (! propIsInstance<ConfigItem>(prop))
+  if (ConfigItem::PropertyKind::Item != item->propertyKind(prop))
     return Visitor::processProperty(item, prop, err);
 
   if (prop.read(item).isNull())
@@ -11,6 +11,7 @@
 #include <QList>
 
 class Zone;
+class Config;
 
 
 /** Simple visitor that splits Zones having A and B channels into two zones with A-lists only.
@@ -23,7 +24,11 @@ public:
   /** Constructor. */
   explicit ZoneSplitVisitor();
 
-  bool processItem(ConfigItem *item, const ErrorStack &err);
+  bool processList(AbstractConfigObjectList *list, const ErrorStack &err);
+
+  /** Returns @c true if the given config contains at least one zone with a non-empty B list,
+   * that is, if applying this visitor would change the config. */
+  static bool isRequired(const Config *config);
 };
 
 /** Simple visitor that merges zones. This is the reverse step of the @c ZoneSplitVisitor.
@@ -37,13 +42,6 @@ public:
   explicit ZoneMergeVisitor();
 
   bool processList(AbstractConfigObjectList *list, const ErrorStack &err);
-  bool processItem(ConfigItem *item, const ErrorStack &err);
-
-protected:
-  /** The last zone visited, @c nullptr if the first zone is processed. */
-  Zone *_lastZone;
-  /** Zones to be removed. */
-  QList<Zone *> _mergedZones;
 };
 
 
@@ -1,5 +1,31 @@
 #include "interval.hh"
-#include <QRegularExpression>
+
+/** Returns the character code of the given character. */
+static inline unsigned charCode(QChar c) { return c.unicode(); }
+/** Returns the character code of the given character. */
+static inline unsigned charCode(char c) { return static_cast<unsigned char>(c); }
+
+template <class Char>
+static inline bool isDigit(Char c) {
+  return (charCode(c) >= '0') && (charCode(c) <= '9');
+}
+
+template <class Char>
+static inline const Char *skipSpaces(const Char *ptr, const Char *end) {
+  while ((ptr != end) && ((' ' == charCode(*ptr)) || (('\t' <= charCode(*ptr)) && ('\r' >= charCode(*ptr)))))
+    ptr++;
+  return ptr;
+}
+
+/** Returns @c true if the given word starts at @c ptr. */
+template <class Char>
+static inline bool hasWord(const Char *ptr, const Char *end, const char *word) {
+  for (; *word; word++, ptr++) {
+    if ((ptr == end) || (charCode(*ptr) != static_cast<unsigned char>(*word)))
+      return false;
+  }
+  return true;
+}
 
 QString
 Interval::format(Format f) const {
@@ -22,23 +48,44 @@ Interval::format(Format f) const {
   return QString("%1 ms").arg(_duration);
 }
 
+template <class Char>
 bool
-Interval::parse(const QString &value) {
-  QRegularExpression ex(R"(\s*([0-9]+)\s*(min|s|ms|)\s*)");
-  QRegularExpressionMatch match = ex.match(value);
-  if (! match.isValid())
+Interval::parse(const Char *ptr, const Char *end) {
+  // Parses "<digits> [min|s|ms]", surrounded by optional white spaces.
+  ptr = skipSpaces(ptr, end);
+  if ((ptr == end) || (! isDigit(*ptr)))
     return false;
+  unsigned long long duration = 0;
+  for (; (ptr != end) && isDigit(*ptr); ptr++)
+    duration = 10*duration + (charCode(*ptr)-'0');
+  ptr = skipSpaces(ptr, end);
 
-  bool hasUnit = match.capturedLength(2);
-  QString unit = match.captured(2);
-  QString dur = match.captured(1);
+  unsigned long long factor = 1ULL;
+  if (hasWord(ptr, end, "min")) {
+    factor = 60000ULL; ptr += 3;
+  } else if (hasWord(ptr, end, "ms")) {
+    ptr += 2;
+  } else if (hasWord(ptr, end, "s")) {
+    factor = 1000ULL; ptr += 1;
+  }
+  if (skipSpaces(ptr, end) != end)
+    return false;
 
-  if (hasUnit && ("s"==unit))
-    _duration = dur.toULongLong()*1000ULL;
-  else if (hasUnit && ("min"==unit))
-    _duration = dur.toULongLong()*60000ULL;
-  else
-    _duration = dur.toULongLong();
+  _duration = duration*factor;
   return true;
 }
 
+bool
+Interval::parse(const QString &value) {
+  return parse(QStringView(value));
+}
+
+bool
+Interval::parse(QStringView value) {
+  return parse(value.data(), value.data()+value.size());
+}
+
+bool
+Interval::parse(const std::string &value) {
+  return parse(value.data(), value.data()+value.size());
+}
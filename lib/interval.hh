@@ -2,6 +2,8 @@
 #define INTERVAL_HH
 
 #include <QString>
+#include <QStringView>
+#include <string>
 #include <QMetaType>
 #include <yaml-cpp/yaml.h>
 
@@ -66,8 +68,17 @@ public:
 
   /** Format the frequency. */
   QString format(Format f=Format::Automatic) const;
-  /** Parses a frequency. */
+  /** Parses an interval. */
   bool parse(const QString &value);
+  /** Parses an interval. */
+  bool parse(QStringView value);
+  /** Parses an interval, e.g., directly from a YAML scalar. */
+  bool parse(const std::string &value);
+
+private:
+  /** Parses an interval from the given range of characters without any allocation. */
+  template <class Char>
+  bool parse(const Char *ptr, const Char *end);
 
 private:
   /** An interval duration in ms. */
@@ -91,7 +102,7 @@ namespace YAML
     static bool decode(const Node& node, Interval& rhs) {
       if (!node.IsScalar())
         return false;
-      return rhs.parse(QString::fromStdString(node.as<std::string>()));
+      return rhs.parse(node.Scalar());
     }
   };
 }
@@ -2,6 +2,7 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDateTime>
+#include <QThread>
 
 
 /* ********************************************************************************************* *
@@ -59,14 +60,20 @@ LogHandler::~LogHandler() {
   // pass...
 }
 
+LogMessage::Level
+LogHandler::minLevel() const {
+  return LogMessage::DEBUG;
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of Logger
  * ********************************************************************************************* */
 Logger *Logger::_instance = nullptr;
+std::atomic<int> Logger::_minLevel(int(LogMessage::FATAL)+1);
 
 Logger::Logger()
-  : QObject(nullptr), _handler()
+  : QObject(nullptr), _handler(), _lock()
 {
   // pass...
 }
@@ -77,6 +84,7 @@ Logger::~Logger() {
 
 void
 Logger::log(const LogMessage &msg) {
+  QMutexLocker locker(&_lock);
   foreach (LogHandler *handler, _handler) {
     handler->handle(msg);
   }
@@ -86,25 +94,46 @@ void
 Logger::addHandler(LogHandler *handler) {
   if (nullptr == handler)
     return;
+  QMutexLocker locker(&_lock);
   if (_handler.contains(handler))
     return;
   handler->setParent(this);
   _handler.append(handler);
   connect(handler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
+  recomputeMinLevel();
 }
 
 void
 Logger::remHandler(LogHandler *handler) {
+  QMutexLocker locker(&_lock);
   if (_handler.contains(handler)) {
     handler->setParent(nullptr);
     disconnect(handler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
   }
   _handler.removeAll(handler);
+  recomputeMinLevel();
+}
+
+void
+Logger::updateMinLevel() {
+  QMutexLocker locker(&_lock);
+  recomputeMinLevel();
+}
+
+void
+Logger::recomputeMinLevel() {
+  int level = int(LogMessage::FATAL)+1;
+  foreach (LogHandler *handler, _handler)
+    level = std::min(level, int(handler->minLevel()));
+  _minLevel.store(level, std::memory_order_relaxed);
 }
 
 void
 Logger::onHandlerDeleted(QObject *obj) {
-  _handler.removeAll(dynamic_cast<LogHandler*>(obj));
+  QMutexLocker locker(&_lock);
+  // The handler is already destroyed, hence do not call any method on it
+  _handler.removeAll(static_cast<LogHandler*>(obj));
+  recomputeMinLevel();
 }
 
 Logger &
@@ -133,6 +162,7 @@ StreamLogHandler::minLevel() const {
 void
 StreamLogHandler::setMinLevel(LogMessage::Level minLevel) {
   _minLevel = minLevel;
+  Logger::get().updateMinLevel();
 }
 
 void
@@ -217,6 +247,7 @@ FileLogHandler::minLevel() const {
 void
 FileLogHandler::setMinLevel(LogMessage::Level minLevel) {
   _minLevel = minLevel;
+  Logger::get().updateMinLevel();
 }
 
 void
@@ -227,16 +258,107 @@ FileLogHandler::handle(const LogMessage &message) {
   if (message.level() < _minLevel)
     return;
 
-  _stream << QDateTime::currentDateTime().toString(Qt::ISODateWithMs) << ": ";
+  _stream << format(message);
+  _stream.flush();
+}
+
+QString
+FileLogHandler::format(const LogMessage &message) {
+  QString line;
+  QTextStream stream(&line);
+  stream << QDateTime::currentDateTime().toString(Qt::ISODateWithMs) << ": ";
   switch (message.level()) {
-  case LogMessage::DEBUG:   _stream << "Debug "; break;
-  case LogMessage::INFO:    _stream << "Info "; break;
-  case LogMessage::WARNING: _stream << "Warning "; break;
-  case LogMessage::ERROR:   _stream << "ERROR "; break;
-  case LogMessage::FATAL:   _stream << "FATAL "; break;
+  case LogMessage::DEBUG:   stream << "Debug "; break;
+  case LogMessage::INFO:    stream << "Info "; break;
+  case LogMessage::WARNING: stream << "Warning "; break;
+  case LogMessage::ERROR:   stream << "ERROR "; break;
+  case LogMessage::FATAL:   stream << "FATAL "; break;
   }
   QFileInfo finfo(message.file());
-  _stream << "in " << finfo.dir().dirName() << "/" << finfo.fileName()
-          << "@" << message.line() << ": " << message.message() << "\n";
-  _stream.flush();
+  stream << "in " << finfo.dir().dirName() << "/" << finfo.fileName()
+         << "@" << message.line() << ": " << message.message() << "\n";
+  stream.flush();
+  return line;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of AsyncFileLogHandler
+ * ********************************************************************************************* */
+AsyncFileLogHandler::AsyncFileLogHandler(const QString &file, LogMessage::Level minLevel,
+                                         unsigned capacity, QObject *parent)
+  : FileLogHandler(file, minLevel, parent), _ring(std::max(1U, capacity)), _first(0), _count(0),
+    _dropped(0), _stop(false), _ringLock(), _notEmpty(), _notFull(), _writer(nullptr)
+{
+  if (! _file.isOpen())
+    return;
+  _writer = QThread::create([this]() { write(); });
+  _writer->start(QThread::LowPriority);
+}
+
+AsyncFileLogHandler::~AsyncFileLogHandler() {
+  if (nullptr == _writer)
+    return;
+  _ringLock.lock();
+  _stop = true;
+  _notEmpty.wakeAll();
+  _ringLock.unlock();
+  _writer->wait();
+  delete _writer;
+}
+
+void
+AsyncFileLogHandler::handle(const LogMessage &message) {
+  if ((nullptr == _writer) || (message.level() < _minLevel))
+    return;
+
+  QString line = format(message);
+
+  QMutexLocker locker(&_ringLock);
+  while (_count == _ring.size()) {
+    if (message.level() < LogMessage::WARNING) {
+      _dropped++;
+      return;
+    }
+    _notFull.wait(&_ringLock);
+  }
+  _ring[(_first + _count) % _ring.size()] = line;
+  _count++;
+  _notEmpty.wakeOne();
+}
+
+void
+AsyncFileLogHandler::write() {
+  QVector<QString> batch;
+  batch.reserve(_ring.size());
+  unsigned dropped = 0;
+  _ringLock.lock();
+  while (true) {
+    if ((0 == _count) && _stop)
+      break;
+    if (0 == _count) {
+      _notEmpty.wait(&_ringLock);
+      continue;
+    }
+
+    // Take all messages from the ring buffer, write them without holding the lock
+    for (; 0 < _count; _count--, _first = (_first+1) % _ring.size())
+      batch.append(std::move(_ring[_first]));
+    std::swap(dropped, _dropped);
+    _notFull.wakeAll();
+    _ringLock.unlock();
+
+    foreach (const QString &line, batch)
+      _stream << line;
+    if (dropped)
+      _stream << QDateTime::currentDateTime().toString(Qt::ISODateWithMs)
+              << ": Warning: Dropped " << dropped << " messages, log buffer full.\n";
+    if (batch.size() || dropped)
+      _stream.flush();
+    batch.clear();
+    dropped = 0;
+
+    _ringLock.lock();
+  }
+  _ringLock.unlock();
 }
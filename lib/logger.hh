@@ -6,22 +6,34 @@
 #include <QFile>
 #include <QTextStream>
 #include <QList>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+
+class QThread;
+
+/** Constructs a log message, if any handler accepts messages of the given level. Otherwise, the
+ * message is neither constructed nor are its arguments evaluated. The macro expands to a complete
+ * if-else statement, hence it can be used safely within unbraced if-else statements. */
+#define LOG_MESSAGE(level) \
+  if (! Logger::isEnabled(level)) {} else LogMessage(level, __FILE__, __LINE__)
 
 /** Constructs a debug message. */
-#define logDebug() LogMessage(LogMessage::DEBUG, __FILE__, __LINE__)
+#define logDebug() LOG_MESSAGE(LogMessage::DEBUG)
 /** Constructs an info message. */
-#define logInfo()  LogMessage(LogMessage::INFO, __FILE__, __LINE__)
+#define logInfo()  LOG_MESSAGE(LogMessage::INFO)
 /** Constructs a warning message. */
-#define logWarn()  LogMessage(LogMessage::WARNING, __FILE__, __LINE__)
+#define logWarn()  LOG_MESSAGE(LogMessage::WARNING)
 /** Constructs an error message. */
-#define logError() LogMessage(LogMessage::ERROR, __FILE__, __LINE__)
+#define logError() LOG_MESSAGE(LogMessage::ERROR)
 /** Constructs a fatal error message. */
 #ifdef __cpp_lib_stacktrace
 #include <stacktrace>
-#define logFatal() LogMessage(LogMessage::FATAL, __FILE__, __LINE__) << \
+#define logFatal() LOG_MESSAGE(LogMessage::FATAL) << \
   QString::fromStdString(std::to_string(std::stacktrace::current()))
 #else
-#define logFatal() LogMessage(LogMessage::FATAL, __FILE__, __LINE__)
+#define logFatal() LOG_MESSAGE(LogMessage::FATAL)
 #endif
 
 /** Implements a log-message.
@@ -84,6 +96,10 @@ public:
   explicit LogHandler(QObject *parent=nullptr);
   /** Destructor. */
   virtual ~LogHandler();
+  /** Returns the minimum level of the messages handled. Messages below the minimum level of all
+   * handlers are not constructed at all. Handlers must call @c Logger::updateMinLevel, whenever
+   * their minimum level changes. By default, all messages are handled. */
+  virtual LogMessage::Level minLevel() const;
   /** Callback to handle log messages. */
   virtual void handle(const LogMessage &message) = 0;
 };
@@ -103,12 +119,16 @@ public:
   /** Destructor. */
   virtual ~Logger();
 
-  /** Logs a message. */
+  /** Logs a message. May be called from any thread, the handlers are called one message at a
+   * time. */
   void log(const LogMessage &msg);
   /** Adds a log-handler to the logger. The ownership is transferred to the logger. */
   void addHandler(LogHandler *handler);
   /** Removes a log-handler from the logger. The ownership is transferred back to the caller. */
   void remHandler(LogHandler *handler);
+  /** Updates the minimum level of all messages handled. Gets called by the handlers whenever their
+   * minimum level changes. */
+  void updateMinLevel();
 
 protected slots:
   /** Internal callback to handle deleted handler objects. */
@@ -117,12 +137,25 @@ protected slots:
 public:
   /** Factory method to get the singleton instance. */
   static Logger &get();
+  /** Returns @c true if any handler accepts messages of the given level. This check is performed
+   * before a message is constructed. */
+  static inline bool isEnabled(LogMessage::Level level) {
+    return int(level) >= _minLevel.load(std::memory_order_relaxed);
+  }
+
+protected:
+  /** Recomputes the minimum level, the lock must be held. */
+  void recomputeMinLevel();
 
 protected:
   /** The singleton instance. */
   static Logger *_instance;
+  /** The minimum level over all handlers. If there are no handlers, it is above all levels. */
+  static std::atomic<int> _minLevel;
   /** The list of registered log-handler. */
   QList<LogHandler *> _handler;
+  /** Serializes messages logged from different threads. */
+  QMutex _lock;
 };
 
 
@@ -180,6 +213,10 @@ public:
 
   void handle(const LogMessage &message);
 
+protected:
+  /** Formats the given message into a single line including a time stamp. */
+  static QString format(const LogMessage &message);
+
 protected:
   /** The file to log into. */
   QFile _file;
@@ -189,4 +226,57 @@ protected:
   LogMessage::Level _minLevel;
 };
 
+
+
+/** A log-handler that writes log-messages into files from a background thread.
+ *
+ * The messages are formatted within the logging thread and passed to the writer thread through a
+ * ring buffer of fixed capacity. Hence, logging only costs formatting the message and the file
+ * access happens in the background. If the buffer is full, debug and info messages are dropped
+ * (the number of dropped messages is logged later), while the logging thread waits for more
+ * severe messages to be taken by the writer.
+ * @ingroup log */
+class AsyncFileLogHandler: public FileLogHandler
+{
+  Q_OBJECT
+
+public:
+  /** Constructor.
+   * @param file Specifies the filename to log to.
+   * @param minLevel Specifies the minimum log-level to log.
+   * @param capacity Specifies the number of messages, the ring buffer holds.
+   * @param parent Specifies the parent object. */
+  AsyncFileLogHandler(const QString &file, LogMessage::Level minLevel=LogMessage::DEBUG,
+                      unsigned capacity=1024, QObject *parent=nullptr);
+
+  /** Destructor, writes all pending messages and stops the writer thread. */
+  virtual ~AsyncFileLogHandler();
+
+  void handle(const LogMessage &message);
+
+protected:
+  /** Main loop of the writer thread. */
+  void write();
+
+protected:
+  /** The ring buffer of formatted messages. */
+  QVector<QString> _ring;
+  /** Index of the oldest message in the ring buffer. */
+  int _first;
+  /** Number of messages in the ring buffer. */
+  int _count;
+  /** Number of messages dropped since the last one written. */
+  unsigned _dropped;
+  /** If @c true, the writer thread stops once the ring buffer is empty. */
+  bool _stop;
+  /** Protects the ring buffer. */
+  QMutex _ringLock;
+  /** Signals the writer thread, that there are messages in the buffer. */
+  QWaitCondition _notEmpty;
+  /** Signals the logging threads, that the writer took messages from the buffer. */
+  QWaitCondition _notFull;
+  /** The writer thread. */
+  QThread *_writer;
+};
+
 #endif // LOGGER_HH
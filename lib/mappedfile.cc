@@ -0,0 +1,94 @@
+#include "mappedfile.hh"
+#include "logger.hh"
+#include <cstring>
+
+
+MappedFile::MappedFile()
+  : _file(), _mapped(nullptr), _buffer(), _data(nullptr), _size(0)
+{
+  // pass...
+}
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+bool
+MappedFile::open(const QString &filename, const ErrorStack &err) {
+  close();
+
+  _file.setFileName(filename);
+  if (! _file.exists()) {
+    errMsg(err) << "Cannot open file '" << filename << "': File does not exist.";
+    return false;
+  }
+  if (! _file.open(QFile::ReadOnly)) {
+    errMsg(err) << "Cannot open file '" << filename << "': " << _file.errorString() << ".";
+    return false;
+  }
+
+  _size = _file.size();
+  if (0 == _size)
+    return true;
+
+  if (nullptr != (_mapped = _file.map(0, _size))) {
+    _data = _mapped;
+    return true;
+  }
+
+  // Fall back to reading the file
+  logDebug() << "Cannot map file '" << filename << "': " << _file.errorString()
+             << ". Read file instead.";
+  _buffer = _file.readAll();
+  if (size_t(_buffer.size()) != _size) {
+    errMsg(err) << "Cannot read file '" << filename << "': " << _file.errorString() << ".";
+    close();
+    return false;
+  }
+  _data = reinterpret_cast<const uint8_t *>(_buffer.constData());
+
+  return true;
+}
+
+void
+MappedFile::close() {
+  if (_mapped)
+    _file.unmap(_mapped);
+  if (_file.isOpen())
+    _file.close();
+  _mapped = nullptr;
+  _buffer.clear();
+  _data = nullptr;
+  _size = 0;
+}
+
+bool
+MappedFile::isOpen() const {
+  return _file.isOpen();
+}
+
+QString
+MappedFile::fileName() const {
+  return _file.fileName();
+}
+
+const uint8_t *
+MappedFile::data() const {
+  return _data;
+}
+
+size_t
+MappedFile::size() const {
+  return _size;
+}
+
+bool
+MappedFile::copy(size_t offset, void *dest, size_t n, const ErrorStack &err) const {
+  if ((offset > _size) || (n > (_size-offset))) {
+    errMsg(err) << "Cannot read " << n << " bytes at offset " << offset
+                << " from file '" << fileName() << "': File size is only " << _size << " bytes.";
+    return false;
+  }
+  memcpy(dest, _data+offset, n);
+  return true;
+}
@@ -0,0 +1,55 @@
+#ifndef MAPPEDFILE_HH
+#define MAPPEDFILE_HH
+
+#include <QFile>
+#include <QByteArray>
+#include "errorstack.hh"
+
+/** Read-only view of the complete content of a file.
+ *
+ * The file gets mapped into memory, if possible. Otherwise, its content is read into an internal
+ * buffer. Either way, the content is accessible as a continuous block via @c data and @c size.
+ * This is used by the readers of manufacturer codeplug files, to decode the files directly or to
+ * copy their segments into the codeplug without intermediate reads.
+ *
+ * @ingroup util */
+class MappedFile
+{
+public:
+  /** Constructs an empty view. */
+  MappedFile();
+  /** Destructor, unmaps the file. */
+  ~MappedFile();
+
+  /** Maps the given file. */
+  bool open(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Unmaps and closes the file. */
+  void close();
+  /** Returns @c true if a file is mapped. */
+  bool isOpen() const;
+
+  /** Returns the file name. */
+  QString fileName() const;
+  /** Returns a pointer to the content of the file. */
+  const uint8_t *data() const;
+  /** Returns the size of the file. */
+  size_t size() const;
+
+  /** Copies @c n bytes at the given file offset into @c dest. Fails, if the range exceeds the
+   * file. */
+  bool copy(size_t offset, void *dest, size_t n, const ErrorStack &err=ErrorStack()) const;
+
+protected:
+  /** The file. */
+  QFile _file;
+  /** The mapped memory or @c nullptr if the content was read into @c _buffer. */
+  uchar *_mapped;
+  /** Holds the content, if the file cannot be mapped. */
+  QByteArray _buffer;
+  /** Pointer to the content. */
+  const uint8_t *_data;
+  /** Size of the content. */
+  size_t _size;
+};
+
+#endif // MAPPEDFILE_HH
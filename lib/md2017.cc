@@ -2,8 +2,6 @@
 #include "md2017_limits.hh"
 
 
-RadioLimits *MD2017::_limits = nullptr;
-
 MD2017::MD2017(TyTInterface *device, QObject *parent)
   : TyTRadio(device, parent), _name("TyT DM-2017")
 {
@@ -21,9 +19,7 @@ MD2017::name() const {
 
 const RadioLimits &
 MD2017::limits() const {
-  if (nullptr == _limits)
-    _limits = new MD2017Limits();
-  return *_limits;
+  return *RadioLimits::shared("md2017", []() -> RadioLimits * { return new MD2017Limits(); });
 }
 
 const Codeplug &
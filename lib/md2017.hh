@@ -64,10 +64,6 @@ private:
   MD2017Codeplug _codeplug;
   /** The callsign DB object. */
   MD2017CallsignDB _callsigndb;
-
-private:
-  /** Singleton instance of the limits for this radio. */
-  static RadioLimits *_limits;
 };
 
 #endif // MD2017_HH
@@ -79,6 +79,15 @@ MD2017Codeplug::~MD2017Codeplug() {
   // pass...
 }
 
+std::vector<AddressMap::Range>
+MD2017Codeplug::generatedMemory() const {
+  // Contacts, group lists, zones and their extensions are cleared before encoding.
+  return {
+    {ADDR_CONTACTS, NUM_CONTACTS*CONTACT_SIZE}, {ADDR_GROUPLISTS, NUM_GROUPLISTS*GROUPLIST_SIZE},
+    {ADDR_ZONES, NUM_ZONES*ZONE_SIZE}, {ADDR_ZONEEXTS, NUM_ZONES*ZONEEXT_SIZE}
+  };
+}
+
 void
 MD2017Codeplug::clearTimestamp() {
   TimestampElement(data(ADDR_TIMESTAMP)).clear();
@@ -184,10 +193,9 @@ MD2017Codeplug::encodeContacts(Config *config, const Flags &flags, Context &ctx,
   // Encode contacts
   for (int i=0; i<NUM_CONTACTS; i++) {
     ContactElement cont(data(ADDR_CONTACTS+i*CONTACT_SIZE));
+    cont.clear();
     if (i < config->contacts()->digitalCount())
       cont.fromContactObj(config->contacts()->digitalContact(i));
-    else
-      cont.clear();
   }
   return true;
 }
@@ -94,6 +94,8 @@ public:
   /** Destructor. */
   virtual ~MD2017Codeplug();
 
+  std::vector<AddressMap::Range> generatedMemory() const;
+
 public:
   void clearTimestamp();
   bool encodeTimestamp();
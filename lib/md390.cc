@@ -55,20 +55,24 @@ MD390::MD390(TyTInterface *device, const ErrorStack &err, QObject *parent)
              << "MHz from " << channelCount << " channels.";
 
   if ((137<=range.first) && (174>=range.second)) {
-    _limits = new MD390Limits({{Frequency::fromMHz(136.), Frequency::fromMHz(174.)}}, this);
+    _limits = RadioLimits::shared("md390:vhf", []() -> RadioLimits * {
+      return new MD390Limits({{Frequency::fromMHz(136.), Frequency::fromMHz(174.)}}); });
     _name += "V";
   } else if ((350<=range.first) && (400>=range.second)) {
-    _limits = new MD390Limits({{Frequency::fromMHz(350.), Frequency::fromMHz(400.)}}, this);
+    _limits = RadioLimits::shared("md390:uhf350", []() -> RadioLimits * {
+      return new MD390Limits({{Frequency::fromMHz(350.), Frequency::fromMHz(400.)}}); });
     _name += "U";
   } else if ((400<=range.first) && (450>=range.second)) {
-    _limits = new MD390Limits({{Frequency::fromMHz(400.), Frequency::fromMHz(480.)}}, this);
+    _limits = RadioLimits::shared("md390:uhf400", []() -> RadioLimits * {
+      return new MD390Limits({{Frequency::fromMHz(400.), Frequency::fromMHz(480.)}}); });
     _name += "U";
   } else if ((450<=range.first) && (520>=range.second)) {
-    _limits = new MD390Limits({{Frequency::fromMHz(450.), Frequency::fromMHz(520.)}}, this);
+    _limits = RadioLimits::shared("md390:uhf450", []() -> RadioLimits * {
+      return new MD390Limits({{Frequency::fromMHz(450.), Frequency::fromMHz(520.)}}); });
     _name += "U";
   } else {
     // Invalid frequency range, needs "Ignore frequency limits" in settings to write any codeplug.
-    _limits = new MD390Limits({}, this);
+    _limits = RadioLimits::shared("md390", []() -> RadioLimits * { return new MD390Limits({}); });
     errMsg(err) << "Cannot determine frequency range from channel frequencies between "
                 << range.first << "MHz and " << range.second
                 << "MHz. Will not check frequency ranges.";
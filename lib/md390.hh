@@ -58,9 +58,9 @@ private:
   MD390Codeplug _codeplug;
 
 private:
-  /** Instance of limits for this radio. Gets intantiated for every radio as it depends on the
-   * radio variant. */
-  RadioLimits *_limits;
+  /** Limits for this radio. Depend on the radio variant and are shared between all radios of the
+   * same variant. */
+  const RadioLimits *_limits;
 };
 
 #endif // MD2017_HH
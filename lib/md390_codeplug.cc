@@ -2,6 +2,7 @@
 #include "config.hh"
 #include "logger.hh"
 #include "intermediaterepresentation.hh"
+#include "tracer.hh"
 
 
 #define NUM_CHANNELS                1000
@@ -166,8 +167,23 @@ MD390Codeplug::MD390Codeplug(QObject *parent)
   clear();
 }
 
+std::vector<AddressMap::Range>
+MD390Codeplug::generatedMemory() const {
+  // Contacts, group lists and zones are cleared before encoding.
+  return {
+    {ADDR_CONTACTS, NUM_CONTACTS*CONTACT_SIZE}, {ADDR_GROUPLISTS, NUM_GROUPLISTS*GROUPLIST_SIZE},
+    {ADDR_ZONES, NUM_ZONES*ZONE_SIZE}
+  };
+}
+
+bool
+MD390Codeplug::requiresPreprocessing(const Config *config) const {
+  return TyTCodeplug::requiresPreprocessing(config) || ZoneSplitVisitor::isRequired(config);
+}
+
 Config *
 MD390Codeplug::preprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("MD390Codeplug::preprocess", "codeplug");
   Config *intermediate = TyTCodeplug::preprocess(config, err);
   if (nullptr == intermediate) {
     errMsg(err) << "Cannot prepare codeplug for MD-390.";
@@ -186,6 +202,7 @@ MD390Codeplug::preprocess(Config *config, const ErrorStack &err) const {
 
 bool
 MD390Codeplug::postprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("MD390Codeplug::postprocess", "codeplug");
   if (! TyTCodeplug::postprocess(config, err)) {
     errMsg(err) << "Cannot post-process MD-390 codeplug.";
     return false;
@@ -202,6 +219,7 @@ MD390Codeplug::postprocess(Config *config, const ErrorStack &err) const {
 
 bool
 MD390Codeplug::decodeElements(Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("MD390Codeplug::decodeElements", "codeplug");
   logDebug() << "Decode MD390 codeplug, programmed with CPS version "
              << TimestampElement(data(ADDR_TIMESTAMP)).cpsVersion() << ".";
   return TyTCodeplug::decodeElements(ctx, err);
@@ -301,10 +319,9 @@ MD390Codeplug::encodeContacts(Config *config, const Flags &flags, Context &ctx,
   // Encode contacts
   for (int i=0; i<NUM_CONTACTS; i++) {
     ContactElement cont(data(ADDR_CONTACTS+i*CONTACT_SIZE));
+    cont.clear();
     if (i < config->contacts()->digitalCount())
       cont.fromContactObj(config->contacts()->digitalContact(i));
-    else
-      cont.clear();
   }
   return true;
 }
@@ -94,7 +94,10 @@ public:
   /** Empty constructor. */
   explicit MD390Codeplug(QObject *parent=nullptr);
 
+  std::vector<AddressMap::Range> generatedMemory() const;
+
   Config *preprocess(Config *config, const ErrorStack &err) const;
+  bool requiresPreprocessing(const Config *config) const;
   bool postprocess(Config *config, const ErrorStack &err) const;
 
   virtual bool decodeElements(Context &ctx, const ErrorStack &err=ErrorStack());
@@ -2,6 +2,16 @@
 #include "logger.hh"
 
 #include <QRegularExpression>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/** The preferred BPM, inferred melodies are kept close to. */
+#define DEFAULT_BPM 100
+/** The minimum BPM considered when inferring a melody. */
+#define MIN_BPM 30
+/** The maximum BPM considered when inferring a melody. */
+#define MAX_BPM 199
 
 
 /* ********************************************************************************************* *
@@ -120,17 +130,9 @@ Melody::toTones() const {
 bool
 Melody::infer(const QVector<QPair<double, unsigned int> > &tones) {
   // Find minimum quantization error -> infer also BPM
-  unsigned int best_bpm = 30;
-  unsigned int best_cost = quantizationTimingError(tones, best_bpm) + std::abs(100-(int)best_bpm);
-  for (unsigned int bpm=31; bpm<200; bpm++) {
-    unsigned int cost = quantizationTimingError(tones, best_bpm);
-    if (cost < best_cost) {
-      best_bpm = bpm;
-      best_cost = cost + std::abs(100 - (int)bpm);
-    }
-  }
-  _bpm = best_bpm;
+  _bpm = inferBPM(tones);
   _melody.clear();
+  _melody.reserve(tones.size());
   for(const QPair<double,unsigned int> &tone: tones) {
     Note note; note.infer(tone.first, tone.second, _bpm);
     _melody.append(note);
@@ -141,14 +143,67 @@ Melody::infer(const QVector<QPair<double, unsigned int> > &tones) {
 }
 
 unsigned int
-Melody::quantizationTimingError(const QVector<QPair<double, unsigned int> > &tones, unsigned int bpm) {
-  if (0 == tones.count())
+Melody::inferBPM(const QVector<QPair<double, unsigned int>> &tones) {
+  // Tones of the same duration have the same error, hence only the distinct durations are kept
+  QVector<QPair<unsigned int, unsigned int>> durations;
+  unsigned int count = 0;
+  for (const QPair<double, unsigned int> &tone: tones) {
+    if (0 == tone.second)
+      continue;
+    QVector<QPair<unsigned int, unsigned int>>::iterator duration = std::find_if(
+          durations.begin(), durations.end(), [&tone](const QPair<unsigned int, unsigned int> &d) {
+      return d.first == tone.second;
+    });
+    if (durations.end() == duration)
+      durations.append({tone.second, 1});
+    else
+      duration->second++;
+    count++;
+  }
+  if (0 == count)
+    return DEFAULT_BPM;
+
+  // BPMs, at which any duration is a whole to sixteenth note
+  QVector<unsigned int> candidates = { DEFAULT_BPM };
+  for (const QPair<unsigned int, unsigned int> &duration: durations) {
+    for (unsigned int fraction=0; fraction<=4; fraction++) {
+      unsigned int bpm = std::round((4*60000.0)/(duration.first << fraction));
+      if ((MIN_BPM <= bpm) && (MAX_BPM >= bpm) && (! candidates.contains(bpm)))
+        candidates.append(bpm);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(), [](unsigned int a, unsigned int b) {
+    unsigned int da = std::abs(DEFAULT_BPM-(int)a), db = std::abs(DEFAULT_BPM-(int)b);
+    return (da < db) || ((da == db) && (a < b));
+  });
+
+  unsigned int best_bpm = DEFAULT_BPM, best_cost = std::numeric_limits<unsigned int>::max();
+  for (unsigned int bpm: candidates) {
+    // The error is never negative, no further candidate can be better
+    unsigned int penalty = std::abs(DEFAULT_BPM-(int)bpm);
+    if (penalty >= best_cost)
+      break;
+    unsigned int cost = quantizationTimingError(durations, count, bpm) + penalty;
+    if (cost < best_cost) {
+      best_bpm = bpm;
+      best_cost = cost;
+    }
+  }
+
+  return best_bpm;
+}
+
+unsigned int
+Melody::quantizationTimingError(const QVector<QPair<unsigned int, unsigned int>> &durations,
+                                unsigned int count, unsigned int bpm)
+{
+  if (0 == count)
     return 0;
   unsigned int error=0;
-  for (const QPair<double,unsigned int> &tone: tones) {
-    error += Note::quantizationTimingError(tone.second, bpm);
+  for (const QPair<unsigned int, unsigned int> &duration: durations) {
+    error += duration.second*Note::quantizationTimingError(duration.first, bpm);
   }
-  return error / tones.count();
+  return error / count;
 }
 
 
@@ -259,7 +314,7 @@ Melody::Note::toLilypond(Duration currentDuration) const {
 
 QPair<double, unsigned int>
 Melody::Note::toTone(unsigned int bpm) const {
-  static const unsigned int bar = (4*60000)/bpm;
+  unsigned int bar = (4*60000)/bpm;
   unsigned int dur = bar;
 
   if (Duration::Whole == duration) {
@@ -329,7 +384,7 @@ Melody::Note::infer(double frequency, unsigned int ms, unsigned int bpm) {
   }
 
   // Try to infer note duration from duration and BPM
-  static const unsigned int bar = (4*60000)/bpm;
+  unsigned int bar = (4*60000)/bpm;
   int fraction = std::round(std::log2(bar)-std::log2(ms));
   int diff = 0;
   if (1 > fraction) {
@@ -354,9 +409,11 @@ Melody::Note::infer(double frequency, unsigned int ms, unsigned int bpm) {
 
 unsigned int
 Melody::Note::quantizationTimingError(unsigned int ms, unsigned int bpm) {
-  static const unsigned int bar = (4*60000)/bpm;
+  if ((0 == ms) || (0 == bpm))
+    return 0;
+  unsigned int bar = (4*60000)/bpm;
   int fraction = std::round(std::log2(bar)-std::log2(ms));
   // Limit onto [2^0, 2^4] fractions == [1/1, 1/16]
   fraction = std::max(0, std::min(4, fraction));
-  return std::abs(ms - bar*std::pow(2, fraction));
+  return std::abs((int)ms - (int)(bar >> fraction));
 }
@@ -115,10 +115,21 @@ public:
   /** Infer melody from a vector of frequeny-duration pairs. */
   bool infer(const QVector<QPair<double, unsigned int>> &tones);
 
+  /** Infers the BPM of the given frequency-duration pairs, without inferring the notes. This
+   * may be used to choose a common BPM for several melodies.
+   *
+   * The quantization error vanishes, whenever a duration is exactly a whole to sixteenth note.
+   * Hence, only these BPMs (and the default of 100 BPM) are considered as candidates, in order of
+   * their distance to 100 BPM. The search stops, once the distance alone exceeds the best cost.
+   * The costs are proportional to the number of distinct durations, not to the number of tones. */
+  static unsigned int inferBPM(const QVector<QPair<double, unsigned int>> &tones);
+
 protected:
-  /** Computes the absolute quantization timing error over the given melody for the given BPM. */
+  /** Computes the mean absolute quantization timing error for the given BPM. The durations are
+   * given as pairs of a distinct duration in ms and the number of tones of that duration, the
+   * total number of tones is @c count. */
   static unsigned int quantizationTimingError(
-      const QVector<QPair<double, unsigned int>> &tones, unsigned int bpm);
+      const QVector<QPair<unsigned int, unsigned int>> &durations, unsigned int count, unsigned int bpm);
 
 protected:
   /** Holds the beats per minute. */
@@ -0,0 +1,86 @@
+#ifndef MEMORYLAYOUT_HH
+#define MEMORYLAYOUT_HH
+
+#include <cstdint>
+
+/** Describes a table of equally sized elements within the memory of a device.
+ *
+ * Many radios split large tables (e.g., channels or contacts) into banks. Within each bank, the
+ * elements are placed at a fixed stride, the banks themselves are placed at a fixed stride too.
+ * This class describes such a table completely and computes the addresses of its elements. As all
+ * methods are @c constexpr, tables declared as constant expressions are folded by the compiler.
+ * Moreover, their consistency and the absence of overlaps can be checked using @c static_assert.
+ *
+ * @code
+ * static constexpr MemoryTable channels = {0x00800000, 0x00040000, 128, 0x40, 0x40, 4000};
+ * static_assert(channels.isValid(), "Channel banks overlap.");
+ * @endcode
+ *
+ * @ingroup util */
+struct MemoryTable
+{
+  uint32_t base;            ///< Address of the first element.
+  uint32_t bankStride;      ///< Distance between two banks.
+  unsigned int perBank;     ///< Number of elements per bank.
+  uint32_t stride;          ///< Distance between two elements within a bank.
+  uint32_t elementSize;     ///< Size of each element.
+  unsigned int count;       ///< Total number of elements.
+
+  /** Returns the number of banks. */
+  constexpr unsigned int banks() const {
+    return (count + perBank - 1)/perBank;
+  }
+  /** Returns the address of the i-th element. */
+  constexpr uint32_t address(unsigned int i) const {
+    return base + (i/perBank)*bankStride + (i%perBank)*stride;
+  }
+  /** Returns the address of the given bank. */
+  constexpr uint32_t bankAddress(unsigned int bank) const {
+    return base + bank*bankStride;
+  }
+  /** Returns the number of elements within the given bank. The last bank may be shorter. */
+  constexpr unsigned int bankCount(unsigned int bank) const {
+    return ((count - bank*perBank) < perBank) ? (count - bank*perBank) : perBank;
+  }
+  /** Returns the size of the memory covered by the given bank. */
+  constexpr uint32_t bankSize(unsigned int bank) const {
+    return (bankCount(bank) - 1)*stride + elementSize;
+  }
+  /** Returns the address of the group of @c n consecutive elements within the same bank, the
+   * i-th element belongs to. */
+  constexpr uint32_t groupAddress(unsigned int i, unsigned int n) const {
+    return address(i - (i%perBank)%n);
+  }
+  /** Returns the size of a group of @c n consecutive elements. */
+  constexpr uint32_t groupSize(unsigned int n) const {
+    return (n - 1)*stride + elementSize;
+  }
+  /** Returns the first address past the last bank. */
+  constexpr uint32_t end() const {
+    return bankAddress(banks()-1) + bankSize(banks()-1);
+  }
+
+  /** Returns @c true, if the elements do not overlap each other. */
+  constexpr bool isValid() const {
+    return (0 < perBank) && (0 < count) && (elementSize <= stride)
+        && ((1 == banks()) || (groupSize(perBank) <= bankStride));
+  }
+  /** Returns @c true, if any bank overlaps the given memory region. */
+  constexpr bool overlaps(uint32_t address, uint32_t size) const {
+    for (unsigned int b=0; b<banks(); b++) {
+      if ((bankAddress(b) < (address+size)) && (address < (bankAddress(b)+bankSize(b))))
+        return true;
+    }
+    return false;
+  }
+  /** Returns @c true, if any bank overlaps any bank of the other table. */
+  constexpr bool overlaps(const MemoryTable &other) const {
+    for (unsigned int b=0; b<other.banks(); b++) {
+      if (overlaps(other.bankAddress(b), other.bankSize(b)))
+        return true;
+    }
+    return false;
+  }
+};
+
+#endif // MEMORYLAYOUT_HH
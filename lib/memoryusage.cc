@@ -0,0 +1,110 @@
+#include "memoryusage.hh"
+#include <QStringList>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+MemoryUsage::MemoryUsage(const QString &name, quint64 bytes, qint64 count)
+  : _name(name), _bytes(bytes), _count(count), _note(), _children()
+{
+  // pass...
+}
+
+const QString &
+MemoryUsage::name() const {
+  return _name;
+}
+
+quint64
+MemoryUsage::bytes() const {
+  return _bytes;
+}
+
+void
+MemoryUsage::addBytes(quint64 bytes) {
+  _bytes += bytes;
+}
+
+qint64
+MemoryUsage::count() const {
+  return _count;
+}
+
+void
+MemoryUsage::setCount(qint64 count) {
+  _count = count;
+}
+
+const QString &
+MemoryUsage::note() const {
+  return _note;
+}
+
+void
+MemoryUsage::setNote(const QString &note) {
+  _note = note;
+}
+
+MemoryUsage &
+MemoryUsage::add(const MemoryUsage &child) {
+  _bytes += child.bytes();
+  _children.append(child);
+  return _children.last();
+}
+
+const QList<MemoryUsage> &
+MemoryUsage::children() const {
+  return _children;
+}
+
+QString
+MemoryUsage::format(unsigned int indent) const {
+  QString line = QString(2*indent, ' ') + QString("%1: %2").arg(_name).arg(formatBytes(_bytes));
+  if (0 <= _count)
+    line += QString(" (%1 entries)").arg(_count);
+  if (! _note.isEmpty())
+    line += QString(", %1").arg(_note);
+
+  QStringList lines(line);
+  foreach (const MemoryUsage &child, _children)
+    lines.append(child.format(indent+1));
+  return lines.join("\n");
+}
+
+QString
+MemoryUsage::formatBytes(quint64 bytes) {
+  if (bytes < 1024)
+    return QString("%1 B").arg(bytes);
+  if (bytes < 1024*1024)
+    return QString("%1 KiB").arg(double(bytes)/1024, 0, 'f', 1);
+  if (bytes < 1024*1024*1024)
+    return QString("%1 MiB").arg(double(bytes)/(1024*1024), 0, 'f', 1);
+  return QString("%1 GiB").arg(double(bytes)/(1024*1024*1024), 0, 'f', 1);
+}
+
+quint64
+MemoryUsage::peakResident() {
+#ifdef Q_OS_UNIX
+  struct rusage usage;
+  if (0 != getrusage(RUSAGE_SELF, &usage))
+    return 0;
+#ifdef Q_OS_MACOS
+  // Reported in bytes on macOS, in KiB elsewhere
+  return quint64(usage.ru_maxrss);
+#else
+  return quint64(usage.ru_maxrss)*1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+quint64
+MemoryUsage::of(const QString &str) {
+  return str.capacity() ? (ARRAY_HEADER + 2*quint64(str.capacity()+1)) : 0;
+}
+
+quint64
+MemoryUsage::of(const QByteArray &data) {
+  return data.capacity() ? (ARRAY_HEADER + quint64(data.capacity()+1)) : 0;
+}
@@ -0,0 +1,90 @@
+#ifndef MEMORYUSAGE_HH
+#define MEMORYUSAGE_HH
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QList>
+
+/** A report of the memory held by some part of the application, e.g., a config, a codeplug or a
+ * database.
+ *
+ * A report is a tree. Each node has a name, the number of bytes held and optionally the number of
+ * entries (e.g., the number of channels). The bytes of a node include the bytes of all its
+ * children. The numbers are estimates of the heap memory held, they do not include the overhead
+ * of the allocator. However, they allow to identify the part of the application responsible for
+ * a high memory usage.
+ *
+ * @ingroup util */
+class MemoryUsage
+{
+public:
+  /** Constructs a node of the given name. If @c count is negative, the node does not count any
+   * entries. */
+  explicit MemoryUsage(const QString &name=QString(), quint64 bytes=0, qint64 count=-1);
+
+  /** Returns the name of the node. */
+  const QString &name() const;
+  /** Returns the total number of bytes, including those of all children. */
+  quint64 bytes() const;
+  /** Adds the given number of bytes to this node. */
+  void addBytes(quint64 bytes);
+  /** Returns the number of entries or -1 if the node does not count entries. */
+  qint64 count() const;
+  /** Sets the number of entries. */
+  void setCount(qint64 count);
+  /** Returns an optional detail, e.g., the number of bytes used by a codeplug. */
+  const QString &note() const;
+  /** Sets the detail. */
+  void setNote(const QString &note);
+
+  /** Adds the given child, its bytes are added to this node. Returns a reference to the child. */
+  MemoryUsage &add(const MemoryUsage &child);
+  /** Returns the children of the node. */
+  const QList<MemoryUsage> &children() const;
+
+  /** Formats the report as a human readable, indented multi-line text. */
+  QString format(unsigned int indent=0) const;
+  /** Formats the given number of bytes using a binary unit, e.g., "1.5 MiB". */
+  static QString formatBytes(quint64 bytes);
+  /** Returns the peak resident memory of the process in bytes, as reported by the operating
+   * system. Unlike the estimates, it includes the allocator overhead and all libraries. Returns
+   * 0 if the peak is not available on this platform. */
+  static quint64 peakResident();
+
+  /** Estimates the heap memory held by a string. Shared strings are counted for every copy. */
+  static quint64 of(const QString &str);
+  /** Estimates the heap memory held by a byte array. */
+  static quint64 of(const QByteArray &data);
+  /** Estimates the heap memory held by the elements of a vector, excluding any heap memory held
+   * by the elements themselves. */
+  template <class T>
+  static quint64 of(const QVector<T> &vec) {
+    return vec.capacity() ? (ARRAY_HEADER + quint64(vec.capacity())*sizeof(T)) : 0;
+  }
+  /** Estimates the heap memory held by the nodes and buckets of a hash table, excluding any
+   * heap memory held by the keys and values themselves. */
+  template <class K, class V>
+  static quint64 of(const QHash<K, V> &hash) {
+    return quint64(hash.capacity())*sizeof(void *)
+        + quint64(hash.size())*(2*sizeof(void *) + sizeof(K) + sizeof(V));
+  }
+
+  /** Size of the header of the shared data of strings, byte arrays and vectors. */
+  static const quint64 ARRAY_HEADER = 24;
+
+protected:
+  /** The name of the node. */
+  QString _name;
+  /** The total number of bytes. */
+  quint64 _bytes;
+  /** The number of entries. */
+  qint64 _count;
+  /** An optional detail. */
+  QString _note;
+  /** The children. */
+  QList<MemoryUsage> _children;
+};
+
+#endif // MEMORYUSAGE_HH
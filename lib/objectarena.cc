@@ -0,0 +1,109 @@
+#include "objectarena.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/** Size of the memory chunks. */
+#define ARENA_CHUNK_SIZE   0x10000
+/** Objects larger than this are always allocated individually. */
+#define ARENA_MAX_OBJECT   0x1000
+/** Alignment of all allocations. */
+#define ARENA_ALIGNMENT    alignof(std::max_align_t)
+
+/** Every allocation is preceded by this header, pointing to the chunk the object lives in or
+ * @c nullptr, if the object was allocated individually. */
+union ObjectArena::Header {
+  Chunk *chunk;
+  std::max_align_t align;
+};
+
+/** A chunk holds a reference counter. The owning scope holds one reference as long as it
+ * allocates from the chunk, every object living in the chunk holds another. */
+struct ObjectArena::Chunk {
+  std::atomic<int> references;
+  std::size_t used;
+
+  char *data() {
+    return reinterpret_cast<char *>(this) + sizeof(Chunk);
+  }
+
+  static Chunk *create() {
+    void *mem = std::malloc(ARENA_CHUNK_SIZE);
+    if (nullptr == mem)
+      throw std::bad_alloc();
+    Chunk *chunk = reinterpret_cast<Chunk *>(mem);
+    new (&chunk->references) std::atomic<int>(1);
+    // Start at an aligned offset
+    chunk->used = (ARENA_ALIGNMENT - (sizeof(Chunk) % ARENA_ALIGNMENT)) % ARENA_ALIGNMENT;
+    return chunk;
+  }
+
+  void unref() {
+    if (1 == references.fetch_sub(1, std::memory_order_acq_rel))
+      std::free(this);
+  }
+};
+
+/** The currently active scope of this thread. */
+static thread_local ObjectArena::Scope *_currentScope = nullptr;
+
+
+/* ********************************************************************************************* *
+ * Implementation of ObjectArena::Scope
+ * ********************************************************************************************* */
+ObjectArena::Scope::Scope()
+  : _previous(_currentScope), _chunk(nullptr)
+{
+  _currentScope = this;
+}
+
+ObjectArena::Scope::~Scope() {
+  if (_chunk)
+    _chunk->unref();
+  _currentScope = _previous;
+}
+
+void *
+ObjectArena::Scope::allocate(std::size_t size) {
+  std::size_t needed = sizeof(Header) + size;
+  needed = ((needed + ARENA_ALIGNMENT - 1)/ARENA_ALIGNMENT)*ARENA_ALIGNMENT;
+
+  if ((nullptr == _chunk) || ((sizeof(Chunk) + _chunk->used + needed) > ARENA_CHUNK_SIZE)) {
+    // Release current chunk, it gets freed with its last object
+    if (_chunk)
+      _chunk->unref();
+    _chunk = Chunk::create();
+  }
+
+  Header *header = reinterpret_cast<Header *>(_chunk->data() + _chunk->used);
+  header->chunk = _chunk;
+  _chunk->used += needed;
+  _chunk->references.fetch_add(1, std::memory_order_relaxed);
+  return header + 1;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ObjectArena
+ * ********************************************************************************************* */
+void *
+ObjectArena::allocate(std::size_t size) {
+  if (_currentScope && (size <= ARENA_MAX_OBJECT))
+    return _currentScope->allocate(size);
+
+  Header *header = reinterpret_cast<Header *>(::operator new(sizeof(Header) + size));
+  header->chunk = nullptr;
+  return header + 1;
+}
+
+void
+ObjectArena::release(void *ptr) {
+  if (nullptr == ptr)
+    return;
+  Header *header = reinterpret_cast<Header *>(ptr) - 1;
+  if (header->chunk)
+    header->chunk->unref();
+  else
+    ::operator delete(header);
+}
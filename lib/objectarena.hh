@@ -0,0 +1,56 @@
+#ifndef OBJECTARENA_HH
+#define OBJECTARENA_HH
+
+#include <cstddef>
+
+/** Implements pooled storage for config items created in bulk.
+ *
+ * Config items are allocated through @c ConfigItem::operator new. While an @c ObjectArena::Scope
+ * is active in the current thread, small objects are taken from larger memory chunks owned by
+ * the scope instead of being allocated individually. Objects created in one scope (e.g., all
+ * channels of a decoded codeplug) are thus placed next to each other. A chunk is released, once
+ * all its objects got deleted and the scope is done with it. Hence, objects may outlive the scope
+ * and may be deleted from any thread, in any order.
+ *
+ * Without an active scope, objects are allocated as usual.
+ *
+ * @ingroup util */
+class ObjectArena
+{
+protected:
+  /** A chunk of memory, objects get allocated from. */
+  struct Chunk;
+  /** Header preceding every allocation. */
+  union Header;
+
+public:
+  /** Scope guard activating the arena for the current thread. Scopes may be nested. */
+  class Scope
+  {
+  public:
+    /** Activates a new scope for the current thread. */
+    Scope();
+    /** Deactivates the scope. Chunks still holding objects remain until these get deleted. */
+    ~Scope();
+
+  protected:
+    /** Allocates memory from the current chunk of this scope. */
+    void *allocate(std::size_t size);
+
+  protected:
+    /** The previously active scope of this thread. */
+    Scope *_previous;
+    /** The chunk, objects are currently allocated from. */
+    Chunk *_chunk;
+
+    friend class ObjectArena;
+  };
+
+public:
+  /** Allocates memory for an object of the given size. */
+  static void *allocate(std::size_t size);
+  /** Releases the memory allocated by @c allocate. */
+  static void release(void *ptr);
+};
+
+#endif // OBJECTARENA_HH
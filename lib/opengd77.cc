@@ -2,11 +2,14 @@
 #include "opengd77_limits.hh"
 #include "logger.hh"
 #include "config.hh"
+#include <algorithm>
 
 
 #define BSIZE 32
-
-RadioLimits *OpenGD77::_limits = nullptr;
+/** Size of the blocks read back for verification. */
+#define RBSIZE 1024
+/** Maximum size of contiguous EEPROM runs passed to the interface at once. */
+#define EEPROM_WBSIZE 1024
 
 OpenGD77::OpenGD77(OpenGD77Interface *device, QObject *parent)
   : Radio(parent), _name("Open GD-77"), _dev(device), _config(nullptr), _codeplug(), _callsigns()
@@ -27,6 +30,24 @@ OpenGD77::~OpenGD77() {
   }
 }
 
+TransferStatistics
+OpenGD77::transferStatistics() const {
+  if (nullptr == _dev)
+    return TransferStatistics();
+  return _dev->transferStatistics();
+}
+
+void
+OpenGD77::moveInterfaceToThread(QThread *thread) {
+  if (_dev)
+    _dev->moveToThread(thread);
+}
+
+RadioInterface *
+OpenGD77::radioInterface() const {
+  return _dev;
+}
+
 const QString &
 OpenGD77::name() const {
   return _name;
@@ -34,9 +55,7 @@ OpenGD77::name() const {
 
 const RadioLimits &
 OpenGD77::limits() const {
-  if (nullptr == _limits)
-    _limits = new OpenGD77Limits();
-  return *_limits;
+  return *RadioLimits::shared("opengd77", []() -> RadioLimits * { return new OpenGD77Limits(); });
 }
 
 const Codeplug &
@@ -49,6 +68,16 @@ OpenGD77::codeplug() {
   return _codeplug;
 }
 
+const CallsignDB *
+OpenGD77::callsignDB() const {
+  return &_callsigns;
+}
+
+CallsignDB *
+OpenGD77::callsignDB() {
+  return &_callsigns;
+}
+
 RadioInfo
 OpenGD77::defaultRadioInfo() {
   return RadioInfo(
@@ -102,6 +131,7 @@ OpenGD77::startUpload(Config *config, bool blocking, const Codeplug::Flags &flag
 
   _task = StatusUpload;
   _errorStack = err;
+  _checkpoint.reset();
 
   if (blocking) {
     run();
@@ -132,6 +162,70 @@ OpenGD77::startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignD
 
   _task = StatusUploadCallsigns;
   _errorStack = err;
+  _checkpoint.reset();
+  if (blocking) {
+    run();
+    return (StatusIdle == _task);
+  }
+
+  // If non-blocking -> move device to this thread
+  if (_dev && _dev->isOpen())
+    _dev->moveToThread(this);
+  // start thread for upload
+  start();
+
+  return true;
+}
+
+bool
+OpenGD77::startUploadAll(Config *config, UserDatabase *db, bool blocking, const Codeplug::Flags &flags,
+                         const CallsignDB::Selection &selection, const ErrorStack &err)
+{
+  Q_UNUSED(flags)
+
+  logDebug() << "Start upload of codeplug and call-sign DB to " << name() << "...";
+
+  if (StatusIdle != _task) {
+    logError() << "Cannot upload to radio, radio is not idle.";
+    return false;
+  }
+
+  if (_config)
+    delete _config;
+
+  if (! (_config = config)) {
+    logError() << "Cannot upload to radio, no config given.";
+    return false;
+  }
+  _config->setParent(this);
+
+  // Assemble call-sign db from user DB
+  logDebug() << "Encode call-signs into db.";
+  _callsigns.encode(db, selection);
+
+  _task = StatusUploadAll;
+  _errorStack = err;
+  _checkpoint.reset();
+
+  if (blocking) {
+    run();
+    return (StatusIdle == _task);
+  }
+
+  // If non-blocking -> move device to this thread
+  if (_dev && _dev->isOpen())
+    _dev->moveToThread(this);
+  // start thread for upload
+  start();
+
+  return true;
+}
+
+bool
+OpenGD77::startResume(bool blocking, const ErrorStack &err) {
+  if (! restoreCheckpoint(err))
+    return false;
+
   if (blocking) {
     run();
     return (StatusIdle == _task);
@@ -177,6 +271,7 @@ OpenGD77::run() {
     }
 
     if (! upload()) {
+      storeCheckpoint();
       _task = StatusError;
       _dev->write_finish();
       _dev->reboot();
@@ -185,6 +280,7 @@ OpenGD77::run() {
       return;
     }
 
+    clearCheckpoint();
     _dev->write_finish();
     _dev->reboot();
     _dev->close();
@@ -197,6 +293,7 @@ OpenGD77::run() {
     }
 
     if (! uploadCallsigns()) {
+      storeCheckpoint();
       _task = StatusError;
       _dev->write_finish();
       _dev->reboot();
@@ -205,6 +302,39 @@ OpenGD77::run() {
       return;
     }
 
+    clearCheckpoint();
+    _dev->write_finish();
+    _dev->reboot();
+    _dev->close();
+    _task = StatusIdle;
+    emit uploadComplete(this);
+  } else if (StatusUploadAll == _task) {
+    if ((nullptr==_dev) || (! _dev->isOpen())) {
+      emit uploadError(this);
+      return;
+    }
+
+    // Reboot only once, after codeplug and callsign DB got written. Once the codeplug is
+    // written, a checkpoint refers to the callsign DB.
+    bool ok = upload();
+    if (ok) {
+      clearCheckpoint();
+      _dev->write_finish();
+      _task = StatusUploadCallsigns;
+      ok = uploadCallsigns();
+    }
+
+    if (! ok) {
+      storeCheckpoint();
+      _task = StatusError;
+      _dev->write_finish();
+      _dev->reboot();
+      _dev->close();
+      emit uploadError(this);
+      return;
+    }
+
+    clearCheckpoint();
     _dev->write_finish();
     _dev->reboot();
     _dev->close();
@@ -231,6 +361,9 @@ OpenGD77::download()
   }
 
   size_t totb = _codeplug.memSize();
+  enterPhase(PhaseRead, totb);
+  // All elements get downloaded entirely, no need to initialize them
+  _codeplug.prepareOverwrite();
 
   if (! _dev->read_start(0, 0, _errorStack)) {
     errMsg(_errorStack) << "Cannot start codeplug download.";
@@ -254,7 +387,7 @@ OpenGD77::download()
           return false;
         }
         QThread::usleep(100);
-        emit downloadProgress(float(bcount*100)/totb);
+        reportDownloadProgress(float(bcount*100)/totb);
       }
     }
     _dev->read_finish(_errorStack);
@@ -281,66 +414,105 @@ OpenGD77::upload()
   }
 
   size_t totb = _codeplug.memSize();
+  // Enable before reading the codeplug, the read flash content is then compared on write
+  _dev->setSkipUnchanged(_skipUnchanged);
+
+  // If resumed, the image being written was restored from the checkpoint. Otherwise, read and
+  // encode the codeplug first.
+  if (_checkpoint.isResume())
+    logInfo() << "Resume upload to " << name() << " from checkpoint.";
+  else if (! prepareUpload())
+    return false;
+  size_t bcount = totb;
 
-  if (! _dev->read_start(0, 0, _errorStack)) {
-    errMsg(_errorStack) << "Cannot start codeplug download.";
+  enterPhase(PhaseWrite, totb);
+  if (! _dev->write_start(0,0, _errorStack)) {
+    errMsg(_errorStack) << "Cannot start codeplug upload.";
     return false;
   }
 
-  // Then download codeplug
-  size_t bcount = 0;
+  // Then upload codeplug
+  _checkpoint.begin();
+  _readback.reset();
+  _readback.setBlockSize(RBSIZE);
   for (int image=0; image<_codeplug.numImages(); image++) {
-    uint32_t bank = ( (0 == image) ? OpenGD77Codeplug::EEPROM : OpenGD77Codeplug::FLASH );
+    uint32_t bank = (0 == image) ? OpenGD77Codeplug::EEPROM : OpenGD77Codeplug::FLASH;
 
     for (int n=0; n<_codeplug.image(image).numElements(); n++) {
       unsigned addr = _codeplug.image(image).element(n).address();
       unsigned size = _codeplug.image(image).element(n).data().size();
       unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-      for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
-        if (! _dev->read(bank, (b0+b)*BSIZE, _codeplug.data((b0+b)*BSIZE, image), BSIZE, _errorStack)) {
-          errMsg(_errorStack) << "Cannot read block " << (b0+b) << ".";
+
+      // The EEPROM is written in larger runs, the interface pipelines the block requests. Flash
+      // blocks are passed one by one, such that unchanged sectors can be detected.
+      unsigned run = (OpenGD77Codeplug::EEPROM == bank) ? (EEPROM_WBSIZE/BSIZE) : 1;
+      for (unsigned b=0; b<nb;) {
+        // Skip blocks written before, when resuming
+        if (! _checkpoint.pending(image, n, b*BSIZE, BSIZE)) {
+          b++; bcount += BSIZE;
+          continue;
+        }
+        unsigned m = std::min(run, nb-b);
+        if (! _dev->write(bank, (b0+b)*BSIZE, _codeplug.data((b0+b)*BSIZE, image), m*BSIZE, _errorStack)) {
+          errMsg(_errorStack) << "Cannot write blocks " << (b0+b) << "-" << (b0+b+m-1) << ".";
           return false;
         }
+        _checkpoint.confirm(image, n, (b+m)*BSIZE);
+        _readback.add(bank, (b0+b)*BSIZE, _codeplug.data((b0+b)*BSIZE, image), m*BSIZE);
         QThread::usleep(100);
-        emit uploadProgress(float(bcount*50)/totb);
+        b += m; bcount += m*BSIZE;
+        reportUploadProgress(float(bcount*50)/totb);
       }
     }
-    _dev->read_finish();
+    _dev->write_finish();
   }
 
-  // Encode config into codeplug
-  _codeplug.encode(_config);
+  if (! verifyUpload()) {
+    errMsg(_errorStack) << "Cannot verify codeplug.";
+    return false;
+  }
 
-  if (! _dev->write_start(0,0, _errorStack)) {
-    errMsg(_errorStack) << "Cannot start codeplug upload.";
+  return true;
+}
+
+
+bool
+OpenGD77::prepareUpload() {
+  size_t totb = _codeplug.memSize();
+  enterPhase(PhaseRead, totb);
+  if (! _dev->read_start(0, 0, _errorStack)) {
+    errMsg(_errorStack) << "Cannot start codeplug download.";
     return false;
   }
 
-  // Then upload codeplug
+  // Then download codeplug
+  size_t bcount = 0;
   for (int image=0; image<_codeplug.numImages(); image++) {
-    uint32_t bank = (0 == image) ? OpenGD77Codeplug::EEPROM : OpenGD77Codeplug::FLASH;
+    uint32_t bank = ( (0 == image) ? OpenGD77Codeplug::EEPROM : OpenGD77Codeplug::FLASH );
 
     for (int n=0; n<_codeplug.image(image).numElements(); n++) {
       unsigned addr = _codeplug.image(image).element(n).address();
       unsigned size = _codeplug.image(image).element(n).data().size();
       unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-
       for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
-        if (! _dev->write(bank, (b0+b)*BSIZE, _codeplug.data((b0+b)*BSIZE, image), BSIZE, _errorStack)) {
-          errMsg(_errorStack) << "Cannot write block " << (b0+b) << ".";
+        if (! _dev->read(bank, (b0+b)*BSIZE, _codeplug.data((b0+b)*BSIZE, image), BSIZE, _errorStack)) {
+          errMsg(_errorStack) << "Cannot read block " << (b0+b) << ".";
           return false;
         }
         QThread::usleep(100);
-        emit uploadProgress(float(bcount*50)/totb);
+        reportUploadProgress(float(bcount*50)/totb);
       }
     }
-    _dev->write_finish();
+    _dev->read_finish();
   }
 
+  // Encode config into codeplug
+  enterPhase(PhaseEncode);
+  _codeplug.encode(_config);
+
   return true;
 }
 
-
 bool
 OpenGD77::uploadCallsigns()
 {
@@ -353,7 +525,9 @@ OpenGD77::uploadCallsigns()
   }
 
   size_t totb = _callsigns.memSize();
+  _dev->setSkipUnchanged(_skipUnchanged);
 
+  enterPhase(PhaseWrite, totb);
   if (! _dev->write_start(OpenGD77Codeplug::FLASH, 0, _errorStack)) {
     errMsg(_errorStack) << "Cannot start callsign DB upload.";
     return false;
@@ -361,22 +535,58 @@ OpenGD77::uploadCallsigns()
 
   unsigned bcount = 0;
   // Then upload callsign DB
+  _checkpoint.begin();
+  _readback.reset();
+  _readback.setBlockSize(RBSIZE);
   for (int n=0; n<_callsigns.image(0).numElements(); n++) {
     unsigned addr = _callsigns.image(0).element(n).address();
     unsigned size = _callsigns.image(0).element(n).data().size();
     unsigned b0 = addr/BSIZE, nb = size/BSIZE;
     for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
+      // Skip blocks written before, when resuming
+      if (! _checkpoint.pending(0, n, b*BSIZE, BSIZE))
+        continue;
       if (! _dev->write(OpenGD77Codeplug::FLASH, (b0+b)*BSIZE,
                         _callsigns.data((b0+b)*BSIZE, 0), BSIZE, _errorStack))
       {
         errMsg(_errorStack) << "Cannot write block " << (b0+b) << ".";
         return false;
       }
-      emit uploadProgress(float(bcount*100)/totb);
+      _checkpoint.confirm(0, n, (b+1)*BSIZE);
+      _readback.add(OpenGD77Codeplug::FLASH, (b0+b)*BSIZE, _callsigns.data((b0+b)*BSIZE, 0), BSIZE);
+      reportUploadProgress(float(bcount*100)/totb);
     }
   }
 
   _dev->write_finish();
+
+  if (! verifyUpload()) {
+    errMsg(_errorStack) << "Cannot verify callsign DB.";
+    return false;
+  }
+
   return true;
 }
 
+bool
+OpenGD77::verifyUpload() {
+  if (! _readback.isEnabled())
+    return true;
+
+  logDebug() << "Read back " << _readback.numBlocks() << " written blocks from " << name() << ".";
+  enterPhase(PhaseVerify);
+  if (! _dev->read_start(0, 0, _errorStack)) {
+    errMsg(_errorStack) << "Cannot start readback.";
+    return false;
+  }
+  bool ok = _readback.verify(
+        [this](uint32_t bank, uint32_t addr, uint8_t *data, int n, const ErrorStack &err) {
+          return _dev->read(bank, addr, data, n, err);
+        }, _errorStack);
+  _dev->read_finish();
+  // Everything was written, hence resuming the upload is pointless.
+  if (! ok)
+    _checkpoint.reset();
+  return ok;
+}
+
@@ -27,6 +27,9 @@ public:
   const RadioLimits &limits() const;
   const Codeplug &codeplug() const;
   Codeplug &codeplug();
+  const CallsignDB *callsignDB() const;
+  CallsignDB *callsignDB();
+  TransferStatistics transferStatistics() const;
 
   /** Returns the default radio information. The actual instance may have different properties
    * due to variants of the same radio. */
@@ -42,8 +45,17 @@ public slots:
   /** Encodes the given user-database and uploades it to the device. */
   bool startUploadCallsignDB(UserDatabase *db, bool blocking=false,
                              const CallsignDB::Selection &selection=CallsignDB::Selection(), const ErrorStack &err=ErrorStack());
+  /** Uploads the codeplug and the callsign DB within a single programming session. */
+  bool startUploadAll(Config *config, UserDatabase *db, bool blocking=false,
+                      const Codeplug::Flags &flags = Codeplug::Flags(),
+                      const CallsignDB::Selection &selection=CallsignDB::Selection(),
+                      const ErrorStack &err=ErrorStack());
+  /** Resumes a failed upload from the stored checkpoint. */
+  bool startResume(bool blocking=false, const ErrorStack &err=ErrorStack());
 
 protected:
+  void moveInterfaceToThread(QThread *thread);
+  RadioInterface *radioInterface() const;
   /** Thread main routine, performs all blocking IO operations for codeplug up- and download. */
 	void run();
 
@@ -51,8 +63,12 @@ protected:
   bool download();
   /** Implements the actual codeplug upload process. */
   bool upload();
+  /** Reads the current codeplug from the radio and encodes the configuration. */
+  bool prepareUpload();
   /** Implements the actual callsign DB upload process. */
   bool uploadCallsigns();
+  /** Reads back the written blocks, if the readback verification is enabled. */
+  bool verifyUpload();
 
 protected:
   /** The device identifier. */
@@ -65,10 +81,6 @@ protected:
   OpenGD77Codeplug _codeplug;
   /** The actual binary callsign DB representation. */
   OpenGD77CallsignDB _callsigns;
-
-private:
-  /** Holds the singleton instance. */
-  static RadioLimits *_limits;
 };
 
 #endif // OPENGD77_HH
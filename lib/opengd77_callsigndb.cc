@@ -93,19 +93,14 @@ OpenGD77CallsignDB::encode(UserDatabase *calldb, const Selection &selection, con
 
   // Limit entries to USERDB_NUM_ENTRIES
   qint64 n = std::min(calldb->count(), qint64(USERDB_NUM_ENTRIES));
-  if (selection.hasCountLimit())
-    n = std::min(n, (qint64)selection.countLimit());
+
+  // Select entries and sort them in ascending order of their IDs
+  QVector<int> users = sortedSelection(calldb, selection, n);
+  n = users.size();
   // If there are no entries -> done.
   if (0 == n)
     return true;
 
-  // Select first n entries and sort them in ascending order of their IDs
-  QVector<UserDatabase::User> users;
-  for (unsigned i=0; i<n; i++)
-    users.append(calldb->user(i));
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
-
   // Allocate segment for user db if requested
   unsigned size = align_size(sizeof(userdb_t)+n*sizeof(userdb_entry_t), BLOCK_SIZE);
   this->image(0).addElement(OFFSET_USERDB, size);
@@ -114,9 +109,11 @@ OpenGD77CallsignDB::encode(UserDatabase *calldb, const Selection &selection, con
   userdb_t *userdb = (userdb_t *)this->data(OFFSET_USERDB);
   userdb->clear(); userdb->setSize(n);
   userdb_entry_t *db = (userdb_entry_t *)this->data(OFFSET_USERDB+sizeof(userdb_t));
-  for (unsigned i=0; i<n; i++) {
-    db[i].fromEntry(users[i]);
-  }
+  // Entries have a fixed size and can be encoded concurrently
+  parallelFor(n, [calldb, &users, db](qint64 first, qint64 last) {
+    for (qint64 i=first; i<last; i++)
+      db[i].fromEntry(calldb->user(users[i]));
+  });
 
   return true;
 }
@@ -2,10 +2,15 @@
 #include "logger.hh"
 #include "radioinfo.hh"
 #include <QtEndian>
+#include <algorithm>
+#include <cstring>
 
 #define USB_VID 0x1fc9
 #define USB_PID 0x0094
 
+/** Number of block requests queued back-to-back before the responses are collected. */
+#define WINDOW_SIZE 8
+
 #define BLOCK_SIZE  32
 #define SECTOR_SIZE 4096
 #define ALIGN_BLOCK_SIZE(n) ((0==((n)%BLOCK_SIZE)) ? (n) : (n)+(BLOCK_SIZE-((n)%BLOCK_SIZE)))
@@ -168,7 +173,9 @@ OpenGD77Interface::CommandRequest::initCommand(Option option) {
  * Implementation of OpenGD77Interface
  * ********************************************************************************************* */
 OpenGD77Interface::OpenGD77Interface(const USBDeviceDescriptor &descr, const ErrorStack &err, QObject *parent)
-  : USBSerial(descr, QSerialPort::Baud115200, err, parent), _sector(-1)
+  : USBSerial(descr, QSerialPort::Baud115200, err, parent), _sector(-1), _window(WINDOW_SIZE),
+    _skipUnchanged(false), _stagedSector(-1), _stagedData(), _stagedBlocks(), _knownFlash(),
+    _sectorsWritten(0), _sectorsSkipped(0)
 {
   // pass...
 }
@@ -206,6 +213,7 @@ OpenGD77Interface::identifier(const ErrorStack &err) {
 bool
 OpenGD77Interface::write_start(uint32_t bank, uint32_t addr, const ErrorStack &err)
 {
+  TransferStatistics::Timer timer(_transferStatistics);
   logDebug() << "Send enter prog mode ...";
   if (! sendShowCPSScreen(err))
     return false;
@@ -248,37 +256,121 @@ OpenGD77Interface::write_start(uint32_t bank, uint32_t addr, const ErrorStack &e
 bool
 OpenGD77Interface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err)
 {
+  _transferStatistics.setAddress(addr);
   if (EEPROM == bank) {
+    if (! flushFlash(err))
+      return false;
     if ((0 <= _sector) && (! finishWriteFlash(err)))
       return false;
-    for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
-      if (! writeEEPROM(addr+i, data+i, BLOCK_SIZE, err)) {
-        _sector = -1;
+    // A request carries a single block at most, hence pipeline the requests like Flash writes.
+    for (int i=0; i<nbytes;) {
+      if (! checkCanceled(err))
         return false;
+      int n = std::min(nbytes-i, int(_window*BLOCK_SIZE));
+      TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Write, n);
+      if (1 == _window) {
+        if (! writeBlocks(EEPROM, addr+i, data+i, n, err)) {
+          _sector = -1;
+          return false;
+        }
+      } else if (! writeBlocks(EEPROM, addr+i, data+i, n)) {
+        // Like writes into the sector buffer, EEPROM writes can simply be repeated.
+        logWarn() << "Pipelined EEPROM write at " << QString::number(addr+i, 16)
+                  << "h failed, fall back to lock-step transfers.";
+        _transferStatistics.addRetry();
+        discardInput();
+        _window = 1;
+        continue;
       }
+      i += n;
     }
     return true;
   }
 
+  // Collect complete blocks within a single sector, everything else gets written directly.
+  if (_skipUnchanged && (0 < nbytes) && (0 == (addr % BLOCK_SIZE)) && (0 == (nbytes % BLOCK_SIZE))
+      && ((addr/SECTOR_SIZE) == ((addr+nbytes-1)/SECTOR_SIZE)))
+    return stageFlash(addr, data, nbytes, err);
+
+  if (! checkCanceled(err))
+    return false;
+  if (! flushFlash(err))
+    return false;
+  if (! programFlash(addr, data, nbytes, err))
+    return false;
+  if (_skipUnchanged)
+    rememberFlash(addr, data, nbytes);
+  return true;
+}
+
+bool
+OpenGD77Interface::write_finish(const ErrorStack &err) {
+  if (! flushFlash(err))
+    return false;
+  if (_skipUnchanged && (_sectorsWritten || _sectorsSkipped)) {
+    logInfo() << "Programmed " << _sectorsWritten << " flash sectors, skipped "
+              << _sectorsSkipped << " unchanged sectors.";
+    _sectorsWritten = _sectorsSkipped = 0;
+  }
+
+  _sector = -1;
+  if (0 > _sector)
+    return true;
+  _sector = -1;
+  if (! finishWriteFlash(err))
+    return false;
+  if (! sendCloseScreen(err))
+    return false;
+  return true;
+}
+
+void
+OpenGD77Interface::setSkipUnchanged(bool enabled) {
+  _skipUnchanged = enabled;
+  _stagedSector = -1;
+  _knownFlash.clear();
+  _sectorsWritten = _sectorsSkipped = 0;
+}
+
+bool
+OpenGD77Interface::skipUnchanged() const {
+  return _skipUnchanged;
+}
+
+bool
+OpenGD77Interface::programFlash(uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err) {
 start:
   int32_t sector = addr/SECTOR_SIZE;
 
   if (0 > _sector) {
-    if (! setFlashSector(addr))
+    if (! setFlashSector(addr, err))
       return false;
     _sector = sector;
   }
 
   if (sector == _sector) {
-    for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
-      if (! writeFlash(addr+i, data+i, BLOCK_SIZE)) {
-        _sector = -1;
-        return false;
+    for (int i=0; i<nbytes;) {
+      int n = std::min(nbytes-i, int(_window*BLOCK_SIZE));
+      TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Write, n);
+      if (1 == _window) {
+        if (! writeBlocks(FLASH, addr+i, data+i, n, err)) {
+          _sector = -1;
+          return false;
+        }
+      } else if (! writeBlocks(FLASH, addr+i, data+i, n)) {
+        // Writes into the sector buffer are idempotent, hence the batch can simply be repeated.
+        logWarn() << "Pipelined write at " << QString::number(addr+i, 16)
+                  << "h failed, fall back to lock-step transfers.";
+        _transferStatistics.addRetry();
+        discardInput();
+        _window = 1;
+        continue;
       }
+      i += n;
     }
   } else {
     _sector = -1;
-    if (! finishWriteFlash()) {
+    if (! finishWriteFlash(err)) {
       return false;
     }
     goto start;
@@ -288,22 +380,114 @@ start:
 }
 
 bool
-OpenGD77Interface::write_finish(const ErrorStack &err) {
-  _sector = -1;
-  if (0 > _sector)
+OpenGD77Interface::stageFlash(uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err) {
+  int32_t sector = addr/SECTOR_SIZE;
+  if ((sector != _stagedSector) && (! flushFlash(err)))
+    return false;
+
+  if (0 > _stagedSector) {
+    _stagedSector = sector;
+    _stagedData = QByteArray(SECTOR_SIZE, 0);
+    _stagedBlocks = QBitArray(SECTOR_SIZE/BLOCK_SIZE);
+  }
+
+  uint32_t offset = addr % SECTOR_SIZE;
+  memcpy(_stagedData.data()+offset, data, nbytes);
+  for (int i=0; i<nbytes; i+=BLOCK_SIZE)
+    _stagedBlocks.setBit((offset+i)/BLOCK_SIZE);
+
+  return true;
+}
+
+bool
+OpenGD77Interface::flushFlash(const ErrorStack &err) {
+  if (0 > _stagedSector)
+    return true;
+
+  int32_t sector = _stagedSector;
+  uint32_t base = uint32_t(sector)*SECTOR_SIZE;
+  const int nblocks = SECTOR_SIZE/BLOCK_SIZE;
+  _stagedSector = -1;
+
+  // Finish any sector written directly, before reading from flash
+  if (0 <= _sector) {
+    _sector = -1;
+    if (! finishWriteFlash(err))
+      return false;
+  }
+
+  // Read back all written blocks with unknown content, read() remembers them
+  if (! _knownFlash.contains(sector))
+    _knownFlash.insert(sector, KnownSector{QByteArray(SECTOR_SIZE, 0), QBitArray(nblocks)});
+  for (int b=0; b<nblocks;) {
+    if ((! _stagedBlocks.testBit(b)) || _knownFlash[sector].valid.testBit(b)) {
+      b++; continue;
+    }
+    int e = b;
+    while ((e < nblocks) && _stagedBlocks.testBit(e) && (! _knownFlash[sector].valid.testBit(e)))
+      e++;
+    QByteArray current((e-b)*BLOCK_SIZE, 0);
+    if (! read(FLASH, base+b*BLOCK_SIZE, (uint8_t *)current.data(), current.size(), err)) {
+      errMsg(err) << "Cannot read current content of flash sector " << sector << ".";
+      return false;
+    }
+    b = e;
+  }
+
+  // Program all changed blocks
+  const KnownSector known = _knownFlash.value(sector);
+  bool changed = false;
+  for (int b=0; b<nblocks;) {
+    int offset = b*BLOCK_SIZE;
+    if ((! _stagedBlocks.testBit(b)) ||
+        (0 == memcmp(_stagedData.constData()+offset, known.data.constData()+offset, BLOCK_SIZE))) {
+      b++; continue;
+    }
+    int e = b+1;
+    while ((e < nblocks) && _stagedBlocks.testBit(e) &&
+           (0 != memcmp(_stagedData.constData()+e*BLOCK_SIZE, known.data.constData()+e*BLOCK_SIZE, BLOCK_SIZE)))
+      e++;
+    const uint8_t *data = (const uint8_t *)_stagedData.constData()+offset;
+    if (! programFlash(base+offset, data, (e-b)*BLOCK_SIZE, err))
+      return false;
+    rememberFlash(base+offset, data, (e-b)*BLOCK_SIZE);
+    changed = true;
+    b = e;
+  }
+
+  if (! changed) {
+    logDebug() << "Skip unchanged flash sector at " << QString::number(base, 16) << "h.";
+    _sectorsSkipped++;
     return true;
+  }
+
   _sector = -1;
   if (! finishWriteFlash(err))
     return false;
-  if (! sendCloseScreen(err))
-    return false;
+  _sectorsWritten++;
+
   return true;
 }
 
+void
+OpenGD77Interface::rememberFlash(uint32_t addr, const uint8_t *data, int nbytes) {
+  const int nblocks = SECTOR_SIZE/BLOCK_SIZE;
+  uint32_t end = addr + nbytes;
+  for (uint32_t a=ALIGN_BLOCK_SIZE(addr); (a+BLOCK_SIZE)<=end; a+=BLOCK_SIZE) {
+    int32_t sector = a/SECTOR_SIZE;
+    if (! _knownFlash.contains(sector))
+      _knownFlash.insert(sector, KnownSector{QByteArray(SECTOR_SIZE, 0), QBitArray(nblocks)});
+    KnownSector &known = _knownFlash[sector];
+    memcpy(known.data.data() + (a % SECTOR_SIZE), data + (a-addr), BLOCK_SIZE);
+    known.valid.setBit((a % SECTOR_SIZE)/BLOCK_SIZE);
+  }
+}
+
 bool
 OpenGD77Interface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
   Q_UNUSED(bank); Q_UNUSED(addr)
 
+  TransferStatistics::Timer timer(_transferStatistics);
   if (! sendShowCPSScreen(err))
     return false;
   if (! sendClearScreen(err))
@@ -326,26 +510,39 @@ OpenGD77Interface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &er
 
 bool
 OpenGD77Interface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  _transferStatistics.setAddress(addr);
   if (! isOpen()) {
     errMsg(err) << "Cannot read block: Device not open!";
     return false;
   }
 
-  for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
-    bool ok;
-    if (EEPROM == bank)
-      ok = readEEPROM(addr+i, data+i, BLOCK_SIZE, err);
-    else if (FLASH == bank)
-      ok = readFlash(addr+i, data+i, BLOCK_SIZE, err);
-    else {
-      errMsg(err) << "Cannot read from bank " << bank << ": Unknown memory bank.";
-      return false;
-    }
+  if ((EEPROM != bank) && (FLASH != bank)) {
+    errMsg(err) << "Cannot read from bank " << bank << ": Unknown memory bank.";
+    return false;
+  }
 
-    if (! ok)
+  for (int i=0; i<nbytes;) {
+    if (! checkCanceled(err))
       return false;
+    int n = std::min(nbytes-i, int(_window*BLOCK_SIZE));
+    TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Read, n);
+    if (1 == _window) {
+      if (! readBlocks(bank, addr+i, data+i, n, err))
+        return false;
+    } else if (! readBlocks(bank, addr+i, data+i, n)) {
+      logWarn() << "Pipelined read at " << QString::number(addr+i, 16)
+                << "h failed, fall back to lock-step transfers.";
+      _transferStatistics.addRetry();
+      discardInput();
+      _window = 1;
+      continue;
+    }
+    i += n;
   }
 
+  if (_skipUnchanged && (FLASH == bank))
+    rememberFlash(addr, data, nbytes);
+
   return true;
 }
 
@@ -365,335 +562,143 @@ OpenGD77Interface::reboot(const ErrorStack &err) {
 
 bool
 OpenGD77Interface::readEEPROM(uint32_t addr, uint8_t *data, uint16_t len, const ErrorStack &err) {
-  Q_UNUSED(len)
-
-  if (! isOpen()) {
-    errMsg(err) << "Cannot read block: Device not open!";
+  ReadRequest req; req.initReadEEPROM(addr, len);
+  if (! send((const char *)&req, sizeof(ReadRequest), err))
     return false;
-  }
-
-  ReadRequest req; req.initReadEEPROM(addr, BLOCK_SIZE);
-  if (sizeof(ReadRequest) != QSerialPort::write((const char *)&req, sizeof(ReadRequest))) {
-    errMsg(err) << "Cannot write to serial port.";
-    return false;
-  }
-
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << "Cannot read from serial port: Timeout!";
-    return false;
-  }
-
-  ReadResponse resp;
-  int retlen = QSerialPort::read((char *)&resp, sizeof(ReadResponse));
-
-  if (0 > retlen) {
-    errMsg(err) << "Cannot read from serial port";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot read from serial port: Device returned empty message.";
-    return false;
-  }
-
-  if ('R' != resp.type) {
-    errMsg(err) << "Cannot read from device: Device returned error '" << resp.type << "'.";
-    return false;
-  }
-
-  if (qFromBigEndian(req.length) != qFromBigEndian(resp.length)) {
-    errMsg(err) << "Cannot read from device: Device returned invalid length " <<
-                qFromBigEndian(resp.length) << ".";
-    return false;
-  }
-
-  memcpy(data, resp.data, qFromBigEndian(resp.length));
-  return true;
+  return receiveReadResponse(len, data, err);
 }
 
 
 bool
 OpenGD77Interface::writeEEPROM(uint32_t addr, const uint8_t *data, uint16_t len, const ErrorStack &err) {
   WriteRequest req; req.initWriteEEPROM(addr, data, len);
-  WriteResponse resp;
-
-  if ((8+len) != QSerialPort::write((const char *)&req, 8+len)) {
-    errMsg(err) << "Cannot write to serial port.";
+  if (! send((const char *)&req, 8+len, err))
     return false;
-  }
-
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << "Cannot read from serial port: Timeout!";
+  if (! receiveWriteResponse(req, _timing.timeout(), err)) {
+    errMsg(err) << "Cannot write EEPROM at " << QString::number(addr, 16) << "h.";
     return false;
   }
-
-  int retlen = QSerialPort::read((char *)&resp, sizeof(WriteResponse));
-
-  if (0 > retlen) {
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot write EEPROM: Device returned empty message.";
-    return false;
-  }
-
-  if ((req.type != resp.type) || (req.command != resp.command)) {
-    errMsg(err) << "Cannot write EEPROM at " << QString::number(addr, 16)
-             << ": Device returned error " << resp.type << ".";
-    return false;
-  }
-
   return true;
 }
 
 
 bool
 OpenGD77Interface::readFlash(uint32_t addr, uint8_t *data, uint16_t len, const ErrorStack &err) {
-  Q_UNUSED(len)
-
-  if (! isOpen()) {
-    errMsg(err) << "Cannot read block: Device not open!";
-    return false;
-  }
-
-  ReadRequest req;
-  req.initReadFlash(addr, BLOCK_SIZE);
-  if (sizeof(ReadRequest) != QSerialPort::write((const char *)&req, sizeof(ReadRequest))) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot write to serial port.";
-    return false;
-  }
-
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot read from serial port: Timeout!";
-    return false;
-  }
-
-  ReadResponse resp;
-  int retlen = QSerialPort::read((char *)&resp, sizeof(ReadResponse));
-
-  if (0 > retlen) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot read from serial port: Device returned empty message.";
-    return false;
-  }
-
-  if ('R' != resp.type) {
-    errMsg(err) << "Cannot read from device: Device returned error " << resp.type << ".";
+  ReadRequest req; req.initReadFlash(addr, len);
+  if (! send((const char *)&req, sizeof(ReadRequest), err))
     return false;
-  }
-
-  if (qFromBigEndian(req.length) != qFromBigEndian(resp.length)) {
-    errMsg(err) << "Cannot read from device: Device returned invalid length "
-                << qFromBigEndian(resp.length) << ".";
-    return false;
-  }
-
-  memcpy(data, resp.data, qFromBigEndian(resp.length));
-  return true;
+  return receiveReadResponse(len, data, err);
 }
 
 bool
 OpenGD77Interface::setFlashSector(uint32_t addr, const ErrorStack &err) {
   WriteRequest req; req.initSetFlashSector(addr);
-  WriteResponse resp;
-
-  if (5 != QSerialPort::write((const char *)&req, 5)) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot write to serial port.";
-    return false;
-  }
-
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot read from serial port: Timeout!";
-    return false;
-  }
-
-  int retlen = QSerialPort::read((char *)&resp, sizeof(WriteResponse));
-
-  if (0 > retlen) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot read from serial port.";
+  if (! send((const char *)&req, 5, err))
     return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot set flash sector: Device returned empty message.";
+  if (! receiveWriteResponse(req, _timing.maxTimeout(), err)) {
+    errMsg(err) << "Cannot set flash sector.";
     return false;
   }
-
-  if ((req.type != resp.type) || (req.command != resp.command)) {
-    errMsg(err) << "Cannot set flash sector: Device returned error " << resp.type << ".";
-    return false;
-  }
-
   return true;
 }
 
 bool
 OpenGD77Interface::writeFlash(uint32_t addr, const uint8_t *data, uint16_t len, const ErrorStack &err) {
   WriteRequest req; req.initWriteFlash(addr, data, len);
-  WriteResponse resp;
-
-  if ((8+len) != QSerialPort::write((const char *)&req, 8+len)) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot write to serial port.";
+  if (! send((const char *)&req, 8+len, err))
     return false;
-  }
-
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot read from serial port: Timeout!";
+  if (! receiveWriteResponse(req, _timing.timeout(), err)) {
+    errMsg(err) << "Cannot write to buffer at " << QString::number(addr,16) << "h.";
     return false;
   }
-
-  int retlen = QSerialPort::read((char *)&resp, sizeof(WriteResponse));
-
-  if (0 > retlen) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot write to buffer: Device returned empty message.";
-    return false;
-  }
-
-  if ((req.type != resp.type) || (req.command != resp.command)) {
-    errMsg(err) << "Cannot write to buffer at " << QString::number(addr,16)
-             << ": Device returned error " << resp.type << ".";
-    return false;
-  }
-
   return true;
 }
 
 bool
 OpenGD77Interface::finishWriteFlash(const ErrorStack &err) {
-  //logDebug() << "Send finish write flash command ...";
-  WriteRequest req;
-  req.initFinishWriteFlash();
-  WriteResponse resp;
-
-  if ((2) != QSerialPort::write((const char *)&req, 2)) {
-    errMsg(err) << "Cannot write to serial port.";
+  // Programming the sector takes much longer than a block transfer, use the maximum timeout.
+  WriteRequest req; req.initFinishWriteFlash();
+  if (! send((const char *)&req, 2, err))
     return false;
-  }
-
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << "Cannot read from serial port: Timeout!";
+  if (! receiveWriteResponse(req, _timing.maxTimeout(), err)) {
+    errMsg(err) << "Cannot write to flash.";
     return false;
   }
+  return true;
+}
 
-  int retlen = QSerialPort::read((char *)&resp, sizeof(WriteResponse));
-
-  if (0 > retlen) {
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot write to flash: Device returned empty message.";
-    return false;
+bool
+OpenGD77Interface::readBlocks(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  // Queue all requests back-to-back, then collect the responses in order.
+  for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
+    ReadRequest req;
+    if (EEPROM == bank)
+      req.initReadEEPROM(addr+i, BLOCK_SIZE);
+    else
+      req.initReadFlash(addr+i, BLOCK_SIZE);
+    if (! send((const char *)&req, sizeof(ReadRequest), err))
+      return false;
   }
-
-  if ((req.type != resp.type) || (req.command != resp.command)) {
-    errMsg(err) << "Cannot write to flash: Device returned error " << resp.type << ".";
-    return false;
+  for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
+    if (! receiveReadResponse(BLOCK_SIZE, data+i, err))
+      return false;
   }
-
   return true;
 }
 
 bool
-OpenGD77Interface::sendShowCPSScreen(const ErrorStack &err) {
-  CommandRequest req;
-  uint8_t resp;
-  req.initShowCPSScreen();
-
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
-    errMsg(err) << "Cannot write to serial port.";
-    return false;
-  }
-
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << "Cannot read from serial port: Timeout!";
-    return false;
+OpenGD77Interface::writeBlocks(uint32_t bank, uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err) {
+  // Queue all requests back-to-back, then collect the responses in order.
+  WriteRequest req;
+  for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
+    uint16_t n = std::min(nbytes-i, BLOCK_SIZE);
+    if (EEPROM == bank)
+      req.initWriteEEPROM(addr+i, data+i, n);
+    else
+      req.initWriteFlash(addr+i, data+i, n);
+    if (! send((const char *)&req, 8+n, err))
+      return false;
   }
-
-  int retlen = QSerialPort::read((char *)&resp, 1);
-  if (0 > retlen) {
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot send command: Device returned empty message.";
-    return false;
-  } else if ('-' != resp) {
-    errMsg(err) << "Cannot send command: Device returned unexpected response '" << (char)resp << "'.";
-    return false;
+  for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
+    if (! receiveWriteResponse(req, _timing.timeout(), err)) {
+      if (EEPROM == bank)
+        errMsg(err) << "Cannot write EEPROM at " << QString::number(addr+i, 16) << "h.";
+      else
+        errMsg(err) << "Cannot write to buffer at " << QString::number(addr+i,16) << "h.";
+      return false;
+    }
   }
-
   return true;
 }
 
 bool
-OpenGD77Interface::sendClearScreen(const ErrorStack &err) {
-  CommandRequest req;
-  req.initClearScreen();
-  uint8_t resp;
-
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot write to serial port.";
+OpenGD77Interface::receiveReadResponse(uint16_t len, uint8_t *data, const ErrorStack &err) {
+  ReadResponse resp;
+  if (! receive((char *)&resp, 3, _timing.timeout(), err))
     return false;
-  }
 
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << "Cannot read from serial port: Timeout!";
+  if ('R' != resp.type) {
+    errMsg(err) << "Cannot read from device: Device returned error '" << resp.type << "'.";
     return false;
   }
 
-  int retlen = QSerialPort::read((char *)&resp, 1);
-
-  if (0 > retlen) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot send command: Device returned empty message.";
-    return false;
-  } else if ('-' != resp) {
-    errMsg(err) << "Cannot send command: Device returned unexpected response '" << (char)resp << "'.";
+  if (len != qFromBigEndian(resp.length)) {
+    errMsg(err) << "Cannot read from device: Device returned invalid length "
+                << qFromBigEndian(resp.length) << ".";
     return false;
   }
 
-  return true;
+  return receive((char *)data, len, _timing.timeout(), err);
 }
 
 bool
-OpenGD77Interface::sendDisplay(uint8_t x, uint8_t y, const char *message, uint8_t iSize, uint8_t alignment, uint8_t inverted, const ErrorStack &err) {
-  CommandRequest req;
-  req.initDisplay(x,y, message, iSize, alignment, inverted);
-  uint8_t resp;
-
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
-    errMsg(err) << "Cannot write to serial port.";
-    return false;
-  }
-
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << "Cannot read from serial port: Timeout!";
+OpenGD77Interface::receiveWriteResponse(const WriteRequest &req, int timeout, const ErrorStack &err) {
+  WriteResponse resp;
+  if (! receive((char *)&resp, sizeof(WriteResponse), timeout, err))
     return false;
-  }
-
-  int retlen = QSerialPort::read((char *)&resp, 1);
 
-  if (0 > retlen) {
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot send command: Device returned empty message.";
-    return false;
-  } else if ('-' != resp) {
-    errMsg(err) << "Cannot send command: Device returned unexpected response '" << (char)resp << "'.";
+  if ((req.type != resp.type) || (req.command != resp.command)) {
+    errMsg(err) << "Device returned error " << resp.type << ".";
     return false;
   }
 
@@ -701,31 +706,14 @@ OpenGD77Interface::sendDisplay(uint8_t x, uint8_t y, const char *message, uint8_
 }
 
 bool
-OpenGD77Interface::sendRenderCPS(const ErrorStack &err) {
-  CommandRequest req;
-  req.initRenderCPS();
-
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
-    errMsg(err) << "Cannot write to serial port.";
+OpenGD77Interface::sendCommandRequest(const CommandRequest &req, const ErrorStack &err) {
+  char resp;
+  // Some commands (e.g., saving settings) take a while, hence do not use the adaptive timeout.
+  if (! transceive((const char *) &req, sizeof(CommandRequest), &resp, 1, _timing.maxTimeout(), err))
     return false;
-  }
 
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << "Cannot read from serial port: Timeout!";
-    return false;
-  }
-
-  uint8_t resp;
-  int retlen = QSerialPort::read((char *)&resp, 1);
-
-  if (0 > retlen) {
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot send command: Device returned empty message.";
-    return false;
-  } else if ('-' != resp) {
-    errMsg(err) << "Cannot send command: Device returned unexpected response '" << (char)resp << "'.";
+  if ('-' != resp) {
+    errMsg(err) << "Cannot send command: Device returned unexpected response '" << resp << "'.";
     return false;
   }
 
@@ -733,69 +721,37 @@ OpenGD77Interface::sendRenderCPS(const ErrorStack &err) {
 }
 
 bool
-OpenGD77Interface::sendCloseScreen(const ErrorStack &err) {
-  CommandRequest req; req.initCloseScreen();
-  uint8_t resp;
-
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
-    errMsg(err) << "Cannot write to serial port.";
-    return false;
-  }
+OpenGD77Interface::sendShowCPSScreen(const ErrorStack &err) {
+  CommandRequest req; req.initShowCPSScreen();
+  return sendCommandRequest(req, err);
+}
 
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << "Cannot read from serial port: Timeout!";
-    return false;
-  }
+bool
+OpenGD77Interface::sendClearScreen(const ErrorStack &err) {
+  CommandRequest req; req.initClearScreen();
+  return sendCommandRequest(req, err);
+}
 
-  int retlen = QSerialPort::read((char *)&resp, 1);
+bool
+OpenGD77Interface::sendDisplay(uint8_t x, uint8_t y, const char *message, uint8_t iSize, uint8_t alignment, uint8_t inverted, const ErrorStack &err) {
+  CommandRequest req; req.initDisplay(x,y, message, iSize, alignment, inverted);
+  return sendCommandRequest(req, err);
+}
 
-  if (0 > retlen) {
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot send command: Device returned empty message.";
-    return false;
-  } else if ('-' != resp) {
-    errMsg(err) << "Cannot send command: Device returned unexpected response '" << (char)resp << "'.";
-    return false;
-  }
+bool
+OpenGD77Interface::sendRenderCPS(const ErrorStack &err) {
+  CommandRequest req; req.initRenderCPS();
+  return sendCommandRequest(req, err);
+}
 
-  return true;
+bool
+OpenGD77Interface::sendCloseScreen(const ErrorStack &err) {
+  CommandRequest req; req.initCloseScreen();
+  return sendCommandRequest(req, err);
 }
 
 bool
 OpenGD77Interface::sendCommand(CommandRequest::Option option, const ErrorStack &err) {
   CommandRequest req; req.initCommand(option);
-  uint8_t resp;
-
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
-    errMsg(err) << "Cannot write to serial port.";
-    return false;
-  }
-
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << "Cannot read from serial port: Timeout!";
-    return false;
-  }
-
-  int retlen = QSerialPort::read((char *)&resp, 1);
-
-  if (0 > retlen) {
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot send command: Device returned empty message.";
-    return false;
-  } else if ('-' != resp) {
-    errMsg(err) << "Cannot send command: Device returned unexpected response '" << (char)resp << "'.";
-    return false;
-  }
-
-  return true;
+  return sendCommandRequest(req, err);
 }
-
-
-
-
-
-
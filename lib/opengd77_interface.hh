@@ -3,6 +3,8 @@
 
 #include "usbserial.hh"
 #include "errorstack.hh"
+#include <QHash>
+#include <QBitArray>
 
 /** Implements the interfact to a radio running the Open GD77 firmware.
  *
@@ -45,6 +47,15 @@ public:
 
   bool reboot(const ErrorStack &err=ErrorStack());
 
+  /** Enables or disables skipping unchanged flash sectors. If enabled, flash writes are collected
+   * per sector. Before a sector gets erased and programmed, its current content is compared to
+   * the new data and the sector is skipped if nothing changed. The current content is taken from
+   * the flash memory read during this session or read back from the device. Must be called
+   * before a transfer is started, as it clears all remembered flash content. */
+  void setSkipUnchanged(bool enabled);
+  /** Returns @c true, if unchanged flash sectors are skipped. */
+  bool skipUnchanged() const;
+
 public:
   /** Returns some information about this interface. */
   static USBDeviceInfo interfaceInfo();
@@ -237,9 +248,59 @@ protected:
   /** Sends some command message with the given options. */
   bool sendCommand(CommandRequest::Option option, const ErrorStack &err=ErrorStack());
 
+  /** Reads several consecutive blocks from the given bank. All requests are queued back-to-back
+   * before the responses are collected. */
+  bool readBlocks(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  /** Writes several consecutive blocks into the EEPROM or the current Flash sector buffer. All
+   * requests are queued back-to-back before the responses are collected. */
+  bool writeBlocks(uint32_t bank, uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  /** Receives and checks a read response carrying @c len bytes of payload. */
+  bool receiveReadResponse(uint16_t len, uint8_t *data, const ErrorStack &err=ErrorStack());
+  /** Receives and checks the response to the given write request within @c timeout ms. */
+  bool receiveWriteResponse(const WriteRequest &req, int timeout, const ErrorStack &err=ErrorStack());
+  /** Sends the given command message and checks the response. */
+  bool sendCommandRequest(const CommandRequest &req, const ErrorStack &err=ErrorStack());
+
+  /** Writes the given data into the Flash sector buffer of the device. Selects and finalizes the
+   * sectors as needed. */
+  bool programFlash(uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  /** Collects the given data for the current Flash sector. */
+  bool stageFlash(uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  /** Compares the collected data with the current sector content and programs the sector, if
+   * anything changed. */
+  bool flushFlash(const ErrorStack &err=ErrorStack());
+  /** Remembers the given Flash memory content. Only complete blocks are remembered. */
+  void rememberFlash(uint32_t addr, const uint8_t *data, int nbytes);
+
+protected:
+  /** Known content of a single Flash sector. */
+  struct KnownSector {
+    /** The sector content. */
+    QByteArray data;
+    /** Marks the blocks of the sector with known content. */
+    QBitArray valid;
+  };
+
 protected:
   /** The current Flash sector, set to -1 if none is currently selected. */
   int32_t _sector;
+  /** Number of block requests queued before collecting responses. Falls back to 1 (lock-step) if
+   * the device fails to keep up with pipelined requests. */
+  unsigned _window;
+  /** If @c true, unchanged Flash sectors are skipped. */
+  bool _skipUnchanged;
+  /** The Flash sector, data is currently collected for. Set to -1 if none. */
+  int32_t _stagedSector;
+  /** The data collected for the staged sector. */
+  QByteArray _stagedData;
+  /** Marks the blocks of the staged sector that got written. */
+  QBitArray _stagedBlocks;
+  /** The Flash content read or written during this session, indexed by sector. */
+  QHash<int32_t, KnownSector> _knownFlash;
+  /** Number of Flash sectors programmed. */
+  unsigned _sectorsWritten;
+  /** Number of unchanged Flash sectors skipped. */
+  unsigned _sectorsSkipped;
 };
 
 #endif // OPENGD77INTERFACE_HH
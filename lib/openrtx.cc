@@ -6,6 +6,8 @@
 
 
 #define BSIZE 32
+/** Size of the blocks read back for verification. */
+#define RBSIZE 1024
 
 OpenRTX::OpenRTX(OpenRTXInterface *device, QObject *parent)
   : Radio(parent), _name("Open RTX"), _dev(device), _config(nullptr), _codeplug()
@@ -28,6 +30,17 @@ OpenRTX::~OpenRTX() {
   }
 }
 
+void
+OpenRTX::moveInterfaceToThread(QThread *thread) {
+  if (_dev)
+    _dev->moveToThread(thread);
+}
+
+RadioInterface *
+OpenRTX::radioInterface() const {
+  return _dev;
+}
+
 const QString &
 OpenRTX::name() const {
   return _name;
@@ -206,6 +219,7 @@ OpenRTX::download(const ErrorStack &err)
   }
 
   size_t totb = _codeplug.memSize();
+  enterPhase(PhaseRead, totb);
 
   if (! _dev->read_start(0, 0, err)) {
     errMsg(err) << "Cannot start codeplug download.";
@@ -229,7 +243,7 @@ OpenRTX::download(const ErrorStack &err)
           return false;
         }
         QThread::usleep(100);
-        emit downloadProgress(float(bcount*100)/totb);
+        reportDownloadProgress(float(bcount*100)/totb);
       }
     }
     _dev->read_finish(err);
@@ -257,6 +271,7 @@ OpenRTX::upload(const ErrorStack &err)
   }
 
   size_t totb = _codeplug.memSize();
+  enterPhase(PhaseRead, totb);
 
   if (! _dev->read_start(0, 0, err)) {
     errMsg(err) << "Cannot start codeplug download.";
@@ -278,21 +293,25 @@ OpenRTX::upload(const ErrorStack &err)
           return false;
         }
         QThread::usleep(100);
-        emit uploadProgress(float(bcount*50)/totb);
+        reportUploadProgress(float(bcount*50)/totb);
       }
     }
     _dev->read_finish(err);
   }
 
   // Encode config into codeplug
+  enterPhase(PhaseEncode);
   _codeplug.encode(_config, Codeplug::Flags(), err);
 
+  enterPhase(PhaseWrite, totb);
   if (! _dev->write_start(0,0, err)) {
     errMsg(err) << "Cannot start codeplug upload.";
     return false;
   }
 
   // Then upload codeplug
+  _readback.reset();
+  _readback.setBlockSize(RBSIZE);
   for (int image=0; image<_codeplug.numImages(); image++) {
     uint32_t bank = 0;
 
@@ -306,13 +325,38 @@ OpenRTX::upload(const ErrorStack &err)
           errMsg(err) << "Cannot write block " << (b0+b) << ".";
           return false;
         }
+        _readback.add(bank, (b0+b)*BSIZE, _codeplug.data((b0+b)*BSIZE, image), BSIZE);
         QThread::usleep(100);
-        emit uploadProgress(float(bcount*50)/totb);
+        reportUploadProgress(float(bcount*50)/totb);
       }
     }
     _dev->write_finish(err);
   }
 
+  if (! verifyUpload(err)) {
+    errMsg(err) << "Cannot verify codeplug.";
+    return false;
+  }
+
   return true;
 }
 
+bool
+OpenRTX::verifyUpload(const ErrorStack &err) {
+  if (! _readback.isEnabled())
+    return true;
+
+  logDebug() << "Read back " << _readback.numBlocks() << " written blocks from " << name() << ".";
+  enterPhase(PhaseVerify);
+  if (! _dev->read_start(0, 0, err)) {
+    errMsg(err) << "Cannot start readback.";
+    return false;
+  }
+  bool ok = _readback.verify(
+        [this](uint32_t bank, uint32_t addr, uint8_t *data, int n, const ErrorStack &err) {
+          return _dev->read(bank, addr, data, n, err);
+        }, err);
+  _dev->read_finish(err);
+  return ok;
+}
+
@@ -45,6 +45,8 @@ public slots:
                              const ErrorStack &err=ErrorStack());
 
 protected:
+  void moveInterfaceToThread(QThread *thread);
+  RadioInterface *radioInterface() const;
   /** Thread main routine, performs all blocking IO operations for codeplug up- and download. */
 	void run();
 
@@ -55,6 +57,8 @@ protected:
   bool download(const ErrorStack &err=ErrorStack());
   /** Implements the actual codeplug upload process. */
   bool upload(const ErrorStack &err=ErrorStack());
+  /** Reads back the written blocks, if the readback verification is enabled. */
+  bool verifyUpload(const ErrorStack &err=ErrorStack());
 
 protected:
   /** The device identifier. */
@@ -8,7 +8,9 @@
 #include "zone.hh"
 #include "config.hh"
 #include "config.h"
+#include "tracer.hh"
 #include <QtEndian>
+#include "stringpool.hh"
 
 QVector<unsigned int> _openrtx_ctcss_tone_table{
     670, 693, 719, 744, 770, 797, 825, 854, 885, 915, 948, 974, 1000, 1034,
@@ -931,7 +933,7 @@ OpenRTXCodeplug::ZoneElement::fromZoneObjB(const Zone *zone, Context &ctx) {
  * Implementation of OpenRTXCodeplug
  * ********************************************************************************************* */
 OpenRTXCodeplug::OpenRTXCodeplug(QObject *parent)
-  : Codeplug(parent)
+  : Codeplug(parent), _layout()
 {
   addImage("OpenRTX codeplug v0.1");
   image(0).addElement(0x0000, HeaderSize);
@@ -946,10 +948,74 @@ OpenRTXCodeplug::clear() {
   remImage(0);
   addImage("OpenRTX codeplug v0.1");
   image(0).addElement(0x0000, HeaderSize);
+  _layout = Layout();
+}
+
+const OpenRTXCodeplug::Layout &
+OpenRTXCodeplug::layout() {
+  if (_layout.valid)
+    return _layout;
+
+  HeaderElement header(data(0x0000));
+  _layout.numContacts = header.contactCount();
+  _layout.numChannels = header.channelCount();
+  _layout.contacts    = HeaderSize;
+  _layout.channels    = _layout.contacts + _layout.numContacts*ContactSize;
+  _layout.zoneOffsets = _layout.channels + _layout.numChannels*ChannelSize;
+  _layout.zones.resize(header.zoneCount());
+  _layout.size = _layout.zoneOffsets + _layout.zones.size()*sizeof(uint32_t);
+  if (_layout.zones.size()) {
+    const uint32_t *offsets = (const uint32_t *)data(_layout.zoneOffsets);
+    for (int i=0; i<_layout.zones.size(); i++)
+      _layout.zones[i] = qFromLittleEndian(offsets[i]);
+  }
+  _layout.valid = true;
+
+  return _layout;
+}
+
+void
+OpenRTXCodeplug::allocate(Config *config, Context &ctx) {
+  Layout layout;
+  layout.numContacts = ctx.count<DMRContact>();
+  layout.numChannels = config->channelList()->count();
+  layout.contacts    = HeaderSize;
+  layout.channels    = layout.contacts + layout.numContacts*ContactSize;
+  layout.zoneOffsets = layout.channels + layout.numChannels*ChannelSize;
+
+  // Zones A and, if not empty, B are stored as separate zones
+  unsigned int zoneCount = 0;
+  for (int i=0; i<config->zones()->count(); i++)
+    zoneCount += (config->zones()->zone(i)->B()->count() ? 2 : 1);
+  uint32_t offset = layout.zoneOffsets + zoneCount*sizeof(uint32_t);
+  for (int i=0; i<config->zones()->count(); i++) {
+    Zone *zone = config->zones()->zone(i);
+    layout.zones.append(offset);
+    offset += ZoneHeaderSize + zone->A()->count()*sizeof(uint32_t);
+    if (zone->B()->count()) {
+      layout.zones.append(offset);
+      offset += ZoneHeaderSize + zone->B()->count()*sizeof(uint32_t);
+    }
+  }
+  layout.size = offset;
+  layout.valid = true;
+
+  // Allocate the entire codeplug as a single element
+  remImage(0);
+  addImage("OpenRTX codeplug v0.1");
+  image(0).addElement(0x0000, layout.size);
+  _layout = layout;
+
+  HeaderElement header(data(0x0000));
+  header.clear();
+  header.setContactCount(layout.numContacts);
+  header.setChannelCount(layout.numChannels);
+  header.setZoneCount(layout.zones.size());
 }
 
 bool
 OpenRTXCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) const {
+  TRACE_SPAN("OpenRTXCodeplug::index", "codeplug");
   Q_UNUSED(err)
 
   // All indices as 1-based. That is, the first channel gets index 1 etc.
@@ -974,6 +1040,7 @@ OpenRTXCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) cons
 
 bool
 OpenRTXCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
+  TRACE_SPAN("OpenRTXCodeplug::encode", "codeplug");
   // Check if default DMR id is set.
   if (nullptr == config->settings()->defaultIdRef()) {
     errMsg(err) << "Cannot encode TyT codeplug: No default radio ID specified.";
@@ -990,8 +1057,10 @@ OpenRTXCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &er
 
 bool
 OpenRTXCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("OpenRTXCodeplug::encodeElements", "codeplug");
+  // Lay out the entire codeplug at once, the sections are then written sequentially
+  allocate(ctx.config(), ctx);
   HeaderElement header(data(0));
-  header.clear();
   header.setAuthor(ctx.config()->settings()->defaultId()->name());
   header.setDescription("Encoded by qdmr v" VERSION_STRING);
 
@@ -1016,6 +1085,9 @@ OpenRTXCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorSta
 
 bool
 OpenRTXCodeplug::decode(Config *config, const ErrorStack &err) {
+  TRACE_SPAN("OpenRTXCodeplug::decode", "codeplug");
+  // Names decoded repeatedly share their storage
+  StringPool::Scope strings;
   // Clear config object
   config->clear();
 
@@ -1027,6 +1099,10 @@ OpenRTXCodeplug::decode(Config *config, const ErrorStack &err) {
 
 bool
 OpenRTXCodeplug::decodeElements(Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("OpenRTXCodeplug::decodeElements", "codeplug");
+  // Rebuild the layout from the header of the read codeplug
+  _layout.valid = false;
+
   if (! this->createContacts(ctx.config(), ctx, err)) {
     errMsg(err) << "Cannot create contacts.";
     return false;
@@ -1057,12 +1133,12 @@ OpenRTXCodeplug::decodeElements(Context &ctx, const ErrorStack &err) {
 
 unsigned int
 OpenRTXCodeplug::numContacts() {
-  return HeaderElement(data(0x0000)).contactCount();
+  return layout().numContacts;
 }
 
 unsigned int
 OpenRTXCodeplug::offsetContact(unsigned int n) {
-  return HeaderSize + n*ContactSize;
+  return layout().contacts + n*ContactSize;
 }
 
 bool
@@ -1070,17 +1146,15 @@ OpenRTXCodeplug::encodeContacts(Config *config, const Flags &flags, Context &ctx
   Q_UNUSED(flags)
 
   /// @todo Limit number of contacts.
-  unsigned int numContacts = ctx.count<DMRContact>();
-  HeaderElement(data(0x0000)).setContactCount(numContacts);
-  image(0).addElement(offsetContact(0), numContacts*ContactSize);
-
-  for (int i=0,c=0; i<config->contacts()->count(); i++) {
+  // Contacts are written sequentially into the allocated section
+  uint8_t *ptr = data(offsetContact(0));
+  for (int i=0; i<config->contacts()->count(); i++) {
     if (! config->contacts()->contact(i)->is<DMRContact>())
       continue;
-    ContactElement contact(data(offsetContact(c)));
+    ContactElement contact(ptr);
     contact.fromContactObj(
           config->contacts()->contact(i)->as<DMRContact>(), ctx, err);
-    c++;
+    ptr += ContactSize;
   }
 
   return true;
@@ -1088,10 +1162,13 @@ OpenRTXCodeplug::encodeContacts(Config *config, const Flags &flags, Context &ctx
 
 bool
 OpenRTXCodeplug::createContacts(Config *config, Context &ctx, const ErrorStack &err) {
-  unsigned int numContacts = HeaderElement(data(0x0000)).contactCount();
+  unsigned int numContacts = this->numContacts();
+  if (0 == numContacts)
+    return true;
 
-  for (unsigned int i=0; i<numContacts; i++) {
-    DMRContact *contact = ContactElement(data(offsetContact(i))).toContactObj(ctx, err);
+  const uint8_t *ptr = data(offsetContact(0));
+  for (unsigned int i=0; i<numContacts; i++, ptr+=ContactSize) {
+    DMRContact *contact = ContactElement((uint8_t *)ptr).toContactObj(ctx, err);
     if (nullptr == contact) {
       errMsg(err) << "Cannot create " << (i+1) << "-th contact.";
       return false;
@@ -1106,13 +1183,12 @@ OpenRTXCodeplug::createContacts(Config *config, Context &ctx, const ErrorStack &
 
 unsigned int
 OpenRTXCodeplug::numChannels() {
-  return HeaderElement(data(0x0000)).channelCount();
+  return layout().numChannels;
 }
 
 unsigned int
 OpenRTXCodeplug::offsetChannel(unsigned int n) {
-  unsigned int numContacts = HeaderElement(data(0x0000)).contactCount();
-  return HeaderSize + numContacts*ContactSize + n*ChannelSize;
+  return layout().channels + n*ChannelSize;
 }
 
 bool
@@ -1120,12 +1196,10 @@ OpenRTXCodeplug::encodeChannels(Config *config, const Flags &flags, Context &ctx
   Q_UNUSED(flags)
 
   /// @todo Limit number of channels.
-  unsigned int numChannels = config->channelList()->count();
-  HeaderElement(data(0x0000)).setChannelCount(numChannels);
-  image(0).addElement(offsetChannel(0), numChannels*ChannelSize);
-
-  for (int i=0; i<config->channelList()->count(); i++) {
-    ChannelElement ch(data(offsetChannel(i)));
+  // Channels are written sequentially into the allocated section
+  uint8_t *ptr = data(offsetChannel(0));
+  for (int i=0; i<config->channelList()->count(); i++, ptr+=ChannelSize) {
+    ChannelElement ch(ptr);
     if (! ch.fromChannelObj(config->channelList()->channel(i), ctx, err)) {
       errMsg(err) << "Cannot encode " << (i+1) << "-th channel '"
                   << config->channelList()->channel(i)->name() << "'.";
@@ -1139,10 +1213,13 @@ OpenRTXCodeplug::encodeChannels(Config *config, const Flags &flags, Context &ctx
 
 bool
 OpenRTXCodeplug::createChannels(Config *config, Context &ctx, const ErrorStack &err) {
-  unsigned int numChannels = HeaderElement(data(0x0000)).channelCount();
-  unsigned int offsetChannels = offsetChannel(0);
-  for (unsigned int i=0; i<numChannels; i++) {
-    ChannelElement ch(data(offsetChannels + i*ChannelSize));
+  unsigned int numChannels = this->numChannels();
+  if (0 == numChannels)
+    return true;
+
+  uint8_t *ptr = data(offsetChannel(0));
+  for (unsigned int i=0; i<numChannels; i++, ptr+=ChannelSize) {
+    ChannelElement ch(ptr);
     Channel *chObj = ch.toChannelObj(ctx, err);
     if (nullptr == chObj) {
       errMsg(err) << "Cannot decode " << (i+1) << "-th channel.";
@@ -1157,10 +1234,13 @@ OpenRTXCodeplug::createChannels(Config *config, Context &ctx, const ErrorStack &
 
 bool
 OpenRTXCodeplug::linkChannels(Config *config, Context &ctx, const ErrorStack &err) {
-  unsigned int numChannels = HeaderElement(data(0x0000)).channelCount();
-  unsigned int offsetChannels = offsetChannel(0);
-  for (unsigned int i=0; i<numChannels; i++) {
-    ChannelElement ch(data(offsetChannels + i*ChannelSize));
+  unsigned int numChannels = this->numChannels();
+  if (0 == numChannels)
+    return true;
+
+  uint8_t *ptr = data(offsetChannel(0));
+  for (unsigned int i=0; i<numChannels; i++, ptr+=ChannelSize) {
+    ChannelElement ch(ptr);
     Channel *chObj = config->channelList()->channel(i);
     if (! ch.linkChannelObj(chObj, ctx, err)) {
       errMsg(err) << "Cannot link " << (i+1) << "-th channel "
@@ -1175,62 +1255,39 @@ OpenRTXCodeplug::linkChannels(Config *config, Context &ctx, const ErrorStack &er
 
 unsigned int
 OpenRTXCodeplug::numZones() {
-  return HeaderElement(data(0x0000)).zoneCount();
+  return layout().zones.size();
 }
 
 unsigned int
 OpenRTXCodeplug::offsetZoneOffsets() {
-  HeaderElement header(data(0x0000));
-  unsigned int numContacts = header.contactCount();
-  unsigned int numChannels = header.channelCount();
-  return  HeaderSize + numContacts*ContactSize + numChannels*ChannelSize;
+  return layout().zoneOffsets;
 }
 
 unsigned int
 OpenRTXCodeplug::offsetZone(unsigned int n) {
-  HeaderElement header(data(0x0000));
-  unsigned int numContacts = header.contactCount();
-  unsigned int numChannels = header.channelCount();
-  uint32_t *ptr = (uint32_t *)data(HeaderSize + numContacts*ContactSize + numChannels*ChannelSize
-                                   + n*sizeof(uint32_t));
-  return qFromLittleEndian(*ptr);
+  return layout().zones.at(n);
 }
 
 bool
 OpenRTXCodeplug::encodeZones(Config *config, const Flags &flags, Context &ctx, const ErrorStack &err) {
   Q_UNUSED(flags); Q_UNUSED(err)
 
-  // Count zones (A + B)
-  unsigned int zoneCount=0;
-  for (int i=0; i<config->zones()->count(); i++) {
-    zoneCount++;
-    // Check if B contains channels
-    if (config->zones()->zone(i)->B()->count())
-      zoneCount++;
-  }
+  unsigned int zoneCount = numZones();
+  if (0 == zoneCount)
+    return true;
 
-  // Allocate zone offsets
-  HeaderElement(data(0x0000)).setZoneCount(zoneCount);
-  image(0).addElement(offsetZoneOffsets(), zoneCount*sizeof(uint32_t));
+  // Zones follow the offset table and are written sequentially
   uint32_t *offsets = (uint32_t *)data(offsetZoneOffsets());
-
-  // Allocate and encode zones
-  uint32_t currentOffset = offsetZoneOffsets() + zoneCount*sizeof(uint32_t);
+  uint8_t *base = data(0x0000);
   for (unsigned int z=0, i=0; i<zoneCount; i++,z++) {
-    // Allocate & encode zone A
-    unsigned int zoneSize = ZoneHeaderSize+config->zones()->zone(z)->A()->count()*sizeof(uint32_t);
-    image(0).addElement(currentOffset, zoneSize);
-    offsets[i] = qToLittleEndian(currentOffset);
-    ZoneElement(data(currentOffset)).fromZoneObjA(config->zones()->zone(z), ctx);
-    currentOffset += zoneSize;
-    // Allocate & encode zone B, if not empty
-    if (ZoneHeaderSize+config->zones()->zone(z)->B()->count()) {
+    // Encode zone A
+    offsets[i] = qToLittleEndian(uint32_t(offsetZone(i)));
+    ZoneElement(base + offsetZone(i)).fromZoneObjA(config->zones()->zone(z), ctx);
+    // Encode zone B, if not empty
+    if (config->zones()->zone(z)->B()->count()) {
       i++;
-      unsigned int zoneSize = ZoneHeaderSize+config->zones()->zone(z)->B()->count()*sizeof(uint32_t);
-      image(0).addElement(currentOffset, zoneSize);
-      offsets[i] = qToLittleEndian(currentOffset);
-      ZoneElement(data(currentOffset)).fromZoneObjB(config->zones()->zone(z), ctx);
-      currentOffset += zoneSize;
+      offsets[i] = qToLittleEndian(uint32_t(offsetZone(i)));
+      ZoneElement(base + offsetZone(i)).fromZoneObjB(config->zones()->zone(z), ctx);
     }
   }
 
@@ -1241,11 +1298,10 @@ bool
 OpenRTXCodeplug::createZones(Config *config, Context &ctx, const ErrorStack &err) {
   Q_UNUSED(err)
   unsigned int zoneCount = numZones();
-  uint32_t *zoneOffsets = (uint32_t *) data(offsetZoneOffsets());
 
   Zone *last_zone = nullptr;
   for (unsigned int i=0; i<zoneCount; i++) {
-    ZoneElement zone(data(qFromLittleEndian(zoneOffsets[i])));
+    ZoneElement zone(data(offsetZone(i)));
     if (! zone.isValid())
       continue;
     bool is_ext = (nullptr != last_zone) && (zone.name().endsWith(" B")) &&
@@ -1267,11 +1323,10 @@ OpenRTXCodeplug::linkZones(Config *config, Context &ctx, const ErrorStack &err)
   Q_UNUSED(config); Q_UNUSED(err)
 
   unsigned int zoneCount = numZones();
-  uint32_t *zoneOffsets = (uint32_t *) data(offsetZoneOffsets());
 
   Zone *last_zone = nullptr;
   for (unsigned int i=0, z=0; i<zoneCount; i++, z++) {
-    ZoneElement zone(data(qFromLittleEndian(zoneOffsets[i])));
+    ZoneElement zone(data(offsetZone(i)));
     if (! zone.isValid())
       continue;
     if (ctx.has<Zone>(i+1)) {
@@ -481,11 +481,34 @@ public:
   /** Links all zones within the configuration. */
   virtual bool linkZones(Config *config, Context &ctx, const ErrorStack &err=ErrorStack());
 
+protected:
+  /** Offsets of the variable-sized sections of the codeplug. */
+  struct Layout {
+    bool valid = false;             ///< If @c false, the layout must be rebuilt from the header.
+    unsigned int numContacts = 0;   ///< Number of contacts.
+    unsigned int numChannels = 0;   ///< Number of channels.
+    unsigned int contacts = 0;      ///< Offset of the first contact.
+    unsigned int channels = 0;      ///< Offset of the first channel.
+    unsigned int zoneOffsets = 0;   ///< Offset of the zone offset table.
+    QVector<uint32_t> zones;        ///< Offsets of all zones.
+    unsigned int size = 0;          ///< Total size of the codeplug.
+  };
+
+  /** Returns the layout of the codeplug. It is built once from the header and the zone offset
+   * table, or when the codeplug gets laid out for encoding. */
+  const Layout &layout();
+  /** Lays out the codeplug for the given configuration and allocates it as a single contiguous
+   * element. The header is cleared. */
+  void allocate(Config *config, Context &ctx);
+
 protected:
   /** Just stores some sizes. */
   enum Offsets {
     HeaderSize = 0x58, ChannelSize = 0x5a, ContactSize = 0x27, ZoneHeaderSize=0x22
   };
+
+  /** The cached layout. */
+  Layout _layout;
 };
 
 #endif // OPENRTX_CODEPLUG_HH
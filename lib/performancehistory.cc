@@ -0,0 +1,367 @@
+#include "performancehistory.hh"
+#include "radio.hh"
+#include "memoryusage.hh"
+#include "logger.hh"
+#include "config.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <algorithm>
+
+
+/** Returns the median of the given values, 0 if there are none. */
+static double
+median(QVector<double> values) {
+  if (values.isEmpty())
+    return 0;
+  int idx = values.size()/2;
+  std::nth_element(values.begin(), values.begin()+idx, values.end());
+  return values.at(idx);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of PerformanceHistory::Record
+ * ********************************************************************************************* */
+PerformanceHistory::Record::Record()
+  : timestamp(), application(), version(), radio(), operation(), success(false), bytesRead(0),
+    bytesWritten(0), roundTrips(0), retries(0), transferTime(0), setupTime(0), latency(0),
+    linkMode(), phases(), peakResident(0)
+{
+  // pass...
+}
+
+qint64
+PerformanceHistory::Record::duration() const {
+  qint64 duration = 0;
+  for (const QPair<QString, qint64> &phase: phases)
+    duration += phase.second;
+  return duration;
+}
+
+double
+PerformanceHistory::Record::throughput() const {
+  if (0 >= transferTime)
+    return 0;
+  return double(bytesRead+bytesWritten)/(double(transferTime)/1e6);
+}
+
+QJsonObject
+PerformanceHistory::Record::toJson() const {
+  QJsonObject obj{
+    {"time", timestamp.toString(Qt::ISODate)}, {"app", application}, {"version", version},
+    {"radio", radio}, {"op", operation}, {"ok", success}, {"read", double(bytesRead)},
+    {"written", double(bytesWritten)}, {"trips", double(roundTrips)}, {"retries", double(retries)},
+    {"transfer", double(transferTime)}, {"setup", double(setupTime)}, {"latency", double(latency)},
+    {"rss", double(peakResident)}};
+  if (! linkMode.isEmpty())
+    obj["link"] = linkMode;
+  QJsonObject ph;
+  for (const QPair<QString, qint64> &phase: phases)
+    ph[phase.first] = double(phase.second);
+  obj["phases"] = ph;
+  return obj;
+}
+
+bool
+PerformanceHistory::Record::fromJson(const QJsonObject &obj, Record &record) {
+  if ((! obj.contains("time")) || (! obj.contains("op")))
+    return false;
+  record.timestamp = QDateTime::fromString(obj["time"].toString(), Qt::ISODate);
+  if (! record.timestamp.isValid())
+    return false;
+  record.application = obj["app"].toString();
+  record.version = obj["version"].toString();
+  record.radio = obj["radio"].toString();
+  record.operation = obj["op"].toString();
+  record.success = obj["ok"].toBool();
+  record.bytesRead = quint64(obj["read"].toDouble());
+  record.bytesWritten = quint64(obj["written"].toDouble());
+  record.roundTrips = unsigned(obj["trips"].toDouble());
+  record.retries = unsigned(obj["retries"].toDouble());
+  record.transferTime = qint64(obj["transfer"].toDouble());
+  record.setupTime = qint64(obj["setup"].toDouble());
+  record.latency = qint64(obj["latency"].toDouble());
+  record.linkMode = obj["link"].toString();
+  record.peakResident = quint64(obj["rss"].toDouble());
+  record.phases.clear();
+  QJsonObject ph = obj["phases"].toObject();
+  for (QJsonObject::const_iterator it=ph.constBegin(); it!=ph.constEnd(); it++)
+    record.phases.append(QPair<QString, qint64>(it.key(), qint64(it.value().toDouble())));
+  return true;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of PerformanceHistory::Recorder
+ * ********************************************************************************************* */
+PerformanceHistory::Recorder::Recorder()
+  : _operation(), _radio(nullptr), _connection(), _phase(), _timer(), _phases()
+{
+  // pass...
+}
+
+PerformanceHistory::Recorder::~Recorder() {
+  detach();
+}
+
+void
+PerformanceHistory::Recorder::start(const QString &operation) {
+  detach();
+  _operation = operation;
+  _phase = "connect";
+  _phases.clear();
+  _timer.start();
+}
+
+void
+PerformanceHistory::Recorder::attach(Radio *radio) {
+  detach();
+  _radio = radio;
+  if (nullptr == _radio)
+    return;
+  // Gets called from within the thread of the radio, the phases are only read once finished.
+  _connection = QObject::connect(radio, &Radio::phaseChanged, [this](Radio::Phase phase, quint64) {
+    switch (phase) {
+    case Radio::PhaseRead: enterPhase("read"); break;
+    case Radio::PhaseEncode: enterPhase("encode"); break;
+    case Radio::PhaseWrite: enterPhase("write"); break;
+    case Radio::PhaseVerify: enterPhase("verify"); break;
+    }
+  });
+}
+
+void
+PerformanceHistory::Recorder::enterPhase(const QString &name) {
+  if (! isRunning())
+    return;
+  qint64 duration = _timer.restart();
+  // A phase may be entered several times (e.g., writing a codeplug in several segments)
+  bool found = false;
+  for (int i=0; (i<_phases.size()) && (! found); i++) {
+    if (_phases[i].first == _phase) {
+      _phases[i].second += duration;
+      found = true;
+    }
+  }
+  if (! found)
+    _phases.append(QPair<QString, qint64>(_phase, duration));
+  _phase = name;
+}
+
+bool
+PerformanceHistory::Recorder::isRunning() const {
+  return ! _operation.isEmpty();
+}
+
+PerformanceHistory::Record
+PerformanceHistory::Recorder::finish(bool success) {
+  Record record;
+  if (! isRunning())
+    return record;
+
+  enterPhase(QString());
+  record.timestamp = QDateTime::currentDateTime();
+  record.application = QCoreApplication::applicationName();
+  record.version = VERSION_STRING;
+  record.operation = _operation;
+  record.success = success;
+  record.phases = _phases;
+  record.peakResident = MemoryUsage::peakResident();
+  if (_radio) {
+    TransferStatistics stats = _radio->transferStatistics();
+    record.radio = _radio->name();
+    record.bytesRead = stats.bytesRead();
+    record.bytesWritten = stats.bytesWritten();
+    record.roundTrips = stats.roundTrips();
+    record.retries = stats.retries();
+    record.transferTime = stats.transferTime();
+    record.setupTime = stats.setupTime();
+    record.latency = stats.latency(0.5);
+    record.linkMode = stats.linkMode();
+  }
+
+  detach();
+  _operation.clear();
+  return record;
+}
+
+void
+PerformanceHistory::Recorder::detach() {
+  if (_connection)
+    QObject::disconnect(_connection);
+  _connection = QMetaObject::Connection();
+  _radio = nullptr;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of PerformanceHistory
+ * ********************************************************************************************* */
+PerformanceHistory::PerformanceHistory(const QString &filename)
+  : _filename(filename)
+{
+  if (_filename.isEmpty())
+    _filename = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+        .filePath("performance.jsonl");
+}
+
+const QString &
+PerformanceHistory::filename() const {
+  return _filename;
+}
+
+bool
+PerformanceHistory::append(const Record &record, const ErrorStack &err) const {
+  QDir().mkpath(QFileInfo(_filename).absolutePath());
+  QFile file(_filename);
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    errMsg(err) << "Cannot open performance history '" << _filename << "': "
+                << file.errorString() << ".";
+    return false;
+  }
+  QByteArray line = QJsonDocument(record.toJson()).toJson(QJsonDocument::Compact) + "\n";
+  if (line.size() != file.write(line)) {
+    errMsg(err) << "Cannot append to performance history '" << _filename << "': "
+                << file.errorString() << ".";
+    return false;
+  }
+  qint64 size = file.size();
+  file.close();
+
+  if (size > MAX_SIZE)
+    return truncate(err);
+  return true;
+}
+
+bool
+PerformanceHistory::read(QVector<Record> &records, const ErrorStack &err) const {
+  QFile file(_filename);
+  if (! file.exists())
+    return true;
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open performance history '" << _filename << "': "
+                << file.errorString() << ".";
+    return false;
+  }
+
+  unsigned lineNo = 0;
+  while (! file.atEnd()) {
+    QByteArray line = file.readLine().trimmed(); lineNo++;
+    if (line.isEmpty())
+      continue;
+    Record record;
+    QJsonDocument doc = QJsonDocument::fromJson(line);
+    if ((! doc.isObject()) || (! Record::fromJson(doc.object(), record))) {
+      logDebug() << "Skip malformed record in line " << lineNo << " of '" << _filename << "'.";
+      continue;
+    }
+    records.append(record);
+  }
+  return true;
+}
+
+bool
+PerformanceHistory::truncate(const ErrorStack &err) const {
+  QFile file(_filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open performance history '" << _filename << "': "
+                << file.errorString() << ".";
+    return false;
+  }
+  QList<QByteArray> lines = file.readAll().split('\n');
+  file.close();
+  lines.removeAll(QByteArray());
+
+  QSaveFile out(_filename);
+  if (! out.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot truncate performance history '" << _filename << "': "
+                << out.errorString() << ".";
+    return false;
+  }
+  for (int i=lines.size()/2; i<lines.size(); i++)
+    out.write(lines[i] + "\n");
+  if (! out.commit()) {
+    errMsg(err) << "Cannot truncate performance history '" << _filename << "': "
+                << out.errorString() << ".";
+    return false;
+  }
+  logDebug() << "Dropped " << lines.size()/2 << " records from performance history.";
+  return true;
+}
+
+QString
+PerformanceHistory::summarize(const QVector<Record> &records) {
+  struct Group {
+    QString radio, operation, version;
+    unsigned runs, failed;
+    QVector<double> durations, throughputs, latencies, memory;
+    QDateTime last;
+  };
+
+  // Group in order of the first record
+  QVector<Group> groups;
+  QHash<QString, int> index;
+  foreach (const Record &record, records) {
+    QString key = record.radio + "\n" + record.operation + "\n" + record.version;
+    if (! index.contains(key)) {
+      index.insert(key, groups.size());
+      groups.append(Group{record.radio, record.operation, record.version, 0, 0,
+                          QVector<double>(), QVector<double>(), QVector<double>(),
+                          QVector<double>(), QDateTime()});
+    }
+    Group &group = groups[index.value(key)];
+    group.runs++;
+    group.last = record.timestamp;
+    if (! record.success) {
+      group.failed++;
+      continue;
+    }
+    group.durations.append(double(record.duration())/1e3);
+    if (0 < record.transferTime)
+      group.throughputs.append(record.throughput()/1024);
+    if (0 < record.roundTrips)
+      group.latencies.append(double(record.latency)/1e3);
+    if (0 < record.peakResident)
+      group.memory.append(double(record.peakResident));
+  }
+
+  QString text;
+  QTextStream out(&text);
+  out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11\n")
+         .arg("Radio", -18).arg("Operation", -10).arg("Version", -10).arg("Runs", 5)
+         .arg("Failed", 6).arg("Duration", 9).arg("Throughput", 11).arg("Latency", 9)
+         .arg("Memory", 10).arg("Trend", 7).arg("Last");
+
+  // Maps radio and operation to the median throughput of the previous group
+  QHash<QString, double> previous;
+  foreach (const Group &group, groups) {
+    double throughput = median(group.throughputs);
+    QString trend = "-", key = group.radio + "\n" + group.operation;
+    if ((0 < throughput) && (0 < previous.value(key, 0)))
+      trend = QString("%1%2%").arg((throughput >= previous[key]) ? "+" : "")
+          .arg(100*(throughput-previous[key])/previous[key], 0, 'f', 0);
+    if (0 < throughput)
+      previous[key] = throughput;
+
+    QString memory = group.memory.isEmpty() ? QString("-")
+                                            : MemoryUsage::formatBytes(quint64(median(group.memory)));
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11\n")
+           .arg(group.radio.left(18), -18).arg(group.operation.left(10), -10)
+           .arg(group.version.left(10), -10).arg(group.runs, 5).arg(group.failed, 6)
+           .arg(QString("%1s").arg(median(group.durations), 0, 'f', 2), 9)
+           .arg(QString("%1kb/s").arg(throughput, 0, 'f', 1), 11)
+           .arg(QString("%1ms").arg(median(group.latencies), 0, 'f', 2), 9)
+           .arg(memory, 10).arg(trend, 7).arg(group.last.toString(Qt::ISODate));
+  }
+  out.flush();
+  return text;
+}
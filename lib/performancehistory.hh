@@ -0,0 +1,141 @@
+#ifndef PERFORMANCEHISTORY_HH
+#define PERFORMANCEHISTORY_HH
+
+#include <QString>
+#include <QVector>
+#include <QPair>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include "errorstack.hh"
+
+class Radio;
+class QJsonObject;
+
+/** Keeps a local history of the transfers with radios, one compact record per operation.
+ *
+ * Each record lists the radio, the operation (e.g., "read" or "write"), the application and its
+ * version, the bytes transferred, the number of round trips and retries, the latency and the time
+ * spent in every phase of the transfer as well as the peak memory usage of the process. The
+ * records are appended as single JSON lines to the history file. Once the file exceeds
+ * @c MAX_SIZE bytes, the older half of the records is dropped.
+ *
+ * The history allows to spot a degradation of the connection to a radio (e.g., a failing cable,
+ * hub or a firmware update) as well as to quantify the gains of a release. A summary grouped by
+ * radio, operation and version is formatted by @c summarize.
+ *
+ * @ingroup util */
+class PerformanceHistory
+{
+public:
+  /** The maximum size of the history file in bytes. */
+  static const qint64 MAX_SIZE = 0x100000;
+
+  /** A single record of the history. */
+  struct Record {
+    QDateTime timestamp;       ///< When the operation finished.
+    QString application;       ///< The application (e.g., "dmrconf" or "qdmr").
+    QString version;           ///< The version of the application.
+    QString radio;             ///< The name of the radio.
+    QString operation;         ///< The operation, e.g., "read", "write" or "write-db".
+    bool success;              ///< If @c true, the operation succeeded.
+    quint64 bytesRead;         ///< The number of bytes read.
+    quint64 bytesWritten;      ///< The number of bytes written.
+    unsigned roundTrips;       ///< The number of round trips.
+    unsigned retries;          ///< The number of retries.
+    qint64 transferTime;       ///< The time spent on round trips in microseconds.
+    qint64 setupTime;          ///< The time spent on setting up the transfer in microseconds.
+    qint64 latency;            ///< The median round trip latency in microseconds.
+    QString linkMode;          ///< The effective link mode, if any.
+    /** The wall time spent in every phase in milliseconds. */
+    QVector<QPair<QString, qint64>> phases;
+    quint64 peakResident;      ///< The peak resident memory of the process in bytes, 0 if unknown.
+
+    /** Empty constructor. */
+    Record();
+    /** Returns the total wall time of all phases in milliseconds. */
+    qint64 duration() const;
+    /** Returns the transfer rate in bytes per second, 0 if nothing was transferred. */
+    double throughput() const;
+    /** Serializes the record. */
+    QJsonObject toJson() const;
+    /** Parses a record, returns @c false if the object is not a valid record. */
+    static bool fromJson(const QJsonObject &obj, Record &record);
+  };
+
+  /** Measures the phases of a single operation and assembles its record.
+   *
+   * The initial @c connect phase lasts from the start of the recorder until the radio reports its
+   * first phase. Hence, it covers entering the program mode and, if the recorder gets started
+   * before the radio is detected, the detection. Once the radio is attached, the phases reported
+   * by the radio are measured. */
+  class Recorder
+  {
+  public:
+    /** Constructs an idle recorder. */
+    Recorder();
+    /** Destructor, detaches from the radio. */
+    ~Recorder();
+
+    /** (Re-)starts the recorder for the given operation. */
+    void start(const QString &operation);
+    /** Measures the phases of the given radio. */
+    void attach(Radio *radio);
+    /** Ends the current phase and starts a new one (e.g., "decode"). */
+    void enterPhase(const QString &name);
+    /** Returns @c true if the recorder was started and not finished yet. */
+    bool isRunning() const;
+    /** Finishes the operation and returns its record. The transfer statistics are taken from the
+     * attached radio, the recorder gets detached. */
+    Record finish(bool success);
+
+  protected:
+    /** Detaches from the radio. */
+    void detach();
+
+  protected:
+    /** The current operation, empty if not running. */
+    QString _operation;
+    /** The attached radio. */
+    Radio *_radio;
+    /** The connection to the phase signal of the radio. */
+    QMetaObject::Connection _connection;
+    /** The name of the current phase. */
+    QString _phase;
+    /** Measures the current phase. */
+    QElapsedTimer _timer;
+    /** Duration of all phases in milliseconds, in order of the first entry. */
+    QVector<QPair<QString, qint64>> _phases;
+  };
+
+public:
+  /** Constructs a history stored in the given file. If no file is given, a file in the default
+   * data location of the application is used. */
+  explicit PerformanceHistory(const QString &filename=QString());
+
+  /** Returns the history file. */
+  const QString &filename() const;
+
+  /** Appends the given record to the history. */
+  bool append(const Record &record, const ErrorStack &err=ErrorStack()) const;
+  /** Reads all records of the history, oldest first. Malformed lines are skipped. A missing
+   * history file is not an error. */
+  bool read(QVector<Record> &records, const ErrorStack &err=ErrorStack()) const;
+
+  /** Formats a summary of the given records as a table. The records are grouped by radio,
+   * operation and version in order of their first record. For every group, the number of runs
+   * and failures as well as the medians of the duration, throughput, latency and peak memory of
+   * the successful runs are listed. The change of the median throughput with respect to the
+   * previous group of the same radio and operation is listed as trend. */
+  static QString summarize(const QVector<Record> &records);
+
+protected:
+  /** Drops the older half of the records, once the file exceeds @c MAX_SIZE. */
+  bool truncate(const ErrorStack &err) const;
+
+protected:
+  /** The history file. */
+  QString _filename;
+};
+
+#endif // PERFORMANCEHISTORY_HH
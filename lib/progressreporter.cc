@@ -0,0 +1,56 @@
+#include "progressreporter.hh"
+
+#define DEFAULT_INTERVAL 100                 // minimum interval between updates in ms
+
+
+/* ********************************************************************************************* *
+ * Implementation of ProgressReporter
+ * ********************************************************************************************* */
+ProgressReporter::ProgressReporter()
+  : _interval(DEFAULT_INTERVAL), _percent(-1), _timer(), _transferred(0), _bytes(0)
+{
+  // pass...
+}
+
+unsigned
+ProgressReporter::interval() const {
+  return _interval;
+}
+
+void
+ProgressReporter::setInterval(unsigned ms) {
+  _interval = ms;
+}
+
+void
+ProgressReporter::reset() {
+  _percent = -1;
+}
+
+bool
+ProgressReporter::update(int percent) {
+  if (percent == _percent)
+    return false;
+  // Intermediate updates are throttled.
+  if ((0 < percent) && (100 > percent) && (0 <= _percent) && _timer.isValid()
+      && (_timer.elapsed() < qint64(_interval)))
+    return false;
+  _percent = percent;
+  _timer.start();
+  return true;
+}
+
+void
+ProgressReporter::count(quint64 transferred) {
+  // If the interface was re-opened, its statistics start from scratch.
+  if (transferred >= _transferred)
+    _bytes += transferred - _transferred;
+  else
+    _bytes += transferred;
+  _transferred = transferred;
+}
+
+quint64
+ProgressReporter::bytes() const {
+  return _bytes;
+}
@@ -0,0 +1,53 @@
+#ifndef PROGRESSREPORTER_HH
+#define PROGRESSREPORTER_HH
+
+#include <QElapsedTimer>
+
+/** Throttles the progress signals of a transfer.
+ *
+ * Radios report the progress for every transferred block. As the radios usually run within a
+ * worker thread, every signal gets queued into the event loop of the receiver, often with the
+ * very same percentage. The reporter lets only those updates pass, that change the percentage
+ * and that are at least the minimum interval apart. The start (0%) and the completion (100%) of
+ * a transfer always pass.
+ *
+ * Additionally, the reporter keeps a monotonic count of the bytes transferred, even if the
+ * interface to the radio gets re-opened (e.g., after a change of the baud rate) and starts its
+ * statistics from scratch.
+ *
+ * @ingroup rif */
+class ProgressReporter
+{
+public:
+  /** Constructs a new reporter using the default minimum interval. */
+  ProgressReporter();
+
+  /** Returns the minimum interval between two updates in milliseconds. */
+  unsigned interval() const;
+  /** Sets the minimum interval between two updates in milliseconds. */
+  void setInterval(unsigned ms);
+
+  /** Forgets the last reported percentage, e.g., on the start of a new phase. */
+  void reset();
+  /** Returns @c true, if the given percentage should be signaled. */
+  bool update(int percent);
+
+  /** Updates the byte counter with the number of bytes transferred by the interface. */
+  void count(quint64 transferred);
+  /** Returns the number of bytes transferred in total. */
+  quint64 bytes() const;
+
+protected:
+  /** The minimum interval between two updates in milliseconds. */
+  unsigned _interval;
+  /** The last reported percentage, -1 if none. */
+  int _percent;
+  /** Time since the last update. */
+  QElapsedTimer _timer;
+  /** The last number of bytes, reported by the interface. */
+  quint64 _transferred;
+  /** The monotonic byte counter. */
+  quint64 _bytes;
+};
+
+#endif // PROGRESSREPORTER_HH
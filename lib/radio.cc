@@ -23,6 +23,7 @@
 
 #include "config.hh"
 #include "configcopyvisitor.hh"
+#include "encodesession.hh"
 #include "logger.hh"
 
 #include <QSet>
@@ -32,9 +33,11 @@
  * Implementation of Radio
  * ******************************************************************************************** */
 Radio::Radio(QObject *parent)
-  : QThread(parent), _task(StatusIdle)
+  : QThread(parent), _task(StatusIdle), _imageCacheId(), _imageCache(), _checkpoint(),
+    _readback(), _skipUnchanged(false), _progress(), _downloadSections(), _cancel()
 {
-  // pass...
+  // Phases may be signaled across threads
+  qRegisterMetaType<Radio::Phase>();
 }
 
 Radio::~Radio() {
@@ -60,7 +63,12 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
   }
   logDebug() << "Try to detect radio at " << descr.description() << ".";
 
-  if (AnytoneInterface::interfaceInfo() == descr) {
+  // Virtual devices are dispatched like the serial interface with the same VID:PID
+  USBDeviceInfo info(descr);
+  if (USBDeviceInfo::Class::Virtual == descr.interfaceClass())
+    info = USBDeviceInfo(USBDeviceInfo::Class::Serial, descr.vendorId(), descr.productId());
+
+  if (AnytoneInterface::interfaceInfo() == info) {
     AnytoneInterface *anytone = new AnytoneInterface(descr, err);
     if (anytone->isOpen()) {
       RadioInfo id = anytone->identifier(err);
@@ -86,7 +94,7 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
       return nullptr;
     }
     anytone->deleteLater();
-  } else if (OpenGD77Interface::interfaceInfo() == descr) {
+  } else if (OpenGD77Interface::interfaceInfo() == info) {
     OpenGD77Interface *ogd77 = new OpenGD77Interface(descr, err);
     if (ogd77->isOpen()) {
       RadioInfo id = ogd77->identifier();
@@ -101,7 +109,7 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
       return nullptr;
     }
     ogd77->deleteLater();
-  } else if (TyTInterface::interfaceInfo() == descr) {
+  } else if (TyTInterface::interfaceInfo() == info) {
     TyTInterface *dfu = new TyTInterface(descr, err);
     if (dfu->isOpen()) {
       RadioInfo id = dfu->identifier();
@@ -123,7 +131,7 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
       return nullptr;
     }
     dfu->deleteLater();
-  } else if (RadioddityInterface::interfaceInfo() == descr) {
+  } else if (RadioddityInterface::interfaceInfo() == info) {
     RadioddityInterface *hid = new RadioddityInterface(descr, err);
     if (hid->isOpen()) {
       RadioInfo id = hid->identifier();
@@ -143,7 +151,7 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
       return nullptr;
     }
     hid->deleteLater();
-  } else if (DR1801UVInterface::interfaceInfo() == descr) {
+  } else if (DR1801UVInterface::interfaceInfo() == info) {
     DR1801UVInterface *dif = new DR1801UVInterface(descr, err);
     if (dif->isOpen()) {
       RadioInfo id = dif->identifier(err);
@@ -161,7 +169,7 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
       return nullptr;
     }
     dif->deleteLater();
-  } else if (C7000Device::interfaceInfo() == descr) {
+  } else if (C7000Device::interfaceInfo() == info) {
     GD73Interface *gdif = new GD73Interface(descr, err);
     if (gdif->isOpen()) {
       RadioInfo id = gdif->identifier();
@@ -181,6 +189,169 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
   return nullptr;
 }
 
+TransferStatistics
+Radio::transferStatistics() const {
+  return TransferStatistics();
+}
+
+quint64
+Radio::bytesTransferred() const {
+  return _progress.bytes();
+}
+
+bool
+Radio::hasCheckpoint() const {
+  return _checkpoint.contains(checkpointKey());
+}
+
+void
+Radio::moveAllToThread(QThread *thread) {
+  moveInterfaceToThread(thread);
+  moveToThread(thread);
+}
+
+void
+Radio::moveInterfaceToThread(QThread *thread) {
+  Q_UNUSED(thread);
+}
+
+RadioInterface *
+Radio::radioInterface() const {
+  return nullptr;
+}
+
+const CancellationToken &
+Radio::cancellationToken() const {
+  return _cancel;
+}
+
+void
+Radio::setCancellationToken(const CancellationToken &token) {
+  _cancel = token;
+  if (RadioInterface *dev = radioInterface())
+    dev->setCancellationToken(token);
+  codeplug().setCancellationToken(token);
+  if (CallsignDB *db = callsignDB())
+    db->setCancellationToken(token);
+}
+
+void
+Radio::cancel() {
+  _cancel.cancel();
+}
+
+bool
+Radio::startUploadSession(EncodeSession *session, bool blocking, const Codeplug::Flags &flags,
+                          const ErrorStack &err)
+{
+  Config *config = session->takeConfig(err);
+  delete session;
+  if (nullptr == config) {
+    errMsg(err) << "Cannot upload codeplug to " << name() << ".";
+    return false;
+  }
+  return startUpload(config, blocking, flags, err);
+}
+
+bool
+Radio::startUploadAll(Config *config, UserDatabase *db, bool blocking, const Codeplug::Flags &flags,
+                      const CallsignDB::Selection &selection, const ErrorStack &err)
+{
+  Q_UNUSED(config); Q_UNUSED(db); Q_UNUSED(blocking); Q_UNUSED(flags); Q_UNUSED(selection)
+  errMsg(err) << "Uploading codeplug and call-sign DB in one session is not supported by "
+              << name() << ".";
+  return false;
+}
+
+bool
+Radio::startResume(bool blocking, const ErrorStack &err) {
+  Q_UNUSED(blocking)
+  errMsg(err) << "Resuming an upload is not supported by " << name() << ".";
+  return false;
+}
+
+void
+Radio::enterPhase(Phase phase, quint64 bytes) {
+  TransferStatistics stats = transferStatistics();
+  _progress.count(stats.bytesRead() + stats.bytesWritten());
+  _progress.reset();
+  emit phaseChanged(phase, bytes);
+}
+
+void
+Radio::reportDownloadProgress(float percent) {
+  if (! _progress.update(int(percent)))
+    return;
+  TransferStatistics stats = transferStatistics();
+  _progress.count(stats.bytesRead() + stats.bytesWritten());
+  emit downloadProgress(int(percent));
+}
+
+void
+Radio::reportUploadProgress(float percent) {
+  if (! _progress.update(int(percent)))
+    return;
+  TransferStatistics stats = transferStatistics();
+  _progress.count(stats.bytesRead() + stats.bytesWritten());
+  emit uploadProgress(int(percent));
+}
+
+QString
+Radio::checkpointKey() const {
+  if (_imageCacheId.isEmpty())
+    return name();
+  return QString("%1-%2").arg(name(), _imageCacheId);
+}
+
+bool
+Radio::restoreCheckpoint(const ErrorStack &err) {
+  if (StatusIdle != _task) {
+    errMsg(err) << "Cannot resume upload: Radio is busy.";
+    return false;
+  }
+
+  DFUFile file;
+  UploadCheckpoint::Kind kind;
+  if (! _checkpoint.load(checkpointKey(), kind, file, err)) {
+    errMsg(err) << "Cannot resume upload.";
+    return false;
+  }
+
+  DFUFile *target = &codeplug();
+  if (UploadCheckpoint::Kind::CallsignDB == kind)
+    target = callsignDB();
+  if ((nullptr == target) || (target->numImages() != file.numImages())) {
+    errMsg(err) << "Cannot resume upload: Checkpoint does not match radio " << name() << ".";
+    _checkpoint.reset();
+    return false;
+  }
+  for (int i=0; i<file.numImages(); i++)
+    target->image(i) = file.image(i);
+
+  _task = (UploadCheckpoint::Kind::Codeplug == kind) ? StatusUpload : StatusUploadCallsigns;
+  _errorStack = err;
+  return true;
+}
+
+void
+Radio::storeCheckpoint() {
+  if (! _checkpoint.isActive())
+    return;
+  if (StatusUploadCallsigns == _task) {
+    if (nullptr != callsignDB())
+      _checkpoint.store(checkpointKey(), UploadCheckpoint::Kind::CallsignDB, *callsignDB());
+  } else {
+    _checkpoint.store(checkpointKey(), UploadCheckpoint::Kind::Codeplug, codeplug());
+  }
+}
+
+void
+Radio::clearCheckpoint() {
+  if (_checkpoint.isActive() || _checkpoint.isResume())
+    _checkpoint.remove(checkpointKey());
+  _checkpoint.reset();
+}
+
 Radio::Status
 Radio::status() const {
   return _task;
@@ -190,3 +361,32 @@ const ErrorStack &
 Radio::errorStack() const {
   return _errorStack;
 }
+
+void
+Radio::setImageCache(const QString &id, const QString &directory) {
+  _imageCacheId = id;
+  _imageCache = ImageCache(directory);
+}
+
+void
+Radio::setReadbackVerification(bool enabled, unsigned samples) {
+  _readback.setEnabled(enabled, samples);
+}
+
+void
+Radio::setSkipUnchanged(bool enabled) {
+  _skipUnchanged = enabled;
+}
+
+bool
+Radio::hasSelectiveDownload() const {
+  return false;
+}
+
+bool
+Radio::startDownload(const Codeplug::Sections &sections, bool blocking, const ErrorStack &err) {
+  if ((! sections.isAll()) && (! hasSelectiveDownload()))
+    logInfo() << name() << " cannot download selected sections only, download entire codeplug.";
+  _downloadSections = sections;
+  return startDownload(blocking, err);
+}
@@ -16,8 +16,13 @@
 #include "callsigndb.hh"
 #include "errorstack.hh"
 #include "config.hh"
+#include "imagecache.hh"
+#include "uploadcheckpoint.hh"
+#include "readbackverifier.hh"
+#include "progressreporter.hh"
 
 class RadioLimits;
+class EncodeSession;
 
 
 /** Base class for all Radio objects.
@@ -39,9 +44,19 @@ public:
     StatusDownload,        ///< Downloading codeplug.
     StatusUpload,          ///< Uploading codeplug.
     StatusUploadCallsigns, ///< Uploading codeplug.
+    StatusUploadAll,       ///< Uploading codeplug and call-sign DB within one session.
     StatusError            ///< An error occurred.
   } Status;
 
+  /** Possible phases of a transfer, see @c phaseChanged. */
+  enum Phase {
+    PhaseRead,             ///< Reading the device memory.
+    PhaseEncode,           ///< Encoding the configuration into the codeplug.
+    PhaseWrite,            ///< Writing to the device memory.
+    PhaseVerify            ///< Reading back the written memory for verification.
+  };
+  Q_ENUM(Phase)
+
 public:
   /** Default constructor. */
 	explicit Radio(QObject *parent = nullptr);
@@ -75,6 +90,52 @@ public:
    * @c startUploadCallsignDB. It contains the error messages from the upload/download process. */
   const ErrorStack &errorStack() const;
 
+  /** Enables the persistent image cache for this radio. If enabled, the last binary image written
+   * to the radio is stored locally and used on the next upload instead of reading the current
+   * codeplug from the device first. Not all radios support the image cache.
+   * @param id Specifies a unique identifier for the radio (e.g., serial number). An empty
+   *        identifier disables the cache.
+   * @param directory Specifies the cache directory. If empty, the default location is used. */
+  void setImageCache(const QString &id, const QString &directory=QString());
+
+  /** Enables the verification of uploads by reading back the written blocks from the device.
+   * If @c samples is 0, all written blocks are read back, otherwise only the given number of
+   * blocks. Radios not supporting the verification ignore this setting.
+   * @see ReadbackVerifier */
+  void setReadbackVerification(bool enabled, unsigned samples=0);
+
+  /** Enables skipping unchanged memory sectors on upload. If enabled, the current content of each
+   * sector is compared to the new data before it gets erased and programmed. Radios not
+   * supporting this ignore the setting. */
+  void setSkipUnchanged(bool enabled);
+
+  /** Returns @c true if the radio can download selected codeplug sections only. The default
+   * implementation returns @c false. */
+  virtual bool hasSelectiveDownload() const;
+
+  /** Returns the metrics collected on the communication with the device. Radios not supporting
+   * these metrics return empty statistics. */
+  virtual TransferStatistics transferStatistics() const;
+  /** Returns the number of bytes transferred since the radio was created. Unlike the transfer
+   * statistics, this counter never decreases. It gets updated with every progress signal. */
+  quint64 bytesTransferred() const;
+
+  /** Returns @c true if there is a stored checkpoint of a failed upload to this radio, that can be
+   * resumed using @c startResume. */
+  bool hasCheckpoint() const;
+
+  /** Moves the radio together with its interface to the given thread. Must be called from the
+   * thread, the radio was created in. E.g., if the radio was detected within a worker thread. */
+  void moveAllToThread(QThread *thread);
+
+  /** Returns the token, the transfers of this radio are canceled with. */
+  const CancellationToken &cancellationToken() const;
+  /** Sets the token, the transfers of this radio are canceled with. The token is passed on to
+   * the interface, the codeplug and the callsign DB. Hence, a canceled transfer stops at the
+   * next block transferred or encoded, leaves the programming mode of the device cleanly and
+   * fails with an error. A failed upload keeps its checkpoint, such that it can be resumed. */
+  void setCancellationToken(const CancellationToken &token);
+
 public:
   /** Tries to detect the radio connected to the specified interface or constructs the specified
    * radio using the @c RadioInfo passed by @c force. */
@@ -86,16 +147,45 @@ public slots:
    * Once the download finished, the codeplug can be accessed and decoded using
    * the @c codeplug() method. */
   virtual bool startDownload(bool blocking=false, const ErrorStack &err=ErrorStack()) = 0;
+  /** Starts the download of the selected codeplug sections only.
+   * Radios supporting the selection only download the memory needed to decode these sections
+   * and the decoded config only contains these sections (see @c Codeplug::Sections). Other
+   * radios download the complete codeplug. */
+  bool startDownload(const Codeplug::Sections &sections, bool blocking=false,
+                     const ErrorStack &err=ErrorStack());
   /** Derives the device-specific codeplug from the generic configuration and uploads that
    * codeplug to the radio. */
   virtual bool startUpload(
       Config *config, bool blocking=false,
       const Codeplug::Flags &flags = Codeplug::Flags(), const ErrorStack &err=ErrorStack()) = 0;
+  /** Uploads the config of the given encode session, reusing whatever the session computed
+   * before, e.g., the preprocessed config or its index. The radio takes ownership of the session.
+   * By default, only the config to upload is taken from the session (see @c startUpload). */
+  virtual bool startUploadSession(
+      EncodeSession *session, bool blocking=false,
+      const Codeplug::Flags &flags = Codeplug::Flags(), const ErrorStack &err=ErrorStack());
   /** Assembles the callsign DB from the given one and uploads it to the device. */
   virtual bool startUploadCallsignDB(
       UserDatabase *db, bool blocking=false,
       const CallsignDB::Selection &selection=CallsignDB::Selection(),
       const ErrorStack &err=ErrorStack()) = 0;
+  /** Derives the device-specific codeplug from the generic configuration, assembles the callsign
+   * DB from the given one and uploads both to the radio within a single programming session.
+   * That is, the radio enters the programming mode and reboots only once. By default, the
+   * combined upload is not supported. */
+  virtual bool startUploadAll(
+      Config *config, UserDatabase *db, bool blocking=false,
+      const Codeplug::Flags &flags = Codeplug::Flags(),
+      const CallsignDB::Selection &selection=CallsignDB::Selection(),
+      const ErrorStack &err=ErrorStack());
+  /** Resumes a failed codeplug or callsign DB upload from the stored checkpoint. The image
+   * being written is taken from the checkpoint, hence the codeplug is neither read nor encoded
+   * again and only those blocks not confirmed by the device earlier are written. By default,
+   * resuming is not supported. */
+  virtual bool startResume(bool blocking=false, const ErrorStack &err=ErrorStack());
+  /** Cancels the current transfer, see @c setCancellationToken. Canceling is thread-safe. As the
+   * token stays canceled, a new token must be set before the next transfer. */
+  void cancel();
 
 signals:
   /** Gets emitted once the codeplug download has been started. */
@@ -116,11 +206,56 @@ signals:
   /** Gets emitted once the codeplug upload has been completed successfully. */
 	void uploadComplete(Radio *radio);
 
+  /** Gets emitted once the current download or upload enters a new phase. The @c bytes specify
+   * the amount of memory transferred within this phase, if known and 0 otherwise. */
+  void phaseChanged(Radio::Phase phase, quint64 bytes);
+
 protected:
   /** The current state/task. */
   Status _task;
   /** The error stack. */
   ErrorStack _errorStack;
+  /** The identifier of the radio within the image cache. If empty, the cache is disabled. */
+  QString _imageCacheId;
+  /** The image cache. */
+  ImageCache _imageCache;
+  /** Tracks the progress of the current upload. */
+  UploadCheckpoint _checkpoint;
+  /** Records the written blocks for the readback verification. */
+  ReadbackVerifier _readback;
+  /** If @c true, unchanged sectors are skipped on upload. */
+  bool _skipUnchanged;
+  /** Throttles the progress signals. */
+  ProgressReporter _progress;
+  /** The sections to download with the next download. Reset to all sections once used. */
+  Codeplug::Sections _downloadSections;
+  /** The token, the transfers are canceled with. */
+  CancellationToken _cancel;
+
+protected:
+  /** Moves the interface to the radio to the given thread. Gets called by @c moveAllToThread. */
+  virtual void moveInterfaceToThread(QThread *thread);
+  /** Returns the interface to the radio or @c nullptr if there is none. The default
+   * implementation returns @c nullptr. */
+  virtual RadioInterface *radioInterface() const;
+  /** Signals the start of a new phase of the current transfer. */
+  void enterPhase(Phase phase, quint64 bytes=0);
+  /** Signals the download progress, unless the percentage did not change or the last signal
+   * was emitted just now. */
+  void reportDownloadProgress(float percent);
+  /** Signals the upload progress, unless the percentage did not change or the last signal was
+   * emitted just now. */
+  void reportUploadProgress(float percent);
+  /** Returns the key of the checkpoint for this radio. */
+  QString checkpointKey() const;
+  /** Loads the stored checkpoint into the codeplug or callsign DB and sets the task accordingly.
+   * Used by the implementations of @c startResume. */
+  bool restoreCheckpoint(const ErrorStack &err=ErrorStack());
+  /** Stores the checkpoint of the current upload, if the device memory has been modified. Gets
+   * called on upload failure. */
+  void storeCheckpoint();
+  /** Removes the stored checkpoint. Gets called on upload success. */
+  void clearCheckpoint();
 };
 
 #endif // RADIO_HH
@@ -9,6 +9,8 @@
 #include "config.hh"
 #include "commercial_extension.hh"
 #include "intermediaterepresentation.hh"
+#include "tracer.hh"
+#include "stringpool.hh"
 
 
 /* ********************************************************************************************* *
@@ -2747,6 +2749,7 @@ RadioddityCodeplug::clear() {
 
 bool
 RadioddityCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) const {
+  TRACE_SPAN("RadioddityCodeplug::index", "codeplug");
   Q_UNUSED(err)
   // All indices as 1-based. That is, the first channel gets index 1.
 
@@ -2795,8 +2798,14 @@ RadioddityCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) c
   return true;
 }
 
+bool
+RadioddityCodeplug::requiresPreprocessing(const Config *config) const {
+  return Codeplug::requiresPreprocessing(config) || ZoneSplitVisitor::isRequired(config);
+}
+
 Config *
 RadioddityCodeplug::preprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("RadioddityCodeplug::preprocess", "codeplug");
   Config *intermediate = Codeplug::preprocess(config, err);
   if (nullptr == intermediate) {
     errMsg(err) << "Cannot pre-process Radioddity codeplug.";
@@ -2816,6 +2825,7 @@ RadioddityCodeplug::preprocess(Config *config, const ErrorStack &err) const {
 
 bool
 RadioddityCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
+  TRACE_SPAN("RadioddityCodeplug::encode", "codeplug");
   // Check if default DMR id is set.
   if (config->settings()->defaultIdRef()->isNull()) {
     errMsg(err) << "No default radio ID specified.";
@@ -2834,6 +2844,7 @@ RadioddityCodeplug::encode(Config *config, const Flags &flags, const ErrorStack
 
 bool
 RadioddityCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("RadioddityCodeplug::encodeElements", "codeplug");
   // General config
   if (! this->encodeGeneralSettings(ctx.config(), flags, ctx, err)) {
     errMsg(err) << "Cannot encode general settings.";
@@ -2897,6 +2908,9 @@ RadioddityCodeplug::encodeElements(const Flags &flags, Context &ctx, const Error
 
 bool
 RadioddityCodeplug::decode(Config *config, const ErrorStack &err) {
+  TRACE_SPAN("RadioddityCodeplug::decode", "codeplug");
+  // Names decoded repeatedly share their storage
+  StringPool::Scope strings;
   // Clear config object
   config->clear();
 
@@ -2908,6 +2922,7 @@ RadioddityCodeplug::decode(Config *config, const ErrorStack &err) {
 
 bool
 RadioddityCodeplug::postprocess(Config *config, const ErrorStack &err) const {
+  TRACE_SPAN("RadioddityCodeplug::postprocess", "codeplug");
   if (! Codeplug::postprocess(config, err)) {
     errMsg(err) << "Cannot post-process Radioddy codeplug.";
     return false;
@@ -2924,6 +2939,7 @@ RadioddityCodeplug::postprocess(Config *config, const ErrorStack &err) const {
 
 bool
 RadioddityCodeplug::decodeElements(Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("RadioddityCodeplug::decodeElements", "codeplug");
   if (! this->decodeGeneralSettings(ctx.config(), ctx, err)) {
     errMsg(err) << "Cannot decode general settings.";
     return false;
@@ -1432,6 +1432,7 @@ public:
   bool postprocess(Config *config, const ErrorStack &err) const;
 
   Config *preprocess(Config *config, const ErrorStack &err) const;
+  bool requiresPreprocessing(const Config *config) const;
   bool encode(Config *config, const Flags &flags = Flags(), const ErrorStack &err=ErrorStack());
 
 public:
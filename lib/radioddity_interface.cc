@@ -120,6 +120,7 @@ bool
 RadioddityInterface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
   Q_UNUSED(addr)
 
+  TransferStatistics::Timer timer(_transferStatistics);
   if (! selectMemoryBank(MemoryBank(bank), err)) {
     errMsg(err) << "Cannot select memory bank " << bank << ".";
     return false;
@@ -131,25 +132,35 @@ RadioddityInterface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &
 bool
 RadioddityInterface::read(uint32_t bank, uint32_t addr, unsigned char *data, int nbytes, const ErrorStack &err)
 {
+  _transferStatistics.setAddress(addr);
   unsigned char cmd[4], reply[32+4];
   int n;
 
+  if (! checkCanceled(err))
+    return false;
+
   if (! selectMemoryBank(MemoryBank(bank), err)) {
     errMsg(err) << "Cannot select memory bank " << bank << ".";
     return false;
   }
 
-  // send data
-  for (n=0; n<nbytes; n+=32) {
+  // assemble all read requests and send them at once
+  int nblocks = (nbytes+31)/32;
+  QByteArray cmds(4*nblocks, 0), replies(sizeof(reply)*nblocks, 0);
+  for (n=0; n<nblocks; n++) {
     cmd[0] = CMD_READ[0];
-    cmd[1] = (addr + n) >> 8;
-    cmd[2] = addr + n;
+    cmd[1] = (addr + 32*n) >> 8;
+    cmd[2] = addr + 32*n;
     cmd[3] = 32;
-    if (! hid_send_recv(cmd, 4, reply, sizeof(reply), err))
-      return false;
-    else
-      memcpy(data + n, reply + 4, 32);
+    memcpy(cmds.data()+4*n, cmd, 4);
   }
+  TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Read, nbytes);
+  if (! hid_send_recv_batch((const unsigned char *)cmds.constData(), 4, nblocks,
+                            (unsigned char *)replies.data(), sizeof(reply), err))
+    return false;
+
+  for (n=0; n<nblocks; n++)
+    memcpy(data + 32*n, replies.constData() + sizeof(reply)*n + 4, std::min(32, nbytes-32*n));
 
   return true;
 }
@@ -181,6 +192,7 @@ bool
 RadioddityInterface::write_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
   Q_UNUSED(addr)
 
+  TransferStatistics::Timer timer(_transferStatistics);
   if (! selectMemoryBank(MemoryBank(bank), err)) {
     errMsg(err) << "Cannot select memory bank " << bank << ".";
     return false;
@@ -192,27 +204,62 @@ RadioddityInterface::write_start(uint32_t bank, uint32_t addr, const ErrorStack
 bool
 RadioddityInterface::write(uint32_t bank, uint32_t addr, unsigned char *data, int nbytes, const ErrorStack &err)
 {
+  _transferStatistics.setAddress(addr);
   unsigned char ack, cmd[4+32];
 
+  if (! checkCanceled(err))
+    return false;
+
   if (! selectMemoryBank(MemoryBank(bank), err)) {
     errMsg(err) << "Cannot select memory bank " << bank << ".";
     return false;
   }
 
-  // send data
+  // assemble all write requests and send them at once
+  int nblocks = (nbytes+31)/32;
+  QByteArray cmds((4+32)*nblocks, 0), acks(nblocks, 0);
+  for (int n=0; n<nblocks; n++) {
+    cmd[0] = CMD_WRITE[0];
+    cmd[1] = (addr + 32*n) >> 8;
+    cmd[2] = addr + 32*n;
+    cmd[3] = 32;
+    memcpy(cmd + 4, data + 32*n, std::min(32, nbytes-32*n));
+    memcpy(cmds.data()+(4+32)*n, cmd, 4+32);
+  }
+  {
+    TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Write, nbytes);
+    if (! hid_send_recv_batch((const unsigned char *)cmds.constData(), 4+32, nblocks,
+                              (unsigned char *)acks.data(), 1, err))
+      return false;
+  }
+
+  // find first block not acknowledged
+  int first = 0;
+  while ((first < nblocks) && (CMD_ACK[0] == (unsigned char)acks.at(first)))
+    first++;
+  if (first < nblocks)
+    _transferStatistics.addRetry(nblocks-first);
+
+  // re-send remaining data in lock-step
   unsigned int count=0;
-  for (int n=0; n<nbytes; n+=32) {
+  for (int n=32*first; n<nbytes; n+=32) {
     cmd[0] = CMD_WRITE[0];
     cmd[1] = (addr + n) >> 8;
     cmd[2] = addr + n;
     cmd[3] = 32;
     memcpy(cmd + 4, data + n, 32);
-    if (! hid_send_recv(cmd, 4+32, &ack, 1, err))
+    bool ok;
+    { // payload is already accounted for by the batch above
+      TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Write, 0);
+      ok = hid_send_recv(cmd, 4+32, &ack, 1, err);
+    }
+    if (! ok)
       return false;
     else if (ack != CMD_ACK[0]) {
       errMsg(err) << "Cannot write block: Wrong acknowledge " << (int)ack
                   << ", expected " << (int)CMD_ACK[0] << ".";
       n-=32;
+      _transferStatistics.addRetry();
 
       if ((++count) > MAX_RETRY) {
         errMsg(err) << "Maximum retry count reached. Abort.";
@@ -2,8 +2,32 @@
 #include "config.hh"
 #include "logger.hh"
 #include "utils.hh"
+#include <algorithm>
 
 #define BSIZE           32
+/** Maximum size of a run of blocks passed to the interface at once. The interface pipelines the
+ * blocks of a run, the run size only limits the progress granularity. */
+#define RUN_SIZE        0x1000
+/** Address of the bank boundary. Addresses are 16 bit within each bank. */
+#define BANK_SIZE       0x10000
+
+
+/** Returns the memory bank holding the given codeplug address. */
+static inline RadioddityInterface::MemoryBank
+codeplugBank(uint32_t addr) {
+  return (BANK_SIZE > addr) ? RadioddityInterface::MEMBANK_CODEPLUG_LOWER
+                            : RadioddityInterface::MEMBANK_CODEPLUG_UPPER;
+}
+
+/** Returns the length of the run starting at @c addr, that neither exceeds @c end, nor the
+ * boundary of the memory bank nor @c RUN_SIZE. */
+static inline uint32_t
+runLength(uint32_t addr, uint32_t end) {
+  uint32_t limit = std::min(end, addr+RUN_SIZE);
+  if (addr < BANK_SIZE)
+    limit = std::min(limit, uint32_t(BANK_SIZE));
+  return limit - addr;
+}
 
 
 RadioddityRadio::RadioddityRadio(RadioddityInterface *device, QObject *parent)
@@ -24,6 +48,24 @@ RadioddityRadio::~RadioddityRadio() {
   }
 }
 
+TransferStatistics
+RadioddityRadio::transferStatistics() const {
+  if (nullptr == _dev)
+    return TransferStatistics();
+  return _dev->transferStatistics();
+}
+
+void
+RadioddityRadio::moveInterfaceToThread(QThread *thread) {
+  if (_dev)
+    _dev->moveToThread(thread);
+}
+
+RadioInterface *
+RadioddityRadio::radioInterface() const {
+  return _dev;
+}
+
 bool
 RadioddityRadio::startDownload(bool blocking, const ErrorStack &err) {
   if (StatusIdle != _task)
@@ -55,6 +97,7 @@ RadioddityRadio::startUpload(Config *config, bool blocking, const Codeplug::Flag
 
   _task = StatusUpload;
   _codeplugFlags = flags;
+  _checkpoint.reset();
   if (blocking) {
     this->run();
     return (StatusIdle == _task);
@@ -76,6 +119,20 @@ RadioddityRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const Ca
   return false;
 }
 
+bool
+RadioddityRadio::startResume(bool blocking, const ErrorStack &err) {
+  if (! restoreCheckpoint(err))
+    return false;
+
+  if (blocking) {
+    this->run();
+    return (StatusIdle == _task);
+  }
+
+  this->start();
+  return true;
+}
+
 void
 RadioddityRadio::run() {
   if (StatusDownload == _task) {
@@ -105,6 +162,7 @@ RadioddityRadio::run() {
     }
 
     if (! upload()) {
+      storeCheckpoint();
       _dev->write_finish();
       _dev->reboot();
       _dev->close();
@@ -112,6 +170,7 @@ RadioddityRadio::run() {
       emit uploadError(this);
       return;
     }
+    clearCheckpoint();
     _dev->write_finish();
     _dev->reboot();
     _dev->close();
@@ -146,22 +205,23 @@ RadioddityRadio::download() {
   for (int n=0; n<codeplug().image(0).numElements(); n++) {
     btot += codeplug().image(0).element(n).data().size()/BSIZE;
   }
+  enterPhase(PhaseRead, btot*BSIZE);
+  // All elements get downloaded entirely, no need to initialize them
+  codeplug().prepareOverwrite();
 
+  // Read elements in runs of blocks within the same memory bank
   unsigned bcount = 0;
   for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    int b0 = codeplug().image(0).element(n).address()/BSIZE;
-    int nb = codeplug().image(0).element(n).data().size()/BSIZE;
-    for (int i=0; i<nb; i++, bcount++) {
-      // Select bank by addr
-      uint32_t addr = (b0+i)*BSIZE;
-      RadioddityInterface::MemoryBank bank = (
-            (0x10000 > addr) ? RadioddityInterface::MEMBANK_CODEPLUG_LOWER : RadioddityInterface::MEMBANK_CODEPLUG_UPPER );
-      // read
-      if (! _dev->read(bank, (b0+i)*BSIZE, codeplug().data((b0+i)*BSIZE), BSIZE, _errorStack)) {
+    uint32_t addr = codeplug().image(0).element(n).address();
+    uint32_t end = addr + codeplug().image(0).element(n).data().size()/BSIZE*BSIZE;
+    while (addr < end) {
+      uint32_t len = runLength(addr, end);
+      if (! _dev->read(codeplugBank(addr), addr, codeplug().data(addr), len, _errorStack)) {
         errMsg(_errorStack) << "Cannot download codeplug.";
         return false;
       }
-      emit downloadProgress(float(bcount*100)/btot);
+      addr += len; bcount += len/BSIZE;
+      reportDownloadProgress(float(bcount*100)/btot);
     }
   }
 
@@ -173,57 +233,119 @@ bool
 RadioddityRadio::upload() {
   emit uploadStarted();
 
+  // If resumed, the image being written was restored from the checkpoint. Otherwise, read and
+  // encode the codeplug first.
+  DFUFile::Image current;
+  if (_checkpoint.isResume())
+    logInfo() << "Resume upload to " << name() << " from checkpoint.";
+  else if (! prepareUpload(current))
+    return false;
+
+  // Count modified blocks
   unsigned btot = 0;
   for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    btot += codeplug().image(0).element(n).data().size()/BSIZE;
+    int b0 = codeplug().image(0).element(n).address()/BSIZE;
+    int nb = codeplug().image(0).element(n).data().size()/BSIZE;
+    for (int i=0; i<nb; i++)
+      if (_checkpoint.pending(0, n, i*BSIZE, BSIZE) && codeplug().image(0).differs(current, (b0+i)*BSIZE, BSIZE))
+        btot++;
   }
+  logDebug() << "Upload " << btot*BSIZE << "b of modified codeplug.";
+  enterPhase(PhaseWrite, btot*BSIZE);
 
+  // then, upload modified codeplug in runs of consecutive modified blocks within the same bank
   unsigned bcount = 0;
+  _checkpoint.begin();
+  for (int n=0; n<codeplug().image(0).numElements(); n++) {
+    uint32_t a0 = codeplug().image(0).element(n).address();
+    int nb = codeplug().image(0).element(n).data().size()/BSIZE;
+    for (int i=0; i<nb;) {
+      // skip unmodified blocks and those written before, when resuming
+      uint32_t addr = a0 + i*BSIZE;
+      if ((! _checkpoint.pending(0, n, i*BSIZE, BSIZE)) || (! codeplug().image(0).differs(current, addr, BSIZE))) {
+        i++;
+        continue;
+      }
+      // extend run
+      int first = i;
+      uint32_t maxLen = runLength(addr, a0 + nb*BSIZE);
+      for (i++; (i<nb) && (uint32_t(i-first)*BSIZE < maxLen); i++) {
+        if ((! _checkpoint.pending(0, n, i*BSIZE, BSIZE))
+            || (! codeplug().image(0).differs(current, a0+i*BSIZE, BSIZE)))
+          break;
+      }
+      // write run
+      if (! _dev->write(codeplugBank(addr), addr, codeplug().data(addr), (i-first)*BSIZE, _errorStack)) {
+        errMsg(_errorStack) << "Cannot upload codeplug.";
+        return false;
+      }
+      bcount += i-first;
+      _checkpoint.confirm(0, n, i*BSIZE);
+      reportUploadProgress(50+float(bcount*50)/btot);
+    }
+  }
+
+  return true;
+}
+
+bool
+RadioddityRadio::prepareUpload(DFUFile::Image &current) {
+  // Memory entirely rewritten by the encoder is not read from the device.
+  std::vector<AddressMap::Range> generated = codeplug().generatedMemory();
+
   if (_codeplugFlags.updateCodePlug) {
-    // If codeplug gets updated, download codeplug from device first:
+    unsigned btot = 0;
     for (int n=0; n<codeplug().image(0).numElements(); n++) {
-      int b0 = codeplug().image(0).element(n).address()/BSIZE;
+      uint32_t a0 = codeplug().image(0).element(n).address();
       int nb = codeplug().image(0).element(n).data().size()/BSIZE;
-      for (int i=0; i<nb; i++, bcount++) {
-        // Select bank by addr
-        uint32_t addr = (b0+i)*BSIZE;
-        RadioddityInterface::MemoryBank bank = (
-              (0x10000 > addr) ? RadioddityInterface::MEMBANK_CODEPLUG_LOWER : RadioddityInterface::MEMBANK_CODEPLUG_UPPER );
-        // read
-        if (! _dev->read(bank, addr, codeplug().data(addr), BSIZE, _errorStack)) {
+      for (int i=0; i<nb; i++)
+        if (! Codeplug::isGenerated(generated, a0+i*BSIZE, BSIZE))
+          btot++;
+    }
+    logDebug() << "Read " << btot*BSIZE << "b preserved from device.";
+    enterPhase(PhaseRead, btot*BSIZE);
+
+    // If codeplug gets updated, download codeplug from device first:
+    unsigned bcount = 0;
+    for (int n=0; n<codeplug().image(0).numElements(); n++) {
+      uint32_t addr = codeplug().image(0).element(n).address();
+      uint32_t end = addr + codeplug().image(0).element(n).data().size()/BSIZE*BSIZE;
+      while (addr < end) {
+        if (Codeplug::isGenerated(generated, addr, BSIZE)) {
+          addr += BSIZE;
+          continue;
+        }
+        // read consecutive preserved blocks within the same bank
+        uint32_t len = runLength(addr, end);
+        for (uint32_t b=BSIZE; b<len; b+=BSIZE) {
+          if (Codeplug::isGenerated(generated, addr+b, BSIZE)) {
+            len = b;
+            break;
+          }
+        }
+        if (! _dev->read(codeplugBank(addr), addr, codeplug().data(addr), len, _errorStack)) {
           errMsg(_errorStack) << "Cannot upload codeplug.";
           return false;
         }
-        emit uploadProgress(float(bcount*50)/btot);
+        addr += len; bcount += len/BSIZE;
+        reportUploadProgress(float(bcount*50)/btot);
       }
     }
   }
 
+  // Keep a copy of the current device memory, to upload modified blocks only. The copy is cheap
+  // as the element data is implicitly shared until modified by the encoder. The memory not read
+  // from the device is unknown and gets excluded, hence it is always written.
+  if (_codeplugFlags.updateCodePlug)
+    current = codeplug().image(0).excluding(generated);
+
   // Encode config into codeplug
+  enterPhase(PhaseEncode);
   if (! codeplug().encode(_config, _codeplugFlags, _errorStack)) {
     errMsg(_errorStack) << "Codeplug upload failed.";
     return false;
   }
 
-  // then, upload modified codeplug
-  bcount = 0;
-  for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    int b0 = codeplug().image(0).element(n).address()/BSIZE;
-    int nb = codeplug().image(0).element(n).data().size()/BSIZE;
-    for (int i=0; i<nb; i++, bcount++) {
-      // Select bank by addr
-      uint32_t addr = (b0+i)*BSIZE;
-      RadioddityInterface::MemoryBank bank = (
-            (0x10000 > addr) ? RadioddityInterface::MEMBANK_CODEPLUG_LOWER : RadioddityInterface::MEMBANK_CODEPLUG_UPPER );
-      // write block
-      if (! _dev->write(bank, addr, codeplug().data(addr), BSIZE, _errorStack)) {
-        errMsg(_errorStack) << "Cannot upload codeplug.";
-        return false;
-      }
-      emit uploadProgress(50+float(bcount*50)/btot);
-    }
-  }
-
   return true;
 }
 
@@ -21,6 +21,8 @@ public:
 
   virtual ~RadioddityRadio();
 
+  TransferStatistics transferStatistics() const;
+
 public slots:
   /** Starts the download of the codeplug and derives the generic configuration from it. */
   bool startDownload(bool blocking=false, const ErrorStack &err=ErrorStack());
@@ -31,14 +33,21 @@ public slots:
   /** Encodes the given user-database and uploades it to the device. */
   bool startUploadCallsignDB(UserDatabase *db, bool blocking=false,
                              const CallsignDB::Selection &selection=CallsignDB::Selection(), const ErrorStack &err=ErrorStack());
+  /** Resumes a failed codeplug upload from the stored checkpoint. */
+  bool startResume(bool blocking=false, const ErrorStack &err=ErrorStack());
 
 protected:
+  void moveInterfaceToThread(QThread *thread);
+  RadioInterface *radioInterface() const;
   /** Thread main routine, performs all blocking IO operations for codeplug up- and download. */
 	void run();
 
 private:
   virtual bool download();
   virtual bool upload();
+  /** Reads the current codeplug from the radio and encodes the configuration. The current
+   * device memory is returned in @c current, to upload modified blocks only. */
+  bool prepareUpload(DFUFile::Image &current);
   virtual bool uploadCallsigns();
 
 protected:
@@ -109,7 +109,8 @@ DefaultRadioID *DefaultRadioID::_instance = nullptr;
 DefaultRadioID::DefaultRadioID(QObject *parent)
   : DMRRadioID(tr("[Default]"),0,parent)
 {
-  // pass...
+  // Shared by all codeplugs, thus references are not tracked
+  disableTracking();
 }
 
 DefaultRadioID *
@@ -163,7 +164,7 @@ DTMFRadioID::setNumber(const QString &number) {
  * Implementation of RadioIDList
  * ********************************************************************************************* */
 RadioIDList::RadioIDList(QObject *parent)
-  : ConfigObjectList(DMRRadioID::staticMetaObject, parent)
+  : ConfigObjectList(DMRRadioID::staticMetaObject, parent), _numberIndex(), _numberIndexValid(false)
 {
   // pass...
 }
@@ -182,11 +183,21 @@ RadioIDList::getId(int idx) const {
 
 DMRRadioID *
 RadioIDList::find(uint32_t id) const {
-  for (int i=0; i<count(); i++) {
-    if (id == getId(i)->number())
-      return getId(i);
+  if (! _numberIndexValid) {
+    // Iterate in reverse order, such that the first ID with a number wins
+    _numberIndex.clear();
+    for (int i=count()-1; i>=0; i--)
+      _numberIndex.insert(getId(i)->number(), getId(i));
+    _numberIndexValid = true;
   }
-  return nullptr;
+  return _numberIndex.value(id, nullptr);
+}
+
+void
+RadioIDList::freeze() {
+  // Any search builds the number index
+  find(0);
+  ConfigObjectList::freeze();
 }
 
 int
@@ -211,6 +222,44 @@ RadioIDList::delId(uint32_t id) {
   return del(find(id));
 }
 
+void
+RadioIDList::invalidateIndex() {
+  ConfigObjectList::invalidateIndex();
+  _numberIndexValid = false;
+}
+
+void
+RadioIDList::appendToIndex(ConfigObject *obj, int idx) {
+  ConfigObjectList::appendToIndex(obj, idx);
+  DMRRadioID *id = obj->as<DMRRadioID>();
+  if (_numberIndexValid && id && (! _numberIndex.contains(id->number())))
+    _numberIndex.insert(id->number(), id);
+}
+
+void
+RadioIDList::removeLastFromIndex(ConfigObject *obj, int idx) {
+  ConfigObjectList::removeLastFromIndex(obj, idx);
+  if (! _numberIndexValid)
+    return;
+  // If the last ID is found by its number, there is no other ID with that number
+  if (DMRRadioID *id = obj->as<DMRRadioID>()) {
+    if (id == _numberIndex.value(id->number(), nullptr))
+      _numberIndex.remove(id->number());
+  } else {
+    // ID is being destroyed, its number is gone
+    _numberIndexValid = false;
+  }
+}
+
+void
+RadioIDList::updateIndex(ConfigObject *obj) {
+  ConfigObjectList::updateIndex(obj);
+  // If the ID is not found by its number, the number may have changed
+  DMRRadioID *id = obj->as<DMRRadioID>();
+  if (_numberIndexValid && id && (id != _numberIndex.value(id->number(), nullptr)))
+    _numberIndexValid = false;
+}
+
 
 ConfigItem *
 RadioIDList::allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err) {
@@ -137,6 +137,8 @@ public:
   /** Searches the DMR ID object associated with the given DMR ID. */
   DMRRadioID *find(uint32_t id) const;
 
+  void freeze();
+
   int add(ConfigObject *obj, int row=-1, bool unique=true);
 
   /** Adds the given DMR ID. */
@@ -146,6 +148,18 @@ public:
 
 public:
   ConfigItem *allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err=ErrorStack());
+
+protected:
+  void invalidateIndex();
+  void appendToIndex(ConfigObject *obj, int idx);
+  void removeLastFromIndex(ConfigObject *obj, int idx);
+  void updateIndex(ConfigObject *obj);
+
+protected:
+  /** Maps DMR IDs to the first radio ID with that number, built lazily by @c find. */
+  mutable QHash<uint32_t, DMRRadioID *> _numberIndex;
+  /** If @c false, the number index must be rebuilt. */
+  mutable bool _numberIndexValid;
 };
 
 
@@ -9,6 +9,7 @@
  * Implementation of RadioInterface
  * ********************************************************************************************* */
 RadioInterface::RadioInterface()
+  : _transferStatistics(), _cancel()
 {
 	// pass...
 }
@@ -28,3 +29,31 @@ RadioInterface::reboot(const ErrorStack &err) {
   Q_UNUSED(err)
   return true;
 }
+
+const TransferStatistics &
+RadioInterface::transferStatistics() const {
+  return _transferStatistics;
+}
+
+void
+RadioInterface::resetTransferStatistics() {
+  _transferStatistics.reset();
+}
+
+const CancellationToken &
+RadioInterface::cancellationToken() const {
+  return _cancel;
+}
+
+void
+RadioInterface::setCancellationToken(const CancellationToken &token) {
+  _cancel = token;
+}
+
+bool
+RadioInterface::checkCanceled(const ErrorStack &err) const {
+  if (_cancel.check(err))
+    return true;
+  errMsg(err) << "Transfer canceled.";
+  return false;
+}
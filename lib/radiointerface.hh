@@ -8,6 +8,8 @@
 #include "usbdevice.hh"
 #include "radioinfo.hh"
 #include "errorstack.hh"
+#include "transferstatistics.hh"
+#include "cancellation.hh"
 
 /** Abstract radio interface.
  * A radion interface must provide means to communicate with the device. That is, open a connection
@@ -90,6 +92,29 @@ public:
    * this function does nothing.
    * @param err Passes an error stack to put error messages on. */
   virtual bool reboot(const ErrorStack &err=ErrorStack());
+
+  /** Returns the metrics collected on the communication with the device. */
+  const TransferStatistics &transferStatistics() const;
+  /** Resets the metrics collected on the communication with the device. */
+  void resetTransferStatistics();
+
+  /** Returns the token, the transfers are canceled with. */
+  const CancellationToken &cancellationToken() const;
+  /** Sets the token, the transfers are canceled with. Once canceled, every read and write fails
+   * before the next block is transferred. Hence, the device is left in a state, that allows for
+   * leaving the programming mode cleanly (see @c reboot). */
+  void setCancellationToken(const CancellationToken &token);
+
+protected:
+  /** Checkpoint of the transfers, returns @c false and puts an error message on the stack, if
+   * the transfer got canceled. */
+  bool checkCanceled(const ErrorStack &err) const;
+
+protected:
+  /** The metrics collected on the communication with the device. */
+  TransferStatistics _transferStatistics;
+  /** The token, the transfers are canceled with. */
+  CancellationToken _cancel;
 };
 
 #endif // RADIOINFERFACE_HH
@@ -1,10 +1,19 @@
 #include "radiolimits.hh"
 #include "configobject.hh"
+#include "configreference.hh"
 #include "logger.hh"
 #include "config.hh"
 #include <QMetaProperty>
 #include <QRegularExpression>
+#include <QReadWriteLock>
+#include <QMutex>
+#include <QHash>
 #include <ctype.h>
+#include <algorithm>
+#include <limits>
+
+// Guards the caches of compiled verification plans, limits may be shared between threads.
+static QReadWriteLock _planLock;
 
 // Utility function to check string content for ASCII encoding
 inline bool qstring_is_ascii(const QString &text) {
@@ -17,7 +26,13 @@ inline bool qstring_is_ascii(const QString &text) {
 
 // Utility function to check string content for DTMF encoding
 inline bool qstring_is_dtmf(const QString &text) {
-  return QRegularExpression("^[0-9A-Da-d*#]*$").match(text).isValid();
+  foreach (QChar c, text) {
+    ushort u = c.unicode();
+    if (! (((u >= '0') && (u <= '9')) || ((u >= 'A') && (u <= 'D'))
+           || ((u >= 'a') && (u <= 'd')) || ('*' == u) || ('#' == u)))
+      return false;
+  }
+  return true;
 }
 
 
@@ -26,23 +41,24 @@ inline bool qstring_is_dtmf(const QString &text) {
  * Implementation of RadioLimitIssue
  * ********************************************************************************************* */
 RadioLimitIssue::RadioLimitIssue(Severity severity, const QStringList &stack)
-  : QTextStream(), _severity(severity), _stack(stack), _message()
+  : _severity(severity), _stack(stack), _message(), _repetitions(1)
 {
-  setString(&_message);
+  // pass...
 }
 
 RadioLimitIssue::RadioLimitIssue(const RadioLimitIssue &other)
-  : QTextStream(), _severity(other._severity), _stack(other._stack), _message(other._message)
+  : _severity(other._severity), _stack(other._stack), _message(other._message),
+    _repetitions(other._repetitions)
 {
-  setString(&_message);
+  // pass...
 }
 
 RadioLimitIssue &
 RadioLimitIssue::operator =(const RadioLimitIssue &other) {
-  QTextStream::flush();
   _severity = other._severity;
   _stack = other._stack;
   _message = other._message;
+  _repetitions = other._repetitions;
   return *this;
 }
 
@@ -52,6 +68,73 @@ RadioLimitIssue::operator =(const QString &message) {
   return *this;
 }
 
+RadioLimitIssue &
+RadioLimitIssue::operator <<(const QString &text) {
+  _message.append(text);
+  return *this;
+}
+
+RadioLimitIssue &
+RadioLimitIssue::operator <<(const char *text) {
+  _message.append(QString::fromUtf8(text));
+  return *this;
+}
+
+RadioLimitIssue &
+RadioLimitIssue::operator <<(QChar c) {
+  _message.append(c);
+  return *this;
+}
+
+RadioLimitIssue &
+RadioLimitIssue::operator <<(char c) {
+  _message.append(QChar::fromLatin1(c));
+  return *this;
+}
+
+RadioLimitIssue &
+RadioLimitIssue::operator <<(int value) {
+  _message.append(QString::number(value));
+  return *this;
+}
+
+RadioLimitIssue &
+RadioLimitIssue::operator <<(unsigned int value) {
+  _message.append(QString::number(value));
+  return *this;
+}
+
+RadioLimitIssue &
+RadioLimitIssue::operator <<(long value) {
+  _message.append(QString::number(value));
+  return *this;
+}
+
+RadioLimitIssue &
+RadioLimitIssue::operator <<(unsigned long value) {
+  _message.append(QString::number(value));
+  return *this;
+}
+
+RadioLimitIssue &
+RadioLimitIssue::operator <<(qlonglong value) {
+  _message.append(QString::number(value));
+  return *this;
+}
+
+RadioLimitIssue &
+RadioLimitIssue::operator <<(qulonglong value) {
+  _message.append(QString::number(value));
+  return *this;
+}
+
+RadioLimitIssue &
+RadioLimitIssue::operator <<(double value) {
+  // Same format as QTextStream
+  _message.append(QString::number(value, 'g', 6));
+  return *this;
+}
+
 RadioLimitIssue::Severity
 RadioLimitIssue::severity() const {
   return _severity;
@@ -62,6 +145,16 @@ RadioLimitIssue::message() const {
   return _message;
 }
 
+const QStringList &
+RadioLimitIssue::stack() const {
+  return _stack;
+}
+
+unsigned int
+RadioLimitIssue::repetitions() const {
+  return _repetitions;
+}
+
 QString
 RadioLimitIssue::format() const {
   QString res; QTextStream stream(&res);
@@ -72,6 +165,8 @@ RadioLimitIssue::format() const {
   case Critical: stream << "Crit: "; break;
   }
   stream << "In " << _stack.join(", ") << ": " << _message;
+  if (1 < _repetitions)
+    stream << " (" << _repetitions << " times)";
   stream.flush();
   return res;
 }
@@ -81,37 +176,84 @@ RadioLimitIssue::format() const {
  * Implementation of RadioLimitContext
  * ********************************************************************************************* */
 RadioLimitContext::RadioLimitContext(bool ignoreFrequencyLimits)
-  : _stack(), _ignoreFrequencyLimits(ignoreFrequencyLimits), _maxSeverity(RadioLimitIssue::Silent)
+  : _stack(), _path(), _pathValid(true), _messages(), _ignoreFrequencyLimits(ignoreFrequencyLimits),
+    _maxSeverity(RadioLimitIssue::Silent), _cache(nullptr), _aggregate(false), _sealed(0), _seen(),
+    _maxIssues(-1), _dropped(0), _overflow(RadioLimitIssue::Silent, QStringList())
+{
+  // pass...
+}
+
+RadioLimitContext::RadioLimitContext(RadioLimitCache *cache, bool ignoreFrequencyLimits)
+  : _stack(), _path(), _pathValid(true), _messages(), _ignoreFrequencyLimits(ignoreFrequencyLimits),
+    _maxSeverity(RadioLimitIssue::Silent), _cache(cache), _aggregate(false), _sealed(0), _seen(),
+    _maxIssues(-1), _dropped(0), _overflow(RadioLimitIssue::Silent, QStringList())
 {
   // pass...
 }
 
 RadioLimitIssue &
 RadioLimitContext::newMessage(RadioLimitIssue::Severity severity) {
-  _messages.push_back(RadioLimitIssue(severity, _stack));
   if (severity > _maxSeverity)
     _maxSeverity = severity;
+
+  seal();
+  if ((0 <= _maxIssues) && (_messages.size() >= _maxIssues)) {
+    _dropped++;
+    _overflow = RadioLimitIssue(severity, QStringList());
+    return _overflow;
+  }
+
+  // Issues at the same position share the stack
+  if (! _pathValid) {
+    _path = _stack;
+    _pathValid = true;
+  }
+  _messages.append(RadioLimitIssue(severity, _path));
   return _messages.back();
 }
 
+void
+RadioLimitContext::seal() const {
+  if (! _aggregate) {
+    _sealed = _messages.size();
+    return;
+  }
+  while (_sealed < _messages.size()) {
+    const RadioLimitIssue &issue = _messages.at(_sealed);
+    QPair<int, QString> key(issue.severity(), issue.message());
+    unsigned int repetitions = issue.repetitions();
+    auto first = _seen.constFind(key);
+    if (_seen.constEnd() == first) {
+      _seen.insert(key, _sealed++);
+    } else {
+      _messages[first.value()]._repetitions += repetitions;
+      _messages.remove(_sealed);
+    }
+  }
+}
+
 int
 RadioLimitContext::count() const {
+  seal();
   return _messages.count();
 }
 
 const RadioLimitIssue &
 RadioLimitContext::message(int n) const {
+  seal();
   return _messages.at(n);
 }
 
 void
 RadioLimitContext::push(const QString &element) {
   _stack.append(element);
+  _pathValid = false;
 }
 
 void
 RadioLimitContext::pop() {
   _stack.pop_back();
+  _pathValid = false;
 }
 
 bool
@@ -128,6 +270,240 @@ RadioLimitContext::maxSeverity() const {
   return _maxSeverity;
 }
 
+void
+RadioLimitContext::merge(const RadioLimitContext &other) {
+  for (int i=0; i<other.count(); i++) {
+    const RadioLimitIssue &issue = other.message(i);
+    RadioLimitIssue &msg = newMessage(issue.severity());
+    if (! issue.stack().isEmpty())
+      msg._stack = _stack + issue.stack();
+    msg._message = issue.message();
+    msg._repetitions = issue.repetitions();
+  }
+  _dropped += other.dropped();
+}
+
+void
+RadioLimitContext::enableAggregation(bool enable) {
+  seal();
+  _aggregate = enable;
+}
+
+void
+RadioLimitContext::setMaxIssues(int max) {
+  _maxIssues = max;
+}
+
+unsigned int
+RadioLimitContext::dropped() const {
+  return _dropped;
+}
+
+RadioLimitCache *
+RadioLimitContext::cache() const {
+  return _cache;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of RadioLimitCache
+ * ********************************************************************************************* */
+RadioLimitCache::RadioLimitCache()
+  : _key(), _ignoreFrequencyLimits(false), _generation(0), _entries()
+{
+  // pass...
+}
+
+void
+RadioLimitCache::clear() {
+  _entries.clear();
+}
+
+int
+RadioLimitCache::count() const {
+  return _entries.count();
+}
+
+const QString &
+RadioLimitCache::key() const {
+  return _key;
+}
+
+void
+RadioLimitCache::setKey(const QString &key) {
+  if (key != _key)
+    clear();
+  _key = key;
+}
+
+void
+RadioLimitCache::begin(bool ignoreFrequencyLimits) {
+  if (ignoreFrequencyLimits != _ignoreFrequencyLimits)
+    clear();
+  _ignoreFrequencyLimits = ignoreFrequencyLimits;
+  _generation++;
+}
+
+void
+RadioLimitCache::end() {
+  for (auto entry=_entries.begin(); entry!=_entries.end();) {
+    if (_generation != entry->generation)
+      entry = _entries.erase(entry);
+    else
+      entry++;
+  }
+}
+
+bool
+RadioLimitCache::lookup(const ConfigObject *obj, RadioLimitContext &context, bool &valid) {
+  auto entry = _entries.find(obj);
+  if (_entries.end() == entry)
+    return false;
+
+  // Check if the object or any referenced object was modified or deleted since
+  bool upToDate = (entry->object.object == obj) && (entry->object.revision == obj->revision());
+  for (int i=0; upToDate && (i<entry->dependencies.size()); i++) {
+    const Revision &dep = entry->dependencies.at(i);
+    upToDate = (! dep.object.isNull()) && (dep.revision == dep.object->revision());
+  }
+  if (! upToDate) {
+    _entries.erase(entry);
+    return false;
+  }
+
+  entry->generation = _generation;
+  context.merge(entry->issues);
+  valid = entry->valid;
+  return true;
+}
+
+void
+RadioLimitCache::store(const ConfigObject *obj, const RadioLimitContext &context, bool valid) {
+  QSet<const ConfigObject *> deps;
+  collectDependencies(obj, deps);
+  deps.remove(obj);
+
+  Entry entry{Revision{obj, obj->revision()}, QVector<Revision>(), context, valid, _generation};
+  entry.dependencies.reserve(deps.size());
+  foreach (const ConfigObject *dep, deps)
+    entry.dependencies.append(Revision{dep, dep->revision()});
+  _entries.insert(obj, entry);
+}
+
+void
+RadioLimitCache::collectDependencies(const ConfigItem *item, QSet<const ConfigObject *> &deps) {
+  foreach (const ConfigItem::PropertyInfo &info, ConfigItem::propertyTable(item->metaObject())) {
+    ConfigItem::PropertyKind kind = item->propertyKind(info);
+    if (ConfigItem::PropertyKind::Reference == kind) {
+      ConfigObjectReference *ref = info.prop.read(item).value<ConfigObjectReference *>();
+      if (ref && (! ref->isNull()))
+        deps.insert(ref->as<ConfigObject>());
+    } else if (ConfigItem::PropertyKind::RefList == kind) {
+      ConfigObjectRefList *refs = info.prop.read(item).value<ConfigObjectRefList *>();
+      for (int i=0; refs && (i<refs->count()); i++)
+        deps.insert(refs->get(i));
+    } else if (ConfigItem::PropertyKind::ObjectList == kind) {
+      ConfigObjectList *lst = info.prop.read(item).value<ConfigObjectList *>();
+      for (int i=0; lst && (i<lst->count()); i++)
+        collectDependencies(lst->get(i), deps);
+    } else if (ConfigItem::PropertyKind::Item == kind) {
+      if (ConfigItem *owned = info.prop.read(item).value<ConfigItem *>())
+        collectDependencies(owned, deps);
+    }
+  }
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of RadioLimitUsage
+ * ********************************************************************************************* */
+RadioLimitUsage::RadioLimitUsage()
+  : _stack(), _sections(), _index()
+{
+  // pass...
+}
+
+void
+RadioLimitUsage::push(const QString &name) {
+  _stack.append(name);
+}
+
+void
+RadioLimitUsage::pop() {
+  if (! _stack.isEmpty())
+    _stack.removeLast();
+}
+
+void
+RadioLimitUsage::add(const QString &name, qint64 used, qint64 capacity) {
+  QString path = (_stack + QStringList(name)).join(".");
+  int idx = _index.value(path, -1);
+  if (0 > idx) {
+    idx = _sections.size();
+    _index.insert(path, idx);
+    _sections.append(Section{path, 0, capacity, 0});
+  }
+
+  // Nested lists are reported by the largest one
+  Section &section = _sections[idx];
+  section.used = std::max(section.used, used);
+  if ((0 <= capacity) && (used > capacity))
+    section.exceeded++;
+}
+
+int
+RadioLimitUsage::count() const {
+  return _sections.size();
+}
+
+const RadioLimitUsage::Section &
+RadioLimitUsage::section(int idx) const {
+  return _sections[idx];
+}
+
+bool
+RadioLimitUsage::fits() const {
+  foreach (const Section &section, _sections) {
+    if (section.exceeded)
+      return false;
+  }
+  return true;
+}
+
+int
+RadioLimitUsage::fullest() const {
+  int fullest = -1; double max = -1;
+  for (int i=0; i<_sections.size(); i++) {
+    const Section &section = _sections[i];
+    if (0 > section.capacity)
+      continue;
+    double fill = section.capacity ? double(section.used)/section.capacity
+                                   : (section.used ? std::numeric_limits<double>::infinity() : 0);
+    if (fill > max) {
+      fullest = i; max = fill;
+    }
+  }
+  return fullest;
+}
+
+QString
+RadioLimitUsage::format() const {
+  QStringList lines;
+  foreach (const Section &section, _sections) {
+    QString line = QString("%1: %2").arg(section.name).arg(section.used);
+    if (0 < section.capacity)
+      line += QString(" of %1 (%2%)").arg(section.capacity).arg(100*section.used/section.capacity);
+    else if (0 == section.capacity)
+      line += " of 0";
+    if (1 == section.exceeded)
+      line += ", exceeds capacity";
+    else if (1 < section.exceeded)
+      line += QString(", %1 lists exceed capacity").arg(section.exceeded);
+    lines.append(line);
+  }
+  return lines.join("\n");
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of RadioLimitElement
@@ -142,6 +518,12 @@ RadioLimitElement::~RadioLimitElement() {
   // pass ...
 }
 
+void
+RadioLimitElement::estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const {
+  Q_UNUSED(item); Q_UNUSED(prop); Q_UNUSED(usage);
+  // pass...
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of RadioLimitIgnored
@@ -171,6 +553,12 @@ RadioLimitIgnored::verifyObject(const ConfigObject *item, RadioLimitContext &con
   return true;
 }
 
+void
+RadioLimitIgnored::estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const {
+  Q_UNUSED(item); Q_UNUSED(prop); Q_UNUSED(usage);
+  // Ignored settings take no space
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of RadioLimitValue
@@ -229,9 +617,10 @@ RadioLimitString::verify(const ConfigItem *item, const QMetaProperty &prop, Radi
  * Implementation of RadioLimitStringRegEx
  * ********************************************************************************************* */
 RadioLimitStringRegEx::RadioLimitStringRegEx(const QString &pattern, QObject *parent)
-  : RadioLimitValue(parent), _pattern(pattern)
+  : RadioLimitValue(parent), _source(pattern),
+    _pattern(QRegularExpression::anchoredPattern(pattern))
 {
-  // pass...
+  _pattern.optimize();
 }
 
 bool
@@ -243,10 +632,10 @@ RadioLimitStringRegEx::verify(const ConfigItem *item, const QMetaProperty &prop,
   }
 
   QString value = prop.read(item).toString();
-  if (! _pattern.exactMatch(value)) {
+  if (! _pattern.match(value).hasMatch()) {
     auto &msg = context.newMessage(RadioLimitIssue::Warning);
     msg << "Value '" << value << "' of property " << prop.name()
-        << " does not match pattern '" << _pattern.pattern() << "'.";
+        << " does not match pattern '" << _source << "'.";
   }
 
   return true;
@@ -507,9 +896,36 @@ RadioLimitItem::add(const QString &prop, RadioLimitElement *structure) {
     return false;
   _elements.insert(prop, structure);
   structure->setParent(this);
+  // Plans need to be recompiled
+  QWriteLocker locker(&_planLock);
+  _plans.clear();
   return true;
 }
 
+QVector<RadioLimitItem::PlanStep>
+RadioLimitItem::plan(const QMetaObject *meta) const {
+  {
+    QReadLocker locker(&_planLock);
+    auto cached = _plans.constFind(meta);
+    if (_plans.constEnd() != cached)
+      return cached.value();
+  }
+
+  QVector<PlanStep> steps;
+  foreach (const ConfigItem::PropertyInfo &info, ConfigItem::propertyTable(meta)) {
+    // Should never happen
+    if (! info.prop.isValid())
+      continue;
+    auto element = _elements.constFind(info.prop.name());
+    if (_elements.constEnd() != element)
+      steps.append(PlanStep{info.prop, element.value()});
+  }
+
+  QWriteLocker locker(&_planLock);
+  _plans.insert(meta, steps);
+  return steps;
+}
+
 bool
 RadioLimitItem::verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const {
   if (! prop.isReadable()) {
@@ -524,34 +940,48 @@ RadioLimitItem::verify(const ConfigItem *item, const QMetaProperty &prop, RadioL
     return false;
   }
 
-  if (prop.read(item).isNull())
+  ConfigItem *value = prop.read(item).value<ConfigItem*>();
+  if (nullptr == value)
     return true;
 
   context.push(QString("Property '%1'").arg(prop.name()));
-  bool success = verifyItem(prop.read(item).value<ConfigItem*>(), context);
+  bool success = verifyItem(value, context);
   context.pop();
   return success;
 }
 
 bool
 RadioLimitItem::verifyItem(const ConfigItem *item, RadioLimitContext &context) const {
-  const QMetaObject *meta = item->metaObject();
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-    // This property
-    QMetaProperty prop = meta->property(p);
-    // Should never happen
-    if (! prop.isValid())
-      continue;
-    // Verify property
-    if (_elements.contains(prop.name())) {
-      if (! _elements[prop.name()]->verify(item, prop, context))
-        return false;
-    }
+  // Execute the plan for this type
+  foreach (const PlanStep &step, plan(item->metaObject())) {
+    if (! step.element->verify(item, step.prop, context))
+      return false;
   }
 
   return true;
 }
 
+void
+RadioLimitItem::estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const {
+  if ((! prop.isReadable()) || (! propIsInstance<ConfigItem>(prop)))
+    return;
+
+  ConfigItem *value = prop.read(item).value<ConfigItem*>();
+  if (nullptr == value)
+    return;
+
+  usage.push(prop.name());
+  estimateItem(value, usage);
+  usage.pop();
+}
+
+void
+RadioLimitItem::estimateItem(const ConfigItem *item, RadioLimitUsage &usage) const {
+  // Same plan as the verification, only lists have a capacity
+  foreach (const PlanStep &step, plan(item->metaObject()))
+    step.element->estimate(item, step.prop, usage);
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of RadioLimitObject
@@ -576,6 +1006,12 @@ RadioLimitObject::verifyObject(const ConfigObject *item, RadioLimitContext &cont
   return success;
 }
 
+unsigned int
+RadioLimitObject::entries(const ConfigObject *obj) const {
+  Q_UNUSED(obj);
+  return 1;
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of RadioLimitObjects
@@ -584,20 +1020,37 @@ RadioLimitObjects::RadioLimitObjects(const TypeList &list, QObject *parent)
   : RadioLimitObject(parent), _types()
 {
   for (auto type=list.begin(); type!=list.end(); type++) {
-    _types[type->first.className()] = type->second;
+    _types[&type->first] = type->second;
     type->second->setParent(this);
   }
 }
 
 bool
 RadioLimitObjects::verifyItem(const ConfigItem *item, RadioLimitContext &context) const {
-  if (! _types.contains(item->metaObject()->className())) {
+  RadioLimitObject *limits = _types.value(item->metaObject(), nullptr);
+  if (nullptr == limits) {
+    QStringList classNames;
+    foreach (const QMetaObject *type, _types.keys())
+      classNames.append(type->className());
     auto &msg = context.newMessage(RadioLimitIssue::Critical);
     msg << "Cannot check item of type " << item->metaObject()->className()
-        << ". Unexpected type. Expected one of " << QStringList(_types.keys()).join(", ") << ".";
+        << ". Unexpected type. Expected one of " << classNames.join(", ") << ".";
     return false;
   }
-  return _types[item->metaObject()->className()]->verifyItem(item, context);
+  return limits->verifyItem(item, context);
+}
+
+void
+RadioLimitObjects::estimateItem(const ConfigItem *item, RadioLimitUsage &usage) const {
+  if (RadioLimitObject *limits = _types.value(item->metaObject(), nullptr))
+    limits->estimateItem(item, usage);
+}
+
+unsigned int
+RadioLimitObjects::entries(const ConfigObject *obj) const {
+  if (RadioLimitObject *limits = _types.value(obj->metaObject(), nullptr))
+    return limits->entries(obj);
+  return 1;
 }
 
 
@@ -737,7 +1190,19 @@ RadioLimitList::verify(const ConfigItem *item, const QMetaProperty &prop, RadioL
     counts[className]++;
 
     context.push(QString("Element %1 ('%2')").arg(i).arg(obj->name()));
-    if (! _elements[className]->verifyObject(obj, context)) {
+    bool valid = true;
+    if (RadioLimitCache *cache = context.cache()) {
+      // Verify object separately, if there is no up-to-date result
+      if (! cache->lookup(obj, context, valid)) {
+        RadioLimitContext objContext(context.ignoreFrequencyLimits());
+        valid = _elements[className]->verifyObject(obj, objContext);
+        cache->store(obj, objContext, valid);
+        context.merge(objContext);
+      }
+    } else {
+      valid = _elements[className]->verifyObject(obj, context);
+    }
+    if (! valid) {
       context.pop();
       context.pop();
       return false;
@@ -764,13 +1229,59 @@ RadioLimitList::verify(const ConfigItem *item, const QMetaProperty &prop, RadioL
   return true;
 }
 
+void
+RadioLimitList::estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const {
+  if (! prop.isReadable())
+    return;
+  const ConfigObjectList *plist = prop.read(item).value<ConfigObjectList*>();
+  if (nullptr == plist)
+    return;
+
+  // Count entries per type first, such that the list is reported before its nested lists
+  QHash<QString, qint64> counts;
+  for (int i=0; i<plist->count(); i++) {
+    ConfigObject *obj = plist->get(i);
+    QString className = findClassName(*(obj->metaObject()));
+    if (! className.isEmpty())
+      counts[className] += _elements.value(className)->entries(obj);
+  }
+
+  // Lists of a single type are reported by the name of the property only
+  QStringList classNames = _elements.keys(); classNames.sort();
+  foreach (const QString &className, classNames) {
+    QString name = (1 == classNames.size()) ? QString(prop.name())
+                                            : QString("%1.%2").arg(prop.name()).arg(className);
+    usage.add(name, counts.value(className, 0), _maxCount.value(className, -1));
+  }
+
+  usage.push(prop.name());
+  for (int i=0; i<plist->count(); i++) {
+    ConfigObject *obj = plist->get(i);
+    QString className = findClassName(*(obj->metaObject()));
+    if (! className.isEmpty())
+      _elements.value(className)->estimateItem(obj, usage);
+  }
+  usage.pop();
+}
+
 QString
 RadioLimitList::findClassName(const QMetaObject &type) const {
-  if (_elements.contains(type.className()))
-    return type.className();
-  if (const QMetaObject *super = type.superClass())
-    return findClassName(*super);
-  return "";
+  {
+    QReadLocker locker(&_planLock);
+    auto cached = _classNames.constFind(&type);
+    if (_classNames.constEnd() != cached)
+      return cached.value();
+  }
+
+  QString className;
+  for (const QMetaObject *t = &type; (nullptr != t) && className.isEmpty(); t = t->superClass()) {
+    if (_elements.contains(t->className()))
+      className = t->className();
+  }
+
+  QWriteLocker locker(&_planLock);
+  _classNames.insert(&type, className);
+  return className;
 }
 
 
@@ -824,6 +1335,14 @@ RadioLimitRefList::verify(const ConfigItem *item, const QMetaProperty &prop, Rad
   return true;
 }
 
+void
+RadioLimitRefList::estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const {
+  if (! prop.isReadable())
+    return;
+  if (const ConfigObjectRefList *plist = prop.read(item).value<ConfigObjectRefList*>())
+    usage.add(prop.name(), plist->count(), _maxSize);
+}
+
 bool
 RadioLimitRefList::validType(const QMetaObject *type) const {
   if (_types.contains(type->className()))
@@ -890,6 +1409,15 @@ RadioLimitGroupCallRefList::verify(const ConfigItem *item, const QMetaProperty &
 }
 
 
+void
+RadioLimitGroupCallRefList::estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const {
+  if (! prop.isReadable())
+    return;
+  if (const ConfigObjectRefList *plist = prop.read(item).value<ConfigObjectRefList*>())
+    usage.add(prop.name(), plist->count(), _maxSize);
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of RadioLimitSingleZone
  * ********************************************************************************************* */
@@ -916,6 +1444,12 @@ RadioLimitSingleZone::verifyItem(const ConfigItem *item, RadioLimitContext &cont
   return true;
 }
 
+unsigned int
+RadioLimitSingleZone::entries(const ConfigObject *obj) const {
+  const Zone *zone = obj->as<Zone>();
+  return (zone && zone->B()->count()) ? 2 : 1;
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of RadioLimits
@@ -927,7 +1461,7 @@ RadioLimits::RadioLimits(bool betaWarning, QObject *parent)
 }
 
 RadioLimits::RadioLimits(const std::initializer_list<std::pair<QString, RadioLimitElement *> > &list, QObject *parent)
-  : RadioLimitItem(list, parent)
+  : RadioLimitItem(list, parent), _betaWarning(false)
 {
   // pass...
 }
@@ -955,5 +1489,30 @@ RadioLimits::verifyConfig(const Config *config, RadioLimitContext &context) cons
              "missing or are not well tested.");
   }
 
-  return verifyItem(config, context);
+  RadioLimitCache *cache = context.cache();
+  if (cache)
+    cache->begin(context.ignoreFrequencyLimits());
+  bool success = verifyItem(config, context);
+  if (cache)
+    cache->end();
+  return success;
+}
+
+RadioLimitUsage
+RadioLimits::estimateUsage(const Config *config) const {
+  RadioLimitUsage usage;
+  estimateItem(config, usage);
+  return usage;
+}
+
+const RadioLimits *
+RadioLimits::shared(const QString &key, const Factory &factory) {
+  // The limits are built while holding the lock, hence every instance gets created once only
+  static QMutex lock;
+  static QHash<QString, const RadioLimits *> instances;
+
+  QMutexLocker locker(&lock);
+  if (! instances.contains(key))
+    instances.insert(key, factory());
+  return instances.value(key);
 }
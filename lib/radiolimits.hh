@@ -33,6 +33,11 @@
 #include <QTextStream>
 #include <QMetaType>
 #include <QSet>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QVector>
+#include <QMetaProperty>
+#include <functional>
 
 #include "frequency.hh"
 #include "ranges.hh"
@@ -45,8 +50,12 @@ class RadioLimits;
 
 
 /** Represents a single issue found during verification.
+ *
+ * The message is assembled using the stream operators. In contrast to a @c QTextStream, the
+ * issue just appends to its message and is therefore cheap to create and copy.
+ *
  * @ingroup limits */
-class RadioLimitIssue: public QTextStream
+class RadioLimitIssue
 {
 public:
   /** Defines the possible severity levels. */
@@ -69,23 +78,58 @@ public:
   /** Set message. */
   RadioLimitIssue &operator =(const QString &message);
 
+  /** Appends the given text to the message. */
+  RadioLimitIssue &operator <<(const QString &text);
+  /** Appends the given text to the message. */
+  RadioLimitIssue &operator <<(const char *text);
+  /** Appends the given character to the message. */
+  RadioLimitIssue &operator <<(QChar c);
+  /** Appends the given character to the message. */
+  RadioLimitIssue &operator <<(char c);
+  /** Appends the given number to the message. */
+  RadioLimitIssue &operator <<(int value);
+  /** Appends the given number to the message. */
+  RadioLimitIssue &operator <<(unsigned int value);
+  /** Appends the given number to the message. */
+  RadioLimitIssue &operator <<(long value);
+  /** Appends the given number to the message. */
+  RadioLimitIssue &operator <<(unsigned long value);
+  /** Appends the given number to the message. */
+  RadioLimitIssue &operator <<(qlonglong value);
+  /** Appends the given number to the message. */
+  RadioLimitIssue &operator <<(qulonglong value);
+  /** Appends the given number to the message. */
+  RadioLimitIssue &operator <<(double value);
+
   /** Returns the severity of the issue. */
   Severity severity() const;
   /** Returns the text message. */
   const QString &message() const;
+  /** Returns the item-stack, where the issue occurred. */
+  const QStringList &stack() const;
+  /** Returns how often this issue occurred. This is larger than 1, if identical issues were
+   * collapsed, see @c RadioLimitContext::enableAggregation. */
+  unsigned int repetitions() const;
   /** Formats the message. */
   QString format() const;
 
 protected:
   /** Holds the severity of the issue. */
   Severity _severity;
-  /** Holds the item-stack (where the issue occurred). */
+  /** Holds the item-stack (where the issue occurred). Issues at the same position share the
+   * stack. */
   QStringList _stack;
   /** Holds the text message. */
   QString _message;
+  /** How often the issue occurred. */
+  unsigned int _repetitions;
+
+  friend class RadioLimitContext;
 };
 
 
+class RadioLimitCache;
+
 /** Collects the issues found during verification.
  * This class also tracks where the issues arise.
  *
@@ -95,6 +139,8 @@ class RadioLimitContext
 public:
   /** Empty constructor. */
   explicit RadioLimitContext(bool ignoreFrequencyLimits=false);
+  /** Constructs a context using the given cache, see @c RadioLimitCache. */
+  RadioLimitContext(RadioLimitCache *cache, bool ignoreFrequencyLimits=false);
 
   /** Constructs a new message and puts it into the list of issues. */
   RadioLimitIssue &newMessage(RadioLimitIssue::Severity severity = RadioLimitIssue::Hint);
@@ -118,15 +164,182 @@ public:
   /** Returns the highest severity of the messages. */
   RadioLimitIssue::Severity maxSeverity() const;
 
+  /** Appends all issues of the given context. The item stack of the issues is put on top of the
+   * current stack of this context. */
+  void merge(const RadioLimitContext &other);
+
+  /** Returns the cache of verification results or @c nullptr, if there is none. */
+  RadioLimitCache *cache() const;
+
+  /** If enabled, identical issues (same severity and message) are collapsed into the first one.
+   * The number of occurrences is then reported by @c RadioLimitIssue::repetitions. */
+  void enableAggregation(bool enable=true);
+  /** Limits the number of collected issues. Further issues are counted but dropped. A negative
+   * value (default) means no limit. */
+  void setMaxIssues(int max);
+  /** Returns the number of dropped issues, see @c setMaxIssues. */
+  unsigned int dropped() const;
+
+protected:
+  /** Collapses the last issue into an identical earlier one, if aggregation is enabled. As
+   * messages are written after they got created, this happens once the next issue is created or
+   * the issues are accessed. */
+  void seal() const;
+
 protected:
   /** The current item stack. */
   QStringList _stack;
+  /** Snapshot of the current item stack, shared by all issues created at the same position. */
+  QStringList _path;
+  /** If @c false, the snapshot of the item stack is outdated. */
+  bool _pathValid;
   /** The list of issues found. */
-  QList<RadioLimitIssue> _messages;
+  mutable QVector<RadioLimitIssue> _messages;
   /** If @c true, any frequency range voilation is a warning. */
   bool _ignoreFrequencyLimits;
   /** Holds the highest severity of all messages. */
   RadioLimitIssue::Severity _maxSeverity;
+  /** A weak reference to the cache of verification results. */
+  RadioLimitCache *_cache;
+  /** If @c true, identical issues get collapsed. */
+  bool _aggregate;
+  /** Number of issues already checked for duplicates. */
+  mutable int _sealed;
+  /** Maps severity and message of the issues to their index. */
+  mutable QHash<QPair<int, QString>, int> _seen;
+  /** Maximum number of issues or -1. */
+  int _maxIssues;
+  /** Number of dropped issues. */
+  unsigned int _dropped;
+  /** Receives the dropped issues. */
+  RadioLimitIssue _overflow;
+};
+
+
+/** Caches the issues found for the elements of object lists (e.g., channels, contacts, zones)
+ * between several verifications of the same config.
+ *
+ * When verifying a config with a context using a cache, only those objects get verified, that
+ * got modified since the last verification or that refer to objects that were modified since
+ * then. For all other objects, the cached issues are reported. Hence, repeated verification of
+ * large configs after small changes is fast.
+ *
+ * The cache is bound to a key identifying the radio (see @c setKey) and the settings it was
+ * filled with. It gets cleared automatically, if the key or the settings change.
+ *
+ * @ingroup limits */
+class RadioLimitCache
+{
+public:
+  /** Empty constructor. */
+  RadioLimitCache();
+
+  /** Removes all cached results. */
+  void clear();
+  /** Returns the number of cached objects. */
+  int count() const;
+
+  /** Returns the key identifying the radio, the cache was filled for. */
+  const QString &key() const;
+  /** Sets the key identifying the radio. The cache gets cleared if the key changes. The limits
+   * of a radio are usually created per radio instance, hence the instances cannot be used to
+   * identify the radio. */
+  void setKey(const QString &key);
+
+  /** Gets called before a config gets verified. Clears the cache, if it was filled with
+   * different settings. */
+  void begin(bool ignoreFrequencyLimits);
+  /** Gets called after the config got verified. Drops all results of objects, that were not
+   * part of the verification. */
+  void end();
+
+  /** Looks up the results for the given object. If there are valid results, the issues are
+   * merged into the given context and @c true is returned. The result of the verification is
+   * stored in @c valid. */
+  bool lookup(const ConfigObject *obj, RadioLimitContext &context, bool &valid);
+  /** Stores the results of the verification of the given object. */
+  void store(const ConfigObject *obj, const RadioLimitContext &context, bool valid);
+
+protected:
+  /** Collects the objects referenced by the given item and its owned items. */
+  static void collectDependencies(const ConfigItem *item, QSet<const ConfigObject *> &deps);
+
+protected:
+  /** A watched object and its revision, the results were obtained with. */
+  struct Revision {
+    QPointer<const ConfigObject> object; ///< The object.
+    unsigned int revision;               ///< Its revision.
+  };
+
+  /** The cached results of a single object. */
+  struct Entry {
+    Revision object;                     ///< The verified object.
+    QVector<Revision> dependencies;      ///< The objects referenced by the verified object.
+    RadioLimitContext issues;            ///< The issues found.
+    bool valid;                          ///< The result of the verification.
+    unsigned int generation;             ///< The verification run, the entry was used last.
+  };
+
+  /** The key identifying the radio, the cache is filled for. */
+  QString _key;
+  /** The setting, the cache is filled with. */
+  bool _ignoreFrequencyLimits;
+  /** Counts the verification runs. */
+  unsigned int _generation;
+  /** The cached results. */
+  QHash<const ConfigObject *, Entry> _entries;
+};
+
+
+/** Collects the use of the capacities of a radio by a config, see @c RadioLimits::estimateUsage.
+ *
+ * The usage is split into sections, one for every limited list of the radio. For example,
+ * "channels" for the channel list or "zones.A" for the channels within the zones. For lists held
+ * by every element of another list (e.g., the channels of zones), the largest one is reported
+ * together with the number of lists exceeding the capacity.
+ *
+ * @ingroup limits */
+class RadioLimitUsage
+{
+public:
+  /** The use of a single section. */
+  struct Section {
+    QString name;           ///< The name of the section, e.g., "zones.A".
+    qint64 used;            ///< The number of elements, the largest one for nested lists.
+    qint64 capacity;        ///< The capacity of the section or -1 if unlimited.
+    unsigned int exceeded;  ///< The number of lists exceeding the capacity.
+  };
+
+public:
+  /** Empty constructor. */
+  RadioLimitUsage();
+
+  /** Enters a nested item or list with the given name. */
+  void push(const QString &name);
+  /** Leaves the current nested item or list. */
+  void pop();
+  /** Adds the use of a list with the given name within the current nesting. */
+  void add(const QString &name, qint64 used, qint64 capacity);
+
+  /** Returns the number of sections. */
+  int count() const;
+  /** Returns the specified section. */
+  const Section &section(int idx) const;
+  /** Returns @c true if no section exceeds its capacity. */
+  bool fits() const;
+  /** Returns the index of the section with the highest use relative to its capacity or -1 if
+   * no section has a capacity. */
+  int fullest() const;
+  /** Formats the usage as a human readable, multi-line text. */
+  QString format() const;
+
+protected:
+  /** The names of the nested items and lists. */
+  QStringList _stack;
+  /** The sections in order of their first appearance. */
+  QVector<Section> _sections;
+  /** Maps the section names to their index. */
+  QHash<QString, int> _index;
 };
 
 
@@ -149,6 +362,9 @@ public:
   /** Verifies the given property of the specified item.
    * This method gets implemented by the specialized classes to implement the actual verification. */
   virtual bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const = 0;
+  /** Adds the use of the capacities by the given property of the specified item. Only lists have
+   * a capacity, hence the default implementation does nothing. */
+  virtual void estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const;
 
 public:
   /** Destructor. */
@@ -223,8 +439,10 @@ public:
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
 
 protected:
-  /** Holds the regular expression pattern. */
-  QRegExp _pattern;
+  /** Holds the regular expression pattern, as passed to the constructor. */
+  QString _source;
+  /** Holds the compiled regular expression, anchored to match the complete string. */
+  QRegularExpression _pattern;
 };
 
 
@@ -414,9 +632,26 @@ public:
   /** Verifies the properties of the given item. */
   virtual bool verifyItem(const ConfigItem *item, RadioLimitContext &context) const;
 
+  void estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const;
+  /** Adds the use of the capacities by the properties of the given item. */
+  virtual void estimateItem(const ConfigItem *item, RadioLimitUsage &usage) const;
+
+protected:
+  /** A single step of a verification plan, applying the limits to a property. */
+  struct PlanStep {
+    QMetaProperty prop;             ///< The property to verify.
+    RadioLimitElement *element;     ///< The limits for the property.
+  };
+
+  /** Returns the verification plan for items of the given type. That is, the properties of the
+   * type having limits in the order of their index. The plan gets compiled once per type. */
+  QVector<PlanStep> plan(const QMetaObject *meta) const;
+
 protected:
   /** Holds the property <-> limits map. */
   QHash<QString, RadioLimitElement *> _elements;
+  /** Caches the compiled verification plans per type. */
+  mutable QHash<const QMetaObject *, QVector<PlanStep>> _plans;
 };
 
 
@@ -435,6 +670,8 @@ public:
 
   /** Verifies the properties of the given object. */
   virtual bool verifyObject(const ConfigObject *item, RadioLimitContext &context) const;
+  /** Returns the number of entries the given object takes in its list within the codeplug. */
+  virtual unsigned int entries(const ConfigObject *obj) const;
 };
 
 
@@ -454,6 +691,7 @@ public:
 
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
   bool verifyObject(const ConfigObject *item, RadioLimitContext &context) const;
+  void estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const;
 
 protected:
   /** Holds the level of the notification. */
@@ -498,10 +736,12 @@ public:
   RadioLimitObjects(const TypeList &list, QObject *parent=nullptr);
 
   bool verifyItem(const ConfigItem *item, RadioLimitContext &context) const;
+  void estimateItem(const ConfigItem *item, RadioLimitUsage &usage) const;
+  unsigned int entries(const ConfigObject *obj) const;
 
 protected:
-  /** Maps class-names to object limits. */
-  QHash<QString,  RadioLimitObject *> _types;
+  /** Maps types to object limits. */
+  QHash<const QMetaObject *, RadioLimitObject *> _types;
 };
 
 
@@ -585,9 +825,11 @@ public:
   RadioLimitList(const std::initializer_list<ElementLimits> &elements, QObject *parent=nullptr);
 
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
+  void estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const;
 
 protected:
-  /** Searches for the specified type or one of its super-clsases in the set of allowed types. */
+  /** Searches for the specified type or one of its super-clsases in the set of allowed types.
+   * The result is cached per type. */
   QString findClassName(const QMetaObject &type) const;
 
 protected:
@@ -597,6 +839,8 @@ protected:
   QHash<QString, qint64> _minCount;
   /** Maps typename to maximum count. */
   QHash<QString, qint64> _maxCount;
+  /** Caches the typenames found by @c findClassName. */
+  mutable QHash<const QMetaObject *, QString> _classNames;
 };
 
 
@@ -615,6 +859,7 @@ public:
   RadioLimitRefList(int minSize, int maxSize, const QMetaObject &type, QObject *parent=nullptr);
 
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
+  void estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const;
 
 protected:
   /** Checks if the given type is one of the valid ones in @c _types. */
@@ -645,6 +890,7 @@ public:
   RadioLimitGroupCallRefList(int minSize, int maxSize, QObject *parent=nullptr);
 
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
+  void estimate(const ConfigItem *item, const QMetaProperty &prop, RadioLimitUsage &usage) const;
 
 protected:
   /** Holds the minimum size of the list. */
@@ -673,6 +919,8 @@ public:
   RadioLimitSingleZone(qint64 maxSize, const PropList &list, QObject *parent=nullptr);
 
   bool verifyItem(const ConfigItem *item, RadioLimitContext &context) const;
+  /** A zone holding two channel lists takes two entries, as it gets split. */
+  unsigned int entries(const ConfigObject *obj) const;
 };
 
 
@@ -692,6 +940,13 @@ public:
 
   /** Verifies the given configuration. */
   virtual bool verifyConfig(const Config *config, RadioLimitContext &context) const;
+  /** Estimates the use of the capacities of the radio by the given configuration.
+   *
+   * In contrast to encoding the config, the estimate only counts the elements of the limited
+   * lists in a single pass over the config. No codeplug gets allocated and the config does not get
+   * pre-processed. Hence it is cheap enough to be updated on every change of the config, but
+   * elements created by the pre-processing of some radios are not counted. */
+  RadioLimitUsage estimateUsage(const Config *config) const;
 
   /** Returns @c true if the radio supports a call-sign DB. */
   bool hasCallSignDB() const;
@@ -700,6 +955,15 @@ public:
   /** Returns the maximum number of entries in the call-sign DB. */
   unsigned numCallSignDBEntries() const;
 
+  /** Factory of radio limits, see @c shared. */
+  typedef std::function<RadioLimits *()> Factory;
+
+  /** Returns the limits shared by all radios of the same model and variant, identified by the
+   * given @c key. The limits are created once using the given @c factory, the first time they
+   * are requested. This method is thread-safe. The returned limits are never deleted and must
+   * not be modified, hence they can be used from any thread. */
+  static const RadioLimits *shared(const QString &key, const Factory &factory);
+
 protected:
   /** If @c true, a warning is issued that the radio is still under development and not well
    * tested yet. */
@@ -6,8 +6,6 @@
 #define BSIZE 128
 
 
-RadioLimits *RD5R::_limits = nullptr;
-
 RD5R::RD5R(RadioddityInterface *device, QObject *parent)
   : RadioddityRadio(device, parent), _name("Baofeng/Radioddity RD-5R"), _codeplug()
 {
@@ -25,9 +23,7 @@ RD5R::name() const {
 
 const RadioLimits &
 RD5R::limits() const {
-  if (nullptr == _limits)
-    _limits = new RD5RLimits();
-  return *_limits;
+  return *RadioLimits::shared("rd5r", []() -> RadioLimits * { return new RD5RLimits(); });
 }
 
 const Codeplug &
@@ -58,10 +58,6 @@ private:
 	QString _name;
   /** Current device specific codeplug. */
 	RD5RCodeplug _codeplug;
-
-private:
-  /** Holds the singleton instance of the radio limits. */
-  static RadioLimits *_limits;
 };
 
 #endif // RD5R_HH
@@ -3,6 +3,7 @@
 #include "channel.hh"
 #include "utils.hh"
 #include "logger.hh"
+#include "tracer.hh"
 #include <QDateTime>
 
 //#define ADDR_ENCRYPTION           0x001370
@@ -211,8 +212,17 @@ RD5RCodeplug::clear() {
   this->clearTimestamp();
 }
 
+std::vector<AddressMap::Range>
+RD5RCodeplug::generatedMemory() const {
+  // Contacts and DTMF contacts are cleared before encoding.
+  return {
+    {ADDR_CONTACTS, NUM_CONTACTS*CONTACT_SIZE}, {ADDR_DTMF_CONTACTS, NUM_DTMF_CONTACTS*DTMF_CONTACT_SIZE}
+  };
+}
+
 bool
 RD5RCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("RD5RCodeplug::encodeElements", "codeplug");
   if (! RadioddityCodeplug::encodeElements(flags, ctx, err))
     return false;
 
@@ -227,6 +237,7 @@ RD5RCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStack
 
 bool
 RD5RCodeplug::decodeElements(Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("RD5RCodeplug::decodeElements", "codeplug");
   if (! RadioddityCodeplug::decodeElements(ctx, err))
     return false;
   return true;
@@ -151,6 +151,7 @@ public:
   RD5RCodeplug(QObject *parent=0);
 
   void clear();
+  std::vector<AddressMap::Range> generatedMemory() const;
 
 public:
   bool encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
@@ -0,0 +1,114 @@
+#include "readbackverifier.hh"
+#include "logger.hh"
+#include <algorithm>
+
+
+/* ********************************************************************************************* *
+ * Implementation of ReadbackVerifier
+ * ********************************************************************************************* */
+ReadbackVerifier::ReadbackVerifier()
+  : _enabled(false), _samples(0), _blockSize(1024), _blocks(), _mismatches()
+{
+  // pass...
+}
+
+bool
+ReadbackVerifier::isEnabled() const {
+  return _enabled;
+}
+
+void
+ReadbackVerifier::setEnabled(bool enabled, unsigned samples) {
+  _enabled = enabled;
+  _samples = samples;
+}
+
+unsigned
+ReadbackVerifier::samples() const {
+  return _samples;
+}
+
+void
+ReadbackVerifier::setBlockSize(unsigned size) {
+  _blockSize = std::max(1U, size);
+}
+
+void
+ReadbackVerifier::reset() {
+  _blocks.clear();
+  _mismatches.clear();
+}
+
+void
+ReadbackVerifier::add(uint32_t bank, uint32_t addr, const uint8_t *data, unsigned size) {
+  if (! _enabled)
+    return;
+  unsigned offset = 0;
+  // Extend the last block, if the region is adjacent to it
+  if ((! _blocks.isEmpty()) && (_blocks.last().bank == bank) &&
+      ((_blocks.last().address+_blocks.last().size) == addr) && (_blocks.last().size < _blockSize)) {
+    Block &last = _blocks.last();
+    unsigned n = std::min(_blockSize-last.size, size);
+    last.crc.update(data, n);
+    last.size += n;
+    offset = n;
+  }
+  for (; offset<size; offset+=_blockSize) {
+    Block block = {bank, addr+offset, std::min(_blockSize, size-offset), CRC32()};
+    block.crc.update(data+offset, block.size);
+    _blocks.append(block);
+  }
+}
+
+unsigned
+ReadbackVerifier::numBlocks() const {
+  return _blocks.size();
+}
+
+bool
+ReadbackVerifier::verify(const Reader &reader, const ErrorStack &err) {
+  _mismatches.clear();
+  if (_blocks.isEmpty())
+    return true;
+
+  unsigned count = _blocks.size();
+  if (_samples && (_samples < count))
+    count = _samples;
+  double step = double(_blocks.size())/count;
+
+  QByteArray buffer(_blockSize, 0);
+  for (unsigned i=0; i<count; i++) {
+    const Block &block = _blocks.at(unsigned(i*step));
+    if (! reader(block.bank, block.address, (uint8_t *)buffer.data(), block.size, err)) {
+      errMsg(err) << "Cannot read back block at " << QString::number(block.address, 16) << "h.";
+      return false;
+    }
+    CRC32 crc; crc.update((const uint8_t *)buffer.constData(), block.size);
+    if (crc.get() == block.crc.get())
+      continue;
+    // Merge with previous range, if adjacent
+    if ((! _mismatches.isEmpty()) && (_mismatches.last().bank == block.bank) &&
+        ((_mismatches.last().address+_mismatches.last().size) == block.address)) {
+      _mismatches.last().size += block.size;
+    } else {
+      _mismatches.append({block.bank, block.address, block.size});
+    }
+  }
+
+  logDebug() << "Verified " << count << " of " << _blocks.size() << " written blocks.";
+  if (_mismatches.isEmpty())
+    return true;
+
+  ErrorStack::MessageStream msg(err, __FILE__, __LINE__);
+  msg << "Readback verification failed, " << _mismatches.size() << " mismatching range(s):";
+  foreach (Range range, _mismatches) {
+    msg << "\n  bank " << range.bank << ": " << QString::number(range.address, 16)
+        << "h-" << QString::number(range.address+range.size-1, 16) << "h";
+  }
+  return false;
+}
+
+const QVector<ReadbackVerifier::Range> &
+ReadbackVerifier::mismatches() const {
+  return _mismatches;
+}
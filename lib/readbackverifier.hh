@@ -0,0 +1,82 @@
+#ifndef READBACKVERIFIER_HH
+#define READBACKVERIFIER_HH
+
+#include <QVector>
+#include <QString>
+#include <functional>
+#include "errorstack.hh"
+#include "crc32.hh"
+
+/** Verifies an upload by reading back the written blocks from the device.
+ *
+ * During the upload, the CRC32 of every written block is recorded. Once the upload is complete,
+ * either all written blocks or a sample of them are read back from the device and their CRC32
+ * gets compared to the recorded one. Mismatching blocks are reported as merged address ranges.
+ * Compared to a full download of the codeplug, only the written blocks are read at most.
+ *
+ * @ingroup rif */
+class ReadbackVerifier
+{
+public:
+  /** A mismatching address range. */
+  struct Range {
+    uint32_t bank;    ///< The memory bank.
+    uint32_t address; ///< The start address.
+    uint32_t size;    ///< The size of the range in bytes.
+  };
+
+  /** Function to read @c n bytes at the given bank and address from the device. */
+  typedef std::function<bool(uint32_t bank, uint32_t addr, uint8_t *data, int n, const ErrorStack &err)> Reader;
+
+public:
+  /** Constructs a disabled verifier. */
+  ReadbackVerifier();
+
+  /** Returns @c true if the verification is enabled. */
+  bool isEnabled() const;
+  /** Enables or disables the verification. If @c samples is 0, all written blocks are
+   * verified. Otherwise, only the given number of blocks, evenly spread over all written blocks. */
+  void setEnabled(bool enabled, unsigned samples=0);
+  /** Returns the number of sampled blocks, 0 means all. */
+  unsigned samples() const;
+
+  /** Sets the size of the blocks read back from the device. Written regions are split into
+   * blocks of this size, adjacent regions are merged up to this size. */
+  void setBlockSize(unsigned size);
+
+  /** Forgets all recorded blocks and mismatches. */
+  void reset();
+  /** Records a written region. Does nothing, if the verification is disabled. */
+  void add(uint32_t bank, uint32_t addr, const uint8_t *data, unsigned size);
+  /** Returns the number of recorded blocks. */
+  unsigned numBlocks() const;
+
+  /** Reads back the recorded blocks (or a sample of them) using the given reader and compares
+   * them. Returns @c false if a block cannot be read or does not match. */
+  bool verify(const Reader &reader, const ErrorStack &err=ErrorStack());
+  /** Returns the mismatching ranges found by the last verification. */
+  const QVector<Range> &mismatches() const;
+
+protected:
+  /** A written block. */
+  struct Block {
+    uint32_t bank;    ///< The memory bank.
+    uint32_t address; ///< The address.
+    uint32_t size;    ///< The size in bytes.
+    CRC32 crc;        ///< The CRC32 of the written data.
+  };
+
+protected:
+  /** If @c true, the verification is enabled. */
+  bool _enabled;
+  /** Number of sampled blocks, 0 means all. */
+  unsigned _samples;
+  /** Size of the blocks. */
+  unsigned _blockSize;
+  /** The recorded blocks. */
+  QVector<Block> _blocks;
+  /** The mismatching ranges. */
+  QVector<Range> _mismatches;
+};
+
+#endif // READBACKVERIFIER_HH
@@ -0,0 +1,212 @@
+#include "repeaterselection.hh"
+#include "configbuilder.hh"
+#include "channel.hh"
+#include "zone.hh"
+#include "utils.hh"
+#include "logger.hh"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QTextStream>
+#include <QHash>
+
+
+/* ********************************************************************************************* *
+ * Implementation of RepeaterSelection::Repeater
+ * ********************************************************************************************* */
+RepeaterSelection::Repeater::Repeater()
+  : call(), qth(), location(), rxFrequency(), txFrequency(), isFM(false), isDMR(false),
+    colorCode(1), rxTone(Signaling::SIGNALING_NONE), txTone(Signaling::SIGNALING_NONE)
+{
+  // pass...
+}
+
+bool
+RepeaterSelection::Repeater::fromRepeaterBook(const QJsonObject &obj) {
+  call = obj["Callsign"].toString();
+  qth = obj["Nearest City"].toString();
+  location = QGeoCoordinate(obj["Lat"].toString().toDouble(), obj["Long"].toString().toDouble());
+  rxFrequency = Frequency::fromMHz(obj["Frequency"].toString().toDouble());
+  txFrequency = Frequency::fromMHz(obj["Input Freq"].toString().toDouble());
+
+  if (obj["FM Analog"].toString() == "Yes") {
+    isFM = true;
+    if (obj.contains("PL"))
+      txTone = Signaling::fromCTCSSFrequency(obj["PL"].toString().toDouble());
+    if (obj.contains("TSQ"))
+      rxTone = Signaling::fromCTCSSFrequency(obj["TSQ"].toString().toDouble());
+  }
+
+  if (obj["DMR"].toString() == "Yes") {
+    isDMR = true;
+    if (obj.contains("DMR Color Code"))
+      colorCode = obj["DMR Color Code"].toString().toUInt();
+  }
+
+  return (! call.isEmpty()) && location.isValid() && (isFM || isDMR);
+}
+
+bool
+RepeaterSelection::Repeater::matches(Mode mode) const {
+  return (isDMR && (int(mode) & int(Mode::DMR))) || (isFM && (int(mode) & int(Mode::FM)));
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of RepeaterSelection
+ * ********************************************************************************************* */
+RepeaterSelection::RepeaterSelection()
+  : _repeaters(), _index()
+{
+  // pass...
+}
+
+int
+RepeaterSelection::count() const {
+  return _repeaters.size();
+}
+
+const RepeaterSelection::Repeater &
+RepeaterSelection::repeater(int idx) const {
+  return _repeaters[idx];
+}
+
+void
+RepeaterSelection::add(const Repeater &repeater) {
+  _repeaters.append(repeater);
+  _index.append(repeater.location);
+}
+
+bool
+RepeaterSelection::readRepeaterBook(const QString &filename, const ErrorStack &err) {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open repeater list '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+
+  QJsonParseError error;
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+  if (! doc.isObject()) {
+    errMsg(err) << "Cannot parse repeater list '" << filename << "': " << error.errorString() << ".";
+    return false;
+  }
+
+  QJsonArray results = doc.object().value("results").toArray();
+  _repeaters.reserve(_repeaters.size() + results.size());
+  _index.reserve(_index.size() + results.size());
+  int skipped = 0;
+  foreach (const QJsonValue &value, results) {
+    Repeater repeater;
+    if (! repeater.fromRepeaterBook(value.toObject())) {
+      skipped++;
+      continue;
+    }
+    add(repeater);
+  }
+
+  logDebug() << "Read " << (results.size()-skipped) << " repeaters from '" << filename
+             << "', skipped " << skipped << " incomplete ones.";
+  return true;
+}
+
+bool
+RepeaterSelection::readWaypoints(const QString &filename, QList<Waypoint> &waypoints, const ErrorStack &err) {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open waypoints '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+
+  QTextStream stream(&file);
+  for (int lineno=1; !stream.atEnd(); lineno++) {
+    QString line = stream.readLine().trimmed();
+    if (line.isEmpty() || line.startsWith('#'))
+      continue;
+
+    QStringList fields = line.split(',');
+    for (int i=0; i<fields.size(); i++)
+      fields[i] = fields[i].trimmed();
+
+    Waypoint waypoint;
+    waypoint.name = fields.first();
+    if (2 == fields.size()) {
+      waypoint.location = loc2deg(fields.at(1));
+    } else if (3 == fields.size()) {
+      bool latOk, lonOk;
+      waypoint.location = QGeoCoordinate(fields.at(1).toDouble(&latOk), fields.at(2).toDouble(&lonOk));
+      if ((! latOk) || (! lonOk))
+        waypoint.location = QGeoCoordinate();
+    }
+
+    if (waypoint.name.isEmpty() || (! waypoint.location.isValid())) {
+      errMsg(err) << "Cannot parse waypoint in line " << lineno << " of '" << filename
+                  << "': Expected 'name, latitude, longitude' or 'name, locator'.";
+      return false;
+    }
+    waypoints.append(waypoint);
+  }
+
+  return true;
+}
+
+QVector<int>
+RepeaterSelection::select(const QGeoCoordinate &location, int n, Mode mode) const {
+  return _index.nearest(location, n, [this, mode](int row) {
+    return _repeaters[row].matches(mode);
+  });
+}
+
+int
+RepeaterSelection::build(ConfigBuilder &builder, const QList<Waypoint> &waypoints, int n, Mode mode) const {
+  typedef ConfigBuilder::List List;
+  bool dmr = int(mode) & int(Mode::DMR), fm = int(mode) & int(Mode::FM);
+
+  // Maps repeater indices to the indices of their channels, repeaters shared by several
+  // waypoints get a single channel.
+  QHash<int, int> dmrChannels, fmChannels;
+  int channels = 0;
+
+  builder.reserve(List::Zones, waypoints.size());
+  foreach (const Waypoint &waypoint, waypoints) {
+    QVector<int> members;
+    foreach (int idx, select(waypoint.location, n, mode)) {
+      const Repeater &rep = _repeaters[idx];
+      // Repeaters with both modes get a suffix to tell their channels apart.
+      bool both = dmr && fm && rep.isDMR && rep.isFM;
+
+      if (dmr && rep.isDMR) {
+        if (! dmrChannels.contains(idx)) {
+          DMRChannel *ch = new DMRChannel();
+          ch->setName(both ? (rep.call + " DMR") : rep.call);
+          ch->setRXFrequency(rep.rxFrequency);
+          ch->setTXFrequency(rep.txFrequency);
+          ch->setColorCode(rep.colorCode);
+          dmrChannels.insert(idx, builder.add(ch));
+          channels++;
+        }
+        members.append(dmrChannels.value(idx));
+      }
+
+      if (fm && rep.isFM) {
+        if (! fmChannels.contains(idx)) {
+          FMChannel *ch = new FMChannel();
+          ch->setName(both ? (rep.call + " FM") : rep.call);
+          ch->setRXFrequency(rep.rxFrequency);
+          ch->setTXFrequency(rep.txFrequency);
+          ch->setRXTone(rep.rxTone);
+          ch->setTXTone(rep.txTone);
+          fmChannels.insert(idx, builder.add(ch));
+          channels++;
+        }
+        members.append(fmChannels.value(idx));
+      }
+    }
+
+    Zone *zone = new Zone(waypoint.name);
+    builder.link(zone->A(), List::Channels, members);
+    builder.add(zone);
+  }
+
+  return channels;
+}
@@ -0,0 +1,106 @@
+#ifndef REPEATERSELECTION_HH
+#define REPEATERSELECTION_HH
+
+#include <QVector>
+#include <QList>
+#include <QString>
+#include <QGeoCoordinate>
+#include <QJsonObject>
+#include "frequency.hh"
+#include "signaling.hh"
+#include "geoindex.hh"
+#include "errorstack.hh"
+
+class ConfigBuilder;
+
+/** Selects repeaters by their distance to a list of waypoints and assembles channels and zones
+ * from them.
+ *
+ * The repeaters are kept in a @c GeoIndex. For every waypoint, the @c N nearest repeaters
+ * matching the selected mode are picked and collected into a zone named after the waypoint.
+ * Repeaters near several waypoints get a single channel, shared by all zones.
+ *
+ * @code
+ * RepeaterSelection selection;
+ * QList<RepeaterSelection::Waypoint> route;
+ * if ((! selection.readRepeaterBook("repeaters.json", err))
+ *     || (! RepeaterSelection::readWaypoints("route.txt", route, err)))
+ *   return false;
+ * ConfigBuilder builder(config);
+ * selection.build(builder, route, 8, RepeaterSelection::Mode::DMR);
+ * builder.finish();
+ * @endcode
+ *
+ * @ingroup conf */
+class RepeaterSelection
+{
+public:
+  /** Selects the kind of repeaters, channels are created for. */
+  enum class Mode {
+    DMR = 1, FM = 2, Both = 3
+  };
+
+  /** A single repeater. */
+  struct Repeater {
+    QString call;                 ///< The call of the repeater.
+    QString qth;                  ///< The nearest city.
+    QGeoCoordinate location;      ///< The location.
+    Frequency rxFrequency;        ///< The frequency the radio receives on, i.e., the output.
+    Frequency txFrequency;        ///< The frequency the radio transmits on, i.e., the input.
+    bool isFM;                    ///< Repeater supports FM.
+    bool isDMR;                   ///< Repeater supports DMR.
+    unsigned int colorCode;       ///< The DMR color code.
+    Signaling::Code rxTone;       ///< The FM RX tone.
+    Signaling::Code txTone;       ///< The FM TX tone.
+
+    /** Default constructor. */
+    Repeater();
+    /** Reads the repeater from a RepeaterBook search result. */
+    bool fromRepeaterBook(const QJsonObject &obj);
+    /** Returns @c true if the repeater supports the given mode. */
+    bool matches(Mode mode) const;
+  };
+
+  /** A named location along a route. */
+  struct Waypoint {
+    QString name;                 ///< The name of the waypoint, used as zone name.
+    QGeoCoordinate location;      ///< The location.
+  };
+
+public:
+  /** Constructs an empty selection. */
+  RepeaterSelection();
+
+  /** Returns the number of repeaters. */
+  int count() const;
+  /** Returns the repeater at the given index. */
+  const Repeater &repeater(int idx) const;
+  /** Adds a repeater. */
+  void add(const Repeater &repeater);
+
+  /** Reads all repeaters from a RepeaterBook JSON export, i.e., an object holding the repeaters
+   * in its @c results array. */
+  bool readRepeaterBook(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Reads waypoints from a text file. Every line holds a single waypoint, either as
+   * @c "name, latitude, longitude" or @c "name, locator". Empty lines and lines starting with
+   * '#' are skipped. */
+  static bool readWaypoints(const QString &filename, QList<Waypoint> &waypoints,
+                            const ErrorStack &err=ErrorStack());
+
+  /** Returns the indices of the (at most) @c n repeaters nearest to the given location,
+   * supporting the given mode, in ascending order of their distance. */
+  QVector<int> select(const QGeoCoordinate &location, int n, Mode mode) const;
+
+  /** Stages a channel for every repeater among the @c n nearest ones of any waypoint and a zone
+   * per waypoint with the channels of its repeaters, ordered by distance. Returns the number of
+   * channels staged. */
+  int build(ConfigBuilder &builder, const QList<Waypoint> &waypoints, int n, Mode mode) const;
+
+protected:
+  /** All repeaters. */
+  QVector<Repeater> _repeaters;
+  /** The locations of the repeaters, indexed like @c _repeaters. */
+  GeoIndex _index;
+};
+
+#endif // REPEATERSELECTION_HH
@@ -1,5 +1,6 @@
 #include "roamingchannel.hh"
 #include "utils.hh"
+#include "enumtable.hh"
 
 /* ********************************************************************************************* *
  * Implementation of RoamingChannel
@@ -148,16 +149,13 @@ RoamingChannel::parse(const YAML::Node &node, Context &ctx, const ErrorStack &er
                   << "Cannot parse 'timeSlot' of RoamingChannel: time slot is not scalar.";
       return false;
     }
-    QMetaEnum e = QMetaEnum::fromType<DMRChannel::TimeSlot>();
-    std::string key = node["timeSlot"].as<std::string>();
-    bool ok=true; int value = e.keyToValue(key.c_str(), &ok);
+    const EnumTable &e = EnumTable::get<DMRChannel::TimeSlot>();
+    const std::string &key = node["timeSlot"].Scalar();
+    bool ok=true; int value = e.keyToValue(key, &ok);
     if (! ok) {
-      QStringList lst;
-      for (int i=0; i<e.keyCount(); i++)
-        lst.push_back(e.key(i));
       errMsg(err) << node["timeSlot"].Mark().line << ":" << node["timeSlot"].Mark().column
                   << ": Unknown key '" << key.c_str() << "' for enum 'DMRChannel::TimeSlot'."
-                  << " Expected one of " << lst.join(", ") << ".";
+                  << " Expected one of " << e.keys().join(", ") << ".";
       return false;
     }
 
@@ -194,8 +192,7 @@ RoamingChannel::populate(YAML::Node &node, const Context &context, const ErrorSt
   node["txFrequency"] = _txFrequency;
 
   if (timeSlotOverridden()) {
-    QMetaEnum e = QMetaEnum::fromType<DMRChannel::TimeSlot>();
-    node["timeSlot"] = e.valueToKey((int)timeSlot());
+    node["timeSlot"] = EnumTable::get<DMRChannel::TimeSlot>().valueToKey((int)timeSlot());
   }
 
   if (colorCodeOverridden()) {
@@ -210,7 +207,8 @@ RoamingChannel::populate(YAML::Node &node, const Context &context, const ErrorSt
  * Implementation of RoamingChannelList
  * ********************************************************************************************* */
 RoamingChannelList::RoamingChannelList(QObject *parent)
-  : ConfigObjectList(RoamingChannel::staticMetaObject, parent)
+  : ConfigObjectList(RoamingChannel::staticMetaObject, parent), _channelIndex(),
+    _channelIndexValid(false)
 {
   // pass...
 }
@@ -229,6 +227,108 @@ RoamingChannelList::add(ConfigObject *obj, int row, bool unique) {
   return -1;
 }
 
+RoamingChannel *
+RoamingChannelList::findChannel(Frequency rx, Frequency tx, unsigned int cc, DMRChannel::TimeSlot ts) const {
+  buildChannelIndex();
+  Key key = {rx.inHz(), tx.inHz(), int(cc), int(ts)};
+  return _channelIndex.value(key, nullptr);
+}
+
+RoamingChannel *
+RoamingChannelList::findOrCreate(DMRChannel *ch) {
+  if (nullptr == ch)
+    return nullptr;
+  if (RoamingChannel *rch = findChannel(ch->rxFrequency(), ch->txFrequency(), ch->colorCode(), ch->timeSlot()))
+    return rch;
+  RoamingChannel *rch = RoamingChannel::fromDMRChannel(ch);
+  add(rch);
+  return rch;
+}
+
+void
+RoamingChannelList::invalidateIndex() {
+  ConfigObjectList::invalidateIndex();
+  _channelIndexValid = false;
+}
+
+void
+RoamingChannelList::appendToIndex(ConfigObject *obj, int idx) {
+  ConfigObjectList::appendToIndex(obj, idx);
+  if (! _channelIndexValid)
+    return;
+  // The appended channel is only found, if it is the first one with that key
+  if (RoamingChannel *rch = obj->as<RoamingChannel>()) {
+    Key key = Key::of(rch);
+    if (! _channelIndex.contains(key))
+      _channelIndex.insert(key, rch);
+  }
+}
+
+void
+RoamingChannelList::removeLastFromIndex(ConfigObject *obj, int idx) {
+  ConfigObjectList::removeLastFromIndex(obj, idx);
+  if (! _channelIndexValid)
+    return;
+  // If the last channel is found by its key, there is no other channel with that key
+  if (RoamingChannel *rch = obj->as<RoamingChannel>()) {
+    Key key = Key::of(rch);
+    if (rch == _channelIndex.value(key, nullptr))
+      _channelIndex.remove(key);
+  } else {
+    // Channel is being destroyed, its settings are gone
+    _channelIndexValid = false;
+  }
+}
+
+void
+RoamingChannelList::updateIndex(ConfigObject *obj) {
+  ConfigObjectList::updateIndex(obj);
+  if (! _channelIndexValid)
+    return;
+  // If the channel is not found by its key, its settings may have changed
+  if (RoamingChannel *rch = obj->as<RoamingChannel>()) {
+    if (rch != _channelIndex.value(Key::of(rch), nullptr))
+      _channelIndexValid = false;
+  }
+}
+
+void
+RoamingChannelList::freeze() {
+  buildChannelIndex();
+  ConfigObjectList::freeze();
+}
+
+void
+RoamingChannelList::buildChannelIndex() const {
+  if (_channelIndexValid)
+    return;
+  _channelIndex.clear();
+  // Iterate in reverse order, such that the first channel with a key wins
+  for (int i=_items.size()-1; i>=0; i--) {
+    if (RoamingChannel *rch = _items.at(i)->as<RoamingChannel>())
+      _channelIndex.insert(Key::of(rch), rch);
+  }
+  _channelIndexValid = true;
+}
+
+RoamingChannelList::Key
+RoamingChannelList::Key::of(const RoamingChannel *ch) {
+  return {ch->rxFrequency().inHz(), ch->txFrequency().inHz(),
+        ch->colorCodeOverridden() ? int(ch->colorCode()) : -1,
+        ch->timeSlotOverridden() ? int(ch->timeSlot()) : -1};
+}
+
+bool
+RoamingChannelList::Key::operator==(const Key &other) const {
+  return (rx == other.rx) && (tx == other.tx) && (colorCode == other.colorCode)
+      && (timeSlot == other.timeSlot);
+}
+
+uint
+qHash(const RoamingChannelList::Key &key, uint seed) {
+  return qHash(key.rx, seed) ^ qHash(key.tx, seed+1) ^ qHash((key.colorCode << 8) ^ key.timeSlot, seed);
+}
+
 ConfigItem *
 RoamingChannelList::allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err) {
   Q_UNUSED(ctx)
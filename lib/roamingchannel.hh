@@ -108,8 +108,49 @@ public:
 
   int add(ConfigObject *obj, int row=-1, bool unique=true);
 
+  /** Finds a roaming channel with the given frequencies, overriding the color code and time slot
+   * with the given ones. */
+  RoamingChannel *findChannel(Frequency rx, Frequency tx, unsigned int cc, DMRChannel::TimeSlot ts) const;
+  /** Returns the roaming channel matching the given DMR channel. If there is none, a new roaming
+   * channel is created from the DMR channel and added to the list. */
+  RoamingChannel *findOrCreate(DMRChannel *ch);
+
+  void freeze();
+
 public:
   ConfigItem *allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err=ErrorStack());
+
+protected:
+  void invalidateIndex();
+  void appendToIndex(ConfigObject *obj, int idx);
+  void removeLastFromIndex(ConfigObject *obj, int idx);
+  void updateIndex(ConfigObject *obj);
+  /** Builds the channel index, if invalid. */
+  void buildChannelIndex() const;
+
+protected:
+  /** Identifies a roaming channel by its frequencies, color code and time slot. */
+  struct Key {
+    /** RX frequency in Hz. */
+    unsigned long long rx;
+    /** TX frequency in Hz. */
+    unsigned long long tx;
+    /** Color code, or -1 if not overridden. */
+    int colorCode;
+    /** Time slot, or -1 if not overridden. */
+    int timeSlot;
+    /** Constructs the key of the given roaming channel. */
+    static Key of(const RoamingChannel *ch);
+    /** Compares two keys. */
+    bool operator==(const Key &other) const;
+  };
+  /** Hashes a key. */
+  friend uint qHash(const Key &key, uint seed);
+
+  /** Maps keys to the first roaming channel with that key, built lazily by @c findChannel. */
+  mutable QHash<Key, RoamingChannel *> _channelIndex;
+  /** If @c false, the channel index must be rebuilt. */
+  mutable bool _channelIndexValid;
 };
 
 #endif // ROAMINGCHANNEL_HH
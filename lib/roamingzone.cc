@@ -9,13 +9,21 @@
 RoamingZone::RoamingZone(QObject *parent)
   : ConfigObject("roam", parent), _channel()
 {
-  // pass...
+  // Changes of the channel list do not emit modified
+  connect(&_channel, SIGNAL(elementAdded(int)), this, SLOT(markDirty()));
+  connect(&_channel, SIGNAL(elementsAdded(int,int)), this, SLOT(markDirty()));
+  connect(&_channel, SIGNAL(elementsReset()), this, SLOT(markDirty()));
+  connect(&_channel, SIGNAL(elementRemoved(int)), this, SLOT(markDirty()));
 }
 
 RoamingZone::RoamingZone(const QString &name, QObject *parent)
   : ConfigObject(name, parent), _channel()
 {
-  // pass...
+  // Changes of the channel list do not emit modified
+  connect(&_channel, SIGNAL(elementAdded(int)), this, SLOT(markDirty()));
+  connect(&_channel, SIGNAL(elementsAdded(int,int)), this, SLOT(markDirty()));
+  connect(&_channel, SIGNAL(elementsReset()), this, SLOT(markDirty()));
+  connect(&_channel, SIGNAL(elementRemoved(int)), this, SLOT(markDirty()));
 }
 
 RoamingZone &
@@ -166,7 +174,8 @@ DefaultRoamingZone *DefaultRoamingZone::_instance = nullptr;
 DefaultRoamingZone::DefaultRoamingZone(QObject *parent)
   : RoamingZone(tr("[Default]"), parent)
 {
-  // pass...
+  // Shared by all codeplugs, thus references are not tracked
+  disableTracking();
 }
 
 DefaultRoamingZone *
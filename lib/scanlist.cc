@@ -22,6 +22,14 @@ ScanList::ScanList(QObject *parent)
   Context::setTag(staticMetaObject.className(), "secondary", "!selected", SelectedChannel::get());
   Context::setTag(staticMetaObject.className(), "revert", "!selected", SelectedChannel::get());
   Context::setTag(staticMetaObject.className(), "channels", "!selected", SelectedChannel::get());
+  // Changes of the channel list and references do not emit modified
+  connect(&_channels, SIGNAL(elementAdded(int)), this, SLOT(markDirty()));
+  connect(&_channels, SIGNAL(elementsAdded(int,int)), this, SLOT(markDirty()));
+  connect(&_channels, SIGNAL(elementsReset()), this, SLOT(markDirty()));
+  connect(&_channels, SIGNAL(elementRemoved(int)), this, SLOT(markDirty()));
+  connect(&_primary, SIGNAL(modified()), this, SLOT(markDirty()));
+  connect(&_secondary, SIGNAL(modified()), this, SLOT(markDirty()));
+  connect(&_revert, SIGNAL(modified()), this, SLOT(markDirty()));
 }
 
 ScanList::ScanList(const QString &name, QObject *parent)
@@ -32,6 +40,14 @@ ScanList::ScanList(const QString &name, QObject *parent)
   Context::setTag(staticMetaObject.className(), "secondary", "!selected", SelectedChannel::get());
   Context::setTag(staticMetaObject.className(), "revert", "!selected", SelectedChannel::get());
   Context::setTag(staticMetaObject.className(), "channels", "!selected", SelectedChannel::get());
+  // Changes of the channel list and references do not emit modified
+  connect(&_channels, SIGNAL(elementAdded(int)), this, SLOT(markDirty()));
+  connect(&_channels, SIGNAL(elementsAdded(int,int)), this, SLOT(markDirty()));
+  connect(&_channels, SIGNAL(elementsReset()), this, SLOT(markDirty()));
+  connect(&_channels, SIGNAL(elementRemoved(int)), this, SLOT(markDirty()));
+  connect(&_primary, SIGNAL(modified()), this, SLOT(markDirty()));
+  connect(&_secondary, SIGNAL(modified()), this, SLOT(markDirty()));
+  connect(&_revert, SIGNAL(modified()), this, SLOT(markDirty()));
 }
 
 ScanList &
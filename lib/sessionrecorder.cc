@@ -0,0 +1,106 @@
+#include "sessionrecorder.hh"
+#include "logger.hh"
+
+/** Magic number of the record files. */
+#define RECORD_MAGIC 0x71726563
+
+QString SessionRecorder::_filename;
+QAtomicInt SessionRecorder::_sessions(0);
+
+
+/* ********************************************************************************************* *
+ * Implementation of SessionRecorder
+ * ********************************************************************************************* */
+SessionRecorder::SessionRecorder(const QString &filename)
+  : _file(filename), _stream(), _clock(), _last(0)
+{
+  // pass...
+}
+
+SessionRecorder::~SessionRecorder() {
+  _file.close();
+}
+
+SessionRecorder *
+SessionRecorder::create(const USBDeviceDescriptor &device) {
+  if (_filename.isEmpty())
+    return nullptr;
+
+  int n = _sessions.fetchAndAddOrdered(1);
+  QString filename = (0 == n) ? _filename : QString("%1.%2").arg(_filename).arg(n);
+  SessionRecorder *recorder = new SessionRecorder(filename);
+  if (! recorder->_file.open(QIODevice::WriteOnly)) {
+    logError() << "Cannot record session into '" << filename << "': "
+               << recorder->_file.errorString() << ".";
+    delete recorder;
+    return nullptr;
+  }
+
+  recorder->_stream.setDevice(&recorder->_file);
+  recorder->_stream << quint32(RECORD_MAGIC) << Version << quint8(device.interfaceClass())
+                    << device.vendorId() << device.productId() << device.deviceHandle();
+  recorder->_clock.start();
+  logInfo() << "Record session with " << device.description() << " into '" << filename << "'.";
+  return recorder;
+}
+
+void
+SessionRecorder::record(Direction direction, const char *data, qint64 len) {
+  if (0 >= len)
+    return;
+  qint64 now = _clock.nsecsElapsed()/1000;
+  _stream << quint8(direction) << quint32(now-_last) << QByteArray::fromRawData(data, len);
+  _last = now;
+}
+
+const QString &
+SessionRecorder::filename() {
+  return _filename;
+}
+
+void
+SessionRecorder::setFilename(const QString &filename) {
+  _filename = filename;
+}
+
+bool
+SessionRecorder::read(const QString &filename, USBDeviceInfo &device, QVector<Event> &events,
+                      const ErrorStack &err)
+{
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open recorded session '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+
+  QDataStream stream(&file);
+  quint32 magic; quint16 version; quint8 cls; quint16 vid, pid; QString handle;
+  stream >> magic >> version >> cls >> vid >> pid >> handle;
+  if ((QDataStream::Ok != stream.status()) || (RECORD_MAGIC != magic)) {
+    errMsg(err) << "File '" << filename << "' is not a recorded session.";
+    return false;
+  }
+  if (Version < version) {
+    errMsg(err) << "Cannot read recorded session '" << filename << "': Unsupported version "
+                << version << ".";
+    return false;
+  }
+  device = USBDeviceInfo(USBDeviceInfo::Class(cls), vid, pid);
+
+  events.clear();
+  qint64 time = 0;
+  while (! stream.atEnd()) {
+    quint8 dir; quint32 delta; QByteArray data;
+    stream >> dir >> delta >> data;
+    if (QDataStream::Ok != stream.status()) {
+      errMsg(err) << "Cannot read recorded session '" << filename << "': Truncated event "
+                  << events.size() << ".";
+      return false;
+    }
+    time += delta;
+    events.append({Direction(dir), time, data});
+  }
+
+  logDebug() << "Read " << events.size() << " events recorded at " << handle << ".";
+  return true;
+}
@@ -0,0 +1,85 @@
+#ifndef SESSIONRECORDER_HH
+#define SESSIONRECORDER_HH
+
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QAtomicInt>
+#include "usbdevice.hh"
+#include "errorstack.hh"
+
+/** Records the requests and responses exchanged with a device into a compact file.
+ *
+ * Recording is enabled globally by setting a filename (e.g., using the @c --record option of
+ * @c dmrconf). Every interface opened afterwards records its session. If several interfaces are
+ * opened, a number is appended to the filename for all but the first one.
+ *
+ * A recorded session of a serial interface can be replayed using a virtual device (see
+ * @c VirtualDevice), serving the recorded responses with the recorded timing.
+ *
+ * The file contains a brief header describing the device, followed by the events. Every event
+ * consists of the direction, the time in microseconds passed since the previous event and the
+ * data transferred.
+ *
+ * @ingroup rif */
+class SessionRecorder
+{
+public:
+  /** Possible directions of a transfer. */
+  enum class Direction {
+    Request = 0,  ///< Data sent to the device.
+    Response = 1  ///< Data received from the device.
+  };
+
+  /** A recorded event. */
+  struct Event {
+    Direction direction; ///< The direction of the transfer.
+    qint64 time;         ///< Time in microseconds since the start of the session.
+    QByteArray data;     ///< The transferred data.
+  };
+
+  /** Current version of the file format. */
+  static const quint16 Version = 1;
+
+protected:
+  /** Hidden constructor, use @c create. */
+  SessionRecorder(const QString &filename);
+
+public:
+  /** Destructor, closes the file. */
+  ~SessionRecorder();
+
+  /** Creates a recorder for the given device, if recording is enabled. Returns @c nullptr
+   * otherwise or if the file cannot be created. */
+  static SessionRecorder *create(const USBDeviceDescriptor &device);
+
+  /** Records the given transfer. */
+  void record(Direction direction, const char *data, qint64 len);
+
+  /** Returns the filename, sessions are recorded into. Empty, if recording is disabled. */
+  static const QString &filename();
+  /** Sets the filename, sessions are recorded into. An empty filename disables recording. */
+  static void setFilename(const QString &filename);
+
+  /** Reads a recorded session. */
+  static bool read(const QString &filename, USBDeviceInfo &device, QVector<Event> &events,
+                   const ErrorStack &err=ErrorStack());
+
+protected:
+  /** The file, the session is recorded into. */
+  QFile _file;
+  /** The stream into that file. */
+  QDataStream _stream;
+  /** Time base of the session. */
+  QElapsedTimer _clock;
+  /** Time of the last event in microseconds. */
+  qint64 _last;
+
+  /** The global filename. */
+  static QString _filename;
+  /** Number of sessions recorded. */
+  static QAtomicInt _sessions;
+};
+
+#endif // SESSIONRECORDER_HH
@@ -0,0 +1,101 @@
+#include "stringpool.hh"
+#include <QMutexLocker>
+
+/** The currently active pool of this thread. */
+static thread_local StringPool *_currentPool = nullptr;
+
+
+/* ********************************************************************************************* *
+ * Implementation of StringPool::Scope
+ * ********************************************************************************************* */
+StringPool::Scope::Scope()
+  : _previous(_currentPool), _own(new StringPool())
+{
+  _currentPool = _own;
+}
+
+StringPool::Scope::Scope(StringPool *pool)
+  : _previous(_currentPool), _own(nullptr)
+{
+  _currentPool = pool;
+}
+
+StringPool::Scope::~Scope() {
+  _currentPool = _previous;
+  // Strings handed out remain valid, they are implicitly shared.
+  delete _own;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of StringPool
+ * ********************************************************************************************* */
+StringPool::StringPool()
+  : _lock(), _strings()
+{
+  // pass...
+}
+
+StringPool *
+StringPool::current() {
+  return _currentPool;
+}
+
+template <class T>
+QString
+StringPool::lookup(const T *data, int n) {
+  // FNV-1a over the code units, Latin-1 and UTF-16 strings of equal content share an entry.
+  uint hash = 2166136261u;
+  for (int i=0; i<n; i++)
+    hash = (hash ^ uint(data[i])) * 16777619u;
+
+  QMutexLocker locker(&_lock);
+  for (QMultiHash<uint, QString>::const_iterator it=_strings.constFind(hash);
+       (it!=_strings.constEnd()) && (it.key()==hash); it++) {
+    if (n != it->size())
+      continue;
+    const ushort *str = it->utf16();
+    int i = 0;
+    while ((i<n) && (ushort(data[i]) == str[i]))
+      i++;
+    if (i == n)
+      return *it;
+  }
+
+  QString str(n, Qt::Uninitialized);
+  ushort *ptr = reinterpret_cast<ushort *>(str.data());
+  for (int i=0; i<n; i++)
+    ptr[i] = ushort(data[i]);
+  _strings.insert(hash, str);
+  return str;
+}
+
+QString
+StringPool::latin1(const char *data, int n) {
+  return lookup(reinterpret_cast<const uchar *>(data), n);
+}
+
+QString
+StringPool::utf16(const ushort *data, int n) {
+  return lookup(data, n);
+}
+
+int
+StringPool::count() const {
+  QMutexLocker locker(&_lock);
+  return _strings.size();
+}
+
+QString
+StringPool::fromLatin1(const char *data, int n) {
+  if ((0 == n) || (nullptr == _currentPool))
+    return QString::fromLatin1(data, n);
+  return _currentPool->latin1(data, n);
+}
+
+QString
+StringPool::fromUtf16(const ushort *data, int n) {
+  if ((0 == n) || (nullptr == _currentPool))
+    return QString(reinterpret_cast<const QChar *>(data), n);
+  return _currentPool->utf16(data, n);
+}
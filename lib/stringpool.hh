@@ -0,0 +1,74 @@
+#ifndef STRINGPOOL_HH
+#define STRINGPOOL_HH
+
+#include <QString>
+#include <QMultiHash>
+#include <QMutex>
+
+/** Shares the storage of identical strings decoded in bulk.
+ *
+ * Codeplugs hold many repeated names, e.g., contact names referenced by several group lists or
+ * generic channel names. While a @c StringPool::Scope is active in the current thread, the
+ * decoding helpers @c decode_ascii and @c decode_unicode look up the raw characters in the pool
+ * and return an implicitly shared copy of an equal string decoded earlier. Hence, a repeated name
+ * neither allocates nor occupies memory again. The lookup hashes the raw characters directly,
+ * no temporary string is created for it.
+ *
+ * A pool may be shared by the scopes of several threads (e.g., by the decoding tasks of a single
+ * codeplug). Without an active scope, strings are decoded as usual.
+ *
+ * @ingroup util */
+class StringPool
+{
+public:
+  /** Scope guard activating a pool for the current thread. Scopes may be nested. */
+  class Scope
+  {
+  public:
+    /** Activates a new, empty pool for the current thread. */
+    Scope();
+    /** Activates the given pool for the current thread. If @c nullptr, strings are not pooled
+     * within this scope. */
+    explicit Scope(StringPool *pool);
+    /** Re-activates the previous pool. */
+    ~Scope();
+
+  protected:
+    /** The previously active pool of this thread. */
+    StringPool *_previous;
+    /** The pool owned by this scope or @c nullptr. */
+    StringPool *_own;
+  };
+
+public:
+  /** Constructs an empty pool. */
+  StringPool();
+
+  /** Returns the pool active in the current thread or @c nullptr. */
+  static StringPool *current();
+
+  /** Returns the string for the given Latin-1 characters, shared with equal strings in the pool. */
+  QString latin1(const char *data, int n);
+  /** Returns the string for the given UTF-16 code units, shared with equal strings in the pool. */
+  QString utf16(const ushort *data, int n);
+  /** Returns the number of distinct strings in the pool. */
+  int count() const;
+
+  /** Decodes the given Latin-1 characters using the active pool, if there is one. */
+  static QString fromLatin1(const char *data, int n);
+  /** Decodes the given UTF-16 code units using the active pool, if there is one. */
+  static QString fromUtf16(const ushort *data, int n);
+
+protected:
+  /** Looks up or inserts the string given by @c n code units of type @c T. */
+  template <class T>
+  QString lookup(const T *data, int n);
+
+protected:
+  /** Protects the strings. */
+  mutable QMutex _lock;
+  /** The pooled strings by hash of their code units. */
+  QMultiHash<uint, QString> _strings;
+};
+
+#endif // STRINGPOOL_HH
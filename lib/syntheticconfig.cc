@@ -0,0 +1,106 @@
+#include "syntheticconfig.hh"
+#include "config.hh"
+#include "configbuilder.hh"
+#include "radioid.hh"
+#include "contact.hh"
+#include "rxgrouplist.hh"
+#include "channel.hh"
+#include "zone.hh"
+#include "scanlist.hh"
+#include "roamingzone.hh"
+#include "roamingchannel.hh"
+
+/** Maximum number of contacts per group list. */
+#define GROUP_LIST_SIZE     16
+/** Maximum number of channels per scan list. */
+#define SCAN_LIST_SIZE      32
+/** Maximum number of channels per roaming zone. */
+#define ROAMING_ZONE_SIZE   16
+
+
+Config *
+createSyntheticConfig(const SyntheticConfigSize &size) {
+  typedef ConfigBuilder::List List;
+  ConfigBuilder builder;
+
+  DMRRadioID *id = new DMRRadioID("DM0ABC", 2621370);
+  builder.add(id);
+  builder.config()->settings()->setDefaultId(id);
+
+  builder.reserve(List::Contacts, size.contacts);
+  for (unsigned int i=0; i<size.contacts; i++)
+    builder.add(new DMRContact(DMRContact::GroupCall, QString("TG %1").arg(i+1), 1000+i));
+  int contacts = size.contacts;
+
+  builder.reserve(List::GroupLists, size.groupLists);
+  for (unsigned int i=0; i<size.groupLists; i++) {
+    RXGroupList *lst = new RXGroupList(QString("Group List %1").arg(i+1));
+    for (int j=0; (j<GROUP_LIST_SIZE) && (j<contacts); j++)
+      builder.link(lst->contacts(), List::Contacts, (i*GROUP_LIST_SIZE + j) % contacts);
+    builder.add(lst);
+  }
+  int groupLists = size.groupLists;
+
+  builder.reserve(List::Channels, size.channels);
+  QVector<Channel *> channels; channels.reserve(size.channels);
+  for (unsigned int i=0; i<size.channels; i++) {
+    // Spread channels over the 70cm band in 12.5kHz steps
+    Frequency rx = Frequency::fromHz(430000000ULL + (i % 800)*12500ULL);
+    Frequency tx = Frequency::fromHz(rx.inHz() + 7600000ULL);
+    Channel *ch = nullptr;
+    if (3 == (i % 4)) {
+      ch = new FMChannel();
+    } else {
+      DMRChannel *dmr = new DMRChannel();
+      dmr->setColorCode(i % 16);
+      dmr->setTimeSlot((i % 2) ? DMRChannel::TimeSlot::TS2 : DMRChannel::TimeSlot::TS1);
+      if (contacts)
+        builder.link(dmr->contact(), List::Contacts, i % contacts);
+      if (groupLists)
+        builder.link(dmr->groupList(), List::GroupLists, i % groupLists);
+      ch = dmr;
+    }
+    ch->setName(QString("Channel %1").arg(i+1));
+    ch->setRXFrequency(rx);
+    ch->setTXFrequency(tx);
+    builder.add(ch);
+    channels.append(ch);
+  }
+
+  if (size.zones && channels.size()) {
+    unsigned int perZone = (channels.size() + size.zones - 1)/size.zones;
+    for (unsigned int i=0; i<size.zones; i++) {
+      Zone *zone = new Zone(QString("Zone %1").arg(i+1));
+      for (unsigned int j=i*perZone; (j<(i+1)*perZone) && (j<unsigned(channels.size())); j++)
+        builder.link(zone->A(), List::Channels, j);
+      builder.add(zone);
+    }
+  }
+
+  for (unsigned int i=0; (i<size.scanLists) && channels.size(); i++) {
+    ScanList *lst = new ScanList(QString("Scan List %1").arg(i+1));
+    for (unsigned int j=0; (j<SCAN_LIST_SIZE) && (j<unsigned(channels.size())); j++)
+      builder.link(lst->channels(), List::Channels, (i*SCAN_LIST_SIZE + j) % channels.size());
+    builder.link(channels[i % channels.size()]->scanListRef(), List::ScanLists, builder.add(lst));
+  }
+
+  // Collect DMR channels for roaming
+  QVector<DMRChannel *> dmrChannels;
+  foreach (Channel *ch, channels) {
+    if (ch->is<DMRChannel>())
+      dmrChannels.append(ch->as<DMRChannel>());
+  }
+
+  for (unsigned int i=0; (i<size.roamingZones) && dmrChannels.size(); i++) {
+    RoamingZone *zone = new RoamingZone(QString("Roaming %1").arg(i+1));
+    for (unsigned int j=0; (j<ROAMING_ZONE_SIZE) && (j<unsigned(dmrChannels.size())); j++) {
+      DMRChannel *ch = dmrChannels[(i*ROAMING_ZONE_SIZE + j) % dmrChannels.size()];
+      builder.link(zone->channels(), List::RoamingChannels,
+                   builder.add(RoamingChannel::fromDMRChannel(ch)));
+    }
+    builder.link(dmrChannels[i % dmrChannels.size()]->roaming(), List::RoamingZones,
+                 builder.add(zone));
+  }
+
+  return builder.finish();
+}
@@ -0,0 +1,29 @@
+#ifndef SYNTHETICCONFIG_HH
+#define SYNTHETICCONFIG_HH
+
+class Config;
+
+/** Specifies the size of a synthetic configuration. */
+struct SyntheticConfigSize
+{
+  /** Number of channels, every fourth channel is an FM channel. */
+  unsigned int channels;
+  /** Number of DMR group-call contacts. */
+  unsigned int contacts;
+  /** Number of zones, the channels are distributed evenly over all zones. */
+  unsigned int zones;
+  /** Number of RX group lists. */
+  unsigned int groupLists;
+  /** Number of scan lists. */
+  unsigned int scanLists;
+  /** Number of roaming zones. */
+  unsigned int roamingZones;
+};
+
+/** Generates a synthetic configuration of the given size, with all objects linked to each other.
+ * The result is deterministic, that is, the same size always yields the same configuration. Used
+ * by the benchmarks and the self-test of dmrconf.
+ * @ingroup conf */
+Config *createSyntheticConfig(const SyntheticConfigSize &size);
+
+#endif // SYNTHETICCONFIG_HH
@@ -2,10 +2,22 @@
 #include <QStandardPaths>
 #include <QFileInfo>
 #include "logger.hh"
+#include "downloadvalidators.hh"
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QNetworkReply>
 #include <QDir>
+#include <QSaveFile>
+#include <QLockFile>
+#include <QtEndian>
+#include <QRunnable>
+
+/** Magic number of the binary talk group DB cache. */
+#define CACHE_MAGIC            "QDMRTGS"
+/** Version of the binary talk group DB cache format, increment on every change. */
+#define CACHE_VERSION          1
+/** Size of the cache header: magic, version, number of talk groups and size of the string pool. */
+#define CACHE_HEADER_SIZE      20
 
 
 /* ********************************************************************************************* *
@@ -24,17 +36,63 @@ TalkGroupDatabase::TalkGroup::TalkGroup(const QString &name, unsigned number)
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of TalkGroupDatabase::Loader
+ * ********************************************************************************************* */
+/** Reads the talk group database on a worker thread and hands the result over to the thread
+ * of the database. */
+class TalkGroupDatabase::Loader: public QRunnable
+{
+public:
+  Loader(TalkGroupDatabase *database, const QString &filename, unsigned generation, int updatePeriodDays)
+    : QRunnable(), _database(database), _filename(filename), _generation(generation),
+      _updatePeriodDays(updatePeriodDays)
+  {
+    // pass...
+  }
+
+  void run() {
+    QVector<TalkGroup> talkgroups; QString msg;
+    bool ok = TalkGroupDatabase::readTable(_filename, talkgroups, msg);
+    // The database waits for all loaders before it gets destroyed. Pending calls are discarded
+    // together with the object.
+    TalkGroupDatabase *database = _database;
+    unsigned generation = _generation;
+    int updatePeriodDays = _updatePeriodDays;
+    QMetaObject::invokeMethod(database, [database, talkgroups, generation, ok, msg, updatePeriodDays]() mutable {
+      database->onLoaded(talkgroups, generation, ok, msg, updatePeriodDays);
+    }, Qt::QueuedConnection);
+  }
+
+protected:
+  TalkGroupDatabase *_database;
+  QString _filename;
+  unsigned _generation;
+  int _updatePeriodDays;
+};
+
+
 /* ********************************************************************************************* *
  * Implementation of TalkGroupDatabase
  * ********************************************************************************************* */
-TalkGroupDatabase::TalkGroupDatabase(unsigned updatePeriodDays, QObject *parent)
-  : QAbstractTableModel(parent), _talkgroups(), _network()
+TalkGroupDatabase::TalkGroupDatabase(unsigned updatePeriodDays, QObject *parent, bool background)
+  : QAbstractTableModel(parent), _talkgroups(), _network(), _loading(false), _generation(0), _loader()
 {
+  _loader.setMaxThreadCount(1);
   connect(&_network, SIGNAL(finished(QNetworkReply*)),
           this, SLOT(downloadFinished(QNetworkReply*)));
 
-  if ((! load()) || (updatePeriodDays < dbAge()))
+  if (background) {
+    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    loadInBackground(path+"/talkgroups.json", updatePeriodDays);
+  } else if ((! load()) || (updatePeriodDays < dbAge())) {
     download();
+  }
+}
+
+TalkGroupDatabase::~TalkGroupDatabase() {
+  // Loaders refer to this database
+  _loader.waitForDone();
 }
 
 qint64
@@ -42,6 +100,16 @@ TalkGroupDatabase::count() const {
   return _talkgroups.count();
 }
 
+MemoryUsage
+TalkGroupDatabase::memoryUsage() const {
+  MemoryUsage usage("Talk group database", sizeof(*this));
+  quint64 talkgroups = MemoryUsage::of(_talkgroups);
+  foreach (const TalkGroup &tg, _talkgroups)
+    talkgroups += MemoryUsage::of(tg.name);
+  usage.add(MemoryUsage("Talk groups", talkgroups, _talkgroups.size()));
+  return usage;
+}
+
 unsigned
 TalkGroupDatabase::dbAge() const {
   QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/talkgroups.json";
@@ -62,6 +130,10 @@ void
 TalkGroupDatabase::download() {
   QUrl url("https://api.brandmeister.network/v2/talkgroup/");
   QNetworkRequest request(url);
+  // Only revalidate the present copy, if it could be loaded. Otherwise, download it again.
+  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  if ((! _talkgroups.isEmpty()) && DownloadValidators(path+"/talkgroups.json").prepare(request))
+    logDebug() << "Check if talk group database changed since last download.";
   _network.get(request);
 }
 
@@ -75,7 +147,6 @@ TalkGroupDatabase::downloadFinished(QNetworkReply *reply) {
   }
 
   QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-  QFile file(path+"/talkgroups.json");
   QDir directory;
   if ((! directory.exists(path)) && (!directory.mkpath(path))) {
     QString msg = QString("Cannot create path '%1'.").arg(path);
@@ -83,16 +154,40 @@ TalkGroupDatabase::downloadFinished(QNetworkReply *reply) {
     emit error(msg);
     return;
   }
+
+  // Another process may refresh the database right now, keep the current state then.
+  QLockFile lock(path+"/talkgroups.json.lock");
+  if (! lock.tryLock(0)) {
+    logInfo() << "Talk group database is being updated by another process, skip update.";
+    reply->deleteLater();
+    return;
+  }
+
+  DownloadValidators validators(path+"/talkgroups.json");
+  if (DownloadValidators::notModified(reply)) {
+    logInfo() << "Talk group database not modified since last download.";
+    validators.touch({cacheFilename(path+"/talkgroups.json")});
+    reply->deleteLater();
+    return;
+  }
+
+  // Replace file atomically, other processes may read it concurrently
+  QSaveFile file(path+"/talkgroups.json");
   if (! file.open(QIODevice::WriteOnly)) {
-    QString msg = QString("Cannot save user database at '%1'.").arg(path+"/talkgroups.json");
+    QString msg = QString("Cannot save talk group database at '%1'.").arg(path+"/talkgroups.json");
     logError() << msg;
     emit error(msg);
     return;
   }
 
   file.write(reply->readAll());
-  file.flush();
-  file.close();
+  if (! file.commit()) {
+    QString msg = QString("Cannot save talk group database at '%1'.").arg(path+"/talkgroups.json");
+    logError() << msg;
+    emit error(msg);
+    return;
+  }
+  validators.store(reply);
 
   load();
   reply->deleteLater();
@@ -106,11 +201,68 @@ TalkGroupDatabase::load() {
 
 bool
 TalkGroupDatabase::load(const QString &filename) {
+  QVector<TalkGroup> talkgroups; QString msg;
+  // Any pending background load is outdated now
+  _generation++; _loading = false;
+  if (! readTable(filename, talkgroups, msg)) {
+    emit error(msg);
+    return false;
+  }
+  install(talkgroups);
+  emit loaded();
+  return true;
+}
+
+bool
+TalkGroupDatabase::isLoading() const {
+  return _loading;
+}
+
+void
+TalkGroupDatabase::loadInBackground(const QString &filename, int updatePeriodDays) {
+  _loading = true;
+  _loader.start(new Loader(this, filename, ++_generation, updatePeriodDays));
+}
+
+void
+TalkGroupDatabase::onLoaded(QVector<TalkGroup> &talkgroups, unsigned generation, bool ok,
+                            const QString &msg, int updatePeriodDays)
+{
+  // Result of an outdated load, the database has been loaded since.
+  if (generation != _generation)
+    return;
+
+  _loading = false;
+  if (ok) {
+    install(talkgroups);
+    emit loaded();
+  } else {
+    emit error(msg);
+  }
+
+  if ((updatePeriodDays >= 0) && ((! ok) || (unsigned(updatePeriodDays) < dbAge())))
+    download();
+}
+
+void
+TalkGroupDatabase::install(QVector<TalkGroup> &talkgroups) {
+  beginResetModel();
+  _talkgroups.swap(talkgroups);
+  endResetModel();
+}
+
+bool
+TalkGroupDatabase::readTable(const QString &filename, QVector<TalkGroup> &talkgroups, QString &msg) {
+  if (loadCache(cacheFilename(filename), talkgroups)) {
+    logDebug() << "Loaded talk group database with " << talkgroups.size()
+               << " entries from cache " << cacheFilename(filename) << ".";
+    return true;
+  }
+
   QFile file(filename);
   if (! file.open(QIODevice::ReadOnly)) {
-    QString msg = QString("Cannot open talk group list '%1': ").arg(filename).arg(file.errorString());
+    msg = QString("Cannot open talk group list '%1': %2").arg(filename).arg(file.errorString());
     logError() << msg;
-    emit error(msg);
     return false;
   }
   QByteArray data = file.readAll();
@@ -118,32 +270,127 @@ TalkGroupDatabase::load(const QString &filename) {
 
   QJsonDocument doc = QJsonDocument::fromJson(data);
   if (! doc.isObject()) {
-    QString msg = "Failed to load talk groups: JSON document is not an object!";
+    msg = "Failed to load talk groups: JSON document is not an object!";
     logError() << msg;
-    emit error(msg);
     return false;
   }
 
-  beginResetModel();
   QJsonObject tgs = doc.object();
-  _talkgroups.clear();
-  _talkgroups.reserve(tgs.count());
+  talkgroups.clear();
+  talkgroups.reserve(tgs.count());
   for (QJsonObject::const_iterator tg = tgs.begin(); tg!=tgs.end(); tg++) {
-    _talkgroups.append(TalkGroup(tg.value().toString(), tg.key().toUInt()));
+    talkgroups.append(TalkGroup(tg.value().toString(), tg.key().toUInt()));
   }
   // Sort repeater w.r.t. their IDs
-  std::stable_sort(_talkgroups.begin(), _talkgroups.end(),
+  std::stable_sort(talkgroups.begin(), talkgroups.end(),
                    [](const TalkGroup &a, const TalkGroup &b){ return a.id < b.id; });
-  // Done.
-  endResetModel();
 
-  logDebug() << "Loaded talk group database with " << _talkgroups.size()
+  logDebug() << "Loaded talk group database with " << talkgroups.size()
              << " entries from " << filename << ".";
+  if (! writeCache(cacheFilename(filename), talkgroups))
+    logWarn() << "Cannot write talk group database cache " << cacheFilename(filename) << ".";
 
-  emit loaded();
   return true;
 }
 
+QString
+TalkGroupDatabase::cacheFilename(const QString &filename) {
+  QFileInfo info(filename);
+  return info.absoluteDir().filePath(info.completeBaseName() + ".cache");
+}
+
+bool
+TalkGroupDatabase::loadCache(const QString &filename, QVector<TalkGroup> &talkgroups) {
+  QFileInfo info(filename);
+  if ((! info.exists()) || (info.size() < CACHE_HEADER_SIZE))
+    return false;
+
+  // Cache is outdated, if the JSON file has been modified since
+  QString json = info.absoluteDir().filePath(info.completeBaseName() + ".json");
+  if (QFileInfo::exists(json) && (QFileInfo(json).lastModified() > info.lastModified()))
+    return false;
+
+  // Read-only mapping, shares the page cache with all other processes using the cache
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly))
+    return false;
+  const uchar *data = file.map(0, file.size());
+  if (nullptr == data)
+    return false;
+
+  qint64 size = file.size();
+  if ((0 != memcmp(data, CACHE_MAGIC, 8)) || (CACHE_VERSION != qFromLittleEndian<quint32>(data+8))) {
+    logDebug() << "Ignore talk group database cache " << filename << ": Unknown format.";
+    return false;
+  }
+
+  quint32 count = qFromLittleEndian<quint32>(data+12);
+  quint32 poolSize = qFromLittleEndian<quint32>(data+16);
+  if (size != (CACHE_HEADER_SIZE + qint64(count)*4 + (qint64(count)+1)*4 + poolSize)) {
+    logDebug() << "Ignore talk group database cache " << filename << ": Size mismatch.";
+    return false;
+  }
+
+  const uchar *ids = data + CACHE_HEADER_SIZE;
+  const uchar *offsets = ids + qint64(count)*4;
+  const char *pool = reinterpret_cast<const char *>(offsets + (qint64(count)+1)*4);
+
+  quint32 last = 0;
+  for (quint32 i=0; i<=count; i++) {
+    quint32 offset = qFromLittleEndian<quint32>(offsets + 4*i);
+    if ((offset < last) || (offset > poolSize)) {
+      logDebug() << "Ignore talk group database cache " << filename << ": Invalid string offset.";
+      return false;
+    }
+    last = offset;
+  }
+
+  talkgroups.clear();
+  talkgroups.reserve(count);
+  for (quint32 i=0; i<count; i++) {
+    quint32 start = qFromLittleEndian<quint32>(offsets + 4*i), end = qFromLittleEndian<quint32>(offsets + 4*i + 4);
+    talkgroups.append(TalkGroup(QString::fromUtf8(pool + start, end-start),
+                                qFromLittleEndian<quint32>(ids + 4*i)));
+  }
+
+  file.unmap(const_cast<uchar *>(data));
+  return true;
+}
+
+bool
+TalkGroupDatabase::writeCache(const QString &filename, const QVector<TalkGroup> &talkgroups) {
+  QByteArray ids, offsets, pool;
+  ids.reserve(talkgroups.size()*4);
+  offsets.reserve((talkgroups.size()+1)*4);
+
+  uchar buffer[4];
+  foreach (const TalkGroup &tg, talkgroups) {
+    qToLittleEndian<quint32>(tg.id, buffer);
+    ids.append(reinterpret_cast<const char *>(buffer), 4);
+    qToLittleEndian<quint32>(pool.size(), buffer);
+    offsets.append(reinterpret_cast<const char *>(buffer), 4);
+    pool.append(tg.name.toUtf8());
+  }
+  qToLittleEndian<quint32>(pool.size(), buffer);
+  offsets.append(reinterpret_cast<const char *>(buffer), 4);
+
+  QByteArray header(CACHE_HEADER_SIZE, 0);
+  memcpy(header.data(), CACHE_MAGIC, 8);
+  qToLittleEndian<quint32>(CACHE_VERSION, header.data()+8);
+  qToLittleEndian<quint32>(talkgroups.size(), header.data()+12);
+  qToLittleEndian<quint32>(pool.size(), header.data()+16);
+
+  // Written to a temporary file and renamed, processes holding the old mapping are not affected.
+  QSaveFile file(filename);
+  if (! file.open(QIODevice::WriteOnly))
+    return false;
+  file.write(header);
+  file.write(ids);
+  file.write(offsets);
+  file.write(pool);
+  return file.commit();
+}
+
 
 int
 TalkGroupDatabase::rowCount(const QModelIndex &parent) const {
@@ -3,14 +3,21 @@
 
 #include <QAbstractTableModel>
 #include <QNetworkAccessManager>
+#include <QThreadPool>
+
+#include "memoryusage.hh"
 
 /** Downloads, periodically updates and provides a list of talk group IDs and their names.
+ *
+ * Updates are conditional (see @c DownloadValidators), hence an unchanged list is not transferred
+ * again.
  *
  * @ingroup utils */
 class TalkGroupDatabase : public QAbstractTableModel
 {
   Q_OBJECT
 
+public:
   /** A talk group entry in the database. */
   class TalkGroup {
   public:
@@ -24,16 +31,20 @@ class TalkGroupDatabase : public QAbstractTableModel
     QString name;
   };
 
-public:
   /** Constructs a talk group database.
    * @param updatePeriodDays Specifies the update period of the DB in days.
-   * @param parent Specifies the QObject parent. */
-  TalkGroupDatabase(unsigned updatePeriodDays=30, QObject *parent=nullptr);
+   * @param parent Specifies the QObject parent.
+   * @param background If @c true, the database is loaded on a worker thread. */
+  TalkGroupDatabase(unsigned updatePeriodDays=30, QObject *parent=nullptr, bool background=false);
+  /** Destructor. */
+  virtual ~TalkGroupDatabase();
 
   /** Returns the number of talk groups. */
   qint64 count() const;
   /** Returns the age of the database in days. */
   unsigned dbAge() const;
+  /** Returns an estimate of the heap memory held by the talk groups. */
+  MemoryUsage memoryUsage() const;
 
   /** Returns the talk group entry at the given index. */
   TalkGroup talkgroup(int index) const;
@@ -42,6 +53,12 @@ public:
   bool load();
   /** Loads all entries from the talk group db at the specified location. */
   bool load(const QString &filename);
+  /** Loads all entries from the talk group db at the specified location on a worker thread.
+   * If @c updatePeriodDays is non-negative, the database gets downloaded afterwards, if it could
+   * not be loaded or is older than the given number of days. */
+  void loadInBackground(const QString &filename, int updatePeriodDays=-1);
+  /** Returns @c true, while the database is loaded in the background. */
+  bool isLoading() const;
 
   /** Implements the QAbstractTableModel interface, returns the number of rows (number of entries). */
   int rowCount(const QModelIndex &parent=QModelIndex()) const;
@@ -64,11 +81,38 @@ private slots:
   /** Gets called whenever the download is complete. */
   void downloadFinished(QNetworkReply *reply);
 
+private:
+  /** Reads the talk groups from the cache or the given JSON file. Does not touch the database
+   * itself, hence it can be called from any thread. */
+  static bool readTable(const QString &filename, QVector<TalkGroup> &talkgroups, QString &msg);
+  /** Replaces the current talk groups. */
+  void install(QVector<TalkGroup> &talkgroups);
+  /** Gets called in the thread of the database, once a background load completed. */
+  void onLoaded(QVector<TalkGroup> &talkgroups, unsigned generation, bool ok, const QString &msg,
+                int updatePeriodDays);
+  /** Returns the filename of the binary cache for the given JSON file. */
+  static QString cacheFilename(const QString &filename);
+  /** Loads all talk groups from the given binary cache. Returns @c false if the cache is missing,
+   * outdated or invalid. */
+  static bool loadCache(const QString &filename, QVector<TalkGroup> &talkgroups);
+  /** Writes all given talk groups into the given binary cache. The file is replaced atomically. */
+  static bool writeCache(const QString &filename, const QVector<TalkGroup> &talkgroups);
+
+  /** Loads the database on a worker thread. */
+  class Loader;
+
 protected:
   /** Holds all talk groups as id->name table. */
   QVector<TalkGroup>    _talkgroups;
   /** The network access used for downloading. */
   QNetworkAccessManager _network;
+  /** If @c true, the database is loaded in the background. */
+  bool _loading;
+  /** Incremented on every load. Results of older background loads are discarded. */
+  unsigned _generation;
+  /** Runs the background loads. Declared last, hence it waits for all loads before any other
+   * member gets destroyed. */
+  QThreadPool _loader;
 };
 
 #endif // TALKGROUPDATABASE_HH
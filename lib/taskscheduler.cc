@@ -0,0 +1,252 @@
+#include "taskscheduler.hh"
+#include <QThread>
+#include <QMutexLocker>
+
+/** The number of chunks, @c TaskScheduler::parallelReduce splits a range into at most. */
+#define MAX_REDUCE_CHUNKS 256
+/** Interval in ms, a waiting thread checks for new jobs to help with. */
+#define WAIT_POLL_MSEC 10
+
+/** Index of the worker running in this thread or -1. */
+static thread_local int _workerIndex = -1;
+
+
+/** Runs the main loop of a single worker of the @c TaskScheduler. */
+class TaskSchedulerWorker: public QThread
+{
+public:
+  TaskSchedulerWorker(TaskScheduler *scheduler, int index)
+    : QThread(), _scheduler(scheduler), _index(index)
+  {
+    // pass...
+  }
+
+protected:
+  void run() {
+    _scheduler->work(_index);
+  }
+
+protected:
+  TaskScheduler *_scheduler;
+  int _index;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of TaskScheduler
+ * ********************************************************************************************* */
+TaskScheduler::TaskScheduler(unsigned int threads)
+  : _queues(), _workers(), _pending(0), _sleepLock(), _wakeUp(), _stop(false)
+{
+  for (unsigned int i=0; i<=threads; i++)
+    _queues.append(new Queue());
+  for (unsigned int i=0; i<threads; i++) {
+    _workers.append(new TaskSchedulerWorker(this, i));
+    _workers.back()->start();
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    QMutexLocker locker(&_sleepLock);
+    _stop = true;
+  }
+  _wakeUp.wakeAll();
+  foreach (QThread *worker, _workers) {
+    worker->wait();
+    delete worker;
+  }
+  qDeleteAll(_queues);
+}
+
+TaskScheduler *
+TaskScheduler::instance() {
+  static TaskScheduler scheduler(std::max(1, QThread::idealThreadCount()));
+  return &scheduler;
+}
+
+unsigned int
+TaskScheduler::threadCount() const {
+  return _workers.size();
+}
+
+void
+TaskScheduler::submit(const Job &job, Priority priority) {
+  // Workers keep their jobs, all other threads share the last queue
+  Queue *queue = (0 <= _workerIndex) ? _queues[_workerIndex] : _queues.back();
+  // Count first, such that an idle worker never misses a queued job
+  _pending.fetch_add(1);
+  {
+    QMutexLocker locker(&queue->lock);
+    queue->jobs[int(priority)].push_back(job);
+  }
+  {
+    QMutexLocker locker(&_sleepLock);
+    _wakeUp.wakeOne();
+  }
+}
+
+bool
+TaskScheduler::runPending() {
+  Job job;
+  if (! take(_workerIndex, job))
+    return false;
+  job();
+  return true;
+}
+
+bool
+TaskScheduler::take(int worker, Job &job) {
+  for (int p=0; p<NUM_PRIORITIES; p++) {
+    // Own jobs first, newest first
+    if (0 <= worker) {
+      Queue *own = _queues[worker];
+      QMutexLocker locker(&own->lock);
+      if (! own->jobs[p].empty()) {
+        job = std::move(own->jobs[p].back());
+        own->jobs[p].pop_back();
+        _pending.fetch_sub(1);
+        return true;
+      }
+    }
+    // Then steal the oldest jobs of the other queues, starting with the next one
+    int n = _queues.size();
+    for (int i=0; i<n; i++) {
+      int victim = (n-1 + worker + 1 + i) % n;
+      if (victim == worker)
+        continue;
+      Queue *queue = _queues[victim];
+      QMutexLocker locker(&queue->lock);
+      if (! queue->jobs[p].empty()) {
+        job = std::move(queue->jobs[p].front());
+        queue->jobs[p].pop_front();
+        _pending.fetch_sub(1);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void
+TaskScheduler::work(int worker) {
+  _workerIndex = worker;
+  for (;;) {
+    Job job;
+    if (take(worker, job)) {
+      job();
+      continue;
+    }
+    QMutexLocker locker(&_sleepLock);
+    if (_stop)
+      return;
+    if (0 >= _pending.load())
+      _wakeUp.wait(&_sleepLock);
+  }
+}
+
+qint64
+TaskScheduler::reduceChunkSize(qint64 n, qint64 grain) {
+  return std::max(std::max(grain, qint64(1)), (n + MAX_REDUCE_CHUNKS - 1)/MAX_REDUCE_CHUNKS);
+}
+
+void
+TaskScheduler::parallelFor(qint64 n, qint64 grain, const std::function<void(qint64, qint64)> &body,
+                           Priority priority)
+{
+  TaskScheduler *scheduler = instance();
+  qint64 threads = scheduler->threadCount();
+  qint64 chunks = std::min(threads, (n + std::max(grain, qint64(1)) - 1)/std::max(grain, qint64(1)));
+  if (2 > chunks) {
+    if (0 < n)
+      body(0, n);
+    return;
+  }
+
+  TaskGroup group(priority);
+  qint64 chunkSize = (n + chunks - 1)/chunks;
+  for (qint64 first=0; first<n; first+=chunkSize) {
+    qint64 last = std::min(n, first+chunkSize);
+    group.run([&body, first, last](const ErrorStack &err) {
+      Q_UNUSED(err);
+      body(first, last);
+      return true;
+    });
+  }
+  group.wait();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of TaskGroup
+ * ********************************************************************************************* */
+TaskGroup::TaskGroup(TaskScheduler::Priority priority)
+  : _priority(priority), _state(new State())
+{
+  _state->pending = 0;
+  _state->success = true;
+  _state->canceled = false;
+}
+
+TaskGroup::~TaskGroup() {
+  wait();
+}
+
+void
+TaskGroup::run(const Task &task) {
+  QSharedPointer<State> state = _state;
+  int index;
+  {
+    QMutexLocker locker(&state->lock);
+    index = state->errors.size();
+    state->errors.append(ErrorStack());
+    state->pending++;
+  }
+
+  TaskScheduler::instance()->submit([state, index, task]() {
+    ErrorStack err;
+    bool success = (! state->canceled.load()) && task(err);
+    QMutexLocker locker(&state->lock);
+    if (! err.isEmpty())
+      state->errors[index].take(err);
+    state->success &= success;
+    if (0 == (--state->pending))
+      state->done.wakeAll();
+  }, _priority);
+}
+
+bool
+TaskGroup::wait(const ErrorStack &err) {
+  TaskScheduler *scheduler = TaskScheduler::instance();
+  for (;;) {
+    {
+      QMutexLocker locker(&_state->lock);
+      if (0 == _state->pending)
+        break;
+    }
+    // Help with pending jobs instead of blocking a thread
+    if (scheduler->runPending())
+      continue;
+    QMutexLocker locker(&_state->lock);
+    if (0 != _state->pending)
+      _state->done.wait(&_state->lock, WAIT_POLL_MSEC);
+  }
+
+  QMutexLocker locker(&_state->lock);
+  foreach (const ErrorStack &stack, _state->errors)
+    err.take(stack);
+  _state->errors.clear();
+  bool success = _state->success;
+  _state->success = true;
+  return success;
+}
+
+void
+TaskGroup::cancel() {
+  _state->canceled = true;
+}
+
+bool
+TaskGroup::isCanceled() const {
+  return _state->canceled.load();
+}
@@ -0,0 +1,183 @@
+#ifndef TASKSCHEDULER_HH
+#define TASKSCHEDULER_HH
+
+#include <QVector>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSharedPointer>
+#include <functional>
+#include <deque>
+#include <atomic>
+#include <algorithm>
+#include "errorstack.hh"
+
+class QThread;
+
+/** Library-wide executor for CPU bound work.
+ *
+ * The scheduler runs a fixed set of worker threads, one per core. Every worker owns a queue of
+ * jobs. Jobs submitted by a worker are put into its own queue and are taken from there in LIFO
+ * order, jobs submitted by any other thread are put into a shared queue. Idle workers take jobs
+ * from the shared queue or steal the oldest jobs of other workers. Hence, nested parallelism
+ * (e.g., a decoding task computing a CRC in parallel) does not oversubscribe the cores.
+ *
+ * Jobs of @c Priority::Interactive are always taken before jobs of @c Priority::Batch, such that
+ * work the user waits for is not delayed by background work.
+ *
+ * Usually, jobs are not submitted directly but through a @c TaskGroup or one of the helpers
+ * @c parallelFor and @c parallelReduce.
+ *
+ * @ingroup util */
+class TaskScheduler
+{
+public:
+  /** Priority of a job. */
+  enum class Priority {
+    Interactive = 0,   ///< Work the user is waiting for.
+    Batch = 1          ///< Background and bulk work.
+  };
+
+  /** A job to execute. */
+  typedef std::function<void()> Job;
+
+public:
+  /** Returns the shared scheduler, started on first use. */
+  static TaskScheduler *instance();
+  /** Stops all workers. Pending jobs are discarded. */
+  ~TaskScheduler();
+
+  /** Returns the number of worker threads. */
+  unsigned int threadCount() const;
+
+  /** Schedules the given job. */
+  void submit(const Job &job, Priority priority=Priority::Batch);
+  /** Runs a single pending job in the calling thread, if there is one. Threads waiting for jobs
+   * to finish call this to help instead of blocking.
+   * @returns @c true if a job was run. */
+  bool runPending();
+
+  /** Calls @c body(first, last) for chunks of the index range @c [0, n) in parallel and waits
+   * for all of them. Chunks span at least @c grain indices. If there is only a single chunk, the
+   * body is called in the current thread. */
+  static void parallelFor(qint64 n, qint64 grain, const std::function<void(qint64 first, qint64 last)> &body,
+                          Priority priority=Priority::Batch);
+
+  /** Maps chunks of the index range @c [0, n) to partial results in parallel and reduces these
+   * with @c reduce, starting with @c identity.
+   *
+   * The partition into chunks only depends on @c n and @c grain and the partial results are
+   * reduced in chunk order. Hence, the result is deterministic, even if @c reduce is only
+   * associative (e.g., floating point sums or concatenations), independent of the number of
+   * threads and the scheduling. */
+  template <class T, class Map, class Reduce>
+  static T parallelReduce(qint64 n, qint64 grain, const T &identity, Map map, Reduce reduce,
+                          Priority priority=Priority::Batch)
+  {
+    qint64 chunkSize = reduceChunkSize(n, grain), chunks = (n + chunkSize - 1)/chunkSize;
+    QVector<T> partial(chunks, identity);
+    T *results = partial.data();
+    parallelFor(chunks, 1, [&map, results, n, chunkSize](qint64 first, qint64 last) {
+      for (qint64 i=first; i<last; i++)
+        results[i] = map(i*chunkSize, std::min(n, (i+1)*chunkSize));
+    }, priority);
+    T result = identity;
+    for (qint64 i=0; i<chunks; i++)
+      result = reduce(result, partial[i]);
+    return result;
+  }
+
+protected:
+  /** Hidden constructor, use @c instance. */
+  explicit TaskScheduler(unsigned int threads);
+
+  /** Takes the next job for the given worker (or -1 for other threads). */
+  bool take(int worker, Job &job);
+  /** Main loop of the given worker. */
+  void work(int worker);
+  /** Returns the size of the chunks, @c parallelReduce splits @c n indices into. */
+  static qint64 reduceChunkSize(qint64 n, qint64 grain);
+
+protected:
+  /** Number of priorities. */
+  static const int NUM_PRIORITIES = int(Priority::Batch)+1;
+
+  /** A queue of jobs per priority. */
+  struct Queue {
+    QMutex lock;                                ///< Protects the jobs.
+    std::deque<Job> jobs[NUM_PRIORITIES];       ///< The jobs by priority.
+  };
+
+  /** One queue per worker and the shared queue last. */
+  QVector<Queue *> _queues;
+  /** The worker threads. */
+  QVector<QThread *> _workers;
+  /** Number of queued jobs. */
+  std::atomic<int> _pending;
+  /** Protects the sleep of idle workers. */
+  QMutex _sleepLock;
+  /** Wakes idle workers. */
+  QWaitCondition _wakeUp;
+  /** If @c true, the workers stop. */
+  bool _stop;
+
+  friend class TaskSchedulerWorker;
+};
+
+
+/** A group of tasks run by the @c TaskScheduler, which are waited for together.
+ *
+ * Each task gets its own error stack. When waiting for the group, these are merged in the order
+ * the tasks were added. Hence, the error messages do not depend on the scheduling. A canceled
+ * group skips all tasks not started yet, running tasks may poll @c isCanceled to stop early.
+ *
+ * @code
+ * TaskGroup group;
+ * for (int i=0; i<sections; i++)
+ *   group.run([i](const ErrorStack &err) { return encodeSection(i, err); });
+ * if (! group.wait(err))
+ *   errMsg(err) << "Cannot encode codeplug.";
+ * @endcode
+ *
+ * @ingroup util */
+class TaskGroup
+{
+public:
+  /** A task. Returns @c false on error. */
+  typedef std::function<bool(const ErrorStack &err)> Task;
+
+public:
+  /** Constructs an empty group, scheduling its tasks with the given priority. */
+  explicit TaskGroup(TaskScheduler::Priority priority=TaskScheduler::Priority::Batch);
+  /** Destructor, waits for all tasks as they may refer to the caller. */
+  ~TaskGroup();
+
+  /** Schedules the given task. */
+  void run(const Task &task);
+  /** Waits for all tasks, helping to run pending jobs meanwhile. The error messages of the tasks
+   * are moved into @c err in the order the tasks were added.
+   * @returns @c false if any task failed or got skipped by a cancellation. */
+  bool wait(const ErrorStack &err=ErrorStack());
+
+  /** Cancels the group. Tasks not started yet are skipped. */
+  void cancel();
+  /** Returns @c true if the group got canceled. */
+  bool isCanceled() const;
+
+protected:
+  /** The state shared with the scheduled jobs. */
+  struct State {
+    QMutex lock;                    ///< Protects the state.
+    QWaitCondition done;            ///< Signals the completion of the last task.
+    int pending;                    ///< Number of unfinished tasks.
+    bool success;                   ///< @c false if any task failed.
+    std::atomic<bool> canceled;     ///< Set by @c cancel.
+    QVector<ErrorStack> errors;     ///< The error stacks of the tasks in order.
+  };
+
+  /** The priority of the tasks. */
+  TaskScheduler::Priority _priority;
+  /** The shared state. */
+  QSharedPointer<State> _state;
+};
+
+#endif // TASKSCHEDULER_HH
@@ -0,0 +1,79 @@
+#include "timingpolicy.hh"
+#include <algorithm>
+#include <cmath>
+
+/** Number of round trips kept to derive the timeout. */
+#define MAX_SAMPLES   128
+/** Minimum number of round trips needed before the timeout gets adapted. */
+#define MIN_SAMPLES   16
+/** Safety factor applied to the 99th percentile of the round-trip times. */
+#define SAFETY_FACTOR 4
+/** Lower limit of the adapted timeout in ms. */
+#define MIN_TIMEOUT   100
+/** Maximum back-off factor relative to the default timeout. */
+#define MAX_FACTOR    4
+
+int TimingPolicy::_fixedTimeout = 0;
+
+TimingPolicy::TimingPolicy(int defaultTimeout)
+  : _defaultTimeout(defaultTimeout), _timeout(defaultTimeout), _samples(), _next(0), _pending(0)
+{
+  _samples.reserve(MAX_SAMPLES);
+}
+
+void
+TimingPolicy::reset() {
+  _timeout = _defaultTimeout;
+  _samples.clear();
+  _next = _pending = 0;
+}
+
+void
+TimingPolicy::addRoundTrip(qint64 usec) {
+  if (MAX_SAMPLES > _samples.size()) {
+    _samples.append(usec);
+  } else {
+    _samples[_next] = usec;
+    _next = (_next+1) % MAX_SAMPLES;
+  }
+  // Updating is cheap but not free, hence update only every MIN_SAMPLES round trips.
+  if (MIN_SAMPLES <= (++_pending))
+    update();
+}
+
+void
+TimingPolicy::update() {
+  _pending = 0;
+  if (MIN_SAMPLES > _samples.size())
+    return;
+  QVector<qint64> sorted(_samples);
+  int idx = std::min(sorted.size()-1, int(std::ceil(0.99*sorted.size()))-1);
+  std::nth_element(sorted.begin(), sorted.begin()+idx, sorted.end());
+  int timeout = int(std::ceil(sorted[idx]*SAFETY_FACTOR/1000.));
+  _timeout = std::max(MIN_TIMEOUT, std::min(timeout, maxTimeout()));
+}
+
+int
+TimingPolicy::timeout(unsigned attempt) const {
+  if (_fixedTimeout)
+    return _fixedTimeout << std::min(attempt, 8U);
+  qint64 timeout = qint64(_timeout) << std::min(attempt, 8U);
+  return int(std::min(timeout, qint64(maxTimeout())));
+}
+
+int
+TimingPolicy::maxTimeout() const {
+  if (_fixedTimeout)
+    return _fixedTimeout;
+  return MAX_FACTOR*_defaultTimeout;
+}
+
+int
+TimingPolicy::fixedTimeout() {
+  return _fixedTimeout;
+}
+
+void
+TimingPolicy::setFixedTimeout(int ms) {
+  _fixedTimeout = std::max(0, ms);
+}
@@ -0,0 +1,58 @@
+#ifndef TIMINGPOLICY_HH
+#define TIMINGPOLICY_HH
+
+#include <QVector>
+
+/** Derives the response timeout of an interface from the observed round-trip times.
+ *
+ * Until enough round trips have been observed, the default timeout of the interface is used.
+ * Afterwards, the timeout is the 99th percentile of the recent round-trip times multiplied by a
+ * safety factor, limited to a range around the default timeout. Repeated attempts double the
+ * timeout (exponential back-off). A global fixed timeout (e.g., set from the command line)
+ * overrides the adaptive timeout of all interfaces.
+ *
+ * @ingroup rif */
+class TimingPolicy
+{
+public:
+  /** Constructs a new timing policy using the given default timeout in ms. */
+  explicit TimingPolicy(int defaultTimeout);
+
+  /** Forgets all observed round trips. */
+  void reset();
+  /** Records the duration of a successful round trip in microseconds. */
+  void addRoundTrip(qint64 usec);
+
+  /** Returns the timeout in ms for the given attempt, starting at 0. */
+  int timeout(unsigned attempt=0) const;
+  /** Returns the upper limit of the timeout in ms. */
+  int maxTimeout() const;
+
+public:
+  /** Returns the global fixed timeout in ms, 0 if the timeout is adaptive. */
+  static int fixedTimeout();
+  /** Sets a global fixed timeout in ms for all interfaces. A value of 0 enables the adaptive
+   * timeout again. */
+  static void setFixedTimeout(int ms);
+
+protected:
+  /** Recomputes the base timeout from the recorded round trips. */
+  void update();
+
+protected:
+  /** The default timeout in ms. */
+  int _defaultTimeout;
+  /** The current base timeout in ms. */
+  int _timeout;
+  /** Ring buffer of the recent round-trip times in microseconds. */
+  QVector<qint64> _samples;
+  /** Index of the next sample to replace. */
+  int _next;
+  /** Number of samples recorded since the last update. */
+  int _pending;
+
+  /** Global fixed timeout in ms. */
+  static int _fixedTimeout;
+};
+
+#endif // TIMINGPOLICY_HH
@@ -0,0 +1,142 @@
+#include "tracer.hh"
+
+#include <atomic>
+#include <QMutex>
+#include <QVector>
+#include <QFile>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+#include <QTextStream>
+#include "logger.hh"
+
+/** A recorded span. */
+struct TraceEvent {
+  const char *name;
+  const char *category;
+  int thread;
+  qint64 start;
+  qint64 duration;
+};
+
+/** The complete state of the tracer. */
+struct TraceState {
+  std::atomic<bool> enabled{false};
+  QString filename;
+  QElapsedTimer timer;
+  QMutex lock;
+  QVector<TraceEvent> events;
+  int threads = 0;
+  // Incremented on every start, invalidates the thread numbers of previous traces.
+  int generation = 0;
+};
+
+static TraceState _trace;
+
+/** Number of the current thread within the trace and the trace generation it belongs to. */
+static thread_local int _threadNumber = 0;
+static thread_local int _threadGeneration = -1;
+
+
+/* ********************************************************************************************* *
+ * Implementation of Tracer::Span
+ * ********************************************************************************************* */
+Tracer::Span::Span(const char *name, const char *category)
+  : _name(name), _category(category), _start(-1)
+{
+  if (Tracer::isEnabled())
+    _start = Tracer::now();
+}
+
+Tracer::Span::~Span() {
+  if ((0 <= _start) && Tracer::isEnabled())
+    Tracer::record(_name, _category, _start, Tracer::now()-_start);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of Tracer
+ * ********************************************************************************************* */
+bool
+Tracer::start(const QString &filename, const ErrorStack &err) {
+  QMutexLocker locker(&_trace.lock);
+  if (_trace.enabled) {
+    errMsg(err) << "Cannot start trace into '" << filename << "': Already tracing into '"
+                << _trace.filename << "'.";
+    return false;
+  }
+
+  // Fail early, if the trace cannot be written
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot open trace file '" << filename << "': " << file.errorString();
+    return false;
+  }
+  file.close();
+
+  _trace.filename = filename;
+  _trace.events.clear();
+  _trace.threads = 0;
+  _trace.generation++;
+  _trace.timer.start();
+  _trace.enabled = true;
+  return true;
+}
+
+bool
+Tracer::stop(const ErrorStack &err) {
+  if (! _trace.enabled)
+    return true;
+
+  QMutexLocker locker(&_trace.lock);
+  _trace.enabled = false;
+  QSaveFile file(_trace.filename);
+  if (! file.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot write trace file '" << _trace.filename << "': " << file.errorString();
+    return false;
+  }
+
+  QTextStream stream(&file);
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+         << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\""
+         << QCoreApplication::applicationName() << "\"}}";
+  foreach (const TraceEvent &event, _trace.events) {
+    stream << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+           << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+           << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+  }
+  stream << "\n]}\n";
+  stream.flush();
+
+  if (! file.commit()) {
+    errMsg(err) << "Cannot write trace file '" << _trace.filename << "': " << file.errorString();
+    return false;
+  }
+
+  logDebug() << "Wrote " << _trace.events.size() << " trace events to '" << _trace.filename << "'.";
+  _trace.events.clear();
+  return true;
+}
+
+bool
+Tracer::isEnabled() {
+  return _trace.enabled.load(std::memory_order_acquire);
+}
+
+void
+Tracer::record(const char *name, const char *category, qint64 start, qint64 duration) {
+  QMutexLocker locker(&_trace.lock);
+  // Tracing might have been stopped in between
+  if (! _trace.enabled)
+    return;
+  if (_threadGeneration != _trace.generation) {
+    _threadGeneration = _trace.generation;
+    _threadNumber = ++_trace.threads;
+  }
+  _trace.events.append(TraceEvent{name, category, _threadNumber, start, duration});
+}
+
+qint64
+Tracer::now() {
+  return _trace.timer.nsecsElapsed()/1000;
+}
@@ -0,0 +1,66 @@
+#ifndef TRACER_HH
+#define TRACER_HH
+
+#include <QString>
+#include "errorstack.hh"
+#include "config.h"
+
+/** Records scoped trace spans and writes them in the Chrome trace event format.
+ *
+ * The resulting file can be loaded into @c chrome://tracing or the Perfetto UI to inspect, where
+ * the time is spent when encoding, decoding or transferring a codeplug. Spans are placed using the
+ * @c TRACE_SPAN macro. Unless tracing was started using @c Tracer::start, a span costs a single
+ * check of an atomic flag. The spans can be compiled out entirely by disabling the
+ * @c ENABLE_TRACING CMake option.
+ *
+ * @ingroup util */
+class Tracer
+{
+public:
+  /** Records the duration of a scope. The name and category must be string literals (or
+   * otherwise outlive the tracer), as they are not copied. */
+  class Span
+  {
+  public:
+    /** Starts the span, if tracing is enabled. */
+    Span(const char *name, const char *category);
+    /** Ends the span. */
+    ~Span();
+
+  protected:
+    /** The name of the span. */
+    const char *_name;
+    /** The category of the span. */
+    const char *_category;
+    /** Start time in microseconds since the trace was started, negative if not tracing. */
+    qint64 _start;
+  };
+
+public:
+  /** Starts tracing. The trace gets written to the given file by @c stop. */
+  static bool start(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Stops tracing and writes the recorded spans. */
+  static bool stop(const ErrorStack &err=ErrorStack());
+  /** Returns @c true if tracing is running. */
+  static bool isEnabled();
+
+protected:
+  /** Records a complete span. */
+  static void record(const char *name, const char *category, qint64 start, qint64 duration);
+  /** Returns the microseconds since tracing was started. */
+  static qint64 now();
+
+  friend class Span;
+};
+
+#define TRACE_CONCAT_(a, b) a ## b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef ENABLE_TRACING
+/** Records the duration of the enclosing scope under the given name and category. */
+#define TRACE_SPAN(name, category) Tracer::Span TRACE_CONCAT(_traceSpan, __LINE__)(name, category)
+#else
+#define TRACE_SPAN(name, category)
+#endif
+
+#endif // TRACER_HH
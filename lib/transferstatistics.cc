@@ -0,0 +1,144 @@
+#include "transferstatistics.hh"
+#include <algorithm>
+#include <cmath>
+
+
+/* ********************************************************************************************* *
+ * Implementation of TransferStatistics::Timer
+ * ********************************************************************************************* */
+TransferStatistics::Timer::Timer(TransferStatistics &stats, Direction dir, unsigned bytes)
+  : _stats(stats), _setup(false), _direction(dir), _bytes(bytes), _timer(),
+    _span((Direction::Read == dir) ? "read" : "write", "io")
+{
+  _timer.start();
+}
+
+TransferStatistics::Timer::Timer(TransferStatistics &stats)
+  : _stats(stats), _setup(true), _direction(Direction::Read), _bytes(0), _timer(),
+    _span("setup", "io")
+{
+  _timer.start();
+}
+
+TransferStatistics::Timer::~Timer() {
+  qint64 usec = _timer.nsecsElapsed()/1000;
+  if (_setup)
+    _stats.addSetup(usec);
+  else
+    _stats.addRoundTrip(_direction, _bytes, usec);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of TransferStatistics
+ * ********************************************************************************************* */
+TransferStatistics::TransferStatistics()
+  : _bytesRead(0), _bytesWritten(0), _retries(0), _transferTime(0), _setupTime(0), _address(0),
+    _latencies(), _linkMode()
+{
+  // pass...
+}
+
+void
+TransferStatistics::reset() {
+  _bytesRead = _bytesWritten = 0;
+  _retries = 0;
+  _transferTime = _setupTime = 0;
+  _address = 0;
+  _latencies.clear();
+}
+
+void
+TransferStatistics::addRoundTrip(Direction dir, unsigned bytes, qint64 usec) {
+  if (Direction::Read == dir)
+    _bytesRead += bytes;
+  else
+    _bytesWritten += bytes;
+  _transferTime += usec;
+  _latencies.append(usec);
+}
+
+void
+TransferStatistics::addRetry(unsigned count) {
+  _retries += count;
+}
+
+void
+TransferStatistics::addSetup(qint64 usec) {
+  _setupTime += usec;
+}
+
+void
+TransferStatistics::setAddress(quint32 addr) {
+  _address = addr;
+}
+
+quint64
+TransferStatistics::bytesRead() const {
+  return _bytesRead;
+}
+
+quint64
+TransferStatistics::bytesWritten() const {
+  return _bytesWritten;
+}
+
+unsigned
+TransferStatistics::roundTrips() const {
+  return _latencies.size();
+}
+
+unsigned
+TransferStatistics::retries() const {
+  return _retries;
+}
+
+qint64
+TransferStatistics::transferTime() const {
+  return _transferTime;
+}
+
+qint64
+TransferStatistics::setupTime() const {
+  return _setupTime;
+}
+
+quint32
+TransferStatistics::address() const {
+  return _address;
+}
+
+qint64
+TransferStatistics::latency(double q) const {
+  if (_latencies.isEmpty())
+    return 0;
+  QVector<qint64> samples(_latencies);
+  int idx = std::min(samples.size()-1, int(std::ceil(std::max(0.0, q)*samples.size()))-1);
+  idx = std::max(0, idx);
+  std::nth_element(samples.begin(), samples.begin()+idx, samples.end());
+  return samples.at(idx);
+}
+
+const QString &
+TransferStatistics::linkMode() const {
+  return _linkMode;
+}
+
+void
+TransferStatistics::setLinkMode(const QString &mode) {
+  _linkMode = mode;
+}
+
+QString
+TransferStatistics::format() const {
+  double seconds = double(_transferTime)/1e6;
+  double rate = (seconds > 0) ? (double(_bytesRead+_bytesWritten)/1024)/seconds : 0;
+  QString link = _linkMode.isEmpty() ? QString() : QString("\nLink mode %1.").arg(_linkMode);
+  return QString("Read %1b, written %2b in %3 round trips (%4 retries).\n"
+                 "Transfer time %5s (%6kb/s), setup time %7s.\n"
+                 "Round trip latency p50=%8ms, p99=%9ms.")
+      .arg(_bytesRead).arg(_bytesWritten).arg(roundTrips()).arg(_retries)
+      .arg(seconds, 0, 'f', 2).arg(rate, 0, 'f', 1).arg(double(_setupTime)/1e6, 0, 'f', 2)
+      .arg(double(latency(0.5))/1e3, 0, 'f', 2).arg(double(latency(0.99))/1e3, 0, 'f', 2)
+      + link;
+}
@@ -0,0 +1,114 @@
+#ifndef TRANSFERSTATISTICS_HH
+#define TRANSFERSTATISTICS_HH
+
+#include <QString>
+#include <QVector>
+#include <QElapsedTimer>
+#include "tracer.hh"
+
+/** Collects some metrics about the communication with a radio.
+ *
+ * That is, the number of bytes read and written, the number of round trips (request-response
+ * pairs), the number of retries, the latency of every round trip as well as the time spent on
+ * setting up the transfer (e.g., entering the program mode or erasing memory). These metrics
+ * allow to distinguish slow connections from protocol overhead.
+ *
+ * @ingroup rif */
+class TransferStatistics
+{
+public:
+  /** Possible directions of a round trip. */
+  enum class Direction {
+    Read, Write
+  };
+
+  /** Measures the duration of a single round trip or setup phase. The result gets recorded on
+   * destruction. If tracing is enabled, the round trip is also recorded as a trace span. */
+  class Timer
+  {
+  public:
+    /** Measures a round trip transferring @c bytes of payload in the given direction. */
+    Timer(TransferStatistics &stats, Direction dir, unsigned bytes);
+    /** Measures a setup phase. */
+    explicit Timer(TransferStatistics &stats);
+    /** Destructor, records the measurement. */
+    ~Timer();
+
+  protected:
+    /** The statistics to record to. */
+    TransferStatistics &_stats;
+    /** If @c true, a setup phase is measured. */
+    bool _setup;
+    /** The direction of the round trip. */
+    Direction _direction;
+    /** The payload of the round trip. */
+    unsigned _bytes;
+    /** The timer. */
+    QElapsedTimer _timer;
+    /** The trace span of the round trip. */
+    Tracer::Span _span;
+  };
+
+public:
+  /** Empty constructor. */
+  TransferStatistics();
+
+  /** Resets all metrics. The link mode is kept, as it is a property of the open interface. */
+  void reset();
+
+  /** Records a single round trip transferring @c bytes of payload in the given direction, that
+   * took @c usec microseconds. */
+  void addRoundTrip(Direction dir, unsigned bytes, qint64 usec);
+  /** Records the given number of retries. */
+  void addRetry(unsigned count=1);
+  /** Records @c usec microseconds spent on setting up the transfer. */
+  void addSetup(qint64 usec);
+  /** Records the start address of the current read or write request. */
+  void setAddress(quint32 addr);
+
+  /** Returns the number of bytes read. */
+  quint64 bytesRead() const;
+  /** Returns the number of bytes written. */
+  quint64 bytesWritten() const;
+  /** Returns the number of round trips. */
+  unsigned roundTrips() const;
+  /** Returns the number of retries. */
+  unsigned retries() const;
+  /** Returns the total time spent on round trips in microseconds. */
+  qint64 transferTime() const;
+  /** Returns the total time spent on setting up the transfer in microseconds. */
+  qint64 setupTime() const;
+  /** Returns the start address of the last read or write request. */
+  quint32 address() const;
+  /** Returns the @c q quantile (0-1) of the round trip latency in microseconds. */
+  qint64 latency(double q) const;
+
+  /** Returns the effective mode of the link to the radio (e.g., "low-latency"). Empty, if the
+   * interface does not report any. */
+  const QString &linkMode() const;
+  /** Sets the effective mode of the link to the radio. */
+  void setLinkMode(const QString &mode);
+
+  /** Formats the metrics as a human readable multi-line text. */
+  QString format() const;
+
+protected:
+  /** Number of bytes read. */
+  quint64 _bytesRead;
+  /** Number of bytes written. */
+  quint64 _bytesWritten;
+  /** Number of retries. */
+  unsigned _retries;
+  /** Total round trip time in microseconds. */
+  qint64 _transferTime;
+  /** Total setup time in microseconds. */
+  qint64 _setupTime;
+  /** Start address of the last request. */
+  quint32 _address;
+  /** Latency of every round trip in microseconds. */
+  QVector<qint64> _latencies;
+  /** The effective mode of the link. */
+  QString _linkMode;
+};
+
+#endif // TRANSFERSTATISTICS_HH
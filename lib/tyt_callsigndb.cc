@@ -57,29 +57,19 @@ TyTCallsignDB::IndexElement::setIndexEntry(unsigned n, unsigned id, unsigned ind
 /* ********************************************************************************************* *
  * Implementation of TyTCallsignDB::IndexElement::Entry
  * ********************************************************************************************* */
-TyTCallsignDB::IndexElement::Entry::Entry(uint8_t *ptr, size_t size)
-  : Codeplug::Element(ptr, size)
-{
-  // pass...
-}
-
 TyTCallsignDB::IndexElement::Entry::Entry(uint8_t *ptr)
-  : Codeplug::Element(ptr, INDEX_ENTRY_SIZE)
+  : Codeplug::ElementView<INDEX_ENTRY_SIZE>(ptr)
 {
   // pass...
 }
 
-TyTCallsignDB::IndexElement::Entry::~Entry() {
-  // pass...
-}
-
 void
-TyTCallsignDB::IndexElement::Entry::clear() {
-  memset(_data, 0xff, INDEX_ENTRY_SIZE);
+TyTCallsignDB::IndexElement::Entry::clear() const {
+  fill(0xff);
 }
 
 void
-TyTCallsignDB::IndexElement::Entry::set(unsigned id, unsigned index) {
+TyTCallsignDB::IndexElement::Entry::set(unsigned id, unsigned index) const {
   _data[0] = id>>16;
   _data[1] = ((id>>8)&0xf0) | ((index>>16) & 0xf);
   _data[2] = index>>8;
@@ -155,40 +145,96 @@ bool
 TyTCallsignDB::encode(UserDatabase *db, const Selection &selection, const ErrorStack &err) {
   Q_UNUSED(err)
 
+  // Select users in ascending order of their IDs
+  QVector<int> users = sortedSelection(db, selection, std::min(MAX_CALLSIGNS, db->count()));
+  size_t n = users.size();
+
   // Allocate space for callsign db
-  size_t n = std::min(MAX_CALLSIGNS, db->count());
-  if (selection.hasCountLimit())
-    n = std::min(n, selection.countLimit());
   allocate(n);
 
   // Clear DB index
   clearIndex();
 
-  // Select n users and sort them in ascending order of their IDs
-  QVector<UserDatabase::User> users;
-  for (unsigned i=0; i<n; i++)
-    users.append(db->user(i));
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
+  if (users.isEmpty())
+    return true;
 
   // Store number of entries
   setNumEntries(n);
 
   // First index entry
   int  j = 0;
-  setIndexEntry(j++, users[0].id, 1);
-  unsigned cidh = (users[0].id >> 12);
+  setIndexEntry(j++, db->user(users[0]).id, 1);
+  unsigned cidh = (db->user(users[0]).id >> 12);
+
+  // Update index
+  for (unsigned i=0; i<n; i++) {
+    unsigned idh = (db->user(users[i]).id >> 12);
+    if (idh != cidh) {
+      setIndexEntry(j++, db->user(users[i]).id, i+1);
+      cidh = idh;
+    }
+  }
 
-  // Store users and update index
+  // Store users, entries have a fixed size and can be encoded concurrently
+  uint8_t *entries = data(ADDR_CALLSIGNS);
+  parallelFor(n, [db, &users, entries](qint64 first, qint64 last) {
+    for (qint64 i=first; i<last; i++)
+      EntryElement(entries + i*CALLSIGN_ENTRY_SIZE).set(db->user(users[i]));
+  });
+
+  return true;
+}
+
+bool
+TyTCallsignDB::encodeToFile(UserDatabase *db, const QString &filename, const Selection &selection,
+                            const ErrorStack &err)
+{
+  // Select users in ascending order of their IDs
+  QVector<int> users = sortedSelection(db, selection, std::min(MAX_CALLSIGNS, db->count()));
+  size_t n = users.size();
+  if (0 == n) {
+    errMsg(err) << "Cannot encode empty call-sign DB.";
+    return false;
+  }
+
+  // Assemble index in memory
+  QByteArray index(0x0003 + NUM_INDEX_ENTRIES*INDEX_ENTRY_SIZE, char(0xff));
+  IndexElement idx((uint8_t *)index.data());
+  idx.clear();
+  idx.setNumEntries(n);
+  int j = 0;
+  idx.setIndexEntry(j++, db->user(users[0]).id, 1);
+  unsigned cidh = (db->user(users[0]).id >> 12);
   for (unsigned i=0; i<n; i++) {
-    setEntry(i, users[i]);
-    unsigned idh = (users[i].id >> 12);
+    unsigned idh = (db->user(users[i]).id >> 12);
     if (idh != cidh) {
-      setIndexEntry(j++,users[i].id, i+1);
+      idx.setIndexEntry(j++, db->user(users[i]).id, i+1);
       cidh = idh;
     }
   }
 
+  // Stream index and entries into the file, the element is padded to 1k
+  qint64 size = align_size(0x0003 + INDEX_ENTRY_SIZE*NUM_INDEX_ENTRIES + CALLSIGN_ENTRY_SIZE*n, 1024);
+  DFUStreamWriter writer;
+  if ((! writer.open(filename, err)) || (! writer.beginImage(image(0).name(), image(0).alternateSettings(), err))
+      || (! writer.beginElement(ADDR_CALLSIGN_INDEX, err)) || (! writer.write(index, err)))
+    return false;
+
+  uint8_t entry[CALLSIGN_ENTRY_SIZE];
+  for (unsigned i=0; i<n; i++) {
+    memset(entry, 0xff, CALLSIGN_ENTRY_SIZE);
+    EntryElement(entry).set(db->user(users[i]));
+    if (! writer.write((const char *)entry, CALLSIGN_ENTRY_SIZE, err))
+      return false;
+  }
+
+  qint64 padding = size - (index.size() + CALLSIGN_ENTRY_SIZE*n);
+  if ((! writer.fill(0xff, padding, err)) || (! writer.endElement(err)) || (! writer.endImage(err))
+      || (! writer.close(err))) {
+    errMsg(err) << "Cannot write call-sign DB file '" << filename << "'.";
+    return false;
+  }
+
   return true;
 }
 
@@ -35,22 +35,17 @@ public:
      * Memory layout of encoded call-sign/user database index entry:
      * @verbinclude tytcallsigndbindexentry.txt
      */
-    class Entry: public Codeplug::Element
+    class Entry: public Codeplug::ElementView<0x0004>
     {
-    protected:
-      /** Hidden constructor. */
-      Entry(uint8_t *ptr, size_t size);
-
     public:
       /** Constructor. */
       explicit Entry(uint8_t *ptr);
-      /** Destructor. */
-      virtual ~Entry();
 
-      void clear();
+      /** Resets the index entry. */
+      void clear() const;
 
       /** Sets the index entry. */
-      virtual void set(unsigned id, unsigned index);
+      void set(unsigned id, unsigned index) const;
     };
 
   protected:
@@ -103,6 +98,10 @@ public:
   virtual ~TyTCallsignDB();
 
   bool encode(UserDatabase *db, const Selection &selection,const ErrorStack &err=ErrorStack());
+  /** Streams the encoded call-sign DB into the file, entry by entry. Only the index is kept in
+   * memory. */
+  bool encodeToFile(UserDatabase *db, const QString &filename, const Selection &selection=Selection(),
+                    const ErrorStack &err=ErrorStack());
 
 protected:
   /** Allocates required space for index and @c n call-signs. */
@@ -8,10 +8,12 @@
 #include "tyt_extensions.hh"
 #include "encryptionextension.hh"
 #include "commercial_extension.hh"
+#include "tracer.hh"
 
 #include <QTimeZone>
 #include <QtEndian>
 #include <QChar>
+#include "stringpool.hh"
 
 #define CHANNEL_SIZE      0x000040
 #define SETTINGS_SIZE     0x000090
@@ -2853,6 +2855,7 @@ TyTCodeplug::~TyTCodeplug() {
 
 bool
 TyTCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) const {
+  TRACE_SPAN("TyTCodeplug::index", "codeplug");
   Q_UNUSED(err)
 
   // All indices as 1-based. That is, the first channel gets index 1.
@@ -2947,6 +2950,7 @@ TyTCodeplug::clear()
 
 bool
 TyTCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
+  TRACE_SPAN("TyTCodeplug::encode", "codeplug");
   // Check if default DMR id is set.
   if (config->settings()->defaultIdRef()->isNull()) {
     errMsg(err) << "Cannot encode TyT codeplug: No default radio ID specified.";
@@ -2966,6 +2970,9 @@ TyTCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
 
 bool
 TyTCodeplug::decode(Config *config, const ErrorStack &err) {
+  TRACE_SPAN("TyTCodeplug::decode", "codeplug");
+  // Names decoded repeatedly share their storage
+  StringPool::Scope strings;
   // Create index<->object table.
   Context ctx(config);
   ctx.addTable(&BasicEncryptionKey::staticMetaObject);
@@ -2980,6 +2987,7 @@ TyTCodeplug::decode(Config *config, const ErrorStack &err) {
 bool
 TyTCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err)
 {
+  TRACE_SPAN("TyTCodeplug::encodeElements", "codeplug");
   // Set timestamp
   if (! this->encodeTimestamp()) {
     errMsg(err) << "Cannot encode time-stamp.";
@@ -3050,6 +3058,7 @@ TyTCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStack &
 
 bool
 TyTCodeplug::decodeElements(Context &ctx, const ErrorStack &err) {
+  TRACE_SPAN("TyTCodeplug::decodeElements", "codeplug");
   // General config
   if (! this->decodeGeneralSettings(ctx.config(), err)) {
     errMsg(err) << "Cannot decode general settings.";
@@ -1,21 +1,24 @@
 #include "tyt_interface.hh"
 #include "logger.hh"
-#include <unistd.h>
 #include "utils.hh"
 #include "errorstack.hh"
+#include <algorithm>
 
 #define USB_VID 0x0483
 #define USB_PID 0xdf11
 
 
 TyTInterface::TyTInterface(const USBDeviceDescriptor &descr, const ErrorStack &err, QObject *parent)
-  : DFUSEDevice(descr, err, 16, parent), RadioInterface()
+  : DFUSEDevice(descr, err, 16, parent), RadioInterface(), _transferSize(1024)
 {
   if (! DFUDevice::isOpen()) {
     errMsg(err) << "Cannot open TyTInterface.";
     return;
   }
 
+  // Use the largest transfer size supported by the device, that is a multiple of 1024 bytes.
+  _transferSize = std::max(1024U, (unsigned(maxTransferSize())/1024)*1024);
+
   // Enter Programming Mode.
   if (wait_idle()) {
     errMsg(err) << "Device not ready. Close device.";
@@ -54,7 +57,7 @@ TyTInterface::TyTInterface(const USBDeviceDescriptor &descr, const ErrorStack &e
   }
 
   logDebug() << "Found device " << _ident.manufacturer() << " "<< _ident.name()
-             << " at " << descr.description() << ".";
+             << " at " << descr.description() << ", transfer size " << _transferSize << "b.";
 }
 
 TyTInterface::~TyTInterface() {
@@ -86,6 +89,11 @@ TyTInterface::isOpen() const {
   return DFUSEDevice::isOpen() && _ident.isValid();
 }
 
+unsigned
+TyTInterface::transferSize() const {
+  return _transferSize;
+}
+
 RadioInfo
 TyTInterface::identifier(const ErrorStack &err) {
   Q_UNUSED(err);
@@ -100,7 +108,7 @@ TyTInterface::md380_command(uint8_t a, uint8_t b, const ErrorStack &err)
   if (int error = download(0, cmd, 2, err))
     return error;
 
-  usleep(100000);
+  wait_poll();
   return wait_idle();
 }
 
@@ -156,6 +164,7 @@ TyTInterface::identify(const ErrorStack &err)
 
 bool
 TyTInterface::erase(unsigned start, unsigned size, void(*progress)(unsigned, void *), void *ctx, const ErrorStack &err) {
+  TransferStatistics::Timer timer(_transferStatistics);
   int error;
   // Enter Programming Mode.
   if ((error = get_status(err)))
@@ -164,7 +173,6 @@ TyTInterface::erase(unsigned start, unsigned size, void(*progress)(unsigned, voi
     return false;
   if ((error = md380_command(0x91, 0x01, err)))
     return false;
-  usleep(100000);
 
   unsigned end = start+size;
   start = align_addr(start, 0x10000);
@@ -199,8 +207,20 @@ TyTInterface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, cons
     return false;
   }
 
-  uint32_t block = addr/1024;
-  return 0 == upload(block+2, data, nbytes, err);
+  // The base address is kept at 0, hence the address is given by the block number times the block
+  // size. Use the transfer size where aligned, 1k blocks otherwise.
+  while (nbytes > 0) {
+    if (! checkCanceled(err))
+      return false;
+    int bsize = ((0 == (addr % _transferSize)) && (nbytes >= int(_transferSize))) ? _transferSize : 1024;
+    int len = std::min(bsize, nbytes);
+    TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Read, len);
+    if (upload(addr/bsize+2, data, len, err))
+      return false;
+    addr += len; data += len; nbytes -= len;
+  }
+
+  return true;
 }
 
 bool
@@ -225,11 +245,22 @@ TyTInterface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, con
     return false;
   }
 
-  uint32_t block = addr/1024;
-  if (download(block+2, data, nbytes, err))
-    return false;
+  // The base address is kept at 0, hence the address is given by the block number times the block
+  // size. Use the transfer size where aligned, 1k blocks otherwise.
+  while (nbytes > 0) {
+    if (! checkCanceled(err))
+      return false;
+    int bsize = ((0 == (addr % _transferSize)) && (nbytes >= int(_transferSize))) ? _transferSize : 1024;
+    int len = std::min(bsize, nbytes);
+    TransferStatistics::Timer timer(_transferStatistics, TransferStatistics::Direction::Write, len);
+    if (download(addr/bsize+2, data, len, err))
+      return false;
+    if (0 != wait_idle())
+      return false;
+    addr += len; data += len; nbytes -= len;
+  }
 
-  return 0 == wait_idle();
+  return true;
 }
 
 bool
@@ -83,6 +83,10 @@ public:
   bool write_finish(const ErrorStack &err=ErrorStack());
   bool reboot(const ErrorStack &err=ErrorStack());
 
+  /** Returns the number of bytes transferred at once by @c read and @c write. This is the largest
+   * multiple of 1024 bytes, supported by the device. */
+  unsigned transferSize() const;
+
   /** Erases a memory section at @c start of size @c size. */
   bool erase(unsigned start, unsigned size, void (*progress)(unsigned, void *)=nullptr, void *ctx=nullptr, const ErrorStack &err=ErrorStack());
 
@@ -105,6 +109,8 @@ protected:
 protected:
   /** Read identifier. */
   RadioInfo _ident;
+  /** Number of bytes transferred at once. */
+  unsigned _transferSize;
 };
 
 #endif // TYTINTERFACE_HH
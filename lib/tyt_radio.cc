@@ -2,8 +2,12 @@
 #include "config.hh"
 #include "logger.hh"
 #include "utils.hh"
+#include <QSet>
+#include <algorithm>
 
 #define BSIZE 1024
+/** Erase sector size of the flash memory. */
+#define ESIZE 0x10000
 
 
 TyTRadio::TyTRadio(TyTInterface *device, QObject *parent)
@@ -26,6 +30,24 @@ TyTRadio::~TyTRadio() {
   logDebug() << "Destructed TyT radio.";
 }
 
+TransferStatistics
+TyTRadio::transferStatistics() const {
+  if (nullptr == _dev)
+    return TransferStatistics();
+  return _dev->transferStatistics();
+}
+
+void
+TyTRadio::moveInterfaceToThread(QThread *thread) {
+  if (_dev)
+    _dev->moveToThread(thread);
+}
+
+RadioInterface *
+TyTRadio::radioInterface() const {
+  return _dev;
+}
+
 bool
 TyTRadio::startDownload(bool blocking, const ErrorStack &err) {
   if (StatusIdle != _task)
@@ -58,6 +80,7 @@ TyTRadio::startUpload(Config *config, bool blocking, const Codeplug::Flags &flag
   _task = StatusUpload;
   _errorStack = err;
   _codeplugFlags = flags;
+  _checkpoint.reset();
 
   if (blocking) {
     this->run();
@@ -81,6 +104,21 @@ TyTRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignD
 
   _task = StatusUploadCallsigns;
   _errorStack = err;
+  _checkpoint.reset();
+
+  if (blocking) {
+    this->run();
+    return (StatusIdle == _task);
+  }
+
+  this->start();
+  return true;
+}
+
+bool
+TyTRadio::startResume(bool blocking, const ErrorStack &err) {
+  if (! restoreCheckpoint(err))
+    return false;
 
   if (blocking) {
     this->run();
@@ -119,6 +157,7 @@ TyTRadio::run() {
     }
 
     if (! upload()) {
+      storeCheckpoint();
       _dev->reboot();
       _dev->close();
       _task = StatusError;
@@ -126,6 +165,7 @@ TyTRadio::run() {
       return;
     }
 
+    clearCheckpoint();
     _dev->reboot();
     _dev->close();
     _task = StatusIdle;
@@ -137,6 +177,7 @@ TyTRadio::run() {
     }
 
     if(! uploadCallsigns()) {
+      storeCheckpoint();
       _dev->reboot();
       _dev->close();
       _task = StatusError;
@@ -144,6 +185,7 @@ TyTRadio::run() {
       return;
     }
 
+    clearCheckpoint();
     _task = StatusIdle;
     _dev->reboot();
     _dev->close();
@@ -169,19 +211,24 @@ TyTRadio::download() {
     }
     totb += codeplug().image(0).element(n).data().size()/BSIZE;
   }
+  enterPhase(PhaseRead, totb*BSIZE);
+  // All elements get downloaded entirely, no need to initialize them
+  codeplug().prepareOverwrite();
 
   // Then download codeplug
   size_t bcount = 0;
+  unsigned chunk = _dev->transferSize();
   for (int n=0; n<codeplug().image(0).numElements(); n++) {
     unsigned addr = codeplug().image(0).element(n).address();
     unsigned size = codeplug().image(0).element(n).data().size();
-    unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-    for (unsigned b=0; b<nb; b++, bcount++) {
-      if (! _dev->read(0, (b0+b)*BSIZE, codeplug().data((b0+b)*BSIZE), BSIZE, _errorStack)) {
+    for (unsigned o=0; o<size;) {
+      unsigned len = std::min(chunk, size-o);
+      if (! _dev->read(0, addr+o, codeplug().data(addr+o), len, _errorStack)) {
         errMsg(_errorStack) << "Cannot download codeplug.";
         return false;
       }
-      emit downloadProgress(float(bcount*100)/totb);
+      o += len; bcount += len/BSIZE;
+      reportDownloadProgress(float(bcount*100)/totb);
     }
   }
 
@@ -199,50 +246,154 @@ TyTRadio::upload() {
     return false;
   }
 
-  size_t totb = codeplug().memSize();
-
   size_t bcount = 0;
-  // If codeplug gets updated, download codeplug from device first:
-  if (_codeplugFlags.updateCodePlug) {
+  unsigned chunk = _dev->transferSize();
+
+  // If resumed, the image being written was restored from the checkpoint. Otherwise, read and
+  // encode the codeplug first.
+  DFUFile::Image current;
+  if (_checkpoint.isResume())
+    logInfo() << "Resume upload to " << name() << " from checkpoint.";
+  else if (! prepareUpload(current))
+    return false;
+
+  // Merge adjacent elements, allows for longer consecutive writes
+  codeplug().image(0).compact();
+  current.compact();
+
+  // Flash memory can only be erased sector-wise. Hence, find all sectors containing modified blocks,
+  // that have not been written before, when resuming.
+  const DFUFile::Image &image = codeplug().image(0);
+  QSet<unsigned> modified;
+  for (int n=0; n<image.numElements(); n++) {
+    unsigned addr = image.element(n).address();
+    unsigned size = image.element(n).memSize();
+    for (unsigned b=addr; b<(addr+size); b+=BSIZE) {
+      if (_checkpoint.pending(0, n, b-addr, BSIZE) && image.differs(current, b, BSIZE))
+        modified.insert(b/ESIZE);
+    }
+  }
+
+  // Count blocks to write
+  size_t totb = 0;
+  for (int n=0; n<image.numElements(); n++) {
+    unsigned addr = image.element(n).address();
+    unsigned size = image.element(n).memSize();
+    for (unsigned b=addr; b<(addr+size); b+=BSIZE)
+      if (modified.contains(b/ESIZE))
+        totb += BSIZE;
+  }
+
+  enterPhase(PhaseWrite, totb);
+  // then erase modified sectors
+  _checkpoint.begin();
+  QList<unsigned> sectors = modified.values(); std::sort(sectors.begin(), sectors.end());
+  for (int i=0; i<sectors.size();) {
+    int j = i+1;
+    while ((j<sectors.size()) && ((sectors[j-1]+1) == sectors[j]))
+      j++;
+    _dev->erase(sectors[i]*ESIZE, (j-i)*ESIZE, nullptr, nullptr, _errorStack);
+    i = j;
+  }
+
+  logDebug() << "Upload " << totb << "b in " << sectors.size() << " modified sectors.";
+  // then, upload all blocks within modified sectors, chunks never cross a sector boundary
+  bcount = 0;
+  for (int n=0; n<image.numElements(); n++) {
+    unsigned addr = image.element(n).address();
+    unsigned size = image.element(n).memSize();
+    for (unsigned o=0; o<size;) {
+      unsigned len = std::min({chunk, size-o, unsigned(ESIZE - ((addr+o) % ESIZE))});
+      if (! modified.contains((addr+o)/ESIZE)) {
+        o += len;
+        continue;
+      }
+      // Sector got erased, hence there is no need to write erased (all 0xff) chunks
+      if (! is_uniform(codeplug().data(addr+o), len, 0xff)) {
+        if (! _dev->write(0, addr+o, codeplug().data(addr+o), len, _errorStack)) {
+          errMsg(_errorStack) << "Cannot upload codeplug.";
+          return false;
+        }
+      }
+      o += len; bcount += len;
+      _checkpoint.confirm(0, n, o);
+      reportUploadProgress(50+float(bcount*50)/totb);
+    }
+  }
+
+  // Remember what has been written to the device
+  if (! _imageCacheId.isEmpty())
+    _imageCache.store(name(), _imageCacheId, codeplug());
+
+  return true;
+}
+
+bool
+TyTRadio::prepareUpload(DFUFile::Image &current) {
+  unsigned chunk = _dev->transferSize();
+
+  // Try to obtain the current device memory from the image cache first
+  DFUFile cached;
+  bool restored = _codeplugFlags.updateCodePlug && (! _imageCacheId.isEmpty())
+      && _imageCache.load(name(), _imageCacheId, cached) && (1 == cached.numImages())
+      && codeplug().image(0).copyData(cached.image(0))
+      && ImageCache::verify(_dev, cached.image(0), BSIZE);
+  if (restored)
+    logInfo() << "Use cached image of " << name() << " '" << _imageCacheId << "', skip read.";
+
+  // If codeplug gets updated, download codeplug from device first. Memory entirely rewritten by
+  // the encoder is skipped.
+  std::vector<AddressMap::Range> generated = codeplug().generatedMemory();
+  if (_codeplugFlags.updateCodePlug && (! restored)) {
+    size_t totb = 0, bcount = 0;
+    for (int n=0; n<codeplug().image(0).numElements(); n++) {
+      unsigned addr = codeplug().image(0).element(n).address();
+      unsigned size = codeplug().image(0).element(n).data().size();
+      for (unsigned o=0; o<size; o+=BSIZE)
+        if (! Codeplug::isGenerated(generated, addr+o, BSIZE))
+          totb += BSIZE;
+    }
+    logDebug() << "Read " << totb << "b of " << codeplug().memSize() << "b preserved from device.";
+    enterPhase(PhaseRead, totb);
     for (int n=0; n<codeplug().image(0).numElements(); n++) {
       unsigned addr = codeplug().image(0).element(n).address();
       unsigned size = codeplug().image(0).element(n).data().size();
-      unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-      for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
-        if (! _dev->read(0, (b0+b)*BSIZE, codeplug().data((b0+b)*BSIZE), BSIZE, _errorStack)) {
+      for (unsigned o=0; o<size;) {
+        if (Codeplug::isGenerated(generated, addr+o, BSIZE)) {
+          o += BSIZE;
+          continue;
+        }
+        // read consecutive preserved blocks up to a chunk
+        unsigned len = std::min(chunk, size-o);
+        for (unsigned b=BSIZE; b<len; b+=BSIZE) {
+          if (Codeplug::isGenerated(generated, addr+o+b, BSIZE)) {
+            len = b;
+            break;
+          }
+        }
+        if (! _dev->read(0, addr+o, codeplug().data(addr+o), len, _errorStack)) {
           errMsg(_errorStack) << "Cannot upload codeplug.";
           return false;
         }
-        emit uploadProgress(float(bcount*50)/totb);
+        o += len; bcount += len;
+        reportUploadProgress(float(bcount*50)/totb);
       }
     }
   }
 
+  // Keep a copy of the current device memory, to upload modified sectors only. The copy is cheap
+  // as the element data is implicitly shared until modified by the encoder. The memory not read
+  // from the device is unknown and gets excluded, hence it is always written.
+  if (restored)
+    current = cached.image(0);
+  else if (_codeplugFlags.updateCodePlug)
+    current = codeplug().image(0).excluding(generated);
+
   // Encode config into codeplug
   logDebug() << "Encode codeplug.";
+  enterPhase(PhaseEncode);
   codeplug().encode(_config, _codeplugFlags);
 
-  // then erase memory
-  for (int i=0; i<codeplug().image(0).numElements(); i++)
-    _dev->erase(codeplug().image(0).element(i).address(), codeplug().image(0).element(i).memSize(),
-                nullptr, nullptr, _errorStack);
-
-  logDebug() << "Upload " << codeplug().image(0).numElements() << " elements.";
-  // then, upload modified codeplug
-  bcount = 0;
-  for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    unsigned addr = codeplug().image(0).element(n).address();
-    unsigned size = codeplug().image(0).element(n).memSize();
-    unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-    for (size_t b=0; b<nb; b++,bcount+=BSIZE) {
-      if (! _dev->write(0, (b0+b)*BSIZE, codeplug().data((b0+b)*BSIZE), BSIZE, _errorStack)) {
-        errMsg(_errorStack) << "Cannot upload codeplug.";
-        return false;
-      }
-      emit uploadProgress(50+float(bcount*50)/totb);
-    }
-  }
-
   return true;
 }
 
@@ -258,10 +409,21 @@ TyTRadio::uploadCallsigns() {
     return false;
   }
 
+  unsigned addr = callsignDB()->image(0).element(0).address();
+  unsigned size = callsignDB()->image(0).element(0).memSize();
+  unsigned chunk = _dev->transferSize(), skipped = 0;
+
+  // When resuming, start at the sector containing the first block not written before
+  unsigned start = 0;
+  while ((start < size) && (! _checkpoint.pending(0, 0, start, BSIZE)))
+    start += BSIZE;
+  start = std::max(addr, ((addr+start)/ESIZE)*ESIZE) - addr;
+
   // then erase memory
   logDebug() << "Erase memory section for call-sign DB.";
-  _dev->erase(callsignDB()->image(0).element(0).address(),
-              callsignDB()->image(0).element(0).memSize(),
+  enterPhase(PhaseWrite, size-start);
+  _checkpoint.begin();
+  _dev->erase(addr+start, size-start,
               [](unsigned percent, void *ctx) { emit ((TyTRadio *)ctx)->uploadProgress(percent/2); },
               this, _errorStack);
 
@@ -269,16 +431,20 @@ TyTRadio::uploadCallsigns() {
   // Total amount of data to transfer
   size_t totb = callsignDB()->memSize();
   // Upload callsign DB
-  unsigned addr = callsignDB()->image(0).element(0).address();
-  unsigned size = callsignDB()->image(0).element(0).memSize();
-  unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-  for (size_t b=0, bcount=0; b<nb; b++,bcount+=BSIZE) {
-    if (! _dev->write(0, (b0+b)*BSIZE, callsignDB()->data((b0+b)*BSIZE), BSIZE, _errorStack)) {
+  for (unsigned o=start; o<size;) {
+    unsigned len = std::min(chunk, size-o);
+    // Memory got erased, hence erased (all 0xff) chunks are skipped
+    if (is_uniform(callsignDB()->data(addr+o), len, 0xff)) {
+      skipped += len;
+    } else if (! _dev->write(0, addr+o, callsignDB()->data(addr+o), len, _errorStack)) {
       errMsg(_errorStack) << "Cannot upload codeplug.";
       return false;
     }
-    emit uploadProgress(50+float(bcount*50)/totb);
+    o += len;
+    _checkpoint.confirm(0, 0, o);
+    reportUploadProgress(50+float(o*50)/totb);
   }
+  logDebug() << "Skipped " << skipped << "b of erased memory.";
 
   return true;
 }
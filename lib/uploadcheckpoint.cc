@@ -0,0 +1,126 @@
+#include "uploadcheckpoint.hh"
+#include "logger.hh"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QRegularExpression>
+
+
+/* ********************************************************************************************* *
+ * Implementation of UploadCheckpoint
+ * ********************************************************************************************* */
+UploadCheckpoint::UploadCheckpoint(const QString &directory)
+  : _directory(directory), _active(false), _resume(false), _image(0), _element(0), _offset(0)
+{
+  if (_directory.isEmpty())
+    _directory = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+        .filePath("checkpoints");
+}
+
+const QString &
+UploadCheckpoint::directory() const {
+  return _directory;
+}
+
+void
+UploadCheckpoint::reset() {
+  _active = _resume = false;
+  _image = _element = _offset = 0;
+}
+
+void
+UploadCheckpoint::begin() {
+  _active = true;
+}
+
+bool
+UploadCheckpoint::isActive() const {
+  return _active;
+}
+
+bool
+UploadCheckpoint::isResume() const {
+  return _resume;
+}
+
+void
+UploadCheckpoint::confirm(unsigned image, unsigned element, unsigned offset) {
+  _image = image; _element = element; _offset = offset;
+}
+
+bool
+UploadCheckpoint::pending(unsigned image, unsigned element, unsigned offset, unsigned size) const {
+  if (image != _image)
+    return image > _image;
+  if (element != _element)
+    return element > _element;
+  return (offset+size) > _offset;
+}
+
+QString
+UploadCheckpoint::filename(const QString &key, const QString &suffix) const {
+  QString name = QString("%1.%2").arg(key, suffix);
+  name.replace(QRegularExpression("[^A-Za-z0-9_.\\-]"), "_");
+  return QDir(_directory).filePath(name);
+}
+
+bool
+UploadCheckpoint::contains(const QString &key) const {
+  return QFileInfo::exists(filename(key, "checkpoint")) && QFileInfo::exists(filename(key, "dfu"));
+}
+
+bool
+UploadCheckpoint::store(const QString &key, Kind kind, DFUFile &file, const ErrorStack &err) const {
+  if (! QDir().mkpath(_directory)) {
+    errMsg(err) << "Cannot create checkpoint directory '" << _directory << "'.";
+    return false;
+  }
+  if (! file.write(filename(key, "dfu"), err)) {
+    errMsg(err) << "Cannot write checkpoint image '" << filename(key, "dfu") << "'.";
+    return false;
+  }
+  QSettings settings(filename(key, "checkpoint"), QSettings::IniFormat);
+  settings.setValue("kind", (Kind::Codeplug == kind) ? "codeplug" : "callsigndb");
+  settings.setValue("image", _image);
+  settings.setValue("element", _element);
+  settings.setValue("offset", _offset);
+  settings.sync();
+  if (QSettings::NoError != settings.status()) {
+    errMsg(err) << "Cannot write checkpoint '" << filename(key, "checkpoint") << "'.";
+    return false;
+  }
+  logInfo() << "Stored upload checkpoint at image " << _image << ", element " << _element
+            << ", offset 0x" << QString::number(_offset, 16) << ".";
+  return true;
+}
+
+bool
+UploadCheckpoint::load(const QString &key, Kind &kind, DFUFile &file, const ErrorStack &err) {
+  if (! contains(key)) {
+    errMsg(err) << "No upload checkpoint found for '" << key << "'.";
+    return false;
+  }
+  if (! file.read(filename(key, "dfu"), err)) {
+    errMsg(err) << "Cannot read checkpoint image '" << filename(key, "dfu") << "'.";
+    return false;
+  }
+  QSettings settings(filename(key, "checkpoint"), QSettings::IniFormat);
+  kind = ("callsigndb" == settings.value("kind").toString()) ? Kind::CallsignDB : Kind::Codeplug;
+  _image   = settings.value("image", 0).toUInt();
+  _element = settings.value("element", 0).toUInt();
+  _offset  = settings.value("offset", 0).toUInt();
+  _resume  = true;
+  _active  = false;
+  logDebug() << "Loaded upload checkpoint at image " << _image << ", element " << _element
+             << ", offset 0x" << QString::number(_offset, 16) << ".";
+  return true;
+}
+
+void
+UploadCheckpoint::remove(const QString &key) const {
+  QFile::remove(filename(key, "checkpoint"));
+  QFile::remove(filename(key, "dfu"));
+}
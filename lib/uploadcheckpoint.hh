@@ -0,0 +1,79 @@
+#ifndef UPLOADCHECKPOINT_HH
+#define UPLOADCHECKPOINT_HH
+
+#include <QString>
+#include "dfufile.hh"
+#include "errorstack.hh"
+
+/** Tracks the progress of an upload to allow for resuming it after a transfer failure.
+ *
+ * During an upload, the radio confirms the position (image, element and offset within the
+ * element) up to which the data has been written successfully. If the upload fails, the image
+ * being written is stored together with that position as a DFU file in the checkpoint directory.
+ * A later resume loads the image and continues the upload at the checkpoint, skipping the read
+ * and encoding of the codeplug as well as all blocks confirmed earlier.
+ *
+ * @ingroup util */
+class UploadCheckpoint
+{
+public:
+  /** Possible kinds of uploads. */
+  enum class Kind {
+    Codeplug, CallsignDB
+  };
+
+public:
+  /** Constructs a new checkpoint stored in the given directory. If no directory is given, the
+   * default cache location of the application is used. */
+  explicit UploadCheckpoint(const QString &directory=QString());
+
+  /** Returns the directory of the checkpoints. */
+  const QString &directory() const;
+
+  /** Resets the checkpoint at the beginning of a new upload. */
+  void reset();
+  /** Marks that the device memory is going to be modified. From now on, a failed upload can be
+   * resumed. */
+  void begin();
+  /** Returns @c true if @c begin was called, since the last reset. */
+  bool isActive() const;
+  /** Returns @c true if the current upload resumes a previous one, that is, if the checkpoint
+   * was loaded. */
+  bool isResume() const;
+
+  /** Confirms that everything before @c offset within the @c element of the @c image has been
+   * written. */
+  void confirm(unsigned image, unsigned element, unsigned offset);
+  /** Returns @c true if the block of @c size bytes at @c offset within the @c element of the
+   * @c image has not been confirmed yet. */
+  bool pending(unsigned image, unsigned element, unsigned offset, unsigned size) const;
+
+  /** Returns @c true if there is a stored checkpoint for the given key (e.g., radio name). */
+  bool contains(const QString &key) const;
+  /** Stores the checkpoint together with the image being written for the given key. */
+  bool store(const QString &key, Kind kind, DFUFile &file, const ErrorStack &err=ErrorStack()) const;
+  /** Loads the checkpoint and the image being written for the given key. */
+  bool load(const QString &key, Kind &kind, DFUFile &file, const ErrorStack &err=ErrorStack());
+  /** Removes the stored checkpoint for the given key. */
+  void remove(const QString &key) const;
+
+protected:
+  /** Returns the path of the checkpoint file with the given suffix. */
+  QString filename(const QString &key, const QString &suffix) const;
+
+protected:
+  /** The checkpoint directory. */
+  QString _directory;
+  /** If @c true, the device memory is being modified. */
+  bool _active;
+  /** If @c true, the current upload resumes a previous one. */
+  bool _resume;
+  /** Image index of the checkpoint. */
+  unsigned _image;
+  /** Element index of the checkpoint. */
+  unsigned _element;
+  /** Offset within the element of the checkpoint. */
+  unsigned _offset;
+};
+
+#endif // UPLOADCHECKPOINT_HH
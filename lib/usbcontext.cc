@@ -0,0 +1,115 @@
+#include "usbcontext.hh"
+#include "logger.hh"
+
+/** Time in ms after which the event thread checks whether it got stopped. */
+#define EVENT_TIMEOUT_MSEC 100
+
+
+/* ********************************************************************************************* *
+ * Implementation of USBContext::Completion
+ * ********************************************************************************************* */
+USBContext::Completion::Completion()
+  : _lock(), _done(), _complete(false), _result(0)
+{
+  // pass...
+}
+
+void
+USBContext::Completion::reset() {
+  QMutexLocker locker(&_lock);
+  _complete = false;
+  _result = 0;
+}
+
+void
+USBContext::Completion::complete(int result) {
+  QMutexLocker locker(&_lock);
+  _result = result;
+  _complete = true;
+  _done.wakeAll();
+}
+
+bool
+USBContext::Completion::isComplete() const {
+  QMutexLocker locker(&_lock);
+  return _complete;
+}
+
+int
+USBContext::Completion::wait() {
+  QMutexLocker locker(&_lock);
+  while (! _complete)
+    _done.wait(&_lock);
+  return _result;
+}
+
+int
+USBContext::Completion::result() const {
+  QMutexLocker locker(&_lock);
+  return _result;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of USBContext
+ * ********************************************************************************************* */
+QMutex USBContext::_instanceLock;
+USBContext *USBContext::_instance = nullptr;
+unsigned int USBContext::_references = 0;
+
+USBContext::USBContext(libusb_context *ctx)
+  : QThread(), _ctx(ctx), _running(1)
+{
+  // pass...
+}
+
+libusb_context *
+USBContext::acquire(const ErrorStack &err) {
+  QMutexLocker locker(&_instanceLock);
+
+  if (nullptr == _instance) {
+    libusb_context *ctx = nullptr;
+    int error = libusb_init(&ctx);
+    if (error < 0) {
+      errMsg(err) << "Libusb init failed (" << error << "): "
+                  << libusb_strerror((enum libusb_error) error) << ".";
+      return nullptr;
+    }
+    logDebug() << "Start shared libusb event thread.";
+    _instance = new USBContext(ctx);
+    _instance->start();
+  }
+
+  _references++;
+  return _instance->_ctx;
+}
+
+void
+USBContext::release() {
+  QMutexLocker locker(&_instanceLock);
+
+  if ((nullptr == _instance) || (0 == _references))
+    return;
+  if (0 != (--_references))
+    return;
+
+  logDebug() << "Stop shared libusb event thread.";
+  _instance->_running = 0;
+  _instance->wait();
+  libusb_exit(_instance->_ctx);
+  delete _instance;
+  _instance = nullptr;
+}
+
+void
+USBContext::run() {
+  struct timeval timeout = {0, EVENT_TIMEOUT_MSEC*1000};
+  while (_running) {
+    int error = libusb_handle_events_timeout_completed(_ctx, &timeout, nullptr);
+    if ((error < 0) && (LIBUSB_ERROR_INTERRUPTED != error) && (LIBUSB_ERROR_TIMEOUT != error)
+        && (LIBUSB_ERROR_BUSY != error)) {
+      logError() << "Cannot handle libusb events (" << error << "): "
+                 << libusb_strerror((enum libusb_error) error) << ".";
+    }
+  }
+}
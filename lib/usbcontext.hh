@@ -0,0 +1,89 @@
+#ifndef USBCONTEXT_HH
+#define USBCONTEXT_HH
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <libusb.h>
+#include "errorstack.hh"
+
+/** Shared libusb context with a dedicated event thread.
+ *
+ * All libusb based devices (HID, DFU, ...) share a single libusb context. While at least one device
+ * holds a reference to the context, a dedicated thread handles the libusb events and thus
+ * completes the asynchronous transfers of all open devices. This allows to access several radios
+ * concurrently from different threads, without each device pumping the events of its own context.
+ *
+ * Asynchronous transfers signal their completion through a @c USBContext::Completion, set from
+ * the transfer callback within the event thread. Synchronous libusb transfers work unchanged, as
+ * libusb coordinates them with the event thread.
+ *
+ * @ingroup rif */
+class USBContext: public QThread
+{
+  Q_OBJECT
+
+public:
+  /** The completion of an asynchronous transfer.
+   *
+   * The transfer callback calls @c complete from the event thread, the device waits for the
+   * result using @c wait. */
+  class Completion
+  {
+  public:
+    /** Constructs a pending completion. */
+    Completion();
+
+    /** Marks the completion as pending again. Must be called before a transfer is submitted. */
+    void reset();
+    /** Completes the transfer with the given result and wakes all waiting threads. */
+    void complete(int result);
+    /** Returns @c true if the transfer has completed. */
+    bool isComplete() const;
+    /** Blocks until the transfer has completed and returns its result. */
+    int wait();
+    /** Returns the result of the completed transfer. */
+    int result() const;
+
+  protected:
+    /** Protects the state. */
+    mutable QMutex _lock;
+    /** Signals the completion. */
+    QWaitCondition _done;
+    /** If @c true, the transfer has completed. */
+    bool _complete;
+    /** The result of the transfer. */
+    int _result;
+  };
+
+public:
+  /** Returns the shared libusb context and starts the event thread on first use. Every successful
+   * call must be paired with a call to @c release. Returns @c nullptr on error. */
+  static libusb_context *acquire(const ErrorStack &err=ErrorStack());
+  /** Releases a reference to the shared context. The last reference stops the event thread and
+   * frees the context. */
+  static void release();
+
+protected:
+  /** Hidden constructor, use @c acquire. */
+  explicit USBContext(libusb_context *ctx);
+
+  /** Handles the libusb events until stopped. */
+  void run() override;
+
+protected:
+  /** The libusb context. */
+  libusb_context *_ctx;
+  /** If cleared, the event thread terminates. */
+  QAtomicInt _running;
+
+  /** Protects the shared instance. */
+  static QMutex _instanceLock;
+  /** The shared instance. */
+  static USBContext *_instance;
+  /** Number of references to the shared instance. */
+  static unsigned int _references;
+};
+
+#endif // USBCONTEXT_HH
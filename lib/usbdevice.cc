@@ -1,8 +1,8 @@
 #include "usbdevice.hh"
 #include <QTextStream>
-#include <QSerialPortInfo>
 #include <libusb.h>
 #include "logger.hh"
+#include "devicemonitor.hh"
 #include "radioinfo.hh"
 
 #include "anytone_interface.hh"
@@ -133,14 +133,22 @@ USBDeviceInfo::description() const {
   case Class::C7K:
     stream << "C7000 " << QString::number(_vid,16) << ":" << QString::number(_pid,16);
     break;
+  case Class::Virtual:
+    stream << "Virtual interface " << QString::number(_vid,16) << ":" << QString::number(_pid,16);
+    break;
   }
   return res;
 }
 
 QString
 USBDeviceInfo::longDescription() const {
+  // Virtual devices emulate the serial interface with the same VID:PID
+  USBDeviceInfo info(*this);
+  if (Class::Virtual == _class)
+    info._class = Class::Serial;
+
   QStringList radios;
-  foreach (RadioInfo radio, RadioInfo::allRadios(*this, true)) {
+  foreach (RadioInfo radio, RadioInfo::allRadios(info, true)) {
     radios.append(QString("%1 %2").arg(radio.manufacturer(), radio.name()));
   }
   // This should not happen
@@ -201,72 +209,43 @@ USBDeviceDescriptor::isValid() const {
   case Class::HID:
   case Class::C7K:
     return validRawUSB();
+  case Class::Virtual:
+    return true;
   }
   return false;
 }
 
 bool
 USBDeviceDescriptor::validRawUSB() const {
-  int error, num;
-  libusb_context *ctx;
-  if (0 > (error = libusb_init(&ctx))) {
-    logError() << "Libusb init failed (" << error << "): "
-               << libusb_strerror((enum libusb_error) error) << ".";
-    return false;
-  }
-
-  libusb_device **lst;
-  if (0 == (num = libusb_get_device_list(ctx, &lst))) {
-    logDebug() << "No USB devices found at all.";
-    // unref devices and free list
-    libusb_free_device_list(lst, 1);
-    libusb_exit(ctx);
-    return false;
-  }
-
   USBDeviceHandle addr = _device.value<USBDeviceHandle>();
   logDebug() << "Search for a device matching VID:PID "
              << QString::number(_vid, 16) << ":" << QString::number(_pid, 16)
              << " at bus " << addr.bus << ", device " << addr.device << ".";
-  bool found = false;
-  for (int i=0; (i<num)&&(nullptr!=lst[i]); i++) {
-    libusb_device_descriptor descr;
-    libusb_get_device_descriptor(lst[i], &descr);
-    found = ( (_vid == descr.idVendor) && (_pid == descr.idProduct) &&
-              (libusb_get_bus_number(lst[i])==addr.bus) &&
-              (libusb_get_device_address(lst[i])==addr.device) );
-    if (found) {
-      logDebug() << "Found device on bus=" << libusb_get_bus_number(lst[i])
-                 << ", device=" << libusb_get_device_address(lst[i])
+  foreach (const DeviceMonitor::USBDevice &device, DeviceMonitor::usbDevices(_vid, _pid)) {
+    if ((device.bus == addr.bus) && (device.address == addr.device)) {
+      logDebug() << "Found device on bus=" << int(device.bus) << ", device=" << int(device.address)
                  << " with " << QString::number(_vid, 16) << ":" << QString::number(_pid, 16) << ".";
-      break;
+      return true;
     }
   }
-
-  // Free list and context
-  libusb_free_device_list(lst, 1);
-  libusb_exit(ctx);
-
-  // done.
-  return found;
+  return false;
 }
 
 bool
 USBDeviceDescriptor::validSerial() const {
-  QSerialPortInfo info(_device.toString());
-
   logDebug() << "Check if serial port " << _device.toString() << " still exisist and has VID:PID "
              << QString::number(_vid, 16) << ":" << QString::number(_pid, 16) << ".";
 
-  if (info.isNull()) {
-    logDebug() << "Serial port " << info.portName() << "("
-               << _device.toString() << ") is not valid anymore.";
-    return false;
+  foreach (const DeviceMonitor::SerialPort &port, DeviceMonitor::serialPorts()) {
+    if ((port.name != _device.toString()) && (port.location != _device.toString()))
+      continue;
+    if (port.vid && port.pid)
+      return ((_vid == port.vid) && (_pid == port.pid));
+    return true;
   }
 
-  if (info.hasProductIdentifier() && info.hasVendorIdentifier())
-    return ((_vid == info.vendorIdentifier()) && (_pid == info.productIdentifier()));
-  return true;
+  logDebug() << "Serial port " << _device.toString() << " is not valid anymore.";
+  return false;
 }
 
 QString
@@ -282,6 +261,8 @@ USBDeviceDescriptor::description() const {
   } else if (USBDeviceInfo::Class::C7K == _class) {
     USBDeviceHandle addr = _device.value<USBDeviceHandle>();
     return QString("USB C7000 HT: bus %1, device %2").arg(addr.bus).arg(addr.device);
+  } else if (USBDeviceInfo::Class::Virtual == _class) {
+    return QString("Virtual radio '%1'").arg(_device.toString());
   }
   return "Invalid";
 }
@@ -302,6 +283,7 @@ USBDeviceDescriptor::deviceHandle() const {
     return QString("%1:%2").arg(_device.value<USBDeviceHandle>().bus)
         .arg(_device.value<USBDeviceHandle>().device);
   case Class::Serial:
+  case Class::Virtual:
     return _device.toString();
   }
 
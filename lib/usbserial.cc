@@ -1,8 +1,22 @@
 #include "usbserial.hh"
 #include "logger.hh"
+#include "devicemonitor.hh"
+#include "virtualdevice.hh"
+#include "sessionrecorder.hh"
 #include <QFileInfo>
 #include <QSerialPortInfo>
+#include <QElapsedTimer>
 #include <QThread>
+#include <QFile>
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#endif
+
+#define TIMEOUT 1000                         // default response timeout in ms
+#define LOW_LATENCY_TIMER "1"                // latency timer of USB-serial bridges in ms
+
+bool USBSerial::_lowLatency = false;
 
 /* ******************************************************************************************** *
  * Implementation of USBSerial::Info
@@ -17,8 +31,23 @@ USBSerial::Descriptor::Descriptor(uint16_t vid, uint16_t pid, const QString &dev
  * Implementation of USBSerial
  * ******************************************************************************************** */
 USBSerial::USBSerial(const USBDeviceDescriptor &descriptor, BaudRate rate, const ErrorStack &err, QObject *parent)
-  : QSerialPort(parent), RadioInterface()
+  : QSerialPort(parent), RadioInterface(), _timing(TIMEOUT), _virtual(nullptr),
+    _recorder(nullptr), _serialFlags(-1), _latencyTimer()
 {
+  if (USBDeviceInfo::Class::Virtual == descriptor.interfaceClass()) {
+    logDebug() << "Try to open " << descriptor.description() << ".";
+    if (nullptr == (_virtual = VirtualDevice::create(descriptor.device().toString(), err))) {
+      errMsg(err) << "Cannot open virtual device '" << descriptor.device().toString() << "'.";
+      return;
+    }
+    // Bypass the serial port, all data passes readData() and writeData()
+    QIODevice::open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    _transferStatistics.setLinkMode("virtual");
+    connect(this, SIGNAL(aboutToClose()), this, SLOT(onClose()));
+    _recorder = SessionRecorder::create(descriptor);
+    return;
+  }
+
   if (USBDeviceInfo::Class::Serial != descriptor.interfaceClass()) {
     errMsg(err) << "Cannot open serial port for a non-serial descriptor: "
                 << descriptor.description();
@@ -71,17 +100,22 @@ USBSerial::USBSerial(const USBDeviceDescriptor &descriptor, BaudRate rate, const
 
   logDebug() << "Opened serial port " << this->portName() << " with "
              << this->baudRate() << "baud.";
+  _transferStatistics.setLinkMode(_lowLatency ? enableLowLatency() : "standard");
 
   connect(this, SIGNAL(aboutToClose()), this, SLOT(onClose()));
   connect(this, SIGNAL(errorOccurred(QSerialPort::SerialPortError)),
           this, SLOT(onError(QSerialPort::SerialPortError)));
   connect(this, SIGNAL(dataTerminalReadyChanged(bool)), this, SLOT(signalingChanged()));
   connect(this, SIGNAL(requestToSendChanged(bool)), this, SLOT(signalingChanged()));
+
+  _recorder = SessionRecorder::create(descriptor);
 }
 
 USBSerial::~USBSerial() {
   if (isOpen())
     close();
+  delete _virtual;
+  delete _recorder;
 }
 
 bool
@@ -91,8 +125,46 @@ USBSerial::isOpen() const {
 
 void
 USBSerial::close() {
-  if (isOpen())
+  if (! isOpen())
+    return;
+  if (_virtual) {
+    QIODevice::close();
+  } else {
+    restoreLatency();
     QSerialPort::close();
+  }
+}
+
+qint64
+USBSerial::bytesAvailable() const {
+  if (_virtual)
+    return _virtual->bytesAvailable();
+  return QSerialPort::bytesAvailable();
+}
+
+bool
+USBSerial::waitForReadyRead(int msecs) {
+  if (_virtual)
+    return _virtual->waitForReadyRead(msecs);
+  return QSerialPort::waitForReadyRead(msecs);
+}
+
+qint64
+USBSerial::readData(char *data, qint64 maxSize) {
+  qint64 n = _virtual ? _virtual->read(data, maxSize) : QSerialPort::readData(data, maxSize);
+  if (_recorder)
+    _recorder->record(SessionRecorder::Direction::Response, data, n);
+  return n;
+}
+
+qint64
+USBSerial::writeData(const char *data, qint64 maxSize) {
+  if (_recorder)
+    _recorder->record(SessionRecorder::Direction::Request, data, maxSize);
+  if (! _virtual)
+    return QSerialPort::writeData(data, maxSize);
+  _virtual->write(data, maxSize);
+  return maxSize;
 }
 
 void
@@ -116,12 +188,10 @@ USBSerial::detect(uint16_t vid, uint16_t pid, bool isSave) {
   // Find matching serial port by VID/PID.
   logDebug() << "Search for serial port with matching VID:PID " <<
                 QString::number(vid, 16) << ":" << QString::number(pid, 16) << ".";
-  QList<QSerialPortInfo> ports = QSerialPortInfo::availablePorts();
-  foreach (QSerialPortInfo port, ports) {
-    if (port.hasProductIdentifier() && (pid == port.productIdentifier()) &&
-        port.hasVendorIdentifier() && (vid == port.vendorIdentifier())) {
-      interfaces.append(Descriptor(vid, pid, port.portName(), isSave));
-      logDebug() << "Found " << port.portName() << " (USB "
+  foreach (const DeviceMonitor::SerialPort &port, DeviceMonitor::serialPorts()) {
+    if ((pid == port.pid) && (vid == port.vid)) {
+      interfaces.append(Descriptor(vid, pid, port.name, isSave));
+      logDebug() << "Found " << port.name << " (USB "
                  << QString::number(vid, 16) << ":" << QString::number(pid, 16) << ").";
     }
   }
@@ -134,18 +204,96 @@ USBSerial::detect() {
   QList<USBDeviceDescriptor> interfaces;
   // Find matching serial port by VID/PID.
   logDebug() << "Search for serial ports.";
-  QList<QSerialPortInfo> ports = QSerialPortInfo::availablePorts();
-  foreach (QSerialPortInfo port, ports) {
-    if (port.hasProductIdentifier() && port.hasVendorIdentifier()) {
-      interfaces.append(Descriptor(port.vendorIdentifier(), port.productIdentifier(), port.portName(), false));
-      logDebug() << "Found " << port.portName() << " (USB "
-                 << QString::number(port.vendorIdentifier(), 16) << ":"
-                 << QString::number(port.productIdentifier(), 16) << ").";
+  foreach (const DeviceMonitor::SerialPort &port, DeviceMonitor::serialPorts()) {
+    if (port.pid && port.vid) {
+      interfaces.append(Descriptor(port.vid, port.pid, port.name, false));
+      logDebug() << "Found " << port.name << " (USB "
+                 << QString::number(port.vid, 16) << ":"
+                 << QString::number(port.pid, 16) << ").";
     }
   }
   return interfaces;
 }
 
+bool
+USBSerial::lowLatency() {
+  return _lowLatency;
+}
+
+void
+USBSerial::setLowLatency(bool enable) {
+  _lowLatency = enable;
+}
+
+QString
+USBSerial::enableLowLatency() {
+  QStringList applied;
+#ifdef Q_OS_LINUX
+  struct serial_struct serial;
+  if (0 != ioctl(handle(), TIOCGSERIAL, &serial)) {
+    logDebug() << "Cannot read serial flags of " << portName() << ".";
+  } else if (serial.flags & ASYNC_LOW_LATENCY) {
+    applied.append("ASYNC_LOW_LATENCY");
+  } else {
+    int flags = serial.flags;
+    serial.flags |= ASYNC_LOW_LATENCY;
+    if (0 != ioctl(handle(), TIOCSSERIAL, &serial)) {
+      logDebug() << "Cannot set ASYNC_LOW_LATENCY on " << portName() << ".";
+    } else {
+      _serialFlags = flags;
+      applied.append("ASYNC_LOW_LATENCY");
+    }
+  }
+
+  // Only some drivers expose the latency timer (e.g., ftdi_sio). CH34x bridges have none.
+  QFile timer(QString("/sys/class/tty/%1/device/latency_timer").arg(portName()));
+  if (timer.exists()) {
+    if (! timer.open(QIODevice::ReadWrite)) {
+      logDebug() << "Cannot access latency timer of " << portName() << ": "
+                 << timer.errorString() << ".";
+    } else {
+      QByteArray original = timer.readAll().trimmed();
+      if (LOW_LATENCY_TIMER == original) {
+        applied.append("latency timer " LOW_LATENCY_TIMER "ms");
+      } else if (0 < timer.write(LOW_LATENCY_TIMER)) {
+        _latencyTimer = original;
+        applied.append("latency timer " LOW_LATENCY_TIMER "ms");
+      }
+      timer.close();
+    }
+  }
+#endif
+
+  if (applied.isEmpty()) {
+    logWarn() << "Low-latency mode is not supported by serial port " << portName() << ".";
+    return "standard";
+  }
+
+  logDebug() << "Enabled low-latency mode on " << portName() << ": " << applied.join(", ") << ".";
+  return QString("low-latency (%1)").arg(applied.join(", "));
+}
+
+void
+USBSerial::restoreLatency() {
+#ifdef Q_OS_LINUX
+  if (0 <= _serialFlags) {
+    struct serial_struct serial;
+    if (0 == ioctl(handle(), TIOCGSERIAL, &serial)) {
+      serial.flags = _serialFlags;
+      ioctl(handle(), TIOCSSERIAL, &serial);
+    }
+    _serialFlags = -1;
+  }
+
+  if (! _latencyTimer.isEmpty()) {
+    QFile timer(QString("/sys/class/tty/%1/device/latency_timer").arg(portName()));
+    if (timer.open(QIODevice::WriteOnly))
+      timer.write(_latencyTimer);
+    _latencyTimer.clear();
+  }
+#endif
+}
+
 QString
 USBSerial::formatPinoutSignals() {
   if (QSerialPort::NoSignal == pinoutSignals())
@@ -175,3 +323,59 @@ USBSerial::formatPinoutSignals() {
 
   return res.join(", ");
 }
+
+bool
+USBSerial::send(const char *data, qint64 len, const ErrorStack &err) {
+  if (len != QSerialPort::write(data, len)) {
+    errMsg(err) << "QSerialPort: " << errorString();
+    errMsg(err) << "Cannot write to serial port.";
+    return false;
+  }
+  return true;
+}
+
+bool
+USBSerial::receive(char *data, qint64 len, int timeout_ms, const ErrorStack &err) {
+  QElapsedTimer timer; timer.start();
+  while (len > 0) {
+    if (0 == bytesAvailable()) {
+      // Pushes out any queued requests before blocking on the response.
+      qint64 remaining = timeout_ms - timer.elapsed();
+      if ((0 >= remaining) || (! waitForReadyRead(remaining))) {
+        errMsg(err) << "QSerialPort: " << errorString();
+        errMsg(err) << "Cannot read from serial port: Timeout!";
+        return false;
+      }
+    }
+
+    qint64 k = QSerialPort::read(data, std::min(len, bytesAvailable()));
+    if (0 > k) {
+      errMsg(err) << "QSerialPort: " << errorString();
+      errMsg(err) << "Cannot read from serial port.";
+      return false;
+    }
+
+    len -= k;
+    data += k;
+  }
+
+  _timing.addRoundTrip(timer.nsecsElapsed()/1000);
+  return true;
+}
+
+bool
+USBSerial::transceive(const char *req, qint64 reqlen, char *resp, qint64 resplen,
+                      int timeout_ms, const ErrorStack &err)
+{
+  if (! send(req, reqlen, err))
+    return false;
+  return receive(resp, resplen, timeout_ms, err);
+}
+
+void
+USBSerial::discardInput(int settle_ms) {
+  while (waitForReadyRead(settle_ms))
+    QSerialPort::readAll();
+  if (! _virtual)
+    QSerialPort::clear(QSerialPort::Input);
+}
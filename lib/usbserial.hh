@@ -5,10 +5,15 @@
 #include <QSerialPort>
 #include "radiointerface.hh"
 #include "errorstack.hh"
+#include "timingpolicy.hh"
+
+class VirtualDevice;
+class SessionRecorder;
 
 /** Implements a serial connection to a radio via USB.
  *
- * The correct serial port is selected by the given VID and PID to the constructor.
+ * The correct serial port is selected by the given VID and PID to the constructor. If a virtual
+ * device descriptor is passed, the radio gets emulated in memory instead (see @c VirtualDevice).
  *
  * @ingroup rif
  */
@@ -44,12 +49,27 @@ public:
   /** Closes the interface to the device. */
   void close();
 
+  /** Returns the number of bytes available for reading. */
+  qint64 bytesAvailable() const;
+  /** Blocks until new data is available for reading or the timeout passed. */
+  bool waitForReadyRead(int msecs=30000);
+
 public:
   /** Searches for all USB serial ports with the specified VID/PID. */
   static QList<USBDeviceDescriptor> detect(uint16_t vid, uint16_t pid, bool isSave=true);
   /** Searches for all USB serial ports */
   static QList<USBDeviceDescriptor> detect();
 
+  /** Returns @c true if serial ports get opened in low-latency mode. */
+  static bool lowLatency();
+  /** Enables or disables the low-latency mode for all serial ports opened afterwards.
+   *
+   * On Linux, the low-latency mode sets the @c ASYNC_LOW_LATENCY flag of the port and reduces
+   * the latency timer of the USB-serial bridge to 1ms, where the driver exposes it (e.g., FTDI).
+   * Otherwise, these bridges hold back short responses for up to 16ms. The original settings are
+   * restored when the port gets closed. */
+  static void setLowLatency(bool enable);
+
 protected slots:
   /** Callback for serial interface errors. */
   void onError(QSerialPort::SerialPortError error_t);
@@ -59,8 +79,47 @@ protected slots:
   void signalingChanged();
 
 protected:
+  /** Reads from the port or the virtual device. */
+  qint64 readData(char *data, qint64 maxSize);
+  /** Writes to the port or the virtual device. */
+  qint64 writeData(const char *data, qint64 maxSize);
+
   /** Serializes the pinout singals. */
   QString formatPinoutSignals();
+
+  /** Applies the low-latency settings to the open port. Returns the effective link mode. */
+  QString enableLowLatency();
+  /** Restores the settings changed by @c enableLowLatency. */
+  void restoreLatency();
+
+  /** Queues the given request for sending without waiting for any response.
+   * Several requests may be queued back-to-back before their responses are collected using
+   * @c receive. */
+  bool send(const char *data, qint64 len, const ErrorStack &err=ErrorStack());
+  /** Receives exactly @c len bytes of response. Bytes already buffered by the port are consumed
+   * without waiting, the remainder is collected incrementally as it arrives. Fails if the
+   * response is not complete within @c timeout_ms milliseconds. */
+  bool receive(char *data, qint64 len, int timeout_ms, const ErrorStack &err=ErrorStack());
+  /** Sends a request and receives a response of the given fixed size. */
+  bool transceive(const char *req, qint64 reqlen, char *resp, qint64 resplen, int timeout_ms,
+                  const ErrorStack &err=ErrorStack());
+  /** Discards any pending input, e.g., late responses after a failed pipelined transfer. */
+  void discardInput(int settle_ms=50);
+
+protected:
+  /** Derives the response timeout from the round-trip times observed by @c receive. */
+  TimingPolicy _timing;
+  /** The emulated radio, if a virtual device descriptor was passed. */
+  VirtualDevice *_virtual;
+  /** Records the session, if enabled. */
+  SessionRecorder *_recorder;
+  /** The original serial flags of the port or -1, if not changed. */
+  int _serialFlags;
+  /** The original latency timer of the USB-serial bridge, empty if not changed. */
+  QByteArray _latencyTimer;
+
+  /** If @c true, ports get opened in low-latency mode. */
+  static bool _lowLatency;
 };
 
 #endif // USBSERIAL_HH
@@ -5,10 +5,29 @@
 #include <QFile>
 #include <QDir>
 #include <QNetworkReply>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QLockFile>
+#include <QtEndian>
+#include <QSet>
+#include <QPair>
+#include <QRunnable>
 #include <algorithm>
 #include "logger.hh"
+#include "downloadvalidators.hh"
 #include <cmath>
 
+/** Magic number of the binary user DB cache. */
+#define CACHE_MAGIC            "QDMRUSR"
+/** Version of the binary user DB cache format, increment on every change. */
+#define CACHE_VERSION          1
+/** Size of the cache header: magic, version, number of users and size of the string pool. */
+#define CACHE_HEADER_SIZE      20
+/** Number of strings stored per user. */
+#define CACHE_STRINGS_PER_USER 7
+/** Size of the chunks, a user DB file gets parsed in. */
+#define READ_CHUNK_SIZE        0x10000
+
 
 /* ********************************************************************************************* *
  * Implementation of User
@@ -28,34 +47,262 @@ UserDatabase::User::User(const QJsonObject &obj)
   // pass...
 }
 
-unsigned
-UserDatabase::User::distance(unsigned id) const {
+/** Powers of 10 up to 10^10, covering all 32-bit IDs. */
+static const uint64_t pow10Table[11] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+  1000000000ULL, 10000000000ULL
+};
+
+/** Returns the number of decimal digits of @c a (at least 1). Branch-free to allow the batch
+ * distance computation to get vectorized. */
+static inline unsigned
+decimalDigits(uint64_t a) {
+  unsigned d = 1;
+  for (int k=1; k<11; k++)
+    d += (a >= pow10Table[k]);
+  return d;
+}
+
+/** Distance between two IDs with known digit counts. */
+static inline unsigned
+prefixDistance(uint64_t a, unsigned ad, uint64_t b, unsigned bd) {
   // Fix number of digits
-  int a = this->id, b = id;
-  int ad = std::ceil(std::log10(a));
-  int bd = std::ceil(std::log10(b));
-  if (ad > bd)
-    b *= std::pow(10u, (ad-bd));
-  else if (bd > ad)
-    a *= std::pow(10u, (bd-ad));
+  a *= pow10Table[(bd > ad) ? (bd-ad) : 0];
+  b *= pow10Table[(ad > bd) ? (ad-bd) : 0];
   // Distance is just the difference between these two numbers
   // this ensures a small distance between two numbers with the same
   // prefix.
-  return std::abs(a-b);
+  uint64_t d = (a > b) ? (a-b) : (b-a);
+  return (d > 0xffffffffULL) ? 0xffffffffU : unsigned(d);
 }
 
+unsigned
+UserDatabase::User::distance(unsigned id) const {
+  return prefixDistance(this->id, decimalDigits(this->id), id, decimalDigits(id));
+}
+
+
+/** Interns the highly repetitive location strings of the given user. Identical strings then share
+ * a single implicitly shared buffer instead of holding a separate copy for every user. */
+static void
+internUser(UserDatabase::User &user, QSet<QString> &pool) {
+  QString *strings[3] = { &user.city, &user.state, &user.country };
+  for (int i=0; i<3; i++) {
+    if (strings[i]->isEmpty()) {
+      *strings[i] = QString();
+      continue;
+    }
+    QSet<QString>::const_iterator item = pool.constFind(*strings[i]);
+    if (pool.constEnd() == item)
+      pool.insert(*strings[i]);
+    else
+      *strings[i] = *item;
+  }
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of UserDatabase::StreamParser
+ * ********************************************************************************************* */
+/** Minimal incremental scanner for the user JSON.
+ *
+ * The scanner only tracks strings and nesting to find the "users" array of the top-level object.
+ * Each element of that array is collected separately and decoded as soon as it is complete. Hence
+ * only a single user record is buffered at any time. */
+class UserDatabase::StreamParser
+{
+public:
+  /** Constructor. */
+  StreamParser()
+    : _depth(0), _inString(false), _escape(false), _arrayDepth(-1), _done(false),
+      _key(), _element(), _error(), _strings()
+  {
+    // pass...
+  }
+
+  /** Processes the next chunk of data. Returns @c false on error. */
+  bool feed(const char *data, qint64 n) {
+    for (qint64 i=0; i<n; i++) {
+      char c = data[i];
+      bool inElement = (_arrayDepth >= 0) && (_depth > _arrayDepth);
+      if (inElement)
+        _element.append(c);
+
+      if (_inString) {
+        if (_escape)
+          _escape = false;
+        else if ('\\' == c)
+          _escape = true;
+        else if ('"' == c)
+          _inString = false;
+        else if ((1 == _depth) && (_key.size() < 16))
+          _key.append(c);
+        continue;
+      }
+
+      switch (c) {
+      case '"':
+        _inString = true;
+        if (1 == _depth)
+          _key.clear();
+        break;
+      case '{':
+      case '[':
+        if ((1 == _depth) && ('[' == c) && ("users" == _key) && (! _done))
+          _arrayDepth = _depth+1;
+        _depth++;
+        if ((_arrayDepth >= 0) && (_depth == (_arrayDepth+1)) && (! inElement))
+          _element = QByteArray(1, c);
+        break;
+      case '}':
+      case ']':
+        if (0 == _depth) {
+          _error = "Unbalanced brackets.";
+          return false;
+        }
+        _depth--;
+        if ((_arrayDepth >= 0) && (_depth == _arrayDepth) && inElement) {
+          if (! decodeElement())
+            return false;
+        } else if ((_arrayDepth >= 0) && (_depth == (_arrayDepth-1))) {
+          _arrayDepth = -1;
+          _done = true;
+        }
+        break;
+      default:
+        break;
+      }
+    }
+    return true;
+  }
+
+  /** Returns @c true if the "users" array has been parsed completely. */
+  bool isComplete() const {
+    return _done && (0 == _depth) && (! _inString);
+  }
+  /** Returns the last error message. */
+  const QString &errorMessage() const {
+    return _error;
+  }
+
+  /** Parsed users. */
+  QVector<User> users;
+
+protected:
+  /** Decodes a single, complete element of the users array. */
+  bool decodeElement() {
+    QJsonParseError err;
+    QJsonDocument doc = QJsonDocument::fromJson(_element, &err);
+    _element.clear();
+    if (QJsonParseError::NoError != err.error) {
+      _error = err.errorString();
+      return false;
+    }
+    if (! doc.isObject())
+      return true;
+    User user(doc.object());
+    if (! user.isValid())
+      return true;
+    internUser(user, _strings);
+    users.append(user);
+    return true;
+  }
+
+protected:
+  /** Current nesting level. */
+  int _depth;
+  /** If @c true, the scanner is within a string. */
+  bool _inString;
+  /** If @c true, the next character is escaped. */
+  bool _escape;
+  /** Nesting level of the users array or -1 if not within the array. */
+  int _arrayDepth;
+  /** Set, once the users array has been closed. */
+  bool _done;
+  /** The last string found within the top-level object. */
+  QByteArray _key;
+  /** Buffer of the current array element. */
+  QByteArray _element;
+  /** The last error message. */
+  QString _error;
+  /** Pool of interned strings. */
+  QSet<QString> _strings;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of UserDatabase::Loader
+ * ********************************************************************************************* */
+/** Reads the user database on a worker thread.
+ *
+ * The complete table including the indices is assembled by the worker and then handed over to
+ * the thread of the database, where it gets installed at once. */
+class UserDatabase::Loader: public QRunnable
+{
+public:
+  Loader(UserDatabase *database, const QString &filename, unsigned generation, int updatePeriodDays)
+    : QRunnable(), _database(database), _filename(filename), _generation(generation),
+      _updatePeriodDays(updatePeriodDays)
+  {
+    // pass...
+  }
+
+  void run() {
+    Table table; QString msg;
+    bool ok = UserDatabase::readTable(_filename, table, msg);
+    // The database waits for all loaders before it gets destroyed. Pending calls are discarded
+    // together with the object.
+    UserDatabase *database = _database;
+    unsigned generation = _generation;
+    int updatePeriodDays = _updatePeriodDays;
+    QMetaObject::invokeMethod(database, [database, table, generation, ok, msg, updatePeriodDays]() mutable {
+      database->onLoaded(table, generation, ok, msg, updatePeriodDays);
+    }, Qt::QueuedConnection);
+  }
+
+protected:
+  UserDatabase *_database;
+  QString _filename;
+  unsigned _generation;
+  int _updatePeriodDays;
+};
+
 
 /* ********************************************************************************************* *
  * Implementation of UserDatabase
  * ********************************************************************************************* */
-UserDatabase::UserDatabase(unsigned updatePeriodDays, QObject *parent)
-  : QAbstractTableModel(parent), _user(), _network()
+UserDatabase::UserDatabase(unsigned updatePeriodDays, QObject *parent, bool background)
+  : QAbstractTableModel(parent), _user(), _idIndex(), _callIndex(), _countryIndex(),
+    _countryIndexValid(false), _network(), _downloadFile(nullptr), _downloadParser(nullptr),
+    _downloadLock(nullptr), _loading(false), _generation(0), _loader()
 {
+  _loader.setMaxThreadCount(1);
   connect(&_network, SIGNAL(finished(QNetworkReply*)),
           this, SLOT(downloadFinished(QNetworkReply*)));
 
-  if ((! load()) || (updatePeriodDays < dbAge()))
+  if (background) {
+    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    loadInBackground(path+"/user.json", updatePeriodDays);
+  } else if ((! load()) || (updatePeriodDays < dbAge())) {
     download();
+  }
+}
+
+UserDatabase::UserDatabase(const QString &filename, QObject *parent)
+  : QAbstractTableModel(parent), _user(), _idIndex(), _callIndex(), _countryIndex(),
+    _countryIndexValid(false), _network(), _downloadFile(nullptr), _downloadParser(nullptr),
+    _downloadLock(nullptr), _loading(false), _generation(0), _loader()
+{
+  _loader.setMaxThreadCount(1);
+  connect(&_network, SIGNAL(finished(QNetworkReply*)),
+          this, SLOT(downloadFinished(QNetworkReply*)));
+  load(filename);
+}
+
+UserDatabase::~UserDatabase() {
+  // Loaders refer to this database
+  _loader.waitForDone();
+  resetDownload();
 }
 
 qint64
@@ -74,131 +321,548 @@ UserDatabase::user(int idx) const {
   return _user[idx];
 }
 
+int
+UserDatabase::findUser(unsigned id) const {
+  QVector<int>::const_iterator item = std::lower_bound(
+        _idIndex.begin(), _idIndex.end(), id, [this](int idx, unsigned id) {
+    return _user[idx].id < id;
+  });
+  if ((_idIndex.end() == item) || (_user[*item].id != id))
+    return -1;
+  return *item;
+}
+
+int
+UserDatabase::findCallsign(const QString &call) const {
+  return _callIndex.value(call.toUpper(), -1);
+}
+
+QVector<int>
+UserDatabase::usersWithPrefix(unsigned prefix) const {
+  // The IDs starting with the prefix form one contiguous range for every possible number of
+  // trailing digits. Collect all ranges and merge them in order of the IDs.
+  QVector<int> result;
+  uint64_t lower = prefix, upper = uint64_t(prefix)+1;
+  while (lower <= 0xffffffffULL) {
+    QVector<int>::const_iterator first = std::lower_bound(
+          _idIndex.begin(), _idIndex.end(), lower, [this](int idx, uint64_t id) {
+      return _user[idx].id < id;
+    });
+    QVector<int>::const_iterator last = std::lower_bound(
+          first, _idIndex.end(), upper, [this](int idx, uint64_t id) {
+      return _user[idx].id < id;
+    });
+    for (; first != last; first++)
+      result.append(*first);
+    if (0 == prefix)
+      break;
+    lower *= 10; upper *= 10;
+  }
+  std::sort(result.begin(), result.end(), [this](int a, int b) { return _user[a].id < _user[b].id; });
+  return result;
+}
+
+QVector<int>
+UserDatabase::usersInCountry(const QString &country, const QString &state) const {
+  QMutexLocker locker(&_countryIndexLock);
+  if (! _countryIndexValid) {
+    _countryIndex.clear();
+    // Iterate in ID order, such that every list is sorted by ID
+    foreach (int idx, _idIndex)
+      _countryIndex[_user[idx].country.toUpper()].append(idx);
+    _countryIndexValid = true;
+  }
+
+  QVector<int> users = _countryIndex.value(country.toUpper());
+  locker.unlock();
+  if (state.isEmpty())
+    return users;
+  QVector<int> result;
+  foreach (int idx, users) {
+    if (0 == _user[idx].state.compare(state, Qt::CaseInsensitive))
+      result.append(idx);
+  }
+  return result;
+}
+
+void
+UserDatabase::rebuildIndex() {
+  buildIndex(_user, _idIndex, _callIndex);
+  _countryIndex.clear();
+  _countryIndexValid = false;
+}
+
+void
+UserDatabase::buildIndex(const QVector<User> &users, QVector<int> &idIndex, QHash<QString, int> &callIndex) {
+  idIndex.resize(users.size());
+  for (int i=0; i<users.size(); i++)
+    idIndex[i] = i;
+  std::stable_sort(idIndex.begin(), idIndex.end(), [&users](int a, int b) {
+    return users[a].id < users[b].id;
+  });
+
+  callIndex.clear();
+  callIndex.reserve(users.size());
+  // Insert in reverse ID order, such that the user with the lowest ID wins.
+  for (int i=idIndex.size()-1; i>=0; i--)
+    callIndex.insert(users[idIndex[i]].call.toUpper(), idIndex[i]);
+}
+
 bool
 UserDatabase::load(const QString &filename) {
-  QFile file(filename);
-  if (! file.open(QIODevice::ReadOnly)) {
-    QString msg = QString("Cannot open user list '%1': %2").arg(filename).arg(file.errorString());
-    logError() << msg;
+  Table table; QString msg;
+  // Any pending background load is outdated now
+  _generation++; _loading = false;
+  if (! readTable(filename, table, msg)) {
     emit error(msg);
     return false;
   }
-  QByteArray data = file.readAll();
-  file.close();
+  install(table);
+  emit loaded();
+  return true;
+}
 
-  QJsonParseError err;
-  QJsonDocument doc = QJsonDocument::fromJson(data, &err);
-  if (doc.isEmpty()) {
-    QString msg = "Failed to load user DB: " + err.errorString();
-    logError() << msg;
+bool
+UserDatabase::isLoading() const {
+  return _loading;
+}
+
+void
+UserDatabase::loadInBackground(const QString &filename, int updatePeriodDays) {
+  _loading = true;
+  _loader.start(new Loader(this, filename, ++_generation, updatePeriodDays));
+}
+
+void
+UserDatabase::onLoaded(Table &table, unsigned generation, bool ok, const QString &msg, int updatePeriodDays) {
+  // Result of an outdated load, the database has been loaded or updated since.
+  if (generation != _generation)
+    return;
+
+  _loading = false;
+  if (ok) {
+    install(table);
+    emit loaded();
+  } else {
     emit error(msg);
-    return false;
   }
 
-  if (! doc.isObject()) {
-    QString msg = "Failed to load user DB: JSON document is not an object!";
+  if ((updatePeriodDays >= 0) && ((! ok) || (unsigned(updatePeriodDays) < dbAge())))
+    download();
+}
+
+void
+UserDatabase::install(Table &table) {
+  beginResetModel();
+  _user.swap(table.users);
+  _idIndex.swap(table.idIndex);
+  _callIndex.swap(table.callIndex);
+  _countryIndex.clear();
+  _countryIndexValid = false;
+  endResetModel();
+}
+
+bool
+UserDatabase::readTable(const QString &filename, Table &table, QString &msg) {
+  if (loadCache(cacheFilename(filename), table)) {
+    buildIndex(table.users, table.idIndex, table.callIndex);
+    logDebug() << "Loaded user database with " << table.users.size() << " entries from cache "
+               << cacheFilename(filename) << ".";
+    return true;
+  }
+
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    msg = QString("Cannot open user list '%1': %2").arg(filename).arg(file.errorString());
     logError() << msg;
-    emit error(msg);
     return false;
   }
-  if (! doc.object().contains("users")) {
-    QString msg = "Failed to load user DB: JSON object does not contain 'users' item.";
+
+  // Parse the file in chunks like a download. Neither the file content nor a JSON document of
+  // all users is held in memory, only the decoded users.
+  StreamParser parser;
+  char buffer[READ_CHUNK_SIZE];
+  for (qint64 n=file.read(buffer, sizeof(buffer)); n>0; n=file.read(buffer, sizeof(buffer))) {
+    if (! parser.feed(buffer, n)) {
+      msg = "Failed to load user DB: " + parser.errorMessage();
+      logError() << msg;
+      return false;
+    }
+  }
+  file.close();
+
+  if (! parser.isComplete()) {
+    msg = "Failed to load user DB: JSON object does not contain a complete 'users' array.";
     logError() << msg;
-    emit error(msg);
     return false;
   }
-  if (! doc.object()["users"].isArray()) {
-    QString msg = "Failed to load user DB: 'users' item is not an array.";
-    logError() << msg;
-    emit error(msg);
+
+  table.users.swap(parser.users);
+  // Sort repeater w.r.t. their IDs
+  std::stable_sort(table.users.begin(), table.users.end(), [](const User &a, const User &b){ return a.id < b.id; });
+  // Done.
+  buildIndex(table.users, table.idIndex, table.callIndex);
+
+  logDebug() << "Loaded user database with " << table.users.size() << " entries from " << filename << ".";
+
+  if (! writeCache(cacheFilename(filename), table.users))
+    logWarn() << "Cannot write user database cache " << cacheFilename(filename) << ".";
+
+  return true;
+}
+
+QString
+UserDatabase::cacheFilename(const QString &filename) {
+  QFileInfo info(filename);
+  return info.absoluteDir().filePath(info.completeBaseName() + ".cache");
+}
+
+bool
+UserDatabase::loadCache(const QString &filename, Table &table) {
+  QFileInfo info(filename);
+  if ((! info.exists()) || (info.size() < CACHE_HEADER_SIZE))
+    return false;
+
+  // Cache is outdated, if the JSON file has been modified since
+  QString json = info.absoluteDir().filePath(info.completeBaseName() + ".json");
+  if (QFileInfo::exists(json) && (QFileInfo(json).lastModified() > info.lastModified()))
+    return false;
+
+  // Read-only mapping, shares the page cache with all other processes using the cache
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly))
+    return false;
+  const uchar *data = file.map(0, file.size());
+  if (nullptr == data)
+    return false;
+
+  qint64 size = file.size();
+  if ((0 != memcmp(data, CACHE_MAGIC, 8)) || (CACHE_VERSION != qFromLittleEndian<quint32>(data+8))) {
+    logDebug() << "Ignore user database cache " << filename << ": Unknown format.";
     return false;
   }
 
-  beginResetModel();
-  _user.clear();
+  quint32 count = qFromLittleEndian<quint32>(data+12);
+  quint32 poolSize = qFromLittleEndian<quint32>(data+16);
+  qint64 offsetsSize = (qint64(count)*CACHE_STRINGS_PER_USER + 1)*4;
+  if (size != (CACHE_HEADER_SIZE + qint64(count)*4 + offsetsSize + poolSize)) {
+    logDebug() << "Ignore user database cache " << filename << ": Size mismatch.";
+    return false;
+  }
 
-  QJsonArray array = doc.object()["users"].toArray();
-  _user.reserve(array.size());
-  for (int i=0; i<array.size(); i++) {
-    User user(array.at(i).toObject());
-    if (user.isValid())
-      _user.append(user);
+  const uchar *ids = data + CACHE_HEADER_SIZE;
+  const uchar *offsets = ids + qint64(count)*4;
+  const char *pool = reinterpret_cast<const char *>(offsets + offsetsSize);
+
+  // Check string offsets once, to avoid any checks within the loop below
+  quint32 last = 0;
+  for (quint32 i=0; i<=count*CACHE_STRINGS_PER_USER; i++) {
+    quint32 offset = qFromLittleEndian<quint32>(offsets + 4*i);
+    if ((offset < last) || (offset > poolSize)) {
+      logDebug() << "Ignore user database cache " << filename << ": Invalid string offset.";
+      return false;
+    }
+    last = offset;
   }
-  // Sort repeater w.r.t. their IDs
-  std::stable_sort(_user.begin(), _user.end(), [](const User &a, const User &b){ return a.id < b.id; });
-  // Done.
-  endResetModel();
 
-  logDebug() << "Loaded user database with " << _user.size() << " entries from " << filename << ".";
+  QSet<QString> interned;
+  table.users.clear();
+  table.users.resize(count);
+  for (quint32 i=0; i<count; i++) {
+    User &user = table.users[i];
+    QString *strings[CACHE_STRINGS_PER_USER] = {
+      &user.call, &user.name, &user.surname, &user.city, &user.state, &user.country, &user.comment
+    };
+    user.id = qFromLittleEndian<quint32>(ids + 4*i);
+    const uchar *off = offsets + 4*CACHE_STRINGS_PER_USER*i;
+    for (int j=0; j<CACHE_STRINGS_PER_USER; j++) {
+      quint32 start = qFromLittleEndian<quint32>(off + 4*j), end=qFromLittleEndian<quint32>(off + 4*j + 4);
+      if (end > start)
+        *strings[j] = QString::fromUtf8(pool + start, end-start);
+    }
+    internUser(user, interned);
+  }
 
-  emit loaded();
+  file.unmap(const_cast<uchar *>(data));
   return true;
 }
 
+bool
+UserDatabase::writeCache(const QString &filename, const QVector<User> &users) {
+  QByteArray ids, offsets, pool;
+  ids.reserve(users.size()*4);
+  offsets.reserve((users.size()*CACHE_STRINGS_PER_USER+1)*4);
+
+  uchar buffer[4];
+  foreach (const User &user, users) {
+    const QString *strings[CACHE_STRINGS_PER_USER] = {
+      &user.call, &user.name, &user.surname, &user.city, &user.state, &user.country, &user.comment
+    };
+    qToLittleEndian<quint32>(user.id, buffer);
+    ids.append(reinterpret_cast<const char *>(buffer), 4);
+    for (int j=0; j<CACHE_STRINGS_PER_USER; j++) {
+      qToLittleEndian<quint32>(pool.size(), buffer);
+      offsets.append(reinterpret_cast<const char *>(buffer), 4);
+      pool.append(strings[j]->toUtf8());
+    }
+  }
+  qToLittleEndian<quint32>(pool.size(), buffer);
+  offsets.append(reinterpret_cast<const char *>(buffer), 4);
+
+  QByteArray header(CACHE_HEADER_SIZE, 0);
+  memcpy(header.data(), CACHE_MAGIC, 8);
+  qToLittleEndian<quint32>(CACHE_VERSION, header.data()+8);
+  qToLittleEndian<quint32>(users.size(), header.data()+12);
+  qToLittleEndian<quint32>(pool.size(), header.data()+16);
+
+  QSaveFile file(filename);
+  if (! file.open(QIODevice::WriteOnly))
+    return false;
+  file.write(header);
+  file.write(ids);
+  file.write(offsets);
+  file.write(pool);
+  return file.commit();
+}
+
 void
-UserDatabase::sortUsers(unsigned id) {
-  // Sort repeater w.r.t. distance to ID
-  std::stable_sort(_user.begin(), _user.end(), [id](const User &a, const User &b){
-    return a.distance(id) < b.distance(id);
-  });
+UserDatabase::sortUsers(unsigned id, int limit) {
+  sortUsers(QSet<unsigned>{id}, limit);
 }
 
 void
-UserDatabase::sortUsers(const QSet<unsigned> &ids) {
+UserDatabase::sortUsers(const QSet<unsigned> &ids, int limit) {
   if (0 == ids.count())
     return;
 
-  // Sort repeater w.r.t. distance to each ID
-  std::stable_sort(_user.begin(), _user.end(), [ids](const User &a, const User &b){
-    QSet<unsigned>::const_iterator id=ids.begin();
-    unsigned min_a = a.distance(*id), min_b = b.distance(*id);
-    id++;
-    for (; id!=ids.end(); id++) {
-      min_a = std::min(min_a, a.distance(*id));
-      min_b = std::min(min_b, b.distance(*id));
-    }
-    return min_a < min_b;
-  });
+  QVector<int> order = selectUsers(ids, ((limit < 0) || (limit > _user.size())) ? _user.size() : limit);
+
+  // Selected users first, then all remaining users in their original order
+  QVector<bool> selected(_user.size(), false);
+  QVector<User> sorted; sorted.reserve(_user.size());
+  foreach (int idx, order) {
+    selected[idx] = true;
+    sorted.append(_user[idx]);
+  }
+  for (int i=0; i<_user.size(); i++) {
+    if (! selected[i])
+      sorted.append(_user[i]);
+  }
+  _user.swap(sorted);
+  rebuildIndex();
+}
+
+void
+UserDatabase::distances(unsigned *dist, const unsigned *ids, size_t n, const QVector<unsigned> &refs) {
+  for (size_t i=0; i<n; i++)
+    dist[i] = 0xffffffffU;
+  // Reference loop outside, such that the inner loop over all IDs is branch-free.
+  foreach (unsigned ref, refs) {
+    unsigned refDigits = decimalDigits(ref);
+    for (size_t i=0; i<n; i++)
+      dist[i] = std::min(dist[i], prefixDistance(ids[i], decimalDigits(ids[i]), ref, refDigits));
+  }
+}
+
+QVector<int>
+UserDatabase::selectUsers(const QSet<unsigned> &ids, int k) const {
+  k = std::max(0, std::min(k, int(_user.size())));
+  if (ids.isEmpty()) {
+    QVector<int> order(k);
+    for (int i=0; i<k; i++)
+      order[i] = i;
+    return order;
+  }
+
+  // Compute the minimum distance once per user. The index is part of the key, this keeps the
+  // order of users with the same distance (like a stable sort) while allowing for partial sorting.
+  QVector<unsigned> column(_user.size()), dist(_user.size());
+  for (int i=0; i<_user.size(); i++)
+    column[i] = _user[i].id;
+  distances(dist.data(), column.constData(), column.size(), ids.values().toVector());
+
+  QVector<QPair<unsigned, int>> keys(_user.size());
+  for (int i=0; i<_user.size(); i++)
+    keys[i] = QPair<unsigned, int>(dist[i], i);
+
+  if (k < keys.size())
+    std::nth_element(keys.begin(), keys.begin()+k, keys.end());
+  std::sort(keys.begin(), keys.begin()+k);
+
+  QVector<int> order(k);
+  for (int i=0; i<k; i++)
+    order[i] = keys[i].second;
+  return order;
 }
 
 void
 UserDatabase::download() {
+  resetDownload();
+
+  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  QDir directory;
+  if ((! directory.exists(path)) && (!directory.mkpath(path))) {
+    QString msg = QString("Cannot create path '%1'.").arg(path);
+    logError() << msg;
+    emit error(msg);
+    return;
+  }
+
+  // Another process may refresh the database right now. The JSON file and cache are replaced
+  // atomically once it is done, hence just keep the current state.
+  _downloadLock = new QLockFile(path+"/user.json.lock");
+  _downloadLock->setStaleLockTime(0);
+  if (! _downloadLock->tryLock(0)) {
+    logInfo() << "User database is being updated by another process, skip download.";
+    resetDownload();
+    return;
+  }
+
+  _downloadFile = new QSaveFile(path+"/user.json");
+  if (! _downloadFile->open(QIODevice::WriteOnly)) {
+    QString msg = QString("Cannot save user database at '%1'.").arg(path+"/user.json");
+    logError() << msg;
+    emit error(msg);
+    resetDownload();
+    return;
+  }
+  _downloadParser = new StreamParser();
+
   QUrl url("https://database.radioid.net/static/users.json");
   QNetworkRequest request(url);
-  _network.get(request);
+  // Only revalidate the present copy, if it could be loaded. Otherwise, download it again.
+  if ((! _user.isEmpty()) && DownloadValidators(path+"/user.json").prepare(request))
+    logDebug() << "Check if user database changed since last download.";
+  QNetworkReply *reply = _network.get(request);
+  connect(reply, SIGNAL(readyRead()), this, SLOT(downloadReadyRead()));
+}
+
+void
+UserDatabase::downloadReadyRead() {
+  QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+  if ((nullptr == reply) || (nullptr == _downloadFile))
+    return;
+  if (! processDownload(reply))
+    reply->abort();
+}
+
+bool
+UserDatabase::processDownload(QNetworkReply *reply) {
+  char buffer[0x10000];
+  while (reply->bytesAvailable()) {
+    qint64 n = reply->read(buffer, sizeof(buffer));
+    if (n <= 0)
+      break;
+    if (n != _downloadFile->write(buffer, n)) {
+      logError() << "Cannot write user database: " << _downloadFile->errorString();
+      _downloadFile->cancelWriting();
+      return false;
+    }
+    // A parser error is not fatal, the file gets parsed again once complete.
+    if (_downloadParser && (! _downloadParser->feed(buffer, n))) {
+      logWarn() << "Cannot parse user database stream: " << _downloadParser->errorMessage();
+      delete _downloadParser;
+      _downloadParser = nullptr;
+    }
+  }
+  return true;
+}
+
+void
+UserDatabase::resetDownload() {
+  if (_downloadFile)
+    delete _downloadFile;
+  _downloadFile = nullptr;
+  if (_downloadParser)
+    delete _downloadParser;
+  _downloadParser = nullptr;
+  if (_downloadLock)
+    delete _downloadLock;
+  _downloadLock = nullptr;
 }
 
 void
 UserDatabase::downloadFinished(QNetworkReply *reply) {
+  reply->deleteLater();
+
   if (reply->error()) {
     QString msg = QString("Cannot download user database: %1").arg(reply->errorString());
     logError() << msg;
     emit error(msg);
+    resetDownload();
     return;
   }
 
-  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-  QFile file(path+"/user.json");
-  QDir directory;
-  if ((! directory.exists(path)) && (!directory.mkpath(path))) {
-    QString msg = QString("Cannot create path '%1'.").arg(path);
-    logError() << msg;
-    emit error(msg);
+  if (_downloadFile && DownloadValidators::notModified(reply)) {
+    // Keep the present copy, the empty reply must not replace it
+    QString filename = _downloadFile->fileName();
+    _downloadFile->cancelWriting();
+    logInfo() << "User database not modified since last download.";
+    DownloadValidators(filename).touch({cacheFilename(filename)});
+    resetDownload();
     return;
   }
-  if (! file.open(QIODevice::WriteOnly)) {
-    QString msg = QString("Cannot save user database at '%1'.").arg(path+"/user.json");
+
+  if ((nullptr == _downloadFile) || (! processDownload(reply)) || (! _downloadFile->commit())) {
+    QString msg = QString("Cannot save user database.");
     logError() << msg;
     emit error(msg);
+    resetDownload();
     return;
   }
 
-  file.write(reply->readAll());
-  file.flush();
-  file.close();
+  QString filename = _downloadFile->fileName();
+  DownloadValidators(filename).store(reply);
+  if ((nullptr == _downloadParser) || (! _downloadParser->isComplete())) {
+    // Stream could not be parsed, fall back to parse the saved file
+    load(filename);
+    resetDownload();
+    return;
+  }
 
-  load();
-  reply->deleteLater();
+  // Any pending background load is outdated now
+  _generation++; _loading = false;
+  beginResetModel();
+  _user.swap(_downloadParser->users);
+  std::stable_sort(_user.begin(), _user.end(), [](const User &a, const User &b){ return a.id < b.id; });
+  rebuildIndex();
+  endResetModel();
+
+  logDebug() << "Loaded user database with " << _user.size() << " entries from download.";
+  if (! writeCache(cacheFilename(filename), _user))
+    logWarn() << "Cannot write user database cache " << cacheFilename(filename) << ".";
+  // Release lock only after the cache got replaced
+  resetDownload();
+
+  emit loaded();
+}
+
+MemoryUsage
+UserDatabase::memoryUsage() const {
+  MemoryUsage usage("User database", sizeof(*this));
+
+  quint64 users = MemoryUsage::of(_user);
+  foreach (const User &user, _user) {
+    users += MemoryUsage::of(user.call) + MemoryUsage::of(user.name) + MemoryUsage::of(user.surname)
+        + MemoryUsage::of(user.city) + MemoryUsage::of(user.state) + MemoryUsage::of(user.country)
+        + MemoryUsage::of(user.comment);
+  }
+  usage.add(MemoryUsage("Users", users, _user.size()));
+
+  usage.add(MemoryUsage("ID index", MemoryUsage::of(_idIndex), _idIndex.size()));
+
+  quint64 calls = MemoryUsage::of(_callIndex);
+  for (QHash<QString, int>::const_iterator it=_callIndex.begin(); it!=_callIndex.end(); it++)
+    calls += MemoryUsage::of(it.key());
+  usage.add(MemoryUsage("Callsign index", calls, _callIndex.size()));
+
+  QMutexLocker locker(&_countryIndexLock);
+  quint64 countries = MemoryUsage::of(_countryIndex);
+  for (QHash<QString, QVector<int>>::const_iterator it=_countryIndex.begin(); it!=_countryIndex.end(); it++)
+    countries += MemoryUsage::of(it.key()) + MemoryUsage::of(it.value());
+  usage.add(MemoryUsage("Country index", countries, _countryIndex.size()));
+
+  return usage;
 }
 
 unsigned
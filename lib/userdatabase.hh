@@ -9,15 +9,36 @@
 #include <QAbstractTableModel>
 #include <QSortFilterProxyModel>
 #include <QGeoPositionInfoSource>
+#include <QThreadPool>
+#include <QMutex>
+
+#include "memoryusage.hh"
+
+class QSaveFile;
+class QLockFile;
+class QNetworkReply;
 
 /** Auto-updating DMR user database.
  *
  * This class represents the complete DMR user database. The user database gets downloaded from
  * https://www.radioid.net/static/users.json and kept up-to-date by re-downloading it
- * periodically (by default every 30 days). This user database gets used in the GUI application
+ * periodically (by default every 30 days). The refresh is conditional (see @c DownloadValidators),
+ * hence an unchanged database is not transferred again. This user database gets used in the GUI application
  * to help assemble private call contacts and to assemble so-called CSV callsign databases, that
  * are programmable to some DMR radios to resolve the DMR ID to callsigns and names.
  *
+ * Parsing the JSON file is slow. Hence, after each successful parse, a compact binary cache is
+ * written next to the JSON file. This cache holds the sorted ID column and a pool of all strings.
+ * As long as the cache is not older than the JSON file, it gets memory-mapped instead of parsing
+ * the JSON file again.
+ *
+ * The download is parsed incrementally while it arrives. Each chunk is written to the JSON file
+ * and each complete user record gets decoded immediately. Hence, the entire download is never
+ * held in memory.
+ *
+ * The city, state and country of the users are very repetitive. These strings get interned while
+ * loading, such that all users share a single copy of each distinct string.
+ *
  * @ingroup util */
 class UserDatabase : public QAbstractTableModel
 {
@@ -35,7 +56,9 @@ public:
     /** Returns @c true if the entry is valid. */
     inline bool isValid() const { return 0 != id; }
 
-    /** Returns the "distance" between this user and the given ID. */
+    /** Returns the "distance" between this user and the given ID. The shorter ID gets padded
+     * with zeros to the number of digits of the longer one. Hence, IDs sharing a prefix have a
+     * small distance. */
     unsigned distance(unsigned id) const;
 
     /** The DMR ID of the user. */
@@ -59,8 +82,14 @@ public:
 public:
   /** Constructs the user-database.
    * The constructor will download the current user database if it was not downloaded yet or
-   * if the downloaded version is older than @c updatePeriodDays days. */
-  explicit UserDatabase(unsigned updatePeriodDays=30, QObject *parent=nullptr);
+   * if the downloaded version is older than @c updatePeriodDays days. If @c background is
+   * @c true, the database is loaded on a worker thread and the constructor returns immediately.
+   * The database is empty until @c loaded gets emitted then. */
+  explicit UserDatabase(unsigned updatePeriodDays=30, QObject *parent=nullptr, bool background=false);
+  /** Constructs the user-database from the given file, without any download. */
+  explicit UserDatabase(const QString &filename, QObject *parent=nullptr);
+  /** Destructor. */
+  virtual ~UserDatabase();
 
   /** Returns the number of users. */
   qint64 count() const;
@@ -69,18 +98,52 @@ public:
   bool load();
   /** Loads all entries from the downloaded user database at the specified location. */
   bool load(const QString &filename);
-
-  /** Sorts users with respect to the distance to the given ID. */
-  void sortUsers(unsigned id);
-  /** Sorts users with respect to the minimum distance to the given IDs. */
-  void sortUsers(const QSet<unsigned> &ids);
+  /** Loads all entries from the user database at the specified location on a worker thread.
+   * The loaded users replace the current ones at once, once the loading is complete. If
+   * @c updatePeriodDays is non-negative, the database gets downloaded afterwards, if it could
+   * not be loaded or is older than the given number of days. */
+  void loadInBackground(const QString &filename, int updatePeriodDays=-1);
+  /** Returns @c true, while the database is loaded in the background. */
+  bool isLoading() const;
+
+  /** Sorts users with respect to the distance to the given ID.
+   * If @c limit is non-negative, only the first @c limit users are guaranteed to be in order. */
+  void sortUsers(unsigned id, int limit=-1);
+  /** Sorts users with respect to the minimum distance to the given IDs.
+   * If @c limit is non-negative, only the first @c limit users are guaranteed to be in order, the
+   * remaining users keep their relative order. This is sufficient for the callsign DB encoders
+   * and turns the sort into a linear-time selection. */
+  void sortUsers(const QSet<unsigned> &ids, int limit=-1);
+  /** Returns the indices of the (at most) @c k users closest to any of the given IDs, in
+   * ascending order of their distance. The users themselves are not reordered. */
+  QVector<int> selectUsers(const QSet<unsigned> &ids, int k) const;
+  /** Computes the minimum distance (see @c User::distance) of each of the @c n @c ids to any of
+   * the reference IDs @c refs. The results are stored in @c dist. */
+  static void distances(unsigned *dist, const unsigned *ids, size_t n, const QVector<unsigned> &refs);
 
   /** Returns the user with index @c idx. */
   const User &user(int idx) const;
 
+  /** Returns the index of the user with the given DMR ID or -1 if there is no such user.
+   * The lookup uses the ID index and takes O(log n). */
+  int findUser(unsigned id) const;
+  /** Returns the index of the user with the given callsign (case insensitive) or -1 if there is
+   * no such user. If several users share the callsign, the one with the lowest ID is returned. */
+  int findCallsign(const QString &call) const;
+  /** Returns the indices of all users whose DMR ID starts with the given decimal prefix, e.g.,
+   * all users 2621xxx for prefix 2621. The indices are ordered by ascending ID. */
+  QVector<int> usersWithPrefix(unsigned prefix) const;
+  /** Returns the indices of all users of the given country (case insensitive). If a @c state is
+   * given, only the users of that state are returned. The indices are ordered by ascending ID.
+   * The country index is built on first use. */
+  QVector<int> usersInCountry(const QString &country, const QString &state=QString()) const;
+
   /** Returns the age of the database in days. */
   unsigned dbAge() const;
 
+  /** Returns an estimate of the heap memory held by the users and the indices. */
+  MemoryUsage memoryUsage() const;
+
   /** Implements the QAbstractTableModel interface, returns the number of rows (number of entries). */
   int rowCount(const QModelIndex &parent=QModelIndex()) const;
   /** Implements the QAbstractTableModel interface, returns the number of columns. */
@@ -101,12 +164,79 @@ public slots:
 private slots:
   /** Gets called whenever the download is complete. */
   void downloadFinished(QNetworkReply *reply);
+  /** Gets called whenever a chunk of the download arrived. */
+  void downloadReadyRead();
+
+private:
+  /** The users together with their indices, assembled before they get installed. */
+  struct Table {
+    /** All users sorted by their ID. */
+    QVector<User> users;
+    /** Indices of all users, sorted by their ID. */
+    QVector<int> idIndex;
+    /** Maps upper-case callsigns to user indices. */
+    QHash<QString, int> callIndex;
+  };
+
+  /** Reads the users from the cache or the given JSON file into the given table. Does not touch
+   * the database itself, hence it can be called from any thread. */
+  static bool readTable(const QString &filename, Table &table, QString &msg);
+  /** Replaces the current users by the given table. */
+  void install(Table &table);
+  /** Gets called in the thread of the database, once a background load completed. */
+  void onLoaded(Table &table, unsigned generation, bool ok, const QString &msg, int updatePeriodDays);
+  /** Loads the users from the binary cache file. Returns @c false if the cache is missing,
+   * outdated or invalid. */
+  static bool loadCache(const QString &filename, Table &table);
+  /** Writes the given users into the binary cache file. */
+  static bool writeCache(const QString &filename, const QVector<User> &users);
+  /** Returns the path of the binary cache file for the given JSON file. */
+  static QString cacheFilename(const QString &filename);
+  /** Writes and parses the available data of the download. */
+  bool processDownload(QNetworkReply *reply);
+  /** Discards the current download state. */
+  void resetDownload();
+
+  /** Rebuilds the ID and callsign indices, must be called whenever the users change. */
+  void rebuildIndex();
+  /** Builds the ID and callsign indices for the given users. */
+  static void buildIndex(const QVector<User> &users, QVector<int> &idIndex, QHash<QString, int> &callIndex);
+
+  /** Incremental parser for the user JSON. */
+  class StreamParser;
+  /** Loads the database on a worker thread. */
+  class Loader;
 
 private:
   /** Holds all users sorted by their ID. */
   QVector<User>         _user;
+  /** Indices of all users, sorted by their ID. */
+  QVector<int>          _idIndex;
+  /** Maps upper-case callsigns to user indices. */
+  QHash<QString, int>   _callIndex;
+  /** Maps upper-case countries to the indices of their users, sorted by ID. Built on demand. */
+  mutable QHash<QString, QVector<int>> _countryIndex;
+  /** If @c true, the country index is built. */
+  mutable bool _countryIndexValid;
+  /** Guards building the country index, the database may be shared by concurrent encoders. */
+  mutable QMutex _countryIndexLock;
   /** The network access used for downloading. */
   QNetworkAccessManager _network;
+  /** The file the current download is written to. */
+  QSaveFile *_downloadFile;
+  /** The parser of the current download. */
+  StreamParser *_downloadParser;
+  /** Lock held while refreshing the database, prevents concurrent downloads by several
+   * processes. */
+  QLockFile *_downloadLock;
+  /** If @c true, the database is loaded in the background. */
+  bool _loading;
+  /** Incremented whenever the users get replaced. Results of older background loads are
+   * discarded. */
+  unsigned _generation;
+  /** Runs the background loads. Declared last, hence it waits for all loads before any other
+   * member gets destroyed. */
+  QThreadPool _loader;
 };
 
 
@@ -1,8 +1,13 @@
 #include "utils.hh"
+#include "stringpool.hh"
 #include <QRegExp>
 #include <QVector>
 #include <QHash>
+#include <QVarLengthArray>
+#include <QMutex>
+#include <QMutexLocker>
 #include <cmath>
+#include <QtEndian>
 #include <QRegularExpression>
 #include <yaml-cpp/yaml.h>
 
@@ -105,41 +110,58 @@ static QHash<unsigned, QString> aprsIconNameTable{
   {(unsigned)APRSSystem::Icon::Yagi, "Yagi"},
   {(unsigned)APRSSystem::Icon::Shelter, "Shelter"}};
 
+/** Narrows @c n UTF-16 code units to Latin-1, code units outside of Latin-1 are replaced by 0.
+ * The loop is branch-free, hence the compiler can vectorize it. */
+static inline void
+narrow_latin1(uint8_t *dst, const ushort *src, size_t n) {
+  for (size_t i=0; i<n; i++)
+    dst[i] = (src[i] < 0x100) ? uint8_t(src[i]) : 0;
+}
+
+/** Returns @c true if all @c n UTF-16 code units are ASCII. */
+static inline bool
+is_ascii(const ushort *src, size_t n) {
+  ushort acc = 0;
+  for (size_t i=0; i<n; i++)
+    acc |= src[i];
+  return acc < 0x80;
+}
+
 QString
 decode_unicode(const uint16_t *data, size_t size, uint16_t fill) {
-  QString res; res.reserve(size);
-  for (size_t i=0; (i<size) && (fill!=data[i]); i++) {
-    res.append(QChar(data[i]));
-  }
-  return res;
+  size_t n = 0;
+  while ((n<size) && (fill!=data[n]))
+    n++;
+  return StringPool::fromUtf16(data, int(n));
 }
 
 void
 encode_unicode(uint16_t *data, const QString &text, size_t size, uint16_t fill) {
-  for (size_t i=0; (i<size); i++) {
-    if (i<size_t(text.size()))
-      data[i] = text.at(i).unicode();
-    else
-      data[i] = fill;
-  }
+  size_t n = std::min(size, size_t(text.size()));
+  memcpy(data, text.utf16(), n*sizeof(uint16_t));
+  for (size_t i=n; i<size; i++)
+    data[i] = fill;
 }
 
 QString
 decode_ascii(const uint8_t *data, size_t size, uint16_t fill) {
-  QString res; res.reserve(size);
-  for (size_t i=0; (i<size) && (0!=data[i]) && (fill!=data[i]); i++)
-    res.append(QChar(data[i]));
-  return res;
+  size_t n = 0;
+  while ((n<size) && (0!=data[n]) && (fill!=data[n]))
+    n++;
+  return StringPool::fromLatin1((const char *)data, int(n));
+}
+
+size_t
+pack_ascii(uint8_t *data, const QString &text, size_t maxlen) {
+  size_t n = std::min(maxlen, size_t(text.size()));
+  narrow_latin1(data, text.utf16(), n);
+  return n;
 }
 
 void
 encode_ascii(uint8_t *data, const QString &text, size_t size, uint16_t fill) {
-  for (size_t i=0; (i<size); i++) {
-    if (i<size_t(text.size()))
-      data[i] = text.at(i).toLatin1();
-    else
-      data[i] = fill;
-  }
+  size_t n = pack_ascii(data, text, size);
+  memset(data+n, fill, size-n);
 }
 
 QString
@@ -150,38 +172,76 @@ decode_utf8(const uint8_t *data, size_t size, uint16_t fill) {
 
 void
 encode_utf8(uint8_t *data, const QString &text, size_t size, uint16_t fill) {
+  // Fast path, ASCII is a subset of UTF-8
+  if (is_ascii(text.utf16(), text.size())) {
+    encode_ascii(data, text, size, fill);
+    return;
+  }
   QByteArray buffer = text.toUtf8();
   memset(data, fill, size);
   memcpy(data, buffer.data(), std::min(size_t(buffer.size()), size));
 }
 
+static inline uint32_t
+bcd8_decode(uint32_t bcd) {
+  // Combine nibbles to bytes (0-99), bytes to half-words (0-9999) and half-words to the result.
+  // This is linear in the nibbles, hence invalid BCD digits get weighted like valid ones.
+  bcd = (bcd & 0x0f0f0f0f) + ((bcd >> 4) & 0x0f0f0f0f)*10;
+  bcd = (bcd & 0x00ff00ff) + ((bcd >> 8) & 0x00ff00ff)*100;
+  return (bcd & 0x0000ffff) + (bcd >> 16)*10000;
+}
+
+static inline uint32_t
+bcd8_encode(uint32_t value) {
+  value %= 100000000;
+  // Split into two 4-digit lanes of 32 bits each
+  uint32_t hi = value/10000;
+  uint64_t x = (uint64_t(hi) << 32) | (value - hi*10000);
+  // Split each lane into 2-digit lanes of 16 bits, n/100 == (n*5243)>>19 for n<43699
+  uint64_t q = ((x*5243) >> 19) & 0x0000007f0000007fULL;
+  x = (q << 16) | (x - q*100);
+  // Split each lane into 1-digit lanes of 8 bits, n/10 == (n*103)>>10 for n<179
+  q = ((x*103) >> 10) & 0x000f000f000f000fULL;
+  x = (q << 8) | (x - q*10);
+  // Pack digits into nibbles
+  x = (x | (x >> 4)) & 0x00ff00ff00ff00ffULL;
+  x = (x | (x >> 8)) & 0x0000ffff0000ffffULL;
+  x = (x | (x >> 16)) & 0x00000000ffffffffULL;
+  return uint32_t(x);
+}
+
+uint32_t
+decode_bcd8(uint32_t bcd) {
+  return bcd8_decode(bcd);
+}
+
+uint32_t
+encode_bcd8(uint32_t value) {
+  return bcd8_encode(value);
+}
+
+void
+decode_bcd8(uint32_t *values, const uint32_t *bcd, size_t n) {
+  for (size_t i=0; i<n; i++)
+    values[i] = bcd8_decode(bcd[i]);
+}
+
+void
+encode_bcd8(uint32_t *bcd, const uint32_t *values, size_t n) {
+  for (size_t i=0; i<n; i++)
+    bcd[i] = bcd8_encode(values[i]);
+}
+
+
 double
 decode_frequency(uint32_t bcd) {
-  double freq =
-      1e2  * ((bcd >> 28) & 0xf) +
-      1e1  * ((bcd >> 24) & 0xf) +
-      1.0  * ((bcd >> 20) & 0xf) +
-      1e-1 * ((bcd >> 16) & 0xf) +
-      1e-2 * ((bcd >> 12) & 0xf) +
-      1e-3 * ((bcd >>  8) & 0xf) +
-      1e-4 * ((bcd >>  4) & 0xf) +
-      1e-5 * ((bcd >>  0) & 0xf);
-  return freq;
+  return double(bcd8_decode(bcd))/1e5;
 }
 
 uint32_t
 encode_frequency(double freq) {
   uint32_t hz = std::round(freq * 1e6);
-  uint32_t a  = (hz / 100000000) % 10;
-  uint32_t b  = (hz /  10000000) % 10;
-  uint32_t c  = (hz /   1000000) % 10;
-  uint32_t d  = (hz /    100000) % 10;
-  uint32_t e  = (hz /     10000) % 10;
-  uint32_t f  = (hz /      1000) % 10;
-  uint32_t g  = (hz /       100) % 10;
-  uint32_t h  = (hz /        10) % 10;
-
-  return (a << 28) + (b << 24) + (c << 20) + (d << 16) + (e << 12) + (f << 8) + (g << 4) + h;
+  return bcd8_encode(hz/10);
 }
 
 
@@ -197,39 +257,19 @@ void encode_dmr_id_bin(uint8_t *id, uint32_t no) {
 
 
 uint32_t decode_dmr_id_bcd(const uint8_t *id) {
-  return ((id[0] >> 4) * 10000000
-      + (id[0] & 15) * 1000000
-      + (id[1] >> 4) * 100000
-      + (id[1] & 15) * 10000
-      + (id[2] >> 4) * 1000
-      + (id[2] & 15) * 100
-      + (id[3] >> 4) * 10
-      + (id[3] & 15));
+  return bcd8_decode(qFromBigEndian<uint32_t>(id));
 }
 
 uint32_t decode_dmr_id_bcd_le(const uint8_t *id) {
-  return ((id[3] >> 4) * 10000000
-      + (id[3] & 15) * 1000000
-      + (id[2] >> 4) * 100000
-      + (id[2] & 15) * 10000
-      + (id[1] >> 4) * 1000
-      + (id[1] & 15) * 100
-      + (id[0] >> 4) * 10
-      + (id[0] & 15));
+  return bcd8_decode(qFromLittleEndian<uint32_t>(id));
 }
 
 void encode_dmr_id_bcd(uint8_t *id, uint32_t no) {
-  id[0] = ((no / 10000000) << 4)    | ((no / 1000000) % 10);
-  id[1] = ((no / 100000 % 10) << 4) | ((no / 10000) % 10);
-  id[2] = ((no / 1000 % 10) << 4)   | ((no / 100) % 10);
-  id[3] = ((no / 10 % 10) << 4)     | (no % 10);
+  qToBigEndian<uint32_t>(bcd8_encode(no), id);
 }
 
 void encode_dmr_id_bcd_le(uint8_t *id, uint32_t no) {
-  id[3] = ((no / 10000000) << 4)    | ((no / 1000000) % 10);
-  id[2] = ((no / 100000 % 10) << 4) | ((no / 10000) % 10);
-  id[1] = ((no / 1000 % 10) << 4)   | ((no / 100) % 10);
-  id[0] = ((no / 10 % 10) << 4)     | (no % 10);
+  qToLittleEndian<uint32_t>(bcd8_encode(no), id);
 }
 
 QVector<char> bin_dtmf_tab = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','*','#'};
@@ -369,6 +409,29 @@ uint16_t dec_to_oct(uint16_t dec) {
   return (((d*10+c)*10 + b)*10 + a);
 }
 
+bool
+is_uniform(const uint8_t *data, size_t size, uint8_t value) {
+  // Check unaligned head byte-wise
+  while (size && (uintptr_t(data) % sizeof(uint64_t))) {
+    if (value != *data)
+      return false;
+    data++; size--;
+  }
+  // then the bulk word-wise
+  uint64_t word = 0x0101010101010101ULL * value;
+  const uint64_t *words = (const uint64_t *)data;
+  for (; size>=sizeof(uint64_t); size-=sizeof(uint64_t), words++) {
+    if (word != *words)
+      return false;
+  }
+  // finally the tail
+  for (data = (const uint8_t *)words; size; size--, data++) {
+    if (value != *data)
+      return false;
+  }
+  return true;
+}
+
 bool
 validDMRNumber(const QString &text) {
   return QRegExp("^[0-9]+$").exactMatch(text);
@@ -393,23 +456,47 @@ aprsicon2name(APRSSystem::Icon icon) {
   return aprsIconNameTable.value((unsigned)icon);
 }
 
+/** Maximum number of resolved names kept by @c name2aprsicon. */
+#define APRS_ICON_CACHE_SIZE 256
+
 APRSSystem::Icon
 name2aprsicon(const QString &name) {
   if (name.isEmpty())
     return APRSSystem::Icon::None;
 
+  // Exact (case-insensitive) matches and previously resolved names
+  static QMutex lock;
+  static QHash<QString, APRSSystem::Icon> exact, resolved;
+  QMutexLocker locker(&lock);
+  if (exact.isEmpty()) {
+    QHash<unsigned, QString>::const_iterator item=aprsIconNameTable.constBegin();
+    for(; item != aprsIconNameTable.constEnd(); item++) {
+      if ((! item.value().isEmpty()) && (! exact.contains(item.value().toLower())))
+        exact.insert(item.value().toLower(), (APRSSystem::Icon)item.key());
+    }
+  }
+  QString key = name.toLower();
+  if (exact.contains(key))
+    return exact.value(key);
+  if (resolved.contains(key))
+    return resolved.value(key);
+
+  // Fuzzy match for misspelled names, candidates are dropped as soon as they exceed the best
   APRSSystem::Icon icon = APRSSystem::Icon::None;
-  int best = levDist(name, "");
+  int best = name.size();
 
   QHash<unsigned, QString>::const_iterator item=aprsIconNameTable.constBegin();
   for(; item != aprsIconNameTable.constEnd(); item++) {
-    int dist = levDist(name, item.value());
+    int dist = levDist(name, item.value(), best-1);
     if (dist < best) {
       icon = (APRSSystem::Icon)item.key();
       best = dist;
     }
   }
 
+  if (resolved.size() >= APRS_ICON_CACHE_SIZE)
+    resolved.clear();
+  resolved.insert(key, icon);
   return icon;
 }
 
@@ -445,6 +532,11 @@ code2aprsicon(char table, char icon) {
 
 int
 levDist(const QString &source, const QString &target, Qt::CaseSensitivity cs) {
+  return levDist(source, target, std::max(source.size(), target.size()), cs);
+}
+
+int
+levDist(const QString &source, const QString &target, int maxDist, Qt::CaseSensitivity cs) {
   // Mostly stolen from https://qgis.org/api/2.14/qgsstringutils_8cpp_source.html
 
   if (0 == QString::compare(source,target, cs)) {
@@ -454,36 +546,41 @@ levDist(const QString &source, const QString &target, Qt::CaseSensitivity cs) {
   const int sourceCount = source.count();
   const int targetCount = target.count();
 
+  // The distance is at least the difference in length
+  if (qAbs(sourceCount-targetCount) > maxDist)
+    return maxDist+1;
   if (source.isEmpty())
     return targetCount;
   if (target.isEmpty())
     return sourceCount;
   if (sourceCount > targetCount)
-    return levDist(target, source, cs);
-
-
-  QVector<int> column;
-  column.fill(0, targetCount + 1);
+    return levDist(target, source, maxDist, cs);
 
-  QVector<int> previousColumn;
-  previousColumn.reserve(targetCount + 1);
+  // Columns are kept on the stack for typical names
+  QVarLengthArray<int, 64> columnBuffer(targetCount + 1), previousColumnBuffer(targetCount + 1);
+  int *column = columnBuffer.data(), *previousColumn = previousColumnBuffer.data();
   for (int i = 0; i < targetCount + 1; i++)
-    previousColumn.append(i);
+    previousColumn[i] = i;
 
   for (int i = 0; i < sourceCount; i++) {
     column[0] = i + 1;
+    int columnMin = column[0];
     for (int j = 0; j < targetCount; j++) {
       column[j + 1] = std::min(
       {
-              1 + column.at(j),
-              1 + previousColumn.at(1 + j),
-              previousColumn.at(j) + (QString::compare(source.at(i),target.at(j), cs) ? 1 : 0)
+              1 + column[j],
+              1 + previousColumn[1 + j],
+              previousColumn[j] + (QString::compare(source.at(i),target.at(j), cs) ? 1 : 0)
             });
+      columnMin = std::min(columnMin, column[j + 1]);
     }
-    column.swap(previousColumn);
+    // The distance never drops below the minimum of a column
+    if (columnMin > maxDist)
+      return maxDist+1;
+    std::swap(column, previousColumn);
   }
 
-  return previousColumn.at(targetCount);
+  return previousColumn[targetCount];
 }
 
 uint32_t
@@ -14,7 +14,7 @@
 #include <QGeoCoordinate>
 
 /** Decodes the unicode string stored in @c data of size @c size. The @c fill code also defines the
- * end-of-string symbol.
+ * end-of-string symbol. Within a @c StringPool::Scope, equal strings share their storage.
  * @returns The decoded string. */
 QString decode_unicode(const uint16_t *data, size_t size, uint16_t fill=0x0000);
 /** Encodes the string @c text as unicode and stores the result into @c data using up-to @c size
@@ -22,11 +22,16 @@ QString decode_unicode(const uint16_t *data, size_t size, uint16_t fill=0x0000);
 void encode_unicode(uint16_t *data, const QString &text, size_t size, uint16_t fill=0x0000);
 
 /** Decodes the ascii string in @c data into a @c QString of up-to size length. The @c fill word
- * specifies the fill and end-of-string word. */
+ * specifies the fill and end-of-string word. Within a @c StringPool::Scope, equal strings share
+ * their storage. */
 QString decode_ascii(const uint8_t *data, size_t size, uint16_t fill=0x00);
 /** Encodes the given QString @c text of up-to size length as ASCII into @c data using the
  * @c fill word as fill and end-of-string word. */
 void encode_ascii(uint8_t *data, const QString &text, size_t size, uint16_t fill=0x00);
+/** Copies up-to @c maxlen chars of @c text as ASCII into @c data without any padding. Allows to
+ * pack several strings back-to-back.
+ * @returns The number of bytes written. */
+size_t pack_ascii(uint8_t *data, const QString &text, size_t maxlen);
 
 /** Decodes the UTF-8 string in @c data into a @c QString of up-to size length. The @c fill word
  * specifies the fill and end-of-string word. */
@@ -35,6 +40,17 @@ QString decode_utf8(const uint8_t *data, size_t size, uint16_t fill=0x00);
  * @c fill word as fill and end-of-string word. */
 void encode_utf8(uint8_t *data, const QString &text, size_t size, uint16_t fill=0x00);
 
+/** Decodes an 8-digit BCD value. The most significant digit is stored in the upper-most nibble.
+ * The conversion is branch- and division-free. */
+uint32_t decode_bcd8(uint32_t bcd);
+/** Encodes the given value (modulo 10^8) as an 8-digit BCD value. The most significant digit is
+ * stored in the upper-most nibble. The conversion is branch-free and avoids any division but one. */
+uint32_t encode_bcd8(uint32_t value);
+/** Decodes @c n 8-digit BCD values from @c bcd into @c values. */
+void decode_bcd8(uint32_t *values, const uint32_t *bcd, size_t n);
+/** Encodes @c n values from @c values as 8-digit BCD values into @c bcd. */
+void encode_bcd8(uint32_t *bcd, const uint32_t *values, size_t n);
+
 /** Decodes an 8 digit BCD encoded frequency (in MHz). */
 double decode_frequency(uint32_t bcd);
 /** Eecodes an 8 digit BCD encoded frequency (in MHz). */
@@ -70,6 +86,10 @@ uint16_t oct_to_dec(uint16_t oct);
  * @param dec The decimal number between 0-4095*/
 uint16_t dec_to_oct(uint16_t dec);
 
+/** Returns @c true if all @c size bytes in @c data are equal to @c value. The check is performed
+ * word-wise, hence it is fast even for large blocks. */
+bool is_uniform(const uint8_t *data, size_t size, uint8_t value);
+
 /** Validates a DMR ID number. */
 bool validDMRNumber(const QString &text);
 /** Validates a DTMF number. */
@@ -87,6 +107,10 @@ APRSSystem::Icon code2aprsicon(char table, char icon);
  * into target. */
 int levDist(const QString &source, const QString &target,
             Qt::CaseSensitivity cs=Qt::CaseInsensitive);
+/** Implements the Levenshtein distance bounded by @c maxDist. If the distance exceeds
+ * @c maxDist, the computation stops early and @c maxDist+1 is returned. */
+int levDist(const QString &source, const QString &target, int maxDist,
+            Qt::CaseSensitivity cs=Qt::CaseInsensitive);
 
 /** Increases the given size to be aligned with the given block size. */
 uint32_t align_size(uint32_t size, uint32_t block);
@@ -2,8 +2,6 @@
 #include "uv390_limits.hh"
 
 
-RadioLimits *UV390::_limits = nullptr;
-
 
 UV390::UV390(TyTInterface *device, QObject *parent)
   : TyTRadio(device, parent), _name("TyT MD-UV390")
@@ -22,9 +20,7 @@ UV390::name() const {
 
 const RadioLimits &
 UV390::limits() const {
-  if (nullptr == _limits)
-    _limits = new UV390Limits();
-  return *_limits;
+  return *RadioLimits::shared("uv390", []() -> RadioLimits * { return new UV390Limits(); });
 }
 
 const Codeplug &
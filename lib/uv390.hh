@@ -65,10 +65,6 @@ private:
   UV390Codeplug _codeplug;
   /** The callsign DB object. */
   UV390CallsignDB _callsigndb;
-
-private:
-  /** Holds the singleton instance of the radio limits. */
-  static RadioLimits *_limits;
 };
 
 #endif // MD2017_HH
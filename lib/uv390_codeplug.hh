@@ -304,6 +304,7 @@ public:
   virtual ~UV390Codeplug();
 
   void clear();
+  std::vector<AddressMap::Range> generatedMemory() const;
 
 public:
   void clearTimestamp();
@@ -0,0 +1,505 @@
+#include "virtualdevice.hh"
+#include "logger.hh"
+#include "anytone_interface.hh"
+#include "opengd77_interface.hh"
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QThread>
+#include <QtEndian>
+#include <cstring>
+#include <algorithm>
+
+/** Size of the memory pages of the emulated memory. */
+#define PAGE_SIZE       0x1000
+/** Magic number of the memory image files. */
+#define IMAGE_MAGIC     0x71766d69
+/** Size of the OpenGD77 flash sectors. */
+#define OGD77_SECTOR    4096
+/** Size of the OpenGD77 command requests. */
+#define OGD77_COMMAND   23
+
+const QString VirtualDevice::Prefix = "virtual:";
+
+
+/* ********************************************************************************************* *
+ * Implementation of VirtualDevice::Descriptor
+ * ********************************************************************************************* */
+VirtualDevice::Descriptor::Descriptor(const QString &handle)
+  : USBDeviceDescriptor()
+{
+  if (! VirtualDevice::isHandle(handle))
+    return;
+  RadioInfo radio = RadioInfo::byKey(handle.mid(Prefix.size()).section(',', 0, 0).simplified().toLower());
+  if (! radio.isValid())
+    return;
+  USBDeviceInfo::operator =(USBDeviceInfo(USBDeviceInfo::Class::Virtual, radio.interface().vendorId(),
+                                          radio.interface().productId(), true));
+  _device = handle.simplified();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of VirtualDevice::Link
+ * ********************************************************************************************* */
+VirtualDevice::Link::Link()
+  : latency(0), bandwidth(0), errorRate(0), seed(0)
+{
+  // pass...
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of VirtualDevice
+ * ********************************************************************************************* */
+VirtualDevice::VirtualDevice(const RadioInfo &radio, const Link &link, uint8_t fill)
+  : _radio(radio), _link(link), _fill(fill), _memory(), _image(), _clock(), _busyUntil(0),
+    _input(), _transit(), _output(), _random(link.seed)
+{
+  _clock.start();
+}
+
+VirtualDevice::~VirtualDevice() {
+  ErrorStack err;
+  if ((! _image.isEmpty()) && (! save(_image, err)))
+    logError() << "Cannot store virtual device memory: " << err.format();
+}
+
+bool
+VirtualDevice::isHandle(const QString &handle) {
+  return handle.simplified().startsWith(Prefix, Qt::CaseInsensitive);
+}
+
+VirtualDevice *
+VirtualDevice::create(const QString &handle, const ErrorStack &err) {
+  if (! isHandle(handle)) {
+    errMsg(err) << "Invalid virtual device handle '" << handle << "'.";
+    return nullptr;
+  }
+
+  QStringList fields = handle.simplified().mid(Prefix.size()).split(',');
+  QString key = fields.takeFirst().simplified().toLower();
+  RadioInfo radio = RadioInfo::byKey(key);
+  if (! radio.isValid()) {
+    errMsg(err) << "Unknown virtual radio '" << key << "'.";
+    return nullptr;
+  }
+
+  Link link; QString image, replay;
+  foreach (QString field, fields) {
+    QString name = field.section('=', 0, 0).simplified().toLower();
+    QString value = field.section('=', 1).simplified();
+    bool ok = true;
+    if ("latency" == name) {
+      link.latency = value.toDouble(&ok)*1000;
+    } else if ("bandwidth" == name) {
+      link.bandwidth = value.toUInt(&ok);
+    } else if ("errors" == name) {
+      link.errorRate = value.toDouble(&ok);
+      ok = ok && (0 <= link.errorRate) && (1 >= link.errorRate);
+    } else if ("seed" == name) {
+      link.seed = value.toUInt(&ok);
+    } else if ("image" == name) {
+      image = value;
+      ok = ! image.isEmpty();
+    } else if ("replay" == name) {
+      replay = value;
+      ok = ! replay.isEmpty();
+    } else {
+      errMsg(err) << "Unknown virtual device option '" << name << "'.";
+      return nullptr;
+    }
+    if (! ok) {
+      errMsg(err) << "Invalid value '" << value << "' for virtual device option '" << name << "'.";
+      return nullptr;
+    }
+  }
+
+  VirtualDevice *dev = nullptr;
+  if (! replay.isEmpty()) {
+    USBDeviceInfo recorded; QVector<SessionRecorder::Event> events;
+    if (! SessionRecorder::read(replay, recorded, events, err))
+      return nullptr;
+    if (((USBDeviceInfo::Class::Serial != recorded.interfaceClass()) &&
+         (USBDeviceInfo::Class::Virtual != recorded.interfaceClass())) ||
+        (recorded.vendorId() != radio.interface().vendorId()) ||
+        (recorded.productId() != radio.interface().productId())) {
+      errMsg(err) << "Cannot replay session '" << replay << "' as " << radio.name()
+                  << ": Recorded at " << recorded.description() << ".";
+      return nullptr;
+    }
+    dev = new VirtualReplay(radio, link, events);
+  } else if (AnytoneInterface::interfaceInfo() == radio.interface()) {
+    dev = new VirtualAnytone(radio, link);
+  } else if (OpenGD77Interface::interfaceInfo() == radio.interface()) {
+    dev = new VirtualOpenGD77(radio, link);
+  } else {
+    errMsg(err) << "Cannot emulate " << radio.manufacturer() << " " << radio.name()
+                << ": Protocol not supported by virtual devices.";
+    return nullptr;
+  }
+
+  if (! image.isEmpty()) {
+    if (QFileInfo::exists(image) && (! dev->load(image, err))) {
+      delete dev;
+      return nullptr;
+    }
+    dev->_image = image;
+  }
+
+  logDebug() << "Created virtual " << radio.name() << " with " << link.latency << "us latency, "
+             << link.bandwidth << "b/s bandwidth and error rate " << link.errorRate << ".";
+  return dev;
+}
+
+const RadioInfo &
+VirtualDevice::radio() const {
+  return _radio;
+}
+
+const VirtualDevice::Link &
+VirtualDevice::link() const {
+  return _link;
+}
+
+void
+VirtualDevice::write(const char *data, qint64 len) {
+  _input.append(data, len);
+
+  qint64 n;
+  QByteArray response;
+  unsigned delay = _link.latency;
+  while ((! _input.isEmpty()) && (0 < (n = process(_input, response, delay)))) {
+    // Requests and responses are transferred serially
+    qint64 start = std::max(qint64(_clock.nsecsElapsed()/1000), _busyUntil);
+    if (_link.bandwidth)
+      start += ((n + response.size())*1000000LL)/_link.bandwidth;
+    _busyUntil = start;
+    _input.remove(0, n);
+    if (response.isEmpty()) {
+      delay = _link.latency;
+      continue;
+    }
+    // Inject errors
+    if ((0 < _link.errorRate) &&
+        (std::uniform_real_distribution<double>(0, 1)(_random) < _link.errorRate)) {
+      int idx = std::uniform_int_distribution<int>(0, response.size()-1)(_random);
+      response[idx] = ~response.at(idx);
+    }
+    _transit.enqueue({start + delay, response});
+    response.clear();
+    delay = _link.latency;
+  }
+}
+
+qint64
+VirtualDevice::bytesAvailable() const {
+  qint64 now = _clock.nsecsElapsed()/1000, n = _output.size();
+  foreach (const Response &resp, _transit) {
+    if (resp.ready > now)
+      break;
+    n += resp.data.size();
+  }
+  return n;
+}
+
+qint64
+VirtualDevice::read(char *data, qint64 maxlen) {
+  update();
+  qint64 n = std::min(maxlen, qint64(_output.size()));
+  memcpy(data, _output.constData(), n);
+  _output.remove(0, n);
+  return n;
+}
+
+bool
+VirtualDevice::waitForReadyRead(int msecs) {
+  update();
+  if (! _output.isEmpty())
+    return true;
+
+  qint64 now = _clock.nsecsElapsed()/1000, deadline = now + qint64(msecs)*1000;
+  if (_transit.isEmpty() || (_transit.head().ready > deadline)) {
+    QThread::usleep(qMax(qint64(0), deadline-now));
+    update();
+    return ! _output.isEmpty();
+  }
+
+  QThread::usleep(qMax(qint64(0), _transit.head().ready-now));
+  update();
+  return true;
+}
+
+void
+VirtualDevice::update() {
+  qint64 now = _clock.nsecsElapsed()/1000;
+  while ((! _transit.isEmpty()) && (_transit.head().ready <= now))
+    _output.append(_transit.dequeue().data);
+}
+
+void
+VirtualDevice::readMemory(uint32_t bank, uint32_t addr, char *data, int len) const {
+  const QHash<uint32_t, QByteArray> pages = _memory.value(bank);
+  while (len > 0) {
+    uint32_t page = addr/PAGE_SIZE, offset = addr%PAGE_SIZE;
+    int n = std::min(len, int(PAGE_SIZE-offset));
+    QHash<uint32_t, QByteArray>::const_iterator it = pages.constFind(page);
+    if (pages.constEnd() != it)
+      memcpy(data, it->constData()+offset, n);
+    else
+      memset(data, _fill, n);
+    addr += n; data += n; len -= n;
+  }
+}
+
+void
+VirtualDevice::writeMemory(uint32_t bank, uint32_t addr, const char *data, int len) {
+  QHash<uint32_t, QByteArray> &pages = _memory[bank];
+  while (len > 0) {
+    uint32_t page = addr/PAGE_SIZE, offset = addr%PAGE_SIZE;
+    int n = std::min(len, int(PAGE_SIZE-offset));
+    if (! pages.contains(page))
+      pages[page] = QByteArray(PAGE_SIZE, char(_fill));
+    memcpy(pages[page].data()+offset, data, n);
+    addr += n; data += n; len -= n;
+  }
+}
+
+bool
+VirtualDevice::save(const QString &filename, const ErrorStack &err) const {
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot open memory image '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+  QDataStream stream(&file);
+  stream << quint32(IMAGE_MAGIC) << _radio.key() << _memory;
+  return QDataStream::Ok == stream.status();
+}
+
+bool
+VirtualDevice::load(const QString &filename, const ErrorStack &err) {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open memory image '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+  QDataStream stream(&file);
+  quint32 magic; QString key;
+  stream >> magic >> key;
+  if ((IMAGE_MAGIC != magic) || (key != _radio.key())) {
+    errMsg(err) << "Memory image '" << filename << "' does not belong to a virtual "
+                << _radio.name() << ".";
+    return false;
+  }
+  stream >> _memory;
+  if (QDataStream::Ok != stream.status()) {
+    errMsg(err) << "Cannot read memory image '" << filename << "'.";
+    return false;
+  }
+  return true;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of VirtualAnytone
+ * ********************************************************************************************* */
+VirtualAnytone::VirtualAnytone(const RadioInfo &radio, const Link &link)
+  : VirtualDevice(radio, link, 0x00), _programMode(false)
+{
+  // pass...
+}
+
+qint64
+VirtualAnytone::process(const QByteArray &input, QByteArray &response, unsigned &delay) {
+  Q_UNUSED(delay);
+  if (input.startsWith("PROGRAM")) {
+    _programMode = true;
+    response.append("QX\x06", 3);
+    return 7;
+  } else if (input.startsWith("END")) {
+    _programMode = false;
+    response.append('\x06');
+    return 3;
+  } else if (QByteArray("PROGRAM").startsWith(input) || QByteArray("END").startsWith(input)) {
+    return 0;
+  } else if (! _programMode) {
+    // Ignore everything outside of program mode
+    return 1;
+  }
+
+  if ('\x02' == input.at(0)) {
+    QByteArray model;
+    switch (_radio.id()) {
+    case RadioInfo::DMR6X2UV: model = "D6X2UV"; break;
+    case RadioInfo::D878UVII: model = "D878UV2"; break;
+    case RadioInfo::D868UV:
+    case RadioInfo::D868UVE: model = "D868UVE"; break;
+    default: model = _radio.name().toLocal8Bit(); break;
+    }
+    model.resize(7);
+    QByteArray version("V100"); version.resize(6);
+    response.append('I').append(model).append('\x00').append(version).append('\x06');
+    return 1;
+  } else if ('R' == input.at(0)) {
+    if (6 > input.size())
+      return 0;
+    uint8_t size = input.at(5);
+    QByteArray data(size, 0);
+    readMemory(0, qFromBigEndian<quint32>((const uchar *)input.constData()+1), data.data(), size);
+    response.append('W').append(input.mid(1, 5)).append(data);
+    uint8_t sum = 0;
+    for (int i=1; i<response.size(); i++)
+      sum += uint8_t(response.at(i));
+    response.append(char(sum)).append('\x06');
+    return 6;
+  } else if ('W' == input.at(0)) {
+    if (6 > input.size())
+      return 0;
+    uint8_t size = input.at(5);
+    if ((8+size) > input.size())
+      return 0;
+    uint8_t sum = 0;
+    for (int i=1; i<(6+size); i++)
+      sum += uint8_t(input.at(i));
+    if (sum != uint8_t(input.at(6+size))) {
+      response.append('\xff');
+    } else {
+      writeMemory(0, qFromBigEndian<quint32>((const uchar *)input.constData()+1),
+                  input.constData()+6, size);
+      response.append('\x06');
+    }
+    return 8+size;
+  }
+
+  // Skip unknown bytes
+  return 1;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of VirtualOpenGD77
+ * ********************************************************************************************* */
+VirtualOpenGD77::VirtualOpenGD77(const RadioInfo &radio, const Link &link)
+  : VirtualDevice(radio, link, 0xff), _sector(-1), _buffer(OGD77_SECTOR, char(0xff))
+{
+  // pass...
+}
+
+qint64
+VirtualOpenGD77::process(const QByteArray &input, QByteArray &response, unsigned &delay) {
+  Q_UNUSED(delay);
+  if ('R' == input.at(0)) {
+    if (8 > input.size())
+      return 0;
+    uint8_t cmd = input.at(1);
+    uint32_t addr = qFromBigEndian<quint32>((const uchar *)input.constData()+2);
+    uint16_t len = qFromBigEndian<quint16>((const uchar *)input.constData()+6);
+    if ((1 != cmd) && (2 != cmd)) {
+      // Only flash (1) and EEPROM (2) are emulated
+      response.append('-');
+      return 8;
+    }
+    QByteArray data(len, 0);
+    readMemory((1 == cmd) ? uint32_t(OpenGD77Interface::FLASH) : uint32_t(OpenGD77Interface::EEPROM),
+               addr, data.data(), len);
+    response.append('R').append(input.mid(6, 2)).append(data);
+    return 8;
+  } else if ('W' == input.at(0)) {
+    if (2 > input.size())
+      return 0;
+    uint8_t cmd = input.at(1);
+    if (1 == cmd) {
+      // Select sector and load it into the sector buffer
+      if (5 > input.size())
+        return 0;
+      _sector = (uint32_t(uint8_t(input.at(2)))<<16) | (uint32_t(uint8_t(input.at(3)))<<8)
+          | uint8_t(input.at(4));
+      readMemory(OpenGD77Interface::FLASH, _sector*OGD77_SECTOR, _buffer.data(), OGD77_SECTOR);
+      response.append(input.left(2));
+      return 5;
+    } else if ((2 == cmd) || (4 == cmd)) {
+      if (8 > input.size())
+        return 0;
+      uint32_t addr = qFromBigEndian<quint32>((const uchar *)input.constData()+2);
+      uint16_t len = qFromBigEndian<quint16>((const uchar *)input.constData()+6);
+      if ((8+len) > input.size())
+        return 0;
+      if (4 == cmd) {
+        writeMemory(OpenGD77Interface::EEPROM, addr, input.constData()+8, len);
+        response.append(input.left(2));
+      } else if ((0 <= _sector) && (addr >= uint32_t(_sector*OGD77_SECTOR)) &&
+                 ((addr+len) <= uint32_t((_sector+1)*OGD77_SECTOR))) {
+        memcpy(_buffer.data() + (addr - _sector*OGD77_SECTOR), input.constData()+8, len);
+        response.append(input.left(2));
+      } else {
+        response.append("-\x00", 2);
+      }
+      return 8+len;
+    } else if (3 == cmd) {
+      // Program sector buffer
+      if (0 <= _sector) {
+        writeMemory(OpenGD77Interface::FLASH, _sector*OGD77_SECTOR, _buffer.constData(), OGD77_SECTOR);
+        response.append(input.left(2));
+      } else {
+        response.append("-\x00", 2);
+      }
+      return 2;
+    }
+    response.append("-\x00", 2);
+    return 2;
+  } else if ('C' == input.at(0)) {
+    if (OGD77_COMMAND > input.size())
+      return 0;
+    response.append('-');
+    return OGD77_COMMAND;
+  }
+
+  // Skip unknown bytes
+  return 1;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of VirtualReplay
+ * ********************************************************************************************* */
+VirtualReplay::VirtualReplay(const RadioInfo &radio, const Link &link,
+                             const QVector<SessionRecorder::Event> &events)
+  : VirtualDevice(radio, link, 0x00), _events(events), _next(0), _diverged(false)
+{
+  // pass...
+}
+
+qint64
+VirtualReplay::process(const QByteArray &input, QByteArray &response, unsigned &delay) {
+  // Skip responses without a request
+  while ((_next < _events.size()) &&
+         (SessionRecorder::Direction::Request != _events.at(_next).direction))
+    _next++;
+
+  if (_next >= _events.size()) {
+    if (! _diverged)
+      logWarn() << "Replay exhausted: Requests exceed the recorded session.";
+    _diverged = true;
+    return input.size();
+  }
+
+  const SessionRecorder::Event &request = _events.at(_next);
+  if (input.size() < request.data.size())
+    return 0;
+  if ((! _diverged) && (! input.startsWith(request.data))) {
+    logWarn() << "Replay diverges from the recorded session at event " << _next << ".";
+    _diverged = true;
+  }
+
+  // Collect all responses up to the next request
+  qint64 last = request.time;
+  for (_next++; (_next < _events.size()) &&
+       (SessionRecorder::Direction::Response == _events.at(_next).direction); _next++) {
+    response.append(_events.at(_next).data);
+    last = _events.at(_next).time;
+  }
+  delay = last - request.time;
+
+  return request.data.size();
+}
@@ -0,0 +1,203 @@
+#ifndef VIRTUALDEVICE_HH
+#define VIRTUALDEVICE_HH
+
+#include <QByteArray>
+#include <QHash>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <random>
+#include "usbdevice.hh"
+#include "radioinfo.hh"
+#include "errorstack.hh"
+#include "sessionrecorder.hh"
+
+/** Emulates the wire protocol of a radio in memory.
+ *
+ * Virtual devices allow to measure transport changes (e.g., pipelining, skipping unchanged
+ * sectors) reproducibly without any hardware attached. A virtual device is addressed by a handle
+ * like @c virtual:d878uv,latency=2,bandwidth=11520,errors=0.001. The first field specifies the
+ * emulated radio by its key, the remaining optional fields configure the emulated link:
+ *
+ *   - @c latency specifies the delay of every response in ms (default 0),
+ *   - @c bandwidth specifies the bandwidth of the link in bytes per second (default unlimited),
+ *   - @c errors specifies the probability of a corrupted response (default 0),
+ *   - @c seed specifies the seed of the error injection (default 0),
+ *   - @c image specifies a file, the emulated memory is loaded from and stored into,
+ *   - @c replay specifies a session recorded by the @c SessionRecorder. The recorded responses
+ *     are served with the recorded timing instead of emulating the protocol.
+ *
+ * The link transfers requests and responses serially. Hence requests pipelined back-to-back
+ * share the latency, while requests sent in lock-step pay it every time.
+ *
+ * The serial protocols of AnyTone and OpenGD77 devices get emulated. The device is used by the
+ * @c USBSerial interface in place of the serial port.
+ *
+ * @ingroup rif */
+class VirtualDevice
+{
+public:
+  /** Prefix of all virtual device handles. */
+  static const QString Prefix;
+
+  /** Specialization of the device descriptor for virtual devices. */
+  class Descriptor: public USBDeviceDescriptor {
+  public:
+    /** Constructs a descriptor for the given virtual device handle. If the handle is invalid,
+     * an invalid descriptor is returned. */
+    Descriptor(const QString &handle);
+  };
+
+  /** Parameters of the emulated link. */
+  struct Link {
+    unsigned latency;   ///< Delay of every response in microseconds.
+    unsigned bandwidth; ///< Bandwidth in bytes per second, 0 means unlimited.
+    double errorRate;   ///< Probability of a corrupted response.
+    unsigned seed;      ///< Seed of the error injection.
+
+    /** Default link, no latency, unlimited bandwidth and no errors. */
+    Link();
+  };
+
+protected:
+  /** Hidden constructor.
+   * @param radio Specifies the emulated radio.
+   * @param link Specifies the link parameters.
+   * @param fill Specifies the value of not-yet written memory. */
+  VirtualDevice(const RadioInfo &radio, const Link &link, uint8_t fill);
+
+public:
+  /** Destructor, stores the memory into the image file, if set. */
+  virtual ~VirtualDevice();
+
+  /** Returns @c true if the given string is a virtual device handle. */
+  static bool isHandle(const QString &handle);
+  /** Creates the virtual device for the given handle. */
+  static VirtualDevice *create(const QString &handle, const ErrorStack &err=ErrorStack());
+
+  /** Returns the emulated radio. */
+  const RadioInfo &radio() const;
+  /** Returns the link parameters. */
+  const Link &link() const;
+
+  /** Passes some request data to the device. */
+  void write(const char *data, qint64 len);
+  /** Returns the number of response bytes available. */
+  qint64 bytesAvailable() const;
+  /** Reads at most @c maxlen bytes of response. */
+  qint64 read(char *data, qint64 maxlen);
+  /** Blocks until response bytes are available or @c msecs milliseconds passed. */
+  bool waitForReadyRead(int msecs);
+
+  /** Stores the emulated memory into the given file. */
+  bool save(const QString &filename, const ErrorStack &err=ErrorStack()) const;
+  /** Loads the emulated memory from the given file. */
+  bool load(const QString &filename, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Processes the first complete request in the given input. Appends the response and
+   * returns the number of bytes consumed or 0 if the request is not complete yet. The @c delay
+   * of the response in microseconds is preset to the latency of the link. */
+  virtual qint64 process(const QByteArray &input, QByteArray &response, unsigned &delay) = 0;
+
+  /** Reads from the emulated memory of the given bank. */
+  void readMemory(uint32_t bank, uint32_t addr, char *data, int len) const;
+  /** Writes to the emulated memory of the given bank. */
+  void writeMemory(uint32_t bank, uint32_t addr, const char *data, int len);
+
+  /** Releases all responses whose time has come. */
+  void update();
+
+protected:
+  /** A response in transit. */
+  struct Response {
+    qint64 ready;    ///< Time in microseconds, the response is available.
+    QByteArray data; ///< The response data.
+  };
+
+  /** The emulated radio. */
+  RadioInfo _radio;
+  /** The link parameters. */
+  Link _link;
+  /** Value of not-yet written memory. */
+  uint8_t _fill;
+  /** The emulated memory, pages by bank and address. */
+  QHash<uint32_t, QHash<uint32_t, QByteArray>> _memory;
+  /** If set, the memory gets loaded from and stored into this file. */
+  QString _image;
+
+  /** Time base of the link. */
+  QElapsedTimer _clock;
+  /** Time in microseconds, the link is busy until. */
+  qint64 _busyUntil;
+  /** Incomplete request data. */
+  QByteArray _input;
+  /** Responses in transit. */
+  QQueue<Response> _transit;
+  /** Responses available for reading. */
+  QByteArray _output;
+  /** Random number generator for the error injection. */
+  std::mt19937 _random;
+};
+
+
+/** Emulates the serial protocol of AnyTone radios.
+ * @ingroup rif */
+class VirtualAnytone: public VirtualDevice
+{
+public:
+  /** Constructs a virtual AnyTone radio. */
+  VirtualAnytone(const RadioInfo &radio, const Link &link);
+
+protected:
+  qint64 process(const QByteArray &input, QByteArray &response, unsigned &delay);
+
+protected:
+  /** If @c true, the radio is in program mode. */
+  bool _programMode;
+};
+
+
+/** Emulates the serial protocol of radios running the OpenGD77 firmware.
+ * @ingroup rif */
+class VirtualOpenGD77: public VirtualDevice
+{
+public:
+  /** Constructs a virtual OpenGD77 radio. */
+  VirtualOpenGD77(const RadioInfo &radio, const Link &link);
+
+protected:
+  qint64 process(const QByteArray &input, QByteArray &response, unsigned &delay);
+
+protected:
+  /** The currently selected flash sector or -1. */
+  int32_t _sector;
+  /** The sector buffer. */
+  QByteArray _buffer;
+};
+
+
+/** Replays a session recorded by the @c SessionRecorder.
+ *
+ * Every request gets answered by the responses recorded after the matching request, delayed
+ * by the recorded time between the request and the last of these responses.
+ *
+ * @ingroup rif */
+class VirtualReplay: public VirtualDevice
+{
+public:
+  /** Constructs a replay of the given recorded events. */
+  VirtualReplay(const RadioInfo &radio, const Link &link, const QVector<SessionRecorder::Event> &events);
+
+protected:
+  qint64 process(const QByteArray &input, QByteArray &response, unsigned &delay);
+
+protected:
+  /** The recorded events. */
+  QVector<SessionRecorder::Event> _events;
+  /** Index of the next event to replay. */
+  int _next;
+  /** If @c true, the requests diverged from the recorded ones. */
+  bool _diverged;
+};
+
+#endif // VIRTUALDEVICE_HH
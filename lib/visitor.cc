@@ -3,18 +3,28 @@
 #include "configobject.hh"
 #include "configreference.hh"
 #include "logger.hh"
+#include "tracer.hh"
 
 Visitor::Visitor()
+  : _types(), _descend()
 {
   // Pass...
 }
 
+Visitor::Visitor(const std::initializer_list<QMetaObject> &types)
+  : _types(), _descend()
+{
+  for (const QMetaObject &type: types)
+    _types.append(type.className());
+}
+
 Visitor::~Visitor() {
   // pass...
 }
 
 bool
 Visitor::process(Config *config, const ErrorStack &err) {
+  TRACE_SPAN("Visitor::process", "visitor");
   return this->processItem(config, err);
 }
 
@@ -22,10 +32,10 @@ bool
 Visitor::processItem(ConfigItem *item, const ErrorStack &err) {
   // Process all properties
   const QMetaObject *meta = item->metaObject();
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
+  foreach (const ConfigItem::PropertyInfo &info, ConfigItem::propertyTable(meta)) {
+    const QMetaProperty &prop = info.prop;
     if (! prop.isValid()) {
-      logWarn() << "Found invalid property at index " << p << " in an instance of '"
+      logWarn() << "Found invalid property in an instance of '"
                 << meta->className() << "'. Skip.";
       continue;
     }
@@ -41,79 +51,85 @@ Visitor::processItem(ConfigItem *item, const ErrorStack &err) {
 
 bool
 Visitor::processProperty(ConfigItem *item, const QMetaProperty &prop, const ErrorStack &err) {
-  if (prop.isEnumType()) {
+  ConfigItem::PropertyKind kind = item->propertyKind(prop);
+  if (ConfigItem::PropertyKind::Enum == kind) {
     if (! this->processEnum(item, prop, err)) {
       errMsg(err) << "While processing enum '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("bool") == prop.typeName()) {
+  } else if (ConfigItem::PropertyKind::Bool == kind) {
     if (! this->processBool(item, prop, err)) {
       errMsg(err) << "While processing boolean '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("int") == prop.typeName()) {
+  } else if (ConfigItem::PropertyKind::Int == kind) {
     if (! this->processInt(item, prop, err)) {
       errMsg(err) << "While processing integer '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("uint") == prop.typeName()) {
+  } else if (ConfigItem::PropertyKind::UInt == kind) {
     if (! this->processUInt(item, prop, err)) {
       errMsg(err) << "While processing unsigned integer '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("double") == prop.typeName()) {
+  } else if (ConfigItem::PropertyKind::Double == kind) {
     if (! this->processDouble(item, prop, err)) {
       errMsg(err) << "While processing double '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("QString") == prop.typeName()) {
+  } else if (ConfigItem::PropertyKind::String == kind) {
     if (! this->processString(item, prop, err)) {
       errMsg(err) << "While processing string '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("Frequency") == prop.typeName()) {
+  } else if (ConfigItem::PropertyKind::Frequency == kind) {
     if (! this->processFrequency(item, prop, err)) {
       errMsg(err) << "While processing frequency '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("Interval") == prop.typeName()) {
+  } else if (ConfigItem::PropertyKind::Interval == kind) {
     if (! this->processInterval(item, prop, err)) {
       errMsg(err) << "While processing frequency '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (ConfigObjectReference *ref = prop.read(item).value<ConfigObjectReference *>()) {
-    if (! this->processReference(ref, err)) {
+  } else if (ConfigItem::PropertyKind::Reference == kind) {
+    ConfigObjectReference *ref = prop.read(item).value<ConfigObjectReference *>();
+    if (ref && (! this->processReference(ref, err))) {
       errMsg(err) << "While processing reference '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (ConfigObjectRefList *refs = prop.read(item).value<ConfigObjectRefList *>()) {
-    if (! this->processList(refs, err)) {
+  } else if (ConfigItem::PropertyKind::RefList == kind) {
+    ConfigObjectRefList *refs = prop.read(item).value<ConfigObjectRefList *>();
+    if (refs && (! this->processList(refs, err))) {
       errMsg(err) << "While processing reference list '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (propIsInstance<ConfigItem>(prop)) {
+  } else if (ConfigItem::PropertyKind::Item == kind) {
     ConfigItem *pitem = prop.read(item).value<ConfigItem *>();
     // Some items, held as writeable properties might be null (e.g., extensions)
     if (prop.isWritable() && (nullptr == pitem))
       return true;
+    if (pitem && (! descend(pitem)))
+      return true;
     // Go for it
     if (! this->processItem(pitem, err)) {
       errMsg(err) << "While processing item '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (ConfigObjectList *lst = prop.read(item).value<ConfigObjectList *>()) {
-    if (! this->processList(lst, err)) {
+  } else if (ConfigItem::PropertyKind::ObjectList == kind) {
+    ConfigObjectList *lst = prop.read(item).value<ConfigObjectList *>();
+    if (lst && (! this->processList(lst, err))) {
       errMsg(err) << "While processing reference list '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
@@ -205,6 +221,8 @@ bool
 Visitor::processList(AbstractConfigObjectList *list, const ErrorStack &err) {
   if (ConfigObjectList *objList = qobject_cast<ConfigObjectList *>(list)) {
     for (int i=0; i<objList->count(); i++) {
+      if (! descend(objList->get(i)))
+        continue;
       if (! this->processItem(objList->get(i), err)) {
         errMsg(err) << "While processing object list.";
         return false;
@@ -214,3 +232,20 @@ Visitor::processList(AbstractConfigObjectList *list, const ErrorStack &err) {
   return true;
 }
 
+
+bool
+Visitor::descend(const ConfigItem *item) {
+  if (_types.isEmpty())
+    return true;
+
+  const QMetaObject *meta = item->metaObject();
+  auto entry = _descend.constFind(meta);
+  if (_descend.constEnd() != entry)
+    return entry.value();
+
+  bool result = ConfigItem::mayContainAny(meta, _types);
+  foreach (const QString &type, _types)
+    result = result || item->inherits(type.toLatin1().constData());
+  _descend.insert(meta, result);
+  return result;
+}
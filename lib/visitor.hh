@@ -2,6 +2,8 @@
 #define VISITOR_HH
 
 #include <QObject>
+#include <QHash>
+#include <QStringList>
 #include "errorstack.hh"
 
 // Forward declarations
@@ -15,12 +17,19 @@ class AbstractConfigObjectList;
  *
  *  This class can be used to implement a convenient tree taversal for the entry configuration.
  *
+ *  Visitors only interested in some types pass these to the constructor. The traversal then skips
+ *  all items and list elements, that are neither instances of these types nor may hold any
+ *  (see @c ConfigItem::mayContain). Lists are always passed to @c processList.
+ *
  * @ingroup config */
 class Visitor
 {
 protected:
-  /** Hidden constructor. */
+  /** Hidden constructor, the visitor traverses all items. */
   Visitor();
+  /** Hidden constructor, the visitor only traverses items that are or may hold instances of the
+   * given types. */
+  explicit Visitor(const std::initializer_list<QMetaObject> &types);
 
 public:
   /** Destructor. */
@@ -98,6 +107,17 @@ public:
   /** Handles references to config objects.
    * By default, the method will simply return @c true. The visitor does not follow references. */
   virtual bool processReference(ConfigObjectReference*, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Returns @c true if the traversal must descend into the given item. That is, if the visitor
+   * handles all types or if the item is or may hold an instance of the handled types. */
+  bool descend(const ConfigItem *item);
+
+protected:
+  /** The class names of the handled types, empty if all types are handled. */
+  QStringList _types;
+  /** Caches @c descend per class. */
+  QHash<const QMetaObject *, bool> _descend;
 };
 
 #endif // VISITOR_HH
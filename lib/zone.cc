@@ -18,18 +18,28 @@ Zone::Zone(QObject *parent)
   : ConfigObject(parent), _A(), _B(), _anytone(nullptr)
 {
   connect(&_A, SIGNAL(elementAdded(int)), this, SIGNAL(modified()));
+  connect(&_A, SIGNAL(elementsAdded(int,int)), this, SIGNAL(modified()));
+  connect(&_A, SIGNAL(elementsReset()), this, SIGNAL(modified()));
   connect(&_A, SIGNAL(elementRemoved(int)), this, SIGNAL(modified()));
   connect(&_B, SIGNAL(elementAdded(int)), this, SIGNAL(modified()));
+  connect(&_B, SIGNAL(elementsAdded(int,int)), this, SIGNAL(modified()));
+  connect(&_B, SIGNAL(elementsReset()), this, SIGNAL(modified()));
   connect(&_B, SIGNAL(elementRemoved(int)), this, SIGNAL(modified()));
+  connect(this, SIGNAL(modified()), this, SLOT(markDirty()));
 }
 
 Zone::Zone(const QString &name, QObject *parent)
   : ConfigObject(name, parent), _A(), _B(), _anytone(nullptr)
 {
   connect(&_A, SIGNAL(elementAdded(int)), this, SIGNAL(modified()));
+  connect(&_A, SIGNAL(elementsAdded(int,int)), this, SIGNAL(modified()));
+  connect(&_A, SIGNAL(elementsReset()), this, SIGNAL(modified()));
   connect(&_A, SIGNAL(elementRemoved(int)), this, SIGNAL(modified()));
   connect(&_B, SIGNAL(elementAdded(int)), this, SIGNAL(modified()));
+  connect(&_B, SIGNAL(elementsAdded(int,int)), this, SIGNAL(modified()));
+  connect(&_B, SIGNAL(elementsReset()), this, SIGNAL(modified()));
   connect(&_B, SIGNAL(elementRemoved(int)), this, SIGNAL(modified()));
+  connect(this, SIGNAL(modified()), this, SLOT(markDirty()));
 }
 
 Zone &
@@ -4,13 +4,24 @@
 #include <QDesktopServices>
 #include <QTranslator>
 #include <QStandardPaths>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QDir>
+#include <QTimer>
+#include <QTabWidget>
+#include <QVBoxLayout>
+#include <QLabel>
 
 #include "logger.hh"
 #include "radio.hh"
+#include "usbserial.hh"
+#include "devicemonitor.hh"
 #include "codeplug.hh"
+#include "objectarena.hh"
 #include "config.h"
 #include "settings.hh"
 #include "radiolimits.hh"
+#include "encodesession.hh"
 #include "verifydialog.hh"
 #include "analogchanneldialog.hh"
 #include "digitalchanneldialog.hh"
@@ -43,8 +54,54 @@
 #include "chirpformat.hh"
 #include "configmergedialog.hh"
 #include "configmergevisitor.hh"
+#include "configsnapshot.hh"
 
+#define AUTOSAVE_INTERVAL 30000  // Interval between autosave snapshots in ms
+#define RELOAD_DELAY 500          // Delay between a change of the codeplug file and its reload in ms
+#define CAPACITY_DELAY 200        // Delay between a change of the codeplug and the capacity update in ms
 
+
+inline QString getAutosavePath() {
+  return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)+"/autosave.snapshot";
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of Application::AutosaveWriter
+ * ********************************************************************************************* */
+/** Writes a serialized snapshot of the config into the autosave file. */
+class Application::AutosaveWriter: public QRunnable
+{
+public:
+  AutosaveWriter(const QString &filename, const QByteArray &snapshot)
+    : QRunnable(), _filename(filename), _snapshot(snapshot)
+  {
+    // pass...
+  }
+
+  void run() {
+    QDir().mkpath(QFileInfo(_filename).absolutePath());
+    QSaveFile file(_filename);
+    if (! file.open(QIODevice::WriteOnly)) {
+      logWarn() << "Cannot open autosave file '" << _filename << "': " << file.errorString() << ".";
+      return;
+    }
+    if ((_snapshot.size() != file.write(_snapshot)) || (! file.commit())) {
+      logWarn() << "Cannot write autosave file '" << _filename << "': " << file.errorString() << ".";
+      return;
+    }
+    logDebug() << "Autosaved codeplug to '" << _filename << "'.";
+  }
+
+protected:
+  QString _filename;
+  QByteArray _snapshot;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of Application
+ * ********************************************************************************************* */
 inline QStringList getLanguages() {
   QStringList languages = {QLocale::system().name()};
   if (languages.last().contains("_")) {
@@ -58,16 +115,24 @@ inline QString getLocalePath(const QString &language) {
 }
 
 Application::Application(int &argc, char *argv[])
-  : QApplication(argc, argv), _config(nullptr), _mainWindow(nullptr), _translator(nullptr),
-    _repeater(nullptr), _lastDevice()
+  : QApplication(argc, argv), _config(nullptr), _history(nullptr), _mainWindow(nullptr), _translator(nullptr),
+    _logFile(nullptr), _generalSettings(nullptr), _radioIdTab(nullptr), _contactList(nullptr),
+    _groupLists(nullptr), _channelList(nullptr), _zoneList(nullptr), _scanLists(nullptr),
+    _posSysList(nullptr), _roamingChannelList(nullptr), _roamingZoneList(nullptr),
+    _extensionView(nullptr), _radioIdPage(nullptr), _roamingZonePage(nullptr),
+    _extensionPage(nullptr), _deferredTabs(), _repeater(nullptr), _autosaveTimer(),
+    _autosavePending(false), _autosaver(), _watcher(), _codeplugFile(), _reloadTimer(),
+    _capacityLimits(nullptr), _capacityRadio(), _capacityTimer(), _lastDevice()
 {
+  _autosaver.setMaxThreadCount(1);
   setApplicationName("qdmr");
   setOrganizationName("DM3MAT");
   setOrganizationDomain("hmatuschek.github.io");
 
   // open logfile
   QString logdir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
-  Logger::get().addHandler(new FileLogHandler(logdir+"/qdmr.log"));
+  _logFile = new AsyncFileLogHandler(logdir+"/qdmr.log");
+  Logger::get().addHandler(_logFile);
 
   // register icon themes
   QStringList iconPaths = QIcon::themeSearchPaths();
@@ -90,10 +155,22 @@ Application::Application(int &argc, char *argv[])
   Settings settings;
   // load databases
   _repeater   = new RepeaterBookList(this);
-  _users      = new UserDatabase(30, this);
-  _talkgroups = new TalkGroupDatabase(30, this);
+  // parsing the databases takes a while, load them in the background
+  _users      = new UserDatabase(30, this, true);
+  _talkgroups = new TalkGroupDatabase(30, this, true);
   // create empty codeplug
   _config     = new Config(this);
+  // the history refers to the objects of the codeplug, drop it once these get replaced
+  _history    = new ConfigHistory(100, this);
+  connect(_config, SIGNAL(beginClear()), _history, SLOT(clear()));
+
+  // Keep track of the connected devices, radios get detected without enumerating all devices
+  if (DeviceMonitor *monitor = DeviceMonitor::acquire())
+    connect(monitor, SIGNAL(devicesChanged()), this, SLOT(onDevicesChanged()));
+
+  // Offer recovery of the last autosave, unless a codeplug file is given
+  if ((argc<2) && ConfigSnapshot::isSnapshot(getAutosavePath()))
+    QTimer::singleShot(0, this, SLOT(restoreAutosave()));
 
   // Handle args (if there are some)
   if (argc>1) {
@@ -111,11 +188,12 @@ Application::Application(int &argc, char *argv[])
       }
     } else if ("yaml" == info.suffix()) {
       ErrorStack err;
-      if (! _config->readYAML(argv[1], err)) {
+      if (! _config->readYAML(argv[1], err, true)) {
         logError() << "Cannot read yaml codeplug file '" << argv[1]
                    << "': " << err.format();
         return;
       }
+      watchCodeplug(info.absoluteFilePath());
     }
   }
 
@@ -131,17 +209,39 @@ Application::Application(int &argc, char *argv[])
     }
   }
 
-  // Check if updated
-  _releaseNotes.checkForUpdate();
+  // Check if updated, once the event loop is running and the main window is shown
+  QTimer::singleShot(0, &_releaseNotes, &ReleaseNotes::checkForUpdate);
 
   logDebug() << "Last known position: " << _currentPosition.toString();
   connect(_config, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModifed()));
+
+  _autosaveTimer.setInterval(AUTOSAVE_INTERVAL);
+  connect(&_autosaveTimer, SIGNAL(timeout()), this, SLOT(autosave()));
+  _autosaveTimer.start();
+
+  _reloadTimer.setSingleShot(true);
+  _reloadTimer.setInterval(RELOAD_DELAY);
+  connect(&_watcher, SIGNAL(fileChanged(QString)), &_reloadTimer, SLOT(start()));
+  connect(&_reloadTimer, SIGNAL(timeout()), this, SLOT(reloadCodeplug()));
+
+  _capacityTimer.setSingleShot(true);
+  _capacityTimer.setInterval(CAPACITY_DELAY);
+  connect(&_capacityTimer, SIGNAL(timeout()), this, SLOT(updateCapacity()));
 }
 
 Application::~Application() {
+  // Pending autosave writers must be done before the snapshot gets removed
+  _autosaver.waitForDone();
+
   if (_mainWindow)
     delete _mainWindow;
   _mainWindow = nullptr;
+
+  DeviceMonitor::release();
+
+  // Write pending log messages
+  Logger::get().remHandler(_logFile);
+  delete _logFile;
 }
 
 bool
@@ -175,6 +275,11 @@ Application::talkgroup() const {
   return _talkgroups;
 }
 
+ConfigHistory *
+Application::history() const {
+  return _history;
+}
+
 RepeaterBookList *Application::repeater() const{
   return _repeater;
 }
@@ -200,11 +305,18 @@ Application::createMainWindow() {
   _mainWindow->statusBar()->addPermanentWidget(progress);
   progress->setVisible(false);
 
+  QLabel *capacity = new QLabel();
+  capacity->setObjectName("capacity");
+  _mainWindow->statusBar()->addPermanentWidget(capacity);
+  capacity->setVisible(false);
+
   QAction *newCP   = _mainWindow->findChild<QAction*>("actionNewCodeplug");
   QAction *loadCP  = _mainWindow->findChild<QAction*>("actionOpenCodeplug");
   QAction *saveCP  = _mainWindow->findChild<QAction*>("actionSaveCodeplug");
   QAction *exportCP = _mainWindow->findChild<QAction*>("actionExportToCHIRP");
   QAction *importCP = _mainWindow->findChild<QAction*>("actionImport");
+  QAction *undoCP  = _mainWindow->findChild<QAction*>("actionUndo");
+  QAction *redoCP  = _mainWindow->findChild<QAction*>("actionRedo");
 
   QAction *findDev = _mainWindow->findChild<QAction*>("actionDetectDevice");
   QAction *verCP   = _mainWindow->findChild<QAction*>("actionVerifyCodeplug");
@@ -225,6 +337,9 @@ Application::createMainWindow() {
   connect(saveCP, SIGNAL(triggered()), this, SLOT(saveCodeplug()));
   connect(exportCP, SIGNAL(triggered()), this, SLOT(exportCodeplugToChirp()));
   connect(importCP, SIGNAL(triggered()), this, SLOT(importCodeplug()));
+  connect(undoCP, SIGNAL(triggered()), this, SLOT(undo()));
+  connect(redoCP, SIGNAL(triggered()), this, SLOT(redo()));
+  connect(_history, SIGNAL(changed()), this, SLOT(onHistoryChanged()));
   connect(quit, SIGNAL(triggered()), this, SLOT(quitApplication()));
   connect(about, SIGNAL(triggered()), this, SLOT(showAbout()));
   connect(sett, SIGNAL(triggered()), this, SLOT(showSettings()));
@@ -255,60 +370,71 @@ Application::createMainWindow() {
     _generalSettings->hideExtensions(true);
   }
 
-  // Wire-up "Radio IDs" view
-  _radioIdTab = new RadioIDListView(_config);
-  tabs->addTab(_radioIdTab, tr("Radio IDs"));
-
-  // Wire-up "Contact List" view
-  _contactList = new ContactListView(_config);
-  tabs->addTab(_contactList, tr("Contacts"));
-
-  // Wire-up "RX Group List" view
-  _groupLists = new GroupListsView(_config);
-  tabs->addTab(_groupLists, tr("Group Lists"));
-
-  // Wire-up "Channel List" view
-  _channelList = new ChannelListView(_config);
-  tabs->addTab(_channelList, tr("Channels"));
-
-  // Wire-up "Zone List" view
-  _zoneList = new ZoneListView(_config);
-  tabs->addTab(_zoneList, tr("Zones"));
-
-  // Wire-up "Scan List" view
-  _scanLists = new ScanListsView(_config);
-  tabs->addTab(_scanLists, tr("Scan Lists"));
-
-  // Wire-up "GPS System List" view
-  _posSysList = new PositioningSystemListView(_config);
-  tabs->addTab(_posSysList, tr("GPS/APRS"));
-
-  // Wire-up "Roaming Zone List" view
-  _roamingChannelList = new RoamingChannelListView(_config);
-  tabs->addTab(_roamingChannelList, tr("Roaming Channels"));
-
-  // Wire-up "Roaming Zone List" view
-  _roamingZoneList = new RoamingZoneListView(_config);
-  tabs->addTab(_roamingZoneList, tr("Roaming Zones"));
-
-  // Wire-up "extension view"
-  _extensionView = new ExtensionView();
-  _extensionView->setObject(_config, _config);
-  tabs->addTab(_extensionView, tr("Extensions"));
+  // All other views are created on first activation of their tab, only the page widgets are
+  // created here.
+  _radioIdPage = addDeferredTab(tabs, tr("Radio IDs"), [this]() {
+    return _radioIdTab = new RadioIDListView(_config); });
+  addDeferredTab(tabs, tr("Contacts"), [this]() {
+    return _contactList = new ContactListView(_config); });
+  addDeferredTab(tabs, tr("Group Lists"), [this]() {
+    return _groupLists = new GroupListsView(_config); });
+  addDeferredTab(tabs, tr("Channels"), [this]() {
+    return _channelList = new ChannelListView(_config); });
+  addDeferredTab(tabs, tr("Zones"), [this]() {
+    return _zoneList = new ZoneListView(_config); });
+  addDeferredTab(tabs, tr("Scan Lists"), [this]() {
+    return _scanLists = new ScanListsView(_config); });
+  addDeferredTab(tabs, tr("GPS/APRS"), [this]() {
+    return _posSysList = new PositioningSystemListView(_config); });
+  addDeferredTab(tabs, tr("Roaming Channels"), [this]() {
+    return _roamingChannelList = new RoamingChannelListView(_config); });
+  _roamingZonePage = addDeferredTab(tabs, tr("Roaming Zones"), [this]() {
+    return _roamingZoneList = new RoamingZoneListView(_config); });
+  _extensionPage = addDeferredTab(tabs, tr("Extensions"), [this]() {
+    _extensionView = new ExtensionView();
+    _extensionView->setObject(_config, _config);
+    return _extensionView;
+  });
 
   if (! settings.showCommercialFeatures()) {
-    tabs->removeTab(tabs->indexOf(_radioIdTab));
-    _radioIdTab->setHidden(true);
+    tabs->removeTab(tabs->indexOf(_radioIdPage));
+    _radioIdPage->setHidden(true);
   }
   if (! settings.showExtensions()) {
-    tabs->removeTab(tabs->indexOf(_extensionView));
-    _extensionView->setHidden(true);
+    tabs->removeTab(tabs->indexOf(_extensionPage));
+    _extensionPage->setHidden(true);
   }
 
+  connect(tabs, SIGNAL(currentChanged(int)), this, SLOT(onTabChanged(int)));
+
   _mainWindow->restoreGeometry(settings.mainWindowState());
   return _mainWindow;
 }
 
+QWidget *
+Application::addDeferredTab(QTabWidget *tabs, const QString &label,
+                            const std::function<QWidget *()> &factory) {
+  QWidget *page = new QWidget();
+  QVBoxLayout *layout = new QVBoxLayout();
+  layout->setContentsMargins(0,0,0,0);
+  page->setLayout(layout);
+  _deferredTabs.insert(page, factory);
+  tabs->addTab(page, label);
+  return page;
+}
+
+void
+Application::onTabChanged(int index) {
+  QTabWidget *tabs = qobject_cast<QTabWidget *>(sender());
+  if (nullptr == tabs)
+    return;
+  QWidget *page = tabs->widget(index);
+  if ((nullptr == page) || (! _deferredTabs.contains(page)))
+    return;
+  logDebug() << "Create view for tab '" << tabs->tabText(index) << "'.";
+  page->layout()->addWidget(_deferredTabs.take(page)());
+}
+
 
 void
 Application::newCodeplug() {
@@ -322,6 +448,8 @@ Application::newCodeplug() {
 
   _config->clear();
   _config->setModified(false);
+  discardAutosave();
+  watchCodeplug(QString());
 }
 
 
@@ -358,17 +486,20 @@ Application::loadCodeplug() {
 
   if ("yaml" == info.suffix()){
     ErrorStack err;
-    if (_config->readYAML(filename, err)) {
+    if (_config->readYAML(filename, err, true)) {
       _mainWindow->setWindowModified(false);
+      watchCodeplug(info.absoluteFilePath());
     } else {
       QMessageBox::critical(nullptr, tr("Cannot read codeplug."),
                             tr("Cannot read codeplug from file '%1': %2")
                             .arg(filename).arg(err.format()));
       _config->clear();
+      watchCodeplug(QString());
     }
   } else {
     QString errorMessage;
     QTextStream stream(&file);
+    watchCodeplug(QString());
     if (_config->readCSV(stream, errorMessage)) {
       _mainWindow->setWindowModified(false);
     } else {
@@ -405,7 +536,8 @@ Application::saveCodeplug() {
   if ((!filename.endsWith(".yaml")) && (!filename.endsWith(".yml")))
     filename.append(".yaml");
 
-  QFile file(filename);
+  // The codeplug gets streamed into the file, only replace the file if complete.
+  QSaveFile file(filename);
   if (! file.open(QIODevice::WriteOnly)) {
     QMessageBox::critical(nullptr, tr("Cannot open file"),
                           tr("Cannot save codeplug to file '%1': %2").arg(filename).arg(file.errorString()));
@@ -415,15 +547,21 @@ Application::saveCodeplug() {
   QTextStream stream(&file);
   QFileInfo info(filename);
   if (_config->toYAML(stream)) {
-    _mainWindow->setWindowModified(false);
+    stream.flush();
+    if (file.commit()) {
+      _mainWindow->setWindowModified(false);
+      discardAutosave();
+      watchCodeplug(info.absoluteFilePath());
+    } else {
+      QMessageBox::critical(nullptr, tr("Cannot save codeplug"),
+                            tr("Cannot save codeplug to file '%1': %2").arg(filename).arg(file.errorString()));
+    }
   } else {
+    file.cancelWriting();
     QMessageBox::critical(nullptr, tr("Cannot save codeplug"),
                           tr("Cannot save codeplug to file '%1'.").arg(filename));
   }
 
-  file.flush();
-  file.close();
-
   settings.setLastDirectoryDir(info.absoluteDir());
 }
 
@@ -515,8 +653,13 @@ Application::importCodeplug() {
     return;
 
   logDebug() << "Merging codeplugs ...";
-  if (! ConfigMerge::mergeInto(_config, &merging, mergeDialog.itemStrategy(),
-                               mergeDialog.setStrategy(), err)) {
+  bool merged;
+  {
+    Config::BulkUpdate update(_config);
+    merged = ConfigMerge::mergeInto(_config, &merging, mergeDialog.itemStrategy(),
+                                    mergeDialog.setStrategy(), err);
+  }
+  if (! merged) {
     QMessageBox::critical(nullptr, tr("Cannot import codeplug"),
                           tr("Cannot import codeplug from '%1': %2")
                           .arg(filename).arg(err.format()));
@@ -541,6 +684,8 @@ Application::quitApplication() {
   if (_mainWindow)
     settings.setMainWindowState(_mainWindow->saveGeometry());
 
+  // Changes are discarded explicitly, nothing to recover on next start
+  discardAutosave();
   quit();
 }
 
@@ -548,6 +693,7 @@ Application::quitApplication() {
 Radio *
 Application::autoDetect(const ErrorStack &err) {
   Settings settings;
+  USBSerial::setLowLatency(settings.lowLatencySerial());
   // If the last detected device is still valid
   //  -> skip interface detection and selection
   if ((! _lastDevice.isValid()) || settings.disableAutoDetect()) {
@@ -593,6 +739,16 @@ Application::autoDetect(const ErrorStack &err) {
   return radio;
 }
 
+void
+Application::onDevicesChanged() {
+  // Forget the last device once it got disconnected, the next detection then picks up the
+  // connected radios.
+  if ((! _lastDevice.USBDeviceInfo::isValid()) || _lastDevice.isValid())
+    return;
+  logDebug() << "Last device " << _lastDevice.description() << " got disconnected.";
+  _lastDevice = USBDeviceDescriptor();
+}
+
 void
 Application::detectRadio() {
   if (Radio *radio = autoDetect()) {
@@ -621,36 +777,50 @@ Application::verifyCodeplug(Radio *radio, bool showSuccess) {
     return false;
   }
 
+  // Verification does not modify the config, it only gets copied if rewritten.
   ErrorStack err;
-  Config *intermediate = myRadio->codeplug().preprocess(_config, err);
-  if (nullptr == intermediate) {
+  EncodeSession session(_config, myRadio->codeplug());
+  if (nullptr == session.config(err)) {
     ErrorMessageView(err).exec();
+    if (nullptr == radio)
+      myRadio->deleteLater();
     return false;
   }
 
+  bool verified = verifySession(myRadio, &session, showSuccess, nullptr != radio);
+
+  // If no radio was given -> close connection to radio again
+  if (nullptr == radio)
+    myRadio->deleteLater();
+
+  return verified;
+}
+
+bool
+Application::verifySession(Radio *radio, EncodeSession *session, bool showSuccess, bool upload) {
+  // The session only uses the cache if the current config gets verified as is.
   Settings settings;
-  RadioLimitContext ctx(settings.ignoreFrequencyLimits());
-  myRadio->limits().verifyConfig(intermediate, ctx);
+  _verifyCache.setKey(radio->name());
+  const RadioLimitContext &ctx = session->verify(radio->limits(), &_verifyCache,
+                                                 settings.ignoreFrequencyLimits());
+
+  // From now on, show the use of the capacity of this radio
+  _capacityLimits = &radio->limits();
+  _capacityRadio = radio->name();
+  updateCapacity();
 
   bool verified = true;
   if ( (settings.ignoreVerificationWarning() && (ctx.maxSeverity()>RadioLimitIssue::Warning)) ||
        ((!settings.ignoreVerificationWarning()) && (ctx.maxSeverity()>=RadioLimitIssue::Warning)) ) {
-    VerifyDialog dialog(ctx, (nullptr != radio));
+    VerifyDialog dialog(ctx, upload);
     if (QDialog::Accepted != dialog.exec())
       verified = false;
   } else if (showSuccess) {
     QMessageBox::information(
           nullptr, tr("Verification success"),
-          tr("The codeplug was successfully verified with the radio '%1'").arg(myRadio->name()));
+          tr("The codeplug was successfully verified with the radio '%1'").arg(radio->name()));
   }
 
-  // Delete intermediate representation
-  delete intermediate;
-
-  // If no radio was given -> close connection to radio again
-  if (nullptr == radio)
-    myRadio->deleteLater();
-
   return verified;
 }
 
@@ -677,6 +847,9 @@ Application::downloadCodeplug() {
 
   QProgressBar *progress = _mainWindow->findChild<QProgressBar *>("progress");
   progress->setValue(0); progress->setMaximum(100); progress->setVisible(true);
+  // The detection may wait for the user, hence only the transfer itself is recorded.
+  _transfer.start("read");
+  _transfer.attach(radio);
   connect(radio, SIGNAL(downloadProgress(int)), progress, SLOT(setValue(int)));
   connect(radio, SIGNAL(downloadError(Radio *)), this, SLOT(onCodeplugDownloadError(Radio *)));
   connect(radio, SIGNAL(downloadFinished(Radio *, Codeplug *)), this, SLOT(onCodeplugDownloaded(Radio *, Codeplug *)));
@@ -693,6 +866,7 @@ Application::downloadCodeplug() {
 
 void
 Application::onCodeplugDownloadError(Radio *radio) {
+  recordTransfer(false);
   _mainWindow->statusBar()->showMessage(tr("Read error"));
   ErrorMessageView(radio->errorStack()).exec();
   _mainWindow->findChild<QProgressBar *>("progress")->setVisible(false);
@@ -707,22 +881,28 @@ Application::onCodeplugDownloadError(Radio *radio) {
 
 void
 Application::onCodeplugDownloaded(Radio *radio, Codeplug *codeplug) {
-  _config->clear();
-  _mainWindow->setWindowModified(false);
-
+  recordTransfer(true);
   ErrorStack err;
-  if (codeplug->decode(_config, err)) {
+  bool success = true;
+  {
+    // Decode as a single update, such that the views get reset only once.
+    Config::BulkUpdate update(_config);
+    ObjectArena::Scope arena;
+    _config->clear();
+    if ((! codeplug->decode(_config, err)) || (! codeplug->postprocess(_config, err))) {
+      _config->clear();
+      success = false;
+    }
+  }
+
+  if (success) {
     _mainWindow->statusBar()->showMessage(tr("Read complete"));
     _mainWindow->findChild<QProgressBar *>("progress")->setVisible(false);
     _config->setModified(false);
+    _mainWindow->setWindowModified(false);
+    watchCodeplug(QString());
   } else {
     ErrorMessageView(err).exec();
-    _config->clear();
-  }
-
-  if (! codeplug->postprocess(_config, err)) {
-    ErrorMessageView(err).exec();
-    _config->clear();
   }
 
   _mainWindow->setEnabled(true);
@@ -743,7 +923,16 @@ Application::uploadCodeplug() {
     return;
   }
 
-  if (! verifyCodeplug(radio, false)) {
+  // The session preprocesses the config only once, the result gets verified and uploaded. If
+  // the config is not rewritten, the current config gets verified to make use of the
+  // verification cache.
+  ErrorStack err;
+  EncodeSession *session = new EncodeSession(_config, radio->codeplug());
+  if ((nullptr == session->config(err)) || (! verifySession(radio, session, false, true))
+      || (nullptr == session->uploadConfig(err))) {
+    if (! err.isEmpty())
+      ErrorMessageView(err).exec();
+    delete session;
     radio->deleteLater();
     return;
   }
@@ -753,19 +942,14 @@ Application::uploadCodeplug() {
   progress->setMaximum(100);
   progress->setVisible(true);
 
+  _transfer.start("write");
+  _transfer.attach(radio);
   connect(radio, SIGNAL(uploadProgress(int)), progress, SLOT(setValue(int)));
   connect(radio, SIGNAL(uploadError(Radio *)), this, SLOT(onCodeplugUploadError(Radio *)));
   connect(radio, SIGNAL(uploadComplete(Radio *)), this, SLOT(onCodeplugUploaded(Radio *)));
 
-  ErrorStack err;
-  Config *intermediate = radio->codeplug().preprocess(_config, err);
-  if (nullptr == intermediate) {
-    ErrorMessageView(err).exec();
-    progress->setVisible(false);
-    return;
-  }
-
-  if (radio->startUpload(intermediate, false, settings.codePlugFlags(), err)) {
+  // The radio takes ownership of the session.
+  if (radio->startUploadSession(session, false, settings.codePlugFlags(), err)) {
      _mainWindow->statusBar()->showMessage(tr("Upload ..."));
      _mainWindow->setEnabled(false);
   } else {
@@ -776,6 +960,12 @@ Application::uploadCodeplug() {
 
 void
 Application::uploadCallsignDB() {
+  if (_users->isLoading()) {
+    QMessageBox::information(nullptr, tr("User database not loaded yet"),
+                             tr("The user database is still being loaded. Please try again in a moment."));
+    return;
+  }
+
   // Start upload
   Radio *radio = autoDetect();
   if (nullptr == radio) {
@@ -806,6 +996,8 @@ Application::uploadCallsignDB() {
   // Sort call-sign DB w.r.t. the current DMR ID in _config
   // this is part of the "auto-selection" of calls-signs for upload
   Settings settings;
+  // Only the first entries need to be sorted, if the number of entries is limited
+  int limit = settings.limitCallSignDBEntries() ? int(settings.maxCallSignDBEntries()) : -1;
   if (settings.selectUsingUserDMRID()) {
     if (nullptr == _config->settings()->defaultId()) {
       QMessageBox::critical(nullptr, tr("Cannot write call-sign DB."),
@@ -817,14 +1009,14 @@ Application::uploadCallsignDB() {
     // Sort w.r.t users DMR ID
     unsigned id = _config->settings()->defaultId()->number();
     logDebug() << "Sort call-signs closest to ID=" << id << ".";
-    _users->sortUsers(id);
+    _users->sortUsers(id, limit);
   } else {
     // sort w.r.t. chosen prefixes
     QSet<unsigned> ids=settings.callSignDBPrefixes(); QStringList prefs;
     foreach (unsigned pref, ids)
       prefs.append(QString::number(pref));
     logDebug() << "Sort call-signs closest to IDs={" << prefs.join(", ") << "}.";
-    _users->sortUsers(ids);
+    _users->sortUsers(ids, limit);
   }
 
   // Assemble flags for callsign DB encoding
@@ -838,6 +1030,8 @@ Application::uploadCallsignDB() {
   progress->setRange(0, 100); progress->setValue(0);
   progress->setVisible(true);
 
+  _transfer.start("write-db");
+  _transfer.attach(radio);
   connect(radio, SIGNAL(uploadProgress(int)), progress, SLOT(setValue(int)));
   connect(radio, SIGNAL(uploadError(Radio *)), this, SLOT(onCodeplugUploadError(Radio *)));
   connect(radio, SIGNAL(uploadComplete(Radio *)), this, SLOT(onCodeplugUploaded(Radio *)));
@@ -856,6 +1050,7 @@ Application::uploadCallsignDB() {
 
 void
 Application::onCodeplugUploadError(Radio *radio) {
+  recordTransfer(false);
   _mainWindow->statusBar()->showMessage(tr("Write error"));
   ErrorMessageView(radio->errorStack()).exec();
   _mainWindow->findChild<QProgressBar *>("progress")->setVisible(false);
@@ -868,6 +1063,7 @@ Application::onCodeplugUploadError(Radio *radio) {
 
 void
 Application::onCodeplugUploaded(Radio *radio) {
+  recordTransfer(true);
   _mainWindow->statusBar()->showMessage(tr("Write complete"));
   _mainWindow->findChild<QProgressBar *>("progress")->setVisible(false);
   _mainWindow->setEnabled(true);
@@ -879,6 +1075,19 @@ Application::onCodeplugUploaded(Radio *radio) {
 }
 
 
+void
+Application::recordTransfer(bool success) {
+  if (! _transfer.isRunning())
+    return;
+  PerformanceHistory::Record record = _transfer.finish(success);
+  if (! Settings().recordPerformance())
+    return;
+  ErrorStack err;
+  if (! PerformanceHistory().append(record, err))
+    logWarn() << "Cannot record transfer: " << err.format();
+}
+
+
 void
 Application::showSettings() {
   SettingsDialog dialog;
@@ -896,35 +1105,51 @@ Application::showSettings() {
     // Handle commercial features
     QTabWidget *tabs = _mainWindow->findChild<QTabWidget*>("tabs");
     if (settings.showCommercialFeatures()) {
-      if (-1 == tabs->indexOf(_radioIdTab)) {
-        tabs->insertTab(tabs->indexOf(_generalSettings)+1, _radioIdTab, tr("Radio IDs"));
+      if (-1 == tabs->indexOf(_radioIdPage)) {
+        tabs->insertTab(tabs->indexOf(_generalSettings)+1, _radioIdPage, tr("Radio IDs"));
         _mainWindow->update();
       }
       _generalSettings->hideDMRID(true);
     } else if (! settings.showCommercialFeatures()) {
-      if (-1 != tabs->indexOf(_radioIdTab)) {
-        tabs->removeTab(tabs->indexOf(_radioIdTab));
+      if (-1 != tabs->indexOf(_radioIdPage)) {
+        tabs->removeTab(tabs->indexOf(_radioIdPage));
         _mainWindow->update();
       }
       _generalSettings->hideDMRID(false);
     }
     // Handle extensions
     if (settings.showExtensions()) {
-      if (-1 == tabs->indexOf(_extensionView)) {
-        tabs->insertTab(tabs->indexOf(_roamingZoneList)+1, _extensionView, tr("Extensions"));
+      if (-1 == tabs->indexOf(_extensionPage)) {
+        tabs->insertTab(tabs->indexOf(_roamingZonePage)+1, _extensionPage, tr("Extensions"));
         _mainWindow->update();
       }
       _generalSettings->hideExtensions(false);
     } else {
-      if (-1 != tabs->indexOf(_extensionView)) {
-        tabs->removeTab(tabs->indexOf(_extensionView));
+      if (-1 != tabs->indexOf(_extensionPage)) {
+        tabs->removeTab(tabs->indexOf(_extensionPage));
         _mainWindow->update();
       }
       _generalSettings->hideExtensions(true);
     }
+    // Start or stop watching the codeplug file
+    watchCodeplug(_codeplugFile);
   }
 }
 
+/** Turns a memory usage report into a tree of items for the diagnostics page. */
+static QTreeWidgetItem *
+memoryUsageItem(const MemoryUsage &usage) {
+  QTreeWidgetItem *item = new QTreeWidgetItem(
+        QStringList({usage.name(), MemoryUsage::formatBytes(usage.bytes()),
+                     (0 <= usage.count()) ? QString::number(usage.count()) : QString(),
+                     usage.note()}));
+  item->setTextAlignment(1, Qt::AlignRight);
+  item->setTextAlignment(2, Qt::AlignRight);
+  foreach (const MemoryUsage &child, usage.children())
+    item->addChild(memoryUsageItem(child));
+  return item;
+}
+
 void
 Application::showAbout() {
   QUiLoader loader;
@@ -955,6 +1180,17 @@ Application::showAbout() {
   radioTab->insertTopLevelItems(0, items.values());
   radioTab->sortByColumn(0,Qt::AscendingOrder);
 
+  // Diagnostics: Memory held by the config and the databases
+  QTreeWidget *memoryTable = new QTreeWidget();
+  memoryTable->setHeaderLabels({tr("Part"), tr("Memory"), tr("Entries"), tr("Details")});
+  QList<MemoryUsage> usages = { _config->memoryUsage(), _users->memoryUsage(),
+                                _talkgroups->memoryUsage(), _repeater->memoryUsage() };
+  foreach (const MemoryUsage &usage, usages)
+    memoryTable->addTopLevelItem(memoryUsageItem(usage));
+  memoryTable->expandToDepth(0);
+  memoryTable->resizeColumnToContents(0);
+  dialog->findChild<QTabWidget *>("tabWidget")->addTab(memoryTable, tr("Diagnostics"));
+
   if (dialog) {
     dialog->exec();
     dialog->deleteLater();
@@ -967,12 +1203,178 @@ Application::showHelp() {
 }
 
 
+void
+Application::undo() {
+  ErrorStack err;
+  if (! _history->undo(err))
+    logWarn() << err.format();
+}
+
+void
+Application::redo() {
+  ErrorStack err;
+  if (! _history->redo(err))
+    logWarn() << err.format();
+}
+
+void
+Application::onHistoryChanged() {
+  if (! _mainWindow)
+    return;
+
+  QAction *undoCP = _mainWindow->findChild<QAction*>("actionUndo");
+  QAction *redoCP = _mainWindow->findChild<QAction*>("actionRedo");
+  undoCP->setEnabled(_history->canUndo());
+  undoCP->setText(_history->canUndo() ? tr("Undo %1").arg(_history->undoLabel()) : tr("Undo"));
+  redoCP->setEnabled(_history->canRedo());
+  redoCP->setText(_history->canRedo() ? tr("Redo %1").arg(_history->redoLabel()) : tr("Redo"));
+}
+
 void
 Application::onConfigModifed() {
   if (! _mainWindow)
     return;
 
   _mainWindow->setWindowModified(true);
+  _autosavePending = true;
+  if (_capacityLimits)
+    _capacityTimer.start();
+}
+
+void
+Application::updateCapacity() {
+  if ((! _mainWindow) || (nullptr == _capacityLimits))
+    return;
+
+  // Counting the elements is cheap, no codeplug gets encoded
+  QLabel *label = _mainWindow->findChild<QLabel *>("capacity");
+  RadioLimitUsage usage = _capacityLimits->estimateUsage(_config);
+  int fullest = usage.fullest();
+  if (0 > fullest) {
+    label->setVisible(false);
+    return;
+  }
+
+  const RadioLimitUsage::Section &section = usage.section(fullest);
+  QString text = tr("%1: %2 %3 of %4").arg(_capacityRadio).arg(section.name)
+      .arg(section.used).arg(section.capacity);
+  if (! usage.fits())
+    text = tr("%1 (does not fit)").arg(text);
+  label->setText(text);
+  label->setToolTip(usage.format());
+  label->setVisible(true);
+}
+
+void
+Application::autosave() {
+  if (! _autosavePending)
+    return;
+  _autosavePending = false;
+
+  // Serializing the config into memory is cheap and gives a consistent copy of the current state.
+  // Only writing the snapshot to disk happens in the background.
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  ErrorStack err;
+  if (! ConfigSnapshot::write(_config, buffer, err)) {
+    logWarn() << "Cannot create autosave snapshot: " << err.format();
+    return;
+  }
+  _autosaver.start(new AutosaveWriter(getAutosavePath(), buffer.data()));
+}
+
+void
+Application::discardAutosave() {
+  _autosavePending = false;
+  _autosaver.waitForDone();
+  QFile::remove(getAutosavePath());
+}
+
+void
+Application::restoreAutosave() {
+  QString filename = getAutosavePath();
+  if (QMessageBox::Yes != QMessageBox::question(
+        nullptr, tr("Recover codeplug?"),
+        tr("qdmr was not closed properly and there is an automatically saved codeplug from "
+           "%1. Do you want to recover it?").arg(QFileInfo(filename).lastModified().toString()),
+        QMessageBox::Yes|QMessageBox::No)) {
+    QFile::remove(filename);
+    return;
+  }
+
+  ErrorStack err;
+  if (! ConfigSnapshot::read(_config, filename, err)) {
+    QMessageBox::critical(nullptr, tr("Cannot recover codeplug"),
+                          tr("Cannot recover codeplug: %1").arg(err.format()));
+    return;
+  }
+  // Recovered changes are unsaved
+  _config->setModified(true);
+}
+
+void
+Application::watchCodeplug(const QString &filename) {
+  _reloadTimer.stop();
+  if (! _watcher.files().isEmpty())
+    _watcher.removePaths(_watcher.files());
+  _codeplugFile = filename;
+  if (_codeplugFile.isEmpty() || (! Settings().watchCodeplugFile()))
+    return;
+  if (! _watcher.addPath(_codeplugFile))
+    logWarn() << "Cannot watch codeplug file '" << _codeplugFile << "'.";
+}
+
+void
+Application::reloadCodeplug() {
+  if (_codeplugFile.isEmpty() || (nullptr == _mainWindow))
+    return;
+  // Editors often replace the file on save, which removes it from the watcher
+  if (! QFileInfo::exists(_codeplugFile))
+    return;
+  if (! _watcher.files().contains(_codeplugFile))
+    _watcher.addPath(_codeplugFile);
+
+  ErrorStack err;
+  Config changed;
+  if (! changed.readYAML(_codeplugFile, err)) {
+    // The file may be incomplete, wait for the next change
+    logWarn() << "Cannot reload codeplug file '" << _codeplugFile << "': " << err.format();
+    _mainWindow->statusBar()->showMessage(tr("Cannot reload changed codeplug file."));
+    return;
+  }
+  if (_config->hash() == changed.hash())
+    return;
+
+  if (_config->isModified()) {
+    if (QMessageBox::Ok != QMessageBox::question(nullptr, tr("Codeplug file changed."),
+                                                 tr("The codeplug file '%1' was changed by another program. "
+                                                    "Unsaved changes to the codeplug are lost if you reload it.")
+                                                 .arg(_codeplugFile),
+                                                 QMessageBox::Cancel|QMessageBox::Ok))
+      return;
+  }
+
+  // Apply the differences only, such that the views keep their state. The history may refer to
+  // the replaced values.
+  logDebug() << "Apply changes of codeplug file '" << _codeplugFile << "'.";
+  _history->clear();
+  if (! _config->apply(&changed, err)) {
+    logWarn() << "Cannot apply changes, reload codeplug: " << err.format();
+    ErrorStack reloadErr;
+    if (! _config->readYAML(_codeplugFile, reloadErr, true)) {
+      QMessageBox::critical(nullptr, tr("Cannot read codeplug."),
+                            tr("Cannot read codeplug from file '%1': %2")
+                            .arg(_codeplugFile).arg(reloadErr.format()));
+      _config->clear();
+      watchCodeplug(QString());
+      return;
+    }
+  }
+
+  _config->setModified(false);
+  _mainWindow->setWindowModified(false);
+  discardAutosave();
+  _mainWindow->statusBar()->showMessage(tr("Reloaded changed codeplug file."));
 }
 
 void
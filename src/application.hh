@@ -4,13 +4,23 @@
 #include <QApplication>
 #include <QGroupBox>
 #include <QIcon>
+#include <QHash>
+#include <QTimer>
+#include <QThreadPool>
+#include <QFileSystemWatcher>
+#include <functional>
 #include "config.hh"
 #include <QGeoPositionInfoSource>
 #include "releasenotes.hh"
 #include "radio.hh"
+#include "radiolimits.hh"
+#include "confighistory.hh"
+#include "performancehistory.hh"
 
 class QMainWindow;
 class QTranslator;
+class QTabWidget;
+class AsyncFileLogHandler;
 class RepeaterBookList;
 class UserDatabase;
 class TalkGroupDatabase;
@@ -30,6 +40,9 @@ class Application : public QApplication
 {
   Q_OBJECT
 
+protected:
+  class AutosaveWriter;
+
 public:
   Application(int &argc, char *argv[]);
   virtual ~Application();
@@ -39,6 +52,8 @@ public:
   UserDatabase *user() const;
   RepeaterBookList *repeater() const;
   TalkGroupDatabase *talkgroup() const;
+  /** Returns the edit history of the codeplug. Views record their edits there. */
+  ConfigHistory *history() const;
 
   bool hasPosition() const;
   QGeoCoordinate position() const;
@@ -54,6 +69,10 @@ public slots:
   void saveCodeplug();
   void exportCodeplugToChirp();
   void importCodeplug();
+  /** Reverts the last recorded edit. */
+  void undo();
+  /** Re-applies the last reverted edit. */
+  void redo();
   void quitApplication();
 
   void detectRadio();
@@ -77,15 +96,59 @@ private slots:
   void onCodeplugUploaded(Radio *radio);
 
   void onConfigModifed();
+  /** Updates the undo and redo actions. */
+  void onHistoryChanged();
+  /** Writes a snapshot of the config into the autosave file in the background, if the config
+   * was modified since the last snapshot. */
+  void autosave();
+  /** Offers the recovery of the autosave file left by a previous session. */
+  void restoreAutosave();
+  /** Applies the changes of the watched codeplug file, made by other programs. */
+  void reloadCodeplug();
+
+  /** Creates the view of the activated tab, if not done yet. */
+  void onTabChanged(int index);
 
   void positionUpdated(const QGeoPositionInfo &info);
 
   void onPaletteChanged(const QPalette &palette);
+  /** Forgets the last detected device, once it got disconnected. */
+  void onDevicesChanged();
+  /** Shows the estimated use of the capacity of the last verified radio in the status bar. */
+  void updateCapacity();
+
+protected:
+  /** Verifies the config of the given encode session for the given radio. Shows the verification
+   * dialog if there are issues. If @c upload is @c true, the dialog allows to proceed with the
+   * upload. */
+  bool verifySession(Radio *radio, EncodeSession *session, bool showSuccess, bool upload);
+  /** Finishes the record of the current transfer and appends it to the performance history, if
+   * enabled in the settings. */
+  void recordTransfer(bool success);
+
+  /** Adds an empty page to the given tab widget. The view is created by the given factory and
+   * placed into the page, once the tab gets activated for the first time. */
+  /** Removes the autosave file, e.g., once the codeplug was saved. */
+  void discardAutosave();
+  /** Sets the YAML file, the current codeplug was read from or saved to. If enabled in the
+   * settings, the file gets watched for changes. An empty filename stops watching. */
+  void watchCodeplug(const QString &filename);
+
+  QWidget *addDeferredTab(QTabWidget *tabs, const QString &label,
+                          const std::function<QWidget *()> &factory);
 
 protected:
   Config *_config;
+  /** The edit history of the codeplug. */
+  ConfigHistory *_history;
+  /** Caches the verification results of unchanged objects between verifications. */
+  RadioLimitCache _verifyCache;
+  /** Records the current transfer for the performance history. */
+  PerformanceHistory::Recorder _transfer;
   QMainWindow *_mainWindow;
   QTranslator *_translator;
+  /** The log file handler, gets flushed on destruction. */
+  AsyncFileLogHandler *_logFile;
 
   GeneralSettingsView *_generalSettings;
   RadioIDListView *_radioIdTab;
@@ -99,6 +162,13 @@ protected:
   RoamingZoneListView *_roamingZoneList;
   ExtensionView *_extensionView;
 
+  /** Tab pages, which are shown or hidden depending on the settings. */
+  QWidget *_radioIdPage;
+  QWidget *_roamingZonePage;
+  QWidget *_extensionPage;
+  /** Factories of the views, not created yet, by their tab page. */
+  QHash<QWidget *, std::function<QWidget *()>> _deferredTabs;
+
   RepeaterBookList *_repeater;
   UserDatabase *_users;
   TalkGroupDatabase *_talkgroups;
@@ -108,6 +178,28 @@ protected:
 
   ReleaseNotes _releaseNotes;
 
+  /** Triggers the periodic autosave. */
+  QTimer _autosaveTimer;
+  /** If @c true, the config was modified since the last autosave snapshot. */
+  bool _autosavePending;
+  /** Writes the autosave snapshots. */
+  QThreadPool _autosaver;
+
+  /** Watches the codeplug file for changes made by other programs. */
+  QFileSystemWatcher _watcher;
+  /** The YAML file, the codeplug was read from or saved to. */
+  QString _codeplugFile;
+  /** Delays the reload until the file stopped changing, editors may write in several steps. */
+  QTimer _reloadTimer;
+
+  /** The limits of the radio, the codeplug was verified with last. The limits are shared and
+   * never deleted. */
+  const RadioLimits *_capacityLimits;
+  /** The name of that radio. */
+  QString _capacityRadio;
+  /** Coalesces the updates of the capacity estimate during bulk edits. */
+  QTimer _capacityTimer;
+
   // Last detected device:
   USBDeviceDescriptor _lastDevice;
 };
@@ -1,5 +1,6 @@
 #include "channelcombobox.hh"
 #include "channel.hh"
+#include "configitemwrapper.hh"
 #include <QCompleter>
 
 
@@ -11,11 +12,9 @@ ChannelComboBox::ChannelComboBox(ChannelList *list, bool includeSelectedChannel,
 {
   setInsertPolicy(QComboBox::NoInsert);
   setEditable(true);
+  // The shared model follows the channel list, hence no items need to be created
+  setModel(ObjectSelectionModel::get(list, includeSelectedChannel ? SelectedChannel::get() : nullptr));
   completer()->setCompletionMode(QCompleter::PopupCompletion);
-  if (includeSelectedChannel)
-    addItem(SelectedChannel::get()->name(), QVariant::fromValue(SelectedChannel::get()));
-  for (int i=0; i<list->count(); i++)
-    addItem(list->channel(i)->name(), QVariant::fromValue(list->channel(i)));
 }
 
 Channel *
@@ -5,9 +5,12 @@
 #include "digitalchanneldialog.hh"
 #include "config.hh"
 #include "settings.hh"
+#include "application.hh"
 
 #include <QHeaderView>
 #include <QMessageBox>
+#include <QMenu>
+#include <QInputDialog>
 
 
 ChannelListView::ChannelListView(Config *config, QWidget *parent)
@@ -27,6 +30,22 @@ ChannelListView::ChannelListView(Config *config, QWidget *parent)
   connect(ui->cloneChannel, SIGNAL(clicked()), this, SLOT(onCloneChannel()));
   connect(ui->remChannel, SIGNAL(clicked()), this, SLOT(onRemChannel()));
   connect(ui->listView, SIGNAL(doubleClicked(unsigned)), this, SLOT(onEditChannel(unsigned)));
+
+  // Mass edits of the selected channels
+  QMenu *edit = new QMenu(ui->editChannels);
+  QMenu *power = edit->addMenu(tr("Power"));
+  power->addAction(tr("Max"))->setData(QVariant::fromValue(Channel::Power::Max));
+  power->addAction(tr("High"))->setData(QVariant::fromValue(Channel::Power::High));
+  power->addAction(tr("Mid"))->setData(QVariant::fromValue(Channel::Power::Mid));
+  power->addAction(tr("Low"))->setData(QVariant::fromValue(Channel::Power::Low));
+  power->addAction(tr("Min"))->setData(QVariant::fromValue(Channel::Power::Min));
+  connect(power, SIGNAL(triggered(QAction*)), this, SLOT(onSetPower(QAction*)));
+  QMenu *timeSlot = edit->addMenu(tr("Time Slot"));
+  timeSlot->addAction(tr("TS 1"))->setData(QVariant::fromValue(DMRChannel::TimeSlot::TS1));
+  timeSlot->addAction(tr("TS 2"))->setData(QVariant::fromValue(DMRChannel::TimeSlot::TS2));
+  connect(timeSlot, SIGNAL(triggered(QAction*)), this, SLOT(onSetTimeSlot(QAction*)));
+  edit->addAction(tr("Color Code ..."), this, SLOT(onSetColorCode()));
+  ui->editChannels->setMenu(edit);
 }
 
 ChannelListView::~ChannelListView() {
@@ -118,9 +137,11 @@ ChannelListView::onRemChannel() {
   QPair<int,int> rows = ui->listView->selection();
   int rowcount = rows.second-rows.first+1;
   if (rows.first == rows.second) {
-    QString name = _config->channelList()->channel(rows.first)->name();
-    if (QMessageBox::No == QMessageBox::question(
-          nullptr, tr("Delete channel?"), tr("Delete channel %1?").arg(name)))
+    Channel *channel = _config->channelList()->channel(rows.first);
+    QString text = tr("Delete channel %1?").arg(channel->name());
+    if (int uses = channel->useCount())
+      text = tr("Channel %1 is used %2 times. Delete it anyway?").arg(channel->name()).arg(uses);
+    if (QMessageBox::No == QMessageBox::question(nullptr, tr("Delete channel?"), text))
       return;
   } else {
     if (QMessageBox::No == QMessageBox::question(
@@ -143,17 +164,73 @@ ChannelListView::onEditChannel(unsigned row) {
   Channel *channel = _config->channelList()->channel(row);
   if (! channel)
     return;
+  ConfigHistory *history = qobject_cast<Application *>(QApplication::instance())->history();
   if (channel->is<FMChannel>()) {
     AnalogChannelDialog dialog(_config, channel->as<FMChannel>());
     if (QDialog::Accepted != dialog.exec())
       return;
+    history->begin(tr("edit channel"));
+    history->track(channel);
     dialog.channel();
+    history->commit();
   } else {
     DigitalChannelDialog dialog(_config, channel->as<DMRChannel>());
     if (QDialog::Accepted != dialog.exec())
       return;
+    history->begin(tr("edit channel"));
+    history->track(channel);
     dialog.channel();
+    history->commit();
+  }
+}
+
+void
+ChannelListView::onSetPower(QAction *action) {
+  applyToSelection("power", action->data());
+}
+
+void
+ChannelListView::onSetTimeSlot(QAction *action) {
+  applyToSelection("timeSlot", action->data());
+}
+
+void
+ChannelListView::onSetColorCode() {
+  if (! ui->listView->hasSelection()) {
+    QMessageBox::information(
+          nullptr, tr("Cannot edit channels"),
+          tr("Cannot edit channels: You have to select channels first."));
+    return;
+  }
+
+  bool ok = false;
+  int cc = QInputDialog::getInt(nullptr, tr("Set color code"),
+                                tr("Color code of all selected digital channels:"),
+                                1, 0, 15, 1, &ok);
+  if (ok)
+    applyToSelection("colorCode", QVariant::fromValue(unsigned(cc)));
+}
+
+void
+ChannelListView::applyToSelection(const char *property, const QVariant &value) {
+  if (! ui->listView->hasSelection()) {
+    QMessageBox::information(
+          nullptr, tr("Cannot edit channels"),
+          tr("Cannot edit channels: You have to select channels first."));
+    return;
+  }
+
+  ConfigHistory *history = qobject_cast<Application *>(QApplication::instance())->history();
+  history->begin(tr("edit channels"));
+  foreach (int row, ui->listView->selectedRows())
+    history->track(_config->channelList()->channel(row));
+
+  ErrorStack err;
+  if (0 > _config->channelList()->applyToAll(ui->listView->selectedRows(), property, value, err)) {
+    QMessageBox::critical(nullptr, tr("Cannot edit channels"),
+                          tr("Cannot edit channels: %1").arg(err.format()));
   }
+  history->commit();
 }
 
 void
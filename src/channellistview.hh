@@ -4,6 +4,7 @@
 #include <QWidget>
 
 class Config;
+class QAction;
 namespace Ui {
   class ChannelListView;
 }
@@ -22,11 +23,21 @@ protected slots:
   void onCloneChannel();
   void onRemChannel();
   void onEditChannel(unsigned row);
+  /** Sets the power of all selected channels. */
+  void onSetPower(QAction *action);
+  /** Sets the time slot of all selected DMR channels. */
+  void onSetTimeSlot(QAction *action);
+  /** Sets the color code of all selected DMR channels. */
+  void onSetColorCode();
   void loadChannelListSectionState();
   void storeChannelListSectionState();
 
 
 
+protected:
+  /** Sets the given property of all selected channels to the given value. */
+  void applyToSelection(const char *property, const QVariant &value);
+
 private:
   Ui::ChannelListView *ui;
   Config *_config;
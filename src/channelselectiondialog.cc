@@ -1,11 +1,12 @@
 #include "channelselectiondialog.hh"
 #include "channel.hh"
 #include "channelcombobox.hh"
+#include "configitemwrapper.hh"
 
 #include <QDialogButtonBox>
 #include <QLabel>
 #include <QVBoxLayout>
-#include <QListWidget>
+#include <QListView>
 
 
 /* ********************************************************************************************* *
@@ -38,31 +39,21 @@ ChannelSelectionDialog::channel() const {
 MultiChannelSelectionDialog::MultiChannelSelectionDialog(ChannelList *lst, bool includeSelectedChannel, bool digitalOnly, QWidget *parent)
   : QDialog(parent)
 {
-  _channel = new QListWidget();
-  if (includeSelectedChannel) {
-    QListWidgetItem *item = new QListWidgetItem(tr("[Selected]"));
-    item->setFlags(Qt::ItemIsUserCheckable|Qt::ItemIsEnabled);
-    item->setData(Qt::UserRole, QVariant::fromValue(SelectedChannel::get()));
-    item->setCheckState(Qt::Unchecked);
-    _channel->addItem(item);
-  }
-  for (int i=0; i<lst->count(); i++) {
-    Channel *channel = lst->channel(i);
-    if (digitalOnly && channel->is<FMChannel>())
-      continue;
-    QListWidgetItem *item = new QListWidgetItem(channel->name());
-    item->setFlags(Qt::ItemIsUserCheckable|Qt::ItemIsEnabled);
-    item->setData(Qt::UserRole, QVariant::fromValue(channel));
-    item->setCheckState(Qt::Unchecked);
-    _channel->addItem(item);
-  }
+  _channels = new ObjectSelectionProxy(
+        ObjectSelectionModel::get(lst, includeSelectedChannel ? SelectedChannel::get() : nullptr),
+        true, this);
+  if (digitalOnly)
+    _channels->setFilter([](const ConfigObject *obj) { return ! obj->is<FMChannel>(); });
+  QListView *view = new QListView();
+  view->setUniformItemSizes(true);
+  view->setModel(_channels);
   QDialogButtonBox *bbox = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Cancel);
   connect(bbox, SIGNAL(accepted()), this, SLOT(accept()));
   connect(bbox, SIGNAL(rejected()), this, SLOT(reject()));
 
   QVBoxLayout *layout = new QVBoxLayout();
   layout->addWidget(new QLabel(tr("Select a channel:")));
-  layout->addWidget(_channel);
+  layout->addWidget(view);
   layout->addWidget(bbox);
   setLayout(layout);
 }
@@ -70,10 +61,8 @@ MultiChannelSelectionDialog::MultiChannelSelectionDialog(ChannelList *lst, bool
 QList<Channel *>
 MultiChannelSelectionDialog::channel() const {
   QList<Channel *> channels;
-  for (int i=0; i<_channel->count(); i++) {
-    if (Qt::Checked == _channel->item(i)->checkState())
-      channels.push_back(_channel->item(i)->data(Qt::UserRole).value<Channel *>());
-  }
+  foreach (ConfigObject *obj, _channels->checked())
+    channels.push_back(obj->as<Channel>());
   return channels;
 }
 
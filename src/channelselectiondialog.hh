@@ -6,7 +6,7 @@
 class Channel;
 class ChannelList;
 class ChannelComboBox;
-class QListWidget;
+class ObjectSelectionProxy;
 
 class ChannelSelectionDialog: public QDialog
 {
@@ -33,7 +33,7 @@ public:
   QList<Channel *> channel() const;
 
 protected:
-  QListWidget *_channel;
+  ObjectSelectionProxy *_channels;
 };
 
 
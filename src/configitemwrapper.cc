@@ -18,7 +18,10 @@ GenericListWrapper::GenericListWrapper(AbstractConfigObjectList *list, QObject *
 
   connect(_list, SIGNAL(destroyed(QObject*)), this, SLOT(onListDeleted()));
   connect(_list, SIGNAL(elementAdded(int)), this, SLOT(onItemAdded(int)));
+  connect(_list, SIGNAL(elementsAdded(int,int)), this, SLOT(onItemsAdded(int,int)));
+  connect(_list, SIGNAL(elementsReset()), this, SLOT(onItemsReset()));
   connect(_list, SIGNAL(elementModified(int)), this, SLOT(onItemModified(int)));
+  connect(_list, SIGNAL(elementsModified(int,int)), this, SLOT(onItemsModified(int,int)));
   connect(_list, SIGNAL(elementRemoved(int)), this, SLOT(onItemRemoved(int)));
 }
 
@@ -78,6 +81,18 @@ GenericListWrapper::onItemAdded(int idx) {
   endInsertRows();
 }
 
+void
+GenericListWrapper::onItemsAdded(int first, int count) {
+  beginInsertRows(QModelIndex(), first, first+count-1);
+  endInsertRows();
+}
+
+void
+GenericListWrapper::onItemsReset() {
+  beginResetModel();
+  endResetModel();
+}
+
 void
 GenericListWrapper::onItemRemoved(int idx) {
   beginRemoveRows(QModelIndex(), idx, idx);
@@ -90,6 +105,11 @@ GenericListWrapper::onItemModified(int idx) {
   emit dataChanged(index(idx),index(idx));
 }
 
+void
+GenericListWrapper::onItemsModified(int first, int count) {
+  emit dataChanged(index(first),index(first+count-1));
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of GenericTableWrapper
@@ -102,8 +122,13 @@ GenericTableWrapper::GenericTableWrapper(AbstractConfigObjectList *list, QObject
 
   connect(_list, SIGNAL(destroyed(QObject*)), this, SLOT(onListDeleted()));
   connect(_list, SIGNAL(elementAdded(int)), this, SLOT(onItemAdded(int)));
+  connect(_list, SIGNAL(elementsAdded(int,int)), this, SLOT(onItemsAdded(int,int)));
+  connect(_list, SIGNAL(elementsReset()), this, SLOT(onItemsReset()));
   connect(_list, SIGNAL(elementModified(int)), this, SLOT(onItemModified(int)));
+  connect(_list, SIGNAL(elementsModified(int,int)), this, SLOT(onItemsModified(int,int)));
   connect(_list, SIGNAL(elementRemoved(int)), this, SLOT(onItemRemoved(int)));
+  if (const Config *config = _list->config())
+    connect(config, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModified()));
 }
 
 int
@@ -173,10 +198,30 @@ GenericTableWrapper::canDropMimeData(const QMimeData *data, Qt::DropAction actio
   return QAbstractTableModel::canDropMimeData(data, action, row, column, parent);
 }
 
+QVariant
+GenericTableWrapper::data(const QModelIndex &index, int role) const {
+  if ((Qt::DisplayRole != role) || (nullptr == _list) || (! index.isValid())
+      || (index.row() >= _list->count()))
+    return cellData(index, role);
+
+  const ConfigObject *obj = _list->get(index.row());
+  auto row = _displayCache.find(obj);
+  if (_displayCache.end() == row) {
+    // Compute all columns of the row at once
+    int columns = columnCount(QModelIndex());
+    QVector<QVariant> cells; cells.reserve(columns);
+    for (int c=0; c<columns; c++)
+      cells.append(cellData(this->index(index.row(), c), role));
+    row = _displayCache.insert(obj, cells);
+  }
+  return row->value(index.column());
+}
+
 void
 GenericTableWrapper::onListDeleted() {
   beginResetModel();
   _list = nullptr;
+  _displayCache.clear();
   endResetModel();
 }
 
@@ -186,8 +231,23 @@ GenericTableWrapper::onItemAdded(int idx) {
   endInsertRows();
 }
 
+void
+GenericTableWrapper::onItemsAdded(int first, int count) {
+  beginInsertRows(QModelIndex(), first, first+count-1);
+  endInsertRows();
+}
+
+void
+GenericTableWrapper::onItemsReset() {
+  _displayCache.clear();
+  beginResetModel();
+  endResetModel();
+}
+
 void
 GenericTableWrapper::onItemRemoved(int idx) {
+  // The removed object is not known anymore and might get deleted
+  _displayCache.clear();
   beginRemoveRows(QModelIndex(), idx, idx);
   //logDebug() << "Signal removal of item at idx=" << idx;
   endRemoveRows();
@@ -195,9 +255,22 @@ GenericTableWrapper::onItemRemoved(int idx) {
 
 void
 GenericTableWrapper::onItemModified(int idx) {
+  _displayCache.remove(_list->get(idx));
   emit dataChanged(index(idx,0),index(idx,columnCount()-1));
 }
 
+void
+GenericTableWrapper::onItemsModified(int first, int count) {
+  for (int i=first; i<(first+count); i++)
+    _displayCache.remove(_list->get(i));
+  emit dataChanged(index(first,0),index(first+count-1,columnCount()-1));
+}
+
+void
+GenericTableWrapper::onConfigModified() {
+  _displayCache.clear();
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of ChannelListWrapper
@@ -215,7 +288,7 @@ ChannelListWrapper::columnCount(const QModelIndex &index) const {
 }
 
 QVariant
-ChannelListWrapper::data(const QModelIndex &index, int role) const {
+ChannelListWrapper::cellData(const QModelIndex &index, int role) const {
   if (nullptr == _list)
     return QVariant();
 
@@ -498,7 +571,7 @@ RoamingChannelListWrapper::columnCount(const QModelIndex &index) const {
 }
 
 QVariant
-RoamingChannelListWrapper::data(const QModelIndex &index, int role) const {
+RoamingChannelListWrapper::cellData(const QModelIndex &index, int role) const {
   if ((Qt::DisplayRole!=role) || (! index.isValid()) || (index.row() >= _list->count()))
     return QVariant();
 
@@ -594,7 +667,7 @@ ContactListWrapper::columnCount(const QModelIndex &index) const {
 }
 
 QVariant
-ContactListWrapper::data(const QModelIndex &index, int role) const {
+ContactListWrapper::cellData(const QModelIndex &index, int role) const {
   if ((!index.isValid()) || (index.row()>=_list->count()))
     return QVariant();
 
@@ -698,7 +771,7 @@ PositioningSystemListWrapper::columnCount(const QModelIndex &idx) const {
 }
 
 QVariant
-PositioningSystemListWrapper::data(const QModelIndex &index, int role) const {
+PositioningSystemListWrapper::cellData(const QModelIndex &index, int role) const {
   if ((! index.isValid()) || (index.row()>=_list->count()))
     return QVariant();
   if ((Qt::DisplayRole!=role) && (Qt::EditRole!=role))
@@ -880,7 +953,7 @@ RadioIdListWrapper::columnCount(const QModelIndex &idx) const {
 }
 
 QVariant
-RadioIdListWrapper::data(const QModelIndex &index, int role) const {
+RadioIdListWrapper::cellData(const QModelIndex &index, int role) const {
   if ((! index.isValid()) || (index.row()>=_list->count()))
     return QVariant();
   if ((Qt::DisplayRole!=role) && (Qt::EditRole!=role))
@@ -917,3 +990,169 @@ RadioIdListWrapper::headerData(int section, Qt::Orientation orientation, int rol
 }
 
 
+
+
+/* ********************************************************************************************* *
+ * Implementation of ObjectSelectionModel
+ * ********************************************************************************************* */
+QHash<QPair<const QObject *, const QObject *>, ObjectSelectionModel *> ObjectSelectionModel::_models;
+
+ObjectSelectionModel::ObjectSelectionModel(AbstractConfigObjectList *list, ConfigObject *first)
+  : QAbstractListModel(list), _list(list), _first(first), _offset(first ? 1 : 0)
+{
+  connect(_list, SIGNAL(destroyed(QObject*)), this, SLOT(onListDeleted()));
+  connect(_list, SIGNAL(elementAdded(int)), this, SLOT(onItemAdded(int)));
+  connect(_list, SIGNAL(elementsAdded(int,int)), this, SLOT(onItemsAdded(int,int)));
+  connect(_list, SIGNAL(elementsReset()), this, SLOT(onItemsReset()));
+  connect(_list, SIGNAL(elementModified(int)), this, SLOT(onItemModified(int)));
+  connect(_list, SIGNAL(elementsModified(int,int)), this, SLOT(onItemsModified(int,int)));
+  connect(_list, SIGNAL(elementRemoved(int)), this, SLOT(onItemRemoved(int)));
+}
+
+ObjectSelectionModel *
+ObjectSelectionModel::get(AbstractConfigObjectList *list, ConfigObject *first) {
+  QPair<const QObject *, const QObject *> key(list, first);
+  if (! _models.contains(key))
+    _models.insert(key, new ObjectSelectionModel(list, first));
+  return _models.value(key);
+}
+
+ConfigObject *
+ObjectSelectionModel::object(int row) const {
+  if ((0 > row) || (row >= rowCount()))
+    return nullptr;
+  if (row < _offset)
+    return _first;
+  return _list->get(row-_offset);
+}
+
+int
+ObjectSelectionModel::rowCount(const QModelIndex &index) const {
+  Q_UNUSED(index)
+  if (nullptr == _list)
+    return _offset;
+  return _offset + _list->count();
+}
+
+QVariant
+ObjectSelectionModel::data(const QModelIndex &index, int role) const {
+  ConfigObject *obj = object(index.row());
+  if ((! index.isValid()) || (nullptr == obj))
+    return QVariant();
+  if ((Qt::DisplayRole == role) || (Qt::EditRole == role))
+    return obj->name();
+  if (Qt::UserRole == role)
+    return QVariant::fromValue(obj);
+  return QVariant();
+}
+
+void
+ObjectSelectionModel::onListDeleted() {
+  beginResetModel();
+  _models.remove(QPair<const QObject *, const QObject *>(_list, _first));
+  _list = nullptr;
+  endResetModel();
+}
+
+void
+ObjectSelectionModel::onItemAdded(int idx) {
+  beginInsertRows(QModelIndex(), _offset+idx, _offset+idx);
+  endInsertRows();
+}
+
+void
+ObjectSelectionModel::onItemsAdded(int first, int count) {
+  beginInsertRows(QModelIndex(), _offset+first, _offset+first+count-1);
+  endInsertRows();
+}
+
+void
+ObjectSelectionModel::onItemsReset() {
+  beginResetModel();
+  endResetModel();
+}
+
+void
+ObjectSelectionModel::onItemRemoved(int idx) {
+  beginRemoveRows(QModelIndex(), _offset+idx, _offset+idx);
+  endRemoveRows();
+}
+
+void
+ObjectSelectionModel::onItemModified(int idx) {
+  emit dataChanged(index(_offset+idx), index(_offset+idx));
+}
+
+void
+ObjectSelectionModel::onItemsModified(int first, int count) {
+  emit dataChanged(index(_offset+first), index(_offset+first+count-1));
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ObjectSelectionProxy
+ * ********************************************************************************************* */
+ObjectSelectionProxy::ObjectSelectionProxy(ObjectSelectionModel *model, bool checkable, QObject *parent)
+  : QSortFilterProxyModel(parent), _checkable(checkable), _filter(), _checked()
+{
+  setSourceModel(model);
+}
+
+void
+ObjectSelectionProxy::setFilter(const Filter &filter) {
+  _filter = filter;
+  invalidateFilter();
+}
+
+QList<ConfigObject *>
+ObjectSelectionProxy::checked() const {
+  QList<ConfigObject *> objects;
+  if (_checked.isEmpty())
+    return objects;
+  ObjectSelectionModel *model = qobject_cast<ObjectSelectionModel *>(sourceModel());
+  for (int i=0; i<rowCount(); i++) {
+    ConfigObject *obj = model->object(mapToSource(index(i, 0)).row());
+    if (_checked.contains(obj))
+      objects.append(obj);
+  }
+  return objects;
+}
+
+Qt::ItemFlags
+ObjectSelectionProxy::flags(const QModelIndex &index) const {
+  if (_checkable && index.isValid())
+    return Qt::ItemIsUserCheckable | Qt::ItemIsEnabled;
+  return QSortFilterProxyModel::flags(index);
+}
+
+QVariant
+ObjectSelectionProxy::data(const QModelIndex &index, int role) const {
+  if (_checkable && index.isValid() && (Qt::CheckStateRole == role)) {
+    ObjectSelectionModel *model = qobject_cast<ObjectSelectionModel *>(sourceModel());
+    return _checked.contains(model->object(mapToSource(index).row())) ? Qt::Checked : Qt::Unchecked;
+  }
+  return QSortFilterProxyModel::data(index, role);
+}
+
+bool
+ObjectSelectionProxy::setData(const QModelIndex &index, const QVariant &value, int role) {
+  if ((! _checkable) || (! index.isValid()) || (Qt::CheckStateRole != role))
+    return false;
+  ObjectSelectionModel *model = qobject_cast<ObjectSelectionModel *>(sourceModel());
+  const ConfigObject *obj = model->object(mapToSource(index).row());
+  if (Qt::Checked == value.value<int>())
+    _checked.insert(obj);
+  else
+    _checked.remove(obj);
+  emit dataChanged(index, index, {Qt::CheckStateRole});
+  return true;
+}
+
+bool
+ObjectSelectionProxy::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const {
+  Q_UNUSED(sourceParent)
+  if (! _filter)
+    return true;
+  ObjectSelectionModel *model = qobject_cast<ObjectSelectionModel *>(sourceModel());
+  return _filter(model->object(sourceRow));
+}
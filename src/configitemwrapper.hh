@@ -3,6 +3,9 @@
 
 #include "config.hh"
 #include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QSet>
+#include <functional>
 
 class GenericListWrapper: public QAbstractListModel
 {
@@ -34,10 +37,16 @@ protected slots:
   void onListDeleted();
   /** Internal callback on added items. */
   void onItemAdded(int idx);
+  /** Internal callback on items added at once. */
+  void onItemsAdded(int first, int count);
+  /** Internal callback at the end of a bulk update of the list. */
+  void onItemsReset();
   /** Internal callback on deleted channels. */
   void onItemRemoved(int idx);
   /** Internal callback on modified channels. */
   void onItemModified(int idx);
+  /** Internal callback on channels modified at once. */
+  void onItemsModified(int first, int count);
 
 protected:
   /** Holds a weak reference to the list object. */
@@ -68,6 +77,16 @@ public:
 
   bool canDropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent) const;
 
+  /** Implements QAbstractTableModel, returns data at cell. The display data is computed once
+   * for all columns of a row using @c cellData and cached until the row or any other part of the
+   * config is modified. Hence scrolling and sorting large lists does not need to query all
+   * properties again. */
+  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
+
+protected:
+  /** Computes the data at the given cell, implemented by the specific wrappers. */
+  virtual QVariant cellData(const QModelIndex &index, int role) const = 0;
+
 signals:
   /** Gets emitted once the table has been changed. */
   void modified();
@@ -77,16 +96,27 @@ protected slots:
   void onListDeleted();
   /** Internal used callback on adding an item. */
   void onItemAdded(int idx);
+  /** Internal used callback on adding several items at once. */
+  void onItemsAdded(int first, int count);
+  /** Internal callback at the end of a bulk update of the list. */
+  void onItemsReset();
   /** Internal callback on deleted channels. */
   void onItemRemoved(int idx);
   /** Internal callback on modified channels. */
   void onItemModified(int idx);
+  /** Internal callback on channels modified at once. */
+  void onItemsModified(int first, int count);
+  /** Internal callback on any modification of the config, invalidates the cache. Display data
+   * may depend on other objects, like the name of a referenced contact. */
+  void onConfigModified();
 
 protected:
   /** Holds a weak reference to the list object. */
   AbstractConfigObjectList *_list;
   /** Insert index for drag & drop move. */
   int _insertRow;
+  /** Caches the display data of rows by object. */
+  mutable QHash<const ConfigObject *, QVector<QVariant>> _displayCache;
 };
 
 
@@ -101,10 +131,12 @@ public:
   // QAbstractTableModel interface
   /** Implements QAbstractTableModel, returns number of columns. */
   int columnCount(const QModelIndex &index) const;
-  /** Implements QAbstractTableModel, returns data at cell. */
-  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   /** Implements QAbstractTableModel, returns header at section. */
   QVariant headerData(int section, Qt::Orientation orientation, int role=Qt::DisplayRole) const;
+
+protected:
+  /** Computes the data at cell, see @c GenericTableWrapper::data. */
+  QVariant cellData(const QModelIndex &index, int role) const;
 };
 
 
@@ -135,10 +167,12 @@ public:
   // Implementation of QAbstractTableModel
   /** Returns the number of columns, implements the QAbstractTableModel. */
   int columnCount(const QModelIndex &index) const;
-  /** Returns the cell data at given index, implements the QAbstractTableModel. */
-  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   /** Implementation of QAbstractListModel, returns the header data at the given section. */
   QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+protected:
+  /** Computes the data at cell, see @c GenericTableWrapper::data. */
+  QVariant cellData(const QModelIndex &index, int role) const;
 };
 
 
@@ -169,10 +203,12 @@ public:
   // Implementation of QAbstractTableModel
   /** Returns the number of columns, implements the QAbstractTableModel. */
   int columnCount(const QModelIndex &index) const;
-  /** Returns the cell data at given index, implements the QAbstractTableModel. */
-  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   /** Returns the header at given section, implements the QAbstractTableModel. */
   QVariant headerData(int section, Qt::Orientation orientation, int role=Qt::DisplayRole) const;
+
+protected:
+  /** Computes the data at cell, see @c GenericTableWrapper::data. */
+  QVariant cellData(const QModelIndex &index, int role) const;
 };
 
 
@@ -203,10 +239,12 @@ public:
   // Implementation of QAbstractTableModel
   /** Returns the number of columns, implements the QAbstractTableModel. */
   int columnCount(const QModelIndex &index) const;
-  /** Returns the cell data at given index, implements the QAbstractTableModel. */
-  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   /** Returns the header at given section, implements the QAbstractTableModel. */
   QVariant headerData(int section, Qt::Orientation orientation, int role=Qt::DisplayRole) const;
+
+protected:
+  /** Computes the data at cell, see @c GenericTableWrapper::data. */
+  QVariant cellData(const QModelIndex &index, int role) const;
 };
 
 
@@ -285,12 +323,109 @@ public:
   // Implementation of QAbstractTableModel
   /** Returns the number of columns, implements the QAbstractTableModel. */
   int columnCount(const QModelIndex &index) const;
-  /** Returns the cell data at given index, implements the QAbstractTableModel. */
-  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   /** Returns the header at given section, implements the QAbstractTableModel. */
   QVariant headerData(int section, Qt::Orientation orientation, int role=Qt::DisplayRole) const;
+
+protected:
+  /** Computes the data at cell, see @c GenericTableWrapper::data. */
+  QVariant cellData(const QModelIndex &index, int role) const;
 };
 
 
+/** Lists the names of the objects of a list for selection widgets.
+ *
+ * The model is shared by all selection widgets and dialogs of a list (see @c get) and follows
+ * the changes of the list incrementally. Hence opening a selection does not need to create any
+ * items. The objects are provided as the @c Qt::UserRole data. Optionally, a fixed object (e.g.,
+ * the selected channel) is listed in front of the objects of the list. */
+class ObjectSelectionModel: public QAbstractListModel
+{
+  Q_OBJECT
+
+protected:
+  /** Hidden constructor, use @c get. */
+  ObjectSelectionModel(AbstractConfigObjectList *list, ConfigObject *first);
+
+public:
+  /** Returns the shared model for the given list and optional first object. The model is owned
+   * by the list. */
+  static ObjectSelectionModel *get(AbstractConfigObjectList *list, ConfigObject *first=nullptr);
+
+  /** Returns the object at the given row. */
+  ConfigObject *object(int row) const;
+
+  /** Implements QAbstractListModel, returns number of rows. */
+  int rowCount(const QModelIndex &index=QModelIndex()) const;
+  /** Implements QAbstractListModel, returns the name or the object (@c Qt::UserRole). */
+  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
+
+protected slots:
+  /** Internal used callback on deleted list. */
+  void onListDeleted();
+  /** Internal callback on added items. */
+  void onItemAdded(int idx);
+  /** Internal callback on items added at once. */
+  void onItemsAdded(int first, int count);
+  /** Internal callback at the end of a bulk update of the list. */
+  void onItemsReset();
+  /** Internal callback on deleted items. */
+  void onItemRemoved(int idx);
+  /** Internal callback on modified items. */
+  void onItemModified(int idx);
+  /** Internal callback on items modified at once. */
+  void onItemsModified(int first, int count);
+
+protected:
+  /** Holds a weak reference to the list object. */
+  AbstractConfigObjectList *_list;
+  /** The optional first object. */
+  ConfigObject *_first;
+  /** Number of rows in front of the list objects. */
+  int _offset;
+  /** All shared models by list and first object. */
+  static QHash<QPair<const QObject *, const QObject *>, ObjectSelectionModel *> _models;
+};
+
+
+/** Per-dialog view of a shared @c ObjectSelectionModel, filtering the objects and holding their
+ * check states. */
+class ObjectSelectionProxy: public QSortFilterProxyModel
+{
+  Q_OBJECT
+
+public:
+  /** Filter on the objects, returns @c true if the object is shown. */
+  typedef std::function<bool(const ConfigObject *obj)> Filter;
+
+public:
+  /** Constructs a proxy for the given shared model. If @c checkable is @c true, the objects can
+   * be checked. */
+  ObjectSelectionProxy(ObjectSelectionModel *model, bool checkable, QObject *parent=nullptr);
+
+  /** Sets the filter. */
+  void setFilter(const Filter &filter);
+
+  /** Returns the checked objects, in the order of the list. */
+  QList<ConfigObject *> checked() const;
+
+  /** Marks the objects checkable. */
+  Qt::ItemFlags flags(const QModelIndex &index) const;
+  /** Returns the check state or the data of the shared model. */
+  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
+  /** Sets the check state. */
+  bool setData(const QModelIndex &index, const QVariant &value, int role=Qt::EditRole);
+
+protected:
+  bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+
+protected:
+  /** If @c true, the objects can be checked. */
+  bool _checkable;
+  /** The filter, if set. */
+  Filter _filter;
+  /** The checked objects. */
+  QSet<const ConfigObject *> _checked;
+};
+
 
 #endif // CONFIG_ITEM_WRAPPER_HH
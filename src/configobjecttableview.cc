@@ -2,6 +2,7 @@
 #include "ui_configobjecttableview.h"
 #include "searchpopup.hh"
 #include <QMessageBox>
+#include <algorithm>
 
 
 inline QPair<int, int>
@@ -67,6 +68,15 @@ ConfigObjectTableView::selection() const {
   return getSelectionRowRange(ui->tableView->selectionModel()->selection().indexes());
 }
 
+QVector<int>
+ConfigObjectTableView::selectedRows() const {
+  QVector<int> rows;
+  foreach (const QModelIndex &idx, ui->tableView->selectionModel()->selectedRows())
+    rows.append(idx.row());
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
 QHeaderView *
 ConfigObjectTableView::header() const {
   return ui->tableView->horizontalHeader();
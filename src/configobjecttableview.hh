@@ -22,6 +22,8 @@ public:
 
   bool hasSelection() const;
   QPair<int,int> selection() const;
+  /** Returns the indices of all selected rows in ascending order. */
+  QVector<int> selectedRows() const;
 
   QHeaderView *header() const;
 
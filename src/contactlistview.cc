@@ -69,9 +69,11 @@ ContactListView::onRemContact() {
   QPair<int,int> rows = ui->listView->selection();
   int numrows = rows.second-rows.first+1;
   if (rows.first == rows.second) {
-    QString name = _config->contacts()->contact(rows.first)->name();
-    if (QMessageBox::No == QMessageBox::question(
-          nullptr, tr("Delete contact?"), tr("Delete contact %1?").arg(name)))
+    Contact *contact = _config->contacts()->contact(rows.first);
+    QString text = tr("Delete contact %1?").arg(contact->name());
+    if (int uses = contact->useCount())
+      text = tr("Contact %1 is used %2 times. Delete it anyway?").arg(contact->name()).arg(uses);
+    if (QMessageBox::No == QMessageBox::question(nullptr, tr("Delete contact?"), text))
       return;
   } else {
     if (QMessageBox::No == QMessageBox::question(
@@ -98,12 +100,18 @@ ContactListView::onEditContact(unsigned row) {
     DMRContactDialog dialog(digi, app->user(), app->talkgroup(), _config);
     if (QDialog::Accepted != dialog.exec())
       return;
+    app->history()->begin(tr("edit contact"));
+    app->history()->track(contact);
     dialog.contact();
+    app->history()->commit();
   } else if (DTMFContact *dtmf = contact->as<DTMFContact>()) {
     DTMFContactDialog dialog(dtmf, _config);
     if (QDialog::Accepted != dialog.exec())
       return;
+    app->history()->begin(tr("edit contact"));
+    app->history()->track(contact);
     dialog.contact();
+    app->history()->commit();
   }
 }
 
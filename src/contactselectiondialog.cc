@@ -1,35 +1,38 @@
 #include "contactselectiondialog.hh"
 #include "contact.hh"
+#include "configitemwrapper.hh"
 
-#include <QListWidget>
+#include <QListView>
 #include <QDialogButtonBox>
 #include <QVBoxLayout>
 #include <QLabel>
 #include <QCheckBox>
 
+/** Shows all DMR contacts, private calls only if @c showPrivateCalls is @c true. */
+static bool
+isGroupCall(const ConfigObject *obj, bool showPrivateCalls) {
+  const DMRContact *digi = obj->as<DMRContact>();
+  return (nullptr != digi) && (showPrivateCalls || (DMRContact::PrivateCall != digi->type()));
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of MultiGroupCallSelectionDialog
  * ********************************************************************************************* */
 MultiGroupCallSelectionDialog::MultiGroupCallSelectionDialog(ContactList *contacts, bool showPrivateCalls, QWidget *parent)
   : QDialog(parent)
 {
-  _contacts = new QListWidget();
   QCheckBox *showPrivCall = new QCheckBox(tr("Show private calls"));
   showPrivCall->setChecked(showPrivateCalls);
 
-  for (int i=0; i<contacts->count(); i++) {
-    Contact *contact = contacts->contact(i);
-    if (! contact->is<DMRContact>())
-      continue;
-    DMRContact *digi = contact->as<DMRContact>();
-    QListWidgetItem *item = new QListWidgetItem(digi->name());
-    item->setFlags(Qt::ItemIsUserCheckable|Qt::ItemIsEnabled);
-    item->setData(Qt::UserRole, QVariant::fromValue(digi));
-    item->setCheckState(Qt::Unchecked);
-    _contacts->addItem(item);
-    // Hide private calls if showPrivateCall is false (default)
-    item->setHidden((DMRContact::PrivateCall == digi->type()) && (! showPrivateCalls));
-  }
+  // Hide private calls if showPrivateCall is false (default)
+  _contacts = new ObjectSelectionProxy(ObjectSelectionModel::get(contacts), true, this);
+  _contacts->setFilter([showPrivateCalls](const ConfigObject *obj) {
+    return isGroupCall(obj, showPrivateCalls);
+  });
+  QListView *view = new QListView();
+  view->setUniformItemSizes(true);
+  view->setModel(_contacts);
 
   QDialogButtonBox *bbox = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Cancel);
   connect(bbox, SIGNAL(accepted()), this, SLOT(accept()));
@@ -39,7 +42,7 @@ MultiGroupCallSelectionDialog::MultiGroupCallSelectionDialog(ContactList *contac
   _label = new QLabel(tr("Select a group call:"));
   QVBoxLayout *layout = new QVBoxLayout();
   layout->addWidget(_label);
-  layout->addWidget(_contacts);
+  layout->addWidget(view);
   layout->addWidget(showPrivCall);
   layout->addWidget(bbox);
   setLayout(layout);
@@ -54,17 +57,14 @@ MultiGroupCallSelectionDialog::setLabel(const QString &text) {
 QList<DMRContact *>
 MultiGroupCallSelectionDialog::contacts() {
   QList<DMRContact *> contacts;
-  for (int i=0; i<_contacts->count(); i++) {
-    if (Qt::Checked == _contacts->item(i)->checkState())
-      contacts.push_back(_contacts->item(i)->data(Qt::UserRole).value<DMRContact *>());
-  }
+  foreach (ConfigObject *obj, _contacts->checked())
+    contacts.push_back(obj->as<DMRContact>());
   return contacts;
 }
 
 void
 MultiGroupCallSelectionDialog::showPrivateCallsToggled(bool show) {
-  for (int i=0; i<_contacts->count(); i++) {
-    if (DMRContact::PrivateCall == _contacts->item(i)->data(Qt::UserRole).value<DMRContact *>()->type())
-      _contacts->item(i)->setHidden(! show);
-  }
+  _contacts->setFilter([show](const ConfigObject *obj) {
+    return isGroupCall(obj, show);
+  });
 }
@@ -6,7 +6,7 @@
 
 class DMRContact;
 class ContactList;
-class QListWidget;
+class ObjectSelectionProxy;
 class QLabel;
 
 
@@ -26,7 +26,7 @@ protected slots:
 
 protected:
   QLabel *_label;
-  QListWidget *_contacts;
+  ObjectSelectionProxy *_contacts;
 };
 
 #endif // CONTACTSELECTIONDIALOG_HH
@@ -100,7 +100,16 @@ DMRContactDialog::construct() {
   if (! settings.showExtensions())
     ui->tabWidget->tabBar()->hide();
 
+  // Databases may still be loaded in the background
+  if (UserDatabase *users = userDatabase())
+    connect(users, SIGNAL(loaded()), this, SLOT(updateLoadingState()));
+  if (TalkGroupDatabase *tgs = talkGroupDatabase())
+    connect(tgs, SIGNAL(loaded()), this, SLOT(updateLoadingState()));
+  updateLoadingState();
+
   connect(ui->typeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(onTypeChanged(int)));
+  connect(ui->nameLineEdit, SIGNAL(editingFinished()), this, SLOT(onNameEdited()));
+  connect(ui->numberLineEdit, SIGNAL(editingFinished()), this, SLOT(onNumberEdited()));
   connect(ui->buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
   connect(ui->buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
 }
@@ -120,6 +129,59 @@ DMRContactDialog::onTypeChanged(int idx) {
     ui->numberLineEdit->setEnabled(false);
     ui->nameLineEdit->setCompleter(nullptr);
   }
+  updateLoadingState();
+}
+
+void
+DMRContactDialog::updateLoadingState() {
+  UserDatabase *users = userDatabase();
+  TalkGroupDatabase *tgs = talkGroupDatabase();
+  if ((0 == ui->typeComboBox->currentIndex()) && users && users->isLoading())
+    ui->nameLineEdit->setPlaceholderText(tr("Loading user database ..."));
+  else if ((1 == ui->typeComboBox->currentIndex()) && tgs && tgs->isLoading())
+    ui->nameLineEdit->setPlaceholderText(tr("Loading talk group database ..."));
+  else
+    ui->nameLineEdit->setPlaceholderText("");
+}
+
+UserDatabase *
+DMRContactDialog::userDatabase() const {
+  if (nullptr == _user_completer)
+    return nullptr;
+  return qobject_cast<UserDatabase *>(_user_completer->model());
+}
+
+TalkGroupDatabase *
+DMRContactDialog::talkGroupDatabase() const {
+  if (nullptr == _tg_completer)
+    return nullptr;
+  return qobject_cast<TalkGroupDatabase *>(_tg_completer->model());
+}
+
+void
+DMRContactDialog::onNameEdited() {
+  // Fill in the ID of a private call, if the callsign is known
+  UserDatabase *db = userDatabase();
+  if ((0 != ui->typeComboBox->currentIndex()) || (nullptr == db))
+    return;
+  if ((! ui->numberLineEdit->text().isEmpty()) && (0 != ui->numberLineEdit->text().toUInt()))
+    return;
+  int idx = db->findCallsign(ui->nameLineEdit->text().simplified());
+  if (idx >= 0)
+    ui->numberLineEdit->setText(QString::number(db->user(idx).id));
+}
+
+void
+DMRContactDialog::onNumberEdited() {
+  // Fill in the callsign of a private call, if the ID is known
+  UserDatabase *db = userDatabase();
+  if ((0 != ui->typeComboBox->currentIndex()) || (nullptr == db))
+    return;
+  if (! ui->nameLineEdit->text().isEmpty())
+    return;
+  int idx = db->findUser(ui->numberLineEdit->text().toUInt());
+  if (idx >= 0)
+    ui->nameLineEdit->setText(db->user(idx).call);
 }
 
 void
@@ -28,9 +28,14 @@ public:
 protected slots:
   void onTypeChanged(int idx);
   void onCompleterActivated(const QModelIndex &idx);
+  void onNameEdited();
+  void onNumberEdited();
+  void updateLoadingState();
 
 protected:
   void construct();
+  UserDatabase *userDatabase() const;
+  TalkGroupDatabase *talkGroupDatabase() const;
 
 private:
   DMRContact *_myContact;
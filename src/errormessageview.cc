@@ -1,5 +1,6 @@
 #include "errormessageview.hh"
 #include "ui_errormessageview.h"
+#include "issuemodel.hh"
 
 ErrorMessageView::ErrorMessageView(const ErrorStack &stack, QWidget *parent) :
   QDialog(parent), ui(new Ui::ErrorMessageView)
@@ -22,7 +23,8 @@ ErrorMessageView::ErrorMessageView(const ErrorStack &stack, QWidget *parent) :
     ui->errorMessage->setText(
           stack.message(0).message() +
           ":" + stack.message(stack.count()-1).message());
-  ui->errorStack->setText(stack.format());
+  // Only the visible messages get rendered
+  ui->errorStack->setModel(new ErrorStackModel(stack, ui->errorStack));
 }
 
 ErrorMessageView::~ErrorMessageView()
@@ -5,6 +5,7 @@
 #include "configobjecttypeselectiondialog.hh"
 #include "frequency.hh"
 #include "interval.hh"
+#include "enumtable.hh"
 
 
 /* ******************************************************************************************** *
@@ -75,18 +76,11 @@ ExtensionProxy::parent(const QModelIndex &child) const {
     return QModelIndex();
 
   if (root == gpptr) {
-    // Search for index of parent root:
-    const QMetaObject *meta = root->metaObject();
-    for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-      QMetaProperty prop = meta->property(p);
-      if (! prop.isValid())
-        continue;
-      if (prop.read(root).value<ConfigItem *>() == pptr) {
-        return createIndex(_indexS2P[p-QObject::staticMetaObject.propertyCount()], 0,
-            reinterpret_cast<quintptr>(root));
-      }
-    }
-    return QModelIndex();
+    // Look up index of parent within root
+    int row = qobject_cast<PropertyWrapper*>(sourceModel())->childRow(root, pptr);
+    if ((0 > row) || (! _indexS2P.contains(row)))
+      return QModelIndex();
+    return createIndex(_indexS2P[row], 0, reinterpret_cast<quintptr>(root));
   }
 
   return mapFromSource(sourceModel()->parent(child));
@@ -145,6 +139,8 @@ PropertyWrapper::PropertyWrapper(ConfigItem *obj, QObject *parent)
   if (_object) {
     connect(_object, SIGNAL(beginClear()), this, SLOT(onItemClearing()));
     connect(_object, SIGNAL(endClear()), this, SLOT(onItemCleared()));
+    // Modifications are passed up the tree
+    connect(_object, SIGNAL(modified(ConfigItem*)), this, SLOT(invalidate()));
   }
 }
 
@@ -235,6 +231,38 @@ PropertyWrapper::propertyAt(const QModelIndex &index) const {
   return QMetaProperty();
 }
 
+int
+PropertyWrapper::childRow(QObject *parent, const QObject *child) const {
+  if ((nullptr == parent) || (nullptr == child))
+    return -1;
+
+  auto table = _childRows.find(parent);
+  if (_childRows.end() == table) {
+    // Build table of all children of the parent once
+    table = _childRows.insert(parent, QHash<const QObject *, int>());
+    if (ConfigItem *item = qobject_cast<ConfigItem*>(parent)) {
+      const QMetaObject *meta = item->metaObject();
+      for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+        QMetaProperty prop = meta->property(p);
+        if (! prop.isValid())
+          continue;
+        if (QObject *obj = prop.read(item).value<QObject *>())
+          table->insert(obj, p-QObject::staticMetaObject.propertyCount());
+      }
+    } else if (ConfigObjectList *lst = qobject_cast<ConfigObjectList*>(parent)) {
+      for (int i=0; i<lst->count(); i++)
+        table->insert(lst->get(i), i);
+      // Lists do not necessarily signal changes up the tree
+      connect(lst, SIGNAL(elementAdded(int)), this, SLOT(invalidate()), Qt::UniqueConnection);
+      connect(lst, SIGNAL(elementsAdded(int,int)), this, SLOT(invalidate()), Qt::UniqueConnection);
+      connect(lst, SIGNAL(elementRemoved(int)), this, SLOT(invalidate()), Qt::UniqueConnection);
+      connect(lst, SIGNAL(elementsReset()), this, SLOT(invalidate()), Qt::UniqueConnection);
+    }
+  }
+
+  return table->value(child, -1);
+}
+
 
 bool
 PropertyWrapper::isExtension(const QModelIndex &index) const {
@@ -294,6 +322,7 @@ PropertyWrapper::createInstanceAt(const QModelIndex &item) {
   // store item
   beginInsertRows(item, 0, ext->metaObject()->propertyCount());
   prop.write(obj, QVariant::fromValue(ext));
+  invalidate();
   endInsertRows();
   emit dataChanged(index(item.row(), 0, item.parent()),
                    index(item.row(), 2, item.parent()));
@@ -317,6 +346,7 @@ PropertyWrapper::deleteInstanceAt(const QModelIndex &item) {
       return false;
     beginRemoveRows(item, 0, rowCount(item));
     prop.write(obj, QVariant::fromValue<ConfigItem*>(nullptr));
+    invalidate();
     endRemoveRows();
     ext->deleteLater();
     return true;
@@ -415,28 +445,11 @@ PropertyWrapper::parent(const QModelIndex &child) const {
   if (nullptr == gpptr)
     return QModelIndex();
 
-  if (ConfigItem *gp = qobject_cast<ConfigItem*>(gpptr)) {
-    // If grand parent is item:
-    // Search for parent in grand-parent's properties
-    const QMetaObject *meta = gp->metaObject();
-    for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-      QMetaProperty prop = meta->property(p);
-      if (! prop.isValid())
-        continue;
-      if (prop.read(gp).value<QObject *>() == pptr) {
-        return createIndex(p-QObject::staticMetaObject.propertyCount(), 0, reinterpret_cast<quintptr>(gp));
-      }
-    }
-  } else if (ConfigObjectList *gp = qobject_cast<ConfigObjectList*>(gpptr)) {
-    // If grand parent is item:
-    // Search for parent in grand-parent's elements
-    for (int i=0; i<gp->count(); i++) {
-      if (pptr == gp->get(i))
-        return createIndex(i, 0, reinterpret_cast<quintptr>(gp));
-    }
-  }
-
-  return QModelIndex();
+  // Look up parent in grand-parent's properties or elements
+  int row = childRow(gpptr, pptr);
+  if (0 > row)
+    return QModelIndex();
+  return createIndex(row, 0, reinterpret_cast<quintptr>(gpptr));
 }
 
 int
@@ -566,7 +579,7 @@ PropertyWrapper::data(const QModelIndex &index, int role) const {
 
     QVariant value = prop.read(pobj);
     if (prop.isEnumType() && ((Qt::DisplayRole == role) || (Qt::EditRole == role))) {
-      QMetaEnum e = prop.enumerator();
+      const EnumTable &e = EnumTable::get(prop.enumerator());
       const char *key = e.valueToKey(value.toInt());
       if (nullptr == key) {
         logError() << "Cannot map value " << value.toUInt()
@@ -639,9 +652,15 @@ PropertyWrapper::data(const QModelIndex &index, int role) const {
 void
 PropertyWrapper::onItemClearing() {
   beginResetModel();
+  invalidate();
 }
 
 void
 PropertyWrapper::onItemCleared() {
   endResetModel();
 }
+
+void
+PropertyWrapper::invalidate() {
+  _childRows.clear();
+}
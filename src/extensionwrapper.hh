@@ -47,6 +47,9 @@ public:
   ConfigObjectList *parentList(const QModelIndex &index) const;
   ConfigItem *parentObject(const QModelIndex &index) const;
   QMetaProperty propertyAt(const QModelIndex &index) const;
+  /** Returns the row of the given child item or list within its parent item or list, or -1 if
+   * not found. The rows of all children of a parent are cached until the tree gets modified. */
+  int childRow(QObject *parent, const QObject *child) const;
 
   bool isProperty(const QModelIndex &index) const;
   bool isExtension(const QModelIndex &index) const;
@@ -73,9 +76,13 @@ public:
 protected slots:
   void onItemClearing();
   void onItemCleared();
+  /** Drops the cached child tables, whenever the structure of the tree may have changed. */
+  void invalidate();
 
 protected:
   ConfigItem *_object;
+  /** Cached rows of the child items and lists, per parent item or list. */
+  mutable QHash<const QObject *, QHash<const QObject *, int>> _childRows;
 };
 
 #endif // EXTENSIONWRAPPER_HH
@@ -0,0 +1,208 @@
+#include "issuemodel.hh"
+#include "application.hh"
+#include <QHash>
+#include <QColor>
+#include <algorithm>
+
+
+/* ********************************************************************************************* *
+ * Implementation of RadioLimitIssueModel
+ * ********************************************************************************************* */
+RadioLimitIssueModel::RadioLimitIssueModel(const RadioLimitContext &issues, Grouping grouping, QObject *parent)
+  : QAbstractItemModel(parent), _issues(issues), _grouping(grouping), _groups(), _darkMode(false)
+{
+  if (Application *app = qobject_cast<Application *>(QApplication::instance()))
+    _darkMode = app->isDarkMode();
+  regroup();
+}
+
+RadioLimitIssueModel::Grouping
+RadioLimitIssueModel::grouping() const {
+  return _grouping;
+}
+
+void
+RadioLimitIssueModel::setGrouping(Grouping grouping) {
+  if (grouping == _grouping)
+    return;
+  beginResetModel();
+  _grouping = grouping;
+  regroup();
+  endResetModel();
+}
+
+int
+RadioLimitIssueModel::issue(const QModelIndex &index) const {
+  if ((! index.isValid()) || (0 == index.internalId()))
+    return -1;
+  const Group &group = _groups[index.internalId()-1];
+  if (index.row() >= group.issues.size())
+    return -1;
+  return group.issues[index.row()];
+}
+
+QModelIndex
+RadioLimitIssueModel::index(int row, int column, const QModelIndex &parent) const {
+  if ((0 > row) || (0 > column) || (column >= columnCount(parent)) || (row >= rowCount(parent)))
+    return QModelIndex();
+  // The internal ID is 0 for groups and the group index + 1 for issues
+  if (! parent.isValid())
+    return createIndex(row, column, quintptr((Grouping::None == _grouping) ? 1 : 0));
+  return createIndex(row, column, quintptr(parent.row()+1));
+}
+
+QModelIndex
+RadioLimitIssueModel::parent(const QModelIndex &child) const {
+  if ((! child.isValid()) || (0 == child.internalId()) || (Grouping::None == _grouping))
+    return QModelIndex();
+  return createIndex(int(child.internalId()-1), 0, quintptr(0));
+}
+
+int
+RadioLimitIssueModel::rowCount(const QModelIndex &parent) const {
+  if (! parent.isValid())
+    return (Grouping::None == _grouping) ? _groups.first().issues.size() : _groups.size();
+  if ((0 == parent.internalId()) && (0 == parent.column()))
+    return _groups[parent.row()].issues.size();
+  return 0;
+}
+
+int
+RadioLimitIssueModel::columnCount(const QModelIndex &parent) const {
+  Q_UNUSED(parent);
+  return 1;
+}
+
+QVariant
+RadioLimitIssueModel::data(const QModelIndex &index, int role) const {
+  if (! index.isValid())
+    return QVariant();
+
+  int idx = issue(index);
+  if (0 > idx) {
+    const Group &group = _groups[index.row()];
+    if (Qt::DisplayRole == role)
+      return tr("%1 (%2)").arg(group.label).arg(group.issues.size());
+    if (Qt::ForegroundRole == role)
+      return color(group.severity);
+    return QVariant();
+  }
+
+  const RadioLimitIssue &issue = _issues.message(idx);
+  if (Qt::DisplayRole == role) {
+    // The object is already given by the group
+    QString text = issue.message();
+    if (Grouping::Object != _grouping)
+      text = tr("In %1: %2").arg(issue.stack().join(", ")).arg(text);
+    if (1 < issue.repetitions())
+      text = tr("%1 (%2 times)").arg(text).arg(issue.repetitions());
+    return text;
+  }
+  if (Qt::ToolTipRole == role)
+    return issue.format();
+  if (Qt::ForegroundRole == role)
+    return color(issue.severity());
+  return QVariant();
+}
+
+QString
+RadioLimitIssueModel::objectOf(const RadioLimitIssue &issue) {
+  QStringList path;
+  foreach (const QString &item, issue.stack()) {
+    path.append(item);
+    if (item.startsWith("Element "))
+      break;
+  }
+  return path.join(", ");
+}
+
+void
+RadioLimitIssueModel::regroup() {
+  _groups.clear();
+
+  if (Grouping::None == _grouping) {
+    Group all{QString(), RadioLimitIssue::Silent, QVector<int>()};
+    all.issues.reserve(_issues.count());
+    for (int i=0; i<_issues.count(); i++) {
+      all.issues.append(i);
+      all.severity = std::max(all.severity, _issues.message(i).severity());
+    }
+    _groups.append(all);
+    return;
+  }
+
+  if (Grouping::Severity == _grouping) {
+    // Most severe first
+    static const RadioLimitIssue::Severity order[] = {
+      RadioLimitIssue::Critical, RadioLimitIssue::Warning, RadioLimitIssue::Hint, RadioLimitIssue::Silent };
+    static const char *labels[] = {
+      QT_TR_NOOP("Critical"), QT_TR_NOOP("Warnings"), QT_TR_NOOP("Hints"), QT_TR_NOOP("Silent") };
+    for (int j=0; j<4; j++) {
+      Group group{tr(labels[j]), order[j], QVector<int>()};
+      for (int i=0; i<_issues.count(); i++) {
+        if (order[j] == _issues.message(i).severity())
+          group.issues.append(i);
+      }
+      if (! group.issues.isEmpty())
+        _groups.append(group);
+    }
+    return;
+  }
+
+  // Group by object in order of the first issue
+  QHash<QString, int> groups;
+  for (int i=0; i<_issues.count(); i++) {
+    const RadioLimitIssue &issue = _issues.message(i);
+    QString object = objectOf(issue);
+    if (! groups.contains(object)) {
+      groups.insert(object, _groups.size());
+      _groups.append({object.isEmpty() ? tr("Codeplug") : object, RadioLimitIssue::Silent, QVector<int>()});
+    }
+    Group &group = _groups[groups.value(object)];
+    group.issues.append(i);
+    group.severity = std::max(group.severity, issue.severity());
+  }
+}
+
+QVariant
+RadioLimitIssueModel::color(RadioLimitIssue::Severity severity) const {
+  switch (severity) {
+  case RadioLimitIssue::Silent:
+    break;
+  case RadioLimitIssue::Hint:
+    return QColor(Qt::gray);
+  case RadioLimitIssue::Warning:
+    return QColor(_darkMode ? Qt::white : Qt::black);
+  case RadioLimitIssue::Critical:
+    return QColor(_darkMode ? Qt::red : Qt::darkRed);
+  }
+  return QVariant();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ErrorStackModel
+ * ********************************************************************************************* */
+ErrorStackModel::ErrorStackModel(const ErrorStack &stack, QObject *parent)
+  : QAbstractListModel(parent), _stack(stack)
+{
+  // pass...
+}
+
+int
+ErrorStackModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid())
+    return 0;
+  return _stack.count();
+}
+
+QVariant
+ErrorStackModel::data(const QModelIndex &index, int role) const {
+  if ((! index.isValid()) || (index.row() >= rowCount()))
+    return QVariant();
+  if (Qt::DisplayRole == role)
+    return _stack.message(index.row()).format();
+  if (Qt::ToolTipRole == role)
+    return _stack.message(index.row()).message();
+  return QVariant();
+}
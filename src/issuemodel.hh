@@ -0,0 +1,99 @@
+#ifndef ISSUEMODEL_HH
+#define ISSUEMODEL_HH
+
+#include <QAbstractItemModel>
+#include <QAbstractListModel>
+#include <QVector>
+#include "radiolimits.hh"
+#include "errorstack.hh"
+
+/** Presents the issues of a verification as a tree, grouped by the object they were found in
+ * or by their severity.
+ *
+ * The model does not copy the issues, it only keeps their indices within the context. Together
+ * with a view using uniform row heights, only the visible rows get queried. Hence, the view is
+ * shown instantly, even for thousands of issues. The context must outlive the model. */
+class RadioLimitIssueModel: public QAbstractItemModel
+{
+  Q_OBJECT
+
+public:
+  /** Possible groupings of the issues. */
+  enum class Grouping {
+    None,     ///< A flat list of issues.
+    Object,   ///< Grouped by the object (e.g., channel) the issues were found in.
+    Severity  ///< Grouped by severity.
+  };
+
+public:
+  /** Constructs a model of the issues of the given context. */
+  explicit RadioLimitIssueModel(const RadioLimitContext &issues, Grouping grouping=Grouping::Object,
+                                QObject *parent=nullptr);
+
+  /** Returns the current grouping. */
+  Grouping grouping() const;
+  /** Regroups the issues. */
+  void setGrouping(Grouping grouping);
+
+  /** Returns the index of the issue within the context or -1 for groups. */
+  int issue(const QModelIndex &index) const;
+
+  QModelIndex index(int row, int column, const QModelIndex &parent=QModelIndex()) const;
+  QModelIndex parent(const QModelIndex &child) const;
+  int rowCount(const QModelIndex &parent=QModelIndex()) const;
+  int columnCount(const QModelIndex &parent=QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
+
+  /** Returns the object, the given issue was found in. That is, the item stack up to the first
+   * list element. */
+  static QString objectOf(const RadioLimitIssue &issue);
+
+protected:
+  /** Rebuilds the groups. */
+  void regroup();
+  /** Returns the text color for the given severity. */
+  QVariant color(RadioLimitIssue::Severity severity) const;
+
+protected:
+  /** A group of issues. */
+  struct Group {
+    /** The label of the group. */
+    QString label;
+    /** The highest severity of the issues in the group. */
+    RadioLimitIssue::Severity severity;
+    /** The indices of the issues. */
+    QVector<int> issues;
+  };
+
+  /** The issues. */
+  const RadioLimitContext &_issues;
+  /** The current grouping. */
+  Grouping _grouping;
+  /** The groups, a single one for @c Grouping::None. */
+  QVector<Group> _groups;
+  /** If @c true, the colors are chosen for a dark palette. */
+  bool _darkMode;
+};
+
+
+/** Presents the messages of an error stack as a list.
+ *
+ * Unlike a single label holding the formatted stack, a list view only renders the visible
+ * messages. */
+class ErrorStackModel: public QAbstractListModel
+{
+  Q_OBJECT
+
+public:
+  /** Constructs a model of the given error stack. The stack is shared, not copied. */
+  explicit ErrorStackModel(const ErrorStack &stack, QObject *parent=nullptr);
+
+  int rowCount(const QModelIndex &parent=QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
+
+protected:
+  /** The error messages. */
+  ErrorStack _stack;
+};
+
+#endif // ISSUEMODEL_HH
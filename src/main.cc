@@ -5,7 +5,9 @@
 #include <QMessageBox>
 #include "logger.hh"
 #include "settings.hh"
+#include "tracer.hh"
 #include <stdio.h>
+#include <string.h>
 #include <QSplashScreen>
 
 int main(int argc, char *argv[])
@@ -13,6 +15,24 @@ int main(int argc, char *argv[])
   QTextStream out(stderr);
   Logger::get().addHandler(new StreamLogHandler(out));
 
+  // Extract the trace option, the remaining arguments are handled by the application
+  QString traceFile;
+  for (int i=1; i<(argc-1); i++) {
+    if (0 == strcmp(argv[i], "--trace")) {
+      traceFile = QString::fromLocal8Bit(argv[i+1]);
+      // Also moves the terminating null pointer
+      for (int j=i; j<=(argc-2); j++)
+        argv[j] = argv[j+2];
+      argc -= 2;
+      break;
+    }
+  }
+
+  // Start tracing before the application loads the codeplug passed as argument
+  ErrorStack err;
+  if ((! traceFile.isEmpty()) && (! Tracer::start(traceFile, err)))
+    logError() << "Cannot start trace: " << err.format();
+
   Application app(argc, argv);
 
   //QPixmap pixmap(":/icons/splash.png");
@@ -32,5 +52,8 @@ int main(int argc, char *argv[])
 
   app.exec();
 
+  if (Tracer::isEnabled() && (! Tracer::stop(err)))
+    logError() << "Cannot write trace: " << err.format();
+
   return 0;
 }
@@ -11,6 +11,7 @@
 #include "logger.hh"
 #include "frequency.hh"
 #include "interval.hh"
+#include "enumtable.hh"
 
 
 PropertyDelegate::PropertyDelegate(QObject *parent)
@@ -86,10 +87,11 @@ PropertyDelegate::setEditorData(QWidget *editor, const QModelIndex &index) const
   // Dispatch by type
   if (prop.isEnumType()) {
     QComboBox *box = dynamic_cast<QComboBox *>(editor);
-    QMetaEnum etype = prop.enumerator();
+    const EnumTable &etype = EnumTable::get(prop.enumerator());
+    int current = prop.read(obj).toInt();
     for (int i=0; i<etype.keyCount(); i++) {
         box->addItem(etype.key(i), QVariant(etype.value(i)));
-        if (etype.value(i) == prop.read(obj).toInt())
+        if (etype.value(i) == current)
           box->setCurrentIndex(i);
     }
   } else if (QVariant::Bool == prop.type()) {
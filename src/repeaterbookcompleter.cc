@@ -5,15 +5,82 @@
 #include <QNetworkReply>
 #include <QStandardPaths>
 #include <QDir>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
 
 #include "logger.hh"
 #include "utils.hh"
 #include "settings.hh"
+#include "mappedfile.hh"
+
+/** Delay of the search after the last keystroke in ms. */
+#define SEARCH_DEBOUNCE_MS 300
+/** Number of journal entries, after which the complete cache gets rewritten. */
+#define JOURNAL_COMPACT_ENTRIES 256
+/** Time in ms without further queries, after which a large journal gets compacted. */
+#define COMPACT_IDLE_MS 30000
+/** Identifies the binary cache and journal ("RBC1"). */
+#define CACHE_MAGIC 0x31434252
+/** Journal entry holding an updated repeater. */
+#define JOURNAL_REPEATER 1
+/** Journal entry holding a query. */
+#define JOURNAL_QUERY 2
+/** Delay of the first prefetch after start-up in ms, keeps the start-up responsive. */
+#define PREFETCH_IDLE_MS 30000
+/** Interval in ms, at which the prefetched region is checked for staleness. */
+#define PREFETCH_CHECK_MS 3600000
+/** Age in days, after which a prefetched region gets refreshed. */
+#define PREFETCH_REFRESH_DAYS 1
+/** Prefix of the query key of a prefetched region, calls never start with it. */
+#define PREFETCH_QUERY_PREFIX "@"
+
+/* The binary cache consists of a header, followed by the fixed-width records of all repeaters and
+ * queries and the pool of their strings. Numbers are stored in native byte order, as the cache
+ * is local to the machine. The journal consists of a header without records, followed by
+ * self-contained entries, each with its own string pool. */
+
+/** Header of the binary cache and the journal. */
+struct CacheHeader {
+  quint32 magic;          ///< Format identifier, see @c CACHE_MAGIC.
+  quint32 recordSize;     ///< Size of a repeater record, detects changes of the format.
+  quint32 records;        ///< Number of repeater records.
+  quint32 queries;        ///< Number of query records.
+  quint32 poolSize;       ///< Size of the string pool in bytes.
+  quint32 reserved;       ///< Keeps the records aligned.
+};
+
+/** Record of a query. */
+struct QueryRecord {
+  quint32 query;          ///< Offset of the query string within the pool.
+  quint16 length;         ///< Length of the query string in bytes.
+  quint16 reserved;       ///< Keeps the timestamp aligned.
+  qint64 timestamp;       ///< Time of the query in seconds since epoch.
+};
+
+/** Header of every journal entry. */
+struct JournalHeader {
+  quint32 type;           ///< Either @c JOURNAL_REPEATER or @c JOURNAL_QUERY.
+  quint32 poolSize;       ///< Size of the string pool following the record.
+};
 
 
 /* ********************************************************************************************* *
  * Helper functions
  * ********************************************************************************************* */
+/** Returns the directory holding the repeater cache, creates it if needed. */
+static QString
+dataPath() {
+  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  QDir directory;
+  if ((! directory.exists(path)) && (!directory.mkpath(path))) {
+    logError() << "Cannot create path '" << path << "'.";
+    return "";
+  }
+  return path;
+}
+
 static const QSet<double> _aprs_frequencies = {
   144.390, 144.575, 144.660, 144.800, 144.930, 145.175, 145.570, 432.500
 };
@@ -42,39 +109,15 @@ inline QString bandName(double rx, double tx) {
 /* ********************************************************************************************* *
  * RepeaterBookEntry
  * ********************************************************************************************* */
-RepeaterBookEntry::RepeaterBookEntry(QObject *parent)
-  : QObject(parent), _id(), _call(), _location(), _qth(), _rxFrequency(0), _txFrequency(0),
+RepeaterBookEntry::RepeaterBookEntry()
+  : _id(), _call(), _location(), _qth(), _rxFrequency(0), _txFrequency(0),
     _isFM(false), _isDMR(false), _rxTone(Signaling::SIGNALING_NONE),
-    _txTone(Signaling::SIGNALING_NONE), _colorCode(0), _timestamp(QDateTime::currentDateTime())
-{
-}
-
-RepeaterBookEntry::RepeaterBookEntry(const RepeaterBookEntry &other)
-  : QObject(other.parent()), _id(other._id), _call(other._call), _location(other._location),
-    _qth(other._qth), _rxFrequency(other._rxFrequency), _txFrequency(other._txFrequency),
-    _isFM(other._isFM), _isDMR(other._isDMR), _rxTone(other._rxTone), _txTone(other._txTone),
-    _colorCode(other._colorCode), _timestamp(other._timestamp)
+    _txTone(Signaling::SIGNALING_NONE), _colorCode(0),
+    _timestamp(QDateTime::currentSecsSinceEpoch())
 {
   // pass...
 }
 
-RepeaterBookEntry &
-RepeaterBookEntry::operator =(const RepeaterBookEntry &other) {
-  _id = other._id;
-  _call = other._call;
-  _location = other._location;
-  _qth = other._qth;
-  _rxFrequency = other._rxFrequency;
-  _txFrequency = other._txFrequency;
-  _isFM = other._isFM;
-  _isDMR = other._isDMR;
-  _rxTone = other._rxTone;
-  _txTone = other._txTone;
-  _colorCode = other._colorCode;
-  _timestamp = other._timestamp;
-  return *this;
-}
-
 bool
 RepeaterBookEntry::isValid() const {
   return (!_call.isEmpty()) && (0!=_rxFrequency) && (0!=_txFrequency);
@@ -139,7 +182,12 @@ RepeaterBookEntry::colorCode() const {
 
 qint64
 RepeaterBookEntry::age() const {
-  return _timestamp.daysTo(QDateTime::currentDateTime());
+  return (QDateTime::currentSecsSinceEpoch() - _timestamp)/(24*3600);
+}
+
+quint64
+RepeaterBookEntry::memorySize() const {
+  return MemoryUsage::of(_id) + MemoryUsage::of(_call) + MemoryUsage::of(_qth);
 }
 
 bool
@@ -172,62 +220,57 @@ RepeaterBookEntry::fromRepeaterBook(const QJsonObject &obj) {
   }
 
   if (obj.contains("timestamp"))
-    _timestamp = QDateTime::fromString(obj["timestamp"].toString(), Qt::ISODate);
+    _timestamp = QDateTime::fromString(obj["timestamp"].toString(), Qt::ISODate).toSecsSinceEpoch();
 
   return isValid();
 }
 
 bool
-RepeaterBookEntry::fromCache(const QJsonObject &obj) {
-  // Handle repeater ID
-  _id = obj["id"].toString();
-  // Handle basic properties
-  _call = obj["Callsign"].toString();
-  _rxFrequency = obj["Frequency"].toDouble();
-  _txFrequency = obj["Input Freq"].toDouble();
-  _location = QGeoCoordinate(obj["Lat"].toDouble(), obj["Long"].toDouble());
-  _qth = obj["Nearest City"].toString();
-  _isFM = obj["FM Analog"].toBool();
-  _isDMR = obj["DMR"].toBool();
+RepeaterBookEntry::fromRecord(const Record &rec, const char *pool, quint32 poolSize) {
+  if ((quint64(rec.id)+rec.idLength > poolSize) || (quint64(rec.call)+rec.callLength > poolSize)
+      || (quint64(rec.qth)+rec.qthLength > poolSize))
+    return false;
 
-  if (_isFM) {
-    if (obj.contains("PL"))
-      _txTone = Signaling::fromCTCSSFrequency(obj["PL"].toDouble());
-    if (obj.contains("TSQ"))
-      _rxTone = Signaling::fromCTCSSFrequency(obj["TSQ"].toDouble());
-  }
-  if (_isDMR) {
-    if (obj.contains("DMR Color Code"))
-      _colorCode = obj["DMR Color Code"].toInt();
-  }
-  if (obj.contains("timestamp"))
-    _timestamp = QDateTime::fromString(obj["timestamp"].toString(), Qt::ISODate);
+  _id = QString::fromUtf8(pool+rec.id, rec.idLength);
+  _call = QString::fromUtf8(pool+rec.call, rec.callLength);
+  _qth = QString::fromUtf8(pool+rec.qth, rec.qthLength);
+  _location = QGeoCoordinate(rec.latitude, rec.longitude);
+  _rxFrequency = rec.rxFrequency;
+  _txFrequency = rec.txFrequency;
+  _isFM = (rec.flags & 1);
+  _isDMR = (rec.flags & 2);
+  _rxTone = Signaling::Code(rec.rxTone);
+  _txTone = Signaling::Code(rec.txTone);
+  _colorCode = rec.colorCode;
+  _timestamp = rec.timestamp;
   return isValid();
 }
 
-QJsonObject
-RepeaterBookEntry::toCache() const {
-  QJsonObject obj;
-  obj.insert("id", _id);
-  obj.insert("Callsign", _call);
-  obj.insert("Frequency", _rxFrequency);
-  obj.insert("Input Freq", _txFrequency);
-  obj.insert("Lat", _location.latitude());
-  obj.insert("Long", _location.longitude());
-  obj.insert("Nearest City", _qth);
-  obj.insert("timestamp", _timestamp.toString(Qt::ISODate));
-  obj.insert("FM Analog", _isFM);
-  obj.insert("DMR", _isDMR);
-  if (_isFM) {
-    if (Signaling::SIGNALING_NONE != _txTone)
-      obj.insert("PL", Signaling::toCTCSSFrequency(_txTone));
-    if (Signaling::SIGNALING_NONE != _rxTone)
-      obj.insert("TSQ", Signaling::toCTCSSFrequency(_rxTone));
-  }
-  if (_isDMR) {
-    obj.insert("DMR Color Code", (int)_colorCode);
-  }
-  return obj;
+/** Appends the UTF-8 representation of the string to the pool and returns its offset and
+ * length. Strings are cut at 64k. */
+static inline void
+appendToPool(const QString &str, QByteArray &pool, quint32 &offset, quint16 &length) {
+  QByteArray utf8 = str.toUtf8().left(0xffff);
+  offset = pool.size();
+  length = utf8.size();
+  pool.append(utf8);
+}
+
+void
+RepeaterBookEntry::toRecord(Record &rec, QByteArray &pool) const {
+  memset(&rec, 0, sizeof(Record));
+  appendToPool(_id, pool, rec.id, rec.idLength);
+  appendToPool(_call, pool, rec.call, rec.callLength);
+  appendToPool(_qth, pool, rec.qth, rec.qthLength);
+  rec.latitude = _location.latitude();
+  rec.longitude = _location.longitude();
+  rec.rxFrequency = _rxFrequency;
+  rec.txFrequency = _txFrequency;
+  rec.flags = (_isFM ? 1 : 0) | (_isDMR ? 2 : 0);
+  rec.rxTone = _rxTone;
+  rec.txTone = _txTone;
+  rec.colorCode = _colorCode;
+  rec.timestamp = _timestamp;
 }
 
 
@@ -235,13 +278,29 @@ RepeaterBookEntry::toCache() const {
  * RepeaterBookList
  * ********************************************************************************************* */
 RepeaterBookList::RepeaterBookList(QObject *parent)
-  : QAbstractListModel(parent), _network(), _currentReply(nullptr),
+  : QAbstractListModel(parent), _network(), _currentReply(nullptr), _currentQuery(),
+    _pendingQuery(), _searchTimer(), _prefetchReply(nullptr), _prefetchRegion(), _prefetchTimer(),
+    _journalSize(0), _compactTimer(),
     _callsignPattern(R"re(([a-z]|[a-z0-9][a-z]|[a-z][a-z0-9])[0-9]+[a-z]*)re",
                      QRegularExpression::CaseInsensitiveOption)
 {
+  _searchTimer.setSingleShot(true);
+  _searchTimer.setInterval(SEARCH_DEBOUNCE_MS);
+  connect(&_searchTimer, SIGNAL(timeout()), this, SLOT(onSearchTimeout()));
+  _compactTimer.setSingleShot(true);
+  _compactTimer.setInterval(COMPACT_IDLE_MS);
+  connect(&_compactTimer, SIGNAL(timeout()), this, SLOT(onCompact()));
+
   load();
   connect(&_network, SIGNAL(finished(QNetworkReply*)),
           this, SLOT(onRequestFinished(QNetworkReply*)));
+
+  // Prefetch the configured region once idle, refresh it once stale
+  _prefetchRegion = Settings().repeaterBookPrefetch();
+  _prefetchTimer.setSingleShot(true);
+  _prefetchTimer.setInterval(PREFETCH_IDLE_MS);
+  connect(&_prefetchTimer, SIGNAL(timeout()), this, SLOT(onPrefetchTimeout()));
+  _prefetchTimer.start();
 }
 
 int
@@ -271,162 +330,398 @@ RepeaterBookList::data(const QModelIndex &index, int role) const {
 
 const RepeaterBookEntry *
 RepeaterBookList::repeater(int row) const {
-  if (row >= _items.count())
+  if ((0 > row) || (row >= _items.count()))
     return nullptr;
   return &(_items[row]);
 }
 
+QVector<double>
+RepeaterBookList::distances(const QGeoCoordinate &location) const {
+  return _positions.distances(location);
+}
+
+QVector<int>
+RepeaterBookList::nearest(const QGeoCoordinate &location, int k,
+                          const std::function<bool(const RepeaterBookEntry &)> &filter) const
+{
+  if (! filter)
+    return _positions.nearest(location, k);
+  return _positions.nearest(location, k, [this, &filter](int row) {
+    return filter(_items[row]);
+  });
+}
+
+MemoryUsage
+RepeaterBookList::memoryUsage() const {
+  MemoryUsage usage("Repeater book", sizeof(*this));
+
+  quint64 items = MemoryUsage::of(_items) + _positions.memorySize();
+  foreach (const RepeaterBookEntry &entry, _items)
+    items += entry.memorySize();
+  usage.add(MemoryUsage("Repeaters", items, _items.size()));
+
+  quint64 rows = MemoryUsage::of(_rows);
+  for (QHash<QString, int>::const_iterator it=_rows.begin(); it!=_rows.end(); it++)
+    rows += MemoryUsage::of(it.key());
+  usage.add(MemoryUsage("ID index", rows, _rows.size()));
+
+  quint64 queries = MemoryUsage::of(_queries);
+  for (QHash<QString, QDateTime>::const_iterator it=_queries.begin(); it!=_queries.end(); it++)
+    queries += MemoryUsage::of(it.key());
+  usage.add(MemoryUsage("Queries", queries, _queries.size()));
+
+  return usage;
+}
+
 QString
 RepeaterBookList::cachePath() const {
-  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-  QDir directory;
-  if ((! directory.exists(path)) && (!directory.mkpath(path))) {
-    logError() << "Cannot create path '" << path << "'.";
+  QString path = dataPath();
+  if (path.isEmpty())
     return "";
-  }
-  return path+"/repeaterbook.cache.json";
+  return path+"/repeaterbook.cache.bin";
 }
 
 QString
-RepeaterBookList::queryPath() const {
-  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-  QDir directory;
-  if ((! directory.exists(path)) && (!directory.mkpath(path))) {
-    logError() << "Cannot create path '" << path << "'.";
+RepeaterBookList::journalPath() const {
+  QString path = dataPath();
+  if (path.isEmpty())
     return "";
-  }
-  return path+"/repeaterbook.query.json";
+  return path+"/repeaterbook.journal.bin";
 }
 
 bool
 RepeaterBookList::load() {
-  QFile file(cachePath());
-  if (! file.open(QIODevice::ReadOnly)) {
-    logInfo() << "Cannot open repeater cache '" << file.fileName() << "'.";
-    return false;
-  }
+  bool ok = loadSnapshot();
+  replayJournal();
+  // Fold a large journal into the snapshot, once idle
+  if (_journalSize > JOURNAL_COMPACT_ENTRIES)
+    _compactTimer.start();
+  return ok;
+}
 
-  QJsonParseError err;
-  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &err);
-  if (doc.isNull()) {
-    logError() << "Cannot parse '" << file.fileName() << "': " << err.errorString() << ".";
-    return false;
+bool
+RepeaterBookList::loadSnapshot() {
+  // Former versions kept the cache as JSON. It is just dropped, as entries expire within days.
+  QString path = dataPath();
+  foreach (const QString &legacy, QStringList({"repeaterbook.cache.json", "repeaterbook.query.json",
+                                               "repeaterbook.journal.json"})) {
+    if ((! path.isEmpty()) && QFile::exists(path+"/"+legacy))
+      QFile::remove(path+"/"+legacy);
   }
-  file.close();
 
-  beginResetModel();
-  _items.clear();
-  foreach (const QJsonValue &rep, doc.array()) {
-    RepeaterBookEntry entry;
-    if (! entry.fromCache(rep.toObject()))
-      continue;
-    if (5 < entry.age())
-      continue;
-    _items.append(entry);
+  if (! QFile::exists(cachePath())) {
+    logInfo() << "No repeater cache '" << cachePath() << "' yet.";
+    return false;
   }
-  endResetModel();
-
-  logDebug() << "Loaded repeater cache of " << _items.count() << " entries.";
 
-  file.setFileName(queryPath());
-  if (!file.open(QIODevice::ReadOnly)) {
-    logError() << "Cannot open query cache '" << file.fileName()
-               << "': " << file.errorString() << ".";
+  ErrorStack err;
+  MappedFile file;
+  CacheHeader header;
+  if ((! file.open(cachePath(), err)) || (! file.copy(0, &header, sizeof(CacheHeader), err))) {
+    logError() << "Cannot read repeater cache '" << cachePath() << "': " << err.format();
     return false;
   }
-
-  doc = QJsonDocument::fromJson(file.readAll(), &err);
-  if (doc.isNull()) {
-    logError() << "Cannot parse '" << file.fileName() << "': " << err.errorString() << ".";
+  if ((CACHE_MAGIC != header.magic) || (sizeof(RepeaterBookEntry::Record) != header.recordSize)) {
+    logError() << "Cannot read repeater cache '" << cachePath() << "': Unknown format.";
     return false;
   }
-  file.close();
 
-  if (! doc.isArray()) {
-    logError() << "Unexpected format for query cache: Expected array.";
+  size_t recordOffset = sizeof(CacheHeader);
+  size_t queryOffset = recordOffset + size_t(header.records)*sizeof(RepeaterBookEntry::Record);
+  size_t poolOffset = queryOffset + size_t(header.queries)*sizeof(QueryRecord);
+  if ((poolOffset + header.poolSize) > file.size()) {
+    logError() << "Cannot read repeater cache '" << cachePath() << "': File truncated.";
     return false;
   }
+  const char *pool = reinterpret_cast<const char *>(file.data()) + poolOffset;
 
-  foreach (const QJsonValue &entry, doc.array()) {
-    if (! entry.isObject())
+  QVector<RepeaterBookEntry> entries; entries.reserve(header.records);
+  for (quint32 i=0; i<header.records; i++) {
+    RepeaterBookEntry::Record rec; RepeaterBookEntry entry;
+    memcpy(&rec, file.data() + recordOffset + i*sizeof(RepeaterBookEntry::Record), sizeof(rec));
+    if ((! entry.fromRecord(rec, pool, header.poolSize)) || (5 < entry.age()))
       continue;
-    QJsonObject obj = entry.toObject();
-    if ((! obj.contains("query")) || (! obj.contains("timestamp")))
+    entries.append(entry);
+  }
+
+  // Keep entries sorted by call, this allows for a binary search by the completer. The cache is
+  // written sorted, hence this is usually a no-op.
+  auto byCall = [](const RepeaterBookEntry &a, const RepeaterBookEntry &b) {
+    return 0 > QString::compare(a.call(), b.call(), Qt::CaseInsensitive);
+  };
+  if (! std::is_sorted(entries.begin(), entries.end(), byCall))
+    std::stable_sort(entries.begin(), entries.end(), byCall);
+
+  beginResetModel();
+  _items = entries;
+  _positions.clear(); _positions.reserve(_items.size());
+  foreach (const RepeaterBookEntry &entry, _items)
+    _positions.append(entry.location());
+  rebuildRows();
+  endResetModel();
+
+  for (quint32 i=0; i<header.queries; i++) {
+    QueryRecord rec;
+    memcpy(&rec, file.data() + queryOffset + i*sizeof(QueryRecord), sizeof(rec));
+    if ((quint64(rec.query) + rec.length) > header.poolSize)
       continue;
-    _queries[obj["query"].toString()] = QDateTime::fromString(
-          obj["timestamp"].toString(), Qt::ISODate);
+    _queries[QString::fromUtf8(pool+rec.query, rec.length)] =
+        QDateTime::fromSecsSinceEpoch(rec.timestamp);
   }
 
+  logDebug() << "Loaded repeater cache of " << _items.count() << " entries and "
+             << _queries.size() << " queries.";
+
   return true;
 }
 
+void
+RepeaterBookList::replayJournal() {
+  _journalSize = 0;
+  if (! QFile::exists(journalPath()))
+    return;
+
+  ErrorStack err;
+  MappedFile file;
+  CacheHeader header;
+  if ((! file.open(journalPath(), err)) || (! file.copy(0, &header, sizeof(CacheHeader), err))) {
+    logError() << "Cannot read repeater journal '" << journalPath() << "': " << err.format();
+    return;
+  }
+  if ((CACHE_MAGIC != header.magic) || (sizeof(RepeaterBookEntry::Record) != header.recordSize)) {
+    logError() << "Cannot read repeater journal '" << journalPath() << "': Unknown format.";
+    return;
+  }
+
+  // Every entry holds either an updated repeater or a query. An incomplete last entry (e.g., due
+  // to a crash while writing) is just ignored.
+  size_t offset = sizeof(CacheHeader);
+  JournalHeader entry;
+  while (file.copy(offset, &entry, sizeof(JournalHeader))) {
+    size_t recordSize = (JOURNAL_REPEATER == entry.type) ? sizeof(RepeaterBookEntry::Record) :
+                                                           sizeof(QueryRecord);
+    size_t poolOffset = offset + sizeof(JournalHeader) + recordSize;
+    if (((JOURNAL_REPEATER != entry.type) && (JOURNAL_QUERY != entry.type))
+        || ((poolOffset + entry.poolSize) > file.size()))
+      break;
+    const char *pool = reinterpret_cast<const char *>(file.data()) + poolOffset;
+
+    if (JOURNAL_REPEATER == entry.type) {
+      RepeaterBookEntry::Record rec; RepeaterBookEntry repeater;
+      file.copy(offset + sizeof(JournalHeader), &rec, sizeof(rec));
+      if (repeater.fromRecord(rec, pool, entry.poolSize) && (5 >= repeater.age()))
+        updateEntry(repeater);
+    } else {
+      QueryRecord rec;
+      file.copy(offset + sizeof(JournalHeader), &rec, sizeof(rec));
+      if ((quint64(rec.query) + rec.length) <= entry.poolSize)
+        _queries[QString::fromUtf8(pool+rec.query, rec.length)] =
+            QDateTime::fromSecsSinceEpoch(rec.timestamp);
+    }
+
+    offset = poolOffset + entry.poolSize;
+    _journalSize++;
+  }
+
+  logDebug() << "Replayed " << _journalSize << " entries of the repeater journal.";
+}
+
 bool
-RepeaterBookList::store() const {
-  QFile file(cachePath());
-  if (!file.open(QIODevice::WriteOnly)) {
-    logError() << "Cannot open repeater cache '" << file.fileName() << "': "
+RepeaterBookList::appendJournal(const QString &query, const QVector<RepeaterBookEntry> &entries) {
+  QFile file(journalPath());
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    logError() << "Cannot open repeater journal '" << file.fileName() << "': "
                << file.errorString();
     return false;
   }
 
-  QJsonArray array;
-  foreach (const RepeaterBookEntry &entry, _items) {
-    array.append(entry.toCache());
+  // Assemble all entries first, such that they are appended with a single write
+  QByteArray data;
+  if (0 == file.size()) {
+    CacheHeader header; memset(&header, 0, sizeof(CacheHeader));
+    header.magic = CACHE_MAGIC;
+    header.recordSize = sizeof(RepeaterBookEntry::Record);
+    data.append(reinterpret_cast<const char *>(&header), sizeof(CacheHeader));
   }
 
-  file.write(QJsonDocument(array).toJson());
-  file.flush();
+  foreach (const RepeaterBookEntry &entry, entries) {
+    QByteArray pool; RepeaterBookEntry::Record rec;
+    entry.toRecord(rec, pool);
+    JournalHeader head = {JOURNAL_REPEATER, quint32(pool.size())};
+    data.append(reinterpret_cast<const char *>(&head), sizeof(JournalHeader));
+    data.append(reinterpret_cast<const char *>(&rec), sizeof(rec));
+    data.append(pool);
+  }
+
+  QByteArray pool; QueryRecord rec; memset(&rec, 0, sizeof(QueryRecord));
+  appendToPool(query, pool, rec.query, rec.length);
+  rec.timestamp = _queries[query].toSecsSinceEpoch();
+  JournalHeader head = {JOURNAL_QUERY, quint32(pool.size())};
+  data.append(reinterpret_cast<const char *>(&head), sizeof(JournalHeader));
+  data.append(reinterpret_cast<const char *>(&rec), sizeof(rec));
+  data.append(pool);
+
+  if (data.size() != file.write(data)) {
+    logError() << "Cannot append to repeater journal '" << file.fileName() << "': "
+               << file.errorString();
+    return false;
+  }
   file.close();
 
-  logDebug() << "Stored repeater cache of " << array.count() << " entries.";
+  _journalSize += entries.size() + 1;
+  return true;
+}
+
+bool
+RepeaterBookList::store() const {
+  QByteArray pool;
+  QVector<RepeaterBookEntry::Record> records(_items.size());
+  for (int i=0; i<_items.size(); i++)
+    _items[i].toRecord(records[i], pool);
+
+  QVector<QueryRecord> queries; queries.reserve(_queries.size());
+  for (QHash<QString, QDateTime>::const_iterator it=_queries.begin(); it!=_queries.end(); it++) {
+    QueryRecord rec; memset(&rec, 0, sizeof(QueryRecord));
+    appendToPool(it.key(), pool, rec.query, rec.length);
+    rec.timestamp = it.value().toSecsSinceEpoch();
+    queries.append(rec);
+  }
+
+  CacheHeader header; memset(&header, 0, sizeof(CacheHeader));
+  header.magic = CACHE_MAGIC;
+  header.recordSize = sizeof(RepeaterBookEntry::Record);
+  header.records = records.size();
+  header.queries = queries.size();
+  header.poolSize = pool.size();
 
-  file.setFileName(queryPath());
+  // Replace the cache atomically, the journal remains valid until the new cache is complete
+  QSaveFile file(cachePath());
   if (! file.open(QIODevice::WriteOnly)) {
-    logError() << "Cannot open repeater queries '" << file.fileName() << "': "
+    logError() << "Cannot open repeater cache '" << file.fileName() << "': "
                << file.errorString();
     return false;
   }
-
-  array = QJsonArray();
-  QHashIterator<QString, QDateTime> iter(_queries);
-  while (iter.hasNext()) {
-    iter.next();
-    QJsonObject obj;
-    obj.insert("query", iter.key());
-    obj.insert("timestamp", iter.value().toString(Qt::ISODate));
-    array.append(obj);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(CacheHeader));
+  file.write(reinterpret_cast<const char *>(records.constData()),
+             records.size()*sizeof(RepeaterBookEntry::Record));
+  file.write(reinterpret_cast<const char *>(queries.constData()), queries.size()*sizeof(QueryRecord));
+  file.write(pool);
+  if (! file.commit()) {
+    logError() << "Cannot write repeater cache '" << file.fileName() << "': "
+               << file.errorString();
+    return false;
   }
 
-  file.write(QJsonDocument(array).toJson());
-  file.flush();
-  file.close();
+  logDebug() << "Stored repeater cache of " << records.size() << " entries and "
+             << queries.size() << " queries.";
+
+  // Snapshot holds everything now
+  QFile::remove(journalPath());
+  _journalSize = 0;
 
   return true;
 }
 
 void
-RepeaterBookList::search(const QString &text) {
-  // Cancel running requests
-  if (_currentReply)
-    _currentReply->abort();
+RepeaterBookList::onCompact() {
+  store();
+}
 
+void
+RepeaterBookList::search(const QString &text) {
   QRegularExpressionMatch match = _callsignPattern.match(text);
   if (! match.hasMatch())
     return;
   QString call = match.captured().toUpper();
+
+  // Already covered by a recent or running query for a prefix
+  if (isCovered(call))
+    return;
+
+  // Cancel running requests, that do not cover the new call
+  if (_currentReply)
+    _currentReply->abort();
+
+  // Wait for the user to stop typing
+  _pendingQuery = call;
+  _searchTimer.start();
+}
+
+bool
+RepeaterBookList::isCovered(const QString &call) const {
+  if ((nullptr != _currentReply) && call.startsWith(_currentQuery))
+    return true;
+  // Searches are served from the list, while the prefetched region is fresh
+  if (isPrefetched(_prefetchRegion))
+    return true;
+  QDateTime now = QDateTime::currentDateTime();
+  for (int n=call.size(); n>0; n--) {
+    QHash<QString, QDateTime>::const_iterator query = _queries.constFind(call.left(n));
+    if ((_queries.constEnd() != query) && (query->daysTo(now)<3))
+      return true;
+  }
+  return false;
+}
+
+void
+RepeaterBookList::onSearchTimeout() {
+  QString call = _pendingQuery;
+  _pendingQuery.clear();
+  if (call.isEmpty() || isCovered(call))
+    return;
+
   logDebug() << "Search for (partial) call '" << call << "'.";
 
-  if ((_queries.contains(call)) && (_queries[call].daysTo(QDateTime::currentDateTime())<3))
+  QUrlQuery items;
+  items.addQueryItem("callsign", QString("%1%").arg(call));
+  _currentQuery = call;
+  _currentReply = query(items);
+}
+
+bool
+RepeaterBookList::isPrefetched(const QString &region) const {
+  if (region.isEmpty())
+    return false;
+  QHash<QString, QDateTime>::const_iterator query = _queries.constFind(PREFETCH_QUERY_PREFIX + region);
+  return (_queries.constEnd() != query) && (query->daysTo(QDateTime::currentDateTime()) < 3);
+}
+
+void
+RepeaterBookList::prefetch(const QString &region) {
+  if (region.isEmpty() || (nullptr != _prefetchReply))
     return;
 
+  logDebug() << "Prefetch repeaters of region '" << region << "'.";
+
+  // The world-wide API filters by country, the North American one by state
+  QUrlQuery items;
+  if (Region::World == Settings().repeaterBookRegion())
+    items.addQueryItem("country", region);
+  else
+    items.addQueryItem("state", region);
+  _prefetchReply = query(items);
+}
+
+void
+RepeaterBookList::onPrefetchTimeout() {
+  _prefetchRegion = Settings().repeaterBookPrefetch();
+  QDateTime last = _queries.value(PREFETCH_QUERY_PREFIX + _prefetchRegion);
+  if ((! _prefetchRegion.isEmpty())
+      && ((! last.isValid()) || (last.daysTo(QDateTime::currentDateTime()) >= PREFETCH_REFRESH_DAYS)))
+    prefetch(_prefetchRegion);
+
+  _prefetchTimer.setInterval(PREFETCH_CHECK_MS);
+  _prefetchTimer.start();
+}
+
+QNetworkReply *
+RepeaterBookList::query(const QUrlQuery &query) {
   QUrl url;
   if (Region::World == Settings().repeaterBookRegion())
     url = QUrl("https://www.repeaterbook.com/api/exportROW.php");
   else
     url = QUrl("https://www.repeaterbook.com/api/export.php");
 
-  QUrlQuery query;
-  query.addQueryItem("callsign", QString("%1%").arg(call));
   url.setQuery(query);
   QNetworkRequest request(url);
   request.setHeader(
@@ -435,15 +730,23 @@ RepeaterBookList::search(const QString &text) {
         "Chrome/115.0.0.0 Safari/537.36 Edg/114.0.1823.86");
   logDebug() << "Query RepeaterBook at " << url.toString()
              << " as '" << request.header(QNetworkRequest::UserAgentHeader).toString() << "'.";
-  _currentReply = _network.get(request);
+  return _network.get(request);
 }
 
 void
 RepeaterBookList::onRequestFinished(QNetworkReply *reply) {
+  bool isPrefetch = (reply == _prefetchReply);
+  if (reply == _currentReply) {
+    _currentReply = nullptr;
+    _currentQuery.clear();
+  } else if (isPrefetch) {
+    _prefetchReply = nullptr;
+  }
+
   if (reply->error()) {
-    logError() << "Cannot download repeater list: " << reply->errorString();
+    if (QNetworkReply::OperationCanceledError != reply->error())
+      logError() << "Cannot download repeater list: " << reply->errorString();
     reply->deleteLater();
-    _currentReply = nullptr;
     return;
   }
 
@@ -454,54 +757,134 @@ RepeaterBookList::onRequestFinished(QNetworkReply *reply) {
     logError() << "Cannot parse response: " << err.errorString() << ".";
     logDebug() << "Got '" << content << "'.";
     reply->deleteLater();
-    _currentReply = nullptr;
     return;
   }
 
-  QString query = QUrlQuery(reply->request().url()).queryItemValue("callsign", QUrl::FullyDecoded).remove("%");
+  QUrlQuery items(reply->request().url());
+  QString query = items.queryItemValue("callsign", QUrl::FullyDecoded).remove("%");
+  if (isPrefetch)
+    query = PREFETCH_QUERY_PREFIX + items.queryItemValue(items.hasQueryItem("country") ? "country" : "state",
+                                                         QUrl::FullyDecoded);
   _queries[query] = QDateTime::currentDateTime();
 
   reply->deleteLater();
-  _currentReply = nullptr;
 
   if ((! doc.isObject()) || (! doc.object().contains("results")) || (! doc.object()["results"].isArray())) {
     logError() << "Cannot parse response: Unexpected structure.";
-    reply->deleteLater();
-    _currentReply = nullptr;
     return;
   }
 
   QJsonArray results = doc.object()["results"].toArray();
+
+  // A region holds thousands of repeaters, merge them at once and rewrite the cache
+  if (isPrefetch) {
+    QVector<RepeaterBookEntry> entries; entries.reserve(results.size());
+    foreach (const QJsonValue &rep, results) {
+      RepeaterBookEntry entry;
+      if (entry.fromRepeaterBook(rep.toObject()))
+        entries.append(entry);
+    }
+    mergeEntries(entries);
+    logDebug() << "Prefetched " << entries.size() << " repeaters of region '"
+               << query.mid(strlen(PREFETCH_QUERY_PREFIX)) << "'.";
+    store();
+    return;
+  }
+
+  QVector<RepeaterBookEntry> updated;
   foreach (const QJsonValue &rep, results) {
     RepeaterBookEntry entry;
     if (! entry.fromRepeaterBook(rep.toObject()))
       continue;
     updateEntry(entry);
+    updated.append(entry);
   }
 
   logDebug() << "Updated repeater cache with " << results.count() << " entries.";
 
-
-  store();
+  // Only append the changes, the complete cache gets rewritten once the journal grows large and
+  // no further queries are answered for a while.
+  if (! appendJournal(query, updated))
+    store();
+  else if (_journalSize > JOURNAL_COMPACT_ENTRIES)
+    _compactTimer.start();
 }
 
 bool
 RepeaterBookList::updateEntry(const RepeaterBookEntry &entry) {
-  for (int i=0; i<_items.count(); i++) {
+  QHash<QString, int>::const_iterator row = _rows.constFind(entry.id());
+  if ((_rows.constEnd() != row) && (0 == QString::compare(_items[*row].call(), entry.call(), Qt::CaseInsensitive))) {
     // Update entry
-    if (_items[i].id() == entry.id()) {
-      _items[i] = entry;
-      return true;
-    }
+    _items[*row] = entry;
+    _positions.replace(*row, entry.location());
+    emit dataChanged(index(*row), index(*row));
+    return true;
+  }
+
+  if (_rows.constEnd() != row) {
+    // Call changed, remove and insert at new position
+    int idx = *row;
+    beginRemoveRows(QModelIndex(), idx, idx);
+    _items.remove(idx);
+    _positions.remove(idx);
+    rebuildRows();
+    endRemoveRows();
   }
 
-  // append entry
-  beginInsertRows(QModelIndex(), _items.count(), _items.count());
-  _items.append(entry);
+  // insert entry, keeping the entries sorted by call
+  QVector<RepeaterBookEntry>::const_iterator pos = std::upper_bound(
+        _items.constBegin(), _items.constEnd(), entry, [](const RepeaterBookEntry &a, const RepeaterBookEntry &b) {
+    return 0 > QString::compare(a.call(), b.call(), Qt::CaseInsensitive);
+  });
+  int idx = pos - _items.constBegin();
+  beginInsertRows(QModelIndex(), idx, idx);
+  _items.insert(idx, entry);
+  _positions.insert(idx, entry.location());
+  rebuildRows();
   endInsertRows();
   return true;
 }
 
+void
+RepeaterBookList::mergeEntries(const QVector<RepeaterBookEntry> &entries) {
+  beginResetModel();
+
+  // Replace known entries in place, append new ones
+  foreach (const RepeaterBookEntry &entry, entries) {
+    QHash<QString, int>::const_iterator row = _rows.constFind(entry.id());
+    if (_rows.constEnd() != row) {
+      _items[*row] = entry;
+    } else {
+      _rows.insert(entry.id(), _items.size());
+      _items.append(entry);
+    }
+  }
+
+  // Drop expired entries, these were not refreshed for too long
+  _items.erase(std::remove_if(_items.begin(), _items.end(), [](const RepeaterBookEntry &entry) {
+    return 5 < entry.age();
+  }), _items.end());
+
+  // Calls of updated entries may have changed, hence sort once for all
+  std::stable_sort(_items.begin(), _items.end(), [](const RepeaterBookEntry &a, const RepeaterBookEntry &b) {
+    return 0 > QString::compare(a.call(), b.call(), Qt::CaseInsensitive);
+  });
+  _positions.clear(); _positions.reserve(_items.size());
+  foreach (const RepeaterBookEntry &entry, _items)
+    _positions.append(entry.location());
+  rebuildRows();
+
+  endResetModel();
+}
+
+void
+RepeaterBookList::rebuildRows() {
+  _rows.clear();
+  _rows.reserve(_items.size());
+  for (int i=0; i<_items.size(); i++)
+    _rows.insert(_items[i].id(), i);
+}
+
 
 /* ********************************************************************************************* *
  * RepeaterBookCompleter
@@ -512,6 +895,8 @@ RepeaterBookCompleter::RepeaterBookCompleter(int minPrefixLength, RepeaterBookLi
 {
   setModel(_repeaterList);
   setCaseSensitivity(Qt::CaseInsensitive);
+  // The list is sorted by call, allows for a binary search instead of a linear scan
+  setModelSorting(QCompleter::CaseInsensitivelySortedModel);
 }
 
 QStringList
@@ -527,17 +912,39 @@ RepeaterBookCompleter::splitPath(const QString &path) const {
  * NearestRepeaterFilter
  * ********************************************************************************************* */
 NearestRepeaterFilter::NearestRepeaterFilter(RepeaterBookList *repeater, const QGeoCoordinate &location, QObject *parent)
-  : QSortFilterProxyModel(parent), _repeater(repeater), _location(location)
+  : QSortFilterProxyModel(parent), _repeater(repeater), _location(location), _distances()
 {
+  // Connect before setting the source model, the distances must be updated before the proxy
+  // sorts the changed rows.
+  connect(repeater, SIGNAL(modelReset()), this, SLOT(updateDistances()));
+  connect(repeater, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(updateDistances()));
+  connect(repeater, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(updateDistances()));
+  connect(repeater, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)), this, SLOT(updateDistances()));
+  _distances = _repeater->distances(_location);
   setSourceModel(repeater);
   sort(0);
 }
 
+const QGeoCoordinate &
+NearestRepeaterFilter::location() const {
+  return _location;
+}
+
+void
+NearestRepeaterFilter::setLocation(const QGeoCoordinate &location) {
+  _location = location;
+  updateDistances();
+  invalidate();
+}
+
+void
+NearestRepeaterFilter::updateDistances() {
+  _distances = _repeater->distances(_location);
+}
+
 bool
 NearestRepeaterFilter::lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const {
-  double ldist = _location.distanceTo(_repeater->repeater(source_left.row())->location());
-  double rdist = _location.distanceTo(_repeater->repeater(source_right.row())->location());
-  return ldist < rdist;
+  return _distances.value(source_left.row()) < _distances.value(source_right.row());
 }
 
 
@@ -8,17 +8,21 @@
 #include <QGeoCoordinate>
 #include <QDateTime>
 #include <QSortFilterProxyModel>
+#include <QTimer>
+#include <functional>
 #include "signaling.hh"
 #include "channel.hh"
+#include "memoryusage.hh"
+#include "geoindex.hh"
 
+class QUrlQuery;
 
-class RepeaterBookEntry: public QObject
+
+/** A plain value holding a single repeater from the RepeaterBook. */
+class RepeaterBookEntry
 {
 public:
-  explicit RepeaterBookEntry(QObject *parent=nullptr);
-  RepeaterBookEntry(const RepeaterBookEntry &other);
-
-  RepeaterBookEntry &operator =(const RepeaterBookEntry &other);
+  RepeaterBookEntry();
 
   bool isValid() const;
 
@@ -35,10 +39,27 @@ public:
   Signaling::Code txTone() const;
   unsigned int colorCode() const;
   qint64 age() const;
+  /** Returns an estimate of the heap memory held by the strings of the entry. */
+  quint64 memorySize() const;
 
   bool fromRepeaterBook(const QJsonObject &obj);
-  bool fromCache(const QJsonObject &obj);
-  QJsonObject toCache() const;
+
+  /** Fixed-width record of an entry within the binary cache. The strings are kept in a separate
+   * pool, referenced by offset and length of their UTF-8 representation. */
+  struct Record {
+    quint32 id, call, qth;                        ///< Offsets of the strings within the pool.
+    quint16 idLength, callLength, qthLength;      ///< Lengths of the strings in bytes.
+    quint16 rxTone, txTone;                       ///< The signaling codes.
+    quint8 flags;                                 ///< Bit 0: FM, bit 1: DMR.
+    quint8 colorCode;                             ///< The DMR color code.
+    double latitude, longitude;                   ///< The location.
+    double rxFrequency, txFrequency;              ///< The frequencies in MHz.
+    qint64 timestamp;                             ///< Seconds since epoch.
+  };
+  /** Reads the entry from the given record, the strings are taken from the given pool. */
+  bool fromRecord(const Record &rec, const char *pool, quint32 poolSize);
+  /** Writes the entry into the given record, appending its strings to the given pool. */
+  void toRecord(Record &rec, QByteArray &pool) const;
 
 protected:
   QString _id;
@@ -52,7 +73,8 @@ protected:
   Signaling::Code _rxTone;
   Signaling::Code _txTone;
   unsigned int _colorCode;
-  QDateTime _timestamp;
+  /** Time of the last update in seconds since epoch. */
+  qint64 _timestamp;
 };
 
 
@@ -74,24 +96,90 @@ public:
 
   const RepeaterBookEntry *repeater(int row) const;
 
+  /** Returns the distances (in meters) of all repeaters to the given location, indexed by row. */
+  QVector<double> distances(const QGeoCoordinate &location) const;
+  /** Returns the rows of the (at most) @c k repeaters closest to the given location in ascending
+   * order of their distance. If given, only repeaters accepted by @c filter are considered. */
+  QVector<int> nearest(const QGeoCoordinate &location, int k,
+                       const std::function<bool(const RepeaterBookEntry &)> &filter=nullptr) const;
+
+  /** Returns an estimate of the heap memory held by the repeaters, their positions and the
+   * cached queries. */
+  MemoryUsage memoryUsage() const;
+
 public slots:
   /** Searches the repeater book for the given call (or part of it). */
   void search(const QString &call);
+  /** Fetches all repeaters of the given country (world) or state (North America) at once. The
+   * result is merged into the list in a single batch. While the region is fresh, searches are
+   * served from the list only. */
+  void prefetch(const QString &region);
   bool load();
   bool store() const;
 
 protected slots:
   void onRequestFinished(QNetworkReply *reply);
+  /** Sends the pending query, once the user stopped typing. */
+  void onSearchTimeout();
+  /** Prefetches the region configured in the settings, once it got stale. */
+  void onPrefetchTimeout();
 
 protected:
+  /** Path of the binary cache, holding all entries and queries at the last @c store. */
   QString cachePath() const;
-  QString queryPath() const;
+  /** Path of the journal, collecting all changes since the last @c store. */
+  QString journalPath() const;
+  /** Loads the cache and queries written by @c store. */
+  bool loadSnapshot();
+  /** Applies all changes recorded in the journal. */
+  void replayJournal();
+  /** Appends the given updated entries and the query to the journal. */
+  bool appendJournal(const QString &query, const QVector<RepeaterBookEntry> &entries);
+
+protected slots:
+  /** Folds the journal into the cache, once no query was answered for a while. */
+  void onCompact();
+
+protected:
+  /** Returns @c true, if a recent or running query for a prefix of the given call exists. */
+  bool isCovered(const QString &call) const;
+  /** Returns @c true, if the given prefetched region is fresh. */
+  bool isPrefetched(const QString &region) const;
+  /** Sends a query to the repeater book. */
+  QNetworkReply *query(const QUrlQuery &query);
+  /** Updates or inserts the given entry. Entries are kept sorted by call. */
   bool updateEntry(const RepeaterBookEntry &entry);
+  /** Updates or inserts all given entries at once and drops expired ones. Unlike @c updateEntry,
+   * the list is sorted only once and the model gets reset instead of announcing every row. */
+  void mergeEntries(const QVector<RepeaterBookEntry> &entries);
+  /** Rebuilds the ID to row map. */
+  void rebuildRows();
 
 protected:
   QNetworkAccessManager _network;
   QNetworkReply *_currentReply;
-  QList<RepeaterBookEntry> _items;
+  /** The call searched by the current reply. */
+  QString _currentQuery;
+  /** The call to search for, once the search timer expires. */
+  QString _pendingQuery;
+  /** Debounces searches while typing. */
+  QTimer _searchTimer;
+  /** The running prefetch. */
+  QNetworkReply *_prefetchReply;
+  /** The region to prefetch, empty if disabled. */
+  QString _prefetchRegion;
+  /** Checks periodically, whether the prefetched region got stale. */
+  QTimer _prefetchTimer;
+  /** Number of entries in the journal. */
+  mutable int _journalSize;
+  /** Delays the compaction of a large journal until the list is idle. */
+  QTimer _compactTimer;
+  /** All entries sorted (case insensitive) by call. */
+  QVector<RepeaterBookEntry> _items;
+  /** Precomputed positions, indexed by row. */
+  GeoIndex _positions;
+  /** Maps repeater IDs to rows. */
+  QHash<QString, int> _rows;
   QHash<QString, QDateTime> _queries;
   QRegularExpression _callsignPattern;
 };
@@ -120,12 +208,24 @@ public:
   /** Constructor. */
   explicit NearestRepeaterFilter(RepeaterBookList *repeater, const QGeoCoordinate &location, QObject *parent=nullptr);
 
+  /** Returns the location, repeaters are sorted by. */
+  const QGeoCoordinate &location() const;
+  /** Sets the location and sorts the repeaters again. */
+  void setLocation(const QGeoCoordinate &location);
+
 protected:
   bool lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const;
 
+protected slots:
+  /** Recomputes the distances of all repeaters, once the repeater list changed. */
+  void updateDistances();
+
 protected:
   RepeaterBookList *_repeater;
   QGeoCoordinate _location;
+  /** Distances of all repeaters to the location, indexed by source row. Computed once per change
+   * of the location or the list, instead of within every comparison. */
+  QVector<double> _distances;
 };
 
 
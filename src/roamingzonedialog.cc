@@ -56,8 +56,9 @@ RoamingZoneDialog::onAddDMRChannel() {
       continue;
     if (! channel->is<DMRChannel>())
       continue;
-    RoamingChannel *rch = RoamingChannel::fromDMRChannel(channel->as<DMRChannel>());
-    _config->roamingChannels()->add(rch);
+    RoamingChannel *rch = _config->roamingChannels()->findOrCreate(channel->as<DMRChannel>());
+    if (0 <= _myZone->channels()->indexOf(rch))
+      continue;
     _myZone->addChannel(rch);
   }
 }
@@ -62,9 +62,9 @@ RoamingZoneListView::onGenRoamingZone() {
     if (nullptr == dch)
       continue;
     if (contacts.contains(dch->txContactObj())) {
-      RoamingChannel *rch = RoamingChannel::fromDMRChannel(dch);
-      _config->roamingChannels()->add(rch);
-      zone->addChannel(rch);
+      RoamingChannel *rch = _config->roamingChannels()->findOrCreate(dch);
+      if (0 > zone->channels()->indexOf(rch))
+        zone->addChannel(rch);
     }
   }
 
@@ -6,10 +6,66 @@
 #include <QLabel>
 #include "logger.hh"
 
+#define CANCEL_CHECK_INTERVAL 1024  // Number of cells searched between checks for cancellation
+
+
+/* ********************************************************************************************* *
+ * Implementation of SearchPopup::Searcher
+ * ********************************************************************************************* */
+class SearchPopup::Searcher: public QRunnable
+{
+public:
+  Searcher(SearchPopup *popup, unsigned generation, const QString &query,
+           const QVector<QString> &index, const QVector<int> &candidates, bool refine)
+    : QRunnable(), _popup(popup), _generation(generation), _query(query), _index(index),
+      _candidates(candidates), _refine(refine)
+  {
+    // pass...
+  }
+
+  void run() {
+    QVector<int> cells;
+    int n = _refine ? _candidates.size() : _index.size();
+    for (int i=0; i<n; i++) {
+      // Stop, if a newer search was started or the model changed
+      if ((0 == (i % CANCEL_CHECK_INTERVAL))
+          && (_generation != unsigned(_popup->_generation.loadAcquire())))
+        return;
+      int cell = _refine ? _candidates.at(i) : i;
+      if (_index.at(cell).contains(_query))
+        cells.append(cell);
+    }
+    // The popup waits for all searches before it gets destroyed. Pending calls are discarded
+    // together with the object.
+    SearchPopup *popup = _popup;
+    unsigned generation = _generation;
+    QString query = _query;
+    QMetaObject::invokeMethod(popup, [popup, generation, query, cells]() {
+      popup->onSearchDone(generation, query, cells);
+    }, Qt::QueuedConnection);
+  }
+
+protected:
+  SearchPopup *_popup;
+  unsigned _generation;
+  QString _query;
+  QVector<QString> _index;
+  QVector<int> _candidates;
+  bool _refine;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of SearchPopup
+ * ********************************************************************************************* */
+
 
 SearchPopup::SearchPopup(QAbstractItemView *parent)
-  : QFrame(parent)
+  : QFrame(parent), _currentMatch(0), _model(), _indexValid(false), _columns(0), _index(),
+    _query(), _cells(), _generation(0), _searcher()
 {
+  _searcher.setMaxThreadCount(1);
+
   setWindowFlags(Qt::Popup | Qt::FramelessWindowHint | Qt::NoDropShadowWindowHint);
   setFrameStyle(QFrame::Panel);
   setWindowModality(Qt::ApplicationModal);
@@ -49,6 +105,11 @@ SearchPopup::SearchPopup(QAbstractItemView *parent)
   this->hide();
 }
 
+SearchPopup::~SearchPopup() {
+  // Stop running searches early
+  _generation.fetchAndAddOrdered(1);
+}
+
 void
 SearchPopup::showPopup() {
   show();
@@ -63,39 +124,98 @@ SearchPopup::showPopup() {
 
 void
 SearchPopup::onSearchChanged(const QString &text) {
+  QAbstractItemView *itemView = qobject_cast<QAbstractItemView *>(parent());
+  unsigned generation = _generation.fetchAndAddOrdered(1)+1;
+
+  _currentMatch = 0;
+  _matches.clear();
+  itemView->selectionModel()->clear();
+  _label->setText("");
+  if (text.isEmpty())
+    return;
+
+  buildIndex();
+  QString query = text.toLower();
+  // If the query grows, only the previous matches need to be searched
+  bool refine = (! _query.isEmpty()) && query.startsWith(_query);
+  _searcher.start(new Searcher(this, generation, query, _index, _cells, refine));
+}
+
+void
+SearchPopup::onSearchDone(unsigned generation, const QString &query, const QVector<int> &cells) {
+  // Result of an outdated search
+  if ((generation != unsigned(_generation.loadAcquire())) || (! _model))
+    return;
+
+  _query = query;
+  _cells = cells;
+
+  // Cells are in row-major order, hence the matches are sorted already
+  _matches.clear();
+  _matches.reserve(cells.size());
+  foreach (int cell, cells)
+    _matches.append(_model->index(cell/_columns, cell%_columns));
+
+  _currentMatch = 0;
+  showMatch();
+}
+
+void
+SearchPopup::onModelChanged() {
+  // Also cancels running searches, their results refer to the old index
+  _generation.fetchAndAddOrdered(1);
+  _indexValid = false;
+  _query.clear();
+  _cells.clear();
+}
+
+void
+SearchPopup::buildIndex() {
   QAbstractItemView *itemView = qobject_cast<QAbstractItemView *>(parent());
   QAbstractItemModel *model = itemView->model();
 
-  if (text.isEmpty()) {
-    _currentMatch = 0;
-    _matches.clear();
-    itemView->selectionModel()->clear();
-    _label->setText("");
+  if (model != _model) {
+    if (_model)
+      disconnect(_model, nullptr, this, nullptr);
+    _model = model;
+    _indexValid = false;
+    connect(model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)), this, SLOT(onModelChanged()));
+    connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(onModelChanged()));
+    connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(onModelChanged()));
+    connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(onModelChanged()));
+    connect(model, SIGNAL(columnsInserted(QModelIndex,int,int)), this, SLOT(onModelChanged()));
+    connect(model, SIGNAL(columnsRemoved(QModelIndex,int,int)), this, SLOT(onModelChanged()));
+    connect(model, SIGNAL(layoutChanged(QList<QPersistentModelIndex>,QAbstractItemModel::LayoutChangeHint)),
+            this, SLOT(onModelChanged()));
+    connect(model, SIGNAL(modelReset()), this, SLOT(onModelChanged()));
+  }
+
+  if (_indexValid)
     return;
+
+  // Models must be accessed from the GUI thread, hence the index is built here
+  int rows = model->rowCount(), columns = model->columnCount();
+  _index.clear();
+  _index.reserve(rows*columns);
+  for (int i=0; i<rows; i++) {
+    for (int j=0; j<columns; j++)
+      _index.append(model->index(i, j).data(Qt::DisplayRole).toString().toLower());
   }
+  _columns = columns;
+  _query.clear();
+  _cells.clear();
+  _indexValid = true;
+}
 
-  _currentMatch = 0;
-  itemView->selectionModel()->clear();
-  _matches.clear();
-  for (int i=0; i<model->columnCount(); i++)
-    _matches.append(model->match(model->index(0,i), Qt::DisplayRole, text, -1,
-                                 Qt::MatchContains|Qt::MatchWrap));
-  std::sort(
-        _matches.begin(), _matches.end(),
-        [](const QModelIndex &a, const QModelIndex &b) {
-    if (a.row() < b.row())
-      return true;
-    if (a.row() > b.row())
-      return false;
-    return a.column() < b.column();
-  });
-
-  if (_matches.count()) {
-    _label->setText(tr("%1/%2").arg(_currentMatch+1).arg(_matches.count()));
-    itemView->setCurrentIndex(_matches.at(_currentMatch));
-  } else {
+void
+SearchPopup::showMatch() {
+  if (0 == _matches.count()) {
     _label->setText("");
+    return;
   }
+  QAbstractItemView *itemView = qobject_cast<QAbstractItemView *>(parent());
+  _label->setText(tr("%1/%2").arg(_currentMatch+1).arg(_matches.count()));
+  itemView->setCurrentIndex(_matches.at(_currentMatch));
 }
 
 void
@@ -3,10 +3,18 @@
 
 #include <QFrame>
 #include <QAbstractItemView>
+#include <QPointer>
+#include <QThreadPool>
+#include <QAtomicInt>
 
 class QLabel;
 
 
+/** Incremental search within the cells of an item view.
+ *
+ * The display texts of all cells get collected lazily in a lower-cased index on the first search
+ * and whenever the model changed. The index is searched on a worker thread. Every keystroke
+ * cancels a running search. If the query grows, only the previous matches get refined. */
 class SearchPopup : public QFrame
 {
   Q_OBJECT
@@ -15,6 +23,9 @@ protected:
   explicit SearchPopup(QAbstractItemView *parent);
 
 public:
+  /** Destructor, waits for a running search. */
+  virtual ~SearchPopup();
+
   static void attach(QAbstractItemView *itemview);
 
 public slots:
@@ -24,12 +35,43 @@ protected slots:
   void onSearchChanged(const QString &text);
   void onNext();
   void onPrevious();
+  /** Invalidates the index, gets called whenever the model changed. */
+  void onModelChanged();
+
+protected:
+  /** Builds the index for the current model, if needed. */
+  void buildIndex();
+  /** Gets called in the GUI thread, once a search completed. */
+  void onSearchDone(unsigned generation, const QString &query, const QVector<int> &cells);
+  /** Selects the current match. */
+  void showMatch();
+
+  /** Searches the index on a worker thread. */
+  class Searcher;
 
 protected:
   QLineEdit *_search;
   QLabel *_label;
   int _currentMatch;
   QModelIndexList _matches;
+
+  /** The model, the index was built for. */
+  QPointer<QAbstractItemModel> _model;
+  /** If @c true, the index is up to date. */
+  bool _indexValid;
+  /** Number of columns of the indexed model. */
+  int _columns;
+  /** Lower-cased display texts of all cells in row-major order. */
+  QVector<QString> _index;
+  /** The last completed query. */
+  QString _query;
+  /** The cells matching the last completed query. */
+  QVector<int> _cells;
+  /** Incremented with every search and model change, outdated searches stop early. */
+  QAtomicInt _generation;
+  /** Runs the searches. Declared last, hence it waits for all searches before any other member
+   * gets destroyed. */
+  QThreadPool _searcher;
 };
 
 #endif // SEARCHPOPUP_HH
@@ -71,6 +71,15 @@ Settings::setRepeaterBookRegion(RepeaterBookList::Region region) {
   setValue("repeaterBookRegion", region);
 }
 
+QString
+Settings::repeaterBookPrefetch() const {
+  return value("repeaterBookPrefetch", "").toString();
+}
+void
+Settings::setRepeaterBookPrefetch(const QString &region) {
+  setValue("repeaterBookPrefetch", region);
+}
+
 bool
 Settings::disableAutoDetect() const {
   return value("disableAutoDetect", false).toBool();
@@ -80,6 +89,24 @@ Settings::setDisableAutoDetect(bool disable) {
   setValue("disableAutoDetect", disable);
 }
 
+bool
+Settings::lowLatencySerial() const {
+  return value("lowLatencySerial", false).toBool();
+}
+void
+Settings::setLowLatencySerial(bool enable) {
+  setValue("lowLatencySerial", enable);
+}
+
+bool
+Settings::recordPerformance() const {
+  return value("recordPerformance", true).toBool();
+}
+void
+Settings::setRecordPerformance(bool enable) {
+  setValue("recordPerformance", enable);
+}
+
 bool
 Settings::updateCodeplug() const {
   return value("updateCodeplug", true).toBool();
@@ -214,6 +241,15 @@ Settings::setShowExtensions(bool show) {
   setValue("showExtensions", show);
 }
 
+bool
+Settings::watchCodeplugFile() const {
+  return value("watchCodeplugFile", false).toBool();
+}
+void
+Settings::setWatchCodeplugFile(bool watch) {
+  setValue("watchCodeplugFile", watch);
+}
+
 bool
 Settings::hideChannelNote() const {
   return value("hideChannelNote", false).toBool();
@@ -355,12 +391,15 @@ SettingsDialog::SettingsDialog(QWidget *parent)
   case RepeaterBookList::World: Ui::SettingsDialog::repeaterBookRegion->setCurrentIndex(0); break;
   case RepeaterBookList::NorthAmerica: Ui::SettingsDialog::repeaterBookRegion->setCurrentIndex(1); break;
   }
+  repeaterBookPrefetch->setText(settings.repeaterBookPrefetch());
 
   connect(Ui::SettingsDialog::ignoreFrequencyLimits, SIGNAL(toggled(bool)),
           this, SLOT(onIgnoreFrequencyLimitsSet(bool)));
   connect(queryLocation, SIGNAL(toggled(bool)), this, SLOT(onSystemLocationToggled(bool)));
 
   Ui::SettingsDialog::disableAutoDetect->setChecked(settings.disableAutoDetect());
+  Ui::SettingsDialog::lowLatencySerial->setChecked(settings.lowLatencySerial());
+  Ui::SettingsDialog::recordPerformance->setChecked(settings.recordPerformance());
   Ui::SettingsDialog::updateCodeplug->setChecked(settings.updateCodeplug());
   Ui::SettingsDialog::autoEnableGPS->setChecked(settings.autoEnableGPS());
   Ui::SettingsDialog::autoEnableRoaming->setChecked(settings.autoEnableRoaming());
@@ -383,6 +422,7 @@ SettingsDialog::SettingsDialog(QWidget *parent)
 
   Ui::SettingsDialog::commercialFeatures->setChecked(settings.showCommercialFeatures());
   Ui::SettingsDialog::showExtensions->setChecked(settings.showExtensions());
+  Ui::SettingsDialog::watchCodeplug->setChecked(settings.watchCodeplugFile());
 
   connect(Ui::SettingsDialog::dbLimitEnable, SIGNAL(toggled(bool)), this, SLOT(onDBLimitToggled(bool)));
   connect(Ui::SettingsDialog::useUserId, SIGNAL(toggled(bool)), this, SLOT(onUseUserDMRIdToggled(bool)));
@@ -441,10 +481,13 @@ SettingsDialog::accept() {
   settings.setQueryPosition(queryLocation->isChecked());
   settings.setLocator(locatorEntry->text().simplified());
   settings.setDisableAutoDetect(disableAutoDetect->isChecked());
+  settings.setLowLatencySerial(lowLatencySerial->isChecked());
+  settings.setRecordPerformance(recordPerformance->isChecked());
   if (0 == Ui::SettingsDialog::repeaterBookRegion->currentIndex())
     settings.setRepeaterBookRegion(RepeaterBookList::World);
   else
     settings.setRepeaterBookRegion(RepeaterBookList::NorthAmerica);
+  settings.setRepeaterBookPrefetch(repeaterBookPrefetch->text().simplified());
   settings.setUpdateCodeplug(updateCodeplug->isChecked());
   settings.setAutoEnableGPS(autoEnableGPS->isChecked());
   settings.setAutoEnableRoaming(autoEnableRoaming->isChecked());
@@ -465,6 +508,7 @@ SettingsDialog::accept() {
 
   settings.setShowCommercialFeatures(commercialFeatures->isChecked());
   settings.setShowExtensions(showExtensions->isChecked());
+  settings.setWatchCodeplugFile(watchCodeplug->isChecked());
 
   QDialog::accept();
 }
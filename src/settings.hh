@@ -34,9 +34,15 @@ public:
 
   bool disableAutoDetect() const;
   void setDisableAutoDetect(bool disable);
+  bool lowLatencySerial() const;
+  void setLowLatencySerial(bool enable);
+  bool recordPerformance() const;
+  void setRecordPerformance(bool enable);
 
   RepeaterBookList::Region repeaterBookRegion() const;
   void setRepeaterBookRegion(RepeaterBookList::Region region);
+  QString repeaterBookPrefetch() const;
+  void setRepeaterBookPrefetch(const QString &region);
 
   bool updateCodeplug() const;
   void setUpdateCodeplug(bool update);
@@ -73,6 +79,9 @@ public:
   bool showExtensions() const;
   void setShowExtensions(bool show);
 
+  bool watchCodeplugFile() const;
+  void setWatchCodeplugFile(bool watch);
+
   bool hideChannelNote() const;
   void setHideChannelNote(bool hide);
 
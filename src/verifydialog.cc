@@ -1,46 +1,38 @@
 #include "verifydialog.hh"
 #include "radiolimits.hh"
-#include "application.hh"
+#include "issuemodel.hh"
 #include <QPushButton>
 
+/** Number of groups, up to which all groups are expanded initially. */
+#define MAX_EXPANDED_GROUPS 50
+
 VerifyDialog::VerifyDialog(const RadioLimitContext &issues, bool upload, QWidget *parent)
-    : QDialog(parent)
+    : QDialog(parent), _model(nullptr)
 {
 	setupUi(this);
 
-  Application *app = qobject_cast<Application *>(QApplication::instance());
-
-  bool valid = true;
-  for (int i=0; i<issues.count(); i++) {
-    const RadioLimitIssue &issue = issues.message(i);
-    QListWidgetItem *item = new QListWidgetItem(issue.message());
-    // Dispatch by severity
-    switch (issue.severity()) {
-    case RadioLimitIssue::Silent:
-      break;
-    case RadioLimitIssue::Hint:
-      item->setForeground(Qt::gray);
-      break;
-    case RadioLimitIssue::Warning:
-      if (app->isDarkMode())
-        item->setForeground(Qt::white);
-      else
-        item->setForeground(Qt::black);
-      break;
-    case RadioLimitIssue::Critical:
-      if (app->isDarkMode())
-        item->setForeground(Qt::red);
-      else
-        item->setForeground(Qt::darkRed);
-      valid = false;
-      break;
-    }
-    listWidget->addItem(item);
-  }
+  // The view only queries the visible issues, hence large numbers of issues are shown instantly
+  _model = new RadioLimitIssueModel(issues, RadioLimitIssueModel::Grouping::Object, this);
+  issueView->setModel(_model);
+  if (MAX_EXPANDED_GROUPS >= _model->rowCount())
+    issueView->expandAll();
+  connect(grouping, SIGNAL(currentIndexChanged(int)), this, SLOT(onGroupingChanged(int)));
 
+  bool valid = (issues.maxSeverity() < RadioLimitIssue::Critical);
   if (upload) {
     buttonBox->setStandardButtons(QDialogButtonBox::Cancel|QDialogButtonBox::Ok);
     QPushButton *ignore = buttonBox->button(QDialogButtonBox::Ok);
     ignore->setEnabled(valid);
   }
 }
+
+void
+VerifyDialog::onGroupingChanged(int index) {
+  switch (index) {
+  case 0: _model->setGrouping(RadioLimitIssueModel::Grouping::Object); break;
+  case 1: _model->setGrouping(RadioLimitIssueModel::Grouping::Severity); break;
+  default: _model->setGrouping(RadioLimitIssueModel::Grouping::None); break;
+  }
+  if (MAX_EXPANDED_GROUPS >= _model->rowCount())
+    issueView->expandAll();
+}
@@ -6,6 +6,7 @@
 #include "ui_verifydialog.h"
 
 class RadioLimitContext;
+class RadioLimitIssueModel;
 
 class VerifyDialog : public QDialog, private Ui::VerifyDialog
 {
@@ -14,6 +15,14 @@ public:
 
 public:
   explicit VerifyDialog(const RadioLimitContext &ctx, bool upload, QWidget *parent = nullptr);
+
+protected slots:
+  /** Regroups the issues according to the selected grouping. */
+  void onGroupingChanged(int index);
+
+protected:
+  /** Holds the issues. */
+  RadioLimitIssueModel *_model;
 };
 
 #endif // VERIFYDIALOG_HH
@@ -2,6 +2,7 @@
 #include "ui_zonelistview.h"
 #include "config.hh"
 #include "zonedialog.hh"
+#include "application.hh"
 #include <QMessageBox>
 
 
@@ -69,8 +70,13 @@ ZoneListView::onRemZone() {
 
 void
 ZoneListView::onEditZone(unsigned row) {
-  ZoneDialog dialog(_config, _config->zones()->zone(row));
+  Zone *zone = _config->zones()->zone(row);
+  ZoneDialog dialog(_config, zone);
   if (QDialog::Accepted != dialog.exec())
     return;
+  ConfigHistory *history = qobject_cast<Application *>(QApplication::instance())->history();
+  history->begin(tr("edit zone"));
+  history->track(zone);
   dialog.zone();
+  history->commit();
 }
@@ -0,0 +1,200 @@
+#include "addressmaptest.hh"
+#include "d878uv_codeplug.hh"
+#include "md390_codeplug.hh"
+#include "errorstack.hh"
+#include <QTest>
+
+Q_DECLARE_METATYPE(AddressMap::Strategy)
+
+AddressMapTest::AddressMapTest(QObject *parent)
+  : UnitTestBase(parent)
+{
+  // pass...
+}
+
+void
+AddressMapTest::testStrategies() {
+  AddressMap search(AddressMap::Strategy::BinarySearch),
+      lastHit(AddressMap::Strategy::LastHit),
+      paged(AddressMap::Strategy::PageTable);
+
+  // Mix of small and large regions with gaps, spanning several pages.
+  uint32_t addr = 0x1000, idx = 0;
+  for (int i=0; i<500; i++, idx++) {
+    uint32_t len = (i % 5) ? (0x10 + (i % 7)*0x30) : 0x2345;
+    search.add(addr, len, idx); lastHit.add(addr, len, idx); paged.add(addr, len, idx);
+    addr += len + ((i % 3) ? 0 : 0x1800);
+  }
+
+  for (uint32_t a=0; a<(addr+0x2000); a+=3) {
+    int expected = search.find(a);
+    QCOMPARE(lastHit.find(a), expected);
+    QCOMPARE(paged.find(a), expected);
+  }
+}
+
+void
+AddressMapTest::testModification() {
+  AddressMap map;
+  map.add(0x0000, 0x100, 0);
+  map.add(0x2000, 0x100, 1);
+  QCOMPARE(map.find(0x2010), 1);
+  QCOMPARE(map.find(0x1000), -1);
+
+  // Page table must be rebuilt after modification
+  map.add(0x1000, 0x100, 2);
+  QCOMPARE(map.find(0x1000), 2);
+  QVERIFY(map.rem(1));
+  QCOMPARE(map.find(0x2010), -1);
+  map.clear();
+  QCOMPARE(map.find(0x0000), -1);
+
+  // Sparse maps fall back to a search
+  map.add(0x00000000, 0x10, 0);
+  map.add(0xfffff000, 0x10, 1);
+  QCOMPARE(map.find(0x00000008), 0);
+  QCOMPARE(map.find(0xfffff008), 1);
+  QCOMPARE(map.find(0x80000000), -1);
+}
+
+void
+AddressMapTest::testBulkAdd() {
+  AddressMap single, bulk;
+  single.add(0x8000, 0x100, 0);
+  bulk.add(0x8000, 0x100, 0);
+
+  // Interleaved, out-of-order regions like banked tables
+  std::vector<AddressMap::Range> ranges;
+  for (uint32_t i=0; i<64; i++) {
+    uint32_t addr = ((i % 2) ? 0x10000 : 0x0000) + (i/2)*0x200;
+    ranges.push_back({addr, 0x100});
+    single.add(addr, 0x100, 1+i);
+  }
+  bulk.add(ranges, 1);
+
+  for (uint32_t a=0; a<0x18000; a+=0x10)
+    QCOMPARE(bulk.find(a), single.find(a));
+
+  // Moved maps keep their items
+  AddressMap moved(std::move(bulk));
+  QCOMPARE(moved.find(0x8010), 0);
+  QCOMPARE(moved.find(0x10210), 4);
+}
+
+void
+AddressMapTest::testImageElements() {
+  DFUFile::Image image;
+  image.addElement(0x1000, 0x10);
+  image.addElements({{0x3000, 0x10}, {0x2000, 0x10}}, 0xff);
+  QCOMPARE(image.numElements(), 3);
+  QCOMPARE(image.findElement(0x2008), 2);
+  QCOMPARE(image.findElement(0x3008), 1);
+  uint8_t fill = 0;
+  QVERIFY(image.isUniform(0x2000, 0x10, &fill));
+  QCOMPARE(fill, uint8_t(0xff));
+
+  // Moving keeps the data and the address map
+  image.data(0x1000)[0] = 0x42;
+  DFUFile::Image moved(std::move(image));
+  QCOMPARE(moved.numElements(), 3);
+  QCOMPARE(moved.findElement(0x3008), 1);
+  QCOMPARE(moved.data(0x1000)[0], uint8_t(0x42));
+
+  // Compacting keeps unmerged elements
+  QCOMPARE(moved.compact(), 0U);
+  QCOMPARE(moved.numElements(), 3);
+  QCOMPARE(moved.findElement(0x3008), 2);
+  QCOMPARE(moved.data(0x1000)[0], uint8_t(0x42));
+}
+
+void
+AddressMapTest::testImageExcluding() {
+  DFUFile::Image image;
+  image.addElement(0x1000, 0x100);
+  image.addElement(0x2000, 0x100, -1, 0xff);
+  image.data(0x1000)[0x80] = 0x42;
+
+  // Excluded ranges split elements, data and uniformity are kept
+  DFUFile::Image current = image.excluding({{0x2040, 0x40}, {0x1040, 0x20}});
+  QCOMPARE(current.numElements(), 4);
+  QCOMPARE(current.data(0x1080)[0], uint8_t(0x42));
+  QVERIFY(current.isUniform(0x2080, 0x80));
+  QVERIFY(! current.isAllocated(0x1040));
+  QVERIFY(! current.isAllocated(0x2070));
+
+  // Excluded sections are always different
+  QVERIFY(! image.differs(current, 0x1000, 0x40));
+  QVERIFY(image.differs(current, 0x1040, 0x20));
+  QVERIFY(! image.differs(current, 0x2080, 0x80));
+  QVERIFY(image.differs(current, 0x2000, 0x80));
+
+  // Codeplugs declare their generated memory
+  MD390Codeplug codeplug;
+  std::vector<AddressMap::Range> generated = codeplug.generatedMemory();
+  QVERIFY(! generated.empty());
+  QVERIFY(Codeplug::isGenerated(generated, generated.front().address, 0x10));
+  QVERIFY(! Codeplug::isGenerated(generated, generated.front().address-0x10, 0x20));
+}
+
+void
+AddressMapTest::addStrategies() {
+  QTest::addColumn<AddressMap::Strategy>("strategy");
+  QTest::newRow("search") << AddressMap::Strategy::BinarySearch;
+  QTest::newRow("last hit") << AddressMap::Strategy::LastHit;
+  QTest::newRow("page table") << AddressMap::Strategy::PageTable;
+}
+
+void
+AddressMapTest::benchmark(DFUFile &codeplug, AddressMap::Strategy strategy) {
+  const DFUFile::Image &image = codeplug.image(0);
+  AddressMap map(strategy);
+  for (int i=0; i<image.numElements(); i++)
+    map.add(image.element(i).address(), image.element(i).memSize(), i);
+
+  // Access every element in 16b steps, like the encoding and decoding of small elements does.
+  unsigned misses = 0;
+  QBENCHMARK {
+    for (int i=0; i<image.numElements(); i++) {
+      const DFUFile::Element &el = image.element(i);
+      for (uint32_t offset=0; offset<el.memSize(); offset+=0x10)
+        misses += (i != map.find(el.address()+offset));
+    }
+  }
+  QCOMPARE(misses, 0U);
+}
+
+void
+AddressMapTest::benchmarkD878UV_data() {
+  addStrategies();
+}
+
+void
+AddressMapTest::benchmarkD878UV() {
+  QFETCH(AddressMap::Strategy, strategy);
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  D878UVCodeplug codeplug;
+  if (! codeplug.encode(&_basicConfig, flags, err))
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  benchmark(codeplug, strategy);
+}
+
+void
+AddressMapTest::benchmarkMD390_data() {
+  addStrategies();
+}
+
+void
+AddressMapTest::benchmarkMD390() {
+  QFETCH(AddressMap::Strategy, strategy);
+  ErrorStack err;
+  MD390Codeplug codeplug;
+  codeplug.clear();
+  if (! codeplug.encode(&_basicConfig, Codeplug::Flags(), err))
+    QFAIL(QString("Cannot encode codeplug for TyT MD390: %1")
+          .arg(err.format()).toStdString().c_str());
+  benchmark(codeplug, strategy);
+}
+
+QTEST_GUILESS_MAIN(AddressMapTest)
@@ -0,0 +1,32 @@
+#ifndef ADDRESSMAPTEST_HH
+#define ADDRESSMAPTEST_HH
+
+#include "libdmrconfigtest.hh"
+#include "addressmap.hh"
+
+class DFUFile;
+
+class AddressMapTest : public UnitTestBase
+{
+  Q_OBJECT
+
+public:
+  explicit AddressMapTest(QObject *parent = nullptr);
+
+private slots:
+  void testStrategies();
+  void testModification();
+  void testBulkAdd();
+  void testImageElements();
+  void testImageExcluding();
+  void benchmarkD878UV_data();
+  void benchmarkD878UV();
+  void benchmarkMD390_data();
+  void benchmarkMD390();
+
+private:
+  void addStrategies();
+  void benchmark(DFUFile &codeplug, AddressMap::Strategy strategy);
+};
+
+#endif // ADDRESSMAPTEST_HH
@@ -142,6 +142,40 @@ ChirpTest::testReaderCross()
 }
 
 
+void
+ChirpTest::testReaderFilter()
+{
+  QString csv =
+      "Location,Name,Frequency,Duplex,Offset,Tone,rToneFreq,cToneFreq,DtcsCode,DtcsPolarity,RxDtcsCode,CrossMode,Mode\n"
+      "0,\"DB0SP, Berlin\",145.600000,-,0.600000,,67.0,67.0,023,NN,023,Tone->Tone,FM\n"
+      "1,DB0ABC,439.100000,-,7.600000,,67.0,67.0,023,NN,023,Tone->Tone,FM\n"
+      "2,Airband,122.800000,,0.000000,,67.0,67.0,023,NN,023,Tone->Tone,AM\n"
+      "3,DB0XYZ,145.750000,-,0.600000,,67.0,67.0,023,NN,023,Tone->Tone,NFM\n";
+
+  ChirpReader::Filter filter;
+  filter.bands.append({Frequency::fromMHz(144.0), Frequency::fromMHz(146.0)});
+  filter.skipUnsupported = true;
+
+  QTextStream stream(&csv);
+  Config config;
+  ErrorStack err;
+  if (! ChirpReader::read(stream, &config, filter, err))
+    QFAIL(QString("Cannot parse CHIRP CSV:\n%1").arg(err.format()).toStdString().c_str());
+
+  QCOMPARE(config.channelList()->count(), 2);
+  QCOMPARE(config.channelList()->channel(0)->name(), "DB0SP, Berlin");
+  QCOMPARE(config.channelList()->channel(0)->as<FMChannel>()->bandwidth(), FMChannel::Bandwidth::Wide);
+  QCOMPARE(config.channelList()->channel(1)->name(), "DB0XYZ");
+  QCOMPARE(config.channelList()->channel(1)->as<FMChannel>()->bandwidth(), FMChannel::Bandwidth::Narrow);
+
+  // Without skipping unsupported modes, the import fails
+  stream.seek(0);
+  Config failing;
+  QVERIFY(! ChirpReader::read(stream, &failing, ChirpReader::Filter()));
+  QCOMPARE(failing.channelList()->count(), 0);
+}
+
+
 void
 ChirpTest::testWriterBasic() {
   Config orig;
@@ -15,6 +15,7 @@ private slots:
   void testReaderCTCSS();
   void testReaderDCS();
   void testReaderCross();
+  void testReaderFilter();
 
   void testWriterBasic();
   void testWriterCTCSS();
@@ -4,10 +4,22 @@
 #include "melody.hh"
 #include <iostream>
 #include <QTest>
+#include <QSignalSpy>
 #include "logger.hh"
 #include <iostream>
 
 #include "configcopyvisitor.hh"
+#include "configsnapshot.hh"
+#include "confighistory.hh"
+#include "objectarena.hh"
+#include "configbuilder.hh"
+#include "repeaterselection.hh"
+#include "radiolimits.hh"
+#include "talkgroupdatabase.hh"
+#include <QBuffer>
+#include <QTemporaryDir>
+#include <QFile>
+#include <thread>
 
 ConfigTest::ConfigTest(QObject *parent)
   : UnitTestBase(parent), _stderr(stderr)
@@ -85,6 +97,810 @@ ConfigTest::testCloneChannelCTCSS() {
            _ctcssCopyTest.channelList()->channel(0)->as<FMChannel>()->rxTone());
 }
 
+void
+ConfigTest::testPropertyTable() {
+  DMRChannel *ch = _basicConfig.channelList()->channel(0)->as<DMRChannel>();
+  QVERIFY(ch);
+
+  // Table is computed once per class
+  const QVector<ConfigItem::PropertyInfo> &table = ConfigItem::propertyTable(ch->metaObject());
+  QCOMPARE(&table, &ConfigItem::propertyTable(ch->metaObject()));
+
+  const QMetaObject *meta = ch->metaObject();
+  QCOMPARE(ch->propertyKind(meta->property(meta->indexOfProperty("name"))), ConfigItem::PropertyKind::String);
+  QCOMPARE(ch->propertyKind(meta->property(meta->indexOfProperty("rxFrequency"))), ConfigItem::PropertyKind::Frequency);
+  QCOMPARE(ch->propertyKind(meta->property(meta->indexOfProperty("rxOnly"))), ConfigItem::PropertyKind::Bool);
+  QCOMPARE(ch->propertyKind(meta->property(meta->indexOfProperty("timeSlot"))), ConfigItem::PropertyKind::Enum);
+  QCOMPARE(ch->propertyKind(meta->property(meta->indexOfProperty("colorCode"))), ConfigItem::PropertyKind::UInt);
+  QCOMPARE(ch->propertyKind(meta->property(meta->indexOfProperty("contact"))), ConfigItem::PropertyKind::Reference);
+  QCOMPARE(ch->propertyKind(meta->property(meta->indexOfProperty("commercial"))), ConfigItem::PropertyKind::Item);
+}
+
+void
+ConfigTest::testListIndex() {
+  Config config;
+  QVector<ConfigObject *> contacts;
+  for (unsigned i=0; i<10; i++)
+    contacts.append(new DMRContact(DMRContact::GroupCall, QString("TG%1").arg(i), i+1));
+
+  QSignalSpy added(config.contacts(), SIGNAL(elementsAdded(int,int)));
+  QCOMPARE(config.contacts()->addMany(contacts), 10);
+  QCOMPARE(added.count(), 1);
+  QCOMPARE(config.contacts()->count(), 10);
+  // Duplicates are ignored
+  QCOMPARE(config.contacts()->addMany(contacts.mid(0,2)), 0);
+  for (int i=0; i<10; i++)
+    QCOMPARE(config.contacts()->indexOf(contacts[i]), i);
+
+  // Index follows moves and removal
+  QVERIFY(config.contacts()->moveUp(5));
+  QCOMPARE(config.contacts()->indexOf(contacts[5]), 4);
+  QCOMPARE(config.contacts()->indexOf(contacts[4]), 5);
+  QVERIFY(config.contacts()->take(contacts[0]));
+  QVERIFY(! config.contacts()->has(contacts[0]));
+  QCOMPARE(config.contacts()->indexOf(contacts[9]), 8);
+  QVERIFY(config.contacts()->take(contacts[9]));
+  QCOMPARE(config.contacts()->indexOf(contacts[8]), 7);
+  delete contacts[0];
+  delete contacts[9];
+}
+
+void
+ConfigTest::testNumberIndex() {
+  Config config;
+  for (unsigned i=0; i<10; i++)
+    config.contacts()->add(new DMRContact(DMRContact::GroupCall, QString("TG%1").arg(i), i+1));
+  DTMFContact *dtmf = new DTMFContact("DTMF", "123");
+  config.contacts()->add(dtmf);
+
+  DMRContact *contact = config.contacts()->contact(4)->as<DMRContact>();
+  QVERIFY(contact == config.contacts()->findDigitalContact(5));
+  QVERIFY(dtmf == config.contacts()->findDTMFContact("123"));
+  QVERIFY(nullptr == config.contacts()->findDigitalContact(11));
+
+  // Index follows appended contacts, the first contact with a number is found
+  DMRContact *added = new DMRContact(DMRContact::PrivateCall, "Added", 11);
+  config.contacts()->add(added);
+  config.contacts()->add(new DMRContact(DMRContact::PrivateCall, "Duplicate", 5));
+  QVERIFY(added == config.contacts()->findDigitalContact(11));
+  QVERIFY(contact == config.contacts()->findDigitalContact(5));
+
+  // Index follows number changes and removal
+  contact->setNumber(100);
+  QVERIFY(contact == config.contacts()->findDigitalContact(100));
+  QCOMPARE(config.contacts()->findDigitalContact(5)->name(), QString("Duplicate"));
+  config.contacts()->del(added);
+  QVERIFY(nullptr == config.contacts()->findDigitalContact(11));
+  config.contacts()->del(contact);
+  QVERIFY(nullptr == config.contacts()->findDigitalContact(100));
+
+  // Radio IDs
+  config.radioIDs()->addId("ID1", 1234);
+  config.radioIDs()->addId("ID2", 5678);
+  DMRRadioID *id = config.radioIDs()->find(5678);
+  QVERIFY(nullptr != id);
+  id->setNumber(4321);
+  QVERIFY(nullptr == config.radioIDs()->find(5678));
+  QVERIFY(id == config.radioIDs()->find(4321));
+}
+
+void
+ConfigTest::testTypeIndex() {
+  Config config;
+  DTMFContact *dtmf = new DTMFContact("DTMF", "123");
+  config.contacts()->add(new DMRContact(DMRContact::GroupCall, "TG1", 1));
+  config.contacts()->add(dtmf);
+  config.contacts()->add(new DMRContact(DMRContact::GroupCall, "TG2", 2));
+
+  QCOMPARE(config.contacts()->digitalCount(), 2);
+  QCOMPARE(config.contacts()->dtmfCount(), 1);
+  QCOMPARE(config.contacts()->digitalContact(1)->name(), QString("TG2"));
+  QVERIFY(dtmf == config.contacts()->dtmfContact(0));
+  QVERIFY(nullptr == config.contacts()->dtmfContact(1));
+
+  // Index follows appended and removed contacts
+  DMRContact *added = new DMRContact(DMRContact::PrivateCall, "Added", 3);
+  config.contacts()->add(added);
+  QCOMPARE(config.contacts()->digitalCount(), 3);
+  QVERIFY(added == config.contacts()->digitalContact(2));
+  config.contacts()->del(added);
+  QCOMPARE(config.contacts()->digitalCount(), 2);
+  config.contacts()->del(dtmf);
+  QCOMPARE(config.contacts()->dtmfCount(), 0);
+  QCOMPARE(config.contacts()->digitalContact(1)->name(), QString("TG2"));
+
+  // Positioning systems
+  GPSSystem *gps = new GPSSystem("GPS");
+  APRSSystem *aprs = new APRSSystem("APRS", nullptr, "DN1ABC", 7, "APAT81", 0, "");
+  config.posSystems()->add(aprs);
+  config.posSystems()->add(gps);
+  QCOMPARE(config.posSystems()->gpsCount(), 1);
+  QCOMPARE(config.posSystems()->aprsCount(), 1);
+  QCOMPARE(config.posSystems()->indexOfGPSSys(gps), 0);
+  QCOMPARE(config.posSystems()->indexOfAPRSSys(aprs), 0);
+  QVERIFY(gps == config.posSystems()->gpsSystem(0));
+}
+
+void
+ConfigTest::testRoamingChannelIndex() {
+  Config config;
+  DMRChannel *ch1 = new DMRChannel(); ch1->setName("DB0ABC");
+  ch1->setRXFrequency(Frequency::fromMHz(439.5625)); ch1->setTXFrequency(Frequency::fromMHz(431.9625));
+  ch1->setColorCode(1); ch1->setTimeSlot(DMRChannel::TimeSlot::TS1);
+  DMRChannel *ch2 = new DMRChannel(); ch2->setName("DB0ABC TS2");
+  ch2->setRXFrequency(Frequency::fromMHz(439.5625)); ch2->setTXFrequency(Frequency::fromMHz(431.9625));
+  ch2->setColorCode(1); ch2->setTimeSlot(DMRChannel::TimeSlot::TS2);
+  config.channelList()->add(ch1);
+  config.channelList()->add(ch2);
+
+  // Channels with the same settings share a roaming channel
+  RoamingChannel *rch1 = config.roamingChannels()->findOrCreate(ch1);
+  QVERIFY(nullptr != rch1);
+  QVERIFY(rch1 == config.roamingChannels()->findOrCreate(ch1));
+  RoamingChannel *rch2 = config.roamingChannels()->findOrCreate(ch2);
+  QVERIFY(rch1 != rch2);
+  QCOMPARE(config.roamingChannels()->count(), 2);
+
+  // Index follows modification and removal
+  rch2->setColorCode(2);
+  QVERIFY(nullptr == config.roamingChannels()->findChannel(
+            ch2->rxFrequency(), ch2->txFrequency(), 1, DMRChannel::TimeSlot::TS2));
+  QVERIFY(rch2 == config.roamingChannels()->findChannel(
+            ch2->rxFrequency(), ch2->txFrequency(), 2, DMRChannel::TimeSlot::TS2));
+  config.roamingChannels()->del(rch1);
+  QVERIFY(nullptr == config.roamingChannels()->findChannel(
+            ch1->rxFrequency(), ch1->txFrequency(), 1, DMRChannel::TimeSlot::TS1));
+}
+
+void
+ConfigTest::testFreeze() {
+  Config config;
+  for (unsigned i=0; i<100; i++)
+    config.contacts()->add(new DMRContact(DMRContact::GroupCall, QString("TG%1").arg(i), i+1));
+  config.contacts()->add(new DTMFContact("DTMF", "123"));
+  quint64 hash = config.hash();
+
+  config.freeze();
+  QVERIFY(config.isFrozen());
+  QVERIFY(config.contacts()->isFrozen());
+
+  // Frozen lists cannot be modified and items do not emit signals
+  QSignalSpy modified(&config, SIGNAL(modified(ConfigItem*)));
+  DMRContact *contact = new DMRContact(DMRContact::GroupCall, "Refused", 1000);
+  QCOMPARE(config.contacts()->add(contact), -1);
+  QVERIFY(! config.contacts()->del(config.contacts()->get(0)));
+  QVERIFY(! config.contacts()->moveDown(0));
+  QCOMPARE(config.contacts()->count(), 101);
+  QCOMPARE(modified.count(), 0);
+
+  // Concurrent read access
+  QVector<unsigned int> found(4, 0);
+  std::vector<std::thread> threads;
+  for (int t=0; t<found.size(); t++) {
+    threads.emplace_back([&config, &found, &hash, t]() {
+      for (unsigned i=0; i<100; i++) {
+        if ((config.contacts()->findDigitalContact(i+1) == config.contacts()->digitalContact(i))
+            && (config.contacts()->findItemByName(QString("TG%1").arg(i)))
+            && (0 <= config.contacts()->indexOf(config.contacts()->digitalContact(i)))
+            && (1 == config.contacts()->dtmfCount()) && (hash == config.hash()))
+          found[t]++;
+      }
+    });
+  }
+  for (auto &thread: threads)
+    thread.join();
+  QCOMPARE(found, QVector<unsigned int>(4, 100));
+
+  // Thawed config can be modified again
+  config.thaw();
+  QVERIFY(! config.contacts()->isFrozen());
+  QCOMPARE(config.contacts()->add(contact), 101);
+  QVERIFY(modified.count() > 0);
+}
+
+void
+ConfigTest::testBulkUpdate() {
+  Config config;
+  QSignalSpy modified(&config, SIGNAL(modified(ConfigItem*)));
+  QSignalSpy added(config.contacts(), SIGNAL(elementAdded(int)));
+  QSignalSpy reset(config.contacts(), SIGNAL(elementsReset()));
+  QSignalSpy channelsReset(config.channelList(), SIGNAL(elementsReset()));
+
+  {
+    Config::BulkUpdate update(&config);
+    for (unsigned i=0; i<10; i++)
+      config.contacts()->add(new DMRContact(DMRContact::GroupCall, QString("TG%1").arg(i), i+1));
+    {
+      // Nested updates are merged
+      Config::BulkUpdate inner(&config);
+      config.contacts()->get(0)->setName("Renamed");
+    }
+    QCOMPARE(modified.count(), 0);
+    QCOMPARE(reset.count(), 0);
+  }
+
+  QCOMPARE(config.contacts()->count(), 10);
+  QCOMPARE(added.count(), 0);
+  QCOMPARE(reset.count(), 1);
+  QCOMPARE(modified.count(), 1);
+  // Unchanged lists do not get reset
+  QCOMPARE(channelsReset.count(), 0);
+  QVERIFY(config.isModified());
+
+  // Signals are emitted as usual after the update
+  config.contacts()->add(new DMRContact(DMRContact::PrivateCall, "Private", 1234));
+  QCOMPARE(added.count(), 1);
+}
+
+void
+ConfigTest::testBuilder() {
+  typedef ConfigBuilder::List List;
+  Config *config = nullptr;
+  ConfigItem::Context context;
+  {
+    ConfigBuilder builder;
+    // Zone refers to channels staged later
+    Zone *zone = new Zone("Zone");
+    builder.link(zone->A(), List::Channels, QVector<int>({1, 0}));
+    QCOMPARE(builder.add(zone), 0);
+
+    QCOMPARE(builder.add(new DMRContact(DMRContact::GroupCall, "TG 91", 91)), 0);
+    for (int i=0; i<2; i++) {
+      DMRChannel *ch = new DMRChannel();
+      ch->setName(QString("DMR %1").arg(i));
+      builder.link(ch->contact(), List::Contacts, 0);
+      QCOMPARE(builder.add(ch), i);
+    }
+    QCOMPARE(builder.count(List::Channels), 2);
+
+    QSignalSpy added(builder.config()->channelList(), SIGNAL(elementAdded(int)));
+    QSignalSpy reset(builder.config()->channelList(), SIGNAL(elementsReset()));
+    ErrorStack err;
+    if (nullptr == (config = builder.finish(&context, err)))
+      QFAIL(err.format().toLocal8Bit().constData());
+    QCOMPARE(added.count(), 0);
+    QCOMPARE(reset.count(), 1);
+  }
+
+  QCOMPARE(config->channelList()->count(), 2);
+  QCOMPARE(config->zones()->zone(0)->A()->count(), 2);
+  QCOMPARE(config->zones()->zone(0)->A()->get(0), config->channelList()->get(1));
+  QCOMPARE(config->channelList()->channel(0)->as<DMRChannel>()->txContactObj(),
+           config->contacts()->contact(0)->as<DMRContact>());
+  QCOMPARE(context.getId(config->channelList()->get(1)), QString("ch2"));
+
+  // Out of bounds references fail
+  {
+    ConfigBuilder builder(config);
+    DMRChannel *ch = new DMRChannel();
+    builder.link(ch->contact(), List::Contacts, 1);
+    builder.add(ch);
+    QVERIFY(nullptr == builder.finish());
+  }
+  QCOMPARE(config->channelList()->count(), 2);
+
+  delete config;
+}
+
+void
+ConfigTest::testRepeaterSelection() {
+  RepeaterSelection selection;
+  RepeaterSelection::Repeater berlin, hamburg, munich;
+  berlin.call = "DB0BER"; berlin.location = QGeoCoordinate(52.52, 13.40);
+  berlin.rxFrequency = Frequency::fromMHz(439.1); berlin.txFrequency = Frequency::fromMHz(431.5);
+  berlin.isDMR = true; berlin.colorCode = 2;
+  hamburg.call = "DB0HH"; hamburg.location = QGeoCoordinate(53.55, 10.00);
+  hamburg.rxFrequency = Frequency::fromMHz(439.2); hamburg.txFrequency = Frequency::fromMHz(431.6);
+  hamburg.isDMR = hamburg.isFM = true;
+  munich.call = "DB0M"; munich.location = QGeoCoordinate(48.14, 11.58);
+  munich.rxFrequency = Frequency::fromMHz(145.6); munich.txFrequency = Frequency::fromMHz(145.0);
+  munich.isFM = true;
+  selection.add(berlin); selection.add(hamburg); selection.add(munich);
+
+  // Munich is nearer to Berlin than Hamburg, but has no DMR
+  QCOMPARE(selection.select(QGeoCoordinate(50.5, 12.8), 2, RepeaterSelection::Mode::DMR),
+           QVector<int>({0, 1}));
+  QCOMPARE(selection.select(QGeoCoordinate(50.5, 12.8), 1, RepeaterSelection::Mode::FM),
+           QVector<int>({2}));
+
+  QList<RepeaterSelection::Waypoint> route = {
+    {"Berlin", QGeoCoordinate(52.50, 13.35)}, {"Hamburg", QGeoCoordinate(53.50, 10.05)} };
+  Config config;
+  {
+    ConfigBuilder builder(&config);
+    // Repeaters near both waypoints get a single channel
+    QCOMPARE(selection.build(builder, route, 2, RepeaterSelection::Mode::DMR), 2);
+    ErrorStack err;
+    if (nullptr == builder.finish(nullptr, err))
+      QFAIL(err.format().toLocal8Bit().constData());
+  }
+
+  QCOMPARE(config.channelList()->count(), 2);
+  QCOMPARE(config.zones()->count(), 2);
+  QCOMPARE(config.zones()->zone(0)->name(), QString("Berlin"));
+  QCOMPARE(config.zones()->zone(0)->A()->get(0), config.channelList()->get(0));
+  QCOMPARE(config.zones()->zone(0)->A()->get(1), config.channelList()->get(1));
+  QCOMPARE(config.zones()->zone(1)->A()->get(0), config.channelList()->get(1));
+  QCOMPARE(config.zones()->zone(1)->A()->get(1), config.channelList()->get(0));
+  QCOMPARE(config.channelList()->channel(0)->as<DMRChannel>()->colorCode(), 2U);
+}
+
+void
+ConfigTest::testImportTalkGroups() {
+  QTemporaryDir dir;
+  QFile file(dir.filePath("talkgroups.json"));
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write("{\"91\": \"World-wide\", \"262\": \"Germany\", \"2621\": \"Berlin\", "
+             "\"2622\": \"Hamburg\", \"3100\": \"USA\"}");
+  file.close();
+
+  // Load in background, such that the default DB is neither loaded nor downloaded
+  TalkGroupDatabase db(30, nullptr, true);
+  QVERIFY(db.load(file.fileName()));
+  QCOMPARE(db.count(), qint64(5));
+
+  Config config;
+  config.contacts()->add(new DMRContact(DMRContact::GroupCall, "DL", 262));
+  config.contacts()->add(new DMRContact(DMRContact::PrivateCall, "Someone", 2621));
+  QSignalSpy added(config.contacts(), SIGNAL(elementAdded(int)));
+  QSignalSpy reset(config.contacts(), SIGNAL(elementsReset()));
+
+  int created = config.importTalkGroups(&db, [](unsigned number, const QString &) {
+    return QString::number(number).startsWith("262");
+  }, "German TGs");
+
+  // Existing group call is reused, the private call is not
+  QCOMPARE(created, 2);
+  QCOMPARE(config.contacts()->count(), 4);
+  QCOMPARE(added.count(), 0);
+  QCOMPARE(reset.count(), 1);
+  QCOMPARE(config.contacts()->contact(0)->name(), QString("DL"));
+
+  QCOMPARE(config.rxGroupLists()->count(), 1);
+  RXGroupList *list = config.rxGroupLists()->list(0);
+  QCOMPARE(list->name(), QString("German TGs"));
+  QCOMPARE(list->count(), 3);
+  QCOMPARE(list->contact(0)->number(), 262U);
+  QCOMPARE(list->contact(1)->type(), DMRContact::GroupCall);
+
+  // Importing again creates nothing new
+  QCOMPARE(config.importTalkGroups(&db, Config::TalkGroupFilter(), "German TGs"), 2);
+  QCOMPARE(config.importTalkGroups(&db, Config::TalkGroupFilter(), "German TGs"), 0);
+  QCOMPARE(config.contacts()->count(), 6);
+  QCOMPARE(list->count(), 5);
+}
+
+void
+ConfigTest::testStreamingYAML() {
+  ErrorStack err;
+  Config::Context ctx;
+  if (! _roamingConfig.label(ctx, err))
+    QFAIL(err.format().toStdString().c_str());
+  YAML::Emitter expected;
+  expected << YAML::BeginDoc << _roamingConfig.serialize(ctx, err) << YAML::EndDoc;
+
+  QString text;
+  QTextStream stream(&text);
+  if (! _roamingConfig.toYAML(stream, err))
+    QFAIL(err.format().toStdString().c_str());
+  stream.flush();
+
+  QCOMPARE(text, QString::fromUtf8(expected.c_str()));
+}
+
+void
+ConfigTest::testLazyYAML() {
+  ErrorStack err;
+  Config lazy;
+  if (! lazy.readYAML(":/data/roaming_channel_test.yaml", err, true))
+    QFAIL(err.format().toStdString().c_str());
+
+  // Core lists are present, roaming is deferred
+  QVERIFY(! lazy.isMaterialized());
+  QCOMPARE(lazy.channelList()->count(), 4);
+  QCOMPARE(lazy.zones()->count(), 1);
+  QVERIFY(! lazy.isMaterialized());
+
+  // First access materializes without signaling a modification
+  QSignalSpy spy(&lazy, SIGNAL(modified(ConfigItem*)));
+  QCOMPARE(lazy.roamingZones()->count(), 2);
+  QVERIFY(lazy.isMaterialized());
+  QCOMPARE(lazy.roamingChannels()->count(), 3);
+  QCOMPARE(lazy.roamingZones()->zone(1)->count(), 2);
+  QCOMPARE(spy.count(), 0);
+
+  // Serializes identically to an eagerly read config
+  QString expected, actual;
+  QTextStream expectedStream(&expected), actualStream(&actual);
+  QVERIFY(_roamingConfig.toYAML(expectedStream, err));
+  QVERIFY(lazy.toYAML(actualStream, err));
+  expectedStream.flush(); actualStream.flush();
+  QCOMPARE(actual, expected);
+
+  // Clearing drops deferred parts
+  QVERIFY(lazy.readYAML(":/data/roaming_channel_test.yaml", err, true));
+  lazy.clear();
+  QVERIFY(lazy.isMaterialized());
+  QCOMPARE(lazy.roamingZones()->count(), 0);
+}
+
+void
+ConfigTest::testSnapshot() {
+  ErrorStack err;
+  QBuffer buffer;
+  buffer.open(QIODevice::ReadWrite);
+  if (! ConfigSnapshot::write(&_roamingConfig, buffer, err))
+    QFAIL(err.format().toStdString().c_str());
+
+  Config restored;
+  buffer.seek(0);
+  if (! ConfigSnapshot::read(&restored, buffer, err))
+    QFAIL(err.format().toStdString().c_str());
+
+  // Restored config must serialize identically
+  QString expected, actual;
+  QTextStream expectedStream(&expected), actualStream(&actual);
+  QVERIFY(_roamingConfig.toYAML(expectedStream, err));
+  QVERIFY(restored.toYAML(actualStream, err));
+  expectedStream.flush(); actualStream.flush();
+  QCOMPARE(actual, expected);
+
+  // Garbage is rejected
+  QBuffer garbage;
+  garbage.setData("not a snapshot");
+  garbage.open(QIODevice::ReadOnly);
+  QVERIFY(! ConfigSnapshot::read(&restored, garbage));
+}
+
+void
+ConfigTest::testObjectArena() {
+  QVector<DMRContact *> contacts;
+  {
+    ObjectArena::Scope arena;
+    for (unsigned int i=0; i<2000; i++)
+      contacts.append(new DMRContact(DMRContact::GroupCall, QString("TG%1").arg(i), i+1));
+  }
+  // Objects outlive the scope
+  contacts.append(new DMRContact(DMRContact::PrivateCall, "Outside", 1234));
+  for (int i=contacts.size()-1; i>=0; i-=2)
+    delete contacts.takeAt(i);
+  for (int i=0; i<contacts.size(); i++)
+    QCOMPARE(contacts[i]->number(), unsigned(2*i+2));
+  qDeleteAll(contacts);
+
+  // Clones are pooled and remain valid after the original got deleted
+  ErrorStack err;
+  Config *copy = ConfigCopy::copy(&_basicConfig, err)->as<Config>();
+  QVERIFY(copy);
+  QCOMPARE(copy->channelList()->count(), _basicConfig.channelList()->count());
+  delete copy;
+}
+
+void
+ConfigTest::testTagLookup() {
+  const QMetaObject &meta = DMRChannel::staticMetaObject;
+  QMetaProperty radioId = meta.property(meta.indexOfProperty("radioId"));
+  QMetaProperty name = meta.property(meta.indexOfProperty("name"));
+
+  // Tags registered by the channel constructor
+  DMRChannel channel;
+  QVERIFY(ConfigItem::Context::hasTag(radioId, DefaultRadioID::get()));
+  QCOMPARE(ConfigItem::Context::getTag(radioId, DefaultRadioID::get()), QString("!default"));
+  QVERIFY(ConfigItem::Context::getTag(radioId, QString("!default")) == DefaultRadioID::get());
+
+  // Cached misses get updated, once a tag gets registered
+  QVERIFY(! ConfigItem::Context::hasTag(name, SelectedChannel::get()));
+  ConfigItem::Context::setTag(name.enclosingMetaObject()->className(), name.name(),
+                              "!test", SelectedChannel::get());
+  QVERIFY(ConfigItem::Context::hasTag(name, SelectedChannel::get()));
+  QVERIFY(ConfigItem::Context::hasTag(name.enclosingMetaObject()->className(), name.name(),
+                                      QString("!test")));
+}
+
+void
+ConfigTest::testVerifyCache() {
+  RadioLimits limits{
+    { "contacts", new RadioLimitList(
+        Contact::staticMetaObject, -1, -1, new RadioLimitObject {
+          { "name", new RadioLimitString(-1, 4, RadioLimitString::Unicode) }
+        } ) }
+  };
+
+  RadioLimitContext uncached;
+  limits.verifyConfig(&_basicConfig, uncached);
+  // Names of 4 contacts are too long
+  QCOMPARE(uncached.count(), 4);
+
+  // First run fills cache
+  RadioLimitCache cache;
+  RadioLimitContext first(&cache);
+  limits.verifyConfig(&_basicConfig, first);
+  QCOMPARE(cache.count(), _basicConfig.contacts()->count());
+  QCOMPARE(first.count(), uncached.count());
+
+  // Second run reports cached issues
+  RadioLimitContext second(&cache);
+  limits.verifyConfig(&_basicConfig, second);
+  QCOMPARE(second.count(), uncached.count());
+  for (int i=0; i<second.count(); i++)
+    QCOMPARE(second.message(i).format(), uncached.message(i).format());
+
+  // Modified objects get verified again
+  _basicConfig.contacts()->contact(1)->setName("Reg");
+  RadioLimitContext third(&cache);
+  limits.verifyConfig(&_basicConfig, third);
+  QCOMPARE(third.count(), 3);
+}
+
+void
+ConfigTest::testIssueAggregation() {
+  RadioLimitContext ctx;
+  ctx.enableAggregation();
+  ctx.push("A");
+  ctx.newMessage(RadioLimitIssue::Warning) << "Value " << 1 << " too large.";
+  ctx.push("B");
+  ctx.newMessage(RadioLimitIssue::Warning) << "Value " << 1 << " too large.";
+  ctx.newMessage(RadioLimitIssue::Hint) << "Value " << 1 << " too large.";
+  ctx.pop();
+  ctx.pop();
+
+  QCOMPARE(ctx.count(), 2);
+  QCOMPARE(ctx.message(0).repetitions(), 2u);
+  QCOMPARE(ctx.message(0).message(), QString("Value 1 too large."));
+  QCOMPARE(ctx.message(0).stack(), QStringList({"A"}));
+  QCOMPARE(ctx.message(1).severity(), RadioLimitIssue::Hint);
+  QCOMPARE(ctx.message(1).stack(), QStringList({"A", "B"}));
+  QCOMPARE(ctx.maxSeverity(), RadioLimitIssue::Warning);
+
+  // Limit number of issues
+  RadioLimitContext limited;
+  limited.setMaxIssues(1);
+  limited.newMessage() << "First";
+  limited.newMessage(RadioLimitIssue::Critical) << "Second";
+  QCOMPARE(limited.count(), 1);
+  QCOMPARE(limited.dropped(), 1u);
+  QCOMPARE(limited.maxSeverity(), RadioLimitIssue::Critical);
+}
+
+void
+ConfigTest::testUsageEstimate() {
+  RadioLimits limits{
+    { "channels", new RadioLimitList(Channel::staticMetaObject, -1, 8, new RadioLimitObject()) },
+    { "contacts", new RadioLimitList{
+        { DMRContact::staticMetaObject, -1, 4, new RadioLimitObject() },
+        { DTMFContact::staticMetaObject, -1, 2, new RadioLimitObject() } } },
+    { "groupLists", new RadioLimitList(
+        RXGroupList::staticMetaObject, -1, 4, new RadioLimitObject {
+          { "contacts", new RadioLimitGroupCallRefList(-1, 2) } }) },
+    { "zones", new RadioLimitList(Zone::staticMetaObject, -1, 1, new RadioLimitSingleZone(4, {})) }
+  };
+
+  RadioLimitUsage usage = limits.estimateUsage(&_basicConfig);
+  QHash<QString, int> sections;
+  for (int i=0; i<usage.count(); i++)
+    sections.insert(usage.section(i).name, i);
+  QCOMPARE(sections.size(), 8);
+
+  const RadioLimitUsage::Section &channels = usage.section(sections.value("channels"));
+  QCOMPARE(channels.used, qint64(4));
+  QCOMPARE(channels.capacity, qint64(8));
+  QCOMPARE(channels.exceeded, 0u);
+
+  // Lists of several types are reported per type
+  QCOMPARE(usage.section(sections.value("contacts.DMRContact")).used, qint64(6));
+  QCOMPARE(usage.section(sections.value("contacts.DMRContact")).exceeded, 1u);
+  QCOMPARE(usage.section(sections.value("contacts.DTMFContact")).used, qint64(0));
+
+  // Nested lists are reported by the largest one
+  QCOMPARE(usage.section(sections.value("groupLists.contacts")).used, qint64(3));
+  QCOMPARE(usage.section(sections.value("groupLists.contacts")).exceeded, 1u);
+
+  // The dual channel zone takes two entries
+  QCOMPARE(usage.section(sections.value("zones")).used, qint64(2));
+  QCOMPARE(usage.section(sections.value("zones.A")).used, qint64(3));
+  QCOMPARE(usage.section(sections.value("zones.B")).used, qint64(1));
+
+  QVERIFY(! usage.fits());
+  QCOMPARE(usage.fullest(), sections.value("zones"));
+}
+
+void
+ConfigTest::testHashAndDiff() {
+  ErrorStack err;
+  Config *copy = ConfigCopy::copy(&_basicConfig, err)->as<Config>();
+  if (nullptr == copy)
+    QFAIL(err.format().toLocal8Bit().constData());
+
+  // Equal configs have equal hashes and no differences
+  quint64 hash = _basicConfig.hash();
+  QCOMPARE(copy->hash(), hash);
+  QVERIFY(_basicConfig.diff(copy).isEmpty());
+
+  // Modifications invalidate the hash of the item and its owners only
+  quint64 zones = copy->zones()->hash();
+  copy->channelList()->channel(0)->setRXFrequency(Frequency::fromMHz(145.5));
+  QVERIFY(copy->hash() != hash);
+  QCOMPARE(copy->zones()->hash(), zones);
+  FMChannel *added = new FMChannel(); added->setName("Added");
+  copy->channelList()->add(added);
+  copy->zones()->del(copy->zones()->get(0));
+
+  QList<Config::Change> changes = _basicConfig.diff(copy);
+  QCOMPARE(changes.size(), 3);
+  QCOMPARE(changes[0].kind, Config::Change::Kind::Modified);
+  QVERIFY(changes[0].item == _basicConfig.channelList()->channel(0));
+  QVERIFY(changes[0].other == copy->channelList()->channel(0));
+  QCOMPARE(changes[1].kind, Config::Change::Kind::Added);
+  QVERIFY(changes[1].other == added);
+  QCOMPARE(changes[2].kind, Config::Change::Kind::Removed);
+  QVERIFY(changes[2].item == _basicConfig.zones()->get(0));
+
+  // Reverted changes are not considered as modifications
+  copy->setModified(false);
+  QString name = copy->channelList()->channel(0)->name();
+  copy->channelList()->channel(0)->setName("Other");
+  QVERIFY(copy->isModified());
+  copy->channelList()->channel(0)->setName(name);
+  QVERIFY(! copy->isModified());
+
+  delete copy;
+}
+
+void
+ConfigTest::testApplyChanges() {
+  ErrorStack err;
+  Config *target = ConfigCopy::copy(&_basicConfig, err)->as<Config>(),
+      *other = ConfigCopy::copy(&_basicConfig, err)->as<Config>();
+  if ((nullptr == target) || (nullptr == other))
+    QFAIL(err.format().toLocal8Bit().constData());
+
+  // Modify, add and reference a new channel
+  other->channelList()->channel(0)->setRXFrequency(Frequency::fromMHz(145.5));
+  FMChannel *added = new FMChannel(); added->setName("Added");
+  other->channelList()->add(added, 0);
+  other->zones()->zone(0)->A()->add(added);
+
+  Channel *kept = target->channelList()->channel(0);
+  QSignalSpy spy(target, SIGNAL(modified(ConfigItem*)));
+  if (! target->apply(other, err))
+    QFAIL(err.format().toLocal8Bit().constData());
+
+  // Equal afterwards, existing objects are updated in place and a single signal is emitted
+  QCOMPARE(target->hash(), other->hash());
+  QVERIFY(target->diff(other).isEmpty());
+  QCOMPARE(spy.count(), 1);
+  QVERIFY(target->channelList()->channel(1) == kept);
+  QCOMPARE(kept->rxFrequency(), Frequency::fromMHz(145.5));
+  QVERIFY(target->channelList()->channel(0) != added);
+  QVERIFY(target->zones()->zone(0)->A()->has(target->channelList()->channel(0)));
+
+  // Removing objects also removes references to them
+  other->channelList()->del(added);
+  QVERIFY(target->apply(other, err));
+  QCOMPARE(target->hash(), other->hash());
+  QVERIFY(target->channelList()->channel(0) == kept);
+
+  delete target;
+  delete other;
+}
+
+void
+ConfigTest::testApplyToAll() {
+  ErrorStack err;
+  Config *copy = ConfigCopy::copy(&_basicConfig, err)->as<Config>();
+  if (nullptr == copy)
+    QFAIL(err.format().toLocal8Bit().constData());
+  FMChannel *fm = new FMChannel(); fm->setName("FM");
+  copy->channelList()->add(fm);
+
+  QSignalSpy single(copy->channelList(), SIGNAL(elementModified(int)));
+  QSignalSpy bulk(copy->channelList(), SIGNAL(elementsModified(int,int)));
+  QSignalSpy config(copy, SIGNAL(modified(ConfigItem*)));
+
+  // All channels have a power setting, signaled at once
+  QCOMPARE(copy->channelList()->applyToAll({0, 1}, "power", QVariant::fromValue(Channel::Power::Min), err), 2);
+  QCOMPARE(copy->channelList()->channel(0)->power(), Channel::Power::Min);
+  QCOMPARE(copy->channelList()->channel(1)->power(), Channel::Power::Min);
+  QCOMPARE(single.count(), 0);
+  QCOMPARE(bulk.count(), 1);
+  QCOMPARE(bulk.at(0).at(0).toInt(), 0);
+  QCOMPARE(bulk.at(0).at(1).toInt(), 2);
+  QCOMPARE(config.count(), 1);
+
+  // FM channels have no time slot
+  int last = copy->channelList()->count()-1;
+  QCOMPARE(copy->channelList()->applyToAll({1, last}, "timeSlot", QVariant::fromValue(DMRChannel::TimeSlot::TS2), err), 1);
+  QCOMPARE(copy->channelList()->channel(1)->as<DMRChannel>()->timeSlot(), DMRChannel::TimeSlot::TS2);
+  QCOMPARE(bulk.count(), 2);
+  QCOMPARE(bulk.at(1).at(0).toInt(), 1);
+  QCOMPARE(bulk.at(1).at(1).toInt(), 1);
+
+  delete copy;
+}
+
+void
+ConfigTest::testUseCount() {
+  ErrorStack err;
+  Config *copy = ConfigCopy::copy(&_basicConfig, err)->as<Config>();
+  if (nullptr == copy)
+    QFAIL(err.format().toLocal8Bit().constData());
+
+  // The owning list is not counted
+  PositioningSystem *sys = copy->posSystems()->get(0)->as<PositioningSystem>();
+  DMRChannel *ch = copy->channelList()->get(1)->as<DMRChannel>();
+  int uses = sys->useCount();
+  QVERIFY(uses > 0);
+  QCOMPARE(sys->lists().count(), 1);
+  QVERIFY(ch->setAPRSObj(nullptr));
+  QCOMPARE(sys->useCount(), uses-1);
+  QVERIFY(ch->setAPRSObj(sys));
+  QCOMPARE(sys->useCount(), uses);
+
+  // Deleting a zone releases its channel lists
+  Channel *zoneCh = copy->channelList()->channel(2);
+  uses = zoneCh->useCount();
+  QVERIFY(uses > 0);
+  QVERIFY(copy->zones()->del(copy->zones()->get(0)));
+  QCOMPARE(zoneCh->useCount(), uses-1);
+
+  // Deleting the channel releases its references
+  uses = sys->useCount();
+  QVERIFY(copy->channelList()->del(ch));
+  QCOMPARE(sys->useCount(), uses-1);
+
+  delete copy;
+}
+
+void
+ConfigTest::testHistory() {
+  ErrorStack err;
+  Config *copy = ConfigCopy::copy(&_basicConfig, err)->as<Config>();
+  if (nullptr == copy)
+    QFAIL(err.format().toLocal8Bit().constData());
+
+  DMRChannel *ch = copy->channelList()->get(1)->as<DMRChannel>();
+  Zone *zone = copy->zones()->get(0)->as<Zone>();
+  QString name = ch->name();
+  PositioningSystem *aprs = ch->aprsObj();
+  int zoneSize = zone->A()->count();
+
+  // Group several edits in one step, unchanged items are not recorded
+  ConfigHistory history;
+  history.begin("Edit");
+  history.track(ch);
+  history.track(zone);
+  history.track(copy->channelList()->get(0));
+  ch->setName("Other");
+  ch->setAPRSObj(nullptr);
+  history.begin("Nested");
+  zone->A()->add(copy->channelList()->get(2));
+  QVERIFY(! history.commit());
+  QVERIFY(history.commit());
+  QVERIFY(history.canUndo());
+  QCOMPARE(history.undoLabel(), QString("Edit"));
+
+  if (! history.undo(err))
+    QFAIL(err.format().toLocal8Bit().constData());
+  QCOMPARE(ch->name(), name);
+  QCOMPARE(ch->aprsObj(), aprs);
+  QCOMPARE(zone->A()->count(), zoneSize);
+  QVERIFY(history.canRedo());
+
+  if (! history.redo(err))
+    QFAIL(err.format().toLocal8Bit().constData());
+  QCOMPARE(ch->name(), QString("Other"));
+  QCOMPARE(ch->aprsObj(), nullptr);
+  QCOMPARE(zone->A()->count(), zoneSize+1);
+
+  // Steps without changes are dropped
+  history.begin("Nothing");
+  history.track(ch);
+  QVERIFY(! history.commit());
+  QCOMPARE(history.undoLabel(), QString("Edit"));
+
+  delete copy;
+}
+
 void
 ConfigTest::testMultipleRadioIDs() {
   ErrorStack err;
@@ -148,5 +964,27 @@ ConfigTest::testMelodyDecoding() {
   QCOMPARE(melody.bpm(), 100);
 }
 
+void
+ConfigTest::testMelodyInferBPM() {
+  // Durations of a quarter, eighth and half note at 120 BPM
+  QVector<QPair<double, unsigned int>> tones = {
+    {440.00, 500}, {493.88, 250}, {329.63, 1000}, {440.00, 500}
+  };
+  QCOMPARE(Melody::inferBPM(tones), 120U);
+
+  Melody melody; melody.infer(tones);
+  QCOMPARE(melody.bpm(), 120U);
+  QCOMPARE(melody.toLilypond(), QString("a4 b8 e2 a4"));
+  // Encoding reproduces the durations at the inferred BPM
+  QVector<QPair<double, unsigned int>> encoded = melody.toTones();
+  for (int i=0; i<tones.size(); i++)
+    QCOMPARE(encoded[i].second, tones[i].second);
+
+  // Nothing to infer from
+  QVector<QPair<double, unsigned int>> empty, silent = { {440.0, 0} };
+  QCOMPARE(Melody::inferBPM(empty), 100U);
+  QCOMPARE(Melody::inferBPM(silent), 100U);
+}
+
 QTEST_GUILESS_MAIN(ConfigTest)
 
@@ -21,12 +21,37 @@ private slots:
   void testCloneChannelBasic();
   void testCloneChannelCTCSS();
 
+  void testPropertyTable();
+  void testListIndex();
+  void testNumberIndex();
+  void testTypeIndex();
+  void testRoamingChannelIndex();
+  void testFreeze();
+  void testBulkUpdate();
+  void testBuilder();
+  void testRepeaterSelection();
+  void testImportTalkGroups();
+  void testStreamingYAML();
+  void testLazyYAML();
+  void testSnapshot();
+  void testObjectArena();
+  void testTagLookup();
+  void testVerifyCache();
+  void testIssueAggregation();
+  void testUsageEstimate();
+  void testHashAndDiff();
+  void testApplyChanges();
+  void testApplyToAll();
+  void testUseCount();
+  void testHistory();
+
   /** Regression test for issue #388. */
   void testMultipleRadioIDs();
 
   void testMelodyLilypond();
   void testMelodyEncoding();
   void testMelodyDecoding(); 
+  void testMelodyInferBPM();
 
 protected:
   QTextStream _stderr;
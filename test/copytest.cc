@@ -63,5 +63,34 @@ CopyTest::testConfigCopy() {
   QCOMPARE(_basicConfig.compare(*item), 0);
 }
 
+void
+CopyTest::testReferenceWorklist() {
+  QHash<ConfigObject *, ConfigObject *> map;
+  ConfigCloneVisitor cloner(map);
+
+  ErrorStack err;
+  if (! cloner.process(&_basicConfig, err)) {
+    QFAIL(err.format().toLocal8Bit().constData());
+  }
+
+  ConfigItem *item = cloner.takeResult(err);
+  QVERIFY(item);
+  QVERIFY(item->is<Config>());
+
+  if (! cloner.fixReferences(false, err)) {
+    QFAIL(err.format().toLocal8Bit().constData());
+  }
+
+  QCOMPARE(_basicConfig.compare(*item), 0);
+
+  // Check, that references point to the clones
+  Config *copy = item->as<Config>();
+  QVERIFY(copy->channelList()->channel(0)->as<DMRChannel>()->txContactObj()
+          == copy->contacts()->contact(0));
+  QVERIFY(copy->zones()->zone(0)->A()->get(0) == copy->channelList()->channel(0));
+
+  delete item;
+}
+
 
 QTEST_GUILESS_MAIN(CopyTest)
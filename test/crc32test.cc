@@ -1,6 +1,18 @@
 #include "crc32test.hh"
 #include "crc32.hh"
 #include <QTest>
+#include <algorithm>
+
+static QByteArray
+randomData(int size) {
+  QByteArray data(size, 0x00);
+  uint32_t state = 42;
+  for (int i=0; i<size; i++) {
+    state = state*1664525 + 1013904223;
+    data[i] = char(state >> 24);
+  }
+  return data;
+}
 
 CRC32Test::CRC32Test(QObject *parent) : QObject(parent)
 {
@@ -15,4 +27,97 @@ CRC32Test::testCRC32() {
   QCOMPARE(crc.get(), 0x414FA339U^0xFFFFFFFF);
 }
 
+void
+CRC32Test::testLargeBuffer() {
+  QByteArray data = randomData(16*1024*1024);
+  CRC32 ref, slicing, crc;
+  ref.updateBytewise((const uint8_t *)data.constData(), data.size());
+  slicing.updateSlicing((const uint8_t *)data.constData(), data.size());
+  crc.update(data);
+  QCOMPARE(slicing.get(), ref.get());
+  QCOMPARE(crc.get(), ref.get());
+}
+
+void
+CRC32Test::testUnaligned() {
+  QByteArray data = randomData(4096);
+  const uint8_t *ptr = (const uint8_t *)data.constData();
+  for (int offset=0; offset<16; offset++) {
+    for (int size=0; size<300; size++) {
+      CRC32 ref, slicing, crc;
+      ref.updateBytewise(ptr+offset, size);
+      slicing.updateSlicing(ptr+offset, size);
+      crc.update(ptr+offset, size);
+      QCOMPARE(slicing.get(), ref.get());
+      QCOMPARE(crc.get(), ref.get());
+    }
+  }
+}
+
+void
+CRC32Test::testIncremental() {
+  QByteArray data = randomData(100000);
+  const uint8_t *ptr = (const uint8_t *)data.constData();
+  CRC32 ref, crc;
+  ref.updateBytewise(ptr, data.size());
+  for (int offset=0, n=1; offset<data.size(); offset+=n, n=(n*3+1)%1000) {
+    n = std::min(n, data.size()-offset);
+    crc.update(ptr+offset, n);
+  }
+  QCOMPARE(crc.get(), ref.get());
+}
+
+void
+CRC32Test::testCombine() {
+  QByteArray data = randomData(10000);
+  const uint8_t *ptr = (const uint8_t *)data.constData();
+  CRC32 ref;
+  ref.update(data);
+  for (int split=0; split<=data.size(); split+=997) {
+    CRC32 head, tail, crc;
+    head.update(ptr, split);
+    tail.update(ptr+split, data.size()-split);
+    QCOMPARE(CRC32::combine(head.get(), tail.get(), data.size()-split), ref.get());
+    crc.update(ptr, split);
+    crc.append(tail.get(), data.size()-split);
+    QCOMPARE(crc.get(), ref.get());
+  }
+}
+
+void
+CRC32Test::testParallel() {
+  QByteArray data = randomData(16*1024*1024+13);
+  CRC32 ref, crc;
+  ref.update(data);
+  crc.updateParallel((const uint8_t *)data.constData(), data.size());
+  QCOMPARE(crc.get(), ref.get());
+}
+
+void
+CRC32Test::benchmarkBytewise() {
+  QByteArray data = randomData(16*1024*1024);
+  CRC32 crc;
+  QBENCHMARK {
+    crc.updateBytewise((const uint8_t *)data.constData(), data.size());
+  }
+}
+
+void
+CRC32Test::benchmarkUpdate() {
+  QByteArray data = randomData(16*1024*1024);
+  CRC32 crc;
+  QBENCHMARK {
+    crc.update(data);
+  }
+}
+
+void
+CRC32Test::benchmarkParallel() {
+  QByteArray data = randomData(16*1024*1024);
+  CRC32 crc;
+  QBENCHMARK {
+    crc.updateParallel((const uint8_t *)data.constData(), data.size());
+  }
+}
+
 QTEST_GUILESS_MAIN(CRC32Test)
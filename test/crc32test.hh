@@ -12,6 +12,14 @@ public:
 
 private slots:
   void testCRC32();
+  void testLargeBuffer();
+  void testUnaligned();
+  void testIncremental();
+  void testCombine();
+  void testParallel();
+  void benchmarkBytewise();
+  void benchmarkUpdate();
+  void benchmarkParallel();
 };
 
 #endif // CRC32TEST_H
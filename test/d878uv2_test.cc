@@ -121,5 +121,34 @@ D878UV2Test::testKeyFunctions() {
 }
 
 
+void
+D878UV2Test::testEncodeFrom() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+
+  D878UVCodeplug source;
+  if (! source.encode(&_basicConfig, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  D878UV2Codeplug expected, codeplug;
+  if (! expected.encode(&_basicConfig, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UVII: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  if (! codeplug.encodeFrom(source, &_basicConfig, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UVII from AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  // Reusing the shared sections must yield the same codeplug
+  QCOMPARE(codeplug.image(0).numElements(), expected.image(0).numElements());
+  for (int i=0; i<expected.image(0).numElements(); i++) {
+    QCOMPARE(codeplug.image(0).element(i).address(), expected.image(0).element(i).address());
+    QCOMPARE(codeplug.image(0).element(i).data(), expected.image(0).element(i).data());
+  }
+}
+
 QTEST_GUILESS_MAIN(D878UV2Test)
 
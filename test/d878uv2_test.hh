@@ -16,6 +16,7 @@ private slots:
   void testBasicConfigDecoding();
   void testChannelFrequency();
   void testKeyFunctions();
+  void testEncodeFrom();
 };
 
 #endif // D878UV2TEST_HH
@@ -3,6 +3,10 @@
 #include "d878uv.hh"
 #include "d878uv_codeplug.hh"
 #include "errorstack.hh"
+#include "dfupatch.hh"
+#include "encodesession.hh"
+#include "codeplugview.hh"
+#include "codeplugtable.hh"
 #include <iostream>
 #include <QTest>
 #include "logger.hh"
@@ -52,6 +56,134 @@ D878UVTest::testBasicConfigDecoding() {
   }
 }
 
+void
+D878UVTest::testConcurrentEncoding() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  D878UVCodeplug sequential;
+  if (! sequential.encode(&_roamingConfig, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  flags.encodeThreads = 4;
+  D878UVCodeplug concurrent;
+  if (! concurrent.encode(&_roamingConfig, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV concurrently: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  // Both must be identical
+  QCOMPARE(concurrent.image(0).numElements(), sequential.image(0).numElements());
+  for (int i=0; i<sequential.image(0).numElements(); i++) {
+    const DFUFile::Element &a = sequential.image(0).element(i), &b = concurrent.image(0).element(i);
+    QCOMPARE(b.address(), a.address());
+    QVERIFY(b.data() == a.data());
+  }
+}
+
+void
+D878UVTest::testSkeletonEncoding() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  D878UVCodeplug first, roaming, second;
+  if ((! first.encode(&_basicConfig, flags, err)) || (! roaming.encode(&_roamingConfig, flags, err))
+      || (! second.encode(&_basicConfig, flags, err))) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  // Encoding another config in between must not alter the shared skeleton
+  QCOMPARE(second.image(0).numElements(), first.image(0).numElements());
+  for (int i=0; i<first.image(0).numElements(); i++) {
+    const DFUFile::Element &a = first.image(0).element(i), &b = second.image(0).element(i);
+    QCOMPARE(b.address(), a.address());
+    QVERIFY(b.data() == a.data());
+  }
+}
+
+void
+D878UVTest::testConcurrentDecoding() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  D878UVCodeplug codeplug;
+  if (! codeplug.encode(&_roamingConfig, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  Config sequential;
+  if (! codeplug.decode(&sequential, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  codeplug.setDecodeThreads(4);
+  Config concurrent;
+  if (! codeplug.decode(&concurrent, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV concurrently: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  // Objects must be created in the same order
+  QCOMPARE(concurrent.channelList()->count(), sequential.channelList()->count());
+  for (int i=0; i<sequential.channelList()->count(); i++) {
+    QCOMPARE(concurrent.channelList()->channel(i)->name(), sequential.channelList()->channel(i)->name());
+    QCOMPARE(concurrent.channelList()->channel(i)->thread(), concurrent.thread());
+  }
+  QCOMPARE(concurrent.contacts()->count(), sequential.contacts()->count());
+  for (int i=0; i<sequential.contacts()->count(); i++)
+    QCOMPARE(concurrent.contacts()->contact(i)->name(), sequential.contacts()->contact(i)->name());
+}
+
+void
+D878UVTest::testIncrementalEncoding() {
+  ErrorStack err;
+  Config config;
+  if (! config.readYAML(":/data/roaming_channel_test.yaml", err)) {
+    QFAIL(QString("Cannot open codeplug file: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  D878UVCodeplug codeplug;
+  Codeplug::Context ctx(&config);
+  DFUPatch changes;
+
+  // First call encodes everything
+  if (! codeplug.encodeIncremental(&config, ctx, changes, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(! changes.isEmpty());
+
+  // Nothing changed
+  if (! codeplug.encodeIncremental(&config, ctx, changes, flags, err)) {
+    QFAIL(QString("Cannot re-encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(changes.isEmpty());
+
+  // Rename a channel, only the name of that channel changes
+  config.channelList()->channel(0)->setName("Renamed");
+  if (! codeplug.encodeIncremental(&config, ctx, changes, flags, err)) {
+    QFAIL(QString("Cannot re-encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(! changes.isEmpty());
+  QVERIFY(16 >= changes.size());
+
+  // Result must match a complete encoding
+  D878UVCodeplug full;
+  if (! full.encode(&config, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(codeplug.image(0).numElements(), full.image(0).numElements());
+  for (int i=0; i<full.image(0).numElements(); i++)
+    QVERIFY(codeplug.image(0).element(i).data() == full.image(0).element(i).data());
+}
+
 void
 D878UVTest::testAnalogMicGain() {
   ErrorStack err;
@@ -72,6 +204,177 @@ D878UVTest::testAnalogMicGain() {
   QCOMPARE(config.settings()->anytoneExtension()->audioSettings()->fmMicGain(), 6);
 }
 
+void
+D878UVTest::testEncodeSession() {
+  ErrorStack err;
+  D878UVCodeplug codeplug;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+
+  EncodeSession session(&_basicConfig, codeplug);
+  // Config gets uploaded as a copy, the source is never modified
+  Config *config = session.uploadConfig(err);
+  if (nullptr == config) {
+    QFAIL(QString("Cannot prepare codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(&_basicConfig != config);
+  QCOMPARE(session.uploadConfig(err), config);
+
+  // Index only once
+  QVERIFY(! session.isIndexed());
+  if (! session.index(err)) {
+    QFAIL(QString("Cannot index codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(session.isIndexed());
+  QVERIFY(session.index(err));
+
+  // Encode from the indexed context must match a complete encoding
+  if (! codeplug.encodeIndexed(session.context(), flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  D878UVCodeplug full;
+  if (! full.encode(config, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(codeplug.image(0).numElements(), full.image(0).numElements());
+  for (int i=0; i<full.image(0).numElements(); i++)
+    QVERIFY(codeplug.image(0).element(i).data() == full.image(0).element(i).data());
+
+  // Taking the config passes ownership and discards the index
+  Config *taken = session.takeConfig(err);
+  QCOMPARE(taken, config);
+  QVERIFY(! session.isIndexed());
+  delete taken;
+}
+
+void
+D878UVTest::testBitmapElements() {
+  // Plain bitmap (set bit -> encoded)
+  QByteArray chBuffer(AnytoneCodeplug::ChannelBitmapElement::size(), 0);
+  AnytoneCodeplug::ChannelBitmapElement channels((uint8_t *)chBuffer.data());
+  channels.clear();
+  QCOMPARE(channels.count(), 0U);
+  QCOMPARE(channels.nextEncoded(0), -1);
+  channels.enableFirst(67);
+  QCOMPARE(channels.count(), 67U);
+  QVERIFY(channels.isEncoded(66));
+  QVERIFY(! channels.isEncoded(67));
+  channels.setRange(3, 70, false);
+  QCOMPARE(channels.count(), 3U);
+  QCOMPARE(channels.nextEncoded(3), -1);
+  channels.setEncoded(1000, true);
+  QCOMPARE(channels.nextEncoded(2), 2);
+  QCOMPARE(channels.nextEncoded(3), 1000);
+
+  // Inverted bitmap (cleared bit -> encoded)
+  QByteArray cntBuffer(AnytoneCodeplug::ContactBitmapElement::size(), 0);
+  AnytoneCodeplug::ContactBitmapElement contacts((uint8_t *)cntBuffer.data());
+  contacts.clear();
+  QCOMPARE(contacts.count(), 0U);
+  contacts.setRange(130, 5, true);
+  QCOMPARE(contacts.count(), 5U);
+  QCOMPARE(contacts.nextEncoded(0), 130);
+  QCOMPARE(contacts.nextEncoded(134), 134);
+  QCOMPARE(contacts.nextEncoded(135), -1);
+
+  // Inverted bytemap (zero byte -> encoded)
+  QByteArray dtmfBuffer(AnytoneCodeplug::DTMFContactBytemapElement::size(), 0);
+  AnytoneCodeplug::DTMFContactBytemapElement dtmf((uint8_t *)dtmfBuffer.data());
+  dtmf.clear();
+  QCOMPARE(dtmf.count(), 0U);
+  dtmf.setRange(10, 2, true);
+  QCOMPARE(dtmf.count(), 2U);
+  QCOMPARE(dtmf.nextEncoded(0), 10);
+  QCOMPARE(dtmf.nextEncoded(12), -1);
+}
+
+void
+D878UVTest::testLazyView() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  D878UVCodeplug codeplug;
+  if (! codeplug.encode(&_basicConfig, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  Config config;
+  if (! codeplug.decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  CodeplugView view(&codeplug);
+  QVERIFY(view.isLazy());
+
+  // Compare channels with full decode
+  QList<unsigned int> indices = view.channelIndices(err);
+  QCOMPARE(indices.size(), config.channelList()->count());
+  for (int i=0; i<indices.size(); i++) {
+    Channel *ch = view.channelAt(indices[i], err);
+    QVERIFY(nullptr != ch);
+    QCOMPARE(ch->name(), config.channelList()->channel(i)->name());
+    QCOMPARE(ch->rxFrequency(), config.channelList()->channel(i)->rxFrequency());
+    // Decoded channels are cached
+    QCOMPARE(view.channelAt(indices[i]), ch);
+  }
+  QVERIFY(nullptr == view.channelAt(3999));
+
+  // Compare zones
+  QStringList zones = view.zones(err);
+  QCOMPARE(zones.size(), config.zones()->count());
+  for (int i=0; i<zones.size(); i++)
+    QCOMPARE(zones[i], config.zones()->zone(i)->name());
+
+  // Compare radio IDs
+  QList<DMRRadioID *> ids = view.radioIDs(err);
+  QCOMPARE(ids.size(), config.radioIDs()->count());
+  QCOMPARE(ids.first()->number(), config.radioIDs()->getId(0)->number());
+}
+
+void
+D878UVTest::testTableDecoding() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  D878UVCodeplug codeplug;
+  if (! codeplug.encode(&_basicConfig, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  // Compare channels with the encoded config
+  ChannelTable channels;
+  QVERIFY(codeplug.decodeChannelTable(channels, err));
+  QCOMPARE(channels.size(), _basicConfig.channelList()->count());
+  for (int i=0; i<channels.size(); i++) {
+    Channel *ch = _basicConfig.channelList()->channel(i);
+    QCOMPARE(channels.name[i], ch->name());
+    QCOMPARE(channels.rxFrequency[i], ch->rxFrequency());
+    QCOMPARE(channels.txFrequency[i], ch->txFrequency());
+    QCOMPARE(channels.digital[i], ch->is<DMRChannel>());
+    if (DMRChannel *dmr = ch->as<DMRChannel>())
+      QVERIFY(dmr->txContactObj() == _basicConfig.contacts()->digitalContact(channels.contact[i]));
+  }
+
+  // Channel objects are created on demand only
+  Channel *ch = channels.createChannel(0);
+  QVERIFY(nullptr != ch);
+  QCOMPARE(ch->name(), _basicConfig.channelList()->channel(0)->name());
+  delete ch;
+
+  // Compare contacts
+  ContactTable contacts;
+  QVERIFY(codeplug.decodeContactTable(contacts, err));
+  QCOMPARE(contacts.size(), _basicConfig.contacts()->digitalCount());
+  for (int i=0; i<contacts.size(); i++) {
+    QCOMPARE(contacts.name[i], _basicConfig.contacts()->digitalContact(i)->name());
+    QCOMPARE(contacts.number[i], _basicConfig.contacts()->digitalContact(i)->number());
+  }
+}
+
 void
 D878UVTest::testChannelFrequency() {
   ErrorStack err;
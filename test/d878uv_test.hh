@@ -16,6 +16,14 @@ private slots:
 
   void testBasicConfigEncoding();
   void testBasicConfigDecoding();
+  void testConcurrentEncoding();
+  void testSkeletonEncoding();
+  void testConcurrentDecoding();
+  void testIncrementalEncoding();
+  void testEncodeSession();
+  void testBitmapElements();
+  void testLazyView();
+  void testTableDecoding();
   void testChannelFrequency();
 
   void testAnalogMicGain();
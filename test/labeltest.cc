@@ -1,5 +1,6 @@
 #include "labeltest.hh"
 #include "configlabelingvisitor.hh"
+#include "channel.hh"
 
 
 LabelTest::LabelTest(QObject *parent)
@@ -26,4 +27,22 @@ LabelTest::testLabelVisitor() {
 
 
 
+void
+LabelTest::testLabelCollisions() {
+  Config::Context ctx;
+  FMChannel present, a, b, c;
+  // An ID taken already, e.g., by a parsed object, must be skipped.
+  QVERIFY(ctx.add("ch2", &present));
+
+  ErrorStack err;
+  if ((! a.label(ctx, err)) || (! b.label(ctx, err)) || (! c.label(ctx, err)))
+    QFAIL(err.format().toLocal8Bit().constData());
+
+  QCOMPARE(ctx.getId(&a), QString("ch1"));
+  QCOMPARE(ctx.getId(&b), QString("ch3"));
+  QCOMPARE(ctx.getId(&c), QString("ch4"));
+  QCOMPARE(ctx.newId("ch"), QString("ch5"));
+}
+
+
 QTEST_GUILESS_MAIN(LabelTest)
@@ -12,6 +12,7 @@ public:
 
 private slots:
   void testLabelVisitor();
+  void testLabelCollisions();
 };
 
 #endif // LABETEST_HH
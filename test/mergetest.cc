@@ -1,8 +1,10 @@
 #include "mergetest.hh"
 
 #include <QTest>
+#include <QElapsedTimer>
 #include "config.hh"
 #include "configmergevisitor.hh"
+#include "configcopyvisitor.hh"
 
 
 MergeTest::MergeTest(QObject *parent)
@@ -419,4 +421,92 @@ MergeTest::testMergeZones() {
 }
 
 
+void
+MergeTest::testMergeAll() {
+  // Every source overrides the channel of the previous one, the zone must refer to the last.
+  QList<Config *> sources;
+  for (int i=0; i<3; i++) {
+    Config *config = new Config();
+    FMChannel *ch = new FMChannel();
+    ch->setName("FM 0");
+    ch->setRXFrequency(Frequency::fromMHz(144.0+i));
+    ch->setTXFrequency(Frequency::fromMHz(144.0+i));
+    config->channelList()->add(ch);
+    ch = new FMChannel();
+    ch->setName(QString("FM %1").arg(i+1));
+    config->channelList()->add(ch);
+    Zone *zone = new Zone("Zone 0");
+    zone->A()->add(config->channelList()->channel(0));
+    zone->A()->add(config->channelList()->channel(1));
+    config->zones()->add(zone);
+    sources.append(config);
+  }
+
+  // Merge one by one for comparison
+  Config *expected = ConfigCopy::copy(sources.first())->as<Config>();
+  ErrorStack err;
+  for (int i=1; i<sources.size(); i++) {
+    if (! ConfigMerge::mergeInto(expected, sources.at(i), ConfigMergeVisitor::ItemStrategy::Override,
+                                 ConfigMergeVisitor::SetStrategy::Merge, err))
+      QFAIL(err.format().toLocal8Bit().constData());
+  }
+
+  Config *merged = sources.takeFirst();
+  if (! ConfigMerge::mergeAllInto(merged, sources, ConfigMergeVisitor::ItemStrategy::Override,
+                                  ConfigMergeVisitor::SetStrategy::Merge, err))
+    QFAIL(err.format().toLocal8Bit().constData());
+
+  QCOMPARE(merged->channelList()->count(), 4);
+  QCOMPARE(merged->channelList()->channel(0)->rxFrequency(), Frequency::fromMHz(146.0));
+  QCOMPARE(merged->zones()->count(), 1);
+  QCOMPARE(merged->zones()->zone(0)->A()->count(), expected->zones()->zone(0)->A()->count());
+  for (int i=0; i<merged->zones()->zone(0)->A()->count(); i++) {
+    Channel *ch = merged->zones()->zone(0)->A()->get(i)->as<Channel>();
+    QVERIFY(0 <= merged->channelList()->indexOf(ch));
+    QCOMPARE(ch->name(), expected->zones()->zone(0)->A()->get(i)->name());
+  }
+
+  delete merged;
+  delete expected;
+  qDeleteAll(sources);
+}
+
+
 QTEST_GUILESS_MAIN(MergeTest)
+
+
+// Merges n channels into a config holding n channels, half of them with the same name.
+static qint64
+mergeChannels(int n) {
+  Config *base = new Config(), *merging = new Config();
+  for (int i=0; i<n; i++) {
+    FMChannel *ch = new FMChannel();
+    ch->setName(QString("Channel %1").arg(i));
+    base->channelList()->add(ch);
+    ch = new FMChannel();
+    ch->setName(QString("Channel %1").arg(i+n/2));
+    merging->channelList()->add(ch);
+  }
+
+  QElapsedTimer timer; timer.start();
+  ErrorStack err;
+  Config *merged = ConfigMerge::merge(base, merging,
+                                      ConfigMergeVisitor::ItemStrategy::Ignore,
+                                      ConfigMergeVisitor::SetStrategy::Ignore, err);
+  qint64 elapsed = timer.elapsed();
+
+  int count = merged ? merged->channelList()->count() : -1;
+  delete base; delete merging;
+  if (merged)
+    delete merged;
+  return (count == (n+n/2)) ? elapsed : -1;
+}
+
+void
+MergeTest::testMergeScaling() {
+  qint64 small = mergeChannels(500), large = mergeChannels(4000);
+  QVERIFY(0 <= small);
+  QVERIFY(0 <= large);
+  // 8 times the size must not take 64 times as long (quadratic), allow for some jitter.
+  QVERIFY(large < 32*std::max(small, qint64(10)));
+}
@@ -16,6 +16,9 @@ private slots:
   void testMergeGroupLists();
   void testMergeChannels();
   void testMergeZones();
+  void testMergeAll();
+
+  void testMergeScaling();
 };
 
 #endif // MERGETEST_HH
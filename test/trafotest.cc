@@ -15,10 +15,13 @@ TrafoTest::testZoneSplitVisitor() {
   if (nullptr == copy)
     QFAIL(err.format().toLocal8Bit().constData());
 
+  QVERIFY(ZoneSplitVisitor::isRequired(copy));
+
   ZoneSplitVisitor splitter;
   if (! splitter.process(copy, err))
     QFAIL(err.format().toLocal8Bit().constData());
 
+  QVERIFY(! ZoneSplitVisitor::isRequired(copy));
   QCOMPARE(copy->zones()->count(), 2);
   QVERIFY(copy->zones()->get(0)->name().endsWith(" A"));
   QVERIFY(copy->zones()->get(1)->name().endsWith(" B"));
@@ -47,6 +50,59 @@ TrafoTest::testZoneMergeVisitor() {
   QCOMPARE(_basicConfig.compare(*copy), 0);
 }
 
+void
+TrafoTest::testZoneSplitOrder() {
+  Config config;
+  for (int i=0; i<3; i++) {
+    FMChannel *ch = new FMChannel();
+    ch->setName(QString("Channel %1").arg(i));
+    config.channelList()->add(ch);
+  }
+  Channel *ch0 = config.channelList()->channel(0), *ch1 = config.channelList()->channel(1),
+      *ch2 = config.channelList()->channel(2);
+  Zone *zone = new Zone("Zone 0");
+  zone->A()->add(ch0); zone->B()->add(ch1);
+  config.zones()->add(zone);
+  zone = new Zone("Zone 1");
+  zone->A()->add(ch2);
+  config.zones()->add(zone);
+  zone = new Zone("Zone 2");
+  zone->A()->add(ch0); zone->B()->add(ch1); zone->B()->add(ch2);
+  config.zones()->add(zone);
+
+  ErrorStack err;
+  ZoneSplitVisitor splitter;
+  if (! splitter.process(&config, err))
+    QFAIL(err.format().toLocal8Bit().constData());
+
+  // Split zones are followed by their B zones, order of the B lists is kept
+  QCOMPARE(config.zones()->count(), 5);
+  QCOMPARE(config.zones()->get(0)->name(), QString("Zone 0 A"));
+  QCOMPARE(config.zones()->get(1)->name(), QString("Zone 0 B"));
+  QCOMPARE(config.zones()->get(2)->name(), QString("Zone 1"));
+  QCOMPARE(config.zones()->get(3)->name(), QString("Zone 2 A"));
+  QCOMPARE(config.zones()->get(4)->name(), QString("Zone 2 B"));
+  QCOMPARE(config.zones()->indexOf(config.zones()->get(4)), 4);
+  Zone *zone2B = config.zones()->get(4)->as<Zone>();
+  QCOMPARE(zone2B->A()->count(), 2);
+  QVERIFY(zone2B->A()->get(0) == ch1);
+  QVERIFY(zone2B->A()->get(1) == ch2);
+  QCOMPARE(config.zones()->get(3)->as<Zone>()->B()->count(), 0);
+
+  ZoneMergeVisitor merger;
+  if (! merger.process(&config, err))
+    QFAIL(err.format().toLocal8Bit().constData());
+
+  QCOMPARE(config.zones()->count(), 3);
+  QCOMPARE(config.zones()->get(2)->name(), QString("Zone 2"));
+  QCOMPARE(config.zones()->indexOf(config.zones()->get(2)), 2);
+  Zone *zone2 = config.zones()->get(2)->as<Zone>();
+  QCOMPARE(zone2->A()->count(), 1);
+  QCOMPARE(zone2->B()->count(), 2);
+  QVERIFY(zone2->B()->get(1) == ch2);
+  QCOMPARE(config.zones()->get(1)->as<Zone>()->B()->count(), 0);
+}
+
 
 void
 TrafoTest::testListElementRemoval() {
@@ -82,4 +138,24 @@ TrafoTest::testPropertyRemoval() {
   QCOMPARE(config.settings()->anytoneExtension(), nullptr);
 }
 
+void
+TrafoTest::testTypePruning() {
+  // Channels hold extensions but no lists
+  QVERIFY(! ConfigItem::mayContain(&DMRChannel::staticMetaObject, "ZoneList"));
+  QVERIFY(! ConfigItem::mayContain(&DMRChannel::staticMetaObject, "GPSSystem"));
+  QVERIFY(ConfigItem::mayContain(&DMRChannel::staticMetaObject, "AnytoneDMRChannelExtension"));
+  QVERIFY(ConfigItem::mayContain(&Config::staticMetaObject, "ZoneList"));
+
+  // Pruning must not change the result
+  ErrorStack err;
+  Config *copy = ConfigCopy::copy(&_basicConfig, err)->as<Config>();
+  if (nullptr == copy)
+    QFAIL(err.format().toLocal8Bit().constData());
+  QSet<ConfigItem *> items;
+  copy->findItemsOfTypes({"DMRChannel"}, items);
+  QCOMPARE(items.count(), copy->channelList()->count());
+
+  delete copy;
+}
+
 QTEST_GUILESS_MAIN(TrafoTest)
@@ -13,8 +13,10 @@ public:
 private slots:
   void testZoneSplitVisitor();
   void testZoneMergeVisitor();
+  void testZoneSplitOrder();
   void testListElementRemoval();
   void testPropertyRemoval();
+  void testTypePruning();
 };
 
 #endif // TRAFOTEST_HH
@@ -1,10 +1,48 @@
 #include "utilstest.hh"
 
 #include <QTest>
+#include <QTemporaryFile>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <type_traits>
 #include "utils.hh"
 #include "frequency.hh"
+#include "interval.hh"
 #include "chirpformat.hh"
 #include "config.hh"
+#include "codeplug.hh"
+#include "userdatabase.hh"
+#include "csvreader.hh"
+#include "mappedfile.hh"
+#include "tracer.hh"
+#include "logger.hh"
+#include "errorstack.hh"
+#include "codeplugprefetch.hh"
+#include "zone.hh"
+#include "virtualdevice.hh"
+#include "sessionrecorder.hh"
+#include "progressreporter.hh"
+#include "radiolimits.hh"
+#include "encodecache.hh"
+#include "callsigndb.hh"
+#include "encodeprogress.hh"
+#include "d868uv_callsigndb.hh"
+#include "radioinfo.hh"
+#include "channel.hh"
+#include "enumtable.hh"
+#include "stringpool.hh"
+#include "taskscheduler.hh"
+#include "cancellation.hh"
+#include "downloadvalidators.hh"
+#include "imagearchive.hh"
+#include "filesignature.hh"
+#include "performancehistory.hh"
+#include <QNetworkRequest>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
 
 
 UtilsTest::UtilsTest(QObject *parent)
@@ -41,6 +79,29 @@ UtilsTest::testEncodeASCII() {
   QCOMPARE(bufferTest, bufferTrue);
 }
 
+void
+UtilsTest::testPackASCII() {
+  QByteArray buffer(16, 0xff);
+  uint8_t *ptr = (uint8_t *)buffer.data();
+  size_t n = pack_ascii(ptr, "abcdef", 4);
+  QCOMPARE(n, size_t(4));
+  ptr[n++] = 0x00;
+  n += pack_ascii(ptr+n, QString::fromUtf8("x\u00e4\u20acy"), 16);
+  QCOMPARE(n, size_t(9));
+  // Latin-1 chars are kept, others are replaced by 0
+  QCOMPARE(buffer, QByteArray("abcd\x00x\xe4\x00y\xff\xff\xff\xff\xff\xff\xff", 16));
+}
+
+void
+UtilsTest::testEncodeUTF8() {
+  QByteArray buffer(8, 0x00);
+  encode_utf8((uint8_t *)buffer.data(), "abc", 8, 0xff);
+  QCOMPARE(buffer, QByteArray("abc\xff\xff\xff\xff\xff", 8));
+  encode_utf8((uint8_t *)buffer.data(), QString::fromUtf8("a\u00e4b"), 8, 0x00);
+  QCOMPARE(buffer, QByteArray("a\xc3\xa4" "b\x00\x00\x00\x00", 8));
+  QCOMPARE(decode_utf8((const uint8_t *)buffer.constData(), 4), QString::fromUtf8("a\u00e4b"));
+}
+
 void
 UtilsTest::testDecodeASCII() {
   const char *testString = "abc\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff";
@@ -80,6 +141,61 @@ UtilsTest::testEncodeDMRID_bcd() {
   QCOMPARE(res, QByteArray(bcd, 4));
 }
 
+/** Reference implementation of the per-digit BCD encoding. */
+static uint32_t
+reference_encode_bcd8(uint32_t val) {
+  uint32_t bcd = 0;
+  for (int i=0; i<8; i++, val /= 10)
+    bcd |= (val % 10) << (4*i);
+  return bcd;
+}
+
+/** Reference implementation of the per-digit BCD decoding. */
+static uint32_t
+reference_decode_bcd8(uint32_t bcd) {
+  uint32_t val = 0;
+  for (int i=7; i>=0; i--)
+    val = val*10 + ((bcd >> (4*i)) & 0xf);
+  return val;
+}
+
+void
+UtilsTest::testBCD8() {
+  // Check all valid values
+  for (uint32_t i=0; i<100000000; i++) {
+    uint32_t bcd = reference_encode_bcd8(i);
+    if (encode_bcd8(i) != bcd)
+      QFAIL(QString("Cannot encode %1: got %2, expected %3.").arg(i)
+            .arg(encode_bcd8(i), 0, 16).arg(bcd, 0, 16).toStdString().c_str());
+    if (decode_bcd8(bcd) != i)
+      QFAIL(QString("Cannot decode %1: got %2.").arg(bcd, 0, 16)
+            .arg(decode_bcd8(bcd)).toStdString().c_str());
+  }
+
+  // Values exceeding 8 digits get truncated, invalid digits are weighted like valid ones
+  QCOMPARE(encode_bcd8(123456789U), 0x23456789U);
+  QCOMPARE(encode_bcd8(0xffffffffU), reference_encode_bcd8(0xffffffffU));
+  QCOMPARE(decode_bcd8(0xffffffffU), reference_decode_bcd8(0xffffffffU));
+  QCOMPARE(decode_bcd8(0x0000000aU), 10U);
+
+  // Check batch variants
+  QVector<uint32_t> values, bcd(1000), decoded(1000);
+  for (uint32_t i=0; i<1000; i++)
+    values.append(i*99991);
+  encode_bcd8(bcd.data(), values.constData(), values.size());
+  decode_bcd8(decoded.data(), bcd.constData(), bcd.size());
+  for (int i=0; i<values.size(); i++)
+    QCOMPARE(bcd[i], reference_encode_bcd8(values[i]));
+  QCOMPARE(decoded, values);
+
+  // Check DMR ID and frequency conversions
+  uint8_t id[4];
+  encode_dmr_id_bcd_le(id, 2621370);
+  QCOMPARE(id[0], uint8_t(0x70)); QCOMPARE(id[3], uint8_t(0x02));
+  QCOMPARE(decode_dmr_id_bcd_le(id), 2621370U);
+  QCOMPARE(decode_frequency(0x43912500), 439.125);
+}
+
 void
 UtilsTest::testFrequencyParser() {
   QCOMPARE(Frequency::fromString("100Hz").inHz(), 100ULL);
@@ -93,6 +209,1236 @@ UtilsTest::testFrequencyParser() {
 
   QCOMPARE(Frequency::fromString("100").inHz(), 100000000ULL);
   QCOMPARE(Frequency::fromString("100.0").inHz(), 100000000ULL);
+  QCOMPARE(Frequency::fromString(" 439.5625 MHz ").inHz(), 439562500ULL);
+  QCOMPARE(Frequency::fromString("12.5kHz").inHz(), 12500ULL);
+  QCOMPARE(Frequency::fromString("1.0000005").inHz(), 1000001ULL);
+
+  Frequency f;
+  QVERIFY(f.parse(std::string("145.6 MHz")));
+  QCOMPARE(f.inHz(), 145600000ULL);
+  QVERIFY(! f.parse(QString("145.6 MHz foo")));
+  QVERIFY(! f.parse(QString("145.6 M")));
+  QVERIFY(! f.parse(QString("")));
+
+  Interval i;
+  QVERIFY(i.parse(QString("10 min")));
+  QCOMPARE(i.milliseconds(), 600000ULL);
+  QVERIFY(i.parse(std::string("30s")));
+  QCOMPARE(i.milliseconds(), 30000ULL);
+  QVERIFY(i.parse(QString("250 ms")));
+  QCOMPARE(i.milliseconds(), 250ULL);
+  QVERIFY(i.parse(QString("42")));
+  QCOMPARE(i.milliseconds(), 42ULL);
+  QVERIFY(! i.parse(QString("10 h")));
+}
+
+void
+UtilsTest::testFrequencyFormat() {
+  QCOMPARE(Frequency::fromHz(0).format(), QString("0 Hz"));
+  QCOMPARE(Frequency::fromHz(9999).format(), QString("9999 Hz"));
+  QCOMPARE(Frequency::fromHz(12500).format(), QString("12.5 kHz"));
+  QCOMPARE(Frequency::fromHz(1234567).format(), QString("1234.57 kHz"));
+  QCOMPARE(Frequency::fromHz(9999999).format(), QString("10000 kHz"));
+  QCOMPARE(Frequency::fromHz(439562500).format(), QString("439.5625 MHz"));
+  QCOMPARE(Frequency::fromHz(145600000).format(), QString("145.6 MHz"));
+  QCOMPARE(Frequency::fromHz(1234567891).format(), QString("1234.56789 MHz"));
+  QCOMPARE(Frequency::fromHz(123456789012ULL).format(), QString("123.456789012 GHz"));
+  QCOMPARE(Frequency::fromHz(145600000).format(Frequency::Format::kHz), QString("145600 kHz"));
+  QCOMPARE(Frequency::fromHz(446006250).format(Frequency::Format::MHz), QString("446.00625 MHz"));
+
+  QCOMPARE(Frequency::fromHz(439562500).toStdString(), std::string("439.5625 MHz"));
+  Frequency f;
+  QVERIFY(f.parse(Frequency::fromHz(446006250).toStdString()));
+  QCOMPARE(f.inHz(), 446006250ULL);
+}
+
+void
+UtilsTest::testLevDist() {
+  QCOMPARE(levDist("kitten", "sitting"), 3);
+  QCOMPARE(levDist("Digipeater", "digipeater"), 0);
+  QCOMPARE(levDist("", "abc"), 3);
+  // Bounded distance stops early
+  QCOMPARE(levDist("kitten", "sitting", 3), 3);
+  QCOMPARE(levDist("kitten", "sitting", 2), 3);
+  QCOMPARE(levDist("a", "abcdef", 1), 2);
+
+  // Exact, case-insensitive and misspelled icon names
+  QCOMPARE(name2aprsicon("Digipeater"), APRSSystem::Icon::Digipeater);
+  QCOMPARE(name2aprsicon("police STATION"), APRSSystem::Icon::PoliceStation);
+  QCOMPARE(name2aprsicon("Digipeatr"), APRSSystem::Icon::Digipeater);
+  QCOMPARE(name2aprsicon("Digipeatr"), APRSSystem::Icon::Digipeater);
+  QCOMPARE(name2aprsicon(""), APRSSystem::Icon::None);
+}
+
+void
+UtilsTest::testIsUniform() {
+  QByteArray block(1027, '\xff');
+  const uint8_t *data = (const uint8_t *)block.constData();
+  QVERIFY(is_uniform(data, block.size(), 0xff));
+  QVERIFY(is_uniform(data+1, block.size()-1, 0xff));
+  QVERIFY(! is_uniform(data, block.size(), 0x00));
+  QVERIFY(is_uniform(data, 0, 0x00));
+
+  // Check head, bulk and tail
+  block[0] = 0x00;
+  QVERIFY(! is_uniform(data, block.size(), 0xff));
+  QVERIFY(is_uniform(data+1, block.size()-1, 0xff));
+  block[0] = 0xff; block[512] = 0xfe;
+  QVERIFY(! is_uniform(data, block.size(), 0xff));
+  block[512] = 0xff; block[1026] = 0x00;
+  QVERIFY(! is_uniform(data, block.size(), 0xff));
+  QVERIFY(is_uniform(data, block.size()-1, 0xff));
+}
+
+/** Trivial element to access the field accessors. */
+class TestElement: public Codeplug::Element
+{
+public:
+  TestElement(uint8_t *ptr, size_t size) : Codeplug::Element(ptr, size) { }
+};
+
+void
+UtilsTest::testElementFields() {
+  typedef Codeplug::Element::FieldEncoding Encoding;
+  typedef Codeplug::Element::Field<0x00, 0, 32, Encoding::BCD_be> Freq;
+  typedef Codeplug::Element::Field<0x04, 0, 16, Encoding::UInt_le> Index;
+  typedef Codeplug::Element::Field<0x06, 0, 24, Encoding::UInt_be> Id;
+  typedef Codeplug::Element::Field<0x09, 2, 3> Mode;
+  typedef Codeplug::Element::Field<0x09, 5, 1> Flag;
+  typedef Codeplug::Element::Field<0x0a, 0, 16, Encoding::BCD_le> Tone;
+  typedef Codeplug::Element::Field<0x0b, 0, 32, Encoding::UInt_le> Overflow;
+
+  QByteArray buffer(12, 0x00);
+  TestElement el((uint8_t *)buffer.data(), buffer.size());
+
+  el.setField<Freq>(43912500);
+  QCOMPARE(el.getBCD8_be(0x00), 43912500U);
+  el.setField<Index>(0x1234);
+  QCOMPARE(el.getUInt16_le(0x04), uint16_t(0x1234));
+  el.setField<Id>(0x123456);
+  QCOMPARE(el.getUInt24_be(0x06), 0x123456U);
+  el.setField<Mode>(5); el.setField<Flag>(1);
+  QCOMPARE(el.getUInt3(0x09, 2), uint8_t(5));
+  QVERIFY(el.getBit(0x09, 5));
+  el.setField<Tone>(885);
+  QCOMPARE(el.getBCD4_le(0x0a), uint16_t(885));
+
+  // Check bulk access
+  unsigned int freq, index, mode, flag;
+  el.getFields<Freq, Index, Mode, Flag>(freq, index, mode, flag);
+  QCOMPARE(freq, 43912500U);
+  QCOMPARE(index, 0x1234U);
+  QCOMPARE(mode, 5U);
+  QCOMPARE(flag, 1U);
+  el.setFields<Mode, Flag>(2, false);
+  QCOMPARE(el.getField<Mode>(), 2U);
+  QCOMPARE(el.getField<Flag>(), 0U);
+  QCOMPARE(el.getField<Freq>(), 43912500U);
+
+  // Out of bounds access is ignored
+  el.setField<Overflow>(0xffffffff);
+  QCOMPARE(el.getField<Overflow>(), 0U);
+}
+
+void
+UtilsTest::testElementView() {
+  typedef Codeplug::Element::FieldEncoding Encoding;
+  typedef Codeplug::Element::Field<0x00, 0, 32, Encoding::BCD_be> Freq;
+  typedef Codeplug::Element::Field<0x04, 0, 16, Encoding::UInt_le> Index;
+  typedef Codeplug::Element::Field<0x06, 2, 3> Mode;
+  typedef Codeplug::ElementView<8> View;
+  static_assert(std::is_trivially_copyable<View>::value, "Views must be trivially copyable.");
+  static_assert(sizeof(View) == sizeof(uint8_t *), "Views must only hold the pointer.");
+
+  // Views encode fields exactly like elements
+  QByteArray buffer(16, 0x00);
+  TestElement el((uint8_t *)buffer.data(), 8);
+  el.setField<Freq>(43912500); el.setField<Index>(0x1234); el.setField<Mode>(5);
+
+  for (int i=0; i<2; i++) {
+    View view((uint8_t *)buffer.data() + i*View::size());
+    QVERIFY(view.isValid());
+    if (1 == i) {
+      view.setField<Freq>(43912500); view.setField<Index>(0x1234); view.setField<Mode>(5);
+    }
+    QCOMPARE(view.getField<Freq>(), 43912500U);
+    QCOMPARE(view.getField<Index>(), 0x1234U);
+    QCOMPARE(view.getField<Mode>(), 5U);
+  }
+  QCOMPARE(buffer.mid(0, 8), buffer.mid(8, 8));
+
+  View((uint8_t *)buffer.data()).fill(0xff);
+  QCOMPARE(buffer.mid(0, 8), QByteArray(8, char(0xff)));
+}
+
+void
+UtilsTest::testUserDistance() {
+  UserDatabase::User user; user.id = 2621370;
+  QCOMPARE(user.distance(2621370), 0U);
+  QCOMPARE(user.distance(262), 1370U);
+  QCOMPARE(user.distance(2622), 630U);
+  // Exact powers of 10 have one more digit
+  user.id = 100;
+  QCOMPARE(user.distance(12), 20U);
+  QCOMPARE(user.distance(10), 0U);
+
+  // Batch API must match the per-user distance
+  unsigned ids[] = {2621370, 2620001, 3100000, 100, 9, 16777215};
+  QVector<unsigned> refs = {262, 31};
+  unsigned dist[6];
+  UserDatabase::distances(dist, ids, 6, refs);
+  for (int i=0; i<6; i++) {
+    user.id = ids[i];
+    QCOMPARE(dist[i], std::min(user.distance(262), user.distance(31)));
+  }
+}
+
+void
+UtilsTest::testUserIndex() {
+  QTemporaryFile file(QDir::tempPath() + "/userdbXXXXXX.json");
+  QVERIFY(file.open());
+  file.write("{\"users\": ["
+             "{\"id\": 2621370, \"callsign\": \"DM3MAT\"},"
+             "{\"id\": 262137, \"callsign\": \"DL1ABC\"},"
+             "{\"id\": 3100001, \"callsign\": \"W1ABC\"},"
+             "{\"id\": 2621001, \"callsign\": \"DL2XYZ\"}]}");
+  file.close();
+
+  UserDatabase db(file.fileName());
+  QFile::remove(QFileInfo(file.fileName()).absoluteDir().filePath(
+                  QFileInfo(file.fileName()).completeBaseName() + ".cache"));
+  QCOMPARE(db.count(), qint64(4));
+
+  QVERIFY(db.findUser(2621370) >= 0);
+  QCOMPARE(db.user(db.findUser(2621370)).call, QString("DM3MAT"));
+  QCOMPARE(db.findUser(1234567), -1);
+  QCOMPARE(db.user(db.findCallsign("dl2xyz")).id, 2621001U);
+  QCOMPARE(db.findCallsign("N0CALL"), -1);
+
+  QVector<int> prefix = db.usersWithPrefix(2621);
+  QCOMPARE(prefix.size(), 3);
+  QCOMPARE(db.user(prefix[0]).id, 262137U);
+  QCOMPARE(db.user(prefix[1]).id, 2621001U);
+  QCOMPARE(db.user(prefix[2]).id, 2621370U);
+
+  // Index must follow reordering
+  db.sortUsers(3100000);
+  QCOMPARE(db.user(db.findUser(3100001)).call, QString("W1ABC"));
+  QCOMPARE(db.user(0).id, 3100001U);
+}
+
+void
+UtilsTest::testCSVLexer() {
+  QString text = "Channel 1 \"DB0ABC\" 439.5625 -7.6 n023 i754 DB0ABC-10 n12 : - + , # comment\n"
+                 "\"open";
+  QTextStream stream(&text);
+  CSVLexer lexer(stream);
+
+  QVector<QPair<CSVLexer::Token::TokenType, QString>> expected = {
+    {CSVLexer::Token::T_KEYWORD, "Channel"}, {CSVLexer::Token::T_NUMBER, "1"},
+    {CSVLexer::Token::T_STRING, "DB0ABC"}, {CSVLexer::Token::T_NUMBER, "439.5625"},
+    {CSVLexer::Token::T_NUMBER, "-7.6"}, {CSVLexer::Token::T_DCS_N, "023"},
+    {CSVLexer::Token::T_DCS_I, "754"}, {CSVLexer::Token::T_APRSCALL, "DB0ABC-10"},
+    {CSVLexer::Token::T_KEYWORD, "n12"}, {CSVLexer::Token::T_COLON, ":"},
+    {CSVLexer::Token::T_NOT_SET, "-"}, {CSVLexer::Token::T_ENABLED, "+"},
+    {CSVLexer::Token::T_COMMA, ","}, {CSVLexer::Token::T_NEWLINE, ""}
+  };
+  foreach (auto exp, expected) {
+    CSVLexer::Token token = lexer.next();
+    QCOMPARE(token.type, exp.first);
+    QCOMPARE(token.value, exp.second);
+  }
+
+  // Unterminated strings are errors
+  QCOMPARE(lexer.next().type, CSVLexer::Token::T_ERROR);
+
+  // Calls with more than 6 characters are keywords followed by a number
+  CSVLexer::Token::TokenType type; int start, length, matched;
+  QVERIFY(CSVLexer::scan(QStringView(u"ABCDEFG-1"), type, start, length, matched));
+  QCOMPARE(type, CSVLexer::Token::T_KEYWORD);
+  QCOMPARE(matched, 7);
+}
+
+void
+UtilsTest::testMappedFile() {
+  QTemporaryFile tmp;
+  QVERIFY(tmp.open());
+  tmp.write("0123456789");
+  tmp.close();
+
+  MappedFile file;
+  QVERIFY(file.open(tmp.fileName()));
+  QCOMPARE(file.size(), size_t(10));
+  QCOMPARE(file.data()[3], uint8_t('3'));
+
+  char buffer[4];
+  QVERIFY(file.copy(6, buffer, 4));
+  QCOMPARE(QByteArray(buffer, 4), QByteArray("6789"));
+  // Ranges exceeding the file are rejected
+  QVERIFY(! file.copy(7, buffer, 4));
+
+  file.close();
+  QVERIFY(! file.isOpen());
+  QVERIFY(! file.open(tmp.fileName() + ".missing"));
+}
+
+void
+UtilsTest::testTracer() {
+  QTemporaryFile tmp;
+  QVERIFY(tmp.open());
+  tmp.close();
+
+  // Spans outside of a trace are ignored
+  { Tracer::Span span("ignored", "test"); }
+
+  QVERIFY(Tracer::start(tmp.fileName()));
+  QVERIFY(Tracer::isEnabled());
+  // Only a single trace at a time
+  QVERIFY(! Tracer::start(tmp.fileName()));
+  { Tracer::Span span("outer", "test"); Tracer::Span inner("inner", "test"); }
+  QVERIFY(Tracer::stop());
+  QVERIFY(! Tracer::isEnabled());
+
+  QFile file(tmp.fileName());
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  QJsonParseError error;
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+  QCOMPARE(error.error, QJsonParseError::NoError);
+
+  QStringList names;
+  foreach (const QJsonValue &event, doc.object().value("traceEvents").toArray()) {
+    if ("X" == event.toObject().value("ph").toString())
+      names.append(event.toObject().value("name").toString());
+  }
+  // Spans are recorded once they end
+  QCOMPARE(names, QStringList({"inner", "outer"}));
+}
+
+void
+UtilsTest::testLogLevelFilter() {
+  QString text;
+  QTextStream stream(&text);
+  StreamLogHandler *handler = new StreamLogHandler(stream, LogMessage::WARNING);
+  Logger::get().addHandler(handler);
+
+  // Messages below the minimum level of all handlers are not even constructed
+  int evaluated = 0;
+  logDebug() << (++evaluated);
+  QCOMPARE(evaluated, 0);
+  QVERIFY(! Logger::isEnabled(LogMessage::INFO));
+  logWarn() << (++evaluated);
+  QCOMPARE(evaluated, 1);
+
+  handler->setMinLevel(LogMessage::DEBUG);
+  QVERIFY(Logger::isEnabled(LogMessage::DEBUG));
+  logDebug() << "visible";
+  QVERIFY(text.contains("visible"));
+
+  Logger::get().remHandler(handler);
+  delete handler;
+  QVERIFY(! Logger::isEnabled(LogMessage::FATAL));
+}
+
+void
+UtilsTest::testAsyncFileLog() {
+  QTemporaryFile tmp;
+  QVERIFY(tmp.open());
+  tmp.close();
+
+  AsyncFileLogHandler *handler = new AsyncFileLogHandler(tmp.fileName(), LogMessage::INFO, 4);
+  Logger::get().addHandler(handler);
+  logDebug() << "debug message";
+  for (int i=0; i<100; i++)
+    logWarn() << "message " << i;
+  // Destruction writes all pending messages
+  Logger::get().remHandler(handler);
+  delete handler;
+
+  QFile file(tmp.fileName());
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  QString content = QString::fromUtf8(file.readAll());
+  QVERIFY(! content.contains("debug message"));
+  // Warnings are never dropped
+  QVERIFY(content.contains("message 0\n"));
+  QVERIFY(content.contains("message 99\n"));
+}
+
+void
+UtilsTest::testErrorStack() {
+  ErrorStack err;
+  QVERIFY(err.isEmpty());
+  QCOMPARE(err.count(), 0U);
+  QVERIFY(err.format().isEmpty());
+
+  // Copies share the same stack, even if created before the first message
+  ErrorStack copy(err);
+  errMsg(copy) << "inner";
+  errMsg(err) << "outer";
+  QCOMPARE(err.count(), 2U);
+  QCOMPARE(err.message(0).message(), QString("outer"));
+  QCOMPARE(copy.message(1).message(), QString("inner"));
+
+  ErrorStack other;
+  other.take(err);
+  QVERIFY(err.isEmpty());
+  QCOMPARE(other.count(), 2U);
+  QCOMPARE(other.message(0).message(), QString("outer"));
+}
+
+void
+UtilsTest::testCodeplugPrefetch() {
+  CodeplugPrefetch prefetch;
+  prefetch.reset(4);
+  CodeplugPrefetch::Factory factory = [](unsigned int idx, Codeplug::Context &ctx) -> ConfigItem * {
+    Q_UNUSED(ctx);
+    if (2 == idx)
+      return nullptr;
+    Zone *zone = new Zone();
+    zone->setName(QString("Zone %1").arg(idx));
+    return zone;
+  };
+  prefetch.schedule(0, 2, factory);
+  // Indices scheduled before are skipped, indices out of range are ignored
+  prefetch.schedule(1, 8, factory);
+  prefetch.wait();
+
+  QVERIFY(prefetch.has(0));
+  QVERIFY(prefetch.has(3));
+  QVERIFY(! prefetch.has(4));
+  // Index without element
+  QVERIFY(prefetch.has(2));
+  QVERIFY(nullptr == prefetch.take(2));
+
+  ConfigItem *obj = prefetch.take(3);
+  QVERIFY(nullptr != obj);
+  QCOMPARE(obj->thread(), QThread::currentThread());
+  QCOMPARE(obj->as<Zone>()->name(), QString("Zone 3"));
+  delete obj;
+  // Remaining objects get deleted
+  prefetch.reset();
+  QVERIFY(! prefetch.has(0));
+}
+
+void
+UtilsTest::testVirtualDevice() {
+  ErrorStack err;
+  // Invalid handles
+  QVERIFY(nullptr == VirtualDevice::create("virtual:unknown", err));
+  QVERIFY(nullptr == VirtualDevice::create("virtual:d878uv,errors=2", err));
+  QVERIFY(! VirtualDevice::Descriptor("virtual:unknown").isValid());
+  QVERIFY(VirtualDevice::Descriptor("virtual:d878uv,latency=1").isValid());
+
+  VirtualDevice *dev = VirtualDevice::create("virtual:d878uv,latency=1", err);
+  if (nullptr == dev)
+    QFAIL(err.format().toLocal8Bit().constData());
+
+  char resp[32];
+  dev->write("PROGRAM", 7);
+  QVERIFY(dev->waitForReadyRead(100));
+  QCOMPARE(dev->read(resp, sizeof(resp)), qint64(3));
+  QVERIFY(0 == memcmp(resp, "QX\x06", 3));
+
+  // Write a block, requests may be split
+  const char write[] = "W\x00\x80\x00\x00\x10" "0123456789abcdef" "\x00\x06";
+  QByteArray req(write, sizeof(write)-1);
+  uint8_t sum = 0;
+  for (int i=1; i<22; i++)
+    sum += uint8_t(req.at(i));
+  req[22] = char(sum);
+  dev->write(req.constData(), 10);
+  dev->write(req.constData()+10, req.size()-10);
+  QVERIFY(dev->waitForReadyRead(100));
+  QCOMPARE(dev->read(resp, 1), qint64(1));
+  QCOMPARE(resp[0], '\x06');
+
+  // Read it back
+  dev->write("R\x00\x80\x00\x00\x10", 6);
+  QVERIFY(dev->waitForReadyRead(100));
+  QCOMPARE(dev->read(resp, 24), qint64(24));
+  QVERIFY(0 == memcmp(resp+6, "0123456789abcdef", 16));
+  QCOMPARE(resp[23], '\x06');
+
+  delete dev;
+}
+
+void
+UtilsTest::testSessionReplay() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  file.close();
+
+  // Record a session
+  SessionRecorder::setFilename(file.fileName());
+  SessionRecorder *recorder = SessionRecorder::create(VirtualDevice::Descriptor("virtual:d878uv"));
+  SessionRecorder::setFilename("");
+  QVERIFY(nullptr != recorder);
+  recorder->record(SessionRecorder::Direction::Request, "PROGRAM", 7);
+  recorder->record(SessionRecorder::Direction::Response, "QX", 2);
+  recorder->record(SessionRecorder::Direction::Response, "\x06", 1);
+  delete recorder;
+
+  ErrorStack err;
+  USBDeviceInfo info; QVector<SessionRecorder::Event> events;
+  if (! SessionRecorder::read(file.fileName(), info, events, err))
+    QFAIL(err.format().toLocal8Bit().constData());
+  QCOMPARE(info.interfaceClass(), USBDeviceInfo::Class::Virtual);
+  QCOMPARE(events.size(), 3);
+  QCOMPARE(events.at(0).data, QByteArray("PROGRAM"));
+  QVERIFY(events.at(0).time <= events.at(2).time);
+
+  // Replay it
+  VirtualDevice *dev = VirtualDevice::create(QString("virtual:d878uv,replay=%1").arg(file.fileName()), err);
+  if (nullptr == dev)
+    QFAIL(err.format().toLocal8Bit().constData());
+  char resp[8];
+  dev->write("PROGRAM", 7);
+  QVERIFY(dev->waitForReadyRead(100));
+  QCOMPARE(dev->read(resp, sizeof(resp)), qint64(3));
+  QVERIFY(0 == memcmp(resp, "QX\x06", 3));
+  delete dev;
+
+  // Replay as a different radio fails
+  QVERIFY(nullptr == VirtualDevice::create(QString("virtual:opengd77,replay=%1").arg(file.fileName()), err));
+}
+
+void
+UtilsTest::testProgressReporter() {
+  ProgressReporter reporter;
+  reporter.setInterval(1000);
+
+  // Start passes, repeated and early intermediate updates are dropped
+  QVERIFY(reporter.update(0));
+  QVERIFY(! reporter.update(0));
+  QVERIFY(! reporter.update(1));
+  QVERIFY(! reporter.update(50));
+  // Completion always passes, but only once
+  QVERIFY(reporter.update(100));
+  QVERIFY(! reporter.update(100));
+  // A new phase starts over
+  reporter.reset();
+  QVERIFY(reporter.update(50));
+  reporter.setInterval(0);
+  QVERIFY(reporter.update(51));
+
+  // Byte counter stays monotonic if the interface starts over
+  reporter.count(100);
+  reporter.count(300);
+  QCOMPARE(reporter.bytes(), quint64(300));
+  reporter.count(50);
+  QCOMPARE(reporter.bytes(), quint64(350));
+  reporter.count(50);
+  QCOMPARE(reporter.bytes(), quint64(350));
+}
+
+void
+UtilsTest::testCodeplugSections() {
+  ErrorStack err;
+  Codeplug::Sections sections;
+  QVERIFY(sections.isAll());
+
+  QVERIFY(Codeplug::Sections::parse("zones, Contacts", sections, err));
+  QVERIFY(sections.has(Codeplug::Sections::Zones));
+  QVERIFY(sections.has(Codeplug::Sections::Contacts));
+  QVERIFY(! sections.has(Codeplug::Sections::Channels));
+  QCOMPARE(sections.format(), QString("contacts,zones"));
+
+  // Zones refer to channels, these to contacts. Radio IDs are always included.
+  Codeplug::Sections resolved = sections.resolved();
+  QCOMPARE(resolved.format(), QString("radioids,contacts,channels,zones"));
+  // Settings refer to everything
+  QVERIFY(Codeplug::Sections(Codeplug::Sections::Settings).resolved().isAll());
+
+  QVERIFY(! Codeplug::Sections::parse("zones,foo", sections, err));
+  QVERIFY(! Codeplug::Sections::parse("", sections, err));
+}
+
+void
+UtilsTest::testSharedLimits() {
+  int created = 0;
+  RadioLimits::Factory factory = [&created]() -> RadioLimits * {
+    created++; return new RadioLimits(false);
+  };
+
+  // Limits are created once per key, even if requested from several threads
+  const RadioLimits *limits = nullptr;
+  QVector<QThread *> threads;
+  for (int i=0; i<4; i++)
+    threads.append(QThread::create([&factory]() { RadioLimits::shared("test:shared", factory); }));
+  foreach (QThread *thread, threads)
+    thread->start();
+  foreach (QThread *thread, threads) {
+    thread->wait();
+    delete thread;
+  }
+  limits = RadioLimits::shared("test:shared", factory);
+  QVERIFY(nullptr != limits);
+  QCOMPARE(created, 1);
+
+  QVERIFY(limits != RadioLimits::shared("test:other", factory));
+  QCOMPARE(created, 2);
+}
+
+void
+UtilsTest::testEncodeCache() {
+  Config a, b;
+  FMChannel *ch = new FMChannel(); ch->setName("Channel"); a.channelList()->add(ch);
+  ch = new FMChannel(); ch->setName("Channel"); b.channelList()->add(ch);
+
+  // Equal content gives equal hashes
+  QByteArray hash = EncodeCache::configHash(&a);
+  QCOMPARE(hash.size(), 32);
+  QCOMPARE(EncodeCache::configHash(&b), hash);
+  ch->setName("Other");
+  QVERIFY(EncodeCache::configHash(&b) != hash);
+
+  // Keys depend on radio and flags, but not on the number of threads
+  RadioInfo radio = RadioInfo::byKey("d878uv");
+  Codeplug::Flags flags, threaded, init;
+  threaded.encodeThreads = 4;
+  init.updateCodePlug = false;
+  QString key = EncodeCache::key(hash, radio, "D878UVCodeplug", flags);
+  QCOMPARE(EncodeCache::key(hash, radio, "D878UVCodeplug", threaded), key);
+  QVERIFY(EncodeCache::key(hash, radio, "D878UVCodeplug", init) != key);
+  QVERIFY(EncodeCache::key(hash, RadioInfo::byKey("d868uve"), "D868UVCodeplug", flags) != key);
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  EncodeCache cache(dir.path());
+  DFUFile image, loaded;
+  QVERIFY(! cache.load(key, loaded));
+  image.addImage("Codeplug");
+  image.image(0).addElement(0x1000, 0x20);
+  image.image(0).element(0).data().fill(0x55);
+  QVERIFY(cache.store(key, image));
+  QVERIFY(QFileInfo::exists(cache.filename(key)));
+
+  // Served from memory and from disk
+  QVERIFY(cache.load(key, loaded));
+  QCOMPARE(loaded.numImages(), 1);
+  QCOMPARE(loaded.image(0).element(0).address(), 0x1000U);
+  DFUFile fromDisk;
+  QVERIFY(fromDisk.read(cache.filename(key)));
+  QCOMPARE(fromDisk.image(0).element(0).data(), image.image(0).element(0).data());
+}
+
+void
+UtilsTest::testUniformElements() {
+  DFUFile file;
+  file.addImage("test");
+  file.image(0).addElement(0x0000, 0x100, -1, 0xff);
+  file.image(0).addElement(0x1000, 0x100);
+
+  // Untouched elements are uniform and not allocated
+  uint8_t fill = 0x00;
+  QVERIFY(file.image(0).isUniform(0x0010, 0x10, &fill));
+  QCOMPARE(fill, uint8_t(0xff));
+  QCOMPARE(file.image(0).element(0).memSize(), 0x100u);
+  QVERIFY(! file.image(0).isUniform(0x00f0, 0x20));
+
+  // Reading returns the fill bytes, writing allocates the element
+  const DFUFile &constFile = file;
+  QCOMPARE(constFile.data(0x1010)[0], uint8_t(0x00));
+  file.data(0x0010)[0] = 0x12;
+  QVERIFY(! file.image(0).isUniform(0x0010, 0x10));
+  QCOMPARE(file.image(0).element(0).data().at(0x11), char(0xff));
+
+  // Uniform elements are written as their fill bytes
+  QTemporaryFile tmp;
+  QVERIFY(tmp.open());
+  tmp.close();
+  DFUFile other;
+  other.addImage("test");
+  other.image(0).addElement(0x2000, 0x20000, -1, 0xaa);
+  QVERIFY(other.write(tmp.fileName()));
+  DFUFile readBack;
+  QVERIFY(readBack.read(tmp.fileName()));
+  QCOMPARE(readBack.image(0).element(0).data(), QByteArray(0x20000, char(0xaa)));
+}
+
+void
+UtilsTest::testPrepareOverwrite() {
+  DFUFile file;
+  file.addImage("test");
+  file.image(0).addElement(0x0000, 0x100, -1, 0xff);
+  file.image(0).addElement(0x1000, 0x100);
+  file.data(0x1000)[0] = 0x12;
+
+  // Only untouched elements are affected
+  file.prepareOverwrite();
+  QVERIFY(! file.image(0).isUniform(0x0000, 0x100));
+  QCOMPARE(file.image(0).element(0).memSize(), 0x100u);
+  QCOMPARE(file.data(0x1000)[0], uint8_t(0x12));
+
+  memset(file.data(0x0000), 0xab, 0x100);
+  QCOMPARE(file.image(0).element(0).data(), QByteArray(0x100, char(0xab)));
+}
+
+void
+UtilsTest::testDumpRange() {
+  DFUFile file;
+  file.addImage("test");
+  file.image(0).addElement(0x0000, 0x100, -1, 0xff);
+  file.image(0).addElement(0x1000, 0x40);
+  for (int i=0; i<0x40; i++)
+    file.data(0x1000)[i] = i;
+
+  // Only the lines of the second element within the range are dumped
+  QString text;
+  QTextStream stream(&text);
+  file.dump(stream, 0x1018, 0x10);
+  stream.flush();
+  QVERIFY(! text.contains("Element @ 0x0,"));
+  QVERIFY(text.contains("Element @ 0x1000, size=0x40\n"));
+  QVERIFY(text.contains("    1010  10 11 12 13 14 15 16 17  18 19 1a 1b 1c 1d 1e 1f  |................|\n"));
+  QVERIFY(text.contains("    1020  20 21 22 23 24 25 26 27  28 29 2a 2b 2c 2d 2e 2f  | !\"#$%&'()*+,-./|\n"));
+  QVERIFY(! text.contains("    1030"));
+
+  // Uniform elements are collapsed and not allocated
+  text.clear();
+  file.dump(stream, 0x0000, 0x100);
+  stream.flush();
+  QVERIFY(text.contains("       0  ff ff ff ff ff ff ff ff  ff ff ff ff ff ff ff ff  |................|\n       *\n"));
+  QVERIFY(file.image(0).isUniform(0x0000, 0x100));
+
+  // Summary lists CRCs and fill regions
+  text.clear();
+  file.summarize(stream);
+  stream.flush();
+  QVERIFY(text.contains("Element @ 0x0, size=0x100, crc32=0x"));
+  QVERIFY(text.contains("uniform 0xff\n"));
+  QVERIFY(! text.contains("fill"));
+  QVERIFY(file.image(0).isUniform(0x0000, 0x100));
+}
+
+void
+UtilsTest::testCallsignSelection() {
+  QTemporaryFile file(QDir::tempPath() + "/userdbXXXXXX.json");
+  QVERIFY(file.open());
+  file.write("{\"users\": ["
+             "{\"id\": 2621370, \"callsign\": \"DM3MAT\", \"country\": \"Germany\", \"state\": \"Berlin\"},"
+             "{\"id\": 2626001, \"callsign\": \"DL1ABC\", \"country\": \"Germany\", \"state\": \"Bayern\"},"
+             "{\"id\": 2321001, \"callsign\": \"OE1ABC\", \"country\": \"Austria\"},"
+             "{\"id\": 3100001, \"callsign\": \"W1ABC\", \"country\": \"United States\"},"
+             "{\"id\": 3100002, \"callsign\": \"W1XYZ\", \"country\": \"United States\"}]}");
+  file.close();
+
+  UserDatabase db(file.fileName());
+  QFile::remove(QFileInfo(file.fileName()).absoluteDir().filePath(
+                  QFileInfo(file.fileName()).completeBaseName() + ".cache"));
+  QCOMPARE(db.usersInCountry("germany").size(), 2);
+  QCOMPARE(db.usersInCountry("Germany", "Bayern").size(), 1);
+
+  // Without filter, the first users are selected
+  CallsignDB::Selection all(2);
+  QCOMPARE(all.select(&db, 5).size(), 2);
+
+  // Users of the selected countries and prefixes first, then the nearest users fill up
+  db.sortUsers(3100002);
+  CallsignDB::Selection selection(1);
+  selection.addCountry("Germany", "Bayern");
+  selection.addPrefix(232);
+  QVector<int> users = selection.select(&db, 5);
+  QCOMPARE(users.size(), 3);
+  QCOMPARE(db.user(users[0]).id, 2321001U);
+  QCOMPARE(db.user(users[1]).id, 2626001U);
+  QCOMPARE(db.user(users[2]).id, 3100002U);
+
+  // The capacity limits the selection
+  QCOMPARE(selection.select(&db, 1).size(), 1);
+}
+
+void
+UtilsTest::testCallsignSizeLimit() {
+  QTemporaryFile file(QDir::tempPath() + "/userdbXXXXXX.json");
+  QVERIFY(file.open());
+  file.write("{\"users\": ["
+             "{\"id\": 2621370, \"callsign\": \"DM3MAT\"},"
+             "{\"id\": 2621371, \"callsign\": \"DL1A\"},"
+             "{\"id\": 3100001, \"callsign\": \"W1ABC\"}]}");
+  file.close();
+
+  UserDatabase db(file.fileName());
+  QFile::remove(QFileInfo(file.fileName()).absoluteDir().filePath(
+                  QFileInfo(file.fileName()).completeBaseName() + ".cache"));
+  db.sortUsers(2621370);
+  auto size = [](const UserDatabase::User &user) { return unsigned(user.call.size()); };
+
+  // Users get taken in order of selection as long as they fit
+  CallsignDB::Selection selection;
+  QCOMPARE(selection.select(&db, 3, 9, size).size(), 1);
+  QCOMPARE(selection.select(&db, 3, 10, size).size(), 2);
+  QCOMPARE(selection.select(&db, 3, 15, size).size(), 3);
+  QCOMPARE(selection.select(&db, 3, -1, size).size(), 3);
+
+  // The size limit applies on top of the device memory
+  selection.setSizeLimit(12);
+  QVector<int> users = selection.select(&db, 3, 16, size);
+  QCOMPARE(users.size(), 2);
+  QCOMPARE(db.user(users[0]).id, 2621370U);
+  QCOMPARE(db.user(users[1]).id, 2621371U);
+}
+
+void
+UtilsTest::testCallsignBackgroundEncoding() {
+  QTemporaryFile file(QDir::tempPath() + "/userdbXXXXXX.json");
+  QVERIFY(file.open());
+  file.write("{\"users\": [");
+  for (int i=0; i<0x9000; i++)
+    file.write(QString("%1{\"id\": %2, \"callsign\": \"DL%3\", \"fname\": \"Name\"}")
+               .arg(i ? "," : "").arg(2620000+i).arg(i).toUtf8());
+  file.write("]}");
+  file.close();
+
+  UserDatabase db(file.fileName());
+  QFile::remove(QFileInfo(file.fileName()).absoluteDir().filePath(
+                  QFileInfo(file.fileName()).completeBaseName() + ".cache"));
+
+  // Encode at once
+  D868UVCallsignDB direct;
+  QVERIFY(direct.encode(&db));
+  direct.image(0).compact();
+
+  // Encode in the background and wait for every element like the upload does
+  D868UVCallsignDB background;
+  ErrorStack err;
+  QVERIFY2(background.startEncoding(&db, CallsignDB::Selection(), err), err.format().toLocal8Bit().constData());
+  QCOMPARE(background.image(0).numElements(), direct.image(0).numElements());
+  for (int i=0; i<background.image(0).numElements(); i++) {
+    const DFUFile::Element &el = background.image(0).element(i);
+    QVERIFY(background.waitEncoded(el.address(), el.memSize()));
+  }
+  QVERIFY(background.finishEncoding(err));
+
+  for (int i=0; i<direct.image(0).numElements(); i++) {
+    QCOMPARE(background.image(0).element(i).address(), direct.image(0).element(i).address());
+    QVERIFY(background.image(0).element(i).data() == direct.image(0).element(i).data());
+  }
+}
+
+void
+UtilsTest::testEncodeProgress() {
+  EncodeProgress progress;
+  // Nothing to wait for, if not started
+  QVERIFY(progress.isDone());
+  QVERIFY(progress.waitEncoded(0x1000, 0x10));
+
+  progress.start();
+  QVERIFY(! progress.isAllocated());
+  progress.setAllocated();
+  QVERIFY(progress.waitAllocated());
+
+  // Adjacent and overlapping ranges get merged
+  progress.setEncoded(0x1000, 0x100);
+  progress.setEncoded(0x1200, 0x100);
+  QVERIFY(progress.isEncoded(0x1000, 0x100));
+  QVERIFY(! progress.isEncoded(0x1000, 0x200));
+  progress.setEncoded(0x1100, 0x100);
+  QVERIFY(progress.isEncoded(0x1000, 0x300));
+  QVERIFY(! progress.isEncoded(0x0ff0, 0x20));
+  QVERIFY(! progress.isEncoded(0x1200, 0x110));
+  QCOMPARE(progress.generation(), 3U);
+
+  // Waiting threads get woken by the encoder
+  QThread *encoder = QThread::create([&progress]() {
+    progress.setEncoded(0x2000, 0x100);
+    progress.finish(false);
+  });
+  encoder->start();
+  QVERIFY(progress.waitProgress(3) >= 4U);
+  QVERIFY(! progress.waitDone());
+  encoder->wait();
+  delete encoder;
+  QVERIFY(progress.isEncoded(0x2000, 0x100));
+  QVERIFY(! progress.waitEncoded(0x3000, 0x10));
+}
+
+void
+UtilsTest::testEnumTable() {
+  const EnumTable &power = EnumTable::get<Channel::Power>();
+  QCOMPARE(&EnumTable::get(QMetaEnum::fromType<Channel::Power>()), &power);
+  QCOMPARE(power.keyCount(), 5);
+  QCOMPARE(power.key(0), "Max");
+
+  bool ok = false;
+  QCOMPARE(power.keyToValue("Low", &ok), (int)Channel::Power::Low);
+  QVERIFY(ok);
+  QCOMPARE(power.keyToValue(std::string("Max"), &ok), (int)Channel::Power::Max);
+  QVERIFY(ok);
+  power.keyToValue("Medium", &ok);
+  QVERIFY(! ok);
+  power.keyToValue("", &ok);
+  QVERIFY(! ok);
+
+  QCOMPARE(power.valueToKey((int)Channel::Power::Mid), "Mid");
+  QVERIFY(nullptr == power.valueToKey(42));
+  QCOMPARE(power.keys(), QStringList({"Max", "High", "Mid", "Low", "Min"}));
+}
+
+void
+UtilsTest::testMemoryUsage() {
+  // Nodes include the bytes of their children
+  MemoryUsage usage("Total", 10);
+  usage.add(MemoryUsage("A", 100, 2)).add(MemoryUsage("B", 1000));
+  QCOMPARE(usage.bytes(), quint64(1110));
+  QCOMPARE(usage.children().first().bytes(), quint64(1100));
+  QCOMPARE(MemoryUsage::formatBytes(1536), QString("1.5 KiB"));
+
+  // Config grows with its lists
+  Config config;
+  MemoryUsage empty = config.memoryUsage();
+  QVERIFY(empty.children().size() >= 10);
+  for (int i=0; i<100; i++) {
+    FMChannel *ch = new FMChannel(); ch->setName(QString("Channel %1").arg(i));
+    config.channelList()->add(ch);
+  }
+  MemoryUsage filled = config.memoryUsage();
+  QVERIFY(filled.bytes() > empty.bytes() + 100*sizeof(ConfigObject));
+  foreach (const MemoryUsage &list, filled.children()) {
+    if ("channels" == list.name())
+      QCOMPARE(list.count(), qint64(100));
+  }
+
+  // Uniform elements are not allocated
+  DFUFile file;
+  file.addImage("test");
+  file.image(0).addElement(0x0000, 0x100);
+  QCOMPARE(file.memoryUsage("file").children().first().bytes(), quint64(0));
+  file.image(0).data(0x0000)[0] = 0x01;
+  QVERIFY(file.memoryUsage("file").children().first().bytes() >= 0x100);
+}
+
+void
+UtilsTest::testStringPool() {
+  const uint8_t ascii[] = "Channel 1\0\0\0";
+  const uint16_t unicode[] = {'C','h','a','n','n','e','l',' ','1',0,0,0};
+
+  // Without a scope, every string is decoded separately
+  QVERIFY(decode_ascii(ascii, 12).constData() != decode_ascii(ascii, 12).constData());
+
+  {
+    StringPool::Scope strings;
+    QString a = decode_ascii(ascii, 12), b = decode_ascii(ascii, 12), c = decode_unicode(unicode, 12);
+    QCOMPARE(a, QString("Channel 1"));
+    QCOMPARE(c, a);
+    // Equal strings share their storage, regardless of the encoding
+    QCOMPARE(b.constData(), a.constData());
+    QCOMPARE(c.constData(), a.constData());
+    QVERIFY(decode_ascii(ascii, 7).constData() != a.constData());
+    QCOMPARE(StringPool::current()->count(), 2);
+
+    // Nested scopes may disable pooling
+    StringPool::Scope none(nullptr);
+    QVERIFY(decode_ascii(ascii, 12).constData() != a.constData());
+  }
+
+  // Strings outlive the pool
+  QString name;
+  {
+    StringPool::Scope strings;
+    name = decode_ascii(ascii, 12);
+  }
+  QCOMPARE(name, QString("Channel 1"));
+  QVERIFY(nullptr == StringPool::current());
+}
+
+void
+UtilsTest::testTaskScheduler() {
+  QVERIFY(TaskScheduler::instance()->threadCount() >= 1);
+
+  // Errors are merged in task order, independent of the scheduling
+  {
+    TaskGroup group;
+    for (int i=0; i<16; i++) {
+      group.run([i](const ErrorStack &err) {
+        QThread::usleep((16-i)*100);
+        if (i % 2)
+          errMsg(err) << "Task " << i << " failed.";
+        return 0 == (i % 2);
+      });
+    }
+    ErrorStack err;
+    QVERIFY(! group.wait(err));
+    QCOMPARE(err.count(), 8U);
+    QVERIFY(err.message(0).message().contains("Task 1 "));
+    QVERIFY(err.message(7).message().contains("Task 15 "));
+  }
+
+  // Canceled groups skip the tasks not started yet
+  {
+    TaskGroup group;
+    group.cancel();
+    QVERIFY(group.isCanceled());
+    bool run = false;
+    group.run([&run](const ErrorStack &) { run = true; return true; });
+    QVERIFY(! group.wait());
+    QVERIFY(! run);
+  }
+
+  // Nested parallel loops and interactive jobs complete
+  QVector<qint64> sums(64, 0);
+  qint64 *results = sums.data();
+  TaskScheduler::parallelFor(sums.size(), 1, [results](qint64 first, qint64 last) {
+    for (qint64 i=first; i<last; i++) {
+      results[i] = TaskScheduler::parallelReduce(
+            qint64(10000), 100, qint64(0),
+            [](qint64 a, qint64 b) { qint64 s=0; for (qint64 j=a; j<b; j++) s += j; return s; },
+            [](qint64 a, qint64 b) { return a+b; }, TaskScheduler::Priority::Interactive);
+    }
+  });
+  foreach (qint64 sum, sums)
+    QCOMPARE(sum, qint64(10000*9999/2));
+
+  // Reductions are done in chunk order
+  QString order = TaskScheduler::parallelReduce(
+        qint64(1000), 10, QString(),
+        [](qint64 first, qint64 last) { Q_UNUSED(last); return QString("%1,").arg(first); },
+        [](const QString &a, const QString &b) { return a+b; });
+  QVERIFY(order.startsWith("0,10,20,"));
+  QVERIFY(order.endsWith("980,990,"));
+}
+
+void
+UtilsTest::testCancellation() {
+  // Copies share their state
+  CancellationToken token, copy = token;
+  QVERIFY(token == copy);
+  QVERIFY(! (token == CancellationToken()));
+  QVERIFY(copy.check());
+  token.cancel();
+  QVERIFY(copy.isCanceled());
+  ErrorStack err;
+  QVERIFY(! copy.check(err));
+  QVERIFY(! err.isEmpty());
+
+  QTemporaryFile file(QDir::tempPath() + "/userdbXXXXXX.json");
+  QVERIFY(file.open());
+  file.write("{\"users\": [");
+  for (int i=0; i<0x1000; i++)
+    file.write(QString("%1{\"id\": %2, \"callsign\": \"DL%3\", \"fname\": \"Name\"}")
+               .arg(i ? "," : "").arg(2620000+i).arg(i).toUtf8());
+  file.write("]}");
+  file.close();
+
+  UserDatabase db(file.fileName());
+  QFile::remove(QFileInfo(file.fileName()).absoluteDir().filePath(
+                  QFileInfo(file.fileName()).completeBaseName() + ".cache"));
+
+  // A canceled encoding fails, in the foreground and in the background
+  D868UVCallsignDB direct;
+  direct.setCancellationToken(copy);
+  QVERIFY(! direct.encode(&db));
+
+  D868UVCallsignDB background;
+  background.setCancellationToken(copy);
+  background.startEncoding(&db);
+  QVERIFY(! background.finishEncoding());
+}
+
+void
+UtilsTest::testDownloadValidators() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString json = dir.filePath("user.json"), cache = dir.filePath("user.cache");
+  DownloadValidators validators(json);
+
+  // Nothing to revalidate without a download
+  QNetworkRequest request;
+  QVERIFY(validators.store("\"abc\"", "Wed, 14 Oct 2026 07:28:00 GMT"));
+  QVERIFY(! validators.prepare(request));
+
+  QFile file(json);
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write("{\"users\": []}");
+  file.close();
+  QVERIFY(validators.prepare(request));
+  QCOMPARE(request.rawHeader("If-None-Match"), QByteArray("\"abc\""));
+  QCOMPARE(request.rawHeader("If-Modified-Since"), QByteArray("Wed, 14 Oct 2026 07:28:00 GMT"));
+
+  // Touching keeps the dependents not older than the download
+  QFile dependent(cache);
+  QVERIFY(dependent.open(QIODevice::WriteOnly));
+  dependent.close();
+  QVERIFY(validators.touch({cache}));
+  QVERIFY(QFileInfo(json).lastModified() <= QFileInfo(cache).lastModified());
+
+  // Storing no validators removes them
+  QVERIFY(validators.store(QByteArray(), QByteArray()));
+  QVERIFY(! QFile::exists(validators.filename()));
+  QNetworkRequest unconditional;
+  QVERIFY(! validators.prepare(unconditional));
+  QVERIFY(! unconditional.hasRawHeader("If-None-Match"));
+}
+
+void
+UtilsTest::testImageArchive() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  ImageArchive archive(dir.filePath("archive"));
+
+  DFUFile first;
+  first.addImage("Codeplug");
+  first.image(0).addElement(0x0000, 3*ImageArchive::CHUNK_SIZE, -1, 0xff);
+  first.image(0).addElement(0x100000, 0x100);
+  for (uint32_t i=0; i<ImageArchive::CHUNK_SIZE; i++)
+    first.data(i)[0] = uint8_t(i);
+  first.data(0x100000)[0] = 0x42;
+
+  // Erased chunks are stored once
+  ErrorStack err; unsigned newChunks = 0;
+  QVERIFY(archive.store("first", first, err, &newChunks));
+  QCOMPARE(newChunks, 3U);
+  QVERIFY(! archive.store("first", first, err));
+  QVERIFY(! archive.store("../escape", first, err));
+
+  // An almost identical file only adds the modified chunk
+  first.data(0x100000)[1] = 0x43;
+  QVERIFY(archive.store("second", first, err, &newChunks));
+  QCOMPARE(newChunks, 1U);
+  QCOMPARE(archive.names(), QStringList({"first", "second"}));
+  ImageArchive::Entry entry;
+  QVERIFY(archive.entry("second", entry, err));
+  QCOMPARE(entry.memSize, quint64(3*ImageArchive::CHUNK_SIZE + 0x100));
+  QCOMPARE(entry.chunks, 4U);
+
+  // Extracted files can be read as usual
+  QString filename = dir.filePath("second.dfu");
+  QVERIFY(archive.extract("second", filename, err));
+  DFUFile extracted, loaded;
+  QVERIFY(extracted.read(filename, err));
+  QVERIFY(archive.load("second", loaded, err));
+  foreach (const DFUFile *file, QList<const DFUFile *>({&extracted, &loaded})) {
+    QCOMPARE(file->numImages(), 1);
+    QCOMPARE(file->image(0).name(), QString("Codeplug"));
+    QCOMPARE(file->image(0).numElements(), 2);
+    QCOMPARE(file->data(0x1234)[0], uint8_t(0x34));
+    QCOMPARE(file->data(2*ImageArchive::CHUNK_SIZE)[0], uint8_t(0xff));
+    QCOMPARE(file->data(0x100001)[0], uint8_t(0x43));
+  }
+
+  // Removing keeps the shared chunks
+  unsigned removed = 0;
+  QVERIFY(archive.remove("second", err));
+  QVERIFY(archive.collectGarbage(err, &removed));
+  QCOMPARE(removed, 1U);
+  QVERIFY(archive.load("first", loaded, err));
+}
+
+void
+UtilsTest::testFileSignature() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  ErrorStack err;
+
+  // Only the headers are read
+  DFUFile codeplug;
+  codeplug.addImage("TYT MD-390 Codeplug");
+  codeplug.image(0).addElement(0x2000, 0x3e000);
+  codeplug.image(0).addElement(0x110000, 0x90000);
+  QString filename = dir.filePath("md390.dfu");
+  QVERIFY(codeplug.write(filename, err));
+  QVector<DFUFile::ImageHeader> images;
+  QVERIFY(DFUFile::readHeaders(filename, images, err));
+  QCOMPARE(images.size(), 1);
+  QCOMPARE(images[0].name, QString("TYT MD-390 Codeplug"));
+  QCOMPARE(images[0].elements.size(), 2);
+  QCOMPARE(images[0].elements[1].address, 0x110000U);
+  QCOMPARE(images[0].elements[1].size, 0x90000U);
+
+  QList<FileSignature::Match> matches;
+  QVERIFY(FileSignature::identify(filename, matches, err));
+  QCOMPARE(matches.size(), 1);
+  QCOMPARE(matches[0].radio, RadioInfo::MD390);
+  QVERIFY(FileSignature::Content::Codeplug == matches[0].content);
+  QVERIFY(FileSignature::Format::DFU == matches[0].format);
+
+  // A call-sign DB shared by several radios
+  DFUFile db;
+  db.addImage("AnyTone AT-D878UV Callsign database.");
+  db.image(0).addElement(0x4000000, 0x100);
+  filename = dir.filePath("db.dfu");
+  QVERIFY(db.write(filename, err));
+  matches.clear();
+  QVERIFY(FileSignature::identify(filename, matches, err));
+  QCOMPARE(matches.size(), 5);
+  QVERIFY(FileSignature::Content::CallsignDB == matches[0].content);
+
+  // Manufacturer files are identified by size
+  QFile rdt(dir.filePath("codeplug.rdt"));
+  QVERIFY(rdt.open(QIODevice::WriteOnly));
+  rdt.write(QByteArray(262709, char(0xff)));
+  rdt.close();
+  matches.clear();
+  QVERIFY(FileSignature::identify(rdt.fileName(), matches, err));
+  QCOMPARE(matches.size(), 1);
+  QCOMPARE(matches[0].radio, RadioInfo::MD390);
+  QVERIFY(FileSignature::Format::Manufacturer == matches[0].format);
+
+  // Truncated and unknown files are rejected
+  QFile truncated(dir.filePath("md390.dfu"));
+  QVERIFY(truncated.resize(0x1000));
+  QVERIFY(! DFUFile::readHeaders(truncated.fileName(), images));
+  matches.clear();
+  QVERIFY(! FileSignature::identify(truncated.fileName(), matches));
+  QVERIFY(matches.isEmpty());
+}
+
+void
+UtilsTest::testPerformanceHistory() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  PerformanceHistory history(dir.filePath("history.jsonl"));
+  ErrorStack err;
+
+  // A missing history is empty
+  QVector<PerformanceHistory::Record> records;
+  QVERIFY(history.read(records, err));
+  QVERIFY(records.isEmpty());
+
+  PerformanceHistory::Record record;
+  record.timestamp = QDateTime(QDate(2024, 1, 1), QTime(12, 0));
+  record.radio = "TYT MD-390"; record.operation = "write"; record.version = "0.12.0";
+  record.success = true; record.bytesWritten = 0x100000; record.roundTrips = 1024;
+  record.transferTime = 4000000; record.latency = 3900; record.peakResident = 0x1000000;
+  record.phases = {{"connect", 500}, {"write", 4000}};
+  QVERIFY(history.append(record, err));
+  // The next release transfers twice as fast
+  record.timestamp = record.timestamp.addDays(1);
+  record.version = "0.13.0"; record.transferTime = 2000000;
+  QVERIFY(history.append(record, err));
+  record.success = false;
+  QVERIFY(history.append(record, err));
+
+  QVERIFY(history.read(records, err));
+  QCOMPARE(records.size(), 3);
+  QCOMPARE(records[0].radio, QString("TYT MD-390"));
+  QCOMPARE(records[0].operation, QString("write"));
+  QCOMPARE(records[0].duration(), qint64(4500));
+  QCOMPARE(records[0].bytesWritten, quint64(0x100000));
+  QCOMPARE(records[1].transferTime, qint64(2000000));
+  QVERIFY(! records[2].success);
+
+  // Grouped by version, failed runs only count
+  QStringList lines = PerformanceHistory::summarize(records).split("\n", Qt::SkipEmptyParts);
+  QCOMPARE(lines.size(), 3);
+  QVERIFY(lines[1].contains("256.0kb/s"));
+  QVERIFY(lines[2].contains("512.0kb/s"));
+  QVERIFY(lines[2].contains("+100%"));
+  QCOMPARE(lines[2].split(" ", Qt::SkipEmptyParts).at(5), QString("1"));
+
+  // The older half gets dropped once the history exceeds its limit
+  qint64 size = QFileInfo(history.filename()).size();
+  for (int i=0; i<10000; i++) {
+    QVERIFY(history.append(record, err));
+    qint64 newSize = QFileInfo(history.filename()).size();
+    if (newSize < size)
+      break;
+    size = newSize;
+  }
+  QVERIFY(QFileInfo(history.filename()).size() <= PerformanceHistory::MAX_SIZE/2 + 1024);
+  records.clear();
+  QVERIFY(history.read(records, err));
+  QVERIFY(! records.isEmpty());
+  QCOMPARE(records.last().version, QString("0.13.0"));
 }
 
 QTEST_GUILESS_MAIN(UtilsTest)
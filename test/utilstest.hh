@@ -15,11 +15,50 @@ private slots:
   void testEncodeUnicode();
   void testDecodeASCII();
   void testEncodeASCII();
+  void testPackASCII();
+  void testEncodeUTF8();
   void testDecodeFrequency();
   void testEncodeFrequency();
   void testDecodeDMRID_bcd();
   void testEncodeDMRID_bcd();
+  void testBCD8();
   void testFrequencyParser();
+  void testFrequencyFormat();
+  void testLevDist();
+  void testIsUniform();
+  void testElementFields();
+  void testElementView();
+  void testUserDistance();
+  void testUserIndex();
+  void testCSVLexer();
+  void testMappedFile();
+  void testTracer();
+  void testLogLevelFilter();
+  void testAsyncFileLog();
+  void testErrorStack();
+  void testCodeplugPrefetch();
+  void testVirtualDevice();
+  void testSessionReplay();
+  void testProgressReporter();
+  void testCodeplugSections();
+  void testSharedLimits();
+  void testEncodeCache();
+  void testUniformElements();
+  void testPrepareOverwrite();
+  void testDumpRange();
+  void testCallsignSelection();
+  void testCallsignSizeLimit();
+  void testCallsignBackgroundEncoding();
+  void testEncodeProgress();
+  void testEnumTable();
+  void testMemoryUsage();
+  void testStringPool();
+  void testTaskScheduler();
+  void testCancellation();
+  void testDownloadValidators();
+  void testImageArchive();
+  void testFileSignature();
+  void testPerformanceHistory();
 };
 
 #endif // UTILSTEST_HH